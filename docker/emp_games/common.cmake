@@ -36,6 +36,23 @@ target_link_libraries(
   Folly::folly
   re2)
 
+# The allocator linked into the games - options: (system|jemalloc). The games
+# allocate and free the storage of many short lived MPC values on every lane at
+# once. The glibc allocator serves the lanes from a few shared arenas, while
+# jemalloc gives each thread a cache and spreads the threads over arenas per
+# CPU, so that the lanes don't contend on allocations.
+set(EMP_GAMES_MALLOC "system" CACHE STRING "Allocator linked into the games")
+if(EMP_GAMES_MALLOC STREQUAL "jemalloc")
+  find_library(JEMALLOC_LIBRARY NAMES jemalloc)
+  if(NOT JEMALLOC_LIBRARY)
+    message(FATAL_ERROR "EMP_GAMES_MALLOC is jemalloc, but it wasn't found")
+  endif()
+  target_link_libraries(empgamecommon INTERFACE ${JEMALLOC_LIBRARY})
+elseif(NOT EMP_GAMES_MALLOC STREQUAL "system")
+  message(FATAL_ERROR
+    "Unknown EMP_GAMES_MALLOC ${EMP_GAMES_MALLOC}, expected system or jemalloc")
+endif()
+
 # pcf2 lift input processing
 file(GLOB_RECURSE pcf2_lift_input_processing_src
   "fbpcs/emp_games/lift/pcf2_calculator/input_processing/**.cpp"
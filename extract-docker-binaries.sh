@@ -92,6 +92,7 @@ docker cp "$TEMP_CONTAINER_NAME":/usr/local/bin/pid_preparer "$SCRIPT_DIR/binari
 docker cp "$TEMP_CONTAINER_NAME":/usr/local/bin/lift_id_combiner "$SCRIPT_DIR/binaries_out/."
 docker cp "$TEMP_CONTAINER_NAME":/usr/local/bin/attribution_id_combiner "$SCRIPT_DIR/binaries_out/."
 docker cp "$TEMP_CONTAINER_NAME":/usr/local/bin/private_id_dfca_id_combiner "$SCRIPT_DIR/binaries_out/."
+docker cp "$TEMP_CONTAINER_NAME":/usr/local/bin/input_data_validator "$SCRIPT_DIR/binaries_out/."
 fi
 
 if [ "$PACKAGE" = "pid" ]; then
@@ -10,7 +10,11 @@
 #include "AttributionIdSpineCombinerOptions.h"
 
 DEFINE_int32(padding_size, 4, "Size of aggregated rows to retain");
-DEFINE_string(spine_path, "", "File path which contains the identity spine");
+DEFINE_string(
+    spine_path,
+    "",
+    "File path which contains the identity spine. For MR-PID, also a local "
+    "directory of part files, which are read in parallel");
 DEFINE_string(data_path, "", "File path which contains the data file");
 DEFINE_string(
     output_path,
@@ -30,6 +34,14 @@ DEFINE_bool(
     false,
     "Log cost info into cloud which will be used for dashboard");
 DEFINE_int32(max_id_column_cnt, 1, "Maximum number of id columns to use as id");
+DEFINE_int32(
+    num_threads,
+    1,
+    "Number of PID ranges of the id swap output to combine in parallel");
+DEFINE_string(
+    output_format,
+    "csv",
+    "Format of the combined output - options: (csv|row_group)");
 DEFINE_string(log_cost_s3_bucket, "", "s3 bucket name");
 DEFINE_string(
     log_cost_s3_region,
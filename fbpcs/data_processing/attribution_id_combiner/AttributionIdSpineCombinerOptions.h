@@ -20,5 +20,7 @@ DECLARE_bool(log_cost);
 DECLARE_string(log_cost_s3_bucket);
 DECLARE_string(log_cost_s3_region);
 DECLARE_int32(max_id_column_cnt);
+DECLARE_int32(num_threads);
+DECLARE_string(output_format);
 DECLARE_string(protocol_type);
 DECLARE_string(run_id);
@@ -7,17 +7,15 @@
 
 #include "fbpcs/data_processing/attribution_id_combiner/AttributionStrategy.h"
 
-#include <folly/Random.h>
 #include <folly/logging/xlog.h>
 
 #include <boost/algorithm/string.hpp>
 #include "fbpcf/io/api/FileIOWrappers.h"
-#include "fbpcs/data_processing/common/FilepathHelpers.h"
-#include "fbpcs/data_processing/id_combiner/AddPaddingToCols.h"
+#include "fbpcs/data_processing/id_combiner/CombineGroups.h"
 #include "fbpcs/data_processing/id_combiner/DataPreparationHelpers.h"
 #include "fbpcs/data_processing/id_combiner/DataValidation.h"
-#include "fbpcs/data_processing/id_combiner/GroupBy.h"
-#include "fbpcs/data_processing/id_combiner/SortIds.h"
+#include "fbpcs/data_processing/id_combiner/OutputFormat.h"
+#include "fbpcs/data_processing/id_combiner/PartitionedCombine.h"
 
 namespace pid::combiner {
 
@@ -25,46 +23,41 @@ void AttributionStrategy::aggregate(
     std::stringstream& idSwapOutFile,
     FileMetaData& meta,
     std::string outputPath) {
-  std::filesystem::path tmpDirectory{FLAGS_tmp_directory};
-  // Get a random ID to avoid potential name collisions if multiple
-  // runs at the same time point to the same input file
-  auto randomId = std::to_string(folly::Random::secureRand64());
-  std::string tmpFilename = randomId + "_" +
-      private_lift::filepath_helpers::getBaseFilename(outputPath);
-  auto tmpFilepath = tmpDirectory / tmpFilename;
-  XLOG(INFO) << "Writing temporary file to " << tmpFilepath;
-  std::ofstream outFile{tmpFilepath};
-
-  std::vector<int32_t> colPaddingSize(
-      meta.aggregatedCols.size(), FLAGS_padding_size);
-  std::stringstream groupByOutFile;
-  std::stringstream groupByUnsortedOutFile;
-  if (FLAGS_sort_strategy == "sort") {
-    groupBy(idSwapOutFile, "id_", meta.aggregatedCols, groupByUnsortedOutFile);
-    sortIds(groupByUnsortedOutFile, groupByOutFile);
-  } else if (FLAGS_sort_strategy == "keep_original") {
-    groupBy(idSwapOutFile, "id_", meta.aggregatedCols, groupByOutFile);
-  } else {
+  if (FLAGS_sort_strategy != "sort" && FLAGS_sort_strategy != "keep_original") {
     XLOG(FATAL) << "Invalid sort strategy '" << FLAGS_sort_strategy
                 << "'. Expected 'sort' or 'keep_original'.";
   }
 
-  std::stringstream paddedOutFile;
-  addPaddingToCols(
-      groupByOutFile, meta.aggregatedCols, colPaddingSize, true, paddedOutFile);
-
   std::vector<std::string> partnerColsToConvert = {
       "conversion_timestamp", "conversion_value"};
   std::vector<std::string> publisherColsToConvert = {"ad_id", "timestamp"};
-  std::vector<std::string> columnsToConvert =
-      meta.isPublisherDataset ? publisherColsToConvert : partnerColsToConvert;
-  headerColumnsToPlural(paddedOutFile, columnsToConvert, outFile);
 
-  outFile.close();
-  if (outputPath != tmpFilepath) {
-    fbpcf::io::FileIOWrappers::transferFileInParts(tmpFilepath, outputPath);
-    std::remove(tmpFilepath.c_str());
-  }
+  // Group by id_, sort by id_ if requested, pad the aggregated columns and
+  // pluralize the converted column headers, all in a single pass. PID ranges
+  // of the id swap output are combined in parallel if requested.
+  CombineGroupsOptions options;
+  options.columnsToAggregate = meta.aggregatedCols;
+  options.sortById = FLAGS_sort_strategy == "sort";
+  options.padSizePerCol =
+      std::vector<int32_t>(meta.aggregatedCols.size(), FLAGS_padding_size);
+  options.enforceMax = true;
+  options.columnsToPluralize =
+      meta.isPublisherDataset ? publisherColsToConvert : partnerColsToConvert;
+  writeOutputFile(
+      [&](std::ostream& outFile) {
+        combinePartitioned(
+            idSwapOutFile,
+            outFile,
+            FLAGS_num_threads,
+            options.sortById,
+            true,
+            [&options](std::istream& in, std::ostream& out) {
+              combineGroups(in, out, options);
+            });
+      },
+      outputPath,
+      FLAGS_output_format,
+      FLAGS_tmp_directory);
 }
 
 bool AttributionStrategy::getFileType(std::string headerLine) {
@@ -15,13 +15,18 @@
 #include <iomanip>
 #include <istream>
 #include <stdexcept>
+#include <thread>
 #include <unordered_map>
 
 #include "fbpcs/data_processing/id_combiner/IdSwapMultiKey.h"
+#include "fbpcs/data_processing/id_combiner/SpineParts.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
 
 namespace pid::combiner {
 MrPidAttributionIdCombiner::MrPidAttributionIdCombiner()
-    : spineIdFilePath(FLAGS_spine_path), outputPath{FLAGS_output_path} {
+    : spineIdFilePath(FLAGS_spine_path),
+      spineParts(getSpineParts(FLAGS_spine_path)),
+      outputPath{FLAGS_output_path} {
   XLOG(INFO) << "Starting attribution id combiner run on: " << "spine_path: "
              << FLAGS_spine_path << ", output_path: " << FLAGS_output_path
              << ", tmp_directory: " << FLAGS_tmp_directory
@@ -29,7 +34,9 @@ MrPidAttributionIdCombiner::MrPidAttributionIdCombiner()
              << ", max_id_column_cnt: " << FLAGS_max_id_column_cnt
              << ", protocol_type: " << FLAGS_protocol_type;
 
-  auto spineReader = std::make_unique<fbpcf::io::FileReader>(FLAGS_spine_path);
+  // The header is read from the first part
+  auto spineReader =
+      private_measurement::compressed_io::makeFileReader(spineParts.front());
   spineIdFile =
       std::make_shared<fbpcf::io::BufferedReader>(std::move(spineReader));
 }
@@ -40,10 +47,11 @@ MrPidAttributionIdCombiner::~MrPidAttributionIdCombiner() {
 std::stringstream MrPidAttributionIdCombiner::idSwap(std::string headerLine) {
   std::stringstream idSwapOutFile;
   idSwapOutFile << headerLine << "\n";
-  while (!spineIdFile->eof()) {
-    auto spineRow = spineIdFile->readLine();
-    idSwapOutFile << spineRow << "\n";
-  }
+  readSpineParts(
+      spineParts,
+      headerLine,
+      idSwapOutFile,
+      std::thread::hardware_concurrency());
   return idSwapOutFile;
 }
 
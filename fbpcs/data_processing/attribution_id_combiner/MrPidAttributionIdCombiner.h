@@ -51,6 +51,8 @@ BBB     [0, 0, 0, a1]     [0, 0, 0, t1]      [0, 0, 0, 0]
 class MrPidAttributionIdCombiner : public AttributionStrategy {
   std::shared_ptr<fbpcf::io::BufferedReader> spineIdFile;
   std::string spineIdFilePath;
+  // The part files of the spine, or just the spine file
+  std::vector<std::string> spineParts;
   std::filesystem::path outputPath;
   std::filesystem::path tmpFilepath;
 
@@ -16,6 +16,7 @@
 #include <unordered_map>
 
 #include "fbpcs/data_processing/id_combiner/IdSwapMultiKey.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
 
 namespace pid::combiner {
 PidAttributionIdCombiner::PidAttributionIdCombiner()
@@ -28,8 +29,10 @@ PidAttributionIdCombiner::PidAttributionIdCombiner()
              << ", max_id_column_cnt: " << FLAGS_max_id_column_cnt
              << ", protocol_type: " << FLAGS_protocol_type;
 
-  auto dataReader = std::make_unique<fbpcf::io::FileReader>(FLAGS_data_path);
-  auto spineReader = std::make_unique<fbpcf::io::FileReader>(FLAGS_spine_path);
+  auto dataReader =
+      private_measurement::compressed_io::makeFileReader(FLAGS_data_path);
+  auto spineReader =
+      private_measurement::compressed_io::makeFileReader(FLAGS_spine_path);
   dataFile = std::make_shared<fbpcf::io::BufferedReader>(std::move(dataReader));
   spineIdFile =
       std::make_shared<fbpcf::io::BufferedReader>(std::move(spineReader));
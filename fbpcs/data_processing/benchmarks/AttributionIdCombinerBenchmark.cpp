@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "fbpcs/data_processing/attribution_id_combiner/AttributionIdSpineCombinerOptions.h"
+#include "fbpcs/data_processing/attribution_id_combiner/PidAttributionIdCombiner.h"
+#include "fbpcs/data_processing/benchmarks/DataProcessingBenchmarkUtil.h"
+
+namespace data_processing::benchmarks {
+
+namespace {
+const GeneratedFile& getAttributionInput(Role role, std::size_t numRows) {
+  static std::map<std::size_t, std::unique_ptr<GeneratedFile>> publisherCache;
+  static std::map<std::size_t, std::unique_ptr<GeneratedFile>> partnerCache;
+  if (role == Role::Publisher) {
+    return getGeneratedFile(publisherCache, numRows, [](std::size_t n) {
+      return GeneratedFile::makeInput(
+          Role::Publisher,
+          kAttributionPublisherColumns,
+          n,
+          kAttributionPublisherHeader);
+    });
+  }
+  return getGeneratedFile(partnerCache, numRows, [](std::size_t n) {
+    return GeneratedFile::makeInput(
+        Role::Partner,
+        kAttributionPartnerColumns,
+        n,
+        kAttributionPartnerHeader);
+  });
+}
+
+const GeneratedFile& getSpine(std::size_t numRows) {
+  static std::map<std::size_t, std::unique_ptr<GeneratedFile>> cache;
+  return getGeneratedFile(cache, numRows, GeneratedFile::makeSpine);
+}
+} // namespace
+
+/*
+ * Combines the generated attribution input of state.range(0) rows with its
+ * spine, combining the id swap output with state.range(1) threads. The
+ * combiner takes its paths from the flags it is run with.
+ */
+static void BM_PidAttributionIdCombiner(benchmark::State& state, Role role) {
+  std::size_t numRows = state.range(0);
+  const auto& input = getAttributionInput(role, numRows);
+  const auto& spine = getSpine(numRows);
+  FLAGS_data_path = input.getPath();
+  FLAGS_spine_path = spine.getPath();
+  FLAGS_output_path = tempPath("attribution_combined");
+  FLAGS_tmp_directory = std::filesystem::temp_directory_path();
+  FLAGS_num_threads = state.range(1);
+
+  for (auto _ : state) {
+    pid::combiner::PidAttributionIdCombiner combiner;
+    combiner.run();
+    state.PauseTiming();
+    removeAll({FLAGS_output_path});
+    state.ResumeTiming();
+  }
+  setThroughput(state, numRows, input.getNumBytes() + spine.getNumBytes());
+}
+BENCHMARK_CAPTURE(BM_PidAttributionIdCombiner, publisher, Role::Publisher)
+    ->ArgsProduct({kNumRows, kNumThreads})
+    ->ArgNames({"rows", "threads"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_PidAttributionIdCombiner, partner, Role::Partner)
+    ->ArgsProduct({kNumRows, kNumThreads})
+    ->ArgNames({"rows", "threads"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+} // namespace data_processing::benchmarks
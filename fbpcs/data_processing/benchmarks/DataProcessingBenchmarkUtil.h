@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/Format.h>
+#include <folly/Random.h>
+
+#include "fbpcs/data_processing/load_testing_utils/FakeDataGenerator.h"
+
+namespace data_processing::benchmarks {
+
+// Fixed, so that every run of a benchmark sees the same input
+constexpr uint32_t kSeed = 42;
+
+inline const std::vector<int64_t> kNumRows = {1 << 16, 1 << 20};
+inline const std::vector<int64_t> kNumThreads = {1, 2, 4, 8};
+
+inline const std::vector<std::string> kLiftPublisherHeader = {
+    "id_",
+    "opportunity_timestamp",
+    "test_flag",
+    "num_impressions",
+    "num_clicks",
+    "total_spend",
+    "breakdown_id"};
+
+inline const std::vector<std::string> kLiftPartnerHeader =
+    {"id_", "event_timestamp", "value", "cohort_id"};
+
+// Attribution inputs are generated from lift columns of the same kind: the
+// small engagement counts stand in for ad ids and the 0/1 breakdown for
+// is_click
+inline const std::vector<std::string> kAttributionPublisherColumns =
+    {"id_", "num_clicks", "opportunity_timestamp", "breakdown_id"};
+inline const std::vector<std::string> kAttributionPublisherHeader =
+    {"id_", "ad_id", "timestamp", "is_click"};
+inline const std::vector<std::string> kAttributionPartnerColumns =
+    {"id_", "event_timestamp", "value"};
+inline const std::vector<std::string> kAttributionPartnerHeader =
+    {"id_", "conversion_timestamp", "conversion_value"};
+
+inline std::string tempPath(const std::string& name) {
+  return folly::sformat(
+      "{}/benchmark_{}_{}",
+      std::filesystem::temp_directory_path().string(),
+      name,
+      folly::Random::secureRand64());
+}
+
+/*
+ * A file of generated rows, removed when it goes out of scope.
+ */
+class GeneratedFile {
+ public:
+  /*
+   * Writes numRows rows of the given generator columns under header, which
+   * names the columns in the file and defaults to the generator columns.
+   */
+  static std::unique_ptr<GeneratedFile> makeInput(
+      Role role,
+      const std::vector<std::string>& columns,
+      std::size_t numRows,
+      const std::vector<std::string>& header = {}) {
+    FakeDataGenerator generator{
+        FakeDataGeneratorParams{role, columns}
+            .withOpportunityRate(1)
+            .withPurchaseRate(1),
+        kSeed};
+    std::unique_ptr<GeneratedFile> generated{new GeneratedFile{"input"}};
+    std::ofstream file{generated->path_};
+    const auto& headerNames = header.empty() ? columns : header;
+    for (std::size_t i = 0; i < headerNames.size(); ++i) {
+      file << (i > 0 ? "," : "") << headerNames.at(i);
+    }
+    file << '\n';
+    for (std::size_t i = 0; i < numRows; ++i) {
+      file << generator.genOneRow() << '\n';
+    }
+    generated->numBytes_ = file.tellp();
+    return generated;
+  }
+
+  /*
+   * Writes the identity spine of the ids of numRows generated rows, as
+   * `private_id,id` rows like the output of the pid match step.
+   */
+  static std::unique_ptr<GeneratedFile> makeSpine(std::size_t numRows) {
+    FakeDataGenerator generator{
+        FakeDataGeneratorParams{Role::Publisher, {"id_"}}.withOpportunityRate(
+            1),
+        kSeed};
+    std::unique_ptr<GeneratedFile> generated{new GeneratedFile{"spine"}};
+    std::ofstream file{generated->path_};
+    for (std::size_t i = 0; i < numRows; ++i) {
+      file << folly::sformat("{:016x}", i) << ',' << generator.genOneRow()
+           << '\n';
+    }
+    generated->numBytes_ = file.tellp();
+    return generated;
+  }
+
+  ~GeneratedFile() {
+    std::remove(path_.c_str());
+  }
+
+  GeneratedFile(const GeneratedFile&) = delete;
+  GeneratedFile& operator=(const GeneratedFile&) = delete;
+
+  const std::string& getPath() const {
+    return path_;
+  }
+
+  uint64_t getNumBytes() const {
+    return numBytes_;
+  }
+
+ private:
+  explicit GeneratedFile(const std::string& name) : path_{tempPath(name)} {}
+
+  std::string path_;
+  uint64_t numBytes_ = 0;
+};
+
+/*
+ * The file makeFile generates for each row count, so that it is written once
+ * for all the thread counts it is benchmarked at. The files are removed on
+ * exit.
+ */
+template <typename MakeFile>
+const GeneratedFile& getGeneratedFile(
+    std::map<std::size_t, std::unique_ptr<GeneratedFile>>& cache,
+    std::size_t numRows,
+    MakeFile makeFile) {
+  auto& file = cache[numRows];
+  if (file == nullptr) {
+    file = makeFile(numRows);
+  }
+  return *file;
+}
+
+inline void removeAll(const std::vector<std::string>& paths) {
+  for (const auto& path : paths) {
+    std::remove(path.c_str());
+  }
+}
+
+// Rows and bytes of input processed per second
+inline void setThroughput(
+    benchmark::State& state,
+    std::size_t numRows,
+    uint64_t numBytes) {
+  state.SetItemsProcessed(state.iterations() * numRows);
+  state.SetBytesProcessed(state.iterations() * numBytes);
+}
+
+} // namespace data_processing::benchmarks
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "fbpcs/data_processing/benchmarks/DataProcessingBenchmarkUtil.h"
+#include "fbpcs/data_processing/lift_id_combiner/LiftIdSpineCombinerOptions.h"
+#include "fbpcs/data_processing/lift_id_combiner/LiftIdSpineFileCombiner.h"
+#include "fbpcs/data_processing/lift_id_combiner/PidLiftIdCombiner.h"
+
+namespace data_processing::benchmarks {
+
+namespace {
+const GeneratedFile& getLiftInput(Role role, std::size_t numRows) {
+  static std::map<std::size_t, std::unique_ptr<GeneratedFile>> publisherCache;
+  static std::map<std::size_t, std::unique_ptr<GeneratedFile>> partnerCache;
+  const auto& header =
+      role == Role::Publisher ? kLiftPublisherHeader : kLiftPartnerHeader;
+  return getGeneratedFile(
+      role == Role::Publisher ? publisherCache : partnerCache,
+      numRows,
+      [role, &header](std::size_t n) {
+        return GeneratedFile::makeInput(role, header, n);
+      });
+}
+
+const GeneratedFile& getSpine(std::size_t numRows) {
+  static std::map<std::size_t, std::unique_ptr<GeneratedFile>> cache;
+  return getGeneratedFile(cache, numRows, GeneratedFile::makeSpine);
+}
+} // namespace
+
+/*
+ * Combines the generated lift input of state.range(0) rows with its spine,
+ * combining the id swap output with state.range(1) threads.
+ */
+static void BM_PidLiftIdCombiner(benchmark::State& state, Role role) {
+  std::size_t numRows = state.range(0);
+  const auto& input = getLiftInput(role, numRows);
+  const auto& spine = getSpine(numRows);
+  FLAGS_num_threads = state.range(1);
+  auto outputPath = tempPath("lift_combined");
+
+  for (auto _ : state) {
+    pid::combiner::PidLiftIdCombiner combiner{
+        input.getPath(),
+        spine.getPath(),
+        outputPath,
+        std::filesystem::temp_directory_path(),
+        "sort",
+        1,
+        pid::combiner::PROTOCOL_PID};
+    combiner.run();
+    state.PauseTiming();
+    removeAll({outputPath});
+    state.ResumeTiming();
+  }
+  setThroughput(state, numRows, input.getNumBytes() + spine.getNumBytes());
+}
+BENCHMARK_CAPTURE(BM_PidLiftIdCombiner, publisher, Role::Publisher)
+    ->ArgsProduct({kNumRows, kNumThreads})
+    ->ArgNames({"rows", "threads"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_PidLiftIdCombiner, partner, Role::Partner)
+    ->ArgsProduct({kNumRows, kNumThreads})
+    ->ArgNames({"rows", "threads"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+} // namespace data_processing::benchmarks
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <benchmark/benchmark.h>
+#include <emmintrin.h>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+
+#include "fbpcf/engine/util/AesPrgFactory.h"
+#include "fbpcs/data_processing/benchmarks/DataProcessingBenchmarkUtil.h"
+#include "fbpcs/data_processing/pid_preparer/UnionPIDDataPreparer.h"
+#include "fbpcs/data_processing/sharding/GenericSharder.h"
+#include "fbpcs/data_processing/sharding/HashBasedSharder.h"
+#include "fbpcs/data_processing/sharding/RoundRobinBasedSharder.h"
+#include "fbpcs/data_processing/sharding/SecureRandomSharder.h"
+
+DECLARE_int32(sharding_threads);
+
+namespace data_processing::benchmarks {
+
+namespace {
+constexpr std::size_t kNumShards = 8;
+// Large enough that progress is never logged while timing
+constexpr int32_t kLogEveryN = 1 << 30;
+
+const GeneratedFile& getPublisherInput(std::size_t numRows) {
+  static std::map<std::size_t, std::unique_ptr<GeneratedFile>> cache;
+  return getGeneratedFile(cache, numRows, [](std::size_t n) {
+    return GeneratedFile::makeInput(Role::Publisher, kLiftPublisherHeader, n);
+  });
+}
+
+/*
+ * Shards the generated publisher input of state.range(0) rows into
+ * kNumShards files with state.range(1) threads. makeSharder is called once per
+ * iteration, as a sharder counts the rows it has written.
+ */
+template <typename MakeSharder>
+void benchmarkSharder(benchmark::State& state, MakeSharder makeSharder) {
+  std::size_t numRows = state.range(0);
+  const auto& input = getPublisherInput(numRows);
+  FLAGS_sharding_threads = state.range(1);
+  auto outputPaths =
+      sharder::GenericSharder::genOutputPaths(tempPath("shard"), 0, kNumShards);
+  // The shard distribution and costs the sharder writes next to the shards
+  auto writtenPaths = outputPaths;
+  writtenPaths.push_back(outputPaths.at(0) + "_shardDistribution");
+  writtenPaths.push_back(outputPaths.at(0) + "_shardCosts");
+
+  for (auto _ : state) {
+    makeSharder(input.getPath(), outputPaths)->shard();
+    state.PauseTiming();
+    removeAll(writtenPaths);
+    state.ResumeTiming();
+  }
+  setThroughput(state, numRows, input.getNumBytes());
+}
+} // namespace
+
+static void BM_HashBasedSharder(benchmark::State& state) {
+  benchmarkSharder(
+      state,
+      [](const std::string& inputPath,
+         const std::vector<std::string>& outputPaths) {
+        return std::make_unique<sharder::HashBasedSharder>(
+            inputPath, outputPaths, kLogEveryN, "");
+      });
+}
+BENCHMARK(BM_HashBasedSharder)
+    ->ArgsProduct({kNumRows, kNumThreads})
+    ->ArgNames({"rows", "threads"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+static void BM_RoundRobinBasedSharder(benchmark::State& state) {
+  benchmarkSharder(
+      state,
+      [](const std::string& inputPath,
+         const std::vector<std::string>& outputPaths) {
+        return std::make_unique<sharder::RoundRobinBasedSharder>(
+            inputPath, outputPaths, kLogEveryN);
+      });
+}
+BENCHMARK(BM_RoundRobinBasedSharder)
+    ->ArgsProduct({kNumRows, kNumThreads})
+    ->ArgNames({"rows", "threads"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+static void BM_SecureRandomSharder(benchmark::State& state) {
+  benchmarkSharder(
+      state,
+      [](const std::string& inputPath,
+         const std::vector<std::string>& outputPaths) {
+        // A fixed key in place of the one agreed on with the other party
+        fbpcf::engine::util::AesPrgFactory prgFactory;
+        return std::make_unique<sharder::SecureRandomSharder>(
+            inputPath,
+            outputPaths,
+            kLogEveryN,
+            prgFactory.create(_mm_set_epi32(0, 1, 2, 3)));
+      });
+}
+BENCHMARK(BM_SecureRandomSharder)
+    ->ArgsProduct({kNumRows, kNumThreads})
+    ->ArgNames({"rows", "threads"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+static void BM_UnionPIDDataPreparer(benchmark::State& state) {
+  std::size_t numRows = state.range(0);
+  const auto& input = getPublisherInput(numRows);
+  auto outputPath = tempPath("pid_prepared");
+  measurement::pid::UnionPIDDataPreparer preparer{
+      input.getPath(),
+      outputPath,
+      std::filesystem::temp_directory_path(),
+      1,
+      -1,
+      kLogEveryN,
+      state.range(1)};
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(preparer.prepare());
+    state.PauseTiming();
+    removeAll({outputPath});
+    state.ResumeTiming();
+  }
+  setThroughput(state, numRows, input.getNumBytes());
+}
+BENCHMARK(BM_UnionPIDDataPreparer)
+    ->ArgsProduct({kNumRows, kNumThreads})
+    ->ArgNames({"rows", "threads"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+} // namespace data_processing::benchmarks
@@ -8,8 +8,11 @@
 #include "fbpcs/data_processing/hash_slinging_salter/HashSlingingSalter.hpp"
 #include "fbpcs/data_processing/hash_slinging_salter/base64.h"
 
+#include <openssl/evp.h>
 #include <openssl/hmac.h>
+#include <algorithm>
 #include <array>
+#include <stdexcept>
 
 namespace private_lift::hash_slinging_salter {
 
@@ -36,4 +39,84 @@ std::string base64SaltedHashFromBase64Key(
   return base64::encode(saltedHash(id, base64::decode(base64Key)));
 }
 
+SaltedHasher::SaltedHasher(const std::string& key)
+    : ctx_{HMAC_CTX_new(), &HMAC_CTX_free} {
+  if (ctx_ == nullptr ||
+      HMAC_Init_ex(
+          ctx_.get(),
+          key.data(),
+          static_cast<int>(key.size()),
+          EVP_sha256(),
+          nullptr) != 1) {
+    throw std::runtime_error("Failed to initialize the HMAC context");
+  }
+}
+
+SaltedHasher SaltedHasher::fromBase64Key(const std::string& base64Key) {
+  return SaltedHasher{base64::decode(base64Key)};
+}
+
+std::optional<HashedId> HashedId::fromBase64(std::string_view base64) {
+  // 32 bytes take 43 characters and one padding character, which decode into
+  // 33 bytes whose last one is zero
+  if (base64.size() != kBase64Size || base64[kBase64Size - 1] != '=' ||
+      base64[kBase64Size - 2] == '=') {
+    return std::nullopt;
+  }
+  std::array<unsigned char, kSize + 1> decoded;
+  if (EVP_DecodeBlock(
+          decoded.data(),
+          reinterpret_cast<unsigned char const*>(base64.data()),
+          static_cast<int>(base64.size())) != kSize + 1) {
+    return std::nullopt;
+  }
+  HashedId id;
+  std::copy(decoded.begin(), decoded.begin() + kSize, id.bytes.begin());
+  return id;
+}
+
+std::string HashedId::toBase64() const {
+  // EVP_EncodeBlock adds a terminating null
+  std::array<unsigned char, kBase64Size + 1> encoded;
+  EVP_EncodeBlock(encoded.data(), bytes.data(), kSize);
+  return std::string{
+      reinterpret_cast<char const*>(encoded.data()), kBase64Size};
+}
+
+HashedId SaltedHasher::hashId(std::string_view id) {
+  HashedId hashed;
+  unsigned int hashLen;
+
+  // Passing no key and no digest resets the context to its keyed state, so
+  // the key setup isn't repeated for every id
+  if (HMAC_Init_ex(ctx_.get(), nullptr, 0, nullptr, nullptr) != 1 ||
+      HMAC_Update(
+          ctx_.get(),
+          reinterpret_cast<unsigned char const*>(id.data()),
+          id.size()) != 1 ||
+      HMAC_Final(ctx_.get(), hashed.bytes.data(), &hashLen) != 1 ||
+      hashLen != HashedId::kSize) {
+    throw std::runtime_error("Failed to compute HMAC");
+  }
+  return hashed;
+}
+
+std::string SaltedHasher::hash(std::string_view id) {
+  return std::string{hashId(id).view()};
+}
+
+std::string SaltedHasher::base64Hash(std::string_view id) {
+  return hashId(id).toBase64();
+}
+
+std::vector<std::string> SaltedHasher::base64HashBatch(
+    const std::vector<std::string_view>& ids) {
+  std::vector<std::string> hashes;
+  hashes.reserve(ids.size());
+  for (auto id : ids) {
+    hashes.push_back(base64Hash(id));
+  }
+  return hashes;
+}
+
 } // namespace private_lift::hash_slinging_salter
@@ -7,7 +7,17 @@
 
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include <openssl/hmac.h>
 
 namespace private_lift::hash_slinging_salter {
 
@@ -16,4 +26,143 @@ std::string base64SaltedHashFromBase64Key(
     const std::string& id,
     const std::string& base64_key);
 
+/**
+ * The raw HMAC_SHA256 digest of an id. Hashed ids are carried as these 32
+ * bytes, which are compared with memcmp and hashed by taking a word of the
+ * digest, and are only base64-encoded where they are written out.
+ */
+struct HashedId {
+  static constexpr std::size_t kSize = 32;
+  // The length of the base64 encoding of a digest
+  static constexpr std::size_t kBase64Size = 44;
+
+  std::array<unsigned char, kSize> bytes{};
+
+  /**
+   * Decode the base64 encoding of a digest, as written by toBase64.
+   *
+   * @param base64 the base64-encoded digest
+   * @returns the digest, or nothing if base64 doesn't encode 32 bytes
+   */
+  static std::optional<HashedId> fromBase64(std::string_view base64);
+
+  /**
+   * @returns the base64 encoding of the digest
+   */
+  std::string toBase64() const;
+
+  /**
+   * @returns the digest as a string of its 32 bytes
+   */
+  std::string_view view() const {
+    return std::string_view{reinterpret_cast<const char*>(bytes.data()), kSize};
+  }
+
+  /**
+   * The little-endian word of 8 bytes at index, the same on both big- and
+   * little-endian machines. The digest is uniformly distributed, so any of
+   * its words is a hash of the id.
+   *
+   * @param index which of the 4 words of the digest to take
+   */
+  uint64_t word(std::size_t index) const {
+    uint64_t value = 0;
+    for (std::size_t i = 0; i < 8; ++i) {
+      value |= static_cast<uint64_t>(bytes[index * 8 + i]) << (8 * i);
+    }
+    return value;
+  }
+
+  /**
+   * The leading 8 bytes as a big-endian integer, so that digests order as
+   * their prefixes do.
+   */
+  uint64_t prefix() const {
+    uint64_t value = 0;
+    for (std::size_t i = 0; i < 8; ++i) {
+      value = (value << 8) | bytes[i];
+    }
+    return value;
+  }
+
+  bool operator==(const HashedId& other) const {
+    return std::memcmp(bytes.data(), other.bytes.data(), kSize) == 0;
+  }
+
+  bool operator!=(const HashedId& other) const {
+    return !(*this == other);
+  }
+
+  bool operator<(const HashedId& other) const {
+    return std::memcmp(bytes.data(), other.bytes.data(), kSize) < 0;
+  }
+};
+
+// Hashes a HashedId for unordered containers
+struct HashedIdHasher {
+  std::size_t operator()(const HashedId& id) const {
+    return static_cast<std::size_t>(id.word(0));
+  }
+};
+
+/**
+ * A reusable HMAC_SHA256 context for hashing many ids with the same key. The
+ * key is decoded and absorbed into the context once, and every hash after that
+ * only resets the context back to that keyed state. The hashes are identical
+ * to the ones from saltedHash. Not thread safe, so every thread which hashes
+ * ids needs its own SaltedHasher.
+ */
+class SaltedHasher {
+ public:
+  /**
+   * Create a hasher for a raw key.
+   *
+   * @param key the HMAC key
+   */
+  explicit SaltedHasher(const std::string& key);
+
+  /**
+   * Create a hasher for a base64-encoded key.
+   *
+   * @param base64Key the base64-encoded HMAC key
+   */
+  static SaltedHasher fromBase64Key(const std::string& base64Key);
+
+  /**
+   * Hash an id.
+   *
+   * @param id the id to hash
+   * @returns the raw HMAC_SHA256 digest of id
+   */
+  std::string hash(std::string_view id);
+
+  /**
+   * Hash an id into a fixed size digest, without allocating.
+   *
+   * @param id the id to hash
+   * @returns the HMAC_SHA256 digest of id
+   */
+  HashedId hashId(std::string_view id);
+
+  /**
+   * Hash an id and base64-encode the digest.
+   *
+   * @param id the id to hash
+   * @returns the base64-encoded HMAC_SHA256 digest of id
+   */
+  std::string base64Hash(std::string_view id);
+
+  /**
+   * Hash a batch of ids and base64-encode the digests.
+   *
+   * @param ids the ids to hash
+   * @returns the base64-encoded HMAC_SHA256 digest of every id, in order
+   */
+  std::vector<std::string> base64HashBatch(
+      const std::vector<std::string_view>& ids);
+
+ private:
+  std::unique_ptr<HMAC_CTX, decltype(&HMAC_CTX_free)> ctx_;
+};
+
 } // namespace private_lift::hash_slinging_salter
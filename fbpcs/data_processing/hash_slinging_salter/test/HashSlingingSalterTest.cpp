@@ -8,6 +8,8 @@
 #include "fbpcs/data_processing/hash_slinging_salter/HashSlingingSalter.hpp"
 #include <gtest/gtest.h>
 #include <string>
+#include <string_view>
+#include <vector>
 
 TEST(HashSalterTest, HashSalterSameAsPythonTest) {
   /*
@@ -39,3 +41,58 @@ TEST(HashSalterTest, HashSalterSameAsPythonTest) {
           piiKey, b64Salt);
   EXPECT_EQ(b64SaltedHashFromCpp, b64SaltedHashFromPy);
 }
+
+TEST(HashSalterTest, SaltedHasherMatchesSaltedHashTest) {
+  auto b64Salt = "CoXbp7BOEvAN9L1CB2DAORHHr3hB7wE7tpxMYm07tc0=";
+  auto hasher =
+      private_lift::hash_slinging_salter::SaltedHasher::fromBase64Key(b64Salt);
+  std::vector<std::string_view> ids{
+      "super_secret_email@example.com", "", "another_email@example.com"};
+
+  // Hash the same ids twice to make sure the context is reset between ids
+  for (auto i = 0; i < 2; ++i) {
+    auto hashes = hasher.base64HashBatch(ids);
+    ASSERT_EQ(hashes.size(), ids.size());
+    for (std::size_t j = 0; j < ids.size(); ++j) {
+      auto expected =
+          private_lift::hash_slinging_salter::base64SaltedHashFromBase64Key(
+              std::string{ids.at(j)}, b64Salt);
+      EXPECT_EQ(hashes.at(j), expected);
+      EXPECT_EQ(hasher.base64Hash(ids.at(j)), expected);
+    }
+  }
+  EXPECT_EQ(
+      hasher.base64Hash("super_secret_email@example.com"),
+      "xz/QtZYtVrksTpkZUCkCf4OGzZJ99iN4EMDJIJ1g+KY=");
+}
+
+TEST(HashSalterTest, HashedIdTest) {
+  auto b64Salt = "CoXbp7BOEvAN9L1CB2DAORHHr3hB7wE7tpxMYm07tc0=";
+  auto hasher =
+      private_lift::hash_slinging_salter::SaltedHasher::fromBase64Key(b64Salt);
+  auto hashedId = hasher.hashId("super_secret_email@example.com");
+  EXPECT_EQ(
+      hashedId.toBase64(), "xz/QtZYtVrksTpkZUCkCf4OGzZJ99iN4EMDJIJ1g+KY=");
+  EXPECT_EQ(hashedId.view(), hasher.hash("super_secret_email@example.com"));
+  EXPECT_EQ(hashedId.word(0), 0xb9562d96b5d03fc7);
+  EXPECT_EQ(hashedId.prefix(), 0xc73fd0b5962d56b9);
+
+  auto decoded = private_lift::hash_slinging_salter::HashedId::fromBase64(
+      "xz/QtZYtVrksTpkZUCkCf4OGzZJ99iN4EMDJIJ1g+KY=");
+  ASSERT_TRUE(decoded.has_value());
+  EXPECT_EQ(*decoded, hashedId);
+
+  auto other = hasher.hashId("another_email@example.com");
+  EXPECT_NE(other, hashedId);
+  EXPECT_NE(other < hashedId, hashedId < other);
+
+  // Only the encodings of 32 bytes are digests
+  for (std::string_view base64 :
+       {"", "abcd", "xz/QtZYtVrksTpkZUCkCf4OGzZJ99iN4EMDJIJ1g+KY",
+        "xz/QtZYtVrksTpkZUCkCf4OGzZJ99iN4EMDJIJ1g+K==",
+        "xz/QtZYtVrksTpkZUCkCf4OGzZJ99iN4EMDJIJ1g+K!="}) {
+    EXPECT_FALSE(
+        private_lift::hash_slinging_salter::HashedId::fromBase64(base64)
+            .has_value());
+  }
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "CombineGroups.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/String.h>
+#include <folly/logging/xlog.h>
+#include "DataPreparationHelpers.h"
+
+namespace pid::combiner {
+namespace {
+// The rows of one group: the first value of every column which isn't
+// aggregated, and every value of the aggregated columns
+struct Group {
+  std::vector<std::string> firstValues;
+  std::vector<std::vector<std::string>> lists;
+};
+
+void removeSpaces(std::string& s) {
+  s.erase(std::remove(s.begin(), s.end(), ' '), s.end());
+}
+
+bool contains(const std::vector<std::string>& v, const std::string& s) {
+  return std::find(v.begin(), v.end(), s) != v.end();
+}
+} // namespace
+
+void combineGroups(
+    std::istream& inFile,
+    std::ostream& outFile,
+    const CombineGroupsOptions& options) {
+  XLOG(INFO) << "[C++ CombineGroups] Starting run to aggregate columns: "
+             << vectorToString(options.columnsToAggregate)
+             << " by column: " << options.groupByColumn;
+
+  std::string line;
+  std::string row;
+
+  getline(inFile, line);
+  if (!line.empty() && line.back() == '\r') {
+    line.pop_back();
+  }
+  std::vector<std::string> header;
+  folly::split(',', line, header);
+  auto headerSize = header.size();
+  auto groupByColumnIndex = headerIndex(header, options.groupByColumn);
+
+  // For every column, its index in Group::firstValues or Group::lists
+  std::vector<bool> isAggregated(headerSize);
+  std::vector<std::size_t> valueIndex(headerSize);
+  std::size_t numAggregated = 0;
+  for (std::size_t i = 0; i < headerSize; ++i) {
+    isAggregated.at(i) = contains(options.columnsToAggregate, header.at(i));
+    valueIndex.at(i) = isAggregated.at(i) ? numAggregated++ : i - numAggregated;
+  }
+
+  std::vector<int32_t> padSize(numAggregated, -1);
+  for (std::size_t i = 0; i < options.padSizePerCol.size(); ++i) {
+    auto c = headerIndex(header, options.columnsToAggregate.at(i));
+    padSize.at(valueIndex.at(c)) = options.padSizePerCol.at(i);
+  }
+
+  std::size_t sortByList = 0;
+  std::vector<std::size_t> sortedLists;
+  if (!options.sortBy.empty()) {
+    if (!contains(options.listColumns, options.sortBy)) {
+      XLOG(FATAL) << "SortBy column must be contained in the listColumns";
+    }
+    for (const auto& listCol : options.listColumns) {
+      auto c = headerIndex(header, listCol);
+      if (!isAggregated.at(c)) {
+        XLOG(FATAL) << "List column " << listCol << " is not aggregated";
+      }
+      sortedLists.push_back(valueIndex.at(c));
+    }
+    sortByList = valueIndex.at(headerIndex(header, options.sortBy));
+  }
+
+  // Group the rows, keeping the order in which the groups first appear
+  std::unordered_map<std::string, std::size_t> idToGroup;
+  std::vector<std::string> ids;
+  std::vector<Group> groups;
+  std::vector<std::string> cols;
+  while (getline(inFile, row)) {
+    cols.clear();
+    folly::split(',', row, cols);
+    auto rowSize = cols.size();
+    if (rowSize != headerSize) {
+      XLOG(FATAL) << "Mismatch between header and row" << '\n'
+                  << "Header has size " << headerSize << " while row has size "
+                  << rowSize << '\n'
+                  << "Header: " << line << '\n'
+                  << "Row   : " << row << '\n';
+    }
+    // convert empty to default value 0
+    for (auto& col : cols) {
+      if (col.empty()) {
+        col = "0";
+      }
+    }
+
+    auto [it, isNewGroup] =
+        idToGroup.emplace(cols.at(groupByColumnIndex), groups.size());
+    if (isNewGroup) {
+      ids.push_back(cols.at(groupByColumnIndex));
+      removeSpaces(ids.back());
+      groups.emplace_back();
+      groups.back().lists.resize(numAggregated);
+    }
+    auto& group = groups.at(it->second);
+    for (std::size_t i = 0; i < headerSize; ++i) {
+      auto& value = cols.at(i);
+      removeSpaces(value);
+      if (isAggregated.at(i)) {
+        // Values left empty by removing their spaces were always dropped
+        if (!value.empty()) {
+          group.lists.at(valueIndex.at(i)).push_back(std::move(value));
+        }
+      } else if (isNewGroup) {
+        group.firstValues.push_back(std::move(value));
+      }
+    }
+  }
+
+  std::vector<std::size_t> order(groups.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    order.at(i) = i;
+  }
+  if (options.sortById) {
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+      return ids.at(a) < ids.at(b);
+    });
+  }
+
+  // Output the header, with the spaces removed and the requested columns
+  // in plural
+  for (std::size_t i = 0; i < headerSize; ++i) {
+    auto name = header.at(i);
+    removeSpaces(name);
+    if (contains(options.columnsToPluralize, name)) {
+      name += "s";
+    }
+    outFile << (i > 0 ? "," : "") << name;
+  }
+  outFile << '\n';
+
+  std::vector<int64_t> vals;
+  std::vector<std::size_t> permutation;
+  std::vector<std::string> scratch;
+  for (auto groupIdx : order) {
+    auto& group = groups.at(groupIdx);
+    for (std::size_t k = 0; k < numAggregated; ++k) {
+      if (padSize.at(k) < 0) {
+        continue;
+      }
+      auto& list = group.lists.at(k);
+      auto size = static_cast<std::size_t>(padSize.at(k));
+      if (list.size() > size && options.enforceMax) {
+        list.resize(size);
+      }
+      if (list.size() < size) {
+        list.insert(list.begin(), size - list.size(), "0");
+      }
+    }
+
+    if (!options.sortBy.empty()) {
+      vals.clear();
+      for (const auto& s : group.lists.at(sortByList)) {
+        vals.push_back(parseSortByValue(s));
+      }
+      getIntegralSortPermutation(vals, permutation);
+      for (auto k : sortedLists) {
+        applyPermutation(group.lists.at(k), permutation, scratch);
+      }
+    }
+
+    for (std::size_t i = 0; i < headerSize; ++i) {
+      if (i > 0) {
+        outFile << ',';
+      }
+      if (isAggregated.at(i)) {
+        outFile << '[' << vectorToString(group.lists.at(valueIndex.at(i)))
+                << ']';
+      } else {
+        outFile << group.firstValues.at(valueIndex.at(i));
+      }
+    }
+    outFile << '\n';
+  }
+
+  XLOG(INFO) << "[C++ CombineGroups] Finished.";
+}
+} // namespace pid::combiner
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace pid::combiner {
+/*
+The steps of combineGroups, in the order they are applied. All of them refer
+to columns by their original (singular) names.
+*/
+struct CombineGroupsOptions {
+  // groupBy: the column to group by and the columns to aggregate into lists
+  std::string groupByColumn = "id_";
+  std::vector<std::string> columnsToAggregate;
+  // sortIds: whether to output the groups sorted by groupByColumn rather than
+  // in the order they first appear
+  bool sortById = false;
+  // addPaddingToCols: the padding of every column in columnsToAggregate. No
+  // padding is added if this is empty.
+  std::vector<int32_t> padSizePerCol;
+  bool enforceMax = true;
+  // sortIntegralValues: the list column to sort by, and the list columns to
+  // reorder along with it. Nothing is sorted if sortBy is empty.
+  std::string sortBy;
+  std::vector<std::string> listColumns;
+  // headerColumnsToPlural: the columns which get an "s" appended to their name
+  std::vector<std::string> columnsToPluralize;
+};
+
+/*
+This file implements combineGroups, which produces the same output as
+chaining groupBy, sortIds, addPaddingToCols, sortIntegralValues and
+headerColumnsToPlural, but in a single pass. Each row is split once into its
+group, and each group is padded, sorted and written out once, instead of every
+step re-reading and re-splitting the whole output of the step before.
+
+For example, with groupByColumn id_, columnsToAggregate {ts, val}, padding of
+3 for both, sortBy ts and listColumns {ts, val} and this input:
+id_,ts,val
+1,20,a
+1,10,b
+2,30,c
+
+The output would be:
+id_,ts,val
+1,[0,10,20],[0,b,a]
+2,[0,0,30],[0,0,c]
+*/
+void combineGroups(
+    std::istream& inFile,
+    std::ostream& outFile,
+    const CombineGroupsOptions& options);
+} // namespace pid::combiner
@@ -8,6 +8,8 @@
 #include "DataPreparationHelpers.h"
 
 #include <folly/logging/xlog.h>
+#include <array>
+#include <charconv>
 #include <cstdint>
 #include <filesystem>
 #include <iomanip>
@@ -16,6 +18,7 @@
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -157,4 +160,72 @@ std::vector<std::string> splitList(const std::string& s) {
   folly::split(kCommaSplitRegex, innerString, res);
   return res;
 }
+
+void splitViews(std::string_view str, std::vector<std::string_view>& out) {
+  out.clear();
+  std::size_t start = 0;
+  while (true) {
+    auto end = str.find(',', start);
+    if (end == std::string_view::npos) {
+      out.push_back(str.substr(start));
+      return;
+    }
+    out.push_back(str.substr(start, end - start));
+    start = end + 1;
+  }
+}
+
+void splitListViews(std::string_view s, std::vector<std::string_view>& out) {
+  // The same as substr(1, s.size() - 2) in splitList
+  auto inner = s.substr(1, s.size() - 2);
+  splitViews(inner, out);
+}
+
+int64_t parseSortByValue(std::string_view s) {
+  auto digits = s;
+  // operator>> skips leading whitespace and accepts a leading plus sign, but
+  // from_chars doesn't
+  auto start = digits.find_first_not_of(" \t\n\v\f\r");
+  digits.remove_prefix(std::min(start, digits.size()));
+  if (!digits.empty() && digits.front() == '+') {
+    digits.remove_prefix(1);
+  }
+  int64_t parsed;
+  auto [ptr, ec] =
+      std::from_chars(digits.data(), digits.data() + digits.size(), parsed);
+  if (ec != std::errc{} || ptr == digits.data()) {
+    XLOG(FATAL) << "Failed to parse " << s << " as int64_t";
+  }
+  return parsed;
+}
+
+void getIntegralSortPermutation(
+    const std::vector<int64_t>& vals,
+    std::vector<std::size_t>& permutation) {
+  auto n = vals.size();
+  permutation.resize(n);
+  if (n > kSmallSortSize) {
+    std::iota(permutation.begin(), permutation.end(), 0);
+    std::sort(
+        permutation.begin(),
+        permutation.end(),
+        [&](std::size_t i, std::size_t j) { return vals[i] < vals[j]; });
+    return;
+  }
+
+  // Equal values keep their order, as they do in the insertion sort std::sort
+  // uses for short ranges
+  std::array<std::pair<int64_t, std::size_t>, kSmallSortSize> sorted;
+  for (std::size_t i = 0; i < n; ++i) {
+    auto value = vals[i];
+    auto j = i;
+    for (; j > 0 && value < sorted[j - 1].first; --j) {
+      sorted[j] = sorted[j - 1];
+    }
+    sorted[j] = {value, i};
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    permutation[i] = sorted[i].second;
+  }
+}
 } // namespace pid::combiner
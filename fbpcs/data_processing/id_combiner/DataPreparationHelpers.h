@@ -13,6 +13,8 @@
 #include <filesystem>
 #include <numeric>
 #include <sstream>
+#include <stdexcept>
+#include <string_view>
 #include <unordered_map>
 #include <variant>
 #include <vector>
@@ -47,6 +49,29 @@ std::vector<int32_t> headerIndices(
 
 std::vector<std::string> splitList(const std::string& s);
 
+// Splits str at every comma into views of it, as folly::split does, reusing
+// the vector of the previous row
+void splitViews(std::string_view str, std::vector<std::string_view>& out);
+
+// Like splitList, for the values of a list cell such as [1,2,3]
+void splitListViews(std::string_view s, std::vector<std::string_view>& out);
+
+// Parses a value of the list sortIntegralValues sorts by, accepting what
+// operator>> does for an int64_t
+int64_t parseSortByValue(std::string_view s);
+
+// Lists of up to this many values are sorted in place by
+// getIntegralSortPermutation
+constexpr std::size_t kSmallSortSize = 16;
+
+// Sets permutation to the getSortPermutation of vals in ascending order. The
+// lists of a row are usually short, and are insertion sorted as (value,
+// position) pairs on the stack, which gives the same order std::sort gives for
+// them, equal values included.
+void getIntegralSortPermutation(
+    const std::vector<int64_t>& vals,
+    std::vector<std::size_t>& permutation);
+
 // From https://stackoverflow.com/questions/17074324/
 template <typename T, typename Compare>
 std::vector<std::size_t> getSortPermutation(
@@ -80,6 +105,22 @@ void applyPermutation(std::vector<T>& vec, const std::vector<std::size_t>& p) {
   }
 }
 
+// applyPermutation through a scratch vector, which is kept for the next list
+template <typename T>
+void applyPermutation(
+    std::vector<T>& vec,
+    const std::vector<std::size_t>& p,
+    std::vector<T>& scratch) {
+  if (vec.size() != p.size()) {
+    throw std::out_of_range{"The permutation and the list differ in size"};
+  }
+  scratch.clear();
+  for (auto i : p) {
+    scratch.push_back(std::move(vec.at(i)));
+  }
+  vec.swap(scratch);
+}
+
 template <typename T>
 const std::string vectorToString(const std::vector<T>& vec) {
   std::stringstream buf;
@@ -7,10 +7,13 @@
 
 #include "DataValidation.h"
 
+#include <cstdint>
+#include <cstring>
 #include <iomanip>
 #include <istream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -36,35 +39,140 @@ bool verifyHeaderContainsCols(
   return true;
 }
 
+namespace {
+
+// Rows are read in blocks of this size rather than line by line
+constexpr size_t kReadBlockSize = 1 << 20;
+
+// Every number of up to 19 digits fits in a uint64_t
+constexpr size_t kMaxPlainFieldSize = 19;
+
+constexpr uint64_t kOnes = ~uint64_t{0} / 255;
+constexpr uint64_t kHighBits = kOnes * 128;
+
+// Whether the 8 bytes of word are all ascii digits, classifying them together
+// rather than one at a time. A byte below '0' borrows into its high bit and a
+// byte above '9' carries into it.
+bool isDigitWord(uint64_t word) {
+  auto below = (word - kOnes * '0') & ~word & kHighBits;
+  auto above = ((word + kOnes * (127 - '9')) | word) & kHighBits;
+  return (below | above) == 0;
+}
+
+// Counts the fields of a row which only holds non-empty fields of up to
+// kMaxPlainFieldSize digits separated by commas, which is every row of a valid
+// file. Returns false for any other row, which is left to validateRow.
+bool countPlainFields(std::string_view row, size_t& numFields) {
+  numFields = 0;
+  size_t fieldSize = 0;
+  size_t i = 0;
+  while (i < row.size()) {
+    uint64_t word;
+    if (i + sizeof(word) <= row.size()) {
+      std::memcpy(&word, row.data() + i, sizeof(word));
+      if (isDigitWord(word)) {
+        fieldSize += sizeof(word);
+        i += sizeof(word);
+        if (fieldSize > kMaxPlainFieldSize) {
+          return false;
+        }
+        continue;
+      }
+    }
+    auto c = row[i++];
+    if (c == ',') {
+      if (fieldSize == 0) {
+        return false;
+      }
+      ++numFields;
+      fieldSize = 0;
+    } else if (c >= '0' && c <= '9') {
+      if (++fieldSize > kMaxPlainFieldSize) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  if (fieldSize == 0) {
+    return false;
+  }
+  ++numFields;
+  return true;
+}
+
+// Checks a row field by field, failing with the reason it is invalid
+void validateRow(
+    size_t row_i,
+    std::string row,
+    const std::vector<std::string>& header) {
+  const std::string kCommaSplitRegex = R"(([^,]+),?)";
+
+  std::vector<std::string> rowVec = split(kCommaSplitRegex, row);
+  if (header.size() != rowVec.size()) {
+    XLOG(FATAL) << "Row at index <" << row_i << "> and header sizes mismatch. "
+                << "Row size is " << rowVec.size() << " and header size is "
+                << header.size() << ". Header: " << vectorToString(header);
+  }
+  for (auto& v : rowVec) {
+    try {
+      folly::to<std::uint64_t>(v);
+    } catch (std::exception&) {
+      XLOG(FATAL) << v << " failed to parse to int";
+    }
+  }
+}
+
+} // namespace
+
 void validateCsvData(std::istream& dataFile) {
   const std::string kCommaSplitRegex = R"(([^,]+),?)";
 
   XLOG(INFO) << "Started.";
   std::string line;
-  std::string row;
   size_t row_i = 0;
 
   getline(dataFile, line);
   std::vector<std::string> header = split(kCommaSplitRegex, line);
   size_t headerSize = header.size();
 
-  while (getline(dataFile, row)) {
+  // Plain rows of digits are checked in a single pass over their bytes, the
+  // others are split and parsed to report why they are invalid
+  auto checkRow = [&](std::string_view row) {
     row_i++;
-    std::vector<std::string> rowVec = split(kCommaSplitRegex, row);
-    if (headerSize != rowVec.size()) {
-      XLOG(FATAL) << "Row at index <" << row_i
-                  << "> and header sizes mismatch. " << "Row size is "
-                  << rowVec.size() << " and header size is " << headerSize
-                  << ". Header: " << vectorToString(header);
+    size_t numFields = 0;
+    if (!countPlainFields(row, numFields) || numFields != headerSize) {
+      validateRow(row_i, std::string{row}, header);
     }
-    for (auto& v : rowVec) {
-      try {
-        folly::to<std::uint64_t>(v);
-      } catch (std::exception&) {
-        XLOG(FATAL) << v << " failed to parse to int";
+  };
+
+  std::vector<char> block(kReadBlockSize);
+  // The start of a row which continues in the next block
+  std::string partialRow;
+  while (dataFile.read(block.data(), block.size()) || dataFile.gcount() > 0) {
+    std::string_view data{block.data(), static_cast<size_t>(dataFile.gcount())};
+    size_t pos = 0;
+    while (true) {
+      auto newLine = data.find('\n', pos);
+      if (newLine == std::string_view::npos) {
+        partialRow.append(data.substr(pos));
+        break;
+      }
+      auto row = data.substr(pos, newLine - pos);
+      if (partialRow.empty()) {
+        checkRow(row);
+      } else {
+        partialRow.append(row);
+        checkRow(partialRow);
+        partialRow.clear();
       }
+      pos = newLine + 1;
     }
   }
+  // The last row, if the file doesn't end with a newline
+  if (!partialRow.empty()) {
+    checkRow(partialRow);
+  }
 
   XLOG(INFO) << "Finished.";
 }
@@ -13,6 +13,7 @@
 #include <ostream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -22,17 +23,30 @@
 
 #include "DataPreparationHelpers.h"
 
+namespace {
+// Empty values are output as the default value 0
+void appendValue(std::string& out, std::string_view value) {
+  if (value.empty()) {
+    out += '0';
+  } else {
+    out.append(value);
+  }
+}
+} // namespace
+
 namespace pid::combiner {
 void groupBy(
     std::istream& inFile,
     std::string groupByColumn,
     std::vector<std::string> columnsToAggregate,
-    std::ostream& outFile) {
+    std::ostream& outFile,
+    bool inputSortedByGroup) {
   const std::string kCommaSplitRegex = ",";
 
   XLOG(INFO) << "[C++ GroupBy] Starting GroupBy run to aggregate columns: "
              << vectorToString(columnsToAggregate)
-             << " by column: " << groupByColumn << " \n";
+             << " by column: " << groupByColumn
+             << (inputSortedByGroup ? " on sorted input" : "") << " \n";
 
   std::string line;
   std::string row;
@@ -48,16 +62,69 @@ void groupBy(
   // Output the header as before
   outFile << vectorToString(header) << "\n";
 
-  // Build a map for group_by_column value to row
-  std::unordered_map<std::string, std::vector<std::vector<std::string>>>
-      idToRows;
+  std::vector<bool> isAggregated(headerSize);
+  for (std::size_t i = 0; i < headerSize; ++i) {
+    isAggregated.at(i) = std::find(
+                             columnsToAggregate.begin(),
+                             columnsToAggregate.end(),
+                             header.at(i)) != columnsToAggregate.end();
+  }
+
+  // The rows are appended to a single buffer, and every group keeps the
+  // indices of its rows in it, in the order the groups are first traversed.
+  // On sorted input the buffer only holds the rows of the current group.
+  std::string rows;
+  std::vector<std::size_t> rowStarts;
+  std::unordered_map<std::string, std::size_t> idToGroup;
+  std::vector<std::vector<std::size_t>> groups;
+
+  // Writes the aggregated values of a group to the output file, splitting
+  // each of its rows again from the buffer
+  // note that for columns that were not specified in columnsToAggregate, we
+  // output a single value rather than a list of values
+  std::vector<std::vector<std::string_view>> groupRows;
+  std::string out;
+  auto writeGroup = [&](const std::vector<std::size_t>& group) {
+    std::string_view rowsView{rows};
+    if (groupRows.size() < group.size()) {
+      groupRows.resize(group.size());
+    }
+    for (std::size_t r = 0; r < group.size(); ++r) {
+      auto rowIndex = group.at(r);
+      auto start = rowStarts.at(rowIndex);
+      auto end = rowIndex + 1 < rowStarts.size() ? rowStarts.at(rowIndex + 1)
+                                                 : rows.size();
+      splitViews(rowsView.substr(start, end - start), groupRows.at(r));
+    }
+
+    out.clear();
+    for (std::size_t i = 0; i < headerSize; i++) {
+      if (isAggregated.at(i)) {
+        out += '[';
+        for (std::size_t r = 0; r < group.size(); ++r) {
+          if (r > 0) {
+            out += ',';
+          }
+          appendValue(out, groupRows.at(r).at(i));
+        }
+        out += ']';
+      } else { // just write out the first value in the list
+        appendValue(out, groupRows.at(0).at(i));
+      }
+
+      if (i < headerSize - 1) {
+        out += ',';
+      }
+    }
+    out += '\n';
+    outFile.write(out.data(), out.size());
+  };
 
-  // Store the order of traversal of the file to retain order
-  std::vector<std::string> traversedOrder;
-  std::unordered_set<std::string> hasBeenTraversed;
+  std::vector<std::string_view> cols;
+  std::string rowId;
+  std::string currentId;
   while (getline(inFile, row)) {
-    std::vector<std::string> cols;
-    folly::split(kCommaSplitRegex, row, cols);
+    splitViews(row, cols);
     auto rowSize = cols.size();
     if (rowSize != headerSize) {
       XLOG(FATAL) << "Mismatch between header and row" << '\n'
@@ -66,62 +133,42 @@ void groupBy(
                   << "Header: " << line << '\n'
                   << "Row   : " << row << '\n';
     }
-    // convert empty to default value 0
-    for (auto& col_member : cols) {
-      if (col_member.empty()) {
-        col_member = "0";
+    rowId.clear();
+    appendValue(rowId, cols.at(groupByColumnIndex));
+    if (inputSortedByGroup) {
+      // The order is checked once empty ids have become 0, as they are
+      // grouped with the ids 0, so that they never start a second group of 0
+      if (!groups.empty() && rowId < currentId) {
+        XLOG(FATAL) << "Input is not sorted by " << groupByColumn << ": "
+                    << rowId << " comes after " << currentId;
       }
-    }
-    auto rowId = cols.at(groupByColumnIndex);
-    if (hasBeenTraversed.count(rowId) == 0) {
-      hasBeenTraversed.insert(rowId);
-      traversedOrder.push_back(rowId);
-    }
-    idToRows[rowId].push_back(cols);
-  }
 
-  // build new map that aggregates common values into lists
-  // newIdToRows maps the groupById to vectors of vectors
-  // where the inner vector is an aggregation over col values
-  // and the other vector represents all the columns for a given row
-  std::map<std::string, std::vector<std::vector<std::string>>> newIdToRows;
-  for (const auto& keyVal : idToRows) { // key value pairs of id to list of rows
-    std::vector<std::vector<std::string>> newRow;
-    std::vector<std::vector<std::string>> rows = keyVal.second;
-    for (std::size_t i = 0; i < rows.size(); i++) {
-      auto curr_row = rows.at(i);
-      for (std::size_t j = 0; j < curr_row.size(); j++) {
-        if (newRow.size() > j) {
-          newRow.at(j).push_back(curr_row.at(j));
-        } else {
-          newRow.push_back({curr_row.at(j)});
-        }
+      // Write the current group as soon as the next one starts
+      if (!groups.empty() && rowId != currentId) {
+        writeGroup(groups.back());
+        groups.clear();
+        rows.clear();
+        rowStarts.clear();
       }
-    }
-    newIdToRows[keyVal.first] = newRow;
-  }
-
-  // This loop iterates over all the unique rows and writes the aggregated
-  // values to the output file
-  // note that for columns that were not specified in columnsToAggregate, we
-  // output a single value rather than a list of values
-  for (const auto& id : traversedOrder) {
-    auto currRow = newIdToRows.at(id);
-    for (std::size_t i = 0; i < currRow.size(); i++) {
-      if (std::find(
-              columnsToAggregate.begin(),
-              columnsToAggregate.end(),
-              header.at(i)) != columnsToAggregate.end()) {
-        outFile << "[" << vectorToString(currRow.at(i)) << "]";
-      } else { // just write out the first value in the list
-        outFile << currRow.at(i).at(0);
+      if (groups.empty()) {
+        groups.emplace_back();
+        currentId = rowId;
       }
-
-      if (i < currRow.size() - 1) {
-        outFile << ",";
+      groups.back().push_back(rowStarts.size());
+    } else {
+      auto group = idToGroup.find(rowId);
+      if (group == idToGroup.end()) {
+        group = idToGroup.emplace(rowId, groups.size()).first;
+        groups.emplace_back();
       }
+      groups.at(group->second).push_back(rowStarts.size());
     }
-    outFile << "\n";
+    rowStarts.push_back(rows.size());
+    rows.append(row);
+  }
+
+  for (const auto& group : groups) {
+    writeGroup(group);
   }
   XLOG(INFO) << "[C++ GroupBy] Finished.\n";
 }
@@ -31,10 +31,20 @@ The output would be:
 id        val1       val2      val3
 1        [x, y]     [a, b]       v1
 2          [z]        [c]        v3
+
+Empty values are output as 0, and empty values of the groupBy column are
+grouped with the rows whose value is 0.
+
+With inputSortedByGroup, the input has to be sorted by the groupBy column, as
+the output of sortIds is, once empty values have become 0. Each group is then
+written out as soon as the next one starts, so only the rows of one group are
+held in memory rather than the whole input. The output is the same as without
+it.
 */
 void groupBy(
     std::istream& inFilePath,
     std::string groupByColumn,
     std::vector<std::string> columnsToAggregate,
-    std::ostream& outFilePath);
+    std::ostream& outFilePath,
+    bool inputSortedByGroup = false);
 } // namespace pid::combiner
@@ -7,21 +7,22 @@
 
 #include "IdSwapMultiKey.h"
 #include "DataPreparationHelpers.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
 #include "folly/Optional.h"
 
 #include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <istream>
-#include <numeric>
 #include <ostream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
 #include <folly/Random.h>
@@ -30,71 +31,130 @@
 #include <re2/re2.h>
 
 namespace pid::combiner {
+namespace {
+// Parses a cell the way std::stoi does, i.e. leading whitespace and trailing
+// characters are ignored, but without allocating or throwing on failure
+bool parseLiftValue(const std::string& cell, int32_t& val) {
+  const char* first = cell.data();
+  const char* last = cell.data() + cell.size();
+  while (first != last && std::isspace(static_cast<unsigned char>(*first))) {
+    ++first;
+  }
+  if (first != last && *first == '+' && last - first > 1 && first[1] != '-') {
+    ++first;
+  }
+  auto [ptr, ec] = std::from_chars(first, last, val);
+  return ec == std::errc() && ptr != first;
+}
+
+// Accumulates the values of one non-id column across the duplicate rows
+class LiftAccumulator {
+ public:
+  explicit LiftAccumulator(LiftAggregation aggregation)
+      : aggregation_{aggregation} {}
+
+  void add(int32_t val) {
+    ++count_;
+    if (count_ == 1) {
+      acc_ = val;
+      return;
+    }
+    switch (aggregation_) {
+      case LiftAggregation::kRandom:
+        // Reservoir sampling keeps each of the values with probability 1/n
+        if (folly::Random::rand32(count_) == 0) {
+          acc_ = val;
+        }
+        break;
+      case LiftAggregation::kMax:
+        acc_ = std::max<int64_t>(acc_, val);
+        break;
+      case LiftAggregation::kMin:
+        acc_ = std::min<int64_t>(acc_, val);
+        break;
+      case LiftAggregation::kSum:
+        acc_ += val;
+        break;
+    }
+  }
+
+  int64_t get() const {
+    return acc_;
+  }
+
+ private:
+  LiftAggregation aggregation_;
+  uint32_t count_ = 0;
+  int64_t acc_ = 0;
+};
+} // namespace
+
+std::vector<LiftAggregation> getLiftAggregations(
+    const std::vector<std::string>& header) {
+  // We register an aggregation method for each column name.
+  static const std::unordered_map<std::string, LiftAggregation>
+      kRegisteredAggregations{
+          {"test_flag", LiftAggregation::kRandom},
+          {"breakdown_id", LiftAggregation::kMax},
+          {"opportunity_timestamp", LiftAggregation::kMin},
+          {"total_spend", LiftAggregation::kSum},
+          {"num_clicks", LiftAggregation::kSum},
+          {"num_impressions", LiftAggregation::kSum}};
+
+  std::vector<LiftAggregation> aggregations;
+  // skip the id_ column
+  for (size_t col = 1; col < header.size(); ++col) {
+    auto search = kRegisteredAggregations.find(header[col]);
+    if (search != kRegisteredAggregations.end()) {
+      aggregations.push_back(search->second);
+    } else {
+      // if the column name is not registered, we will take min as default.
+      aggregations.push_back(LiftAggregation::kMin);
+      XLOG(INFO) << "WARNING: Column name not registered to aggregate.\n"
+                 << "\tWe are taking a min of " << header[col] << "\n";
+    }
+  }
+  return aggregations;
+}
+
 void aggregateLiftNonIdColumns(
-    std::vector<std::string> header,
+    const std::vector<LiftAggregation>& aggregations,
     std::vector<std::vector<std::string>>& dRows) {
-  // Step1: We register an aggregation method for each column name.
-  std::unordered_set<std::string> randomFromColumns({"test_flag"});
-  std::unordered_set<std::string> maxFromColumns({"breakdown_id"});
-  std::unordered_set<std::string> minFromColumns({"opportunity_timestamp"});
-  std::unordered_set<std::string> sumOfColumns(
-      {"total_spend", "num_clicks", "num_impressions"});
-
-  // vector with single vector inside that stores aggregated result
-  std::vector<std::vector<std::string>> aggregatedRows(
-      1, std::vector<std::string>());
-
-  header.erase(header.begin()); // remove id_ column
-  std::vector<std::vector<int>> columnValues(header.size(), std::vector<int>());
-
-  // Step2: We first transform dRows into column by column vector (columnValues)
-  for (auto dRow : dRows) {
-    if (dRow.size() != header.size()) {
+  std::vector<LiftAccumulator> accumulators(
+      aggregations.begin(), aggregations.end());
+
+  // Accumulate the rows column by column, parsing every cell once
+  for (const auto& dRow : dRows) {
+    if (dRow.size() != aggregations.size()) {
       XLOG(FATAL)
           << "Error: number of non-id columns not consistent with header.";
     }
     for (size_t col = 0; col < dRow.size(); ++col) {
-      try {
-        int32_t val = std::stoi(dRow[col]);
-        columnValues[col].push_back(val);
-      } catch (std::exception&) {
+      int32_t val;
+      if (!parseLiftValue(dRow[col], val)) {
         XLOG(FATAL)
             << "Error: Exception caught during casting string to int.\n"
             << "\tFor PL, non-id columns has to be int to aggregate in case of duplicates.";
       }
+      accumulators[col].add(val);
     }
   }
 
-  // Step3: For each column stored in columnValues, we first check the column
-  // name to find out aggregation method. Then, we aggregate the values using
-  // aggregation method. Finally, we add aggregated value into the vector inside
-  // of aggregatedRows.
-  for (size_t col = 0; col < header.size(); ++col) {
-    int32_t val;
-    if (randomFromColumns.count(header[col]) > 0) {
-      uint32_t random = folly::Random::rand32() % columnValues[col].size();
-      val = columnValues[col][random];
-    } else if (maxFromColumns.count(header[col]) > 0) {
-      val =
-          *std::max_element(columnValues[col].begin(), columnValues[col].end());
-    } else if (minFromColumns.count(header[col]) > 0) {
-      val =
-          *std::min_element(columnValues[col].begin(), columnValues[col].end());
-    } else if (sumOfColumns.count(header[col]) > 0) {
-      val = accumulate(columnValues[col].begin(), columnValues[col].end(), 0);
-    } else {
-      // if the column name is not registered, we will take min as default.
-      val =
-          *std::min_element(columnValues[col].begin(), columnValues[col].end());
-      XLOG(INFO) << "WARNING: Column name not registered to aggregate.\n"
-                 << "\tWe are taking a min of " << header[col] << "\n";
-    }
-    aggregatedRows[0].push_back(std::to_string(val));
+  // Replace dRows with the single aggregated row
+  if (dRows.empty()) {
+    return;
+  }
+  auto& aggregatedRow = dRows[0];
+  for (size_t col = 0; col < accumulators.size(); ++col) {
+    aggregatedRow[col] = std::to_string(accumulators[col].get());
   }
+  dRows.resize(1);
+}
 
-  // Step4: Swap dRows with aggregatedRows. As a result, dRows would have only
-  // one line.
-  dRows.swap(aggregatedRows);
+void aggregateLiftNonIdColumns(
+    const std::vector<std::string>& header,
+    std::vector<std::vector<std::string>>& dRows) {
+  aggregateLiftNonIdColumns(getLiftAggregations(header), dRows);
 }
 
 void idSwapMultiKey(
@@ -120,7 +180,8 @@ void idSwapMultiKey(
    * and we can revisit this to store the contents during the
    * first read.
    */
-  auto spineReader = std::make_unique<fbpcf::io::FileReader>(spineIdPath);
+  auto spineReader =
+      private_measurement::compressed_io::makeFileReader(spineIdPath);
   auto spineIdFileDup =
       std::make_shared<fbpcf::io::BufferedReader>(std::move(spineReader));
   std::vector<std::string> header;
@@ -136,6 +197,10 @@ void idSwapMultiKey(
   }
   header.insert(header.begin(), "id_");
   outFile << vectorToString(header) << "\n";
+  std::vector<LiftAggregation> aggregations;
+  if (isPublisherLift) {
+    aggregations = getLiftAggregations(header);
+  }
 
   // Build a map for <id_ to private_id> from the spineId File
   std::unordered_map<std::string, std::string> idToPrivateIDMap;
@@ -260,7 +325,7 @@ void idSwapMultiKey(
       if (isPublisherLift) {
         // For publisher lift dataset, duplicates would result in failure.
         // We are aggregating columns here.
-        aggregateLiftNonIdColumns(header, dRows);
+        aggregateLiftNonIdColumns(aggregations, dRows);
       }
       for (auto& dRow : dRows) {
         outFile << privId << "," << vectorToString(dRow) << '\n';
@@ -17,13 +17,31 @@
 
 namespace pid::combiner {
 
+/*
+ * The ways a non-id column of a publisher PL dataset can be aggregated when
+ * a private id has duplicate rows.
+ */
+enum class LiftAggregation { kRandom, kMax, kMin, kSum };
+
+/*
+ * Resolves the aggregation of every non-id column of the given header, whose
+ * first column is the id_ column. Columns which are not registered are
+ * aggregated with a min.
+ */
+std::vector<LiftAggregation> getLiftAggregations(
+    const std::vector<std::string>& header);
+
 /*
  * This function implements the aggregation logic used by publisher PL run.
  * Currently, PL does not posses ability to handle duplicates. Multi-key
  * PID would introduce duplicates and this process would be required.
  */
 void aggregateLiftNonIdColumns(
-    std::vector<std::string> header,
+    const std::vector<LiftAggregation>& aggregations,
+    std::vector<std::vector<std::string>>& dRows);
+
+void aggregateLiftNonIdColumns(
+    const std::vector<std::string>& header,
     std::vector<std::vector<std::string>>& dRows);
 
 /*
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "OutputFormat.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <folly/Random.h>
+#include <folly/logging/xlog.h>
+
+#include "fbpcs/data_processing/common/FilepathHelpers.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
+#include "fbpcs/emp_games/common/RowGroupFormat.h"
+
+namespace pid::combiner {
+void writeOutputFile(
+    const std::function<void(std::ostream&)>& writeCsv,
+    const std::string& outputPath,
+    const std::string& outputFormat,
+    const std::filesystem::path& tmpDirectory) {
+  if (outputFormat != "csv" && outputFormat != "row_group") {
+    XLOG(FATAL) << "Invalid output format '" << outputFormat
+                << "'. Expected 'csv' or 'row_group'.";
+  }
+
+  XLOG(INFO) << "Writing combined data to " << outputPath;
+  private_measurement::compressed_io::OutputFileStream outFile{outputPath};
+  if (outputFormat == "csv") {
+    writeCsv(outFile);
+    outFile.commit();
+    return;
+  }
+
+  // Get a random ID to avoid potential name collisions if multiple
+  // runs at the same time point to the same input file
+  auto csvPath = tmpDirectory /
+      (std::to_string(folly::Random::secureRand64()) + "_" +
+       private_lift::filepath_helpers::getBaseFilename(outputPath));
+  XLOG(INFO) << "Writing temporary csv to " << csvPath;
+  {
+    std::ofstream csvFile{csvPath};
+    writeCsv(csvFile);
+  }
+  XLOG(INFO) << "Converting " << csvPath << " to row groups";
+  {
+    std::ifstream csvFile{csvPath};
+    private_measurement::row_group::convertCsv(csvFile, outFile);
+  }
+  std::remove(csvPath.c_str());
+  outFile.commit();
+}
+} // namespace pid::combiner
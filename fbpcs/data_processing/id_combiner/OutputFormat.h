@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace pid::combiner {
+/*
+This file implements writeOutputFile, which writes the combined csv of a
+combiner to its final, possibly remote, output path in the format requested
+for its output:
+  - csv: the combined csv is streamed straight to the output path.
+  - row_group: the binary row group format of
+    fbpcs/emp_games/common/RowGroupFormat.h, which the games read without
+    tokenizing or parsing text. The csv is spilled to a file in tmpDirectory,
+    which is removed once it is converted straight to the output path.
+
+The output only appears at its path once it is completely written (see
+compressed_io::OutputFileStream). Any other outputFormat is fatal.
+*/
+void writeOutputFile(
+    const std::function<void(std::ostream&)>& writeCsv,
+    const std::string& outputPath,
+    const std::string& outputFormat,
+    const std::filesystem::path& tmpDirectory);
+} // namespace pid::combiner
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "PartitionedCombine.h"
+#include "DataPreparationHelpers.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <ios>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Random.h>
+#include <folly/String.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/futures/Future.h>
+#include <folly/hash/Hash.h>
+#include <folly/logging/xlog.h>
+
+namespace pid::combiner {
+namespace {
+// Number of ids sampled to choose the id ranges of the partitions
+constexpr std::size_t kPartitionSampleSize = 1 << 16;
+
+// Returns the id_ column of the row without splitting all of it. A row which
+// is too short is left for combine to report.
+std::string getRowId(const std::string& row, std::size_t idColumnIdx) {
+  std::size_t start = 0;
+  for (std::size_t i = 0; i < idColumnIdx; ++i) {
+    start = row.find(',', start);
+    if (start == std::string::npos) {
+      return "";
+    }
+    ++start;
+  }
+  auto end = row.find(',', start);
+  return row.substr(
+      start, end == std::string::npos ? std::string::npos : end - start);
+}
+
+// A seekable std::streambuf reading a string in place, so that a partition
+// built in a string can be combined without copying it into a stream first
+class StringReadBuf final : public std::streambuf {
+ public:
+  explicit StringReadBuf(std::string& content) {
+    setg(content.data(), content.data(), content.data() + content.size());
+  }
+
+ protected:
+  pos_type seekoff(
+      off_type off,
+      std::ios_base::seekdir dir,
+      std::ios_base::openmode which) override {
+    if (!(which & std::ios_base::in)) {
+      return pos_type(off_type(-1));
+    }
+    auto from = dir == std::ios_base::beg
+        ? eback()
+        : (dir == std::ios_base::cur ? gptr() : egptr());
+    auto target = from - eback() + off;
+    if (target < 0 || target > egptr() - eback()) {
+      return pos_type(off_type(-1));
+    }
+    setg(eback(), eback() + target, egptr());
+    return pos_type(target);
+  }
+
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+  }
+};
+
+// Runs combine on content and frees it
+void combineString(
+    std::string& content,
+    std::ostream& out,
+    const std::function<void(std::istream&, std::ostream&)>& combine) {
+  {
+    StringReadBuf buf{content};
+    std::istream in{&buf};
+    combine(in, out);
+  }
+  content = std::string{};
+}
+} // namespace
+
+void combinePartitioned(
+    std::istream& inFile,
+    std::ostream& outFile,
+    int32_t numPartitions,
+    bool sortById,
+    bool keepGroupsTogether,
+    const std::function<void(std::istream&, std::ostream&)>& combine) {
+  if (numPartitions <= 1) {
+    combine(inFile, outFile);
+    return;
+  }
+
+  std::string headerLine;
+  getline(inFile, headerLine);
+  std::vector<std::string> header;
+  folly::split(',', headerLine, header);
+  auto idColumnIdx = headerIndex(header, "id_");
+  auto rowsStart = inFile.tellg();
+
+  // First pass: count the rows and, to pick the id ranges, take a uniform
+  // sample of their ids
+  uint64_t numRows = 0;
+  std::vector<std::string> sample;
+  std::string row;
+  while (getline(inFile, row)) {
+    if (sortById) {
+      if (sample.size() < kPartitionSampleSize) {
+        sample.push_back(getRowId(row, idColumnIdx));
+      } else {
+        auto replaced = folly::Random::rand64(numRows + 1);
+        if (replaced < kPartitionSampleSize) {
+          sample.at(replaced) = getRowId(row, idColumnIdx);
+        }
+      }
+    }
+    ++numRows;
+  }
+
+  // Partition p holds the ids in [splitIds[p - 1], splitIds[p])
+  std::vector<std::string> splitIds;
+  if (sortById && !sample.empty()) {
+    std::sort(sample.begin(), sample.end());
+    for (int32_t p = 1; p < numPartitions; ++p) {
+      splitIds.push_back(sample.at(sample.size() * p / numPartitions));
+    }
+  }
+
+  // Second pass: split the rows
+  inFile.clear();
+  inFile.seekg(rowsStart);
+  std::vector<std::string> partitionsIn(numPartitions, headerLine + '\n');
+  std::unordered_map<std::string, std::size_t> groupPartitions;
+  uint64_t rowIdx = 0;
+  while (getline(inFile, row)) {
+    std::size_t partition;
+    if (sortById) {
+      partition = std::upper_bound(
+                      splitIds.begin(),
+                      splitIds.end(),
+                      getRowId(row, idColumnIdx)) -
+          splitIds.begin();
+    } else {
+      partition = rowIdx * numPartitions / numRows;
+      if (keepGroupsTogether) {
+        partition =
+            groupPartitions.try_emplace(getRowId(row, idColumnIdx), partition)
+                .first->second;
+      }
+    }
+    partitionsIn.at(partition).append(row).push_back('\n');
+    ++rowIdx;
+  }
+  groupPartitions.clear();
+  XLOG(INFO) << "Split " << numRows << " rows into " << numPartitions
+             << " partitions";
+
+  // The first partition is combined straight into outFile. The others are
+  // combined into buffers, each written out and freed as soon as the
+  // partitions before it are.
+  std::vector<std::stringstream> partitionsOut(numPartitions);
+  folly::CPUThreadPoolExecutor executor{
+      static_cast<std::size_t>(numPartitions)};
+  std::vector<folly::SemiFuture<folly::Unit>> combined;
+  for (int32_t p = 0; p < numPartitions; ++p) {
+    auto [promise, future] = folly::makePromiseContract<folly::Unit>();
+    std::ostream& out = p == 0 ? outFile : partitionsOut.at(p);
+    executor.add([promise = std::move(promise),
+                  &partitionIn = partitionsIn.at(p),
+                  &partitionOut = out,
+                  &combine]() mutable {
+      promise.setWith(
+          [&]() { combineString(partitionIn, partitionOut, combine); });
+    });
+    combined.push_back(std::move(future));
+  }
+
+  // Concatenate the outputs in order, keeping only the first header
+  std::move(combined.at(0)).get();
+  for (int32_t p = 1; p < numPartitions; ++p) {
+    std::move(combined.at(p)).get();
+    auto& partitionOut = partitionsOut.at(p);
+    std::string partitionHeader;
+    getline(partitionOut, partitionHeader);
+    // Streaming an empty buffer would set the failbit of outFile
+    if (partitionOut.peek() != std::char_traits<char>::eof()) {
+      outFile << partitionOut.rdbuf();
+    }
+    partitionOut = std::stringstream{};
+  }
+}
+
+void combineSharded(
+    std::istream& inFile,
+    const std::vector<std::ostream*>& outFiles,
+    int32_t numThreads,
+    const std::function<void(std::istream&, std::ostream&)>& combine) {
+  if (outFiles.empty()) {
+    XLOG(FATAL) << "combineSharded needs at least one output";
+  }
+  std::string headerLine;
+  getline(inFile, headerLine);
+  std::vector<std::string> header;
+  folly::split(',', headerLine, header);
+  auto idColumnIdx = headerIndex(header, "id_");
+
+  std::vector<std::string> shardsIn(outFiles.size(), headerLine + '\n');
+  // fnv64 is a fixed function, unlike std::hash, so the other party gets the
+  // same shard for an id
+  uint64_t numRows = 0;
+  std::string row;
+  while (getline(inFile, row)) {
+    auto shard =
+        folly::hash::fnv64(getRowId(row, idColumnIdx)) % shardsIn.size();
+    shardsIn.at(shard).append(row).push_back('\n');
+    ++numRows;
+  }
+  XLOG(INFO) << "Split " << numRows << " rows into " << shardsIn.size()
+             << " shards";
+
+  folly::CPUThreadPoolExecutor executor{static_cast<std::size_t>(
+      std::clamp<int32_t>(numThreads, 1, shardsIn.size()))};
+  std::vector<folly::SemiFuture<folly::Unit>> combined;
+  for (std::size_t s = 0; s < shardsIn.size(); ++s) {
+    auto [promise, future] = folly::makePromiseContract<folly::Unit>();
+    executor.add([promise = std::move(promise),
+                  &shardIn = shardsIn.at(s),
+                  &shardOut = *outFiles.at(s),
+                  &combine]() mutable {
+      promise.setWith([&]() { combineString(shardIn, shardOut, combine); });
+    });
+    combined.push_back(std::move(future));
+  }
+  for (auto& future : combined) {
+    std::move(future).get();
+  }
+}
+} // namespace pid::combiner
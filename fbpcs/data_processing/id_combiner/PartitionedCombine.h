@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace pid::combiner {
+/*
+This file implements combinePartitioned, which runs a combine step over the
+output of an id swap on several threads. The rows are split into
+numPartitions partitions by their id_ column, combine is run on every
+partition in parallel, and the outputs are concatenated in partition order,
+keeping only the header of the first one. combine has to write a header even
+for a partition without any rows.
+
+The partitions are chosen so that the concatenated output is the same as
+running combine once over the whole input:
+  - with sortById, every partition holds a contiguous range of ids, and the
+    ranges are in increasing order. This is for a combine which outputs the
+    rows sorted by id_.
+  - otherwise every partition holds a contiguous range of rows, in the input
+    order. With keepGroupsTogether, a row whose id_ was already seen is added
+    to the partition of the first row with that id_ instead. This is for a
+    combine which groups the rows by id_ in the order they first appear.
+
+The input stream is read twice, so it must support seeking. With
+numPartitions of 1 or less, combine is run on the input directly.
+*/
+void combinePartitioned(
+    std::istream& inFile,
+    std::ostream& outFile,
+    int32_t numPartitions,
+    bool sortById,
+    bool keepGroupsTogether,
+    const std::function<void(std::istream&, std::ostream&)>& combine);
+
+/*
+combineSharded splits the rows of the output of an id swap into
+outFiles.size() shards by a hash of their id_ column, and runs combine on the
+shards on up to numThreads threads, writing every shard to its own output. The
+hash only depends on the id, so the shards of two parties with the same ids
+hold the same ids, and all the rows of an id are in the same shard. Every
+shard gets the header, even one without any rows.
+*/
+void combineSharded(
+    std::istream& inFile,
+    const std::vector<std::ostream*>& outFiles,
+    int32_t numThreads,
+    const std::function<void(std::istream&, std::ostream&)>& combine);
+} // namespace pid::combiner
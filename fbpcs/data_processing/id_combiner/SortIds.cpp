@@ -7,22 +7,160 @@
 
 #include "SortIds.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <filesystem>
+#include <fstream>
 #include <iomanip>
 #include <istream>
+#include <memory>
 #include <ostream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <unordered_map>
 #include <vector>
 
+#include <folly/Random.h>
 #include <folly/String.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
 #include <re2/re2.h>
 #include "DataPreparationHelpers.h"
 
 namespace pid::combiner {
-void sortIds(std::istream& inFile, std::ostream& outFile) {
+namespace {
+// Maximum number of runs being sorted and spilled at the same time
+constexpr std::size_t kMaxSortThreads = 4;
+// Rough per row overhead of a SortRecord on top of its strings
+constexpr std::size_t kSortRecordOverhead = 2 * sizeof(std::string) + 8;
+
+struct SortRecord {
+  std::string id;
+  // Position of the row in the input, which breaks ties between equal ids
+  uint64_t seq;
+  std::string row;
+
+  bool operator<(const SortRecord& other) const {
+    return std::tie(id, seq) < std::tie(other.id, other.seq);
+  }
+};
+
+using SortRun = std::vector<SortRecord>;
+
+/**
+ * Writes the sorted records to the output. Rows with the same id have always
+ * been written as copies of the last of them, once per occurrence, and that is
+ * kept here.
+ */
+class SortedRowWriter {
+ public:
+  explicit SortedRowWriter(std::ostream& outFile) : outFile_{outFile} {}
+
+  void write(SortRecord&& record) {
+    if (count_ > 0 && record.id != id_) {
+      flush();
+    }
+    id_ = std::move(record.id);
+    row_ = std::move(record.row);
+    ++count_;
+  }
+
+  void flush() {
+    for (; count_ > 0; --count_) {
+      outFile_ << row_ << '\n';
+    }
+  }
+
+ private:
+  std::ostream& outFile_;
+  std::string id_;
+  std::string row_;
+  std::size_t count_ = 0;
+};
+
+/**
+ * A sorted run spilled to disk. Records are stored as three lines: id, seq and
+ * the row, none of which contain a newline.
+ */
+class SpilledRun {
+ public:
+  SpilledRun(const std::filesystem::path& path, SortRun& run) : path_{path} {
+    std::ofstream out{path_};
+    for (const auto& record : run) {
+      out << record.id << '\n' << record.seq << '\n' << record.row << '\n';
+    }
+    out.close();
+    if (out.fail()) {
+      throw std::runtime_error(
+          "Failed to spill sorted run to " + path_.string());
+    }
+  }
+
+  ~SpilledRun() {
+    std::error_code ec;
+    std::filesystem::remove(path_, ec);
+  }
+
+  void open() {
+    in_.open(path_);
+  }
+
+  bool next(SortRecord& record) {
+    std::string seq;
+    if (!getline(in_, record.id) || !getline(in_, seq) ||
+        !getline(in_, record.row)) {
+      return false;
+    }
+    record.seq = std::stoull(seq);
+    return true;
+  }
+
+ private:
+  std::filesystem::path path_;
+  std::ifstream in_;
+};
+
+void mergeRuns(
+    std::vector<std::unique_ptr<SpilledRun>>& runs,
+    SortedRowWriter& writer) {
+  // A min-heap of the next record of every run, along with the run it is from
+  using Head = std::pair<SortRecord, std::size_t>;
+  auto greater = [](const Head& a, const Head& b) { return b.first < a.first; };
+  std::vector<Head> heads;
+
+  for (std::size_t i = 0; i < runs.size(); ++i) {
+    runs.at(i)->open();
+    SortRecord record;
+    if (runs.at(i)->next(record)) {
+      heads.emplace_back(std::move(record), i);
+    }
+  }
+  std::make_heap(heads.begin(), heads.end(), greater);
+  while (!heads.empty()) {
+    std::pop_heap(heads.begin(), heads.end(), greater);
+    auto& head = heads.back();
+    auto runIdx = head.second;
+    writer.write(std::move(head.first));
+    if (runs.at(runIdx)->next(head.first)) {
+      std::push_heap(heads.begin(), heads.end(), greater);
+    } else {
+      heads.pop_back();
+    }
+  }
+  writer.flush();
+}
+} // namespace
+
+void sortIds(
+    std::istream& inFile,
+    std::ostream& outFile,
+    const std::filesystem::path& tmpDirectory,
+    std::size_t maxRunBytes) {
   const std::string kCommaSplitRegex = ",";
   const std::string kIdColumnName = "id_";
 
@@ -39,11 +177,38 @@ void sortIds(std::istream& inFile, std::ostream& outFile) {
   // Output the header as before
   outFile << vectorToString(header) << "\n";
 
-  // Build a map for data value to row_id
-  std::unordered_map<std::string, std::vector<std::string>> idToData;
+  auto runPrefix = std::to_string(folly::Random::secureRand64());
+  auto numThreads = std::clamp<std::size_t>(
+      std::thread::hardware_concurrency(), 1, kMaxSortThreads);
+  folly::CPUThreadPoolExecutor executor{numThreads};
+  std::deque<folly::SemiFuture<std::unique_ptr<SpilledRun>>> spilling;
+  std::vector<std::unique_ptr<SpilledRun>> runs;
+
+  auto spill = [&](SortRun run) {
+    auto path = tmpDirectory /
+        (runPrefix + "_sort_ids_run_" +
+         std::to_string(runs.size() + spilling.size()));
+    auto [promise, future] =
+        folly::makePromiseContract<std::unique_ptr<SpilledRun>>();
+    executor.add([p = std::move(promise),
+                  run = std::move(run),
+                  path = std::move(path)]() mutable {
+      p.setWith([&]() {
+        std::sort(run.begin(), run.end());
+        return std::make_unique<SpilledRun>(path, run);
+      });
+    });
+    spilling.push_back(std::move(future));
+    // Bound the number of runs held in memory
+    if (spilling.size() >= numThreads) {
+      runs.push_back(std::move(spilling.front()).get());
+      spilling.pop_front();
+    }
+  };
 
-  // Store the data map as well list of row_ids that need to be sorted
-  std::vector<std::string> idList;
+  SortRun run;
+  std::size_t runBytes = 0;
+  uint64_t seq = 0;
   while (getline(inFile, row)) {
     std::vector<std::string> cols;
     cols = splitByComma(row, true);
@@ -55,16 +220,34 @@ void sortIds(std::istream& inFile, std::ostream& outFile) {
                   << "Header: " << line << '\n'
                   << "Row   : " << row << '\n';
     }
-    auto row_id = cols.at(idColumnIdx);
-    idToData[row_id] = cols;
-    idList.push_back(row_id);
+    SortRecord record{cols.at(idColumnIdx), seq++, vectorToString(cols)};
+    runBytes += record.id.size() + record.row.size() + kSortRecordOverhead;
+    run.push_back(std::move(record));
+    if (runBytes >= maxRunBytes) {
+      spill(std::move(run));
+      run = SortRun{};
+      runBytes = 0;
+    }
   }
 
-  sort(idList.begin(), idList.end());
-
-  for (const auto& id : idList) {
-    auto& dataRow = idToData.at(id);
-    outFile << vectorToString(dataRow) << '\n';
+  SortedRowWriter writer{outFile};
+  if (runs.empty() && spilling.empty()) {
+    // Everything fit in a single run, so there is nothing to merge
+    std::sort(run.begin(), run.end());
+    for (auto& record : run) {
+      writer.write(std::move(record));
+    }
+    writer.flush();
+  } else {
+    if (!run.empty()) {
+      spill(std::move(run));
+    }
+    while (!spilling.empty()) {
+      runs.push_back(std::move(spilling.front()).get());
+      spilling.pop_front();
+    }
+    XLOG(INFO) << "[C++ SortIds] Merging " << runs.size() << " sorted runs";
+    mergeRuns(runs, writer);
   }
 
   XLOG(INFO) << "[C++ SortIds] Finished.\n";
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <filesystem>
 #include <istream>
 #include <ostream>
@@ -15,6 +16,9 @@
 #include <vector>
 
 namespace pid::combiner {
+// Approximate memory used by the rows of one sorted run before it is spilled
+constexpr std::size_t kSortIdsMaxRunBytes = 1 << 28;
+
 /*
 This file implements the sortIds that is used to sort data files based on id
 in order to return a sorted file
@@ -32,6 +36,16 @@ id        val1       val2        val3
 1           x       [a,b,c]       v1
 2           z         [c]         v3
 3           q         [l]         v4
+
+The input is sorted with an external merge sort: rows are read into runs of
+roughly maxRunBytes, each run is sorted (on a pool of threads) and spilled to
+tmpDirectory, and the runs are then merged into the output. An input which
+fits in a single run is sorted in memory without touching the disk.
 */
-void sortIds(std::istream& inFilePath, std::ostream& outFilePath);
+void sortIds(
+    std::istream& inFilePath,
+    std::ostream& outFilePath,
+    const std::filesystem::path& tmpDirectory =
+        std::filesystem::temp_directory_path(),
+    std::size_t maxRunBytes = kSortIdsMaxRunBytes);
 } // namespace pid::combiner
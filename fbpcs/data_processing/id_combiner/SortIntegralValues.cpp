@@ -7,12 +7,13 @@
 
 #include "SortIntegralValues.h"
 
-#include <folly/String.h>
 #include <folly/logging/xlog.h>
 
+#include <cstdint>
 #include <istream>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "DataPreparationHelpers.h"
@@ -20,23 +21,33 @@
 // TODO(T90086783): We should rely upon Csv.h to handle this sort of parsing for
 // us
 namespace {
-std::vector<std::string> splitWithBrackets(const std::string& s) {
-  std::vector<std::string> res;
+void splitWithBrackets(
+    std::string_view s,
+    std::vector<std::string_view>& res) {
+  res.clear();
   std::size_t start = 0;
   bool inBrackets = false;
   for (std::size_t i = 0; i < s.size(); ++i) {
-    if (s.at(i) == ',' && !inBrackets) {
+    if (s[i] == ',' && !inBrackets) {
       res.push_back(s.substr(start, i - start));
       start = i + 1;
-    } else if (s.at(i) == '[') {
+    } else if (s[i] == '[') {
       inBrackets = true;
-    } else if (s.at(i) == ']') {
+    } else if (s[i] == ']') {
       inBrackets = false;
     }
   }
   // Remember to include the last column
   res.push_back(s.substr(start));
-  return res;
+}
+
+void appendJoined(std::string& out, const std::vector<std::string_view>& vec) {
+  for (std::size_t i = 0; i < vec.size(); ++i) {
+    if (i > 0) {
+      out += ',';
+    }
+    out.append(vec[i]);
+  }
 }
 } // namespace
 
@@ -53,15 +64,42 @@ void sortIntegralValues(
 
   std::string line;
   getline(inStream, line);
-  auto header = splitWithBrackets(line);
+  std::vector<std::string_view> headerViews;
+  splitWithBrackets(line, headerViews);
+  std::vector<std::string> header{headerViews.begin(), headerViews.end()};
 
   auto headerSize = header.size();
 
   // Output the header as before
   outStream << vectorToString(header) << '\n';
 
+  // Look up the list columns once: the column of every list, and the list
+  // output for every column
+  constexpr std::size_t kNotAList = -1;
+  std::vector<std::size_t> listIndices;
+  std::vector<std::size_t> columnLists(headerSize, kNotAList);
+  std::size_t sortByIdxInParsedLists = 0;
+  for (std::size_t k = 0; k < listColumns.size(); ++k) {
+    auto idx = headerIndex(header, listColumns.at(k));
+    listIndices.push_back(idx);
+    if (columnLists.at(idx) == kNotAList) {
+      columnLists.at(idx) = k;
+    }
+    if (listColumns.at(k) == sortBy) {
+      sortByIdxInParsedLists = k;
+    }
+  }
+
+  // The values of each row are views of its line, kept with the rest of
+  // these buffers for the next row
+  std::vector<std::string_view> row;
+  std::vector<std::vector<std::string_view>> listsInRow(listColumns.size());
+  std::vector<std::string_view> scratch;
+  std::vector<int64_t> vals;
+  std::vector<std::size_t> permutation;
+  std::string out;
   while (getline(inStream, line)) {
-    auto row = splitWithBrackets(line);
+    splitWithBrackets(line, row);
     auto rowSize = row.size();
     if (rowSize != headerSize) {
       XLOG(FATAL) << "Mismatch between header and row\n"
@@ -72,63 +110,51 @@ void sortIntegralValues(
     }
 
     // First parse the listy columns
-    std::vector<std::vector<std::string>> listsInRow;
-    std::size_t sortByIdxInParsedLists;
-    std::size_t pushBackIdx = 0;
-    for (const auto& listCol : listColumns) {
-      if (listCol == sortBy) {
-        sortByIdxInParsedLists = pushBackIdx;
-      }
-      auto idx = headerIndex(header, listCol);
-      listsInRow.push_back(splitList(row.at(idx)));
-      ++pushBackIdx;
+    for (std::size_t k = 0; k < listIndices.size(); ++k) {
+      splitListViews(row[listIndices[k]], listsInRow[k]);
     }
 
     // We go ahead and parse the sortBy column once to avoid duplicating work
-    std::vector<int64_t> vals;
-    for (const auto& s : listsInRow.at(sortByIdxInParsedLists)) {
-      int64_t parsed;
-      std::istringstream parser{s};
-      parser >> parsed;
-      if (parser.fail()) {
-        XLOG(FATAL) << "Failed to parse " << s << " as int64_t";
-      }
-      vals.push_back(parsed);
+    vals.clear();
+    for (auto s : listsInRow[sortByIdxInParsedLists]) {
+      vals.push_back(parseSortByValue(s));
     }
 
     // Then sort them all based on the sortBy column
-    auto permutation =
-        getSortPermutation(vals, [](int64_t a, int64_t b) { return a < b; });
-    XLOG(INFO) << "The permutation of " << vectorToString(vals) << " is... "
-               << vectorToString(permutation);
+    getIntegralSortPermutation(vals, permutation);
+    XLOG(DBG) << "The permutation of " << vectorToString(vals) << " is... "
+              << vectorToString(permutation);
 
     // Apply the permutation to every list column
-    for (auto& lst : listsInRow) {
-      applyPermutation(lst, permutation);
+    for (std::size_t k = 0; k < listsInRow.size(); ++k) {
+      if (listsInRow[k].size() != permutation.size()) {
+        XLOG(FATAL) << "List column " << listColumns.at(k) << " has "
+                    << listsInRow[k].size() << " values while " << sortBy
+                    << " has " << permutation.size() << '\n'
+                    << "Row   : " << line << '\n';
+      }
+      applyPermutation(listsInRow[k], permutation, scratch);
     }
 
     // Finally, emit a new line
-    bool first = true;
-    for (std::size_t i = 0; i < row.size(); ++i) {
-      if (!first) {
-        outStream << ',';
+    out.clear();
+    for (std::size_t i = 0; i < rowSize; ++i) {
+      if (i > 0) {
+        out += ',';
       }
-      first = false;
 
       // If this is a list column, output from the sorted listsInRow instead
-      auto listFind =
-          std::find(listColumns.begin(), listColumns.end(), header.at(i));
-      if (listFind != listColumns.end()) {
-        outStream << '['
-                  << vectorToString(
-                         listsInRow.at(listFind - listColumns.begin()))
-                  << ']';
+      if (columnLists[i] != kNotAList) {
+        out += '[';
+        appendJoined(out, listsInRow[columnLists[i]]);
+        out += ']';
       } else {
         // Otherwise we have the "easy" case -- just output
-        outStream << row.at(i);
+        out.append(row[i]);
       }
     }
-    outStream << '\n';
+    out += '\n';
+    outStream.write(out.data(), out.size());
   }
 }
 } // namespace pid::combiner
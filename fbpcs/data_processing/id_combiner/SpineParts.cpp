@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "SpineParts.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/futures/Future.h>
+#include <folly/logging/xlog.h>
+
+#include "fbpcs/emp_games/common/CompressedIO.h"
+
+namespace pid::combiner {
+std::vector<std::string> getSpineParts(const std::string& spinePath) {
+  std::error_code ec;
+  if (!std::filesystem::is_directory(spinePath, ec)) {
+    return {spinePath};
+  }
+
+  std::vector<std::string> parts;
+  for (const auto& entry : std::filesystem::directory_iterator{spinePath}) {
+    auto name = entry.path().filename().string();
+    if (!entry.is_regular_file() || name.empty() || name.front() == '.' ||
+        name.front() == '_') {
+      continue;
+    }
+    parts.push_back(entry.path().string());
+  }
+  std::sort(parts.begin(), parts.end());
+  if (parts.empty()) {
+    XLOG(FATAL) << "No part files in spine directory " << spinePath;
+  }
+  XLOG(INFO) << "Reading " << parts.size() << " part files of " << spinePath;
+  return parts;
+}
+
+void readSpineParts(
+    const std::vector<std::string>& parts,
+    const std::string& headerLine,
+    std::ostream& outFile,
+    std::size_t maxThreads) {
+  auto numThreads = std::clamp<std::size_t>(maxThreads, 1, parts.size());
+  folly::CPUThreadPoolExecutor executor{numThreads};
+
+  // Parts are read ahead of the one being written, up to one per thread
+  std::deque<folly::SemiFuture<std::string>> reading;
+  std::size_t nextPart = 0;
+  auto readNextPart = [&]() {
+    auto [promise, future] = folly::makePromiseContract<std::string>();
+    executor.add([p = std::move(promise), path = parts.at(nextPart)]() mutable {
+      p.setWith([&]() {
+        return private_measurement::compressed_io::readFile(path);
+      });
+    });
+    reading.push_back(std::move(future));
+    ++nextPart;
+  };
+
+  for (std::size_t i = 0; i < parts.size(); ++i) {
+    while (nextPart < parts.size() && reading.size() < numThreads) {
+      readNextPart();
+    }
+    auto content = std::move(reading.front()).get();
+    reading.pop_front();
+
+    // An empty part has no rows, and not even a header
+    if (content.empty()) {
+      continue;
+    }
+    std::string_view rows{content};
+    auto headerEnd = std::min(rows.find('\n'), rows.size());
+    // headerLine is trimmed of the \r of CRLF lines by processHeader
+    auto header = rows.substr(0, headerEnd);
+    if (!header.empty() && header.back() == '\r') {
+      header.remove_suffix(1);
+    }
+    if (header != headerLine) {
+      XLOG(FATAL) << "Part " << parts.at(i) << " has header <" << header
+                  << "> instead of <" << headerLine << ">";
+    }
+    rows.remove_prefix(std::min(headerEnd + 1, rows.size()));
+    outFile.write(rows.data(), rows.size());
+    if (!rows.empty() && rows.back() != '\n') {
+      outFile << '\n';
+    }
+  }
+}
+} // namespace pid::combiner
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace pid::combiner {
+/*
+The output of a MapReduce PID match is a directory of part files, which used
+to be concatenated into a single spine file before the combiners ran.
+getSpineParts lists the part files of a spine path, and readSpineParts reads
+them concurrently, one worker per part, writing their rows in part order as if
+they had been concatenated.
+
+Every part starts with the same header line, and files whose name starts with
+'.' or '_' (such as _SUCCESS) are not parts.
+*/
+
+// The part files of a local directory in name order, or the spine path itself
+// if it is a file
+std::vector<std::string> getSpineParts(const std::string& spinePath);
+
+// Writes the rows of every part to outFile, without their header line, which
+// has to be headerLine. Up to maxThreads parts are read at the same time.
+void readSpineParts(
+    const std::vector<std::string>& parts,
+    const std::string& headerLine,
+    std::ostream& outFile,
+    std::size_t maxThreads);
+} // namespace pid::combiner
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "../CombineGroups.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../AddPaddingToCols.h"
+#include "../DataPreparationHelpers.h"
+#include "../GroupBy.h"
+#include "../SortIds.h"
+#include "../SortIntegralValues.h"
+
+namespace pid::combiner {
+class CombineGroupsTest : public testing::Test {
+ public:
+  void vectorStringToStream(
+      const std::vector<std::string>& input,
+      std::stringstream& out) {
+    for (auto const& row : input) {
+      out << row << '\n';
+    }
+  }
+
+  std::vector<std::string> streamToVectorString(std::stringstream& in) {
+    std::vector<std::string> rows;
+    std::string row;
+    while (getline(in, row)) {
+      rows.push_back(row);
+    }
+    return rows;
+  }
+
+  std::vector<std::string> runCombineGroups(
+      const std::vector<std::string>& dataContent,
+      const CombineGroupsOptions& options) {
+    std::stringstream dataStream;
+    std::stringstream outputStream;
+    vectorStringToStream(dataContent, dataStream);
+    combineGroups(dataStream, outputStream, options);
+    return streamToVectorString(outputStream);
+  }
+
+  // The chain of separate steps which combineGroups replaces
+  std::vector<std::string> runChainedSteps(
+      const std::vector<std::string>& dataContent,
+      const CombineGroupsOptions& options) {
+    std::stringstream dataStream;
+    vectorStringToStream(dataContent, dataStream);
+
+    std::stringstream groupedStream;
+    groupBy(
+        dataStream,
+        options.groupByColumn,
+        options.columnsToAggregate,
+        groupedStream);
+
+    std::stringstream sortedStream;
+    if (options.sortById) {
+      sortIds(groupedStream, sortedStream);
+    } else {
+      sortedStream << groupedStream.rdbuf();
+    }
+
+    std::stringstream paddedStream;
+    if (options.padSizePerCol.empty()) {
+      paddedStream << sortedStream.rdbuf();
+    } else {
+      addPaddingToCols(
+          sortedStream,
+          options.columnsToAggregate,
+          options.padSizePerCol,
+          options.enforceMax,
+          paddedStream);
+    }
+
+    std::stringstream valuesSortedStream;
+    if (options.sortBy.empty()) {
+      valuesSortedStream << paddedStream.rdbuf();
+    } else {
+      sortIntegralValues(
+          paddedStream,
+          valuesSortedStream,
+          options.sortBy,
+          options.listColumns);
+    }
+
+    std::stringstream outputStream;
+    headerColumnsToPlural(
+        valuesSortedStream, options.columnsToPluralize, outputStream);
+    return streamToVectorString(outputStream);
+  }
+};
+
+TEST_F(CombineGroupsTest, TestAllSteps) {
+  std::vector<std::string> dataInput = {
+      "id_,ts,val", "1,20,a", "1,10,b", "2,30,c"};
+  std::vector<std::string> expectedOutput = {
+      "id_,ts,val", "1,[0,10,20],[0,b,a]", "2,[0,0,30],[0,0,c]"};
+
+  CombineGroupsOptions options;
+  options.columnsToAggregate = {"ts", "val"};
+  options.padSizePerCol = {3, 3};
+  options.sortBy = "ts";
+  options.listColumns = {"ts", "val"};
+
+  EXPECT_EQ(runCombineGroups(dataInput, options), expectedOutput);
+}
+
+TEST_F(CombineGroupsTest, TestMatchesChainedStepsForLiftPartner) {
+  std::vector<std::string> dataInput = {
+      "id_,event_timestamp,value,cohort_id",
+      "CCC,375,300,1",
+      "AAA,129,106,0",
+      "AAA,125,102,0",
+      "BBB,,200,2",
+      "AAA,127,104,0",
+      "DDD,400,400,3",
+      "AAA,126,103,0",
+      "AAA,128,105,0"};
+
+  CombineGroupsOptions options;
+  options.columnsToAggregate = {"event_timestamp", "value"};
+  options.sortById = true;
+  options.padSizePerCol = {4, 4};
+  options.enforceMax = true;
+  options.sortBy = "event_timestamp";
+  options.listColumns = {"event_timestamp", "value"};
+  options.columnsToPluralize = {"event_timestamp", "value"};
+
+  std::vector<std::string> expectedOutput = {
+      "id_,event_timestamps,values,cohort_id",
+      "AAA,[125,126,127,129],[102,103,104,106],0",
+      "BBB,[0,0,0,0],[0,0,0,200],2",
+      "CCC,[0,0,0,375],[0,0,0,300],1",
+      "DDD,[0,0,0,400],[0,0,0,400],3"};
+  EXPECT_EQ(runCombineGroups(dataInput, options), expectedOutput);
+  EXPECT_EQ(
+      runCombineGroups(dataInput, options),
+      runChainedSteps(dataInput, options));
+}
+
+TEST_F(CombineGroupsTest, TestMatchesChainedStepsForAttributionPublisher) {
+  std::vector<std::string> dataInput = {
+      "id_,ad_id,timestamp,is_click",
+      "id_2,3,200,1",
+      "id_1,1,125,0",
+      "id_1,2,126,1",
+      "id_3,4,375,0"};
+
+  CombineGroupsOptions options;
+  options.columnsToAggregate = {"ad_id", "timestamp", "is_click"};
+  options.padSizePerCol = {3, 3, 3};
+  options.enforceMax = true;
+  options.columnsToPluralize = {"ad_id", "timestamp"};
+
+  std::vector<std::string> expectedOutput = {
+      "id_,ad_ids,timestamps,is_click",
+      "id_2,[0,0,3],[0,0,200],[0,0,1]",
+      "id_1,[0,1,2],[0,125,126],[0,0,1]",
+      "id_3,[0,0,4],[0,0,375],[0,0,0]"};
+  EXPECT_EQ(runCombineGroups(dataInput, options), expectedOutput);
+  EXPECT_EQ(
+      runCombineGroups(dataInput, options),
+      runChainedSteps(dataInput, options));
+
+  options.sortById = true;
+  EXPECT_EQ(
+      runCombineGroups(dataInput, options),
+      runChainedSteps(dataInput, options));
+}
+} // namespace pid::combiner
@@ -68,3 +68,49 @@ TEST_F(DataValidationTest, TestRowMismatch) {
       runTest(dataInput),
       "Row at index <2> and header sizes mismatch. Row size is 2 and header size is 3");
 }
+
+TEST_F(DataValidationTest, TestLargeValues) {
+  std::vector<std::string> dataInput = {
+      "id_,event_timestamp,value",
+      "1234567890123456789,18446744073709551615,0"};
+
+  runTest(dataInput);
+}
+
+TEST_F(DataValidationTest, TestValueOutOfRange) {
+  std::vector<std::string> dataInput = {
+      "id_,event_timestamp,value", "1,18446744073709551616,0"};
+
+  ASSERT_DEATH(
+      runTest(dataInput), ".*18446744073709551616 failed to parse to int*");
+}
+
+TEST_F(DataValidationTest, TestEmptyField) {
+  std::vector<std::string> dataInput = {
+      "id_,event_timestamp,value", "111,200,200", "222,,375"};
+
+  ASSERT_DEATH(
+      runTest(dataInput),
+      "Row at index <2> and header sizes mismatch. Row size is 1 and header size is 3");
+}
+
+TEST_F(DataValidationTest, TestRowsAcrossReadBlocks) {
+  // Enough rows to be read in several blocks, ending with an invalid one
+  std::vector<std::string> dataInput = {"id_,event_timestamp,value"};
+  for (int i = 0; i < 200000; ++i) {
+    dataInput.push_back(folly::to<std::string>(i, ",1600000000,", i * 7));
+  }
+  dataInput.push_back("200001,1600000000,12x");
+
+  ASSERT_DEATH(runTest(dataInput), ".*12x failed to parse to int*");
+}
+
+TEST_F(DataValidationTest, TestLastRowWithoutNewline) {
+  dataStream_ << "id_,event_timestamp,value\n"
+              << "111,200,200\n"
+              << "222,375";
+
+  ASSERT_DEATH(
+      validateCsvData(dataStream_),
+      "Row at index <2> and header sizes mismatch. Row size is 2 and header size is 3");
+}
@@ -42,11 +42,16 @@ class GroupByTest : public testing::Test {
       std::vector<std::string>& dataContent,
       std::string groupByCol,
       std::vector<std::string> columnsToAggregate,
-      std::vector<std::string>& expectedOutput) {
+      std::vector<std::string>& expectedOutput,
+      bool inputSortedByGroup = false) {
     vectorStringToStream(dataContent, dataStream_);
 
     pid::combiner::groupBy(
-        dataStream_, groupByCol, columnsToAggregate, outputStream_);
+        dataStream_,
+        groupByCol,
+        columnsToAggregate,
+        outputStream_,
+        inputSortedByGroup);
     validateOutputFile(expectedOutput);
   }
 
@@ -136,3 +141,70 @@ TEST_F(GroupByTest, TestGroupingTraversedOrder) {
   };
   runTest(dataInput, "id_", {"event_timestamp", "value"}, expectedOutput);
 }
+
+// testing that empty values, including empty ids, are output as 0
+TEST_F(GroupByTest, TestGroupingEmptyValues) {
+  std::vector<std::string> dataInput = {
+      "id_,event_timestamp,value",
+      "AAA,,102",
+      ",200,",
+      "AAA,126,",
+      "0,300,1",
+  };
+  std::vector<std::string> expectedOutput = {
+      "id_,event_timestamp,value",
+      "AAA,[0,126],[102,0]",
+      "0,[200,300],[0,1]",
+  };
+  runTest(dataInput, "id_", {"event_timestamp", "value"}, expectedOutput);
+}
+
+// testing that sorted input can't be streamed if its empty ids, which are
+// grouped with the ids 0, don't come right before them
+TEST_F(GroupByTest, TestGroupingSortedEmptyIdApartFromZeroFails) {
+  std::vector<std::string> dataInput = {
+      "id_,event_timestamp,value",
+      ",200,200",
+      "-5,125,102",
+      "0,126,103",
+  };
+  std::vector<std::string> expectedOutput;
+  EXPECT_DEATH(
+      runTest(dataInput, "id_", {"event_timestamp"}, expectedOutput, true),
+      "Input is not sorted by id_");
+}
+
+// testing that sorted input is grouped the same when streamed, without
+// holding the earlier groups
+TEST_F(GroupByTest, TestGroupingSortedInput) {
+  std::vector<std::string> dataInput = {
+      "id_,event_timestamp,value",
+      ",100,1",
+      "AAA,125,",
+      "AAA,126,103",
+      "BBB,200,200",
+      "CCC,375,300",
+      "CCC,376,301",
+  };
+  std::vector<std::string> expectedOutput = {
+      "id_,event_timestamp,value",
+      "0,[100],[1]",
+      "AAA,[125,126],[0,103]",
+      "BBB,[200],[200]",
+      "CCC,[375,376],[300,301]",
+  };
+  runTest(dataInput, "id_", {"event_timestamp", "value"}, expectedOutput, true);
+}
+
+// testing that unsorted input can't be streamed
+TEST_F(GroupByTest, TestGroupingUnsortedInputFails) {
+  std::vector<std::string> dataInput = {
+      "id_,event_timestamp,value",
+      "BBB,200,200",
+      "AAA,125,102",
+  };
+  std::vector<std::string> expectedOutput;
+  EXPECT_DEATH(
+      runTest(dataInput, "id_", {"event_timestamp"}, expectedOutput, true),
+      "Input is not sorted by id_");
+}
@@ -339,6 +339,30 @@ TEST_F(IdSwapMultiKeyTest, MismatchBetweenHeaderAndRows) {
       "Error: number of non-id columns not consistent with header.");
 }
 
+// Aggregations resolved once from the header are reused across groups
+TEST_F(IdSwapMultiKeyTest, AggregateWithResolvedAggregations) {
+  std::vector<std::string> header{
+      "id_", "opportunity_timestamp", "breakdown_id", "num_impressions"};
+  auto aggregations = pid::combiner::getLiftAggregations(header);
+  std::vector<pid::combiner::LiftAggregation> expectedAggregations{
+      pid::combiner::LiftAggregation::kMin,
+      pid::combiner::LiftAggregation::kMax,
+      pid::combiner::LiftAggregation::kSum};
+  EXPECT_EQ(aggregations, expectedAggregations);
+
+  std::vector<std::vector<std::string>> dRows{
+      {"150", "0", "2147483647"}, {"100", "1", "2147483647"}};
+  pid::combiner::aggregateLiftNonIdColumns(aggregations, dRows);
+  std::vector<std::vector<std::string>> expectedRows{
+      {"100", "1", "4294967294"}};
+  EXPECT_EQ(dRows, expectedRows);
+
+  std::vector<std::vector<std::string>> otherRows{{" 20", "+3", "5"}};
+  pid::combiner::aggregateLiftNonIdColumns(aggregations, otherRows);
+  std::vector<std::vector<std::string>> expectedOtherRows{{"20", "3", "5"}};
+  EXPECT_EQ(otherRows, expectedOtherRows);
+}
+
 // three id keys but only single key would be used
 TEST_F(IdSwapMultiKeyTest, MultiKeyWithMaxOne) {
   std::vector<std::string> dataInput = {
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "../PartitionedCombine.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../CombineGroups.h"
+#include "../SortIds.h"
+
+namespace pid::combiner {
+class PartitionedCombineTest : public testing::Test {
+ public:
+  std::vector<std::string> runTest(
+      const std::vector<std::string>& dataContent,
+      int32_t numPartitions,
+      bool sortById,
+      bool keepGroupsTogether,
+      const std::function<void(std::istream&, std::ostream&)>& combine) {
+    std::stringstream dataStream;
+    for (auto const& row : dataContent) {
+      dataStream << row << '\n';
+    }
+    std::stringstream outputStream;
+    combinePartitioned(
+        dataStream,
+        outputStream,
+        numPartitions,
+        sortById,
+        keepGroupsTogether,
+        combine);
+
+    std::vector<std::string> rows;
+    std::string row;
+    while (getline(outputStream, row)) {
+      rows.push_back(row);
+    }
+    return rows;
+  }
+
+  // Returns the rows of every shard, without their header
+  std::vector<std::vector<std::string>> runShardedTest(
+      const std::vector<std::string>& dataContent,
+      std::size_t numShards,
+      int32_t numThreads) {
+    std::stringstream dataStream;
+    for (auto const& row : dataContent) {
+      dataStream << row << '\n';
+    }
+    std::vector<std::stringstream> shardStreams(numShards);
+    std::vector<std::ostream*> outFiles;
+    for (auto& shardStream : shardStreams) {
+      outFiles.push_back(&shardStream);
+    }
+    auto combine = [](std::istream& in, std::ostream& out) {
+      sortIds(in, out);
+    };
+    combineSharded(dataStream, outFiles, numThreads, combine);
+
+    std::vector<std::vector<std::string>> shards;
+    for (auto& shardStream : shardStreams) {
+      std::string row;
+      getline(shardStream, row);
+      EXPECT_EQ(row, dataContent.front());
+      shards.emplace_back();
+      while (getline(shardStream, row)) {
+        shards.back().push_back(row);
+      }
+    }
+    return shards;
+  }
+
+ protected:
+  const std::vector<std::string> dataInput_ = {
+      "id_,ts",
+      "5,50",
+      "3,30",
+      "1,10",
+      "5,51",
+      "4,40",
+      "2,20",
+      "3,31",
+      "6,60"};
+};
+
+TEST_F(PartitionedCombineTest, TestGroupsInFirstSeenOrder) {
+  CombineGroupsOptions options;
+  options.columnsToAggregate = {"ts"};
+  auto combine = [&options](std::istream& in, std::ostream& out) {
+    combineGroups(in, out, options);
+  };
+
+  std::vector<std::string> expectedOutput = {
+      "id_,ts",
+      "5,[50,51]",
+      "3,[30,31]",
+      "1,[10]",
+      "4,[40]",
+      "2,[20]",
+      "6,[60]"};
+  for (int32_t numPartitions : {1, 2, 3, 8, 16}) {
+    EXPECT_EQ(
+        runTest(dataInput_, numPartitions, false, true, combine),
+        expectedOutput);
+  }
+}
+
+TEST_F(PartitionedCombineTest, TestGroupsSortedById) {
+  CombineGroupsOptions options;
+  options.columnsToAggregate = {"ts"};
+  options.sortById = true;
+  auto combine = [&options](std::istream& in, std::ostream& out) {
+    combineGroups(in, out, options);
+  };
+
+  std::vector<std::string> expectedOutput = {
+      "id_,ts",
+      "1,[10]",
+      "2,[20]",
+      "3,[30,31]",
+      "4,[40]",
+      "5,[50,51]",
+      "6,[60]"};
+  for (int32_t numPartitions : {1, 2, 3, 8, 16}) {
+    EXPECT_EQ(
+        runTest(dataInput_, numPartitions, true, true, combine),
+        expectedOutput);
+  }
+}
+
+TEST_F(PartitionedCombineTest, TestRowsSortedById) {
+  auto combine = [](std::istream& in, std::ostream& out) {
+    sortIds(in, out);
+  };
+
+  std::vector<std::string> expectedOutput = {
+      "id_,ts", "1,10", "2,20", "3,31", "3,31", "4,40", "5,51", "5,51", "6,60"};
+  for (int32_t numPartitions : {1, 2, 3, 8, 16}) {
+    EXPECT_EQ(
+        runTest(dataInput_, numPartitions, true, false, combine),
+        expectedOutput);
+  }
+}
+
+TEST_F(PartitionedCombineTest, TestRowsKeptInOrder) {
+  auto combine = [](std::istream& in, std::ostream& out) { out << in.rdbuf(); };
+
+  for (int32_t numPartitions : {1, 2, 3, 8, 16}) {
+    EXPECT_EQ(
+        runTest(dataInput_, numPartitions, false, false, combine), dataInput_);
+  }
+}
+
+TEST_F(PartitionedCombineTest, TestPartitionsCanBeReadTwice) {
+  // Reads the header, then seeks back and copies the whole partition, like a
+  // combine which reads the header before the rows
+  auto combine = [](std::istream& in, std::ostream& out) {
+    std::string header;
+    getline(in, header);
+    in.clear();
+    in.seekg(0);
+    out << in.rdbuf();
+  };
+
+  for (int32_t numPartitions : {1, 2, 3}) {
+    EXPECT_EQ(
+        runTest(dataInput_, numPartitions, false, false, combine), dataInput_);
+  }
+}
+
+TEST_F(PartitionedCombineTest, TestEmptyInput) {
+  CombineGroupsOptions options;
+  options.columnsToAggregate = {"ts"};
+  options.sortById = true;
+  auto combine = [&options](std::istream& in, std::ostream& out) {
+    combineGroups(in, out, options);
+  };
+
+  std::vector<std::string> expectedOutput = {"id_,ts"};
+  EXPECT_EQ(runTest({"id_,ts"}, 4, true, true, combine), expectedOutput);
+}
+
+TEST_F(PartitionedCombineTest, TestShardsById) {
+  // The other party has the same ids in another order, with other values
+  const std::vector<std::string> otherInput = {
+      "id_,ts", "6,6", "2,2", "4,4", "1,1", "3,3", "5,5"};
+
+  for (int32_t numThreads : {1, 2, 8}) {
+    auto shards = runShardedTest(dataInput_, 3, numThreads);
+    auto otherShards = runShardedTest(otherInput, 3, numThreads);
+    ASSERT_EQ(shards.size(), 3);
+
+    std::map<std::string, std::size_t> idShards;
+    std::size_t numRows = 0;
+    for (std::size_t s = 0; s < shards.size(); ++s) {
+      // Every shard is sorted, and an id is only in one shard
+      EXPECT_TRUE(std::is_sorted(shards.at(s).begin(), shards.at(s).end()));
+      for (const auto& row : shards.at(s)) {
+        auto id = row.substr(0, row.find(','));
+        EXPECT_EQ(idShards.try_emplace(id, s).first->second, s);
+        ++numRows;
+      }
+    }
+    EXPECT_EQ(numRows, dataInput_.size() - 1);
+    for (std::size_t s = 0; s < otherShards.size(); ++s) {
+      for (const auto& row : otherShards.at(s)) {
+        EXPECT_EQ(idShards.at(row.substr(0, row.find(','))), s);
+      }
+    }
+  }
+}
+} // namespace pid::combiner
@@ -40,10 +40,15 @@ class SortIdsTest : public testing::Test {
 
   void runTest(
       std::vector<std::string>& dataContent,
-      std::vector<std::string>& expectedOutput) {
+      std::vector<std::string>& expectedOutput,
+      std::size_t maxRunBytes = pid::combiner::kSortIdsMaxRunBytes) {
     vectorStringToStream(dataContent, dataStream_);
 
-    pid::combiner::sortIds(dataStream_, outputStream_);
+    pid::combiner::sortIds(
+        dataStream_,
+        outputStream_,
+        std::filesystem::temp_directory_path(),
+        maxRunBytes);
     validateOutputFile(expectedOutput);
   }
 
@@ -106,3 +111,25 @@ TEST_F(SortIdsTest, TestGroupingTraversedOrder) {
   };
   runTest(dataInput, expectedOutput);
 }
+
+// testing that spilling every row to its own run gives the same order,
+// including for repeated ids
+TEST_F(SortIdsTest, TestSortingWithSpilledRuns) {
+  std::vector<std::string> dataInput = {
+      "id_,event_timestamp,value",
+      "CCC,[375],[300]",
+      "AAA,[125,126],[102,103]",
+      "DDD,[400],[400]",
+      "BBB,[200],[200]",
+      "AAA,[127],[104]",
+  };
+  std::vector<std::string> expectedOutput = {
+      "id_,event_timestamp,value",
+      "AAA,[127],[104]",
+      "AAA,[127],[104]",
+      "BBB,[200],[200]",
+      "CCC,[375],[300]",
+      "DDD,[400],[400]",
+  };
+  runTest(dataInput, expectedOutput, 1);
+}
@@ -6,7 +6,9 @@
  */
 
 #include "../SortIntegralValues.h"
+#include "../DataPreparationHelpers.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
 #include <filesystem>
@@ -75,3 +77,47 @@ TEST_F(SortIntegralValuesTest, TestSortingBasic) {
       {"event_timestamps", "values"},
       expectedOutput);
 }
+
+// test that equal values keep their order and long lists are sorted too
+TEST_F(SortIntegralValuesTest, TestSortingTiesAndLongLists) {
+  std::vector<std::string> dataInput = {
+      "id_,event_timestamps,values,other",
+      "id_1,[2,1,2,1],[a,b,c,d],x",
+      "id_2,[20,19,18,17,16,15,14,13,12,11,10,9,8,7,6,5,4,3,2,1],"
+      "[a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p,q,r,s,t],y",
+  };
+  std::vector<std::string> expectedOutput = {
+      "id_,event_timestamps,values,other",
+      "id_1,[1,1,2,2],[b,d,a,c],x",
+      "id_2,[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20],"
+      "[t,s,r,q,p,o,n,m,l,k,j,i,h,g,f,e,d,c,b,a],y",
+  };
+  runTest(
+      dataInput,
+      "event_timestamps",
+      {"event_timestamps", "values"},
+      expectedOutput);
+}
+
+// test that the permutation matches getSortPermutation
+TEST(IntegralSortPermutationTest, TestMatchesGetSortPermutation) {
+  std::vector<std::size_t> permutation;
+  for (std::size_t n = 0; n <= 2 * kSmallSortSize; ++n) {
+    std::vector<int64_t> vals;
+    for (std::size_t i = 0; i < n; ++i) {
+      vals.push_back((i * 7919) % 5 - 2);
+    }
+    getIntegralSortPermutation(vals, permutation);
+    std::vector<int64_t> sorted;
+    for (auto i : permutation) {
+      sorted.push_back(vals.at(i));
+    }
+    EXPECT_TRUE(std::is_sorted(sorted.begin(), sorted.end()));
+    if (n <= kSmallSortSize) {
+      EXPECT_EQ(
+          permutation,
+          getSortPermutation(
+              vals, [](int64_t a, int64_t b) { return a < b; }));
+    }
+  }
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "../SpineParts.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <folly/Random.h>
+#include <gtest/gtest.h>
+
+using namespace ::pid::combiner;
+
+class SpinePartsTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = std::filesystem::temp_directory_path() /
+        ("SpinePartsTest_" + std::to_string(folly::Random::rand32()));
+    std::filesystem::create_directories(directory_);
+  }
+
+  void TearDown() override {
+    std::filesystem::remove_all(directory_);
+  }
+
+  std::string writePart(const std::string& name, const std::string& content) {
+    auto path = (directory_ / name).string();
+    std::ofstream out{path};
+    out << content;
+    return path;
+  }
+
+  std::filesystem::path directory_;
+};
+
+TEST_F(SpinePartsTest, TestSpineFileIsItsOnlyPart) {
+  auto path = writePart("spine.csv", "id_,value\n1,2\n");
+  EXPECT_EQ(getSpineParts(path), std::vector<std::string>({path}));
+}
+
+TEST_F(SpinePartsTest, TestPartsAreReadInOrder) {
+  auto part1 = writePart("part-00001", "id_,value\n3,4\n5,6");
+  auto part0 = writePart("part-00000", "id_,value\n1,2\n");
+  auto part2 = writePart("part-00002", "");
+  auto part3 = writePart("part-00003", "id_,value\n");
+  auto part4 = writePart("part-00004", "id_,value\n7,8\n");
+  writePart("_SUCCESS", "");
+  writePart(".part-00000.crc", "");
+
+  auto parts = getSpineParts(directory_.string());
+  EXPECT_EQ(
+      parts, std::vector<std::string>({part0, part1, part2, part3, part4}));
+
+  for (std::size_t maxThreads : {1, 2, 16}) {
+    std::stringstream out;
+    readSpineParts(parts, "id_,value", out, maxThreads);
+    EXPECT_EQ(out.str(), "1,2\n3,4\n5,6\n7,8\n");
+  }
+}
+
+TEST_F(SpinePartsTest, TestPartsWithCrlfLines) {
+  writePart("part-00000", "id_,value\r\n1,2\r\n");
+  writePart("part-00001", "id_,value\r\n3,4\r\n");
+  auto parts = getSpineParts(directory_.string());
+  std::stringstream out;
+  readSpineParts(parts, "id_,value", out, 2);
+  EXPECT_EQ(out.str(), "1,2\r\n3,4\r\n");
+}
+
+TEST_F(SpinePartsTest, TestPartsNeedTheSameHeader) {
+  writePart("part-00000", "id_,value\n1,2\n");
+  writePart("part-00001", "id_,other\n3,4\n");
+  auto parts = getSpineParts(directory_.string());
+  std::stringstream out;
+  EXPECT_DEATH(
+      readSpineParts(parts, "id_,value", out, 2), "has header <id_,other>");
+}
@@ -0,0 +1,474 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "fbpcs/data_processing/input_validation/InputDataValidator.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/logging/xlog.h>
+
+namespace data_processing::input_validation {
+
+namespace {
+
+// The field names and limits of fbpcs/pc_pre_validation/constants.py
+constexpr std::string_view kIdFieldPrefix = "id_";
+constexpr std::string_view kCohortIdField = "cohort_id";
+constexpr std::string_view kTimestampSuffix = "timestamp";
+constexpr int64_t kIntegerMaxValue = 2147483647;
+
+const std::vector<std::string_view> kIntegerFields = {
+    "conversion_value",
+    "conversion_metadata",
+    "value",
+    "cohort_id",
+    "ad_id",
+    "is_click"};
+const std::vector<std::string_view> kTimestampFields = {
+    "conversion_timestamp",
+    "event_timestamp",
+    "timestamp",
+    "opportunity_timestamp"};
+const std::vector<std::string_view> kValueFields = {
+    "conversion_value",
+    "value"};
+
+constexpr std::string_view kLineEndingError =
+    "Detected an unexpected line ending. The only supported line ending is "
+    "'\\n'";
+constexpr std::string_view kMissingValuesError =
+    "CSV format error - line is missing expected value(s).";
+constexpr std::string_view kTooManyValuesError =
+    "CSV format error - line has too many values.";
+
+bool contains(const std::vector<std::string_view>& fields, std::string_view f) {
+  return std::find(fields.begin(), fields.end(), f) != fields.end();
+}
+
+bool startsWith(std::string_view str, std::string_view prefix) {
+  return str.substr(0, prefix.size()) == prefix;
+}
+
+bool endsWith(std::string_view str, std::string_view suffix) {
+  return str.size() >= suffix.size() &&
+      str.substr(str.size() - suffix.size()) == suffix;
+}
+
+// The characters Python's str.isspace and the regex \S treat as whitespace
+bool isSpace(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r') || (c >= '\x1c' && c <= '\x1f');
+}
+
+std::string_view strip(std::string_view str) {
+  while (!str.empty() && isSpace(str.front())) {
+    str.remove_prefix(1);
+  }
+  while (!str.empty() && isSpace(str.back())) {
+    str.remove_suffix(1);
+  }
+  return str;
+}
+
+bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// ^[0-9]+$
+bool isInteger(std::string_view value) {
+  return !value.empty() && std::all_of(value.begin(), value.end(), isDigit);
+}
+
+// ^[0-9]{10}$
+bool isTimestamp(std::string_view value) {
+  return value.size() == 10 && isInteger(value);
+}
+
+// ^[A-Za-z0-9+/]+={0,2}$
+bool isBase64(std::string_view value) {
+  auto padding = value.find_last_not_of('=');
+  if (padding == std::string_view::npos || value.size() - padding - 1 > 2) {
+    return false;
+  }
+  auto body = value.substr(0, padding + 1);
+  return std::all_of(body.begin(), body.end(), [](char c) {
+    return isDigit(c) || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+        c == '+' || c == '/';
+  });
+}
+
+// A list such as `[abc, def]` of base64 values
+bool isBase64List(std::string_view value) {
+  if (value.size() < 2 || value.front() != '[' || value.back() != ']') {
+    return false;
+  }
+  auto inner = value.substr(1, value.size() - 2);
+  size_t pos = 0;
+  while (true) {
+    auto end = std::min(inner.find(',', pos), inner.size());
+    if (!isBase64(strip(inner.substr(pos, end - pos)))) {
+      return false;
+    }
+    if (end == inner.size()) {
+      return true;
+    }
+    pos = end + 1;
+  }
+}
+
+// Parses a value the way Python's int() does, saturating values which don't
+// fit an int64_t. Returns false for values int() would reject.
+bool parsePythonInt(std::string_view value, int64_t& parsed) {
+  value = strip(value);
+  bool negative = false;
+  if (!value.empty() && (value.front() == '+' || value.front() == '-')) {
+    negative = value.front() == '-';
+    value.remove_prefix(1);
+  }
+  if (value.empty() || !isDigit(value.front()) || !isDigit(value.back())) {
+    return false;
+  }
+  constexpr auto kMax = std::numeric_limits<int64_t>::max();
+  int64_t result = 0;
+  for (size_t i = 0; i < value.size(); ++i) {
+    auto c = value[i];
+    if (c == '_' && isDigit(value[i - 1]) && isDigit(value[i + 1])) {
+      continue;
+    }
+    if (!isDigit(c)) {
+      return false;
+    }
+    result = result > (kMax - (c - '0')) / 10 ? kMax : result * 10 + (c - '0');
+  }
+  parsed = negative ? -result : result;
+  return true;
+}
+
+std::string intError(std::string_view value) {
+  return "invalid literal for int() with base 10: '" + std::string{value} +
+      "'";
+}
+
+// Read-only mapping of a local file
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Failed to open " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Failed to stat " + path);
+    }
+    size_ = st.st_size;
+    if (size_ > 0) {
+      void* addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Failed to map " + path);
+      }
+      ::madvise(addr, size_, MADV_SEQUENTIAL);
+      data_ = static_cast<const char*>(addr);
+    }
+    ::close(fd);
+  }
+
+  ~MappedFile() {
+    if (data_ != nullptr) {
+      ::munmap(const_cast<char*>(data_), size_);
+    }
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  std::string_view contents() const {
+    return std::string_view(data_, size_);
+  }
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Whether a line, without its newline, passes VALID_LINE_ENDING_REGEX
+bool hasValidLineEnding(std::string_view line) {
+  return !line.empty() && !isSpace(line.back());
+}
+
+} // namespace
+
+void InputValidationCounts::merge(const InputValidationCounts& other) {
+  if (!error.empty()) {
+    return;
+  }
+  rowsProcessedCount += other.rowsProcessedCount;
+  for (auto& [field, count] : other.emptyCounts) {
+    emptyCounts[field] += count;
+  }
+  for (auto& [field, count] : other.formatErrorCounts) {
+    formatErrorCounts[field] += count;
+  }
+  for (auto& [field, count] : other.rangeErrorCounts) {
+    rangeErrorCounts[field] += count;
+  }
+  cohortIds.insert(other.cohortIds.begin(), other.cohortIds.end());
+  error = other.error;
+}
+
+folly::dynamic InputValidationCounts::toDynamic() const {
+  auto toObject = [](const std::map<std::string, uint64_t>& counts) {
+    auto object = folly::dynamic::object();
+    for (auto& [field, count] : counts) {
+      object[field] = count;
+    }
+    return object;
+  };
+  auto ids = folly::dynamic::array();
+  for (auto id : cohortIds) {
+    ids.push_back(id);
+  }
+  return folly::dynamic::object("rows_processed_count", rowsProcessedCount)(
+      "empty_counts", toObject(emptyCounts))(
+      "format_error_counts", toObject(formatErrorCounts))(
+      "range_error_counts", toObject(rangeErrorCounts))("cohort_ids", ids)(
+      "error", error);
+}
+
+InputDataValidator::InputDataValidator(
+    const std::vector<std::string>& header,
+    InputValidationOptions options)
+    : options_{options} {
+  for (auto& name : header) {
+    Column column;
+    column.field = startsWith(name, kIdFieldPrefix) ? std::string{kIdFieldPrefix}
+                                                    : name;
+    if (column.field == kIdFieldPrefix) {
+      column.format =
+          options_.enableForTee ? Format::kBase64List : Format::kBase64;
+    } else if (contains(kIntegerFields, column.field)) {
+      column.format = Format::kInteger;
+    } else if (contains(kTimestampFields, column.field)) {
+      column.format = Format::kTimestamp;
+    }
+    column.isTimestamp = endsWith(column.field, kTimestampSuffix);
+    column.isValue = contains(kValueFields, column.field);
+    column.isCohortId = startsWith(name, kCohortIdField);
+    columns_.push_back(std::move(column));
+  }
+}
+
+bool InputDataValidator::validateValue(
+    Column& column,
+    std::string_view value,
+    InputValidationCounts& counts) const {
+  bool formatted = true;
+  switch (column.format) {
+    case Format::kNone:
+      break;
+    case Format::kInteger:
+      formatted = isInteger(value);
+      break;
+    case Format::kTimestamp:
+      formatted = isTimestamp(value);
+      break;
+    case Format::kBase64:
+      formatted = isBase64(value);
+      break;
+    case Format::kBase64List:
+      formatted = isBase64List(value);
+      break;
+  }
+
+  int64_t parsed = 0;
+  if (strip(value).empty()) {
+    ++column.emptyCount;
+  } else if (!formatted) {
+    ++column.formatErrorCount;
+  } else if (column.isTimestamp) {
+    if (options_.startTimestamp != 0 || options_.endTimestamp != 0) {
+      if (!parsePythonInt(value, parsed)) {
+        counts.error = intError(value);
+        return false;
+      }
+      if (options_.startTimestamp != 0 && parsed < options_.startTimestamp) {
+        ++column.rangeErrorCount;
+      }
+      if (options_.endTimestamp != 0 && parsed > options_.endTimestamp) {
+        ++column.rangeErrorCount;
+      }
+    }
+  } else if (column.isValue) {
+    if (!parsePythonInt(value, parsed)) {
+      counts.error = intError(value);
+      return false;
+    }
+    if (parsed >= kIntegerMaxValue) {
+      ++column.rangeErrorCount;
+    }
+  }
+
+  if (column.isCohortId) {
+    if (!parsePythonInt(value, parsed)) {
+      counts.error = intError(value);
+      return false;
+    }
+    counts.cohortIds.insert(parsed);
+  }
+  return true;
+}
+
+void InputDataValidator::validateRow(
+    std::string_view row,
+    InputValidationCounts& counts) {
+  if (!hasValidLineEnding(row)) {
+    counts.error = kLineEndingError;
+    return;
+  }
+  splitCsvRow(row, values_);
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    if (i >= values_.size()) {
+      counts.error = kMissingValuesError;
+      return;
+    }
+    if (!validateValue(columns_[i], values_[i], counts)) {
+      return;
+    }
+  }
+  if (values_.size() > columns_.size()) {
+    counts.error = kTooManyValuesError;
+    return;
+  }
+  ++counts.rowsProcessedCount;
+}
+
+void InputDataValidator::addColumnCounts(InputValidationCounts& counts) const {
+  for (auto& column : columns_) {
+    if (column.emptyCount > 0) {
+      counts.emptyCounts[column.field] += column.emptyCount;
+    }
+    if (column.formatErrorCount > 0) {
+      counts.formatErrorCounts[column.field] += column.formatErrorCount;
+    }
+    if (column.rangeErrorCount > 0) {
+      counts.rangeErrorCounts[column.field] += column.rangeErrorCount;
+    }
+  }
+}
+
+void splitCsvRow(std::string_view row, std::vector<std::string>& values) {
+  size_t numValues = 0;
+  size_t pos = 0;
+  while (true) {
+    if (values.size() <= numValues) {
+      values.emplace_back();
+    }
+    auto& value = values[numValues++];
+    value.clear();
+    if (pos < row.size() && row[pos] == '"') {
+      ++pos;
+      while (pos < row.size()) {
+        auto quote = row.find('"', pos);
+        if (quote == std::string_view::npos) {
+          value.append(row.substr(pos));
+          pos = row.size();
+          break;
+        }
+        value.append(row.substr(pos, quote - pos));
+        pos = quote + 1;
+        if (pos < row.size() && row[pos] == '"') {
+          value += '"';
+          ++pos;
+        } else {
+          break;
+        }
+      }
+    }
+    auto end = std::min(row.find(',', pos), row.size());
+    value.append(row.substr(pos, end - pos));
+    if (end == row.size()) {
+      break;
+    }
+    pos = end + 1;
+  }
+  values.resize(numValues);
+}
+
+InputValidationCounts validateFile(
+    const std::string& path,
+    const InputValidationOptions& options,
+    size_t numThreads) {
+  MappedFile file{path};
+  auto contents = file.contents();
+  auto headerEnd = std::min(contents.find('\n'), contents.size());
+  auto headerLine = contents.substr(0, headerEnd);
+
+  InputValidationCounts counts;
+  if (!hasValidLineEnding(headerLine)) {
+    counts.error = kLineEndingError;
+    return counts;
+  }
+  std::vector<std::string> header;
+  splitCsvRow(headerLine, header);
+  auto rows = contents.substr(std::min(headerEnd + 1, contents.size()));
+
+  // Cut the rows into roughly equal byte ranges at line starts
+  numThreads = std::max<size_t>(numThreads, 1);
+  std::vector<std::string_view> chunks;
+  size_t chunkStart = 0;
+  for (size_t i = 1; i <= numThreads && chunkStart < rows.size(); ++i) {
+    auto chunkEnd = rows.size();
+    if (i < numThreads) {
+      auto target = std::max(chunkStart, i * rows.size() / numThreads);
+      auto newLine = rows.find('\n', target);
+      chunkEnd = newLine == std::string_view::npos ? rows.size() : newLine + 1;
+    }
+    chunks.push_back(rows.substr(chunkStart, chunkEnd - chunkStart));
+    chunkStart = chunkEnd;
+  }
+
+  std::vector<InputValidationCounts> chunkCounts(chunks.size());
+  {
+    folly::CPUThreadPoolExecutor executor(std::max<size_t>(chunks.size(), 1));
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      executor.add([&, i]() {
+        InputDataValidator validator{header, options};
+        auto chunk = chunks[i];
+        auto& chunkCount = chunkCounts[i];
+        size_t pos = 0;
+        while (pos < chunk.size() && chunkCount.error.empty()) {
+          auto newLine = std::min(chunk.find('\n', pos), chunk.size());
+          validator.validateRow(chunk.substr(pos, newLine - pos), chunkCount);
+          pos = newLine + 1;
+        }
+        validator.addColumnCounts(chunkCount);
+      });
+    }
+    executor.join();
+  }
+  for (auto& chunkCount : chunkCounts) {
+    counts.merge(chunkCount);
+  }
+  XLOG(INFO) << "Validated " << counts.rowsProcessedCount << " rows of "
+             << path << " on " << chunks.size() << " threads";
+  return counts;
+}
+
+} // namespace data_processing::input_validation
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <folly/dynamic.h>
+
+/*
+A native version of the row checks of the pc_pre_validation input data
+validator (fbpcs/pc_pre_validation/input_data_validator.py), which scans the
+rows of an input on several threads and reports the same counts the Python
+workers compute. The header itself is still validated by the Python layer,
+which only reads its first line.
+*/
+namespace data_processing::input_validation {
+
+struct InputValidationOptions {
+  // The range of valid timestamps, where 0 means no bound, as in the Python
+  // validator
+  int64_t startTimestamp = 0;
+  int64_t endTimestamp = 0;
+  // Whether id_ columns hold lists of ids, such as `[abc,def]`
+  bool enableForTee = false;
+};
+
+// The issues found in the rows of an input, keyed by field name. Every field
+// with the id_ prefix is counted as id_.
+struct InputValidationCounts {
+  uint64_t rowsProcessedCount = 0;
+  std::map<std::string, uint64_t> emptyCounts;
+  std::map<std::string, uint64_t> formatErrorCounts;
+  std::map<std::string, uint64_t> rangeErrorCounts;
+  std::set<int64_t> cohortIds;
+  // Why the input failed validation outright, or empty if it didn't. The
+  // counts of an input which failed are incomplete.
+  std::string error;
+
+  // Adds the counts of rows which come after the rows of this one
+  void merge(const InputValidationCounts& other);
+
+  // The counts as the JSON object read by input_data_validator.py
+  folly::dynamic toDynamic() const;
+};
+
+class InputDataValidator {
+ public:
+  InputDataValidator(
+      const std::vector<std::string>& header,
+      InputValidationOptions options);
+
+  // Validates a row given without its trailing newline, adding its issues to
+  // counts. Stops at the first row which fails validation outright, setting
+  // counts.error.
+  void validateRow(std::string_view row, InputValidationCounts& counts);
+
+  // Adds the counts of every column to counts by field name, once all the
+  // rows were validated
+  void addColumnCounts(InputValidationCounts& counts) const;
+
+ private:
+  enum class Format { kNone, kInteger, kTimestamp, kBase64, kBase64List };
+
+  struct Column {
+    std::string field;
+    Format format = Format::kNone;
+    bool isTimestamp = false;
+    bool isValue = false;
+    bool isCohortId = false;
+    uint64_t emptyCount = 0;
+    uint64_t formatErrorCount = 0;
+    uint64_t rangeErrorCount = 0;
+  };
+
+  // Counts the issues of one value, returning false if it fails the whole
+  // input
+  bool validateValue(
+      Column& column,
+      std::string_view value,
+      InputValidationCounts& counts) const;
+
+  std::vector<Column> columns_;
+  InputValidationOptions options_;
+  std::vector<std::string> values_;
+};
+
+// Splits a csv row into values the way Python's csv module does for these
+// inputs: a value starting with a double quote runs to its closing quote, in
+// which two double quotes stand for one
+void splitCsvRow(std::string_view row, std::vector<std::string>& values);
+
+// Validates the header line ending and every row of a local file, splitting
+// its rows into numThreads chunks which are validated concurrently
+InputValidationCounts validateFile(
+    const std::string& path,
+    const InputValidationOptions& options,
+    size_t numThreads);
+
+} // namespace data_processing::input_validation
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include <gflags/gflags.h>
+
+#include "folly/init/Init.h"
+#include "folly/json.h"
+
+#include "fbpcs/data_processing/input_validation/InputDataValidator.h"
+
+DEFINE_string(input_path, "", "Path to the local input CSV (with header)");
+DEFINE_string(
+    output_path,
+    "",
+    "Path where the validation counts are written as JSON, or stdout if empty");
+DEFINE_int64(
+    start_timestamp,
+    0,
+    "Timestamps before this one are out of range, unless it is 0");
+DEFINE_int64(
+    end_timestamp,
+    0,
+    "Timestamps after this one are out of range, unless it is 0");
+DEFINE_bool(
+    enable_for_tee,
+    false,
+    "Whether the id_ columns hold lists of ids, such as [abc,def]");
+DEFINE_int32(
+    num_threads,
+    0,
+    "Number of threads validating the input rows, or one per core if 0");
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  data_processing::input_validation::InputValidationOptions options;
+  options.startTimestamp = FLAGS_start_timestamp;
+  options.endTimestamp = FLAGS_end_timestamp;
+  options.enableForTee = FLAGS_enable_for_tee;
+  size_t numThreads = FLAGS_num_threads > 0
+      ? FLAGS_num_threads
+      : std::max(std::thread::hardware_concurrency(), 1u);
+
+  auto counts = data_processing::input_validation::validateFile(
+      FLAGS_input_path, options, numThreads);
+  auto json = folly::toJson(counts.toDynamic());
+  if (FLAGS_output_path.empty()) {
+    std::cout << json << std::endl;
+  } else {
+    std::ofstream out{FLAGS_output_path};
+    out << json << std::endl;
+    if (!out) {
+      throw std::runtime_error("Failed to write " + FLAGS_output_path);
+    }
+  }
+  return 0;
+}
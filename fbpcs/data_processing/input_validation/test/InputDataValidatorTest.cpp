@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "fbpcs/data_processing/input_validation/InputDataValidator.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <folly/Random.h>
+#include <gtest/gtest.h>
+
+using namespace ::data_processing::input_validation;
+
+class InputDataValidatorTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = std::filesystem::temp_directory_path() /
+        ("InputDataValidatorTest_" + std::to_string(folly::Random::rand32()));
+  }
+
+  void TearDown() override {
+    std::filesystem::remove(path_);
+  }
+
+  InputValidationCounts validate(
+      const std::string& contents,
+      InputValidationOptions options = {},
+      size_t numThreads = 1) {
+    {
+      std::ofstream out{path_};
+      out << contents;
+    }
+    return validateFile(path_, options, numThreads);
+  }
+
+  std::string path_;
+};
+
+TEST(InputDataValidatorSplitTest, TestSplitCsvRow) {
+  std::vector<std::string> values;
+  splitCsvRow("a,,b c", values);
+  EXPECT_EQ(values, std::vector<std::string>({"a", "", "b c"}));
+  splitCsvRow("\"[a,b]\",\"say \"\"hi\"\"\"", values);
+  EXPECT_EQ(values, std::vector<std::string>({"[a,b]", "say \"hi\""}));
+  // Quotes only start a quoted value at its beginning
+  splitCsvRow("a\"b,\"c\"d", values);
+  EXPECT_EQ(values, std::vector<std::string>({"a\"b", "cd"}));
+  splitCsvRow("", values);
+  EXPECT_EQ(values, std::vector<std::string>({""}));
+}
+
+TEST_F(InputDataValidatorTest, TestCounts) {
+  auto counts = validate(
+      "id_email,id_phone,conversion_timestamp,conversion_value,cohort_id\n"
+      "abc=,,1600000000,100,0\n"
+      "a*c,def,16000,2147483647,1\n"
+      " ,ghi==,1700000000,x,1\n");
+  EXPECT_EQ(counts.error, "");
+  EXPECT_EQ(counts.rowsProcessedCount, 3);
+  EXPECT_EQ(
+      counts.emptyCounts, (std::map<std::string, uint64_t>{{"id_", 2}}));
+  EXPECT_EQ(
+      counts.formatErrorCounts,
+      (std::map<std::string, uint64_t>{
+          {"id_", 1}, {"conversion_timestamp", 1}, {"conversion_value", 1}}));
+  EXPECT_EQ(
+      counts.rangeErrorCounts,
+      (std::map<std::string, uint64_t>{{"conversion_value", 1}}));
+  EXPECT_EQ(counts.cohortIds, (std::set<int64_t>{0, 1}));
+}
+
+TEST_F(InputDataValidatorTest, TestTimestampRange) {
+  InputValidationOptions options;
+  options.startTimestamp = 1600000000;
+  auto counts = validate(
+      "id_,event_timestamp,timestamp\n"
+      "abc,1500000000,1700000000\n"
+      "abc,1600000000,1599999999\n",
+      options);
+  EXPECT_EQ(
+      counts.rangeErrorCounts,
+      (std::map<std::string, uint64_t>{
+          {"event_timestamp", 1}, {"timestamp", 1}}));
+
+  options.endTimestamp = 1650000000;
+  counts = validate("id_,event_timestamp\nabc,1700000000\n", options);
+  EXPECT_EQ(
+      counts.rangeErrorCounts,
+      (std::map<std::string, uint64_t>{{"event_timestamp", 1}}));
+}
+
+TEST_F(InputDataValidatorTest, TestIdListsForTee) {
+  InputValidationOptions options;
+  options.enableForTee = true;
+  auto counts = validate(
+      "id_,value\n"
+      "\"[abc, def=]\",1\n"
+      "abc,1\n"
+      "\"[abc,]\",1\n",
+      options);
+  EXPECT_EQ(counts.rowsProcessedCount, 3);
+  EXPECT_EQ(
+      counts.formatErrorCounts, (std::map<std::string, uint64_t>{{"id_", 2}}));
+}
+
+TEST_F(InputDataValidatorTest, TestErrors) {
+  EXPECT_EQ(
+      validate("id_,value\r\nabc,1\n").error,
+      "Detected an unexpected line ending. The only supported line ending is "
+      "'\\n'");
+  EXPECT_EQ(
+      validate("id_,value\nabc,1 \n").error,
+      "Detected an unexpected line ending. The only supported line ending is "
+      "'\\n'");
+  EXPECT_EQ(
+      validate("id_,value\nabc\n").error,
+      "CSV format error - line is missing expected value(s).");
+  EXPECT_EQ(
+      validate("id_,value\nabc,1,2\n").error,
+      "CSV format error - line has too many values.");
+  EXPECT_EQ(
+      validate("id_,cohort_id\nabc,x\n").error,
+      "invalid literal for int() with base 10: 'x'");
+  // A header with no rows is valid
+  EXPECT_EQ(validate("id_,value\n").error, "");
+}
+
+TEST_F(InputDataValidatorTest, TestThreadsGiveSameCounts) {
+  std::string contents = "id_,conversion_value,cohort_id\n";
+  for (int i = 0; i < 1000; ++i) {
+    contents += (i % 7 == 0 ? "" : "abc") + std::string{","} +
+        (i % 5 == 0 ? "x" : std::to_string(i)) + "," + std::to_string(i % 3) +
+        "\n";
+  }
+  auto expected = validate(contents);
+  for (size_t numThreads : {2, 3, 16, 2000}) {
+    auto counts = validate(contents, {}, numThreads);
+    EXPECT_EQ(counts.rowsProcessedCount, 1000);
+    EXPECT_EQ(counts.emptyCounts, expected.emptyCounts);
+    EXPECT_EQ(counts.formatErrorCounts, expected.formatErrorCounts);
+    EXPECT_EQ(counts.cohortIds, expected.cohortIds);
+  }
+
+  // The first error in the file is reported
+  contents += "abc,1\n";
+  contents.insert(contents.find('\n') + 1, "abc,1,0,0\n");
+  EXPECT_EQ(
+      validate(contents, {}, 4).error,
+      "CSV format error - line has too many values.");
+}
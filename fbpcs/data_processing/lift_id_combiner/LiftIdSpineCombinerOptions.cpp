@@ -9,7 +9,11 @@
 
 #include "LiftIdSpineCombinerOptions.h"
 
-DEFINE_string(spine_path, "", "File path which contains the identity spine");
+DEFINE_string(
+    spine_path,
+    "",
+    "File path which contains the identity spine. For MR-PID, also a local "
+    "directory of part files, which are read in parallel");
 DEFINE_string(data_path, "", "File path which contains the data file");
 DEFINE_string(
     output_path,
@@ -29,6 +33,14 @@ DEFINE_string(
     "sort",
     "Sorting strategy selected for the output data - options: (sort|keep_original)");
 DEFINE_int32(max_id_column_cnt, 1, "Maximum number of id columns to use as id");
+DEFINE_int32(
+    num_threads,
+    1,
+    "Number of PID ranges of the id swap output to combine in parallel");
+DEFINE_string(
+    output_format,
+    "csv",
+    "Format of the combined output - options: (csv|row_group)");
 DEFINE_string(protocol_type, "PID", "protocol type");
 DEFINE_string(
     run_id,
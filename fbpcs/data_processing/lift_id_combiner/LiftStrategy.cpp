@@ -7,17 +7,15 @@
 
 #include "fbpcs/data_processing/lift_id_combiner/LiftStrategy.h"
 
-#include <folly/Random.h>
 #include <folly/logging/xlog.h>
 
-#include "fbpcs/data_processing/common/FilepathHelpers.h"
-#include "fbpcs/data_processing/id_combiner/AddPaddingToCols.h"
+#include "fbpcs/data_processing/id_combiner/CombineGroups.h"
 #include "fbpcs/data_processing/id_combiner/DataPreparationHelpers.h"
 #include "fbpcs/data_processing/id_combiner/DataValidation.h"
-#include "fbpcs/data_processing/id_combiner/GroupBy.h"
 #include "fbpcs/data_processing/id_combiner/IdSwapMultiKey.h"
+#include "fbpcs/data_processing/id_combiner/OutputFormat.h"
+#include "fbpcs/data_processing/id_combiner/PartitionedCombine.h"
 #include "fbpcs/data_processing/id_combiner/SortIds.h"
-#include "fbpcs/data_processing/id_combiner/SortIntegralValues.h"
 #include "fbpcs/data_processing/lift_id_combiner/LiftIdSpineCombinerOptions.h"
 
 namespace pid::combiner {
@@ -28,15 +26,33 @@ void LiftStrategy::aggregate(
     std::string tmpDirectory,
     std::string sortStrategy) {
   std::filesystem::path tempDir{tmpDirectory};
-  // Get a random ID to avoid potential name collisions if multiple
-  // runs at the same time point to the same input file
-  auto randomId = std::to_string(folly::Random::secureRand64());
-  std::string tmpFilename = randomId + "_" +
-      private_lift::filepath_helpers::getBaseFilename(outputPath);
-  auto tmpFilepath = (tempDir / tmpFilename);
-  XLOG(INFO) << "Writing temporary file to " << tmpFilepath;
-  std::ofstream outFile{tmpFilepath};
+  writeOutputFile(
+      [&](std::ostream& outFile) {
+        // Combine PID ranges of the id swap output in parallel if requested.
+        // The publisher rows are not grouped, so only the partner rows of an
+        // id have to stay together
+        pid::combiner::combinePartitioned(
+            idSwapOutFile,
+            outFile,
+            FLAGS_num_threads,
+            sortStrategy == "sort",
+            !isPublisherDataset,
+            [&](std::istream& in, std::ostream& out) {
+              combineIdSwapOutput(
+                  in, out, isPublisherDataset, tempDir, sortStrategy);
+            });
+      },
+      outputPath,
+      FLAGS_output_format,
+      tempDir);
+}
 
+void LiftStrategy::combineIdSwapOutput(
+    std::istream& idSwapOutFile,
+    std::ostream& outFile,
+    bool isPublisherDataset,
+    const std::filesystem::path& tempDir,
+    const std::string& sortStrategy) {
   std::string idSwapOutFileHeaderLine;
   getline(idSwapOutFile, idSwapOutFileHeaderLine);
   std::vector<std::string> idSwapOutFileHeader;
@@ -53,11 +69,14 @@ void LiftStrategy::aggregate(
   if (isPublisherDataset) {
     // There is no grouping for publisher side,
     // so we can do ID sorting directly.
+    // With keep_original the id swap output is read as is, rather than
+    // copied into another stream first
     std::stringstream sortedOutFile;
+    std::istream* sortedIn = &sortedOutFile;
     if (sortStrategy == "sort") {
-      pid::combiner::sortIds(idSwapOutFile, sortedOutFile);
+      pid::combiner::sortIds(idSwapOutFile, sortedOutFile, tempDir);
     } else if (sortStrategy == "keep_original") {
-      sortedOutFile << idSwapOutFile.rdbuf();
+      sortedIn = &idSwapOutFile;
     } else {
       XLOG(FATAL) << "Invalid sort strategy '" << sortStrategy
                   << "'. Expected 'sort' or 'keep_original'.";
@@ -74,8 +93,8 @@ void LiftStrategy::aggregate(
     // add opportunity value.
     // if timestamp is 0, opportunity is 0
     // if timestamp is not 0, opportunity is 1
-    getline(sortedOutFile, line); // skip header
-    while (getline(sortedOutFile, line)) {
+    getline(*sortedIn, line); // skip header
+    while (getline(*sortedIn, line)) {
       std::vector<std::string> row;
       folly::split(',', line, row);
       if (row.at(timestampIndex) == "0") {
@@ -100,68 +119,30 @@ void LiftStrategy::aggregate(
         std::remove(aggregatedCols.begin(), aggregatedCols.end(), "cohort_id"),
         aggregatedCols.end());
 
-    std::stringstream groupByOutFile;
-    std::stringstream groupByUnsortedOutFile;
-    if (sortStrategy == "sort") {
-      pid::combiner::groupBy(
-          idSwapOutFile, "id_", aggregatedCols, groupByUnsortedOutFile);
-      pid::combiner::sortIds(groupByUnsortedOutFile, groupByOutFile);
-    } else if (sortStrategy == "keep_original") {
-      pid::combiner::groupBy(
-          idSwapOutFile, "id_", aggregatedCols, groupByOutFile);
-    } else {
+    if (sortStrategy != "sort" && sortStrategy != "keep_original") {
       XLOG(FATAL) << "Invalid sort strategy '" << sortStrategy
                   << "'. Expected 'sort' or 'keep_original'.";
     }
 
-    // add "s" to all aggregated column headers
-    std::stringstream renamedColsFile;
-    std::vector<std::string> renamedColsVec = idSwapOutFileHeader;
-    for (auto& colName : aggregatedCols) {
-      auto it = find(renamedColsVec.begin(), renamedColsVec.end(), colName);
-      colName.append("s");
-      *it = colName;
-    }
-    renamedColsFile << combiner::vectorToString(renamedColsVec) << "\n";
-    getline(groupByOutFile, line);
-    renamedColsFile << groupByOutFile.rdbuf();
-
-    // define padding size and add padding to aggregated columns
-    std::vector<int32_t> colPaddingSize(
+    // Group by id_, sort by id_ if requested, pad the aggregated columns,
+    // ensure conversions are sorted by timestamp and pluralize the aggregated
+    // column headers, all in a single pass
+    pid::combiner::CombineGroupsOptions options;
+    options.columnsToAggregate = aggregatedCols;
+    options.sortById = sortStrategy == "sort";
+    options.padSizePerCol = std::vector<int32_t>(
         aggregatedCols.size(), FLAGS_multi_conversion_limit);
-    std::stringstream paddingOutFile;
-
-    pid::combiner::addPaddingToCols(
-        renamedColsFile, aggregatedCols, colPaddingSize, true, paddingOutFile);
-
-    // ensure conversions are sorted by timestamp
-    std::stringstream sortingOutFile;
-    std::string sortBy = "event_timestamps";
-    std::vector<std::string> listColumns = {"event_timestamps"};
+    options.enforceMax = true;
+    options.sortBy = "event_timestamp";
+    options.listColumns = {"event_timestamp"};
     // It's possible that this is a "valueless" run
-    // Also remember that we need to search for the *original* header name
-    // since we have pluralized it in a previous step
     if (std::find(
             idSwapOutFileHeader.begin(), idSwapOutFileHeader.end(), "value") !=
         idSwapOutFileHeader.end()) {
-      listColumns.push_back("values");
+      options.listColumns.push_back("value");
     }
-    pid::combiner::sortIntegralValues(
-        paddingOutFile, sortingOutFile, sortBy, listColumns);
-
-    outFile << sortingOutFile.rdbuf();
-  }
-
-  XLOG(INFO) << "Now copying combined data to final output path";
-  outFile.close();
-  if (outputPath != tmpFilepath) {
-    // The only time this wouldn't be the case is if tmpFilepath is somehow
-    // the final output location (which is possible if the final output is in
-    // the same location as our tmpDirectory)
-    // TODO: This should never happen if we actually use a tmp filename
-    XLOG(INFO) << "Writing " << tmpFilepath << " -> " << outputPath;
-    fbpcf::io::FileIOWrappers::transferFileInParts(tmpFilepath, outputPath);
-    std::remove(tmpFilepath.c_str());
+    options.columnsToPluralize = aggregatedCols;
+    pid::combiner::combineGroups(idSwapOutFile, outFile, options);
   }
 }
 
@@ -70,6 +70,22 @@ class LiftStrategy {
    **/
   virtual FileMetaData processHeader(
       const std::shared_ptr<fbpcf::io::BufferedReader>& file);
+  /**
+   * combineIdSwapOutput() will run the aggregation steps of aggregate() on
+   * either the whole id swap output or on one PID range of it.
+   *
+   * @param idSwapOutFile id swap output, starting with its header
+   * @param outFile the stream that stores the aggregated result
+   * @param isPublisherDataset file type. True is Publisher, false is partner
+   * @param tempDir the temp directory for the files spilled while sorting
+   * @param sortStrategy sortStrategy to sort records
+   **/
+  virtual void combineIdSwapOutput(
+      std::istream& idSwapOutFile,
+      std::ostream& outFile,
+      bool isPublisherDataset,
+      const std::filesystem::path& tempDir,
+      const std::string& sortStrategy);
   virtual ~LiftStrategy() {}
   /**
    * run() will execute different steps according to differnt id_combiner
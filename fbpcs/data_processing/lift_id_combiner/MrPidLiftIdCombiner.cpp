@@ -17,6 +17,7 @@
 #include <ostream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -27,7 +28,9 @@
 #include "fbpcs/data_processing/common/FilepathHelpers.h"
 #include "fbpcs/data_processing/id_combiner/DataPreparationHelpers.h"
 #include "fbpcs/data_processing/id_combiner/IdSwapMultiKey.h"
+#include "fbpcs/data_processing/id_combiner/SpineParts.h"
 #include "fbpcs/data_processing/lift_id_combiner/LiftIdSpineCombinerOptions.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
 
 namespace pid::combiner {
 MrPidLiftIdCombiner::MrPidLiftIdCombiner(
@@ -38,6 +41,7 @@ MrPidLiftIdCombiner::MrPidLiftIdCombiner(
     int maxIdColumnCnt,
     std::string protocolType)
     : spineIdFilePath(spineIdFilePath),
+      spineParts(getSpineParts(spineIdFilePath)),
       tmpDirectory(tmpDirectory),
       sortStrategy(sortStrategy),
       maxIdColumnCnt(maxIdColumnCnt),
@@ -49,7 +53,9 @@ MrPidLiftIdCombiner::MrPidLiftIdCombiner(
              << ", max_id_column_cnt: " << maxIdColumnCnt
              << ", protocol_type: " << protocolType;
 
-  auto spineReader = std::make_unique<fbpcf::io::FileReader>(FLAGS_spine_path);
+  // The header is read from the first part
+  auto spineReader =
+      private_measurement::compressed_io::makeFileReader(spineParts.front());
   spineIdFile =
       std::make_shared<fbpcf::io::BufferedReader>(std::move(spineReader));
 }
@@ -59,13 +65,17 @@ MrPidLiftIdCombiner::~MrPidLiftIdCombiner() {
 }
 
 std::stringstream MrPidLiftIdCombiner::idSwap(FileMetaData meta) {
-  auto spineReader = std::make_unique<fbpcf::io::FileReader>(spineIdFilePath);
-  auto spineIdFileDup =
-      std::make_shared<fbpcf::io::BufferedReader>(std::move(spineReader));
-
   std::stringstream idSwapOutFile;
 
   if (meta.isPublisherDataset) {
+    // The rows of every part of the spine, which are read twice
+    std::stringstream spineRows;
+    readSpineParts(
+        spineParts,
+        meta.headerLine,
+        spineRows,
+        std::thread::hardware_concurrency());
+
     const std::string kCommaSplitRegex = ",";
     const std::string kIdColumnPrefix = "id_";
     std::vector<std::string> header;
@@ -84,8 +94,8 @@ std::stringstream MrPidLiftIdCombiner::idSwap(FileMetaData meta) {
     header.insert(header.begin(), "id_");
 
     idSwapOutFile << vectorToString(header) << "\n";
-    while (!spineIdFile->eof()) {
-      auto line = spineIdFile->readLine();
+    std::string line;
+    while (getline(spineRows, line)) {
       std::vector<std::string> rowVec;
       folly::split(kCommaSplitRegex, line, rowVec);
       // for each row in spine id,
@@ -96,12 +106,12 @@ std::stringstream MrPidLiftIdCombiner::idSwap(FileMetaData meta) {
 
       pidToDataMap[privId].push_back(rowVec);
     }
+    auto aggregations = getLiftAggregations(header);
     std::string row;
     std::unordered_set<std::string> pidVisited;
-    // skip the header
-    spineIdFileDup->readLine();
-    while (!spineIdFileDup->eof()) {
-      row = spineIdFileDup->readLine();
+    spineRows.clear();
+    spineRows.seekg(0);
+    while (getline(spineRows, row)) {
       std::vector<std::string> cols;
       folly::split(kCommaSplitRegex, row, cols);
       // get private id from position idx
@@ -114,7 +124,7 @@ std::stringstream MrPidLiftIdCombiner::idSwap(FileMetaData meta) {
         // For publisher lift dataset, duplicates would result in failure.
         // We are aggregating columns here.
         if (dRows.size() > 1) {
-          aggregateLiftNonIdColumns(header, dRows);
+          aggregateLiftNonIdColumns(aggregations, dRows);
         }
         pidVisited.insert(privId);
         if (dRows.size() > 0) {
@@ -122,13 +132,13 @@ std::stringstream MrPidLiftIdCombiner::idSwap(FileMetaData meta) {
         }
       }
     }
-    spineIdFileDup->close();
   } else {
     idSwapOutFile << meta.headerLine << "\n";
-    while (!spineIdFile->eof()) {
-      auto spineRow = spineIdFile->readLine();
-      idSwapOutFile << spineRow << "\n";
-    }
+    readSpineParts(
+        spineParts,
+        meta.headerLine,
+        idSwapOutFile,
+        std::thread::hardware_concurrency());
   }
 
   return idSwapOutFile;
@@ -24,6 +24,8 @@ namespace pid::combiner {
 class MrPidLiftIdCombiner : public LiftStrategy {
   std::shared_ptr<fbpcf::io::BufferedReader> spineIdFile;
   std::string spineIdFilePath;
+  // The part files of the spine, or just the spine file
+  std::vector<std::string> spineParts;
   std::string tmpDirectory;
   std::string outputStr;
   std::string sortStrategy;
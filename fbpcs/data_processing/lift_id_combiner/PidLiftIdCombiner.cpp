@@ -25,6 +25,7 @@
 #include "fbpcs/data_processing/id_combiner/DataPreparationHelpers.h"
 #include "fbpcs/data_processing/id_combiner/IdSwapMultiKey.h"
 #include "fbpcs/data_processing/lift_id_combiner/LiftIdSpineCombinerOptions.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
 
 namespace pid::combiner {
 PidLiftIdCombiner::PidLiftIdCombiner(
@@ -48,8 +49,10 @@ PidLiftIdCombiner::PidLiftIdCombiner(
              << ", max_id_column_cnt: " << maxIdColumnCnt
              << ", protocol_type: " << protocolType;
 
-  auto dataReader = std::make_unique<fbpcf::io::FileReader>(dataPath);
-  auto spineReader = std::make_unique<fbpcf::io::FileReader>(spineIdFilePath);
+  auto dataReader =
+      private_measurement::compressed_io::makeFileReader(dataPath);
+  auto spineReader =
+      private_measurement::compressed_io::makeFileReader(spineIdFilePath);
   dataFile = std::make_shared<fbpcf::io::BufferedReader>(std::move(dataReader));
   spineIdFile =
       std::make_shared<fbpcf::io::BufferedReader>(std::move(spineReader));
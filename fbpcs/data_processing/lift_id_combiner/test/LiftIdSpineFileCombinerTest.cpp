@@ -284,6 +284,28 @@ TEST_F(LiftIdSpineFileCombinerTest, ValidSortedSpinePublisherWithDup) {
   runTest(dataInput, spineInput, expectedOutput);
 }
 
+TEST_F(LiftIdSpineFileCombinerTest, ValidSortedSpinePublisherWithThreads) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_num_threads = 3;
+  FLAGS_sort_strategy = "sort";
+  std::vector<std::string> dataInput = {
+      "id_,opportunity_timestamp,test_flag",
+      "aaa,100,1",
+      "bbb,150,0",
+      "ccc,200,0"};
+  std::vector<std::string> spineInput = {
+      "1,aaa", "2,", "3,bbb", "10,ccc", "100,", "123,"};
+  std::vector<std::string> expectedOutput = {
+      "id_,opportunity_timestamp,opportunity,test_flag",
+      "1,100,1,1",
+      "10,200,1,0",
+      "100,0,0,0",
+      "123,0,0,0",
+      "2,0,0,0",
+      "3,150,1,0"};
+  runTest(dataInput, spineInput, expectedOutput);
+}
+
 TEST_F(LiftIdSpineFileCombinerTest, ValidMrPidSortedSpinePublisher) {
   std::vector<std::string> dataInput = {};
   std::vector<std::string> spineInput = {
@@ -332,6 +354,32 @@ TEST_F(LiftIdSpineFileCombinerTest, ValidSpinePartner) {
   runTest(dataInput, spineInput, expectedOutput);
 }
 
+// Same as ValidSpinePartner, with the PID ranges combined on several threads
+TEST_F(LiftIdSpineFileCombinerTest, ValidSpinePartnerWithThreads) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_num_threads = 4;
+  FLAGS_sort_strategy = "sort";
+  FLAGS_multi_conversion_limit = 4;
+  std::vector<std::string> dataInput = {
+      "id_,event_timestamp,value",
+      "123,125,100",
+      "111,200,200",
+      "222,375,300",
+      "123,150,50",
+      "333,400,400"};
+  std::vector<std::string> spineInput = {
+      "1,123", "2,", "10,111", "DDDD,", "EEEE,222", "FFFF,333"};
+  std::vector<std::string> expectedOutput = {
+      "id_,event_timestamps,values",
+      "1,[0,0,125,150],[0,0,100,50]",
+      "10,[0,0,0,200],[0,0,0,200]",
+      "2,[0,0,0,0],[0,0,0,0]",
+      "DDDD,[0,0,0,0],[0,0,0,0]",
+      "EEEE,[0,0,0,375],[0,0,0,300]",
+      "FFFF,[0,0,0,400],[0,0,0,400]"};
+  runTest(dataInput, spineInput, expectedOutput);
+}
+
 // Valid spine with some amount of overlap for partner
 // No opp_flag flag needed at the output level
 TEST_F(LiftIdSpineFileCombinerTest, ValidMrPidSpinePartner) {
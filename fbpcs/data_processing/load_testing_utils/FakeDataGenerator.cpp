@@ -8,77 +8,234 @@
 #include "fbpcs/data_processing/load_testing_utils/FakeDataGenerator.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
 #include <random>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
-static std::string genIdFor(int64_t n) {
+// Rows generated before they are written to the output file at once
+static constexpr int64_t kRowsPerWrite = 4096;
+
+static void appendIdFor(int64_t n, bool shouldUseComplexIds, std::string& out) {
   auto c = std::to_string(n);
+  if (!shouldUseComplexIds) {
+    out += c;
+    return;
+  }
   // I'm too lazy to do something better
   // and md5 is a PITA without pulling in openssl
-  return "a1" + c + "b2c3" + c + "d4" + c + "e5f6";
+  out += "a1";
+  out += c;
+  out += "b2c3";
+  out += c;
+  out += "d4";
+  out += c;
+  out += "e5f6";
+}
+
+FakeDataGenerator::FakeDataGenerator(
+    FakeDataGeneratorParams params,
+    uint32_t seed)
+    : params_{params},
+      r_{seed},
+      valueDist_{params.minValue, params.maxValue},
+      tsDist_{params.minTs, params.maxTs},
+      n_{0} {
+  static const std::unordered_map<std::string, Column> kColumns{
+      {"id_", Column::Id},
+      {"opportunity_timestamp", Column::OpportunityTimestamp},
+      {"test_flag", Column::TestFlag},
+      {"num_impressions", Column::NumImpressions},
+      {"num_clicks", Column::NumClicks},
+      {"total_spend", Column::TotalSpend},
+      {"breakdown_id", Column::BreakdownId},
+      {"event_timestamp", Column::EventTimestamp},
+      {"value", Column::Value},
+      {"cohort_id", Column::CohortId},
+  };
+  for (const auto& col : params_.header) {
+    auto column = kColumns.find(col);
+    if (column == kColumns.end()) {
+      throw std::invalid_argument("Unknown fake data column '" + col + "'");
+    }
+    columns_.push_back(column->second);
+  }
 }
 
 std::string FakeDataGenerator::genOneRow() {
-  std::uniform_real_distribution<double> realDist{0, 1};
-  std::uniform_int_distribution<int8_t> binaryDist{0, 1};
-  // Used for impressions and clicks
-  std::uniform_int_distribution<int64_t> engagementDist{0, 10};
-  std::uniform_int_distribution<int64_t> valueDist{
-      params_.minValue, params_.maxValue};
-  std::uniform_int_distribution<int64_t> tsDist{params_.minTs, params_.maxTs};
+  std::string res;
+  if (appendRow(n_, res)) {
+    ++n_;
+  }
+  return res;
+}
 
+bool FakeDataGenerator::drawIsMatched() {
+  return realDist_(r_) < params_.matchRate;
+}
+
+bool FakeDataGenerator::appendRow(int64_t idNumber, std::string& out) {
   // Shared stuff
-  auto id = params_.shouldUseComplexIds ? genIdFor(n_) : std::to_string(n_);
-  auto groupId = binaryDist(r_);
+  auto groupId = binaryDist_(r_);
 
   // Publisher stuff
-  auto hasOpp = realDist(r_) < params_.opportunityRate ? 1 : 0;
-  auto oppTs = hasOpp * tsDist(r_);
-  auto isTest = hasOpp && realDist(r_) < params_.testRate ? 1 : 0;
+  auto hasOpp = realDist_(r_) < params_.opportunityRate ? 1 : 0;
+  auto oppTs = hasOpp * tsDist_(r_);
+  auto isTest = hasOpp && realDist_(r_) < params_.testRate ? 1 : 0;
   // Engagement
-  auto impressions = isTest * engagementDist(r_);
-  auto clicks = std::min(impressions, engagementDist(r_));
-  auto spend = isTest * valueDist(r_);
+  auto impressions = isTest * engagementDist_(r_);
+  auto clicks = std::min(impressions, engagementDist_(r_));
+  auto spend = isTest * valueDist_(r_);
 
   // Partner stuff
-  auto hasPurchase = realDist(r_) < params_.purchaseRate ? 1 : 0;
-  auto eventTs = hasPurchase * tsDist(r_);
-  auto value = hasPurchase * valueDist(r_);
+  auto hasPurchase = realDist_(r_) < params_.purchaseRate ? 1 : 0;
+  auto eventTs = hasPurchase * tsDist_(r_);
+  auto value = hasPurchase * valueDist_(r_);
 
   // If no opp as publisher, useless row
   if (!hasOpp && params_.role == Role::Publisher) {
-    return "";
+    return false;
   }
 
   // If no purchase as partner, useless row
   if (!hasPurchase && params_.role == Role::Partner) {
-    return "";
+    return false;
   }
 
-  std::string res;
-  std::unordered_map<std::string, std::string> m{
-      {"id_", id},
-      {"opportunity_timestamp", std::to_string(oppTs)},
-      {"test_flag", std::to_string(isTest)},
-      {"num_impressions", std::to_string(impressions)},
-      {"num_clicks", std::to_string(clicks)},
-      {"total_spend", std::to_string(spend)},
-      {"breakdown_id", std::to_string(groupId)},
-      {"event_timestamp", std::to_string(eventTs)},
-      {"value", std::to_string(value)},
-      {"cohort_id", std::to_string(groupId)},
-  };
+  for (std::size_t i = 0; i < columns_.size(); ++i) {
+    if (i > 0) {
+      out += ',';
+    }
+    switch (columns_[i]) {
+      case Column::Id:
+        appendIdFor(idNumber, params_.shouldUseComplexIds, out);
+        break;
+      case Column::OpportunityTimestamp:
+        out += std::to_string(oppTs);
+        break;
+      case Column::TestFlag:
+        out += std::to_string(isTest);
+        break;
+      case Column::NumImpressions:
+        out += std::to_string(impressions);
+        break;
+      case Column::NumClicks:
+        out += std::to_string(clicks);
+        break;
+      case Column::TotalSpend:
+        out += std::to_string(spend);
+        break;
+      case Column::BreakdownId:
+      case Column::CohortId:
+        out += std::to_string(groupId);
+        break;
+      case Column::EventTimestamp:
+        out += std::to_string(eventTs);
+        break;
+      case Column::Value:
+        out += std::to_string(value);
+        break;
+    }
+  }
+  return true;
+}
 
-  for (const auto& col : params_.header) {
-    res += m.at(col);
-    res += ',';
+int64_t writeFakeDataFiles(
+    const FakeDataGeneratorParams& params,
+    const std::vector<std::string>& outputPaths,
+    int64_t numRows,
+    uint32_t seed,
+    int32_t numThreads,
+    int64_t logEveryN) {
+  int64_t numFiles = outputPaths.size();
+  std::string headerLine;
+  for (std::size_t i = 0; i < params.header.size(); ++i) {
+    headerLine += (i > 0 ? "," : "") + params.header.at(i);
   }
 
-  // Get rid of the last ','
-  res.pop_back();
+  std::atomic<int64_t> nextFile{0};
+  std::atomic<int64_t> rowsGenerated{0};
+  std::atomic<int64_t> rowsWritten{0};
+  std::mutex logMutex;
 
-  ++n_;
-  return res;
+  auto writeFile = [&](int64_t file) {
+    // Its own stream for every file, so the output doesn't depend on which
+    // thread writes the file
+    std::seed_seq seq{seed, static_cast<uint32_t>(file)};
+    std::vector<uint32_t> fileSeed(1);
+    seq.generate(fileSeed.begin(), fileSeed.end());
+    FakeDataGenerator generator{params, fileSeed.at(0)};
+
+    std::ofstream out{outputPaths.at(file)};
+    if (!out) {
+      throw std::runtime_error(
+          "Failed to open output file " + outputPaths.at(file));
+    }
+    out << headerLine << '\n';
+
+    auto begin = file * numRows / numFiles;
+    auto end = (file + 1) * numRows / numFiles;
+    std::string buffer;
+    int64_t written = 0;
+    for (auto batchBegin = begin; batchBegin < end;
+         batchBegin += kRowsPerWrite) {
+      auto batchEnd = std::min(batchBegin + kRowsPerWrite, end);
+      buffer.clear();
+      for (auto i = batchBegin; i < batchEnd; ++i) {
+        auto idNumber = i;
+        if (params.role == Role::Partner && !generator.drawIsMatched()) {
+          idNumber = numRows + i;
+        }
+        if (generator.appendRow(idNumber, buffer)) {
+          buffer += '\n';
+          ++written;
+        }
+      }
+      out.write(buffer.data(), buffer.size());
+
+      auto batchRows = batchEnd - batchBegin;
+      auto generated = rowsGenerated.fetch_add(batchRows) + batchRows;
+      if (logEveryN > 0 &&
+          generated / logEveryN != (generated - batchRows) / logEveryN) {
+        std::lock_guard<std::mutex> lock{logMutex};
+        std::cout << "Processed " << generated / logEveryN * logEveryN
+                  << " lines\n";
+      }
+    }
+    out.close();
+    if (!out) {
+      throw std::runtime_error(
+          "Failed to write output file " + outputPaths.at(file));
+    }
+    rowsWritten += written;
+  };
+
+  std::vector<std::thread> threads;
+  std::vector<std::exception_ptr> errors(std::max(numThreads, 1));
+  for (std::size_t t = 0; t < errors.size(); ++t) {
+    threads.emplace_back([&, t]() {
+      try {
+        for (auto file = nextFile++; file < numFiles; file = nextFile++) {
+          writeFile(file);
+        }
+      } catch (...) {
+        errors.at(t) = std::current_exception();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  return rowsWritten;
 }
@@ -29,6 +29,9 @@ struct FakeDataGeneratorParams {
   int64_t minValue = 100;
   int64_t maxValue = 10000;
   bool shouldUseComplexIds = true;
+  // Proportion of partner rows whose id is also the id of a publisher row,
+  // when generating files with writeFakeDataFiles
+  double matchRate = 1.0;
 
   FakeDataGeneratorParams(Role role_, std::vector<std::string> header_)
       : role{role_}, header{header_} {}
@@ -72,6 +75,11 @@ struct FakeDataGeneratorParams {
     shouldUseComplexIds = b;
     return *this;
   }
+
+  FakeDataGeneratorParams& withMatchRate(double r) {
+    matchRate = r;
+    return *this;
+  }
 };
 
 class FakeDataGenerator {
@@ -82,13 +90,72 @@ class FakeDataGenerator {
             static_cast<uint32_t>(
                 std::chrono::system_clock::now().time_since_epoch().count())} {}
 
-  FakeDataGenerator(FakeDataGeneratorParams params, uint32_t seed)
-      : params_{params}, r_{seed}, n_{0} {}
+  FakeDataGenerator(FakeDataGeneratorParams params, uint32_t seed);
 
   std::string genOneRow();
 
+  /*
+   * Append one row for the id numbered idNumber to out, without a trailing
+   * newline. Nothing is appended if the row would be useless for the role,
+   * that is a publisher row without an opportunity or a partner row without a
+   * purchase.
+   *
+   * @returns whether a row was appended
+   */
+  bool appendRow(int64_t idNumber, std::string& out);
+
+  /*
+   * Draw whether the next partner row has the id of the publisher row with
+   * the same number, with probability params.matchRate
+   */
+  bool drawIsMatched();
+
  private:
+  enum class Column {
+    Id,
+    OpportunityTimestamp,
+    TestFlag,
+    NumImpressions,
+    NumClicks,
+    TotalSpend,
+    BreakdownId,
+    EventTimestamp,
+    Value,
+    CohortId,
+  };
+
   FakeDataGeneratorParams params_;
+  // The header resolved once, so rows are generated without looking up the
+  // column names
+  std::vector<Column> columns_;
   std::default_random_engine r_;
+  std::uniform_real_distribution<double> realDist_{0, 1};
+  std::uniform_int_distribution<int8_t> binaryDist_{0, 1};
+  // Used for impressions and clicks
+  std::uniform_int_distribution<int64_t> engagementDist_{0, 10};
+  std::uniform_int_distribution<int64_t> valueDist_;
+  std::uniform_int_distribution<int64_t> tsDist_;
   int64_t n_;
 };
+
+/*
+ * Generate numRows rows into outputPaths on numThreads threads. Every file
+ * gets a contiguous range of the rows and its own random stream, seeded from
+ * seed and the index of the file, so the output only depends on the seed and
+ * not on the number of threads.
+ *
+ * Row i of a publisher dataset has id number i. Row i of a partner dataset
+ * has id number i with probability params.matchRate, and otherwise
+ * numRows + i, which no publisher row has. Publisher and partner files
+ * generated with the same numRows and number of files therefore share ids
+ * file by file.
+ *
+ * @returns the number of rows written, as useless rows are skipped
+ */
+int64_t writeFakeDataFiles(
+    const FakeDataGeneratorParams& params,
+    const std::vector<std::string>& outputPaths,
+    int64_t numRows,
+    uint32_t seed,
+    int32_t numThreads,
+    int64_t logEveryN);
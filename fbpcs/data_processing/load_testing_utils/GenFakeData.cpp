@@ -7,8 +7,8 @@
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <cstdlib>
-#include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -17,14 +17,25 @@
 
 #include "fbpcs/data_processing/load_testing_utils/FakeDataGenerator.h"
 
-DEFINE_string(output_filepath, "", "Path of the output file");
+DEFINE_string(
+    output_filepath,
+    "",
+    "Path of the output file. With more than one output file, file i is "
+    "written to <output_filepath>_i");
 DEFINE_string(
     role,
     "publisher",
     "Whether this is a publisher or partner dataset");
 DEFINE_string(header, "", "Header defining the output to be generated");
-DEFINE_int32(n, 1'000'000, "How many lines to generate");
-DEFINE_int32(log_every_n, 1'000'000, "How frequently to log updates");
+DEFINE_int64(n, 1'000'000, "How many lines to generate");
+DEFINE_int32(num_files, 1, "How many files to split the lines into");
+DEFINE_int32(num_threads, 1, "How many files to generate at once");
+DEFINE_int64(
+    seed,
+    -1,
+    "Seed of the generated data, which is reproducible for a given seed. "
+    "Negative uses the current time");
+DEFINE_int64(log_every_n, 1'000'000, "How frequently to log updates");
 DEFINE_string(
     opportunity_rate,
     "0.8",
@@ -37,6 +48,11 @@ DEFINE_string(
     purchase_rate,
     "0.1",
     "Proportion of users making a purchase (as a double)");
+DEFINE_string(
+    match_rate,
+    "1.0",
+    "Proportion of partner lines with the id of a publisher line generated "
+    "with the same n and num_files (as a double)");
 DEFINE_int32(min_ts, 1'600'000'000, "Minimum timestamp possible");
 DEFINE_int32(max_ts, 1'600'000'000 + 86400 * 30, "Maximum timestamp possible");
 DEFINE_int32(min_value, 100, "Minimum value for generated purchases");
@@ -85,23 +101,33 @@ int main(int argc, char** argv) {
                .withMaxTs(FLAGS_max_ts)
                .withMinValue(FLAGS_min_value)
                .withMaxValue(FLAGS_max_value)
-               .withShouldUseComplexIds(FLAGS_should_use_complex_ids);
+               .withShouldUseComplexIds(FLAGS_should_use_complex_ids)
+               .withMatchRate(std::stod(FLAGS_match_rate));
 
-  FakeDataGenerator g{params};
+  uint32_t seed = FLAGS_seed >= 0
+      ? static_cast<uint32_t>(FLAGS_seed)
+      : static_cast<uint32_t>(
+            std::chrono::system_clock::now().time_since_epoch().count());
 
-  std::cout << "Writing output to " << FLAGS_output_filepath << '\n';
-  std::ofstream fOut{FLAGS_output_filepath};
-  fOut << FLAGS_header << '\n';
-  for (std::size_t i = 0; i < FLAGS_n; ++i) {
-    auto row = g.genOneRow();
-    if (!row.empty()) {
-      fOut << row << '\n';
-    }
-    if ((i + 1) % FLAGS_log_every_n == 0) {
-      std::cout << "Processed " << i + 1 << " lines\n";
+  std::vector<std::string> outputPaths;
+  if (FLAGS_num_files == 1) {
+    outputPaths.push_back(FLAGS_output_filepath);
+  } else {
+    for (int32_t i = 0; i < FLAGS_num_files; ++i) {
+      outputPaths.push_back(FLAGS_output_filepath + "_" + std::to_string(i));
     }
   }
 
-  std::cout << "Done.\n";
+  std::cout << "Writing output to " << FLAGS_output_filepath << " with seed "
+            << seed << '\n';
+  auto rowsWritten = writeFakeDataFiles(
+      params,
+      outputPaths,
+      FLAGS_n,
+      seed,
+      FLAGS_num_threads,
+      FLAGS_log_every_n);
+
+  std::cout << "Done. Wrote " << rowsWritten << " lines.\n";
   return 0;
 }
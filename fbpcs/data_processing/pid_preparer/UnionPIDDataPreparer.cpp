@@ -10,51 +10,115 @@
 #include <algorithm>
 #include <cstdint>
 #include <cstdlib>
+#include <deque>
+#include <functional>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include <re2/re2.h>
 
 #include <folly/String.h>
+#include <folly/container/F14Map.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/futures/Future.h>
 #include "fbpcf/io/api/BufferedReader.h"
 #include "fbpcf/io/api/FileReader.h"
 #include "folly/Random.h"
 #include "folly/logging/xlog.h"
 
 // TODO: Rewrite for OSS?
-#include "../common/FilepathHelpers.h"
 #include "../common/Logging.h"
-#include "fbpcf/io/api/FileIOWrappers.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
 
 namespace measurement::pid {
 
 static const std::string kIdColumnPrefix = "id_";
 
+namespace {
+// Number of lines split and validated together by one prepare thread
+constexpr std::size_t kPrepareBatchLines = 4096;
+// Number of batches being prepared at the same time, per prepare thread
+constexpr std::size_t kPrepareBatchesPerThread = 4;
+
+struct PreparedBatch {
+  // Number of columns of each row, to be validated against the header
+  std::vector<std::size_t> rowSizes;
+  // The non-null ids of each row. Which of them are used depends on the ids
+  // filtered, which are only known once the whole input has been read.
+  std::vector<std::vector<std::string>> rowIds;
+};
+
+PreparedBatch prepareBatch(
+    std::vector<std::string>& lines,
+    std::size_t headerSize,
+    const std::vector<std::int64_t>& idColumnIndices) {
+  PreparedBatch batch;
+  batch.rowSizes.reserve(lines.size());
+  batch.rowIds.reserve(lines.size());
+  std::vector<std::string> cols;
+  for (auto& line : lines) {
+    line.erase(std::remove(line.begin(), line.end(), ' '), line.end());
+    cols.clear();
+    folly::split(',', line, cols);
+    batch.rowSizes.push_back(cols.size());
+    auto& ids = batch.rowIds.emplace_back();
+    if (cols.size() != headerSize) {
+      // The mismatch is reported when the batch is consumed
+      continue;
+    }
+
+    for (std::int64_t idColumnIdx : idColumnIndices) {
+      auto& id = cols.at(idColumnIdx);
+      if (id == "") {
+        continue;
+      }
+      ids.push_back(std::move(id));
+    }
+  }
+  return batch;
+}
+
+// The number of the non-null ids of a row counted towards the filter, the
+// first maxColumnCnt of them
+std::size_t getNumCountedIds(
+    const std::vector<std::string>& ids,
+    std::int64_t maxColumnCnt) {
+  if (maxColumnCnt <= 0) {
+    return ids.size();
+  }
+  return std::min(ids.size(), static_cast<std::size_t>(maxColumnCnt));
+}
+} // namespace
+
 UnionPIDDataPreparerResults UnionPIDDataPreparer::prepare() const {
   UnionPIDDataPreparerResults res;
-  auto readerForFilter = std::make_unique<fbpcf::io::FileReader>(inputPath_);
-  auto bufferedReaderForFilter =
-      std::make_unique<fbpcf::io::BufferedReader>(std::move(readerForFilter));
+  auto reader =
+      private_measurement::compressed_io::makeRawFileReader(inputPath_);
+  auto bufferedReader =
+      std::make_unique<fbpcf::io::BufferedReader>(std::move(reader));
 
   // Get a random ID to avoid potential name collisions if multiple
   // runs at the same time point to the same input file
   auto randomId = std::to_string(folly::Random::secureRand64());
-  std::string tmpFilename = randomId + "_" +
-      private_lift::filepath_helpers::getBaseFilename(inputPath_) + "_prepared";
-  auto tmpFilepath = (tmpDirectory_ / tmpFilename).string();
-  std::cout << "\t\tCreated temporary filepath --> " << tmpFilepath << '\n';
-  auto tmpFile = std::make_unique<std::ofstream>(tmpFilename);
+  // The prepared data is written straight to the output path, where it only
+  // appears once it is complete. It is never compressed, since the PID
+  // protocol reads it with fbpcf directly.
+  XLOG(INFO) << "Writing prepared data to " << outputPath_;
+  private_measurement::compressed_io::OutputFileStream outFile{
+      outputPath_, private_measurement::compressed_io::Codec::kNone};
 
   std::vector<std::string> header;
 
-  std::string line = bufferedReaderForFilter->readLine();
+  std::string line = bufferedReader->readLine();
   line.erase(std::remove(line.begin(), line.end(), ' '), line.end());
   folly::split(',', line, header);
 
@@ -71,117 +135,32 @@ UnionPIDDataPreparerResults UnionPIDDataPreparer::prepare() const {
     idIter++;
   }
   if (0 == idColumnIndices.size()) {
-    // note: it's not *essential* to clean up tmpfile here, but it will
-    // pollute our test directory otherwise, which is just somewhat annoying.
-    std::remove(tmpFilename.c_str());
+    // Destructors don't run on a fatal error, so the partial output is
+    // discarded here
+    outFile.discard();
     XLOG(FATAL) << kIdColumnPrefix
                 << " prefixed-column missing from input header" << "Header: ["
                 << folly::join(",", header) << "]";
   }
 
-  // Count number of appearance of each identifier.
-  // Then keep ones that have appearance more than idFilterThresh_.
-  std::unordered_map<std::string, std::int32_t> countIds;
+  // Duplicate ids are not allowed. If a row has an id seen in an earlier
+  // row, we skip the row. Ids in filterIds are dropped from the rows.
   std::unordered_set<std::string> filterIds;
-  if (idFilterThresh_ > 1) {
-    XLOG(INFO) << "idFilterThresh_ set to " << idFilterThresh_
-               << ". Filtering ids with its appearance above "
-               << idFilterThresh_ << ".";
-    while (!bufferedReaderForFilter->eof()) {
-      line = bufferedReaderForFilter->readLine();
-      std::vector<std::string> cols;
-      line.erase(std::remove(line.begin(), line.end(), ' '), line.end());
-      folly::split(',', line, cols);
-      auto rowSize = cols.size();
-      auto headerSize = header.size();
-
-      if (rowSize != headerSize) {
-        // note: it's not *essential* to clean up tmpfile here, but it will
-        // pollute our test directory otherwise, which is just somewhat
-        // annoying.
-        std::remove(tmpFilename.c_str());
-        XLOG(FATAL) << "Mismatch between header and row at index "
-                    << res.linesProcessed << '\n'
-                    << "Header has size " << headerSize
-                    << " while row has size " << rowSize << '\n'
-                    << "Header: [" << folly::join(",", header) << "]\n"
-                    << "Row   : [" << folly::join(",", header) << "]";
-      }
-
-      int cntNonEmptyIdColumn = 0;
-      for (std::int64_t idColumnIdx : idColumnIndices) {
-        auto id = cols.at(idColumnIdx);
-        if (id == "") {
-          continue;
-        }
-        if (countIds.find(id) != countIds.end()) {
-          // If id is already present in countIds, increase the count by 1.
-          // If the count reaches idFilterThresh_, add id into filterIds.
-          if (++countIds[id] == idFilterThresh_) {
-            XLOG(INFO) << "Filtering " << id << " after appearing "
-                       << idFilterThresh_ << " times.";
-            filterIds.insert(id);
-          }
-        } else {
-          // If id is not present in countIds, add a new entry.
-          countIds[id] = 1;
-        }
-        if (++cntNonEmptyIdColumn == maxColumnCnt_) {
-          // If the number of ids for this row reaches maxColumnCnt_,
-          // we won't consider the rest of ids.
-          break;
-        }
-      }
-    }
-  }
-  bufferedReaderForFilter->close();
-
-  // Read entire file again to create PREPARE file.
-  auto reader = std::make_unique<fbpcf::io::FileReader>(inputPath_);
-  auto bufferedReader =
-      std::make_unique<fbpcf::io::BufferedReader>(std::move(reader));
-  bufferedReader->readLine(); // Skip header
   std::unordered_set<std::string> seenIds;
-  while (!bufferedReader->eof()) {
-    line = bufferedReader->readLine();
-    std::vector<std::string> cols;
-    line.erase(std::remove(line.begin(), line.end(), ' '), line.end());
-    folly::split(',', line, cols);
-    auto rowSize = cols.size();
-    auto headerSize = header.size();
-
-    if (rowSize != headerSize) {
-      // note: it's not *essential* to clean up tmpfile here, but it will
-      // pollute our test directory otherwise, which is just somewhat annoying.
-      std::remove(tmpFilename.c_str());
-      XLOG(FATAL) << "Mismatch between header and row at index "
-                  << res.linesProcessed << '\n'
-                  << "Header has size " << headerSize << " while row has size "
-                  << rowSize << '\n'
-                  << "Header: [" << folly::join(",", header) << "]\n"
-                  << "Row   : [" << folly::join(",", header) << "]";
-    }
-
-    // Stores non-null id values in vector ids.
-    // Duplicate ids are not allowed. If we find duplicates, we skip this row.
-    bool isDuplicateRow = false;
+  auto writeIds = [&](const std::vector<std::string>& rowIds) {
     std::vector<std::string> ids;
-    int cntNonEmptyIdColumn = 0;
-    for (std::int64_t idColumnIdx : idColumnIndices) {
-      auto id = cols.at(idColumnIdx);
-      if (id == "") {
-        continue;
-      }
+    std::int64_t cntNonEmptyIdColumn = 0;
+    for (const auto& id : rowIds) {
       ++cntNonEmptyIdColumn;
       if (filterIds.find(id) != filterIds.end()) {
-        // If id is in filterIds, we drop this id.
+        // If id is in filterIds, we drop this id. It still counts towards
+        // maxColumnCnt_, but doesn't end the row when it reaches it.
         continue;
       }
       if (seenIds.find(id) != seenIds.end()) {
         // If id is seen before, we will drop this row.
-        isDuplicateRow = true;
         ++res.duplicateIdCount;
-        break;
+        return;
       }
       ids.push_back(id);
       if (cntNonEmptyIdColumn == maxColumnCnt_) {
@@ -189,25 +168,158 @@ UnionPIDDataPreparerResults UnionPIDDataPreparer::prepare() const {
       }
     }
 
-    // skip if number of ids == 0 or identifiers is already present in other row
-    if (ids.size() > 0 && !isDuplicateRow) {
+    // skip if number of ids == 0
+    if (ids.size() > 0) {
       // only when row is not skipped we put ids into seenIds
       for (auto id : ids) {
         seenIds.insert(id);
       }
 
       // join all the ids with delimiter ","
-      *tmpFile << folly::join(",", ids) << '\n';
+      outFile << folly::join(",", ids) << '\n';
+    }
+  };
+
+  // Whether ids appear too often can only be known once the whole input has
+  // been read. So with a filter, the input is read once while counting the
+  // ids, and the ids of each row are spilled to a local file which is read
+  // again once the ids to filter are known. The counts are kept per 64 bit
+  // fingerprint of the id rather than per id, and are then verified on the
+  // few ids whose fingerprint reached the threshold.
+  bool filterFrequentIds = idFilterThresh_ > 1;
+  auto spillFilepath = tmpDirectory_ / (randomId + "_ids_spill");
+  std::unique_ptr<std::ofstream> spillFile;
+  folly::F14FastMap<uint64_t, uint32_t> fingerprintCounts;
+  if (filterFrequentIds) {
+    XLOG(INFO) << "idFilterThresh_ set to " << idFilterThresh_
+               << ". Filtering ids with its appearance above "
+               << idFilterThresh_ << ".";
+    spillFile = std::make_unique<std::ofstream>(spillFilepath);
+  }
+
+  auto headerSize = header.size();
+  auto consumeBatch = [&](PreparedBatch batch) {
+    for (std::size_t row = 0; row < batch.rowSizes.size(); ++row) {
+      auto rowSize = batch.rowSizes.at(row);
+      if (rowSize != headerSize) {
+        outFile.discard();
+        std::remove(spillFilepath.c_str());
+        XLOG(FATAL) << "Mismatch between header and row at index "
+                    << res.linesProcessed << '\n'
+                    << "Header has size " << headerSize
+                    << " while row has size " << rowSize << '\n'
+                    << "Header: [" << folly::join(",", header) << "]\n"
+                    << "Row   : [" << folly::join(",", header) << "]";
+      }
+
+      const auto& ids = batch.rowIds.at(row);
+      if (!filterFrequentIds) {
+        writeIds(ids);
+      } else if (ids.size() > 0) {
+        auto numCounted = getNumCountedIds(ids, maxColumnCnt_);
+        for (std::size_t i = 0; i < numCounted; ++i) {
+          auto& count = fingerprintCounts[std::hash<std::string>{}(ids[i])];
+          if (count < std::numeric_limits<uint32_t>::max()) {
+            ++count;
+          }
+        }
+        *spillFile << folly::join(",", ids) << '\n';
+      }
+
+      ++res.linesProcessed;
+      if (res.linesProcessed % logEveryN_ == 0) {
+        XLOG(INFO) << "Processed "
+                   << private_lift::logging::formatNumber(res.linesProcessed)
+                   << " lines.";
+      }
+    }
+  };
+
+  // Batches of lines are split and validated on numThreads_ threads, but are
+  // consumed in input order, so which rows are kept as duplicates and the
+  // order of the output are the same as with a single thread.
+  auto numThreads = static_cast<std::size_t>(std::max<int64_t>(numThreads_, 1));
+  std::unique_ptr<folly::CPUThreadPoolExecutor> executor;
+  if (numThreads > 1) {
+    executor = std::make_unique<folly::CPUThreadPoolExecutor>(numThreads);
+  }
+  std::deque<folly::SemiFuture<PreparedBatch>> preparing;
+  auto submitBatch = [&](std::vector<std::string> lines) {
+    if (!executor) {
+      consumeBatch(prepareBatch(lines, headerSize, idColumnIndices));
+      return;
     }
+    auto [promise, future] = folly::makePromiseContract<PreparedBatch>();
+    executor->add([p = std::move(promise),
+                   lines = std::move(lines),
+                   headerSize,
+                   &idColumnIndices]() mutable {
+      p.setWith(
+          [&]() { return prepareBatch(lines, headerSize, idColumnIndices); });
+    });
+    preparing.push_back(std::move(future));
+    // Bound the number of lines held in memory
+    if (preparing.size() >= numThreads * kPrepareBatchesPerThread) {
+      consumeBatch(std::move(preparing.front()).get());
+      preparing.pop_front();
+    }
+  };
 
-    ++res.linesProcessed;
-    if (res.linesProcessed % logEveryN_ == 0) {
-      XLOG(INFO) << "Processed "
-                 << private_lift::logging::formatNumber(res.linesProcessed)
-                 << " lines.";
+  std::vector<std::string> lines;
+  while (!bufferedReader->eof()) {
+    lines.push_back(bufferedReader->readLine());
+    if (lines.size() == kPrepareBatchLines) {
+      submitBatch(std::move(lines));
+      lines = std::vector<std::string>{};
     }
   }
+  if (!lines.empty()) {
+    submitBatch(std::move(lines));
+  }
+  while (!preparing.empty()) {
+    consumeBatch(std::move(preparing.front()).get());
+    preparing.pop_front();
+  }
   bufferedReader->close();
+
+  if (filterFrequentIds) {
+    spillFile.reset();
+    auto readSpill = [&](const std::function<void(std::vector<std::string>&)>&
+                             processIds) {
+      std::ifstream spill{spillFilepath};
+      std::string spillLine;
+      std::vector<std::string> ids;
+      while (getline(spill, spillLine)) {
+        folly::split(',', spillLine, ids);
+        processIds(ids);
+        ids.clear();
+      }
+    };
+
+    // Count exactly the ids whose fingerprint appeared often enough. Keep ones
+    // that have appearance more than idFilterThresh_.
+    std::unordered_map<std::string, int64_t> candidateCounts;
+    readSpill([&](std::vector<std::string>& ids) {
+      auto numCounted = getNumCountedIds(ids, maxColumnCnt_);
+      for (std::size_t i = 0; i < numCounted; ++i) {
+        const auto& id = ids[i];
+        if (fingerprintCounts.at(std::hash<std::string>{}(id)) <
+            idFilterThresh_) {
+          continue;
+        }
+        if (++candidateCounts[id] == idFilterThresh_) {
+          XLOG(INFO) << "Filtering " << id << " after appearing "
+                     << idFilterThresh_ << " times.";
+          filterIds.insert(id);
+        }
+      }
+    });
+    fingerprintCounts = {};
+    candidateCounts = {};
+
+    readSpill([&](std::vector<std::string>& ids) { writeIds(ids); });
+    std::remove(spillFilepath.c_str());
+  }
   XLOG(INFO) << "Processed with "
              << private_lift::logging::formatNumber(res.duplicateIdCount)
              << " duplicate ids.";
@@ -216,16 +328,10 @@ UnionPIDDataPreparerResults UnionPIDDataPreparer::prepare() const {
     XLOG(INFO) << "The file is empty. Adding random dummy row";
     // Using random value to avoid accidental match with other-side data
     auto randomDummyRow = std::to_string(folly::Random::secureRand64());
-    *tmpFile << randomDummyRow << "\n";
+    outFile << randomDummyRow << "\n";
   }
 
-  XLOG(INFO) << "Now copying prepared data to final output path";
-  // Reset underlying unique_ptr to ensure buffer gets flushed
-  tmpFile.reset();
-  XLOG(INFO) << "Writing " << tmpFilename << " -> " << outputPath_;
-  fbpcf::io::FileIOWrappers::transferFileInParts(tmpFilename, outputPath_);
-  // We need to make sure we clean up the tmpfiles now
-  std::remove(tmpFilename.c_str());
+  outFile.commit();
   XLOG(INFO) << "File write successful.";
 
   return res;
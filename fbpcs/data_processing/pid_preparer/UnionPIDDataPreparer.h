@@ -26,13 +26,15 @@ class UnionPIDDataPreparer {
       const std::filesystem::path& tmpDirectory,
       int64_t maxColumnCnt = 1,
       int64_t idFilterThresh = -1,
-      int64_t logEveryN = 1'000)
+      int64_t logEveryN = 1'000,
+      int64_t numThreads = 1)
       : inputPath_{inputPath},
         outputPath_{outputPath},
         tmpDirectory_{tmpDirectory},
         logEveryN_{logEveryN},
         maxColumnCnt_{maxColumnCnt},
-        idFilterThresh_{idFilterThresh} {}
+        idFilterThresh_{idFilterThresh},
+        numThreads_{numThreads} {}
 
   UnionPIDDataPreparerResults prepare() const;
 
@@ -47,6 +49,8 @@ class UnionPIDDataPreparer {
   int64_t logEveryN_;
   int64_t maxColumnCnt_;
   int64_t idFilterThresh_;
+  // Number of threads splitting and validating the input rows
+  int64_t numThreads_;
 };
 
 } // namespace measurement::pid
@@ -45,6 +45,21 @@ static void validateFileContents(
   }
 }
 
+// The files next to path whose name starts with its name, such as the
+// temporary file it is written to before it is complete
+static std::vector<std::filesystem::path> getFilesStartingWith(
+    const std::filesystem::path& path) {
+  std::vector<std::filesystem::path> files;
+  for (const auto& entry :
+       std::filesystem::directory_iterator{path.parent_path()}) {
+    if (entry.path().filename().native().rfind(path.filename().native(), 0) ==
+        0) {
+      files.push_back(entry.path());
+    }
+  }
+  return files;
+}
+
 static void validateRowCounts(
     const std::int32_t& expected,
     const std::filesystem::path& path,
@@ -75,6 +90,7 @@ TEST(UnionPIDDataPreparerTest, InvalidHeader) {
 
   UnionPIDDataPreparer preparer{inpath, outpath, "/tmp/"};
   ASSERT_DEATH(preparer.prepare(), ".*column missing from input header.*");
+  EXPECT_TRUE(getFilesStartingWith(outpath).empty());
 }
 
 TEST(UnionPIDDataPreparerTest, RowLengthMismatch) {
@@ -87,6 +103,9 @@ TEST(UnionPIDDataPreparerTest, RowLengthMismatch) {
   UnionPIDDataPreparer preparer{inpath, outpath, "/tmp/"};
   ASSERT_DEATH(
       preparer.prepare(), ".*Mismatch between header and row at index 0.*");
+  // The death test child shares the filesystem, and discarded the partial
+  // output it wrote before dying
+  EXPECT_TRUE(getFilesStartingWith(outpath).empty());
 }
 
 TEST(UnionPIDDataPreparerTest, DuplicateIdsNotAdded) {
@@ -119,6 +138,10 @@ TEST(UnionPIDDataPreparerTest, ValidTest) {
   UnionPIDDataPreparer preparer{inpath, outpath, "/tmp/"};
   preparer.prepare();
   validateFileContents(expected, outpath);
+  // Nothing but the output is left next to it
+  EXPECT_EQ(
+      std::vector<std::filesystem::path>{outpath},
+      getFilesStartingWith(outpath));
 }
 
 TEST(UnionPIDDataPreparerTest, RowCountTest) {
@@ -350,4 +373,72 @@ TEST(UnionPIDDataPreparerTest, AttributionIdSpineInputValidationWithFilter) {
   preparer.prepare();
   validateFileContents(expected, outpath);
 }
+
+TEST(UnionPIDDataPreparerTest, FilterCountsOnlyUsedIdColumns) {
+  std::vector<std::string> lines = {
+      "id_email,id_phone,value",
+      "email1,phone1,1",
+      "email1,phone2,2",
+      "email2,phone1,3",
+      ",phone1,4",
+      "email3,phone3,5",
+      "email3,,6"};
+  // With max_column_cnt of 1 only the first non-empty id of a row is counted,
+  // so email1 and email3 are filtered but phone1 is not. A filtered id is
+  // dropped without ending its row, so the ids after it are written instead.
+  std::string expected{"phone1\nphone2\nemail2\nphone3\n"};
+  std::filesystem::path inpath{tmpnam(nullptr)};
+  std::filesystem::path outpath{tmpnam(nullptr)};
+  writeLinesToFile(inpath, lines);
+
+  UnionPIDDataPreparer preparer{inpath, outpath, "/tmp/", 1, 2};
+  auto res = preparer.prepare();
+  validateFileContents(expected, outpath);
+  EXPECT_EQ(res.linesProcessed, 6);
+  EXPECT_EQ(res.duplicateIdCount, 1);
+}
+
+TEST(UnionPIDDataPreparerTest, MultiThreadedMatchesSingleThreaded) {
+  std::vector<std::string> lines = {"id_email,id_phone,value"};
+  // Enough rows for several batches, with duplicates across batches
+  for (int32_t i = 0; i < 20'000; ++i) {
+    lines.push_back(
+        "email" + std::to_string(i % 7'919) + ",phone" +
+        std::to_string(i % 104'729) + "," + std::to_string(i));
+  }
+  std::filesystem::path inpath{tmpnam(nullptr)};
+  std::filesystem::path singleThreadedOutpath{tmpnam(nullptr)};
+  std::filesystem::path multiThreadedOutpath{tmpnam(nullptr)};
+  writeLinesToFile(inpath, lines);
+
+  for (int64_t idFilterThresh : {-1, 2, 3}) {
+    UnionPIDDataPreparer singleThreaded{
+        inpath, singleThreadedOutpath, "/tmp/", 2, idFilterThresh, 1'000, 1};
+    UnionPIDDataPreparer multiThreaded{
+        inpath, multiThreadedOutpath, "/tmp/", 2, idFilterThresh, 1'000, 4};
+    auto singleThreadedRes = singleThreaded.prepare();
+    auto multiThreadedRes = multiThreaded.prepare();
+    EXPECT_EQ(singleThreadedRes.linesProcessed, 20'000);
+    EXPECT_EQ(multiThreadedRes.linesProcessed, 20'000);
+    EXPECT_EQ(
+        singleThreadedRes.duplicateIdCount, multiThreadedRes.duplicateIdCount);
+    validateFileContents(
+        readFile(singleThreadedOutpath), multiThreadedOutpath);
+  }
+}
+
+TEST(UnionPIDDataPreparerTest, MultiThreadedRowLengthMismatch) {
+  std::vector<std::string> lines = {"id_,aaa,bbb"};
+  for (int32_t i = 0; i < 10'000; ++i) {
+    lines.push_back(std::to_string(i) + ",1,2");
+  }
+  lines.push_back("123,456");
+  std::filesystem::path inpath{tmpnam(nullptr)};
+  std::filesystem::path outpath{tmpnam(nullptr)};
+  writeLinesToFile(inpath, lines);
+
+  UnionPIDDataPreparer preparer{inpath, outpath, "/tmp/", 1, -1, 1'000, 4};
+  ASSERT_DEATH(
+      preparer.prepare(), ".*Mismatch between header and row at index 10000.*");
+}
 } // namespace measurement::pid
@@ -34,6 +34,11 @@ DEFINE_int32(
     id_filter_thresh,
     -1,
     "A threshold for number of times identifier can appear");
+DEFINE_int32(
+    num_threads,
+    1,
+    "Number of threads splitting and validating the input rows. The output "
+    "is the same, in the same order, for any number of threads");
 
 int main(int argc, char** argv) {
   folly::init(&argc, &argv);
@@ -49,7 +54,8 @@ int main(int argc, char** argv) {
       tmpDirectory,
       FLAGS_max_column_cnt,
       FLAGS_id_filter_thresh,
-      FLAGS_log_every_n};
+      FLAGS_log_every_n,
+      FLAGS_num_threads};
 
   preparer.prepare();
   return 0;
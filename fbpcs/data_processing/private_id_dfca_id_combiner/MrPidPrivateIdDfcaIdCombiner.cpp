@@ -15,13 +15,17 @@
 #include <iomanip>
 #include <istream>
 #include <stdexcept>
+#include <thread>
 #include <unordered_map>
 
 #include "fbpcs/data_processing/id_combiner/IdSwapMultiKey.h"
+#include "fbpcs/data_processing/id_combiner/SpineParts.h"
 
 namespace pid::combiner {
 MrPidPrivateIdDfcaIdCombiner::MrPidPrivateIdDfcaIdCombiner()
-    : spineIdFilePath(FLAGS_spine_path), outputPath{FLAGS_output_path} {
+    : spineIdFilePath(FLAGS_spine_path),
+      spineParts(getSpineParts(FLAGS_spine_path)),
+      outputPath{FLAGS_output_path} {
   XLOG(INFO) << "Starting private_id_dfca id combiner run on: "
              << "spine_path: " << FLAGS_spine_path
              << ", output_path: " << FLAGS_output_path
@@ -30,7 +34,9 @@ MrPidPrivateIdDfcaIdCombiner::MrPidPrivateIdDfcaIdCombiner()
              << ", max_id_column_cnt: " << FLAGS_max_id_column_cnt
              << ", protocol_type: " << FLAGS_protocol_type;
 
-  auto spineReader = std::make_unique<fbpcf::io::FileReader>(FLAGS_spine_path);
+  // The header is read from the first part
+  auto spineReader =
+      std::make_unique<fbpcf::io::FileReader>(spineParts.front());
   spineIdFile =
       std::make_shared<fbpcf::io::BufferedReader>(std::move(spineReader));
 }
@@ -41,10 +47,11 @@ MrPidPrivateIdDfcaIdCombiner::~MrPidPrivateIdDfcaIdCombiner() {
 std::stringstream MrPidPrivateIdDfcaIdCombiner::idSwap(std::string headerLine) {
   std::stringstream idSwapOutFile;
   idSwapOutFile << headerLine << "\n";
-  while (!spineIdFile->eof()) {
-    auto spineRow = spineIdFile->readLine();
-    idSwapOutFile << spineRow << "\n";
-  }
+  readSpineParts(
+      spineParts,
+      headerLine,
+      idSwapOutFile,
+      std::thread::hardware_concurrency());
   return idSwapOutFile;
 }
 
@@ -51,6 +51,8 @@ BBB               a2
 class MrPidPrivateIdDfcaIdCombiner : public PrivateIdDfcaStrategy {
   std::shared_ptr<fbpcf::io::BufferedReader> spineIdFile;
   std::string spineIdFilePath;
+  // The part files of the spine, or just the spine file
+  std::vector<std::string> spineParts;
   std::filesystem::path outputPath;
   std::filesystem::path tmpFilepath;
 
@@ -9,7 +9,11 @@
 
 #include "fbpcs/data_processing/private_id_dfca_id_combiner/PrivateIdDfcaIdSpineCombinerOptions.h"
 
-DEFINE_string(spine_path, "", "File path which contains the identity spine");
+DEFINE_string(
+    spine_path,
+    "",
+    "File path which contains the identity spine. For MR-PID, also a local "
+    "directory of part files, which are read in parallel");
 DEFINE_string(data_path, "", "File path which contains the data file");
 DEFINE_string(
     output_path,
@@ -28,6 +32,14 @@ DEFINE_bool(
     log_cost,
     false,
     "Log cost info into cloud which will be used for dashboard");
+DEFINE_int32(
+    num_threads,
+    1,
+    "Number of PID ranges or output shards of the id swap output to combine in parallel");
+DEFINE_int32(
+    num_output_shards,
+    0,
+    "If more than 1, write this many shards split by PID to <output_path>_<i> instead of a single output");
 DEFINE_int32(max_id_column_cnt, 1, "Maximum number of id columns to use as id");
 DEFINE_string(log_cost_s3_bucket, "cost-estimation-logs", "s3 bucket name");
 DEFINE_string(
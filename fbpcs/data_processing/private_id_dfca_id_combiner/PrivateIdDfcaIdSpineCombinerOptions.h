@@ -18,6 +18,8 @@ DECLARE_string(sort_strategy);
 DECLARE_bool(log_cost);
 DECLARE_string(log_cost_s3_bucket);
 DECLARE_string(log_cost_s3_region);
+DECLARE_int32(num_threads);
+DECLARE_int32(num_output_shards);
 DECLARE_int32(max_id_column_cnt);
 DECLARE_string(protocol_type);
 DECLARE_string(run_id);
@@ -7,6 +7,7 @@
 
 #include "fbpcs/data_processing/private_id_dfca_id_combiner/PrivateIdDfcaIdSpineFileCombiner.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
 #include <filesystem>
@@ -134,3 +135,40 @@ TEST_F(PrivateIdDfcaIdSpineFileCombinerTest, TestMultiKeyWithMaxFour) {
   FLAGS_max_id_column_cnt = 4;
   runTest(multiKeyDataInput, multiKeySpineInput, multiKeyExpectedOutput);
 }
+
+TEST_F(PrivateIdDfcaIdSpineFileCombinerTest, TestMultiKeyWithThreads) {
+  FLAGS_max_id_column_cnt = 1;
+  FLAGS_num_threads = 3;
+  runTest(multiKeyDataInput, multiKeySpineInput, multiKeyExpectedOutput);
+  FLAGS_num_threads = 1;
+}
+
+TEST_F(PrivateIdDfcaIdSpineFileCombinerTest, TestMultiKeyWithOutputShards) {
+  FLAGS_max_id_column_cnt = 1;
+  FLAGS_num_threads = 2;
+  FLAGS_num_output_shards = 3;
+  // The single output isn't written, only its shards
+  std::vector<std::string> noOutput;
+  runTest(multiKeyDataInput, multiKeySpineInput, noOutput);
+
+  std::vector<std::string> rows;
+  for (int32_t i = 0; i < FLAGS_num_output_shards; ++i) {
+    std::ifstream shardFile{outputFilePath_ + "_" + std::to_string(i)};
+    std::string row;
+    getline(shardFile, row);
+    EXPECT_EQ(row, multiKeyExpectedOutput.front());
+    std::vector<std::string> shardRows;
+    while (getline(shardFile, row)) {
+      shardRows.push_back(row);
+    }
+    EXPECT_TRUE(std::is_sorted(shardRows.begin(), shardRows.end()));
+    rows.insert(rows.end(), shardRows.begin(), shardRows.end());
+  }
+  std::sort(rows.begin(), rows.end());
+  EXPECT_EQ(
+      rows,
+      std::vector<std::string>(
+          multiKeyExpectedOutput.begin() + 1, multiKeyExpectedOutput.end()));
+  FLAGS_num_threads = 1;
+  FLAGS_num_output_shards = 0;
+}
@@ -9,6 +9,7 @@
 
 #include <folly/Random.h>
 #include <folly/logging/xlog.h>
+#include <functional>
 
 #include <boost/algorithm/string.hpp>
 #include "fbpcf/io/api/FileIOWrappers.h"
@@ -17,36 +18,90 @@
 #include "fbpcs/data_processing/id_combiner/DataPreparationHelpers.h"
 #include "fbpcs/data_processing/id_combiner/DataValidation.h"
 #include "fbpcs/data_processing/id_combiner/GroupBy.h"
+#include "fbpcs/data_processing/id_combiner/PartitionedCombine.h"
 #include "fbpcs/data_processing/id_combiner/SortIds.h"
 
 namespace pid::combiner {
 
-void PrivateIdDfcaStrategy::aggregate(
-    std::stringstream& idSwapOutFile,
-    std::string outputPath) {
-  std::filesystem::path tmpDirectory{FLAGS_tmp_directory};
+namespace {
+std::filesystem::path getTmpFilepath(const std::string& outputPath) {
   // Get a random ID to avoid potential name collisions if multiple
   // runs at the same time point to the same input file
   auto randomId = std::to_string(folly::Random::secureRand64());
   std::string tmpFilename = randomId + "_" +
       private_lift::filepath_helpers::getBaseFilename(outputPath);
-  auto tmpFilepath = tmpDirectory / tmpFilename;
+  auto tmpFilepath = std::filesystem::path{FLAGS_tmp_directory} / tmpFilename;
   XLOG(INFO) << "Writing temporary file to " << tmpFilepath;
-  std::ofstream outFile{tmpFilepath};
+  return tmpFilepath;
+}
+
+void moveToOutput(
+    const std::filesystem::path& tmpFilepath,
+    const std::string& outputPath) {
+  if (outputPath != tmpFilepath) {
+    fbpcf::io::FileIOWrappers::transferFileInParts(tmpFilepath, outputPath);
+    std::remove(tmpFilepath.c_str());
+  }
+}
+} // namespace
 
+void PrivateIdDfcaStrategy::aggregate(
+    std::stringstream& idSwapOutFile,
+    std::string outputPath) {
+  std::filesystem::path tmpDirectory{FLAGS_tmp_directory};
+  std::function<void(std::istream&, std::ostream&)> combine;
   if (FLAGS_sort_strategy == "sort") {
-    sortIds(idSwapOutFile, outFile);
+    combine = [&tmpDirectory](std::istream& in, std::ostream& out) {
+      sortIds(in, out, tmpDirectory);
+    };
   } else if (FLAGS_sort_strategy == "keep_original") {
-    outFile << idSwapOutFile.rdbuf();
+    combine = [](std::istream& in, std::ostream& out) {
+      // Streaming an empty buffer would set the failbit of out
+      if (in.peek() != std::char_traits<char>::eof()) {
+        out << in.rdbuf();
+      }
+    };
   } else {
     XLOG(FATAL) << "Invalid sort strategy '" << FLAGS_sort_strategy
                 << "'. Expected 'sort' or 'keep_original'.";
   }
 
-  outFile.close();
-  if (outputPath != tmpFilepath) {
-    fbpcf::io::FileIOWrappers::transferFileInParts(tmpFilepath, outputPath);
-    std::remove(tmpFilepath.c_str());
+  if (FLAGS_num_output_shards <= 1) {
+    auto tmpFilepath = getTmpFilepath(outputPath);
+    std::ofstream outFile{tmpFilepath};
+    // Combine PID ranges in parallel if requested. The rows are not grouped,
+    // so none of them have to stay together
+    combinePartitioned(
+        idSwapOutFile,
+        outFile,
+        FLAGS_num_threads,
+        FLAGS_sort_strategy == "sort",
+        false,
+        combine);
+    outFile.close();
+    moveToOutput(tmpFilepath, outputPath);
+    return;
+  }
+
+  // Write the shards of the aggregation stage directly. They are split by a
+  // hash of the PID, so the publisher and partner shards with the same index
+  // hold the same PIDs
+  std::vector<std::string> shardPaths;
+  std::vector<std::filesystem::path> tmpFilepaths;
+  std::vector<std::ofstream> shardFiles;
+  for (int32_t i = 0; i < FLAGS_num_output_shards; ++i) {
+    shardPaths.push_back(outputPath + "_" + std::to_string(i));
+    tmpFilepaths.push_back(getTmpFilepath(shardPaths.back()));
+    shardFiles.emplace_back(tmpFilepaths.back());
+  }
+  std::vector<std::ostream*> outFiles;
+  for (auto& shardFile : shardFiles) {
+    outFiles.push_back(&shardFile);
+  }
+  combineSharded(idSwapOutFile, outFiles, FLAGS_num_threads, combine);
+  for (int32_t i = 0; i < FLAGS_num_output_shards; ++i) {
+    shardFiles.at(i).close();
+    moveToOutput(tmpFilepaths.at(i), shardPaths.at(i));
   }
 }
 
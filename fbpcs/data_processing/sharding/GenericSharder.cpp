@@ -8,33 +8,95 @@
 #include "fbpcs/data_processing/sharding/GenericSharder.h"
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <deque>
 #include <exception>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
+#include <strings.h>
+
 #include <fbpcf/aws/S3Util.h>
 #include <fbpcf/io/api/BufferedReader.h>
 #include <fbpcf/io/api/BufferedWriter.h>
 #include <fbpcf/io/api/FileReader.h>
 #include <fbpcf/io/api/FileWriter.h>
+#include <folly/MPMCQueue.h>
 #include <folly/Random.h>
 #include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
-#include <re2/re2.h>
 
-#include <folly/DynamicConverter.h>
+#include <folly/dynamic.h>
 #include <folly/json.h>
 #include "fbpcs/data_processing/common/FilepathHelpers.h"
 #include "fbpcs/data_processing/common/Logging.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
 #include "folly/String.h"
 
+DEFINE_int32(
+    sharding_threads,
+    1,
+    "Number of threads preparing lines to be sharded. With more than one, the "
+    "input is read, prepared and written by a pipeline of threads");
+DEFINE_int32(
+    sharding_writer_threads,
+    data_processing::sharder::THREAD_POOL_SIZE,
+    "Number of threads opening, writing and closing the output files, which "
+    "bounds how many output uploads (e.g. S3 multipart parts) are in flight");
+DEFINE_int64(
+    sharding_output_buffer_bytes,
+    0,
+    "Size of the write buffer of every output file, which is the size of the "
+    "parts handed to the output file at once. 0 uses the default size");
+DEFINE_int64(
+    sharding_writer_queue_bytes,
+    1 << 28,
+    "Maximum bytes of prepared rows waiting for the writer threads before the "
+    "reader waits, when sharding with more than one thread");
+DEFINE_string(
+    sharding_output_format,
+    "csv",
+    "Format of the output shards - options: (csv|row_group). row_group writes "
+    "the binary row group format, which the games read without parsing text");
+DEFINE_string(
+    sharding_output_compression,
+    "none",
+    "Compression of the output shards - options: (none|zstd|lz4). The games "
+    "and combiners detect compressed inputs and decompress them as they read");
+DEFINE_int32(
+    sharding_reader_threads,
+    8,
+    "Number of input part files read at the same time when the input names "
+    "several parts and shards are assigned by id. Parts are read one after "
+    "another when shards are assigned in input order");
+DEFINE_string(
+    sharding_input_filenames,
+    "",
+    "Comma-separated list of input part files, which are sharded in one run "
+    "in place of the input file");
+DEFINE_bool(
+    sharding_sort_by_id,
+    false,
+    "Write the rows of every shard sorted by their id, the first non-empty id_ "
+    "column. The rows of each shard are held in memory until it is closed, "
+    "when the shards are sorted and written concurrently");
+
 namespace data_processing::sharder {
 namespace detail {
 void stripQuotes(std::string& s) {
@@ -46,25 +108,230 @@ void dos2Unix(std::string& s) {
   s.erase(std::remove(s.begin(), s.end(), '\r'), s.end());
 }
 
-void strRemoveBlanks(std::string& str) {
-  str.erase(std::remove(str.begin(), str.end(), ' '), str.end());
+bool isNormalized(std::string_view line, bool blankNullColumns) {
+  for (char c : {'"', '\'', '\r', ' '}) {
+    if (std::memchr(line.data(), c, line.size()) != nullptr) {
+      return false;
+    }
+  }
+  // Most rows are numbers and ids, so the columns only need to be compared
+  // with `null` if the row has an l at all
+  if (!blankNullColumns ||
+      (std::memchr(line.data(), 'l', line.size()) == nullptr &&
+       std::memchr(line.data(), 'L', line.size()) == nullptr)) {
+    return true;
+  }
+  std::size_t columnStart = 0;
+  while (true) {
+    auto columnEnd = std::min(line.find(',', columnStart), line.size());
+    if (columnEnd - columnStart == 4 &&
+        strncasecmp(line.data() + columnStart, "null", 4) == 0) {
+      return false;
+    }
+    if (columnEnd == line.size()) {
+      return true;
+    }
+    columnStart = columnEnd + 1;
+  }
+}
+
+void normalizeLine(
+    std::string& line,
+    std::vector<std::size_t>& columnEnds,
+    bool blankNullColumns) {
+  if (isNormalized(line, blankNullColumns)) {
+    findColumnEnds(line, columnEnds);
+    return;
+  }
+  columnEnds.clear();
+  std::size_t out = 0;
+  std::size_t columnStart = 0;
+  auto endColumn = [&]() {
+    if (blankNullColumns && out - columnStart == 4 &&
+        strncasecmp(line.data() + columnStart, "null", 4) == 0) {
+      out = columnStart;
+    }
+    columnEnds.push_back(out);
+  };
+
+  // Characters are only ever dropped, so the normalized line can be written
+  // over the original one as it is scanned.
+  for (std::size_t in = 0; in < line.size(); ++in) {
+    char c = line[in];
+    if (c == '"' || c == '\'' || c == '\r' || c == ' ') {
+      continue;
+    }
+    if (c == ',') {
+      endColumn();
+      line[out++] = ',';
+      columnStart = out;
+    } else {
+      line[out++] = c;
+    }
+  }
+  endColumn();
+  line.resize(out);
+}
+
+void findColumnEnds(
+    const std::string& line,
+    std::vector<std::size_t>& columnEnds) {
+  columnEnds.clear();
+  std::size_t pos = line.find(',');
+  while (pos != std::string::npos) {
+    columnEnds.push_back(pos);
+    pos = line.find(',', pos + 1);
+  }
+  columnEnds.push_back(line.size());
 }
 
-void strReplaceNullColumnWithEmpty(std::string& str) {
-  std::string tmp = "";
-  re2::RE2 Regex("(^|,)(?i)null($|,)");
-  while (tmp != str) {
-    // in case there are overlapping matches, it would iterate to replace all
-    // the null columns. e.g. null,null,null --> ,null, --> ,,
-    tmp = str;
-    re2::RE2::Replace(&str, Regex, "\\1\\2");
+uint64_t estimateCost(std::string_view lines) {
+  uint64_t cost = 0;
+  bool inArray = false;
+  bool emptyArray = false;
+  for (auto c : lines) {
+    if (c == '\n') {
+      ++cost;
+      inArray = false;
+    } else if (c == '[') {
+      inArray = true;
+      emptyArray = true;
+    } else if (c == ']') {
+      cost += inArray && !emptyArray;
+      inArray = false;
+    } else if (inArray) {
+      cost += c == ',';
+      emptyArray = false;
+    }
   }
+  return cost + (!lines.empty() && lines.back() != '\n');
+}
+
+std::vector<std::string> getInputParts(
+    const std::vector<std::string>& inputPaths) {
+  std::vector<std::string> parts;
+  for (const auto& path : inputPaths) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(path, ec)) {
+      parts.push_back(path);
+      continue;
+    }
+    std::vector<std::string> directoryParts;
+    for (const auto& entry : std::filesystem::directory_iterator{path}) {
+      auto name = entry.path().filename().string();
+      if (!entry.is_regular_file() || name.empty() || name.front() == '.' ||
+          name.front() == '_') {
+        continue;
+      }
+      directoryParts.push_back(entry.path().string());
+    }
+    std::sort(directoryParts.begin(), directoryParts.end());
+    parts.insert(parts.end(), directoryParts.begin(), directoryParts.end());
+  }
+  if (parts.empty()) {
+    throw std::invalid_argument(
+        "No input part files in " + folly::join(',', inputPaths));
+  }
+  return parts;
 }
 } // namespace detail
 
 static const std::string kIdColumnPrefix = "id_";
 static const std::string numIds = "num_ids";
 
+namespace {
+// Number of lines the reader hands to a worker at a time
+constexpr std::size_t kPipelineBatchLines = 4096;
+// Number of batches each worker may have queued before the reader waits
+constexpr std::size_t kPipelineBatchesPerWorker = 4;
+// Number of chunks each writer may have queued before the reader waits
+constexpr std::size_t kWriterQueueCapacity = 256;
+// Size of the chunks a sorted shard is written in
+constexpr std::size_t kSortedShardChunkBytes = 1 << 20;
+
+struct PreparedBatch {
+  // The lines of the batch that weren't dropped and the ids to shard them by.
+  // Only kept when the shards are assigned by the reader.
+  std::vector<std::string> lines;
+  std::vector<std::string> ids;
+  // The newline terminated lines of the batch grouped by shard, and how many
+  // rows each group has
+  std::vector<std::string> shardData;
+  std::vector<std::size_t> shardRows;
+};
+
+struct ShardChunk {
+  std::size_t shard;
+  std::size_t numRows;
+  std::string data;
+};
+
+/**
+ * A budget of bytes shared by the reader and the writer threads. The reader
+ * waits in acquire while too many bytes are queued for the writers, which
+ * release them once written.
+ */
+class ByteBudget {
+ public:
+  explicit ByteBudget(std::size_t limit) : limit_{limit} {}
+
+  void acquire(std::size_t bytes) {
+    std::unique_lock<std::mutex> lock{mutex_};
+    // A chunk larger than the whole budget is let through on its own
+    released_.wait(
+        lock, [&]() { return inUse_ == 0 || inUse_ + bytes <= limit_; });
+    inUse_ += bytes;
+  }
+
+  void release(std::size_t bytes) {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      inUse_ -= bytes;
+    }
+    released_.notify_all();
+  }
+
+ private:
+  const std::size_t limit_;
+  std::size_t inUse_ = 0;
+  std::mutex mutex_;
+  std::condition_variable released_;
+};
+
+std::size_t getNumWriterThreads(std::size_t numShards) {
+  return std::clamp<std::size_t>(
+      numShards, 1, std::max(FLAGS_sharding_writer_threads, 1));
+}
+
+/**
+ * Run a function for every shard on a pool of threads, and rethrow the first
+ * exception it threw once all of them are done.
+ */
+void forEachShardInParallel(
+    std::size_t numShards,
+    const std::function<void(std::size_t)>& fn) {
+  std::vector<std::exception_ptr> errors(numShards);
+  {
+    folly::CPUThreadPoolExecutor executor{getNumWriterThreads(numShards)};
+    for (std::size_t shard = 0; shard < numShards; ++shard) {
+      executor.add([&, shard]() {
+        try {
+          fn(shard);
+        } catch (...) {
+          errors.at(shard) = std::current_exception();
+        }
+      });
+    }
+    executor.join();
+  }
+  for (auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+} // namespace
+
 std::vector<std::string> GenericSharder::genOutputPaths(
     const std::string& outputBasePath,
     std::size_t startIndex,
@@ -78,25 +345,54 @@ std::vector<std::string> GenericSharder::genOutputPaths(
 
 void GenericSharder::shard() {
   std::size_t numShards = getOutputPaths().size();
-  auto reader = std::make_unique<fbpcf::io::FileReader>(getInputPath());
-  auto bufferedReader =
-      std::make_unique<fbpcf::io::BufferedReader>(std::move(reader));
-
-  std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>> outFiles(0);
-
-  for (std::size_t i = 0; i < numShards; ++i) {
-    auto fileWriter =
-        std::make_unique<fbpcf::io::FileWriter>(getOutputPaths().at(i));
-    auto bufferedWriter =
-        std::make_unique<fbpcf::io::BufferedWriter>(std::move(fileWriter));
-    outFiles.push_back(std::move(bufferedWriter));
-    XLOG(INFO) << "Created buffered writer for shard " << std::to_string(i);
+  std::vector<std::string> inputPaths{getInputPath()};
+  if (!FLAGS_sharding_input_filenames.empty()) {
+    inputPaths.clear();
+    folly::split(
+        ',',
+        FLAGS_sharding_input_filenames,
+        inputPaths,
+        true /* ignoreEmpty */);
+  }
+  auto inputParts = detail::getInputParts(inputPaths);
+  if (inputParts.size() > 1) {
+    XLOG(INFO) << "Sharding " << inputParts.size() << " input part files";
+  }
+  // The header is taken from the first part which has one. Empty parts before
+  // it are dropped, and the ones after it are skipped by the pipeline.
+  std::unique_ptr<fbpcf::io::BufferedReader> bufferedReader;
+  std::string line;
+  while (true) {
+    bufferedReader = std::make_unique<fbpcf::io::BufferedReader>(
+        private_measurement::compressed_io::makeFileReader(inputParts.at(0)));
+    line = bufferedReader->readLine();
+    if (!line.empty() || !bufferedReader->eof() || inputParts.size() == 1) {
+      break;
+    }
+    bufferedReader->close();
+    inputParts.erase(inputParts.begin());
   }
-  // First get the header and put it in all the output files
-  std::string line = bufferedReader->readLine();
-  detail::stripQuotes(line);
-  detail::dos2Unix(line);
-  detail::strRemoveBlanks(line);
+
+  // Opening an output can be a round trip to remote storage (e.g. starting an
+  // S3 multipart upload), so the outputs are opened concurrently
+  auto codec = private_measurement::compressed_io::parseCodec(
+      FLAGS_sharding_output_compression);
+  std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>> outFiles(numShards);
+  forEachShardInParallel(numShards, [&](std::size_t i) {
+    auto fileWriter = private_measurement::compressed_io::makeFileWriter(
+        getOutputPaths().at(i), codec);
+    if (FLAGS_sharding_output_buffer_bytes > 0) {
+      outFiles.at(i) = std::make_unique<fbpcf::io::BufferedWriter>(
+          std::move(fileWriter), FLAGS_sharding_output_buffer_bytes);
+    } else {
+      outFiles.at(i) =
+          std::make_unique<fbpcf::io::BufferedWriter>(std::move(fileWriter));
+    }
+    XLOG(INFO) << "Created buffered writer for shard " << std::to_string(i);
+  });
+  // Parse the header, and put it in all the output files
+  std::vector<std::size_t> columnEnds;
+  detail::normalizeLine(line, columnEnds, false);
 
   std::vector<std::string> header;
   folly::split(',', line, header);
@@ -117,30 +413,57 @@ void GenericSharder::shard() {
                 << folly::join(",", header) << "]";
   }
 
-  pid_shard_info[numIds] = idColumnIndices.size();
+  numIds_ = idColumnIndices.size();
 
   std::string newLine = "\n";
-  std::size_t i = 0;
-  for (const auto& outFile : outFiles) {
-    XLOG(INFO) << "Writing header to shard " << std::to_string(i++);
-    outFile->writeString(line);
-    outFile->writeString(newLine);
+  sortedRows_.clear();
+  if (FLAGS_sharding_sort_by_id) {
+    sortedRows_.resize(numShards);
+  }
+  rowGroupWriters_.clear();
+  if (FLAGS_sharding_output_format == "row_group") {
+    // The schema is written along with the first row group of every shard
+    for (const auto& outFile : outFiles) {
+      rowGroupWriters_.push_back(
+          std::make_unique<private_measurement::row_group::RowGroupWriter>(
+              header,
+              [&outFile](std::string& bytes) { outFile->writeString(bytes); }));
+    }
+  } else if (FLAGS_sharding_output_format == "csv") {
+    std::size_t i = 0;
+    for (const auto& outFile : outFiles) {
+      XLOG(INFO) << "Writing header to shard " << std::to_string(i++);
+      outFile->writeString(line);
+      outFile->writeString(newLine);
+    }
+  } else {
+    XLOG(FATAL) << "Invalid output format '" << FLAGS_sharding_output_format
+                << "'. Expected 'csv' or 'row_group'.";
   }
   XLOG(INFO) << "Got header line: '" << line << "'";
 
-  // Read lines and send to appropriate outFile repeatedly
+  // Read lines and send to appropriate outFile repeatedly. The parts of an
+  // input of several parts are all sharded by the pipeline, into the same
+  // output files.
   uint64_t lineIdx = 0;
-  while (!bufferedReader->eof()) {
-    line = bufferedReader->readLine();
-    detail::stripQuotes(line);
-    detail::dos2Unix(line);
-    detail::strRemoveBlanks(line);
-    detail::strReplaceNullColumnWithEmpty(line);
-    shardLine(std::move(line), outFiles, idColumnIndices);
-    ++lineIdx;
-    if (lineIdx % getLogRate() == 0) {
-      XLOG(INFO) << "Processed line "
-                 << private_lift::logging::formatNumber(lineIdx);
+  if (FLAGS_sharding_threads > 1 || inputParts.size() > 1) {
+    lineIdx = shardPipelined(
+        *bufferedReader,
+        inputParts,
+        line,
+        outFiles,
+        idColumnIndices,
+        std::max(FLAGS_sharding_threads, 1));
+  } else {
+    while (!bufferedReader->eof()) {
+      line = bufferedReader->readLine();
+      detail::normalizeLine(line, columnEnds, true);
+      shardLine(std::move(line), columnEnds, outFiles, idColumnIndices);
+      ++lineIdx;
+      if (lineIdx % getLogRate() == 0) {
+        XLOG(INFO) << "Processed line "
+                   << private_lift::logging::formatNumber(lineIdx);
+      }
     }
   }
 
@@ -153,45 +476,391 @@ void GenericSharder::shard() {
 
   bufferedReader->close();
 
-  for (auto i_2 = 0; i_2 < numShards; ++i_2) {
-    outFiles.at(i_2)->close();
-    XLOG(INFO, fmt::format("Shard {} has {} rows", i_2, getRowsForShard(i_2)));
-  }
+  // Closing an output flushes and uploads its last part, so the outputs are
+  // closed concurrently as well, along with sorting the shards if they are
+  // held back to be sorted
+  forEachShardInParallel(numShards, [&](std::size_t i) {
+    if (!sortedRows_.empty()) {
+      writeSortedShard(i, outFiles, idColumnIndices);
+    }
+    if (!rowGroupWriters_.empty()) {
+      rowGroupWriters_.at(i)->close();
+    }
+    outFiles.at(i)->close();
+    XLOG(INFO, fmt::format("Shard {} has {} rows", i, getRowsForShard(i)));
+  });
 
   XLOG(INFO) << "All file writes successful";
 }
 
-void GenericSharder::shardLine(
-    std::string line,
+uint64_t GenericSharder::shardPipelined(
+    fbpcf::io::BufferedReader& reader,
+    const std::vector<std::string>& inputParts,
+    const std::string& header,
     const std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>>& outFiles,
-    const std::vector<int32_t>& idColumnIndices) {
-  std::vector<std::string> cols;
-  folly::split(',', line, cols);
+    const std::vector<int32_t>& idColumnIndices,
+    std::size_t numWorkers) {
+  auto numShards = outFiles.size();
+  auto assignInWorkers = isGetShardForThreadSafe();
+
+  // Every output file is owned by a single writer thread, which keeps the rows
+  // of each shard in input order without any locking. Each writer counts the
+  // rows of its own shards, and the counts are merged once it's done.
+  auto numWriters = getNumWriterThreads(numShards);
+  ByteBudget queuedBytes{static_cast<std::size_t>(
+      std::max<int64_t>(FLAGS_sharding_writer_queue_bytes, 1))};
+  std::vector<std::unique_ptr<folly::MPMCQueue<ShardChunk>>> writerQueues;
+  for (std::size_t i = 0; i < numWriters; ++i) {
+    writerQueues.push_back(
+        std::make_unique<folly::MPMCQueue<ShardChunk>>(kWriterQueueCapacity));
+  }
+  std::vector<std::vector<uint64_t>> writerRows(
+      numWriters, std::vector<uint64_t>(numShards));
+  std::vector<std::vector<uint64_t>> writerCosts(
+      numWriters, std::vector<uint64_t>(numShards));
+  std::vector<std::exception_ptr> writerErrors(numWriters);
 
-  std::string id = "";
+  folly::CPUThreadPoolExecutor writers{numWriters};
+  for (std::size_t i = 0; i < numWriters; ++i) {
+    writers.add([&, i]() {
+      ShardChunk chunk;
+      while (true) {
+        writerQueues.at(i)->blockingRead(chunk);
+        if (chunk.shard == numShards) {
+          return;
+        }
+        // Keep draining after a failure so the reader never blocks on us
+        if (!writerErrors.at(i)) {
+          try {
+            writeToShard(chunk.shard, chunk.data, outFiles);
+            writerRows.at(i).at(chunk.shard) += chunk.numRows;
+            writerCosts.at(i).at(chunk.shard) +=
+                detail::estimateCost(chunk.data);
+          } catch (...) {
+            writerErrors.at(i) = std::current_exception();
+          }
+        }
+        queuedBytes.release(chunk.data.size());
+      }
+    });
+  }
+
+  auto sendToWriters = [&](PreparedBatch batch) {
+    if (!assignInWorkers) {
+      batch.shardData.resize(numShards);
+      batch.shardRows.resize(numShards);
+      for (std::size_t j = 0; j < batch.lines.size(); ++j) {
+        auto shard = getShardFor(batch.ids.at(j), numShards);
+        batch.shardData.at(shard) += batch.lines.at(j);
+        batch.shardData.at(shard) += '\n';
+        ++batch.shardRows.at(shard);
+      }
+    }
+    for (std::size_t shard = 0; shard < numShards; ++shard) {
+      if (batch.shardRows.at(shard) > 0) {
+        queuedBytes.acquire(batch.shardData.at(shard).size());
+        writerQueues.at(shard % numWriters)
+            ->blockingWrite(ShardChunk{
+                shard,
+                batch.shardRows.at(shard),
+                std::move(batch.shardData.at(shard))});
+      }
+    }
+  };
+
+  auto prepareBatch = [&](std::vector<std::string> lines) {
+    PreparedBatch batch;
+    if (assignInWorkers) {
+      batch.shardData.resize(numShards);
+      batch.shardRows.resize(numShards);
+    }
+    std::vector<std::size_t> columnEnds;
+    std::string id;
+    for (auto& line : lines) {
+      detail::normalizeLine(line, columnEnds, true);
+      if (!prepareLine(line, columnEnds, idColumnIndices, id)) {
+        continue;
+      }
+      if (assignInWorkers) {
+        auto shard = getShardFor(id, numShards);
+        batch.shardData.at(shard) += line;
+        batch.shardData.at(shard) += '\n';
+        ++batch.shardRows.at(shard);
+      } else {
+        batch.lines.push_back(std::move(line));
+        batch.ids.push_back(std::move(id));
+      }
+    }
+    return batch;
+  };
+
+  std::atomic<uint64_t> lineIdx = 0;
+  // Hands the batches of lines of reader to the workers. The batches of a part
+  // are handed to the writers in the order they were read, so a single part
+  // is written the same as when sharding on a single thread
+  auto shardPart = [&](fbpcf::io::BufferedReader& partReader,
+                       folly::CPUThreadPoolExecutor& workers) {
+    std::deque<folly::SemiFuture<PreparedBatch>> inFlight;
+    while (!partReader.eof()) {
+      std::vector<std::string> lines;
+      lines.reserve(kPipelineBatchLines);
+      while (lines.size() < kPipelineBatchLines && !partReader.eof()) {
+        lines.push_back(partReader.readLine());
+      }
+      auto previousLineIdx = lineIdx.fetch_add(lines.size());
+      auto newLineIdx = previousLineIdx + lines.size();
+      if (newLineIdx / getLogRate() != previousLineIdx / getLogRate()) {
+        XLOG(INFO) << "Processed line "
+                   << private_lift::logging::formatNumber(newLineIdx);
+      }
+
+      auto [promise, future] = folly::makePromiseContract<PreparedBatch>();
+      workers.add([&prepareBatch,
+                   p = std::move(promise),
+                   lines = std::move(lines)]() mutable {
+        p.setWith([&]() { return prepareBatch(std::move(lines)); });
+      });
+      inFlight.push_back(std::move(future));
+
+      if (inFlight.size() >= numWorkers * kPipelineBatchesPerWorker) {
+        sendToWriters(std::move(inFlight.front()).get());
+        inFlight.pop_front();
+      }
+    }
+    while (!inFlight.empty()) {
+      sendToWriters(std::move(inFlight.front()).get());
+      inFlight.pop_front();
+    }
+  };
+
+  // Opens a part after the first one, and shards its lines after its header
+  auto shardOtherPart = [&](std::size_t part,
+                            folly::CPUThreadPoolExecutor& workers) {
+    auto partReader = std::make_unique<fbpcf::io::BufferedReader>(
+        private_measurement::compressed_io::makeFileReader(
+            inputParts.at(part)));
+    // An empty part has no rows, and not even a header
+    auto partHeader = partReader->readLine();
+    std::vector<std::size_t> columnEnds;
+    detail::normalizeLine(partHeader, columnEnds, false);
+    if (!partHeader.empty() || !partReader->eof()) {
+      if (partHeader != header) {
+        throw std::runtime_error(fmt::format(
+            "The header '{}' of input part {} differs from the header '{}' of "
+            "the first part",
+            partHeader,
+            inputParts.at(part),
+            header));
+      }
+      shardPart(*partReader, workers);
+    }
+    partReader->close();
+  };
+
+  std::exception_ptr error;
+  {
+    folly::CPUThreadPoolExecutor workers{numWorkers};
+    // When the shard of a line only depends on its id, the parts are read at
+    // the same time, and the shards get the same rows whichever order the
+    // parts are read in. Otherwise they are read in order, as if they had
+    // been concatenated.
+    auto numReaders = assignInWorkers
+        ? std::min<std::size_t>(
+              std::max(FLAGS_sharding_reader_threads, 1), inputParts.size())
+        : 1;
+    std::vector<std::exception_ptr> partErrors(inputParts.size());
+    if (numReaders > 1) {
+      folly::CPUThreadPoolExecutor readers{numReaders};
+      for (std::size_t part = 0; part < inputParts.size(); ++part) {
+        readers.add([&, part]() {
+          try {
+            if (part == 0) {
+              shardPart(reader, workers);
+            } else {
+              shardOtherPart(part, workers);
+            }
+          } catch (...) {
+            partErrors.at(part) = std::current_exception();
+          }
+        });
+      }
+      readers.join();
+    } else {
+      try {
+        shardPart(reader, workers);
+        for (std::size_t part = 1; part < inputParts.size(); ++part) {
+          shardOtherPart(part, workers);
+        }
+      } catch (...) {
+        partErrors.at(0) = std::current_exception();
+      }
+    }
+    for (auto& partError : partErrors) {
+      if (!error && partError) {
+        error = partError;
+      }
+    }
+    workers.join();
+  }
+
+  for (auto& queue : writerQueues) {
+    queue->blockingWrite(ShardChunk{numShards, 0, ""});
+  }
+  writers.join();
+
+  rowsPerShard_.resize(std::max(rowsPerShard_.size(), numShards));
+  costPerShard_.resize(std::max(costPerShard_.size(), numShards));
+  for (std::size_t i = 0; i < numWriters; ++i) {
+    if (!error && writerErrors.at(i)) {
+      error = writerErrors.at(i);
+    }
+    for (std::size_t shard = 0; shard < numShards; ++shard) {
+      rowsPerShard_[shard] += writerRows.at(i).at(shard);
+      costPerShard_[shard] += writerCosts.at(i).at(shard);
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return lineIdx.load();
+}
+
+bool GenericSharder::prepareLine(
+    std::string& line,
+    const std::vector<std::size_t>& columnEnds,
+    const std::vector<int32_t>& idColumnIndices,
+    std::string& id) const {
+  std::string_view idColumn;
   for (auto idColumnIdx : idColumnIndices) {
-    if (idColumnIdx >= cols.size()) {
+    if (idColumnIdx >= columnEnds.size()) {
       XLOG_EVERY_MS(INFO, 5000)
           << "Discrepancy with header:" << line << " does not have "
           << idColumnIdx << "th column.\n";
-      return;
+      return false;
     }
-    id = cols.at(idColumnIdx);
-    if (!id.empty()) {
+    idColumn = detail::getColumn(line, columnEnds, idColumnIdx);
+    if (!idColumn.empty()) {
       break;
     }
   }
-  if (id.empty()) {
+  if (idColumn.empty()) {
     XLOG_EVERY_MS(INFO, 5000) << "All the id values are empty in this row";
+    return false;
+  }
+  id = idColumn;
+  return true;
+}
+
+void GenericSharder::shardLine(
+    std::string line,
+    const std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>>& outFiles,
+    const std::vector<int32_t>& idColumnIndices) {
+  std::vector<std::size_t> columnEnds;
+  detail::findColumnEnds(line, columnEnds);
+  shardLine(std::move(line), columnEnds, outFiles, idColumnIndices);
+}
+
+void GenericSharder::shardLine(
+    std::string line,
+    const std::vector<std::size_t>& columnEnds,
+    const std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>>& outFiles,
+    const std::vector<int32_t>& idColumnIndices) {
+  std::string id;
+  if (!prepareLine(line, columnEnds, idColumnIndices, id)) {
     return;
   }
   auto shard = getShardFor(id, outFiles.size());
   logRowsToShard(shard);
+  logCostToShard(shard, detail::estimateCost(line));
+  if (!sortedRows_.empty()) {
+    sortedRows_.at(shard) += line;
+    sortedRows_.at(shard) += '\n';
+    return;
+  }
+  if (!rowGroupWriters_.empty()) {
+    rowGroupWriters_.at(shard)->addCsvLine(line);
+    return;
+  }
   std::string newLine = "\n";
   outFiles.at(shard)->writeString(line);
   outFiles.at(shard)->writeString(newLine);
 }
 
+void GenericSharder::writeToShard(
+    std::size_t shard,
+    const std::string& lines,
+    const std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>>& outFiles) {
+  // Each shard is only written by one thread, so its rows can be held back
+  // without locking
+  if (!sortedRows_.empty()) {
+    sortedRows_.at(shard) += lines;
+    return;
+  }
+  writeLinesToShard(shard, lines, outFiles);
+}
+
+void GenericSharder::writeSortedShard(
+    std::size_t shard,
+    const std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>>& outFiles,
+    const std::vector<int32_t>& idColumnIndices) {
+  auto rows = std::move(sortedRows_.at(shard));
+  // Every row held back was prepared, so it has a non-empty id column
+  std::vector<std::pair<std::string_view, std::string_view>> idsAndRows;
+  std::vector<std::string_view> columns;
+  std::string_view rest{rows};
+  while (!rest.empty()) {
+    auto row = rest.substr(0, rest.find('\n'));
+    rest.remove_prefix(row.size() + 1);
+    columns.clear();
+    for (std::size_t start = 0; start <= row.size();) {
+      auto end = std::min(row.find(',', start), row.size());
+      columns.push_back(row.substr(start, end - start));
+      start = end + 1;
+    }
+    std::string_view id;
+    for (auto idColumnIdx : idColumnIndices) {
+      if (idColumnIdx < columns.size() && !columns.at(idColumnIdx).empty()) {
+        id = columns.at(idColumnIdx);
+        break;
+      }
+    }
+    idsAndRows.emplace_back(id, row);
+  }
+  // Rows with the same id keep the order they were read in
+  std::stable_sort(
+      idsAndRows.begin(), idsAndRows.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+      });
+
+  std::string lines;
+  for (const auto& [id, row] : idsAndRows) {
+    lines += row;
+    lines += '\n';
+    if (lines.size() >= kSortedShardChunkBytes) {
+      writeLinesToShard(shard, lines, outFiles);
+      lines.clear();
+    }
+  }
+  writeLinesToShard(shard, lines, outFiles);
+}
+
+void GenericSharder::writeLinesToShard(
+    std::size_t shard,
+    const std::string& lines,
+    const std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>>& outFiles) {
+  if (rowGroupWriters_.empty()) {
+    outFiles.at(shard)->writeString(lines);
+    return;
+  }
+  auto& writer = *rowGroupWriters_.at(shard);
+  std::string_view rest{lines};
+  while (!rest.empty()) {
+    auto newLine = std::min(rest.find('\n'), rest.size());
+    writer.addCsvLine(rest.substr(0, newLine));
+    rest.remove_prefix(std::min(newLine + 1, rest.size()));
+  }
+}
+
 void GenericSharder::logShardInfo() {
   std::size_t numShards = getOutputPaths().size();
   if (numShards == 0) {
@@ -211,11 +880,32 @@ void GenericSharder::logShardInfo() {
   bWriter->writeString(shardInfoJson);
   bWriter->close();
   XLOG(INFO) << "PID shard info written to: '" << shardInfoPath << "'";
+
+  const std::string& shardCostsPath = outputPath + '_' + "shardCosts";
+  auto costsWriter = std::make_unique<fbpcf::io::BufferedWriter>(
+      std::make_unique<fbpcf::io::FileWriter>(shardCostsPath));
+  std::string shardCostsJson = getShardCostsJson();
+  costsWriter->writeString(shardCostsJson);
+  costsWriter->close();
+  XLOG(INFO) << "Shard cost manifest written to: '" << shardCostsPath << "'";
 }
 
-std::string GenericSharder::getShardInfoJson() {
-  auto pidShardInfoDynamic = folly::toDynamic(pid_shard_info);
+std::string GenericSharder::getShardInfoJson() const {
+  auto pidShardInfoDynamic =
+      folly::dynamic::object(numIds, static_cast<int64_t>(numIds_));
+  for (std::size_t shard = 0; shard < rowsPerShard_.size(); ++shard) {
+    pidShardInfoDynamic[std::to_string(shard)] =
+        static_cast<int64_t>(rowsPerShard_[shard]);
+  }
   std::string shardInfoStr = folly::toPrettyJson(pidShardInfoDynamic);
   return shardInfoStr;
 }
+
+std::string GenericSharder::getShardCostsJson() const {
+  auto costs = folly::dynamic::array();
+  for (std::size_t shard = 0; shard < getOutputPaths().size(); ++shard) {
+    costs.push_back(static_cast<int64_t>(getCostForShard(shard)));
+  }
+  return folly::toPrettyJson(folly::dynamic::object("shard_costs", costs));
+}
 } // namespace data_processing::sharder
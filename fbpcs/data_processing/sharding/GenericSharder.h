@@ -7,15 +7,18 @@
 
 #pragma once
 
+#include <cstdint>
 #include <exception>
 #include <memory>
-#include <sstream>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
+#include <fbpcf/io/api/BufferedReader.h>
 #include <fbpcf/io/api/BufferedWriter.h>
 
+#include "fbpcs/emp_games/common/RowGroupFormat.h"
+
 namespace data_processing::sharder {
 namespace detail {
 /**
@@ -32,10 +35,89 @@ void stripQuotes(std::string& s);
  * @param s the string from which to remove dos line ending characters
  */
 void dos2Unix(std::string& s);
+
+/**
+ * Check whether a line is already normalized, so that normalizeLine would leave
+ * it unchanged: it has no quotes, carriage returns or spaces, and no `null`
+ * column if blankNullColumns is set. The line is scanned with memchr, which is
+ * much faster than normalizing it when the input is already clean.
+ *
+ * @param line the line to check
+ * @param blankNullColumns whether `null` columns would be blanked out
+ * @returns true if normalizing the line wouldn't change it
+ */
+bool isNormalized(std::string_view line, bool blankNullColumns);
+
+/**
+ * Normalize a line in a single pass, modifying it in place. Quotes, carriage
+ * returns and spaces are removed, and if blankNullColumns is set, any column
+ * that is `null` (case insensitive) afterwards is replaced with an empty
+ * column. The end offset of every column of the normalized line is written to
+ * columnEnds, so the line doesn't need to be split again. Lines that are
+ * already normalized are only split.
+ *
+ * @param line the line to normalize
+ * @param columnEnds receives the offset one past the end of each column
+ * @param blankNullColumns whether to blank out `null` columns
+ */
+void normalizeLine(
+    std::string& line,
+    std::vector<std::size_t>& columnEnds,
+    bool blankNullColumns);
+
+/**
+ * Find the end offset of every comma separated column of a line without
+ * modifying it.
+ *
+ * @param line the line to scan
+ * @param columnEnds receives the offset one past the end of each column
+ */
+void findColumnEnds(
+    const std::string& line,
+    std::vector<std::size_t>& columnEnds);
+
+/**
+ * Get a view of a column of a line given its column end offsets.
+ *
+ * @param line the line the offsets were computed for
+ * @param columnEnds the end offsets of the columns of line
+ * @param column the index of the column
+ * @returns a view into line covering the column
+ */
+inline std::string_view getColumn(
+    const std::string& line,
+    const std::vector<std::size_t>& columnEnds,
+    std::size_t column) {
+  auto start = column == 0 ? 0 : columnEnds.at(column - 1) + 1;
+  return std::string_view{line}.substr(start, columnEnds.at(column) - start);
+}
+
+/**
+ * Estimate the cost for the games of running the given newline separated rows,
+ * which grows with the number of rows and with the number of elements in their
+ * array columns, such as the touchpoints or conversions of a user. Each row
+ * costs one, plus one for each element of its arrays.
+ *
+ * @param lines one or more normalized rows, each ending with a newline except
+ *     possibly the last one
+ * @returns the estimated cost of the rows
+ */
+uint64_t estimateCost(std::string_view lines);
+
+/**
+ * Get the part files input paths name. A local directory stands for its part
+ * files in name order, leaving out files whose name starts with '.' or '_'
+ * (such as _SUCCESS). Every part which isn't empty starts with the same
+ * header line.
+ *
+ * @param inputPaths the input file, or the input part files, of the sharder
+ * @returns the paths of the parts, in the order their rows are read
+ */
+std::vector<std::string> getInputParts(
+    const std::vector<std::string>& inputPaths);
 } // namespace detail
 
 constexpr int THREAD_POOL_SIZE = 20;
-constexpr size_t BUFFER_SIZE = 1073741824; // 2^30
 
 /**
  * A class which can shard data from one file into many sub-files.
@@ -56,7 +138,9 @@ class GenericSharder {
       int32_t logEveryN)
       : inputPath_{std::move(inputPath)},
         outputPaths_{std::move(outputPaths)},
-        logEveryN_{logEveryN} {}
+        logEveryN_{logEveryN},
+        rowsPerShard_(outputPaths_.size()),
+        costPerShard_(outputPaths_.size()) {}
 
   /**
    * Create a new GenericSharder from the given input path and output basepath.
@@ -102,9 +186,12 @@ class GenericSharder {
       std::size_t endIndex);
 
   /**
-   * Get a reference to this sharder's input path.
+   * Get a reference to this sharder's input path, which may be a directory
+   * of part files. It is not read when --sharding_input_filenames lists the
+   * part files instead.
    *
    * @returns a reference to this sharder's input path
+   * @see detail::getInputParts
    */
   const std::string& getInputPath() const {
     return inputPath_;
@@ -128,18 +215,49 @@ class GenericSharder {
     return logEveryN_;
   }
 
+  /**
+   * Count a row as written to a shard.
+   *
+   * @param shard the shard the row was written to
+   */
   void logRowsToShard(std::size_t shard) {
-    std::stringstream ss;
-    ss << shard;
-    std::string key = ss.str();
-    pid_shard_info[key]++;
+    if (shard >= rowsPerShard_.size()) {
+      rowsPerShard_.resize(shard + 1);
+    }
+    ++rowsPerShard_[shard];
   }
 
-  int getRowsForShard(std::size_t shard) {
-    std::stringstream ss;
-    ss << shard;
-    std::string key = ss.str();
-    return pid_shard_info[key];
+  /**
+   * Get how many rows have been written to a shard.
+   *
+   * @param shard the shard to look up
+   * @returns the number of rows written to shard
+   */
+  uint64_t getRowsForShard(std::size_t shard) const {
+    return shard < rowsPerShard_.size() ? rowsPerShard_[shard] : 0;
+  }
+
+  /**
+   * Add the estimated cost of rows written to a shard.
+   *
+   * @param shard the shard the rows were written to
+   * @param cost the cost of the rows, as given by detail::estimateCost
+   */
+  void logCostToShard(std::size_t shard, uint64_t cost) {
+    if (shard >= costPerShard_.size()) {
+      costPerShard_.resize(shard + 1);
+    }
+    costPerShard_[shard] += cost;
+  }
+
+  /**
+   * Get the estimated cost of the rows written to a shard.
+   *
+   * @param shard the shard to look up
+   * @returns the estimated cost of running the shard in the games
+   */
+  uint64_t getCostForShard(std::size_t shard) const {
+    return shard < costPerShard_.size() ? costPerShard_[shard] : 0;
   }
 
   /**
@@ -160,32 +278,162 @@ class GenericSharder {
       std::size_t numShards) = 0;
 
   /**
-   * Shard an individual input line. Internally calls `getShardFor` to detect
-   * the correct shard. If the input line needs modified for some reason, the
-   * derived class must override this method.
+   * Whether getShardFor may be called concurrently and in any order. If so,
+   * the pipelined sharder assigns shards on its worker threads, otherwise the
+   * assignment is made on the reader thread in input order.
+   *
+   * @returns true if getShardFor only depends on its arguments
+   */
+  virtual bool isGetShardForThreadSafe() const {
+    return false;
+  }
+
+  /**
+   * Prepare a normalized line to be sharded: find the id it should be sharded
+   * by and apply any changes the derived class needs to make to the line. This
+   * is called concurrently from the worker threads of the pipelined sharder,
+   * so it must not modify the sharder.
+   *
+   * @param line the line to be sharded, which may be modified in place
+   * @param columnEnds the end offset of every column of line
+   * @param idColumnIndices the indices of the id columns
+   * @param id receives the id the line should be sharded by
+   * @returns false if the line should be dropped
+   */
+  virtual bool prepareLine(
+      std::string& line,
+      const std::vector<std::size_t>& columnEnds,
+      const std::vector<int32_t>& idColumnIndices,
+      std::string& id) const;
+
+  /**
+   * Shard an individual input line. Finds the columns of the line and then
+   * calls the overload below.
 
    * @param line the line to be sharded
    * @param outFiles the list of output files to be sharded into
    */
+  void shardLine(
+      std::string line,
+      const std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>>& outFiles,
+      const std::vector<int32_t>& idColumnIndices);
+
+  /**
+   * Shard an individual input line whose columns are already known, as
+   * recorded by detail::normalizeLine. Internally calls `prepareLine` and
+   * then `getShardFor` to detect the correct shard. This is only used when
+   * sharding on a single thread.
+
+   * @param line the line to be sharded
+   * @param columnEnds the end offset of every column of line
+   * @param outFiles the list of output files to be sharded into
+   */
   virtual void shardLine(
       std::string line,
+      const std::vector<std::size_t>& columnEnds,
       const std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>>& outFiles,
       const std::vector<int32_t>& idColumnIndices);
 
   /**
-   * Log number of rows in each shard to a json file
+   * Write newline terminated lines to a shard. When writing the row group
+   * format, the lines are encoded as row groups instead, and when sorting the
+   * shards by id, they are held back until the shard is closed. Lines of
+   * different shards may be written concurrently.
+   *
+   * @param shard the shard to write to
+   * @param lines the lines to write
+   * @param outFiles the list of output files to be sharded into
+   */
+  void writeToShard(
+      std::size_t shard,
+      const std::string& lines,
+      const std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>>& outFiles);
+
+  /**
+   * Log number of rows in each shard to a json file, and the estimated cost of
+   * each shard to a manifest next to it
    */
   void logShardInfo();
 
   /**
    * Return the json string that contains the number of rows in each shard
    */
-  std::string getShardInfoJson();
+  std::string getShardInfoJson() const;
+
+  /**
+   * Return the json string of the cost manifest, which lists the estimated
+   * cost of each shard under "shard_costs" so that the games can run the most
+   * expensive shards first
+   */
+  std::string getShardCostsJson() const;
 
  private:
+  /**
+   * Shard the remaining lines of reader, and the lines of the other parts of
+   * the input, with a pipeline: a reader thread reads batches of lines, a pool
+   * of workers normalize and prepare them, and each output file is written by
+   * a single writer thread fed through a queue. The parts are read one after
+   * another, unless getShardFor is thread safe, in which case several parts
+   * are read at the same time, each by a reader thread of its own.
+   *
+   * @param reader the first part of the input, positioned after the header
+   * @param inputParts the paths of all the parts, the first one included
+   * @param header the normalized header line of the first part, which every
+   *     other part has to start with
+   * @param outFiles the list of output files to be sharded into
+   * @param idColumnIndices the indices of the id columns
+   * @param numWorkers how many threads prepare lines
+   * @returns the number of lines read
+   */
+  uint64_t shardPipelined(
+      fbpcf::io::BufferedReader& reader,
+      const std::vector<std::string>& inputParts,
+      const std::string& header,
+      const std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>>& outFiles,
+      const std::vector<int32_t>& idColumnIndices,
+      std::size_t numWorkers);
+
+  /**
+   * Write the rows held back for a shard sorted by their id, which is the
+   * first non-empty id column of each row. Rows with the same id are written
+   * in the order they were read.
+   *
+   * @param shard the shard to write
+   * @param outFiles the list of output files to be sharded into
+   * @param idColumnIndices the indices of the id columns
+   */
+  void writeSortedShard(
+      std::size_t shard,
+      const std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>>& outFiles,
+      const std::vector<int32_t>& idColumnIndices);
+
+  /**
+   * Write newline terminated lines to a shard as csv or row groups.
+   *
+   * @param shard the shard to write to
+   * @param lines the lines to write
+   * @param outFiles the list of output files to be sharded into
+   */
+  void writeLinesToShard(
+      std::size_t shard,
+      const std::string& lines,
+      const std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>>& outFiles);
+
   std::string inputPath_;
   std::vector<std::string> outputPaths_;
   int32_t logEveryN_;
-  std::unordered_map<std::string, int> pid_shard_info;
+  // Number of rows written to each shard, their estimated cost and the number
+  // of id columns, which are only converted to json when the shard info is
+  // logged
+  std::vector<uint64_t> rowsPerShard_;
+  std::vector<uint64_t> costPerShard_;
+  uint64_t numIds_ = 0;
+  // The encoder of every shard when writing the row group format, and empty
+  // when writing csv
+  std::vector<std::unique_ptr<private_measurement::row_group::RowGroupWriter>>
+      rowGroupWriters_;
+  // The newline terminated rows of every shard when writing the shards sorted
+  // by id, and empty otherwise
+  std::vector<std::string> sortedRows_;
 };
 } // namespace data_processing::sharder
@@ -10,12 +10,16 @@
 #include <arpa/inet.h>
 
 #include <algorithm>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <memory>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include <folly/logging/xlog.h>
@@ -24,9 +28,32 @@
 #include "folly/String.h"
 
 DEFINE_int32(hashing_prime, 37, "Prime number to assist in consistent hashing");
+DEFINE_int32(
+    shard_assignment_version,
+    0,
+    "How ids are assigned to shards - options: 0 hashes the id text with "
+    "--hashing_prime, 1 takes the first little-endian word of the raw 32 byte "
+    "HMAC_SHA256 digest of the id modulo the number of shards, 2 reduces the "
+    "leading 64 bits of the digest to a shard with a multiply and a shift. "
+    "The versions assign different shards, so both parties have to use the "
+    "same one");
 
 namespace data_processing::sharder {
-std::size_t hashString(const std::string& s, uint64_t hashing_prime) {
+ShardAssignmentVersion getShardAssignmentVersion() {
+  switch (FLAGS_shard_assignment_version) {
+    case static_cast<int32_t>(ShardAssignmentVersion::StringHash):
+    case static_cast<int32_t>(ShardAssignmentVersion::DigestModulo):
+    case static_cast<int32_t>(ShardAssignmentVersion::DigestMultiplyShift):
+      return static_cast<ShardAssignmentVersion>(
+          FLAGS_shard_assignment_version);
+    default:
+      throw std::invalid_argument(
+          "Unknown shard assignment version " +
+          std::to_string(FLAGS_shard_assignment_version));
+  }
+}
+
+std::size_t hashString(std::string_view s, uint64_t hashing_prime) {
   std::size_t res = 0;
   for (auto i = 0; i < s.length(); ++i) {
     res = hashing_prime * res + s[i];
@@ -37,50 +64,105 @@ std::size_t hashString(const std::string& s, uint64_t hashing_prime) {
 std::size_t HashBasedSharder::getShardFor(
     const std::string& id,
     std::size_t numShards) {
-  auto hashed = hashString(id, FLAGS_hashing_prime); // returns std::size_t
-  return hashed % numShards;
-}
+  if (version_ == ShardAssignmentVersion::StringHash) {
+    return hashString(id, FLAGS_hashing_prime) % numShards;
+  }
 
-void HashBasedSharder::shardLine(
-    std::string line,
-    const std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>>& outFiles,
-    const std::vector<int32_t>& idColumnIndices) {
-  std::vector<std::string> cols;
-  folly::split(',', line, cols);
+  if (id.empty() || (id.front() != kDigestIdTag && id.front() != kTextIdTag)) {
+    throw std::invalid_argument("Id is not tagged as a digest or a text");
+  }
+  auto untagged = std::string_view{id}.substr(1);
+  if (id.front() == kTextIdTag) {
+    return hashString(untagged, FLAGS_hashing_prime) % numShards;
+  }
+  if (untagged.size() != private_lift::hash_slinging_salter::HashedId::kSize) {
+    throw std::invalid_argument(
+        "Digest id has " + std::to_string(untagged.size()) + " bytes");
+  }
+
+  // A digest is already uniformly distributed, so a word of it is its hash
+  private_lift::hash_slinging_salter::HashedId hashedId;
+  std::memcpy(hashedId.bytes.data(), untagged.data(), untagged.size());
+  if (version_ == ShardAssignmentVersion::DigestModulo) {
+    return hashedId.word(0) % numShards;
+  }
+  // The high word of prefix * numShards is a uniform shard, without the
+  // bias of a modulo towards the first shards or its division
+  return static_cast<std::size_t>(
+      (static_cast<unsigned __int128>(hashedId.prefix()) * numShards) >> 64);
+}
 
-  std::string id = "";
+bool HashBasedSharder::prepareLine(
+    std::string& line,
+    const std::vector<std::size_t>& columnEnds,
+    const std::vector<int32_t>& idColumnIndices,
+    std::string& id) const {
+  // the non-empty id columns and their indices
+  std::vector<std::size_t> idCols;
+  std::vector<std::string_view> ids;
   for (auto idColumnIdx : idColumnIndices) {
-    if (idColumnIdx >= cols.size()) {
+    if (idColumnIdx >= columnEnds.size()) {
       XLOG_EVERY_MS(INFO, 5000)
           << "Discrepancy with header:" << line << " does not have "
           << idColumnIdx << "th column.\n";
-      return;
+      return false;
     }
-    auto& col = cols.at(idColumnIdx);
+    auto col = detail::getColumn(line, columnEnds, idColumnIdx);
     if (!col.empty()) {
-      if (!hmacKey_.empty()) {
-        // If hmacBase64Key is empty, the hashing already happened upstream.
-        // This means we can reinterpret the id as a base64-encoded string.
-        // Otherwise, hash all the id columns.
-        col = private_lift::hash_slinging_salter::base64SaltedHashFromBase64Key(
-            col, hmacKey_);
-      }
-      if (id.empty()) {
-        id = col;
-      }
+      idCols.push_back(static_cast<std::size_t>(idColumnIdx));
+      ids.push_back(col);
     }
   }
-  if (id.empty()) {
+  if (ids.empty()) {
     XLOG_EVERY_MS(INFO, 5000) << "All the id values are empty in this row";
-    return;
+    return false;
+  }
+  // If hmacBase64Key is empty, the hashing already happened upstream.
+  // This means we can reinterpret the id as a base64-encoded string.
+  // Otherwise, hash all the id columns.
+  auto isBinaryId = version_ != ShardAssignmentVersion::StringHash;
+  if (hmacKey_.empty()) {
+    auto hashedId = isBinaryId
+        ? private_lift::hash_slinging_salter::HashedId::fromBase64(ids.front())
+        : std::nullopt;
+    if (!isBinaryId) {
+      id = ids.front();
+    } else if (hashedId.has_value()) {
+      id = makeDigestId(hashedId->view());
+    } else {
+      id = makeTextId(ids.front());
+    }
+    return true;
+  }
+  // The digests are only base64-encoded for the output line
+  std::vector<std::string> hashes;
+  hashes.reserve(ids.size());
+  for (std::size_t i = 0; i < ids.size(); ++i) {
+    auto hashedId = hashers_->hashId(ids.at(i));
+    if (i == 0 && isBinaryId) {
+      id = makeDigestId(hashedId.view());
+    }
+    hashes.push_back(hashedId.toBase64());
+  }
+  if (!isBinaryId) {
+    id = hashes.front();
+  }
+
+  // Rebuild the line with the id columns replaced by their hashes
+  std::string hashedLine;
+  hashedLine.reserve(line.size());
+  for (std::size_t i = 0; i < columnEnds.size(); ++i) {
+    if (i > 0) {
+      hashedLine += ',';
+    }
+    auto idCol = std::find(idCols.begin(), idCols.end(), i);
+    if (idCol != idCols.end()) {
+      hashedLine += hashes.at(idCol - idCols.begin());
+    } else {
+      hashedLine += detail::getColumn(line, columnEnds, i);
+    }
   }
-  auto numShards = outFiles.size();
-  std::size_t shard;
-  shard = getShardFor(id, numShards);
-  std::string lineToWrite = folly::join(",", cols);
-  std::string newLine = "\n";
-  outFiles.at(shard)->writeString(lineToWrite);
-  outFiles.at(shard)->writeString(newLine);
-  logRowsToShard(shard);
+  line = std::move(hashedLine);
+  return true;
 }
 } // namespace data_processing::sharder
@@ -10,9 +10,12 @@
 #include <fstream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <fbpcf/io/api/BufferedWriter.h>
+#include <folly/ThreadLocal.h>
+#include "fbpcs/data_processing/hash_slinging_salter/HashSlingingSalter.hpp"
 #include "fbpcs/data_processing/sharding/GenericSharder.h"
 
 namespace data_processing::sharder {
@@ -21,7 +24,26 @@ namespace data_processing::sharder {
  * Adapted from
  * https://stackoverflow.com/questions/8567238/hash-function-in-c-for-string-to-int
  */
-std::size_t hashString(const std::string& s, uint64_t hashing_prime);
+std::size_t hashString(std::string_view s, uint64_t hashing_prime);
+
+/* The ways of assigning ids to shards. Both parties have to use the same
+ * version, or their rows of the same id end up in different shards. The
+ * versions after StringHash shard by the raw digest of the hashed ids.
+ */
+enum class ShardAssignmentVersion : int32_t {
+  // hashString of the id text, modulo the number of shards
+  StringHash = 0,
+  // The first little-endian word of the digest, modulo the number of shards
+  DigestModulo = 1,
+  // The leading 64 bits of the digest, scaled to the number of shards by a
+  // multiply and a shift
+  DigestMultiplyShift = 2,
+};
+
+/* The version set by --shard_assignment_version. Throws std::invalid_argument
+ * if it is unknown.
+ */
+ShardAssignmentVersion getShardAssignmentVersion();
 
 class HashBasedSharder final : public GenericSharder {
  public:
@@ -43,7 +65,9 @@ class HashBasedSharder final : public GenericSharder {
       int32_t logEveryN,
       std::string hmacKey)
       : GenericSharder{inputPath, outputPaths, logEveryN},
-        hmacKey_{std::move(hmacKey)} {}
+        hmacKey_{std::move(hmacKey)},
+        version_{getShardAssignmentVersion()},
+        hashers_{[this]() { return makeHasher(); }} {}
 
   /**
    * Create a new HashBasedSharder which is able to consistently hash a line
@@ -67,10 +91,36 @@ class HashBasedSharder final : public GenericSharder {
       int32_t logEveryN,
       std::string hmacKey)
       : GenericSharder{inputPath, outputBasePath, startIndex, endIndex, logEveryN},
-        hmacKey_{std::move(hmacKey)} {}
+        hmacKey_{std::move(hmacKey)},
+        version_{getShardAssignmentVersion()},
+        hashers_{[this]() { return makeHasher(); }} {}
 
   /**
-   * Get the correct shard associated with a string.
+   * With a digest shard assignment version, the ids prepareLine hands to
+   * getShardFor start with one of these tags, which marks the rest as the raw
+   * digest of a hashed id or as the text of an id which isn't one. The kind of
+   * an id is then never inferred from its size.
+   */
+  static constexpr char kDigestIdTag = 'd';
+  static constexpr char kTextIdTag = 't';
+
+  static std::string makeDigestId(std::string_view digest) {
+    std::string id{kDigestIdTag};
+    id.append(digest);
+    return id;
+  }
+
+  static std::string makeTextId(std::string_view text) {
+    std::string id{kTextIdTag};
+    id.append(text);
+    return id;
+  }
+
+  /**
+   * Get the correct shard associated with a string. With a digest shard
+   * assignment version, the id has to be tagged, see kDigestIdTag, and the
+   * raw 32 byte digest of a hashed id is sharded by its words. Throws
+   * std::invalid_argument on an untagged id or a digest of the wrong size.
    *
    * @param id the id to be sharded
    * @param numShards the total number of shards being created
@@ -79,18 +129,48 @@ class HashBasedSharder final : public GenericSharder {
   std::size_t getShardFor(const std::string& id, std::size_t numShards) final;
 
   /**
-   * Shard an input line by hashing each identifier into an int32_t first using
-   * a hashing method that works on both big- and little-endian machines.
+   * The shard of an id only depends on the id itself, so shards can be
+   * assigned concurrently.
    *
-   * @param line the line to be sharded
-   * @param outFiles the list of output files to be sharded into
+   * @returns true
    */
-  void shardLine(
-      std::string line,
-      const std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>>& outFiles,
-      const std::vector<int32_t>& idColumnIndices) final;
+  bool isGetShardForThreadSafe() const final {
+    return true;
+  }
+
+  /**
+   * Prepare an input line by hashing each identifier with the HMAC key first,
+   * if there is one. The line is sharded by its first non-empty identifier,
+   * after hashing, using a hashing method that works on both big- and
+   * little-endian machines. With a digest shard assignment version, the line
+   * is sharded by the raw digest of its hashed id, which is only
+   * base64-encoded in the line, and id is tagged with its kind.
+   *
+   * @param line the line to be sharded, with its ids replaced by their hashes
+   * @param columnEnds the end offset of every column of line
+   * @param idColumnIndices the indices of the id columns
+   * @param id receives the id the line should be sharded by
+   * @returns false if the line should be dropped
+   */
+  bool prepareLine(
+      std::string& line,
+      const std::vector<std::size_t>& columnEnds,
+      const std::vector<int32_t>& idColumnIndices,
+      std::string& id) const final;
 
  private:
+  private_lift::hash_slinging_salter::SaltedHasher* makeHasher() const {
+    return new private_lift::hash_slinging_salter::SaltedHasher{
+        private_lift::hash_slinging_salter::SaltedHasher::fromBase64Key(
+            hmacKey_)};
+  }
+
   std::string hmacKey_;
+  // Read from --shard_assignment_version when the sharder is created
+  ShardAssignmentVersion version_;
+  // Every thread preparing lines hashes ids with its own context, so the key
+  // is only set up once per thread
+  mutable folly::ThreadLocal<private_lift::hash_slinging_salter::SaltedHasher>
+      hashers_;
 };
 } // namespace data_processing::sharder
@@ -7,14 +7,51 @@
 
 #include "fbpcs/data_processing/sharding/SecureRandomSharder.h"
 
+#include <cstdint>
+#include <limits>
+#include <vector>
+
 namespace data_processing::sharder {
 
 std::size_t SecureRandomSharder::getShardFor(
     const std::string& /* unused */,
     std::size_t /* unused */) {
-  auto randomBytes = prg_->getRandomBytes(sizeof(uint32_t) + sizeof(__m128i));
-  auto position = fbpcf::engine::util::mod(randomBytes, numShards_, ctx_);
-  return position;
+  if (nextShard_ == shards_.size()) {
+    drawShards();
+  }
+  return shards_[nextShard_++];
+}
+
+void SecureRandomSharder::drawShards() {
+  auto randomBytes =
+      prg_->getRandomBytes(kShardDrawBatchSize * kBytesPerShardDraw);
+  shards_.resize(kShardDrawBatchSize);
+  nextShard_ = 0;
+
+  if (numShards_ > std::numeric_limits<uint32_t>::max()) {
+    for (std::size_t i = 0; i < kShardDrawBatchSize; ++i) {
+      auto begin = randomBytes.begin() + i * kBytesPerShardDraw;
+      std::vector<unsigned char> draw(begin, begin + kBytesPerShardDraw);
+      shards_[i] = fbpcf::engine::util::mod(draw, numShards_, ctx_);
+    }
+    return;
+  }
+
+  // Reduce every draw as a big-endian integer, 32 bits at a time. As the
+  // remainder is below 2^32, each step fits in 64 bit arithmetic, which avoids
+  // a BIGNUM per row.
+  static_assert(kBytesPerShardDraw % sizeof(uint32_t) == 0);
+  for (std::size_t i = 0; i < kShardDrawBatchSize; ++i) {
+    const auto* draw = randomBytes.data() + i * kBytesPerShardDraw;
+    uint64_t remainder = 0;
+    for (std::size_t j = 0; j < kBytesPerShardDraw; j += sizeof(uint32_t)) {
+      uint64_t word = (uint64_t{draw[j]} << 24) |
+          (uint64_t{draw[j + 1]} << 16) | (uint64_t{draw[j + 2]} << 8) |
+          uint64_t{draw[j + 3]};
+      remainder = ((remainder << 32) | word) % numShards_;
+    }
+    shards_[i] = remainder;
+  }
 }
 
 } // namespace data_processing::sharder
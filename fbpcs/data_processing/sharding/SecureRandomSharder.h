@@ -74,7 +74,9 @@ class SecureRandomSharder final : public GenericSharder {
   }
 
   /**
-   * Determine which shard a line should go to given an id.
+   * Determine which shard a line should go to given an id. The shards are
+   * drawn from the prg in batches, so this usually just returns the next
+   * precomputed shard.
    *
    * @param id the identifier representing the line to be sharded
    * @param numShards the number of shards to be considered
@@ -83,9 +85,23 @@ class SecureRandomSharder final : public GenericSharder {
   std::size_t getShardFor(const std::string& id, std::size_t numShards) final;
 
  private:
+  // Number of shards drawn from the prg at once
+  static constexpr std::size_t kShardDrawBatchSize = 4096;
+  // Number of random bytes reduced to each shard. They are far more than the
+  // bits of numShards_, so the reduction is uniform up to a negligible bias.
+  static constexpr std::size_t kBytesPerShardDraw =
+      sizeof(uint32_t) + sizeof(__m128i);
+
+  /**
+   * Draw the next batch of shards from the prg.
+   */
+  void drawShards();
+
   std::unique_ptr<fbpcf::engine::util::IPrg> prg_;
   BN_CTX* ctx_;
   size_t numShards_;
+  std::vector<std::size_t> shards_;
+  std::size_t nextShard_ = 0;
 };
 
 } // namespace data_processing::sharder
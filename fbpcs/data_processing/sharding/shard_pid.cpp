@@ -13,7 +13,11 @@
 
 #include "fbpcs/data_processing/sharding/Sharding.h"
 
-DEFINE_string(input_filename, "", "Name of the input file");
+DEFINE_string(
+    input_filename,
+    "",
+    "Name of the input file. A local directory of part files is sharded in "
+    "one run, as is a list of them given by --sharding_input_filenames");
 DEFINE_string(
     output_filenames,
     "",
@@ -32,12 +32,13 @@ class GenericSharderTest final : public GenericSharder {
 
   void shardLine(
       std::string line,
+      const std::vector<std::size_t>& /* unused */,
       const std::vector<
           std::unique_ptr<fbpcf::io::BufferedWriter>>& /* unused */,
       const std::vector<int32_t>& /* unused */) final {
     linesCalledWith_.push_back(line);
     // shardLine is overwritten here so we should mannually call the
-    // logRowsToShard to make changes to pid_shard_info.
+    // logRowsToShard to count the row.
     std::size_t s = {0};
     logRowsToShard(s);
   }
@@ -72,6 +73,56 @@ TEST(GenericSharderTest, TestDos2Unix) {
   EXPECT_EQ(lineNoNewline, "hello world");
 }
 
+TEST(GenericSharderTest, TestNormalizeLine) {
+  std::vector<std::size_t> columnEnds;
+
+  std::string line{"\"abc\", 'd e' ,NuLl,null1,\r"};
+  detail::normalizeLine(line, columnEnds, true);
+  EXPECT_EQ(line, "abc,de,,null1,");
+  EXPECT_EQ(columnEnds, std::vector<std::size_t>({3, 6, 7, 13, 14}));
+  EXPECT_EQ(detail::getColumn(line, columnEnds, 1), "de");
+  EXPECT_EQ(detail::getColumn(line, columnEnds, 2), "");
+  EXPECT_EQ(detail::getColumn(line, columnEnds, 3), "null1");
+
+  std::string nulls{"null,NULL,'null'"};
+  detail::normalizeLine(nulls, columnEnds, true);
+  EXPECT_EQ(nulls, ",,");
+  EXPECT_EQ(columnEnds, std::vector<std::size_t>({0, 1, 2}));
+
+  std::string header{"id_,null"};
+  detail::normalizeLine(header, columnEnds, false);
+  EXPECT_EQ(header, "id_,null");
+  EXPECT_EQ(columnEnds, std::vector<std::size_t>({3, 8}));
+}
+
+TEST(GenericSharderTest, TestIsNormalized) {
+  EXPECT_TRUE(detail::isNormalized("", true));
+  EXPECT_TRUE(detail::isNormalized("abc,123,,[1,2]", true));
+  EXPECT_TRUE(detail::isNormalized("null1,lnull,nul", true));
+  EXPECT_TRUE(detail::isNormalized("id_,null", false));
+  EXPECT_FALSE(detail::isNormalized("abc,NuLl,1", true));
+  EXPECT_FALSE(detail::isNormalized("null", true));
+  EXPECT_FALSE(detail::isNormalized("\"abc\",1", false));
+  EXPECT_FALSE(detail::isNormalized("'abc',1", false));
+  EXPECT_FALSE(detail::isNormalized("abc, 1", false));
+  EXPECT_FALSE(detail::isNormalized("abc,1\r", false));
+
+  // A normalized line is only split
+  std::vector<std::size_t> columnEnds;
+  std::string line{"abc,,null1"};
+  detail::normalizeLine(line, columnEnds, true);
+  EXPECT_EQ(line, "abc,,null1");
+  EXPECT_EQ(columnEnds, std::vector<std::size_t>({3, 4, 10}));
+}
+
+TEST(GenericSharderTest, TestEstimateCost) {
+  EXPECT_EQ(detail::estimateCost(""), 0);
+  EXPECT_EQ(detail::estimateCost("abc,1,2"), 1);
+  // Each row costs one, plus one for each element of its arrays
+  EXPECT_EQ(detail::estimateCost("abc,[1,2,3],[4,5,6]\n"), 7);
+  EXPECT_EQ(detail::estimateCost("abc,[],5\ndef,[7],8\nghi,9"), 4);
+}
+
 TEST(GenericSharderTest, TestGenOutputPaths) {
   std::string basePath = "/tmp";
   std::size_t start = 0;
@@ -116,6 +167,21 @@ TEST(GenericSharderTest, TestGetShardFor) {
   EXPECT_EQ(actualShard, actual.shardFor_);
 }
 
+TEST(GenericSharderTest, TestLogRowsToShard) {
+  std::vector<std::string> outputPaths{"/tmp_0", "/tmp_1"};
+  int32_t logEveryN = 123;
+  GenericSharderTest actual{"/tmp", outputPaths, logEveryN};
+  actual.logRowsToShard(1);
+  actual.logRowsToShard(1);
+  // Shards past the output paths are counted as well
+  actual.logRowsToShard(3);
+  EXPECT_EQ(actual.getRowsForShard(0), 0);
+  EXPECT_EQ(actual.getRowsForShard(1), 2);
+  EXPECT_EQ(actual.getRowsForShard(2), 0);
+  EXPECT_EQ(actual.getRowsForShard(3), 1);
+  EXPECT_EQ(actual.getRowsForShard(4), 0);
+}
+
 TEST(GenericSharderTest, TestShardLine) {
   // This test is just ensuring that internally, shardLine is being called for
   // each line of input except the header.
@@ -170,7 +236,7 @@ TEST(GenericSharderTest, TestGetShardInfoJson) {
   // There are 2 output paths, so there will be two shards.
   // Since there are 4 rows in the input file, the shardLine() is called for 4
   // times. logRowsToShard(0) is also called for 4 times. Thus, the first pair
-  // in json should be "0":4. As pid_shard_info[1] is never specified, it should
+  // in json should be "0":4. As shard 1 never gets a row, it should
   // be a default 0, thus the second pair should be "1":0.
   std::string expected{
       "{\n  \"0\": 4,\n  \"1\": 0,\n  \"num_ids\": 1\n}",
@@ -178,4 +244,17 @@ TEST(GenericSharderTest, TestGetShardInfoJson) {
   EXPECT_EQ(actual.getShardInfoJson(), expected);
 }
 
+TEST(GenericSharderTest, TestGetShardCostsJson) {
+  std::vector<std::string> outputPaths{"/tmp/a", "/tmp/b", "/tmp/c"};
+  GenericSharderTest sharder{"", outputPaths, 123};
+  sharder.logCostToShard(0, 5);
+  sharder.logCostToShard(2, 3);
+  sharder.logCostToShard(0, 2);
+  EXPECT_EQ(sharder.getCostForShard(0), 7);
+  EXPECT_EQ(sharder.getCostForShard(5), 0);
+  std::string expected{
+      "{\n  \"shard_costs\": [\n    7,\n    0,\n    3\n  ]\n}"};
+  EXPECT_EQ(sharder.getShardCostsJson(), expected);
+}
+
 } // namespace data_processing::sharder
@@ -5,17 +5,23 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <fbpcf/io/api/BufferedWriter.h>
 #include <fbpcf/io/api/FileWriter.h>
 #include <folly/Random.h>
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
 #include "fbpcs/data_processing/sharding/HashBasedSharder.h"
 #include "fbpcs/data_processing/test_utils/FileIOTestUtils.h"
 
+DECLARE_int32(hashing_prime);
+DECLARE_int32(shard_assignment_version);
+
 namespace data_processing::sharder {
 TEST(HashBasedSharderTest, TestGetShardFor) {
   HashBasedSharder sharder{"unused", {/* unused */}, 123, ""};
@@ -25,6 +31,43 @@ TEST(HashBasedSharderTest, TestGetShardFor) {
   EXPECT_EQ(sharder.getShardFor(key, 1), 0);
 }
 
+TEST(HashBasedSharderTest, TestGetShardForBinaryId) {
+  auto hashedId = private_lift::hash_slinging_salter::HashedId::fromBase64(
+      "9BX9ClsYtFj3L8N023K3mJnw1vemIGqenY5vfAY0/cg=");
+  ASSERT_TRUE(hashedId.has_value());
+  auto id = HashBasedSharder::makeDigestId(hashedId->view());
+  auto textId = HashBasedSharder::makeTextId("abcd");
+  // A text id which happens to have the size of a digest
+  auto digestSizedTextId = HashBasedSharder::makeTextId(hashedId->view());
+
+  FLAGS_shard_assignment_version = 1;
+  HashBasedSharder moduloSharder{"unused", {/* unused */}, 123, ""};
+  // The first little-endian word of the digest is 6391760550451025396
+  EXPECT_EQ(moduloSharder.getShardFor(id, 123), 53);
+  // Text ids are still hashed as strings, whatever their size
+  EXPECT_EQ(moduloSharder.getShardFor(textId, 123), 25);
+  EXPECT_EQ(
+      moduloSharder.getShardFor(digestSizedTextId, 123),
+      hashString(hashedId->view(), FLAGS_hashing_prime) % 123);
+  EXPECT_THROW(moduloSharder.getShardFor("abcd", 123), std::invalid_argument);
+  EXPECT_THROW(
+      moduloSharder.getShardFor(HashBasedSharder::makeDigestId("abcd"), 123),
+      std::invalid_argument);
+
+  FLAGS_shard_assignment_version = 2;
+  HashBasedSharder multiplyShiftSharder{"unused", {/* unused */}, 123, ""};
+  // The leading 64 bits of the digest are 0xf415fd0a5b18b458
+  EXPECT_EQ(multiplyShiftSharder.getShardFor(id, 123), 117);
+  EXPECT_EQ(multiplyShiftSharder.getShardFor(id, 1), 0);
+  EXPECT_EQ(multiplyShiftSharder.getShardFor(textId, 123), 25);
+
+  FLAGS_shard_assignment_version = 3;
+  EXPECT_THROW(
+      HashBasedSharder("unused", {/* unused */}, 123, ""),
+      std::invalid_argument);
+  FLAGS_shard_assignment_version = 0;
+}
+
 TEST(HashBasedSharderTest, TestShardLineNoHmacKey) {
   std::string line = "abcd,1,2,3";
   std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>> streams(0);
@@ -131,6 +174,87 @@ TEST(HashBasedSharderTest, TestShardMultiKeyLineWithHmacKey) {
       outputPaths.at(1), expected1);
 }
 
+TEST(HashBasedSharderTest, TestShardLineByBinaryId) {
+  // Hashing the id in the sharder and reading an id hashed upstream shard the
+  // line the same way, by the digest and not by its base64 text
+  for (auto [version, hmacKey] :
+       std::vector<std::pair<int32_t, std::string>>{
+           {1, "abcd1234"}, {1, ""}, {2, "abcd1234"}, {2, ""}}) {
+    std::string line = hmacKey.empty()
+        ? "9BX9ClsYtFj3L8N023K3mJnw1vemIGqenY5vfAY0/cg=,1,2,3"
+        : "abcd,1,2,3";
+    std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>> streams(0);
+    std::vector<std::string> outputPaths;
+    auto randStart = folly::Random::secureRand64();
+    for (auto i = 0; i < 3; ++i) {
+      outputPaths.push_back(
+          "/tmp/HashBasedSharderTestShardOutput" +
+          std::to_string(randStart + i));
+      streams.push_back(std::make_unique<fbpcf::io::BufferedWriter>(
+          std::make_unique<fbpcf::io::FileWriter>(outputPaths.back())));
+    }
+
+    FLAGS_shard_assignment_version = version;
+    HashBasedSharder sharder{"unused", outputPaths, 123, hmacKey};
+    std::vector<int32_t> idColumnIndices{0};
+    sharder.shardLine(line, streams, idColumnIndices);
+    FLAGS_shard_assignment_version = 0;
+
+    for (auto& stream : streams) {
+      stream->close();
+    }
+
+    // Both versions put the digest in shard 2, the base64 text would go to
+    // shard 1
+    std::vector<std::string> expected{
+        "9BX9ClsYtFj3L8N023K3mJnw1vemIGqenY5vfAY0/cg=,1,2,3"};
+    std::vector<std::string> expectedEmpty{};
+    data_processing::test_utils::expectFileRowsEqual(
+        outputPaths.at(0), expectedEmpty);
+    data_processing::test_utils::expectFileRowsEqual(
+        outputPaths.at(1), expectedEmpty);
+    data_processing::test_utils::expectFileRowsEqual(
+        outputPaths.at(2), expected);
+  }
+}
+
+TEST(HashBasedSharderTest, TestShardLineByDigestSizedTextId) {
+  // An id which isn't a base64 digest is sharded by its text, even when it
+  // has the size of a raw digest
+  std::string textId = "abcdefghijklmnopqrstuvwxyz012345";
+  ASSERT_EQ(
+      textId.size(), private_lift::hash_slinging_salter::HashedId::kSize);
+  std::string line = textId + ",1,2,3";
+  std::vector<std::unique_ptr<fbpcf::io::BufferedWriter>> streams(0);
+  std::vector<std::string> outputPaths;
+  auto randStart = folly::Random::secureRand64();
+  for (auto i = 0; i < 3; ++i) {
+    outputPaths.push_back(
+        "/tmp/HashBasedSharderTestShardOutput" +
+        std::to_string(randStart + i));
+    streams.push_back(std::make_unique<fbpcf::io::BufferedWriter>(
+        std::make_unique<fbpcf::io::FileWriter>(outputPaths.back())));
+  }
+
+  FLAGS_shard_assignment_version = 1;
+  HashBasedSharder sharder{"unused", outputPaths, 123, ""};
+  std::vector<int32_t> idColumnIndices{0};
+  sharder.shardLine(line, streams, idColumnIndices);
+  FLAGS_shard_assignment_version = 0;
+
+  for (auto& stream : streams) {
+    stream->close();
+  }
+
+  auto expectedShard = hashString(textId, FLAGS_hashing_prime) % 3;
+  std::vector<std::string> expected{line};
+  std::vector<std::string> expectedEmpty{};
+  for (std::size_t i = 0; i < outputPaths.size(); ++i) {
+    data_processing::test_utils::expectFileRowsEqual(
+        outputPaths.at(i), i == expectedShard ? expected : expectedEmpty);
+  }
+}
+
 TEST(HashBasedSharderTest, TestShardNoHmacKey) {
   std::vector<std::string> rows{
       "id_,a,b,c",
@@ -5,19 +5,37 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <filesystem>
+#include <fstream>
 #include <limits>
+#include <sstream>
 #include <string>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
+#include <folly/Format.h>
 #include <folly/Random.h>
 #include <folly/String.h>
 
 #include "fbpcf/engine/communication/SocketPartyCommunicationAgent.h"
 #include "fbpcf/engine/communication/test/AgentFactoryCreationHelper.h"
+#include "fbpcs/data_processing/sharding/GenericSharder.h"
 #include "fbpcs/data_processing/sharding/Sharding.h"
 #include "fbpcs/data_processing/test_utils/FileIOTestUtils.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
+#include "fbpcs/emp_games/common/RowGroupFormat.h"
+
+DECLARE_int32(sharding_threads);
+DECLARE_int32(sharding_writer_threads);
+DECLARE_int64(sharding_output_buffer_bytes);
+DECLARE_int64(sharding_writer_queue_bytes);
+DECLARE_string(sharding_output_format);
+DECLARE_string(sharding_output_compression);
+DECLARE_bool(sharding_sort_by_id);
+DECLARE_int32(sharding_reader_threads);
+DECLARE_string(sharding_input_filenames);
 
 using namespace data_processing::sharder;
 
@@ -134,10 +152,251 @@ TEST(ShardTest, RunWithOutputBasePath) {
       outputFilenames.at(1), expectedOutBasic.at(1));
 }
 
+TEST(ShardTest, RunPipelinedWithOutputFilenames) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_sharding_threads = 4;
+  auto rand =
+      folly::Random::secureRand64() % std::numeric_limits<int32_t>::max();
+  std::string inputPath =
+      "/tmp/ShardTest_RunPipelinedWithOutputFilenames_in" +
+      std::to_string(rand);
+  data_processing::test_utils::writeVecToFile(inputLines, inputPath);
+
+  std::string outputBasePath =
+      "/tmp/ShardTest_RunPipelinedWithOutputFilenames_out_";
+  std::vector<std::string> outputFilenames{
+      outputBasePath + std::to_string(rand),
+      outputBasePath + std::to_string(rand + 1),
+  };
+
+  auto outputFilenamesStr = folly::join(',', outputFilenames);
+
+  runShard(inputPath, outputFilenamesStr, "", 0, 2, 1'000'000);
+  data_processing::test_utils::expectFileRowsEqual(
+      outputFilenames.at(0), expectedOutBasic.at(0));
+  data_processing::test_utils::expectFileRowsEqual(
+      outputFilenames.at(1), expectedOutBasic.at(1));
+}
+
+TEST(ShardTest, RunPipelinedWithSmallWriteBuffers) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_sharding_threads = 4;
+  // Force the reader to wait for the writers after every chunk, and the
+  // outputs to be flushed every few rows
+  FLAGS_sharding_writer_threads = 1;
+  FLAGS_sharding_output_buffer_bytes = 16;
+  FLAGS_sharding_writer_queue_bytes = 1;
+  auto rand =
+      folly::Random::secureRand64() % std::numeric_limits<int32_t>::max();
+  std::string inputPath =
+      "/tmp/ShardTest_RunPipelinedWithSmallWriteBuffers_in" +
+      std::to_string(rand);
+  data_processing::test_utils::writeVecToFile(inputLines, inputPath);
+
+  std::string outputBasePath =
+      "/tmp/ShardTest_RunPipelinedWithSmallWriteBuffers_out_";
+  std::vector<std::string> outputFilenames{
+      outputBasePath + std::to_string(rand),
+      outputBasePath + std::to_string(rand + 1),
+  };
+
+  auto outputFilenamesStr = folly::join(',', outputFilenames);
+
+  runShard(inputPath, outputFilenamesStr, "", 0, 2, 1'000'000);
+  data_processing::test_utils::expectFileRowsEqual(
+      outputFilenames.at(0), expectedOutBasic.at(0));
+  data_processing::test_utils::expectFileRowsEqual(
+      outputFilenames.at(1), expectedOutBasic.at(1));
+}
+
+TEST(ShardTest, RunWithSortById) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_sharding_sort_by_id = true;
+  // With the rows read in reverse, every shard gets the rows of the other one
+  // in reverse, and writes them back sorted
+  std::vector<std::string> reversedInputLines{inputLines.front()};
+  reversedInputLines.insert(
+      reversedInputLines.end(), inputLines.rbegin(), inputLines.rend() - 1);
+  for (int32_t threads : {1, 4}) {
+    FLAGS_sharding_threads = threads;
+    auto rand =
+        folly::Random::secureRand64() % std::numeric_limits<int32_t>::max();
+    std::string inputPath =
+        "/tmp/ShardTest_RunWithSortById_in" + std::to_string(rand);
+    data_processing::test_utils::writeVecToFile(reversedInputLines, inputPath);
+
+    std::string outputBasePath = "/tmp/ShardTest_RunWithSortById_out_";
+    std::vector<std::string> outputFilenames{
+        outputBasePath + std::to_string(rand),
+        outputBasePath + std::to_string(rand + 1),
+    };
+
+    runShard(inputPath, folly::join(',', outputFilenames), "", 0, 2, 1'000'000);
+    data_processing::test_utils::expectFileRowsEqual(
+        outputFilenames.at(0), expectedOutBasic.at(1));
+    data_processing::test_utils::expectFileRowsEqual(
+        outputFilenames.at(1), expectedOutBasic.at(0));
+  }
+}
+
+// Decodes a shard written in the row group format back to csv rows
+static std::vector<std::string> readRowGroupRows(const std::string& path) {
+  namespace row_group = private_measurement::row_group;
+  std::ifstream file{path, std::ios::binary};
+  row_group::RowGroupReader reader{row_group::streamSource(file)};
+  std::vector<std::string> rows{folly::join(',', reader.getHeader())};
+  row_group::RowGroup group;
+  while (reader.next(group)) {
+    for (std::size_t row = 0; row < group.numRows; ++row) {
+      std::string line;
+      for (std::size_t column = 0; column < reader.getSchema().size();
+           ++column) {
+        if (column > 0) {
+          line += ',';
+        }
+        row_group::appendCsvCell(reader.getSchema(), group, column, row, line);
+      }
+      rows.push_back(line);
+    }
+  }
+  return rows;
+}
+
+TEST(ShardTest, RunWithRowGroupOutput) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_sharding_output_format = "row_group";
+  for (int32_t threads : {1, 4}) {
+    FLAGS_sharding_threads = threads;
+    auto rand =
+        folly::Random::secureRand64() % std::numeric_limits<int32_t>::max();
+    std::string inputPath =
+        "/tmp/ShardTest_RunWithRowGroupOutput_in" + std::to_string(rand);
+    data_processing::test_utils::writeVecToFile(inputLines, inputPath);
+
+    std::string outputBasePath = "/tmp/ShardTest_RunWithRowGroupOutput_out_";
+    std::vector<std::string> outputFilenames{
+        outputBasePath + std::to_string(rand),
+        outputBasePath + std::to_string(rand + 1),
+    };
+
+    auto outputFilenamesStr = folly::join(',', outputFilenames);
+    runShard(inputPath, outputFilenamesStr, "", 0, 2, 1'000'000);
+    EXPECT_EQ(readRowGroupRows(outputFilenames.at(0)), expectedOutBasic.at(0));
+    EXPECT_EQ(readRowGroupRows(outputFilenames.at(1)), expectedOutBasic.at(1));
+  }
+}
+
+TEST(ShardTest, RunWithCompressedOutput) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_sharding_output_compression = "zstd";
+  auto rand =
+      folly::Random::secureRand64() % std::numeric_limits<int32_t>::max();
+  std::string inputPath =
+      "/tmp/ShardTest_RunWithCompressedOutput_in" + std::to_string(rand);
+  data_processing::test_utils::writeVecToFile(inputLines, inputPath);
+
+  std::string outputBasePath = "/tmp/ShardTest_RunWithCompressedOutput_out_";
+  std::vector<std::string> outputFilenames{
+      outputBasePath + std::to_string(rand),
+      outputBasePath + std::to_string(rand + 1),
+  };
+
+  auto outputFilenamesStr = folly::join(',', outputFilenames);
+  runShard(inputPath, outputFilenamesStr, "", 0, 2, 1'000'000);
+  for (std::size_t i = 0; i < outputFilenames.size(); ++i) {
+    std::istringstream content{
+        private_measurement::compressed_io::readFile(outputFilenames.at(i))};
+    std::vector<std::string> rows;
+    for (std::string row; std::getline(content, row);) {
+      rows.push_back(row);
+    }
+    EXPECT_EQ(rows, expectedOutBasic.at(i));
+  }
+
+  // A compressed shard is decompressed when it is sharded again
+  FLAGS_sharding_output_compression = "none";
+  std::string reshardedPath =
+      "/tmp/ShardTest_RunWithCompressedOutput_resharded_" +
+      std::to_string(rand);
+  runShard(outputFilenames.at(0), reshardedPath, "", 0, 1, 1'000'000);
+  data_processing::test_utils::expectFileRowsEqual(
+      reshardedPath, expectedOutBasic.at(0));
+}
+
 TEST(ShardTest, RunWithNoOutputFatal) {
   ASSERT_DEATH(runShard("/test/input", "", "", 0, 0, 0), "Error");
 }
 
+// Writes the rows of inputLines to numParts part files of a new directory,
+// each starting with the header, along with an empty part and a _SUCCESS file
+// which aren't parts. Returns the directory.
+static std::string writeInputParts(const std::string& name, int numParts) {
+  auto rand =
+      folly::Random::secureRand64() % std::numeric_limits<int32_t>::max();
+  std::string directory = "/tmp/" + name + "_parts_" + std::to_string(rand);
+  std::filesystem::create_directories(directory);
+  auto numRows = inputLines.size() - 1;
+  for (int part = 0; part < numParts; ++part) {
+    std::vector<std::string> partLines{inputLines.front()};
+    partLines.insert(
+        partLines.end(),
+        inputLines.begin() + 1 + part * numRows / numParts,
+        inputLines.begin() + 1 + (part + 1) * numRows / numParts);
+    data_processing::test_utils::writeVecToFile(
+        partLines, folly::sformat("{}/part-{:05d}", directory, part));
+  }
+  std::ofstream{folly::sformat("{}/part-{:05d}", directory, numParts)};
+  std::ofstream{directory + "/_SUCCESS"};
+  return directory;
+}
+
+TEST(ShardTest, RunWithInputParts) {
+  gflags::FlagSaver flagSaver;
+  auto directory = writeInputParts("ShardTest_RunWithInputParts", 3);
+  auto parts = detail::getInputParts({directory});
+  ASSERT_EQ(4, parts.size());
+  EXPECT_EQ(directory + "/part-00000", parts.at(0));
+  EXPECT_EQ(parts, detail::getInputParts(parts));
+
+  // Round robin shards are assigned in input order, so the parts are read as
+  // if they had been concatenated, whether the input is their directory or a
+  // list of them
+  std::vector<std::string> outputFilenames{
+      directory + "_out_0", directory + "_out_1"};
+  runShard(directory, folly::join(',', outputFilenames), "", 0, 2, 1'000'000);
+  data_processing::test_utils::expectFileRowsEqual(
+      outputFilenames.at(0), expectedOutBasic.at(0));
+  data_processing::test_utils::expectFileRowsEqual(
+      outputFilenames.at(1), expectedOutBasic.at(1));
+
+  // The header is taken from the first part which isn't empty
+  std::vector<std::string> listedParts{parts.back()};
+  listedParts.insert(listedParts.end(), parts.begin(), parts.end());
+  FLAGS_sharding_input_filenames = folly::join(',', listedParts);
+  runShard("", folly::join(',', outputFilenames), "", 0, 2, 1'000'000);
+  data_processing::test_utils::expectFileRowsEqual(
+      outputFilenames.at(0), expectedOutBasic.at(0));
+  data_processing::test_utils::expectFileRowsEqual(
+      outputFilenames.at(1), expectedOutBasic.at(1));
+}
+
+TEST(ShardTest, RunWithCommaInInputFilename) {
+  auto rand =
+      folly::Random::secureRand64() % std::numeric_limits<int32_t>::max();
+  auto basePath = "/tmp/ShardTest_RunWithCommaInInputFilename_" +
+      std::to_string(rand);
+  auto inputPath = basePath + "_input,with_comma";
+  data_processing::test_utils::writeVecToFile(inputLines, inputPath);
+  std::vector<std::string> outputFilenames{
+      basePath + "_out_0", basePath + "_out_1"};
+
+  runShard(inputPath, folly::join(',', outputFilenames), "", 0, 2, 1'000'000);
+  data_processing::test_utils::expectFileRowsEqual(
+      outputFilenames.at(0), expectedOutBasic.at(0));
+  data_processing::test_utils::expectFileRowsEqual(
+      outputFilenames.at(1), expectedOutBasic.at(1));
+}
+
 TEST(ShardPidTest, RunWithOutputFilenames) {
   auto rand =
       folly::Random::secureRand64() % std::numeric_limits<int32_t>::max();
@@ -185,6 +444,31 @@ TEST(ShardPidTest, RunWithOutputBasePath) {
       outputFilenames.at(1), expectedOutPid.at(1));
 }
 
+TEST(ShardPidTest, RunPipelinedWithOutputFilenames) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_sharding_threads = 4;
+  auto rand =
+      folly::Random::secureRand64() % std::numeric_limits<int32_t>::max();
+  std::string inputPath =
+      "/tmp/ShardPidTest_RunPipelinedWithOutputFilenames_in" +
+      std::to_string(rand);
+  data_processing::test_utils::writeVecToFile(inputLines, inputPath);
+
+  std::string outputBasePath =
+      "/tmp/ShardPidTest_RunPipelinedWithOutputFilenames_out_";
+  std::vector<std::string> outputFilenames{
+      outputBasePath + std::to_string(rand),
+      outputBasePath + std::to_string(rand + 1),
+  };
+
+  auto outputFilenamesStr = folly::join(',', outputFilenames);
+  runShardPid(inputPath, outputFilenamesStr, "", 0, 2, 1'000'000, "");
+  data_processing::test_utils::expectFileRowsEqual(
+      outputFilenames.at(0), expectedOutPid.at(0));
+  data_processing::test_utils::expectFileRowsEqual(
+      outputFilenames.at(1), expectedOutPid.at(1));
+}
+
 TEST(ShardPidTest, RunWithNoOutputFatal) {
   ASSERT_DEATH(runShardPid("/test/input", "", "", 0, 0, 0, ""), "Error");
 }
@@ -342,3 +626,21 @@ TEST(SecureRandomShardTest, RunWithOutputBasePath) {
   data_processing::test_utils::expectFilesEqual(
       outputFilenames1.at(1), outputFilenames2.at(1));
 }
+
+TEST(ShardPidTest, RunWithInputPartsConcurrently) {
+  gflags::FlagSaver flagSaver;
+  // The parts are read at the same time, so the rows are sorted to compare
+  // them with the rows of a single input
+  FLAGS_sharding_sort_by_id = true;
+  FLAGS_sharding_reader_threads = 3;
+  auto directory =
+      writeInputParts("ShardPidTest_RunWithInputPartsConcurrently", 3);
+  std::vector<std::string> outputFilenames{
+      directory + "_out_0", directory + "_out_1"};
+
+  runShardPid(directory, folly::join(',', outputFilenames), "", 0, 2, 1, "");
+  data_processing::test_utils::expectFileRowsEqual(
+      outputFilenames.at(0), expectedOutPid.at(0));
+  data_processing::test_utils::expectFileRowsEqual(
+      outputFilenames.at(1), expectedOutPid.at(1));
+}
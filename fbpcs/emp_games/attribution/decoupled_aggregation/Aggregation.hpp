@@ -255,7 +255,9 @@ AggregationOutputMetrics computeAggregations(
   }
 
   PrivateAggregationMetrics aggregationMetrics{
-      aggregationFormats, AggregationContext{adIds}, outputVisibility};
+      aggregationFormats,
+      AggregationContext{adIds, FLAGS_use_sorted_aggregation},
+      outputVisibility};
 
   AggregationOutputMetrics out;
   const auto& attributionRules = inputData.getAttributionRules();
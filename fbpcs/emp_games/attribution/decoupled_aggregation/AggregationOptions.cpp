@@ -56,6 +56,13 @@ DEFINE_string(
     "A user given run name that will be used in s3 filename");
 DEFINE_int32(max_num_touchpoints, 4, "Maximum touchpoints per user");
 DEFINE_int32(max_num_conversions, 4, "Maximum conversions per user");
+DEFINE_bool(
+    use_sorted_aggregation,
+    false,
+    "Aggregate the measurement metrics by obliviously sorting the attributed "
+    "conversions by compressed ad id, in O(n log^2 n) gates for n conversions "
+    "and ad ids, rather than comparing every conversion with every ad id. Both "
+    "parties must set the same value");
 DEFINE_bool(
     log_cost,
     false,
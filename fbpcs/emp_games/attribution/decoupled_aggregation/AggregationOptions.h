@@ -25,6 +25,7 @@ DECLARE_string(run_name);
 DECLARE_bool(use_postfix);
 DECLARE_int32(max_num_touchpoints);
 DECLARE_int32(max_num_conversions);
+DECLARE_bool(use_sorted_aggregation);
 DECLARE_bool(log_cost);
 DECLARE_string(log_cost_s3_bucket);
 DECLARE_string(log_cost_s3_region);
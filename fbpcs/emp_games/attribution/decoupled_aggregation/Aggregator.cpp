@@ -26,6 +26,54 @@ using PrivateConvMap = std::vector<std::pair<emp::Integer, PrivateConvMetrics>>;
 
 namespace {
 
+// Sort keys hold a compressed ad id, or UNUSED_SORT_KEY. They have two more
+// bits than the ids so that they stay positive in emp's signed comparisons.
+const int64_t SORT_KEY_SIZE = INT_SIZE_16 + 2;
+const int64_t UNUSED_SORT_KEY = int64_t{1} << INT_SIZE_16;
+
+// An attributed conversion, or the placeholder of an ad id, in the sorted
+// aggregation
+struct SortableConvMetrics {
+  emp::Integer key;
+  PrivateConvMetrics metrics;
+};
+
+emp::Integer toSortKey(emp::Integer adId) {
+  adId.bits.resize(SORT_KEY_SIZE, emp::Bit{false, emp::PUBLIC});
+  return adId;
+}
+
+// Put the element with the smaller key first. Selecting the first element
+// costs one AND gate per bit, and the second one is recovered with XORs.
+void compareSwap(SortableConvMetrics& a, SortableConvMetrics& b) {
+  const auto swap = a.key > b.key;
+  SortableConvMetrics first{
+      a.key.select(swap, b.key),
+      PrivateConvMetrics{
+          a.metrics.convs.select(swap, b.metrics.convs),
+          a.metrics.sales.select(swap, b.metrics.sales)}};
+  b.key = a.key ^ b.key ^ first.key;
+  b.metrics = a.metrics ^ b.metrics ^ first.metrics;
+  a = std::move(first);
+}
+
+// Batcher's odd-even merge sort, whose network sorts any number of elements
+// in O(n log^2 n) compare-swaps
+void obliviousSort(std::vector<SortableConvMetrics>& elements) {
+  const auto n = elements.size();
+  for (std::size_t p = 1; p < n; p <<= 1) {
+    for (std::size_t k = p; k >= 1; k >>= 1) {
+      for (std::size_t j = k % p; j + k < n; j += 2 * k) {
+        for (std::size_t i = 0; i < std::min(k, n - j - k); ++i) {
+          if ((i + j) / (2 * p) == (i + j + k) / (2 * p)) {
+            compareSwap(elements.at(i + j), elements.at(i + j + k));
+          }
+        }
+      }
+    }
+  }
+}
+
 struct MeasurementAggregation {
   // ad_id => metrics
   std::unordered_map<int64_t, ConvMetrics> metrics;
@@ -54,8 +102,10 @@ class MeasurementAggregator : public Aggregator {
  public:
   explicit MeasurementAggregator(
       const std::vector<int64_t>& validAdIds,
+      bool useSortedAggregation,
       const fbpcf::Visibility& outputVisibility)
-      : Aggregator{outputVisibility} {
+      : Aggregator{outputVisibility},
+        useSortedAggregation_{useSortedAggregation} {
     int numValidAdIds = validAdIds.size();
     validOriginalAdIds_ = validAdIds;
     for (uint16_t compressedAdId = 1; compressedAdId <= numValidAdIds;
@@ -106,6 +156,11 @@ class MeasurementAggregator : public Aggregator {
       touchpointConversionResults.push_back(touchpointConversionResultsPerId);
     }
 
+    if (useSortedAggregation_) {
+      aggregateBySorting(touchpointConversionResults);
+      return;
+    }
+
     for (auto& touchpointConversionResultsPerId : touchpointConversionResults) {
       for (auto& touchpointConversionResult :
            touchpointConversionResultsPerId) {
@@ -173,6 +228,72 @@ class MeasurementAggregator : public Aggregator {
     return aggregationResults;
   }
 
+  /*
+   * Adds the same metrics as the comparisons of aggregateAttributions, in
+   * O(n log^2 n) gates for n conversions and ad ids rather than O(n * ad ids).
+   * The conversions are sorted by the ad id they are attributed to, with a
+   * placeholder of every ad id. The metrics of each run of equal ad ids are
+   * summed into its last element, and the other elements are given an unused
+   * key. A second sort then puts the sums of the ad ids in their order.
+   */
+  void aggregateBySorting(
+      const std::vector<std::vector<
+          MeasurementAggregation::PrivateMeasurementAggregationResult>>&
+          touchpointConversionResults) {
+    const emp::Integer zero{INT_SIZE_32, 0, emp::PUBLIC};
+    const emp::Integer one{INT_SIZE_32, 1, emp::PUBLIC};
+    const emp::Integer noAdId{INT_SIZE_16, 0, emp::PUBLIC};
+    const emp::Integer unusedKey{SORT_KEY_SIZE, UNUSED_SORT_KEY, emp::PUBLIC};
+
+    // Id 0 is that of the conversions attributed to no touchpoint
+    std::vector<SortableConvMetrics> elements;
+    for (int64_t adId = 0;
+         adId <= static_cast<int64_t>(validOriginalAdIds_.size());
+         adId++) {
+      elements.push_back(SortableConvMetrics{
+          emp::Integer{SORT_KEY_SIZE, adId, emp::PUBLIC},
+          PrivateConvMetrics{}});
+    }
+    for (const auto& touchpointConversionResultsPerId :
+         touchpointConversionResults) {
+      for (const auto& touchpointConversionResult :
+           touchpointConversionResultsPerId) {
+        const auto& hasAttributedTouchpoint =
+            touchpointConversionResult.hasAttributedTouchpoint;
+        elements.push_back(SortableConvMetrics{
+            toSortKey(noAdId.select(
+                hasAttributedTouchpoint,
+                touchpointConversionResult.measurementTouchpointMetadata
+                    .adId)),
+            PrivateConvMetrics{
+                zero.select(hasAttributedTouchpoint, one),
+                zero.select(
+                    hasAttributedTouchpoint,
+                    touchpointConversionResult.measurementConversionMetadata
+                        .conv_value)}});
+      }
+    }
+
+    XLOGF(INFO, "Sorting {} conversions and ad ids...", elements.size());
+    obliviousSort(elements);
+    for (std::size_t i = 1; i < elements.size(); i++) {
+      auto& previous = elements.at(i - 1);
+      auto& current = elements.at(i);
+      const auto sameAdId = previous.key.equal(current.key);
+      current.metrics = current.metrics +
+          PrivateConvMetrics{
+              zero.select(sameAdId, previous.metrics.convs),
+              zero.select(sameAdId, previous.metrics.sales)};
+      previous.key = previous.key.select(sameAdId, unusedKey);
+    }
+    obliviousSort(elements);
+
+    for (std::size_t i = 0; i < adIdToMetrics_.size(); i++) {
+      auto& metrics = adIdToMetrics_.at(i).second;
+      metrics = metrics + elements.at(i + 1).metrics;
+    }
+  }
+
   virtual AggregationOutput reveal() const override {
     MeasurementAggregation out;
 
@@ -196,6 +317,7 @@ class MeasurementAggregator : public Aggregator {
   }
 
  private:
+  bool useSortedAggregation_;
   PrivateConvMap adIdToMetrics_;
 };
 } // namespace
@@ -207,7 +329,7 @@ static const std::array SUPPORTED_AGGREGATION_FORMATS{AggregationFormat{
     [](AggregationContext ctx,
        fbpcf::Visibility outputVisibility) -> std::unique_ptr<Aggregator> {
       return std::make_unique<MeasurementAggregator>(
-          ctx.validAdIds, outputVisibility);
+          ctx.validAdIds, ctx.useSortedAggregation, outputVisibility);
     }}};
 
 AggregationFormat getAggregationFormatFromNameOrThrow(const std::string& name) {
@@ -99,6 +99,9 @@ class Aggregator {
 
 struct AggregationContext {
   const std::vector<int64_t>& validAdIds;
+  // Aggregate by obliviously sorting the attributed conversions by ad id,
+  // rather than by comparing every conversion with every ad id
+  bool useSortedAggregation = false;
 };
 
 class AggregationFormat {
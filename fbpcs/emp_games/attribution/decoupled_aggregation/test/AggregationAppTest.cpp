@@ -11,6 +11,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
 #include <fbpcf/mpc/EmpGame.h>
@@ -18,6 +19,7 @@
 #include "folly/Random.h"
 #include "folly/logging/xlog.h"
 
+#include "fbpcs/emp_games/attribution/decoupled_aggregation/AggregationOptions.h"
 #include "fbpcs/emp_games/attribution/decoupled_aggregation/test/AggregationTestUtils.h"
 #include "fbpcs/emp_games/common/TestUtil.h"
 
@@ -135,4 +137,36 @@ TEST_F(AggregationAppTest, TestMPCAEMCorrectnessWithPrivateScaling) {
     }
   }
 }
+
+TEST_F(AggregationAppTest, TestMPCAEMCorrectnessWithSortedAggregation) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_use_sorted_aggregation = true;
+
+  std::vector<std::string> attribution_rules{"last_click_1d", "last_touch_1d"};
+  for (auto attribution_rule : attribution_rules) {
+    std::string inputPrefix = "test_correctness";
+    std::string aggregationFormatAlice = "measurement";
+    std::string OutputJsonFileName = baseDir_ + inputPrefix + "/" +
+        attribution_rule + "." + aggregationFormatAlice + ".json";
+
+    auto [resAlice, resBob] = runGameAndGenOutput<fbpcf::Visibility::Xor>(
+        serverIpAlice_,
+        port_,
+        aggregationFormatAlice,
+        baseDir_ + inputPrefix + "/" + attribution_rule + ".publisher.json",
+        baseDir_ + inputPrefix + "/" + attribution_rule + ".publisher.csv",
+        outputPathAlice_,
+        serverIpBob_,
+        port_,
+        "",
+        baseDir_ + inputPrefix + "/" + attribution_rule + ".partner.json",
+        baseDir_ + inputPrefix + "/" + attribution_rule + ".partner.csv",
+        outputPathBob_);
+
+    // The sorted aggregation reveals the same metrics as the comparisons
+    auto [revealedResAlice, revealedresBob] = revealXORedResult(
+        resAlice, resBob, aggregationFormatAlice, attribution_rule);
+    verifyOutput(revealedResAlice, revealedresBob, OutputJsonFileName);
+  }
+}
 } // namespace aggregation::private_aggregation
@@ -7,6 +7,8 @@
 
 #include "ShardAggregatorApp.h"
 
+#include <algorithm>
+#include <future>
 #include <memory>
 #include <string>
 #include <vector>
@@ -17,13 +19,13 @@
 #include <folly/logging/xlog.h>
 #include "folly/Conv.h"
 
-#include <fbpcf/common/FunctionalUtil.h>
 #include <fbpcf/io/api/FileIOWrappers.h>
 #include <fbpcf/mpc/EmpGame.h>
 #include "AggMetrics.h"
 #include "ShardAggregatorGame.h"
 #include "ShardAggregatorValidation.h"
 #include "fbpcs/emp_games/attribution/shard_aggregator/AggMetricsThresholdCheckers.h"
+#include "fbpcs/emp_games/common/MetricTreeFormat.h"
 
 namespace measurement::private_attribution {
 using AggMetrics = private_measurement::AggMetrics;
@@ -91,20 +93,42 @@ std::vector<std::shared_ptr<AggMetrics>> ShardAggregatorApp::getInputData() {
   auto inputPaths = ShardAggregatorApp::getInputPaths(
       inputPath_, firstShardIndex_, numShards_);
 
-  auto inputData =
-      fbpcf::functional::map<std::string, std::shared_ptr<AggMetrics>>(
-          inputPaths, [](const auto& inputPath) -> std::shared_ptr<AggMetrics> {
-            XLOG(INFO) << "Opening file at <" << inputPath << ">";
-            auto contents = fbpcf::io::FileIOWrappers::readFile(inputPath);
-            if (contents.empty()) {
-              XLOG(WARN) << "Empty file: <" << inputPath << ">";
-              return nullptr;
-            }
-            return std::make_shared<AggMetrics>(
-                AggMetrics::fromDynamic(folly::parseJson(std::move(contents))));
-          });
-  std::remove_if(
-      inputData.begin(), inputData.end(), [](auto& x) { return x == nullptr; });
+  auto readShard = [](const std::string& inputPath) {
+    XLOG(INFO) << "Opening file at <" << inputPath << ">";
+    auto contents = fbpcf::io::FileIOWrappers::readFile(inputPath);
+    if (contents.empty()) {
+      XLOG(WARN) << "Empty file: <" << inputPath << ">";
+      return std::shared_ptr<AggMetrics>{nullptr};
+    }
+    if (private_measurement::metric_tree::hasMagic(contents)) {
+      return std::make_shared<AggMetrics>(AggMetrics::fromDynamic(
+          private_measurement::metric_tree::decode(contents)));
+    }
+    return std::make_shared<AggMetrics>(
+        AggMetrics::fromDynamic(folly::parseJson(std::move(contents))));
+  };
+
+  // The shards are read and parsed readConcurrency_ at a time, which also
+  // bounds how many file contents are held at once. They are kept in the
+  // order of their paths.
+  std::vector<std::shared_ptr<AggMetrics>> inputData;
+  inputData.reserve(inputPaths.size());
+  for (std::size_t begin = 0; begin < inputPaths.size();
+       begin += readConcurrency_) {
+    auto end = std::min<std::size_t>(
+        begin + readConcurrency_, inputPaths.size());
+    std::vector<std::future<std::shared_ptr<AggMetrics>>> shards;
+    for (auto i = begin; i < end; ++i) {
+      shards.push_back(
+          std::async(std::launch::async, readShard, inputPaths.at(i)));
+    }
+    for (auto& shard : shards) {
+      auto metrics = shard.get();
+      if (metrics != nullptr) {
+        inputData.push_back(std::move(metrics));
+      }
+    }
+  }
 
   validateInputDataAggMetrics(inputData, metricsFormatType_);
   return inputData;
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -35,7 +36,8 @@ class ShardAggregatorApp
       const std::string& outputPath,
       const std::string& inputMappingPath,
       const bool useNewOutputFormat,
-      const std::string& metricsFormatType = "ad_object")
+      const std::string& metricsFormatType = "ad_object",
+      int32_t readConcurrency = 1)
       : fbpcf::EmpApp<
             ShardAggregatorGame<emp::NetIO>,
             std::vector<std::shared_ptr<private_measurement::AggMetrics>>,
@@ -49,7 +51,8 @@ class ShardAggregatorApp
         visibility_{visibility},
         metricsFormatType_{metricsFormatType},
         inputMappingPath_{inputMappingPath},
-        useNewOutputFormat_{useNewOutputFormat} {}
+        useNewOutputFormat_{useNewOutputFormat},
+        readConcurrency_{std::max(readConcurrency, 1)} {}
 
   void run() override;
 
@@ -86,5 +89,7 @@ class ShardAggregatorApp
   std::string metricsFormatType_;
   std::string inputMappingPath_;
   bool useNewOutputFormat_;
+  // How many shards are read and parsed at the same time
+  int32_t readConcurrency_;
 };
 } // namespace measurement::private_attribution
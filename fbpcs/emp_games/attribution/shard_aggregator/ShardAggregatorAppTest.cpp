@@ -66,7 +66,8 @@ class ShardAggregatorAppTest : public ::testing::Test {
         outputPath,
         inputMappingPath,
         useNewOutputFormat,
-        metricsFormatType)
+        metricsFormatType,
+        2 /* readConcurrency */)
         .run();
   }
 
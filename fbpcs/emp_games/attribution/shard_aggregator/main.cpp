@@ -62,6 +62,10 @@ DEFINE_string(
     input_ad_id_mapping_path,
     "",
     "Input path where the compressed adId mapping files are located");
+DEFINE_int32(
+    read_concurrency,
+    8,
+    "Number of shards read and parsed at the same time");
 
 int main(int argc, char* argv[]) {
   folly::init(&argc, &argv);
@@ -103,7 +107,8 @@ int main(int argc, char* argv[]) {
         FLAGS_output_path,
         FLAGS_input_ad_id_mapping_path,
         FLAGS_use_new_output_format,
-        FLAGS_metrics_format_type)
+        FLAGS_metrics_format_type,
+        FLAGS_read_concurrency)
         .run();
   } catch (const fbpcf::ExceptionBase& e) {
     XLOGF(ERR, "Some error occurred: {}", e.what());
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include <fbpcf/io/api/FileIOWrappers.h>
+#include <folly/Format.h>
+#include <folly/Random.h>
+#include <folly/dynamic.h>
+#include <folly/json.h>
+
+#include "fbpcs/emp_games/benchmarks/BenchmarkUtil.h"
+#include "fbpcs/emp_games/common/MetricTreeFormat.h"
+#include "fbpcs/emp_games/pcf2_shard_combiner/AggMetrics.h"
+#include "fbpcs/emp_games/pcf2_shard_combiner/AggMetrics_impl.h"
+
+namespace benchmarks {
+
+namespace {
+// An attribution shard in the ad object format, with the convs and sales of
+// numAds ads taken from generated purchase values
+folly::dynamic generateAdObjectMetrics(std::size_t numAds) {
+  auto values = generateLiftRows(Role::Partner, {"value"}, 2 * numAds);
+  folly::dynamic measurement = folly::dynamic::object();
+  for (std::size_t i = 0; i < numAds; ++i) {
+    measurement.insert(
+        std::to_string(i + 1),
+        folly::dynamic::object("convs", std::stoll(values.at(2 * i)))(
+            "sales", std::stoll(values.at(2 * i + 1))));
+  }
+  return folly::dynamic::object(
+      "last_click_1d", folly::dynamic::object("measurement", measurement));
+}
+} // namespace
+
+// Arg 0 is the number of ads, and arg 1 whether the shard is in the binary
+// metric tree format instead of JSON
+static void BM_AggMetricsFromJson(benchmark::State& state) {
+  auto metrics = generateAdObjectMetrics(state.range(0));
+  auto path = folly::sformat(
+      "{}/benchmark_shard_{}",
+      std::filesystem::temp_directory_path().string(),
+      folly::Random::secureRand64());
+  fbpcf::io::FileIOWrappers::writeFile(
+      path,
+      state.range(1) != 0 ? private_measurement::metric_tree::encode(metrics)
+                          : folly::toJson(metrics));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(shard_combiner::AggMetrics<>::fromJson(path));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  std::remove(path.c_str());
+}
+BENCHMARK(BM_AggMetricsFromJson)
+    ->Args({1 << 8, 0})
+    ->Args({1 << 8, 1})
+    ->Args({1 << 14, 0})
+    ->Args({1 << 14, 1});
+
+} // namespace benchmarks
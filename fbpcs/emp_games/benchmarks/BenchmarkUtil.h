@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "fbpcs/data_processing/load_testing_utils/FakeDataGenerator.h"
+
+namespace benchmarks {
+
+// Fixed, so that every run of a benchmark sees the same input
+constexpr uint32_t kSeed = 42;
+
+inline const std::vector<std::string> kPublisherHeader = {
+    "id_",
+    "opportunity_timestamp",
+    "test_flag",
+    "num_impressions",
+    "num_clicks",
+    "total_spend",
+    "breakdown_id"};
+
+inline const std::vector<std::string> kPartnerHeader =
+    {"id_", "event_timestamp", "value", "cohort_id"};
+
+// Rows of lift input for role, without the header. Every row has an
+// opportunity and a purchase, so that the publisher and partner rows line up.
+inline std::vector<std::string> generateLiftRows(
+    Role role,
+    const std::vector<std::string>& header,
+    std::size_t numRows) {
+  FakeDataGenerator generator{
+      FakeDataGeneratorParams{role, header}
+          .withOpportunityRate(1)
+          .withPurchaseRate(1)
+          .withShouldUseComplexIds(false),
+      kSeed};
+  std::vector<std::string> rows;
+  rows.reserve(numRows);
+  for (std::size_t i = 0; i < numRows; ++i) {
+    rows.push_back(generator.genOneRow());
+  }
+  return rows;
+}
+
+// Array cells of numElements timestamps each, such as `[1600000000,...]`
+inline std::vector<std::string> generateArrayCells(
+    std::size_t numCells,
+    std::size_t numElements) {
+  auto rows = generateLiftRows(
+      Role::Partner, {"event_timestamp"}, numCells * numElements);
+  std::vector<std::string> cells;
+  cells.reserve(numCells);
+  for (std::size_t i = 0; i < numCells; ++i) {
+    std::string cell = "[";
+    for (std::size_t j = 0; j < numElements; ++j) {
+      if (j > 0) {
+        cell += ',';
+      }
+      cell += rows.at(i * numElements + j);
+    }
+    cells.push_back(cell + "]");
+  }
+  return cells;
+}
+
+inline void writeCsv(
+    const std::string& path,
+    const std::vector<std::string>& header,
+    const std::vector<std::string>& rows) {
+  std::ofstream file{path};
+  for (std::size_t i = 0; i < header.size(); ++i) {
+    file << (i > 0 ? "," : "") << header.at(i);
+  }
+  file << '\n';
+  for (const auto& row : rows) {
+    file << row << '\n';
+  }
+}
+
+} // namespace benchmarks
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fbpcf/frontend/mpcGame.h"
+#include "fbpcf/scheduler/PlaintextScheduler.h"
+#include "fbpcf/scheduler/SchedulerHelper.h"
+#include "fbpcs/emp_games/benchmarks/BenchmarkUtil.h"
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/Csv.h"
+#include "fbpcs/emp_games/common/Util.h"
+
+namespace benchmarks {
+
+static void BM_SplitByComma(benchmark::State& state) {
+  auto rows = generateLiftRows(Role::Publisher, kPublisherHeader, 1000);
+  for (auto _ : state) {
+    for (const auto& row : rows) {
+      // splitByComma removes the spaces of its input
+      auto line = row;
+      benchmark::DoNotOptimize(private_measurement::csv::splitByComma(
+          line, state.range(0) != 0));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * rows.size());
+}
+BENCHMARK(BM_SplitByComma)->Arg(0)->Arg(1);
+
+static void BM_GetInnerArray(benchmark::State& state) {
+  auto cells = generateArrayCells(1000, state.range(0));
+  for (auto _ : state) {
+    for (const auto& cell : cells) {
+      benchmark::DoNotOptimize(common::getInnerArray<uint64_t>(cell));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * cells.size());
+}
+BENCHMARK(BM_GetInnerArray)->Arg(4)->Arg(32);
+
+static void BM_TransposeArraysWithPadding(benchmark::State& state) {
+  const std::size_t numRows = state.range(0);
+  const std::size_t numCols = 8;
+  // Rows of 1 to numCols elements, so that some of them are padded
+  std::vector<std::vector<uint64_t>> arrays;
+  auto cells = generateArrayCells(numRows, numCols);
+  for (std::size_t i = 0; i < numRows; ++i) {
+    auto array = common::getInnerArray<uint64_t>(cells.at(i));
+    array.resize(1 + i % numCols);
+    arrays.push_back(std::move(array));
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(common::transposeArraysWithPadding<uint64_t>(
+        arrays, numRows, numCols, 0));
+  }
+  state.SetItemsProcessed(state.iterations() * numRows * numCols);
+}
+BENCHMARK(BM_TransposeArraysWithPadding)->Arg(1 << 10)->Arg(1 << 16);
+
+static void BM_PrivatelyShareArray(benchmark::State& state) {
+  constexpr int schedulerId = 0;
+  using SecValue = typename fbpcf::frontend::MpcGame<
+      schedulerId>::template SecSignedInt<64, false>;
+  fbpcf::scheduler::SchedulerKeeper<schedulerId>::setScheduler(
+      std::make_unique<fbpcf::scheduler::PlaintextScheduler>(
+          fbpcf::scheduler::WireKeeper::createWithVectorArena<true>()));
+
+  auto cells = generateArrayCells(1, state.range(0));
+  auto values = common::getInnerArray<int64_t>(cells.front());
+  std::function<SecValue(const int64_t&)> constructor =
+      [](const int64_t& value) {
+        return SecValue{value, common::PUBLISHER};
+      };
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        common::privatelyShareArray<int64_t, SecValue>(values, constructor));
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+  fbpcf::scheduler::SchedulerKeeper<schedulerId>::deleteEngine();
+}
+BENCHMARK(BM_PrivatelyShareArray)->Arg(1 << 10)->Arg(1 << 14);
+
+} // namespace benchmarks
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <filesystem>
+#include <future>
+#include <string>
+
+#include <folly/Format.h>
+#include <folly/Random.h>
+
+#include "fbpcf/engine/communication/test/AgentFactoryCreationHelper.h"
+#include "fbpcf/scheduler/NetworkPlaintextSchedulerFactory.h"
+#include "fbpcf/scheduler/SchedulerHelper.h"
+#include "fbpcs/emp_games/benchmarks/BenchmarkUtil.h"
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/InputProcessor.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/LiftGameProcessedData.h"
+
+namespace benchmarks {
+
+namespace {
+constexpr int32_t kNumConversionsPerUser = 1;
+constexpr int64_t kEpoch = 1'600'000'000;
+
+template <int schedulerId>
+private_lift::InputProcessor<schedulerId> processInput(
+    int myRole,
+    const std::string& inputPath,
+    fbpcf::engine::communication::IPartyCommunicationAgentFactory& factory) {
+  fbpcf::scheduler::SchedulerKeeper<schedulerId>::setScheduler(
+      fbpcf::scheduler::NetworkPlaintextSchedulerFactory<true>(myRole, factory)
+          .create());
+  private_lift::InputData inputData{
+      inputPath,
+      private_lift::InputData::LiftMPCType::Standard,
+      true,
+      kEpoch,
+      kNumConversionsPerUser};
+  return private_lift::InputProcessor<schedulerId>(
+      myRole, inputData, kNumConversionsPerUser);
+}
+
+/*
+ * The processed publisher data of numRows generated rows, and the paths it is
+ * written to. The schedulers stay set, as the data is made of their wires.
+ */
+class ProcessedData {
+ public:
+  explicit ProcessedData(std::size_t numRows) {
+    std::string tempDir = std::filesystem::temp_directory_path();
+    auto random = folly::Random::secureRand64();
+    auto publisherInput =
+        folly::sformat("{}/benchmark_publisher_{}.csv", tempDir, random);
+    auto partnerInput =
+        folly::sformat("{}/benchmark_partner_{}.csv", tempDir, random);
+    globalParamsPath_ =
+        folly::sformat("{}/benchmark_global_params_{}.csv", tempDir, random);
+    secretSharesPath_ =
+        folly::sformat("{}/benchmark_secret_shares_{}.csv", tempDir, random);
+    writeCsv(
+        publisherInput,
+        kPublisherHeader,
+        generateLiftRows(Role::Publisher, kPublisherHeader, numRows));
+    writeCsv(
+        partnerInput,
+        kPartnerHeader,
+        generateLiftRows(Role::Partner, kPartnerHeader, numRows));
+
+    factories_ = fbpcf::engine::communication::getInMemoryAgentFactory(2);
+    auto publisher = std::async(
+        processInput<0>,
+        common::PUBLISHER,
+        publisherInput,
+        std::ref(*factories_[0]));
+    auto partner = std::async(
+        processInput<1>,
+        common::PARTNER,
+        partnerInput,
+        std::ref(*factories_[1]));
+    data_ = publisher.get().getLiftGameProcessedData();
+    partner.get();
+    std::remove(publisherInput.c_str());
+    std::remove(partnerInput.c_str());
+  }
+
+  ~ProcessedData() {
+    // The wires of the data go before their schedulers, which go before the
+    // agents they use
+    data_ = private_lift::LiftGameProcessedData<0>{};
+    fbpcf::scheduler::SchedulerKeeper<0>::deleteEngine();
+    fbpcf::scheduler::SchedulerKeeper<1>::deleteEngine();
+    std::remove(globalParamsPath_.c_str());
+    std::remove(secretSharesPath_.c_str());
+  }
+
+  const private_lift::LiftGameProcessedData<0>& getData() const {
+    return data_;
+  }
+
+  const std::string& getGlobalParamsPath() const {
+    return globalParamsPath_;
+  }
+
+  const std::string& getSecretSharesPath() const {
+    return secretSharesPath_;
+  }
+
+ private:
+  std::vector<std::unique_ptr<
+      fbpcf::engine::communication::IPartyCommunicationAgentFactory>>
+      factories_;
+  private_lift::LiftGameProcessedData<0> data_;
+  std::string globalParamsPath_;
+  std::string secretSharesPath_;
+};
+} // namespace
+
+static void BM_LiftGameProcessedDataWriteToCSV(benchmark::State& state) {
+  ProcessedData processedData(state.range(0));
+  for (auto _ : state) {
+    processedData.getData().writeToCSV(
+        processedData.getGlobalParamsPath(),
+        processedData.getSecretSharesPath());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LiftGameProcessedDataWriteToCSV)
+    ->Arg(1 << 10)
+    ->Arg(1 << 15)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_LiftGameProcessedDataReadFromCSV(benchmark::State& state) {
+  ProcessedData processedData(state.range(0));
+  processedData.getData().writeToCSV(
+      processedData.getGlobalParamsPath(), processedData.getSecretSharesPath());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        private_lift::LiftGameProcessedData<0>::readFromCSV(
+            processedData.getGlobalParamsPath(),
+            processedData.getSecretSharesPath()));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LiftGameProcessedDataReadFromCSV)
+    ->Arg(1 << 10)
+    ->Arg(1 << 15)
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace benchmarks
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fbpcf/io/api/FileIOWrappers.h>
+#include <folly/dynamic.h>
+#include <folly/json.h>
+
+#include "fbpcs/emp_games/benchmarks/e2e/GameInputs.h"
+#include "fbpcs/emp_games/benchmarks/e2e/TwoPartyHarness.h"
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/pcf2_aggregation/AggregationApp.h"
+#include "fbpcs/emp_games/pcf2_aggregation/AggregationOptions.h"
+
+namespace benchmarks {
+
+namespace {
+/*
+ * Shares of last click 1d attribution results of numRows rows, in the format
+ * the attribution game writes, with an is_attributed share for every pair of
+ * touchpoint and conversion. They are random, which costs the aggregation the
+ * same as real shares do.
+ */
+void writeAttributionShares(
+    const std::string& path,
+    std::size_t numRows,
+    std::size_t numAttributions,
+    uint32_t seed) {
+  std::mt19937_64 r{seed};
+  std::bernoulli_distribution attributedDist{0.5};
+  folly::dynamic resultsPerPid = folly::dynamic::object();
+  for (std::size_t i = 0; i < numRows; ++i) {
+    folly::dynamic results = folly::dynamic::array();
+    for (std::size_t j = 0; j < numAttributions; ++j) {
+      results.push_back(
+          folly::dynamic::object("is_attributed", attributedDist(r)));
+    }
+    resultsPerPid.insert(std::to_string(i), std::move(results));
+  }
+  fbpcf::io::FileIOWrappers::writeFile(
+      path,
+      folly::toJson(folly::dynamic::object(
+          common::LAST_CLICK_1D,
+          folly::dynamic::object("default", std::move(resultsPerPid)))));
+}
+
+template <int PARTY, int schedulerId>
+common::SchedulerStatistics runAggregationApp(
+    std::unique_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory> factory,
+    const std::string& secretSharePath,
+    const std::string& clearTextPath,
+    const std::string& outputPath,
+    int concurrency) {
+  auto metricCollector =
+      std::make_shared<fbpcf::util::MetricCollector>("aggregation_benchmark");
+  pcf2_aggregation::AggregationApp<PARTY, schedulerId> app(
+      common::InputEncryption::Plaintext,
+      common::Visibility::Xor,
+      std::move(factory),
+      common::MEASUREMENT,
+      std::vector<std::string>{secretSharePath},
+      std::vector<std::string>{clearTextPath},
+      std::vector<std::string>{outputPath},
+      metricCollector,
+      0 /* startFileIndex */,
+      1 /* numFiles */,
+      concurrency);
+  app.run();
+  return app.getSchedulerStatistics();
+}
+
+/*
+ * Both parties of the measurement aggregation of the last click 1d
+ * attributions of numRows rows, with concurrency threads in the game.
+ */
+void runAggregationBenchmark(
+    benchmark::State& state,
+    int64_t numRows,
+    int64_t numTouchpoints,
+    int64_t numConversions,
+    int concurrency,
+    LinkShape shape) {
+  FLAGS_max_num_touchpoints = numTouchpoints;
+  FLAGS_max_num_conversions = numConversions;
+
+  TempDir dir{"aggregation_benchmark"};
+  auto publisherClearText = dir.file("publisher.csv");
+  auto partnerClearText = dir.file("partner.csv");
+  auto publisherShares = dir.file("publisher_attribution.json");
+  auto partnerShares = dir.file("partner_attribution.json");
+  auto publisherOutput = dir.file("publisher_aggregation.json");
+  auto partnerOutput = dir.file("partner_aggregation.json");
+  writeAttributionInputs(
+      {publisherClearText},
+      {partnerClearText},
+      numRows,
+      numTouchpoints,
+      numConversions);
+  writeAttributionShares(
+      publisherShares, numRows, numTouchpoints * numConversions, kSeed);
+  writeAttributionShares(
+      partnerShares, numRows, numTouchpoints * numConversions, kSeed + 1);
+
+  TwoPartyStatistics statistics;
+  for (auto _ : state) {
+    statistics.add(runTwoParties(
+        findLoopbackPort(),
+        shape,
+        [&](auto factory) {
+          return runAggregationApp<common::PUBLISHER, common::PUBLISHER>(
+              std::move(factory),
+              publisherShares,
+              publisherClearText,
+              publisherOutput,
+              concurrency);
+        },
+        [&](auto factory) {
+          return runAggregationApp<common::PARTNER, common::PARTNER>(
+              std::move(factory),
+              partnerShares,
+              partnerClearText,
+              partnerOutput,
+              concurrency);
+        }));
+  }
+  reportTwoPartyRun(state, statistics, numRows);
+}
+} // namespace
+
+/*
+ * Both parties of the measurement aggregation of the last click 1d
+ * attributions of rows rows, with concurrency threads in the game.
+ */
+static void BM_AggregationGame(benchmark::State& state) {
+  runAggregationBenchmark(
+      state,
+      state.range(0),
+      state.range(1),
+      state.range(2),
+      std::max<int>(state.range(3), 1),
+      getLinkShape(state, 4));
+}
+BENCHMARK(BM_AggregationGame)
+    ->ArgNames(
+        {"rows",
+         "touchpoints",
+         "conversions",
+         "concurrency",
+         "latency_ms",
+         "mbps"})
+    ->Args({1000, 4, 4, 1, 0, 0})
+    ->Args({10000, 4, 4, 1, 0, 0})
+    ->Args({10000, 4, 4, 4, 0, 0})
+    ->Args({10000, 4, 4, 1, 10, 1000})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+/*
+ * Both parties of the measurement aggregation of rows rows with 4
+ * touchpoints and conversions, over the scheduler hints of the arguments, to
+ * choose the hints of aggregation from. Aggregation takes max_batch_width as
+ * a cap on the rows of an ORAM batch.
+ */
+static void BM_AggregationGameSchedulerHints(benchmark::State& state) {
+  ScopedSchedulerHints hints{getSchedulerHints(state, 1)};
+  runAggregationBenchmark(
+      state, state.range(0), 4, 4, 1, getLinkShape(state, 4));
+}
+BENCHMARK(BM_AggregationGameSchedulerHints)
+    ->ArgNames(
+        {"rows",
+         "lazy",
+         "flush_rows",
+         "max_batch_width",
+         "latency_ms",
+         "mbps"})
+    ->Args({10000, 1, 0, 0, 0, 0})
+    ->Args({10000, 1, 0, 256, 0, 0})
+    ->Args({10000, 1, 0, 1024, 0, 0})
+    ->Args({10000, 0, 0, 0, 0, 0})
+    ->Args({10000, 0, 0, 1024, 0, 0})
+    ->Args({10000, 1, 0, 0, 10, 1000})
+    ->Args({10000, 1, 0, 256, 10, 1000})
+    ->Args({10000, 0, 0, 0, 10, 1000})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+} // namespace benchmarks
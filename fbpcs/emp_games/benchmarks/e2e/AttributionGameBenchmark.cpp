@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fbpcs/emp_games/benchmarks/e2e/GameInputs.h"
+#include "fbpcs/emp_games/benchmarks/e2e/TwoPartyHarness.h"
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/ShardQueue.h"
+#include "fbpcs/emp_games/pcf2_attribution/AttributionApp.h"
+#include "fbpcs/emp_games/pcf2_attribution/AttributionOptions.h"
+
+namespace benchmarks {
+
+namespace {
+// Pairs of apps run at most, each on schedulers of their own
+constexpr std::size_t kMaxAttributionApps = 4;
+
+template <int PARTY, int schedulerId>
+common::SchedulerStatistics runAttributionApp(
+    std::unique_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory> factory,
+    const std::vector<std::string>& inputPaths,
+    const std::vector<std::string>& outputPaths,
+    std::shared_ptr<common::ShardQueue> shardQueue) {
+  auto metricCollector =
+      std::make_shared<fbpcf::util::MetricCollector>("attribution_benchmark");
+  pcf2_attribution::AttributionApp<PARTY, schedulerId> app(
+      std::move(factory),
+      PARTY == common::PUBLISHER ? common::LAST_CLICK_1D : "",
+      inputPaths,
+      outputPaths,
+      metricCollector,
+      true /* useXorEncryption */,
+      common::InputEncryption::Plaintext,
+      0U /* startFileIndex */,
+      0 /* numFiles */,
+      std::move(shardQueue));
+  app.run();
+  return app.getSchedulerStatistics();
+}
+
+/*
+ * Runs numApps pairs of apps, taking the files from a queue of each party
+ * like the sharded runs of the attribution binary do. Publisher apps use even
+ * schedulerIds and partner apps odd ones.
+ */
+template <std::size_t... indices>
+TwoPartyStatistics runAttributionApps(
+    std::index_sequence<indices...>,
+    std::size_t numApps,
+    LinkShape shape,
+    const std::vector<std::string>& publisherInputs,
+    const std::vector<std::string>& publisherOutputs,
+    const std::vector<std::string>& partnerInputs,
+    const std::vector<std::string>& partnerOutputs) {
+  auto publisherQueue = common::makeShardQueue(publisherInputs.size(), "");
+  auto partnerQueue = common::makeShardQueue(partnerInputs.size(), "");
+  // The socket factory may take the ports after the one it is given, like
+  // the attribution binary leaves 100 ports per pair
+  auto port = findLoopbackPort();
+
+  std::vector<std::future<TwoPartyStatistics>> runs;
+  (
+      [&]() {
+        if (indices < numApps) {
+          runs.push_back(std::async(std::launch::async, [&]() {
+            return runTwoParties(
+                port + 100 * indices,
+                shape,
+                [&](auto factory) {
+                  return runAttributionApp<common::PUBLISHER, 2 * indices>(
+                      std::move(factory),
+                      publisherInputs,
+                      publisherOutputs,
+                      publisherQueue);
+                },
+                [&](auto factory) {
+                  return runAttributionApp<common::PARTNER, 2 * indices + 1>(
+                      std::move(factory),
+                      partnerInputs,
+                      partnerOutputs,
+                      partnerQueue);
+                });
+          }));
+        }
+      }(),
+      ...);
+
+  TwoPartyStatistics statistics;
+  for (auto& run : runs) {
+    statistics.add(run.get());
+  }
+  return statistics;
+}
+} // namespace
+
+/*
+ * Both parties of the last click 1d attribution of rows rows, split over
+ * concurrency files and as many pairs of apps.
+ */
+static void BM_AttributionGame(benchmark::State& state) {
+  auto numRows = state.range(0);
+  auto numTouchpoints = state.range(1);
+  auto numConversions = state.range(2);
+  auto concurrency = std::clamp<std::size_t>(
+      state.range(3), 1, std::min<std::size_t>(kMaxAttributionApps, numRows));
+  auto shape = getLinkShape(state, 4);
+  FLAGS_max_num_touchpoints = numTouchpoints;
+  FLAGS_max_num_conversions = numConversions;
+
+  TempDir dir{"attribution_benchmark"};
+  std::vector<std::string> publisherInputs, publisherOutputs, partnerInputs,
+      partnerOutputs;
+  for (std::size_t i = 0; i < concurrency; ++i) {
+    publisherInputs.push_back(dir.file(folly::sformat("publisher_{}.csv", i)));
+    publisherOutputs.push_back(
+        dir.file(folly::sformat("publisher_{}.json", i)));
+    partnerInputs.push_back(dir.file(folly::sformat("partner_{}.csv", i)));
+    partnerOutputs.push_back(dir.file(folly::sformat("partner_{}.json", i)));
+  }
+  writeAttributionInputs(
+      publisherInputs, partnerInputs, numRows, numTouchpoints, numConversions);
+
+  TwoPartyStatistics statistics;
+  for (auto _ : state) {
+    statistics.add(runAttributionApps(
+        std::make_index_sequence<kMaxAttributionApps>{},
+        concurrency,
+        shape,
+        publisherInputs,
+        publisherOutputs,
+        partnerInputs,
+        partnerOutputs));
+  }
+  reportTwoPartyRun(state, statistics, numRows);
+}
+BENCHMARK(BM_AttributionGame)
+    ->ArgNames(
+        {"rows",
+         "touchpoints",
+         "conversions",
+         "concurrency",
+         "latency_ms",
+         "mbps"})
+    ->Args({1000, 4, 4, 1, 0, 0})
+    ->Args({10000, 4, 4, 1, 0, 0})
+    ->Args({10000, 8, 8, 1, 0, 0})
+    ->Args({10000, 4, 4, 4, 0, 0})
+    ->Args({10000, 4, 4, 1, 10, 1000})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+/*
+ * Both parties of the last click 1d attribution of rows rows with 4
+ * touchpoints and conversions on one pair of apps, over the scheduler hints
+ * of the arguments, to choose the hints of attribution from. Attribution
+ * takes flush_rows as the users it attributes at a time.
+ */
+static void BM_AttributionGameSchedulerHints(benchmark::State& state) {
+  auto numRows = state.range(0);
+  ScopedSchedulerHints hints{getSchedulerHints(state, 1)};
+  auto shape = getLinkShape(state, 4);
+  FLAGS_max_num_touchpoints = 4;
+  FLAGS_max_num_conversions = 4;
+
+  TempDir dir{"attribution_hints_benchmark"};
+  std::vector<std::string> publisherInputs{dir.file("publisher.csv")};
+  std::vector<std::string> publisherOutputs{dir.file("publisher.json")};
+  std::vector<std::string> partnerInputs{dir.file("partner.csv")};
+  std::vector<std::string> partnerOutputs{dir.file("partner.json")};
+  writeAttributionInputs(publisherInputs, partnerInputs, numRows, 4, 4);
+
+  TwoPartyStatistics statistics;
+  for (auto _ : state) {
+    statistics.add(runAttributionApps(
+        std::make_index_sequence<1>{},
+        1,
+        shape,
+        publisherInputs,
+        publisherOutputs,
+        partnerInputs,
+        partnerOutputs));
+  }
+  reportTwoPartyRun(state, statistics, numRows);
+}
+BENCHMARK(BM_AttributionGameSchedulerHints)
+    ->ArgNames(
+        {"rows",
+         "lazy",
+         "flush_rows",
+         "max_batch_width",
+         "latency_ms",
+         "mbps"})
+    ->Args({10000, 1, 0, 0, 0, 0})
+    ->Args({10000, 1, 1000, 0, 0, 0})
+    ->Args({10000, 1, 5000, 0, 0, 0})
+    ->Args({10000, 0, 0, 0, 0, 0})
+    ->Args({10000, 0, 1000, 0, 0, 0})
+    ->Args({10000, 1, 0, 0, 10, 1000})
+    ->Args({10000, 1, 1000, 0, 10, 1000})
+    ->Args({10000, 0, 0, 0, 10, 1000})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+} // namespace benchmarks
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fbpcs/emp_games/benchmarks/BenchmarkUtil.h"
+#include "fbpcs/emp_games/benchmarks/e2e/TwoPartyHarness.h"
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/dotproduct/DotproductApp.h"
+
+namespace benchmarks {
+
+namespace {
+constexpr int kLabelWidth = 16;
+constexpr double kDelta = 1e-6;
+constexpr double kEps = 5;
+
+/*
+ * Dotproduct inputs of numRows rows, the publisher with numFeatures features
+ * and a share of the labels and the partner with the other share.
+ */
+void writeDotproductInputs(
+    const std::string& publisherPath,
+    const std::string& partnerPath,
+    std::size_t numRows,
+    std::size_t numFeatures) {
+  std::mt19937_64 r{kSeed};
+  std::uniform_real_distribution<double> featureDist{0, 1};
+  std::bernoulli_distribution bitDist{0.5};
+  auto randomLabels = [&]() {
+    std::string labels(kLabelWidth, '0');
+    std::generate(labels.begin(), labels.end(), [&]() {
+      return bitDist(r) ? '1' : '0';
+    });
+    return labels;
+  };
+
+  std::vector<std::string> publisherRows, partnerRows;
+  for (std::size_t i = 0; i < numRows; ++i) {
+    std::string features = "[";
+    for (std::size_t j = 0; j < numFeatures; ++j) {
+      features += (j > 0 ? "," : "") + std::to_string(featureDist(r));
+    }
+    publisherRows.push_back(
+        folly::sformat("{},{}],{}", i, features, randomLabels()));
+    partnerRows.push_back(folly::sformat("{},{}", i, randomLabels()));
+  }
+  writeCsv(
+      publisherPath,
+      {"row_id", "float_features", "label_secret_share"},
+      publisherRows);
+  writeCsv(partnerPath, {"row_id", "label_secret_share"}, partnerRows);
+}
+
+template <int party>
+common::SchedulerStatistics runDotproductApp(
+    std::unique_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory> factory,
+    std::string inputPath,
+    std::string outputPath,
+    int numFeatures,
+    int numParseThreads) {
+  auto metricCollector =
+      std::make_shared<fbpcf::util::MetricCollector>("dotproduct_benchmark");
+  pcf2_dotproduct::DotproductApp<party, party> app(
+      std::move(factory),
+      inputPath,
+      outputPath,
+      numFeatures,
+      kLabelWidth,
+      metricCollector,
+      kDelta,
+      kEps,
+      true /* addDpNoise */,
+      numParseThreads);
+  app.run();
+  return app.getSchedulerStatistics();
+}
+} // namespace
+
+/*
+ * Both parties of the dotproduct of features features over rows rows, parsed
+ * by concurrency threads.
+ */
+static void BM_DotproductGame(benchmark::State& state) {
+  auto numRows = state.range(0);
+  auto numFeatures = static_cast<int>(state.range(1));
+  auto numParseThreads = std::max<int>(state.range(2), 1);
+  auto shape = getLinkShape(state, 3);
+
+  TempDir dir{"dotproduct_benchmark"};
+  auto publisherInput = dir.file("publisher.csv");
+  auto partnerInput = dir.file("partner.csv");
+  writeDotproductInputs(publisherInput, partnerInput, numRows, numFeatures);
+
+  TwoPartyStatistics statistics;
+  for (auto _ : state) {
+    statistics.add(runTwoParties(
+        findLoopbackPort(),
+        shape,
+        [&](auto factory) {
+          return runDotproductApp<common::PUBLISHER>(
+              std::move(factory),
+              publisherInput,
+              dir.file("publisher_output.csv"),
+              numFeatures,
+              numParseThreads);
+        },
+        [&](auto factory) {
+          return runDotproductApp<common::PARTNER>(
+              std::move(factory),
+              partnerInput,
+              dir.file("partner_output.csv"),
+              numFeatures,
+              numParseThreads);
+        }));
+  }
+  reportTwoPartyRun(state, statistics, numRows);
+}
+BENCHMARK(BM_DotproductGame)
+    ->ArgNames({"rows", "features", "concurrency", "latency_ms", "mbps"})
+    ->Args({1000, 50, 1, 0, 0})
+    ->Args({10000, 50, 1, 0, 0})
+    ->Args({10000, 200, 1, 0, 0})
+    ->Args({10000, 50, 4, 0, 0})
+    ->Args({10000, 50, 1, 10, 1000})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+} // namespace benchmarks
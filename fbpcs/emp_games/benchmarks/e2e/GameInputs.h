@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fbpcs/emp_games/benchmarks/BenchmarkUtil.h"
+
+namespace benchmarks {
+
+constexpr int64_t kAttributionBaseTimestamp = 1'600'000'000;
+// Two days, so that some conversions are past the window of the 1d rules
+constexpr int64_t kAttributionTimeRange = 2 * 86'400;
+
+// `[1,2,3]`
+inline std::string toArrayCell(const std::vector<int64_t>& values) {
+  std::string cell = "[";
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    if (i > 0) {
+      cell += ',';
+    }
+    cell += std::to_string(values.at(i));
+  }
+  return cell + "]";
+}
+
+/*
+ * Writes attribution inputs of numRows rows for both parties, in
+ * numFiles files of about the same number of rows each. Every row has
+ * numTouchpoints touchpoints and numConversions conversions, at random times
+ * within kAttributionTimeRange, so the games are padded the same on every row.
+ */
+inline void writeAttributionInputs(
+    const std::vector<std::string>& publisherPaths,
+    const std::vector<std::string>& partnerPaths,
+    std::size_t numRows,
+    std::size_t numTouchpoints,
+    std::size_t numConversions) {
+  std::mt19937_64 r{kSeed};
+  std::uniform_int_distribution<int64_t> tsDist{
+      kAttributionBaseTimestamp,
+      kAttributionBaseTimestamp + kAttributionTimeRange};
+  std::uniform_int_distribution<int64_t> adIdDist{1, 100};
+  std::uniform_int_distribution<int64_t> valueDist{1, 1000};
+  std::bernoulli_distribution clickDist{0.5};
+  auto randomArray = [&r](std::size_t size, auto& dist) {
+    std::vector<int64_t> values(size);
+    std::generate(values.begin(), values.end(), [&]() { return dist(r); });
+    return values;
+  };
+
+  auto numFiles = publisherPaths.size();
+  for (std::size_t file = 0; file < numFiles; ++file) {
+    std::vector<std::string> publisherRows, partnerRows;
+    for (auto i = file * numRows / numFiles;
+         i < (file + 1) * numRows / numFiles;
+         ++i) {
+      auto id = std::to_string(i);
+      std::vector<int64_t> isClick(numTouchpoints);
+      std::generate(
+          isClick.begin(), isClick.end(), [&]() { return clickDist(r); });
+      publisherRows.push_back(
+          id + "," + toArrayCell(randomArray(numTouchpoints, adIdDist)) + "," +
+          toArrayCell(randomArray(numTouchpoints, tsDist)) + "," +
+          toArrayCell(isClick) + "," +
+          toArrayCell(std::vector<int64_t>(numTouchpoints, 0)));
+      partnerRows.push_back(
+          id + "," + toArrayCell(randomArray(numConversions, tsDist)) + "," +
+          toArrayCell(randomArray(numConversions, valueDist)) + "," +
+          toArrayCell(std::vector<int64_t>(numConversions, 0)));
+    }
+    writeCsv(
+        publisherPaths.at(file),
+        {"id_", "ad_ids", "timestamps", "is_click", "campaign_metadata"},
+        publisherRows);
+    writeCsv(
+        partnerPaths.at(file),
+        {"id_",
+         "conversion_timestamps",
+         "conversion_values",
+         "conversion_metadata"},
+        partnerRows);
+  }
+}
+
+} // namespace benchmarks
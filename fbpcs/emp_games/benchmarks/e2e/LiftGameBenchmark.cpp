@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fbpcs/emp_games/benchmarks/e2e/TwoPartyHarness.h"
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/CalculatorApp.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/test/common/GenFakeData.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/test/common/LiftFakeDataParams.h"
+#include "fbpcs/emp_games/pcf2_shard_combiner/ShardCombinerApp.h"
+
+namespace benchmarks {
+
+namespace {
+constexpr int32_t kEpoch = 1546300800;
+
+/*
+ * Lift inputs of numRows rows for both parties, split over the files given.
+ * The values are random, but the games are data oblivious, so every run costs
+ * the same gates and traffic.
+ */
+void writeLiftInputs(
+    const std::vector<std::string>& publisherPaths,
+    const std::vector<std::string>& partnerPaths,
+    std::size_t numRows,
+    int32_t numConversions,
+    int32_t numCohorts) {
+  private_lift::GenFakeData generator;
+  for (std::size_t i = 0; i < publisherPaths.size(); ++i) {
+    private_lift::LiftFakeDataParams params;
+    params
+        .setNumRows(
+            (i + 1) * numRows / publisherPaths.size() -
+            i * numRows / publisherPaths.size())
+        .setOpportunityRate(0.5)
+        .setTestRate(0.5)
+        .setPurchaseRate(0.5)
+        .setIncrementalityRate(0.0)
+        .setNumConversions(numConversions)
+        .setNumCohorts(numCohorts)
+        .setEpoch(kEpoch);
+    generator.genFakeInputFiles(
+        publisherPaths.at(i), partnerPaths.at(i), params);
+  }
+}
+
+// Each party runs on the scheduler of the same id
+template <int party>
+common::SchedulerStatistics runCalculatorApp(
+    std::unique_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory> factory,
+    const std::vector<std::string>& inputPaths,
+    const std::vector<std::string>& outputPaths,
+    int32_t numConversions,
+    int numParseThreads) {
+  auto metricCollector =
+      std::make_shared<fbpcf::util::MetricCollector>("lift_benchmark");
+  private_lift::CalculatorApp<party> app(
+      party,
+      std::move(factory),
+      numConversions,
+      false /* computePublisherBreakdowns */,
+      kEpoch,
+      inputPaths,
+      "" /* inputGlobalParamsPath */,
+      "" /* inputExpandedKeyPath */,
+      outputPaths,
+      false /* readInputFromSecretShares */,
+      false /* useDecoupledUDP */,
+      metricCollector,
+      0 /* startFileIndex */,
+      inputPaths.size(),
+      true /* useXorEncryption */,
+      false /* useBinarySecretShares */,
+      numParseThreads);
+  app.run();
+  return app.getSchedulerStatistics();
+}
+
+template <int party>
+common::SchedulerStatistics runShardCombinerApp(
+    std::unique_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory> factory,
+    int32_t numShards,
+    const std::string& inputDir,
+    const std::string& inputPrefix,
+    const std::string& outputPath) {
+  auto metricCollector = std::make_shared<fbpcf::util::MetricCollector>(
+      "shard_combiner_benchmark");
+  shard_combiner::ShardCombinerApp<
+      shard_combiner::ShardSchemaType::kGroupedLiftMetrics,
+      party,
+      true /* usingBatch */,
+      common::InputEncryption::Xor>
+      app(std::move(factory),
+          numShards,
+          0 /* shardStartIndex */,
+          inputDir,
+          inputPrefix,
+          outputPath,
+          100 /* threshold */,
+          true /* useXorEncryption */,
+          common::ResultVisibility::kPublic,
+          metricCollector);
+  app.run();
+  return app.getSchedulerStatistics();
+}
+
+// The files of the shards of a party, `<dir>/<prefix>_<i>` as the shard
+// combiner reads them
+std::vector<std::string>
+shardPaths(const TempDir& dir, const std::string& prefix, int64_t numShards) {
+  std::vector<std::string> paths;
+  for (int64_t i = 0; i < numShards; ++i) {
+    paths.push_back(dir.file(folly::sformat("{}_{}", prefix, i)));
+  }
+  return paths;
+}
+
+TwoPartyStatistics runCalculatorApps(
+    LinkShape shape,
+    const std::vector<std::string>& publisherInputs,
+    const std::vector<std::string>& publisherOutputs,
+    const std::vector<std::string>& partnerInputs,
+    const std::vector<std::string>& partnerOutputs,
+    int32_t numConversions,
+    int numParseThreads) {
+  return runTwoParties(
+      findLoopbackPort(),
+      shape,
+      [&](auto factory) {
+        return runCalculatorApp<common::PUBLISHER>(
+            std::move(factory),
+            publisherInputs,
+            publisherOutputs,
+            numConversions,
+            numParseThreads);
+      },
+      [&](auto factory) {
+        return runCalculatorApp<common::PARTNER>(
+            std::move(factory),
+            partnerInputs,
+            partnerOutputs,
+            numConversions,
+            numParseThreads);
+      });
+}
+} // namespace
+
+/*
+ * Both parties of the lift calculator on rows rows, with conversions
+ * conversions per user and cohorts cohorts, parsed by concurrency threads.
+ */
+static void BM_CalculatorGame(benchmark::State& state) {
+  auto numRows = state.range(0);
+  auto numConversions = state.range(1);
+  auto numCohorts = state.range(2);
+  auto numParseThreads = std::max<int>(state.range(3), 1);
+  auto shape = getLinkShape(state, 4);
+
+  TempDir dir{"lift_benchmark"};
+  auto publisherInputs = shardPaths(dir, "publisher_input", 1);
+  auto partnerInputs = shardPaths(dir, "partner_input", 1);
+  auto publisherOutputs = shardPaths(dir, "publisher_lift", 1);
+  auto partnerOutputs = shardPaths(dir, "partner_lift", 1);
+  writeLiftInputs(
+      publisherInputs, partnerInputs, numRows, numConversions, numCohorts);
+
+  TwoPartyStatistics statistics;
+  for (auto _ : state) {
+    statistics.add(runCalculatorApps(
+        shape,
+        publisherInputs,
+        publisherOutputs,
+        partnerInputs,
+        partnerOutputs,
+        numConversions,
+        numParseThreads));
+  }
+  reportTwoPartyRun(state, statistics, numRows);
+}
+BENCHMARK(BM_CalculatorGame)
+    ->ArgNames(
+        {"rows", "conversions", "cohorts", "concurrency", "latency_ms", "mbps"})
+    ->Args({1000, 4, 0, 1, 0, 0})
+    ->Args({10000, 4, 0, 1, 0, 0})
+    ->Args({10000, 4, 4, 1, 0, 0})
+    ->Args({10000, 4, 0, 4, 0, 0})
+    ->Args({10000, 4, 0, 1, 10, 1000})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+/*
+ * Both parties of the lift calculator on rows rows with 4 conversions per
+ * user, over the scheduler hints of the arguments, to choose the hints of
+ * lift from. Lift only takes lazy or eager.
+ */
+static void BM_CalculatorGameSchedulerHints(benchmark::State& state) {
+  auto numRows = state.range(0);
+  ScopedSchedulerHints hints{getSchedulerHints(state, 1)};
+  auto shape = getLinkShape(state, 4);
+
+  TempDir dir{"lift_hints_benchmark"};
+  auto publisherInputs = shardPaths(dir, "publisher_input", 1);
+  auto partnerInputs = shardPaths(dir, "partner_input", 1);
+  auto publisherOutputs = shardPaths(dir, "publisher_lift", 1);
+  auto partnerOutputs = shardPaths(dir, "partner_lift", 1);
+  writeLiftInputs(publisherInputs, partnerInputs, numRows, 4, 0);
+
+  TwoPartyStatistics statistics;
+  for (auto _ : state) {
+    statistics.add(runCalculatorApps(
+        shape,
+        publisherInputs,
+        publisherOutputs,
+        partnerInputs,
+        partnerOutputs,
+        4,
+        1));
+  }
+  reportTwoPartyRun(state, statistics, numRows);
+}
+BENCHMARK(BM_CalculatorGameSchedulerHints)
+    ->ArgNames(
+        {"rows",
+         "lazy",
+         "flush_rows",
+         "max_batch_width",
+         "latency_ms",
+         "mbps"})
+    ->Args({10000, 1, 0, 0, 0, 0})
+    ->Args({10000, 0, 0, 0, 0, 0})
+    ->Args({10000, 1, 0, 0, 10, 1000})
+    ->Args({10000, 0, 0, 0, 10, 1000})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+/*
+ * Both parties of the shard combiner on shards lift outputs with cohorts
+ * cohorts, which the lift calculator writes before the benchmark starts. Rows
+ * are the shards combined.
+ */
+static void BM_ShardCombinerGame(benchmark::State& state) {
+  auto numShards = std::max<int64_t>(state.range(0), 1);
+  auto numCohorts = state.range(1);
+  auto shape = getLinkShape(state, 2);
+  constexpr int32_t kNumConversions = 4;
+
+  TempDir dir{"shard_combiner_benchmark"};
+  auto publisherOutputs = shardPaths(dir, "publisher_lift", numShards);
+  auto partnerOutputs = shardPaths(dir, "partner_lift", numShards);
+  {
+    auto publisherInputs = shardPaths(dir, "publisher_input", numShards);
+    auto partnerInputs = shardPaths(dir, "partner_input", numShards);
+    writeLiftInputs(
+        publisherInputs,
+        partnerInputs,
+        100 * numShards,
+        kNumConversions,
+        numCohorts);
+    runCalculatorApps(
+        LinkShape{},
+        publisherInputs,
+        publisherOutputs,
+        partnerInputs,
+        partnerOutputs,
+        kNumConversions,
+        1 /* numParseThreads */);
+  }
+
+  TwoPartyStatistics statistics;
+  for (auto _ : state) {
+    statistics.add(runTwoParties(
+        findLoopbackPort(),
+        shape,
+        [&](auto factory) {
+          return runShardCombinerApp<common::PUBLISHER>(
+              std::move(factory),
+              numShards,
+              dir.path(),
+              "publisher_lift",
+              dir.file("publisher_combined.json"));
+        },
+        [&](auto factory) {
+          return runShardCombinerApp<common::PARTNER>(
+              std::move(factory),
+              numShards,
+              dir.path(),
+              "partner_lift",
+              dir.file("partner_combined.json"));
+        }));
+  }
+  reportTwoPartyRun(state, statistics, numShards);
+}
+BENCHMARK(BM_ShardCombinerGame)
+    ->ArgNames({"shards", "cohorts", "latency_ms", "mbps"})
+    ->Args({10, 0, 0, 0})
+    ->Args({100, 0, 0, 0})
+    ->Args({100, 4, 0, 0})
+    ->Args({100, 0, 10, 1000})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+} // namespace benchmarks
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <folly/Format.h>
+#include <folly/Random.h>
+
+#include "fbpcf/engine/communication/IPartyCommunicationAgent.h"
+#include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
+#include "fbpcf/engine/communication/SocketPartyCommunicationAgentFactory.h"
+#include "fbpcf/engine/communication/test/SocketInTestHelper.h"
+#include "fbpcf/util/MetricCollector.h"
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/SchedulerHints.h"
+#include "fbpcs/emp_games/common/SchedulerStatistics.h"
+
+namespace benchmarks {
+
+// Simulated network between the two parties. Zero means no shaping.
+struct LinkShape {
+  std::chrono::milliseconds latency{0}; // one way
+  int64_t bandwidthBytesPerSec = 0;
+};
+
+/*
+ * Forwards to an agent, holding sends back to the bandwidth of the link and
+ * holding the first receive after a send back by the latency of the link, as
+ * that is when a party waits on a message of the other one. This doesn't
+ * model queueing, but charges every round of a protocol a network delay, and
+ * counts the rounds.
+ */
+class ShapedAgent
+    : public fbpcf::engine::communication::IPartyCommunicationAgent {
+ public:
+  ShapedAgent(
+      std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+          agent,
+      LinkShape shape,
+      std::shared_ptr<std::atomic<int64_t>> rounds)
+      : agent_{std::move(agent)},
+        shape_{shape},
+        rounds_{std::move(rounds)},
+        linkFreeAt_{std::chrono::steady_clock::now()} {}
+
+  void send(const std::vector<unsigned char>& data) override {
+    holdForBandwidth(data.size());
+    agent_->send(data);
+  }
+
+  std::vector<unsigned char> receive(size_t size) override {
+    holdForLatency();
+    return agent_->receive(size);
+  }
+
+  std::pair<uint64_t, uint64_t> getTrafficStatistics() const override {
+    return agent_->getTrafficStatistics();
+  }
+
+ protected:
+  void sendImpl(const void* data, int nBytes) override {
+    auto bytes = static_cast<const unsigned char*>(data);
+    send(std::vector<unsigned char>(bytes, bytes + nBytes));
+  }
+
+  void recvImpl(void* data, int nBytes) override {
+    auto received = receive(nBytes);
+    std::memcpy(data, received.data(), received.size());
+  }
+
+ private:
+  void holdForBandwidth(size_t size) {
+    sentSinceReceive_ = true;
+    if (shape_.bandwidthBytesPerSec <= 0) {
+      return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    linkFreeAt_ = std::max(linkFreeAt_, now) +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                      std::chrono::duration<double>(
+                          static_cast<double>(size) /
+                          shape_.bandwidthBytesPerSec));
+    std::this_thread::sleep_until(linkFreeAt_);
+  }
+
+  void holdForLatency() {
+    if (sentSinceReceive_) {
+      ++*rounds_;
+      if (shape_.latency.count() > 0) {
+        std::this_thread::sleep_for(shape_.latency);
+      }
+    }
+    sentSinceReceive_ = false;
+  }
+
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+      agent_;
+  LinkShape shape_;
+  std::shared_ptr<std::atomic<int64_t>> rounds_;
+  std::chrono::steady_clock::time_point linkFreeAt_;
+  bool sentSinceReceive_ = true;
+};
+
+// Wraps every agent of a factory in a ShapedAgent, counting the rounds of all
+// of them together
+class ShapedAgentFactory
+    : public fbpcf::engine::communication::IPartyCommunicationAgentFactory {
+ public:
+  ShapedAgentFactory(
+      std::unique_ptr<
+          fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+          factory,
+      LinkShape shape,
+      std::shared_ptr<fbpcf::util::MetricCollector> metricCollector)
+      : fbpcf::engine::communication::IPartyCommunicationAgentFactory(
+            "shaped_traffic_for_benchmark",
+            metricCollector),
+        factory_{std::move(factory)},
+        shape_{shape},
+        rounds_{std::make_shared<std::atomic<int64_t>>(0)} {}
+
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+  create(int id, std::string name) override {
+    return std::make_unique<ShapedAgent>(
+        factory_->create(id, std::move(name)), shape_, rounds_);
+  }
+
+  // The rounds of all the agents so far, counted while they are in use
+  std::shared_ptr<const std::atomic<int64_t>> getRounds() const {
+    return rounds_;
+  }
+
+ private:
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+      factory_;
+  LinkShape shape_;
+  std::shared_ptr<std::atomic<int64_t>> rounds_;
+};
+
+// The statistics of the schedulers of both parties in a run, and the rounds
+// the publisher waited on the partner for
+struct TwoPartyStatistics {
+  common::SchedulerStatistics publisher{0, 0, 0, 0, folly::dynamic::object()};
+  common::SchedulerStatistics partner{0, 0, 0, 0, folly::dynamic::object()};
+  int64_t rounds = 0;
+
+  void add(const TwoPartyStatistics& other) {
+    publisher.add(other.publisher);
+    partner.add(other.partner);
+    rounds += other.rounds;
+  }
+};
+
+// Runs a party of a game on the factory it is given, returning the statistics
+// of its scheduler
+using PartyRunner = std::function<common::SchedulerStatistics(
+    std::unique_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory>)>;
+
+// A free loopback port at or above the one given, for a pair of parties
+inline int findLoopbackPort(int from = 5000) {
+  return fbpcf::engine::communication::SocketInTestHelper::findNextOpenPort(
+      from);
+}
+
+/*
+ * Runs both parties of a game on their own threads, connected over a loopback
+ * socket on port and shaped by shape, which only counts the rounds when it
+ * is unshaped. Each party makes its factory on its own thread, as the
+ * publisher waits for the partner to connect.
+ */
+inline TwoPartyStatistics runTwoParties(
+    int port,
+    LinkShape shape,
+    PartyRunner runPublisher,
+    PartyRunner runPartner) {
+  auto runParty = [port, shape](int party, const PartyRunner& runner) {
+    std::map<
+        int32_t,
+        fbpcf::engine::communication::SocketPartyCommunicationAgentFactory::
+            PartyInfo>
+        partyInfos(
+            {{common::PUBLISHER, {"127.0.0.1", port}},
+             {common::PARTNER, {"127.0.0.1", port}}});
+    fbpcf::engine::communication::SocketPartyCommunicationAgent::TlsInfo
+        tlsInfo;
+    tlsInfo.useTls = false;
+    auto metricCollector = std::make_shared<fbpcf::util::MetricCollector>(
+        folly::sformat("benchmark_party_{}", party));
+
+    auto factory = std::make_unique<ShapedAgentFactory>(
+        std::make_unique<
+            fbpcf::engine::communication::SocketPartyCommunicationAgentFactory>(
+            party, partyInfos, tlsInfo, metricCollector),
+        shape,
+        metricCollector);
+    auto rounds = factory->getRounds();
+    auto statistics = runner(std::move(factory));
+    return std::make_pair(statistics, rounds->load());
+  };
+
+  auto publisher =
+      std::async(std::launch::async, runParty, common::PUBLISHER, runPublisher);
+  auto partner =
+      std::async(std::launch::async, runParty, common::PARTNER, runPartner);
+  TwoPartyStatistics statistics;
+  std::tie(statistics.publisher, statistics.rounds) = publisher.get();
+  std::tie(statistics.partner, std::ignore) = partner.get();
+  return statistics;
+}
+
+/*
+ * Reports the gates, rounds and traffic of a run of the game, all averaged
+ * over the iterations, and the rows it went through per second of wall time.
+ * Gates and rounds are the publisher's, as the partner's are the same or off
+ * by the last round, and traffic is what both parties sent.
+ */
+inline void reportTwoPartyRun(
+    benchmark::State& state,
+    const TwoPartyStatistics& statistics,
+    int64_t numRows) {
+  auto iterations = std::max<int64_t>(state.iterations(), 1);
+  state.counters["non_free_gates"] = benchmark::Counter(
+      statistics.publisher.nonFreeGates, benchmark::Counter::kAvgIterations);
+  state.counters["free_gates"] = benchmark::Counter(
+      statistics.publisher.freeGates, benchmark::Counter::kAvgIterations);
+  state.counters["rounds"] = benchmark::Counter(
+      statistics.rounds, benchmark::Counter::kAvgIterations);
+  state.counters["sent_bytes"] = benchmark::Counter(
+      statistics.publisher.sentNetwork + statistics.partner.sentNetwork,
+      benchmark::Counter::kAvgIterations,
+      benchmark::Counter::OneK::kIs1024);
+  state.counters["non_free_gates_per_row"] = static_cast<double>(
+      statistics.publisher.nonFreeGates) /
+      static_cast<double>(std::max<int64_t>(numRows, 1) * iterations);
+  state.SetItemsProcessed(numRows * iterations);
+}
+
+// The link shape of the benchmark arguments at latencyArg and the one after,
+// the latency in milliseconds and the bandwidth in megabits per second
+inline LinkShape getLinkShape(const benchmark::State& state, int latencyArg) {
+  return LinkShape{
+      std::chrono::milliseconds(state.range(latencyArg)),
+      state.range(latencyArg + 1) * 1'000'000 / 8};
+}
+
+// The scheduler hints of the benchmark arguments at lazyArg and the two after
+// it: 1 for the lazy scheduler or 0 for the eager one, the rows fed in between
+// reveals and the width of the widest batch, 0 for those of the game
+inline common::SchedulerHints getSchedulerHints(
+    const benchmark::State& state,
+    int lazyArg) {
+  common::SchedulerHints hints;
+  hints.lazy = state.range(lazyArg) != 0;
+  hints.flushRows = state.range(lazyArg + 1);
+  hints.maxBatchWidth = state.range(lazyArg + 2);
+  return hints;
+}
+
+// Runs the games with the scheduler hints given while in scope, over the
+// hints of each game
+class ScopedSchedulerHints {
+ public:
+  explicit ScopedSchedulerHints(const common::SchedulerHints& hints)
+      : previous_{FLAGS_scheduler_hints} {
+    FLAGS_scheduler_hints = hints.toString();
+  }
+  ~ScopedSchedulerHints() {
+    FLAGS_scheduler_hints = previous_;
+  }
+
+  ScopedSchedulerHints(const ScopedSchedulerHints&) = delete;
+  ScopedSchedulerHints& operator=(const ScopedSchedulerHints&) = delete;
+
+ private:
+  std::string previous_;
+};
+
+// A directory of its own for the inputs and outputs of a benchmark, removed
+// when it goes out of scope
+class TempDir {
+ public:
+  explicit TempDir(const std::string& name)
+      : path_{std::filesystem::temp_directory_path() /
+              folly::sformat(
+                  "{}_{}", name, folly::Random::secureRand64())} {
+    std::filesystem::create_directories(path_);
+  }
+  ~TempDir() {
+    std::error_code ec;
+    std::filesystem::remove_all(path_, ec);
+  }
+
+  TempDir(const TempDir&) = delete;
+  TempDir& operator=(const TempDir&) = delete;
+
+  std::string file(const std::string& name) const {
+    return path_ / name;
+  }
+
+  std::string path() const {
+    return path_;
+  }
+
+ private:
+  std::filesystem::path path_;
+};
+
+} // namespace benchmarks
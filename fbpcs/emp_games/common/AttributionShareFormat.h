@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+A binary format for handing the secret shares of the attribution results from
+pcf2_attribution to pcf2_aggregation, so that the results don't have to be
+written as JSON objects per user by one game and parsed back by the next one.
+Like the row group format it only depends on the standard library and is
+header only.
+
+All integers are written in the byte order of the host, which is little endian
+on every platform we run on. A file is laid out as:
+
+  magic             8 bytes, kMagic
+  numRules          uint32
+  per rule:
+    nameSize        uint32, followed by the name
+    reformatted     uint8, 1 for the ad id and conversion value results of the
+                    new output format
+    numUsers        uint64
+    resultsPerUser  uint32
+    isAttributed    numUsers * resultsPerUser bits, packed 8 to a byte
+    if reformatted:
+      adIds         numUsers * resultsPerUser uint16 values
+      convValues    numUsers * resultsPerUser uint32 values
+
+The results of a rule are ordered by user id, then in the order of the results
+of the user, which is the order pcf2_aggregation shares them in.
+*/
+namespace private_measurement::attribution_shares {
+
+constexpr std::string_view kMagic{"PCSATSH1", 8};
+
+// The shares of the results of one attribution rule, flattened as described
+// above. adIds and convValues are only set for the reformatted results.
+struct RuleShares {
+  std::string rule;
+  bool reformatted = false;
+  uint64_t numUsers = 0;
+  uint32_t resultsPerUser = 0;
+  std::vector<bool> isAttributed;
+  std::vector<uint16_t> adIds;
+  std::vector<uint32_t> convValues;
+
+  bool operator==(const RuleShares& other) const {
+    return rule == other.rule && reformatted == other.reformatted &&
+        numUsers == other.numUsers && resultsPerUser == other.resultsPerUser &&
+        isAttributed == other.isAttributed && adIds == other.adIds &&
+        convValues == other.convValues;
+  }
+};
+
+// Whether the first bytes of a file are the magic of this format
+inline bool hasMagic(std::string_view prefix) {
+  return prefix.substr(0, kMagic.size()) == kMagic;
+}
+
+namespace detail {
+template <typename T>
+inline void append(std::string& out, T value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+inline void appendAll(std::string& out, const std::vector<T>& values) {
+  out.append(
+      reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+class Cursor {
+ public:
+  explicit Cursor(std::string_view content) : content_{content} {}
+
+  std::string_view take(std::size_t size) {
+    if (size > content_.size() - position_) {
+      throw std::runtime_error("Attribution shares are truncated");
+    }
+    auto bytes = content_.substr(position_, size);
+    position_ += size;
+    return bytes;
+  }
+
+  template <typename T>
+  T read() {
+    T value;
+    std::memcpy(&value, take(sizeof(T)).data(), sizeof(T));
+    return value;
+  }
+
+  template <typename T>
+  void readAll(std::vector<T>& values, std::size_t size) {
+    if (size > (content_.size() - position_) / sizeof(T)) {
+      throw std::runtime_error("Attribution shares are truncated");
+    }
+    values.resize(size);
+    std::memcpy(values.data(), take(size * sizeof(T)).data(), size * sizeof(T));
+  }
+
+  bool atEnd() const {
+    return position_ == content_.size();
+  }
+
+ private:
+  std::string_view content_;
+  std::size_t position_ = 0;
+};
+} // namespace detail
+
+// Throws std::invalid_argument if the shares of a rule don't have one value of
+// each field for every result
+inline std::string encode(const std::vector<RuleShares>& rules) {
+  std::string out{kMagic};
+  detail::append<uint32_t>(out, rules.size());
+  for (auto& shares : rules) {
+    auto numResults = shares.numUsers * shares.resultsPerUser;
+    if (shares.isAttributed.size() != numResults ||
+        (shares.reformatted &&
+         (shares.adIds.size() != numResults ||
+          shares.convValues.size() != numResults))) {
+      throw std::invalid_argument(
+          "The attribution shares of rule " + shares.rule +
+          " don't have the same number of results for every user and field");
+    }
+    detail::append<uint32_t>(out, shares.rule.size());
+    out += shares.rule;
+    detail::append<uint8_t>(out, shares.reformatted);
+    detail::append<uint64_t>(out, shares.numUsers);
+    detail::append<uint32_t>(out, shares.resultsPerUser);
+
+    std::string packed((numResults + 7) / 8, '\0');
+    for (std::size_t i = 0; i < numResults; ++i) {
+      if (shares.isAttributed[i]) {
+        packed[i / 8] |= static_cast<char>(1 << (i % 8));
+      }
+    }
+    out += packed;
+    if (shares.reformatted) {
+      detail::appendAll(out, shares.adIds);
+      detail::appendAll(out, shares.convValues);
+    }
+  }
+  return out;
+}
+
+// Throws std::runtime_error on content which isn't in this format or is
+// malformed
+inline std::vector<RuleShares> decode(std::string_view content) {
+  if (!hasMagic(content)) {
+    throw std::runtime_error("Input is not in the attribution shares format");
+  }
+  detail::Cursor cursor{content.substr(kMagic.size())};
+  auto numRules = cursor.read<uint32_t>();
+  // Every rule takes at least the bytes of its sizes
+  if (numRules > content.size() / (2 * sizeof(uint32_t) + sizeof(uint64_t))) {
+    throw std::runtime_error("Attribution shares are truncated");
+  }
+  std::vector<RuleShares> rules(numRules);
+  for (auto& shares : rules) {
+    shares.rule = std::string{cursor.take(cursor.read<uint32_t>())};
+    shares.reformatted = cursor.read<uint8_t>() != 0;
+    shares.numUsers = cursor.read<uint64_t>();
+    shares.resultsPerUser = cursor.read<uint32_t>();
+    if (shares.resultsPerUser != 0 &&
+        shares.numUsers > content.size() * 8 / shares.resultsPerUser) {
+      throw std::runtime_error("Attribution shares are truncated");
+    }
+    auto numResults = shares.numUsers * shares.resultsPerUser;
+
+    auto packed = cursor.take((numResults + 7) / 8);
+    shares.isAttributed.resize(numResults);
+    for (std::size_t i = 0; i < numResults; ++i) {
+      shares.isAttributed[i] = (packed[i / 8] >> (i % 8)) & 1;
+    }
+    if (shares.reformatted) {
+      cursor.readAll(shares.adIds, numResults);
+      cursor.readAll(shares.convValues, numResults);
+    }
+  }
+  if (!cursor.atEnd()) {
+    throw std::runtime_error("Attribution shares have trailing bytes");
+  }
+  return rules;
+}
+
+} // namespace private_measurement::attribution_shares
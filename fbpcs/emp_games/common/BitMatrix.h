@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace common {
+
+/*
+ * A matrix of bits packed into 64 bit words, a row at a time, with column c of
+ * a row in bit c % 64 of its word c / 64. The bits past the last column of a
+ * row are always zero.
+ *
+ * It is meant for reshaping bit shares, such as packing integer columns into
+ * one bit per row for a batch of secret bits and unpacking their shares back
+ * into integers, which is a transpose. Transposing goes 64 by 64 bits at a
+ * time with word operations, instead of one std::vector<bool> bit proxy at a
+ * time. The fbpcf frontend and ORAMs take std::vector<bool>, so shares are
+ * converted from and to that at the edges with fromBits and getRow.
+ */
+class BitMatrix {
+ public:
+  BitMatrix() = default;
+
+  // A matrix of zeros
+  BitMatrix(std::size_t numRows, std::size_t numCols)
+      : numRows_{numRows},
+        numCols_{numCols},
+        wordsPerRow_{(numCols + 63) / 64},
+        words_(numRows * wordsPerRow_, 0) {}
+
+  std::size_t getNumRows() const {
+    return numRows_;
+  }
+
+  std::size_t getNumCols() const {
+    return numCols_;
+  }
+
+  std::size_t getWordsPerRow() const {
+    return wordsPerRow_;
+  }
+
+  bool get(std::size_t row, std::size_t col) const {
+    return (rowWords(row)[col / 64] >> (col % 64)) & 1;
+  }
+
+  void set(std::size_t row, std::size_t col, bool value) {
+    auto& word = rowWords(row)[col / 64];
+    auto mask = uint64_t{1} << (col % 64);
+    word = value ? word | mask : word & ~mask;
+  }
+
+  const uint64_t* rowWords(std::size_t row) const {
+    return words_.data() + row * wordsPerRow_;
+  }
+
+  uint64_t* rowWords(std::size_t row) {
+    return words_.data() + row * wordsPerRow_;
+  }
+
+  // Sets the row to bits, whose missing columns are zero. Throws
+  // std::invalid_argument if there are more bits than columns.
+  void setRow(std::size_t row, const std::vector<bool>& bits) {
+    setRow(row, bits, 0, bits.size());
+  }
+
+  // Sets the row to the size bits of bits from offset
+  void setRow(
+      std::size_t row,
+      const std::vector<bool>& bits,
+      std::size_t offset,
+      std::size_t size) {
+    if (size > numCols_ || offset + size > bits.size()) {
+      throw std::invalid_argument(
+          "Row of " + std::to_string(size) + " bits in rows of " +
+          std::to_string(numCols_) + " bits");
+    }
+    auto words = rowWords(row);
+    std::fill(words, words + wordsPerRow_, 0);
+    for (std::size_t i = 0; i < size; ++i) {
+      words[i / 64] |= static_cast<uint64_t>(bits[offset + i]) << (i % 64);
+    }
+  }
+
+  std::vector<bool> getRow(std::size_t row) const {
+    std::vector<bool> bits;
+    appendRowTo(row, bits);
+    return bits;
+  }
+
+  // Appends the bits of the row to out
+  void appendRowTo(std::size_t row, std::vector<bool>& out) const {
+    auto words = rowWords(row);
+    out.reserve(out.size() + numCols_);
+    for (std::size_t i = 0; i < numCols_; ++i) {
+      out.push_back((words[i / 64] >> (i % 64)) & 1);
+    }
+  }
+
+  // The bits of every row one after the other, as they are secret shared
+  std::vector<bool> toBits() const {
+    std::vector<bool> bits;
+    bits.reserve(numRows_ * numCols_);
+    for (std::size_t row = 0; row < numRows_; ++row) {
+      appendRowTo(row, bits);
+    }
+    return bits;
+  }
+
+  // The numRows rows of numCols bits which follow each other in bits from
+  // offset
+  static BitMatrix fromBits(
+      const std::vector<bool>& bits,
+      std::size_t offset,
+      std::size_t numRows,
+      std::size_t numCols) {
+    BitMatrix matrix{numRows, numCols};
+    for (std::size_t row = 0; row < numRows; ++row) {
+      matrix.setRow(row, bits, offset + row * numCols, numCols);
+    }
+    return matrix;
+  }
+
+  // A row per value, holding its lowest width bits. Signed values are taken
+  // as their two's complement.
+  template <typename T>
+  static BitMatrix fromInts(const std::vector<T>& values, std::size_t width) {
+    static_assert(std::is_integral_v<T>, "Only integers can be packed");
+    if (width > 64) {
+      throw std::invalid_argument("Integers are at most 64 bits wide");
+    }
+    BitMatrix matrix{values.size(), width};
+    auto mask = width == 64 ? ~uint64_t{0} : (uint64_t{1} << width) - 1;
+    if (width == 0) {
+      return matrix;
+    }
+    for (std::size_t row = 0; row < values.size(); ++row) {
+      matrix.words_[row] = static_cast<uint64_t>(values[row]) & mask;
+    }
+    return matrix;
+  }
+
+  // The rows as integers, from rows of at most 64 bits. Signed integers are
+  // sign extended from the last column.
+  template <typename T>
+  std::vector<T> toInts() const {
+    static_assert(std::is_integral_v<T>, "Only integers can be unpacked");
+    if (numCols_ > 64) {
+      throw std::invalid_argument("Integers are at most 64 bits wide");
+    }
+    std::vector<T> values;
+    values.reserve(numRows_);
+    for (std::size_t row = 0; row < numRows_; ++row) {
+      auto value = numCols_ == 0 ? 0 : words_[row];
+      if constexpr (std::is_signed_v<T>) {
+        if (numCols_ > 0 && numCols_ < 64 && ((value >> (numCols_ - 1)) & 1)) {
+          value |= ~uint64_t{0} << numCols_;
+        }
+      }
+      values.push_back(static_cast<T>(value));
+    }
+    return values;
+  }
+
+  // The matrix with its rows as columns, transposed a block of 64 by 64 bits
+  // at a time
+  BitMatrix transpose() const {
+    BitMatrix transposed{numCols_, numRows_};
+    std::array<uint64_t, 64> block;
+    for (std::size_t rowBlock = 0; rowBlock < numRows_; rowBlock += 64) {
+      auto blockRows = std::min<std::size_t>(64, numRows_ - rowBlock);
+      for (std::size_t colWord = 0; colWord < wordsPerRow_; ++colWord) {
+        for (std::size_t i = 0; i < blockRows; ++i) {
+          block[i] = rowWords(rowBlock + i)[colWord];
+        }
+        std::fill(block.begin() + blockRows, block.end(), 0);
+        transposeBlock(block);
+        auto blockCols = std::min<std::size_t>(64, numCols_ - colWord * 64);
+        for (std::size_t i = 0; i < blockCols; ++i) {
+          transposed.rowWords(colWord * 64 + i)[rowBlock / 64] = block[i];
+        }
+      }
+    }
+    return transposed;
+  }
+
+  // Transposes 64 rows of 64 bits in place, swapping the off diagonal halves
+  // of ever smaller blocks with word shifts and masks
+  static void transposeBlock(std::array<uint64_t, 64>& block) {
+    uint64_t mask = 0x00000000FFFFFFFFULL;
+    for (std::size_t half = 32; half != 0;
+         half >>= 1, mask ^= mask << half) {
+      for (std::size_t i = 0; i < 64; i = ((i | half) + 1) & ~half) {
+        auto swapped = ((block[i] >> half) ^ block[i | half]) & mask;
+        block[i] ^= swapped << half;
+        block[i | half] ^= swapped;
+      }
+    }
+  }
+
+ private:
+  std::size_t numRows_ = 0;
+  std::size_t numCols_ = 0;
+  std::size_t wordsPerRow_ = 0;
+  std::vector<uint64_t> words_;
+};
+
+} // namespace common
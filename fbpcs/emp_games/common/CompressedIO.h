@@ -0,0 +1,873 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <aws/s3/model/AbortMultipartUploadRequest.h>
+#include <aws/s3/model/ListMultipartUploadsRequest.h>
+#include <folly/Random.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/futures/Future.h>
+#include <folly/io/Compression.h>
+#include <folly/logging/xlog.h>
+
+#include "fbpcf/aws/S3Util.h"
+#include "fbpcf/io/api/BufferedReader.h"
+#include "fbpcf/io/api/BufferedWriter.h"
+#include "fbpcf/io/api/FileIOWrappers.h"
+#include "fbpcf/io/api/FileReader.h"
+#include "fbpcf/io/api/FileWriter.h"
+#include "fbpcf/io/api/IReaderCloser.h"
+#include "fbpcf/io/api/IWriterCloser.h"
+#include "fbpcf/io/cloud_util/CloudFileUtil.h"
+
+/*
+Compressed streaming I/O for the intermediate files handed between the
+data_processing stages and the games, so that less data moves through remote
+storage between containers. It is header only so that both the
+data_processing binaries and the games can include it.
+
+Files whose path ends in kZstdSuffix or kLz4Suffix are written compressed by
+makeFileWriter, and makeFileReader reads compressed files transparently
+whatever their name. The data is cut into independently compressed frames,
+which are compressed and decompressed on a shared pool of threads while the
+previous frames are written or read, so that the codec doesn't become the
+bottleneck. The fastest compression level of each codec is used.
+
+A compressed file is laid out as:
+
+  magic           8 bytes, kMagic
+  codec           uint8, a Codec
+  frames, each one:
+    rawSize        uint32, 0 for the empty frame ending the file
+    compressedSize uint32, followed by the compressed bytes
+
+All integers are written in the byte order of the host, which is little endian
+on every platform we run on. Since the frames carry their own sizes, these are
+not plain .zst or .lz4 files, and have to be read back through makeFileReader.
+
+Files in S3 are read by makeFileReader with several concurrent ranged GETs
+ahead of the reader, since a single stream from S3 is much slower than the
+network of the instance, unless a different way of opening them is set with
+setS3ReaderOpener. The games use it to read their inputs from a local cache
+(see InputCache.h), which is kept out of this header since data_processing
+doesn't use it.
+
+Outputs are written straight to their final location by OutputFileStream,
+rather than to a local file which is then copied there with transferFile.
+*/
+namespace private_measurement::compressed_io {
+
+constexpr std::string_view kMagic{"PCSCOMP1", 8};
+constexpr std::string_view kZstdSuffix{".zst"};
+constexpr std::string_view kLz4Suffix{".lz4"};
+// Bytes of data compressed into one frame
+constexpr std::size_t kFrameSize = 1 << 20;
+// Frames of a file being compressed or decompressed at once
+constexpr std::size_t kFramesInFlight = 8;
+// Bytes of a remote file fetched by one ranged read
+constexpr std::size_t kPrefetchPartSize = 8 << 20;
+// Parts of a remote file being fetched ahead of the reader at once
+constexpr std::size_t kPrefetchPartsAhead = 8;
+// Threads fetching parts of remote files, shared by every file
+constexpr std::size_t kPrefetchThreads = 32;
+
+enum class Codec : uint8_t { kNone = 0, kZstd = 1, kLz4 = 2 };
+
+// The codec a file is written with, chosen by the suffix of its path
+inline Codec getCodecForPath(std::string_view path) {
+  auto endsWith = [&path](std::string_view suffix) {
+    return path.size() >= suffix.size() &&
+        path.substr(path.size() - suffix.size()) == suffix;
+  };
+  if (endsWith(kZstdSuffix)) {
+    return Codec::kZstd;
+  }
+  if (endsWith(kLz4Suffix)) {
+    return Codec::kLz4;
+  }
+  return Codec::kNone;
+}
+
+// The codec named by a flag - options: (none|zstd|lz4)
+inline Codec parseCodec(std::string_view name) {
+  if (name == "none") {
+    return Codec::kNone;
+  }
+  if (name == "zstd") {
+    return Codec::kZstd;
+  }
+  if (name == "lz4") {
+    return Codec::kLz4;
+  }
+  throw std::invalid_argument(
+      "Unknown compression '" + std::string{name} +
+      "'. Expected 'none', 'zstd' or 'lz4'.");
+}
+
+// Whether the first bytes of a file are the magic of a compressed file
+inline bool hasMagic(std::string_view prefix) {
+  return prefix.substr(0, kMagic.size()) == kMagic;
+}
+
+namespace detail {
+// The threads compressing and decompressing frames, shared by every file
+inline folly::CPUThreadPoolExecutor& getExecutor() {
+  static folly::CPUThreadPoolExecutor executor{
+      std::max<std::size_t>(std::thread::hardware_concurrency(), 1)};
+  return executor;
+}
+
+// The threads fetching parts of remote files, which mostly wait on the network
+inline folly::CPUThreadPoolExecutor& getPrefetchExecutor() {
+  static folly::CPUThreadPoolExecutor executor{kPrefetchThreads};
+  return executor;
+}
+
+inline std::unique_ptr<folly::io::Codec> getFollyCodec(Codec codec) {
+  switch (codec) {
+    case Codec::kZstd:
+      return folly::io::getCodec(
+          folly::io::CodecType::ZSTD, folly::io::COMPRESSION_LEVEL_FASTEST);
+    case Codec::kLz4:
+      return folly::io::getCodec(
+          folly::io::CodecType::LZ4, folly::io::COMPRESSION_LEVEL_FASTEST);
+    case Codec::kNone:
+      break;
+  }
+  throw std::invalid_argument(
+      "Unknown codec " + std::to_string(static_cast<int>(codec)));
+}
+
+inline void appendUint32(std::string& out, uint32_t value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Runs fn on the shared executor, or on the given one
+template <typename T, typename F>
+folly::SemiFuture<T> runOnExecutor(
+    F&& fn,
+    folly::CPUThreadPoolExecutor& executor = getExecutor()) {
+  auto [promise, future] = folly::makePromiseContract<T>();
+  executor.add(
+      [promise = std::move(promise), fn = std::forward<F>(fn)]() mutable {
+        promise.setWith(fn);
+      });
+  return std::move(future);
+}
+} // namespace detail
+
+/*
+An fbpcf::io::IWriterCloser which compresses everything written to it into
+another writer. Frames are compressed concurrently but written in order.
+*/
+class CompressingWriter final : public fbpcf::io::IWriterCloser {
+ public:
+  CompressingWriter(
+      std::unique_ptr<fbpcf::io::IWriterCloser> baseWriter,
+      Codec codec)
+      : baseWriter_{std::move(baseWriter)}, codec_{codec} {
+    std::string header{kMagic};
+    header += static_cast<char>(codec_);
+    writeToBase(header);
+  }
+
+  // Finishes the file if it wasn't closed. Nothing can be thrown from here,
+  // so a failure to write it out is only logged; call close() to see it.
+  ~CompressingWriter() override {
+    try {
+      close();
+    } catch (const std::exception& e) {
+      XLOG(ERR) << "Failed to close compressed output: " << e.what();
+    }
+  }
+
+  size_t write(std::vector<char>& buf) override {
+    auto data = buf.data();
+    auto remaining = buf.size();
+    while (remaining > 0) {
+      auto size = std::min(remaining, kFrameSize - frame_.size());
+      frame_.append(data, size);
+      data += size;
+      remaining -= size;
+      if (frame_.size() == kFrameSize) {
+        compressFrame();
+      }
+    }
+    return buf.size();
+  }
+
+  int close() override {
+    if (closed_) {
+      return 0;
+    }
+    closed_ = true;
+    if (!frame_.empty()) {
+      compressFrame();
+    }
+    while (!inFlight_.empty()) {
+      writeNextFrame();
+    }
+    std::string end;
+    detail::appendUint32(end, 0);
+    detail::appendUint32(end, 0);
+    writeToBase(end);
+    return baseWriter_->close();
+  }
+
+ private:
+  void compressFrame() {
+    inFlight_.push_back(detail::runOnExecutor<std::string>(
+        [codec = codec_, frame = std::move(frame_)]() {
+          auto compressed = detail::getFollyCodec(codec)->compress(frame);
+          std::string out;
+          detail::appendUint32(out, frame.size());
+          detail::appendUint32(out, compressed.size());
+          out += compressed;
+          return out;
+        }));
+    frame_ = std::string{};
+    frame_.reserve(kFrameSize);
+    if (inFlight_.size() >= kFramesInFlight) {
+      writeNextFrame();
+    }
+  }
+
+  void writeNextFrame() {
+    auto frame = std::move(inFlight_.front()).get();
+    inFlight_.pop_front();
+    writeToBase(frame);
+  }
+
+  void writeToBase(const std::string& data) {
+    std::vector<char> buf(data.begin(), data.end());
+    baseWriter_->write(buf);
+  }
+
+  std::unique_ptr<fbpcf::io::IWriterCloser> baseWriter_;
+  Codec codec_;
+  std::string frame_;
+  std::deque<folly::SemiFuture<std::string>> inFlight_;
+  bool closed_ = false;
+};
+
+/*
+An fbpcf::io::IReaderCloser which decompresses another reader if it holds a
+compressed file, and reads it unchanged otherwise. The frames following the
+one being read are decompressed concurrently. Throws std::runtime_error on a
+truncated or malformed file.
+*/
+class DecompressingReader final : public fbpcf::io::IReaderCloser {
+ public:
+  explicit DecompressingReader(
+      std::unique_ptr<fbpcf::io::IReaderCloser> baseReader)
+      : baseReader_{std::move(baseReader)} {
+    std::string header(kMagic.size() + 1, '\0');
+    header.resize(readFromBase(header.data(), header.size()));
+    if (header.size() == kMagic.size() + 1 && hasMagic(header)) {
+      codec_ = static_cast<Codec>(header.back());
+      detail::getFollyCodec(codec_);
+      decompressAhead();
+    } else {
+      // Not compressed, so what was read is the start of the data
+      current_ = std::move(header);
+    }
+  }
+
+  size_t read(std::vector<char>& buf) override {
+    size_t size = 0;
+    while (size < buf.size() && nextData()) {
+      auto copied = std::min(buf.size() - size, current_.size() - position_);
+      std::memcpy(buf.data() + size, current_.data() + position_, copied);
+      position_ += copied;
+      size += copied;
+    }
+    return size;
+  }
+
+  bool eof() override {
+    return !nextData();
+  }
+
+  int close() override {
+    return baseReader_->close();
+  }
+
+ private:
+  // Makes sure current_ has unread data, returning false at the end
+  bool nextData() {
+    if (position_ < current_.size()) {
+      return true;
+    }
+    if (codec_ == Codec::kNone) {
+      current_.resize(kFrameSize);
+      current_.resize(readFromBase(current_.data(), current_.size()));
+      position_ = 0;
+      return !current_.empty();
+    }
+    while (position_ == current_.size() && !inFlight_.empty()) {
+      current_ = std::move(inFlight_.front()).get();
+      inFlight_.pop_front();
+      position_ = 0;
+      decompressAhead();
+    }
+    return position_ < current_.size();
+  }
+
+  // Reads frames until kFramesInFlight are being decompressed or the end of
+  // the file is reached
+  void decompressAhead() {
+    while (!ended_ && inFlight_.size() < kFramesInFlight) {
+      uint32_t sizes[2];
+      readExactly(reinterpret_cast<char*>(sizes), sizeof(sizes));
+      if (sizes[0] == 0) {
+        ended_ = true;
+        return;
+      }
+      std::string compressed(sizes[1], '\0');
+      readExactly(compressed.data(), compressed.size());
+      inFlight_.push_back(detail::runOnExecutor<std::string>(
+          [codec = codec_,
+           rawSize = sizes[0],
+           compressed = std::move(compressed)]() {
+            auto frame =
+                detail::getFollyCodec(codec)->uncompress(compressed, rawSize);
+            if (frame.size() != rawSize) {
+              throw std::runtime_error("Compressed frame has the wrong size");
+            }
+            return frame;
+          }));
+    }
+  }
+
+  void readExactly(char* data, size_t size) {
+    if (readFromBase(data, size) != size) {
+      throw std::runtime_error("Compressed input ended unexpectedly");
+    }
+  }
+
+  // Reads up to size bytes, fewer only at the end of the input
+  size_t readFromBase(char* data, size_t size) {
+    size_t read = 0;
+    while (read < size) {
+      if (rawPosition_ == raw_.size()) {
+        if (baseReader_->eof()) {
+          break;
+        }
+        raw_.resize(kFrameSize);
+        raw_.resize(baseReader_->read(raw_));
+        rawPosition_ = 0;
+        if (raw_.empty()) {
+          break;
+        }
+      }
+      auto copied = std::min(size - read, raw_.size() - rawPosition_);
+      std::memcpy(data + read, raw_.data() + rawPosition_, copied);
+      rawPosition_ += copied;
+      read += copied;
+    }
+    return read;
+  }
+
+  std::unique_ptr<fbpcf::io::IReaderCloser> baseReader_;
+  Codec codec_ = Codec::kNone;
+  std::vector<char> raw_;
+  size_t rawPosition_ = 0;
+  std::string current_;
+  size_t position_ = 0;
+  std::deque<folly::SemiFuture<std::string>> inFlight_;
+  bool ended_ = false;
+};
+
+/*
+An fbpcf::io::IReaderCloser which reads head, bytes an earlier read took from
+reader, and then the rest of reader, as if they had never been read. It lets a
+caller which read the start of a file to find out its format hand the opened
+file on instead of opening it again.
+*/
+class PushbackReader final : public fbpcf::io::IReaderCloser {
+ public:
+  PushbackReader(
+      std::vector<char> head,
+      std::unique_ptr<fbpcf::io::IReaderCloser> reader)
+      : head_{std::move(head)}, reader_{std::move(reader)} {}
+
+  size_t read(std::vector<char>& buf) override {
+    if (offset_ == head_.size()) {
+      return reader_->read(buf);
+    }
+    auto size = std::min(buf.size(), head_.size() - offset_);
+    std::memcpy(buf.data(), head_.data() + offset_, size);
+    offset_ += size;
+    return size;
+  }
+
+  bool eof() override {
+    return offset_ == head_.size() && reader_->eof();
+  }
+
+  int close() override {
+    return reader_->close();
+  }
+
+ private:
+  std::vector<char> head_;
+  std::size_t offset_ = 0;
+  std::unique_ptr<fbpcf::io::IReaderCloser> reader_;
+};
+
+/*
+An fbpcf::io::IReaderCloser over a file read in ranges, such as an object in
+S3. The parts following the one being read are fetched concurrently, up to
+partsAhead of them. Throws std::runtime_error if a range is read short.
+*/
+class PrefetchingReader final : public fbpcf::io::IReaderCloser {
+ public:
+  // Reads the bytes of the file from start up to, but not including, end.
+  // Called concurrently from the prefetching threads.
+  using ReadRange = std::function<std::string(std::size_t, std::size_t)>;
+
+  PrefetchingReader(
+      ReadRange readRange,
+      std::size_t size,
+      std::size_t partSize = kPrefetchPartSize,
+      std::size_t partsAhead = kPrefetchPartsAhead)
+      : readRange_{std::move(readRange)},
+        size_{size},
+        partSize_{std::max<std::size_t>(partSize, 1)},
+        partsAhead_{std::max<std::size_t>(partsAhead, 1)} {
+    fetchAhead();
+  }
+
+  ~PrefetchingReader() override {
+    close();
+  }
+
+  size_t read(std::vector<char>& buf) override {
+    size_t size = 0;
+    while (size < buf.size() && nextData()) {
+      auto copied = std::min(buf.size() - size, current_.size() - position_);
+      std::memcpy(buf.data() + size, current_.data() + position_, copied);
+      position_ += copied;
+      size += copied;
+    }
+    return size;
+  }
+
+  bool eof() override {
+    return !nextData();
+  }
+
+  int close() override {
+    // Wait for the parts still being fetched, which are no longer needed
+    while (!inFlight_.empty()) {
+      std::move(inFlight_.front()).wait();
+      inFlight_.pop_front();
+    }
+    nextOffset_ = size_;
+    return 0;
+  }
+
+ private:
+  // Makes sure current_ has unread data, returning false at the end
+  bool nextData() {
+    while (position_ == current_.size() && !inFlight_.empty()) {
+      // Taken out of the queue first so that a failed part isn't waited on
+      // again when the reader is closed
+      auto part = std::move(inFlight_.front());
+      inFlight_.pop_front();
+      current_ = std::move(part).get();
+      position_ = 0;
+      fetchAhead();
+    }
+    return position_ < current_.size();
+  }
+
+  // Starts fetching parts until partsAhead_ are being fetched or the end of
+  // the file is reached
+  void fetchAhead() {
+    while (nextOffset_ < size_ && inFlight_.size() < partsAhead_) {
+      auto start = nextOffset_;
+      auto end = std::min(size_, start + partSize_);
+      nextOffset_ = end;
+      inFlight_.push_back(detail::runOnExecutor<std::string>(
+          [readRange = readRange_, start, end]() {
+            auto part = readRange(start, end);
+            if (part.size() < end - start) {
+              throw std::runtime_error("Remote file was read short");
+            }
+            part.resize(end - start);
+            return part;
+          },
+          detail::getPrefetchExecutor()));
+    }
+  }
+
+  ReadRange readRange_;
+  std::size_t size_;
+  std::size_t partSize_;
+  std::size_t partsAhead_;
+  std::size_t nextOffset_ = 0;
+  std::string current_;
+  size_t position_ = 0;
+  std::deque<folly::SemiFuture<std::string>> inFlight_;
+};
+
+namespace detail {
+// Opens a file in S3 for reading, fetching it ahead in parts
+inline std::unique_ptr<PrefetchingReader> makePrefetchingReader(
+    const std::string& path,
+    std::size_t partSize,
+    std::size_t partsAhead) {
+  // The client is shared by the fetches in flight, which may outlive the
+  // reader if it is closed early
+  std::shared_ptr<fbpcf::cloudio::IFileReader> cloudReader =
+      fbpcf::cloudio::getCloudFileReader(path);
+  auto size = cloudReader->getFileSize(path);
+  return std::make_unique<PrefetchingReader>(
+      [cloudReader, path](std::size_t start, std::size_t end) {
+        return cloudReader->readBytes(path, start, end);
+      },
+      size,
+      partSize,
+      partsAhead);
+}
+
+// Copies a file in S3 to a local path, fetching it ahead in parts
+inline void downloadFile(
+    const std::string& path,
+    const std::string& localPath,
+    std::size_t partSize,
+    std::size_t partsAhead) {
+  auto reader = makePrefetchingReader(path, partSize, partsAhead);
+  fbpcf::io::FileWriter writer{localPath};
+  std::vector<char> buf(partSize);
+  while (!reader->eof()) {
+    buf.resize(partSize);
+    buf.resize(reader->read(buf));
+    writer.write(buf);
+  }
+  reader->close();
+  writer.close();
+}
+} // namespace detail
+
+// Opens a file in S3 for reading, given the part size and the number of parts
+// ahead which makeRawFileReader was called with
+using S3ReaderOpener = std::function<std::unique_ptr<fbpcf::io::IReaderCloser>(
+    const std::string& path,
+    std::size_t partSize,
+    std::size_t partsAhead)>;
+
+namespace detail {
+inline S3ReaderOpener& getS3ReaderOpenerInstance() {
+  static S3ReaderOpener opener;
+  return opener;
+}
+
+inline std::mutex& getS3ReaderOpenerMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+} // namespace detail
+
+// Has makeRawFileReader open the files in S3 read by this process with opener,
+// or fetch them ahead in parts again if opener is empty
+inline void setS3ReaderOpener(S3ReaderOpener opener) {
+  std::lock_guard<std::mutex> lock{detail::getS3ReaderOpenerMutex()};
+  detail::getS3ReaderOpenerInstance() = std::move(opener);
+}
+
+inline S3ReaderOpener getS3ReaderOpener() {
+  std::lock_guard<std::mutex> lock{detail::getS3ReaderOpenerMutex()};
+  return detail::getS3ReaderOpenerInstance();
+}
+
+// Opens a file for reading. A file in S3 is opened by the opener set with
+// setS3ReaderOpener if there is one, and otherwise fetched ahead in parts.
+inline std::unique_ptr<fbpcf::io::IReaderCloser> makeRawFileReader(
+    const std::string& path,
+    std::size_t partSize = kPrefetchPartSize,
+    std::size_t partsAhead = kPrefetchPartsAhead) {
+  if (fbpcf::cloudio::getCloudFileType(path) !=
+      fbpcf::cloudio::CloudFileType::S3) {
+    return std::make_unique<fbpcf::io::FileReader>(path);
+  }
+  if (auto opener = getS3ReaderOpener()) {
+    return opener(path, partSize, partsAhead);
+  }
+  return detail::makePrefetchingReader(path, partSize, partsAhead);
+}
+
+// Opens a file for writing, compressed with the given codec
+inline std::unique_ptr<fbpcf::io::IWriterCloser> makeFileWriter(
+    const std::string& path,
+    Codec codec) {
+  auto fileWriter = std::make_unique<fbpcf::io::FileWriter>(path);
+  if (codec == Codec::kNone) {
+    return fileWriter;
+  }
+  return std::make_unique<CompressingWriter>(std::move(fileWriter), codec);
+}
+
+// Opens a file for writing, compressing it if its path ends in a codec suffix
+inline std::unique_ptr<fbpcf::io::IWriterCloser> makeFileWriter(
+    const std::string& path) {
+  return makeFileWriter(path, getCodecForPath(path));
+}
+
+// Opens a file for reading, decompressing it if it is compressed
+inline std::unique_ptr<fbpcf::io::IReaderCloser> makeFileReader(
+    const std::string& path,
+    std::size_t partSize = kPrefetchPartSize,
+    std::size_t partsAhead = kPrefetchPartsAhead) {
+  return std::make_unique<DecompressingReader>(
+      makeRawFileReader(path, partSize, partsAhead));
+}
+
+// Same as fbpcf::io::FileIOWrappers::writeFile, compressing the file if its
+// path ends in a codec suffix
+inline void writeFile(const std::string& path, const std::string& content) {
+  if (getCodecForPath(path) == Codec::kNone) {
+    fbpcf::io::FileIOWrappers::writeFile(path, content);
+    return;
+  }
+  fbpcf::io::BufferedWriter writer{makeFileWriter(path)};
+  writer.writeString(content);
+  writer.close();
+}
+
+// Same as fbpcf::io::FileIOWrappers::readFile, decompressing the file if it is
+// compressed
+inline std::string readFile(const std::string& path) {
+  auto reader = makeFileReader(path);
+  std::string content;
+  std::vector<char> buf(kFrameSize);
+  while (!reader->eof()) {
+    buf.resize(kFrameSize);
+    buf.resize(reader->read(buf));
+    content.append(buf.data(), buf.size());
+  }
+  reader->close();
+  return content;
+}
+
+// Copies a local file to its final, possibly remote, location with
+// fbpcf::io::FileIOWrappers::transferFileInParts, compressing it on the way if
+// the destination ends in a codec suffix
+inline void transferFile(const std::string& from, const std::string& to) {
+  if (getCodecForPath(to) == Codec::kNone) {
+    fbpcf::io::FileIOWrappers::transferFileInParts(from, to);
+    return;
+  }
+  fbpcf::io::FileReader reader{from};
+  auto writer = makeFileWriter(to);
+  std::vector<char> buf(kFrameSize);
+  while (!reader.eof()) {
+    buf.resize(kFrameSize);
+    buf.resize(reader.read(buf));
+    writer->write(buf);
+  }
+  reader.close();
+  writer->close();
+}
+
+namespace detail {
+// A std::streambuf writing to an fbpcf::io::IWriterCloser in kFrameSize
+// chunks
+class WriterStreamBuf final : public std::streambuf {
+ public:
+  explicit WriterStreamBuf(fbpcf::io::IWriterCloser& writer)
+      : writer_{writer}, buf_(kFrameSize) {
+    setp(buf_.data(), buf_.data() + buf_.size());
+  }
+
+ protected:
+  int_type overflow(int_type ch) override {
+    if (sync() != 0) {
+      return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(ch);
+      pbump(1);
+    }
+    return traits_type::not_eof(ch);
+  }
+
+  int sync() override {
+    auto size = static_cast<size_t>(pptr() - pbase());
+    if (size > 0) {
+      // Shrinking and growing back within the capacity doesn't reallocate
+      buf_.resize(size);
+      auto written = writer_.write(buf_);
+      buf_.resize(kFrameSize);
+      setp(buf_.data(), buf_.data() + buf_.size());
+      if (written != size) {
+        return -1;
+      }
+    }
+    return 0;
+  }
+
+ private:
+  fbpcf::io::IWriterCloser& writer_;
+  std::vector<char> buf_;
+};
+} // namespace detail
+
+// Aborts the multipart uploads to an object in S3 which haven't completed,
+// removing the parts they uploaded
+inline void abortS3MultipartUploads(const std::string& path) {
+  auto ref = fbpcf::aws::uriToObjectReference(path);
+  fbpcf::aws::S3ClientOption option;
+  option.region = ref.region;
+  auto client = fbpcf::aws::createS3Client(option);
+  Aws::S3::Model::ListMultipartUploadsRequest request;
+  request.SetBucket(ref.bucket);
+  request.SetPrefix(ref.key);
+  auto outcome = client->ListMultipartUploads(request);
+  if (!outcome.IsSuccess()) {
+    throw std::runtime_error(
+        "Failed to list the uploads to " + path + ": " +
+        std::string{outcome.GetError().GetMessage()});
+  }
+  for (const auto& upload : outcome.GetResult().GetUploads()) {
+    // The prefix also matches the uploads to longer keys
+    if (upload.GetKey() != ref.key) {
+      continue;
+    }
+    Aws::S3::Model::AbortMultipartUploadRequest abortRequest;
+    abortRequest.SetBucket(ref.bucket);
+    abortRequest.SetKey(ref.key);
+    abortRequest.SetUploadId(upload.GetUploadId());
+    auto abortOutcome = client->AbortMultipartUpload(abortRequest);
+    if (!abortOutcome.IsSuccess()) {
+      throw std::runtime_error(
+          "Failed to abort the upload to " + path + ": " +
+          std::string{abortOutcome.GetError().GetMessage()});
+    }
+  }
+}
+
+/*
+A std::ostream writing a file straight to its final, possibly remote, location
+through makeFileWriter. A file in S3 is uploaded in parts while it is written,
+so only a part at a time is held in memory, and it only appears once commit()
+completes the upload. A local file is written next to its destination and
+renamed over it by commit(). A stream destroyed or discarded without commit(),
+such as when an exception is thrown, publishes nothing.
+*/
+class OutputFileStream final : public std::ostream {
+ public:
+  OutputFileStream(const std::string& path, Codec codec)
+      : std::ostream{nullptr},
+        path_{path},
+        isLocal_{
+            fbpcf::cloudio::getCloudFileType(path) ==
+            fbpcf::cloudio::CloudFileType::UNKNOWN},
+        writePath_{
+            isLocal_ ? path + ".tmp-" +
+                    std::to_string(folly::Random::secureRand64())
+                     : path},
+        writer_{makeFileWriter(writePath_, codec)},
+        buf_{std::make_unique<detail::WriterStreamBuf>(*writer_)} {
+    rdbuf(buf_.get());
+  }
+
+  // Compresses the file if its path ends in a codec suffix
+  explicit OutputFileStream(const std::string& path)
+      : OutputFileStream{path, getCodecForPath(path)} {}
+
+  ~OutputFileStream() override {
+    discard();
+  }
+
+  // Finishes the file and makes it appear at its path. Throws
+  // std::runtime_error if anything written couldn't be written out.
+  void commit() {
+    if (!writer_) {
+      throw std::runtime_error(
+          "Output " + path_ + " was already committed or discarded");
+    }
+    flush();
+    if (fail()) {
+      throw std::runtime_error("Failed to write output " + path_);
+    }
+    writer_->close();
+    writer_.reset();
+    // Nothing can be written once the writer is gone
+    rdbuf(nullptr);
+    if (isLocal_) {
+      std::filesystem::rename(writePath_, path_);
+    }
+  }
+
+  // Drops everything written, leaving whatever was at the path unchanged.
+  // Never throws, so that it can be called while unwinding; a failure to clean
+  // up what was written is only logged.
+  void discard() noexcept {
+    if (!writer_) {
+      return;
+    }
+    rdbuf(nullptr);
+    if (!isLocal_) {
+      // Closing a writer to S3 completes its upload, so the upload, which the
+      // writer started when it was made, is aborted first, and the close then
+      // fails to complete it
+      try {
+        abortS3MultipartUploads(writePath_);
+      } catch (const std::exception& e) {
+        // Closing the writer now would publish the output, so it is abandoned
+        // instead, and the parts it uploaded are left for the lifecycle rule
+        // of the bucket for incomplete multipart uploads
+        XLOG(ERR) << "Failed to abort the upload of " << path_ << ": "
+                  << e.what();
+        writer_.release();
+        return;
+      }
+    }
+    try {
+      writer_->close();
+    } catch (const std::exception& e) {
+      // Only a local writer is expected to close successfully
+      if (isLocal_) {
+        XLOG(ERR) << "Failed to close discarded output " << path_ << ": "
+                  << e.what();
+      }
+    }
+    writer_.reset();
+    if (isLocal_) {
+      std::error_code ignored;
+      std::filesystem::remove(writePath_, ignored);
+    }
+  }
+
+ private:
+  std::string path_;
+  bool isLocal_;
+  std::string writePath_;
+  std::unique_ptr<fbpcf::io::IWriterCloser> writer_;
+  std::unique_ptr<detail::WriterStreamBuf> buf_;
+};
+} // namespace private_measurement::compressed_io
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <folly/Range.h>
+#include <folly/io/Compression.h>
+
+#include "fbpcf/engine/communication/IPartyCommunicationAgent.h"
+#include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
+#include "fbpcf/util/MetricCollector.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
+
+/*
+Compression of the traffic between the parties, for runs where the bandwidth
+between their regions costs more than the CPU to compress it. The agents of a
+CompressingAgentFactory wrap the agents of another factory, so it works with
+every game. Both parties must use the same codec.
+
+Everything sent is cut into frames of at most kMaxFrameSize bytes, each one
+laid out as:
+
+  rawSize        uint32
+  compressedSize uint32, 0 if the frame is sent uncompressed
+  the compressed bytes, or the rawSize bytes of the frame
+
+Frames under kMinCompressedFrameSize are sent uncompressed, as the header
+costs about what compressing them would save. Much of the traffic of a game is
+random, such as the masked values of its gates, so each agent compresses its
+first kSampleBytes and keeps compressing only if that saved at least
+1 - kMaxCompressionRatio of them. Otherwise it sends the next kBypassBytes
+uncompressed before it samples again, since what the game sends changes with
+its stages.
+*/
+namespace common {
+
+class CompressingAgent
+    : public fbpcf::engine::communication::IPartyCommunicationAgent {
+ public:
+  static constexpr std::size_t kMaxFrameSize = 1 << 20;
+  static constexpr std::size_t kMinCompressedFrameSize = 512;
+  static constexpr uint64_t kSampleBytes = 16 << 20;
+  static constexpr uint64_t kBypassBytes = 256 << 20;
+  static constexpr double kMaxCompressionRatio = 0.9;
+
+  CompressingAgent(
+      std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+          agent,
+      private_measurement::compressed_io::Codec codec)
+      : agent_{std::move(agent)},
+        codec_{private_measurement::compressed_io::detail::getFollyCodec(
+            codec)} {}
+
+  void send(const std::vector<unsigned char>& data) override {
+    sendBytes(data.data(), data.size());
+  }
+
+  std::vector<unsigned char> receive(size_t size) override {
+    std::vector<unsigned char> data(size);
+    receiveBytes(data.data(), size);
+    return data;
+  }
+
+  // The bytes sent and received over the underlying agent, after compression
+  std::pair<uint64_t, uint64_t> getTrafficStatistics() const override {
+    return agent_->getTrafficStatistics();
+  }
+
+ protected:
+  void sendImpl(const void* data, int nBytes) override {
+    sendBytes(static_cast<const unsigned char*>(data), nBytes);
+  }
+
+  void recvImpl(void* data, int nBytes) override {
+    receiveBytes(static_cast<unsigned char*>(data), nBytes);
+  }
+
+ private:
+  static constexpr std::size_t kHeaderSize = 2 * sizeof(uint32_t);
+
+  void sendBytes(const unsigned char* data, std::size_t size) {
+    for (std::size_t offset = 0; offset < size; offset += kMaxFrameSize) {
+      sendFrame(data + offset, std::min(kMaxFrameSize, size - offset));
+    }
+  }
+
+  void sendFrame(const unsigned char* data, std::size_t size) {
+    std::string compressed;
+    if (size >= kMinCompressedFrameSize && bypassRemaining_ == 0) {
+      compressed = codec_->compress(
+          folly::StringPiece{reinterpret_cast<const char*>(data), size});
+      sampleRatio(size, std::min(size, compressed.size()));
+    } else {
+      bypassRemaining_ -= std::min<uint64_t>(bypassRemaining_, size);
+    }
+    // Incompressible frames are sent as they are, as are frames which weren't
+    // compressed
+    bool isCompressed = !compressed.empty() && compressed.size() < size;
+
+    std::vector<unsigned char> frame(
+        kHeaderSize + (isCompressed ? compressed.size() : size));
+    writeUint32(frame.data(), size);
+    writeUint32(
+        frame.data() + sizeof(uint32_t), isCompressed ? compressed.size() : 0);
+    if (isCompressed) {
+      std::memcpy(
+          frame.data() + kHeaderSize, compressed.data(), compressed.size());
+    } else {
+      std::memcpy(frame.data() + kHeaderSize, data, size);
+    }
+    agent_->send(frame);
+  }
+
+  void sampleRatio(std::size_t rawSize, std::size_t compressedSize) {
+    sampledRaw_ += rawSize;
+    sampledCompressed_ += compressedSize;
+    if (sampledRaw_ < kSampleBytes) {
+      return;
+    }
+    if (sampledCompressed_ > kMaxCompressionRatio * sampledRaw_) {
+      bypassRemaining_ = kBypassBytes;
+    }
+    sampledRaw_ = 0;
+    sampledCompressed_ = 0;
+  }
+
+  void receiveBytes(unsigned char* data, std::size_t size) {
+    while (size > 0) {
+      if (pendingOffset_ == pending_.size()) {
+        receiveFrame();
+      }
+      auto n = std::min(size, pending_.size() - pendingOffset_);
+      std::memcpy(data, pending_.data() + pendingOffset_, n);
+      pendingOffset_ += n;
+      data += n;
+      size -= n;
+    }
+  }
+
+  void receiveFrame() {
+    auto header = agent_->receive(kHeaderSize);
+    auto rawSize = readUint32(header.data());
+    auto compressedSize = readUint32(header.data() + sizeof(uint32_t));
+    if (rawSize > kMaxFrameSize) {
+      throw std::runtime_error(
+          "Received a compressed frame of " + std::to_string(rawSize) +
+          " bytes, more than the most that is sent");
+    }
+    pendingOffset_ = 0;
+    if (compressedSize == 0) {
+      auto raw = agent_->receive(rawSize);
+      pending_.assign(raw.begin(), raw.end());
+      return;
+    }
+    auto compressed = agent_->receive(compressedSize);
+    pending_ = codec_->uncompress(
+        folly::StringPiece{
+            reinterpret_cast<const char*>(compressed.data()),
+            compressed.size()},
+        rawSize);
+  }
+
+  static void writeUint32(unsigned char* out, uint64_t value) {
+    auto narrowed = static_cast<uint32_t>(value);
+    std::memcpy(out, &narrowed, sizeof(narrowed));
+  }
+
+  static uint32_t readUint32(const unsigned char* in) {
+    uint32_t value;
+    std::memcpy(&value, in, sizeof(value));
+    return value;
+  }
+
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+      agent_;
+  std::unique_ptr<folly::io::Codec> codec_;
+
+  uint64_t sampledRaw_ = 0;
+  uint64_t sampledCompressed_ = 0;
+  uint64_t bypassRemaining_ = 0;
+
+  // What was decompressed and not yet received
+  std::string pending_;
+  std::size_t pendingOffset_ = 0;
+};
+
+class CompressingAgentFactory
+    : public fbpcf::engine::communication::IPartyCommunicationAgentFactory {
+ public:
+  CompressingAgentFactory(
+      std::unique_ptr<
+          fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+          factory,
+      private_measurement::compressed_io::Codec codec,
+      std::shared_ptr<fbpcf::util::MetricCollector> metricCollector)
+      : fbpcf::engine::communication::IPartyCommunicationAgentFactory(
+            "compressed_traffic",
+            metricCollector),
+        factory_{std::move(factory)},
+        codec_{codec} {}
+
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+  create(int id, std::string name) override {
+    return std::make_unique<CompressingAgent>(
+        factory_->create(id, std::move(name)), codec_);
+  }
+
+ private:
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+      factory_;
+  private_measurement::compressed_io::Codec codec_;
+};
+
+// Compresses the traffic of the agents of factory with codec, if it isn't
+// Codec::kNone
+inline std::unique_ptr<
+    fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+compressTraffic(
+    std::unique_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory> factory,
+    private_measurement::compressed_io::Codec codec,
+    std::shared_ptr<fbpcf::util::MetricCollector> metricCollector) {
+  if (codec == private_measurement::compressed_io::Codec::kNone) {
+    return factory;
+  }
+  return std::make_unique<CompressingAgentFactory>(
+      std::move(factory), codec, std::move(metricCollector));
+}
+
+} // namespace common
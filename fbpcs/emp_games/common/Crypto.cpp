@@ -7,9 +7,15 @@
 
 #include "fbpcs/emp_games/common/Crypto.h"
 
+#include <folly/logging/xlog.h>
 #include <openssl/conf.h>
 #include <openssl/err.h>
 #include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
 #include <stdexcept>
 
 namespace private_measurement::crypto {
@@ -118,4 +124,352 @@ std::vector<unsigned char> HybridCipher::decrypt(
   return plaintext;
 }
 
+namespace {
+
+constexpr std::size_t kStreamNonceLength = 12;
+
+void checkStreamKey(const std::vector<unsigned char>& key) {
+  if (key.size() != kStreamKeyLength) {
+    throw std::invalid_argument(
+        fmt::format("Stream keys are {} bytes long", kStreamKeyLength));
+  }
+}
+
+folly::ssl::EvpCipherCtxUniquePtr newCipherContext() {
+  folly::ssl::EvpCipherCtxUniquePtr ctx(EVP_CIPHER_CTX_new());
+  if (ctx == nullptr) {
+    throw OpenSSLException("EVP_CIPHER_CTX_new failed", 0);
+  }
+  return ctx;
+}
+
+void writeBigEndian(unsigned char* out, uint32_t value) {
+  for (std::size_t i = 0; i < sizeof(value); ++i) {
+    out[i] = static_cast<unsigned char>(value >> (8 * (sizeof(value) - 1 - i)));
+  }
+}
+
+uint32_t readBigEndian(const unsigned char* in) {
+  uint32_t value = 0;
+  for (std::size_t i = 0; i < sizeof(value); ++i) {
+    value = (value << 8) | in[i];
+  }
+  return value;
+}
+
+// The nonce prefix of the stream, followed by the index of the chunk in big
+// endian and whether it is the last one
+std::array<unsigned char, kStreamNonceLength> getChunkNonce(
+    const std::vector<unsigned char>& header,
+    uint32_t chunkIndex,
+    bool last) {
+  std::array<unsigned char, kStreamNonceLength> nonce;
+  std::memcpy(
+      nonce.data(),
+      header.data() + kStreamHeaderLength - kStreamNoncePrefixLength,
+      kStreamNoncePrefixLength);
+  writeBigEndian(nonce.data() + kStreamNoncePrefixLength, chunkIndex);
+  nonce.back() = last ? 1 : 0;
+  return nonce;
+}
+
+} // namespace
+
+std::vector<unsigned char> generateStreamKey() {
+  std::vector<unsigned char> key(kStreamKeyLength);
+  checkSuccessOrThrow(RAND_bytes(key.data(), key.size()), "RAND_bytes failed");
+  return key;
+}
+
+StreamEncryptor::StreamEncryptor(
+    const std::vector<unsigned char>& key,
+    std::size_t chunkSize)
+    : ctx_(newCipherContext()), chunkSize_{chunkSize} {
+  checkStreamKey(key);
+  if (chunkSize_ == 0 || chunkSize_ > std::numeric_limits<uint32_t>::max()) {
+    throw std::invalid_argument("Invalid chunk size for an encrypted stream");
+  }
+  checkSuccessOrThrow(
+      EVP_EncryptInit_ex(
+          ctx_.get(), EVP_aes_256_gcm(), nullptr, key.data(), nullptr),
+      "EVP_EncryptInit_ex failed");
+
+  header_.resize(kStreamHeaderLength);
+  std::memcpy(header_.data(), kStreamMagic.data(), kStreamMagic.size());
+  writeBigEndian(
+      header_.data() + kStreamMagic.size(), static_cast<uint32_t>(chunkSize_));
+  checkSuccessOrThrow(
+      RAND_bytes(
+          header_.data() + kStreamHeaderLength - kStreamNoncePrefixLength,
+          kStreamNoncePrefixLength),
+      "RAND_bytes failed");
+  chunk_.reserve(chunkSize_);
+}
+
+void StreamEncryptor::update(
+    const unsigned char* data,
+    std::size_t size,
+    std::vector<unsigned char>& out) {
+  if (finished_) {
+    throw std::logic_error("Encrypted stream already finished");
+  }
+  if (!headerWritten_) {
+    out.insert(out.end(), header_.begin(), header_.end());
+    headerWritten_ = true;
+  }
+  while (size > 0) {
+    // Whole chunks are encrypted straight from the data
+    if (chunk_.empty() && size >= chunkSize_) {
+      sealChunk(data, chunkSize_, false, out);
+      data += chunkSize_;
+      size -= chunkSize_;
+      continue;
+    }
+    auto copied = std::min(size, chunkSize_ - chunk_.size());
+    chunk_.insert(chunk_.end(), data, data + copied);
+    data += copied;
+    size -= copied;
+    if (chunk_.size() == chunkSize_) {
+      sealChunk(chunk_.data(), chunk_.size(), false, out);
+      chunk_.clear();
+    }
+  }
+}
+
+void StreamEncryptor::finish(std::vector<unsigned char>& out) {
+  if (finished_) {
+    return;
+  }
+  if (!headerWritten_) {
+    out.insert(out.end(), header_.begin(), header_.end());
+    headerWritten_ = true;
+  }
+  sealChunk(chunk_.data(), chunk_.size(), true, out);
+  chunk_.clear();
+  finished_ = true;
+}
+
+void StreamEncryptor::sealChunk(
+    const unsigned char* chunk,
+    std::size_t size,
+    bool last,
+    std::vector<unsigned char>& out) {
+  if (chunkIndex_ == std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error("Too many chunks in an encrypted stream");
+  }
+  auto nonce = getChunkNonce(header_, chunkIndex_++, last);
+  int len;
+  checkSuccessOrThrow(
+      EVP_EncryptInit_ex(ctx_.get(), nullptr, nullptr, nullptr, nonce.data()),
+      "EVP_EncryptInit_ex failed");
+  checkSuccessOrThrow(
+      EVP_EncryptUpdate(
+          ctx_.get(), nullptr, &len, header_.data(), header_.size()),
+      "EVP_EncryptUpdate failed on the header");
+
+  auto offset = out.size();
+  out.resize(offset + size + kStreamTagLength);
+  checkSuccessOrThrow(
+      EVP_EncryptUpdate(ctx_.get(), out.data() + offset, &len, chunk, size),
+      "EVP_EncryptUpdate failed");
+  int finalLen;
+  checkSuccessOrThrow(
+      EVP_EncryptFinal_ex(ctx_.get(), out.data() + offset + len, &finalLen),
+      "EVP_EncryptFinal_ex failed");
+  checkSuccessOrThrow(
+      EVP_CIPHER_CTX_ctrl(
+          ctx_.get(),
+          EVP_CTRL_GCM_GET_TAG,
+          kStreamTagLength,
+          out.data() + offset + size),
+      "EVP_CTRL_GCM_GET_TAG failed");
+}
+
+StreamDecryptor::StreamDecryptor(const std::vector<unsigned char>& key)
+    : ctx_(newCipherContext()) {
+  checkStreamKey(key);
+  checkSuccessOrThrow(
+      EVP_DecryptInit_ex(
+          ctx_.get(), EVP_aes_256_gcm(), nullptr, key.data(), nullptr),
+      "EVP_DecryptInit_ex failed");
+}
+
+void StreamDecryptor::update(
+    const unsigned char* data,
+    std::size_t size,
+    std::vector<unsigned char>& out) {
+  if (finished_) {
+    throw std::logic_error("Encrypted stream already finished");
+  }
+  buffer_.insert(buffer_.end(), data, data + size);
+  std::size_t position = 0;
+  if (header_.empty()) {
+    if (buffer_.size() < kStreamHeaderLength) {
+      return;
+    }
+    if (!std::equal(
+            kStreamMagic.begin(), kStreamMagic.end(), buffer_.begin())) {
+      throw OpenSSLException("Not an encrypted stream", 0);
+    }
+    auto chunkSize = readBigEndian(buffer_.data() + kStreamMagic.size());
+    if (chunkSize == 0) {
+      throw OpenSSLException("Invalid chunk size of an encrypted stream", 0);
+    }
+    chunkSize_ = chunkSize;
+    header_.assign(buffer_.begin(), buffer_.begin() + kStreamHeaderLength);
+    position = kStreamHeaderLength;
+  }
+
+  // A whole chunk followed by more data isn't the last chunk
+  auto sealedSize = chunkSize_ + kStreamTagLength;
+  while (buffer_.size() - position > sealedSize) {
+    openChunk(buffer_.data() + position, sealedSize, false, out);
+    position += sealedSize;
+  }
+  buffer_.erase(buffer_.begin(), buffer_.begin() + position);
+}
+
+void StreamDecryptor::finish(std::vector<unsigned char>& out) {
+  if (finished_) {
+    return;
+  }
+  if (header_.empty() || buffer_.size() < kStreamTagLength) {
+    throw OpenSSLException("Encrypted stream is truncated", 0);
+  }
+  openChunk(buffer_.data(), buffer_.size(), true, out);
+  buffer_.clear();
+  finished_ = true;
+}
+
+void StreamDecryptor::openChunk(
+    const unsigned char* chunk,
+    std::size_t size,
+    bool last,
+    std::vector<unsigned char>& out) {
+  if (chunkIndex_ == std::numeric_limits<uint32_t>::max()) {
+    throw OpenSSLException("Too many chunks in an encrypted stream", 0);
+  }
+  auto nonce = getChunkNonce(header_, chunkIndex_++, last);
+  auto ciphertextSize = size - kStreamTagLength;
+  std::array<unsigned char, kStreamTagLength> tag;
+  std::memcpy(tag.data(), chunk + ciphertextSize, tag.size());
+  int len;
+  checkSuccessOrThrow(
+      EVP_DecryptInit_ex(ctx_.get(), nullptr, nullptr, nullptr, nonce.data()),
+      "EVP_DecryptInit_ex failed");
+  checkSuccessOrThrow(
+      EVP_DecryptUpdate(
+          ctx_.get(), nullptr, &len, header_.data(), header_.size()),
+      "EVP_DecryptUpdate failed on the header");
+
+  // The plaintext is only kept once the tag has been checked
+  auto offset = out.size();
+  out.resize(offset + ciphertextSize);
+  checkSuccessOrThrow(
+      EVP_DecryptUpdate(
+          ctx_.get(), out.data() + offset, &len, chunk, ciphertextSize),
+      "EVP_DecryptUpdate failed");
+  checkSuccessOrThrow(
+      EVP_CIPHER_CTX_ctrl(
+          ctx_.get(), EVP_CTRL_GCM_SET_TAG, tag.size(), tag.data()),
+      "EVP_CTRL_GCM_SET_TAG failed");
+  int finalLen;
+  auto ret =
+      EVP_DecryptFinal_ex(ctx_.get(), out.data() + offset + len, &finalLen);
+  if (ret <= 0) {
+    out.resize(offset);
+    throw OpenSSLException(
+        "Encrypted stream has been altered or truncated", ret);
+  }
+}
+
+EncryptingWriter::EncryptingWriter(
+    std::unique_ptr<fbpcf::io::IWriterCloser> baseWriter,
+    const std::vector<unsigned char>& key,
+    std::size_t chunkSize)
+    : baseWriter_{std::move(baseWriter)}, encryptor_{key, chunkSize} {}
+
+EncryptingWriter::~EncryptingWriter() {
+  if (closed_) {
+    return;
+  }
+  // The stream is left without its last chunk, so that a writer destroyed
+  // before all its data was written, e.g. by an exception, doesn't leave a
+  // truncated stream which authenticates as complete
+  try {
+    baseWriter_->close();
+  } catch (const std::exception& e) {
+    XLOG(ERR) << "Failed to close an unfinished encrypted stream: " << e.what();
+  }
+}
+
+size_t EncryptingWriter::write(std::vector<char>& buf) {
+  encryptor_.update(
+      reinterpret_cast<const unsigned char*>(buf.data()), buf.size(), out_);
+  writeToBase();
+  return buf.size();
+}
+
+int EncryptingWriter::close() {
+  if (closed_) {
+    return 0;
+  }
+  closed_ = true;
+  encryptor_.finish(out_);
+  writeToBase();
+  return baseWriter_->close();
+}
+
+void EncryptingWriter::writeToBase() {
+  if (out_.empty()) {
+    return;
+  }
+  std::vector<char> buf(out_.begin(), out_.end());
+  baseWriter_->write(buf);
+  out_.clear();
+}
+
+DecryptingReader::DecryptingReader(
+    std::unique_ptr<fbpcf::io::IReaderCloser> baseReader,
+    const std::vector<unsigned char>& key)
+    : baseReader_{std::move(baseReader)}, decryptor_{key} {}
+
+size_t DecryptingReader::read(std::vector<char>& buf) {
+  size_t size = 0;
+  while (size < buf.size() && nextData()) {
+    auto copied = std::min(buf.size() - size, plaintext_.size() - position_);
+    std::memcpy(buf.data() + size, plaintext_.data() + position_, copied);
+    position_ += copied;
+    size += copied;
+  }
+  return size;
+}
+
+bool DecryptingReader::eof() {
+  return !nextData();
+}
+
+int DecryptingReader::close() {
+  return baseReader_->close();
+}
+
+bool DecryptingReader::nextData() {
+  while (position_ == plaintext_.size() && !ended_) {
+    plaintext_.clear();
+    position_ = 0;
+    if (baseReader_->eof()) {
+      decryptor_.finish(plaintext_);
+      ended_ = true;
+      break;
+    }
+    raw_.resize(kStreamChunkSize);
+    raw_.resize(baseReader_->read(raw_));
+    decryptor_.update(
+        reinterpret_cast<const unsigned char*>(raw_.data()),
+        raw_.size(),
+        plaintext_);
+  }
+  return position_ < plaintext_.size();
+}
+
 } // namespace private_measurement::crypto
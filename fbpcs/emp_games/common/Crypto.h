@@ -12,11 +12,17 @@
 #include <openssl/conf.h>
 #include <openssl/err.h>
 #include <openssl/evp.h>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "fbpcf/io/api/IReaderCloser.h"
+#include "fbpcf/io/api/IWriterCloser.h"
+
 namespace private_measurement::crypto {
 
 class OpenSSLException : public std::runtime_error {
@@ -76,4 +82,155 @@ class HybridCipher {
       folly::ssl::EvpPkeySharedPtr privKey);
 };
 
+/*
+Authenticated encryption of streams too large to hold in memory, such as the
+intermediate files of the games, with AES-256-GCM over chunks of the stream.
+Each chunk carries its own tag, so that a chunk is decrypted and checked as
+soon as it is read, with no pass over the whole stream, and a reader never
+sees data which hasn't been authenticated. OpenSSL runs GCM on AES-NI and
+PCLMULQDQ, or on VAES where the CPU has it, so this runs at close to the speed
+of copying the data.
+
+The chunks are sealed as in the STREAM construction: the nonce of a chunk is
+a random prefix of the stream, the index of the chunk and whether it is the
+last one, so that chunks can't be reordered, dropped or truncated, or moved
+from a stream to another, without failing the tag. A stream is laid out as:
+
+  header          kStreamMagic, chunk size as big endian uint32, nonce prefix
+  chunks, each one:
+    ciphertext    chunk size bytes, fewer for the last chunk only
+    tag           kStreamTagLength bytes
+
+where the last chunk is always shorter than the chunk size, and may be empty.
+The header is authenticated with every chunk. Failures throw OpenSSLException.
+*/
+constexpr std::string_view kStreamMagic{"PCSGCM01", 8};
+constexpr std::size_t kStreamKeyLength = 32;
+constexpr std::size_t kStreamNoncePrefixLength = 7;
+constexpr std::size_t kStreamTagLength = 16;
+constexpr std::size_t kStreamHeaderLength =
+    kStreamMagic.size() + sizeof(uint32_t) + kStreamNoncePrefixLength;
+// Bytes of plaintext in one chunk
+constexpr std::size_t kStreamChunkSize = 1 << 20;
+
+// A random key for StreamEncryptor
+std::vector<unsigned char> generateStreamKey();
+
+// Encrypts a stream fed to it in pieces of any size
+class StreamEncryptor {
+ public:
+  explicit StreamEncryptor(
+      const std::vector<unsigned char>& key,
+      std::size_t chunkSize = kStreamChunkSize);
+
+  // Appends the ciphertext of the chunks the data completes to out, starting
+  // with the header of the stream
+  void update(
+      const unsigned char* data,
+      std::size_t size,
+      std::vector<unsigned char>& out);
+
+  // Appends the last chunk to out, ending the stream
+  void finish(std::vector<unsigned char>& out);
+
+ private:
+  void sealChunk(
+      const unsigned char* chunk,
+      std::size_t size,
+      bool last,
+      std::vector<unsigned char>& out);
+
+  folly::ssl::EvpCipherCtxUniquePtr ctx_;
+  std::size_t chunkSize_;
+  std::vector<unsigned char> header_;
+  std::vector<unsigned char> chunk_;
+  uint32_t chunkIndex_ = 0;
+  bool headerWritten_ = false;
+  bool finished_ = false;
+};
+
+// Decrypts a stream of StreamEncryptor fed to it in pieces of any size. Only
+// the plaintext of chunks whose tags have been checked is returned.
+class StreamDecryptor {
+ public:
+  explicit StreamDecryptor(const std::vector<unsigned char>& key);
+
+  // Appends the plaintext of the chunks the data completes to out. The last
+  // chunk is only known to be the last one at the end of the stream, so the
+  // data of a chunk is held back until what follows it is fed.
+  void update(
+      const unsigned char* data,
+      std::size_t size,
+      std::vector<unsigned char>& out);
+
+  // Appends the plaintext of the last chunk to out, throwing if the stream is
+  // truncated
+  void finish(std::vector<unsigned char>& out);
+
+ private:
+  void openChunk(
+      const unsigned char* chunk,
+      std::size_t size,
+      bool last,
+      std::vector<unsigned char>& out);
+
+  folly::ssl::EvpCipherCtxUniquePtr ctx_;
+  std::size_t chunkSize_ = 0;
+  std::vector<unsigned char> header_;
+  std::vector<unsigned char> buffer_;
+  uint32_t chunkIndex_ = 0;
+  bool finished_ = false;
+};
+
+// An fbpcf::io::IWriterCloser which encrypts everything written to it into
+// another writer. The stream only ends, with its last chunk, on close(): a
+// writer destroyed without it leaves a stream which fails to decrypt.
+class EncryptingWriter final : public fbpcf::io::IWriterCloser {
+ public:
+  EncryptingWriter(
+      std::unique_ptr<fbpcf::io::IWriterCloser> baseWriter,
+      const std::vector<unsigned char>& key,
+      std::size_t chunkSize = kStreamChunkSize);
+
+  ~EncryptingWriter() override;
+
+  size_t write(std::vector<char>& buf) override;
+
+  int close() override;
+
+ private:
+  void writeToBase();
+
+  std::unique_ptr<fbpcf::io::IWriterCloser> baseWriter_;
+  StreamEncryptor encryptor_;
+  std::vector<unsigned char> out_;
+  bool closed_ = false;
+};
+
+// An fbpcf::io::IReaderCloser which decrypts another reader, throwing
+// OpenSSLException if what it reads has been altered or truncated
+class DecryptingReader final : public fbpcf::io::IReaderCloser {
+ public:
+  DecryptingReader(
+      std::unique_ptr<fbpcf::io::IReaderCloser> baseReader,
+      const std::vector<unsigned char>& key);
+
+  size_t read(std::vector<char>& buf) override;
+
+  bool eof() override;
+
+  int close() override;
+
+ private:
+  // Makes sure plaintext_ has unread data, returning false at the end
+  bool nextData();
+
+  std::unique_ptr<fbpcf::io::IReaderCloser> baseReader_;
+  StreamDecryptor decryptor_;
+  std::vector<char> raw_;
+  std::vector<unsigned char> plaintext_;
+  std::size_t position_ = 0;
+  bool ended_ = false;
+};
+
 } // namespace private_measurement::crypto
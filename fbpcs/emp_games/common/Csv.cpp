@@ -5,8 +5,18 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <fcntl.h>
 #include <folly/String.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <exception>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -14,7 +24,9 @@
 #include "fbpcf/io/api/BufferedWriter.h"
 #include "fbpcf/io/api/FileReader.h"
 #include "fbpcf/io/api/FileWriter.h"
+#include "fbpcf/io/api/IReaderCloser.h"
 
+#include "CompressedIO.h"
 #include "Constants.h"
 #include "Csv.h"
 
@@ -36,23 +48,443 @@ const std::vector<std::string> split(
   return tokens;
 }
 
+namespace {
+
+void assignParts(
+    const std::vector<std::string_view>& views,
+    std::vector<std::string>& parts) {
+  parts.resize(views.size());
+  for (size_t i = 0; i < views.size(); ++i) {
+    parts[i].assign(views[i].data(), views[i].size());
+  }
+}
+
+// Read-only private mapping of a local file. Remote paths (e.g. s3 urls) and
+// files that can't be mapped are left unmapped so callers can fall back to
+// fbpcf::io.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& fileName) {
+    if (fileName.find("://") != std::string::npos) {
+      return;
+    }
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+      void* addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {
+        ::madvise(addr, st.st_size, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(addr);
+        size_ = st.st_size;
+      }
+    }
+    ::close(fd);
+  }
+
+  ~MappedFile() {
+    if (data_ != nullptr) {
+      ::munmap(const_cast<char*>(data_), size_);
+    }
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool isMapped() const {
+    return data_ != nullptr;
+  }
+
+  std::string_view contents() const {
+    return std::string_view(data_, size_);
+  }
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Calls onLine for every newline separated line of contents. A trailing
+// newline doesn't produce an extra empty line.
+void forEachLineIn(
+    std::string_view contents,
+    const std::function<void(std::string_view)>& onLine) {
+  size_t pos = 0;
+  while (pos < contents.size()) {
+    auto newLine = contents.find('\n', pos);
+    if (newLine == std::string_view::npos) {
+      newLine = contents.size();
+    }
+    onLine(contents.substr(pos, newLine - pos));
+    pos = newLine + 1;
+  }
+}
+
+// Which columns of header are named in columns, up to the last of them, or
+// nullopt if columns is empty and every column is read
+std::optional<std::vector<bool>> selectColumns(
+    const std::vector<std::string>& header,
+    const std::vector<std::string>& columns) {
+  if (columns.empty()) {
+    return std::nullopt;
+  }
+  std::vector<bool> selected;
+  for (size_t i = 0; i < header.size(); ++i) {
+    if (std::find(columns.begin(), columns.end(), header[i]) !=
+        columns.end()) {
+      selected.resize(i + 1, false);
+      selected[i] = true;
+    }
+  }
+  return selected;
+}
+
+// Splits a data row into parts, only tokenizing the selected columns if there
+// is a selection
+void splitRow(
+    std::string& line,
+    const std::optional<std::vector<bool>>& selected,
+    std::vector<std::string_view>& parts) {
+  // Split on commas, but if it looks like we're reading an array
+  // like `[1, 2, 3]`, take the whole array
+  if (selected.has_value()) {
+    splitSelectedByCommaInPlace(line, true, *selected, parts);
+  } else {
+    splitByCommaInPlace(line, true, parts);
+  }
+}
+
+// Parses every line of contents as a data row, the same way readCsvViews does.
+void readRows(
+    std::string_view contents,
+    const std::vector<std::string>& header,
+    const std::optional<std::vector<bool>>& selected,
+    const std::function<void(
+        const std::vector<std::string>&,
+        const std::vector<std::string_view>&)>& readLine) {
+  std::string line;
+  std::vector<std::string_view> parts;
+  forEachLineIn(contents, [&](std::string_view lineView) {
+    line.assign(lineView);
+    splitRow(line, selected, parts);
+    readLine(header, parts);
+  });
+}
+
+// Whether a local file is mapped and can be walked in place
+bool isMappedUncompressed(const MappedFile& mappedFile) {
+  return mappedFile.isMapped() &&
+      !compressed_io::hasMagic(mappedFile.contents());
+}
+
+// Calls onLine for every line of the file, starting with the header. Local
+// files are mapped and walked in place, everything else, including compressed
+// files, is read through fbpcf::io::BufferedReader. Either way a trailing
+// newline doesn't produce an extra empty line. The file is read from reader
+// if it was already opened.
+void forEachLine(
+    const std::string& fileName,
+    const std::function<void(std::string_view)>& onLine,
+    std::unique_ptr<fbpcf::io::IReaderCloser> reader = nullptr) {
+  if (reader == nullptr) {
+    MappedFile mappedFile(fileName);
+    if (isMappedUncompressed(mappedFile)) {
+      forEachLineIn(mappedFile.contents(), onLine);
+      return;
+    }
+    reader = compressed_io::makeFileReader(fileName);
+  }
+
+  auto inlineReader = std::move(reader);
+  auto inlineBufferedReader =
+      std::make_unique<fbpcf::io::BufferedReader>(std::move(inlineReader));
+  onLine(inlineBufferedReader->readLine());
+  while (!inlineBufferedReader->eof()) {
+    onLine(inlineBufferedReader->readLine());
+  }
+  inlineBufferedReader->close();
+}
+
+// Calls readGroup for every row group of a local file which is mapped, or of a
+// remote or compressed one, returning false without reading it if it isn't in
+// the row group format. A remote or compressed file is opened to find out, and
+// if it isn't in the format and unread is given, it is handed the opened file,
+// reading from its start, so that it can be read as a csv without opening it
+// again.
+bool forEachRowGroup(
+    const std::string& fileName,
+    const MappedFile& mappedFile,
+    const std::function<
+        void(const row_group::Schema&, const row_group::RowGroup&)>& readGroup,
+    std::unique_ptr<fbpcf::io::IReaderCloser>* unread = nullptr) {
+  row_group::RowGroupReader::Source source;
+  std::unique_ptr<fbpcf::io::IReaderCloser> fileReader;
+  std::vector<char> buffer;
+  size_t offset = 0;
+  if (isMappedUncompressed(mappedFile)) {
+    auto contents = mappedFile.contents();
+    if (!row_group::hasMagic(contents)) {
+      return false;
+    }
+    source = [contents, &offset](char* data, size_t size) {
+      size = std::min(size, contents.size() - offset);
+      std::memcpy(data, contents.data() + offset, size);
+      offset += size;
+      return size;
+    };
+  } else {
+    if (!mappedFile.isMapped() && fileName.find("://") == std::string::npos) {
+      // An empty local file, or one which can't be mapped
+      return false;
+    }
+    fileReader = compressed_io::makeFileReader(fileName);
+    // Reads the file through a buffer, the first fill of which also
+    // holds the magic
+    auto fill = [&]() {
+      buffer.resize(1 << 20);
+      buffer.resize(fileReader->read(buffer));
+      offset = 0;
+    };
+    fill();
+    if (!row_group::hasMagic(std::string_view(buffer.data(), buffer.size()))) {
+      if (unread != nullptr) {
+        *unread = std::make_unique<compressed_io::PushbackReader>(
+            std::move(buffer), std::move(fileReader));
+      } else {
+        fileReader->close();
+      }
+      return false;
+    }
+    source = [&](char* data, size_t size) {
+      if (offset == buffer.size()) {
+        fill();
+      }
+      size = std::min(size, buffer.size() - offset);
+      std::memcpy(data, buffer.data() + offset, size);
+      offset += size;
+      return size;
+    };
+  }
+
+  row_group::RowGroupReader reader(std::move(source));
+  row_group::RowGroup group;
+  while (reader.next(group)) {
+    readGroup(reader.getSchema(), group);
+  }
+  if (fileReader != nullptr) {
+    fileReader->close();
+  }
+  return true;
+}
+
+// Reads a file in the row group format the way readCsvViews reads a csv,
+// formatting every row back to its csv text. See forEachRowGroup for unread.
+bool readRowGroupsAsViews(
+    const std::string& fileName,
+    const MappedFile& mappedFile,
+    const std::function<void(
+        const std::vector<std::string>&,
+        const std::vector<std::string_view>&)>& readLine,
+    const std::function<void(const std::vector<std::string>&)>& processHeader,
+    const std::vector<std::string>& columns,
+    std::unique_ptr<fbpcf::io::IReaderCloser>* unread) {
+  std::vector<std::string> header;
+  std::optional<std::vector<bool>> selected;
+  std::string line;
+  std::vector<size_t> cellEnds;
+  std::vector<std::string_view> parts;
+  return forEachRowGroup(
+      fileName,
+      mappedFile,
+      [&](const row_group::Schema& schema, const row_group::RowGroup& group) {
+        if (header.empty()) {
+          for (auto& column : schema) {
+            header.push_back(column.name);
+          }
+          processHeader(header);
+          selected = selectColumns(header, columns);
+        }
+        auto numColumns =
+            selected.has_value() ? selected->size() : schema.size();
+        for (size_t row = 0; row < group.numRows; ++row) {
+          line.clear();
+          cellEnds.clear();
+          for (size_t column = 0; column < numColumns; ++column) {
+            if (!selected.has_value() || selected->at(column)) {
+              row_group::appendCsvCell(schema, group, column, row, line);
+            }
+            cellEnds.push_back(line.size());
+          }
+          parts.clear();
+          size_t start = 0;
+          for (auto end : cellEnds) {
+            parts.emplace_back(line.data() + start, end - start);
+            start = end;
+          }
+          readLine(header, parts);
+        }
+      },
+      unread);
+}
+
+} // namespace
+
+void splitByCommaInPlace(
+    std::string& line,
+    bool supportInnerBrackets,
+    std::vector<std::string_view>& out) {
+  out.clear();
+  line.erase(std::remove(line.begin(), line.end(), ' '), line.end());
+  std::string_view input{line};
+
+  size_t pos = 0;
+  while (pos < input.size()) {
+    size_t end = std::string_view::npos;
+    if (supportInnerBrackets && input[pos] == '[') {
+      // Take the whole `[...]` array if it is closed and non-empty,
+      // otherwise fall back to reading up to the next comma.
+      auto close = input.find(']', pos + 1);
+      if (close != std::string_view::npos && close > pos + 1) {
+        end = close + 1;
+      }
+    }
+    if (end == std::string_view::npos) {
+      end = std::min(input.find(',', pos), input.size());
+    }
+    if (end == pos) {
+      break;
+    }
+    out.push_back(input.substr(pos, end - pos));
+    pos = end;
+    if (pos < input.size() && input[pos] == ',') {
+      ++pos;
+    }
+  }
+}
+
+void splitSelectedByCommaInPlace(
+    std::string& line,
+    bool supportInnerBrackets,
+    const std::vector<bool>& selected,
+    std::vector<std::string_view>& out) {
+  out.clear();
+  // Walks the line with its spaces, splitting it where splitByCommaInPlace
+  // would split it once they are removed
+  size_t pos = 0;
+  for (size_t column = 0; column < selected.size(); ++column) {
+    auto begin = line.find_first_not_of(' ', pos);
+    if (begin == std::string::npos || line[begin] == ',') {
+      // An empty field ends tokenization
+      break;
+    }
+    size_t end = std::string::npos;
+    if (supportInnerBrackets && line[begin] == '[') {
+      auto close = line.find(']', begin + 1);
+      if (close != std::string::npos &&
+          line.find_first_not_of(' ', begin + 1) < close) {
+        end = close + 1;
+      }
+    }
+    if (end == std::string::npos) {
+      end = std::min(line.find(',', begin), line.size());
+    }
+
+    if (selected[column]) {
+      // Remove the spaces of the field within its own bytes, so the fields
+      // after it are left where they are
+      auto write = begin;
+      for (auto read = begin; read < end; ++read) {
+        if (line[read] != ' ') {
+          line[write++] = line[read];
+        }
+      }
+      out.emplace_back(line.data() + begin, write - begin);
+    } else {
+      out.emplace_back();
+    }
+
+    pos = std::min(line.find_first_not_of(' ', end), line.size());
+    if (pos < line.size() && line[pos] == ',') {
+      ++pos;
+    }
+  }
+}
+
+void splitInnerArray(std::string_view str, std::vector<std::string_view>& out) {
+  out.clear();
+  auto isSkipped = [](char c) { return c == ' ' || c == '[' || c == ']'; };
+
+  size_t pos = 0;
+  while (pos < str.size()) {
+    auto end = std::min(str.find(',', pos), str.size());
+    auto begin = pos;
+    while (begin < end && isSkipped(str[begin])) {
+      ++begin;
+    }
+    auto last = end;
+    while (last > begin && isSkipped(str[last - 1])) {
+      --last;
+    }
+    if (begin == last) {
+      break;
+    }
+    out.push_back(str.substr(begin, last - begin));
+    pos = end + 1;
+  }
+}
+
 const std::vector<std::string> splitByComma(
     std::string& str,
     bool supportInnerBrackets) {
-  if (supportInnerBrackets) {
-    // The pattern here indicates that it's looking for a \[, gets all
-    // non-brackets [^\]], then the \]. Otherwise |,
-    // it will get all the non commas [^,]. The surrounding () makes it
-    // a capture group. ,? means there may or may not be a comma
-    return split(str, R"((\[[^\]]+\]|[^,]+),?)");
-  } else {
-    // split internally uses RE2 which relies on
-    // consuming patterns. The pattern here indicates
-    // it will get all the non commas [^,]. The surrounding () makes it
-    // a capture group. ,? means there may or may not be a comma
+  std::vector<std::string_view> views;
+  splitByCommaInPlace(str, supportInnerBrackets, views);
+  std::vector<std::string> tokens;
+  assignParts(views, tokens);
+  return tokens;
+}
 
-    return split(str, "([^,]+),?");
+bool readCsvViews(
+    const std::string& fileName,
+    std::function<void(
+        const std::vector<std::string>&,
+        const std::vector<std::string_view>&)> readLine,
+    std::function<void(const std::vector<std::string>&)> processHeader,
+    const std::vector<std::string>& columns) {
+  std::unique_ptr<fbpcf::io::IReaderCloser> unread;
+  {
+    MappedFile mappedFile(fileName);
+    if (readRowGroupsAsViews(
+            fileName, mappedFile, readLine, processHeader, columns, &unread)) {
+      return true;
+    }
   }
+
+  std::vector<std::string> header;
+  std::optional<std::vector<bool>> selected;
+  bool headerRead = false;
+
+  // The line buffer and token views are reused for every row so that reading
+  // a row doesn't allocate once they have grown.
+  std::string line;
+  std::vector<std::string_view> parts;
+  forEachLine(
+      fileName,
+      [&](std::string_view lineView) {
+        line.assign(lineView);
+        if (!headerRead) {
+          header = splitByComma(line, false);
+          processHeader(header);
+          selected = selectColumns(header, columns);
+          headerRead = true;
+          return;
+        }
+        splitRow(line, selected, parts);
+        readLine(header, parts);
+      },
+      std::move(unread));
+  return true;
 }
 
 bool readCsv(
@@ -60,31 +492,137 @@ bool readCsv(
     std::function<
         void(const std::vector<std::string>&, const std::vector<std::string>&)>
         readLine,
-    std::function<void(const std::vector<std::string>&)> processHeader) {
-  auto inlineReader = std::make_unique<fbpcf::io::FileReader>(fileName);
-  auto inlineBufferedReader =
-      std::make_unique<fbpcf::io::BufferedReader>(std::move(inlineReader));
+    std::function<void(const std::vector<std::string>&)> processHeader,
+    const std::vector<std::string>& columns) {
+  std::vector<std::string> parts;
+  return readCsvViews(
+      fileName,
+      [&readLine, &parts](
+          const std::vector<std::string>& header,
+          const std::vector<std::string_view>& views) {
+        assignParts(views, parts);
+        readLine(header, parts);
+      },
+      processHeader,
+      columns);
+}
+
+bool readCsvViewsInChunks(
+    const std::string& fileName,
+    size_t numChunks,
+    std::function<void(
+        size_t,
+        const std::vector<std::string>&,
+        const std::vector<std::string_view>&)> readLine,
+    std::function<void(const std::vector<std::string>&)> processHeader,
+    const std::vector<std::string>& columns) {
+  MappedFile mappedFile(fileName);
+  // Files in the row group format are already typed, and compressed files
+  // can't be cut without decompressing them, so both are read as a single
+  // chunk
+  if (numChunks <= 1 || !isMappedUncompressed(mappedFile) ||
+      row_group::hasMagic(mappedFile.contents())) {
+    return readCsvViews(
+        fileName,
+        [&readLine](
+            const std::vector<std::string>& header,
+            const std::vector<std::string_view>& parts) {
+          readLine(0, header, parts);
+        },
+        processHeader,
+        columns);
+  }
 
-  std::string line = inlineBufferedReader->readLine();
-  auto header = splitByComma(line, false);
+  auto contents = mappedFile.contents();
+  auto headerEnd = std::min(contents.find('\n'), contents.size());
+  std::string headerLine{contents.substr(0, headerEnd)};
+  auto header = splitByComma(headerLine, false);
   processHeader(header);
+  auto selected = selectColumns(header, columns);
+  auto rows = contents.substr(std::min(headerEnd + 1, contents.size()));
 
-  while (!inlineBufferedReader->eof()) {
-    // Split on commas, but if it looks like we're reading an array
-    // like `[1, 2, 3]`, take the whole array
-    line = inlineBufferedReader->readLine();
-    auto parts = splitByComma(line, true);
-    readLine(header, parts);
+  // Cut the rows into roughly equal byte ranges, moving each cut forward to
+  // the start of the next line so that no row is split between chunks.
+  std::vector<std::string_view> chunks;
+  size_t chunkStart = 0;
+  for (size_t i = 1; i <= numChunks && chunkStart < rows.size(); ++i) {
+    auto chunkEnd = rows.size();
+    if (i < numChunks) {
+      auto target = std::max(chunkStart, i * rows.size() / numChunks);
+      auto newLine = rows.find('\n', target);
+      chunkEnd = newLine == std::string_view::npos ? rows.size() : newLine + 1;
+    }
+    chunks.push_back(rows.substr(chunkStart, chunkEnd - chunkStart));
+    chunkStart = chunkEnd;
+  }
+
+  std::vector<std::exception_ptr> errors(chunks.size());
+  {
+    folly::CPUThreadPoolExecutor executor(chunks.size());
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      executor.add([&, i]() {
+        try {
+          readRows(
+              chunks[i],
+              header,
+              selected,
+              [&readLine, i](
+                  const std::vector<std::string>& rowHeader,
+                  const std::vector<std::string_view>& parts) {
+                readLine(i, rowHeader, parts);
+              });
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+      });
+    }
+    executor.join();
+  }
+  for (auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
   }
-  inlineBufferedReader->close();
   return true;
 }
 
+bool readRowGroups(
+    const std::string& fileName,
+    std::function<
+        void(const row_group::Schema&, const row_group::RowGroup&)> readGroup) {
+  MappedFile mappedFile(fileName);
+  return forEachRowGroup(fileName, mappedFile, readGroup);
+}
+
+size_t countCsvRows(const std::string& fileName) {
+  size_t numRows = 0;
+  auto countGroupRows = [&numRows](
+                            const row_group::Schema&,
+                            const row_group::RowGroup& group) {
+    numRows += group.numRows;
+  };
+  std::unique_ptr<fbpcf::io::IReaderCloser> unread;
+  {
+    MappedFile mappedFile(fileName);
+    if (forEachRowGroup(fileName, mappedFile, countGroupRows, &unread)) {
+      return numRows;
+    }
+  }
+
+  size_t numLines = 0;
+  forEachLine(
+      fileName,
+      [&numLines](std::string_view) { ++numLines; },
+      std::move(unread));
+  // skip the header
+  return numLines > 0 ? numLines - 1 : 0;
+}
+
 bool writeCsv(
     const std::string& fileName,
     const std::vector<std::string>& header,
     const std::vector<std::vector<std::string>>& data) {
-  auto inlineWriter = std::make_unique<fbpcf::io::FileWriter>(fileName);
+  auto inlineWriter = compressed_io::makeFileWriter(fileName);
   auto inlineBufferedWriter =
       std::make_unique<fbpcf::io::BufferedWriter>(std::move(inlineWriter));
 
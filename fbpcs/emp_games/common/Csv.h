@@ -8,10 +8,13 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <re2/re2.h>
 
+#include "fbpcs/emp_games/common/RowGroupFormat.h"
+
 namespace private_measurement::csv {
 
 // Split an input string into component pieces given a delimiter
@@ -24,16 +27,99 @@ const std::vector<std::string> splitByComma(
     std::string& str,
     bool supportInnerBrackets);
 
+// Tokenizes a comma separated line without regexes or per-field copies,
+// matching the results of splitByComma. Spaces are removed from `line` in place
+// and `out` is filled with views into it, so the views are only valid until
+// `line` is next modified. `out` is cleared first so callers can reuse it
+// across lines. As with splitByComma, an empty field ends tokenization.
+void splitByCommaInPlace(
+    std::string& line,
+    bool supportInnerBrackets,
+    std::vector<std::string_view>& out);
+
+// Same as splitByCommaInPlace, but only tokenizes the columns whose entry of
+// selected is true. The other columns are passed as empty views and the line
+// isn't read past the last selected column, so `out` has at most
+// selected.size() views. Spaces are only removed from the selected columns.
+void splitSelectedByCommaInPlace(
+    std::string& line,
+    bool supportInnerBrackets,
+    const std::vector<bool>& selected,
+    std::vector<std::string_view>& out);
+
+// Splits the elements of an array cell such as `[1, 2, 3]` into views of
+// `str`, dropping brackets and surrounding spaces. An empty element ends
+// tokenization, the same as splitByComma.
+void splitInnerArray(std::string_view str, std::vector<std::string_view>& out);
+
 // Reads a csv from the given file, calling the given function for each line
 // Returns true on success, false on failure
+// Like every reader below, it decompresses files written compressed through
+// CompressedIO.h
+//
+// If columns is not empty, only the columns of the header named in it are
+// parsed. The parts of the other columns are empty and parts ends at the last
+// of the named columns, so wide rows with many unused columns are cut short
+// instead of being tokenized and copied in full.
 bool readCsv(
     const std::string& fileName,
     std::function<void(
         const std::vector<std::string>& header,
         const std::vector<std::string>& parts)> readLine,
     std::function<void(const std::vector<std::string>&)> processHeader =
-        [](auto) {});
+        [](auto) {},
+    const std::vector<std::string>& columns = {});
+
+// Same as readCsv, but passes each row as views into a reused line buffer
+// instead of copying every field into a std::string. The views are only valid
+// for the duration of the readLine call. Local files are memory mapped and
+// scanned in place rather than read line by line through fbpcf::io.
+bool readCsvViews(
+    const std::string& fileName,
+    std::function<void(
+        const std::vector<std::string>& header,
+        const std::vector<std::string_view>& parts)> readLine,
+    std::function<void(const std::vector<std::string>&)> processHeader =
+        [](auto) {},
+    const std::vector<std::string>& columns = {});
+
+// Same as readCsvViews, but splits the rows of a local file into up to
+// numChunks contiguous ranges at line boundaries and parses them concurrently
+// on a folly::CPUThreadPoolExecutor. readLine is told which chunk each row
+// belongs to and is called concurrently for different chunks. Rows of a chunk
+// arrive in file order and every row of chunk i comes before the rows of
+// chunk i + 1, so callers can keep one accumulator per chunk and concatenate
+// them in chunk order. Files that can't be memory mapped are read
+// sequentially as chunk 0.
+bool readCsvViewsInChunks(
+    const std::string& fileName,
+    size_t numChunks,
+    std::function<void(
+        size_t chunk,
+        const std::vector<std::string>& header,
+        const std::vector<std::string_view>& parts)> readLine,
+    std::function<void(const std::vector<std::string>&)> processHeader =
+        [](auto) {},
+    const std::vector<std::string>& columns = {});
+
+// Calls readGroup for every row group of the file and returns true if it is in
+// the binary row group format (see RowGroupFormat.h). Returns false without
+// calling readGroup otherwise, so callers can fall back to reading it as a csv.
+// readCsv, readCsvViews, readCsvViewsInChunks and countCsvRows accept files in
+// this format as well, formatting every cell back to its csv text, but callers
+// which can take typed values should read it here instead.
+bool readRowGroups(
+    const std::string& fileName,
+    std::function<void(
+        const row_group::Schema& schema,
+        const row_group::RowGroup& group)> readGroup);
+
+// Counts the data rows (excluding the header) of a csv, so that callers can
+// size their column storage before parsing.
+size_t countCsvRows(const std::string& fileName);
 
+// Writes a csv to the given file, compressed if the file name ends in a codec
+// suffix of CompressedIO.h
 bool writeCsv(
     const std::string& fileName,
     const std::vector<std::string>& header,
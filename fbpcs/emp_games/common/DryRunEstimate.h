@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <folly/Format.h>
+#include <folly/Random.h>
+#include <folly/dynamic.h>
+
+#include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
+#include "fbpcf/engine/communication/InMemoryPartyCommunicationAgentFactory.h"
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/SchedulerStatistics.h"
+
+namespace common {
+
+// Rows of the two dry runs the costs of a run are extrapolated from. They are
+// small enough to run in seconds, but far enough apart that the cost per row
+// dominates the difference of their costs.
+constexpr int64_t kDryRunSmallRows = 64;
+constexpr int64_t kDryRunLargeRows = 512;
+
+constexpr int64_t kDryRunBaseTimestamp = 1'600'000'000;
+// Two days, so that some conversions are past the window of the 1d rules
+constexpr int64_t kDryRunTimeRange = 2 * 86'400;
+
+// `[1,2,3]`
+inline std::string toDryRunArrayCell(const std::vector<int64_t>& values) {
+  std::string cell = "[";
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    if (i > 0) {
+      cell += ',';
+    }
+    cell += std::to_string(values.at(i));
+  }
+  return cell + "]";
+}
+
+/*
+ * Writes the attribution inputs of numRows rows for both parties, in as many
+ * files of about the same number of rows each as there are paths. Every row
+ * has numTouchpoints touchpoints of ad ids up to numAdIds and numConversions
+ * conversions, at random times within kDryRunTimeRange, so the game is padded
+ * the same on every row.
+ */
+inline void writeAttributionDryRunInputs(
+    const std::vector<std::string>& publisherPaths,
+    const std::vector<std::string>& partnerPaths,
+    std::size_t numRows,
+    std::size_t numTouchpoints,
+    std::size_t numConversions,
+    int64_t numAdIds = 100,
+    uint32_t seed = 42) {
+  std::mt19937_64 r{seed};
+  std::uniform_int_distribution<int64_t> tsDist{
+      kDryRunBaseTimestamp, kDryRunBaseTimestamp + kDryRunTimeRange};
+  std::uniform_int_distribution<int64_t> adIdDist{
+      1, std::max<int64_t>(numAdIds, 1)};
+  std::uniform_int_distribution<int64_t> valueDist{1, 1000};
+  std::uniform_int_distribution<int64_t> clickDist{0, 1};
+  auto randomArray = [&r](std::size_t size, auto& dist) {
+    std::vector<int64_t> values(size);
+    std::generate(values.begin(), values.end(), [&]() { return dist(r); });
+    return values;
+  };
+
+  auto numFiles = publisherPaths.size();
+  for (std::size_t file = 0; file < numFiles; ++file) {
+    std::ofstream publisher{publisherPaths.at(file)};
+    std::ofstream partner{partnerPaths.at(file)};
+    publisher << "id_,ad_ids,timestamps,is_click,campaign_metadata\n";
+    partner << "id_,conversion_timestamps,conversion_values,"
+            << "conversion_metadata\n";
+    for (auto i = file * numRows / numFiles;
+         i < (file + 1) * numRows / numFiles;
+         ++i) {
+      publisher << i << ','
+                << toDryRunArrayCell(randomArray(numTouchpoints, adIdDist))
+                << ',' << toDryRunArrayCell(randomArray(numTouchpoints, tsDist))
+                << ','
+                << toDryRunArrayCell(randomArray(numTouchpoints, clickDist))
+                << ','
+                << toDryRunArrayCell(std::vector<int64_t>(numTouchpoints, 0))
+                << '\n';
+      partner << i << ','
+              << toDryRunArrayCell(randomArray(numConversions, tsDist)) << ','
+              << toDryRunArrayCell(randomArray(numConversions, valueDist))
+              << ','
+              << toDryRunArrayCell(std::vector<int64_t>(numConversions, 0))
+              << '\n';
+    }
+  }
+}
+
+// The costs of a dry run of both parties of a game on numRows rows
+struct DryRunSample {
+  int64_t numRows;
+  // The gates of the publisher, which are the same as the partner's
+  uint64_t nonFreeGates;
+  uint64_t freeGates;
+  // What each party sent
+  uint64_t publisherSent;
+  uint64_t partnerSent;
+  double seconds;
+};
+
+// The predicted costs of a run, for a party
+struct DryRunEstimate {
+  int64_t numRows;
+  int64_t numLanes;
+  uint64_t nonFreeGates;
+  uint64_t freeGates;
+  uint64_t sentNetwork;
+  uint64_t receivedNetwork;
+  double computeSeconds;
+  double networkSeconds;
+
+  double getSeconds() const {
+    return computeSeconds + networkSeconds;
+  }
+
+  folly::dynamic toDynamic() const {
+    return folly::dynamic::object("num_rows", numRows)("num_lanes", numLanes)(
+        "non_free_gates", nonFreeGates)("free_gates", freeGates)(
+        "scheduler_transmitted_network", sentNetwork)(
+        "scheduler_received_network", receivedNetwork)(
+        "compute_seconds", computeSeconds)(
+        "network_seconds", networkSeconds);
+  }
+};
+
+// Runs a party of a game on the factory it is given, returning the statistics
+// of its scheduler
+using DryRunParty = std::function<SchedulerStatistics(
+    int party,
+    std::unique_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory>)>;
+
+// The agent factories of the publisher and the partner, connected to each
+// other in memory
+inline auto makeDryRunAgentFactories() {
+  auto host = std::make_shared<
+      fbpcf::engine::communication::InMemoryPartyCommunicationAgentHost>();
+  std::vector<std::unique_ptr<
+      fbpcf::engine::communication::IPartyCommunicationAgentFactory>>
+      factories(2);
+  for (auto party : {PUBLISHER, PARTNER}) {
+    std::map<
+        int,
+        std::shared_ptr<
+            fbpcf::engine::communication::InMemoryPartyCommunicationAgentHost>>
+        hosts{{1 - party, host}};
+    factories.at(party) = std::make_unique<
+        fbpcf::engine::communication::InMemoryPartyCommunicationAgentFactory>(
+        party, std::move(hosts), "dry_run_traffic");
+  }
+  return factories;
+}
+
+/*
+ * Runs both parties of a game in this process, on their own threads and
+ * connected in memory, so a dry run needs neither the other party nor the
+ * network. The parties run the real protocol, so the gates and traffic are
+ * those of a run on the same input.
+ */
+inline DryRunSample runDryRunSample(
+    int64_t numRows,
+    const DryRunParty& runParty) {
+  auto factories = makeDryRunAgentFactories();
+  auto start = std::chrono::steady_clock::now();
+  auto publisher = std::async(
+      std::launch::async,
+      runParty,
+      PUBLISHER,
+      std::move(factories.at(PUBLISHER)));
+  auto partner = std::async(
+      std::launch::async,
+      runParty,
+      PARTNER,
+      std::move(factories.at(PARTNER)));
+  auto publisherStatistics = publisher.get();
+  auto partnerStatistics = partner.get();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return DryRunSample{
+      numRows,
+      publisherStatistics.nonFreeGates,
+      publisherStatistics.freeGates,
+      publisherStatistics.sentNetwork,
+      partnerStatistics.sentNetwork,
+      elapsed.count()};
+}
+
+/*
+ * Predicts the costs of a party in a run of numRows rows from two dry runs on
+ * fewer rows. Every cost is fit as a fixed cost of setting up a lane, such as
+ * the base OTs, plus a cost per row, and the numLanes lanes of the run split
+ * the rows between them. The lanes share the link of the container, of
+ * bandwidthBytesPerSec, so the time sending is that of all the traffic.
+ */
+inline DryRunEstimate extrapolateDryRuns(
+    const DryRunSample& small,
+    const DryRunSample& large,
+    int party,
+    int64_t numRows,
+    int64_t numLanes,
+    double bandwidthBytesPerSec) {
+  numLanes = std::max<int64_t>(numLanes, 1);
+  double rowsApart = std::max<int64_t>(large.numRows - small.numRows, 1);
+  auto predict = [&](double smallCost, double largeCost) {
+    auto perRow = std::max((largeCost - smallCost) / rowsApart, 0.0);
+    auto perLane = std::max(smallCost - perRow * small.numRows, 0.0);
+    return std::make_pair(perLane, perRow);
+  };
+  auto total = [&](double smallCost, double largeCost) {
+    auto [perLane, perRow] = predict(smallCost, largeCost);
+    return static_cast<uint64_t>(perLane * numLanes + perRow * numRows);
+  };
+
+  DryRunEstimate estimate;
+  estimate.numRows = numRows;
+  estimate.numLanes = numLanes;
+  estimate.nonFreeGates = total(small.nonFreeGates, large.nonFreeGates);
+  estimate.freeGates = total(small.freeGates, large.freeGates);
+  auto publisherSent = total(small.publisherSent, large.publisherSent);
+  auto partnerSent = total(small.partnerSent, large.partnerSent);
+  estimate.sentNetwork = party == PUBLISHER ? publisherSent : partnerSent;
+  estimate.receivedNetwork = party == PUBLISHER ? partnerSent : publisherSent;
+
+  auto [secondsPerLane, secondsPerRow] = predict(small.seconds, large.seconds);
+  estimate.computeSeconds =
+      secondsPerLane + secondsPerRow * numRows / numLanes;
+  estimate.networkSeconds = bandwidthBytesPerSec > 0
+      ? std::max(publisherSent, partnerSent) / bandwidthBytesPerSec
+      : 0;
+  return estimate;
+}
+
+/*
+ * Predicts the costs of a party in a run of numRows rows on numLanes lanes.
+ * prepareDryRun writes the inputs of both parties for a number of rows, with
+ * the same dimensions as the run otherwise, to the directory it is given, and
+ * returns how a party runs on them.
+ */
+inline DryRunEstimate estimateFromDryRuns(
+    int party,
+    int64_t numRows,
+    int64_t numLanes,
+    int32_t bandwidthMbps,
+    const std::function<DryRunParty(int64_t numRows, const std::string& dir)>&
+        prepareDryRun) {
+  auto sample = [&](int64_t sampleRows) {
+    auto dir = std::filesystem::temp_directory_path() /
+        folly::sformat("dry_run_{}", folly::Random::secureRand64());
+    std::filesystem::create_directories(dir);
+    auto result =
+        runDryRunSample(sampleRows, prepareDryRun(sampleRows, dir.string()));
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+    return result;
+  };
+  auto small = sample(kDryRunSmallRows);
+  auto large = sample(kDryRunLargeRows);
+  return extrapolateDryRuns(
+      small,
+      large,
+      party,
+      numRows,
+      numLanes,
+      static_cast<double>(bandwidthMbps) * 1'000'000 / 8);
+}
+
+} // namespace common
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <deque>
 #include <numeric>
 #include <vector>
 
@@ -19,9 +20,8 @@ namespace private_measurement::emp_utils {
 // that the input vector of Integers actually represents Bits.
 const std::vector<emp::Bit> intsToBits(const std::vector<emp::Integer>& in);
 
-// Converts a vector of emp::Bits to emp::Integers since we can't add Bits
-// TODO: Could probably be smarter about INT_SIZE here given the size of the
-// input dataset -- if we have N values, output can't be larger than log(N)
+// Converts a vector of emp::Bits to emp::Integers since we can't add Bits.
+// The bits above the lowest one are public zeros, which costs no gates.
 const std::vector<emp::Integer> bitsToInts(const std::vector<emp::Bit>& in);
 
 // Sums the given vector of integers and then reveals the result
@@ -33,7 +33,9 @@ const int64_t sum(const std::vector<emp::Integer>& in);
 template <int TO = emp::PUBLIC>
 const int64_t sum(const std::vector<emp::Bit>& in);
 
-// Sum operations that do *not* call reveal at the end
+// Sum operations that do *not* call reveal at the end. Integers are summed by
+// a balanced tree of adders, and bits are counted by a tree of full adders on
+// as few bits as the count needs, then widened to INT_SIZE bits.
 emp::Integer secretSum(const std::vector<emp::Integer>& in);
 emp::Integer secretSum(const std::vector<emp::Bit>& in);
 
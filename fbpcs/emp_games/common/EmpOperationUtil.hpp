@@ -23,15 +23,13 @@ inline const std::vector<emp::Bit> intsToBits(
 
 inline const std::vector<emp::Integer> bitsToInts(
     const std::vector<emp::Bit>& in) {
-  // auto bitLen = std::ceil(std::log2(in.size() + 1));
-  // TODO: Braced initialization
+  // A bit is the lowest bit of its integer, above which every bit is a public
+  // zero, so no gates are needed, unlike selecting between one and zero
   const emp::Integer zero(INT_SIZE, 0, emp::PUBLIC);
-  const emp::Integer one(INT_SIZE, 1, emp::PUBLIC);
 
-  std::vector<emp::Integer> ints;
-  ints.reserve(in.size());
+  std::vector<emp::Integer> ints(in.size(), zero);
   for (std::vector<emp::Bit>::size_type i = 0; i < in.size(); ++i) {
-    ints.emplace_back(emp::If(in[i], one, zero));
+    ints[i].bits[0] = in[i];
   }
   return ints;
 }
@@ -67,20 +65,68 @@ const int64_t sum(const std::vector<emp::Integer>& in) {
 
 template <int TO>
 const int64_t sum(const std::vector<emp::Bit>& in) {
-  // POTENTIAL OPTIMIZATION: this wastes memory since it stores an additional
-  // vector<Integer> whereas we could instead calculate on the fly.
-  return sum<TO>(bitsToInts(in));
+  return secretSum(in).reveal<int64_t>(TO);
 }
 
 inline emp::Integer secretSum(const std::vector<emp::Integer>& in) {
-  const emp::Integer zero{static_cast<int>(in.at(0).size()), 0, emp::PUBLIC};
-  return std::accumulate(in.begin(), in.end(), zero);
+  // Adding pairs a level at a time takes as many adders as a running sum, but
+  // the circuit is only log2(n) adders deep instead of n
+  auto level = in;
+  while (level.size() > 1) {
+    std::size_t numSums = 0;
+    for (std::size_t i = 0; i + 1 < level.size(); i += 2) {
+      level[numSums++] = level[i] + level[i + 1];
+    }
+    if (level.size() % 2 == 1) {
+      level[numSums++] = std::move(level.back());
+    }
+    level.erase(level.begin() + numSums, level.end());
+  }
+  return level.at(0);
 }
 
 inline emp::Integer secretSum(const std::vector<emp::Bit>& in) {
-  // POTENTIAL OPTIMIZATION: this wastes memory since it stores an additional
-  // vector<Integer> whereas we could instead calculate on the fly.
-  return secretSum(bitsToInts(in));
+  // Bits of the same weight are added three at a time by full adders, whose
+  // sum bit keeps the weight and whose carry bit goes to the next weight,
+  // until every weight has a single bit. That counts with one AND per input
+  // bit, and taking the oldest bits first keeps the tree log(n) deep.
+  std::vector<std::deque<emp::Bit>> weights;
+  if (!in.empty()) {
+    weights.emplace_back(in.begin(), in.end());
+  }
+  for (std::size_t weight = 0; weight < weights.size(); ++weight) {
+    while (weights[weight].size() > 1) {
+      auto a = weights[weight].front();
+      weights[weight].pop_front();
+      auto b = weights[weight].front();
+      weights[weight].pop_front();
+      emp::Bit carry;
+      if (weights[weight].empty()) {
+        // Half adder for the last two bits
+        weights[weight].push_back(a ^ b);
+        carry = a & b;
+      } else {
+        auto c = weights[weight].front();
+        weights[weight].pop_front();
+        // The majority of a, b and c
+        carry = ((a ^ c) & (b ^ c)) ^ c;
+        weights[weight].push_back(a ^ b ^ c);
+      }
+      if (weight + 1 == weights.size()) {
+        weights.emplace_back();
+      }
+      weights[weight + 1].push_back(carry);
+    }
+  }
+
+  // The count only takes as many bits as it needs, the rest are public zeros
+  emp::Integer count{INT_SIZE, 0, emp::PUBLIC};
+  for (std::size_t weight = 0; weight < weights.size(); ++weight) {
+    if (!weights[weight].empty()) {
+      count.bits[weight] = weights[weight].front();
+    }
+  }
+  return count;
 }
 
 template <typename T>
@@ -6,19 +6,40 @@
  */
 
 #pragma once
-#include <set>
+#include <iterator>
+#include <string>
+#include <unordered_set>
 #include "folly/String.h"
 
 namespace private_measurement {
+
+/*
+ * The feature flags of a run, parsed once from the comma separated
+ * pc_feature_flags string. Lookups are O(1), so a parsed FeatureFlags can be
+ * kept and queried wherever the flags are needed instead of splitting the
+ * string again.
+ */
+class FeatureFlags {
+ public:
+  explicit FeatureFlags(const std::string& featureFlags) {
+    folly::splitTo<std::string>(
+        ',',
+        featureFlags,
+        std::inserter(enabledFeatureFlags_, enabledFeatureFlags_.begin()),
+        true);
+  }
+
+  bool isEnabled(const std::string& featureFlag) const {
+    return enabledFeatureFlags_.contains(featureFlag);
+  }
+
+ private:
+  std::unordered_set<std::string> enabledFeatureFlags_;
+};
+
 bool inline isFeatureFlagEnabled(
     const std::string& featureFlags,
     const std::string& featureFlag) {
-  std::set<std::string> enabledFeatureFlags;
-  folly::splitTo<std::string>(
-      ',',
-      featureFlags,
-      std::inserter(enabledFeatureFlags, enabledFeatureFlags.begin()),
-      true);
-  return enabledFeatureFlags.contains(featureFlag);
+  return FeatureFlags{featureFlags}.isEnabled(featureFlag);
 }
 } // namespace private_measurement
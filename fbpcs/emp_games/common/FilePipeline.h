@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <optional>
+
+#include "fbpcs/emp_games/common/ShardQueue.h"
+
+namespace common {
+
+/*
+ * Run every file of an assignment through three stages: load parses the
+ * input of a file, compute runs the game on it and store writes the output.
+ * Only compute uses the network, so while it runs on a file the input of the
+ * next file is loaded and the output of the previous file is stored on
+ * background threads. This keeps at most two inputs in memory, the one being
+ * computed on and the next one, and stores the outputs in the order the files
+ * were computed. Compute always runs on the calling thread, which owns the
+ * scheduler of the game.
+ *
+ * The next file is taken from the assignment before computing the current
+ * one, so both parties still take files at the same points.
+ */
+template <typename Input, typename Output>
+void runFilesPipelined(
+    ShardAssignment& files,
+    std::function<Input(std::size_t)> load,
+    std::function<Output(std::size_t, Input)> compute,
+    std::function<void(std::size_t, Output)> store) {
+  auto current = files.next();
+  std::future<Input> currentInput;
+  if (current.has_value()) {
+    currentInput = std::async(std::launch::async, load, *current);
+  }
+  std::future<void> pendingStore;
+  while (current.has_value()) {
+    auto input = currentInput.get();
+    auto next = files.next();
+    std::future<Input> nextInput;
+    if (next.has_value()) {
+      nextInput = std::async(std::launch::async, load, *next);
+    }
+
+    auto output = compute(*current, std::move(input));
+    if (pendingStore.valid()) {
+      pendingStore.get();
+    }
+    pendingStore = std::async(
+        std::launch::async,
+        [&store, file = *current, output = std::move(output)]() mutable {
+          store(file, std::move(output));
+        });
+
+    current = next;
+    currentInput = std::move(nextInput);
+  }
+  if (pendingStore.valid()) {
+    pendingStore.get();
+  }
+}
+
+} // namespace common
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace common {
+
+/*
+ * Serialized rows which all have the same number of bytes, stored back to
+ * back in one allocation instead of in a vector per row. The UDP libraries
+ * take a vector per row, so the rows are only copied out that way a chunk at a
+ * time, right before they are handed over.
+ */
+class FixedWidthRowBuffer {
+ public:
+  explicit FixedWidthRowBuffer(std::size_t rowWidth) : rowWidth_{rowWidth} {}
+
+  std::size_t getRowWidth() const {
+    return rowWidth_;
+  }
+
+  std::size_t size() const {
+    return numRows_;
+  }
+
+  bool empty() const {
+    return numRows_ == 0;
+  }
+
+  void reserve(std::size_t numRows) {
+    bytes_.reserve(numRows * rowWidth_);
+  }
+
+  // Removes the rows, keeping the allocation for the next ones
+  void clear() {
+    bytes_.clear();
+    numRows_ = 0;
+  }
+
+  // Throws std::invalid_argument if the row doesn't have rowWidth bytes
+  void pushRow(const unsigned char* row, std::size_t size) {
+    if (size != rowWidth_) {
+      throw std::invalid_argument(
+          "Row of " + std::to_string(size) + " bytes in rows of " +
+          std::to_string(rowWidth_) + " bytes");
+    }
+    bytes_.insert(bytes_.end(), row, row + size);
+    ++numRows_;
+  }
+
+  const unsigned char* row(std::size_t i) const {
+    return bytes_.data() + i * rowWidth_;
+  }
+
+  unsigned char* row(std::size_t i) {
+    return bytes_.data() + i * rowWidth_;
+  }
+
+  // Appends a copy of the rows from begin up to end to out, a vector per row
+  void appendRowsTo(
+      std::vector<std::vector<unsigned char>>& out,
+      std::size_t begin,
+      std::size_t end) const {
+    if (begin > end || end > numRows_) {
+      throw std::out_of_range("Rows out of range");
+    }
+    for (std::size_t i = begin; i < end; ++i) {
+      out.emplace_back(row(i), row(i) + rowWidth_);
+    }
+  }
+
+ private:
+  std::size_t rowWidth_;
+  std::size_t numRows_ = 0;
+  std::vector<unsigned char> bytes_;
+};
+
+} // namespace common
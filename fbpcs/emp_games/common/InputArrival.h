@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/Format.h>
+#include <folly/logging/xlog.h>
+
+#include "fbpcf/io/api/FileReader.h"
+
+/*
+Lets a game start before its inputs are written. The parties connect and their
+schedulers set up the protocols under them, such as the base OTs and the first
+tuples of the engine, which doesn't depend on the inputs. The game then waits
+for the inputs of each shard before it parses them, so that only the work which
+depends on the inputs is left once they arrive.
+
+An input counts as arrived once it can be opened. Inputs on local disk should
+be written elsewhere and moved into place, so that they aren't read while
+still being written, as objects of cloud storage are only visible once whole.
+*/
+namespace common {
+
+constexpr std::chrono::milliseconds kInputPollInterval{5000};
+
+// Whether the file at path exists and can be opened
+inline bool canOpenInput(const std::string& path) {
+  try {
+    fbpcf::io::FileReader reader{path};
+    reader.close();
+    return true;
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
+// Polls every pollInterval until all of paths can be opened. Throws if they
+// can't after timeout.
+inline void waitForInputs(
+    const std::vector<std::string>& paths,
+    std::chrono::seconds timeout,
+    std::chrono::milliseconds pollInterval = kInputPollInterval) {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  for (const auto& path : paths) {
+    bool logged = false;
+    while (!canOpenInput(path)) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        throw std::runtime_error(folly::sformat(
+            "Input {} didn't arrive within {} seconds", path, timeout.count()));
+      }
+      if (!logged) {
+        XLOG(INFO) << "Waiting for input " << path << " to arrive";
+        logged = true;
+      }
+      std::this_thread::sleep_for(pollInterval);
+    }
+  }
+}
+
+} // namespace common
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <aws/s3/model/HeadObjectRequest.h>
+#include <folly/Format.h>
+#include <folly/Random.h>
+#include <folly/hash/SpookyHashV2.h>
+#include <folly/logging/xlog.h>
+
+#include "fbpcf/aws/S3Util.h"
+#include "fbpcf/io/api/FileReader.h"
+#include "fbpcf/io/api/IReaderCloser.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
+
+/*
+A cache of remote input files in a local directory, so that the stages which
+read the same objects again, such as retries, several attribution rules or
+aggregation after attribution, read them from a local disk rather than
+downloading them again. The directory can be shared by every container on a
+host.
+
+Files are cached under the hash of their ETag and size, so a file is cached
+once whatever path it is read from, and a file which changed gets a new entry.
+The ETag of a file is looked up every time it is opened, which is much cheaper
+than reading it.
+
+A file is downloaded holding an exclusive lock on its entry, which makes the
+other readers of the same file, in this process or another one sharing the
+directory, wait for it instead of downloading it as well. It is downloaded to
+a temporary file, moved into place once complete, so a reader never sees a
+partial file. Entries are never evicted, so the directory has to be cleaned up
+by whoever provides it.
+*/
+namespace private_measurement::compressed_io {
+
+class InputCache {
+ public:
+  // Downloads the file to the given local path
+  using Download = std::function<void(const std::string&)>;
+
+  explicit InputCache(std::filesystem::path directory)
+      : directory_{std::move(directory)} {
+    std::filesystem::create_directories(directory_);
+  }
+
+  // The name of the entry of a file with the given ETag and size
+  static std::string getKey(const std::string& etag, uint64_t size) {
+    folly::hash::SpookyHashV2 hash;
+    hash.Init(0, 0);
+    hash.Update(&size, sizeof(size));
+    hash.Update(etag.data(), etag.size());
+    uint64_t hash1 = 0;
+    uint64_t hash2 = 0;
+    hash.Final(&hash1, &hash2);
+    return folly::sformat("{:016x}{:016x}", hash1, hash2);
+  }
+
+  // The local path of the file with the given ETag and size, which is
+  // downloaded first if it isn't cached yet
+  std::string get(
+      const std::string& etag,
+      uint64_t size,
+      const Download& download) {
+    auto key = getKey(etag, size);
+    auto path = directory_ / key;
+    if (isCached(path, size)) {
+      return path.native();
+    }
+
+    FileLock lock{directory_ / (key + ".lock")};
+    // Another reader may have downloaded it while this one waited
+    if (isCached(path, size)) {
+      return path.native();
+    }
+    auto tmpPath = directory_ /
+        (key + ".tmp." + std::to_string(folly::Random::secureRand64()));
+    try {
+      download(tmpPath.native());
+      if (std::filesystem::file_size(tmpPath) != size) {
+        throw std::runtime_error(
+            "Cached input " + key + " doesn't have the expected size");
+      }
+      std::filesystem::rename(tmpPath, path);
+    } catch (...) {
+      std::error_code ec;
+      std::filesystem::remove(tmpPath, ec);
+      throw;
+    }
+    XLOG(INFO) << "Cached input " << key << " of " << size << " bytes";
+    return path.native();
+  }
+
+ private:
+  // An exclusive lock on a file, taken with flock so that it excludes both
+  // the other threads and the other processes locking the same file
+  class FileLock {
+   public:
+    explicit FileLock(const std::filesystem::path& path)
+        : fd_{::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)} {
+      if (fd_ < 0 || ::flock(fd_, LOCK_EX) != 0) {
+        auto error = std::error_code{errno, std::generic_category()};
+        if (fd_ >= 0) {
+          ::close(fd_);
+        }
+        throw std::system_error(error, "Failed to lock " + path.native());
+      }
+    }
+
+    ~FileLock() {
+      ::flock(fd_, LOCK_UN);
+      ::close(fd_);
+    }
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+   private:
+    int fd_;
+  };
+
+  static bool isCached(const std::filesystem::path& path, uint64_t size) {
+    std::error_code ec;
+    auto cachedSize = std::filesystem::file_size(path, ec);
+    return !ec && cachedSize == size;
+  }
+
+  std::filesystem::path directory_;
+};
+
+// The ETag and size of an object in S3
+inline std::pair<std::string, uint64_t> getS3ETagAndSize(
+    const std::string& path) {
+  auto ref = fbpcf::aws::uriToObjectReference(path);
+  fbpcf::aws::S3ClientOption option;
+  option.region = ref.region;
+  auto client = fbpcf::aws::createS3Client(option);
+  Aws::S3::Model::HeadObjectRequest request;
+  request.SetBucket(ref.bucket);
+  request.SetKey(ref.key);
+  auto outcome = client->HeadObject(request);
+  if (!outcome.IsSuccess()) {
+    throw std::runtime_error(
+        "Failed to look up " + path + ": " +
+        std::string{outcome.GetError().GetMessage()});
+  }
+  return {
+      std::string{outcome.GetResult().GetETag()},
+      static_cast<uint64_t>(outcome.GetResult().GetContentLength())};
+}
+
+// Reads the files in S3 read by this process through a cache in directory, or
+// stops caching them if directory is empty
+inline void setInputCacheDirectory(const std::string& directory) {
+  if (directory.empty()) {
+    setS3ReaderOpener(nullptr);
+    return;
+  }
+  auto inputCache = std::make_shared<InputCache>(directory);
+  setS3ReaderOpener([inputCache](
+                        const std::string& path,
+                        std::size_t partSize,
+                        std::size_t partsAhead)
+                        -> std::unique_ptr<fbpcf::io::IReaderCloser> {
+    auto [etag, size] = getS3ETagAndSize(path);
+    auto localPath =
+        inputCache->get(etag, size, [&](const std::string& downloadPath) {
+          detail::downloadFile(path, downloadPath, partSize, partsAhead);
+        });
+    return std::make_unique<fbpcf::io::FileReader>(localPath);
+  });
+}
+} // namespace private_measurement::compressed_io
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "folly/logging/xlog.h"
+
+#include "fbpcs/emp_games/common/RowGroupFormat.h"
+#include "fbpcs/emp_games/common/Util.h"
+
+/*
+Rows of a game input, read either from a csv or from a file in the row group
+format (see RowGroupFormat.h), so that the input parsers are written once for
+both. Parsers take the row as a template parameter and read array cells through
+appendArray, which parses the text of a csv cell and copies the already typed
+values of a row group.
+*/
+namespace common {
+
+// The cells of a csv row, such as the parts passed by csv::readCsvViews
+class CsvInputRow {
+ public:
+  explicit CsvInputRow(const std::vector<std::string_view>& parts)
+      : parts_{parts} {}
+
+  size_t size() const {
+    return parts_.size();
+  }
+
+  // Appends the values of an array cell such as `[1, 2, 3]`
+  template <typename T>
+  void appendArray(size_t column, std::vector<T>& out) const {
+    appendInnerArray(parts_[column], out);
+  }
+
+ private:
+  const std::vector<std::string_view>& parts_;
+};
+
+// A row of a row group, whose arrays are already parsed
+class RowGroupInputRow {
+ public:
+  RowGroupInputRow(
+      const private_measurement::row_group::Schema& schema,
+      const private_measurement::row_group::RowGroup& group,
+      size_t row)
+      : schema_{schema}, group_{group}, row_{row} {}
+
+  size_t size() const {
+    return schema_.size();
+  }
+
+  // Appends the values of an array cell. An integer cell is taken as an array
+  // of one value, the same as it is in a csv.
+  template <typename T>
+  void appendArray(size_t column, std::vector<T>& out) const {
+    using private_measurement::row_group::ColumnType;
+    const auto& schemaColumn = schema_[column];
+    if (schemaColumn.type == ColumnType::kInt64) {
+      out.push_back(toValue<T>(group_.getInt64(column, row_)));
+      return;
+    }
+    if (schemaColumn.type != ColumnType::kInt64Array) {
+      XLOG(FATAL) << "Column " << schemaColumn.name << " is not an array";
+    }
+    auto values = group_.getArray(schema_, column, row_);
+    for (uint32_t i = 0; i < schemaColumn.arrayWidth; ++i) {
+      out.push_back(toValue<T>(values[i]));
+    }
+  }
+
+ private:
+  // Converts negative values to zero for unsigned types, as appendInnerArray
+  // does
+  template <typename T>
+  static T toValue(int64_t value) {
+    if constexpr (std::is_unsigned_v<T>) {
+      if (value < 0) {
+        if constexpr (!std::is_same_v<T, bool>) {
+          XLOGF(ERR, "Error: input is negative {}", -value);
+        }
+        return 0;
+      }
+    }
+    return static_cast<T>(value);
+  }
+
+  const private_measurement::row_group::Schema& schema_;
+  const private_measurement::row_group::RowGroup& group_;
+  size_t row_;
+};
+
+// The column names of a row group schema, in the order of its columns
+inline std::vector<std::string> getRowGroupHeader(
+    const private_measurement::row_group::Schema& schema) {
+  std::vector<std::string> header;
+  header.reserve(schema.size());
+  for (const auto& column : schema) {
+    header.push_back(column.name);
+  }
+  return header;
+}
+
+} // namespace common
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <folly/Format.h>
+#include <folly/json.h>
+
+#include "fbpcf/io/api/FileIOWrappers.h"
+
+namespace common {
+
+/*
+ * One of several independent jobs run in a single MPC session, so that they
+ * share the fixed costs of a session: connecting, the TLS handshake and the
+ * base OTs. Each job is run as one of the files of the session, so its rows
+ * are never combined with the rows of another job and it gets its own output,
+ * which is thresholded and revealed on its own downstream.
+ */
+struct BatchedJob {
+  std::string id;
+  // The input paths of the job, in the order the game takes them
+  std::vector<std::string> inputs;
+  std::string output;
+};
+
+/*
+ * Reads the jobs to batch into one session from a manifest of the form
+ *   {"jobs": [{"id": "a", "inputs": ["..."], "output": "..."}, ...]}
+ * where every job has numInputs inputs. Both parties have to be given
+ * manifests listing the same jobs in the same order, as the jobs are run in
+ * that order. Unlike a shard cost manifest, which only affects how long a run
+ * takes, the jobs can't be guessed without it, so a manifest which can't be
+ * read is an error.
+ */
+inline std::vector<BatchedJob> readJobManifest(
+    const std::string& manifestPath,
+    std::size_t numInputs) {
+  auto manifest =
+      folly::parseJson(fbpcf::io::FileIOWrappers::readFile(manifestPath));
+
+  std::vector<BatchedJob> jobs;
+  std::unordered_set<std::string> ids;
+  std::unordered_set<std::string> outputs;
+  for (auto& job : manifest.at("jobs")) {
+    BatchedJob batchedJob{
+        job.at("id").asString(), {}, job.at("output").asString()};
+    for (auto& input : job.at("inputs")) {
+      batchedJob.inputs.push_back(input.asString());
+    }
+    if (batchedJob.inputs.size() != numInputs) {
+      throw std::invalid_argument(folly::sformat(
+          "Job {} in {} has {} inputs instead of {}",
+          batchedJob.id,
+          manifestPath,
+          batchedJob.inputs.size(),
+          numInputs));
+    }
+    if (!ids.insert(batchedJob.id).second) {
+      throw std::invalid_argument(folly::sformat(
+          "Job {} is listed twice in {}", batchedJob.id, manifestPath));
+    }
+    if (!outputs.insert(batchedJob.output).second) {
+      throw std::invalid_argument(folly::sformat(
+          "Job {} in {} writes to the output of another job",
+          batchedJob.id,
+          manifestPath));
+    }
+    jobs.push_back(std::move(batchedJob));
+  }
+  if (jobs.empty()) {
+    throw std::invalid_argument(
+        folly::sformat("There are no jobs in {}", manifestPath));
+  }
+  return jobs;
+}
+
+} // namespace common
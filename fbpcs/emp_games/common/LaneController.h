@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <folly/logging/xlog.h>
+
+#include "fbpcf/engine/communication/IPartyCommunicationAgent.h"
+#include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
+#include "fbpcf/util/MetricCollector.h"
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/ShardQueue.h"
+
+namespace common {
+
+// Forwards to an agent, adding the bytes it sends and receives to a counter
+// shared by the agents of every app
+class TrafficCountingAgent
+    : public fbpcf::engine::communication::IPartyCommunicationAgent {
+ public:
+  TrafficCountingAgent(
+      std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+          agent,
+      std::shared_ptr<std::atomic<uint64_t>> traffic)
+      : agent_{std::move(agent)}, traffic_{std::move(traffic)} {}
+
+  void send(const std::vector<unsigned char>& data) override {
+    agent_->send(data);
+    *traffic_ += data.size();
+  }
+
+  std::vector<unsigned char> receive(size_t size) override {
+    auto data = agent_->receive(size);
+    *traffic_ += size;
+    return data;
+  }
+
+  std::pair<uint64_t, uint64_t> getTrafficStatistics() const override {
+    return agent_->getTrafficStatistics();
+  }
+
+ protected:
+  void sendImpl(const void* data, int nBytes) override {
+    agent_->send(std::vector<unsigned char>(
+        static_cast<const unsigned char*>(data),
+        static_cast<const unsigned char*>(data) + nBytes));
+    *traffic_ += nBytes;
+  }
+
+  void recvImpl(void* data, int nBytes) override {
+    auto received = agent_->receive(nBytes);
+    std::copy(
+        received.begin(), received.end(), static_cast<unsigned char*>(data));
+    *traffic_ += nBytes;
+  }
+
+ private:
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+      agent_;
+  std::shared_ptr<std::atomic<uint64_t>> traffic_;
+};
+
+class TrafficCountingAgentFactory
+    : public fbpcf::engine::communication::IPartyCommunicationAgentFactory {
+ public:
+  TrafficCountingAgentFactory(
+      std::unique_ptr<
+          fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+          factory,
+      std::shared_ptr<std::atomic<uint64_t>> traffic,
+      std::shared_ptr<fbpcf::util::MetricCollector> metricCollector)
+      : fbpcf::engine::communication::IPartyCommunicationAgentFactory(
+            "counted_traffic",
+            metricCollector),
+        factory_{std::move(factory)},
+        traffic_{std::move(traffic)} {}
+
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+  create(int id, std::string name) override {
+    return std::make_unique<TrafficCountingAgent>(
+        factory_->create(id, std::move(name)), traffic_);
+  }
+
+ private:
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+      factory_;
+  std::shared_ptr<std::atomic<uint64_t>> traffic_;
+};
+
+/*
+ * Decides how many of the apps of a party run concurrently, for runs where
+ * that is found out rather than set by the concurrency flag. Whether another
+ * app speeds a run up depends on whether it is bound by the CPU, the latency
+ * or the bandwidth between the parties, so the controller starts minLanes
+ * apps, then measures the traffic of the running apps for an interval before
+ * starting each of the next ones. It stops adding apps once the last one
+ * didn't raise the throughput by minGain, the process used more than
+ * maxCpuUtilization of the cores, or the queue has no file left for another
+ * app.
+ *
+ * Both parties have to start the same apps, so only the publisher measures,
+ * and sends each decision to the partner over an agent connected before the
+ * apps are constructed.
+ */
+class LaneController {
+ public:
+  struct Options {
+    std::size_t minLanes = 2;
+    std::chrono::milliseconds interval{30000};
+    double minGain = 0.1;
+    double maxCpuUtilization = 0.9;
+  };
+
+  LaneController(int myRole, std::shared_ptr<ShardQueue> queue, Options options)
+      : myRole_{myRole},
+        queue_{std::move(queue)},
+        options_{options},
+        traffic_{std::make_shared<std::atomic<uint64_t>>(0)} {}
+
+  // Connects to the controller of the other party. Called by both parties at
+  // the same point with respect to the other agents created from the factory
+  void connect(
+      fbpcf::engine::communication::IPartyCommunicationAgentFactory& factory) {
+    communicationAgent_ =
+        factory.create(myRole_ == PUBLISHER ? PARTNER : PUBLISHER, "lanes");
+  }
+
+  // Wraps the factory of an app, so that its traffic is measured
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+  countTraffic(
+      std::unique_ptr<
+          fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+          factory,
+      std::shared_ptr<fbpcf::util::MetricCollector> metricCollector) {
+    return std::make_unique<TrafficCountingAgentFactory>(
+        std::move(factory), traffic_, std::move(metricCollector));
+  }
+
+  // Whether to start the app of the given index, once apps 0 to lane - 1 are
+  // running. Blocks for the interval of the measurement, and is called for
+  // one lane at a time
+  bool shouldStart(std::size_t lane) {
+    if (lane < options_.minLanes) {
+      return true;
+    }
+    if (stopped_) {
+      return false;
+    }
+
+    bool start;
+    if (myRole_ == PUBLISHER) {
+      start = measureAndDecide(lane);
+      communicationAgent_->sendT(std::vector<uint64_t>{start ? 1U : 0U});
+    } else {
+      start = communicationAgent_->receiveT<uint64_t>(1).at(0) != 0;
+    }
+    stopped_ = !start;
+    return start;
+  }
+
+  // Whether the throughput of the running apps, in bytes per second,
+  // justifies another one, given the throughput before the last one started
+  // (0 if it wasn't measured) and the share of the cores the process used
+  static bool shouldAddLane(
+      double throughput,
+      double previousThroughput,
+      double cpuUtilization,
+      const Options& options) {
+    if (cpuUtilization > options.maxCpuUtilization) {
+      return false;
+    }
+    return previousThroughput == 0 ||
+        throughput >= previousThroughput * (1 + options.minGain);
+  }
+
+ private:
+  bool measureAndDecide(std::size_t lane) {
+    auto startTraffic = traffic_->load();
+    auto startCpu = std::clock();
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + options_.interval;
+    // Checks the queue while waiting, so that a run whose files are all taken
+    // doesn't wait out the interval
+    for (auto now = start; now < end; now = std::chrono::steady_clock::now()) {
+      if (!queue_->hasRemaining()) {
+        XLOG(INFO) << "Running " << lane << " apps, as every file is taken";
+        return false;
+      }
+      std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(
+          end - now, std::chrono::milliseconds(100)));
+    }
+
+    auto seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    auto throughput = (traffic_->load() - startTraffic) / seconds;
+    auto cores = std::max(1U, std::thread::hardware_concurrency());
+    auto cpuUtilization =
+        static_cast<double>(std::clock() - startCpu) / CLOCKS_PER_SEC /
+        (seconds * cores);
+    auto addLane = shouldAddLane(
+        throughput, previousThroughput_, cpuUtilization, options_);
+    XLOG(INFO) << lane << " apps ran at " << throughput << " bytes/s, using "
+               << cpuUtilization * 100 << "% of the CPU. "
+               << (addLane ? "Starting another" : "Not starting another");
+    previousThroughput_ = throughput;
+    return addLane;
+  }
+
+  int myRole_;
+  std::shared_ptr<ShardQueue> queue_;
+  Options options_;
+  std::shared_ptr<std::atomic<uint64_t>> traffic_;
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+      communicationAgent_;
+  double previousThroughput_ = 0;
+  bool stopped_ = false;
+};
+
+} // namespace common
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <utility>
+
+#include <folly/logging/xlog.h>
+
+namespace common {
+
+// The resident set size of the process in bytes, read from statm, or 0 if it
+// can't be read
+inline uint64_t readCurrentRss(
+    const std::string& statmPath = "/proc/self/statm") {
+  std::ifstream in{statmPath};
+  uint64_t totalPages = 0;
+  uint64_t residentPages = 0;
+  if (!(in >> totalPages >> residentPages)) {
+    XLOGF(WARN, "Could not read the memory usage from {}", statmPath);
+    return 0;
+  }
+  return residentPages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+// Returns the memory freed to the allocator to the system where the allocator
+// allows it, so that the resident set size reflects what is still in use
+inline void releaseFreeMemory() {
+#ifdef __GLIBC__
+  malloc_trim(0);
+#endif
+}
+
+// The resident set size after releasing the free memory
+inline uint64_t readInUseRss() {
+  releaseFreeMemory();
+  return readCurrentRss();
+}
+
+/*
+ * Sizes the batches a game feeds its inputs in by the memory the process is
+ * holding, so that a run which gets close to its memory budget carries on
+ * with smaller batches instead of being killed. The secrets of a batch and
+ * the gates the lazy scheduler buffers for it are freed once the batch is
+ * revealed, so a smaller next batch brings the peak down.
+ *
+ * Above highWatermark of the budget the batch is halved, down to
+ * minBatchFraction of the size the run asked for, and below lowWatermark it is
+ * doubled back, up to that size. Since an allocator doesn't always return what
+ * is freed to the system, the memory use may never drop below lowWatermark
+ * again, so the batch is also doubled after growAfterBatches batches in a row
+ * which stayed below highWatermark. A budget of 0 leaves the batch size as it
+ * is.
+ */
+class MemoryGovernor {
+ public:
+  struct Options {
+    uint64_t budgetBytes = 0;
+    double highWatermark = 0.8;
+    double lowWatermark = 0.5;
+    double minBatchFraction = 0.125;
+    std::size_t growAfterBatches = 4;
+  };
+
+  explicit MemoryGovernor(
+      Options options,
+      std::function<uint64_t()> readRss = [] { return readInUseRss(); })
+      : options_{options}, readRss_{std::move(readRss)} {}
+
+  bool isEnabled() const {
+    return options_.budgetBytes > 0;
+  }
+
+  // The smallest batch the size the run asked for is shrunk to
+  std::size_t getMinBatchSize(std::size_t max) const {
+    auto min = static_cast<std::size_t>(
+        std::ceil(static_cast<double>(max) * options_.minBatchFraction));
+    return std::clamp<std::size_t>(min, 1, std::max<std::size_t>(max, 1));
+  }
+
+  // The size of the next batch, given the size of the last one and the size
+  // the run asked for
+  std::size_t nextBatchSize(std::size_t current, std::size_t max) {
+    if (!isEnabled()) {
+      return max;
+    }
+    auto rss = readRss_();
+    auto budget = static_cast<double>(options_.budgetBytes);
+    if (rss > options_.highWatermark * budget) {
+      batchesBelowHighWatermark_ = 0;
+      auto next = std::max(current / 2, getMinBatchSize(max));
+      if (next < current) {
+        XLOGF(
+            INFO,
+            "Memory use of {} bytes is close to the budget of {}, shrinking "
+            "the batch from {} to {}",
+            rss,
+            options_.budgetBytes,
+            current,
+            next);
+      }
+      return std::min(next, max);
+    }
+    ++batchesBelowHighWatermark_;
+    if (rss < options_.lowWatermark * budget ||
+        batchesBelowHighWatermark_ >= options_.growAfterBatches) {
+      batchesBelowHighWatermark_ = 0;
+      return std::min(current * 2, max);
+    }
+    return std::min(current, max);
+  }
+
+ private:
+  Options options_;
+  std::function<uint64_t()> readRss_;
+  std::size_t batchesBelowHighWatermark_ = 0;
+};
+
+} // namespace common
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <folly/dynamic.h>
+
+/*
+A binary format for the per shard metrics of the aggregation games, which are
+trees of dicts and lists with a 64 bit secret share at every leaf. The shard
+combiners read it back without parsing JSON, which for these files is mostly
+parsing the digits of the shares. The tree shape is written once as a schema,
+and the shares follow it as fixed width values.
+
+All integers are written in the byte order of the host, which is little endian
+on every platform we run on. A file is laid out as:
+
+  magic        8 bytes, kMagic
+  schemaSize   uint64, followed by the schema
+  numValues    uint64
+  values       numValues int64 values, in the order of the leaves in the schema
+
+The schema lists the nodes in pre order, each starting with its tag:
+
+  kValueTag    uint8, a leaf taking the next value
+  kListTag     uint8, then size uint32 followed by the elements
+  kDictTag     uint8, then size uint32 followed by, per entry, keySize uint32,
+               the key and the node of the entry
+*/
+namespace private_measurement::metric_tree {
+
+constexpr std::string_view kMagic{"PCSMTRE1", 8};
+constexpr uint8_t kValueTag = 0;
+constexpr uint8_t kListTag = 1;
+constexpr uint8_t kDictTag = 2;
+
+// Whether the first bytes of a file are the magic of this format
+inline bool hasMagic(std::string_view prefix) {
+  return prefix.substr(0, kMagic.size()) == kMagic;
+}
+
+namespace detail {
+template <typename T>
+inline void append(std::string& out, T value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void encodeNode(
+    const folly::dynamic& node,
+    std::string& schema,
+    std::vector<int64_t>& values) {
+  switch (node.type()) {
+    case folly::dynamic::INT64:
+      append<uint8_t>(schema, kValueTag);
+      values.push_back(node.asInt());
+      break;
+    case folly::dynamic::ARRAY:
+      append<uint8_t>(schema, kListTag);
+      append<uint32_t>(schema, node.size());
+      for (const auto& element : node) {
+        encodeNode(element, schema, values);
+      }
+      break;
+    case folly::dynamic::OBJECT:
+      append<uint8_t>(schema, kDictTag);
+      append<uint32_t>(schema, node.size());
+      for (const auto& [key, value] : node.items()) {
+        auto keyString = key.asString();
+        append<uint32_t>(schema, keyString.size());
+        schema += keyString;
+        encodeNode(value, schema, values);
+      }
+      break;
+    default:
+      throw std::invalid_argument(
+          "Metric trees only hold integers, lists and dicts");
+  }
+}
+
+class Cursor {
+ public:
+  explicit Cursor(std::string_view content) : content_{content} {}
+
+  std::string_view take(std::size_t size) {
+    if (size > content_.size() - position_) {
+      throw std::runtime_error("Metric tree is truncated");
+    }
+    auto bytes = content_.substr(position_, size);
+    position_ += size;
+    return bytes;
+  }
+
+  template <typename T>
+  T read() {
+    T value;
+    std::memcpy(&value, take(sizeof(T)).data(), sizeof(T));
+    return value;
+  }
+
+  bool atEnd() const {
+    return position_ == content_.size();
+  }
+
+ private:
+  std::string_view content_;
+  std::size_t position_ = 0;
+};
+
+inline folly::dynamic decodeNode(Cursor& schema, Cursor& values) {
+  switch (schema.read<uint8_t>()) {
+    case kValueTag:
+      return values.read<int64_t>();
+    case kListTag: {
+      auto size = schema.read<uint32_t>();
+      auto node = folly::dynamic::array();
+      for (uint32_t i = 0; i < size; ++i) {
+        node.push_back(decodeNode(schema, values));
+      }
+      return node;
+    }
+    case kDictTag: {
+      auto size = schema.read<uint32_t>();
+      auto node = folly::dynamic::object();
+      for (uint32_t i = 0; i < size; ++i) {
+        std::string key{schema.take(schema.read<uint32_t>())};
+        node.insert(std::move(key), decodeNode(schema, values));
+      }
+      return node;
+    }
+    default:
+      throw std::runtime_error("Metric tree has a node of an unknown type");
+  }
+}
+} // namespace detail
+
+// Throws std::invalid_argument if the tree holds anything other than integers,
+// lists and dicts
+inline std::string encode(const folly::dynamic& metrics) {
+  std::string schema;
+  std::vector<int64_t> values;
+  detail::encodeNode(metrics, schema, values);
+
+  std::string out{kMagic};
+  out.reserve(
+      kMagic.size() + 2 * sizeof(uint64_t) + schema.size() +
+      values.size() * sizeof(int64_t));
+  detail::append<uint64_t>(out, schema.size());
+  out += schema;
+  detail::append<uint64_t>(out, values.size());
+  out.append(
+      reinterpret_cast<const char*>(values.data()),
+      values.size() * sizeof(int64_t));
+  return out;
+}
+
+// Throws std::runtime_error on content which isn't in this format or is
+// malformed
+inline folly::dynamic decode(std::string_view content) {
+  if (!hasMagic(content)) {
+    throw std::runtime_error("Input is not in the metric tree format");
+  }
+  detail::Cursor header{content.substr(kMagic.size())};
+  auto schemaSize = header.read<uint64_t>();
+  detail::Cursor schema{header.take(schemaSize)};
+  auto numValues = header.read<uint64_t>();
+  if (numValues > content.size() / sizeof(int64_t)) {
+    throw std::runtime_error("Metric tree is truncated");
+  }
+  detail::Cursor values{header.take(numValues * sizeof(int64_t))};
+  if (!header.atEnd()) {
+    throw std::runtime_error("Metric tree has trailing bytes");
+  }
+
+  auto metrics = detail::decodeNode(schema, values);
+  if (!schema.atEnd() || !values.atEnd()) {
+    throw std::runtime_error("Metric tree schema doesn't match its values");
+  }
+  return metrics;
+}
+
+} // namespace private_measurement::metric_tree
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "fbpcs/emp_games/common/MetricsRegistry.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace common {
+
+folly::dynamic mergeMetrics(
+    const folly::dynamic& first,
+    const folly::dynamic& second) {
+  if (first.isNull()) {
+    return second;
+  }
+  if (second.isNull()) {
+    return first;
+  }
+  if (first.isInt() && second.isInt()) {
+    return first.asInt() + second.asInt();
+  }
+  if (first.isNumber() && second.isNumber()) {
+    return first.asDouble() + second.asDouble();
+  }
+  if (first.isObject() && second.isObject()) {
+    auto merged = first;
+    for (const auto& [key, value] : second.items()) {
+      auto existing = merged.get_ptr(key);
+      if (existing == nullptr) {
+        merged.insert(key, value);
+      } else {
+        *existing = mergeMetrics(*existing, value);
+      }
+    }
+    return merged;
+  }
+  return first;
+}
+
+std::size_t getMetricShard() {
+  thread_local std::size_t shard =
+      std::hash<std::thread::id>{}(std::this_thread::get_id()) %
+      ShardedCounter<int64_t>::kShards;
+  return shard;
+}
+
+void Histogram::record(double value) {
+  count_.add(1);
+  sum_.add(value);
+  std::size_t bucket = 0;
+  if (value >= 1) {
+    bucket = std::min<std::size_t>(
+        static_cast<std::size_t>(std::floor(std::log2(value))) + 1,
+        kBuckets - 1);
+  }
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+folly::dynamic Histogram::toDynamic() const {
+  // Only the buckets with values, by their upper bound
+  folly::dynamic buckets = folly::dynamic::object();
+  for (std::size_t i = 0; i < kBuckets; ++i) {
+    auto count = buckets_[i].load(std::memory_order_relaxed);
+    if (count > 0) {
+      buckets.insert(
+          "lt_" + std::to_string(static_cast<uint64_t>(1) << i), count);
+    }
+  }
+  return folly::dynamic::object("count", getCount())("sum", getSum())(
+      "buckets", std::move(buckets));
+}
+
+MetricsRegistry& MetricsRegistry::getInstance() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+template <typename Metric>
+Metric& MetricsRegistry::getOrCreate(
+    std::map<std::string, std::unique_ptr<Metric>>& metrics,
+    const std::string& name) {
+  {
+    std::shared_lock<std::shared_mutex> lock{mutex_};
+    auto metric = metrics.find(name);
+    if (metric != metrics.end()) {
+      return *metric->second;
+    }
+  }
+  std::unique_lock<std::shared_mutex> lock{mutex_};
+  auto& metric = metrics[name];
+  if (metric == nullptr) {
+    metric = std::make_unique<Metric>();
+  }
+  return *metric;
+}
+
+ShardedCounter<int64_t>& MetricsRegistry::getCounter(const std::string& name) {
+  return getOrCreate(counters_, name);
+}
+
+ShardedCounter<double>& MetricsRegistry::getDoubleCounter(
+    const std::string& name) {
+  return getOrCreate(doubleCounters_, name);
+}
+
+Gauge& MetricsRegistry::getGauge(const std::string& name) {
+  return getOrCreate(gauges_, name);
+}
+
+Histogram& MetricsRegistry::getHistogram(const std::string& name) {
+  return getOrCreate(histograms_, name);
+}
+
+folly::dynamic MetricsRegistry::toDynamic() const {
+  std::shared_lock<std::shared_mutex> lock{mutex_};
+  folly::dynamic result = folly::dynamic::object();
+  for (const auto& [name, counter] : counters_) {
+    result.insert(name, counter->getValue());
+  }
+  for (const auto& [name, counter] : doubleCounters_) {
+    result.insert(name, counter->getValue());
+  }
+  for (const auto& [name, gauge] : gauges_) {
+    result.insert(name, gauge->getValue());
+  }
+  for (const auto& [name, histogram] : histograms_) {
+    result.insert(name, histogram->toDynamic());
+  }
+  return result;
+}
+
+namespace {
+std::string toPrometheusName(
+    const std::string& prefix,
+    const std::string& name) {
+  auto result = prefix + name;
+  for (std::size_t i = 0; i < result.size(); ++i) {
+    auto c = result[i];
+    bool allowed = std::isalpha(static_cast<unsigned char>(c)) || c == '_' ||
+        c == ':' || (i > 0 && std::isdigit(static_cast<unsigned char>(c)));
+    if (!allowed) {
+      result[i] = '_';
+    }
+  }
+  return result;
+}
+} // namespace
+
+std::string MetricsRegistry::toPrometheusText(const std::string& prefix) const {
+  std::shared_lock<std::shared_mutex> lock{mutex_};
+  std::ostringstream out;
+  auto writeSample = [&out](
+                         const std::string& name,
+                         const std::string& type,
+                         auto value) {
+    out << "# TYPE " << name << ' ' << type << '\n'
+        << name << ' ' << value << '\n';
+  };
+  for (const auto& [name, counter] : counters_) {
+    writeSample(toPrometheusName(prefix, name), "counter", counter->getValue());
+  }
+  for (const auto& [name, counter] : doubleCounters_) {
+    writeSample(toPrometheusName(prefix, name), "counter", counter->getValue());
+  }
+  for (const auto& [name, gauge] : gauges_) {
+    writeSample(toPrometheusName(prefix, name), "gauge", gauge->getValue());
+  }
+  for (const auto& [name, histogram] : histograms_) {
+    auto metricName = toPrometheusName(prefix, name);
+    out << "# TYPE " << metricName << " histogram\n";
+    // Prometheus buckets are cumulative, and bucket i holds the values below
+    // 2^i
+    int64_t cumulative = 0;
+    for (std::size_t i = 0; i < Histogram::kBuckets; ++i) {
+      auto count = histogram->getBucketCount(i);
+      if (count == 0) {
+        continue;
+      }
+      cumulative += count;
+      out << metricName << "_bucket{le=\"" << (static_cast<uint64_t>(1) << i)
+          << "\"} " << cumulative << '\n';
+    }
+    out << metricName << "_bucket{le=\"+Inf\"} " << histogram->getCount()
+        << '\n'
+        << metricName << "_sum " << histogram->getSum() << '\n'
+        << metricName << "_count " << histogram->getCount() << '\n';
+  }
+  return out.str();
+}
+
+} // namespace common
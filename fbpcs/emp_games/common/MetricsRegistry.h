@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <type_traits>
+
+#include <folly/dynamic.h>
+
+namespace common {
+
+/*
+ * Merges two metric trees such as those of MetricCollector::collectMetrics.
+ * Objects are merged key by key, numbers at the same key are added, so the
+ * metrics of concurrent apps merge into their totals, and anything else keeps
+ * the value of first unless it is null.
+ */
+folly::dynamic mergeMetrics(
+    const folly::dynamic& first,
+    const folly::dynamic& second);
+
+// Index of the shard of the calling thread in the sharded metrics
+std::size_t getMetricShard();
+
+/*
+ * A counter which threads add to without contending with each other. Each
+ * thread adds to one of kShards cache lines, and reading sums them.
+ */
+template <typename T>
+class ShardedCounter {
+ public:
+  static constexpr std::size_t kShards = 16;
+
+  void add(T value) {
+    auto& shard = shards_[getMetricShard()].value;
+    if constexpr (std::is_integral_v<T>) {
+      shard.fetch_add(value, std::memory_order_relaxed);
+    } else {
+      // std::atomic of floating point types has no fetch_add before C++20
+      T current = shard.load(std::memory_order_relaxed);
+      while (!shard.compare_exchange_weak(
+          current, current + value, std::memory_order_relaxed)) {
+      }
+    }
+  }
+
+  T getValue() const {
+    T total = 0;
+    for (const auto& shard : shards_) {
+      total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<T> value{0};
+  };
+  std::array<Shard, kShards> shards_;
+};
+
+// A value which is set rather than added to, such as a number in progress
+class Gauge {
+ public:
+  void set(int64_t value) {
+    value_.store(value, std::memory_order_relaxed);
+  }
+
+  void add(int64_t value) {
+    value_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  int64_t getValue() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64_t> value_{0};
+};
+
+/*
+ * A histogram of non-negative values in buckets of powers of two: bucket i
+ * counts the values below 2^i and not below 2^(i - 1).
+ */
+class Histogram {
+ public:
+  static constexpr std::size_t kBuckets = 64;
+
+  void record(double value);
+
+  int64_t getCount() const {
+    return count_.getValue();
+  }
+
+  double getSum() const {
+    return sum_.getValue();
+  }
+
+  int64_t getBucketCount(std::size_t bucket) const {
+    return buckets_.at(bucket).load(std::memory_order_relaxed);
+  }
+
+  folly::dynamic toDynamic() const;
+
+ private:
+  ShardedCounter<int64_t> count_;
+  ShardedCounter<double> sum_;
+  std::array<std::atomic<int64_t>, kBuckets> buckets_{};
+};
+
+/*
+ * The counters and histograms of a process, shared by all of its apps. Adding
+ * to a metric is lock free once it exists, and apps which add to a metric of
+ * the same name add to its total. Callers on hot paths keep the reference to
+ * the metric they got, as metrics are never removed.
+ */
+class MetricsRegistry {
+ public:
+  static MetricsRegistry& getInstance();
+
+  ShardedCounter<int64_t>& getCounter(const std::string& name);
+  ShardedCounter<double>& getDoubleCounter(const std::string& name);
+  Gauge& getGauge(const std::string& name);
+  Histogram& getHistogram(const std::string& name);
+
+  folly::dynamic toDynamic() const;
+
+  /*
+   * The metrics in the Prometheus text format, named by their names with
+   * every character Prometheus does not allow replaced by _, after prefix.
+   */
+  std::string toPrometheusText(const std::string& prefix) const;
+
+ private:
+  template <typename Metric>
+  Metric& getOrCreate(
+      std::map<std::string, std::unique_ptr<Metric>>& metrics,
+      const std::string& name);
+
+  mutable std::shared_mutex mutex_;
+  std::map<std::string, std::unique_ptr<ShardedCounter<int64_t>>> counters_;
+  std::map<std::string, std::unique_ptr<ShardedCounter<double>>>
+      doubleCounters_;
+  std::map<std::string, std::unique_ptr<Gauge>> gauges_;
+  std::map<std::string, std::unique_ptr<Histogram>> histograms_;
+};
+
+} // namespace common
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "fbpcs/emp_games/common/MetricsServer.h"
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <folly/Format.h>
+#include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+
+#include "fbpcs/emp_games/common/MetricsRegistry.h"
+
+DEFINE_int32(
+    metrics_port,
+    0,
+    "Serve the live metrics of the game, such as the shards finished, rows, "
+    "gates, traffic and running phases, in the Prometheus text format at "
+    "http://<host>:<port>/metrics. 0 serves none");
+
+namespace common {
+
+namespace {
+// How often the server checks whether it is stopped while idle
+constexpr int kPollMilliseconds = 200;
+constexpr std::size_t kMaxRequestBytes = 4096;
+
+std::string makeResponse(
+    const std::string& status,
+    const std::string& contentType,
+    const std::string& body) {
+  return folly::sformat(
+      "HTTP/1.1 {}\r\nContent-Type: {}\r\nContent-Length: {}\r\n"
+      "Connection: close\r\n\r\n{}",
+      status,
+      contentType,
+      body.size(),
+      body);
+}
+} // namespace
+
+std::string getMetricsResponse(const std::string& path) {
+  if (path == "/metrics" || path.rfind("/metrics?", 0) == 0) {
+    return makeResponse(
+        "200 OK",
+        "text/plain; version=0.0.4; charset=utf-8",
+        MetricsRegistry::getInstance().toPrometheusText(kMetricsNamePrefix));
+  }
+  return makeResponse("404 Not Found", "text/plain", "Not found\n");
+}
+
+MetricsServer::MetricsServer(uint16_t port) {
+  socket_ = ::socket(AF_INET6, SOCK_STREAM, 0);
+  if (socket_ < 0) {
+    throw std::runtime_error(folly::sformat(
+        "Failed to open the metrics socket: {}", std::strerror(errno)));
+  }
+  int enable = 1;
+  ::setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  // Accept IPv4 scrapers on the same socket
+  int disable = 0;
+  ::setsockopt(socket_, IPPROTO_IPV6, IPV6_V6ONLY, &disable, sizeof(disable));
+
+  sockaddr_in6 address{};
+  address.sin6_family = AF_INET6;
+  address.sin6_addr = in6addr_any;
+  address.sin6_port = htons(port);
+  socklen_t length = sizeof(address);
+  if (::bind(socket_, reinterpret_cast<sockaddr*>(&address), length) != 0 ||
+      ::listen(socket_, SOMAXCONN) != 0 ||
+      ::getsockname(socket_, reinterpret_cast<sockaddr*>(&address), &length) !=
+          0) {
+    auto error = std::strerror(errno);
+    ::close(socket_);
+    throw std::runtime_error(folly::sformat(
+        "Failed to serve metrics on port {}: {}", port, error));
+  }
+  port_ = ntohs(address.sin6_port);
+  thread_ = std::thread([this]() { serve(); });
+  XLOGF(INFO, "Serving metrics at http://localhost:{}/metrics", port_);
+}
+
+MetricsServer::~MetricsServer() {
+  stopped_ = true;
+  thread_.join();
+  ::close(socket_);
+}
+
+std::unique_ptr<MetricsServer> MetricsServer::startFromFlags() {
+  if (FLAGS_metrics_port == 0) {
+    return nullptr;
+  }
+  try {
+    return std::make_unique<MetricsServer>(
+        static_cast<uint16_t>(FLAGS_metrics_port));
+  } catch (const std::exception& e) {
+    XLOGF(WARN, "Not serving metrics: {}", e.what());
+    return nullptr;
+  }
+}
+
+void MetricsServer::serve() {
+  while (!stopped_) {
+    pollfd listening{socket_, POLLIN, 0};
+    if (::poll(&listening, 1, kPollMilliseconds) <= 0) {
+      continue;
+    }
+    int connection = ::accept(socket_, nullptr, nullptr);
+    if (connection < 0) {
+      continue;
+    }
+    try {
+      respond(connection);
+    } catch (const std::exception& e) {
+      XLOGF(WARN, "Failed to serve a metrics request: {}", e.what());
+    }
+    ::close(connection);
+  }
+}
+
+void MetricsServer::respond(int connection) {
+  // Only the request line matters, which is in the first read of a scrape
+  pollfd readable{connection, POLLIN, 0};
+  if (::poll(&readable, 1, kPollMilliseconds) <= 0) {
+    return;
+  }
+  std::string request(kMaxRequestBytes, '\0');
+  auto received = ::recv(connection, request.data(), request.size(), 0);
+  if (received <= 0) {
+    return;
+  }
+  request.resize(received);
+
+  // GET <path> HTTP/1.1
+  auto pathStart = request.find(' ');
+  auto pathEnd = request.find(' ', pathStart + 1);
+  std::string path;
+  if (pathStart != std::string::npos && pathEnd != std::string::npos) {
+    path = request.substr(pathStart + 1, pathEnd - pathStart - 1);
+  }
+  auto response = getMetricsResponse(path);
+
+  std::size_t sent = 0;
+  while (sent < response.size()) {
+    auto bytes = ::send(
+        connection,
+        response.data() + sent,
+        response.size() - sent,
+        MSG_NOSIGNAL);
+    if (bytes <= 0) {
+      return;
+    }
+    sent += bytes;
+  }
+}
+
+} // namespace common
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <gflags/gflags_declare.h>
+
+DECLARE_int32(metrics_port);
+
+namespace common {
+
+// The prefix of the names of the metrics served
+inline const std::string kMetricsNamePrefix = "pcf2_";
+
+/*
+ * The response to an HTTP request for path: the metrics of the
+ * MetricsRegistry in the Prometheus text format for /metrics, and a 404
+ * otherwise.
+ */
+std::string getMetricsResponse(const std::string& path);
+
+/*
+ * Serves the metrics of the MetricsRegistry over HTTP at /metrics while it
+ * lives, so the progress of a long game can be scraped while it runs. Requests
+ * are answered one at a time on a thread of their own, away from the apps.
+ */
+class MetricsServer {
+ public:
+  // Port 0 picks a free port
+  explicit MetricsServer(uint16_t port);
+  ~MetricsServer();
+
+  MetricsServer(const MetricsServer&) = delete;
+  MetricsServer& operator=(const MetricsServer&) = delete;
+
+  uint16_t getPort() const {
+    return port_;
+  }
+
+  /*
+   * A server on --metrics_port, or nullptr if it is 0. Failing to listen does
+   * not fail the game, which only logs it.
+   */
+  static std::unique_ptr<MetricsServer> startFromFlags();
+
+ private:
+  void serve();
+  void respond(int connection);
+
+  int socket_;
+  uint16_t port_;
+  std::atomic<bool> stopped_{false};
+  std::thread thread_;
+};
+
+} // namespace common
@@ -0,0 +1,385 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <folly/Format.h>
+#include <folly/logging/xlog.h>
+
+#include "fbpcf/engine/communication/IPartyCommunicationAgent.h"
+#include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
+#include "fbpcf/engine/communication/SocketPartyCommunicationAgentFactory.h"
+#include "fbpcf/util/MetricCollector.h"
+
+namespace common {
+
+/*
+ * Carries any number of logical streams between two parties over two
+ * connections, each only sent on by one party, so that no connection is read
+ * and written by two threads at once. Data is sent in frames tagged with their
+ * stream, and a thread reads the frames of the other party into the buffers of
+ * their streams. Each stream may have at most a window of bytes in flight: the
+ * receiver grants more as its reads consume them, so a stream that is not read
+ * holds back only its own sender.
+ */
+class MultiplexedConnection {
+ public:
+  static constexpr uint32_t kDefaultWindow = 1 << 24;
+  static constexpr uint32_t kMaxFrameSize = 1 << 20;
+
+  MultiplexedConnection(
+      std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+          sendAgent,
+      std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+          receiveAgent,
+      int peerId,
+      uint32_t window = kDefaultWindow)
+      : sendAgent_{std::move(sendAgent)},
+        receiveAgent_{std::move(receiveAgent)},
+        peerId_{peerId},
+        window_{window} {
+    if (window_ < kMaxFrameSize) {
+      throw std::invalid_argument(folly::sformat(
+          "The window of a stream must be at least {} bytes, got {}",
+          kMaxFrameSize,
+          window_));
+    }
+    reader_ = std::thread{[this]() { readFrames(); }};
+  }
+
+  /*
+   * The connection of party myId to peerId over two agents of factory, which
+   * is kept for as long as the connection. Both parties must create it at the
+   * same point of their use of their factories.
+   */
+  static std::shared_ptr<MultiplexedConnection> create(
+      int myId,
+      int peerId,
+      std::unique_ptr<
+          fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+          factory,
+      uint32_t window = kDefaultWindow) {
+    auto lowerToHigher = factory->create(peerId, "multiplexed_lower_to_higher");
+    auto higherToLower = factory->create(peerId, "multiplexed_higher_to_lower");
+    auto& sendAgent = myId < peerId ? lowerToHigher : higherToLower;
+    auto& receiveAgent = myId < peerId ? higherToLower : lowerToHigher;
+    auto connection = std::make_shared<MultiplexedConnection>(
+        std::move(sendAgent), std::move(receiveAgent), peerId, window);
+    connection->factory_ = std::move(factory);
+    return connection;
+  }
+
+  MultiplexedConnection(const MultiplexedConnection&) = delete;
+  MultiplexedConnection& operator=(const MultiplexedConnection&) = delete;
+
+  // Tells the other party that no more frames are sent, and waits for it to
+  // do the same
+  ~MultiplexedConnection() {
+    try {
+      std::lock_guard<std::mutex> sendLock{sendMutex_};
+      sendFrame(FrameType::Close, 0, nullptr, 0);
+    } catch (const std::exception& e) {
+      XLOG(ERR) << "Failed to close a multiplexed connection: " << e.what();
+    }
+    reader_.join();
+  }
+
+  int getPeerId() const {
+    return peerId_;
+  }
+
+  void send(uint32_t stream, const unsigned char* data, size_t size) {
+    size_t sent = 0;
+    while (sent < size) {
+      uint32_t frameSize;
+      {
+        std::unique_lock<std::mutex> lock{mutex_};
+        auto& state = streamLocked(stream);
+        changed_.wait(lock, [&]() { return state.credit > 0 || closed_; });
+        if (state.credit == 0) {
+          throw std::runtime_error(folly::sformat(
+              "Multiplexed connection closed while sending on stream {}",
+              stream));
+        }
+        frameSize = static_cast<uint32_t>(std::min<size_t>(
+            {size - sent, state.credit, static_cast<size_t>(kMaxFrameSize)}));
+        state.credit -= frameSize;
+      }
+      std::lock_guard<std::mutex> sendLock{sendMutex_};
+      sendFrame(FrameType::Data, stream, data + sent, frameSize);
+      sent += frameSize;
+    }
+  }
+
+  void receive(uint32_t stream, unsigned char* data, size_t size) {
+    std::unique_lock<std::mutex> lock{mutex_};
+    auto& state = streamLocked(stream);
+    size_t received = 0;
+    while (received < size) {
+      changed_.wait(lock, [&]() { return state.buffered > 0 || closed_; });
+      if (state.buffered == 0) {
+        throw std::runtime_error(folly::sformat(
+            "Multiplexed connection closed while receiving on stream {}",
+            stream));
+      }
+      auto& chunk = state.chunks.front();
+      auto count = std::min(size - received, chunk.size() - state.offset);
+      std::memcpy(data + received, chunk.data() + state.offset, count);
+      received += count;
+      state.offset += count;
+      state.buffered -= count;
+      state.consumed += count;
+      if (state.offset == chunk.size()) {
+        state.chunks.pop_front();
+        state.offset = 0;
+      }
+
+      // Grants the consumed bytes back in batches, and before waiting on
+      // more data, which the sender may be holding for them
+      if (state.consumed >= window_ / 4 ||
+          (state.buffered == 0 && received < size)) {
+        auto credit = static_cast<uint32_t>(state.consumed);
+        state.consumed = 0;
+        lock.unlock();
+        {
+          std::lock_guard<std::mutex> sendLock{sendMutex_};
+          sendFrame(FrameType::Credit, stream, nullptr, credit);
+        }
+        lock.lock();
+      }
+    }
+  }
+
+ private:
+  enum class FrameType : uint8_t { Data, Credit, Close };
+
+  // The type of a frame, its stream, and its size for data, or the bytes
+  // granted for credit
+  static constexpr size_t kHeaderSize = 1 + 2 * sizeof(uint32_t);
+
+  struct Stream {
+    std::deque<std::vector<unsigned char>> chunks;
+    size_t offset = 0;
+    size_t buffered = 0;
+    size_t consumed = 0;
+    size_t credit = 0;
+  };
+
+  Stream& streamLocked(uint32_t stream) {
+    auto [it, inserted] = streams_.try_emplace(stream);
+    if (inserted) {
+      it->second.credit = window_;
+    }
+    return it->second;
+  }
+
+  void sendFrame(
+      FrameType type,
+      uint32_t stream,
+      const unsigned char* data,
+      uint32_t size) {
+    std::vector<unsigned char> frame(
+        kHeaderSize + (type == FrameType::Data ? size : 0));
+    frame[0] = static_cast<unsigned char>(type);
+    std::memcpy(frame.data() + 1, &stream, sizeof(uint32_t));
+    std::memcpy(frame.data() + 1 + sizeof(uint32_t), &size, sizeof(uint32_t));
+    if (type == FrameType::Data) {
+      std::memcpy(frame.data() + kHeaderSize, data, size);
+    }
+    sendAgent_->send(frame);
+  }
+
+  void readFrames() {
+    try {
+      while (true) {
+        auto header = receiveAgent_->receive(kHeaderSize);
+        auto type = static_cast<FrameType>(header[0]);
+        uint32_t stream;
+        uint32_t size;
+        std::memcpy(&stream, header.data() + 1, sizeof(uint32_t));
+        std::memcpy(
+            &size, header.data() + 1 + sizeof(uint32_t), sizeof(uint32_t));
+        if (type == FrameType::Close) {
+          break;
+        }
+        std::vector<unsigned char> payload;
+        if (type == FrameType::Data) {
+          payload = receiveAgent_->receive(size);
+        }
+        std::lock_guard<std::mutex> lock{mutex_};
+        auto& state = streamLocked(stream);
+        if (type == FrameType::Credit) {
+          state.credit += size;
+        } else {
+          state.buffered += payload.size();
+          state.chunks.push_back(std::move(payload));
+        }
+        changed_.notify_all();
+      }
+    } catch (const std::exception& e) {
+      XLOG(ERR) << "Multiplexed connection failed: " << e.what();
+    }
+    std::lock_guard<std::mutex> lock{mutex_};
+    closed_ = true;
+    changed_.notify_all();
+  }
+
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+      factory_;
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+      sendAgent_;
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+      receiveAgent_;
+  int peerId_;
+  uint32_t window_;
+
+  std::mutex sendMutex_;
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::unordered_map<uint32_t, Stream> streams_;
+  bool closed_ = false;
+  std::thread reader_;
+};
+
+// An agent sending and receiving on one stream of a multiplexed connection
+class MultiplexedAgent
+    : public fbpcf::engine::communication::IPartyCommunicationAgent {
+ public:
+  MultiplexedAgent(
+      std::shared_ptr<MultiplexedConnection> connection,
+      uint32_t stream)
+      : connection_{std::move(connection)}, stream_{stream} {}
+
+  void send(const std::vector<unsigned char>& data) override {
+    connection_->send(stream_, data.data(), data.size());
+    sentData_ += data.size();
+  }
+
+  std::vector<unsigned char> receive(size_t size) override {
+    std::vector<unsigned char> data(size);
+    connection_->receive(stream_, data.data(), size);
+    receivedData_ += size;
+    return data;
+  }
+
+  std::pair<uint64_t, uint64_t> getTrafficStatistics() const override {
+    return {sentData_, receivedData_};
+  }
+
+ protected:
+  void sendImpl(const void* data, int nBytes) override {
+    connection_->send(
+        stream_, static_cast<const unsigned char*>(data), nBytes);
+    sentData_ += nBytes;
+  }
+
+  void recvImpl(void* data, int nBytes) override {
+    connection_->receive(stream_, static_cast<unsigned char*>(data), nBytes);
+    receivedData_ += nBytes;
+  }
+
+ private:
+  std::shared_ptr<MultiplexedConnection> connection_;
+  uint32_t stream_;
+  uint64_t sentData_ = 0;
+  uint64_t receivedData_ = 0;
+};
+
+/*
+ * Creates the agents of one lane, such as one of the apps of a party running
+ * concurrently, as streams of a connection shared by every lane. Both parties
+ * create the agents of a lane in the same order, which identifies the stream
+ * of each agent, so lanes need distinct indices rather than distinct ports.
+ */
+class MultiplexedAgentFactory
+    : public fbpcf::engine::communication::IPartyCommunicationAgentFactory {
+ public:
+  static constexpr uint32_t kMaxAgentsPerLane = 1 << 16;
+
+  MultiplexedAgentFactory(
+      std::shared_ptr<MultiplexedConnection> connection,
+      uint32_t lane,
+      std::shared_ptr<fbpcf::util::MetricCollector> metricCollector)
+      : fbpcf::engine::communication::IPartyCommunicationAgentFactory(
+            "multiplexed_traffic",
+            metricCollector),
+        connection_{std::move(connection)},
+        lane_{lane} {
+    if (lane_ >= kMaxAgentsPerLane) {
+      throw std::invalid_argument(folly::sformat(
+          "A multiplexed connection has lanes 0 to {}, got {}",
+          kMaxAgentsPerLane - 1,
+          lane_));
+    }
+  }
+
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+  create(int id, std::string /* name */) override {
+    if (id != connection_->getPeerId()) {
+      throw std::invalid_argument(folly::sformat(
+          "The multiplexed connection is to party {}, not {}",
+          connection_->getPeerId(),
+          id));
+    }
+    if (nextAgent_ == kMaxAgentsPerLane) {
+      throw std::runtime_error(folly::sformat(
+          "Lane {} has created {} agents already", lane_, kMaxAgentsPerLane));
+    }
+    return std::make_unique<MultiplexedAgent>(
+        connection_, lane_ * kMaxAgentsPerLane + nextAgent_++);
+  }
+
+ private:
+  std::shared_ptr<MultiplexedConnection> connection_;
+  uint32_t lane_;
+  uint32_t nextAgent_ = 0;
+};
+
+/*
+ * The multiplexed connection of party to the other one of a two party game,
+ * over sockets to serverIp on port. The apps of every lane of the party then
+ * share its connections rather than each connecting on a port of its own.
+ */
+inline std::shared_ptr<MultiplexedConnection> connectMultiplexed(
+    int party,
+    const std::string& serverIp,
+    int port,
+    const fbpcf::engine::communication::SocketPartyCommunicationAgent::TlsInfo&
+        tlsInfo,
+    const std::string& metricsName) {
+  std::map<
+      int,
+      fbpcf::engine::communication::SocketPartyCommunicationAgentFactory::
+          PartyInfo>
+      partyInfos({{0, {serverIp, port}}, {1, {serverIp, port}}});
+  return MultiplexedConnection::create(
+      party,
+      1 - party,
+      std::make_unique<
+          fbpcf::engine::communication::SocketPartyCommunicationAgentFactory>(
+          party,
+          partyInfos,
+          tlsInfo,
+          std::make_shared<fbpcf::util::MetricCollector>(metricsName)));
+}
+
+} // namespace common
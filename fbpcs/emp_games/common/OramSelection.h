@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
+#include "fbpcf/mpc_std_lib/oram/IWriteOnlyOramFactory.h"
+#include "fbpcf/mpc_std_lib/oram/LinearOramFactory.h"
+#include "fbpcf/mpc_std_lib/oram/WriteOnlyOramFactory.h"
+
+namespace common {
+
+/*
+ * The linear ORAM adds every row to every slot, so its cost per row grows with
+ * the ORAM size times the width of the values, while the cost per row of the
+ * write-only ORAM grows with the width of the values only once. The linear
+ * ORAM is used up to the largest ORAM size it is cheaper for, which is kept
+ * separately for the values of up to kNarrowOramValueWidth bits and the wider
+ * ones, as the crossover moves with the width of the values.
+ */
+constexpr std::size_t kNarrowOramValueWidth = 32;
+constexpr std::size_t kMaxLinearOramSizeForNarrowValues = 4;
+constexpr std::size_t kMaxLinearOramSizeForWideValues = 4;
+
+// Whether an ORAM of oramSize slots of valueWidth bits should be linear
+inline bool useLinearOram(std::size_t oramSize, std::size_t valueWidth) {
+  return oramSize <= (valueWidth <= kNarrowOramValueWidth
+                          ? kMaxLinearOramSizeForNarrowValues
+                          : kMaxLinearOramSizeForWideValues);
+}
+
+// The secure ORAM factory for an ORAM of oramSize slots of valueWidth bits,
+// linear or write-only according to useLinearOram. Both parties have to pass
+// the same sizes, so that they create the same kind of ORAM.
+template <typename T, int8_t indicatorSumWidth, int schedulerId>
+std::unique_ptr<fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<T>>
+getSecureOramFactory(
+    bool isPublisher,
+    std::size_t oramSize,
+    std::size_t valueWidth,
+    fbpcf::engine::communication::IPartyCommunicationAgentFactory&
+        communicationAgentFactory) {
+  if (useLinearOram(oramSize, valueWidth)) {
+    return fbpcf::mpc_std_lib::oram::
+        getSecureLinearOramFactory<T, schedulerId>(
+            isPublisher, 0, 1, communicationAgentFactory);
+  }
+  return fbpcf::mpc_std_lib::oram::
+      getSecureWriteOnlyOramFactory<T, indicatorSumWidth, schedulerId>(
+          isPublisher, 0, 1, communicationAgentFactory);
+}
+
+} // namespace common
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <utility>
+
+#include "fbpcf/mpc_std_lib/oram/IWriteOnlyOram.h"
+#include "fbpcf/mpc_std_lib/oram/IWriteOnlyOramFactory.h"
+
+/*
+Creating an ORAM sets up the protocols under it, such as their base OTs, over
+agents of its own. A game can start creating the ORAMs it aggregates with
+before their inputs are computed, so that this setup overlaps the computation
+of the inputs instead of waiting for it.
+
+Both parties have to create the agents of their ORAMs in the same order. An
+OramPrewarmer therefore creates the ORAMs of all of its factories one at a
+time, in the order they were asked for, on a thread of its own. The ORAMs which
+weren't created ahead are created in turn on the same thread, after the ones
+which were.
+*/
+namespace common {
+
+class OramPrewarmer {
+ public:
+  OramPrewarmer() = default;
+  OramPrewarmer(const OramPrewarmer&) = delete;
+  OramPrewarmer& operator=(const OramPrewarmer&) = delete;
+
+  ~OramPrewarmer() {
+    if (last_.valid()) {
+      last_.wait();
+    }
+  }
+
+  // Runs task once every task passed before it has run
+  std::shared_future<void> run(std::function<void()> task) {
+    last_ = std::async(
+                std::launch::async,
+                [previous = last_, task = std::move(task)]() {
+                  if (previous.valid()) {
+                    previous.get();
+                  }
+                  task();
+                })
+                .share();
+    return last_;
+  }
+
+ private:
+  std::shared_future<void> last_;
+};
+
+template <typename T>
+class PrewarmedOramFactory
+    : public fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<T> {
+ public:
+  // Starts creating numPrewarmed ORAMs of oramSize slots with factory. The
+  // prewarmer has to outlive this factory.
+  PrewarmedOramFactory(
+      std::unique_ptr<fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<T>>
+          factory,
+      std::size_t oramSize,
+      std::size_t numPrewarmed,
+      OramPrewarmer& prewarmer)
+      : factory_{std::move(factory)},
+        oramSize_{oramSize},
+        prewarmer_{prewarmer} {
+    for (std::size_t i = 0; i < numPrewarmed; ++i) {
+      prewarmed_.push_back(createInBackground(oramSize));
+    }
+  }
+
+  // The ORAMs still being created refer to this factory
+  ~PrewarmedOramFactory() override {
+    for (auto& oram : prewarmed_) {
+      oram.wait();
+    }
+  }
+
+  std::unique_ptr<fbpcf::mpc_std_lib::oram::IWriteOnlyOram<T>> create(
+      size_t size) override {
+    if (size == oramSize_ && !prewarmed_.empty()) {
+      auto oram = std::move(prewarmed_.front());
+      prewarmed_.pop_front();
+      return oram.get();
+    }
+    return createInBackground(size).get();
+  }
+
+  uint32_t getMaxBatchSize(size_t size, int8_t concurrency) override {
+    return factory_->getMaxBatchSize(size, concurrency);
+  }
+
+ private:
+  std::future<std::unique_ptr<fbpcf::mpc_std_lib::oram::IWriteOnlyOram<T>>>
+  createInBackground(std::size_t size) {
+    auto promise = std::make_shared<std::promise<
+        std::unique_ptr<fbpcf::mpc_std_lib::oram::IWriteOnlyOram<T>>>>();
+    auto oram = promise->get_future();
+    prewarmer_.run([this, promise, size]() {
+      try {
+        promise->set_value(factory_->create(size));
+      } catch (...) {
+        promise->set_exception(std::current_exception());
+      }
+    });
+    return oram;
+  }
+
+  std::unique_ptr<fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<T>>
+      factory_;
+  std::size_t oramSize_;
+  OramPrewarmer& prewarmer_;
+  std::deque<std::future<
+      std::unique_ptr<fbpcf::mpc_std_lib::oram::IWriteOnlyOram<T>>>>
+      prewarmed_;
+};
+
+} // namespace common
@@ -0,0 +1,520 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*
+A binary row group format for handing typed data from the data_processing
+stages to the games, so that the rows don't have to be formatted as text by one
+stage and tokenized and parsed again by the next one. It only depends on the
+standard library and is header only, so both the data_processing binaries and
+the games can include it.
+
+All integers are written in the byte order of the host, which is little endian
+on every platform we run on. A file is laid out as:
+
+  magic        8 bytes, kMagic
+  numColumns   uint32
+  per column:
+    type       uint8, a ColumnType
+    arrayWidth uint32, the number of values of every cell of an array column
+    nameSize   uint32, followed by the name
+  row groups, each one:
+    numRows    uint32, 0 for the empty row group ending the file
+    per column, in schema order:
+      kInt64       numRows int64 values
+      kInt64Array  numRows * arrayWidth int64 values
+      kString      numRows uint32 sizes, followed by the bytes of every cell
+
+Columns are typed from the header and the first row, the same way the games
+read csv files: `id_` prefixed columns are strings, `[...]` cells are arrays of
+integers and everything else is an integer. The combiners pad every array
+column to max_num_touchpoints, max_num_conversions or multi_conversion_limit
+values, so the arrays of a column all have the width of the first row.
+*/
+namespace private_measurement::row_group {
+
+constexpr std::string_view kMagic{"PCSRGRP1", 8};
+constexpr uint32_t kDefaultRowsPerGroup = 1 << 16;
+constexpr std::string_view kIdColumnPrefix{"id_"};
+
+enum class ColumnType : uint8_t { kInt64 = 0, kInt64Array = 1, kString = 2 };
+
+struct Column {
+  std::string name;
+  ColumnType type = ColumnType::kInt64;
+  uint32_t arrayWidth = 0;
+
+  bool operator==(const Column& other) const {
+    return name == other.name && type == other.type &&
+        arrayWidth == other.arrayWidth;
+  }
+};
+
+using Schema = std::vector<Column>;
+
+// The cells of one column of a row group. Integer and array columns only use
+// values, string columns only use strings and stringEnds.
+struct ColumnData {
+  std::vector<int64_t> values;
+  std::string strings;
+  std::vector<uint32_t> stringEnds;
+
+  void clear() {
+    values.clear();
+    strings.clear();
+    stringEnds.clear();
+  }
+};
+
+struct RowGroup {
+  uint32_t numRows = 0;
+  std::vector<ColumnData> columns;
+
+  int64_t getInt64(std::size_t column, std::size_t row) const {
+    return columns[column].values[row];
+  }
+
+  // The arrayWidth values of an array cell
+  const int64_t*
+  getArray(const Schema& schema, std::size_t column, std::size_t row) const {
+    return columns[column].values.data() + row * schema[column].arrayWidth;
+  }
+
+  std::string_view getString(std::size_t column, std::size_t row) const {
+    auto& data = columns[column];
+    auto start = row == 0 ? 0 : data.stringEnds[row - 1];
+    return std::string_view{data.strings}.substr(
+        start, data.stringEnds[row] - start);
+  }
+};
+
+// Whether the first bytes of a file are the magic of the row group format
+inline bool hasMagic(std::string_view prefix) {
+  return prefix.substr(0, kMagic.size()) == kMagic;
+}
+
+// Splits a csv line into views of its cells, taking a `[...]` array as a
+// single cell
+inline void splitCsvLine(
+    std::string_view line,
+    std::vector<std::string_view>& cells) {
+  cells.clear();
+  std::size_t start = 0;
+  bool inArray = false;
+  for (std::size_t i = 0; i < line.size(); ++i) {
+    if (line[i] == '[') {
+      inArray = true;
+    } else if (line[i] == ']') {
+      inArray = false;
+    } else if (line[i] == ',' && !inArray) {
+      cells.push_back(line.substr(start, i - start));
+      start = i + 1;
+    }
+  }
+  cells.push_back(line.substr(start));
+}
+
+namespace detail {
+inline bool parseInt64(std::string_view cell, int64_t& value) {
+  value = 0;
+  if (cell.empty()) {
+    return true;
+  }
+  auto end = cell.data() + cell.size();
+  auto [ptr, ec] = std::from_chars(cell.data(), end, value);
+  return ec == std::errc{} && ptr == end;
+}
+
+// Parses the values of an array cell such as `[1,2,3]`, returning false if it
+// isn't an array of integers
+inline bool parseArray(std::string_view cell, std::vector<int64_t>& values) {
+  values.clear();
+  if (cell.size() < 2 || cell.front() != '[' || cell.back() != ']') {
+    return false;
+  }
+  auto inner = cell.substr(1, cell.size() - 2);
+  if (inner.empty()) {
+    return true;
+  }
+  std::size_t start = 0;
+  while (true) {
+    auto end = std::min(inner.find(',', start), inner.size());
+    int64_t value;
+    if (end == start || !parseInt64(inner.substr(start, end - start), value)) {
+      return false;
+    }
+    values.push_back(value);
+    if (end == inner.size()) {
+      return true;
+    }
+    start = end + 1;
+  }
+}
+
+inline void appendUint32(std::string& out, uint32_t value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void appendInt64s(std::string& out, const std::vector<int64_t>& values) {
+  out.append(
+      reinterpret_cast<const char*>(values.data()),
+      values.size() * sizeof(int64_t));
+}
+} // namespace detail
+
+// Types the columns of a header from its first row, as described above
+inline Schema inferSchema(
+    const std::vector<std::string>& header,
+    const std::vector<std::string_view>& firstRow) {
+  Schema schema;
+  std::vector<int64_t> values;
+  for (std::size_t i = 0; i < header.size(); ++i) {
+    Column column{header[i]};
+    std::string_view cell = i < firstRow.size() ? firstRow[i] : "";
+    int64_t value;
+    if (header[i].compare(0, kIdColumnPrefix.size(), kIdColumnPrefix) == 0) {
+      column.type = ColumnType::kString;
+    } else if (!cell.empty() && cell.front() == '[') {
+      if (!detail::parseArray(cell, values)) {
+        throw std::invalid_argument(
+            "Column " + header[i] + " is not an array of integers: " +
+            std::string{cell});
+      }
+      column.type = ColumnType::kInt64Array;
+      column.arrayWidth = values.size();
+    } else if (!detail::parseInt64(cell, value)) {
+      column.type = ColumnType::kString;
+    }
+    schema.push_back(std::move(column));
+  }
+  return schema;
+}
+
+// Formats a cell back to its csv text, e.g. for readers which only take csv
+inline void appendCsvCell(
+    const Schema& schema,
+    const RowGroup& group,
+    std::size_t column,
+    std::size_t row,
+    std::string& out) {
+  char buffer[24];
+  auto appendInt64 = [&](int64_t value) {
+    auto [ptr, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, ptr);
+  };
+  switch (schema[column].type) {
+    case ColumnType::kInt64:
+      appendInt64(group.getInt64(column, row));
+      break;
+    case ColumnType::kInt64Array: {
+      auto values = group.getArray(schema, column, row);
+      out += '[';
+      for (uint32_t i = 0; i < schema[column].arrayWidth; ++i) {
+        if (i > 0) {
+          out += ',';
+        }
+        appendInt64(values[i]);
+      }
+      out += ']';
+      break;
+    }
+    case ColumnType::kString:
+      out += group.getString(column, row);
+      break;
+  }
+}
+
+/*
+Encodes csv rows in the row group format. The schema is inferred from the first
+row, and the encoded bytes are handed to sink a row group at a time. close
+must be called once all the rows were added.
+*/
+class RowGroupWriter {
+ public:
+  using Sink = std::function<void(std::string&)>;
+
+  RowGroupWriter(
+      std::vector<std::string> header,
+      Sink sink,
+      uint32_t rowsPerGroup = kDefaultRowsPerGroup)
+      : header_{std::move(header)},
+        sink_{std::move(sink)},
+        rowsPerGroup_{std::max<uint32_t>(rowsPerGroup, 1)} {}
+
+  // Adds a row given as one view per cell. Throws std::invalid_argument if the
+  // row doesn't match the schema.
+  void addRow(const std::vector<std::string_view>& cells) {
+    if (!schemaWritten_) {
+      writeSchema(inferSchema(header_, cells));
+    }
+    if (cells.size() != schema_.size()) {
+      throw std::invalid_argument(
+          "Row has " + std::to_string(cells.size()) + " columns, expected " +
+          std::to_string(schema_.size()));
+    }
+    for (std::size_t i = 0; i < cells.size(); ++i) {
+      addCell(i, cells[i]);
+    }
+    if (++group_.numRows == rowsPerGroup_) {
+      flush();
+    }
+  }
+
+  // Adds a row given as a csv line without spaces
+  void addCsvLine(std::string_view line) {
+    splitCsvLine(line, cells_);
+    addRow(cells_);
+  }
+
+  // Writes the last row group and the end of the file. A file without rows
+  // types every column from the header alone.
+  void close() {
+    if (!schemaWritten_) {
+      writeSchema(inferSchema(header_, {}));
+    }
+    flush();
+    std::string end;
+    detail::appendUint32(end, 0);
+    sink_(end);
+  }
+
+  const Schema& getSchema() const {
+    return schema_;
+  }
+
+ private:
+  void writeSchema(Schema schema) {
+    schema_ = std::move(schema);
+    group_.columns.resize(schema_.size());
+    std::string out{kMagic};
+    detail::appendUint32(out, schema_.size());
+    for (auto& column : schema_) {
+      out += static_cast<char>(column.type);
+      detail::appendUint32(out, column.arrayWidth);
+      detail::appendUint32(out, column.name.size());
+      out += column.name;
+    }
+    sink_(out);
+    schemaWritten_ = true;
+  }
+
+  void addCell(std::size_t i, std::string_view cell) {
+    auto& column = schema_[i];
+    auto& data = group_.columns[i];
+    int64_t value;
+    switch (column.type) {
+      case ColumnType::kInt64:
+        if (!detail::parseInt64(cell, value)) {
+          throw std::invalid_argument(
+              "Column " + column.name + " is not an integer: " +
+              std::string{cell});
+        }
+        data.values.push_back(value);
+        break;
+      case ColumnType::kInt64Array:
+        if (!detail::parseArray(cell, arrayValues_) ||
+            arrayValues_.size() != column.arrayWidth) {
+          throw std::invalid_argument(
+              "Column " + column.name + " is not an array of " +
+              std::to_string(column.arrayWidth) +
+              " integers: " + std::string{cell});
+        }
+        data.values.insert(
+            data.values.end(), arrayValues_.begin(), arrayValues_.end());
+        break;
+      case ColumnType::kString:
+        data.strings += cell;
+        data.stringEnds.push_back(data.strings.size());
+        break;
+    }
+  }
+
+  void flush() {
+    if (group_.numRows == 0) {
+      return;
+    }
+    std::string out;
+    detail::appendUint32(out, group_.numRows);
+    for (std::size_t i = 0; i < schema_.size(); ++i) {
+      auto& data = group_.columns[i];
+      if (schema_[i].type == ColumnType::kString) {
+        uint32_t start = 0;
+        for (auto end : data.stringEnds) {
+          detail::appendUint32(out, end - start);
+          start = end;
+        }
+        out += data.strings;
+      } else {
+        detail::appendInt64s(out, data.values);
+      }
+      data.clear();
+    }
+    group_.numRows = 0;
+    sink_(out);
+  }
+
+  std::vector<std::string> header_;
+  Sink sink_;
+  uint32_t rowsPerGroup_;
+  Schema schema_;
+  bool schemaWritten_ = false;
+  RowGroup group_;
+  std::vector<std::string_view> cells_;
+  std::vector<int64_t> arrayValues_;
+};
+
+/*
+Decodes a file in the row group format. source fills the given buffer with up
+to the given number of bytes and returns how many it read, which is 0 only at
+the end of the input. Throws std::runtime_error on a malformed file.
+*/
+class RowGroupReader {
+ public:
+  using Source = std::function<std::size_t(char* data, std::size_t size)>;
+
+  explicit RowGroupReader(Source source) : source_{std::move(source)} {
+    std::string magic(kMagic.size(), '\0');
+    readExactly(magic.data(), magic.size());
+    if (!hasMagic(magic)) {
+      throw std::runtime_error("Input is not in the row group format");
+    }
+    auto numColumns = readUint32();
+    for (uint32_t i = 0; i < numColumns; ++i) {
+      Column column;
+      uint8_t type;
+      readExactly(reinterpret_cast<char*>(&type), sizeof(type));
+      if (type > static_cast<uint8_t>(ColumnType::kString)) {
+        throw std::runtime_error(
+            "Unknown row group column type " + std::to_string(type));
+      }
+      column.type = static_cast<ColumnType>(type);
+      column.arrayWidth = readUint32();
+      column.name.resize(readUint32());
+      readExactly(column.name.data(), column.name.size());
+      schema_.push_back(std::move(column));
+    }
+  }
+
+  const Schema& getSchema() const {
+    return schema_;
+  }
+
+  std::vector<std::string> getHeader() const {
+    std::vector<std::string> header;
+    for (auto& column : schema_) {
+      header.push_back(column.name);
+    }
+    return header;
+  }
+
+  // Reads the next row group into group, reusing its storage. Returns false
+  // once the end of the file is reached.
+  bool next(RowGroup& group) {
+    if (done_) {
+      return false;
+    }
+    group.numRows = readUint32();
+    if (group.numRows == 0) {
+      done_ = true;
+      return false;
+    }
+    group.columns.resize(schema_.size());
+    for (std::size_t i = 0; i < schema_.size(); ++i) {
+      auto& data = group.columns[i];
+      data.clear();
+      if (schema_[i].type == ColumnType::kString) {
+        data.stringEnds.resize(group.numRows);
+        readExactly(
+            reinterpret_cast<char*>(data.stringEnds.data()),
+            group.numRows * sizeof(uint32_t));
+        uint32_t end = 0;
+        for (auto& size : data.stringEnds) {
+          end += size;
+          size = end;
+        }
+        data.strings.resize(end);
+        readExactly(data.strings.data(), end);
+      } else {
+        std::size_t width = schema_[i].type == ColumnType::kInt64Array
+            ? schema_[i].arrayWidth
+            : 1;
+        data.values.resize(group.numRows * width);
+        readExactly(
+            reinterpret_cast<char*>(data.values.data()),
+            data.values.size() * sizeof(int64_t));
+      }
+    }
+    return true;
+  }
+
+ private:
+  void readExactly(char* data, std::size_t size) {
+    while (size > 0) {
+      auto read = source_(data, size);
+      if (read == 0) {
+        throw std::runtime_error("Row group input ended unexpectedly");
+      }
+      data += read;
+      size -= read;
+    }
+  }
+
+  uint32_t readUint32() {
+    uint32_t value;
+    readExactly(reinterpret_cast<char*>(&value), sizeof(value));
+    return value;
+  }
+
+  Source source_;
+  Schema schema_;
+  bool done_ = false;
+};
+
+// Returns a RowGroupReader::Source reading from a stream
+inline RowGroupReader::Source streamSource(std::istream& in) {
+  return [&in](char* data, std::size_t size) {
+    in.read(data, size);
+    return static_cast<std::size_t>(in.gcount());
+  };
+}
+
+// Converts a csv without spaces, such as the output of the combiners, to the
+// row group format
+inline void convertCsv(
+    std::istream& in,
+    std::ostream& out,
+    uint32_t rowsPerGroup = kDefaultRowsPerGroup) {
+  std::string line;
+  std::getline(in, line);
+  std::vector<std::string_view> cells;
+  splitCsvLine(line, cells);
+  RowGroupWriter writer{
+      std::vector<std::string>(cells.begin(), cells.end()),
+      [&out](std::string& bytes) { out.write(bytes.data(), bytes.size()); },
+      rowsPerGroup};
+  while (std::getline(in, line)) {
+    if (!line.empty()) {
+      writer.addCsvLine(line);
+    }
+  }
+  writer.close();
+}
+} // namespace private_measurement::row_group
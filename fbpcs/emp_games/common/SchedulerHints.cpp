@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "fbpcs/emp_games/common/SchedulerHints.h"
+
+#include <gflags/gflags.h>
+
+DEFINE_string(
+    scheduler_hints,
+    "",
+    "Comma separated hints on the scheduler of the game over its own: lazy or "
+    "eager, flush_rows=<rows fed in between reveals> and "
+    "max_batch_width=<widest batch of one operation>, where 0 leaves the "
+    "game's own. Both parties must use the same hints");
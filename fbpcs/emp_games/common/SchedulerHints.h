@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <folly/Format.h>
+#include <gflags/gflags_declare.h>
+
+#include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
+#include "fbpcf/scheduler/EagerSchedulerFactory.h"
+#include "fbpcf/scheduler/IScheduler.h"
+#include "fbpcf/scheduler/LazySchedulerFactory.h"
+#include "fbpcf/util/MetricCollector.h"
+
+DECLARE_string(scheduler_hints);
+
+/*
+Hints on how a game feeds gates to the scheduler of the real engine, as the
+games differ a lot in the shape of their gates: aggregation is heavy on
+ORAM, attribution on comparisons and lift on additions. Every game has hints
+of its own as defaults, which the scheduler_hints flag of a run overrides key
+by key, and a game leaves out the hints which don't apply to it.
+
+The lazy scheduler of fbpcf buffers gates until a value is revealed and has no
+knobs of its own, so a game bounds what it buffers through its own batching:
+flushRows is how many rows it feeds in before revealing them, and
+maxBatchWidth the widest batch it runs one operation on. Both parties must
+use the same hints, as they change the gates the game runs.
+*/
+namespace common {
+
+struct SchedulerHints {
+  // Whether the scheduler buffers gates until a value is needed, rather
+  // than running each gate as it comes
+  bool lazy = true;
+  // The rows fed in between reveals, 0 for every row of a file at once
+  std::size_t flushRows = 0;
+  // The width of the widest batch of one operation, 0 for the game's own
+  std::size_t maxBatchWidth = 0;
+
+  std::string toString() const {
+    return folly::sformat(
+        "{},flush_rows={},max_batch_width={}",
+        lazy ? "lazy" : "eager",
+        flushRows,
+        maxBatchWidth);
+  }
+};
+
+namespace detail {
+
+inline std::size_t parseSchedulerHintSize(
+    const std::string& value,
+    const std::string& hint) {
+  if (value.empty() ||
+      value.find_first_not_of("0123456789") != std::string::npos) {
+    throw std::invalid_argument(
+        "The scheduler hint " + hint + " needs a non negative number");
+  }
+  try {
+    return std::stoull(value);
+  } catch (const std::out_of_range&) {
+    throw std::invalid_argument("The scheduler hint " + hint + " is too big");
+  }
+}
+
+} // namespace detail
+
+/*
+ * Parses hints such as "eager,flush_rows=50000" over defaults. The hints are
+ * separated by commas, and are "lazy", "eager", "flush_rows=<rows>" or
+ * "max_batch_width=<width>". Throws std::invalid_argument on any other.
+ */
+inline SchedulerHints parseSchedulerHints(
+    const std::string& hints,
+    SchedulerHints defaults = SchedulerHints{}) {
+  auto parsed = defaults;
+  std::size_t start = 0;
+  while (start <= hints.size()) {
+    auto end = hints.find(',', start);
+    if (end == std::string::npos) {
+      end = hints.size();
+    }
+    auto hint = hints.substr(start, end - start);
+    start = end + 1;
+    if (hint.empty()) {
+      continue;
+    }
+
+    auto equals = hint.find('=');
+    auto key = hint.substr(0, equals);
+    if (equals == std::string::npos) {
+      if (key == "lazy" || key == "eager") {
+        parsed.lazy = key == "lazy";
+        continue;
+      }
+    } else {
+      auto value =
+          detail::parseSchedulerHintSize(hint.substr(equals + 1), hint);
+      if (key == "flush_rows") {
+        parsed.flushRows = value;
+        continue;
+      }
+      if (key == "max_batch_width") {
+        parsed.maxBatchWidth = value;
+        continue;
+      }
+    }
+    throw std::invalid_argument("Unknown scheduler hint " + hint);
+  }
+  return parsed;
+}
+
+// The hints of a game: its own, with those of scheduler_hints over them
+inline SchedulerHints getSchedulerHints(const SchedulerHints& gameHints) {
+  return parseSchedulerHints(FLAGS_scheduler_hints, gameHints);
+}
+
+// A lazy or eager scheduler of the real engine, as the hints ask for
+inline std::unique_ptr<fbpcf::scheduler::IScheduler> createRealScheduler(
+    const SchedulerHints& hints,
+    int myRole,
+    fbpcf::engine::communication::IPartyCommunicationAgentFactory& factory,
+    std::shared_ptr<fbpcf::util::MetricCollector> metricCollector) {
+  return hints.lazy
+      ? fbpcf::scheduler::getLazySchedulerFactoryWithRealEngine(
+            myRole, factory, metricCollector)
+            ->create()
+      : fbpcf::scheduler::getEagerSchedulerFactoryWithRealEngine(
+            myRole, factory, metricCollector)
+            ->create();
+}
+
+} // namespace common
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "fbpcf/scheduler/SchedulerHelper.h"
+#include "fbpcs/performance_tools/PhaseProfiler.h"
+
+namespace common {
+
+// Reads the gate and traffic counters of the scheduler of schedulerId, which
+// must be set while the phase runs
+template <int schedulerId>
+std::function<fbpcs::performance_tools::PhaseCounters()>
+getSchedulerCounterReader() {
+  return []() {
+    auto gateStatistics =
+        fbpcf::scheduler::SchedulerKeeper<schedulerId>::getGateStatistics();
+    auto trafficStatistics =
+        fbpcf::scheduler::SchedulerKeeper<schedulerId>::getTrafficStatistics();
+    return fbpcs::performance_tools::PhaseCounters{
+        gateStatistics.first,
+        gateStatistics.second,
+        trafficStatistics.first,
+        trafficStatistics.second};
+  };
+}
+
+} // namespace common
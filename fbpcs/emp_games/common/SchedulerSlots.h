@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "fbpcs/emp_games/common/SchedulerStatistics.h"
+
+/*
+The scheduler slots the concurrent apps of a run are started in. fbpcf keeps
+the scheduler of an app in the static SchedulerKeeper<schedulerId> and takes
+the schedulerId as a template argument of its frontend types, so every app
+running at the same time needs a schedulerId of its own, known at compile time.
+
+SchedulerSlots instantiates the app of each of its numSlots slots exactly once,
+and keeps it behind a std::function, so that the apps are started in a loop
+over slots chosen at runtime rather than by a template recursing over the
+slots, one nested call and one future per level.
+*/
+namespace common {
+
+template <std::size_t numSlots, typename... Args>
+class SchedulerSlots {
+ public:
+  using App = std::function<SchedulerStatistics(Args...)>;
+
+  // makeApp is called with a std::integral_constant of every slot, and
+  // returns the function which runs the app of that slot on the calling
+  // thread
+  template <typename MakeApp>
+  explicit SchedulerSlots(MakeApp makeApp)
+      : apps_{makeApps(makeApp, std::make_index_sequence<numSlots>{})} {}
+
+  static constexpr std::size_t getNumSlots() {
+    return numSlots;
+  }
+
+  SchedulerStatistics run(std::size_t slot, Args... args) const {
+    if (slot >= numSlots) {
+      throw std::out_of_range(
+          "Scheduler slot " + std::to_string(slot) + " out of " +
+          std::to_string(numSlots));
+    }
+    return apps_[slot](std::forward<Args>(args)...);
+  }
+
+ private:
+  template <typename MakeApp, std::size_t... slots>
+  static std::array<App, numSlots> makeApps(
+      MakeApp& makeApp,
+      std::index_sequence<slots...>) {
+    return {App(makeApp(std::integral_constant<std::size_t, slots>{}))...};
+  }
+
+  std::array<App, numSlots> apps_;
+};
+
+/*
+ * Starts numApps apps, in slots 0 up, and adds up the statistics of their
+ * runs. startApp(slot) starts the app of a slot on a thread of its own and
+ * returns the future of its statistics. The apps after the first one are only
+ * started as long as shouldStart(slot) allows it, as an adaptive run does.
+ */
+template <typename StartApp, typename ShouldStart>
+SchedulerStatistics runAppsInSlots(
+    std::size_t numApps,
+    StartApp startApp,
+    ShouldStart shouldStart) {
+  std::vector<std::future<SchedulerStatistics>> runs;
+  for (std::size_t slot = 0; slot < numApps; ++slot) {
+    if (slot > 0 && !shouldStart(slot)) {
+      break;
+    }
+    runs.push_back(startApp(slot));
+  }
+
+  SchedulerStatistics schedulerStatistics{
+      0, 0, 0, 0, folly::dynamic::object()};
+  for (auto& run : runs) {
+    schedulerStatistics.add(run.get());
+  }
+  return schedulerStatistics;
+}
+
+template <typename StartApp>
+SchedulerStatistics runAppsInSlots(std::size_t numApps, StartApp startApp) {
+  return runAppsInSlots(
+      numApps, std::move(startApp), [](std::size_t) { return true; });
+}
+
+} // namespace common
@@ -9,7 +9,8 @@
 
 #include <folly/dynamic.h>
 #include <cstdint>
-#include <exception>
+
+#include "fbpcs/emp_games/common/MetricsRegistry.h"
 
 namespace common {
 
@@ -25,11 +26,7 @@ struct SchedulerStatistics {
     freeGates += other.freeGates;
     sentNetwork += other.sentNetwork;
     receivedNetwork += other.receivedNetwork;
-    try {
-      details = folly::dynamic::merge(details, other.details);
-    } catch (std::exception& e) {
-      details = std::string("Failed to merge details: ") + e.what();
-    }
+    details = mergeMetrics(details, other.details);
   }
 };
 
@@ -49,38 +49,56 @@ const std::vector<O> privatelyShareArrayFrom(
     OArgs... oArgs);
 
 /*
- * Share emp::Integers from SOURCE_ROLE to the opposite party
+ * Feed the low bitLen bits of numVals values from SOURCE_ROLE to emp in one
+ * batch, so the OT runs over one contiguous block rather than once per value
+ * as constructing an emp::Integer or emp::Bit per value does.
+ *
+ * getValue(i) returns value i and is only called by SOURCE_ROLE.
+ * Returns the labels of the bits, bitLen per value from the least
+ * significant bit, as emp::Integer lays them out.
+ */
+template <int MY_ROLE, int SOURCE_ROLE, typename GetValue>
+std::vector<emp::block>
+feedBitsFrom(size_t numVals, int32_t bitLen, GetValue getValue);
+
+/*
+ * Reveal the emp::Integers of bitLen bits whose labels are labels to party,
+ * in one batch rather than a round trip per value. With emp::XOR, each party
+ * gets its XOR share of the values.
+ */
+inline std::vector<int64_t> revealIntsFromLabels(
+    const std::vector<emp::block>& labels,
+    int32_t bitLen,
+    int party = emp::PUBLIC);
+
+/*
+ * Share emp::Integers from SOURCE_ROLE to the opposite party in one batch
  * numVals = number of items to share
  */
 template <int MY_ROLE, int SOURCE_ROLE>
 const std::vector<emp::Integer> privatelyShareIntsFrom(
     const std::vector<int64_t>& in,
     size_t numVals,
-    int32_t bitLen = INT_SIZE) {
-  return privatelyShareArrayFrom<MY_ROLE, SOURCE_ROLE, int64_t, emp::Integer>(
-      in, numVals, 0, bitLen);
-}
+    int32_t bitLen = INT_SIZE);
 
 /*
- * Share emp::Bits from SOURCE_ROLE to the opposite party
+ * Share emp::Bits from SOURCE_ROLE to the opposite party in one batch
  * numVals = number of items to share
  */
 template <int MY_ROLE, int SOURCE_ROLE>
 const std::vector<emp::Bit> privatelyShareBitsFrom(
     const std::vector<int64_t>& in,
-    size_t numVals) {
-  return privatelyShareArrayFrom<MY_ROLE, SOURCE_ROLE, int64_t, emp::Bit>(
-      in, numVals, 0);
-}
+    size_t numVals);
 
 /*
  * Share an array of T arrays from SOURCE_ROLE to the opposite party,
  * returning a vector of O arrays.
  *
  * The inner arrays will be padded to prevent the other party from
- * learning how many items are in the arrays.
+ * learning how many items are in the arrays. The padding is shared in
+ * place, without padded copies of the arrays.
  *
- * privatelyShareArrayFrom will be used to share the inner arrays.
+ * emp::Bits are shared in one batch, and other types of O one at a time.
  *
  * maxArraySize = maximum inner array size
  * paddingValue = value to pad the inner arrays with
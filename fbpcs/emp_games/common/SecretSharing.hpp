@@ -10,10 +10,12 @@
 
 #include <algorithm>
 #include <functional>
+#include <memory>
 #include <numeric>
 #include <optional>
 #include <stdexcept>
 #include <tuple>
+#include <type_traits>
 #include <vector>
 
 #include "SecretSharing.h"
@@ -29,6 +31,106 @@ PrivateInt<MY_ROLE> privatelyShareInt(int64_t in) {
   return PrivateInt<MY_ROLE>{myInt, theirInt};
 }
 
+template <int MY_ROLE, int SOURCE_ROLE, typename GetValue>
+std::vector<emp::block>
+feedBitsFrom(size_t numVals, int32_t bitLen, GetValue getValue) {
+  const auto numBits = numVals * bitLen;
+  std::vector<emp::block> labels(numBits);
+  if (numBits == 0) {
+    return labels;
+  }
+
+  // The other party feeds placeholder bits, which emp does not read
+  std::unique_ptr<bool[]> bits{new bool[numBits]()};
+  if constexpr (MY_ROLE == SOURCE_ROLE) {
+    for (size_t i = 0; i < numVals; ++i) {
+      const int64_t value = getValue(i);
+      for (int32_t j = 0; j < bitLen; ++j) {
+        // Sign extended past 64 bits, as emp::Integer does
+        bits[i * bitLen + j] = (value >> std::min(j, 63)) & 1;
+      }
+    }
+  }
+  emp::ProtocolExecution::prot_exec->feed(
+      labels.data(), SOURCE_ROLE, bits.get(), static_cast<int>(numBits));
+  return labels;
+}
+
+inline std::vector<int64_t> revealIntsFromLabels(
+    const std::vector<emp::block>& labels,
+    int32_t bitLen,
+    int party) {
+  const auto numVals = bitLen > 0 ? labels.size() / bitLen : 0;
+  std::vector<int64_t> out(numVals);
+  if (labels.empty()) {
+    return out;
+  }
+
+  std::unique_ptr<bool[]> bits{new bool[labels.size()]};
+  emp::ProtocolExecution::prot_exec->reveal(
+      bits.get(), party, labels.data(), static_cast<int>(labels.size()));
+  for (size_t i = 0; i < numVals; ++i) {
+    uint64_t value = 0;
+    for (int32_t j = std::min(bitLen, 64) - 1; j >= 0; --j) {
+      value = (value << 1) | bits[i * bitLen + j];
+    }
+    out[i] = static_cast<int64_t>(value);
+  }
+  return out;
+}
+
+template <int MY_ROLE, int SOURCE_ROLE>
+const std::vector<emp::Integer> privatelyShareIntsFrom(
+    const std::vector<int64_t>& in,
+    size_t numVals,
+    int32_t bitLen) {
+  const auto receiveStr = MY_ROLE == SOURCE_ROLE ? "sending" : "receiving";
+  XLOGF(
+      DBG,
+      "Privately {} array[{}] = {}",
+      receiveStr,
+      numVals,
+      privateVecToString<MY_ROLE, SOURCE_ROLE, int64_t>(
+          in, numVals, std::make_optional<int64_t>(0)));
+
+  const auto labels = feedBitsFrom<MY_ROLE, SOURCE_ROLE>(
+      numVals, bitLen, [&in](size_t i) { return in.at(i); });
+
+  std::vector<emp::Integer> out(numVals);
+  for (size_t i = 0; i < numVals; ++i) {
+    auto& bits = out.at(i).bits;
+    bits.reserve(bitLen);
+    for (int32_t j = 0; j < bitLen; ++j) {
+      bits.emplace_back(labels.at(i * bitLen + j));
+    }
+  }
+  return out;
+}
+
+template <int MY_ROLE, int SOURCE_ROLE>
+const std::vector<emp::Bit> privatelyShareBitsFrom(
+    const std::vector<int64_t>& in,
+    size_t numVals) {
+  const auto receiveStr = MY_ROLE == SOURCE_ROLE ? "sending" : "receiving";
+  XLOGF(
+      DBG,
+      "Privately {} array[{}] = {}",
+      receiveStr,
+      numVals,
+      privateVecToString<MY_ROLE, SOURCE_ROLE, int64_t>(
+          in, numVals, std::make_optional<int64_t>(0)));
+
+  const auto labels = feedBitsFrom<MY_ROLE, SOURCE_ROLE>(
+      numVals, 1, [&in](size_t i) { return in.at(i); });
+
+  std::vector<emp::Bit> out;
+  out.reserve(numVals);
+  for (const auto& label : labels) {
+    out.emplace_back(label);
+  }
+  return out;
+}
+
 template <
     int MY_ROLE,
     int SOURCE_ROLE,
@@ -125,22 +227,10 @@ const std::vector<std::vector<O>> privatelyShareArraysFrom(
       numVals,
       maxArraySize);
 
-  // Pad the passed in arrays
-  // POTENTIAL OPTIMIZATION: we don't need to store the padded arrays on
-  // the publisher.
-  std::vector<int64_t> paddedLengths;
-  std::vector<std::vector<T>> paddedArrays;
-  if (MY_ROLE == SOURCE_ROLE) {
-    XLOG(DBG, "padding arrays");
-
-    paddedLengths.reserve(numVals);
-    paddedArrays.reserve(numVals);
-
+  // Every array is padded to maxArraySize, which the other party may not know
+  if constexpr (MY_ROLE == SOURCE_ROLE) {
     for (size_t i = 0; i < numVals; i++) {
-      auto vec = in.at(i);
-      auto arrayLength = vec.size();
-      auto paddedLength = maxArraySize;
-
+      auto arrayLength = in.at(i).size();
       if (arrayLength > maxArraySize) {
         throw std::runtime_error(fmt::format(
             "Input array {} of length {} is greater than allowed size {}",
@@ -148,42 +238,60 @@ const std::vector<std::vector<O>> privatelyShareArraysFrom(
             arrayLength,
             maxArraySize));
       }
-
-      // Perform the padding
-      std::vector<T> paddedVec(vec.begin(), vec.end());
-      for (size_t i_2_2 = 0; i_2_2 < paddedLength - arrayLength; i_2_2++) {
-        const T paddingCopy = paddingValue;
-        paddedVec.push_back(paddingCopy);
-      }
-
-      paddedArrays.push_back(paddedVec);
-      paddedLengths.push_back(paddedLength);
-    }
-  } else {
-    // Still allocate the outer arrays
-    for (size_t i = 0; i < numVals; i++) {
-      paddedArrays.push_back(std::vector<T>());
     }
   }
 
   // Send over the lengths
   XLOGF(DBG, "{} padded array lengths", receiveStr);
-  const auto empPaddedLengths = privatelyShareIntsFrom<MY_ROLE, SOURCE_ROLE>(
-      paddedLengths, numVals, INT_SIZE);
-  const auto revealedPaddedLengths = map<emp::Integer, int64_t>(
-      empPaddedLengths,
-      [](auto empLength) { return empLength.template reveal<int64_t>(); });
+  const auto revealedPaddedLengths = revealIntsFromLabels(
+      feedBitsFrom<MY_ROLE, SOURCE_ROLE>(
+          numVals,
+          INT_SIZE,
+          [maxArraySize](size_t) {
+            return static_cast<int64_t>(maxArraySize);
+          }),
+      INT_SIZE);
+
+  // The value at j of array i, reading the padding past its end rather than
+  // from a padded copy
+  auto paddedValue = [&in, &paddingValue](size_t i, size_t j) -> T {
+    const auto& vec = in.at(i);
+    return j < vec.size() ? vec.at(j) : paddingValue;
+  };
 
   // Send over the padded arrays
   XLOGF(DBG, "{} padded arrays", receiveStr);
-  const auto out = zip_and_map<std::vector<T>, int64_t, std::vector<O>>(
-      paddedArrays,
-      revealedPaddedLengths,
-      std::bind(
-          privatelyShareArrayFrom<MY_ROLE, SOURCE_ROLE, T, O>,
-          std::placeholders::_1,
-          std::placeholders::_2,
-          paddingValue));
+  std::vector<std::vector<O>> out(numVals);
+  if constexpr (std::is_same_v<O, emp::Bit>) {
+    // All bits at once. The source pads every array to maxArraySize.
+    size_t numBits = std::accumulate(
+        revealedPaddedLengths.begin(), revealedPaddedLengths.end(), size_t{0});
+    const auto labels = feedBitsFrom<MY_ROLE, SOURCE_ROLE>(
+        numBits, 1, [&paddedValue, maxArraySize](size_t k) {
+          return static_cast<int64_t>(
+              paddedValue(k / maxArraySize, k % maxArraySize));
+        });
+    auto label = labels.begin();
+    for (size_t i = 0; i < numVals; ++i) {
+      out.at(i).reserve(revealedPaddedLengths.at(i));
+      for (int64_t j = 0; j < revealedPaddedLengths.at(i); ++j) {
+        out.at(i).emplace_back(*label++);
+      }
+    }
+  } else {
+    for (size_t i = 0; i < numVals; ++i) {
+      auto& array = out.at(i);
+      array.reserve(revealedPaddedLengths.at(i));
+      for (int64_t j = 0; j < revealedPaddedLengths.at(i); ++j) {
+        if constexpr (MY_ROLE == SOURCE_ROLE) {
+          array.push_back(O(paddedValue(i, j), SOURCE_ROLE));
+        } else {
+          T paddingCopy = paddingValue;
+          array.push_back(O(paddingCopy, SOURCE_ROLE));
+        }
+      }
+    }
+  }
 
   return out;
 }
@@ -233,11 +341,12 @@ const std::vector<std::vector<O>> privatelyShareArraysFromNoPadding(
 
   // Send over the lengths
   XLOGF(DBG, "{} array lengths", receiveStr);
-  const auto empLengths = privatelyShareIntsFrom<MY_ROLE, SOURCE_ROLE>(
-      vecLengths, numVals, INT_SIZE);
-  const auto revealedLengths = map<emp::Integer, int64_t>(
-      empLengths,
-      [](auto empLength) { return empLength.template reveal<int64_t>(); });
+  const auto revealedLengths = revealIntsFromLabels(
+      feedBitsFrom<MY_ROLE, SOURCE_ROLE>(
+          numVals,
+          INT_SIZE,
+          [&vecLengths](size_t i) { return vecLengths.at(i); }),
+      INT_SIZE);
 
   // Send over the arrays
   XLOGF(DBG, "{} arrays", receiveStr);
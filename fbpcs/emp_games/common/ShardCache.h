@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <folly/Format.h>
+#include <folly/Random.h>
+#include <folly/hash/SpookyHashV2.h>
+#include <folly/logging/xlog.h>
+
+#include "fbpcf/engine/communication/IPartyCommunicationAgent.h"
+#include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
+#include "fbpcf/io/api/FileIOWrappers.h"
+#include "fbpcf/io/api/FileReader.h"
+#include "fbpcs/emp_games/common/Constants.h"
+
+namespace common {
+
+/*
+ * The key of a shard, a hash of the contents of its input files and of the
+ * config of the stage which computes it, as a hex string
+ */
+inline std::string shardCacheKey(
+    const std::vector<std::string>& inputPaths,
+    const std::string& config) {
+  folly::hash::SpookyHashV2 hash;
+  hash.Init(0, 0);
+  uint64_t configSize = config.size();
+  hash.Update(&configSize, sizeof(configSize));
+  hash.Update(config.data(), config.size());
+  std::vector<char> buffer(1 << 20);
+  for (auto& inputPath : inputPaths) {
+    fbpcf::io::FileReader reader{inputPath};
+    uint64_t fileSize = 0;
+    while (!reader.eof()) {
+      auto size = reader.read(buffer);
+      hash.Update(buffer.data(), size);
+      fileSize += size;
+    }
+    reader.close();
+    // Keeps the boundaries between the files in the key
+    hash.Update(&fileSize, sizeof(fileSize));
+  }
+  uint64_t hash1 = 0;
+  uint64_t hash2 = 0;
+  hash.Final(&hash1, &hash2);
+  return folly::sformat("{:016x}{:016x}", hash1, hash2);
+}
+
+/*
+ * Lets a stage skip the shards it computed in an earlier run, so that a retry
+ * after a failure resumes with the shards which weren't finished instead of
+ * redoing all of them.
+ *
+ * Once the outputs of a shard are written, a stamp is written next to them
+ * with the key of the shard and the run of the shard it comes from. A shard is
+ * skipped when the stamps of both parties have the current key and the same
+ * run. The run matters because secret shares only match the shares of the
+ * other party which were computed together with them, so the outputs of one
+ * party can't be kept while the other party computes the shard again.
+ *
+ * The parties agree on every shard over a communication agent, which is
+ * created from the factory of the app, so both parties have to construct this
+ * at the same point with respect to the other agents created from it, and
+ * call isComputed for the same shards in the same order.
+ */
+class ShardCache {
+ public:
+  ShardCache(
+      int myRole,
+      std::string config,
+      fbpcf::engine::communication::IPartyCommunicationAgentFactory&
+          communicationAgentFactory)
+      : myRole_{myRole},
+        config_{std::move(config)},
+        communicationAgent_{communicationAgentFactory.create(
+            myRole == PUBLISHER ? PARTNER : PUBLISHER,
+            "shard_cache")} {}
+
+  // Whether both parties already have the outputs of the shard with the given
+  // inputs, whose stamp is at stampPath. Otherwise the shard has to be
+  // computed, and markComputed called with the same stampPath once its
+  // outputs are written.
+  bool isComputed(
+      const std::vector<std::string>& inputPaths,
+      const std::string& stampPath) {
+    auto key = shardCacheKey(inputPaths, config_);
+    auto cachedRun = readStamp(stampPath, key);
+
+    // The publisher also draws the run of the shard, in case it's computed
+    Run otherRun;
+    Run newRun;
+    if (myRole_ == PUBLISHER) {
+      newRun = {
+          folly::Random::secureRand64() | 1, folly::Random::secureRand64()};
+      communicationAgent_->sendT(std::vector<uint64_t>{
+          cachedRun.first, cachedRun.second, newRun.first, newRun.second});
+      auto received = communicationAgent_->receiveT<uint64_t>(2);
+      otherRun = {received.at(0), received.at(1)};
+    } else {
+      auto received = communicationAgent_->receiveT<uint64_t>(4);
+      communicationAgent_->sendT(
+          std::vector<uint64_t>{cachedRun.first, cachedRun.second});
+      otherRun = {received.at(0), received.at(1)};
+      newRun = {received.at(2), received.at(3)};
+    }
+
+    if (cachedRun != kNoRun && cachedRun == otherRun) {
+      XLOG(INFO) << "Skipping the shard of " << stampPath
+                 << ", which both parties computed in an earlier run";
+      return true;
+    }
+    std::lock_guard<std::mutex> lock{pendingMutex_};
+    pending_[stampPath] = {std::move(key), newRun};
+    return false;
+  }
+
+  // Writes the stamp of a shard which isComputed returned false for. This
+  // doesn't use the communication agent, so it can be called on another
+  // thread than isComputed.
+  void markComputed(const std::string& stampPath) {
+    std::pair<std::string, Run> stamp;
+    {
+      std::lock_guard<std::mutex> lock{pendingMutex_};
+      stamp = std::move(pending_.at(stampPath));
+      pending_.erase(stampPath);
+    }
+    fbpcf::io::FileIOWrappers::writeFile(
+        stampPath,
+        folly::sformat(
+            "{} {:016x}{:016x}\n",
+            stamp.first,
+            stamp.second.first,
+            stamp.second.second));
+  }
+
+ private:
+  using Run = std::pair<uint64_t, uint64_t>;
+  // Runs drawn by the publisher are never this, as their first half is odd
+  static constexpr Run kNoRun{0, 0};
+
+  // The run of the stamp at stampPath, or kNoRun if there is none, it can't
+  // be read or it has another key
+  static Run readStamp(const std::string& stampPath, const std::string& key) {
+    std::string content;
+    try {
+      content = fbpcf::io::FileIOWrappers::readFile(stampPath);
+    } catch (const std::exception&) {
+      return kNoRun;
+    }
+    std::istringstream stamp{content};
+    std::string stampKey;
+    std::string run;
+    if (!(stamp >> stampKey >> run) || stampKey != key || run.size() != 32) {
+      return kNoRun;
+    }
+    try {
+      return {
+          std::stoull(run.substr(0, 16), nullptr, 16),
+          std::stoull(run.substr(16), nullptr, 16)};
+    } catch (const std::exception&) {
+      return kNoRun;
+    }
+  }
+
+  int myRole_;
+  std::string config_;
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+      communicationAgent_;
+  std::mutex pendingMutex_;
+  // The key and run of the shards which are being computed, by stamp path
+  std::unordered_map<std::string, std::pair<std::string, Run>> pending_;
+};
+
+// The path of the stamp of a shard, next to its first output
+inline std::string shardCacheStampPath(const std::string& outputPath) {
+  return outputPath + "_cacheStamp";
+}
+
+} // namespace common
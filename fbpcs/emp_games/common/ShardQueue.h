@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <folly/json.h>
+#include <folly/logging/xlog.h>
+
+#include "fbpcf/engine/communication/IPartyCommunicationAgent.h"
+#include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
+#include "fbpcf/io/api/FileIOWrappers.h"
+#include "fbpcs/emp_games/common/Constants.h"
+
+namespace common {
+
+/*
+ * Hands out the indices of the sharded files to the apps of one party running
+ * on separate threads. An app takes the next file when it finishes one, instead
+ * of every app being given an even range of files up front, so that with
+ * skewed shards the apps which drew small files carry on with the remaining
+ * ones rather than waiting on the app which drew the largest.
+ */
+class ShardQueue {
+ public:
+  explicit ShardQueue(std::size_t numFiles) : order_(numFiles) {
+    std::iota(order_.begin(), order_.end(), 0);
+  }
+
+  // Hands out the files in the given order, which should have every index
+  // exactly once
+  explicit ShardQueue(std::vector<std::size_t> order)
+      : order_{std::move(order)} {}
+
+  // The index of a file no app has taken yet, or std::nullopt once all of
+  // them are taken
+  std::optional<std::size_t> take() {
+    auto next = next_.fetch_add(1);
+    if (next >= order_.size()) {
+      return std::nullopt;
+    }
+    return order_[next];
+  }
+
+  // Whether some file is left for an app to take
+  bool hasRemaining() const {
+    return next_.load() < order_.size();
+  }
+
+ private:
+  std::vector<std::size_t> order_;
+  std::atomic<std::size_t> next_{0};
+};
+
+/*
+ * The indices of the files ordered from the most expensive to the cheapest,
+ * keeping the original order between files of the same cost. Running the most
+ * expensive files first leaves only cheap ones at the end for the apps which
+ * finish early, so the apps finish at about the same time.
+ */
+inline std::vector<std::size_t> orderLongestFirst(
+    const std::vector<uint64_t>& costs) {
+  std::vector<std::size_t> order(costs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+    return costs[a] > costs[b];
+  });
+  return order;
+}
+
+/*
+ * A queue of numFiles files, which runs them longest first when given the
+ * cost manifest the sharder wrote next to them (<first shard>_shardCosts). The
+ * files run in their original order without a manifest, or if it can't be
+ * read or doesn't list one cost per file, as the order only affects how long
+ * the apps take and not their results.
+ */
+inline std::shared_ptr<ShardQueue> makeShardQueue(
+    std::size_t numFiles,
+    const std::string& costManifestPath) {
+  if (costManifestPath.empty()) {
+    return std::make_shared<ShardQueue>(numFiles);
+  }
+  std::vector<uint64_t> costs;
+  try {
+    auto manifest =
+        folly::parseJson(fbpcf::io::FileIOWrappers::readFile(costManifestPath));
+    for (auto& cost : manifest.at("shard_costs")) {
+      costs.push_back(cost.asInt());
+    }
+  } catch (const std::exception& e) {
+    XLOG(WARNING) << "Running the files in order, as the shard cost manifest "
+                  << costManifestPath << " couldn't be read: " << e.what();
+    return std::make_shared<ShardQueue>(numFiles);
+  }
+  if (costs.size() != numFiles) {
+    XLOG(WARNING) << "Running the files in order, as the shard cost manifest "
+                  << costManifestPath << " lists " << costs.size()
+                  << " shards for " << numFiles << " files";
+    return std::make_shared<ShardQueue>(numFiles);
+  }
+  return std::make_shared<ShardQueue>(orderLongestFirst(costs));
+}
+
+/*
+ * The files run by one app, which is paired with an app of the other party.
+ * Either a fixed range of files, or files taken from a ShardQueue as the app
+ * finishes the previous ones. In the latter case both parties have to run the
+ * same file in a pair of apps while their apps finish in a different order, so
+ * only the publisher takes files from its queue and sends each index to the
+ * partner over a communication agent of the pair. The agent is created from
+ * the factory of the app, so both parties have to construct this at the same
+ * point, with respect to the other agents created from it.
+ */
+class ShardAssignment {
+ public:
+  ShardAssignment(std::size_t startFileIndex, std::size_t numFiles)
+      : next_{startFileIndex}, end_{startFileIndex + numFiles} {}
+
+  ShardAssignment(
+      int myRole,
+      std::shared_ptr<ShardQueue> queue,
+      fbpcf::engine::communication::IPartyCommunicationAgentFactory&
+          communicationAgentFactory)
+      : myRole_{myRole},
+        queue_{std::move(queue)},
+        communicationAgent_{communicationAgentFactory.create(
+            myRole == PUBLISHER ? PARTNER : PUBLISHER,
+            "shard_assignment")} {}
+
+  // The index of the next file to run, or std::nullopt once there are none
+  // left
+  std::optional<std::size_t> next() {
+    if (communicationAgent_ == nullptr) {
+      if (next_ >= end_) {
+        return std::nullopt;
+      }
+      return next_++;
+    }
+
+    if (myRole_ == PUBLISHER) {
+      auto index = queue_->take();
+      communicationAgent_->sendT(
+          std::vector<uint64_t>{index.value_or(kNoMoreFiles)});
+      return index;
+    }
+    auto index = communicationAgent_->receiveT<uint64_t>(1).at(0);
+    if (index == kNoMoreFiles) {
+      return std::nullopt;
+    }
+    return index;
+  }
+
+ private:
+  static constexpr uint64_t kNoMoreFiles = std::numeric_limits<uint64_t>::max();
+
+  std::size_t next_ = 0;
+  std::size_t end_ = 0;
+  int myRole_ = PUBLISHER;
+  std::shared_ptr<ShardQueue> queue_;
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+      communicationAgent_;
+};
+
+} // namespace common
@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "fbpcs/emp_games/common/ShardReport.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+#include <fbpcf/io/api/FileIOWrappers.h>
+#include <folly/json.h>
+#include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+
+#include "fbpcs/emp_games/common/MetricsRegistry.h"
+
+DEFINE_bool(
+    write_shard_reports,
+    true,
+    "Write the rows, time per phase, gates and traffic of each shard as JSON "
+    "next to its output, with the .perf.json suffix");
+
+namespace common {
+
+void ShardReport::addPhase(const std::string& name, double seconds) {
+  auto phase = std::find_if(
+      phaseSeconds.begin(), phaseSeconds.end(), [&name](const auto& phase) {
+        return phase.first == name;
+      });
+  if (phase == phaseSeconds.end()) {
+    phaseSeconds.emplace_back(name, seconds);
+  } else {
+    phase->second += seconds;
+  }
+}
+
+double ShardReport::getTotalSeconds() const {
+  double total = 0;
+  for (const auto& [name, seconds] : phaseSeconds) {
+    total += seconds;
+  }
+  return total;
+}
+
+folly::dynamic ShardReport::toDynamic() const {
+  folly::dynamic phases = folly::dynamic::object();
+  for (const auto& [name, seconds] : phaseSeconds) {
+    phases.insert(name, seconds);
+  }
+  return folly::dynamic::object(
+      "file_index", static_cast<int64_t>(fileIndex))("num_rows", numRows)(
+      "input_bytes", inputBytes)("output_bytes", outputBytes)(
+      "non_free_gates", mpc.nonFreeGates)("free_gates", mpc.freeGates)(
+      "sent_network", mpc.sentNetwork)("received_network", mpc.receivedNetwork)(
+      "phase_seconds", std::move(phases));
+}
+
+ShardReport ShardReport::fromDynamic(const folly::dynamic& report) {
+  ShardReport result;
+  result.fileIndex = report["file_index"].asInt();
+  result.numRows = report["num_rows"].asInt();
+  result.inputBytes = report["input_bytes"].asInt();
+  result.outputBytes = report["output_bytes"].asInt();
+  result.mpc.nonFreeGates = report["non_free_gates"].asInt();
+  result.mpc.freeGates = report["free_gates"].asInt();
+  result.mpc.sentNetwork = report["sent_network"].asInt();
+  result.mpc.receivedNetwork = report["received_network"].asInt();
+  for (const auto& [name, seconds] : report["phase_seconds"].items()) {
+    result.phaseSeconds.emplace_back(name.asString(), seconds.asDouble());
+  }
+  return result;
+}
+
+uint64_t getLocalFileBytes(const std::vector<std::string>& paths) {
+  uint64_t bytes = 0;
+  for (const auto& path : paths) {
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (!ec) {
+      bytes += size;
+    }
+  }
+  return bytes;
+}
+
+void writeShardReport(
+    const std::string& outputPath,
+    const ShardReport& report) {
+  fbpcf::io::FileIOWrappers::writeFile(
+      getShardReportPath(outputPath), folly::toJson(report.toDynamic()));
+}
+
+std::optional<ShardReport> readShardReport(const std::string& outputPath) {
+  try {
+    return ShardReport::fromDynamic(folly::parseJson(
+        fbpcf::io::FileIOWrappers::readFile(getShardReportPath(outputPath))));
+  } catch (const std::exception& e) {
+    XLOGF(INFO, "No shard report next to {}: {}", outputPath, e.what());
+    return std::nullopt;
+  }
+}
+
+folly::dynamic summarizeShardReports(const std::vector<ShardReport>& reports) {
+  ShardReport total;
+  folly::dynamic shards = folly::dynamic::array();
+  std::optional<ShardReport> slowest;
+  for (const auto& report : reports) {
+    total.numRows += report.numRows;
+    total.inputBytes += report.inputBytes;
+    total.outputBytes += report.outputBytes;
+    total.mpc.nonFreeGates += report.mpc.nonFreeGates;
+    total.mpc.freeGates += report.mpc.freeGates;
+    total.mpc.sentNetwork += report.mpc.sentNetwork;
+    total.mpc.receivedNetwork += report.mpc.receivedNetwork;
+    for (const auto& [name, seconds] : report.phaseSeconds) {
+      total.addPhase(name, seconds);
+    }
+    if (!slowest.has_value() ||
+        report.getTotalSeconds() > slowest->getTotalSeconds()) {
+      slowest = report;
+    }
+    shards.push_back(report.toDynamic());
+  }
+
+  auto totals = total.toDynamic();
+  totals.erase("file_index");
+  return folly::dynamic::object(
+      "num_shards", static_cast<int64_t>(reports.size()))(
+      "totals", std::move(totals))(
+      "slowest_shard",
+      slowest.has_value()
+          ? folly::dynamic(static_cast<int64_t>(slowest->fileIndex))
+          : folly::dynamic(nullptr))(
+      "shards", std::move(shards));
+}
+
+void writeRunReport(
+    const std::vector<std::string>& shardPaths,
+    const std::string& outputPath,
+    const folly::dynamic& extraInfo) {
+  std::vector<ShardReport> reports;
+  for (const auto& shardPath : shardPaths) {
+    auto report = readShardReport(shardPath);
+    if (report.has_value()) {
+      reports.push_back(std::move(*report));
+    }
+  }
+  auto runReport = summarizeShardReports(reports);
+  runReport.update(extraInfo);
+  fbpcf::io::FileIOWrappers::writeFile(
+      getRunReportPath(outputPath), folly::toPrettyJson(runReport));
+}
+
+ShardReporter::Phase::Phase(
+    ShardReporter& reporter,
+    std::size_t i,
+    std::string name,
+    std::function<fbpcs::performance_tools::PhaseCounters()> readCounters)
+    : reporter_{reporter},
+      i_{i},
+      name_{std::move(name)},
+      readCounters_{std::move(readCounters)},
+      start_{std::chrono::steady_clock::now()} {
+  if (readCounters_) {
+    startCounters_ = readCounters_();
+  }
+  MetricsRegistry::getInstance().getGauge("phase." + name_ + ".active").add(1);
+}
+
+ShardReporter::Phase::~Phase() {
+  end();
+}
+
+void ShardReporter::Phase::end() {
+  if (ended_) {
+    return;
+  }
+  ended_ = true;
+  try {
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start_)
+                         .count();
+    fbpcs::performance_tools::PhaseCounters counters;
+    if (readCounters_) {
+      auto end = readCounters_();
+      counters.nonFreeGates = end.nonFreeGates - startCounters_.nonFreeGates;
+      counters.freeGates = end.freeGates - startCounters_.freeGates;
+      counters.sentNetwork = end.sentNetwork - startCounters_.sentNetwork;
+      counters.receivedNetwork =
+          end.receivedNetwork - startCounters_.receivedNetwork;
+    }
+    auto& registry = MetricsRegistry::getInstance();
+    registry.getGauge("phase." + name_ + ".active").add(-1);
+    registry.getHistogram("shard." + name_ + ".milliseconds")
+        .record(seconds * 1000);
+    registry.getCounter("mpc.non_free_gates").add(counters.nonFreeGates);
+    registry.getCounter("mpc.free_gates").add(counters.freeGates);
+    registry.getCounter("mpc.sent_bytes").add(counters.sentNetwork);
+    registry.getCounter("mpc.received_bytes").add(counters.receivedNetwork);
+    reporter_.update(i_, [&](ShardReport& report) {
+      report.addPhase(name_, seconds);
+      report.mpc.nonFreeGates += counters.nonFreeGates;
+      report.mpc.freeGates += counters.freeGates;
+      report.mpc.sentNetwork += counters.sentNetwork;
+      report.mpc.receivedNetwork += counters.receivedNetwork;
+    });
+  } catch (const std::exception& e) {
+    XLOGF(
+        WARN,
+        "Failed to record phase {} of shard {}: {}",
+        name_,
+        i_,
+        e.what());
+  }
+}
+
+void ShardReporter::setNumRows(std::size_t i, int64_t numRows) {
+  MetricsRegistry::getInstance().getCounter("shard.rows").add(numRows);
+  update(i, [numRows](ShardReport& report) { report.numRows = numRows; });
+}
+
+void ShardReporter::setInputPaths(
+    std::size_t i,
+    const std::vector<std::string>& paths) {
+  if (!enabled_) {
+    return;
+  }
+  auto bytes = getLocalFileBytes(paths);
+  update(i, [bytes](ShardReport& report) { report.inputBytes = bytes; });
+}
+
+void ShardReporter::finish(std::size_t i, const std::string& outputPath) {
+  MetricsRegistry::getInstance().getCounter("shard.files_completed").add(1);
+  if (!enabled_) {
+    return;
+  }
+  auto bytes = getLocalFileBytes({outputPath});
+  ShardReport report;
+  update(i, [&](ShardReport& shardReport) {
+    shardReport.outputBytes = bytes;
+    report = shardReport;
+  });
+  // A report is only for capacity planning, so failing to write one does not
+  // fail the shard
+  try {
+    writeShardReport(outputPath, report);
+  } catch (const std::exception& e) {
+    XLOGF(WARN, "Failed to write the report of shard {}: {}", i, e.what());
+  }
+}
+
+std::optional<ShardReport> ShardReporter::getReport(std::size_t i) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto report = reports_.find(i);
+  if (report == reports_.end()) {
+    return std::nullopt;
+  }
+  return report->second;
+}
+
+} // namespace common
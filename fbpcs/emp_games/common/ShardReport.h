@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <folly/dynamic.h>
+#include <gflags/gflags_declare.h>
+
+#include "fbpcs/performance_tools/PhaseProfiler.h"
+
+DECLARE_bool(write_shard_reports);
+
+namespace common {
+
+// The report of a shard is written next to its output, with this suffix
+inline const std::string kShardReportSuffix = ".perf.json";
+
+inline std::string getShardReportPath(const std::string& outputPath) {
+  return outputPath + kShardReportSuffix;
+}
+
+// The report of a run over its shards is written next to the output of the
+// shard combiner, with this suffix
+inline const std::string kRunReportSuffix = ".run_perf.json";
+
+inline std::string getRunReportPath(const std::string& outputPath) {
+  return outputPath + kRunReportSuffix;
+}
+
+/*
+ * The performance of an app on a shard: its size, the wall time of each phase
+ * it went through and the gates and traffic of the game on it. Bytes are
+ * those of local files, and are 0 for files in the cloud.
+ */
+struct ShardReport {
+  std::size_t fileIndex = 0;
+  int64_t numRows = 0;
+  uint64_t inputBytes = 0;
+  uint64_t outputBytes = 0;
+  fbpcs::performance_tools::PhaseCounters mpc;
+  // In the order the phases first ran
+  std::vector<std::pair<std::string, double>> phaseSeconds;
+
+  void addPhase(const std::string& name, double seconds);
+  double getTotalSeconds() const;
+
+  folly::dynamic toDynamic() const;
+  static ShardReport fromDynamic(const folly::dynamic& report);
+};
+
+// Bytes of the local files at paths, skipping those which cannot be found
+uint64_t getLocalFileBytes(const std::vector<std::string>& paths);
+
+void writeShardReport(const std::string& outputPath, const ShardReport& report);
+
+// The report written next to outputPath, if there is one
+std::optional<ShardReport> readShardReport(const std::string& outputPath);
+
+/*
+ * The report of a run over its shards: their totals, the slowest shard and
+ * every shard report, for capacity planning to fit costs per row.
+ */
+folly::dynamic summarizeShardReports(const std::vector<ShardReport>& reports);
+
+/*
+ * Writes the summary of the reports of the shards at shardPaths, skipping
+ * those without one, next to outputPath. extraInfo, such as the report of
+ * the app combining the shards, is added to it.
+ */
+void writeRunReport(
+    const std::vector<std::string>& shardPaths,
+    const std::string& outputPath,
+    const folly::dynamic& extraInfo = folly::dynamic::object());
+
+/*
+ * Collects the reports of the shards of an app. The stages of
+ * runFilesPipelined run on different threads, so a phase of a shard may be
+ * recorded while another shard is computed on. Only writes reports if
+ * --write_shard_reports is set, but always keeps the live metrics of the
+ * MetricsRegistry, such as the phases running and the shards finished.
+ */
+class ShardReporter {
+ public:
+  ShardReporter() : enabled_{FLAGS_write_shard_reports} {}
+
+  /*
+   * Records the wall time of a phase of shard i from its construction to its
+   * destruction, or to end() if that comes first. readCounters, if set, reads
+   * the counters of the scheduler the phase runs on, and the shard is charged
+   * how much they grew.
+   */
+  class Phase {
+   public:
+    Phase(
+        ShardReporter& reporter,
+        std::size_t i,
+        std::string name,
+        std::function<fbpcs::performance_tools::PhaseCounters()> readCounters =
+            nullptr);
+    ~Phase();
+
+    void end();
+
+    Phase(const Phase&) = delete;
+    Phase& operator=(const Phase&) = delete;
+
+   private:
+    ShardReporter& reporter_;
+    std::size_t i_;
+    std::string name_;
+    std::function<fbpcs::performance_tools::PhaseCounters()> readCounters_;
+    std::chrono::steady_clock::time_point start_;
+    fbpcs::performance_tools::PhaseCounters startCounters_;
+    bool ended_ = false;
+  };
+
+  void setNumRows(std::size_t i, int64_t numRows);
+  void setInputPaths(std::size_t i, const std::vector<std::string>& paths);
+
+  // Writes the report of shard i next to its output, once it is written
+  void finish(std::size_t i, const std::string& outputPath);
+
+  // What has been recorded of shard i
+  std::optional<ShardReport> getReport(std::size_t i);
+
+ private:
+  template <typename Update>
+  void update(std::size_t i, Update&& update) {
+    if (!enabled_) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto& report = reports_[i];
+    report.fileIndex = i;
+    update(report);
+  }
+
+  bool enabled_;
+  std::mutex mutex_;
+  std::map<std::size_t, ShardReport> reports_;
+};
+
+} // namespace common
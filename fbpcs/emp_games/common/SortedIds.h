@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+Compresses the ids of every input row, such as ad ids, to their position among
+the distinct ids. The distinct ids are kept as a sorted array, built with a
+radix sort, and every row looks its id up with a binary search, instead of
+hashing each id into a set and then into a map.
+*/
+namespace common {
+
+// Sorts ids and removes the duplicates among them with a least significant
+// digit radix sort over 16 bit digits. The digits which are the same in every
+// id are skipped.
+inline std::vector<uint64_t> sortUniqueIds(std::vector<uint64_t> ids) {
+  constexpr int kDigitBits = 16;
+  constexpr std::size_t kNumBuckets = std::size_t{1} << kDigitBits;
+  std::vector<uint64_t> buffer(ids.size());
+  std::vector<std::size_t> counts(kNumBuckets);
+  for (int shift = 0; shift < 64 && !ids.empty(); shift += kDigitBits) {
+    std::fill(counts.begin(), counts.end(), 0);
+    for (auto id : ids) {
+      ++counts[(id >> shift) & (kNumBuckets - 1)];
+    }
+    if (counts[(ids.front() >> shift) & (kNumBuckets - 1)] == ids.size()) {
+      continue;
+    }
+    std::size_t offset = 0;
+    for (auto& count : counts) {
+      auto bucketSize = count;
+      count = offset;
+      offset += bucketSize;
+    }
+    for (auto id : ids) {
+      buffer[counts[(id >> shift) & (kNumBuckets - 1)]++] = id;
+    }
+    ids.swap(buffer);
+  }
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  return ids;
+}
+
+// The position of id among sortedIds counted from 1, or 0 if it isn't one of
+// them
+inline uint64_t compressId(const std::vector<uint64_t>& sortedIds, uint64_t id) {
+  auto it = std::lower_bound(sortedIds.begin(), sortedIds.end(), id);
+  if (it == sortedIds.end() || *it != id) {
+    return 0;
+  }
+  return it - sortedIds.begin() + 1;
+}
+
+} // namespace common
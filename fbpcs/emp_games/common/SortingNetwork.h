@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/*
+A sorting network is a fixed sequence of compare-exchanges which sorts any
+input, so that secret values can be sorted obliviously: which elements are
+compared never depends on their values, only whether they are swapped does.
+The network here is a bitonic sorter in the form where every comparator puts
+the smaller value first. It takes O(n log^2 n) comparators in O(log^2 n)
+layers, and the comparators of a layer touch distinct elements, so that those
+of a layer can run in the same rounds.
+*/
+namespace common {
+
+// A comparator of elements first < second, after which first holds the
+// smaller of the two
+using Comparator = std::pair<std::size_t, std::size_t>;
+
+/*
+ * The layers of a network sorting n elements. The network for the next power
+ * of two is built, with the missing elements taken as larger than any other,
+ * so that the comparators touching them never swap and are left out.
+ */
+inline std::vector<std::vector<Comparator>> makeSortingNetwork(std::size_t n) {
+  std::size_t size = 1;
+  while (size < n) {
+    size *= 2;
+  }
+
+  std::vector<std::vector<Comparator>> layers;
+  auto addLayer = [&layers, n](std::vector<Comparator> layer) {
+    std::vector<Comparator> kept;
+    for (const auto& comparator : layer) {
+      if (comparator.second < n) {
+        kept.push_back(comparator);
+      }
+    }
+    if (!kept.empty()) {
+      layers.push_back(std::move(kept));
+    }
+  };
+
+  // Each block of blockSize elements is merged from its two sorted halves. The
+  // first layer compares the halves mirrored, which leaves the smaller half
+  // of the block in its first half, both bitonic, and the layers after it
+  // sort each of them by halving
+  for (std::size_t blockSize = 2; blockSize <= size; blockSize *= 2) {
+    std::vector<Comparator> mirrored;
+    for (std::size_t block = 0; block < size; block += blockSize) {
+      for (std::size_t i = 0; i < blockSize / 2; ++i) {
+        mirrored.emplace_back(block + i, block + blockSize - 1 - i);
+      }
+    }
+    addLayer(std::move(mirrored));
+
+    for (std::size_t distance = blockSize / 4; distance > 0; distance /= 2) {
+      std::vector<Comparator> halving;
+      for (std::size_t i = 0; i < size; ++i) {
+        if ((i & distance) == 0) {
+          halving.emplace_back(i, i + distance);
+        }
+      }
+      addLayer(std::move(halving));
+    }
+  }
+  return layers;
+}
+
+} // namespace common
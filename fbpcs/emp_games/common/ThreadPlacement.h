@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <folly/logging/xlog.h>
+
+/*
+Pins the concurrent apps of a run to disjoint sets of CPUs. On hosts with more
+than one NUMA node, apps whose threads float across the nodes keep moving their
+working set between the caches of the nodes and read memory of the other node.
+
+The CPUs the process may run on are ordered by their node, and each app gets an
+equal, contiguous share of them, so that its CPUs are on one node whenever the
+apps divide the nodes evenly. The threads an app starts after pinning its own
+thread, such as those of its engine, inherit its CPUs. Linux allocates the pages
+a thread touches first on the node it runs on, so the buffers of an app are
+local to its CPUs without allocating them from a node explicitly.
+*/
+namespace common {
+
+struct Cpu {
+  int id;
+  int node;
+};
+
+// The NUMA node of cpu, or 0 if the kernel doesn't expose one
+inline int getCpuNode(int cpu) {
+  std::error_code error;
+  std::filesystem::directory_iterator entries{
+      "/sys/devices/system/cpu/cpu" + std::to_string(cpu), error};
+  if (error) {
+    return 0;
+  }
+  for (const auto& entry : entries) {
+    auto name = entry.path().filename().string();
+    if (name.rfind("node", 0) == 0 && name.size() > 4 &&
+        std::all_of(name.begin() + 4, name.end(), [](unsigned char c) {
+          return std::isdigit(c);
+        })) {
+      return std::stoi(name.substr(4));
+    }
+  }
+  return 0;
+}
+
+// The CPUs this process may run on, ordered by node and then by id
+inline std::vector<Cpu> getAvailableCpus() {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  std::vector<Cpu> cpus;
+  if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+    return cpus;
+  }
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &set)) {
+      cpus.push_back(Cpu{cpu, getCpuNode(cpu)});
+    }
+  }
+  std::stable_sort(cpus.begin(), cpus.end(), [](const Cpu& a, const Cpu& b) {
+    return a.node < b.node;
+  });
+  return cpus;
+}
+
+// The ids of the CPUs of lane out of numLanes. Lanes share CPUs only when
+// there are fewer CPUs than lanes.
+inline std::vector<int> getLaneCpus(
+    const std::vector<Cpu>& cpus,
+    std::size_t lane,
+    std::size_t numLanes) {
+  if (cpus.empty() || numLanes == 0) {
+    return {};
+  }
+  if (cpus.size() < numLanes) {
+    return {cpus.at(lane % cpus.size()).id};
+  }
+  std::vector<int> laneCpus;
+  for (auto i = lane * cpus.size() / numLanes;
+       i < (lane + 1) * cpus.size() / numLanes;
+       ++i) {
+    laneCpus.push_back(cpus.at(i).id);
+  }
+  return laneCpus;
+}
+
+// Pins the calling thread, and the threads it starts from then on, to the
+// CPUs of lane out of numLanes. A failure to pin is logged, as the run works
+// the same unpinned.
+inline void pinThreadToLane(std::size_t lane, std::size_t numLanes) {
+  auto laneCpus = getLaneCpus(getAvailableCpus(), lane, numLanes);
+  if (laneCpus.empty()) {
+    XLOG(WARN) << "No CPUs to pin lane " << lane << " to";
+    return;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : laneCpus) {
+    CPU_SET(cpu, &set);
+  }
+  auto result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (result != 0) {
+    XLOG(WARN) << "Failed to pin lane " << lane
+               << " to its CPUs: " << std::system_category().message(result);
+    return;
+  }
+  XLOG(INFO) << "Pinned lane " << lane << " to " << laneCpus.size()
+             << " CPUs from CPU " << laneCpus.front();
+}
+
+} // namespace common
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <folly/dynamic.h>
+
+#include "fbpcs/emp_games/common/TrafficTrace.h"
+
+/*
+Replays the traffic traces of the two apps of a lane over a simulated network,
+to tell how long each phase of a party spent computing, on the network, and
+waiting for the other party to compute, and how long the run would take over
+another network.
+
+A replay doesn't run the games again: the parties draw fresh randomness in
+every run, so the bytes of a recorded run wouldn't fit the shares of another
+one. It keeps what the traces do fix instead, as the messages of a game don't
+depend on its inputs. Each party computes for as long as it did between its
+recorded messages, and sends the same messages in the same order, which reach
+the other party after the latency, one after another at the bandwidth of the
+link in their direction. A receive waits until its last byte has arrived, and
+the part of that wait before the other party sent the message is counted as
+waiting for the other party, the rest as the network.
+*/
+namespace common {
+
+struct ReplayNetwork {
+  double latencySeconds = 0;
+  // 0 for a link of unlimited bandwidth
+  double bytesPerSecond = 0;
+};
+
+struct ReplayedPhase {
+  double computeSeconds = 0;
+  double networkSeconds = 0;
+  double peerWaitSeconds = 0;
+  uint64_t sentBytes = 0;
+  uint64_t receivedBytes = 0;
+
+  folly::dynamic toDynamic() const {
+    return folly::dynamic::object("compute_seconds", computeSeconds)(
+        "network_seconds", networkSeconds)(
+        "peer_wait_seconds", peerWaitSeconds)("sent_bytes", sentBytes)(
+        "received_bytes", receivedBytes);
+  }
+};
+
+// The time of a party over its phases, in the order they first ran
+struct ReplayedParty {
+  double wallSeconds = 0;
+  std::vector<std::pair<std::string, ReplayedPhase>> phases;
+
+  ReplayedPhase& getPhase(const std::string& name) {
+    for (auto& [phaseName, phase] : phases) {
+      if (phaseName == name) {
+        return phase;
+      }
+    }
+    return phases.emplace_back(name, ReplayedPhase{}).second;
+  }
+
+  folly::dynamic toDynamic() const {
+    folly::dynamic out = folly::dynamic::object;
+    for (const auto& [name, phase] : phases) {
+      out[name.empty() ? "(no phase)" : name] = phase.toDynamic();
+    }
+    return folly::dynamic::object("wall_seconds", wallSeconds)("phases", out);
+  }
+};
+
+/*
+ * The time of one party over its phases as it was recorded, where its
+ * receives were blocked on the network and the other party together, so both
+ * are counted as network time.
+ */
+inline ReplayedParty summarizeTrafficTrace(const TrafficTrace& trace) {
+  ReplayedParty party;
+  uint64_t lastEndNs = 0;
+  for (const auto& event : trace.events) {
+    auto& phase = party.getPhase(trace.phases.at(event.phase));
+    if (event.startNs > lastEndNs) {
+      phase.computeSeconds += (event.startNs - lastEndNs) / 1e9;
+    }
+    if (event.kind == TrafficEvent::Kind::kSend) {
+      phase.sentBytes += event.bytes;
+    } else {
+      phase.networkSeconds += (event.endNs - event.startNs) / 1e9;
+      phase.receivedBytes += event.bytes;
+    }
+    lastEndNs = std::max(lastEndNs, event.endNs);
+  }
+  party.wallSeconds = lastEndNs / 1e9;
+  return party;
+}
+
+namespace detail {
+
+// A message sent over an agent, which has been sent up to totalBytes bytes
+struct ReplayedMessage {
+  uint64_t totalBytes;
+  double sentAt;
+  double arrivesAt;
+};
+
+struct ReplayState {
+  const TrafficTrace* trace;
+  std::size_t next = 0;
+  double clock = 0;
+  uint64_t lastEndNs = 0;
+  // The link to the other party is free from this time
+  double linkFreeAt = 0;
+  // By agent, the messages sent and the bytes received so far
+  std::unordered_map<uint16_t, std::vector<ReplayedMessage>> sent;
+  std::unordered_map<uint16_t, uint64_t> receivedBytes;
+  std::unordered_map<uint16_t, std::size_t> receivedMessages;
+  ReplayedParty result;
+};
+
+// Replays the events of a party until it has to wait for a message the other
+// party hasn't sent yet. Returns whether it replayed any event.
+inline bool replayUntilBlocked(
+    ReplayState& self,
+    const ReplayState& other,
+    const ReplayNetwork& network) {
+  bool progressed = false;
+  while (self.next < self.trace->events.size()) {
+    const auto& event = self.trace->events[self.next];
+    auto& phase = self.result.getPhase(self.trace->phases.at(event.phase));
+    auto computeSeconds =
+        event.startNs > self.lastEndNs ? (event.startNs - self.lastEndNs) / 1e9
+                                       : 0;
+
+    if (event.kind == TrafficEvent::Kind::kSend) {
+      auto sentAt = self.clock + computeSeconds;
+      auto transferSeconds = network.bytesPerSecond > 0
+          ? event.bytes / network.bytesPerSecond
+          : 0;
+      self.linkFreeAt = std::max(self.linkFreeAt, sentAt) + transferSeconds;
+      auto& messages = self.sent[event.agent];
+      auto totalBytes =
+          (messages.empty() ? 0 : messages.back().totalBytes) + event.bytes;
+      messages.push_back(
+          {totalBytes, sentAt, self.linkFreeAt + network.latencySeconds});
+      phase.computeSeconds += computeSeconds;
+      phase.sentBytes += event.bytes;
+      self.clock = sentAt;
+    } else {
+      // The message of the other party which holds the last byte of this
+      // receive
+      auto needed = self.receivedBytes[event.agent] + event.bytes;
+      auto sent = other.sent.find(event.agent);
+      if (sent == other.sent.end()) {
+        return progressed;
+      }
+      auto& index = self.receivedMessages[event.agent];
+      while (index < sent->second.size() &&
+             sent->second[index].totalBytes < needed) {
+        ++index;
+      }
+      if (index == sent->second.size()) {
+        return progressed;
+      }
+      const auto& message = sent->second[index];
+
+      auto readyAt = self.clock + computeSeconds;
+      auto arrivesAt = std::max(readyAt, message.arrivesAt);
+      auto peerWaitSeconds =
+          std::clamp(message.sentAt - readyAt, 0.0, arrivesAt - readyAt);
+      phase.computeSeconds += computeSeconds;
+      phase.peerWaitSeconds += peerWaitSeconds;
+      phase.networkSeconds += arrivesAt - readyAt - peerWaitSeconds;
+      phase.receivedBytes += event.bytes;
+      self.receivedBytes[event.agent] = needed;
+      self.clock = arrivesAt;
+    }
+    self.lastEndNs = std::max(self.lastEndNs, event.endNs);
+    ++self.next;
+    progressed = true;
+  }
+  return progressed;
+}
+
+} // namespace detail
+
+/*
+ * Replays the traces of the publisher and partner apps of a lane over
+ * network, and returns the time of each party. Throws if one of the parties
+ * receives more than the other one sent, as then the traces aren't of the
+ * two apps of one lane.
+ */
+inline std::array<ReplayedParty, 2> replayTrafficTraces(
+    const TrafficTrace& publisher,
+    const TrafficTrace& partner,
+    const ReplayNetwork& network) {
+  std::array<detail::ReplayState, 2> parties;
+  parties[0].trace = &publisher;
+  parties[1].trace = &partner;
+  auto isDone = [&parties]() {
+    return parties[0].next == parties[0].trace->events.size() &&
+        parties[1].next == parties[1].trace->events.size();
+  };
+  while (!isDone()) {
+    auto progressed =
+        detail::replayUntilBlocked(parties[0], parties[1], network);
+    progressed |= detail::replayUntilBlocked(parties[1], parties[0], network);
+    if (!progressed) {
+      throw std::runtime_error(
+          "The traffic traces don't match, as both parties wait for a message "
+          "the other one never sends");
+    }
+  }
+
+  std::array<ReplayedParty, 2> results;
+  for (std::size_t i = 0; i < parties.size(); ++i) {
+    results[i] = std::move(parties[i].result);
+    results[i].wallSeconds = parties[i].clock;
+  }
+  return results;
+}
+
+} // namespace common
@@ -0,0 +1,17 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "fbpcs/emp_games/common/TrafficTrace.h"
+
+#include <gflags/gflags.h>
+
+DEFINE_string(
+    traffic_trace_dir,
+    "",
+    "If set, the sizes and times of the messages every app sends and "
+    "receives are written to a trace per app in this directory, for "
+    "traffic_replay");
@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <folly/Format.h>
+#include <gflags/gflags_declare.h>
+
+#include "fbpcf/engine/communication/IPartyCommunicationAgent.h"
+#include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
+#include "fbpcf/util/MetricCollector.h"
+#include "fbpcs/performance_tools/PhaseProfiler.h"
+
+DECLARE_string(traffic_trace_dir);
+
+/*
+Traces of the traffic of the apps, for finding out offline whether a slow run
+was held up by the network, its own computation or the other party. The agents
+of a RecordingAgentFactory wrap the agents of another factory and write the
+size, start and end of every send and receive of all of them to one trace per
+app, with the phase (ScopedPhase) running on the thread which made it. Only
+sizes and times are written, never the bytes sent, so that the parties can
+hand their traces to each other.
+
+A trace is laid out as the magic "MPCTRACE", a uint32 version, then records
+which start with their type:
+
+  'P' a phase: phase uint16, name length uint16, the name
+  'S' or 'R' a send or receive: agent uint16, phase uint16, bytes uint32,
+      start uint64, end uint64, in ns since the app created its factory
+
+Both parties create the agents of an app in the same order, so agent k of the
+trace of a publisher app talks to agent k of the trace of its partner app.
+*/
+namespace common {
+
+struct TrafficEvent {
+  enum class Kind : uint8_t { kSend = 'S', kReceive = 'R' };
+
+  Kind kind;
+  uint16_t agent;
+  uint16_t phase;
+  uint32_t bytes;
+  uint64_t startNs;
+  uint64_t endNs;
+};
+
+struct TrafficTrace {
+  static constexpr char kMagic[] = "MPCTRACE";
+  static constexpr uint32_t kVersion = 1;
+
+  // The names of the phases, by their index in the events
+  std::vector<std::string> phases;
+  std::vector<TrafficEvent> events;
+
+  static TrafficTrace read(const std::string& path) {
+    std::ifstream in{path, std::ios::binary};
+    if (!in) {
+      throw std::runtime_error("Could not open the traffic trace " + path);
+    }
+    char magic[sizeof(kMagic) - 1];
+    uint32_t version = 0;
+    if (!in.read(magic, sizeof(magic)) ||
+        std::string(magic, sizeof(magic)) != kMagic ||
+        !readValue(in, version) || version != kVersion) {
+      throw std::runtime_error(path + " is not a traffic trace");
+    }
+
+    TrafficTrace trace;
+    char type;
+    while (in.get(type)) {
+      if (type == 'P') {
+        uint16_t phase;
+        uint16_t length;
+        readOrThrow(in, phase, path);
+        readOrThrow(in, length, path);
+        std::string name(length, '\0');
+        if (!in.read(name.data(), length)) {
+          throw std::runtime_error("Truncated traffic trace " + path);
+        }
+        if (trace.phases.size() <= phase) {
+          trace.phases.resize(phase + 1);
+        }
+        trace.phases[phase] = std::move(name);
+      } else if (type == 'S' || type == 'R') {
+        TrafficEvent event;
+        event.kind = static_cast<TrafficEvent::Kind>(type);
+        readOrThrow(in, event.agent, path);
+        readOrThrow(in, event.phase, path);
+        readOrThrow(in, event.bytes, path);
+        readOrThrow(in, event.startNs, path);
+        readOrThrow(in, event.endNs, path);
+        if (event.phase >= trace.phases.size()) {
+          throw std::runtime_error(
+              "Traffic trace " + path + " has an event of an unknown phase");
+        }
+        trace.events.push_back(event);
+      } else {
+        throw std::runtime_error(folly::sformat(
+            "Unknown record type {} in the traffic trace {}",
+            static_cast<int>(type),
+            path));
+      }
+    }
+    return trace;
+  }
+
+ private:
+  template <typename T>
+  static bool readValue(std::istream& in, T& value) {
+    return static_cast<bool>(
+        in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+  }
+
+  template <typename T>
+  static void
+  readOrThrow(std::istream& in, T& value, const std::string& path) {
+    if (!readValue(in, value)) {
+      throw std::runtime_error("Truncated traffic trace " + path);
+    }
+  }
+};
+
+// Writes the trace of the agents of one app, which may be used from several
+// threads
+class TrafficTraceWriter {
+ public:
+  explicit TrafficTraceWriter(const std::string& path)
+      : out_{path, std::ios::binary | std::ios::trunc},
+        epoch_{std::chrono::steady_clock::now()} {
+    if (!out_) {
+      throw std::runtime_error("Could not create the traffic trace " + path);
+    }
+    out_.write(TrafficTrace::kMagic, sizeof(TrafficTrace::kMagic) - 1);
+    writeValue(TrafficTrace::kVersion);
+  }
+
+  uint16_t addAgent() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return numAgents_++;
+  }
+
+  // Records a send or receive of agent, made in the phase running on the
+  // calling thread
+  void record(
+      TrafficEvent::Kind kind,
+      uint16_t agent,
+      std::size_t bytes,
+      std::chrono::steady_clock::time_point start,
+      std::chrono::steady_clock::time_point end) {
+    const auto& phaseName =
+        fbpcs::performance_tools::ScopedPhase::getCurrentName();
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto phase = getPhase(phaseName);
+    out_.put(static_cast<char>(kind));
+    writeValue(agent);
+    writeValue(phase);
+    writeValue(static_cast<uint32_t>(bytes));
+    writeValue(toNs(start));
+    writeValue(toNs(end));
+  }
+
+ private:
+  // The index of a phase, which is written when first seen
+  uint16_t getPhase(const std::string& name) {
+    auto [it, inserted] = phases_.try_emplace(name, phases_.size());
+    if (inserted) {
+      out_.put('P');
+      writeValue(it->second);
+      writeValue(static_cast<uint16_t>(name.size()));
+      out_.write(name.data(), name.size());
+    }
+    return it->second;
+  }
+
+  uint64_t toNs(std::chrono::steady_clock::time_point time) const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time - epoch_)
+        .count();
+  }
+
+  template <typename T>
+  void writeValue(T value) {
+    out_.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  std::mutex mutex_;
+  std::ofstream out_;
+  std::chrono::steady_clock::time_point epoch_;
+  std::unordered_map<std::string, uint16_t> phases_;
+  uint16_t numAgents_ = 0;
+};
+
+// Calls the protected sendImpl and recvImpl of another agent, so that an agent
+// wrapping it can pass the buffers it is given through without copying them
+// into vectors. Never instantiated: naming the members through a class
+// derived from the agent interface is what makes them accessible.
+struct ForwardingAgentAccess
+    : fbpcf::engine::communication::IPartyCommunicationAgent {
+  static void sendRaw(
+      fbpcf::engine::communication::IPartyCommunicationAgent& agent,
+      const void* data,
+      int nBytes) {
+    (agent.*&ForwardingAgentAccess::sendImpl)(data, nBytes);
+  }
+
+  static void recvRaw(
+      fbpcf::engine::communication::IPartyCommunicationAgent& agent,
+      void* data,
+      int nBytes) {
+    (agent.*&ForwardingAgentAccess::recvImpl)(data, nBytes);
+  }
+};
+
+class RecordingAgent
+    : public fbpcf::engine::communication::IPartyCommunicationAgent {
+ public:
+  RecordingAgent(
+      std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+          agent,
+      std::shared_ptr<TrafficTraceWriter> writer)
+      : agent_{std::move(agent)},
+        writer_{std::move(writer)},
+        id_{writer_->addAgent()} {}
+
+  void send(const std::vector<unsigned char>& data) override {
+    auto start = std::chrono::steady_clock::now();
+    agent_->send(data);
+    record(TrafficEvent::Kind::kSend, data.size(), start);
+  }
+
+  std::vector<unsigned char> receive(size_t size) override {
+    auto start = std::chrono::steady_clock::now();
+    auto data = agent_->receive(size);
+    record(TrafficEvent::Kind::kReceive, size, start);
+    return data;
+  }
+
+  std::pair<uint64_t, uint64_t> getTrafficStatistics() const override {
+    return agent_->getTrafficStatistics();
+  }
+
+ protected:
+  void sendImpl(const void* data, int nBytes) override {
+    auto start = std::chrono::steady_clock::now();
+    ForwardingAgentAccess::sendRaw(*agent_, data, nBytes);
+    record(TrafficEvent::Kind::kSend, nBytes, start);
+  }
+
+  void recvImpl(void* data, int nBytes) override {
+    auto start = std::chrono::steady_clock::now();
+    ForwardingAgentAccess::recvRaw(*agent_, data, nBytes);
+    record(TrafficEvent::Kind::kReceive, nBytes, start);
+  }
+
+ private:
+  void record(
+      TrafficEvent::Kind kind,
+      std::size_t bytes,
+      std::chrono::steady_clock::time_point start) {
+    writer_->record(kind, id_, bytes, start, std::chrono::steady_clock::now());
+  }
+
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+      agent_;
+  std::shared_ptr<TrafficTraceWriter> writer_;
+  uint16_t id_;
+};
+
+class RecordingAgentFactory
+    : public fbpcf::engine::communication::IPartyCommunicationAgentFactory {
+ public:
+  RecordingAgentFactory(
+      std::unique_ptr<
+          fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+          factory,
+      const std::string& tracePath,
+      std::shared_ptr<fbpcf::util::MetricCollector> metricCollector)
+      : fbpcf::engine::communication::IPartyCommunicationAgentFactory(
+            "recorded_traffic",
+            metricCollector),
+        factory_{std::move(factory)},
+        writer_{std::make_shared<TrafficTraceWriter>(tracePath)} {}
+
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>
+  create(int id, std::string name) override {
+    return std::make_unique<RecordingAgent>(
+        factory_->create(id, std::move(name)), writer_);
+  }
+
+ private:
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+      factory_;
+  std::shared_ptr<TrafficTraceWriter> writer_;
+};
+
+// The trace of the app of a party on a lane of a stage, in traffic_trace_dir,
+// or an empty path if traces aren't recorded. The traces of the two apps of a
+// lane only differ by their party.
+inline std::string
+getTrafficTracePath(const std::string& stage, int party, std::size_t lane) {
+  if (FLAGS_traffic_trace_dir.empty()) {
+    return "";
+  }
+  return folly::sformat(
+      "{}/{}_lane{}_party{}.mpctrace",
+      FLAGS_traffic_trace_dir,
+      stage,
+      lane,
+      party);
+}
+
+// Records the traffic of the agents of factory to tracePath, if it isn't empty
+inline std::unique_ptr<
+    fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+recordTraffic(
+    std::unique_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory> factory,
+    const std::string& tracePath,
+    std::shared_ptr<fbpcf::util::MetricCollector> metricCollector) {
+  if (tracePath.empty()) {
+    return factory;
+  }
+  return std::make_unique<RecordingAgentFactory>(
+      std::move(factory), tracePath, std::move(metricCollector));
+}
+
+} // namespace common
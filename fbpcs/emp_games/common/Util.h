@@ -7,9 +7,13 @@
 
 #pragma once
 
+#include <algorithm>
+#include <charconv>
 #include <cstdlib>
 #include <memory>
 #include <sstream>
+#include <string_view>
+#include <type_traits>
 
 #include "folly/dynamic.h"
 #include "folly/logging/xlog.h"
@@ -17,42 +21,60 @@
 #include "fbpcf/engine/communication/SocketPartyCommunicationAgent.h"
 #include "fbpcf/frontend/mpcGame.h"
 #include "fbpcs/emp_games/common/Csv.h"
+#include "fbpcs/emp_games/common/MetricsRegistry.h"
 #include "fbpcs/emp_games/common/SchedulerStatistics.h"
 
 namespace common {
 
-// utility method used for parsing string information to vector of type T.
+// Parses the values of an array cell such as `[1, 2, 3]` with std::from_chars
+// and appends them to `out`, without building intermediate strings.
 template <typename T>
-static const std::vector<T> getInnerArray(const std::string& str) {
-  // Strip the brackets [] before splitting into individual timestamp values
-  auto innerString = str;
-  innerString.erase(
-      std::remove(innerString.begin(), innerString.end(), '['),
-      innerString.end());
-  innerString.erase(
-      std::remove(innerString.begin(), innerString.end(), ']'),
-      innerString.end());
-  auto innerVals = private_measurement::csv::splitByComma(innerString, false);
+void appendInnerArray(std::string_view str, std::vector<T>& out) {
+  auto isSkipped = [](char c) { return c == ' ' || c == '[' || c == ']'; };
 
-  std::vector<T> out;
+  size_t pos = 0;
+  while (pos < str.size()) {
+    auto end = std::min(str.find(',', pos), str.size());
+    auto begin = pos;
+    while (begin < end && isSkipped(str[begin])) {
+      ++begin;
+    }
+    auto last = end;
+    while (last > begin && isSkipped(str[last - 1])) {
+      --last;
+    }
+    if (begin == last) {
+      // an empty element ends the array, the same as csv::splitInnerArray
+      break;
+    }
 
-  for (const auto& innerVal : innerVals) {
-    if (!innerVal.empty()) {
+    const char* first = str.data() + begin;
+    const char* lastChar = str.data() + last;
+    if constexpr (std::is_same_v<T, bool>) {
+      uint64_t parsed = 0;
+      std::from_chars(first, lastChar, parsed);
+      out.push_back(parsed != 0);
+    } else {
       T parsed = 0;
-      std::istringstream iss{innerVal};
-      if (std::is_unsigned<T>::value & (iss.peek() == '-')) {
+      if (std::is_unsigned<T>::value && *first == '-') {
         // convert negative inputs to zero
-        iss.ignore();
         T parsedNegative = 0;
-        iss >> parsedNegative;
+        std::from_chars(first + 1, lastChar, parsedNegative);
         XLOGF(ERR, "Error: input is negative {}", parsedNegative);
       } else {
-        iss >> parsed;
+        std::from_chars(first, lastChar, parsed);
       }
       out.push_back(parsed);
     }
+    pos = end + 1;
   }
+}
 
+// utility method used for parsing string information to vector of type T.
+template <typename T>
+static const std::vector<T> getInnerArray(const std::string& str) {
+  std::vector<T> out;
+  appendInnerArray(str, out);
   return out;
 }
 
@@ -130,13 +152,11 @@ template <typename T>
 std::vector<T>
 padArray(const std::vector<T>& inputArray, size_t size, T paddingValue) {
   std::vector<T> paddedInput;
-  for (size_t i = 0; i < size; ++i) {
-    if (i < inputArray.size()) {
-      paddedInput.push_back(inputArray.at(i));
-    } else {
-      paddedInput.push_back(paddingValue);
-    }
-  }
+  paddedInput.reserve(size);
+  paddedInput.assign(
+      inputArray.begin(),
+      inputArray.begin() + std::min(inputArray.size(), size));
+  paddedInput.resize(size, paddingValue);
   return paddedInput;
 }
 
@@ -147,20 +167,12 @@ std::vector<std::vector<T>> padNestedArrays(
     size_t numCols,
     T paddingValue) {
   std::vector<std::vector<T>> paddedArrays;
-  paddedArrays.reserve(numRows);
-  for (size_t i = 0; i < inputArrays.size(); ++i) {
-    std::vector<T> paddedArray(numCols);
-    for (int j = 0; j < inputArrays[i].size(); j++) {
-      paddedArray[j] = inputArrays[i][j];
-    }
-
-    for (int j = inputArrays[i].size(); j < numCols; j++) {
-      paddedArray[j] = paddingValue;
-    }
-    paddedArrays.push_back(paddedArray);
+  paddedArrays.reserve(std::max(numRows, inputArrays.size()));
+  for (auto& inputArray : inputArrays) {
+    paddedArrays.push_back(padArray(inputArray, numCols, paddingValue));
   }
   for (size_t i = inputArrays.size(); i < numRows; ++i) {
-    paddedArrays.push_back(std::vector<T>(numCols, paddingValue));
+    paddedArrays.emplace_back(numCols, paddingValue);
   }
   return paddedArrays;
 }
@@ -175,10 +187,36 @@ O privatelyShareArrayWithPaddingFrom(
     const std::vector<T>& inputArray,
     size_t size,
     T paddingValue) {
+  // Only copy the input when it has to be padded or cut
+  if (inputArray.size() == size) {
+    return O{inputArray, sender};
+  }
   auto paddedInput = padArray(inputArray, size, paddingValue);
   return O{paddedInput, sender};
 }
 
+namespace detail {
+
+// Fills column with the values of column i of inputArrays, of dimension
+// numRows by numCols, reusing its allocation
+template <typename T>
+void fillTransposedColumn(
+    const std::vector<std::vector<T>>& inputArrays,
+    size_t i,
+    size_t numRows,
+    T paddingValue,
+    std::vector<T>& column) {
+  column.assign(numRows, paddingValue);
+  auto numInputRows = std::min(numRows, inputArrays.size());
+  for (size_t j = 0; j < numInputRows; ++j) {
+    if (inputArrays[j].size() > i) {
+      column[j] = inputArrays[j][i];
+    }
+  }
+}
+
+} // namespace detail
+
 /**
  * Convert input arrays of dimension numRows by numCols to its transpose, of
  * dimension numCols by numRows. If the input has a different size, resize the
@@ -190,17 +228,10 @@ std::vector<std::vector<T>> transposeArraysWithPadding(
     size_t numRows,
     size_t numCols,
     T paddingValue) {
-  std::vector<std::vector<T>> outputArrays;
+  std::vector<std::vector<T>> outputArrays(numCols);
   for (size_t i = 0; i < numCols; ++i) {
-    std::vector<T> outputArray;
-    for (size_t j = 0; j < numRows; ++j) {
-      if (inputArrays.size() > j && inputArrays.at(j).size() > i) {
-        outputArray.push_back(inputArrays.at(j).at(i));
-      } else {
-        outputArray.push_back(paddingValue);
-      }
-    }
-    outputArrays.push_back(std::move(outputArray));
+    detail::fillTransposedColumn(
+        inputArrays, i, numRows, paddingValue, outputArrays[i]);
   }
   return outputArrays;
 }
@@ -214,8 +245,7 @@ std::vector<std::vector<T>> transpose(const std::vector<std::vector<T>>& data) {
 
   result.reserve(data[0].size());
   for (size_t column = 0; column < data[0].size(); column++) {
-    std::vector<T> innerArray(data.size());
-    result.push_back(std::vector<T>(data.size()));
+    result.emplace_back(data.size());
     for (size_t row = 0; row < data.size(); row++) {
       result[column][row] = data[row][column];
     }
@@ -226,9 +256,10 @@ std::vector<std::vector<T>> transpose(const std::vector<std::vector<T>>& data) {
 /**
  * Privately share tranposed array of arrays of type T from sender, with batch
  * output type O. The input arrays have dimension numRows by numCols, and are
- * first tranposed before sharing. If the input has a different size, resize the
- * transposed arrays accordingly and fill up additional entries with
- * paddingValue.
+ * tranposed one column at a time into a single buffer, which is shared before
+ * the next column is written to it, so the whole transpose is never held in
+ * memory. If the input has a different size, resize the transposed arrays
+ * accordingly and fill up additional entries with paddingValue.
  */
 template <int sender, typename T, typename O>
 std::vector<O> privatelyShareTransposedArraysWithPaddingFrom(
@@ -236,11 +267,37 @@ std::vector<O> privatelyShareTransposedArraysWithPaddingFrom(
     size_t numRows,
     size_t numCols,
     T paddingValue) {
-  auto transposedInputArrays = transposeArraysWithPadding<T>(
-      inputArrays, numRows, numCols, paddingValue);
   std::vector<O> output;
-  for (auto& transposedInputArray : transposedInputArrays) {
-    output.push_back(O{transposedInputArray, sender});
+  output.reserve(numCols);
+  std::vector<T> column;
+  for (size_t i = 0; i < numCols; ++i) {
+    detail::fillTransposedColumn(inputArrays, i, numRows, paddingValue, column);
+    output.push_back(O{column, sender});
+  }
+  return output;
+}
+
+/**
+ * Privately share arrays of type T from sender, with batch output type O. The
+ * input arrays are already columns, of dimension numCols by numRows, so they
+ * are shared as they are. If the input has a different size, resize the
+ * arrays accordingly and fill up additional entries with paddingValue.
+ */
+template <int sender, typename T, typename O>
+std::vector<O> privatelyShareArraysWithPaddingFrom(
+    const std::vector<std::vector<T>>& inputArrays,
+    size_t numRows,
+    size_t numCols,
+    T paddingValue) {
+  std::vector<O> output;
+  output.reserve(numCols);
+  for (size_t i = 0; i < numCols; ++i) {
+    if (i < inputArrays.size()) {
+      output.push_back(privatelyShareArrayWithPaddingFrom<sender, T, O>(
+          inputArrays[i], numRows, paddingValue));
+    } else {
+      output.push_back(O{std::vector<T>(numRows, paddingValue), sender});
+    }
   }
   return output;
 }
@@ -296,7 +353,8 @@ inline folly::dynamic getCostExtraInfo(
       "free_gates", schedulerStatistics.freeGates)(
       "scheduler_transmitted_network", schedulerStatistics.sentNetwork)(
       "scheduler_received_network", schedulerStatistics.receivedNetwork)(
-      "mpc_traffic_details", schedulerStatistics.details);
+      "mpc_traffic_details", schedulerStatistics.details)(
+      "metrics", MetricsRegistry::getInstance().toDynamic());
 }
 
 } // namespace common
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fbpcs/emp_games/common/AttributionShareFormat.h"
+
+namespace private_measurement::attribution_shares {
+
+static std::vector<RuleShares> makeShares() {
+  RuleShares lastClick{"last_click_1d", false, 3, 3};
+  lastClick.isAttributed = {1, 0, 0, 0, 1, 1, 0, 0, 0};
+  RuleShares lastTouch{"last_touch_1d", true, 2, 2};
+  lastTouch.isAttributed = {0, 1, 1, 0};
+  lastTouch.adIds = {0, 3, 65535, 1};
+  lastTouch.convValues = {0, 20, 4294967295, 7};
+  RuleShares noUsers{"no_users", false, 0, 4};
+  return {lastClick, lastTouch, noUsers};
+}
+
+TEST(AttributionShareFormatTest, TestRoundTrip) {
+  auto shares = makeShares();
+  auto content = encode(shares);
+  EXPECT_TRUE(hasMagic(content));
+  EXPECT_EQ(shares, decode(content));
+}
+
+TEST(AttributionShareFormatTest, TestIsAttributedIsBitPacked) {
+  std::vector<RuleShares> shares{{"rule", false, 100, 4}};
+  shares[0].isAttributed.resize(400, true);
+  auto content = encode(shares);
+  // The header of the rule, then 400 bits
+  EXPECT_EQ(kMagic.size() + 4 + 4 + 4 + 1 + 8 + 4 + 50, content.size());
+  EXPECT_EQ(shares, decode(content));
+}
+
+TEST(AttributionShareFormatTest, TestMismatchedSharesThrow) {
+  auto shares = makeShares();
+  shares[1].adIds.pop_back();
+  EXPECT_THROW(encode(shares), std::invalid_argument);
+
+  shares = makeShares();
+  shares[0].isAttributed.push_back(true);
+  EXPECT_THROW(encode(shares), std::invalid_argument);
+}
+
+TEST(AttributionShareFormatTest, TestMalformedContentThrows) {
+  auto content = encode(makeShares());
+  EXPECT_THROW(decode("{\"last_click_1d\": {}}"), std::runtime_error);
+  EXPECT_THROW(
+      decode(content.substr(0, content.size() - 1)), std::runtime_error);
+  EXPECT_THROW(decode(content + "x"), std::runtime_error);
+}
+
+} // namespace private_measurement::attribution_shares
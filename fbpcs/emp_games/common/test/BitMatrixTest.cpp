@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "fbpcs/emp_games/common/BitMatrix.h"
+
+namespace common {
+
+TEST(BitMatrixTest, TestRowsArePackedIntoWords) {
+  BitMatrix matrix{2, 70};
+  EXPECT_EQ(2, matrix.getNumRows());
+  EXPECT_EQ(70, matrix.getNumCols());
+  EXPECT_EQ(2, matrix.getWordsPerRow());
+
+  matrix.set(0, 1, true);
+  matrix.set(1, 65, true);
+  matrix.set(1, 3, true);
+  matrix.set(1, 3, false);
+  EXPECT_EQ(0b10, matrix.rowWords(0)[0]);
+  EXPECT_EQ(0, matrix.rowWords(1)[0]);
+  EXPECT_EQ(0b10, matrix.rowWords(1)[1]);
+  EXPECT_TRUE(matrix.get(1, 65));
+  EXPECT_FALSE(matrix.get(0, 65));
+
+  matrix.setRow(0, std::vector<bool>{true, false, true});
+  EXPECT_EQ(0b101, matrix.rowWords(0)[0]);
+  EXPECT_EQ(70, matrix.getRow(0).size());
+  EXPECT_THROW(
+      matrix.setRow(0, std::vector<bool>(71, true)), std::invalid_argument);
+}
+
+TEST(BitMatrixTest, TestBitsRoundTrip) {
+  std::vector<bool> bits{true, false, false, true, true, true};
+  auto matrix = BitMatrix::fromBits(bits, 0, 2, 3);
+  EXPECT_EQ((std::vector<bool>{true, false, false}), matrix.getRow(0));
+  EXPECT_EQ((std::vector<bool>{true, true, true}), matrix.getRow(1));
+  EXPECT_EQ(bits, matrix.toBits());
+
+  auto offsetMatrix = BitMatrix::fromBits(bits, 2, 2, 2);
+  EXPECT_EQ(
+      (std::vector<bool>{false, true, true, true}), offsetMatrix.toBits());
+}
+
+TEST(BitMatrixTest, TestIntsRoundTrip) {
+  std::vector<int64_t> values{-5, 7, 0, -1};
+  auto matrix = BitMatrix::fromInts(values, 32);
+  EXPECT_EQ(values, matrix.toInts<int64_t>());
+  EXPECT_EQ(
+      (std::vector<uint64_t>{0xFFFFFFFB, 7, 0, 0xFFFFFFFF}),
+      matrix.toInts<uint64_t>());
+  EXPECT_EQ(values, BitMatrix::fromInts(values, 64).toInts<int64_t>());
+  EXPECT_THROW(BitMatrix::fromInts(values, 65), std::invalid_argument);
+}
+
+TEST(BitMatrixTest, TestTransposeMovesEveryBit) {
+  std::mt19937_64 random{42};
+  // Sizes on both sides of the 64 bit blocks
+  for (size_t numRows : {0, 1, 63, 64, 65, 130}) {
+    for (size_t numCols : {1, 7, 64, 100}) {
+      BitMatrix matrix{numRows, numCols};
+      for (size_t i = 0; i < numRows; ++i) {
+        for (size_t j = 0; j < numCols; ++j) {
+          matrix.set(i, j, random() & 1);
+        }
+      }
+      auto transposed = matrix.transpose();
+      ASSERT_EQ(numCols, transposed.getNumRows());
+      ASSERT_EQ(numRows, transposed.getNumCols());
+      for (size_t i = 0; i < numRows; ++i) {
+        for (size_t j = 0; j < numCols; ++j) {
+          EXPECT_EQ(matrix.get(i, j), transposed.get(j, i));
+        }
+      }
+      EXPECT_EQ(matrix.toBits(), transposed.transpose().toBits());
+    }
+  }
+}
+
+TEST(BitMatrixTest, TestTransposeSlicesIntsIntoBits) {
+  // Each row of the transpose holds one bit of every value
+  auto bits = BitMatrix::fromInts(std::vector<uint32_t>{0b01, 0b11, 0b10}, 2)
+                  .transpose();
+  EXPECT_EQ((std::vector<bool>{true, true, false}), bits.getRow(0));
+  EXPECT_EQ((std::vector<bool>{false, true, true}), bits.getRow(1));
+  EXPECT_EQ(
+      (std::vector<uint32_t>{0b01, 0b11, 0b10}),
+      bits.transpose().toInts<uint32_t>());
+}
+
+} // namespace common
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "folly/Random.h"
+
+#include "fbpcs/emp_games/common/CompressedIO.h"
+#include "fbpcs/emp_games/common/Csv.h"
+
+namespace private_measurement::compressed_io {
+
+class CompressedIOTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    basePath_ = (std::filesystem::temp_directory_path() /
+                 ("CompressedIOTest_" +
+                  std::to_string(folly::Random::rand32())))
+                    .native();
+  }
+
+  void TearDown() override {
+    for (auto suffix : {"", ".zst", ".lz4", ".csv"}) {
+      std::filesystem::remove(basePath_ + suffix);
+    }
+  }
+
+  static std::string readRaw(const std::string& path) {
+    std::ifstream in{path, std::ios::binary};
+    return std::string{
+        std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+  }
+
+  // Spans several frames, with a last one which is only partly filled
+  static std::string makeContent() {
+    std::string content;
+    for (size_t i = 0; content.size() < kFrameSize * 3 + 100; ++i) {
+      content += std::to_string(i) + ",[1,2,3]," + std::to_string(i * 7) + "\n";
+    }
+    return content;
+  }
+
+  std::string basePath_;
+};
+
+TEST_F(CompressedIOTest, TestCodecIsChosenBySuffix) {
+  EXPECT_EQ(Codec::kZstd, getCodecForPath("s3://bucket/shard_0.zst"));
+  EXPECT_EQ(Codec::kLz4, getCodecForPath("/tmp/out.lz4"));
+  EXPECT_EQ(Codec::kNone, getCodecForPath("/tmp/out.csv"));
+  EXPECT_EQ(Codec::kNone, getCodecForPath("zst"));
+  EXPECT_EQ(Codec::kLz4, parseCodec("lz4"));
+  EXPECT_THROW(parseCodec("gzip"), std::invalid_argument);
+}
+
+TEST_F(CompressedIOTest, TestRoundTrip) {
+  auto content = makeContent();
+  for (auto suffix : {".zst", ".lz4"}) {
+    auto path = basePath_ + suffix;
+    writeFile(path, content);
+    EXPECT_TRUE(hasMagic(readRaw(path)));
+    EXPECT_EQ(content, readFile(path));
+  }
+}
+
+TEST_F(CompressedIOTest, TestEmptyRoundTrip) {
+  auto path = basePath_ + ".zst";
+  writeFile(path, "");
+  EXPECT_TRUE(hasMagic(readRaw(path)));
+  auto reader = makeFileReader(path);
+  EXPECT_TRUE(reader->eof());
+  reader->close();
+}
+
+TEST_F(CompressedIOTest, TestUncompressedFilesAreReadUnchanged) {
+  auto content = makeContent();
+  writeFile(basePath_, content);
+  EXPECT_EQ(content, readRaw(basePath_));
+  EXPECT_EQ(content, readFile(basePath_));
+
+  writeFile(basePath_, "short");
+  EXPECT_EQ("short", readFile(basePath_));
+}
+
+TEST_F(CompressedIOTest, TestTruncatedFileThrows) {
+  auto path = basePath_ + ".lz4";
+  writeFile(path, makeContent());
+  auto bytes = readRaw(path);
+  {
+    std::ofstream out{path, std::ios::binary | std::ios::trunc};
+    out << bytes.substr(0, bytes.size() / 2);
+  }
+  EXPECT_THROW(readFile(path), std::runtime_error);
+}
+
+TEST_F(CompressedIOTest, TestTransferFileCompressesDestination) {
+  auto content = makeContent();
+  writeFile(basePath_, content);
+  transferFile(basePath_, basePath_ + ".zst");
+  EXPECT_TRUE(hasMagic(readRaw(basePath_ + ".zst")));
+  EXPECT_EQ(content, readFile(basePath_ + ".zst"));
+
+  transferFile(basePath_ + ".zst", basePath_ + ".csv");
+  // Only the destination suffix chooses the codec, so this is copied as is
+  EXPECT_EQ(readRaw(basePath_ + ".zst"), readRaw(basePath_ + ".csv"));
+}
+
+// Accepts every write and fails to close
+class FailingToCloseWriter final : public fbpcf::io::IWriterCloser {
+ public:
+  size_t write(std::vector<char>& buf) override {
+    return buf.size();
+  }
+
+  int close() override {
+    throw std::runtime_error("close failed");
+  }
+};
+
+TEST_F(CompressedIOTest, TestCompressingWriterDestructorDoesNotThrow) {
+  std::vector<char> buf{'a', 'b', 'c'};
+  {
+    CompressingWriter writer{
+        std::make_unique<FailingToCloseWriter>(), Codec::kZstd};
+    writer.write(buf);
+    EXPECT_THROW(writer.close(), std::runtime_error);
+  }
+  // A failure to close an unclosed writer is only logged
+  EXPECT_NO_THROW({
+    CompressingWriter writer{
+        std::make_unique<FailingToCloseWriter>(), Codec::kLz4};
+    writer.write(buf);
+  });
+}
+
+TEST_F(CompressedIOTest, TestOutputFileStreamAppearsOnCommit) {
+  auto content = makeContent();
+  writeFile(basePath_, "previous");
+  {
+    OutputFileStream out{basePath_};
+    out << content;
+    out.flush();
+    // Until commit, the destination is unchanged
+    EXPECT_EQ("previous", readRaw(basePath_));
+    out.commit();
+  }
+  EXPECT_EQ(content, readRaw(basePath_));
+
+  OutputFileStream compressed{basePath_ + ".zst"};
+  compressed << content;
+  compressed.commit();
+  EXPECT_TRUE(hasMagic(readRaw(basePath_ + ".zst")));
+  EXPECT_EQ(content, readFile(basePath_ + ".zst"));
+  EXPECT_THROW(compressed.commit(), std::runtime_error);
+}
+
+TEST_F(CompressedIOTest, TestOutputFileStreamWithoutCommitPublishesNothing) {
+  auto directory = std::filesystem::path{basePath_}.parent_path();
+  auto countFiles = [&directory]() {
+    return std::distance(
+        std::filesystem::directory_iterator{directory},
+        std::filesystem::directory_iterator{});
+  };
+  auto numFiles = countFiles();
+  {
+    OutputFileStream out{basePath_};
+    out << makeContent();
+  }
+  EXPECT_FALSE(std::filesystem::exists(basePath_));
+
+  OutputFileStream out{basePath_};
+  out << "abc";
+  out.discard();
+  EXPECT_FALSE(std::filesystem::exists(basePath_));
+  EXPECT_EQ(numFiles, countFiles());
+  out << "def";
+  EXPECT_TRUE(out.fail());
+}
+
+TEST_F(CompressedIOTest, TestPrefetchingReaderReadsEveryPart) {
+  auto content = makeContent();
+  auto readRange = [&content](size_t start, size_t end) {
+    return content.substr(start, end - start);
+  };
+  // Parts that don't divide the file, fewer and more of them than are fetched
+  // ahead, and a read buffer spanning several parts
+  std::vector<std::pair<size_t, size_t>> partSizesAndPartsAhead{
+      {1000, 3}, {kFrameSize, 8}, {content.size(), 2}, {content.size() / 3, 1}};
+  for (auto [partSize, partsAhead] : partSizesAndPartsAhead) {
+    PrefetchingReader reader{readRange, content.size(), partSize, partsAhead};
+    std::string read;
+    std::vector<char> buf(2500);
+    while (!reader.eof()) {
+      buf.resize(2500);
+      buf.resize(reader.read(buf));
+      read.append(buf.data(), buf.size());
+    }
+    reader.close();
+    EXPECT_EQ(content, read);
+  }
+
+  PrefetchingReader empty{readRange, 0};
+  EXPECT_TRUE(empty.eof());
+}
+
+TEST_F(CompressedIOTest, TestPrefetchingReaderDecompresses) {
+  auto path = basePath_ + ".zst";
+  auto content = makeContent();
+  writeFile(path, content);
+  auto bytes = readRaw(path);
+  DecompressingReader reader{std::make_unique<PrefetchingReader>(
+      [&bytes](size_t start, size_t end) {
+        // A range including its end byte is cut back to the requested size
+        return bytes.substr(start, end + 1 - start);
+      },
+      bytes.size(),
+      4096)};
+  std::string read;
+  std::vector<char> buf(kFrameSize);
+  while (!reader.eof()) {
+    buf.resize(kFrameSize);
+    buf.resize(reader.read(buf));
+    read.append(buf.data(), buf.size());
+  }
+  EXPECT_EQ(content, read);
+}
+
+TEST_F(CompressedIOTest, TestPrefetchingReaderThrowsOnShortRead) {
+  PrefetchingReader reader{
+      [](size_t start, size_t end) {
+        return std::string(end - start - 1, 'a');
+      },
+      100};
+  EXPECT_THROW(reader.eof(), std::runtime_error);
+}
+
+TEST_F(CompressedIOTest, TestCsvReadersDecompress) {
+  auto path = basePath_ + ".zst";
+  std::vector<std::string> header = {"id_", "values", "value"};
+  std::vector<std::vector<std::string>> rows = {
+      {"abc", "[1,2,3]", "10"}, {"def", "[4,5,6]", "20"}};
+  csv::writeCsv(path, header, rows);
+  EXPECT_TRUE(hasMagic(readRaw(path)));
+
+  EXPECT_EQ(2, csv::countCsvRows(path));
+  std::vector<std::string> readHeader;
+  std::vector<std::vector<std::string>> readRows;
+  csv::readCsv(
+      path,
+      [&](const std::vector<std::string>& rowHeader,
+          const std::vector<std::string>& parts) {
+        readHeader = rowHeader;
+        readRows.push_back(parts);
+      });
+  EXPECT_EQ(header, readHeader);
+  EXPECT_EQ(rows, readRows);
+
+  std::vector<std::vector<std::string>> chunkedRows;
+  csv::readCsvViewsInChunks(
+      path,
+      4,
+      [&](size_t chunk,
+          const std::vector<std::string>&,
+          const std::vector<std::string_view>& parts) {
+        EXPECT_EQ(0, chunk);
+        chunkedRows.emplace_back(parts.begin(), parts.end());
+      });
+  EXPECT_EQ(rows, chunkedRows);
+}
+
+TEST_F(CompressedIOTest, TestCsvReadersReadPastTheSniffedBytes) {
+  // Longer than the bytes read to find out whether the file is in the row
+  // group format, which are read again as the start of the csv
+  auto path = basePath_ + ".zst";
+  std::vector<std::string> header = {"id_", "value"};
+  std::vector<std::vector<std::string>> rows;
+  for (int i = 0; i < 200000; ++i) {
+    rows.push_back({"id_" + std::to_string(i), std::to_string(i)});
+  }
+  csv::writeCsv(path, header, rows);
+
+  EXPECT_EQ(rows.size(), csv::countCsvRows(path));
+  std::vector<std::vector<std::string>> readRows;
+  csv::readCsv(
+      path,
+      [&](const std::vector<std::string>&,
+          const std::vector<std::string>& parts) {
+        readRows.push_back(parts);
+      });
+  EXPECT_EQ(rows, readRows);
+}
+} // namespace private_measurement::compressed_io
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "fbpcf/engine/communication/test/AgentFactoryCreationHelper.h"
+#include "fbpcf/util/MetricCollector.h"
+
+#include "fbpcs/emp_games/common/CompressingAgent.h"
+
+namespace common {
+
+using private_measurement::compressed_io::Codec;
+
+namespace {
+std::vector<unsigned char> makeCompressible(size_t size) {
+  std::vector<unsigned char> data(size);
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<unsigned char>((i / 64) % 4);
+  }
+  return data;
+}
+
+std::vector<unsigned char> makeRandom(size_t size) {
+  std::mt19937 generator{size};
+  std::uniform_int_distribution<int> byte{0, 255};
+  std::vector<unsigned char> data(size);
+  for (auto& value : data) {
+    value = static_cast<unsigned char>(byte(generator));
+  }
+  return data;
+}
+
+// Sends data from the publisher, and has the partner receive it in chunks of
+// receiveSize bytes. Returns what was received and the bytes sent over the
+// underlying agent
+std::pair<std::vector<unsigned char>, uint64_t> sendAndReceive(
+    Codec codec,
+    const std::vector<std::vector<unsigned char>>& messages,
+    size_t receiveSize) {
+  auto factories = fbpcf::engine::communication::getInMemoryAgentFactory(2);
+  auto metricCollector =
+      std::make_shared<fbpcf::util::MetricCollector>("compressing_test");
+  auto publisherFactory =
+      compressTraffic(std::move(factories[0]), codec, metricCollector);
+  auto partnerFactory =
+      compressTraffic(std::move(factories[1]), codec, metricCollector);
+
+  auto sent = std::async(std::launch::async, [&]() {
+    auto agent = publisherFactory->create(1, "test");
+    for (const auto& message : messages) {
+      agent->send(message);
+    }
+    return agent->getTrafficStatistics().first;
+  });
+
+  size_t total = 0;
+  for (const auto& message : messages) {
+    total += message.size();
+  }
+  auto agent = partnerFactory->create(0, "test");
+  std::vector<unsigned char> received;
+  while (received.size() < total) {
+    auto chunk = agent->receive(std::min(receiveSize, total - received.size()));
+    received.insert(received.end(), chunk.begin(), chunk.end());
+  }
+  return {received, sent.get()};
+}
+
+std::vector<unsigned char> concat(
+    const std::vector<std::vector<unsigned char>>& messages) {
+  std::vector<unsigned char> out;
+  for (const auto& message : messages) {
+    out.insert(out.end(), message.begin(), message.end());
+  }
+  return out;
+}
+} // namespace
+
+class CompressingAgentTest : public ::testing::TestWithParam<Codec> {};
+
+TEST_P(CompressingAgentTest, TestCompressesStructuredTraffic) {
+  std::vector<std::vector<unsigned char>> messages{
+      makeCompressible(3 * CompressingAgent::kMaxFrameSize + 100),
+      makeCompressible(10),
+      makeCompressible(5000)};
+  // Received in chunks which don't line up with the frames
+  auto [received, sentBytes] = sendAndReceive(GetParam(), messages, 777);
+  EXPECT_EQ(concat(messages), received);
+  EXPECT_LT(sentBytes, received.size() / 10);
+}
+
+TEST_P(CompressingAgentTest, TestSendsRandomTrafficAsItIs) {
+  std::vector<std::vector<unsigned char>> messages{
+      makeRandom(CompressingAgent::kSampleBytes + 12345), makeRandom(100)};
+  auto [received, sentBytes] = sendAndReceive(
+      GetParam(), messages, CompressingAgent::kMaxFrameSize * 2 + 1);
+  EXPECT_EQ(concat(messages), received);
+  // Only the headers of the frames are added
+  EXPECT_LE(sentBytes, received.size() + received.size() / 1000);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    CompressingAgentTestSuite,
+    CompressingAgentTest,
+    ::testing::Values(Codec::kLz4, Codec::kZstd));
+
+TEST(CompressingAgentTest, TestNoneLeavesFactoryUnwrapped) {
+  auto factories = fbpcf::engine::communication::getInMemoryAgentFactory(2);
+  auto* factory = factories[0].get();
+  auto metricCollector =
+      std::make_shared<fbpcf::util::MetricCollector>("compressing_test");
+  EXPECT_EQ(
+      factory,
+      compressTraffic(std::move(factories[0]), Codec::kNone, metricCollector)
+          .get());
+}
+
+} // namespace common
@@ -10,9 +10,12 @@
 
 #include <algorithm>
 #include <climits>
+#include <cstring>
 #include <functional>
+#include <memory>
 #include <random>
 #include <stdexcept>
+#include <utility>
 
 #include <openssl/conf.h>
 #include <openssl/err.h>
@@ -20,6 +23,8 @@
 
 #include <folly/ssl/OpenSSLPtrTypes.h>
 
+#include "fbpcf/io/api/IReaderCloser.h"
+#include "fbpcf/io/api/IWriterCloser.h"
 #include "fbpcs/emp_games/common/Crypto.h"
 
 namespace private_measurement::crypto {
@@ -88,4 +93,201 @@ TEST(CryptoUtilTest, testEncryptionDecryption) {
   encryptionTestHelper(generateRandomBytes(2000), keyPair1, keyPair2);
 }
 
+// Encrypts plaintext fed to the encryptor in pieces of pieceSize bytes
+std::vector<unsigned char> encryptStream(
+    const std::vector<unsigned char>& plaintext,
+    const std::vector<unsigned char>& key,
+    size_t chunkSize,
+    size_t pieceSize) {
+  StreamEncryptor encryptor{key, chunkSize};
+  std::vector<unsigned char> ciphertext;
+  for (size_t i = 0; i < plaintext.size(); i += pieceSize) {
+    encryptor.update(
+        plaintext.data() + i,
+        std::min(pieceSize, plaintext.size() - i),
+        ciphertext);
+  }
+  encryptor.finish(ciphertext);
+  return ciphertext;
+}
+
+std::vector<unsigned char> decryptStream(
+    const std::vector<unsigned char>& ciphertext,
+    const std::vector<unsigned char>& key,
+    size_t pieceSize) {
+  StreamDecryptor decryptor{key};
+  std::vector<unsigned char> plaintext;
+  for (size_t i = 0; i < ciphertext.size(); i += pieceSize) {
+    decryptor.update(
+        ciphertext.data() + i,
+        std::min(pieceSize, ciphertext.size() - i),
+        plaintext);
+  }
+  decryptor.finish(plaintext);
+  return plaintext;
+}
+
+TEST(CryptoUtilTest, testStreamEncryptionDecryption) {
+  auto key = generateStreamKey();
+  const size_t chunkSize = 64;
+  for (size_t size : {0, 1, 63, 64, 65, 128, 1000}) {
+    auto plaintext = generateRandomBytes(size);
+    for (size_t pieceSize : {1, 7, 64, 4096}) {
+      auto ciphertext = encryptStream(plaintext, key, chunkSize, pieceSize);
+      auto chunks = size / chunkSize + 1;
+      EXPECT_EQ(
+          kStreamHeaderLength + size + chunks * kStreamTagLength,
+          ciphertext.size());
+      EXPECT_THAT(
+          decryptStream(ciphertext, key, pieceSize),
+          testing::ContainerEq(plaintext));
+    }
+  }
+
+  // Encrypting the same plaintext twice gives different ciphertexts
+  auto plaintext = generateRandomBytes(100);
+  EXPECT_NE(
+      encryptStream(plaintext, key, chunkSize, 100),
+      encryptStream(plaintext, key, chunkSize, 100));
+}
+
+TEST(CryptoUtilTest, testStreamDecryptionFailures) {
+  auto key = generateStreamKey();
+  const size_t chunkSize = 64;
+  const size_t sealedSize = chunkSize + kStreamTagLength;
+  auto plaintext = generateRandomBytes(200);
+  auto ciphertext = encryptStream(plaintext, key, chunkSize, 200);
+
+  // Wrong key
+  EXPECT_THROW(
+      decryptStream(ciphertext, generateStreamKey(), 1000), OpenSSLException);
+
+  // Any altered byte, in the header, a chunk or a tag
+  for (size_t i : {size_t{0}, kStreamMagic.size(), kStreamHeaderLength - 1,
+                   kStreamHeaderLength, kStreamHeaderLength + sealedSize - 1,
+                   ciphertext.size() - 1}) {
+    auto altered = ciphertext;
+    altered[i] ^= 1;
+    EXPECT_THROW(decryptStream(altered, key, 1000), OpenSSLException) << i;
+  }
+
+  // Truncated, at the end of a chunk or within one
+  for (size_t size : {size_t{0}, kStreamHeaderLength,
+                      kStreamHeaderLength + sealedSize,
+                      kStreamHeaderLength + 2 * sealedSize,
+                      ciphertext.size() - 1}) {
+    std::vector<unsigned char> truncated(
+        ciphertext.begin(), ciphertext.begin() + size);
+    EXPECT_THROW(decryptStream(truncated, key, 1000), OpenSSLException)
+        << size;
+  }
+
+  // Chunks swapped
+  auto swapped = ciphertext;
+  std::swap_ranges(
+      swapped.begin() + kStreamHeaderLength,
+      swapped.begin() + kStreamHeaderLength + sealedSize,
+      swapped.begin() + kStreamHeaderLength + sealedSize);
+  EXPECT_THROW(decryptStream(swapped, key, 1000), OpenSSLException);
+
+  // A chunk from another stream under the same key
+  auto other = encryptStream(plaintext, key, chunkSize, 200);
+  auto mixed = ciphertext;
+  std::copy(
+      other.begin() + kStreamHeaderLength,
+      other.begin() + kStreamHeaderLength + sealedSize,
+      mixed.begin() + kStreamHeaderLength);
+  EXPECT_THROW(decryptStream(mixed, key, 1000), OpenSSLException);
+}
+
+class MemoryWriter final : public fbpcf::io::IWriterCloser {
+ public:
+  explicit MemoryWriter(std::vector<char>& data) : data_{data} {}
+
+  size_t write(std::vector<char>& buf) override {
+    data_.insert(data_.end(), buf.begin(), buf.end());
+    return buf.size();
+  }
+
+  int close() override {
+    return 0;
+  }
+
+ private:
+  std::vector<char>& data_;
+};
+
+class MemoryReader final : public fbpcf::io::IReaderCloser {
+ public:
+  explicit MemoryReader(std::vector<char> data) : data_{std::move(data)} {}
+
+  size_t read(std::vector<char>& buf) override {
+    auto size = std::min(buf.size(), data_.size() - position_);
+    std::memcpy(buf.data(), data_.data() + position_, size);
+    position_ += size;
+    return size;
+  }
+
+  bool eof() override {
+    return position_ == data_.size();
+  }
+
+  int close() override {
+    return 0;
+  }
+
+ private:
+  std::vector<char> data_;
+  size_t position_ = 0;
+};
+
+TEST(CryptoUtilTest, testEncryptingWriterDecryptingReader) {
+  auto key = generateStreamKey();
+  auto plaintext = generateRandomBytes(3 * 1000 + 17);
+  std::vector<char> file;
+  {
+    EncryptingWriter writer{std::make_unique<MemoryWriter>(file), key, 1000};
+    for (size_t i = 0; i < plaintext.size(); i += 333) {
+      std::vector<char> buf(
+          plaintext.begin() + i,
+          plaintext.begin() + std::min(i + 333, plaintext.size()));
+      writer.write(buf);
+    }
+    writer.close();
+  }
+
+  DecryptingReader reader{std::make_unique<MemoryReader>(file), key};
+  std::vector<unsigned char> decrypted;
+  std::vector<char> buf;
+  while (!reader.eof()) {
+    buf.resize(100);
+    buf.resize(reader.read(buf));
+    decrypted.insert(decrypted.end(), buf.begin(), buf.end());
+  }
+  reader.close();
+  EXPECT_THAT(decrypted, testing::ContainerEq(plaintext));
+
+  file.pop_back();
+  DecryptingReader truncatedReader{std::make_unique<MemoryReader>(file), key};
+  buf.resize(plaintext.size());
+  EXPECT_THROW(truncatedReader.read(buf), OpenSSLException);
+}
+
+TEST(CryptoUtilTest, testEncryptingWriterDestroyedWithoutClose) {
+  auto key = generateStreamKey();
+  auto plaintext = generateRandomBytes(2500);
+  std::vector<char> file;
+  {
+    EncryptingWriter writer{std::make_unique<MemoryWriter>(file), key, 1000};
+    std::vector<char> buf(plaintext.begin(), plaintext.end());
+    writer.write(buf);
+  }
+
+  // The chunks written so far are there, but not the last one
+  EXPECT_EQ(kStreamHeaderLength + 2 * (1000 + kStreamTagLength), file.size());
+  DecryptingReader reader{std::make_unique<MemoryReader>(file), key};
+  std::vector<char> buf(plaintext.size());
+  EXPECT_THROW(reader.read(buf), OpenSSLException);
+}
+
 } // namespace private_measurement::crypto
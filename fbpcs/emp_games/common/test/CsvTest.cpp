@@ -54,6 +54,68 @@ TEST_F(CsvTest, TestSplitByCommaSupportInnerBrackets) {
   EXPECT_EQ(expOutput, output);
 }
 
+TEST_F(CsvTest, TestSplitByCommaStopsAtEmptyField) {
+  std::string inputStr = "a,b,,c";
+  std::vector<std::string> expOutput = {"a", "b"};
+  EXPECT_EQ(expOutput, csv::splitByComma(inputStr, false));
+}
+
+TEST_F(CsvTest, TestSplitByCommaUnclosedBracket) {
+  std::string inputStr = "[],[1,2";
+  std::vector<std::string> expOutput = {"[]", "[1", "2"};
+  EXPECT_EQ(expOutput, csv::splitByComma(inputStr, true));
+}
+
+TEST_F(CsvTest, TestSplitByCommaInPlace) {
+  std::string inputStr = "id_1, [1, 2], 3";
+  std::vector<std::string_view> output;
+  csv::splitByCommaInPlace(inputStr, true, output);
+  std::vector<std::string_view> expOutput = {"id_1", "[1,2]", "3"};
+  EXPECT_EQ(expOutput, output);
+  EXPECT_EQ(inputStr, "id_1,[1,2],3");
+}
+
+TEST_F(CsvTest, TestSplitSelectedByCommaInPlaceMatchesSplitByComma) {
+  std::vector<std::string> lines = {
+      "id_1, [1, 2], 3",
+      " a , b ,c  ",
+      "a,b,,c",
+      "[],[1,2",
+      "[ ],x",
+      "[1, 2] x, y",
+      "[1,2],  [3 , 4 ]  ,5",
+      "   "};
+  for (auto& line : lines) {
+    auto copy = line;
+    std::vector<std::string_view> expected;
+    csv::splitByCommaInPlace(copy, true, expected);
+    std::string selectedLine = line;
+    std::vector<std::string_view> output;
+    csv::splitSelectedByCommaInPlace(
+        selectedLine, true, std::vector<bool>(10, true), output);
+    EXPECT_EQ(expected, output) << line;
+  }
+}
+
+TEST_F(CsvTest, TestSplitSelectedByCommaInPlace) {
+  std::string inputStr = "id_1, [1, 2], 3 , [4, 5], 6";
+  std::vector<std::string_view> output;
+  csv::splitSelectedByCommaInPlace(
+      inputStr, true, {false, true, false, true}, output);
+  std::vector<std::string_view> expOutput = {"", "[1,2]", "", "[4,5]"};
+  EXPECT_EQ(expOutput, output);
+}
+
+TEST_F(CsvTest, TestSplitInnerArray) {
+  std::vector<std::string_view> output;
+  csv::splitInnerArray("[ 10, 20 ,30 ]", output);
+  std::vector<std::string_view> expOutput = {"10", "20", "30"};
+  EXPECT_EQ(expOutput, output);
+
+  csv::splitInnerArray("[]", output);
+  EXPECT_TRUE(output.empty());
+}
+
 TEST_F(CsvTest, TestReadCsv) {
   std::string baseDir = test_util::getBaseDirFromPath(__FILE__);
   std::string inputPath = baseDir + "test_data/input.csv";
@@ -78,6 +140,27 @@ TEST_F(CsvTest, TestReadCsv) {
   EXPECT_EQ(results, EXPECTED_VALUES);
 }
 
+TEST_F(CsvTest, TestReadCsvSelectedColumns) {
+  std::string baseDir = test_util::getBaseDirFromPath(__FILE__);
+  std::string inputPath = baseDir + "test_data/input.csv";
+
+  std::vector<std::vector<std::string>> results;
+  csv::readCsv(
+      inputPath,
+      [&results](
+          const std::vector<std::string>& header,
+          const std::vector<std::string>& values) {
+        EXPECT_EQ(header, EXPECTED_HEADER);
+        results.push_back(values);
+      },
+      [](auto) {},
+      {"field2", "id", "missing"});
+
+  std::vector<std::vector<std::string>> expected = {
+      {"1", "", "bubba"}, {"2", "", "[1,2,3]"}};
+  EXPECT_EQ(results, expected);
+}
+
 TEST_F(CsvTest, TestWriteCsv) {
   std::string baseDir = test_util::getBaseDirFromPath(__FILE__);
   std::string outputPath = folly::sformat(
@@ -107,4 +190,85 @@ TEST_F(CsvTest, TestWriteCsv) {
   cleanup(outputPath);
 }
 
+TEST_F(CsvTest, TestReadCsvWithoutTrailingNewline) {
+  std::string baseDir = test_util::getBaseDirFromPath(__FILE__);
+  std::string inputPath = folly::sformat(
+      "{}test_data/input_{}.csv", baseDir, folly::Random::secureRand64());
+  {
+    std::ofstream file{inputPath};
+    file << "id,field1,field2,field3\n"
+         << "1,foo,bubba,gas\n"
+         << "2,trio,[1,2,3],[4,5,6]";
+  }
+
+  std::vector<std::vector<std::string>> results;
+  csv::readCsv(
+      inputPath,
+      [&results](
+          const std::vector<std::string>& header,
+          const std::vector<std::string>& values) {
+        EXPECT_EQ(header, EXPECTED_HEADER);
+        results.push_back(values);
+      });
+
+  EXPECT_EQ(results, EXPECTED_VALUES);
+  EXPECT_EQ(csv::countCsvRows(inputPath), EXPECTED_VALUES.size());
+
+  cleanup(inputPath);
+}
+
+TEST_F(CsvTest, TestCountCsvRows) {
+  std::string baseDir = test_util::getBaseDirFromPath(__FILE__);
+  std::string inputPath = baseDir + "test_data/input.csv";
+
+  EXPECT_EQ(csv::countCsvRows(inputPath), EXPECTED_VALUES.size());
+}
+
+TEST_F(CsvTest, TestReadCsvViewsInChunksKeepsRowOrder) {
+  std::string baseDir = test_util::getBaseDirFromPath(__FILE__);
+  std::string inputPath = folly::sformat(
+      "{}test_data/input_{}.csv", baseDir, folly::Random::secureRand64());
+  const size_t numRows = 1000;
+  {
+    std::ofstream file{inputPath};
+    file << "id,values\n";
+    for (size_t i = 0; i < numRows; ++i) {
+      file << i << ",[" << i << "," << i + 1 << "]\n";
+    }
+  }
+
+  const size_t numChunks = 4;
+  std::vector<std::vector<std::vector<std::string>>> chunks(numChunks);
+  std::vector<std::string> headerInput;
+  csv::readCsvViewsInChunks(
+      inputPath,
+      numChunks,
+      [&chunks](
+          size_t chunk,
+          const std::vector<std::string>& header,
+          const std::vector<std::string_view>& parts) {
+        EXPECT_EQ(header.size(), 2U);
+        chunks.at(chunk).emplace_back(parts.begin(), parts.end());
+      },
+      [&headerInput](const std::vector<std::string>& header) {
+        headerInput = header;
+      });
+
+  EXPECT_EQ(headerInput, std::vector<std::string>({"id", "values"}));
+  std::vector<std::vector<std::string>> results;
+  for (const auto& chunk : chunks) {
+    EXPECT_FALSE(chunk.empty());
+    results.insert(results.end(), chunk.begin(), chunk.end());
+  }
+  ASSERT_EQ(results.size(), numRows);
+  for (size_t i = 0; i < numRows; ++i) {
+    EXPECT_EQ(
+        results[i],
+        std::vector<std::string>(
+            {std::to_string(i), folly::sformat("[{},{}]", i, i + 1)}));
+  }
+
+  cleanup(inputPath);
+}
+
 } // namespace private_measurement
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/DryRunEstimate.h"
+
+namespace common {
+
+// Costs of 1000 per lane plus 10 per row, the publisher sending twice as much
+// as the partner
+static DryRunSample makeSample(int64_t numRows) {
+  return DryRunSample{
+      numRows,
+      static_cast<uint64_t>(1000 + 10 * numRows),
+      static_cast<uint64_t>(100 + numRows),
+      static_cast<uint64_t>(2000 + 20 * numRows),
+      static_cast<uint64_t>(1000 + 10 * numRows),
+      1 + 0.01 * numRows};
+}
+
+TEST(DryRunEstimateTest, TestExtrapolatesPerLaneAndPerRowCosts) {
+  auto estimate = extrapolateDryRuns(
+      makeSample(kDryRunSmallRows),
+      makeSample(kDryRunLargeRows),
+      PUBLISHER,
+      10000,
+      4,
+      0);
+  EXPECT_EQ(4 * 1000 + 10 * 10000, estimate.nonFreeGates);
+  EXPECT_EQ(4 * 100 + 10000, estimate.freeGates);
+  EXPECT_EQ(4 * 2000 + 20 * 10000, estimate.sentNetwork);
+  EXPECT_EQ(4 * 1000 + 10 * 10000, estimate.receivedNetwork);
+  // The lanes run at the same time
+  EXPECT_NEAR(1 + 0.01 * 10000 / 4, estimate.computeSeconds, 1e-6);
+  EXPECT_EQ(0, estimate.networkSeconds);
+}
+
+TEST(DryRunEstimateTest, TestPartnerReceivesWhatPublisherSends) {
+  auto publisher = extrapolateDryRuns(
+      makeSample(kDryRunSmallRows),
+      makeSample(kDryRunLargeRows),
+      PUBLISHER,
+      10000,
+      1,
+      0);
+  auto partner = extrapolateDryRuns(
+      makeSample(kDryRunSmallRows),
+      makeSample(kDryRunLargeRows),
+      PARTNER,
+      10000,
+      1,
+      0);
+  EXPECT_EQ(publisher.sentNetwork, partner.receivedNetwork);
+  EXPECT_EQ(publisher.receivedNetwork, partner.sentNetwork);
+  EXPECT_EQ(publisher.nonFreeGates, partner.nonFreeGates);
+}
+
+TEST(DryRunEstimateTest, TestNetworkTimeIsOfTheBusierDirection) {
+  auto estimate = extrapolateDryRuns(
+      makeSample(kDryRunSmallRows),
+      makeSample(kDryRunLargeRows),
+      PARTNER,
+      10000,
+      2,
+      1000);
+  EXPECT_NEAR((2 * 2000 + 20 * 10000) / 1000.0, estimate.networkSeconds, 1e-6);
+  EXPECT_NEAR(
+      estimate.computeSeconds + estimate.networkSeconds,
+      estimate.getSeconds(),
+      1e-9);
+}
+
+TEST(DryRunEstimateTest, TestCostsNeverDecreaseWithRows) {
+  // A noisy large sample costing less than the small one
+  auto small = makeSample(kDryRunSmallRows);
+  auto large = makeSample(kDryRunLargeRows);
+  large.seconds = small.seconds / 2;
+  auto estimate =
+      extrapolateDryRuns(small, large, PUBLISHER, 1'000'000, 1, 0);
+  EXPECT_NEAR(small.seconds, estimate.computeSeconds, 1e-9);
+}
+
+} // namespace common
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <vector>
+
+#include <fbpcf/mpc/EmpTestUtil.h>
+
+#include "fbpcs/emp_games/common/EmpOperationUtil.h"
+
+namespace private_measurement::emp_utils {
+
+TEST(EmpOperationUtilTest, TestSecretSumOfInts) {
+  fbpcf::mpc::wrapTestWithParty<std::function<void(fbpcf::Party party)>>(
+      [](fbpcf::Party party) {
+        // Odd and even numbers of values, so that some are carried to the
+        // next level of the tree
+        for (std::size_t numValues : {1, 2, 5, 8, 13}) {
+          std::vector<emp::Integer> values;
+          int64_t expected = 0;
+          for (std::size_t i = 0; i < numValues; ++i) {
+            int64_t value = static_cast<int64_t>(i * 7) - 20;
+            values.emplace_back(32, value, emp::ALICE);
+            expected += value;
+          }
+          auto actual = secretSum(values);
+          EXPECT_EQ(32, actual.size());
+          EXPECT_EQ(expected, actual.reveal<int32_t>());
+        }
+      });
+}
+
+TEST(EmpOperationUtilTest, TestSecretSumOfBits) {
+  fbpcf::mpc::wrapTestWithParty<std::function<void(fbpcf::Party party)>>(
+      [](fbpcf::Party party) {
+        for (std::size_t numBits : {0, 1, 2, 3, 7, 64, 1000}) {
+          std::vector<emp::Bit> bits;
+          int64_t expected = 0;
+          for (std::size_t i = 0; i < numBits; ++i) {
+            bool bit = (i * 5) % 3 != 0;
+            bits.emplace_back(bit, emp::ALICE);
+            expected += bit;
+          }
+          auto actual = secretSum(bits);
+          EXPECT_EQ(INT_SIZE, actual.size());
+          EXPECT_EQ(expected, actual.reveal<int64_t>());
+          EXPECT_EQ(expected, sum(bits));
+        }
+      });
+}
+
+TEST(EmpOperationUtilTest, TestBitsToInts) {
+  fbpcf::mpc::wrapTestWithParty<std::function<void(fbpcf::Party party)>>(
+      [](fbpcf::Party party) {
+        std::vector<emp::Bit> bits{
+            emp::Bit{true, emp::ALICE},
+            emp::Bit{false, emp::ALICE},
+            emp::Bit{true, emp::ALICE}};
+        auto ints = bitsToInts(bits);
+        ASSERT_EQ(bits.size(), ints.size());
+        EXPECT_EQ(1, ints.at(0).reveal<int64_t>());
+        EXPECT_EQ(0, ints.at(1).reveal<int64_t>());
+        EXPECT_EQ(1, ints.at(2).reveal<int64_t>());
+        EXPECT_EQ(INT_SIZE, ints.at(0).size());
+      });
+}
+
+} // namespace private_measurement::emp_utils
@@ -32,4 +32,12 @@ INSTANTIATE_TEST_SUITE_P(
         {"", "pcs_dummy_feature", false},
         {",pcs_dummy_feature,", "", false},
     }));
+
+TEST(FeatureFlagsTest, TestParsedOnce) {
+  const FeatureFlags featureFlags{"pcs_dummy_feature,,pcs_fake_feature"};
+  EXPECT_TRUE(featureFlags.isEnabled("pcs_dummy_feature"));
+  EXPECT_TRUE(featureFlags.isEnabled("pcs_fake_feature"));
+  EXPECT_FALSE(featureFlags.isEnabled("pcs_feature_not_found"));
+  EXPECT_FALSE(featureFlags.isEnabled(""));
+}
 } // namespace private_measurement
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fbpcs/emp_games/common/FilePipeline.h"
+#include "fbpcs/emp_games/common/ShardQueue.h"
+
+namespace common {
+
+TEST(FilePipelineTest, TestRunsEveryFileInOrder) {
+  ShardAssignment files{3, 5};
+  std::atomic<int> loadedInputs{0};
+  int maxLoadedInputs = 0;
+  std::vector<std::size_t> computed;
+  std::mutex storedMutex;
+  std::vector<std::string> stored;
+
+  runFilesPipelined<std::string, std::string>(
+      files,
+      [&](std::size_t i) {
+        ++loadedInputs;
+        return "input_" + std::to_string(i);
+      },
+      [&](std::size_t i, std::string input) {
+        maxLoadedInputs = std::max(maxLoadedInputs, loadedInputs.load());
+        // Leave time for the next input to be loaded
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        computed.push_back(i);
+        --loadedInputs;
+        return input + "_output";
+      },
+      [&](std::size_t, std::string output) {
+        std::lock_guard<std::mutex> lock{storedMutex};
+        stored.push_back(output);
+      });
+
+  EXPECT_EQ(std::vector<std::size_t>({3, 4, 5, 6, 7}), computed);
+  EXPECT_EQ(
+      std::vector<std::string>(
+          {"input_3_output",
+           "input_4_output",
+           "input_5_output",
+           "input_6_output",
+           "input_7_output"}),
+      stored);
+  EXPECT_LE(maxLoadedInputs, 2);
+}
+
+TEST(FilePipelineTest, TestNoFiles) {
+  ShardAssignment files{0, 0};
+  bool called = false;
+  runFilesPipelined<int, int>(
+      files,
+      [&](std::size_t) {
+        called = true;
+        return 0;
+      },
+      [&](std::size_t, int) {
+        called = true;
+        return 0;
+      },
+      [&](std::size_t, int) { called = true; });
+  EXPECT_FALSE(called);
+}
+
+TEST(FilePipelineTest, TestLoadErrorIsRethrown) {
+  ShardAssignment files{0, 3};
+  std::vector<std::size_t> computed;
+  EXPECT_THROW(
+      (runFilesPipelined<int, int>(
+          files,
+          [](std::size_t i) {
+            if (i == 1) {
+              throw std::runtime_error("bad input");
+            }
+            return static_cast<int>(i);
+          },
+          [&](std::size_t i, int input) {
+            computed.push_back(i);
+            return input;
+          },
+          [](std::size_t, int) {})),
+      std::runtime_error);
+  EXPECT_EQ(std::vector<std::size_t>{0}, computed);
+}
+
+} // namespace common
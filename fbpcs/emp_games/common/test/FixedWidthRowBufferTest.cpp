@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+#include "fbpcs/emp_games/common/FixedWidthRowBuffer.h"
+
+namespace common {
+
+TEST(FixedWidthRowBufferTest, TestRowsAreStoredBackToBack) {
+  FixedWidthRowBuffer rows{3};
+  rows.reserve(2);
+  std::vector<unsigned char> row0{1, 2, 3};
+  std::vector<unsigned char> row1{4, 5, 6};
+  rows.pushRow(row0.data(), row0.size());
+  rows.pushRow(row1.data(), row1.size());
+
+  EXPECT_EQ(3, rows.getRowWidth());
+  EXPECT_EQ(2, rows.size());
+  EXPECT_FALSE(rows.empty());
+  EXPECT_EQ(rows.row(0) + 3, rows.row(1));
+  EXPECT_EQ(4, rows.row(1)[0]);
+
+  rows.row(1)[2] = 7;
+  std::vector<std::vector<unsigned char>> out{{0}};
+  rows.appendRowsTo(out, 1, 2);
+  EXPECT_EQ(std::vector<std::vector<unsigned char>>({{0}, {4, 5, 7}}), out);
+  rows.appendRowsTo(out, 0, 0);
+  EXPECT_EQ(2, out.size());
+
+  rows.clear();
+  EXPECT_TRUE(rows.empty());
+  rows.pushRow(row0.data(), row0.size());
+  EXPECT_EQ(1, rows.size());
+  EXPECT_EQ(1, rows.row(0)[0]);
+}
+
+TEST(FixedWidthRowBufferTest, TestRowOfAnotherWidthThrows) {
+  FixedWidthRowBuffer rows{2};
+  std::vector<unsigned char> row{1, 2, 3};
+  EXPECT_THROW(rows.pushRow(row.data(), row.size()), std::invalid_argument);
+  EXPECT_TRUE(rows.empty());
+
+  std::vector<std::vector<unsigned char>> out;
+  EXPECT_THROW(rows.appendRowsTo(out, 0, 1), std::out_of_range);
+}
+
+} // namespace common
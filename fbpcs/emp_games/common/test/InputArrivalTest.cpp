@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "fbpcf/io/api/FileIOWrappers.h"
+#include "folly/Random.h"
+
+#include "fbpcs/emp_games/common/InputArrival.h"
+
+namespace common {
+
+class InputArrivalTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = std::filesystem::temp_directory_path() /
+        ("InputArrivalTest_" + std::to_string(folly::Random::rand32()));
+    std::filesystem::create_directories(directory_);
+  }
+
+  void TearDown() override {
+    std::filesystem::remove_all(directory_);
+  }
+
+  std::string path(const std::string& name) const {
+    return (directory_ / name).string();
+  }
+
+  std::filesystem::path directory_;
+};
+
+TEST_F(InputArrivalTest, TestWaitsForInputsToArrive) {
+  auto first = path("first");
+  auto second = path("second");
+  fbpcf::io::FileIOWrappers::writeFile(first, "id_,value\n");
+  EXPECT_TRUE(canOpenInput(first));
+  EXPECT_FALSE(canOpenInput(second));
+
+  auto writer = std::async(std::launch::async, [&second]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    fbpcf::io::FileIOWrappers::writeFile(second, "id_,value\n");
+  });
+  waitForInputs(
+      {first, second}, std::chrono::seconds(10), std::chrono::milliseconds(5));
+  writer.get();
+  EXPECT_TRUE(canOpenInput(second));
+}
+
+TEST_F(InputArrivalTest, TestThrowsIfInputsDontArrive) {
+  EXPECT_THROW(
+      waitForInputs(
+          {path("missing")},
+          std::chrono::seconds(0),
+          std::chrono::milliseconds(5)),
+      std::runtime_error);
+}
+
+} // namespace common
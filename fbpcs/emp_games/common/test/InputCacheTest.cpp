@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "folly/Random.h"
+
+#include "fbpcs/emp_games/common/InputCache.h"
+
+namespace private_measurement::compressed_io {
+
+class InputCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = std::filesystem::temp_directory_path() /
+        ("InputCacheTest_" + std::to_string(folly::Random::rand32()));
+  }
+
+  void TearDown() override {
+    std::filesystem::remove_all(directory_);
+  }
+
+  static std::string readFile(const std::string& path) {
+    std::ifstream in{path, std::ios::binary};
+    return std::string{
+        std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+  }
+
+  // Downloads content, counting the downloads
+  InputCache::Download download(const std::string& content) {
+    return [this, content](const std::string& path) {
+      ++downloads_;
+      std::ofstream out{path, std::ios::binary};
+      out << content;
+    };
+  }
+
+  std::filesystem::path directory_;
+  std::atomic<int> downloads_ = 0;
+};
+
+TEST_F(InputCacheTest, TestFilesAreDownloadedOnce) {
+  InputCache cache{directory_};
+  auto path = cache.get("\"etag1\"", 5, download("hello"));
+  EXPECT_EQ("hello", readFile(path));
+  EXPECT_EQ(path, cache.get("\"etag1\"", 5, download("hello")));
+  EXPECT_EQ(1, downloads_);
+
+  // Another cache sharing the directory reads the same entry
+  InputCache otherCache{directory_};
+  EXPECT_EQ(path, otherCache.get("\"etag1\"", 5, download("hello")));
+  EXPECT_EQ(1, downloads_);
+
+  // A changed file has another ETag, so it is downloaded again
+  auto changedPath = cache.get("\"etag2\"", 5, download("world"));
+  EXPECT_NE(path, changedPath);
+  EXPECT_EQ("world", readFile(changedPath));
+  EXPECT_EQ(2, downloads_);
+}
+
+TEST_F(InputCacheTest, TestFailedDownloadsAreNotCached) {
+  InputCache cache{directory_};
+  EXPECT_THROW(
+      cache.get("\"etag\"", 10, download("truncated")), std::runtime_error);
+  EXPECT_THROW(
+      cache.get(
+          "\"etag\"",
+          10,
+          [](const std::string& /* path */) {
+            throw std::runtime_error("download failed");
+          }),
+      std::runtime_error);
+  auto path = cache.get("\"etag\"", 10, download("0123456789"));
+  EXPECT_EQ("0123456789", readFile(path));
+  // Only the entry and its lock are left behind
+  EXPECT_EQ(
+      2,
+      std::distance(
+          std::filesystem::directory_iterator{directory_},
+          std::filesystem::directory_iterator{}));
+}
+
+TEST_F(InputCacheTest, TestConcurrentReadsAreCoalesced) {
+  InputCache cache{directory_};
+  std::string content(1 << 20, 'a');
+  std::vector<std::thread> threads;
+  std::vector<std::string> paths(8);
+  for (size_t i = 0; i < paths.size(); ++i) {
+    threads.emplace_back([&, i]() {
+      // A separate cache for each thread, as separate processes would have
+      InputCache threadCache{directory_};
+      paths.at(i) =
+          threadCache.get("\"etag\"", content.size(), download(content));
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(1, downloads_);
+  for (auto& path : paths) {
+    EXPECT_EQ(paths.at(0), path);
+  }
+  EXPECT_EQ(content, readFile(paths.at(0)));
+}
+
+} // namespace private_measurement::compressed_io
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "fbpcs/emp_games/common/InputRow.h"
+#include "fbpcs/emp_games/common/RowGroupFormat.h"
+
+namespace common {
+
+TEST(InputRowTest, TestRowGroupRowsMatchCsvRows) {
+  const std::string csv =
+      "id_,ad_ids,is_click,cohort_id\n"
+      "abc,[0,1,-2],[0,0,1],7\n"
+      "def,[0,0,3],[1,0,0],8\n";
+  std::stringstream in{csv};
+  std::stringstream out;
+  private_measurement::row_group::convertCsv(in, out, 1);
+
+  private_measurement::row_group::RowGroupReader reader{
+      private_measurement::row_group::streamSource(out)};
+  EXPECT_EQ(
+      getRowGroupHeader(reader.getSchema()),
+      std::vector<std::string>({"id_", "ad_ids", "is_click", "cohort_id"}));
+
+  std::vector<std::vector<std::string_view>> csvRows = {
+      {"abc", "[0,1,-2]", "[0,0,1]", "7"}, {"def", "[0,0,3]", "[1,0,0]", "8"}};
+  private_measurement::row_group::RowGroup group;
+  size_t numRows = 0;
+  while (reader.next(group)) {
+    ASSERT_EQ(group.numRows, 1);
+    RowGroupInputRow row{reader.getSchema(), group, 0};
+    CsvInputRow csvRow{csvRows.at(numRows++)};
+    EXPECT_EQ(row.size(), csvRow.size());
+
+    std::vector<uint64_t> adIds;
+    std::vector<uint64_t> csvAdIds;
+    row.appendArray(1, adIds);
+    csvRow.appendArray(1, csvAdIds);
+    EXPECT_EQ(adIds, csvAdIds);
+
+    std::vector<bool> isClicks;
+    std::vector<bool> csvIsClicks;
+    row.appendArray(2, isClicks);
+    csvRow.appendArray(2, csvIsClicks);
+    EXPECT_EQ(isClicks, csvIsClicks);
+
+    // An integer cell is an array of one value
+    std::vector<uint64_t> cohortIds;
+    std::vector<uint64_t> csvCohortIds;
+    row.appendArray(3, cohortIds);
+    csvRow.appendArray(3, csvCohortIds);
+    EXPECT_EQ(cohortIds, csvCohortIds);
+  }
+  EXPECT_EQ(numRows, csvRows.size());
+}
+
+} // namespace common
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fbpcf/io/api/FileIOWrappers.h"
+#include "folly/Random.h"
+
+#include "fbpcs/emp_games/common/JobManifest.h"
+
+namespace common {
+
+class JobManifestTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    manifestPath_ = (std::filesystem::temp_directory_path() /
+                     ("JobManifestTest_" +
+                      std::to_string(folly::Random::rand32())))
+                        .native();
+  }
+
+  void TearDown() override {
+    std::filesystem::remove(manifestPath_);
+  }
+
+  void writeManifest(const std::string& manifest) {
+    fbpcf::io::FileIOWrappers::writeFile(manifestPath_, manifest);
+  }
+
+  std::string manifestPath_;
+};
+
+TEST_F(JobManifestTest, TestReadsJobsInOrder) {
+  writeManifest(R"({"jobs": [
+      {"id": "b", "inputs": ["/in/b_ss", "/in/b"], "output": "/out/b"},
+      {"id": "a", "inputs": ["/in/a_ss", "/in/a"], "output": "/out/a"}]})");
+
+  auto jobs = readJobManifest(manifestPath_, 2);
+  ASSERT_EQ(2, jobs.size());
+  EXPECT_EQ("b", jobs.at(0).id);
+  EXPECT_EQ(std::vector<std::string>({"/in/b_ss", "/in/b"}), jobs.at(0).inputs);
+  EXPECT_EQ("/out/b", jobs.at(0).output);
+  EXPECT_EQ("a", jobs.at(1).id);
+  EXPECT_EQ(std::vector<std::string>({"/in/a_ss", "/in/a"}), jobs.at(1).inputs);
+  EXPECT_EQ("/out/a", jobs.at(1).output);
+}
+
+TEST_F(JobManifestTest, TestRejectsWrongNumberOfInputs) {
+  writeManifest(
+      R"({"jobs": [{"id": "a", "inputs": ["/in/a"], "output": "/out/a"}]})");
+  EXPECT_THROW(readJobManifest(manifestPath_, 2), std::invalid_argument);
+  EXPECT_EQ(1, readJobManifest(manifestPath_, 1).size());
+}
+
+TEST_F(JobManifestTest, TestRejectsSharedIdsAndOutputs) {
+  writeManifest(R"({"jobs": [
+      {"id": "a", "inputs": ["/in/a"], "output": "/out/a"},
+      {"id": "a", "inputs": ["/in/b"], "output": "/out/b"}]})");
+  EXPECT_THROW(readJobManifest(manifestPath_, 1), std::invalid_argument);
+
+  writeManifest(R"({"jobs": [
+      {"id": "a", "inputs": ["/in/a"], "output": "/out/a"},
+      {"id": "b", "inputs": ["/in/b"], "output": "/out/a"}]})");
+  EXPECT_THROW(readJobManifest(manifestPath_, 1), std::invalid_argument);
+}
+
+TEST_F(JobManifestTest, TestRejectsEmptyManifest) {
+  writeManifest(R"({"jobs": []})");
+  EXPECT_THROW(readJobManifest(manifestPath_, 1), std::invalid_argument);
+}
+
+} // namespace common
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "fbpcf/engine/communication/test/AgentFactoryCreationHelper.h"
+#include "fbpcf/util/MetricCollector.h"
+
+#include "fbpcs/emp_games/common/LaneController.h"
+
+namespace common {
+
+TEST(LaneControllerTest, TestAddsLaneWhileThroughputScales) {
+  LaneController::Options options;
+  options.minGain = 0.1;
+  options.maxCpuUtilization = 0.9;
+  // The first measurement has nothing to compare to
+  EXPECT_TRUE(LaneController::shouldAddLane(100, 0, 0.5, options));
+  EXPECT_TRUE(LaneController::shouldAddLane(120, 100, 0.5, options));
+  EXPECT_FALSE(LaneController::shouldAddLane(105, 100, 0.5, options));
+  EXPECT_FALSE(LaneController::shouldAddLane(200, 100, 0.95, options));
+}
+
+TEST(LaneControllerTest, TestPartiesStartTheSameLanes) {
+  auto factories = fbpcf::engine::communication::getInMemoryAgentFactory(2);
+  LaneController::Options options;
+  options.minLanes = 2;
+  options.interval = std::chrono::milliseconds(10);
+  auto queue = std::make_shared<ShardQueue>(4);
+
+  auto run = [&](int party) {
+    LaneController controller{party, queue, options};
+    controller.connect(*factories[party]);
+    std::vector<bool> started;
+    for (std::size_t lane = 0; lane < 4; ++lane) {
+      started.push_back(controller.shouldStart(lane));
+      // Every file is taken once the third lane is running
+      if (party == PUBLISHER && lane == 2) {
+        while (queue->take().has_value()) {
+        }
+      }
+    }
+    return started;
+  };
+  auto publisher = std::async(std::launch::async, run, PUBLISHER);
+  auto partner = std::async(std::launch::async, run, PARTNER);
+
+  // Lanes 0 and 1 start at once, lane 2 as the first measurement has nothing
+  // to compare to, and lane 3 not as there is no file left for it
+  std::vector<bool> expected{true, true, true, false};
+  EXPECT_EQ(expected, publisher.get());
+  EXPECT_EQ(expected, partner.get());
+}
+
+TEST(LaneControllerTest, TestCountsTrafficOfApps) {
+  auto factories = fbpcf::engine::communication::getInMemoryAgentFactory(2);
+  auto metricCollector =
+      std::make_shared<fbpcf::util::MetricCollector>("lane_test");
+  auto traffic = std::make_shared<std::atomic<uint64_t>>(0);
+  TrafficCountingAgentFactory sender{
+      std::move(factories[0]), traffic, metricCollector};
+  TrafficCountingAgentFactory receiver{
+      std::move(factories[1]), traffic, metricCollector};
+
+  auto sent = std::async(std::launch::async, [&]() {
+    sender.create(1, "test")->send(std::vector<unsigned char>(10, 1));
+  });
+  auto received = receiver.create(0, "test")->receive(10);
+  EXPECT_EQ(std::vector<unsigned char>(10, 1), received);
+  sent.get();
+  EXPECT_EQ(20, traffic->load());
+}
+
+} // namespace common
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "fbpcs/emp_games/common/MemoryGovernor.h"
+
+namespace common {
+
+TEST(MemoryGovernorTest, TestReadsTheResidentSetSize) {
+  EXPECT_GT(readCurrentRss(), 0);
+
+  auto path = std::filesystem::temp_directory_path() / "MemoryGovernorStatm";
+  std::ofstream{path} << "100 25 3 1 0 20 0\n";
+  EXPECT_EQ(25 * sysconf(_SC_PAGESIZE), readCurrentRss(path.string()));
+  std::ofstream{path} << "";
+  EXPECT_EQ(0, readCurrentRss(path.string()));
+  std::filesystem::remove(path);
+}
+
+TEST(MemoryGovernorTest, TestKeepsTheBatchSizeWithoutABudget) {
+  MemoryGovernor governor{MemoryGovernor::Options{}, [] { return 1000; }};
+  EXPECT_FALSE(governor.isEnabled());
+  EXPECT_EQ(64, governor.nextBatchSize(8, 64));
+}
+
+TEST(MemoryGovernorTest, TestShrinksAndGrowsTheBatchWithTheMemoryUse) {
+  uint64_t rss = 0;
+  MemoryGovernor::Options options;
+  options.budgetBytes = 1000;
+  options.minBatchFraction = 0.0625;
+  MemoryGovernor governor{options, [&rss] { return rss; }};
+  EXPECT_TRUE(governor.isEnabled());
+
+  // Above the high watermark, down to the fraction of the size asked for
+  rss = 900;
+  EXPECT_EQ(32, governor.nextBatchSize(64, 64));
+  EXPECT_EQ(4, governor.nextBatchSize(6, 64));
+  EXPECT_EQ(4, governor.nextBatchSize(4, 64));
+
+  // Between the watermarks
+  rss = 600;
+  EXPECT_EQ(16, governor.nextBatchSize(16, 64));
+
+  // Below the low watermark
+  rss = 100;
+  EXPECT_EQ(32, governor.nextBatchSize(16, 64));
+  EXPECT_EQ(64, governor.nextBatchSize(48, 64));
+}
+
+TEST(MemoryGovernorTest, TestNeverShrinksBelowTheMinimum) {
+  MemoryGovernor::Options options;
+  options.budgetBytes = 1000;
+  MemoryGovernor governor{options, [] { return 900; }};
+  EXPECT_EQ(125, governor.getMinBatchSize(1000));
+  EXPECT_EQ(1, governor.getMinBatchSize(3));
+  EXPECT_EQ(1, governor.getMinBatchSize(0));
+
+  std::size_t batchSize = 1000;
+  for (int i = 0; i < 20; ++i) {
+    batchSize = governor.nextBatchSize(batchSize, 1000);
+  }
+  EXPECT_EQ(125, batchSize);
+}
+
+TEST(MemoryGovernorTest, TestGrowsBackWhenTheMemoryUseStaysBelowTheHigh) {
+  uint64_t rss = 900;
+  MemoryGovernor::Options options;
+  options.budgetBytes = 1000;
+  options.growAfterBatches = 3;
+  MemoryGovernor governor{options, [&rss] { return rss; }};
+  EXPECT_EQ(32, governor.nextBatchSize(64, 64));
+
+  // The freed memory isn't returned, so the use stays between the watermarks
+  rss = 600;
+  EXPECT_EQ(32, governor.nextBatchSize(32, 64));
+  EXPECT_EQ(32, governor.nextBatchSize(32, 64));
+  EXPECT_EQ(64, governor.nextBatchSize(32, 64));
+  EXPECT_EQ(64, governor.nextBatchSize(64, 64));
+
+  // Going above the high watermark starts the count again
+  rss = 900;
+  EXPECT_EQ(32, governor.nextBatchSize(64, 64));
+  rss = 600;
+  EXPECT_EQ(32, governor.nextBatchSize(32, 64));
+}
+
+} // namespace common
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+#include <folly/dynamic.h>
+
+#include "fbpcs/emp_games/common/MetricTreeFormat.h"
+
+namespace private_measurement::metric_tree {
+
+static folly::dynamic makeMetrics() {
+  return folly::dynamic::object(
+      "last_click_1d",
+      folly::dynamic::object(
+          "measurement",
+          folly::dynamic::object(
+              "1",
+              folly::dynamic::object(
+                  "convs", std::numeric_limits<int64_t>::min())(
+                  "sales", -572762462605311500))))(
+      "cohortMetrics",
+      folly::dynamic::array(
+          folly::dynamic::object("testConverters", 3),
+          folly::dynamic::object("testConverters", 0)))(
+      "empty", folly::dynamic::array());
+}
+
+TEST(MetricTreeFormatTest, TestRoundTrip) {
+  auto metrics = makeMetrics();
+  auto content = encode(metrics);
+  EXPECT_TRUE(hasMagic(content));
+  EXPECT_EQ(metrics, decode(content));
+
+  folly::dynamic value = 7;
+  EXPECT_EQ(value, decode(encode(value)));
+}
+
+TEST(MetricTreeFormatTest, TestValuesAreFixedWidth) {
+  auto content = encode(folly::dynamic::array(1, 2, 3));
+  // The schema is the list tag, its size and 3 value tags
+  EXPECT_EQ(kMagic.size() + 8 + (1 + 4 + 3) + 8 + 3 * 8, content.size());
+}
+
+TEST(MetricTreeFormatTest, TestUnsupportedValuesThrow) {
+  EXPECT_THROW(
+      encode(folly::dynamic::object("convs", "12")), std::invalid_argument);
+  EXPECT_THROW(encode(folly::dynamic::array(1.5)), std::invalid_argument);
+}
+
+TEST(MetricTreeFormatTest, TestMalformedContentThrows) {
+  auto content = encode(makeMetrics());
+  EXPECT_THROW(decode("{\"last_click_1d\": {}}"), std::runtime_error);
+  EXPECT_THROW(
+      decode(content.substr(0, content.size() - 1)), std::runtime_error);
+  EXPECT_THROW(decode(content + "x"), std::runtime_error);
+}
+
+} // namespace private_measurement::metric_tree
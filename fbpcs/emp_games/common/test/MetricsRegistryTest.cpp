@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "folly/dynamic.h"
+
+#include "fbpcs/emp_games/common/MetricsRegistry.h"
+#include "fbpcs/emp_games/common/SchedulerStatistics.h"
+
+namespace common {
+
+TEST(MetricsRegistryTest, TestMergeAddsNumbersAtTheSameKey) {
+  auto first = folly::dynamic::object(
+      "lift_metrics.traffic", folly::dynamic::object("sent", 10)("time", 1.5))(
+      "name", "first");
+  auto second = folly::dynamic::object(
+      "lift_metrics.traffic", folly::dynamic::object("sent", 5)("time", 0.5))(
+      "other", 7)("name", "second");
+  auto merged = mergeMetrics(first, second);
+  EXPECT_EQ(15, merged["lift_metrics.traffic"]["sent"].asInt());
+  EXPECT_DOUBLE_EQ(2.0, merged["lift_metrics.traffic"]["time"].asDouble());
+  EXPECT_EQ(7, merged["other"].asInt());
+  EXPECT_EQ("first", merged["name"].asString());
+}
+
+TEST(MetricsRegistryTest, TestMergeWithNull) {
+  auto metrics = folly::dynamic::object("sent", 10);
+  EXPECT_EQ(metrics, mergeMetrics(nullptr, metrics));
+  EXPECT_EQ(metrics, mergeMetrics(metrics, nullptr));
+}
+
+TEST(MetricsRegistryTest, TestStatisticsOfAppsAddUp) {
+  // The statistics of the apps start with null details
+  SchedulerStatistics statistics{0, 0, 0, 0};
+  for (int app = 0; app < 3; ++app) {
+    statistics.add(SchedulerStatistics{
+        1, 2, 3, 4, folly::dynamic::object("attribution_metrics.sent", 100)});
+  }
+  EXPECT_EQ(3, statistics.nonFreeGates);
+  EXPECT_EQ(300, statistics.details["attribution_metrics.sent"].asInt());
+}
+
+TEST(MetricsRegistryTest, TestCountersAddAcrossThreads) {
+  auto& counter =
+      MetricsRegistry::getInstance().getCounter("test.concurrent_counter");
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < 8; ++thread) {
+    threads.emplace_back([&counter]() {
+      for (int i = 0; i < 10000; ++i) {
+        counter.add(1);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(80000, counter.getValue());
+  EXPECT_EQ(
+      &counter,
+      &MetricsRegistry::getInstance().getCounter("test.concurrent_counter"));
+}
+
+TEST(MetricsRegistryTest, TestDoubleCountersAddAcrossThreads) {
+  auto& counter = MetricsRegistry::getInstance().getDoubleCounter(
+      "test.concurrent_double_counter");
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < 8; ++thread) {
+    threads.emplace_back([&counter]() {
+      for (int i = 0; i < 10000; ++i) {
+        counter.add(0.5);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_DOUBLE_EQ(40000.0, counter.getValue());
+}
+
+TEST(MetricsRegistryTest, TestHistogramBuckets) {
+  Histogram histogram;
+  histogram.record(0.5);
+  histogram.record(1);
+  histogram.record(3);
+  histogram.record(3.5);
+  auto histogramDynamic = histogram.toDynamic();
+  EXPECT_EQ(4, histogramDynamic["count"].asInt());
+  EXPECT_DOUBLE_EQ(8.0, histogramDynamic["sum"].asDouble());
+  EXPECT_EQ(1, histogramDynamic["buckets"]["lt_1"].asInt());
+  EXPECT_EQ(1, histogramDynamic["buckets"]["lt_2"].asInt());
+  EXPECT_EQ(2, histogramDynamic["buckets"]["lt_4"].asInt());
+}
+
+} // namespace common
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+
+#include "fbpcs/emp_games/common/MetricsRegistry.h"
+#include "fbpcs/emp_games/common/MetricsServer.h"
+
+namespace common {
+
+namespace {
+std::string scrape(uint16_t port, const std::string& path) {
+  int connection = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+  EXPECT_EQ(
+      0,
+      ::connect(
+          connection,
+          reinterpret_cast<sockaddr*>(&address),
+          sizeof(address)));
+  auto request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  ::send(connection, request.data(), request.size(), 0);
+
+  std::string response;
+  char buffer[1024];
+  ssize_t received;
+  while ((received = ::recv(connection, buffer, sizeof(buffer), 0)) > 0) {
+    response.append(buffer, received);
+  }
+  ::close(connection);
+  return response;
+}
+} // namespace
+
+TEST(MetricsServerTest, TestPrometheusText) {
+  auto& registry = MetricsRegistry::getInstance();
+  registry.getCounter("test.server.rows").add(42);
+  registry.getGauge("test.server.files_total").set(8);
+  registry.getHistogram("test.server.milliseconds").record(3);
+
+  auto text = registry.toPrometheusText(kMetricsNamePrefix);
+  EXPECT_NE(
+      std::string::npos, text.find("# TYPE pcf2_test_server_rows counter"));
+  EXPECT_NE(std::string::npos, text.find("pcf2_test_server_rows 42\n"));
+  EXPECT_NE(std::string::npos, text.find("pcf2_test_server_files_total 8\n"));
+  EXPECT_NE(
+      std::string::npos,
+      text.find("pcf2_test_server_milliseconds_bucket{le=\"4\"} 1\n"));
+  EXPECT_NE(
+      std::string::npos,
+      text.find("pcf2_test_server_milliseconds_bucket{le=\"+Inf\"} 1\n"));
+  EXPECT_NE(
+      std::string::npos, text.find("pcf2_test_server_milliseconds_count 1\n"));
+}
+
+TEST(MetricsServerTest, TestServesMetrics) {
+  MetricsRegistry::getInstance().getCounter("test.server.scraped").add(7);
+  MetricsServer server{0};
+  ASSERT_NE(0, server.getPort());
+
+  auto response = scrape(server.getPort(), "/metrics");
+  EXPECT_EQ(0, response.rfind("HTTP/1.1 200 OK", 0));
+  EXPECT_NE(std::string::npos, response.find("pcf2_test_server_scraped 7\n"));
+
+  EXPECT_EQ(
+      0, scrape(server.getPort(), "/other").rfind("HTTP/1.1 404 Not Found", 0));
+}
+
+TEST(MetricsServerTest, TestNoServerWithoutPort) {
+  FLAGS_metrics_port = 0;
+  EXPECT_EQ(nullptr, MetricsServer::startFromFlags());
+}
+
+} // namespace common
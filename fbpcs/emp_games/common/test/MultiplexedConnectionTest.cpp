@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "fbpcf/engine/communication/test/AgentFactoryCreationHelper.h"
+#include "fbpcf/util/MetricCollector.h"
+
+#include "fbpcs/emp_games/common/MultiplexedConnection.h"
+
+namespace common {
+
+namespace {
+std::vector<unsigned char> makeData(size_t size, unsigned char seed) {
+  std::vector<unsigned char> data(size);
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<unsigned char>(seed + i * 7);
+  }
+  return data;
+}
+
+/*
+ * Runs each party with its connection to the other over in memory agents, on
+ * its own thread. A connection waits for the other party to close its side
+ * when destroyed, so they are destroyed on the threads of their parties.
+ */
+void runParties(
+    uint32_t window,
+    std::function<void(std::shared_ptr<MultiplexedConnection>)> runPublisher,
+    std::function<void(std::shared_ptr<MultiplexedConnection>)> runPartner) {
+  auto factories = fbpcf::engine::communication::getInMemoryAgentFactory(2);
+  auto runParty = [&](int party, const auto& run) {
+    run(MultiplexedConnection::create(
+        party, 1 - party, std::move(factories[party]), window));
+  };
+  auto publisher =
+      std::async(std::launch::async, runParty, 0, std::cref(runPublisher));
+  auto partner =
+      std::async(std::launch::async, runParty, 1, std::cref(runPartner));
+  publisher.get();
+  partner.get();
+}
+} // namespace
+
+TEST(MultiplexedConnectionTest, TestAgentsOfLanesAreSeparateStreams) {
+  auto metricCollector =
+      std::make_shared<fbpcf::util::MetricCollector>("multiplexed_test");
+  auto run = [&](int party) {
+    return [&, party](std::shared_ptr<MultiplexedConnection> connection) {
+      MultiplexedAgentFactory lane0{connection, 0, metricCollector};
+      MultiplexedAgentFactory lane1{connection, 1, metricCollector};
+      auto a = lane0.create(1 - party, "a");
+      auto b = lane0.create(1 - party, "b");
+      auto c = lane1.create(1 - party, "a");
+
+      // Each party sends on every agent, then reads them in an order of its
+      // own
+      a->send(makeData(10, party));
+      b->send(makeData(20, party + 10));
+      c->send(makeData(30, party + 20));
+      int other = 1 - party;
+      if (party == 0) {
+        EXPECT_EQ(makeData(30, other + 20), c->receive(30));
+        EXPECT_EQ(makeData(10, other), a->receive(10));
+        EXPECT_EQ(makeData(20, other + 10), b->receive(20));
+      } else {
+        EXPECT_EQ(makeData(20, other + 10), b->receive(20));
+        EXPECT_EQ(makeData(30, other + 20), c->receive(30));
+        EXPECT_EQ(makeData(10, other), a->receive(10));
+      }
+      EXPECT_EQ(
+          (std::pair<uint64_t, uint64_t>{30, 30}), c->getTrafficStatistics());
+    };
+  };
+  runParties(MultiplexedConnection::kDefaultWindow, run(0), run(1));
+}
+
+TEST(MultiplexedConnectionTest, TestStreamBeyondWindowDoesNotBlockOthers) {
+  auto window = MultiplexedConnection::kMaxFrameSize;
+  auto large = makeData(5 * window + 3, 1);
+  auto small = makeData(100, 2);
+  auto metricCollector =
+      std::make_shared<fbpcf::util::MetricCollector>("multiplexed_test");
+
+  runParties(
+      window,
+      [&](std::shared_ptr<MultiplexedConnection> connection) {
+        MultiplexedAgentFactory factory{connection, 0, metricCollector};
+        auto largeAgent = factory.create(1, "large");
+        auto smallAgent = factory.create(1, "small");
+        // The large message is held back by its window until the partner
+        // reads it, which it only does after the small one
+        auto sending = std::async(std::launch::async, [&]() {
+          largeAgent->send(large);
+        });
+        smallAgent->send(small);
+        sending.get();
+      },
+      [&](std::shared_ptr<MultiplexedConnection> connection) {
+        MultiplexedAgentFactory factory{connection, 0, metricCollector};
+        auto largeAgent = factory.create(0, "large");
+        auto smallAgent = factory.create(0, "small");
+        EXPECT_EQ(small, smallAgent->receive(small.size()));
+        EXPECT_EQ(large, largeAgent->receive(large.size()));
+      });
+}
+
+TEST(MultiplexedConnectionTest, TestRejectsOtherParty) {
+  auto metricCollector =
+      std::make_shared<fbpcf::util::MetricCollector>("multiplexed_test");
+  auto run = [&](std::shared_ptr<MultiplexedConnection> connection) {
+    MultiplexedAgentFactory factory{connection, 0, metricCollector};
+    EXPECT_THROW(factory.create(2, "agent"), std::invalid_argument);
+  };
+  runParties(MultiplexedConnection::kDefaultWindow, run, run);
+}
+
+} // namespace common
@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "fbpcs/emp_games/common/OramSelection.h"
+
+namespace common {
+
+TEST(OramSelectionTest, TestUseLinearOram) {
+  EXPECT_TRUE(useLinearOram(1, kNarrowOramValueWidth));
+  EXPECT_TRUE(
+      useLinearOram(kMaxLinearOramSizeForNarrowValues, kNarrowOramValueWidth));
+  EXPECT_FALSE(useLinearOram(
+      kMaxLinearOramSizeForNarrowValues + 1, kNarrowOramValueWidth));
+
+  EXPECT_TRUE(useLinearOram(1, 2 * kNarrowOramValueWidth));
+  EXPECT_TRUE(useLinearOram(
+      kMaxLinearOramSizeForWideValues, 2 * kNarrowOramValueWidth));
+  EXPECT_FALSE(useLinearOram(
+      kMaxLinearOramSizeForWideValues + 1, 2 * kNarrowOramValueWidth));
+}
+
+} // namespace common
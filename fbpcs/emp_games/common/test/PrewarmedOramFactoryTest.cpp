@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fbpcs/emp_games/common/PrewarmedOramFactory.h"
+
+namespace common {
+
+// Records the ORAMs it is asked for instead of creating them
+class RecordingOramFactory
+    : public fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<uint32_t> {
+ public:
+  RecordingOramFactory(
+      std::string name,
+      std::vector<std::pair<std::string, std::size_t>>& created,
+      std::mutex& mutex)
+      : name_{std::move(name)}, created_{created}, mutex_{mutex} {}
+
+  std::unique_ptr<fbpcf::mpc_std_lib::oram::IWriteOnlyOram<uint32_t>> create(
+      size_t size) override {
+    std::lock_guard<std::mutex> lock{mutex_};
+    created_.emplace_back(name_, size);
+    return nullptr;
+  }
+
+  uint32_t getMaxBatchSize(size_t size, int8_t /* concurrency */) override {
+    return size;
+  }
+
+ private:
+  std::string name_;
+  std::vector<std::pair<std::string, std::size_t>>& created_;
+  std::mutex& mutex_;
+};
+
+TEST(PrewarmedOramFactoryTest, TestCreatesOramsInTheOrderAskedFor) {
+  std::vector<std::pair<std::string, std::size_t>> created;
+  std::mutex mutex;
+  OramPrewarmer prewarmer;
+  PrewarmedOramFactory<uint32_t> first{
+      std::make_unique<RecordingOramFactory>("first", created, mutex),
+      4,
+      2,
+      prewarmer};
+  PrewarmedOramFactory<uint32_t> second{
+      std::make_unique<RecordingOramFactory>("second", created, mutex),
+      8,
+      1,
+      prewarmer};
+
+  // The ORAMs which weren't created ahead, for another size or once the
+  // prewarmed ones were used, are created after the prewarmed ones
+  second.create(8);
+  first.create(16);
+  first.create(4);
+  first.create(4);
+  second.create(8);
+
+  std::vector<std::pair<std::string, std::size_t>> expected{
+      {"first", 4}, {"first", 4}, {"second", 8}, {"first", 16}, {"second", 8}};
+  EXPECT_EQ(created, expected);
+  EXPECT_EQ(first.getMaxBatchSize(4, 1), 4);
+}
+
+} // namespace common
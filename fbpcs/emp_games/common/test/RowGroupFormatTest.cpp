@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "folly/Random.h"
+
+#include "fbpcs/emp_games/common/Csv.h"
+#include "fbpcs/emp_games/common/RowGroupFormat.h"
+
+namespace private_measurement::row_group {
+
+class RowGroupFormatTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    filename_ = std::filesystem::temp_directory_path() /
+        ("RowGroupFormatTest_" + std::to_string(folly::Random::rand32()));
+  }
+
+  void TearDown() override {
+    std::filesystem::remove(filename_);
+  }
+
+  void writeRowGroupFile(const std::string& csv, uint32_t rowsPerGroup) {
+    std::stringstream in{csv};
+    std::ofstream out{filename_, std::ios::binary};
+    convertCsv(in, out, rowsPerGroup);
+  }
+
+  std::filesystem::path filename_;
+  const std::string csv_ =
+      "id_,ad_ids,timestamps,is_click\n"
+      "abc,[0,1,2],[0,100,200],[0,0,1]\n"
+      "def,[0,0,3],[0,0,-5],[0,0,0]\n"
+      "ghi,[4,5,6],[300,400,500],[1,1,1]\n";
+};
+
+TEST_F(RowGroupFormatTest, TestSchemaIsInferredFromFirstRow) {
+  std::vector<std::string_view> firstRow = {"abc", "[1,2,3]", "42", "x"};
+  auto schema =
+      inferSchema({"id_email", "values", "cohort_id", "label"}, firstRow);
+  Schema expected = {
+      {"id_email", ColumnType::kString, 0},
+      {"values", ColumnType::kInt64Array, 3},
+      {"cohort_id", ColumnType::kInt64, 0},
+      {"label", ColumnType::kString, 0}};
+  EXPECT_EQ(expected, schema);
+}
+
+TEST_F(RowGroupFormatTest, TestRoundTrip) {
+  std::stringstream in{csv_};
+  std::stringstream encoded;
+  convertCsv(in, encoded, 2 /* rowsPerGroup */);
+
+  RowGroupReader reader{streamSource(encoded)};
+  std::vector<std::string> expectedHeader = {
+      "id_", "ad_ids", "timestamps", "is_click"};
+  EXPECT_EQ(expectedHeader, reader.getHeader());
+  EXPECT_EQ(3, reader.getSchema().at(1).arrayWidth);
+
+  std::string decoded;
+  std::vector<uint32_t> groupSizes;
+  RowGroup group;
+  while (reader.next(group)) {
+    groupSizes.push_back(group.numRows);
+    for (size_t row = 0; row < group.numRows; ++row) {
+      for (size_t column = 0; column < reader.getSchema().size(); ++column) {
+        if (column > 0) {
+          decoded += ',';
+        }
+        appendCsvCell(reader.getSchema(), group, column, row, decoded);
+      }
+      decoded += '\n';
+    }
+  }
+  EXPECT_EQ(std::vector<uint32_t>({2, 1}), groupSizes);
+  EXPECT_EQ(csv_.substr(csv_.find('\n') + 1), decoded);
+  EXPECT_FALSE(reader.next(group));
+}
+
+TEST_F(RowGroupFormatTest, TestEmptyInput) {
+  std::stringstream in{"id_,values\n"};
+  std::stringstream encoded;
+  convertCsv(in, encoded);
+
+  RowGroupReader reader{streamSource(encoded)};
+  Schema expected = {
+      {"id_", ColumnType::kString, 0}, {"values", ColumnType::kInt64, 0}};
+  EXPECT_EQ(expected, reader.getSchema());
+  RowGroup group;
+  EXPECT_FALSE(reader.next(group));
+}
+
+TEST_F(RowGroupFormatTest, TestArrayWidthMismatchThrows) {
+  std::stringstream in{"id_,values\na,[1,2]\nb,[1,2,3]\n"};
+  std::stringstream encoded;
+  EXPECT_THROW(convertCsv(in, encoded), std::invalid_argument);
+}
+
+TEST_F(RowGroupFormatTest, TestTruncatedInputThrows) {
+  std::stringstream in{csv_};
+  std::stringstream encoded;
+  convertCsv(in, encoded);
+  auto bytes = encoded.str();
+  std::stringstream truncated{bytes.substr(0, bytes.size() - 10)};
+
+  RowGroupReader reader{streamSource(truncated)};
+  RowGroup group;
+  EXPECT_THROW(reader.next(group), std::runtime_error);
+}
+
+TEST_F(RowGroupFormatTest, TestCsvReadersAcceptRowGroups) {
+  writeRowGroupFile(csv_, 2);
+
+  EXPECT_EQ(3, csv::countCsvRows(filename_.native()));
+
+  std::vector<std::string> header;
+  std::vector<std::vector<std::string>> rows;
+  csv::readCsv(
+      filename_.native(),
+      [&](const std::vector<std::string>& rowHeader,
+          const std::vector<std::string>& parts) {
+        header = rowHeader;
+        rows.push_back(parts);
+      });
+  std::vector<std::string> expectedHeader = {
+      "id_", "ad_ids", "timestamps", "is_click"};
+  std::vector<std::vector<std::string>> expectedRows = {
+      {"abc", "[0,1,2]", "[0,100,200]", "[0,0,1]"},
+      {"def", "[0,0,3]", "[0,0,-5]", "[0,0,0]"},
+      {"ghi", "[4,5,6]", "[300,400,500]", "[1,1,1]"}};
+  EXPECT_EQ(expectedHeader, header);
+  EXPECT_EQ(expectedRows, rows);
+
+  std::vector<std::vector<std::string>> chunkedRows;
+  csv::readCsvViewsInChunks(
+      filename_.native(),
+      4,
+      [&](size_t chunk,
+          const std::vector<std::string>&,
+          const std::vector<std::string_view>& parts) {
+        EXPECT_EQ(0, chunk);
+        chunkedRows.emplace_back(parts.begin(), parts.end());
+      });
+  EXPECT_EQ(expectedRows, chunkedRows);
+}
+
+TEST_F(RowGroupFormatTest, TestReadRowGroupsSkipsCsv) {
+  {
+    std::ofstream out{filename_};
+    out << csv_;
+  }
+  bool called = false;
+  EXPECT_FALSE(csv::readRowGroups(
+      filename_.native(), [&](const Schema&, const RowGroup&) {
+        called = true;
+      }));
+  EXPECT_FALSE(called);
+  EXPECT_EQ(3, csv::countCsvRows(filename_.native()));
+}
+} // namespace private_measurement::row_group
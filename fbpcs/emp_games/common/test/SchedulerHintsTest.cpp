@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+#include "fbpcs/emp_games/common/SchedulerHints.h"
+
+namespace common {
+
+TEST(SchedulerHintsTest, TestParsesHintsOverTheDefaults) {
+  SchedulerHints defaults;
+  defaults.flushRows = 100;
+  defaults.maxBatchWidth = 8;
+
+  auto hints = parseSchedulerHints("", defaults);
+  EXPECT_TRUE(hints.lazy);
+  EXPECT_EQ(100, hints.flushRows);
+  EXPECT_EQ(8, hints.maxBatchWidth);
+
+  hints = parseSchedulerHints("eager,max_batch_width=1024", defaults);
+  EXPECT_FALSE(hints.lazy);
+  EXPECT_EQ(100, hints.flushRows);
+  EXPECT_EQ(1024, hints.maxBatchWidth);
+
+  hints = parseSchedulerHints("eager,flush_rows=0,,lazy", defaults);
+  EXPECT_TRUE(hints.lazy);
+  EXPECT_EQ(0, hints.flushRows);
+  EXPECT_EQ(8, hints.maxBatchWidth);
+}
+
+TEST(SchedulerHintsTest, TestRoundTripsThroughItsString) {
+  SchedulerHints hints;
+  hints.lazy = false;
+  hints.flushRows = 50000;
+  hints.maxBatchWidth = 256;
+  EXPECT_EQ("eager,flush_rows=50000,max_batch_width=256", hints.toString());
+
+  auto parsed = parseSchedulerHints(hints.toString());
+  EXPECT_EQ(hints.lazy, parsed.lazy);
+  EXPECT_EQ(hints.flushRows, parsed.flushRows);
+  EXPECT_EQ(hints.maxBatchWidth, parsed.maxBatchWidth);
+}
+
+TEST(SchedulerHintsTest, TestThrowsOnBadHints) {
+  EXPECT_THROW(parseSchedulerHints("greedy"), std::invalid_argument);
+  EXPECT_THROW(parseSchedulerHints("flush_rows"), std::invalid_argument);
+  EXPECT_THROW(parseSchedulerHints("flush_rows="), std::invalid_argument);
+  EXPECT_THROW(parseSchedulerHints("flush_rows=-1"), std::invalid_argument);
+  EXPECT_THROW(parseSchedulerHints("lazy=1"), std::invalid_argument);
+  EXPECT_THROW(
+      parseSchedulerHints("max_batch_width=99999999999999999999999"),
+      std::invalid_argument);
+}
+
+TEST(SchedulerHintsTest, TestTheFlagOverridesTheHintsOfAGame) {
+  SchedulerHints gameHints;
+  gameHints.flushRows = 10;
+  FLAGS_scheduler_hints = "max_batch_width=64";
+  auto hints = getSchedulerHints(gameHints);
+  FLAGS_scheduler_hints = "";
+  EXPECT_TRUE(hints.lazy);
+  EXPECT_EQ(10, hints.flushRows);
+  EXPECT_EQ(64, hints.maxBatchWidth);
+}
+
+} // namespace common
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "fbpcs/emp_games/common/SchedulerSlots.h"
+
+namespace common {
+
+template <int schedulerId>
+SchedulerStatistics runTestApp(std::unique_ptr<int> gates) {
+  return {
+      static_cast<uint64_t>(*gates),
+      schedulerId,
+      0,
+      0,
+      folly::dynamic::object()};
+}
+
+TEST(SchedulerSlotsTest, TestRunsTheAppOfASlot) {
+  SchedulerSlots<4, std::unique_ptr<int>> slots([](auto slot) {
+    return runTestApp<2 * decltype(slot)::value + 1>;
+  });
+  EXPECT_EQ(4, slots.getNumSlots());
+
+  for (std::size_t slot = 0; slot < 4; ++slot) {
+    auto statistics = slots.run(slot, std::make_unique<int>(7));
+    EXPECT_EQ(7, statistics.nonFreeGates);
+    EXPECT_EQ(2 * slot + 1, statistics.freeGates);
+  }
+  EXPECT_THROW(slots.run(4, std::make_unique<int>(0)), std::out_of_range);
+}
+
+TEST(SchedulerSlotsTest, TestAddsUpTheStatisticsOfTheApps) {
+  SchedulerSlots<4, std::unique_ptr<int>> slots(
+      [](auto slot) { return runTestApp<decltype(slot)::value>; });
+
+  auto statistics = runAppsInSlots(3, [&slots](std::size_t slot) {
+    return std::async(std::launch::async, [&slots, slot]() {
+      return slots.run(slot, std::make_unique<int>(10));
+    });
+  });
+  EXPECT_EQ(30, statistics.nonFreeGates);
+  // Slots 0, 1 and 2
+  EXPECT_EQ(3, statistics.freeGates);
+}
+
+TEST(SchedulerSlotsTest, TestStopsStartingAppsWhenTold) {
+  std::vector<std::size_t> started;
+  auto statistics = runAppsInSlots(
+      4,
+      [&started](std::size_t slot) {
+        started.push_back(slot);
+        return std::async(std::launch::async, []() {
+          return SchedulerStatistics{1, 0, 0, 0, folly::dynamic::object()};
+        });
+      },
+      [](std::size_t slot) { return slot < 2; });
+  EXPECT_EQ((std::vector<std::size_t>{0, 1}), started);
+  EXPECT_EQ(2, statistics.nonFreeGates);
+}
+
+} // namespace common
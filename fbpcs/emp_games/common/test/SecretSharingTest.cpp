@@ -50,6 +50,38 @@ TEST(SecretSharingTest, TestPrivatelyShareIntsFromAlice) {
       });
 }
 
+TEST(SecretSharingTest, TestPrivatelyShareNarrowIntsAndBitsFromBob) {
+  fbpcf::mpc::wrapTestWithParty<std::function<void(fbpcf::Party party)>>(
+      [](fbpcf::Party party) {
+        std::vector<int64_t> bobInts{0, 1, 1000, (int64_t{1} << 31) - 1};
+        std::vector<int64_t> bobBits{1, 0, 0, 1, 1};
+        auto bitLen = 32;
+        std::vector<emp::Integer> ints;
+        std::vector<emp::Bit> bits;
+
+        if (party == fbpcf::Party::Alice) {
+          ints = privatelyShareIntsFromBob<emp::ALICE>(
+              // Alice passes in dummy arrays
+              std::vector<int64_t>(),
+              bobInts.size(),
+              bitLen);
+          bits = privatelyShareBitsFromBob<emp::ALICE>(
+              std::vector<int64_t>(), bobBits.size());
+        } else {
+          ints = privatelyShareIntsFromBob<emp::BOB>(
+              bobInts, bobInts.size(), bitLen);
+          bits = privatelyShareBitsFromBob<emp::BOB>(bobBits, bobBits.size());
+        }
+
+        ASSERT_EQ(bobInts.size(), ints.size());
+        EXPECT_EQ(bitLen, ints.at(0).size());
+        EXPECT_EQ(bobInts, (revealVector<emp::Integer, int64_t>(ints)));
+        auto revealedBits = revealVector<emp::Bit, bool>(bits);
+        EXPECT_EQ(
+            std::vector<bool>(bobBits.begin(), bobBits.end()), revealedBits);
+      });
+}
+
 TEST(SecretSharingTest, TestPrivatelyShareArraysFromBob) {
   fbpcf::mpc::wrapTestWithParty<std::function<void(fbpcf::Party party)>>(
       [](fbpcf::Party party) {
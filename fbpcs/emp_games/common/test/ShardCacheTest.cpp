@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "fbpcf/engine/communication/test/AgentFactoryCreationHelper.h"
+#include "fbpcf/io/api/FileIOWrappers.h"
+#include "folly/Random.h"
+
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/ShardCache.h"
+
+namespace common {
+
+class ShardCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = std::filesystem::temp_directory_path() /
+        ("ShardCacheTest_" + std::to_string(folly::Random::rand32()));
+    std::filesystem::create_directories(directory_);
+    for (auto party : {PUBLISHER, PARTNER}) {
+      inputPaths_.push_back(path("input_" + std::to_string(party)));
+      stampPaths_.push_back(path("output_" + std::to_string(party)));
+      fbpcf::io::FileIOWrappers::writeFile(inputPaths_.at(party), "1,2,3\n");
+    }
+  }
+
+  void TearDown() override {
+    std::filesystem::remove_all(directory_);
+  }
+
+  std::string path(const std::string& name) const {
+    return (directory_ / name).native();
+  }
+
+  // Runs a shard on both parties, which compute it and write its stamp unless
+  // isComputed, and returns whether each party skipped it
+  std::vector<bool> runShard(
+      const std::string& publisherConfig = "config",
+      const std::string& partnerConfig = "config") {
+    auto factories = fbpcf::engine::communication::getInMemoryAgentFactory(2);
+    auto run = [this, &factories](int party, std::string config) {
+      ShardCache cache{party, config, *factories.at(party)};
+      auto skipped = cache.isComputed(
+          {inputPaths_.at(party)},
+          shardCacheStampPath(stampPaths_.at(party)));
+      if (!skipped) {
+        cache.markComputed(shardCacheStampPath(stampPaths_.at(party)));
+      }
+      return skipped;
+    };
+    auto publisher = std::async(
+        std::launch::async, run, PUBLISHER, std::string{publisherConfig});
+    auto partner = std::async(
+        std::launch::async, run, PARTNER, std::string{partnerConfig});
+    return {publisher.get(), partner.get()};
+  }
+
+  std::filesystem::path directory_;
+  std::vector<std::string> inputPaths_;
+  std::vector<std::string> stampPaths_;
+};
+
+TEST_F(ShardCacheTest, TestSkipsShardsComputedByBothParties) {
+  EXPECT_EQ(std::vector<bool>({false, false}), runShard());
+  EXPECT_EQ(std::vector<bool>({true, true}), runShard());
+}
+
+TEST_F(ShardCacheTest, TestChangedInputIsComputed) {
+  runShard();
+  fbpcf::io::FileIOWrappers::writeFile(inputPaths_.at(PARTNER), "1,2,4\n");
+  EXPECT_EQ(std::vector<bool>({false, false}), runShard());
+  EXPECT_EQ(std::vector<bool>({true, true}), runShard());
+}
+
+TEST_F(ShardCacheTest, TestChangedConfigIsComputed) {
+  runShard();
+  EXPECT_EQ(std::vector<bool>({false, false}), runShard("config", "other"));
+}
+
+TEST_F(ShardCacheTest, TestStampsOfDifferentRunsAreComputed) {
+  runShard();
+  auto publisherStamp = fbpcf::io::FileIOWrappers::readFile(
+      shardCacheStampPath(stampPaths_.at(PUBLISHER)));
+  // Only the partner computes the shard again after losing its stamp
+  std::filesystem::remove(shardCacheStampPath(stampPaths_.at(PARTNER)));
+  runShard();
+  fbpcf::io::FileIOWrappers::writeFile(
+      shardCacheStampPath(stampPaths_.at(PUBLISHER)), publisherStamp);
+  EXPECT_EQ(std::vector<bool>({false, false}), runShard());
+}
+
+TEST(ShardCacheKeyTest, TestKeyDependsOnContentAndConfig) {
+  auto directory = std::filesystem::temp_directory_path() /
+      ("ShardCacheKeyTest_" + std::to_string(folly::Random::rand32()));
+  std::filesystem::create_directories(directory);
+  auto first = (directory / "first").native();
+  auto second = (directory / "second").native();
+  fbpcf::io::FileIOWrappers::writeFile(first, "ab");
+  fbpcf::io::FileIOWrappers::writeFile(second, "c");
+
+  auto key = shardCacheKey({first, second}, "config");
+  EXPECT_EQ(key, shardCacheKey({first, second}, "config"));
+  EXPECT_NE(key, shardCacheKey({first, second}, "other"));
+  EXPECT_NE(key, shardCacheKey({second, first}, "config"));
+  // The boundaries between the files are part of the key
+  fbpcf::io::FileIOWrappers::writeFile(first, "a");
+  fbpcf::io::FileIOWrappers::writeFile(second, "bc");
+  EXPECT_NE(key, shardCacheKey({first, second}, "config"));
+  std::filesystem::remove_all(directory);
+}
+
+} // namespace common
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fbpcf/engine/communication/test/AgentFactoryCreationHelper.h"
+#include "fbpcf/io/api/FileIOWrappers.h"
+#include "folly/Random.h"
+
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/ShardQueue.h"
+
+namespace common {
+
+// The files run by one app, in the order it ran them
+static std::vector<std::size_t> runFiles(ShardAssignment& files) {
+  std::vector<std::size_t> run;
+  for (auto file = files.next(); file.has_value(); file = files.next()) {
+    run.push_back(*file);
+  }
+  return run;
+}
+
+TEST(ShardQueueTest, TestTakesEveryFileOnce) {
+  ShardQueue queue{3};
+  EXPECT_EQ(std::optional<std::size_t>{0}, queue.take());
+  EXPECT_EQ(std::optional<std::size_t>{1}, queue.take());
+  EXPECT_EQ(std::optional<std::size_t>{2}, queue.take());
+  EXPECT_EQ(std::nullopt, queue.take());
+  EXPECT_EQ(std::nullopt, queue.take());
+}
+
+TEST(ShardQueueTest, TestTakesFilesInGivenOrder) {
+  ShardQueue queue{std::vector<std::size_t>{2, 0, 1}};
+  EXPECT_EQ(std::optional<std::size_t>{2}, queue.take());
+  EXPECT_EQ(std::optional<std::size_t>{0}, queue.take());
+  EXPECT_EQ(std::optional<std::size_t>{1}, queue.take());
+  EXPECT_EQ(std::nullopt, queue.take());
+}
+
+TEST(ShardQueueTest, TestOrderLongestFirst) {
+  EXPECT_EQ(
+      std::vector<std::size_t>({3, 1, 0, 4, 2}),
+      orderLongestFirst({5, 7, 1, 9, 5}));
+  EXPECT_EQ(std::vector<std::size_t>{}, orderLongestFirst({}));
+}
+
+TEST(ShardQueueTest, TestMakeShardQueueFromManifest) {
+  auto manifestPath = std::filesystem::temp_directory_path() /
+      ("ShardQueueTest_" + std::to_string(folly::Random::rand32()));
+  fbpcf::io::FileIOWrappers::writeFile(
+      manifestPath.native(), "{\"shard_costs\": [3, 10, 5]}");
+
+  auto queue = makeShardQueue(3, manifestPath.native());
+  EXPECT_EQ(std::optional<std::size_t>{1}, queue->take());
+  EXPECT_EQ(std::optional<std::size_t>{2}, queue->take());
+  EXPECT_EQ(std::optional<std::size_t>{0}, queue->take());
+  EXPECT_EQ(std::nullopt, queue->take());
+
+  // A manifest which doesn't match the files, or none, runs them in order
+  for (auto path : {manifestPath.native(), std::string{"/nonexistent"}}) {
+    auto inOrder = makeShardQueue(2, path);
+    EXPECT_EQ(std::optional<std::size_t>{0}, inOrder->take());
+    EXPECT_EQ(std::optional<std::size_t>{1}, inOrder->take());
+  }
+  std::filesystem::remove(manifestPath);
+}
+
+TEST(ShardQueueTest, TestFixedRangeAssignment) {
+  ShardAssignment files{2, 3};
+  EXPECT_EQ(std::vector<std::size_t>({2, 3, 4}), runFiles(files));
+
+  ShardAssignment noFiles{0, 0};
+  EXPECT_EQ(std::vector<std::size_t>{}, runFiles(noFiles));
+}
+
+TEST(ShardQueueTest, TestPairsOfAppsRunTheSameFiles) {
+  const std::size_t numFiles = 20;
+  const std::size_t numPairs = 3;
+  auto queue = std::make_shared<ShardQueue>(numFiles);
+
+  std::vector<std::future<std::vector<std::size_t>>> publisherRuns;
+  std::vector<std::future<std::vector<std::size_t>>> partnerRuns;
+  for (std::size_t pair = 0; pair < numPairs; ++pair) {
+    auto factories = fbpcf::engine::communication::getInMemoryAgentFactory(2);
+    // The first pair is slow, as if its files were larger, so the others
+    // should take more of the files
+    auto delay = std::chrono::milliseconds(pair == 0 ? 20 : 1);
+    publisherRuns.push_back(std::async(
+        std::launch::async,
+        [queue, delay, factory = std::move(factories.at(PUBLISHER))]() {
+          ShardAssignment files{PUBLISHER, queue, *factory};
+          std::vector<std::size_t> run;
+          for (auto file = files.next(); file.has_value();
+               file = files.next()) {
+            std::this_thread::sleep_for(delay);
+            run.push_back(*file);
+          }
+          return run;
+        }));
+    // The partner has its own queue, which it doesn't take files from
+    partnerRuns.push_back(std::async(
+        std::launch::async,
+        [numFiles, factory = std::move(factories.at(PARTNER))]() {
+          ShardAssignment files{
+              PARTNER, std::make_shared<ShardQueue>(numFiles), *factory};
+          return runFiles(files);
+        }));
+  }
+
+  std::vector<std::size_t> allFiles;
+  std::vector<std::size_t> numFilesPerPair;
+  for (std::size_t pair = 0; pair < numPairs; ++pair) {
+    auto publisherRun = publisherRuns.at(pair).get();
+    EXPECT_EQ(publisherRun, partnerRuns.at(pair).get());
+    numFilesPerPair.push_back(publisherRun.size());
+    allFiles.insert(allFiles.end(), publisherRun.begin(), publisherRun.end());
+  }
+  std::sort(allFiles.begin(), allFiles.end());
+  std::vector<std::size_t> expectedFiles(numFiles);
+  for (std::size_t i = 0; i < numFiles; ++i) {
+    expectedFiles.at(i) = i;
+  }
+  EXPECT_EQ(expectedFiles, allFiles);
+  EXPECT_LT(numFilesPerPair.at(0), numFilesPerPair.at(1));
+}
+
+} // namespace common
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "fbpcf/io/api/FileIOWrappers.h"
+#include "folly/Random.h"
+#include "folly/json.h"
+
+#include "fbpcs/emp_games/common/ShardReport.h"
+
+namespace common {
+
+class ShardReportTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = std::filesystem::temp_directory_path() /
+        ("ShardReportTest_" + std::to_string(folly::Random::rand32()));
+    std::filesystem::create_directories(directory_);
+    FLAGS_write_shard_reports = true;
+  }
+
+  void TearDown() override {
+    std::filesystem::remove_all(directory_);
+  }
+
+  std::string path(const std::string& name) const {
+    return (directory_ / name).string();
+  }
+
+  static ShardReport makeReport(std::size_t fileIndex, double seconds) {
+    ShardReport report;
+    report.fileIndex = fileIndex;
+    report.numRows = 100;
+    report.inputBytes = 1000;
+    report.outputBytes = 10;
+    report.mpc = {5, 50, 500, 400};
+    report.addPhase("input_parsing", seconds);
+    report.addPhase("lift", 2 * seconds);
+    return report;
+  }
+
+  std::filesystem::path directory_;
+};
+
+TEST_F(ShardReportTest, TestRoundTripsThroughDynamic) {
+  auto report = makeReport(3, 1.5);
+  report.addPhase("input_parsing", 0.5);
+  auto parsed = ShardReport::fromDynamic(
+      folly::parseJson(folly::toJson(report.toDynamic())));
+  EXPECT_EQ(3, parsed.fileIndex);
+  EXPECT_EQ(100, parsed.numRows);
+  EXPECT_EQ(1000, parsed.inputBytes);
+  EXPECT_EQ(500, parsed.mpc.sentNetwork);
+  ASSERT_EQ(2, parsed.phaseSeconds.size());
+  EXPECT_EQ("input_parsing", parsed.phaseSeconds.at(0).first);
+  EXPECT_DOUBLE_EQ(2.0, parsed.phaseSeconds.at(0).second);
+  EXPECT_DOUBLE_EQ(5.0, parsed.getTotalSeconds());
+}
+
+TEST_F(ShardReportTest, TestSummarizesShards) {
+  auto summary = summarizeShardReports(
+      {makeReport(0, 1), makeReport(1, 3), makeReport(2, 2)});
+  EXPECT_EQ(3, summary["num_shards"].asInt());
+  EXPECT_EQ(1, summary["slowest_shard"].asInt());
+  EXPECT_EQ(300, summary["totals"]["num_rows"].asInt());
+  EXPECT_EQ(15, summary["totals"]["non_free_gates"].asInt());
+  EXPECT_DOUBLE_EQ(12.0, summary["totals"]["phase_seconds"]["lift"].asDouble());
+  EXPECT_EQ(3, summary["shards"].size());
+}
+
+TEST_F(ShardReportTest, TestReporterWritesReportNextToOutput) {
+  auto inputPath = path("input_0");
+  auto outputPath = path("output_0");
+  fbpcf::io::FileIOWrappers::writeFile(inputPath, "id_\n1\n2\n");
+
+  // Counters growing by 10 gates and 100 bytes between reads
+  uint64_t reads = 0;
+  auto readCounters = [&reads]() {
+    ++reads;
+    return fbpcs::performance_tools::PhaseCounters{
+        reads * 10, 0, reads * 100, 0};
+  };
+
+  ShardReporter reporter;
+  {
+    ShardReporter::Phase phase{reporter, 0, "input_parsing", readCounters};
+    reporter.setInputPaths(0, {inputPath});
+    reporter.setNumRows(0, 2);
+  }
+  fbpcf::io::FileIOWrappers::writeFile(outputPath, "{}");
+  reporter.finish(0, outputPath);
+
+  auto report = readShardReport(outputPath);
+  ASSERT_TRUE(report.has_value());
+  EXPECT_EQ(2, report->numRows);
+  EXPECT_EQ(8, report->inputBytes);
+  EXPECT_EQ(2, report->outputBytes);
+  EXPECT_EQ(10, report->mpc.nonFreeGates);
+  EXPECT_EQ(100, report->mpc.sentNetwork);
+  ASSERT_EQ(1, report->phaseSeconds.size());
+  EXPECT_EQ("input_parsing", report->phaseSeconds.at(0).first);
+}
+
+TEST_F(ShardReportTest, TestReporterDoesNothingWhenDisabled) {
+  FLAGS_write_shard_reports = false;
+  auto outputPath = path("output_0");
+  fbpcf::io::FileIOWrappers::writeFile(outputPath, "{}");
+
+  ShardReporter reporter;
+  { ShardReporter::Phase phase{reporter, 0, "input_parsing"}; }
+  reporter.finish(0, outputPath);
+
+  EXPECT_FALSE(reporter.getReport(0).has_value());
+  EXPECT_FALSE(std::filesystem::exists(getShardReportPath(outputPath)));
+}
+
+TEST_F(ShardReportTest, TestRunReportSkipsShardsWithoutReports) {
+  std::vector<std::string> shardPaths = {path("shard_0"), path("shard_1")};
+  writeShardReport(shardPaths.at(0), makeReport(0, 1));
+  auto outputPath = path("combined");
+  writeRunReport(
+      shardPaths,
+      outputPath,
+      folly::dynamic::object("shard_combiner", makeReport(0, 4).toDynamic()));
+
+  auto runReport = folly::parseJson(
+      fbpcf::io::FileIOWrappers::readFile(getRunReportPath(outputPath)));
+  EXPECT_EQ(1, runReport["num_shards"].asInt());
+  EXPECT_EQ(100, runReport["totals"]["num_rows"].asInt());
+  EXPECT_TRUE(runReport.count("shard_combiner"));
+}
+
+} // namespace common
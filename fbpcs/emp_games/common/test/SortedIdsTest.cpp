@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "folly/Random.h"
+
+#include "fbpcs/emp_games/common/SortedIds.h"
+
+namespace common {
+
+TEST(SortedIdsTest, TestSortUniqueIds) {
+  std::vector<uint64_t> ids{
+      7, 0xffffffffffffffff, 3, 7, 1ull << 40, 0x10000, 3, 0x1ffff};
+  std::vector<uint64_t> expected{
+      3, 7, 0x10000, 0x1ffff, 1ull << 40, 0xffffffffffffffff};
+  EXPECT_EQ(sortUniqueIds(ids), expected);
+  EXPECT_TRUE(sortUniqueIds({}).empty());
+}
+
+TEST(SortedIdsTest, TestSortUniqueRandomIds) {
+  std::vector<uint64_t> ids;
+  for (int i = 0; i < 10000; ++i) {
+    ids.push_back(folly::Random::rand64() % 5000 << (i % 3 * 20));
+  }
+  auto expected = ids;
+  std::sort(expected.begin(), expected.end());
+  expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+  EXPECT_EQ(sortUniqueIds(ids), expected);
+}
+
+TEST(SortedIdsTest, TestCompressId) {
+  std::vector<uint64_t> sortedIds{3, 7, 1ull << 40};
+  EXPECT_EQ(compressId(sortedIds, 3), 1);
+  EXPECT_EQ(compressId(sortedIds, 7), 2);
+  EXPECT_EQ(compressId(sortedIds, 1ull << 40), 3);
+  EXPECT_EQ(compressId(sortedIds, 0), 0);
+  EXPECT_EQ(compressId(sortedIds, 5), 0);
+  EXPECT_EQ(compressId(sortedIds, 1ull << 41), 0);
+}
+
+} // namespace common
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "folly/Random.h"
+
+#include "fbpcs/emp_games/common/SortingNetwork.h"
+
+namespace common {
+
+TEST(SortingNetworkTest, TestSortsAnyNumberOfValues) {
+  for (std::size_t n = 0; n <= 70; ++n) {
+    auto layers = makeSortingNetwork(n);
+    for (int round = 0; round < 10; ++round) {
+      std::vector<uint64_t> values;
+      for (std::size_t i = 0; i < n; ++i) {
+        values.push_back(folly::Random::rand64() % 8);
+      }
+      auto expected = values;
+      std::sort(expected.begin(), expected.end());
+
+      for (const auto& layer : layers) {
+        for (const auto& [first, second] : layer) {
+          if (values.at(second) < values.at(first)) {
+            std::swap(values.at(first), values.at(second));
+          }
+        }
+      }
+      EXPECT_EQ(expected, values) << n;
+    }
+  }
+}
+
+TEST(SortingNetworkTest, TestLayersTouchEachValueOnce) {
+  for (std::size_t n : {5, 16, 33}) {
+    std::size_t logSize = 0;
+    while ((std::size_t{1} << logSize) < n) {
+      ++logSize;
+    }
+    auto layers = makeSortingNetwork(n);
+    EXPECT_LE(layers.size(), logSize * (logSize + 1) / 2);
+    for (const auto& layer : layers) {
+      std::vector<bool> touched(n, false);
+      for (const auto& [first, second] : layer) {
+        EXPECT_LT(first, second);
+        EXPECT_FALSE(touched.at(first));
+        EXPECT_FALSE(touched.at(second));
+        touched.at(first) = true;
+        touched.at(second) = true;
+      }
+    }
+  }
+}
+
+} // namespace common
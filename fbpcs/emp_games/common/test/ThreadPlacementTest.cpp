@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <future>
+#include <vector>
+
+#include "fbpcs/emp_games/common/ThreadPlacement.h"
+
+namespace common {
+
+TEST(ThreadPlacementTest, TestSplitsCpusIntoLanes) {
+  // Two nodes of four CPUs each, with the CPUs of the nodes interleaved
+  std::vector<Cpu> cpus{
+      {0, 0}, {2, 0}, {4, 0}, {6, 0}, {1, 1}, {3, 1}, {5, 1}, {7, 1}};
+  EXPECT_EQ(getLaneCpus(cpus, 0, 2), (std::vector<int>{0, 2, 4, 6}));
+  EXPECT_EQ(getLaneCpus(cpus, 1, 2), (std::vector<int>{1, 3, 5, 7}));
+  EXPECT_EQ(getLaneCpus(cpus, 1, 4), (std::vector<int>{4, 6}));
+  EXPECT_EQ(getLaneCpus(cpus, 2, 3), (std::vector<int>{3, 5, 7}));
+  // Lanes share CPUs when there are more lanes than CPUs
+  EXPECT_EQ(getLaneCpus(cpus, 9, 16), (std::vector<int>{2}));
+  EXPECT_TRUE(getLaneCpus({}, 0, 1).empty());
+}
+
+TEST(ThreadPlacementTest, TestAvailableCpusAreOrderedByNode) {
+  auto cpus = getAvailableCpus();
+  ASSERT_FALSE(cpus.empty());
+  for (std::size_t i = 1; i < cpus.size(); ++i) {
+    EXPECT_LE(cpus.at(i - 1).node, cpus.at(i).node);
+  }
+}
+
+TEST(ThreadPlacementTest, TestPinsThreadsStartedAfterwards) {
+  auto cpus = getAvailableCpus();
+  auto laneCpus = getLaneCpus(cpus, 0, 2);
+  std::async(std::launch::async, [&laneCpus]() {
+    pinThreadToLane(0, 2);
+    // A thread started by a pinned thread runs on the same CPUs
+    std::async(std::launch::async, [&laneCpus]() {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      ASSERT_EQ(sched_getaffinity(0, sizeof(set), &set), 0);
+      EXPECT_EQ(CPU_COUNT(&set), static_cast<int>(laneCpus.size()));
+      for (auto cpu : laneCpus) {
+        EXPECT_TRUE(CPU_ISSET(cpu, &set));
+      }
+    }).get();
+  }).get();
+}
+
+} // namespace common
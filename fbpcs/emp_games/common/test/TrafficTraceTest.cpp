@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "folly/Random.h"
+
+#include "fbpcf/engine/communication/test/AgentFactoryCreationHelper.h"
+#include "fbpcf/util/MetricCollector.h"
+
+#include "fbpcs/emp_games/common/TrafficReplay.h"
+#include "fbpcs/emp_games/common/TrafficTrace.h"
+#include "fbpcs/performance_tools/PhaseProfiler.h"
+
+namespace common {
+
+TEST(TrafficTraceTest, TestRecordsTheTrafficOfEachPhase) {
+  auto factories = fbpcf::engine::communication::getInMemoryAgentFactory(2);
+  auto metricCollector =
+      std::make_shared<fbpcf::util::MetricCollector>("trace_test");
+  auto tracePath = std::filesystem::temp_directory_path() /
+      ("TrafficTraceTest_" + std::to_string(folly::Random::secureRand64()));
+
+  {
+    RecordingAgentFactory sender{
+        std::move(factories[0]), tracePath.string(), metricCollector};
+    auto agent = sender.create(1, "test");
+    auto receiver = std::async(std::launch::async, [&factories]() {
+      auto agent = factories[1]->create(0, "test");
+      agent->receive(10);
+      agent->send(std::vector<unsigned char>(4, 2));
+    });
+    {
+      fbpcs::performance_tools::ScopedPhase phase{"sharing"};
+      EXPECT_EQ(
+          "sharing", fbpcs::performance_tools::ScopedPhase::getCurrentName());
+      agent->send(std::vector<unsigned char>(10, 1));
+    }
+    EXPECT_EQ("", fbpcs::performance_tools::ScopedPhase::getCurrentName());
+    EXPECT_EQ(std::vector<unsigned char>(4, 2), agent->receive(4));
+    receiver.get();
+  }
+
+  auto trace = TrafficTrace::read(tracePath.string());
+  std::filesystem::remove(tracePath);
+  EXPECT_EQ((std::vector<std::string>{"sharing", ""}), trace.phases);
+  ASSERT_EQ(2, trace.events.size());
+  EXPECT_EQ(TrafficEvent::Kind::kSend, trace.events[0].kind);
+  EXPECT_EQ(10, trace.events[0].bytes);
+  EXPECT_EQ(0, trace.events[0].phase);
+  EXPECT_EQ(TrafficEvent::Kind::kReceive, trace.events[1].kind);
+  EXPECT_EQ(4, trace.events[1].bytes);
+  EXPECT_EQ(1, trace.events[1].phase);
+  EXPECT_LE(trace.events[0].endNs, trace.events[1].startNs);
+}
+
+TEST(TrafficTraceTest, TestRejectsOtherFiles) {
+  auto path = std::filesystem::temp_directory_path() /
+      ("NotATrafficTrace_" + std::to_string(folly::Random::secureRand64()));
+  std::ofstream{path} << "not a trace";
+  EXPECT_THROW(TrafficTrace::read(path.string()), std::runtime_error);
+  std::filesystem::remove(path);
+}
+
+namespace {
+TrafficEvent event(
+    TrafficEvent::Kind kind,
+    uint32_t bytes,
+    uint64_t startMs,
+    uint64_t endMs) {
+  return TrafficEvent{kind, 0, 0, bytes, startMs * 1000000, endMs * 1000000};
+}
+} // namespace
+
+TEST(TrafficTraceTest, TestReplaysTheTracesOverANetwork) {
+  // The publisher computes for 10ms and sends 1000 bytes, which the partner
+  // waits for after computing for 2ms, then the partner computes for 5ms and
+  // sends 1000 bytes back in two messages
+  TrafficTrace publisher;
+  publisher.phases = {"phase"};
+  publisher.events = {
+      event(TrafficEvent::Kind::kSend, 1000, 10, 10),
+      event(TrafficEvent::Kind::kReceive, 1000, 10, 25)};
+  TrafficTrace partner;
+  partner.phases = {"phase"};
+  partner.events = {
+      event(TrafficEvent::Kind::kReceive, 1000, 2, 11),
+      event(TrafficEvent::Kind::kSend, 500, 16, 16),
+      event(TrafficEvent::Kind::kSend, 500, 16, 16)};
+
+  ReplayNetwork network;
+  network.latencySeconds = 0.001;
+  network.bytesPerSecond = 1e6;
+  auto parties = replayTrafficTraces(publisher, partner, network);
+
+  // The partner gets the message at 10 + 1 (transfer) + 1 (latency) ms, after
+  // waiting 8ms for the publisher
+  const auto& partnerPhase = parties[1].phases.at(0).second;
+  EXPECT_NEAR(0.007, partnerPhase.computeSeconds, 1e-9);
+  EXPECT_NEAR(0.008, partnerPhase.peerWaitSeconds, 1e-9);
+  EXPECT_NEAR(0.002, partnerPhase.networkSeconds, 1e-9);
+  EXPECT_EQ(1000, partnerPhase.sentBytes);
+  EXPECT_NEAR(0.017, parties[1].wallSeconds, 1e-9);
+
+  // The partner sends at 17ms, and the second message arrives at
+  // 17 + 1 + 1 ms
+  const auto& publisherPhase = parties[0].phases.at(0).second;
+  EXPECT_NEAR(0.010, publisherPhase.computeSeconds, 1e-9);
+  EXPECT_NEAR(0.007, publisherPhase.peerWaitSeconds, 1e-9);
+  EXPECT_NEAR(0.002, publisherPhase.networkSeconds, 1e-9);
+  EXPECT_NEAR(0.019, parties[0].wallSeconds, 1e-9);
+
+  // As recorded, the publisher was blocked for 15ms on its receive
+  auto recorded = summarizeTrafficTrace(publisher);
+  EXPECT_NEAR(0.015, recorded.phases.at(0).second.networkSeconds, 1e-9);
+}
+
+TEST(TrafficTraceTest, TestThrowsOnTracesOfDifferentLanes) {
+  TrafficTrace publisher;
+  publisher.phases = {""};
+  publisher.events = {event(TrafficEvent::Kind::kReceive, 10, 0, 1)};
+  TrafficTrace partner;
+  partner.phases = {""};
+  partner.events = {event(TrafficEvent::Kind::kSend, 5, 0, 0)};
+  EXPECT_THROW(
+      replayTrafficTraces(publisher, partner, ReplayNetwork{}),
+      std::runtime_error);
+}
+
+} // namespace common
@@ -75,34 +75,44 @@ class ShuffleBasedCompactorGame : public BaseCompactorGame<T, schedulerId> {
       : BaseCompactorGame<T, schedulerId>(
             std::move(scheduler),
             myId,
-            partnerId) {}
+            partnerId),
+        compactorFactory_(createCompactorFactory(myId, partnerId)) {}
 
  private:
+  using CompactorFactory = fbpcf::mpc_std_lib::compactor::
+      ShuffleBasedCompactorFactory<T, bool, schedulerId>;
+
+  // The compactor factory, with the shuffler and permuter factories it holds,
+  // is built once per game and creates a compactor for every play
+  static std::unique_ptr<CompactorFactory> createCompactorFactory(
+      int myId,
+      int partnerId) {
+    return std::make_unique<CompactorFactory>(
+        myId,
+        partnerId,
+        std::make_unique<
+            fbpcf::mpc_std_lib::shuffler::PermuteBasedShufflerFactory<std::pair<
+                typename fbpcf::mpc_std_lib::util::SecBatchType<T, schedulerId>::
+                    type,
+                typename fbpcf::mpc_std_lib::util::
+                    SecBatchType<bool, schedulerId>::type>>>(
+            myId,
+            partnerId,
+            std::make_unique<fbpcf::mpc_std_lib::permuter::
+                                 AsWaksmanPermuterFactory<
+                                     std::pair<T, bool>,
+                                     schedulerId>>(myId, partnerId),
+            std::make_unique<fbpcf::engine::util::AesPrgFactory>()));
+  }
+
   std::unique_ptr<fbpcf::mpc_std_lib::compactor::ICompactor<
       typename fbpcf::mpc_std_lib::util::SecBatchType<T, schedulerId>::type,
       typename fbpcf::mpc_std_lib::util::SecBatchType<bool, schedulerId>::type>>
-  getCompactor(int myId, int partnerId) override {
-    return std::make_unique<
-               fbpcf::mpc_std_lib::compactor::
-                   ShuffleBasedCompactorFactory<T, bool, schedulerId>>(
-               myId,
-               partnerId,
-               std::make_unique<
-                   fbpcf::mpc_std_lib::shuffler::PermuteBasedShufflerFactory<
-                       std::pair<
-                           typename fbpcf::mpc_std_lib::util::
-                               SecBatchType<T, schedulerId>::type,
-                           typename fbpcf::mpc_std_lib::util::
-                               SecBatchType<bool, schedulerId>::type>>>(
-                   myId,
-                   partnerId,
-                   std::make_unique<
-                       fbpcf::mpc_std_lib::permuter::AsWaksmanPermuterFactory<
-                           std::pair<T, bool>,
-                           schedulerId>>(myId, partnerId),
-                   std::make_unique<fbpcf::engine::util::AesPrgFactory>()))
-        ->create();
+  getCompactor(int /* myId */, int /* partnerId */) override {
+    return compactorFactory_->create();
   }
+
+  std::unique_ptr<CompactorFactory> compactorFactory_;
 };
 
 template <typename T, int schedulerId>
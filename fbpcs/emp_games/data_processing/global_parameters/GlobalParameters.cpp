@@ -5,20 +5,80 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
 #include "fbpcf/io/api/FileIOWrappers.h"
 
 #include "fbpcs/emp_games/data_processing/global_parameters/GlobalParameters.h"
 
 namespace global_parameters {
 
-std::string serialize(const GlobalParameters& src) {
-  std::ostringstream s;
-  boost::archive::text_oarchive oa(s);
-  oa << src;
-  return s.str();
+namespace {
+
+constexpr uint8_t kInt32Type = 0;
+constexpr uint8_t kMapType = 1;
+constexpr size_t kPairSize = 2 * sizeof(int32_t);
+
+template <typename T>
+void append(std::string& out, T value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(T));
 }
 
-GlobalParameters deserialize(const std::string& src) {
+// Reads the values of the serialization in order, throwing if it ends early
+class Reader {
+ public:
+  Reader(const std::string& data, size_t offset, size_t end)
+      : data_{data}, offset_{offset}, end_{end} {}
+
+  template <typename T>
+  T read() {
+    T value;
+    std::memcpy(&value, bytes(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  const char* bytes(size_t size) {
+    if (end_ - offset_ < size) {
+      throw std::runtime_error("Global parameters are truncated");
+    }
+    auto out = data_.data() + offset_;
+    offset_ += size;
+    return out;
+  }
+
+  size_t offset() const {
+    return offset_;
+  }
+
+ private:
+  const std::string& data_;
+  size_t offset_;
+  size_t end_;
+};
+
+bool isBinary(const std::string& src) {
+  return src.compare(0, kBinaryMagic.size(), kBinaryMagic) == 0;
+}
+
+std::string serializeMap(const std::unordered_map<int32_t, int32_t>& map) {
+  std::vector<std::pair<int32_t, int32_t>> pairs(map.begin(), map.end());
+  std::sort(pairs.begin(), pairs.end());
+
+  std::string out;
+  out.reserve(sizeof(uint32_t) + pairs.size() * kPairSize);
+  append(out, static_cast<uint32_t>(pairs.size()));
+  for (const auto& [key, value] : pairs) {
+    append(out, key);
+    append(out, value);
+  }
+  return out;
+}
+
+GlobalParameters deserializeText(const std::string& src) {
   GlobalParameters data;
   std::istringstream s(src);
   boost::archive::text_iarchive ia(s);
@@ -26,6 +86,43 @@ GlobalParameters deserialize(const std::string& src) {
   return data;
 }
 
+} // namespace
+
+std::string serialize(const GlobalParameters& src) {
+  // Sorted by name, so that equal parameters serialize equally
+  std::map<std::string, const GlobalParameterType*> sorted;
+  for (const auto& [name, value] : src) {
+    sorted.emplace(name, &value);
+  }
+
+  std::string out{kBinaryMagic};
+  append(out, static_cast<uint32_t>(sorted.size()));
+  for (const auto& [name, value] : sorted) {
+    append(out, static_cast<uint32_t>(name.size()));
+    out.append(name);
+    std::string payload;
+    if (const auto* intValue = boost::get<int32_t>(value)) {
+      append(out, kInt32Type);
+      append(payload, *intValue);
+    } else {
+      append(out, kMapType);
+      payload = serializeMap(
+          boost::get<std::unordered_map<int32_t, int32_t>>(*value));
+    }
+    append(out, static_cast<uint64_t>(payload.size()));
+    out.append(payload);
+  }
+  return out;
+}
+
+GlobalParameters deserialize(const std::string& src) {
+  if (!isBinary(src)) {
+    return deserializeText(src);
+  }
+
+  return GlobalParametersView{src}.toGlobalParameters();
+}
+
 void writeToFile(const std::string& file, const GlobalParameters& gp) {
   fbpcf::io::FileIOWrappers::writeFile(file, serialize(gp));
 }
@@ -34,4 +131,111 @@ GlobalParameters readFromFile(const std::string& file) {
   return deserialize(fbpcf::io::FileIOWrappers::readFile(file));
 }
 
+GlobalParametersView::GlobalParametersView(std::string serialized)
+    : data_{
+          isBinary(serialized) ? std::move(serialized)
+                               : serialize(deserializeText(serialized))} {
+  Reader reader{data_, kBinaryMagic.size(), data_.size()};
+  auto numParameters = reader.read<uint32_t>();
+  index_.reserve(numParameters);
+  for (uint32_t i = 0; i < numParameters; ++i) {
+    auto nameSize = reader.read<uint32_t>();
+    std::string name{reader.bytes(nameSize), nameSize};
+    auto type = reader.read<uint8_t>();
+    auto size = reader.read<uint64_t>();
+    auto offset = reader.offset();
+    reader.bytes(size);
+    if (type != kInt32Type && type != kMapType) {
+      throw std::runtime_error(
+          "Unknown type of global parameter " + name + ": " +
+          std::to_string(type));
+    }
+    index_.emplace(std::move(name), Entry{type, offset, size});
+  }
+}
+
+const GlobalParametersView::Entry& GlobalParametersView::entryAt(
+    const std::string& name) const {
+  auto entry = index_.find(name);
+  if (entry == index_.end()) {
+    throw std::out_of_range("No global parameter " + name);
+  }
+  return entry->second;
+}
+
+GlobalParameterType GlobalParametersView::at(const std::string& name) const {
+  const auto& entry = entryAt(name);
+  if (entry.type == kInt32Type) {
+    return getInt(name);
+  }
+
+  Reader reader{data_, entry.offset, entry.offset + entry.size};
+  auto numPairs = reader.read<uint32_t>();
+  std::unordered_map<int32_t, int32_t> map;
+  map.reserve(numPairs);
+  for (uint32_t i = 0; i < numPairs; ++i) {
+    auto key = reader.read<int32_t>();
+    map.emplace(key, reader.read<int32_t>());
+  }
+  return map;
+}
+
+GlobalParameters GlobalParametersView::toGlobalParameters() const {
+  GlobalParameters out;
+  out.reserve(index_.size());
+  for (const auto& [name, entry] : index_) {
+    out.emplace(name, at(name));
+  }
+  return out;
+}
+
+int32_t GlobalParametersView::getInt(const std::string& name) const {
+  const auto& entry = entryAt(name);
+  if (entry.type != kInt32Type) {
+    throw boost::bad_get();
+  }
+  return Reader{data_, entry.offset, entry.offset + entry.size}
+      .read<int32_t>();
+}
+
+std::optional<int32_t> GlobalParametersView::findInMap(
+    const std::string& name,
+    int32_t key) const {
+  const auto& entry = entryAt(name);
+  if (entry.type != kMapType) {
+    throw boost::bad_get();
+  }
+
+  Reader reader{data_, entry.offset, entry.offset + entry.size};
+  auto numPairs = reader.read<uint32_t>();
+  const auto* pairs = reader.bytes(numPairs * kPairSize);
+  auto keyAt = [pairs](size_t i) {
+    int32_t out;
+    std::memcpy(&out, pairs + i * kPairSize, sizeof(int32_t));
+    return out;
+  };
+
+  size_t low = 0;
+  size_t high = numPairs;
+  while (low < high) {
+    auto mid = low + (high - low) / 2;
+    if (keyAt(mid) < key) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low == numPairs || keyAt(low) != key) {
+    return std::nullopt;
+  }
+  int32_t value;
+  std::memcpy(
+      &value, pairs + low * kPairSize + sizeof(int32_t), sizeof(int32_t));
+  return value;
+}
+
+GlobalParametersView readViewFromFile(const std::string& file) {
+  return GlobalParametersView{fbpcf::io::FileIOWrappers::readFile(file)};
+}
+
 } // namespace global_parameters
@@ -14,9 +14,13 @@
 
 #include <boost/serialization/unordered_map.hpp>
 #include <boost/serialization/variant.hpp>
+#include <cstddef>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <variant>
 
 namespace global_parameters {
@@ -54,6 +58,28 @@ using GlobalParameterType = boost::variant<
  */
 using GlobalParameters = std::unordered_map<std::string, GlobalParameterType>;
 
+/**
+ * Global parameters are serialized in a binary format, whose integers are
+ * written in the byte order of the host:
+ *
+ *   magic           8 bytes, kBinaryMagic
+ *   numParameters   uint32
+ *   per parameter, sorted by name:
+ *     nameSize      uint32, followed by the name
+ *     type          uint8, the index of the type in GlobalParameterType
+ *     payloadSize   uint64, followed by the payload:
+ *       int32_t                        the value
+ *       unordered_map<int32_t,int32_t> numPairs uint32, followed by the
+ *                                      int32 key and value of every pair,
+ *                                      sorted by key
+ *
+ * The payload sizes let a reader skip the parameters it doesn't need, and the
+ * sorted pairs let it look up keys of a map by binary search in place.
+ * deserialize and readFromFile also read the boost text archives that were
+ * written before.
+ */
+inline constexpr std::string_view kBinaryMagic{"PCSGPAR1", 8};
+
 std::string serialize(const GlobalParameters& src);
 
 GlobalParameters deserialize(const std::string& src);
@@ -62,4 +88,47 @@ void writeToFile(const std::string& file, const GlobalParameters& gp);
 
 GlobalParameters readFromFile(const std::string& file);
 
+/**
+ * Global parameters read in place from their serialization. Only the names
+ * and payload offsets are read up front; a parameter is decoded when it is
+ * retrieved, and the keys of a map can be looked up without decoding it.
+ */
+class GlobalParametersView {
+ public:
+  explicit GlobalParametersView(std::string serialized);
+
+  bool contains(const std::string& name) const {
+    return index_.find(name) != index_.end();
+  }
+
+  // Throws std::out_of_range if there is no parameter of that name
+  GlobalParameterType at(const std::string& name) const;
+
+  // Throws std::out_of_range if there is no parameter of that name, and
+  // boost::bad_get if it isn't an int32_t
+  int32_t getInt(const std::string& name) const;
+
+  // The value of key in the map parameter of that name, found by binary
+  // search. Throws like getInt if it isn't a map.
+  std::optional<int32_t> findInMap(const std::string& name, int32_t key)
+      const;
+
+  // Decodes every parameter
+  GlobalParameters toGlobalParameters() const;
+
+ private:
+  struct Entry {
+    uint8_t type;
+    size_t offset;
+    size_t size;
+  };
+
+  const Entry& entryAt(const std::string& name) const;
+
+  std::string data_;
+  std::unordered_map<std::string, Entry> index_;
+};
+
+GlobalParametersView readViewFromFile(const std::string& file);
+
 } // namespace global_parameters
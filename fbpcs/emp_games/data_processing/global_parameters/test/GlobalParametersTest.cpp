@@ -41,4 +41,62 @@ TEST(GlobalParametersSerialization, testSerializeAndDeserialize) {
       (boost::get<std::unordered_map<int32_t, int32_t>>(gp1.at("test2"))));
 }
 
+TEST(GlobalParametersSerialization, testReadsTextArchives) {
+  GlobalParameters gp;
+  gp.emplace("test1", 3);
+  gp.emplace(
+      "test2", std::unordered_map<int32_t, int32_t>({{1, 2}, {3, 4}, {5, 6}}));
+
+  std::ostringstream s;
+  {
+    boost::archive::text_oarchive oa(s);
+    oa << gp;
+  }
+  auto gp1 = deserialize(s.str());
+
+  EXPECT_EQ(3, boost::get<int32_t>(gp1.at("test1")));
+  EXPECT_EQ(
+      (boost::get<std::unordered_map<int32_t, int32_t>>(gp.at("test2"))),
+      (boost::get<std::unordered_map<int32_t, int32_t>>(gp1.at("test2"))));
+  EXPECT_EQ(serialize(gp), serialize(gp1));
+}
+
+TEST(GlobalParametersSerialization, testView) {
+  std::unordered_map<int32_t, int32_t> adIds;
+  for (int32_t i = -500; i < 500; ++i) {
+    adIds.emplace(i * 7, i);
+  }
+  GlobalParameters gp;
+  gp.emplace(KPubDataWidth, 3);
+  gp.emplace("ad_ids", adIds);
+
+  GlobalParametersView view{serialize(gp)};
+  EXPECT_TRUE(view.contains("ad_ids"));
+  EXPECT_FALSE(view.contains(KAdvDataWidth));
+  EXPECT_EQ(3, view.getInt(KPubDataWidth));
+  for (const auto& [key, value] : adIds) {
+    EXPECT_EQ(value, view.findInMap("ad_ids", key));
+  }
+  EXPECT_EQ(std::nullopt, view.findInMap("ad_ids", 1));
+  EXPECT_EQ(std::nullopt, view.findInMap("ad_ids", 3500));
+  EXPECT_EQ(
+      adIds,
+      (boost::get<std::unordered_map<int32_t, int32_t>>(view.at("ad_ids"))));
+
+  EXPECT_THROW(view.getInt("ad_ids"), boost::bad_get);
+  EXPECT_THROW(view.findInMap(KPubDataWidth, 1), boost::bad_get);
+  EXPECT_THROW(view.at(KAdvDataWidth), std::out_of_range);
+}
+
+TEST(GlobalParametersSerialization, testThrowsOnTruncatedInput) {
+  GlobalParameters gp;
+  gp.emplace(
+      "test2", std::unordered_map<int32_t, int32_t>({{1, 2}, {3, 4}, {5, 6}}));
+  auto serialized = serialize(gp);
+
+  EXPECT_THROW(
+      deserialize(serialized.substr(0, serialized.size() - 1)),
+      std::runtime_error);
+}
+
 } // namespace global_parameters
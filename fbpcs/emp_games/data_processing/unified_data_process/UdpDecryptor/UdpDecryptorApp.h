@@ -14,8 +14,11 @@
 #include <fbpcf/io/api/BufferedWriter.h>
 #include <stdint.h>
 #include <fstream>
+#include <future>
 #include <stdexcept>
+#include <vector>
 
+#include "fbpcf/mpc_std_lib/unified_data_process/data_processor/IUdpEncryption.h"
 #include "fbpcf/mpc_std_lib/unified_data_process/data_processor/UdpDecryption.h"
 #include "fbpcf/mpc_std_lib/unified_data_process/data_processor/UdpUtil.h"
 #include "fbpcs/emp_games/data_processing/global_parameters/GlobalParameters.h"
@@ -34,22 +37,53 @@ class UdpDecryptorApp {
   UdpDecryptorApp(std::unique_ptr<Decryption> decryption, bool amIPublisher)
       : decryption_(std::move(decryption)), amIPublisher_(amIPublisher) {}
 
+  // The inputs are read concurrently
   std::tuple<SecString, SecString> invokeUdpDecryption(
       const std::string& dataFile,
       const std::string& expandedKeyFile,
       const std::string& globalParameterFile) const {
-    auto gp = global_parameters::readFromFile(globalParameterFile);
-    auto publisherWidth =
-        boost::get<int32_t>(gp.at(global_parameters::KPubDataWidth));
-    auto advertiserWidth =
-        boost::get<int32_t>(gp.at(global_parameters::KAdvDataWidth));
+    auto expandedKey = std::async(std::launch::async, [&expandedKeyFile]() {
+      return fbpcf::mpc_std_lib::unified_data_process::data_processor::
+          readExpandedKeyFromFile(expandedKeyFile);
+    });
+    auto encryptionResults = readEncryptionResults(dataFile);
+    auto gp = global_parameters::readViewFromFile(globalParameterFile);
+    return decrypt(encryptionResults.get(), expandedKey.get(), gp);
+  }
+
+  // Takes the expanded key in memory, e.g. the one returned by the encryptor
+  // running in this process, or one read once for every shard
+  std::tuple<SecString, SecString> invokeUdpDecryption(
+      const std::string& dataFile,
+      const std::vector<__m128i>& expandedKey,
+      const std::string& globalParameterFile) const {
+    auto encryptionResults = readEncryptionResults(dataFile);
+    auto gp = global_parameters::readViewFromFile(globalParameterFile);
+    return decrypt(encryptionResults.get(), expandedKey, gp);
+  }
+
+ private:
+  using EncryptionResults = fbpcf::mpc_std_lib::unified_data_process::
+      data_processor::IUdpEncryption::EncryptionResults;
+
+  static std::future<EncryptionResults> readEncryptionResults(
+      const std::string& dataFile) {
+    return std::async(std::launch::async, [&dataFile]() {
+      return fbpcf::mpc_std_lib::unified_data_process::data_processor::
+          readEncryptionResultsFromFile(dataFile);
+    });
+  }
+
+  std::tuple<SecString, SecString> decrypt(
+      const EncryptionResults& encryptionResults,
+      const std::vector<__m128i>& expandedKey,
+      const global_parameters::GlobalParametersView& gp) const {
+    auto publisherWidth = gp.getInt(global_parameters::KPubDataWidth);
+    auto advertiserWidth = gp.getInt(global_parameters::KAdvDataWidth);
 
     if (amIPublisher_) {
-      auto encryptionResults = fbpcf::mpc_std_lib::unified_data_process::
-          data_processor::readEncryptionResultsFromFile(dataFile);
       auto myData = decryption_->decryptMyData(
-          fbpcf::mpc_std_lib::unified_data_process::data_processor::
-              readExpandedKeyFromFile(expandedKeyFile),
+          expandedKey,
           publisherWidth,
           encryptionResults.ciphertexts.size());
       auto peerData = decryption_->decryptPeerData(
@@ -58,22 +92,18 @@ class UdpDecryptorApp {
           encryptionResults.indexes);
       return {myData, peerData};
     } else {
-      auto encryptionResults = fbpcf::mpc_std_lib::unified_data_process::
-          data_processor::readEncryptionResultsFromFile(dataFile);
       auto peerData = decryption_->decryptPeerData(
           encryptionResults.ciphertexts,
           encryptionResults.nonces,
           encryptionResults.indexes);
       auto myData = decryption_->decryptMyData(
-          fbpcf::mpc_std_lib::unified_data_process::data_processor::
-              readExpandedKeyFromFile(expandedKeyFile),
+          expandedKey,
           advertiserWidth,
           encryptionResults.ciphertexts.size());
       return {peerData, myData};
     }
   }
 
- private:
   std::unique_ptr<Decryption> decryption_;
   bool amIPublisher_;
 };
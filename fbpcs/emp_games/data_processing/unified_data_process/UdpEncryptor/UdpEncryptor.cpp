@@ -6,6 +6,7 @@
  */
 
 #include "fbpcs/emp_games/data_processing/unified_data_process/UdpEncryptor/UdpEncryptor.h"
+#include <algorithm>
 #include <iterator>
 #include <memory>
 #include <stdexcept>
@@ -14,6 +15,22 @@
 
 namespace unified_data_process {
 
+size_t UdpEncryptor::getChunkSizeForMemoryBudget(
+    size_t publisherDataWidth,
+    size_t partnerDataWidth,
+    size_t memoryBudget) {
+  auto width = std::max(publisherDataWidth, partnerDataWidth);
+  // my data is held in the chunks in flight, the chunk being filled and the
+  // rows the app reads ahead into, with a line and an index per row in all
+  // but the last
+  auto myRowBytes = (kMaxChunksInFlight + 1) *
+          (width + sizeof(std::vector<unsigned char>) + sizeof(uint64_t)) +
+      width;
+  // the peer's data is received and encrypted a chunk at a time
+  auto peerRowBytes = 2 * width;
+  return std::max<size_t>(memoryBudget / (myRowBytes + peerRowBytes), 1);
+}
+
 /**
  * The idea here is to distribute the workload across more threads. This
  * UdpEncryptor object will read in data in the main thread and buffer them.
@@ -31,29 +48,73 @@ void UdpEncryptor::processDataInBuffer() {
   indexesForMyData_->resize(bufferIndex_);
   bufferIndex_ = 0;
   if (bufferForMyData_->size() > 0) {
+    if (myDataProcessingFutures_.size() >= kMaxChunksInFlight) {
+      // bound the chunks which were read but not processed yet
+      myDataProcessingFutures_
+          .at(myDataProcessingFutures_.size() - kMaxChunksInFlight)
+          .wait();
+    }
     auto [promise, future] = folly::makePromiseContract<folly::Unit>();
     myDataProcessExecutor_->add([this,
                                  data = std::move(bufferForMyData_),
                                  indexes = std::move(indexesForMyData_),
                                  p = std::move(promise)]() mutable {
       udpEncryption_->processMyData(*data, *indexes);
+      {
+        std::lock_guard<std::mutex> lock{recycledBuffersMutex_};
+        recycledBuffers_.push_back(std::move(data));
+      }
       p.setValue(folly::Unit());
     });
     myDataProcessingFutures_.push_back(std::move(future));
 
-    bufferForMyData_ =
-        std::make_unique<std::vector<std::vector<unsigned char>>>(0);
+    bufferForMyData_ = takeBuffer();
     indexesForMyData_ = std::make_unique<std::vector<uint64_t>>(0);
-    bufferForMyData_->reserve(chunkSize_);
     indexesForMyData_->reserve(chunkSize_);
   }
 }
 
+std::unique_ptr<std::vector<std::vector<unsigned char>>>
+UdpEncryptor::takeBuffer() {
+  {
+    std::lock_guard<std::mutex> lock{recycledBuffersMutex_};
+    if (!recycledBuffers_.empty()) {
+      auto buffer = std::move(recycledBuffers_.back());
+      recycledBuffers_.pop_back();
+      return buffer;
+    }
+  }
+  auto buffer = std::make_unique<std::vector<std::vector<unsigned char>>>(0);
+  buffer->reserve(chunkSize_);
+  return buffer;
+}
+
 // load a line that is to be processed later.
 void UdpEncryptor::pushOneLineFromMe(
     std::vector<unsigned char>&& serializedLine,
     uint64_t index) {
-  bufferForMyData_->push_back(std::move(serializedLine));
+  if (bufferIndex_ < bufferForMyData_->size()) {
+    bufferForMyData_->at(bufferIndex_) = std::move(serializedLine);
+  } else {
+    bufferForMyData_->push_back(std::move(serializedLine));
+  }
+  indexesForMyData_->push_back(index);
+  bufferIndex_++;
+  if (bufferIndex_ >= chunkSize_) {
+    processDataInBuffer();
+  }
+}
+
+void UdpEncryptor::pushOneLineFromMe(
+    const unsigned char* serializedLine,
+    size_t size,
+    uint64_t index) {
+  if (bufferIndex_ < bufferForMyData_->size()) {
+    bufferForMyData_->at(bufferIndex_)
+        .assign(serializedLine, serializedLine + size);
+  } else {
+    bufferForMyData_->emplace_back(serializedLine, serializedLine + size);
+  }
   indexesForMyData_->push_back(index);
   bufferIndex_++;
   if (bufferIndex_ >= chunkSize_) {
@@ -69,37 +130,22 @@ void UdpEncryptor::pushLinesFromMe(
     throw std::invalid_argument(
         "data's and indexes' lengths are not the same.");
   }
-  size_t inputIndex = 0;
-
-  while (inputIndex < serializedLines.size()) {
-    if (chunkSize_ - bufferIndex_ <= serializedLines.size() - inputIndex) {
-      bufferForMyData_->insert(
-          bufferForMyData_->end(),
-          std::make_move_iterator(serializedLines.begin() + inputIndex),
-          std::make_move_iterator(
-              serializedLines.begin() + inputIndex + chunkSize_ -
-              bufferIndex_));
-      indexesForMyData_->insert(
-          indexesForMyData_->end(),
-          std::make_move_iterator(indexes.begin() + inputIndex),
-          std::make_move_iterator(
-              indexes.begin() + inputIndex + chunkSize_ - bufferIndex_));
-      inputIndex += chunkSize_ - bufferIndex_;
-      // the buffer is full, the index should be changed to chunkSize_
-      bufferIndex_ = chunkSize_;
-      processDataInBuffer();
-    } else {
-      bufferForMyData_->insert(
-          bufferForMyData_->end(),
-          std::make_move_iterator(serializedLines.begin() + inputIndex),
-          std::make_move_iterator(serializedLines.end()));
-      indexesForMyData_->insert(
-          indexesForMyData_->end(),
-          std::make_move_iterator(indexes.begin() + inputIndex),
-          std::make_move_iterator(indexes.end()));
-      bufferIndex_ += serializedLines.size() - inputIndex;
-      inputIndex = serializedLines.size();
-    }
+  for (size_t i = 0; i < serializedLines.size(); i++) {
+    pushOneLineFromMe(std::move(serializedLines.at(i)), indexes.at(i));
+  }
+}
+
+// load multiple lines from a buffer into the buffer.
+void UdpEncryptor::pushLinesFromMe(
+    const common::FixedWidthRowBuffer& serializedLines,
+    std::vector<uint64_t>&& indexes) {
+  if (serializedLines.size() != indexes.size()) {
+    throw std::invalid_argument(
+        "data's and indexes' lengths are not the same.");
+  }
+  for (size_t i = 0; i < serializedLines.size(); i++) {
+    pushOneLineFromMe(
+        serializedLines.row(i), serializedLines.getRowWidth(), indexes.at(i));
   }
 }
 
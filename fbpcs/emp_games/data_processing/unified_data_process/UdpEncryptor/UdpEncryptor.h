@@ -8,10 +8,14 @@
 #pragma once
 
 #include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/SerialExecutor.h>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 #include "fbpcf/mpc_std_lib/unified_data_process/data_processor/IUdpEncryption.h"
+#include "fbpcs/emp_games/common/FixedWidthRowBuffer.h"
 #include "folly/futures/Future.h"
 
 namespace unified_data_process {
@@ -23,17 +27,45 @@ class UdpEncryptor {
  public:
   using EncryptionResults = UdpEncryption::EncryptionResults;
 
+  // The number of chunks of my data which can wait for or be in processing at
+  // a time. Filling another chunk waits for the oldest of them to be
+  // processed, so the lines read ahead of the encryption stay bounded.
+  static constexpr size_t kMaxChunksInFlight = 2;
+
+  // The largest chunk size for which the chunks of my data and of the peer's
+  // data a party holds at a time fit in memoryBudget bytes. It only depends on
+  // the wider of the two parties' rows, so both parties get the same chunk
+  // size from the same global parameters and budget.
+  static size_t getChunkSizeForMemoryBudget(
+      size_t publisherDataWidth,
+      size_t partnerDataWidth,
+      size_t memoryBudget);
+
   UdpEncryptor(std::unique_ptr<UdpEncryption> udpEncryption, size_t chunkSize)
+      : UdpEncryptor(
+            std::move(udpEncryption),
+            chunkSize,
+            std::make_shared<folly::CPUThreadPoolExecutor>(2)) {}
+
+  // The chunks of my data and of the peer's data are processed in order on
+  // executor, which can be shared with other work. The underlying udp
+  // encryption processes the chunks of each side one after another, so it
+  // uses up to two of its threads.
+  UdpEncryptor(
+      std::unique_ptr<UdpEncryption> udpEncryption,
+      size_t chunkSize,
+      std::shared_ptr<folly::CPUThreadPoolExecutor> executor)
       : udpEncryption_(std::move(udpEncryption)),
         chunkSize_(chunkSize),
         bufferIndex_(0),
         bufferForMyData_{
             std::make_unique<std::vector<std::vector<unsigned char>>>(0)},
         indexesForMyData_{std::make_unique<std::vector<uint64_t>>(0)},
-        myDataProcessExecutor_(
-            std::make_shared<folly::CPUThreadPoolExecutor>(1)),
-        peerProcessExecutor_(
-            std::make_shared<folly::CPUThreadPoolExecutor>(1)) {
+        executor_(std::move(executor)),
+        myDataProcessExecutor_(folly::SerialExecutor::create(
+            folly::getKeepAliveToken(executor_.get()))),
+        peerProcessExecutor_(folly::SerialExecutor::create(
+            folly::getKeepAliveToken(executor_.get()))) {
     bufferForMyData_->reserve(chunkSize_);
     indexesForMyData_->reserve(chunkSize_);
   }
@@ -48,6 +80,12 @@ class UdpEncryptor {
       std::vector<std::vector<unsigned char>>&& serializedLines,
       std::vector<uint64_t>&& indexes);
 
+  // load a number of lines stored back to back, which are only copied into a
+  // line each a chunk at a time.
+  void pushLinesFromMe(
+      const common::FixedWidthRowBuffer& serializedLines,
+      std::vector<uint64_t>&& indexes);
+
   // set the config for peer's data.
   void setPeerConfig(
       size_t totalNumberOfPeerRows,
@@ -56,11 +94,25 @@ class UdpEncryptor {
 
   EncryptionResults getEncryptionResults();
 
+  size_t getChunkSize() const {
+    return chunkSize_;
+  }
+
   std::vector<__m128i> getExpandedKey();
 
  private:
   void processDataInBuffer();
 
+  // write a line at bufferIndex_ of the buffer, reusing the line a recycled
+  // buffer has there.
+  void pushOneLineFromMe(
+      const unsigned char* serializedLine,
+      size_t size,
+      uint64_t index);
+
+  // a buffer of processed lines to fill again, or a new one.
+  std::unique_ptr<std::vector<std::vector<unsigned char>>> takeBuffer();
+
   std::unique_ptr<UdpEncryption> udpEncryption_;
 
   size_t chunkSize_;
@@ -68,11 +120,18 @@ class UdpEncryptor {
   size_t bufferIndex_;
   std::unique_ptr<std::vector<std::vector<unsigned char>>> bufferForMyData_;
   std::unique_ptr<std::vector<uint64_t>> indexesForMyData_;
+  // the buffers of the chunks which were processed, whose lines keep their
+  // allocations for the next chunks.
+  std::mutex recycledBuffersMutex_;
+  std::vector<std::unique_ptr<std::vector<std::vector<unsigned char>>>>
+      recycledBuffers_;
+
+  std::shared_ptr<folly::CPUThreadPoolExecutor> executor_;
 
-  std::shared_ptr<folly::CPUThreadPoolExecutor> myDataProcessExecutor_;
+  folly::Executor::KeepAlive<folly::SerialExecutor> myDataProcessExecutor_;
   std::vector<folly::SemiFuture<folly::Unit>> myDataProcessingFutures_;
 
-  std::shared_ptr<folly::CPUThreadPoolExecutor> peerProcessExecutor_;
+  folly::Executor::KeepAlive<folly::SerialExecutor> peerProcessExecutor_;
   std::vector<folly::SemiFuture<folly::Unit>> peerDataProcessingFutures_;
 };
 
@@ -12,21 +12,25 @@
 #include <fbpcf/io/api/FileReader.h>
 #include <fbpcf/io/api/FileWriter.h>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <optional>
 #include <string>
 #include "fbpcf/mpc_std_lib/unified_data_process/data_processor/UdpUtil.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
 #include "fbpcs/emp_games/data_processing/global_parameters/GlobalParameters.h"
 #include "folly/String.h"
 
 namespace unified_data_process {
 
-void UdpEncryptorApp::invokeUdpEncryption(
+std::vector<__m128i> UdpEncryptorApp::invokeUdpEncryption(
     const std::vector<std::string>& indexFiles,
     const std::vector<std::string>& serializedDataFiles,
     const std::string& globalParameters,
     const std::vector<std::string>& dataFiles,
     const std::string& expandedKeyFile) {
   std::vector<folly::SemiFuture<folly::Unit>> futures;
+  // Both sides wait for work on executor_, so they run on their own threads
   auto executor = std::make_shared<folly::CPUThreadPoolExecutor>(2);
   {
     auto [promise, future] = folly::makePromiseContract<folly::Unit>();
@@ -51,24 +55,72 @@ void UdpEncryptorApp::invokeUdpEncryption(
 
   folly::collectAll(std::move(futures)).get();
 
-  fbpcf::mpc_std_lib::unified_data_process::data_processor::
-      writeExpandedKeyToFile(encryptor_->getExpandedKey(), expandedKeyFile);
+  // The outputs are written concurrently. The expanded key is ready once my
+  // data is processed, so it's written while the peer's data may still be.
+  std::vector<folly::SemiFuture<folly::Unit>> writes;
+  auto write = [this, &writes](std::function<void()> task) {
+    auto [promise, future] = folly::makePromiseContract<folly::Unit>();
+    executor_->add(
+        [task = std::move(task), p = std::move(promise)]() mutable {
+          p.setWith(task);
+        });
+    writes.push_back(std::move(future));
+  };
+
+  auto expandedKey = encryptor_->getExpandedKey();
+  write([&expandedKey, &expandedKeyFile]() {
+    fbpcf::mpc_std_lib::unified_data_process::data_processor::
+        writeExpandedKeyToFile(expandedKey, expandedKeyFile);
+  });
   auto results = fbpcf::mpc_std_lib::unified_data_process::data_processor::
       splitEncryptionResults(
           encryptor_->getEncryptionResults(), dataFiles.size());
   for (size_t i = 0; i < dataFiles.size(); i++) {
-    fbpcf::mpc_std_lib::unified_data_process::data_processor::
-        writeEncryptionResultsToFile(results.at(i), dataFiles.at(i));
+    write([&results, &dataFiles, i]() {
+      fbpcf::mpc_std_lib::unified_data_process::data_processor::
+          writeEncryptionResultsToFile(results.at(i), dataFiles.at(i));
+    });
+  }
+
+  for (auto& written : folly::collectAll(std::move(writes)).get()) {
+    written.throwUnlessValue();
   }
+  return expandedKey;
+}
+
+size_t UdpEncryptorApp::getChunkSizeForMemoryBudget(
+    const std::string& globalParameterFile,
+    size_t memoryBudget) {
+  auto globalParameters =
+      global_parameters::readViewFromFile(globalParameterFile);
+  auto publisherDataWidth =
+      globalParameters.getInt(global_parameters::KPubDataWidth);
+  auto partnerDataWidth =
+      globalParameters.getInt(global_parameters::KAdvDataWidth);
+  return UdpEncryptor::getChunkSizeForMemoryBudget(
+      publisherDataWidth, partnerDataWidth, memoryBudget);
 }
 
 std::vector<uint64_t> UdpEncryptorApp::readIndexFile(
     const std::string& fileName) {
+  std::vector<uint64_t> rst;
+  auto file = private_measurement::compressed_io::makeRawFileReader(fileName);
+  auto records = openRecordFile(*file);
+  if (records.readMagic(record_format::kIndexMagic)) {
+    uint64_t index;
+    while (records.nextIndex(index)) {
+      rst.push_back(index);
+    }
+    file->close();
+    return rst;
+  }
+
+  // a csv file, with the indexes in its second column
   auto reader = std::make_unique<fbpcf::io::BufferedReader>(
-      std::make_unique<fbpcf::io::FileReader>(fileName));
+      std::make_unique<private_measurement::compressed_io::PushbackReader>(
+          records.takeUnread(), std::move(file)));
   reader->readLine(); // header, useless
 
-  std::vector<uint64_t> rst;
   while (!reader->eof()) {
     std::vector<std::string> data;
     auto line = reader->readLine();
@@ -79,10 +131,15 @@ std::vector<uint64_t> UdpEncryptorApp::readIndexFile(
   return rst;
 }
 
-std::tuple<uint64_t, std::vector<unsigned char>>
-UdpEncryptorApp::readOneLineData(
-    std::shared_ptr<fbpcf::io::BufferedReader> file) {
-  auto line = file->readLine();
+record_format::RecordReader UdpEncryptorApp::openRecordFile(
+    fbpcf::io::IReaderCloser& file) {
+  return record_format::RecordReader{[&file](std::vector<char>& buffer) {
+    return file.eof() ? 0 : file.read(buffer);
+  }};
+}
+
+std::tuple<uint64_t, size_t> UdpEncryptorApp::parseOneLineIndex(
+    const std::string& line) {
   std::string spliter(", ");
   auto pos = line.find(spliter);
   if (pos == std::string::npos) {
@@ -90,44 +147,23 @@ UdpEncryptorApp::readOneLineData(
   }
   auto indexChar = std::string(line.begin(), line.begin() + pos);
   auto index = std::atoi(indexChar.c_str());
-  return {
-      index,
-      std::vector<unsigned char>(
-          std::make_move_iterator(line.begin() + pos + spliter.length()),
-          std::make_move_iterator(line.end()))};
-}
-
-std::tuple<std::vector<uint64_t>, std::vector<std::vector<unsigned char>>>
-UdpEncryptorApp::readDataFile(const std::string& fileName) {
-  auto reader = std::make_shared<fbpcf::io::BufferedReader>(
-      std::make_unique<fbpcf::io::FileReader>(fileName));
-  std::vector<uint64_t> rstIndex;
-  std::vector<std::vector<unsigned char>> rstData;
-  while (!reader->eof()) {
-    auto [index, data] = readOneLineData(reader);
-    rstIndex.push_back(index);
-    rstData.push_back(data);
-  }
-  reader->close();
-  return {std::move(rstIndex), std::move(rstData)};
+  return {index, pos + spliter.length()};
 }
 
 void UdpEncryptorApp::processPeerData(
     const std::vector<std::string>& indexFiles,
     const std::string& globalParameterFile) const {
-  auto executor =
-      std::make_shared<folly::CPUThreadPoolExecutor>(indexFiles.size());
-
   std::vector<folly::SemiFuture<std::vector<uint64_t>>> futures;
   for (auto& file : indexFiles) {
     auto [promise, future] =
         folly::makePromiseContract<std::vector<uint64_t>>();
-    executor->add([&file, p = std::move(promise)]() mutable {
+    executor_->add([&file, p = std::move(promise)]() mutable {
       p.setValue(UdpEncryptorApp::readIndexFile(file));
     });
     futures.push_back(std::move(future));
   }
-  auto globalParameters = global_parameters::readFromFile(globalParameterFile);
+  auto globalParameters =
+      global_parameters::readViewFromFile(globalParameterFile);
   auto indexInFiles = folly::collectAll(std::move(futures)).get();
 
   std::vector<uint64_t> indexes;
@@ -139,12 +175,12 @@ void UdpEncryptorApp::processPeerData(
         std::make_move_iterator(indexInFile.begin()),
         std::make_move_iterator(indexInFile.end()));
   }
-  auto totalNumberOfPeerRows = boost::get<int32_t>(
-      amIPublisher_ ? globalParameters.at(global_parameters::KAdvRowCount)
-                    : globalParameters.at(global_parameters::KPubRowCount));
-  auto peerDataWidth = boost::get<int32_t>(
-      amIPublisher_ ? globalParameters.at(global_parameters::KAdvDataWidth)
-                    : globalParameters.at(global_parameters::KPubDataWidth));
+  auto totalNumberOfPeerRows = globalParameters.getInt(
+      amIPublisher_ ? global_parameters::KAdvRowCount
+                    : global_parameters::KPubRowCount);
+  auto peerDataWidth = globalParameters.getInt(
+      amIPublisher_ ? global_parameters::KAdvDataWidth
+                    : global_parameters::KPubDataWidth);
 
   encryptor_->setPeerConfig(totalNumberOfPeerRows, peerDataWidth, indexes);
   return;
@@ -152,42 +188,58 @@ void UdpEncryptorApp::processPeerData(
 
 void UdpEncryptorApp::processMyData(
     const std::vector<std::string>& serializedDataFiles) const {
-  auto executor = std::make_shared<folly::CPUThreadPoolExecutor>(
-      serializedDataFiles.size() + 1);
-
-  std::vector<folly::SemiFuture<std::tuple<
-      std::vector<uint64_t>,
-      std::vector<std::vector<unsigned char>>>>>
-      futures;
-
-  for (size_t i = 1; i < serializedDataFiles.size(); i++) {
-    auto [promise, future] = folly::makePromiseContract<std::tuple<
-        std::vector<uint64_t>,
-        std::vector<std::vector<unsigned char>>>>();
-    executor->add(
-        [file = serializedDataFiles.at(i), p = std::move(promise)]() mutable {
-          p.setValue(readDataFile(file));
-        });
-    futures.push_back(std::move(future));
-  }
-  {
-    // process the first file in main thread.
-    auto reader = std::make_shared<fbpcf::io::BufferedReader>(
-        std::make_unique<fbpcf::io::FileReader>(serializedDataFiles.at(0)));
+  auto chunkSize = encryptor_->getChunkSize();
+  // The width of the rows is the width of the first line
+  std::optional<common::FixedWidthRowBuffer> rows;
+  std::vector<uint64_t> indexes;
+  indexes.reserve(chunkSize);
+
+  auto pushRow = [&](uint64_t index, const unsigned char* data, size_t size) {
+    if (!rows.has_value()) {
+      rows.emplace(size);
+      rows->reserve(chunkSize);
+    }
+    indexes.push_back(index);
+    rows->pushRow(data, size);
+    if (rows->size() >= chunkSize) {
+      encryptor_->pushLinesFromMe(*rows, std::move(indexes));
+      rows->clear();
+      indexes = std::vector<uint64_t>();
+      indexes.reserve(chunkSize);
+    }
+  };
+
+  for (auto& fileName : serializedDataFiles) {
+    auto file = private_measurement::compressed_io::makeRawFileReader(fileName);
+    auto records = openRecordFile(*file);
+    if (records.readMagic(record_format::kDataMagic)) {
+      uint64_t index;
+      const unsigned char* data;
+      uint32_t size;
+      while (records.nextData(index, data, size)) {
+        pushRow(index, data, size);
+      }
+      file->close();
+      continue;
+    }
+
+    // a text file, with a line of "<index>, <data>" per row
+    auto reader = std::make_unique<fbpcf::io::BufferedReader>(
+        std::make_unique<private_measurement::compressed_io::PushbackReader>(
+            records.takeUnread(), std::move(file)));
     while (!reader->eof()) {
-      auto [index, data] = readOneLineData(reader);
-      encryptor_->pushOneLineFromMe(std::move(data), index);
+      auto line = reader->readLine();
+      auto [index, dataStart] = parseOneLineIndex(line);
+      pushRow(
+          index,
+          reinterpret_cast<const unsigned char*>(line.data()) + dataStart,
+          line.size() - dataStart);
     }
     reader->close();
   }
-
-  auto data = folly::collectAll(std::move(futures)).get();
-  for (auto& datum : data) {
-    datum.throwUnlessValue();
-    auto& [index, data_2] = datum.value();
-    encryptor_->pushLinesFromMe(std::move(data_2), std::move(index));
+  if (rows.has_value() && !rows->empty()) {
+    encryptor_->pushLinesFromMe(*rows, std::move(indexes));
   }
-  return;
 }
 
 } // namespace unified_data_process
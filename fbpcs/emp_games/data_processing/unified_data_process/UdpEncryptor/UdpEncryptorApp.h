@@ -8,9 +8,16 @@
 #pragma once
 
 #include <fbpcf/io/api/BufferedReader.h>
+#include <fbpcf/io/api/IReaderCloser.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <algorithm>
 #include <cstdint>
+#include <memory>
+#include <thread>
 
+#include "fbpcs/emp_games/common/FixedWidthRowBuffer.h"
 #include "fbpcs/emp_games/data_processing/unified_data_process/UdpEncryptor/UdpEncryptor.h"
+#include "fbpcs/emp_games/data_processing/unified_data_process/UdpEncryptor/UdpRecordFormat.h"
 
 namespace unified_data_process {
 
@@ -19,9 +26,36 @@ class UdpEncryptorApp {
   ~UdpEncryptorApp() {}
 
   UdpEncryptorApp(std::unique_ptr<UdpEncryptor> encryptor, bool amIPublisher)
-      : encryptor_(std::move(encryptor)), amIPublisher_(amIPublisher) {}
+      : UdpEncryptorApp(
+            std::move(encryptor),
+            amIPublisher,
+            std::make_shared<folly::CPUThreadPoolExecutor>(
+                getDefaultNumThreads())) {}
 
-  void invokeUdpEncryption(
+  // The index files are read on executor, which is usually the one the
+  // encryptor processes its chunks on
+  UdpEncryptorApp(
+      std::unique_ptr<UdpEncryptor> encryptor,
+      bool amIPublisher,
+      std::shared_ptr<folly::CPUThreadPoolExecutor> executor)
+      : encryptor_(std::move(encryptor)),
+        amIPublisher_(amIPublisher),
+        executor_(std::move(executor)) {}
+
+  // One thread per core
+  static size_t getDefaultNumThreads() {
+    return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  // The chunk size for the encryptor, from the widths of both parties' rows
+  // in globalParameterFile and the bytes of memory the chunks may take
+  static size_t getChunkSizeForMemoryBudget(
+      const std::string& globalParameterFile,
+      size_t memoryBudget);
+
+  // Returns the expanded key written to expandedKeyFile, so that a
+  // decryption running in the same process doesn't have to read it again
+  std::vector<__m128i> invokeUdpEncryption(
       const std::vector<std::string>& indexFiles,
       const std::vector<std::string>& serializedDataFiles,
       const std::string& globalParameters,
@@ -29,22 +63,30 @@ class UdpEncryptorApp {
       const std::string& expandedKeyFile);
 
  private:
+  // Index and data files are either binary record files or text files
   static std::vector<uint64_t> readIndexFile(const std::string& fileName);
 
-  static std::
-      tuple<std::vector<uint64_t>, std::vector<std::vector<unsigned char>>>
-      readDataFile(const std::string& fileName);
-  static std::tuple<uint64_t, std::vector<unsigned char>> readOneLineData(
-      std::shared_ptr<fbpcf::io::BufferedReader> file);
+  // A record reader reading file, which has to outlive it
+  static record_format::RecordReader openRecordFile(
+      fbpcf::io::IReaderCloser& file);
+
+  // The index of a line of a data file and the position its data starts at
+  static std::tuple<uint64_t, size_t> parseOneLineIndex(
+      const std::string& line);
 
   void processPeerData(
       const std::vector<std::string>& indexFiles,
       const std::string& globalParameterFile) const;
 
+  // The rows of the data files all have the width of the rows of their
+  // serializer, so they are read a chunk at a time into one buffer, which is
+  // reused for every chunk. Only a few chunks are read ahead of the
+  // encryption, so the files are never held in memory at once.
   void processMyData(const std::vector<std::string>& serializedDataFiles) const;
 
   std::unique_ptr<UdpEncryptor> encryptor_;
   bool amIPublisher_;
+  std::shared_ptr<folly::CPUThreadPoolExecutor> executor_;
 };
 
 } // namespace unified_data_process
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*
+Binary record files for the index and serialized data inputs of the udp
+encryptor, so that the binary payloads of the serialized rows don't have to be
+framed in text lines, and the indexes don't have to be formatted and parsed as
+text. It only depends on the standard library and is header only, so the
+stages producing these files can include it too.
+
+All integers are written in the byte order of the host, which is little endian
+on every platform we run on. A file starts with its magic, kIndexMagic or
+kDataMagic, followed by its records until the end of the file:
+
+  index record  index uint64
+  data record   index uint64, size uint32, followed by size bytes of payload
+
+The encryptor still reads the text files, which don't start with either magic.
+*/
+namespace unified_data_process::record_format {
+
+constexpr std::string_view kIndexMagic{"PCSUDPI1", 8};
+constexpr std::string_view kDataMagic{"PCSUDPD1", 8};
+constexpr std::size_t kReadSize = 1 << 20;
+
+inline void appendIndexRecord(std::string& out, uint64_t index) {
+  out.append(reinterpret_cast<const char*>(&index), sizeof(index));
+}
+
+inline void appendDataRecord(
+    std::string& out,
+    uint64_t index,
+    const unsigned char* data,
+    uint32_t size) {
+  out.append(reinterpret_cast<const char*>(&index), sizeof(index));
+  out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+  out.append(reinterpret_cast<const char*>(data), size);
+}
+
+/*
+Decodes a record file with large sequential reads. source fills the given
+buffer with up to its size in bytes and returns how many it read, which is 0
+only at the end of the input. Throws std::runtime_error on a truncated file.
+*/
+class RecordReader {
+ public:
+  using Source = std::function<std::size_t(std::vector<char>& buffer)>;
+
+  explicit RecordReader(Source source) : source_{std::move(source)} {}
+
+  // Whether the file starts with magic, which is skipped if it does. This has
+  // to be called before reading any record.
+  bool readMagic(std::string_view magic) {
+    if (!fill(magic.size()) ||
+        std::string_view{buffer_.data(), magic.size()} != magic) {
+      return false;
+    }
+    position_ += magic.size();
+    return true;
+  }
+
+  // The bytes read from source but not consumed yet, which are taken out of
+  // the reader. Lets a file which turned out not to start with the magic be
+  // read on as a text file.
+  std::vector<char> takeUnread() {
+    buffer_.erase(buffer_.begin(), buffer_.begin() + position_);
+    position_ = 0;
+    return std::move(buffer_);
+  }
+
+  // Reads the next record of an index file. Returns false at the end of the
+  // file.
+  bool nextIndex(uint64_t& index) {
+    if (!fill(1)) {
+      return false;
+    }
+    readExactly(&index, sizeof(index));
+    return true;
+  }
+
+  // Reads the next record of a data file. data points to its payload, which
+  // stays valid until the next call. Returns false at the end of the file.
+  bool nextData(uint64_t& index, const unsigned char*& data, uint32_t& size) {
+    if (!fill(1)) {
+      return false;
+    }
+    readExactly(&index, sizeof(index));
+    readExactly(&size, sizeof(size));
+    if (!fill(size)) {
+      throw std::runtime_error("Udp record file ended unexpectedly");
+    }
+    data = reinterpret_cast<const unsigned char*>(buffer_.data() + position_);
+    position_ += size;
+    return true;
+  }
+
+ private:
+  // Makes at least size bytes available from position_, unless the input
+  // ends first
+  bool fill(std::size_t size) {
+    if (buffer_.size() - position_ >= size) {
+      return true;
+    }
+    buffer_.erase(buffer_.begin(), buffer_.begin() + position_);
+    position_ = 0;
+    while (buffer_.size() < size) {
+      auto end = buffer_.size();
+      block_.resize(std::max(kReadSize, size - end));
+      auto read = source_(block_);
+      if (read == 0) {
+        return false;
+      }
+      buffer_.insert(buffer_.end(), block_.begin(), block_.begin() + read);
+    }
+    return true;
+  }
+
+  void readExactly(void* data, std::size_t size) {
+    if (!fill(size)) {
+      throw std::runtime_error("Udp record file ended unexpectedly");
+    }
+    std::memcpy(data, buffer_.data() + position_, size);
+    position_ += size;
+  }
+
+  Source source_;
+  std::vector<char> buffer_;
+  std::vector<char> block_;
+  std::size_t position_ = 0;
+};
+
+} // namespace unified_data_process::record_format
@@ -57,7 +57,15 @@ DEFINE_string(
 DEFINE_int32(
     chunk_size,
     50000,
-    "the batch size for processing UDP encryption.");
+    "the batch size for processing UDP encryption, 0 to choose it from the row widths and chunk_memory_budget_mb.");
+DEFINE_int32(
+    chunk_memory_budget_mb,
+    1024,
+    "the memory the chunks may take when chunk_size is 0, in MB.");
+DEFINE_int32(
+    num_threads,
+    0,
+    "the number of threads for reading and encrypting the data, 0 for one per core.");
 
 DEFINE_bool(
     use_tls,
@@ -147,14 +155,29 @@ int main(int argc, char* argv[]) {
       fbpcf::engine::communication::SocketPartyCommunicationAgentFactory>(
       FLAGS_party, partyInfos, tlsInfo, metricCollector);
 
+  auto executor = std::make_shared<folly::CPUThreadPoolExecutor>(
+      FLAGS_num_threads > 0
+          ? static_cast<size_t>(FLAGS_num_threads)
+          : unified_data_process::UdpEncryptorApp::getDefaultNumThreads());
+  XLOGF(INFO, "Threads: {}", executor->numThreads());
+
+  size_t chunkSize = FLAGS_chunk_size > 0
+      ? static_cast<size_t>(FLAGS_chunk_size)
+      : unified_data_process::UdpEncryptorApp::getChunkSizeForMemoryBudget(
+            FLAGS_global_parameters_file,
+            static_cast<size_t>(FLAGS_chunk_memory_budget_mb) << 20);
+  XLOGF(INFO, "Chunk size: {}", chunkSize);
+
   unified_data_process::UdpEncryptorApp encryptionApp(
       std::make_unique<unified_data_process::UdpEncryptor>(
           std::make_unique<fbpcf::mpc_std_lib::unified_data_process::
                                data_processor::UdpEncryption>(
               communicationAgentFactory->create(
                   1 - FLAGS_party, "udp_encryption_traffic")),
-          FLAGS_chunk_size),
-      FLAGS_party == 0);
+          chunkSize,
+          executor),
+      FLAGS_party == 0,
+      executor);
 
   encryptionApp.invokeUdpEncryption(
       generateFileNames(FLAGS_index_base_path, FLAGS_index_num),
@@ -23,6 +23,7 @@
 #include "fbpcs/emp_games/data_processing/unified_data_process/UdpDecryptor/UdpDecryptorApp.h"
 #include "fbpcs/emp_games/data_processing/unified_data_process/UdpEncryptor/UdpEncryptor.h"
 #include "fbpcs/emp_games/data_processing/unified_data_process/UdpEncryptor/UdpEncryptorApp.h"
+#include "fbpcs/emp_games/data_processing/unified_data_process/UdpEncryptor/UdpRecordFormat.h"
 #include "fbpcs/emp_games/data_processing/unified_data_process/UdpProcessApp.h"
 #include "fbpcs/emp_games/data_processing/unified_data_process/UdpProcessGameFactory.h"
 #include "fbpcs/performance_tools/CostEstimation.h"
@@ -66,10 +67,22 @@ std::vector<uint64_t> generateRandomIndex(
 void writeDataToFile(
     const std::string& file,
     const std::vector<uint64_t>& indexes,
-    const std::vector<std::vector<unsigned char>>& data) {
+    const std::vector<std::vector<unsigned char>>& data,
+    bool binaryFile) {
   if (indexes.size() != data.size()) {
     throw std::invalid_argument("indexes and data have different length.");
   }
+  if (binaryFile) {
+    std::string content{record_format::kDataMagic};
+    for (size_t i = 0; i < indexes.size(); i++) {
+      record_format::appendDataRecord(
+          content, indexes.at(i), data.at(i).data(), data.at(i).size());
+    }
+    auto writer = std::make_unique<fbpcf::io::BufferedWriter>(
+        std::make_unique<fbpcf::io::FileWriter>(file));
+    writer->writeString(content);
+    return;
+  }
   auto writer = std::make_unique<fbpcf::io::BufferedWriter>(
       std::make_unique<fbpcf::io::FileWriter>(file));
   std::string newLine("\n");
@@ -84,7 +97,18 @@ void writeDataToFile(
 
 void writeIndexToFile(
     const std::string& file,
-    const std::vector<uint64_t>& indexes) {
+    const std::vector<uint64_t>& indexes,
+    bool binaryFile) {
+  if (binaryFile) {
+    std::string content{record_format::kIndexMagic};
+    for (auto index : indexes) {
+      record_format::appendIndexRecord(content, index);
+    }
+    auto writer = std::make_unique<fbpcf::io::BufferedWriter>(
+        std::make_unique<fbpcf::io::FileWriter>(file));
+    writer->writeString(content);
+    return;
+  }
   auto writer = std::make_unique<fbpcf::io::BufferedWriter>(
       std::make_unique<fbpcf::io::FileWriter>(file));
   std::string header("dummy header");
@@ -101,7 +125,8 @@ void writeIndexToFile(
 void distributeDataToFiles(
     const std::vector<std::string>& files,
     const std::vector<uint64_t>& indexes,
-    const std::vector<std::vector<unsigned char>>& data) {
+    const std::vector<std::vector<unsigned char>>& data,
+    bool binaryFiles) {
   for (size_t i = 0; i < files.size(); i++) {
     writeDataToFile(
         files.at(i),
@@ -110,19 +135,22 @@ void distributeDataToFiles(
             indexes.begin() + (i + 1) * data.size() / files.size()),
         std::vector<std::vector<unsigned char>>(
             data.begin() + i * data.size() / files.size(),
-            data.begin() + (i + 1) * data.size() / files.size()));
+            data.begin() + (i + 1) * data.size() / files.size()),
+        binaryFiles);
   }
 }
 
 void distributeIndexesToFiles(
     const std::vector<std::string>& files,
-    const std::vector<uint64_t>& indexes) {
+    const std::vector<uint64_t>& indexes,
+    bool binaryFiles) {
   for (size_t i = 0; i < files.size(); i++) {
     writeIndexToFile(
         files.at(i),
         std::vector<uint64_t>(
             indexes.begin() + i * indexes.size() / files.size(),
-            indexes.begin() + (i + 1) * indexes.size() / files.size()));
+            indexes.begin() + (i + 1) * indexes.size() / files.size()),
+        binaryFiles);
   }
 }
 
@@ -152,7 +180,8 @@ TestData generateTestData(
     size_t intersectionSize,
     int publisherFileCount,
     int advertiserFileCount,
-    int encryptionFileCount) {
+    int encryptionFileCount,
+    bool binaryFiles) {
   std::string tempDir = std::filesystem::temp_directory_path();
   const std::string publisherDataPath =
       folly::sformat("{}/publisher_data_{}_", tempDir, folly::Random::rand32());
@@ -229,12 +258,20 @@ TestData generateTestData(
   }
 
   distributeDataToFiles(
-      publisherDataFiles, publisherRandomIndexForAllUser, publisherData);
+      publisherDataFiles,
+      publisherRandomIndexForAllUser,
+      publisherData,
+      binaryFiles);
   distributeDataToFiles(
-      advertiserDataFiles, advertiserRandomIndexForAllUser, advertiserData);
+      advertiserDataFiles,
+      advertiserRandomIndexForAllUser,
+      advertiserData,
+      binaryFiles);
 
-  distributeIndexesToFiles(publisherIndexFiles, publisherCherryPickIndex);
-  distributeIndexesToFiles(advertiserIndexFiles, advertiserCherryPickIndex);
+  distributeIndexesToFiles(
+      publisherIndexFiles, publisherCherryPickIndex, binaryFiles);
+  distributeIndexesToFiles(
+      advertiserIndexFiles, advertiserCherryPickIndex, binaryFiles);
 
   global_parameters::GlobalParameters gp;
   gp.emplace(global_parameters::KAdvDataWidth, advertiserWidth);
@@ -294,7 +331,7 @@ std::vector<std::vector<uint8_t>> test(
           chunkSize),
       schedulerId == 0);
 
-  encryptionApp.invokeUdpEncryption(
+  auto expandedKey = encryptionApp.invokeUdpEncryption(
       indexFiles, dataFiles, parameterFile, encryptionFiles, expandedKeyFile);
 
   UdpDecryptorApp<schedulerId> decryptionApp{
@@ -314,8 +351,13 @@ std::vector<std::vector<uint8_t>> test(
         fbpcf::mpc_std_lib::unified_data_process::data_processor::getShardSize(
             intersectionSize, i, encryptionFiles.size());
 
-    auto [publisherData, advertiserData] = decryptionApp.invokeUdpDecryption(
-        encryptionFiles.at(i), expandedKeyFile, parameterFile);
+    // the first shard reads the expanded key written by the encryption, the
+    // others take the one it returned
+    auto [publisherData, advertiserData] = i == 0
+        ? decryptionApp.invokeUdpDecryption(
+              encryptionFiles.at(i), expandedKeyFile, parameterFile)
+        : decryptionApp.invokeUdpDecryption(
+              encryptionFiles.at(i), expandedKey, parameterFile);
 
     if constexpr (schedulerId == 0) {
       auto data = publisherData.openToParty(0).getValue();
@@ -332,8 +374,8 @@ std::vector<std::vector<uint8_t>> test(
   return rst;
 }
 
-TEST(UdpEncryptorAppTest, integration_test) {
-  auto testdata = generateTestData(100, 87, 42, 31, 19, 3, 7, 2);
+void runIntegrationTest(bool binaryFiles) {
+  auto testdata = generateTestData(100, 87, 42, 31, 19, 3, 7, 2, binaryFiles);
 
   std::vector<std::unique_ptr<fbpcf::engine::communication::
                                   SocketPartyCommunicationAgentFactoryForTests>>
@@ -405,4 +447,12 @@ TEST(UdpEncryptorAppTest, integration_test) {
   };
 }
 
+TEST(UdpEncryptorAppTest, integration_test) {
+  runIntegrationTest(false);
+}
+
+TEST(UdpEncryptorAppTest, integration_test_with_binary_files) {
+  runIntegrationTest(true);
+}
+
 } // namespace unified_data_process
@@ -7,6 +7,7 @@
 
 #include "fbpcs/emp_games/data_processing/unified_data_process/UdpEncryptor/UdpEncryptor.h"
 #include "fbpcf/mpc_std_lib/unified_data_process/data_processor/test/UdpEncryptionMock.h"
+#include "fbpcs/emp_games/common/FixedWidthRowBuffer.h"
 
 #include <gtest/gtest.h>
 #include <functional>
@@ -92,6 +93,54 @@ TEST(UdpEncryptorTestWithMock, testProcessingMyData) {
   encryptor.getExpandedKey();
 }
 
+TEST(UdpEncryptorTestWithMock, testProcessingMyDataFromRowBuffer) {
+  size_t chunkSize = 200;
+  size_t totalRow = 450;
+  size_t width = 32;
+
+  std::vector<std::vector<std::vector<unsigned char>>> testData;
+  std::vector<std::vector<uint64_t>> index;
+  common::FixedWidthRowBuffer rows{width};
+  std::vector<uint64_t> rowIndexes;
+  uint64_t randomIndex = 0;
+  for (size_t i = 0; i < totalRow; i++) {
+    if (i % chunkSize == 0) {
+      testData.push_back(std::vector<std::vector<unsigned char>>());
+      index.push_back(std::vector<uint64_t>());
+    }
+    uint8_t randomChar = folly::Random::rand32(0, 0xff);
+    randomIndex +=
+        folly::Random::rand32(); // make sure random index is always unique
+    testData.back().push_back(std::vector<unsigned char>(width, randomChar));
+    index.back().push_back(randomIndex);
+    rows.pushRow(testData.back().back().data(), width);
+    rowIndexes.push_back(randomIndex);
+  }
+
+  auto mock = std::make_unique<fbpcf::mpc_std_lib::unified_data_process::
+                                   data_processor::UdpEncryptionMock>();
+
+  EXPECT_CALL(*mock, prepareToProcessMyData(width)).Times(1);
+  for (size_t i = 0; i < testData.size(); i++) {
+    EXPECT_CALL(*mock, processMyData(testData.at(i), index.at(i))).Times(1);
+  }
+  EXPECT_CALL(*mock, getExpandedKey()).Times(1);
+
+  UdpEncryptor encryptor(std::move(mock), chunkSize);
+  // The buffer starts in the middle of a chunk
+  encryptor.pushOneLineFromMe(
+      std::vector<unsigned char>(rows.row(0), rows.row(0) + width),
+      rowIndexes.at(0));
+  common::FixedWidthRowBuffer restOfRows{width};
+  for (size_t i = 1; i < rows.size(); i++) {
+    restOfRows.pushRow(rows.row(i), width);
+  }
+  encryptor.pushLinesFromMe(
+      restOfRows,
+      std::vector<uint64_t>(rowIndexes.begin() + 1, rowIndexes.end()));
+  encryptor.getExpandedKey();
+}
+
 TEST(UdpEncryptorTestWithMock, testProcessingBothSidesData) {
   size_t chunkSize = 200;
   size_t sampleSize = 219;
@@ -163,4 +212,20 @@ TEST(UdpEncryptorTestWithMock, testProcessingBothSidesData) {
   encryptor.getEncryptionResults();
 }
 
+TEST(UdpEncryptorTest, testChunkSizeForMemoryBudget) {
+  size_t budget = 1 << 30;
+  auto chunkSize = UdpEncryptor::getChunkSizeForMemoryBudget(32, 64, budget);
+  EXPECT_GT(chunkSize, 1);
+  // both parties choose the same chunk size
+  EXPECT_EQ(
+      chunkSize, UdpEncryptor::getChunkSizeForMemoryBudget(64, 32, budget));
+  // wider rows and smaller budgets give smaller chunks
+  EXPECT_LT(
+      UdpEncryptor::getChunkSizeForMemoryBudget(32, 128, budget), chunkSize);
+  EXPECT_LT(
+      UdpEncryptor::getChunkSizeForMemoryBudget(32, 64, budget / 2),
+      chunkSize);
+  EXPECT_EQ(1, UdpEncryptor::getChunkSizeForMemoryBudget(32, 64, 0));
+}
+
 } // namespace unified_data_process
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fbpcs/emp_games/data_processing/unified_data_process/UdpEncryptor/UdpRecordFormat.h"
+
+namespace unified_data_process::record_format {
+
+// A source returning at most maxRead bytes per read, to cross the records
+RecordReader::Source stringSource(const std::string& content, size_t maxRead) {
+  return [&content, maxRead, position = size_t{0}](
+             std::vector<char>& buffer) mutable {
+    auto size = std::min({buffer.size(), maxRead, content.size() - position});
+    std::copy_n(content.begin() + position, size, buffer.begin());
+    position += size;
+    return size;
+  };
+}
+
+TEST(UdpRecordFormatTest, TestIndexRecords) {
+  std::string content{kIndexMagic};
+  std::vector<uint64_t> expected{3, 1ULL << 40, 0};
+  for (auto index : expected) {
+    appendIndexRecord(content, index);
+  }
+
+  RecordReader reader{stringSource(content, 5)};
+  EXPECT_FALSE(reader.readMagic(kDataMagic));
+  ASSERT_TRUE(reader.readMagic(kIndexMagic));
+  std::vector<uint64_t> indexes;
+  uint64_t index;
+  while (reader.nextIndex(index)) {
+    indexes.push_back(index);
+  }
+  EXPECT_EQ(expected, indexes);
+}
+
+TEST(UdpRecordFormatTest, TestDataRecords) {
+  std::vector<uint64_t> expectedIndexes{7, 2};
+  std::vector<std::vector<unsigned char>> expectedData{
+      {'\n', ',', ' ', 0}, {255, 0, 1, 2}};
+  std::string content{kDataMagic};
+  for (size_t i = 0; i < expectedIndexes.size(); i++) {
+    appendDataRecord(
+        content,
+        expectedIndexes.at(i),
+        expectedData.at(i).data(),
+        expectedData.at(i).size());
+  }
+
+  RecordReader reader{stringSource(content, 3)};
+  ASSERT_TRUE(reader.readMagic(kDataMagic));
+  std::vector<uint64_t> indexes;
+  std::vector<std::vector<unsigned char>> data;
+  uint64_t index;
+  const unsigned char* payload;
+  uint32_t size;
+  while (reader.nextData(index, payload, size)) {
+    indexes.push_back(index);
+    data.emplace_back(payload, payload + size);
+  }
+  EXPECT_EQ(expectedIndexes, indexes);
+  EXPECT_EQ(expectedData, data);
+}
+
+TEST(UdpRecordFormatTest, TestTextFileHasNoMagic) {
+  std::string content{"1, abc\n"};
+  RecordReader reader{stringSource(content, 100)};
+  EXPECT_FALSE(reader.readMagic(kDataMagic));
+
+  std::string empty;
+  RecordReader emptyReader{stringSource(empty, 100)};
+  EXPECT_FALSE(emptyReader.readMagic(kIndexMagic));
+}
+
+TEST(UdpRecordFormatTest, TestTakeUnreadReturnsTheSniffedBytes) {
+  std::string content{"1, abc\n2, def\n"};
+  auto source = stringSource(content, 3);
+  RecordReader reader{
+      [&source](std::vector<char>& buffer) { return source(buffer); }};
+  EXPECT_FALSE(reader.readMagic(kDataMagic));
+
+  // The bytes read looking for the magic, followed by the rest of the source,
+  // are the whole file
+  auto unread = reader.takeUnread();
+  std::string read{unread.begin(), unread.end()};
+  std::vector<char> buffer(100);
+  while (auto size = source(buffer)) {
+    read.append(buffer.begin(), buffer.begin() + size);
+  }
+  EXPECT_EQ(content, read);
+
+  std::string shortContent{"1, a"};
+  RecordReader shortReader{stringSource(shortContent, 100)};
+  EXPECT_FALSE(shortReader.readMagic(kIndexMagic));
+  unread = shortReader.takeUnread();
+  EXPECT_EQ(shortContent, std::string(unread.begin(), unread.end()));
+}
+
+TEST(UdpRecordFormatTest, TestTruncatedRecordThrows) {
+  std::string content{kDataMagic};
+  std::vector<unsigned char> payload{1, 2, 3};
+  appendDataRecord(content, 1, payload.data(), payload.size());
+  content.pop_back();
+
+  RecordReader reader{stringSource(content, 100)};
+  ASSERT_TRUE(reader.readMagic(kDataMagic));
+  uint64_t index;
+  const unsigned char* data;
+  uint32_t size;
+  EXPECT_THROW(reader.nextData(index, data, size), std::runtime_error);
+}
+
+} // namespace unified_data_process::record_format
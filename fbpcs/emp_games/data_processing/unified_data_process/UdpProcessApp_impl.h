@@ -12,16 +12,24 @@
 #include <fbpcf/scheduler/LazySchedulerFactory.h>
 #include <fbpcf/scheduler/NetworkPlaintextSchedulerFactory.h>
 #include <cstddef>
+#include <future>
+#include "fbpcs/emp_games/common/SchedulerPhase.h"
+#include "fbpcs/performance_tools/PhaseProfiler.h"
 
 namespace unified_data_process {
 
 template <int schedulerId>
 std::tuple<std::vector<std::vector<bool>>, std::vector<std::vector<bool>>>
 UdpProcessApp<schedulerId>::run() {
+  // The data is generated locally, so it is generated on another thread while
+  // the scheduler sets up its engine with the peer
+  XLOG(INFO) << "Start generating random data...";
+  auto dataGenerationFuture =
+      std::async(std::launch::async, [this]() { return dataGeneration(); });
+
   auto scheduler = createScheduler();
 
-  XLOG(INFO) << "Start generating random data...";
-  auto testData = dataGeneration();
+  auto testData = dataGenerationFuture.get();
   XLOG(INFO) << "Finsihed generating random data...";
   auto& unionMap = std::get<0>(testData);
   auto& metaData = std::get<1>(testData);
@@ -29,18 +37,24 @@ UdpProcessApp<schedulerId>::run() {
   costEst_->addCheckPoint("computation preparation");
   XLOGF(
       INFO, "Start to run Adapter with a unionMap of size {}", unionMap.size());
+  fbpcs::performance_tools::ScopedPhase adapterPhase{
+      "udp_adapter", common::getSchedulerCounterReader<schedulerId>()};
   auto indexes = udpProcessGame->playAdapter(unionMap);
+  adapterPhase.end();
   costEst_->addCheckPoint("Adapter done");
   XLOGF(
       INFO,
       "Start to run DataProcessor with a metaData of size {} and intersection size of {}",
       metaData.size(),
       indexes.size());
+  fbpcs::performance_tools::ScopedPhase dataProcessorPhase{
+      "udp_data_processor", common::getSchedulerCounterReader<schedulerId>()};
   auto shares = udpProcessGame->playDataProcessor(
       metaData,
       indexes,
       numberOfRows_ - metaData.size() + numberOfIntersection_,
       sizeOfRow_);
+  dataProcessorPhase.end();
   costEst_->addCheckPoint("DataProcessor done");
   auto publisherShares = std::get<0>(shares);
   auto partnerShares = std::get<1>(shares);
@@ -8,12 +8,21 @@
 #pragma once
 
 #include <fbpcf/io/api/FileIOWrappers.h>
+#include <algorithm>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
 #include "fbpcf/scheduler/LazySchedulerFactory.h"
 #include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/SchedulerPhase.h"
 #include "fbpcs/emp_games/common/Util.h"
 #include "fbpcs/emp_games/dotproduct/DotproductGame.h"
+#include "fbpcs/emp_games/dotproduct/SparseFeatureMatrix.h"
 
 #include "fbpcs/emp_games/common/SchedulerStatistics.h"
 
@@ -33,17 +42,59 @@ class DotproductApp {
       std::shared_ptr<fbpcf::util::MetricCollector> metricCollector,
       double delta,
       double eps,
-      const bool addDpNoise = true)
+      const bool addDpNoise = true,
+      const int numParseThreads = 1,
+      const int rowBlockSize = 0,
+      FixedPointOptions fixedPoint = FixedPointOptions{},
+      const bool sparseFeatures = false)
+      : DotproductApp(
+            std::move(communicationAgentFactory),
+            std::vector<std::string>{inputFilePath},
+            std::vector<std::string>{outputFilePath},
+            numFeatures,
+            labelWidth,
+            metricCollector,
+            delta,
+            eps,
+            addDpNoise,
+            numParseThreads,
+            rowBlockSize,
+            fixedPoint,
+            sparseFeatures) {}
+
+  // A session computing the dot product of every input file in turn, with
+  // one connection and one OT extension setup for all of them. The output of
+  // each input file is written to the output file at the same position.
+  DotproductApp(
+      std::unique_ptr<
+          fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+          communicationAgentFactory,
+      std::vector<std::string> inputFilePaths,
+      std::vector<std::string> outputFilePaths,
+      int numFeatures,
+      int labelWidth,
+      std::shared_ptr<fbpcf::util::MetricCollector> metricCollector,
+      double delta,
+      double eps,
+      const bool addDpNoise = true,
+      const int numParseThreads = 1,
+      const int rowBlockSize = 0,
+      FixedPointOptions fixedPoint = FixedPointOptions{},
+      const bool sparseFeatures = false)
       : communicationAgentFactory_(std::move(communicationAgentFactory)),
-        inputFilePath_(inputFilePath),
-        outputFilePath_(outputFilePath),
+        inputFilePaths_(std::move(inputFilePaths)),
+        outputFilePaths_(std::move(outputFilePaths)),
         numFeatures_(numFeatures),
         labelWidth_(labelWidth),
         delta_(delta),
         eps_(eps),
         schedulerStatistics_{0, 0, 0, 0, 0},
         metricCollector_{metricCollector},
-        addDpNoise_(addDpNoise) {}
+        addDpNoise_(addDpNoise),
+        numParseThreads_(numParseThreads),
+        rowBlockSize_(rowBlockSize),
+        fixedPoint_(fixedPoint),
+        sparseFeatures_(sparseFeatures) {}
 
   void run() {
     auto scheduler = fbpcf::scheduler::getLazySchedulerFactoryWithRealEngine(
@@ -53,26 +104,25 @@ class DotproductApp {
     DotproductGame<schedulerId> game(
         std::move(scheduler),
         std::move(communicationAgentFactory_),
-        metricCollector_);
-
-    XLOG(INFO) << "Start Reading input file ";
-    auto inputTuple = readCSVInput(inputFilePath_, labelWidth_, numFeatures_);
-    XLOG(INFO) << "Finished Reading input file ";
+        metricCollector_,
+        fixedPoint_);
 
-    XLOG(INFO) << "Number of feature rows " << std::get<0>(inputTuple).size();
-
-    auto output = game.computeDotProduct(
-        MY_ROLE,
-        inputTuple,
-        labelWidth_,
-        numFeatures_,
-        delta_,
-        eps_,
-        addDpNoise_);
+    if (inputFilePaths_.size() != outputFilePaths_.size()) {
+      throw std::invalid_argument(
+          "There must be as many output files as input files");
+    }
+    for (size_t i = 0; i < inputFilePaths_.size(); i++) {
+      XLOG(INFO) << "Start Reading input file " << inputFilePaths_.at(i);
+      // The partner has no features, so only the publisher reads them sparsely
+      auto output = sparseFeatures_ && MY_ROLE == common::PUBLISHER
+          ? computeSparseDotProduct(game, inputFilePaths_.at(i))
+          : computeDenseDotProduct(game, inputFilePaths_.at(i));
 
-    if (MY_ROLE == common::PUBLISHER) {
-      XLOG(INFO, "Writing output ...");
-      writeOutputData(output, outputFilePath_);
+      if (MY_ROLE == common::PUBLISHER) {
+        XLOG(INFO, "Writing output ...");
+        fbpcs::performance_tools::ScopedPhase outputPhase{"output_writing"};
+        writeOutputData(output, outputFilePaths_.at(i));
+      }
     }
 
     auto gateStatistics =
@@ -98,75 +148,201 @@ class DotproductApp {
     schedulerStatistics_.details = metricCollector_->collectMetrics();
   }
 
+  std::vector<double> computeDenseDotProduct(
+      DotproductGame<schedulerId>& game,
+      const std::string& inputFilePath) {
+    fbpcs::performance_tools::ScopedPhase inputPhase{"input_parsing"};
+    auto inputTuple = readCSVInput(
+        inputFilePath, labelWidth_, numFeatures_, numParseThreads_);
+    inputPhase.end();
+    XLOG(INFO) << "Finished Reading input file ";
+
+    XLOG(INFO) << "Number of feature rows " << std::get<0>(inputTuple).size();
+
+    fbpcs::performance_tools::ScopedPhase dotproductPhase{
+        "dotproduct", common::getSchedulerCounterReader<schedulerId>()};
+    return game.computeDotProduct(
+        MY_ROLE,
+        inputTuple,
+        labelWidth_,
+        numFeatures_,
+        delta_,
+        eps_,
+        addDpNoise_,
+        rowBlockSize_);
+  }
+
+  std::vector<double> computeSparseDotProduct(
+      DotproductGame<schedulerId>& game,
+      const std::string& inputFilePath) {
+    fbpcs::performance_tools::ScopedPhase inputPhase{"input_parsing"};
+    auto [features, labels] = readSparseCSVInput(
+        inputFilePath, labelWidth_, numFeatures_, numParseThreads_);
+    inputPhase.end();
+    XLOG(INFO) << "Finished Reading input file ";
+
+    XLOG(INFO) << "Number of feature rows " << features.getNumRows()
+               << ", non-zero features " << features.getNumNonZeros();
+
+    fbpcs::performance_tools::ScopedPhase dotproductPhase{
+        "dotproduct", common::getSchedulerCounterReader<schedulerId>()};
+    return game.computeDotProduct(
+        MY_ROLE,
+        features,
+        labels,
+        labelWidth_,
+        numFeatures_,
+        delta_,
+        eps_,
+        addDpNoise_,
+        rowBlockSize_);
+  }
+
   common::SchedulerStatistics getSchedulerStatistics() {
     return schedulerStatistics_;
   }
 
   static std::
       tuple<std::vector<std::vector<double>>, std::vector<std::vector<bool>>>
-      readCSVInput(std::string inputPath, int labelWidth, int numFeatures) {
-    std::vector<std::vector<double>> allFeatures;
-    std::vector<std::vector<bool>> allLabels;
-    auto lineNo = 0;
+      readCSVInput(
+          std::string inputPath,
+          int labelWidth,
+          int numFeatures,
+          int numParseThreads = 1) {
+    // Each chunk of the file is parsed into its own rows, which are then
+    // concatenated in chunk order to keep the row order of the file. The
+    // cells are parsed from the views of the file, and the labels are stored
+    // by column as they are parsed, so they don't have to be transposed.
+    size_t numChunks = std::max(numParseThreads, 1);
+    std::vector<std::vector<std::vector<double>>> chunkFeatures(numChunks);
+    std::vector<std::vector<std::vector<bool>>> chunkLabels(
+        numChunks, std::vector<std::vector<bool>>(labelWidth));
+    std::optional<size_t> featuresColumn;
+    std::optional<size_t> labelsColumn;
 
-    private_measurement::csv::readCsv(
+    private_measurement::csv::readCsvViewsInChunks(
         inputPath,
-        [&](const std::vector<std::string>& header,
-            const std::vector<std::string>& parts) {
-          if (lineNo == 0) {
-            XLOGF(DBG, "{}", common::vecToString(header));
+        numChunks,
+        [&](size_t chunk,
+            const std::vector<std::string>& /* header */,
+            const std::vector<std::string_view>& parts) {
+          if (featuresColumn.has_value()) {
+            std::vector<double> features;
+            if (*featuresColumn < parts.size()) {
+              features.reserve(numFeatures);
+              common::appendInnerArray(parts[*featuresColumn], features);
+            } else {
+              features = std::vector<double>(numFeatures);
+            }
+            if (features.size() != 0) {
+              chunkFeatures[chunk].push_back(std::move(features));
+            }
           }
 
-          auto [features, labels] =
-              parseLine(lineNo, header, parts, labelWidth, numFeatures);
-          if (features.size() != 0)
-            allFeatures.push_back(features);
-          allLabels.push_back(labels);
-          lineNo++;
+          std::string_view labels;
+          if (labelsColumn.has_value() && *labelsColumn < parts.size()) {
+            labels = parts[*labelsColumn];
+          }
+          auto& labelColumns = chunkLabels[chunk];
+          for (int j = 0; j < labelWidth; j++) {
+            labelColumns[j].push_back(
+                static_cast<size_t>(j) < labels.size() && labels[j] == '1');
+          }
+        },
+        [&](const std::vector<std::string>& header) {
+          XLOGF(DBG, "{}", common::vecToString(header));
+          for (size_t i = 0; i < header.size(); ++i) {
+            if (header[i] == "float_features") {
+              featuresColumn = i;
+            } else if (header[i] == "label_secret_share") {
+              labelsColumn = i;
+            }
+          }
         });
 
-    return {allFeatures, transposeLabels(allLabels, labelWidth)};
+    std::vector<std::vector<double>> allFeatures;
+    std::vector<std::vector<bool>> allLabels(labelWidth);
+    for (size_t chunk = 0; chunk < numChunks; ++chunk) {
+      allFeatures.insert(
+          allFeatures.end(),
+          std::make_move_iterator(chunkFeatures[chunk].begin()),
+          std::make_move_iterator(chunkFeatures[chunk].end()));
+      for (int j = 0; j < labelWidth; j++) {
+        allLabels[j].insert(
+            allLabels[j].end(),
+            chunkLabels[chunk][j].begin(),
+            chunkLabels[chunk][j].end());
+      }
+    }
+
+    return {std::move(allFeatures), std::move(allLabels)};
   }
 
-  static std::tuple<std::vector<double>, std::vector<bool>> parseLine(
-      const int lineNo,
-      const std::vector<std::string>& header,
-      const std::vector<std::string>& parts,
+  // Reads the features of the sparse_features column, which lists the
+  // non-zero features of a row as [id:value, ...], and the labels as
+  // readCSVInput does
+  static std::tuple<SparseFeatureMatrix, std::vector<std::vector<bool>>>
+  readSparseCSVInput(
+      std::string inputPath,
       int labelWidth,
-      int numFeatures) {
-    std::vector<double> features;
-    std::vector<bool> labels(labelWidth);
-
-    for (auto i = 0; i < header.size(); ++i) {
-      auto column = header[i];
-
-      if (column == "float_features") {
-        if (i < parts.size()) {
-          auto value = parts[i];
-          features = common::getInnerArray<double>(value);
-        } else {
-          features = std::vector<double>(numFeatures);
-        }
-
-      } else if (column == "label_secret_share") {
-        auto value = parts[i];
-        for (int j = 0; j < value.size(); j++) {
-          labels[j] = (value[j] == '1');
-        }
+      int numFeatures,
+      int numParseThreads = 1) {
+    size_t numChunks = std::max(numParseThreads, 1);
+    std::vector<SparseFeatureMatrix> chunkFeatures(
+        numChunks, SparseFeatureMatrix(numFeatures));
+    std::vector<std::vector<std::vector<bool>>> chunkLabels(
+        numChunks, std::vector<std::vector<bool>>(labelWidth));
+    std::optional<size_t> featuresColumn;
+    std::optional<size_t> labelsColumn;
+
+    private_measurement::csv::readCsvViewsInChunks(
+        inputPath,
+        numChunks,
+        [&](size_t chunk,
+            const std::vector<std::string>& /* header */,
+            const std::vector<std::string_view>& parts) {
+          chunkFeatures[chunk].appendRow(
+              featuresColumn.has_value() && *featuresColumn < parts.size()
+                  ? parts[*featuresColumn]
+                  : std::string_view{});
+
+          std::string_view labels;
+          if (labelsColumn.has_value() && *labelsColumn < parts.size()) {
+            labels = parts[*labelsColumn];
+          }
+          auto& labelColumns = chunkLabels[chunk];
+          for (int j = 0; j < labelWidth; j++) {
+            labelColumns[j].push_back(
+                static_cast<size_t>(j) < labels.size() && labels[j] == '1');
+          }
+        },
+        [&](const std::vector<std::string>& header) {
+          for (size_t i = 0; i < header.size(); ++i) {
+            if (header[i] == "sparse_features") {
+              featuresColumn = i;
+            } else if (header[i] == "label_secret_share") {
+              labelsColumn = i;
+            }
+          }
+          if (!featuresColumn.has_value()) {
+            throw std::invalid_argument(
+                "Input " + inputPath + " has no sparse_features column");
+          }
+        });
+
+    SparseFeatureMatrix allFeatures(numFeatures);
+    std::vector<std::vector<bool>> allLabels(labelWidth);
+    for (size_t chunk = 0; chunk < numChunks; ++chunk) {
+      allFeatures.append(chunkFeatures[chunk]);
+      for (int j = 0; j < labelWidth; j++) {
+        allLabels[j].insert(
+            allLabels[j].end(),
+            chunkLabels[chunk][j].begin(),
+            chunkLabels[chunk][j].end());
       }
     }
-    return {features, labels};
-  }
 
-  static inline std::vector<std::vector<bool>> transposeLabels(
-      std::vector<std::vector<bool>> labels,
-      int labelWidth) {
-    std::vector<std::vector<bool>> transposedLabels(
-        labelWidth, std::vector<bool>(labels.size()));
-    for (int i = 0; i < labels.size(); i++)
-      for (int j = 0; j < labelWidth; j++)
-        transposedLabels[j][i] = labels[i][j];
-    return transposedLabels;
+    return {std::move(allFeatures), std::move(allLabels)};
   }
 
   void writeOutputData(
@@ -188,8 +364,8 @@ class DotproductApp {
  private:
   std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgentFactory>
       communicationAgentFactory_;
-  std::string inputFilePath_;
-  std::string outputFilePath_;
+  std::vector<std::string> inputFilePaths_;
+  std::vector<std::string> outputFilePaths_;
   int numFeatures_;
   int labelWidth_;
   double delta_;
@@ -197,6 +373,11 @@ class DotproductApp {
   common::SchedulerStatistics schedulerStatistics_;
   std::shared_ptr<fbpcf::util::MetricCollector> metricCollector_;
   bool addDpNoise_;
+  int numParseThreads_;
+  int rowBlockSize_;
+  FixedPointOptions fixedPoint_;
+  // Whether the publisher's features are read from the sparse_features column
+  bool sparseFeatures_;
 };
 
 } // namespace pcf2_dotproduct
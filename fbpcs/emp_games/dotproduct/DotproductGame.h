@@ -7,16 +7,75 @@
 
 #pragma once
 
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
 #include "folly/logging/xlog.h"
 
 #include <fbpcf/util/MetricCollector.h>
 #include "fbpcf/frontend/mpcGame.h"
+#include "fbpcf/mpc_std_lib/walr_multiplication/IWalrMatrixMultiplication.h"
+#include "fbpcf/mpc_std_lib/walr_multiplication/IWalrMatrixMultiplicationFactory.h"
+#include "fbpcf/mpc_std_lib/walr_multiplication/OTBasedMatrixMultiplicationFactory.h"
 #include "fbpcs/emp_games/common/Debug.h"
 #include "fbpcs/emp_games/common/Util.h"
 #include "fbpcs/emp_games/dotproduct/DotproductOptions.h"
+#include "fbpcs/emp_games/dotproduct/SparseFeatureMatrix.h"
 
 namespace pcf2_dotproduct {
 
+/*
+ * The fixed-point encoding the features are multiplied in: integers of
+ * ringBits bits, 32 or 64, holding the values scaled by 10^decimalDigits. A
+ * 32-bit ring halves the traffic and memory of the OTs of the multiplication,
+ * for features whose sums fit in it at the precision needed. Both parties need
+ * the same encoding.
+ */
+struct FixedPointOptions {
+  int ringBits = 64;
+  int decimalDigits = 9;
+
+  // The most decimal digits whose scale fits in a quarter of the ring
+  int getMaxDecimalDigits() const {
+    return ringBits == 32 ? 9 : 18;
+  }
+
+  uint64_t getDivisor() const {
+    // 10^19 is the largest power of ten a uint64_t holds
+    if (decimalDigits < 0 || decimalDigits > 19) {
+      throw std::invalid_argument(
+          "Can't scale by " + std::to_string(decimalDigits) +
+          " decimal digits");
+    }
+    uint64_t divisor = 1;
+    for (int i = 0; i < decimalDigits; i++) {
+      divisor *= 10;
+    }
+    return divisor;
+  }
+
+  // The largest magnitude a party's share of a dot product may have once
+  // scaled, a quarter of the ring, so that the sum of the publisher's
+  // features and the partner's noise can't wrap around
+  double getMaxScaledValue() const {
+    return static_cast<double>(uint64_t{1} << (ringBits - 2));
+  }
+
+  void validate() const {
+    if (ringBits != 32 && ringBits != 64) {
+      throw std::invalid_argument(
+          "The ring has to be 32 or 64 bits, not " + std::to_string(ringBits));
+    }
+    if (decimalDigits < 0 || decimalDigits > getMaxDecimalDigits()) {
+      throw std::invalid_argument(
+          "A " + std::to_string(ringBits) + " bit ring can't hold " +
+          std::to_string(decimalDigits) + " decimal digits, only up to " +
+          std::to_string(getMaxDecimalDigits()));
+    }
+  }
+};
+
 template <int schedulerId>
 class DotproductGame : public fbpcf::frontend::MpcGame<schedulerId> {
  public:
@@ -25,21 +84,59 @@ class DotproductGame : public fbpcf::frontend::MpcGame<schedulerId> {
       std::shared_ptr<
           fbpcf::engine::communication::IPartyCommunicationAgentFactory>
           communicationAgentFactory,
-      std::shared_ptr<fbpcf::util::MetricCollector> metricCollector)
+      std::shared_ptr<fbpcf::util::MetricCollector> metricCollector,
+      FixedPointOptions fixedPoint = FixedPointOptions{})
       : fbpcf::frontend::MpcGame<schedulerId>(std::move(scheduler)),
         communicationAgentFactory_(communicationAgentFactory),
-        metricCollector_{metricCollector} {}
+        metricCollector_{metricCollector},
+        fixedPoint_{fixedPoint} {
+    fixedPoint_.validate();
+  }
 
+  // Multiplies the features by the OR of the labels rowBlockSize rows at a
+  // time, or all at once if it's 0, so that the matrix multiplication only
+  // holds a block of rows at a time. Both parties need the same block size.
+  // The matrix multiplication, with its OT extension, is set up on the first
+  // call and reused by every later block and call of the game, so a session
+  // computing several dot products with the same peer runs the base OTs once.
   std::vector<double> computeDotProduct(
       const int myRole,
       const std::tuple<
           std::vector<std::vector<double>>,
-          std::vector<std::vector<bool>>> inputTuple,
+          std::vector<std::vector<bool>>>& inputTuple,
       size_t nLabels,
       size_t nFeatures,
       double delta,
       double eps,
-      const bool addDpNoise);
+      const bool addDpNoise,
+      size_t rowBlockSize = 0);
+
+  // The same with the publisher's features given sparsely, which are expanded
+  // to dense rows a block at a time, so that only a block of dense rows is
+  // held. The partner, which has no features, computes the same either way.
+  std::vector<double> computeDotProduct(
+      const int myRole,
+      const SparseFeatureMatrix& features,
+      const std::vector<std::vector<bool>>& labels,
+      size_t nLabels,
+      size_t nFeatures,
+      double delta,
+      double eps,
+      const bool addDpNoise,
+      size_t rowBlockSize = 0);
+
+  // Multiplies the features of each block of rows, which getBlockFeatures
+  // returns, by the OR of the labels of the block, and sums the products
+  template <typename GetBlockFeatures>
+  std::vector<double> computeDotProductInBlocks(
+      const int myRole,
+      const std::vector<std::vector<bool>>& labels,
+      size_t nFeatures,
+      double delta,
+      double eps,
+      const bool addDpNoise,
+      size_t rowBlockSize,
+      GetBlockFeatures getBlockFeatures);
 
   virtual std::vector<double>
   generateDpNoise(int nFeatures, double delta, double eps, bool addDpNoise);
@@ -55,6 +152,25 @@ class DotproductGame : public fbpcf::frontend::MpcGame<schedulerId> {
   fbpcf::frontend::Bit<true, schedulerId, true> orAllLabels(
       const std::vector<fbpcf::frontend::Bit<true, schedulerId, true>>& labels);
 
+  fbpcf::mpc_std_lib::walr::IWalrMatrixMultiplication<schedulerId>&
+  getMatrixMultiplication(const int myRole);
+
+  // Throws std::overflow_error if a sum of some of the values of a column,
+  // which a dot product may be, doesn't fit in a quarter of the ring once
+  // scaled
+  void checkFixedPointRange(
+      const std::vector<std::vector<double>>& rows,
+      const std::string& name) const;
+
+  FixedPointOptions fixedPoint_;
+
+  std::unique_ptr<
+      fbpcf::mpc_std_lib::walr::IWalrMatrixMultiplicationFactory<schedulerId>>
+      matMulFactory_;
+  std::unique_ptr<
+      fbpcf::mpc_std_lib::walr::IWalrMatrixMultiplication<schedulerId>>
+      matMul_;
+
   virtual ~DotproductGame<schedulerId>() = default;
 };
 
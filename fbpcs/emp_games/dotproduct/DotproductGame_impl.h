@@ -8,9 +8,14 @@
 #pragma once
 
 #include <algorithm>
+#include <cmath>
 #include <exception>
+#include <functional>
 #include <future>
 #include <random>
+#include <stdexcept>
+#include "folly/Format.h"
+
 #include "fbpcs/emp_games/common/Constants.h"
 #include "fbpcs/emp_games/dotproduct/DotproductGame.h"
 
@@ -35,24 +40,159 @@ std::vector<double> DotproductGame<schedulerId>::computeDotProduct(
     const int myRole,
     const std::tuple<
         std::vector<std::vector<double>>,
-        std::vector<std::vector<bool>>> inputTuple,
+        std::vector<std::vector<bool>>>& inputTuple,
     size_t nLabels,
     size_t nFeatures,
     double delta,
     double eps,
-    const bool addDpNoise) {
-  // Plaintext label secret share
-  std::vector<std::vector<bool>> labels = std::get<1>(inputTuple);
+    const bool addDpNoise,
+    size_t rowBlockSize) {
+  // Read features
+  const auto& features = std::get<0>(inputTuple);
+  // A single block uses the features as they are
+  return computeDotProductInBlocks(
+      myRole,
+      std::get<1>(inputTuple),
+      nFeatures,
+      delta,
+      eps,
+      addDpNoise,
+      rowBlockSize,
+      [&features](
+          size_t begin,
+          size_t end,
+          bool isWholeInput,
+          std::vector<std::vector<double>>& blockFeatures)
+          -> const std::vector<std::vector<double>>& {
+        if (isWholeInput) {
+          return features;
+        }
+        blockFeatures.assign(features.begin() + begin, features.begin() + end);
+        return blockFeatures;
+      });
+}
+
+template <int schedulerId>
+std::vector<double> DotproductGame<schedulerId>::computeDotProduct(
+    const int myRole,
+    const SparseFeatureMatrix& features,
+    const std::vector<std::vector<bool>>& labels,
+    size_t nLabels,
+    size_t nFeatures,
+    double delta,
+    double eps,
+    const bool addDpNoise,
+    size_t rowBlockSize) {
+  if (features.getNumFeatures() != nFeatures) {
+    throw std::invalid_argument(
+        "The sparse features have " +
+        std::to_string(features.getNumFeatures()) + " features instead of " +
+        std::to_string(nFeatures));
+  }
+  return computeDotProductInBlocks(
+      myRole,
+      labels,
+      nFeatures,
+      delta,
+      eps,
+      addDpNoise,
+      rowBlockSize,
+      [&features](
+          size_t begin,
+          size_t end,
+          bool /* isWholeInput */,
+          std::vector<std::vector<double>>& blockFeatures)
+          -> const std::vector<std::vector<double>>& {
+        blockFeatures = features.toDense(begin, end);
+        return blockFeatures;
+      });
+}
+
+template <int schedulerId>
+template <typename GetBlockFeatures>
+std::vector<double> DotproductGame<schedulerId>::computeDotProductInBlocks(
+    const int myRole,
+    const std::vector<std::vector<bool>>& labels,
+    size_t nFeatures,
+    double delta,
+    double eps,
+    const bool addDpNoise,
+    size_t rowBlockSize,
+    GetBlockFeatures getBlockFeatures) {
+  size_t numRows = labels.empty() ? 0 : labels.at(0).size();
+  if (rowBlockSize == 0 || rowBlockSize > numRows) {
+    rowBlockSize = numRows;
+  }
+
+  auto& matMul = getMatrixMultiplication(myRole);
+
+  // Create noise vector, which is only added to the first block
+  std::vector<double> dpNoise;
+  if (myRole == common::PARTNER) {
+    dpNoise = generateDpNoise(nFeatures, delta, eps, addDpNoise);
+    checkFixedPointRange({dpNoise}, "DP noise");
+  }
+
+  // The rows are multiplied a block of rowBlockSize rows at a time, and the
+  // dot products of the blocks are summed. A single block uses the labels as
+  // they are.
+  std::vector<double> rst;
+  size_t begin = 0;
+  do {
+    size_t end = std::min(begin + rowBlockSize, numRows);
+    bool isWholeInput = begin == 0 && end == numRows;
 
-  // Create label secret shares
-  auto labelShare = createSecretLabelShare(labels);
-  XLOG(INFO, "Created Label secret shares");
+    std::vector<std::vector<bool>> blockLabels;
+    if (!isWholeInput) {
+      for (const auto& label : labels) {
+        blockLabels.emplace_back(label.begin() + begin, label.begin() + end);
+      }
+    }
 
-  // Do ORing of all the labels
-  auto finalLabel = orAllLabels(labelShare);
-  XLOG(INFO, "Performed the OR for all labels");
+    // Create label secret shares
+    auto labelShare =
+        createSecretLabelShare(isWholeInput ? labels : blockLabels);
+    XLOG(INFO, "Created Label secret shares");
 
-  constexpr uint64_t divisor = static_cast<uint64_t>(1e9);
+    // Do ORing of all the labels
+    auto finalLabel = orAllLabels(labelShare);
+    XLOG(INFO, "Performed the OR for all labels");
+
+    if (myRole == common::PUBLISHER) {
+      std::vector<std::vector<double>> blockFeaturesBuffer;
+      const auto& blockFeatures =
+          getBlockFeatures(begin, end, isWholeInput, blockFeaturesBuffer);
+      checkFixedPointRange(blockFeatures, "features");
+      auto blockRst =
+          matMul.matrixVectorMultiplication(blockFeatures, finalLabel);
+      if (rst.empty()) {
+        rst = std::move(blockRst);
+      } else {
+        std::transform(
+            rst.begin(),
+            rst.end(),
+            blockRst.begin(),
+            rst.begin(),
+            std::plus<double>());
+      }
+    } else if (myRole == common::PARTNER) {
+      matMul.matrixVectorMultiplication(
+          finalLabel,
+          begin == 0 ? dpNoise : std::vector<double>(nFeatures, 0.0));
+    }
+    begin = end;
+  } while (begin < numRows);
+  return rst;
+}
+
+template <int schedulerId>
+fbpcf::mpc_std_lib::walr::IWalrMatrixMultiplication<schedulerId>&
+DotproductGame<schedulerId>::getMatrixMultiplication(const int myRole) {
+  if (matMul_ != nullptr) {
+    return *matMul_;
+  }
+
+  const uint64_t divisor = fixedPoint_.getDivisor();
 
   auto prgFactory = std::make_unique<fbpcf::engine::util::AesPrgFactory>();
 
@@ -79,52 +219,68 @@ std::vector<double> DotproductGame<schedulerId>::computeDotProduct(
       fbpcf::mpc_std_lib::walr::util::COTWithRandomMessageFactory>(
       std::move(rcotFactory));
 
-  std::vector<double> rst;
-  if (myRole == common::PUBLISHER) {
-    // Read features
-    std::vector<std::vector<double>> features = std::get<0>(inputTuple);
-
-    // Create matrix multiplication factory
-    auto matMulFactoryPublisher = std::make_unique<
+  // Create matrix multiplication factory
+  if (fixedPoint_.ringBits == 32) {
+    matMulFactory_ = std::make_unique<
         fbpcf::mpc_std_lib::walr::
-            OTBasedMatrixMultiplicationFactory<schedulerId, uint64_t>>(
+            OTBasedMatrixMultiplicationFactory<schedulerId, uint32_t>>(
         myRole,
         1 - myRole,
-        true,
-        divisor,
+        myRole == common::PUBLISHER,
+        static_cast<uint32_t>(divisor),
         *communicationAgentFactory_,
         std::move(prgFactory),
         std::move(cotWRMFactory),
         metricCollector_);
-
-    XLOG(INFO, "Created Matrix Multiplication Factory");
-
-    rst = matMulFactoryPublisher->create()->matrixVectorMultiplication(
-        features, finalLabel);
-
-  } else if (myRole == common::PARTNER) {
-    // Create noise vector
-    const std::vector<double> dpNoise =
-        generateDpNoise(nFeatures, delta, eps, addDpNoise);
-
-    // Create matrix multiplication factory
-    auto matMulFactoryPartner = std::make_unique<
+  } else {
+    matMulFactory_ = std::make_unique<
         fbpcf::mpc_std_lib::walr::
             OTBasedMatrixMultiplicationFactory<schedulerId, uint64_t>>(
         myRole,
         1 - myRole,
-        false,
+        myRole == common::PUBLISHER,
         divisor,
         *communicationAgentFactory_,
         std::move(prgFactory),
         std::move(cotWRMFactory),
         metricCollector_);
-    XLOG(INFO, "Created Matrix Multiplication Factory");
+  }
+  XLOGF(
+      INFO,
+      "Created Matrix Multiplication Factory over {} bits with divisor {}",
+      fixedPoint_.ringBits,
+      divisor);
+
+  matMul_ = matMulFactory_->create();
+  return *matMul_;
+}
 
-    matMulFactoryPartner->create()->matrixVectorMultiplication(
-        finalLabel, dpNoise);
+template <int schedulerId>
+void DotproductGame<schedulerId>::checkFixedPointRange(
+    const std::vector<std::vector<double>>& rows,
+    const std::string& name) const {
+  // The largest magnitude any sum of the values of a column can have is the
+  // sum of their magnitudes
+  std::vector<double> columnBounds;
+  for (const auto& row : rows) {
+    columnBounds.resize(std::max(columnBounds.size(), row.size()), 0.0);
+    for (size_t i = 0; i < row.size(); i++) {
+      columnBounds[i] += std::fabs(row[i]);
+    }
+  }
+  const double divisor = static_cast<double>(fixedPoint_.getDivisor());
+  for (size_t i = 0; i < columnBounds.size(); i++) {
+    if (columnBounds[i] * divisor >= fixedPoint_.getMaxScaledValue()) {
+      throw std::overflow_error(folly::sformat(
+          "The {} of column {} sum up to {}, which overflows a {} bit ring "
+          "at {} decimal digits",
+          name,
+          i,
+          columnBounds[i],
+          fixedPoint_.ringBits,
+          fixedPoint_.decimalDigits));
+    }
   }
-  return rst;
 }
 
 template <int schedulerId>
@@ -156,6 +312,7 @@ std::vector<fbpcf::frontend::Bit<true, schedulerId, true>>
 DotproductGame<schedulerId>::createSecretLabelShare(
     const std::vector<std::vector<bool>>& labelValues) {
   std::vector<fbpcf::frontend::Bit<true, schedulerId, true>> label0;
+  label0.reserve(labelValues.size());
   for (size_t i = 0; i < labelValues.size(); i++) {
     // XLOG(INFO, labelValues.at(i)[0]);
     label0.push_back(fbpcf::frontend::Bit<true, schedulerId, true>(
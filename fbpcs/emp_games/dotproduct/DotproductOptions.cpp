@@ -17,6 +17,10 @@ DEFINE_string(
     output_base_path,
     "",
     "Local or s3 base path where output files are written to");
+DEFINE_int32(
+    num_files,
+    0,
+    "Number of input files computed in one session, read from and written to the base paths with a suffix of _0 up to _<num_files - 1>. The OT extension setup is shared by all of them. 0 for the base paths themselves");
 DEFINE_int32(
     num_features,
     50,
@@ -25,6 +29,33 @@ DEFINE_int32(
     label_width,
     16,
     "Number of labels in each row of the label matrix");
+DEFINE_int32(
+    input_parse_threads,
+    1,
+    "Number of threads used to parse a local input file");
+DEFINE_int32(
+    row_block_size,
+    0,
+    "Number of rows multiplied at a time, the same for both parties, 0 for all rows at once");
+DEFINE_int32(
+    ring_bits,
+    64,
+    "Bits of the fixed-point integers the features are multiplied in, 32 or "
+    "64, the same for both parties. 32 bits halve the OT traffic, but only "
+    "fit sums of the features and the DP noise below 2^30 / "
+    "10^fixed_point_digits, which the run checks");
+DEFINE_int32(
+    fixed_point_digits,
+    9,
+    "Decimal digits after the point the features are multiplied with, the "
+    "same for both parties. At most 18 with a 64 bit ring, and 9 with a 32 "
+    "bit one");
+DEFINE_bool(
+    sparse_features,
+    false,
+    "Read the publisher's features from a sparse_features column listing the "
+    "non-zero features of a row as [id:value, ...], and only expand "
+    "row_block_size rows at a time to dense rows. Ignored by the partner");
 DEFINE_double(delta, 1e-6, "DP noise parameter (delta)");
 DEFINE_double(eps, 5, "DP noise parameter (epsilon)");
 DEFINE_string(
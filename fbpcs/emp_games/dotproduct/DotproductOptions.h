@@ -14,8 +14,14 @@ DECLARE_string(server_ip);
 DECLARE_int32(port);
 DECLARE_string(input_base_path);
 DECLARE_string(output_base_path);
+DECLARE_int32(num_files);
 DECLARE_int32(num_features);
 DECLARE_int32(label_width);
+DECLARE_int32(input_parse_threads);
+DECLARE_int32(row_block_size);
+DECLARE_int32(ring_bits);
+DECLARE_int32(fixed_point_digits);
+DECLARE_bool(sparse_features);
 DECLARE_double(delta);
 DECLARE_double(eps);
 DECLARE_string(run_name);
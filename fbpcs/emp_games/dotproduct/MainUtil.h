@@ -10,6 +10,8 @@
 #include <folly/dynamic.h>
 #include <future>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "fbpcf/engine/communication/SocketPartyCommunicationAgentFactory.h"
 #include "fbpcs/emp_games/dotproduct/DotproductApp.h"
@@ -20,15 +22,19 @@ template <int PARTY>
 inline common::SchedulerStatistics startDotProductApp(
     std::string serverIp,
     int port,
-    std::string& inputFilePath,
-    std::string& outFilePath,
+    std::vector<std::string> inputFilePaths,
+    std::vector<std::string> outFilePaths,
     int numFeatures,
     int labelWidth,
     double delta,
     double eps,
     bool addDpNoise,
+    int numParseThreads,
+    int rowBlockSize,
     fbpcf::engine::communication::SocketPartyCommunicationAgent::TlsInfo&
-        tlsInfo) {
+        tlsInfo,
+    FixedPointOptions fixedPoint = FixedPointOptions{},
+    bool sparseFeatures = false) {
   std::map<
       int,
       fbpcf::engine::communication::SocketPartyCommunicationAgentFactory::
@@ -44,14 +50,18 @@ inline common::SchedulerStatistics startDotProductApp(
 
   auto app = std::make_unique<pcf2_dotproduct::DotproductApp<PARTY, PARTY>>(
       std::move(communicationAgentFactory),
-      inputFilePath,
-      outFilePath,
+      std::move(inputFilePaths),
+      std::move(outFilePaths),
       numFeatures,
       labelWidth,
       metricCollector,
       delta,
       eps,
-      addDpNoise);
+      addDpNoise,
+      numParseThreads,
+      rowBlockSize,
+      fixedPoint,
+      sparseFeatures);
 
   app->run();
   return app->getSchedulerStatistics();
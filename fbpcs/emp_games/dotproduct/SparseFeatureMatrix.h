@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pcf2_dotproduct {
+
+/*
+ * The features of the publisher's rows, keeping only the non-zero ones: the
+ * feature ids and values of every row, one row after the other, and where
+ * each row starts in them. The publisher reads mostly zero features into it,
+ * so parsing them and holding them take memory in the number of non-zero
+ * features, and only expands a block of rows at a time to the dense rows the
+ * matrix multiplication takes.
+ */
+class SparseFeatureMatrix {
+ public:
+  explicit SparseFeatureMatrix(size_t numFeatures)
+      : numFeatures_{numFeatures} {}
+
+  size_t getNumRows() const {
+    return rowOffsets_.size() - 1;
+  }
+
+  size_t getNumFeatures() const {
+    return numFeatures_;
+  }
+
+  size_t getNumNonZeros() const {
+    return values_.size();
+  }
+
+  // Appends a row of features in the form [id:value, id:value, ...], where an
+  // id is the index of the feature in a dense row. Features which aren't
+  // listed are zero. The commas may be escaped, as in the csv inputs.
+  void appendRow(std::string_view entries) {
+    auto isSkipped = [](char c) {
+      return c == ' ' || c == '[' || c == ']' || c == '\\';
+    };
+    size_t pos = 0;
+    while (pos < entries.size()) {
+      auto end = std::min(entries.find(',', pos), entries.size());
+      auto begin = pos;
+      pos = end + 1;
+      while (begin < end && isSkipped(entries[begin])) {
+        ++begin;
+      }
+      auto last = end;
+      while (last > begin && isSkipped(entries[last - 1])) {
+        --last;
+      }
+      if (begin == last) {
+        continue;
+      }
+
+      auto entry = entries.substr(begin, last - begin);
+      auto colon = entry.find(':');
+      uint32_t featureId = 0;
+      double value = 0;
+      if (colon == std::string_view::npos ||
+          std::from_chars(entry.data(), entry.data() + colon, featureId).ec !=
+              std::errc{} ||
+          std::from_chars(
+              entry.data() + colon + 1, entry.data() + entry.size(), value)
+                  .ec != std::errc{}) {
+        throw std::invalid_argument(
+            "Invalid sparse feature " + std::string(entry) +
+            ", expected id:value");
+      }
+      if (featureId >= numFeatures_) {
+        throw std::invalid_argument(
+            "Sparse feature id " + std::to_string(featureId) +
+            " out of range for " + std::to_string(numFeatures_) + " features");
+      }
+      if (value != 0) {
+        featureIds_.push_back(featureId);
+        values_.push_back(value);
+      }
+    }
+    rowOffsets_.push_back(values_.size());
+  }
+
+  // Appends the rows of other, which has as many features
+  void append(const SparseFeatureMatrix& other) {
+    size_t offset = values_.size();
+    featureIds_.insert(
+        featureIds_.end(), other.featureIds_.begin(), other.featureIds_.end());
+    values_.insert(values_.end(), other.values_.begin(), other.values_.end());
+    for (size_t row = 1; row < other.rowOffsets_.size(); row++) {
+      rowOffsets_.push_back(offset + other.rowOffsets_[row]);
+    }
+  }
+
+  // The dense rows from begin up to end
+  std::vector<std::vector<double>> toDense(size_t begin, size_t end) const {
+    std::vector<std::vector<double>> rows(
+        end - begin, std::vector<double>(numFeatures_, 0.0));
+    for (size_t row = begin; row < end; row++) {
+      for (size_t i = rowOffsets_[row]; i < rowOffsets_[row + 1]; i++) {
+        rows[row - begin][featureIds_[i]] = values_[i];
+      }
+    }
+    return rows;
+  }
+
+ private:
+  size_t numFeatures_;
+  std::vector<size_t> rowOffsets_{0};
+  std::vector<uint32_t> featureIds_;
+  std::vector<double> values_;
+};
+
+} // namespace pcf2_dotproduct
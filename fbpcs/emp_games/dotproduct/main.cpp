@@ -7,6 +7,7 @@
 
 #include <gflags/gflags.h>
 #include <string>
+#include <vector>
 
 #include "folly/Format.h"
 #include "folly/init/Init.h"
@@ -43,6 +44,22 @@ int main(int argc, char* argv[]) {
   XLOGF(INFO, "Base input path: {}", FLAGS_input_base_path);
   XLOGF(INFO, "Base output path: {}", FLAGS_output_base_path);
 
+  // With num_files, the files are the shards of the base paths, which are
+  // computed in one session
+  std::vector<std::string> inputFilePaths;
+  std::vector<std::string> outputFilePaths;
+  if (FLAGS_num_files > 0) {
+    for (int i = 0; i < FLAGS_num_files; i++) {
+      inputFilePaths.push_back(
+          FLAGS_input_base_path + "_" + std::to_string(i));
+      outputFilePaths.push_back(
+          FLAGS_output_base_path + "_" + std::to_string(i));
+    }
+  } else {
+    inputFilePaths.push_back(FLAGS_input_base_path);
+    outputFilePaths.push_back(FLAGS_output_base_path);
+  }
+
   common::SchedulerStatistics schedulerStatistics;
 
   auto tlsInfo = fbpcf::engine::communication::getTlsInfoFromArgs(
@@ -51,6 +68,14 @@ int main(int argc, char* argv[]) {
       FLAGS_server_cert_path,
       FLAGS_private_key_path,
       "");
+
+  pcf2_dotproduct::FixedPointOptions fixedPoint{
+      FLAGS_ring_bits, FLAGS_fixed_point_digits};
+  XLOGF(
+      INFO,
+      "Fixed point: {} bit ring, {} decimal digits",
+      fixedPoint.ringBits,
+      fixedPoint.decimalDigits);
   try {
     if (FLAGS_party == common::PUBLISHER) {
       XLOG(INFO)
@@ -60,14 +85,18 @@ int main(int argc, char* argv[]) {
           pcf2_dotproduct::startDotProductApp<common::PUBLISHER>(
               FLAGS_server_ip,
               FLAGS_port,
-              FLAGS_input_base_path,
-              FLAGS_output_base_path,
+              inputFilePaths,
+              outputFilePaths,
               FLAGS_num_features,
               FLAGS_label_width,
               FLAGS_delta,
               FLAGS_eps,
               FLAGS_add_dp_noise,
-              tlsInfo);
+              FLAGS_input_parse_threads,
+              FLAGS_row_block_size,
+              tlsInfo,
+              fixedPoint,
+              FLAGS_sparse_features);
 
     } else if (FLAGS_party == common::PARTNER) {
       XLOG(INFO)
@@ -77,14 +106,18 @@ int main(int argc, char* argv[]) {
           pcf2_dotproduct::startDotProductApp<common::PARTNER>(
               FLAGS_server_ip,
               FLAGS_port,
-              FLAGS_input_base_path,
-              FLAGS_output_base_path,
+              inputFilePaths,
+              outputFilePaths,
               FLAGS_num_features,
               FLAGS_label_width,
               FLAGS_delta,
               FLAGS_eps,
               FLAGS_add_dp_noise,
-              tlsInfo);
+              FLAGS_input_parse_threads,
+              FLAGS_row_block_size,
+              tlsInfo,
+              fixedPoint,
+              FLAGS_sparse_features);
     } else {
       XLOGF(FATAL, "Invalid Party: {}", FLAGS_party);
     }
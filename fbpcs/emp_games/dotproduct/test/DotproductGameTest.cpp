@@ -24,6 +24,7 @@
 #include "fbpcs/emp_games/common/TestUtil.h"
 #include "fbpcs/emp_games/dotproduct/DotproductApp.h"
 #include "fbpcs/emp_games/dotproduct/DotproductGame.h"
+#include "fbpcs/emp_games/dotproduct/SparseFeatureMatrix.h"
 #include "fbpcs/emp_games/dotproduct/test/DotproductTestUtils.h"
 #include "gmock/gmock.h"
 
@@ -37,11 +38,13 @@ class MockDotProductGame : public DotproductGame<schedulerId> {
       std::shared_ptr<
           fbpcf::engine::communication::IPartyCommunicationAgentFactory>
           communicationAgentFactory,
-      std::shared_ptr<fbpcf::util::MetricCollector> metricCollector)
+      std::shared_ptr<fbpcf::util::MetricCollector> metricCollector,
+      FixedPointOptions fixedPoint = FixedPointOptions{})
       : DotproductGame<schedulerId>(
             std::move(scheduler),
             std::move(communicationAgentFactory),
-            metricCollector) {}
+            metricCollector,
+            fixedPoint) {}
 
   MOCK_METHOD(
       std::vector<double>,
@@ -86,24 +89,50 @@ std::vector<double> runGame(
     double delta,
     double eps,
     bool addDpNoise,
-    std::vector<double> dpNoise) {
+    std::vector<double> dpNoise,
+    size_t rowBlockSize,
+    FixedPointOptions fixedPoint,
+    bool sparseFeatures) {
   auto scheduler = schedulerCreator(PARTY, *factory);
 
   auto metricCollector =
       std::make_shared<fbpcf::util::MetricCollector>("dotproduct_test");
   // create a mock Dotproduct Game
   MockDotProductGame<schedulerId> mockGame(
-      std::move(scheduler), std::move(factory), metricCollector);
+      std::move(scheduler), std::move(factory), metricCollector, fixedPoint);
 
   // mock the dpNoise generation in DotproductGame
   ON_CALL(mockGame, generateDpNoise(numFeatures, delta, eps, addDpNoise))
       .WillByDefault(testing::Return(dpNoise));
 
+  if (sparseFeatures && PARTY == common::PUBLISHER) {
+    auto [features, labels] =
+        DotproductApp<PARTY, schedulerId>::readSparseCSVInput(
+            inputFilePath, labelWidth, numFeatures);
+    return mockGame.computeDotProduct(
+        PARTY,
+        features,
+        labels,
+        labelWidth,
+        numFeatures,
+        delta,
+        eps,
+        addDpNoise,
+        rowBlockSize);
+  }
+
   auto inputTuple = DotproductApp<PARTY, schedulerId>::readCSVInput(
       inputFilePath, labelWidth, numFeatures);
 
   auto output = mockGame.computeDotProduct(
-      PARTY, inputTuple, labelWidth, numFeatures, delta, eps, addDpNoise);
+      PARTY,
+      inputTuple,
+      labelWidth,
+      numFeatures,
+      delta,
+      eps,
+      addDpNoise,
+      rowBlockSize);
   return output;
 }
 
@@ -185,7 +214,13 @@ void testORLabels(fbpcf::SchedulerType schedulerType) {
   EXPECT_EQ(result, expectedResult);
 }
 
-void testDotproductGame(fbpcf::SchedulerType schedulerType, bool addDpNoise) {
+void testDotproductGame(
+    fbpcf::SchedulerType schedulerType,
+    bool addDpNoise,
+    size_t rowBlockSize = 0,
+    FixedPointOptions fixedPoint = FixedPointOptions{},
+    double tolerance = 1e-7,
+    bool sparseFeatures = false) {
   auto factories = fbpcf::engine::communication::getInMemoryAgentFactory(2);
   const bool unsafe = true;
   fbpcf::SchedulerCreator schedulerCreator =
@@ -194,7 +229,9 @@ void testDotproductGame(fbpcf::SchedulerType schedulerType, bool addDpNoise) {
   std::string baseDir =
       private_measurement::test_util::getBaseDirFromPath(__FILE__);
   std::string filename0 = folly::sformat(
-      "{}/test_correctness/publisher_dotprodtest_0.csv", baseDir);
+      sparseFeatures ? "{}/test_correctness/publisher_sparse_dotprodtest_0.csv"
+                     : "{}/test_correctness/publisher_dotprodtest_0.csv",
+      baseDir);
 
   std::string filename1 =
       folly::sformat("{}/test_correctness/partner_dotprodtest_0.csv", baseDir);
@@ -230,7 +267,10 @@ void testDotproductGame(fbpcf::SchedulerType schedulerType, bool addDpNoise) {
       DELTA,
       EPS,
       addDpNoise,
-      dpNoise);
+      dpNoise,
+      rowBlockSize,
+      fixedPoint,
+      sparseFeatures);
   auto futureBob = std::async(
       runGame<1, 1>,
       std::move(factories[1]),
@@ -241,7 +281,10 @@ void testDotproductGame(fbpcf::SchedulerType schedulerType, bool addDpNoise) {
       DELTA,
       EPS,
       addDpNoise,
-      dpNoise);
+      dpNoise,
+      rowBlockSize,
+      fixedPoint,
+      sparseFeatures);
 
   auto output = futureAlice.get();
   futureBob.get();
@@ -260,7 +303,7 @@ void testDotproductGame(fbpcf::SchedulerType schedulerType, bool addDpNoise) {
   EXPECT_EQ(output.size(), expectedResult.size());
 
   // Check that values are equal
-  bool equal = verifyOutput(output, expectedResult);
+  bool equal = verifyOutput(output, expectedResult, tolerance);
 
   EXPECT_TRUE(equal);
 }
@@ -285,6 +328,85 @@ TEST_P(DotproductGameTestFixture, TestDotProductGameWithNoise) {
   // No Dp noise
   testDotproductGame(schedulerType, false);
 }
+TEST_P(DotproductGameTestFixture, TestDotProductGameInRowBlocks) {
+  auto schedulerType = GetParam();
+
+  // With Dp noise, in blocks of 3 rows out of 10
+  testDotproductGame(schedulerType, true, 3);
+}
+TEST_P(DotproductGameTestFixture, TestDotProductGameInNarrowRing) {
+  auto schedulerType = GetParam();
+
+  // With Dp noise, in 32 bit integers with 6 decimal digits, which round
+  // each of the 10 rows by at most 5e-7
+  testDotproductGame(schedulerType, true, 0, FixedPointOptions{32, 6}, 1e-5);
+}
+
+TEST_P(DotproductGameTestFixture, TestDotProductGameWithSparseFeatures) {
+  auto schedulerType = GetParam();
+
+  // With Dp noise, from the non-zero features of the same rows, in blocks of
+  // 3 rows out of 10
+  testDotproductGame(schedulerType, true, 3, FixedPointOptions{}, 1e-7, true);
+}
+
+TEST(DotproductGameTest, TestFixedPointOptions) {
+  EXPECT_EQ(1'000'000'000, FixedPointOptions{}.getDivisor());
+  EXPECT_EQ(1'000'000, (FixedPointOptions{32, 6}.getDivisor()));
+  EXPECT_NO_THROW((FixedPointOptions{32, 6}.validate()));
+  // 10^9 fits in a quarter of a 32 bit ring, and 10^18 of a 64 bit one
+  EXPECT_NO_THROW((FixedPointOptions{32, 9}.validate()));
+  EXPECT_NO_THROW((FixedPointOptions{64, 18}.validate()));
+  EXPECT_THROW((FixedPointOptions{32, 10}.validate()), std::invalid_argument);
+  EXPECT_THROW((FixedPointOptions{64, 19}.validate()), std::invalid_argument);
+  // 10^20 doesn't even fit in 64 bits
+  EXPECT_THROW((FixedPointOptions{64, 20}.validate()), std::invalid_argument);
+  EXPECT_THROW((FixedPointOptions{64, 20}.getDivisor()), std::invalid_argument);
+  EXPECT_THROW((FixedPointOptions{16, 2}.validate()), std::invalid_argument);
+  EXPECT_THROW((FixedPointOptions{64, -1}.validate()), std::invalid_argument);
+}
+
+TEST(DotproductGameTest, TestSparseFeatureMatrix) {
+  SparseFeatureMatrix features(4);
+  features.appendRow("[1:0.5\\, 3:2.0]");
+  features.appendRow("[]");
+  features.appendRow("[0:1.5, 2:0.0]");
+
+  EXPECT_EQ(3, features.getNumRows());
+  // The explicit zero isn't kept
+  EXPECT_EQ(3, features.getNumNonZeros());
+  std::vector<std::vector<double>> expected{
+      {0.0, 0.5, 0.0, 2.0}, {0.0, 0.0, 0.0, 0.0}, {1.5, 0.0, 0.0, 0.0}};
+  EXPECT_EQ(expected, features.toDense(0, 3));
+  EXPECT_EQ(
+      std::vector<std::vector<double>>(expected.begin() + 1, expected.end()),
+      features.toDense(1, 3));
+
+  SparseFeatureMatrix other(4);
+  other.appendRow("[3:1.0]");
+  features.append(other);
+  EXPECT_EQ(4, features.getNumRows());
+  EXPECT_EQ(
+      (std::vector<std::vector<double>>{{0.0, 0.0, 0.0, 1.0}}),
+      features.toDense(3, 4));
+
+  EXPECT_THROW(features.appendRow("[4:1.0]"), std::invalid_argument);
+  EXPECT_THROW(features.appendRow("[1.0]"), std::invalid_argument);
+  EXPECT_THROW(features.appendRow("[a:1.0]"), std::invalid_argument);
+}
+
+TEST(DotproductGameTest, TestSparseInputWithoutFeaturesColumnThrows) {
+  auto path = (std::filesystem::temp_directory_path() /
+               ("DotproductGameTest_" +
+                std::to_string(folly::Random::secureRand64())))
+                  .string();
+  fbpcf::io::FileIOWrappers::writeFile(
+      path, "id_,float_features,label_secret_share\n1,[1.0],1\n");
+  EXPECT_THROW(
+      (DotproductApp<common::PUBLISHER, 0>::readSparseCSVInput(path, 1, 4)),
+      std::invalid_argument);
+  std::filesystem::remove(path);
+}
 
 INSTANTIATE_TEST_SUITE_P(
     DotproductGameTest,
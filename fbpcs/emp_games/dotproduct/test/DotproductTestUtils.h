@@ -44,16 +44,17 @@ inline std::vector<double> parseResult(std::string filePath) {
 }
 
 // verify the dotproduct output with expected results, value difference should
-// be smaller than 1e-7.
+// be smaller than tolerance, 1e-7 by default.
 inline bool verifyOutput(
     std::vector<double> result,
-    std::vector<double> expectedResult) {
+    std::vector<double> expectedResult,
+    double tolerance = 1e-7) {
   return std::equal(
       result.begin(),
       result.end(),
       expectedResult.begin(),
-      [](double value1, double value2) {
-        return std::fabs(value1 - value2) < 1e-7;
+      [tolerance](double value1, double value2) {
+        return std::fabs(value1 - value2) < tolerance;
       });
 }
 
@@ -116,49 +116,89 @@ parseTouchpointMetadata(
 }
 
 // Secret share attribution result received by the game will be structured as
-// : {"rule1" -> {"format1" -> {"pid1" -> {results}}}} Thus here, we are
-// iterating over list of attribution results per pid per format per rule and
-// adding them to a vector of maps from pid to vector<result>. While
-// running the aggregation game, we will share this vector of vectors between
-// parties (order maintained), where each vector would represent results for
-// one rule and one format.
-static std::vector<std::vector<std::vector<AttributionAdditiveSSResult>>>
-getAttributionsArrayfromDynamic(const folly::dynamic& obj) {
-  std::vector<std::map<int64_t, std::vector<AttributionAdditiveSSResult>>>
-      attributionPidVectorMap;
-  std::vector<std::string> attributionList; // list of attribution rules
-  // For now, I am not using the rule name or formatter name in the logic as
-  // the aggregation behaviour is not affected by different attribution rules.
-  std::vector<std::vector<std::vector<AttributionAdditiveSSResult>>>
-      attributionResultsList;
+// : {"rule1" -> {"format1" -> {"pid1" -> {results}}}}. The isAttributed shares
+// are read into one attribution array per rule and format, in the order of
+// the rules and formats, with the rows of an array ordered by pid. The shares
+// are copied straight from the parsed json into the flat column, without
+// building the results of a row in between.
+static void readIsAttributed(
+    const folly::dynamic& obj,
+    size_t numRows,
+    size_t& numAttributionArrays,
+    size_t& numAttributionSlots,
+    std::vector<int64_t>& isAttributed) {
+  // For now, the rule name or formatter name is not used in the logic as the
+  // aggregation behaviour is not affected by different attribution rules.
   for (const auto& [rule, formatters] : obj.items()) {
-    attributionList.push_back(rule.asString());
     for (const auto& [formatter, resultPerPID] : formatters.items()) {
-      std::map<int64_t, std::vector<AttributionAdditiveSSResult>>
-          attributionsPerPidMap;
+      std::vector<std::pair<int64_t, const folly::dynamic*>> rows;
+      rows.reserve(resultPerPID.size());
       for (const auto& [pid, results] : resultPerPID.items()) {
-        std::vector<AttributionAdditiveSSResult> attributionResults;
-        for (const auto& result : results) {
-          attributionResults.push_back(
-              AttributionAdditiveSSResult::fromDynamic(result));
+        rows.emplace_back(pid.asInt(), &results);
+      }
+      std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+      });
+      CHECK_EQ(rows.size(), numRows)
+          << "Attribution results of rule " << rule.asString()
+          << " do not have one row per input row.";
+
+      if (numAttributionArrays == 0 && !rows.empty()) {
+        numAttributionSlots = rows.front().second->size();
+        isAttributed.reserve(
+            obj.size() * formatters.size() * numRows * numAttributionSlots);
+      }
+      for (const auto& [pid, results] : rows) {
+        CHECK_EQ(results->size(), numAttributionSlots)
+            << "Attribution results of pid " << pid
+            << " do not have as many slots as the other rows.";
+        for (const auto& result : *results) {
+          isAttributed.push_back(
+              AttributionAdditiveSSResult::fromDynamic(result).isAttributed);
         }
-        attributionsPerPidMap.emplace(
-            pid.asInt(), std::move(attributionResults));
       }
-      attributionPidVectorMap.push_back(std::move(attributionsPerPidMap));
+      numAttributionArrays++;
     }
+  }
+}
 
-    for (const auto& attributionsPerPidMap : attributionPidVectorMap) {
-      std::vector<std::vector<AttributionAdditiveSSResult>>
-          attributionPidVector;
-      for (const auto& attributionResults : attributionsPerPidMap) {
-        attributionPidVector.push_back(attributionResults.second);
+void AggregationInputMetrics::appendOriginalAdIds(
+    const std::vector<pcf2_aggregation::TouchpointMetadata>& touchpoints) {
+  if (originalAdIds_.empty()) {
+    numTouchpoints_ = touchpoints.size();
+  }
+  CHECK_EQ(touchpoints.size(), numTouchpoints_)
+      << "Rows do not have the same number of touchpoints.";
+  for (const auto& touchpoint : touchpoints) {
+    originalAdIds_.push_back(touchpoint.originalAdId);
+  }
+}
+
+AggregationInputMetrics::AggregationInputMetrics(
+    std::vector<int64_t> ids,
+    const std::vector<std::vector<std::vector<AttributionAdditiveSSResult>>>&
+        attributionSecretShare,
+    const std::vector<std::vector<pcf2_aggregation::TouchpointMetadata>>&
+        touchpointMetadataArrays)
+    : ids_{std::move(ids)},
+      numAttributionArrays_{attributionSecretShare.size()} {
+  for (const auto& touchpoints : touchpointMetadataArrays) {
+    appendOriginalAdIds(touchpoints);
+  }
+  for (const auto& attributionArray : attributionSecretShare) {
+    CHECK_EQ(attributionArray.size(), getNumRows())
+        << "Attribution results do not have one row per input row.";
+    for (const auto& results : attributionArray) {
+      if (isAttributed_.empty()) {
+        numAttributionSlots_ = results.size();
+      }
+      CHECK_EQ(results.size(), numAttributionSlots_)
+          << "Attribution results do not have the same number of slots.";
+      for (const auto& result : results) {
+        isAttributed_.push_back(result.isAttributed);
       }
-      attributionResultsList.push_back(std::move(attributionPidVector));
     }
   }
-
-  return attributionResultsList;
 }
 
 AggregationInputMetrics::AggregationInputMetrics(
@@ -174,7 +214,7 @@ AggregationInputMetrics::AggregationInputMetrics(
   XLOGF(
       INFO, "Parsing input metadata file {}", inputClearTextFilePath.string());
 
-  // Parse the input metadata file
+  // Parse the input metadata file, keeping only the ad ids of the touchpoints
   int lineNo = 0;
   bool success = private_measurement::csv::readCsv(
       inputClearTextFilePath,
@@ -182,7 +222,7 @@ AggregationInputMetrics::AggregationInputMetrics(
           const std::vector<std::string>& parts) {
         ids_.push_back(lineNo);
 
-        touchpointMetadataArrays_.push_back(
+        appendOriginalAdIds(
             parseTouchpointMetadata(inputEncryption, lineNo, header, parts));
 
         lineNo++;
@@ -199,13 +239,15 @@ AggregationInputMetrics::AggregationInputMetrics(
       INFO,
       "Parsing input secret share file {}",
       inputSecretShareFilePath.string());
-  // Reading the attribution results received from private attribution game in
-  // an unordered_map.
   auto attributionResultJson = folly::parseJson(
       fbpcf::io::FileIOWrappers::readFile(inputSecretShareFilePath));
 
-  attributionSecretShare_ =
-      getAttributionsArrayfromDynamic(attributionResultJson);
+  readIsAttributed(
+      attributionResultJson,
+      getNumRows(),
+      numAttributionArrays_,
+      numAttributionSlots_,
+      isAttributed_);
 }
 
 } // namespace pcf2_he
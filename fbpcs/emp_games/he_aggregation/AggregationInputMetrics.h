@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <string>
 #include <unordered_map>
@@ -22,7 +24,13 @@ namespace pcf2_he {
 
 /*
  * This class represents input data for Private Aggregation.
- * It processes an input csv and generates the std::vectors for each column
+ * It processes an input csv and the attribution results of each row, and
+ * stores the columns that are aggregated flat: the isAttributed shares indexed
+ * by (attribution array, row, slot), where an attribution array holds the
+ * results of one rule and format, and the original ad ids indexed by (row,
+ * touchpoint). The touchpoints of every row are padded to
+ * FLAGS_max_num_touchpoints, and the attribution results of every row have
+ * the same number of slots, one per conversion and touchpoint.
  */
 class AggregationInputMetrics {
  public:
@@ -33,34 +41,58 @@ class AggregationInputMetrics {
 
   explicit AggregationInputMetrics(
       std::vector<int64_t> ids,
-      std::vector<std::vector<std::vector<AttributionAdditiveSSResult>>>
+      const std::vector<std::vector<std::vector<AttributionAdditiveSSResult>>>&
           attributionSecretShare,
-      std::vector<std::vector<pcf2_aggregation::TouchpointMetadata>>
-          touchpointMetadataArrays)
-      : ids_{ids},
-        attributionSecretShare_{attributionSecretShare},
-        touchpointMetadataArrays_{touchpointMetadataArrays} {}
+      const std::vector<std::vector<pcf2_aggregation::TouchpointMetadata>>&
+          touchpointMetadataArrays);
 
   const std::vector<int64_t>& getIds() const {
     return ids_;
   }
 
-  const std::vector<std::vector<std::vector<AttributionAdditiveSSResult>>>
-  getAttributionSecretShares() const {
-    return attributionSecretShare_;
+  size_t getNumRows() const {
+    return ids_.size();
   }
 
-  const std::vector<std::vector<pcf2_aggregation::TouchpointMetadata>>&
-  getTouchpointMetadata() const {
-    return touchpointMetadataArrays_;
+  size_t getNumAttributionArrays() const {
+    return numAttributionArrays_;
+  }
+
+  size_t getNumAttributionSlots() const {
+    return numAttributionSlots_;
+  }
+
+  size_t getNumTouchpoints() const {
+    return numTouchpoints_;
+  }
+
+  // The getNumAttributionSlots() isAttributed shares of a row in an
+  // attribution array
+  const int64_t* getIsAttributed(size_t attributionArray, size_t row) const {
+    return isAttributed_.data() +
+        (attributionArray * getNumRows() + row) * numAttributionSlots_;
+  }
+
+  // The getNumTouchpoints() original ad ids of a row
+  const uint64_t* getOriginalAdIds(size_t row) const {
+    return originalAdIds_.data() + row * numTouchpoints_;
+  }
+
+  // The original ad ids of every row, one row after the other
+  const std::vector<uint64_t>& getOriginalAdIds() const {
+    return originalAdIds_;
   }
 
  private:
+  void appendOriginalAdIds(
+      const std::vector<pcf2_aggregation::TouchpointMetadata>& touchpoints);
+
   std::vector<int64_t> ids_;
-  std::vector<std::vector<std::vector<AttributionAdditiveSSResult>>>
-      attributionSecretShare_;
-  std::vector<std::vector<pcf2_aggregation::TouchpointMetadata>>
-      touchpointMetadataArrays_;
+  size_t numAttributionArrays_ = 0;
+  size_t numAttributionSlots_ = 0;
+  size_t numTouchpoints_ = 0;
+  std::vector<int64_t> isAttributed_;
+  std::vector<uint64_t> originalAdIds_;
 };
 
 } // namespace pcf2_he
@@ -61,14 +61,12 @@ class HEAggApp {
         secretShareFilePath_,
         inputFilePath_);
 
-    auto touchpointMetadataArrays = input.getTouchpointMetadata();
-    auto secretShareAttributionArrays = input.getAttributionSecretShares();
-
     XLOGF(
         INFO,
-        "Touchpoint Array size = {}, Secret share attribution array size = {}",
-        touchpointMetadataArrays.size(),
-        secretShareAttributionArrays[0].size());
+        "Rows = {}, Attribution arrays = {}, Attribution slots per row = {}",
+        input.getNumRows(),
+        input.getNumAttributionArrays(),
+        input.getNumAttributionSlots());
 
     XLOG(INFO) << "Finished Reading input file ";
 
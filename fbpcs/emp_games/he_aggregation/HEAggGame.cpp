@@ -6,7 +6,16 @@
  */
 
 #include "fbpcs/emp_games/he_aggregation/HEAggGame.h"
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
 #include "fbpcf/engine/util/AesPrgFactory.h"
 #include "fbpcf/mpc_std_lib/oram/DifferenceCalculatorFactory.h"
 #include "fbpcf/mpc_std_lib/oram/LinearOramFactory.h"
@@ -18,56 +27,100 @@
 
 #include "folly/logging/xlog.h"
 
-#include "privacy_infra/elgamal/ElGamal.h"
-
 namespace pcf2_he {
 
+// The sum of the isAttributed shares of a touchpoint over the conversions,
+// whose shares are maxTouchpoints slots apart
+int64_t sumOverConversions(
+    const int64_t* isAttributed,
+    int touchpoint,
+    int maxTouchpoints,
+    int maxConversions) {
+  int64_t sum = 0;
+  for (int k = touchpoint; k < maxConversions * maxTouchpoints;
+       k += maxTouchpoints) {
+    sum += isAttributed[k];
+  }
+  return sum;
+}
+
+// Encrypts the rows from rowBegin up to rowEnd, counting the rows of every
+// attribution array one array after the other, which is the order their
+// ciphertexts are sent in. The ciphertexts are written to their slots in one
+// preallocated array, so the rows can be encrypted on numThreads threads in
+// any order
+template <typename Scheme>
 std::vector<uint8_t> encryptAttrResult(
-    heschme::PublicKey& pk,
+    const Scheme& scheme,
     const AggregationInputMetrics& input,
+    size_t rowBegin,
+    size_t rowEnd,
     int maxTouchpoints,
-    int maxConversions) {
-  std::vector<std::vector<std::vector<AttributionAdditiveSSResult>>>
-      secretShareAttributionArrays = input.getAttributionSecretShares();
-  std::vector<uint8_t> ciphertextArray;
-  for (const auto& secretShareAttributionArray : secretShareAttributionArrays) {
-    for (const auto& paddedSecretAttribution : secretShareAttributionArray) {
+    int maxConversions,
+    size_t numThreads) {
+  const size_t ciphertextSize = scheme.getCiphertextSize();
+  size_t numRows = rowEnd - rowBegin;
+  std::vector<uint8_t> ciphertextArray(
+      numRows * maxTouchpoints * ciphertextSize);
+
+  auto encryptRows = [&](size_t begin, size_t end) {
+    for (size_t row = begin; row < end; row++) {
+      const int64_t* paddedSecretAttribution = input.getIsAttributed(
+          (rowBegin + row) / input.getNumRows(),
+          (rowBegin + row) % input.getNumRows());
       // Each touchpoint has is_attr ss for each conversion. We add all
       // is_attr ss for the same touchpoint in plaintext before HE encryption
       for (int i = 0; i < maxTouchpoints; i++) {
-        int partnerAttrResult = 0;
-        for (int j = i; j < maxConversions * maxTouchpoints;
-             j += maxTouchpoints) {
-          partnerAttrResult += paddedSecretAttribution[j].isAttributed;
-        }
-        std::vector<uint8_t> c = pk.encrypt(partnerAttrResult).toBytes();
-        ciphertextArray.insert(ciphertextArray.end(), c.begin(), c.end());
+        int partnerAttrResult = sumOverConversions(
+            paddedSecretAttribution, i, maxTouchpoints, maxConversions);
+        std::vector<uint8_t> c =
+            scheme.toBytes(scheme.encrypt(partnerAttrResult));
+        std::copy(
+            c.begin(),
+            c.end(),
+            ciphertextArray.begin() +
+                (row * maxTouchpoints + i) * ciphertextSize);
       }
     }
+  };
+
+  numThreads = std::clamp<size_t>(numThreads, 1, std::max<size_t>(numRows, 1));
+  std::vector<std::future<void>> futures;
+  for (size_t t = 0; t < numThreads; t++) {
+    futures.push_back(std::async(
+        std::launch::async,
+        encryptRows,
+        numRows * t / numThreads,
+        numRows * (t + 1) / numThreads));
+  }
+  for (auto& future : futures) {
+    future.get();
   }
   return ciphertextArray;
 }
+
+template <typename Scheme>
 std::vector<uint64_t> decryptAggCiphertext(
-    heschme::PrivateKey& sk,
+    const Scheme& scheme,
     const std::vector<uint8_t>& aggregatedCiphertexts,
-    int numGroups,
-    int ciphertextSize) {
+    size_t numGroups) {
+  const size_t ciphertextSize = scheme.getCiphertextSize();
   std::vector<uint64_t> decryptedArray;
+  decryptedArray.reserve(numGroups);
 
   // Initialize pointers to the ciphertext
-  int ciphertextStart = 0;
-  int ciphertextEnd = ciphertextStart + ciphertextSize;
+  size_t ciphertextStart = 0;
+  size_t ciphertextEnd = ciphertextStart + ciphertextSize;
 
-  for (int j = 0; j < numGroups; j++) {
+  for (size_t j = 0; j < numGroups; j++) {
     // initialize the ciphertext based on the pointers' location
     const std::vector<uint8_t> c(
         aggregatedCiphertexts.begin() + ciphertextStart,
         aggregatedCiphertexts.begin() + ciphertextEnd);
-    heschme::Ciphertext aggregatedCiphertext =
-        heschme::Ciphertext::fromBytes(c);
+    auto aggregatedCiphertext = Scheme::fromBytes(c);
 
     // Decrypt ciphertext
-    uint64_t decrypted = sk.decrypt(aggregatedCiphertext);
+    uint64_t decrypted = scheme.decrypt(aggregatedCiphertext);
     decryptedArray.push_back(std::move(decrypted));
 
     // advance the ciphertext pointers
@@ -77,179 +130,284 @@ std::vector<uint64_t> decryptAggCiphertext(
   return decryptedArray;
 }
 
-std::unordered_map<uint64_t, heschme::Ciphertext> aggregateCiphertexts(
+// The distinct original ad ids of the touchpoints, sorted. The compressed ad
+// id of an ad id is its position in them, as in pcf2_aggregation.
+std::vector<uint64_t> getSortedAdIds(const AggregationInputMetrics& input) {
+  const auto& originalAdIds = input.getOriginalAdIds();
+  std::unordered_set<uint64_t> adIdSet(
+      originalAdIds.begin(), originalAdIds.end());
+  std::vector<uint64_t> adIds(adIdSet.begin(), adIdSet.end());
+  std::sort(adIds.begin(), adIds.end());
+  return adIds;
+}
+
+// Adds the ciphertexts of the rows from rowBegin up to rowEnd, which
+// ciphertextArray holds, to their ad id buckets. The rows are split across
+// the partial sums, which are each added to on their own thread.
+template <typename Scheme>
+void aggregateCiphertexts(
+    std::vector<CiphertextSums<Scheme>>& partialSums,
+    const std::unordered_map<uint64_t, size_t>& adIdToCompressedAdId,
     const std::vector<uint8_t>& ciphertextArray,
     const AggregationInputMetrics& input,
+    size_t rowBegin,
+    size_t rowEnd,
     int maxTouchpoints,
     int maxConversions,
-    int ciphertextSize) {
-  std::unordered_map<uint64_t, heschme::Ciphertext> adIdToAggregate;
-
-  auto& touchpointMetadataArrays = input.getTouchpointMetadata();
-  auto& secretShareAttributionArrays = input.getAttributionSecretShares();
-
-  int ciphertextStart = 0;
-  int ciphertextEnd = ciphertextStart + ciphertextSize;
-  for (int i = 0; i < touchpointMetadataArrays.size(); i++) {
-    // get publisher side secret share for the first attr r
-    auto& paddedSecretAttribution = secretShareAttributionArrays[0][i];
-    auto& touchpointMetadataArray = touchpointMetadataArrays[i];
-
-    for (int j = 0; j < touchpointMetadataArray.size(); j++) {
-      // Each touchpoint has is_attr for each conversion. Add all is_attr for
-      // the same touchpoint in plaintext
-      uint64_t pubAttrResult = 0;
-      for (int k = 0; k < maxConversions * maxTouchpoints;
-           k += maxTouchpoints) {
-        pubAttrResult += paddedSecretAttribution[k].isAttributed;
-      }
-
-      // initialize the ciphertext from received bytes
-      std::vector<uint8_t> c(
-          ciphertextArray.begin() + ciphertextStart,
-          ciphertextArray.begin() + ciphertextEnd);
-      heschme::Ciphertext partnerAttrValue = heschme::Ciphertext::fromBytes(c);
-
-      // combine publisher and partner conv values in HE
-      heschme::Ciphertext attrVal = heschme::Ciphertext::add_with_plaintext(
-          partnerAttrValue, pubAttrResult);
-
-      // find the adId to aggregate against
-      int adId = touchpointMetadataArray[j].originalAdId;
-
-      // add ciphertext to the adId bucket
-      if (adIdToAggregate.find(adId) != adIdToAggregate.end()) {
-        heschme::Ciphertext currentSum = adIdToAggregate[adId];
-        adIdToAggregate[adId] =
-            heschme::Ciphertext::add_with_ciphertext(currentSum, attrVal);
-      } else {
-        adIdToAggregate[adId] = attrVal;
+    size_t ciphertextSize) {
+  rowEnd = std::min(rowEnd, input.getNumRows());
+  const size_t numTouchpoints = input.getNumTouchpoints();
+
+  auto aggregateRows = [&](CiphertextSums<Scheme>& sums,
+                           size_t begin,
+                           size_t end) {
+    // the bytes of a ciphertext, reusing its allocation for every ciphertext
+    std::vector<uint8_t> c(ciphertextSize);
+    for (size_t i = begin; i < end; i++) {
+      // get publisher side secret share for the first attr r
+      const int64_t* paddedSecretAttribution = input.getIsAttributed(0, i);
+      const uint64_t* originalAdIds = input.getOriginalAdIds(i);
+
+      for (size_t j = 0; j < numTouchpoints; j++) {
+        // Each touchpoint has is_attr for each conversion. Add all is_attr
+        // for the same touchpoint in plaintext
+        uint64_t pubAttrResult = sumOverConversions(
+            paddedSecretAttribution,
+            static_cast<int>(j),
+            maxTouchpoints,
+            maxConversions);
+
+        // initialize the ciphertext from received bytes
+        auto ciphertextStart = ciphertextArray.begin() +
+            ((i - rowBegin) * maxTouchpoints + j) * ciphertextSize;
+        c.assign(ciphertextStart, ciphertextStart + ciphertextSize);
+        auto partnerAttrValue = Scheme::fromBytes(c);
+
+        // combine publisher and partner conv values in HE, and add the
+        // ciphertext to the bucket of its adId
+        sums.add(
+            adIdToCompressedAdId.at(originalAdIds[j]),
+            Scheme::addPlaintext(partnerAttrValue, pubAttrResult));
       }
-
-      // advance the ciphertext pointers
-      ciphertextStart += ciphertextSize;
-      ciphertextEnd += ciphertextSize;
     }
+  };
+
+  auto numRows = rowEnd > rowBegin ? rowEnd - rowBegin : 0;
+  std::vector<std::future<void>> futures;
+  for (size_t t = 0; t < partialSums.size(); t++) {
+    futures.push_back(std::async(
+        std::launch::async,
+        aggregateRows,
+        std::ref(partialSums.at(t)),
+        rowBegin + numRows * t / partialSums.size(),
+        rowBegin + numRows * (t + 1) / partialSums.size()));
+  }
+  for (auto& future : futures) {
+    future.get();
   }
-  return adIdToAggregate;
 }
 
 std::unordered_map<uint64_t, uint64_t> HEAggGame::computeAggregations(
     const int myRole,
     const AggregationInputMetrics& inputData) {
-  XLOG(INFO, "Running private aggregation");
+  switch (parseHEScheme(FLAGS_he_scheme)) {
+    case HESchemeType::ElGamal: {
+      ElGamalScheme scheme(
+          FLAGS_ciphertext_size, FLAGS_decryption_table_size);
+      return computeAggregations(myRole, inputData, scheme);
+    }
+  }
+  throw std::invalid_argument("Unknown HE scheme: " + FLAGS_he_scheme);
+}
+
+template <typename Scheme>
+std::unordered_map<uint64_t, uint64_t> HEAggGame::computeAggregations(
+    const int myRole,
+    const AggregationInputMetrics& inputData,
+    Scheme& scheme) {
+  XLOGF(INFO, "Running private aggregation with {}", Scheme::getName());
 
-  std::vector<int64_t> ids = inputData.getIds();
-  uint32_t numIds = ids.size();
+  uint32_t numIds = inputData.getNumRows();
   XLOGF(INFO, "Have {} ids", numIds);
 
-  const int ciphertextSize = FLAGS_ciphertext_size;
+  const size_t ciphertextSize = scheme.getCiphertextSize();
   const int maxTouchpoints = FLAGS_max_num_touchpoints;
   const int maxConversions = FLAGS_max_num_conversions;
+  // The rows whose ciphertexts are sent in a message. Both parties have to use
+  // the same chunk size.
+  const size_t chunkSize = std::max(FLAGS_chunk_size, 1);
+  const size_t numThreads = FLAGS_num_threads > 0
+      ? static_cast<size_t>(FLAGS_num_threads)
+      : std::max<size_t>(std::thread::hardware_concurrency(), 1);
 
   // final output is (breakdown_id, aggregate)
   std::unordered_map<uint64_t, uint64_t> out;
 
   if (myRole == common::PARTNER) {
-    // 0) Generate private key, public key and decryption table
-    auto sk = heschme::PrivateKey::generate();
-    auto pk = sk.toPublicKey();
-
-    heschme::initializeElGamalDecryptionTable(FLAGS_decryption_table_size);
-
-    // 1) Encrypt the attr values
-    XLOG(INFO, "Encrypting partner conv values...");
-    std::vector<uint8_t> ciphertextArray =
-        encryptAttrResult(pk, inputData, maxTouchpoints, maxConversions);
-    XLOGF(INFO, "Ciphertext array size  = {}", ciphertextArray.size());
-
-    // 2) Send the ciphertext
+    // 0) Generate the keys, and prepare the decryption, e.g. build the
+    // decryption table. That's only needed to decrypt the aggregates, so it's
+    // done in the background while the attr values are encrypted and
+    // aggregated.
+    scheme.generateKeys();
+
+    auto decryptionTable = std::async(
+        std::launch::async, [&scheme]() { scheme.prepareDecryption(); });
+
+    // 1) Encrypt the attr values, and 2) send the ciphertext. The next chunk
+    // is encrypted while the last one is sent, so only two chunks are held.
+    XLOG(INFO, "Encrypting and sending partner conv values...");
     auto communicationAgent = communicationAgentFactory_->create(
         common::PUBLISHER, "he_aggregator_partner");
-    communicationAgent->sendT(ciphertextArray);
+    const size_t numRows =
+        inputData.getNumAttributionArrays() * inputData.getNumRows();
+    auto encryptChunk = [&](size_t begin) {
+      return encryptAttrResult(
+          scheme,
+          inputData,
+          begin,
+          std::min(begin + chunkSize, numRows),
+          maxTouchpoints,
+          maxConversions,
+          numThreads);
+    };
+    std::future<std::vector<uint8_t>> nextChunk;
+    if (numRows > 0) {
+      nextChunk = std::async(std::launch::async, encryptChunk, 0);
+    }
+    size_t ciphertextArraySize = 0;
+    for (size_t begin = 0; begin < numRows; begin += chunkSize) {
+      auto ciphertextArray = nextChunk.get();
+      if (begin + chunkSize < numRows) {
+        nextChunk =
+            std::async(std::launch::async, encryptChunk, begin + chunkSize);
+      }
+      communicationAgent->sendT(ciphertextArray);
+      ciphertextArraySize += ciphertextArray.size();
+    }
+    XLOGF(INFO, "Ciphertext array size  = {}", ciphertextArraySize);
 
-    // 7) Receive number of groups and aggregated ciphertext
-    // Receive num of groups
+    // 7) Receive number of groups and aggregated ciphertext, which the
+    // publisher sends as one message starting with the number of groups
     XLOG(INFO, "Waiting to receive number of groups ... ");
-    int msgSize = 1;
     std::vector<uint8_t> receivedNumGroups =
-        communicationAgent->receive(msgSize);
+        communicationAgent->receive(sizeof(uint64_t));
 
-    if (receivedNumGroups.size() == 0) {
-      XLOG(ERR, "Received an empty array, cannot read number of groups");
+    if (receivedNumGroups.size() != sizeof(uint64_t)) {
+      XLOG(ERR, "Received a truncated array, cannot read number of groups");
       std::exit(1);
     };
-    int numGroups = receivedNumGroups[0];
+    uint64_t numGroups;
+    std::memcpy(&numGroups, receivedNumGroups.data(), sizeof(numGroups));
     XLOGF(INFO, "Received number of groups  = {}", numGroups);
 
     // Receive aggregated ciphertext
     XLOG(INFO, "Waiting to receive aggregated ciphertext ... ");
-    msgSize = numGroups * ciphertextSize;
     std::vector<uint8_t> aggregatedCiphertexts =
-        communicationAgent->receive(msgSize);
+        communicationAgent->receive(numGroups * ciphertextSize);
     XLOGF(INFO, "Received array size  = {}", aggregatedCiphertexts.size());
 
     // 8) Decrypt the aggregated ciphertext
+    decryptionTable.get();
     // Initialize a vector for decrypted plaintext
-    std::vector<uint64_t> decryptedArray = decryptAggCiphertext(
-        sk, aggregatedCiphertexts, numGroups, ciphertextSize);
+    std::vector<uint64_t> decryptedArray =
+        decryptAggCiphertext(scheme, aggregatedCiphertexts, numGroups);
 
     // 9) Send final decrypted result to publisher
     communicationAgent->sendT(decryptedArray);
 
   } else if (myRole == common::PUBLISHER) {
-    // 3) Receive ciphertext from partner
-    XLOG(INFO, "Starting to receive ciphertext...");
-    int msgSize = numIds * maxTouchpoints * ciphertextSize;
+    // 3) Receive ciphertext from partner, and 4) aggregate ciphertext based
+    // on ad id. The next chunk is received while the last one is aggregated,
+    // so only two chunks are held.
+    XLOG(INFO, "Receiving and aggregating conv values...");
     auto communicationAgent = communicationAgentFactory_->create(
         common::PARTNER, "he_aggregator_publisher");
-    std::vector<uint8_t> ciphertextArray = communicationAgent->receive(msgSize);
-    XLOGF(INFO, "Received array size  = {}", ciphertextArray.size());
-
-    // 4) Aggregate ciphertext based on ad id
-    XLOG(INFO, "Aggregating conv values...");
-    std::unordered_map<uint64_t, heschme::Ciphertext> adIdToAggregate =
-        aggregateCiphertexts(
-            ciphertextArray,
-            inputData,
-            maxTouchpoints,
-            maxConversions,
-            ciphertextSize);
+    auto receiveChunk = [&](size_t begin) {
+      return communicationAgent->receive(
+          (std::min<size_t>(begin + chunkSize, numIds) - begin) *
+          maxTouchpoints * ciphertextSize);
+    };
+    std::future<std::vector<uint8_t>> nextChunk;
+    if (numIds > 0) {
+      nextChunk = std::async(std::launch::async, receiveChunk, 0);
+    }
+    auto adIds = getSortedAdIds(inputData);
+    std::unordered_map<uint64_t, size_t> adIdToCompressedAdId;
+    for (size_t i = 0; i < adIds.size(); i++) {
+      adIdToCompressedAdId.emplace(adIds.at(i), i);
+    }
+    std::vector<CiphertextSums<Scheme>> partialSums(
+        numThreads, CiphertextSums<Scheme>(adIds.size()));
+    size_t ciphertextArraySize = 0;
+    for (size_t begin = 0; begin < numIds; begin += chunkSize) {
+      auto ciphertextArray = nextChunk.get();
+      if (begin + chunkSize < numIds) {
+        nextChunk =
+            std::async(std::launch::async, receiveChunk, begin + chunkSize);
+      }
+      aggregateCiphertexts(
+          partialSums,
+          adIdToCompressedAdId,
+          ciphertextArray,
+          inputData,
+          begin,
+          begin + chunkSize,
+          maxTouchpoints,
+          maxConversions,
+          ciphertextSize);
+      ciphertextArraySize += ciphertextArray.size();
+    }
+    XLOGF(INFO, "Received array size  = {}", ciphertextArraySize);
+
+    // merge the partial sums, in the order of the ad ids
+    auto& adIdToAggregate = partialSums.at(0);
+    for (size_t t = 1; t < partialSums.size(); t++) {
+      adIdToAggregate.merge(partialSums.at(t));
+    }
+    std::vector<std::pair<uint64_t, typename Scheme::Ciphertext>> aggregates;
+    for (size_t i = 0; i < adIds.size(); i++) {
+      if (adIdToAggregate.hasSum.at(i)) {
+        aggregates.emplace_back(adIds.at(i), adIdToAggregate.sums.at(i));
+      }
+    }
 
     // 5) Add noise to each ad_id bucket
-    // Initialize noise generator and to be less than the size of the decryption
-    // table
+    // Initialize noise generator and to be at most the largest plaintext the
+    // scheme decrypts, e.g. less than the size of the decryption table
     std::random_device rd;
     std::mt19937_64 e(rd());
     std::uniform_int_distribution<int> randomInt(
-        0, FLAGS_decryption_table_size - 1);
-    std::vector<int> noiseVector;
-    uint8_t numGroups = 0;
-    std::vector<uint8_t> aggregatedCiphertexts;
-    for (auto i = adIdToAggregate.begin(); i != adIdToAggregate.end(); i++) {
+        0, static_cast<int>(scheme.getMaxPlaintext()));
+    uint64_t numGroups = aggregates.size();
+    std::vector<int> noiseVector(numGroups);
+    for (auto& noise : noiseVector) {
+      noise = randomInt(e);
+    }
+
+    // The message to the partner is the number of groups followed by the
+    // aggregated ciphertext of each group
+    std::vector<uint8_t> aggregatedCiphertexts(
+        sizeof(numGroups) + numGroups * ciphertextSize);
+    std::memcpy(aggregatedCiphertexts.data(), &numGroups, sizeof(numGroups));
+    for (size_t i = 0; i < numGroups; i++) {
       // add noise
-      int noise = randomInt(e);
-      std::vector<uint8_t> c =
-          heschme::Ciphertext::add_with_plaintext((i->second), noise).toBytes();
-      aggregatedCiphertexts.insert(
-          aggregatedCiphertexts.end(), c.begin(), c.end());
-
-      // Keep track of the added noise
-      noiseVector.push_back(std::move(noise));
-      numGroups += 1;
+      std::vector<uint8_t> c = scheme.toBytes(Scheme::addPlaintext(
+          aggregates.at(i).second, noiseVector.at(i)));
+      std::copy(
+          c.begin(),
+          c.end(),
+          aggregatedCiphertexts.begin() + sizeof(numGroups) +
+              i * ciphertextSize);
     }
 
     // 6) Send the aggregated ciphertext to Partner
-    std::vector<uint8_t> numGroupsArr{numGroups};
-    communicationAgent->sendT(numGroupsArr);
     communicationAgent->sendT(aggregatedCiphertexts);
 
     // 10) Receive final result (Decrypted plaintext)
     XLOGF(INFO, "number of groups = {}", numGroups);
-    msgSize = numGroups;
 
     auto receivedPlainTextArray =
-        communicationAgent->receiveT<uint64_t>(msgSize);
+        communicationAgent->receiveT<uint64_t>(numGroups);
     XLOGF(
         INFO,
         "Received receivedPlainTextArray size  = {}",
@@ -257,7 +415,7 @@ std::unordered_map<uint64_t, uint64_t> HEAggGame::computeAggregations(
 
     // 11) Remove the noise and generate output
     // Sanity checks
-    if (noiseVector.size() != numGroups &&
+    if (noiseVector.size() != numGroups ||
         receivedPlainTextArray.size() != numGroups) {
       XLOG(
           ERR,
@@ -266,7 +424,7 @@ std::unordered_map<uint64_t, uint64_t> HEAggGame::computeAggregations(
     }
 
     int index = 0;
-    for (auto i = adIdToAggregate.begin(); i != adIdToAggregate.end(); i++) {
+    for (auto i = aggregates.begin(); i != aggregates.end(); i++) {
       // Join the adId with the plaintext and noise
       int plainTextAgg = receivedPlainTextArray[index];
       int addedNoise = noiseVector[index];
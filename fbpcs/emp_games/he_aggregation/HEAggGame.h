@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <cstddef>
+#include <vector>
+
 #include "folly/logging/xlog.h"
 
 #include "fbpcf/engine/communication/IPartyCommunicationAgent.h"
@@ -15,14 +18,45 @@
 #include "fbpcs/emp_games/common/Constants.h"
 #include "fbpcs/emp_games/common/Util.h"
 #include "fbpcs/emp_games/he_aggregation/AggregationInputMetrics.h"
+#include "fbpcs/emp_games/he_aggregation/HEScheme.h"
 #include "fbpcs/emp_games/pcf2_aggregation/ConversionMetadata.h"
 #include "fbpcs/emp_games/pcf2_aggregation/TouchpointMetadata.h"
 
-#include "privacy_infra/elgamal/ElGamal.h"
+namespace pcf2_he {
+
+/*
+ * Sums of ciphertexts indexed by the compressed ad id of their bucket. An ad
+ * id has no sum until a ciphertext is added to it.
+ */
+template <typename Scheme>
+struct CiphertextSums {
+  using Ciphertext = typename Scheme::Ciphertext;
 
-namespace heschme = facebook::privacy_infra::elgamal;
+  explicit CiphertextSums(size_t numAdIds)
+      : sums(numAdIds), hasSum(numAdIds, false) {}
 
-namespace pcf2_he {
+  void add(size_t compressedAdId, const Ciphertext& ciphertext) {
+    if (hasSum.at(compressedAdId)) {
+      sums.at(compressedAdId) =
+          Scheme::add(sums.at(compressedAdId), ciphertext);
+    } else {
+      sums.at(compressedAdId) = ciphertext;
+      hasSum.at(compressedAdId) = true;
+    }
+  }
+
+  // Adds the sums of other, which has as many ad ids
+  void merge(const CiphertextSums& other) {
+    for (size_t i = 0; i < other.sums.size(); i++) {
+      if (other.hasSum.at(i)) {
+        add(i, other.sums.at(i));
+      }
+    }
+  }
+
+  std::vector<Ciphertext> sums;
+  std::vector<bool> hasSum;
+};
 
 class HEAggGame {
  public:
@@ -37,6 +71,12 @@ class HEAggGame {
       const AggregationInputMetrics& inputData);
 
  private:
+  template <typename Scheme>
+  std::unordered_map<uint64_t, uint64_t> computeAggregations(
+      const int myRole,
+      const AggregationInputMetrics& inputData,
+      Scheme& scheme);
+
   std::shared_ptr<fbpcf::engine::communication::IPartyCommunicationAgentFactory>
       communicationAgentFactory_;
 };
@@ -63,6 +63,20 @@ DEFINE_int32(
 DEFINE_int32(max_num_touchpoints, 4, "Maximum touchpoints per user");
 DEFINE_int32(max_num_conversions, 4, "Maximum conversions per user");
 DEFINE_bool(use_new_output_format, false, "New Format of Attribution output");
+DEFINE_string(
+    he_scheme,
+    "elgamal",
+    "Additively homomorphic encryption scheme the partner's values are "
+    "encrypted and aggregated with, which has to be the same for both "
+    "parties. Only 'elgamal' for now");
 DEFINE_int32(ciphertext_size, 64, "Size of HE ciphertext");
 DEFINE_int32(plaintext_size, 8, "Size of plaintext");
 DEFINE_int32(decryption_table_size, 2000000, "Size of the Decryption Table");
+DEFINE_int32(
+    num_threads,
+    0,
+    "Number of threads encrypting the partner's values, 0 for one per core");
+DEFINE_int32(
+    chunk_size,
+    100000,
+    "Number of rows whose ciphertexts are encrypted, sent and aggregated at a time, which has to be the same for both parties");
@@ -30,6 +30,9 @@ DECLARE_int32(input_encryption);
 DECLARE_int32(max_num_touchpoints);
 DECLARE_int32(max_num_conversions);
 DECLARE_bool(use_new_output_format);
+DECLARE_string(he_scheme);
 DECLARE_int32(ciphertext_size);
 DECLARE_int32(plaintext_size);
 DECLARE_int32(decryption_table_size);
+DECLARE_int32(num_threads);
+DECLARE_int32(chunk_size);
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "privacy_infra/elgamal/ElGamal.h"
+
+namespace pcf2_he {
+
+/*
+ * The additively homomorphic encryption schemes HEAggGame can aggregate with,
+ * chosen with --he_scheme. Both parties have to use the same scheme.
+ *
+ * A scheme is a class like ElGamalScheme below, which the steps of HEAggGame
+ * are templated on. The partner constructs one, generates its keys and
+ * encrypts its values with it, and later decrypts the aggregates. The
+ * publisher only adds ciphertexts, to each other and to plaintexts, and so
+ * never holds a key, and the publisher's operations are static. The members a
+ * scheme has to have are
+ *   Ciphertext                the type the publisher adds up
+ *   getName()                 the value of --he_scheme which selects it
+ *   getCiphertextSize()       the bytes of a serialized ciphertext
+ *   getMaxPlaintext()         the largest sum that can be decrypted
+ *   generateKeys()            called by the partner before encrypting
+ *   prepareDecryption()       called by the partner before decrypting, on a
+ *                             thread of its own while it encrypts
+ *   encrypt(value)            the ciphertext of value
+ *   decrypt(ciphertext)       the value of a ciphertext
+ *   toBytes(ciphertext)       the getCiphertextSize() bytes of a ciphertext
+ *   static add(a, b)          the ciphertext of the sum of a and b
+ *   static addPlaintext(a, v) the ciphertext of the sum of a and v
+ *   static fromBytes(bytes)   the ciphertext toBytes returned the bytes of
+ *
+ * A ciphertext holds a single value, which the publisher adds to the sum of
+ * the ad id bucket of its conversion. This doesn't fit a packed scheme, whose
+ * ciphertexts hold values in many slots: encryption would have to fill the
+ * slots of a ciphertext with a batch of values, and since the values of one
+ * ciphertext go to different buckets, the publisher would have to mask or
+ * rotate slots into the bucket sums. Such a scheme needs the interface and the
+ * publisher's steps extended for it.
+ */
+enum class HESchemeType {
+  ElGamal,
+};
+
+inline HESchemeType parseHEScheme(const std::string& name) {
+  if (name == "elgamal") {
+    return HESchemeType::ElGamal;
+  }
+  throw std::invalid_argument("Unknown HE scheme: " + name);
+}
+
+/*
+ * Exponential ElGamal from privacy_infra, with one value per ciphertext.
+ * Sums are decrypted by looking them up in a table of decryptionTableSize
+ * entries, which bounds them.
+ */
+class ElGamalScheme {
+ public:
+  using Ciphertext = facebook::privacy_infra::elgamal::Ciphertext;
+  using PrivateKey = facebook::privacy_infra::elgamal::PrivateKey;
+  using PublicKey = decltype(std::declval<PrivateKey&>().toPublicKey());
+
+  ElGamalScheme(std::size_t ciphertextSize, std::size_t decryptionTableSize)
+      : ciphertextSize_{ciphertextSize},
+        decryptionTableSize_{decryptionTableSize} {}
+
+  static std::string getName() {
+    return "elgamal";
+  }
+
+  std::size_t getCiphertextSize() const {
+    return ciphertextSize_;
+  }
+
+  uint64_t getMaxPlaintext() const {
+    return decryptionTableSize_ - 1;
+  }
+
+  void generateKeys() {
+    privateKey_ = PrivateKey::generate();
+    publicKey_ = privateKey_->toPublicKey();
+  }
+
+  void prepareDecryption() const {
+    facebook::privacy_infra::elgamal::initializeElGamalDecryptionTable(
+        decryptionTableSize_);
+  }
+
+  Ciphertext encrypt(uint64_t value) const {
+    return publicKey_->encrypt(value);
+  }
+
+  uint64_t decrypt(const Ciphertext& ciphertext) const {
+    return privateKey_->decrypt(ciphertext);
+  }
+
+  static Ciphertext add(const Ciphertext& a, const Ciphertext& b) {
+    return Ciphertext::add_with_ciphertext(a, b);
+  }
+
+  static Ciphertext addPlaintext(const Ciphertext& a, uint64_t value) {
+    return Ciphertext::add_with_plaintext(a, value);
+  }
+
+  std::vector<uint8_t> toBytes(const Ciphertext& ciphertext) const {
+    auto bytes = ciphertext.toBytes();
+    if (bytes.size() != ciphertextSize_) {
+      throw std::runtime_error(
+          "Ciphertext of " + std::to_string(bytes.size()) +
+          " bytes instead of " + std::to_string(ciphertextSize_));
+    }
+    return bytes;
+  }
+
+  static Ciphertext fromBytes(const std::vector<uint8_t>& bytes) {
+    return Ciphertext::fromBytes(bytes);
+  }
+
+ private:
+  std::size_t ciphertextSize_;
+  std::size_t decryptionTableSize_;
+  std::optional<PrivateKey> privateKey_;
+  std::optional<PublicKey> publicKey_;
+};
+
+} // namespace pcf2_he
@@ -9,6 +9,7 @@
 #include <gtest/gtest.h>
 #include <filesystem>
 #include <future>
+#include <stdexcept>
 #include <string>
 
 #include "folly/Format.h"
@@ -28,6 +29,7 @@
 #include "fbpcs/emp_games/he_aggregation/HEAggApp.h"
 #include "fbpcs/emp_games/he_aggregation/HEAggGame.h"
 #include "fbpcs/emp_games/he_aggregation/HEAggOptions.h"
+#include "fbpcs/emp_games/he_aggregation/HEScheme.h"
 
 #include "privacy_infra/elgamal/ElGamal.h"
 
@@ -106,6 +108,84 @@ TEST(HEAggGameTest, HEPlaintextAdditionTest) {
   EXPECT_EQ(decrypted, x + y);
 }
 
+TEST(HEAggGameTest, CiphertextSumsTest) {
+  // Generate private key, public key and decryption table
+  auto sk = heschme::PrivateKey::generate();
+  auto pk = sk.toPublicKey();
+  heschme::initializeElGamalDecryptionTable(FLAGS_decryption_table_size);
+
+  // Sum ad id 0 in both partial sums, and ad id 2 only in the second one
+  CiphertextSums<ElGamalScheme> sums(3);
+  CiphertextSums<ElGamalScheme> otherSums(3);
+  sums.add(0, pk.encrypt(11));
+  sums.add(0, pk.encrypt(22));
+  otherSums.add(0, pk.encrypt(33));
+  otherSums.add(2, pk.encrypt(44));
+  sums.merge(otherSums);
+
+  EXPECT_EQ(std::vector<bool>({true, false, true}), sums.hasSum);
+  EXPECT_EQ(66, sk.decrypt(sums.sums.at(0)));
+  EXPECT_EQ(44, sk.decrypt(sums.sums.at(2)));
+}
+
+TEST(HEAggGameTest, ElGamalSchemeTest) {
+  ElGamalScheme scheme(FLAGS_ciphertext_size, FLAGS_decryption_table_size);
+  scheme.generateKeys();
+  scheme.prepareDecryption();
+  EXPECT_EQ(FLAGS_decryption_table_size - 1, scheme.getMaxPlaintext());
+
+  // Add through the bytes the publisher receives and sends
+  auto bytes = scheme.toBytes(scheme.encrypt(111));
+  EXPECT_EQ(FLAGS_ciphertext_size, bytes.size());
+  auto sum = ElGamalScheme::addPlaintext(
+      ElGamalScheme::add(
+          ElGamalScheme::fromBytes(bytes), scheme.encrypt(222)),
+      333);
+  EXPECT_EQ(666, scheme.decrypt(ElGamalScheme::fromBytes(scheme.toBytes(sum))));
+}
+
+TEST(HEAggGameTest, ParseHESchemeTest) {
+  EXPECT_EQ(HESchemeType::ElGamal, parseHEScheme("elgamal"));
+  EXPECT_THROW(parseHEScheme("unknown"), std::invalid_argument);
+}
+
+TEST(HEAggGameTest, AggregationInputMetricsColumnsTest) {
+  const std::string filePrefix =
+      private_measurement::test_util::getBaseDirFromPath(__FILE__) +
+      "test_correctness/dataset1/";
+  AggregationInputMetrics input{
+      common::InputEncryption::Plaintext,
+      filePrefix + "ss_partner_0.json",
+      filePrefix + "dataproc_partner_0.csv"};
+
+  ASSERT_EQ(5, input.getNumRows());
+  ASSERT_EQ(1, input.getNumAttributionArrays());
+  ASSERT_EQ(
+      FLAGS_max_num_touchpoints * FLAGS_max_num_conversions,
+      input.getNumAttributionSlots());
+  ASSERT_EQ(FLAGS_max_num_touchpoints, input.getNumTouchpoints());
+  EXPECT_EQ(
+      input.getNumRows() * input.getNumTouchpoints(),
+      input.getOriginalAdIds().size());
+
+  // The first row is attributed to its fourth touchpoint twice
+  const int64_t* isAttributed = input.getIsAttributed(0, 0);
+  EXPECT_EQ(
+      std::vector<int64_t>({0, 0, 0, 1, 0, 0, 0, 1}),
+      std::vector<int64_t>(isAttributed, isAttributed + 8));
+
+  // The same columns from nested rows
+  AggregationInputMetrics fromRows{
+      {0, 1},
+      {{{AttributionAdditiveSSResult{1}, AttributionAdditiveSSResult{2}},
+        {AttributionAdditiveSSResult{3}, AttributionAdditiveSSResult{4}}}},
+      {{pcf2_aggregation::TouchpointMetadata{7, 0, false, 0, 0}},
+       {pcf2_aggregation::TouchpointMetadata{8, 0, false, 0, 0}}}};
+  EXPECT_EQ(2, fromRows.getNumAttributionSlots());
+  EXPECT_EQ(3, fromRows.getIsAttributed(0, 1)[0]);
+  EXPECT_EQ(std::vector<uint64_t>({7, 8}), fromRows.getOriginalAdIds());
+}
+
 TEST(HEAggGameTest, HEAggGameCorrectnessTest) {
   const std::string baseDir_ =
       private_measurement::test_util::getBaseDirFromPath(__FILE__);
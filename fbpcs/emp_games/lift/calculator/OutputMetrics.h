@@ -9,6 +9,7 @@
 
 #include <cmath>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <emp-sh2pc/emp-sh2pc.h>
@@ -158,28 +159,49 @@ class OutputMetrics {
       const std::vector<std::vector<emp::Bit>>& eventArrays);
 
   /**
-   * Compute a private sum on a vector of bits, revealing to both parties at the
-   * end.
+   * Call f(bitmask, groupMetrics) for every publisher breakdown, then for
+   * every partner cohort.
    */
-  int64_t sum(const std::vector<emp::Bit>& in) const;
+  template <typename F>
+  void forEachGroup(F f);
 
   /**
-   * Compute a private sum on a vector of integers, revealing to both parties at
-   * the end.
+   * Count the bits of in (those of the rows whose bit in mask is set, if a
+   * mask is given) without revealing the count. The count is accumulated on
+   * as few bits as it needs by a tree of full adders, then widened to
+   * INT_SIZE bits.
    */
-  int64_t sum(const std::vector<emp::Integer>& in) const;
+  emp::Integer secretCount(
+      const std::vector<emp::Bit>& in,
+      const std::vector<emp::Bit>* mask = nullptr) const;
+
+  emp::Integer secretCount(
+      const std::vector<std::vector<emp::Bit>>& in,
+      const std::vector<emp::Bit>* mask = nullptr) const;
+
+  /**
+   * Sum the integers of in (those of the rows whose bit in mask is set, if a
+   * mask is given) without revealing the sum.
+   */
+  emp::Integer secretSum(
+      const std::vector<emp::Integer>& in,
+      const std::vector<emp::Bit>* mask = nullptr) const;
+
+  emp::Integer secretSum(
+      const std::vector<std::vector<emp::Integer>>& in,
+      const std::vector<emp::Bit>* mask = nullptr) const;
 
   /**
-   * Compute a private sum on a vector of vectors of bits, revealing to both
-   * parties at the end.
+   * Reveal value into out with the other deferred sums, in
+   * revealDeferredSums. out must stay valid until then.
    */
-  int64_t sum(const std::vector<std::vector<emp::Bit>>& in) const;
+  void deferReveal(const emp::Integer& value, int64_t& out);
 
   /**
-   * Compute a private sum on a vector of vectors of integers, revealing to both
-   * parties at the end.
+   * Reveal every deferred sum in a single batch per bit length, rather than
+   * in a round trip per metric of every group.
    */
-  int64_t sum(const std::vector<std::vector<emp::Integer>>& in) const;
+  void revealDeferredSums();
 
   const InputData& inputData_;
   int64_t n_;
@@ -197,6 +219,7 @@ class OutputMetrics {
   std::unordered_map<int64_t, std::vector<emp::Bit>> partnerBitmasks_;
   std::unordered_map<int64_t, OutputMetricsData> cohortMetrics_;
   std::unordered_map<int64_t, OutputMetricsData> publisherBreakdowns_;
+  std::vector<std::pair<emp::Integer, int64_t*>> deferredSums_;
 
   template <class T>
   T reveal(const emp::Integer& empInteger) const;
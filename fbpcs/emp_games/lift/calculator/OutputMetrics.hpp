@@ -5,6 +5,7 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <stdexcept>
 #include <tuple>
 #include <unordered_map>
 
@@ -304,6 +305,7 @@ void OutputMetrics<MY_ROLE>::calculateAll() {
       purchaseValueArrays,
       purchaseValueSquaredArrays,
       validPurchaseArrays);
+  revealDeferredSums();
 }
 
 template <int32_t MY_ROLE>
@@ -456,91 +458,39 @@ std::vector<std::vector<emp::Bit>> OutputMetrics<MY_ROLE>::calculateEvents(
             return std::make_tuple(vec, anyValidPurchase, numConvSquared);
           });
 
-  if (groupType == GroupType::TEST) {
-    metrics_.testEvents = sum(eventArrays);
-    metrics_.testConverters = sum(converterArrays);
-    metrics_.testNumConvSquared = sum(squaredNumConvs);
+  // And compute for breakdowns + cohorts. Their sums are all revealed at the
+  // end of calculateAll.
+  auto isTest = groupType == GroupType::TEST;
+  // Structured bindings can't be captured by every compiler, hence the
+  // init-captures
+  auto deferEventSums = [&,
+                         &events = eventArrays,
+                         &converters = converterArrays,
+                         &numConvsSquared = squaredNumConvs](
+                            const std::vector<emp::Bit>* mask,
+                            OutputMetricsData& out) {
+    deferReveal(
+        secretCount(events, mask),
+        isTest ? out.testEvents : out.controlEvents);
+    deferReveal(
+        secretCount(converters, mask),
+        isTest ? out.testConverters : out.controlConverters);
+    deferReveal(
+        secretSum(numConvsSquared, mask),
+        isTest ? out.testNumConvSquared : out.controlNumConvSquared);
     // TODO: Computational shortcut possible by recognizing that bin 0
     // is equivalent to population - sum(convs in other bins).
     // We can avoid a relatively expensive bit sum.
+    auto& histogram = isTest ? out.testConvHistogram : out.controlConvHistogram;
+    histogram.assign(convHistograms.size(), 0);
     for (size_t bin = 0; bin < convHistograms.size(); ++bin) {
-      metrics_.testConvHistogram.push_back(sum(convHistograms.at(bin)));
-    }
-  } else {
-    metrics_.controlEvents = sum(eventArrays);
-    metrics_.controlConverters = sum(converterArrays);
-    metrics_.controlNumConvSquared = sum(squaredNumConvs);
-    for (size_t bin = 0; bin < convHistograms.size(); ++bin) {
-      metrics_.controlConvHistogram.push_back(sum(convHistograms.at(bin)));
-    }
-  }
-
-  // And compute for breakdowns + cohorts
-  // TODO: These could be abstracted into a common function
-  for (size_t i = 0; i < numPublisherBreakdowns_; ++i) {
-    const auto& mask = publisherBitmasks_.at(i);
-    auto groupEventBits =
-        private_measurement::secret_sharing::multiplyBitmask(eventArrays, mask);
-    auto groupConverterBits =
-        private_measurement::secret_sharing::multiplyBitmask(
-            converterArrays, mask);
-    auto groupEvents = sum(groupEventBits);
-    auto groupConverters = sum(groupConverterBits);
-    auto groupInts = private_measurement::secret_sharing::multiplyBitmask(
-        squaredNumConvs, mask);
-
-    std::vector<int64_t> groupConvHistogram;
-    for (size_t bin = 0; bin < convHistograms.size(); ++bin) {
-      auto binBits = private_measurement::secret_sharing::multiplyBitmask(
-          convHistograms.at(bin), mask);
-      groupConvHistogram.push_back(sum(binBits));
-    }
-
-    if (groupType == GroupType::TEST) {
-      publisherBreakdowns_[i].testEvents = groupEvents;
-      publisherBreakdowns_[i].testConverters = groupConverters;
-      publisherBreakdowns_[i].testNumConvSquared = sum(groupInts);
-      publisherBreakdowns_[i].testConvHistogram = std::move(groupConvHistogram);
-    } else {
-      publisherBreakdowns_[i].controlEvents = groupEvents;
-      publisherBreakdowns_[i].controlConverters = groupConverters;
-      publisherBreakdowns_[i].controlNumConvSquared = sum(groupInts);
-      publisherBreakdowns_[i].controlConvHistogram =
-          std::move(groupConvHistogram);
+      deferReveal(secretCount(convHistograms.at(bin), mask), histogram.at(bin));
     }
-  }
-
-  for (size_t i = 0; i < static_cast<std::size_t>(numPartnerCohorts_); ++i) {
-    const auto& mask = partnerBitmasks_.at(i);
-    auto groupEventBits =
-        private_measurement::secret_sharing::multiplyBitmask(eventArrays, mask);
-    auto groupConverterBits =
-        private_measurement::secret_sharing::multiplyBitmask(
-            converterArrays, mask);
-    auto groupEvents = sum(groupEventBits);
-    auto groupConverters = sum(groupConverterBits);
-    auto groupInts = private_measurement::secret_sharing::multiplyBitmask(
-        squaredNumConvs, mask);
-
-    std::vector<int64_t> groupConvHistogram;
-    for (size_t bin = 0; bin < convHistograms.size(); ++bin) {
-      auto binBits = private_measurement::secret_sharing::multiplyBitmask(
-          convHistograms.at(bin), mask);
-      groupConvHistogram.push_back(sum(binBits));
-    }
-
-    if (groupType == GroupType::TEST) {
-      cohortMetrics_[i].testEvents = groupEvents;
-      cohortMetrics_[i].testConverters = groupConverters;
-      cohortMetrics_[i].testNumConvSquared = sum(groupInts);
-      cohortMetrics_[i].testConvHistogram = std::move(groupConvHistogram);
-    } else {
-      cohortMetrics_[i].controlEvents = groupEvents;
-      cohortMetrics_[i].controlConverters = groupConverters;
-      cohortMetrics_[i].controlNumConvSquared = sum(groupInts);
-      cohortMetrics_[i].controlConvHistogram = std::move(groupConvHistogram);
-    }
-  }
+  };
+  deferEventSums(nullptr, metrics_);
+  forEachGroup([&](const std::vector<emp::Bit>& mask, OutputMetricsData& out) {
+    deferEventSums(&mask, out);
+  });
   return eventArrays;
 }
 
@@ -588,33 +538,16 @@ void OutputMetrics<MY_ROLE>::calculateMatchCount(
       opportunityTimestamps.begin(),
       purchaseTimestampArrays.begin());
 
-  if (groupType == GroupType::TEST) {
-    metrics_.testMatchCount = sum(matchArrays);
-  } else {
-    metrics_.controlMatchCount = sum(matchArrays);
-  }
-
   // And compute for breakdowns + cohorts
-  // TODO: These could be abstracted into a common function
-  for (size_t i = 0; i < numPublisherBreakdowns_; ++i) {
-    auto groupBits = private_measurement::secret_sharing::multiplyBitmask(
-        matchArrays, publisherBitmasks_.at(i));
-    if (groupType == GroupType::TEST) {
-      publisherBreakdowns_[i].testMatchCount = sum(groupBits);
-    } else {
-      publisherBreakdowns_[i].controlMatchCount = sum(groupBits);
-    }
-  }
-
-  for (size_t i = 0; i < static_cast<std::size_t>(numPartnerCohorts_); ++i) {
-    auto groupBits = private_measurement::secret_sharing::multiplyBitmask(
-        matchArrays, partnerBitmasks_.at(i));
-    if (groupType == GroupType::TEST) {
-      cohortMetrics_[i].testMatchCount = sum(groupBits);
-    } else {
-      cohortMetrics_[i].controlMatchCount = sum(groupBits);
-    }
-  }
+  auto isTest = groupType == GroupType::TEST;
+  deferReveal(
+      secretCount(matchArrays),
+      isTest ? metrics_.testMatchCount : metrics_.controlMatchCount);
+  forEachGroup([&](const std::vector<emp::Bit>& mask, OutputMetricsData& out) {
+    deferReveal(
+        secretCount(matchArrays, &mask),
+        isTest ? out.testMatchCount : out.controlMatchCount);
+  });
 }
 
 template <int32_t MY_ROLE>
@@ -628,6 +561,7 @@ std::vector<emp::Bit> OutputMetrics<MY_ROLE>::calculateImpressions(
       privatelyShareIntsFromPublisher<MY_ROLE>(
           inputData_.getNumImpressions(), n_, FULL_BITS);
 
+  // Only reach is used, by the reached metrics. Impressions aren't reported.
   auto [impressionsArray, reachArray] = private_measurement::secret_sharing::
       zip_and_map<emp::Bit, emp::Integer, emp::Integer, emp::Bit>(
           populationBits,
@@ -641,22 +575,6 @@ std::vector<emp::Bit> OutputMetrics<MY_ROLE>::calculateImpressions(
                 isUser & (numImpressions > zero));
           });
 
-  // And compute for breakdowns + cohorts
-  // TODO: These could be abstracted into a common function
-  for (size_t i = 0; i < numPublisherBreakdowns_; ++i) {
-    auto groupInts = private_measurement::secret_sharing::multiplyBitmask(
-        impressionsArray, publisherBitmasks_.at(i));
-    auto groupBits = private_measurement::secret_sharing::multiplyBitmask(
-        reachArray, publisherBitmasks_.at(i));
-  }
-
-  for (size_t i = 0; i < static_cast<std::size_t>(numPartnerCohorts_); ++i) {
-    auto groupInts = private_measurement::secret_sharing::multiplyBitmask(
-        impressionsArray, partnerBitmasks_.at(i));
-    auto groupBits = private_measurement::secret_sharing::multiplyBitmask(
-        reachArray, partnerBitmasks_.at(i));
-  }
-
   return reachArray;
 }
 
@@ -686,36 +604,11 @@ void OutputMetrics<MY_ROLE>::calculateReachedConversions(
           validPurchaseArrays.end(),
           reachedArray.begin());
 
-  if (groupType == GroupType::TEST) {
-    metrics_.reachedConversions = sum(reachedConversions);
-  } else {
-    XLOG(FATAL)
-        << "Calculation of reached conversions for control group not supported";
-  }
-
   // And compute for breakdowns + cohorts
-  // TODO: These could be abstracted into a common function
-  for (size_t i = 0; i < numPublisherBreakdowns_; ++i) {
-    auto groupInts = private_measurement::secret_sharing::multiplyBitmask(
-        reachedConversions, publisherBitmasks_.at(i));
-    if (groupType == GroupType::TEST) {
-      publisherBreakdowns_[i].reachedConversions = sum(groupInts);
-    } else {
-      XLOG(FATAL) << "Calculation of reached conversions for control group not "
-                     "supported";
-    }
-  }
-
-  for (size_t i = 0; i < static_cast<std::size_t>(numPartnerCohorts_); ++i) {
-    auto groupInts = private_measurement::secret_sharing::multiplyBitmask(
-        reachedConversions, partnerBitmasks_.at(i));
-    if (groupType == GroupType::TEST) {
-      cohortMetrics_[i].reachedConversions = sum(groupInts);
-    } else {
-      XLOG(FATAL) << "Calculation of reached conversions for control group not "
-                     "supported";
-    }
-  }
+  deferReveal(secretCount(reachedConversions), metrics_.reachedConversions);
+  forEachGroup([&](const std::vector<emp::Bit>& mask, OutputMetricsData& out) {
+    deferReveal(secretCount(reachedConversions, &mask), out.reachedConversions);
+  });
 }
 
 template <int32_t MY_ROLE>
@@ -749,8 +642,9 @@ void OutputMetrics<MY_ROLE>::calculateValue(
           eventArrays.end(),
           purchaseValueArrays.begin());
 
+  auto isTest = groupType == GroupType::TEST;
   std::vector<std::vector<emp::Integer>> reachedValue;
-  if (groupType == GroupType::TEST) {
+  if (isTest) {
     reachedValue = private_measurement::functional::zip_apply(
         [](std::vector<emp::Integer> validValues,
            emp::Bit reached) -> std::vector<emp::Integer> {
@@ -765,42 +659,22 @@ void OutputMetrics<MY_ROLE>::calculateValue(
         valueArrays.begin(),
         valueArrays.end(),
         reachedArray.begin());
-
-    metrics_.testValue = sum(valueArrays);
-    metrics_.reachedValue = sum(reachedValue);
-  } else {
-    metrics_.controlValue = sum(valueArrays);
   }
 
   // And compute for breakdowns + cohorts
-  // TODO: These could be abstracted into a common function
-  for (size_t i = 0; i < numPublisherBreakdowns_; ++i) {
-    auto groupInts = private_measurement::secret_sharing::multiplyBitmask(
-        valueArrays, publisherBitmasks_.at(i));
-    if (groupType == GroupType::TEST) {
-      publisherBreakdowns_[i].testValue = sum(groupInts);
-      auto reachedGroupInts =
-          private_measurement::secret_sharing::multiplyBitmask(
-              reachedValue, publisherBitmasks_.at(i));
-      publisherBreakdowns_[i].reachedValue = sum(reachedGroupInts);
+  auto deferValueSums = [&](const std::vector<emp::Bit>* mask,
+                            OutputMetricsData& out) {
+    if (isTest) {
+      deferReveal(secretSum(valueArrays, mask), out.testValue);
+      deferReveal(secretSum(reachedValue, mask), out.reachedValue);
     } else {
-      publisherBreakdowns_[i].controlValue = sum(groupInts);
+      deferReveal(secretSum(valueArrays, mask), out.controlValue);
     }
-  }
-
-  for (size_t i = 0; i < static_cast<std::size_t>(numPartnerCohorts_); ++i) {
-    auto groupInts = private_measurement::secret_sharing::multiplyBitmask(
-        valueArrays, partnerBitmasks_.at(i));
-    if (groupType == GroupType::TEST) {
-      cohortMetrics_[i].testValue = sum(groupInts);
-      auto reachedGroupInts =
-          private_measurement::secret_sharing::multiplyBitmask(
-              reachedValue, partnerBitmasks_.at(i));
-      cohortMetrics_[i].reachedValue = sum(reachedGroupInts);
-    } else {
-      cohortMetrics_[i].controlValue = sum(groupInts);
-    }
-  }
+  };
+  deferValueSums(nullptr, metrics_);
+  forEachGroup([&](const std::vector<emp::Bit>& mask, OutputMetricsData& out) {
+    deferValueSums(&mask, out);
+  });
 }
 
 template <int32_t MY_ROLE>
@@ -836,72 +710,124 @@ void OutputMetrics<MY_ROLE>::calculateValueSquared(
       eventArrays.end(),
       purchaseValueSquaredArrays.begin());
 
-  if (groupType == GroupType::TEST) {
-    metrics_.testValueSquared = sum(squaredValues);
-  } else {
-    metrics_.controlValueSquared = sum(squaredValues);
-  }
-
   // And compute for breakdowns + cohorts
-  // TODO: These could be abstracted into a common function
+  auto isTest = groupType == GroupType::TEST;
+  deferReveal(
+      secretSum(squaredValues),
+      isTest ? metrics_.testValueSquared : metrics_.controlValueSquared);
+  forEachGroup([&](const std::vector<emp::Bit>& mask, OutputMetricsData& out) {
+    deferReveal(
+        secretSum(squaredValues, &mask),
+        isTest ? out.testValueSquared : out.controlValueSquared);
+  });
+}
+
+template <int32_t MY_ROLE>
+template <typename F>
+void OutputMetrics<MY_ROLE>::forEachGroup(F f) {
   for (size_t i = 0; i < numPublisherBreakdowns_; ++i) {
-    const auto& mask = publisherBitmasks_.at(i);
-    auto groupInts = private_measurement::secret_sharing::multiplyBitmask(
-        squaredValues, mask);
-    if (groupType == GroupType::TEST) {
-      publisherBreakdowns_[i].testValueSquared = sum(groupInts);
-    } else {
-      publisherBreakdowns_[i].controlValueSquared = sum(groupInts);
-    }
+    f(publisherBitmasks_.at(i), publisherBreakdowns_[i]);
   }
   for (size_t i = 0; i < static_cast<std::size_t>(numPartnerCohorts_); ++i) {
-    const auto& mask = partnerBitmasks_.at(i);
-    auto groupInts = private_measurement::secret_sharing::multiplyBitmask(
-        squaredValues, mask);
-    if (groupType == GroupType::TEST) {
-      cohortMetrics_[i].testValueSquared = sum(groupInts);
-    } else {
-      cohortMetrics_[i].controlValueSquared = sum(groupInts);
-    }
+    f(partnerBitmasks_.at(i), cohortMetrics_[i]);
   }
 }
 
 template <int32_t MY_ROLE>
-int64_t OutputMetrics<MY_ROLE>::sum(const std::vector<emp::Integer>& in) const {
-  return shouldUseXorEncryption()
-      ? private_measurement::emp_utils::sum<emp::XOR>(in)
-      : private_measurement::emp_utils::sum<emp::PUBLIC>(in);
+emp::Integer OutputMetrics<MY_ROLE>::secretCount(
+    const std::vector<emp::Bit>& in,
+    const std::vector<emp::Bit>* mask) const {
+  if (mask == nullptr) {
+    return private_measurement::emp_utils::secretSum(in);
+  }
+  std::vector<emp::Bit> masked;
+  masked.reserve(in.size());
+  for (size_t i = 0; i < in.size(); ++i) {
+    masked.push_back(in.at(i) & mask->at(i));
+  }
+  return private_measurement::emp_utils::secretSum(masked);
 }
 
 template <int32_t MY_ROLE>
-int64_t OutputMetrics<MY_ROLE>::sum(const std::vector<emp::Bit>& in) const {
-  return sum(private_measurement::emp_utils::bitsToInts(in));
+emp::Integer OutputMetrics<MY_ROLE>::secretCount(
+    const std::vector<std::vector<emp::Bit>>& in,
+    const std::vector<emp::Bit>* mask) const {
+  std::vector<emp::Bit> bits;
+  for (size_t i = 0; i < in.size(); ++i) {
+    for (const auto& bit : in.at(i)) {
+      bits.push_back(mask ? bit & mask->at(i) : bit);
+    }
+  }
+  return private_measurement::emp_utils::secretSum(bits);
 }
 
 template <int32_t MY_ROLE>
-int64_t OutputMetrics<MY_ROLE>::sum(
-    const std::vector<std::vector<emp::Bit>>& in) const {
-  // flatten the 2D vector into 1D
-  // TODO: this can be optimizing by specializing this use case so we don't have
-  // to make a copy of the data
-  std::vector<emp::Bit> accum;
-  for (auto& sub : in) {
-    accum.insert(std::end(accum), std::begin(sub), std::end(sub));
-  }
-  return sum(accum);
+emp::Integer OutputMetrics<MY_ROLE>::secretSum(
+    const std::vector<emp::Integer>& in,
+    const std::vector<emp::Bit>* mask) const {
+  if (mask == nullptr) {
+    return private_measurement::emp_utils::secretSum(in);
+  }
+  return private_measurement::emp_utils::secretSum(
+      private_measurement::secret_sharing::multiplyBitmask(in, *mask));
 }
 
 template <int32_t MY_ROLE>
-int64_t OutputMetrics<MY_ROLE>::sum(
-    const std::vector<std::vector<emp::Integer>>& in) const {
+emp::Integer OutputMetrics<MY_ROLE>::secretSum(
+    const std::vector<std::vector<emp::Integer>>& in,
+    const std::vector<emp::Bit>* mask) const {
   // flatten the 2D vector into 1D
-  // TODO: this can be optimizing by specializing this use case so we don't have
-  // to make a copy of the data
   std::vector<emp::Integer> accum;
-  for (auto& sub : in) {
-    accum.insert(std::end(accum), std::begin(sub), std::end(sub));
+  if (mask == nullptr) {
+    for (const auto& sub : in) {
+      accum.insert(std::end(accum), std::begin(sub), std::end(sub));
+    }
+  } else {
+    for (auto& sub :
+         private_measurement::secret_sharing::multiplyBitmask(in, *mask)) {
+      accum.insert(std::end(accum), std::begin(sub), std::end(sub));
+    }
+  }
+  return private_measurement::emp_utils::secretSum(accum);
+}
+
+template <int32_t MY_ROLE>
+void OutputMetrics<MY_ROLE>::deferReveal(
+    const emp::Integer& value,
+    int64_t& out) {
+  if (value.size() != QUICK_BITS && value.size() != FULL_BITS) {
+    throw std::runtime_error(
+        "Only 32 and 64 bit sums can be revealed");
+  }
+  deferredSums_.emplace_back(value, &out);
+}
+
+template <int32_t MY_ROLE>
+void OutputMetrics<MY_ROLE>::revealDeferredSums() {
+  XLOG(INFO) << "Reveal " << deferredSums_.size() << " sums";
+  const auto party = shouldUseXorEncryption() ? emp::XOR : emp::PUBLIC;
+  for (auto bitLen : {QUICK_BITS, FULL_BITS}) {
+    std::vector<emp::block> labels;
+    std::vector<int64_t*> outs;
+    for (const auto& [value, out] : deferredSums_) {
+      if (value.size() == bitLen) {
+        for (const auto& bit : value.bits) {
+          labels.push_back(bit.bit);
+        }
+        outs.push_back(out);
+      }
+    }
+
+    auto values = private_measurement::secret_sharing::revealIntsFromLabels(
+        labels, bitLen, party);
+    for (size_t i = 0; i < outs.size(); ++i) {
+      // 32 bit sums are signed, as emp::Integer::reveal<int32_t> reveals them
+      *outs.at(i) = bitLen == QUICK_BITS
+          ? static_cast<int32_t>(static_cast<uint32_t>(values.at(i)))
+          : values.at(i);
+    }
   }
-  return sum(accum);
+  deferredSums_.clear();
 }
 
 } // namespace private_lift
@@ -11,6 +11,7 @@
 #include "folly/Format.h"
 
 #include "fbpcf/engine/communication/SocketPartyCommunicationAgentFactory.h"
+#include "fbpcs/emp_games/common/SchedulerSlots.h"
 #include "fbpcs/emp_games/lift/metadata_compaction/MetadataCompactorApp.h"
 #include "fbpcs/emp_games/lift/metadata_compaction/MetadataCompactorGame.h"
 #include "fbpcs/emp_games/lift/metadata_compaction/MetadataCompactorGameFactory.h"
@@ -52,14 +53,13 @@ inline LiftMetadataCompactionFilePaths getIOFilepaths(
   }
 }
 
-template <int PARTY, int index>
+template <int PARTY>
 inline common::SchedulerStatistics
 startMetadataCompactionAppForShardedFileHelper(
     const std::vector<std::string>& inputFilePaths,
     const std::vector<std::string>& outputGlobalParamsPaths,
     const std::vector<std::string>& outputSecretSharesPaths,
-    int startFileIndex,
-    int remainingThreads,
+    std::shared_ptr<common::ShardQueue> shardQueue,
     int numThreads,
     std::string serverIp,
     int port,
@@ -67,87 +67,81 @@ startMetadataCompactionAppForShardedFileHelper(
     bool computePublisherBreakdowns,
     int epoch,
     bool useXorEncryption,
+    bool useBinarySecretShares,
+    int numParseThreads,
+    bool useShardCache,
     fbpcf::engine::communication::SocketPartyCommunicationAgent::TlsInfo&
         tlsInfo) {
-  // aggregate scheduler statistics across apps
-  common::SchedulerStatistics schedulerStatistics{
-      0, 0, 0, 0, folly::dynamic::object()};
-
-  // split files evenly across threads
-  auto remainingFiles = inputFilePaths.size() - startFileIndex;
-  if (remainingFiles > 0) {
-    auto numFiles = (remainingThreads > remainingFiles)
-        ? 1
-        : (remainingFiles / remainingThreads);
-
+  // Each MetadataCompactorApp runs the files it takes from shardQueue
+  // sequentially on a single thread, taking the next one when it finishes
+  // one, so that the apps which drew small files carry on with the rest.
+  // Publisher uses even schedulerId and partner uses odd schedulerId
+  common::SchedulerSlots<
+      kMaxConcurrency,
+      std::shared_ptr<fbpcf::engine::communication::
+                          SocketPartyCommunicationAgentFactory>>
+      slots([&](auto slot) {
+        constexpr int schedulerId = 2 * decltype(slot)::value + PARTY;
+        return [&](std::shared_ptr<fbpcf::engine::communication::
+                                       SocketPartyCommunicationAgentFactory>
+                       communicationAgentFactory) {
+          auto compactorGameFactory =
+              std::make_unique<MetadataCompactorGameFactory<schedulerId>>(
+                  communicationAgentFactory);
+
+          auto app = std::make_unique<MetadataCompactorApp<schedulerId>>(
+              PARTY,
+              std::move(communicationAgentFactory),
+              std::move(compactorGameFactory),
+              numConversionsPerUser,
+              computePublisherBreakdowns,
+              epoch,
+              inputFilePaths,
+              outputGlobalParamsPaths,
+              outputSecretSharesPaths,
+              0 /* startFileIndex */,
+              0 /* numFiles */,
+              useXorEncryption,
+              useBinarySecretShares,
+              numParseThreads,
+              useShardCache,
+              shardQueue);
+          app->run();
+          return app->getSchedulerStatistics();
+        };
+      });
+
+  return common::runAppsInSlots(numThreads, [&](std::size_t slot) {
     std::map<
         int,
         fbpcf::engine::communication::SocketPartyCommunicationAgentFactory::
             PartyInfo>
         partyInfos(
-            {{0, {serverIp, port + index * 100}},
-             {1, {serverIp, port + index * 100}}});
+            {{0, {serverIp, port + static_cast<int>(slot) * 100}},
+             {1, {serverIp, port + static_cast<int>(slot) * 100}}});
 
     /** It is safe to use a shared pointer to the same factory rather than a
      * whole new factory as the usage order is consistent across parties
      * 1. App will create scheduler -> creates first communicationAgent
      * 2. App will create CompactorGame -> creates DataProcessor -> creates
      * second communicationAgent
+     * 3. App will take files from the shard queue -> creates third
+     * communicationAgent
+     * 4. App will create the shard cache, if used -> creates fourth
+     * communicationAgent
      */
     auto communicationAgentFactory = std::make_shared<
         fbpcf::engine::communication::SocketPartyCommunicationAgentFactory>(
         PARTY, partyInfos, tlsInfo, "metadata_compaction_traffic");
 
-    auto compactorGameFactory =
-        std::make_unique<MetadataCompactorGameFactory<2 * index + PARTY>>(
-            communicationAgentFactory);
-
-    auto app = std::make_unique<MetadataCompactorApp<2 * index + PARTY>>(
-        PARTY,
-        std::move(communicationAgentFactory),
-        std::move(compactorGameFactory),
-        numConversionsPerUser,
-        computePublisherBreakdowns,
-        epoch,
-        inputFilePaths,
-        outputGlobalParamsPaths,
-        outputSecretSharesPaths,
-        startFileIndex,
-        numFiles,
-        useXorEncryption);
-
-    auto future = std::async([&app]() {
-      app->run();
-      return app->getSchedulerStatistics();
-    });
-
-    // We construct a MetadataCompactorApp for each thread recursively because
-    // each app has a different schedulerId, which is a template parameter
-    if constexpr (index < kMaxConcurrency) {
-      if (remainingThreads > 1) {
-        auto remainingStats =
-            startMetadataCompactionAppForShardedFileHelper<PARTY, index + 1>(
-                inputFilePaths,
-                outputGlobalParamsPaths,
-                outputSecretSharesPaths,
-                startFileIndex + numFiles,
-                remainingThreads - 1,
-                numThreads,
-                serverIp,
-                port,
-                numConversionsPerUser,
-                computePublisherBreakdowns,
-                epoch,
-                useXorEncryption,
-                tlsInfo);
-        schedulerStatistics.add(remainingStats);
-      }
-    }
-
-    auto stats = future.get();
-    schedulerStatistics.add(stats);
-  }
-  return schedulerStatistics;
+    return std::async(
+        std::launch::async,
+        [&slots,
+         slot,
+         communicationAgentFactory = std::move(communicationAgentFactory)]() {
+          return slots.run(slot, communicationAgentFactory);
+        });
+  });
 }
 
 template <int PARTY>
@@ -162,16 +156,20 @@ inline common::SchedulerStatistics startMetadataCompactionApp(
     bool computePublisherBreakdowns,
     int epoch,
     bool useXorEncryption,
+    bool useBinarySecretShares,
+    int numParseThreads,
     fbpcf::engine::communication::SocketPartyCommunicationAgent::TlsInfo&
-        tlsInfo) {
+        tlsInfo,
+    bool useShardCache = false,
+    const std::string& shardCostManifest = "") {
+  // use only as many threads as the number of files
   auto numThreads = std::min((int)inputFilePaths.size(), (int)concurrency);
 
-  return startMetadataCompactionAppForShardedFileHelper<PARTY, 0>(
+  return startMetadataCompactionAppForShardedFileHelper<PARTY>(
       inputFilePaths,
       outputGlobalParamsPaths,
       outputSecretSharesPaths,
-      0,
-      numThreads,
+      common::makeShardQueue(inputFilePaths.size(), shardCostManifest),
       numThreads,
       serverIp,
       port,
@@ -179,6 +177,9 @@ inline common::SchedulerStatistics startMetadataCompactionApp(
       computePublisherBreakdowns,
       epoch,
       useXorEncryption,
+      useBinarySecretShares,
+      numParseThreads,
+      useShardCache,
       tlsInfo);
 }
 
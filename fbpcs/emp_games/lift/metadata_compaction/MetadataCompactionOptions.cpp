@@ -46,6 +46,16 @@ DEFINE_string(
     "",
     "Local or s3 base path where output secret share files are written to");
 DEFINE_int32(concurrency, 1, "max number of games that will run concurrently");
+DEFINE_string(
+    shard_cost_manifest,
+    "",
+    "Path of the shard cost manifest written by the sharder, used by the "
+    "publisher to run the most expensive files first. Files run in order "
+    "if empty");
+DEFINE_int32(
+    input_parse_threads,
+    1,
+    "Number of threads each game uses to parse a local input file");
 DEFINE_int32(
     epoch,
     1546300800,
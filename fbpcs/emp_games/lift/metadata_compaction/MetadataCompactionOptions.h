@@ -25,6 +25,8 @@ DECLARE_string(input_base_path);
 DECLARE_string(output_global_params_base_path);
 DECLARE_string(output_secret_shares_base_path);
 DECLARE_int32(concurrency);
+DECLARE_string(shard_cost_manifest);
+DECLARE_int32(input_parse_threads);
 DECLARE_int32(epoch);
 DECLARE_int32(num_conversions_per_user);
 DECLARE_bool(compute_publisher_breakdowns);
@@ -10,6 +10,7 @@
 #include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
 #include "fbpcf/scheduler/IScheduler.h"
 #include "fbpcs/emp_games/common/SchedulerStatistics.h"
+#include "fbpcs/emp_games/common/ShardQueue.h"
 #include "fbpcs/emp_games/lift/metadata_compaction/IMetadataCompactorGame.h"
 #include "fbpcs/emp_games/lift/metadata_compaction/IMetadataCompactorGameFactory.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/InputData.h"
@@ -34,7 +35,11 @@ class MetadataCompactorApp {
       const std::vector<std::string>& outputSecretSharesPaths,
       int startFileIndex,
       int numFiles,
-      bool useXorEncryption = true)
+      bool useXorEncryption = true,
+      bool useBinarySecretShares = false,
+      int numParseThreads = 1,
+      bool useShardCache = false,
+      std::shared_ptr<common::ShardQueue> shardQueue = nullptr)
       : party_{party},
         communicationAgentFactory_{std::move(communicationAgentFactory)},
         compactorGameFactory_{std::move(compactorGameFactory)},
@@ -46,7 +51,11 @@ class MetadataCompactorApp {
         outputSecretSharesPaths_{outputSecretSharesPaths},
         startFileIndex_{startFileIndex},
         numFiles_{numFiles},
-        useXorEncryption_{useXorEncryption} {}
+        useXorEncryption_{useXorEncryption},
+        useBinarySecretShares_{useBinarySecretShares},
+        numParseThreads_{numParseThreads},
+        useShardCache_{useShardCache},
+        shardQueue_{std::move(shardQueue)} {}
 
   void run();
 
@@ -59,6 +68,10 @@ class MetadataCompactorApp {
 
   std::unique_ptr<fbpcf::scheduler::IScheduler> createScheduler();
 
+  // The config which the outputs of a shard depend on, for its key in the
+  // shard cache
+  std::string getShardCacheConfig() const;
+
  private:
   int party_;
   std::function<std::unique_ptr<IMetadataCompactorGame<schedulerId>>(
@@ -78,6 +91,10 @@ class MetadataCompactorApp {
   int startFileIndex_;
   int numFiles_;
   bool useXorEncryption_;
+  bool useBinarySecretShares_;
+  int numParseThreads_;
+  bool useShardCache_;
+  std::shared_ptr<common::ShardQueue> shardQueue_;
   common::SchedulerStatistics schedulerStatistics_;
 };
 
@@ -11,6 +11,9 @@
 
 #include <fbpcf/scheduler/LazySchedulerFactory.h>
 #include <fbpcf/scheduler/NetworkPlaintextSchedulerFactory.h>
+#include <folly/Format.h>
+#include "fbpcs/emp_games/common/SchedulerPhase.h"
+#include "fbpcs/emp_games/common/ShardCache.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/IInputProcessor.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/InputData.h"
 
@@ -27,7 +30,23 @@ void MetadataCompactorApp<schedulerId>::run() {
   auto metadataCompactorGame =
       compactorGameFactory_->create(std::move(scheduler), party_);
 
-  for (size_t i = startFileIndex_; i < startFileIndex_ + numFiles_; i++) {
+  // Run the game sequentially on the files taken from shardQueue_ if there is
+  // one, otherwise on numFiles files starting from startFileIndex. Taking
+  // files from the queue creates the third communication agent
+  auto files = shardQueue_ == nullptr
+      ? common::ShardAssignment(startFileIndex_, numFiles_)
+      : common::ShardAssignment(
+            party_, shardQueue_, *communicationAgentFactory_);
+
+  // next communication agent created, if the shard cache is used
+  std::unique_ptr<common::ShardCache> shardCache;
+  if (useShardCache_) {
+    shardCache = std::make_unique<common::ShardCache>(
+        party_, getShardCacheConfig(), *communicationAgentFactory_);
+  }
+
+  for (auto file = files.next(); file.has_value(); file = files.next()) {
+    auto i = *file;
     try {
       CHECK_LT(i, inputPaths_.size()) << "File index exceeds number of files.";
       CHECK_LT(i, outputGlobalParamsPaths_.size())
@@ -35,16 +54,42 @@ void MetadataCompactorApp<schedulerId>::run() {
       CHECK_LT(i, outputSecretSharesPaths_.size())
           << "File index exceeds number of files.";
 
+      // The stamp is written after both outputs, next to the secret shares
+      auto stampPath =
+          common::shardCacheStampPath(outputSecretSharesPaths_.at(i));
+      if (shardCache != nullptr &&
+          shardCache->isComputed({inputPaths_.at(i)}, stampPath)) {
+        continue;
+      }
+
+      fbpcs::performance_tools::ScopedPhase inputPhase{"input_parsing"};
       auto inputData = getInputData(inputPaths_.at(i));
+      inputPhase.end();
       XLOG(INFO) << "Have " << inputData.getNumRows()
                  << " values in inputData.";
+      fbpcs::performance_tools::ScopedPhase compactionPhase{
+          "metadata_compaction",
+          common::getSchedulerCounterReader<schedulerId>()};
       auto inputProcessor =
           metadataCompactorGame->play(inputData, numConversionsPerUser_);
+      compactionPhase.end();
       XLOG(INFO) << "done calculating";
-      writeToCSV(
-          *inputProcessor,
-          outputGlobalParamsPaths_.at(i),
-          outputSecretSharesPaths_.at(i));
+      fbpcs::performance_tools::ScopedPhase outputPhase{"output_writing"};
+      if (useBinarySecretShares_) {
+        writeToBinary(
+            *inputProcessor,
+            outputGlobalParamsPaths_.at(i),
+            outputSecretSharesPaths_.at(i));
+      } else {
+        writeToCSV(
+            *inputProcessor,
+            outputGlobalParamsPaths_.at(i),
+            outputSecretSharesPaths_.at(i));
+      }
+      outputPhase.end();
+      if (shardCache != nullptr) {
+        shardCache->markComputed(stampPath);
+      }
     } catch (const std::exception& e) {
       XLOGF(
           ERR,
@@ -88,7 +133,19 @@ InputData MetadataCompactorApp<schedulerId>::getInputData(
       InputData::LiftMPCType::Standard,
       computePublisherBreakdowns_,
       epoch_,
-      numConversionsPerUser_);
+      numConversionsPerUser_,
+      numParseThreads_);
+}
+
+template <int schedulerId>
+std::string MetadataCompactorApp<schedulerId>::getShardCacheConfig() const {
+  return folly::sformat(
+      "pcf2_lift_metadata_compaction {} {} {} {} {}",
+      numConversionsPerUser_,
+      computePublisherBreakdowns_,
+      epoch_,
+      useXorEncryption_,
+      useBinarySecretShares_);
 }
 
 template <int schedulerId>
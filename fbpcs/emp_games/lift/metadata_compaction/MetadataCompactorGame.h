@@ -7,10 +7,8 @@
 
 #pragma once
 
-#include "fbpcf/mpc_std_lib/unified_data_process/adapter/AdapterFactory.h"
-#include "fbpcf/mpc_std_lib/unified_data_process/data_processor/DataProcessorFactory.h"
 #include "fbpcs/emp_games/lift/metadata_compaction/IMetadataCompactorGame.h"
-#include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/CompactionBasedInputProcessor.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/CompactionBasedInputProcessorFactory.h"
 
 namespace private_lift {
 
@@ -30,27 +28,8 @@ class MetadataCompactorGame : public IMetadataCompactorGame<schedulerId>,
   std::unique_ptr<IInputProcessor<schedulerId>> play(
       InputData inputData,
       int32_t numConversionPerUser) override {
-    int partnerParty =
-        party_ == common::PUBLISHER ? common::PARTNER : common::PUBLISHER;
-    auto adapter = fbpcf::mpc_std_lib::unified_data_process::adapter::
-                       getAdapterFactoryWithAsWaksmanBasedShuffler<schedulerId>(
-                           party_ == common::PUBLISHER, party_, partnerParty)
-                           ->create();
-    auto dataProcessor =
-        fbpcf::mpc_std_lib::unified_data_process::data_processor::
-            getDataProcessorFactoryWithAesCtr<schedulerId>(
-                party_, partnerParty, agentFactory_)
-                ->create();
-    auto prg = std::make_unique<fbpcf::engine::util::AesPrgFactory>()->create(
-        fbpcf::engine::util::getRandomM128iFromSystemNoise());
-
-    return std::make_unique<CompactionBasedInputProcessor<schedulerId>>(
-        party_,
-        std::move(adapter),
-        std::move(dataProcessor),
-        std::move(prg),
-        inputData,
-        numConversionPerUser);
+    return makeCompactionBasedInputProcessor<schedulerId>(
+        party_, agentFactory_, inputData, numConversionPerUser);
   }
 
  private:
@@ -14,6 +14,7 @@
 #include "fbpcs/performance_tools/CostEstimation.h"
 
 #include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/FeatureFlagUtil.h"
 #include "fbpcs/emp_games/common/Util.h"
 #include "fbpcs/emp_games/lift/metadata_compaction/MainUtil.h"
 #include "fbpcs/emp_games/lift/metadata_compaction/MetadataCompactionOptions.h"
@@ -76,6 +77,9 @@ int main(int argc, char** argv) {
              << "\tsecret shares output: "
              << outputSecretSharesFileLogList.str() << "\n"
              << "\tepoch: " << FLAGS_epoch << "\n"
+             << "\tconcurrency: " << FLAGS_concurrency << "\n"
+             << "\tshard cost manifest: " << FLAGS_shard_cost_manifest << "\n"
+             << "\tinput parse threads: " << FLAGS_input_parse_threads << "\n"
              << "\tnumber of conversions per user: "
              << FLAGS_num_conversions_per_user << "\n"
              << "\tcompute publisher breakdowns: "
@@ -98,6 +102,16 @@ int main(int argc, char** argv) {
 
   common::SchedulerStatistics schedulerStatistics;
 
+  const private_measurement::FeatureFlags featureFlags{
+      FLAGS_pc_feature_flags};
+  bool useBinarySecretShares =
+      featureFlags.isEnabled("private_lift_binary_secret_shares");
+  XLOG(INFO) << "Write secret shares in binary format: "
+             << useBinarySecretShares;
+  bool useShardCache = featureFlags.isEnabled("private_lift_shard_cache");
+  XLOG(INFO) << "Skip the shards computed in an earlier run: "
+             << useShardCache;
+
   XLOG(INFO) << "Start Metadata Compaction...";
   if (FLAGS_party == common::PUBLISHER) {
     XLOG(INFO)
@@ -114,7 +128,11 @@ int main(int argc, char** argv) {
             FLAGS_compute_publisher_breakdowns,
             FLAGS_epoch,
             FLAGS_use_xor_encryption,
-            tlsInfo);
+            useBinarySecretShares,
+            FLAGS_input_parse_threads,
+            tlsInfo,
+            useShardCache,
+            FLAGS_shard_cost_manifest);
   } else if (FLAGS_party == common::PARTNER) {
     XLOG(INFO)
         << "Starting Metadata Compaction as Partner, will wait for Publisher...";
@@ -130,7 +148,11 @@ int main(int argc, char** argv) {
             FLAGS_compute_publisher_breakdowns,
             FLAGS_epoch,
             FLAGS_use_xor_encryption,
-            tlsInfo);
+            useBinarySecretShares,
+            FLAGS_input_parse_threads,
+            tlsInfo,
+            useShardCache,
+            FLAGS_shard_cost_manifest);
   } else {
     XLOGF(FATAL, "Invalid Party: {}", FLAGS_party);
   }
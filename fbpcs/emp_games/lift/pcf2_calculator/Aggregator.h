@@ -7,11 +7,15 @@
 
 #pragma once
 
+#include <functional>
+#include <vector>
+
 #include "folly/logging/xlog.h"
 
 #include "fbpcf/mpc_std_lib/oram/IWriteOnlyOramFactory.h"
 #include "fbpcf/mpc_std_lib/oram/LinearOramFactory.h"
 #include "fbpcf/mpc_std_lib/oram/WriteOnlyOramFactory.h"
+#include "fbpcs/emp_games/common/PrewarmedOramFactory.h"
 #include "fbpcs/emp_games/lift/common/GroupedLiftMetrics.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/Attributor.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/OutputMetricsData.h"
@@ -34,30 +38,121 @@ template <int schedulerId, bool isSigned, int8_t width>
 using SecInt =
     typename fbpcf::frontend::Int<isSigned, width, true, schedulerId, false>;
 
-template <int schedulerId>
+// The ORAM factories of an Aggregator, each one linear or write-only according
+// to the number of groups and the width of its values. Constructing them
+// starts creating the first ORAM of every factory in the background, so they
+// can be constructed before the attribution to set up the ORAMs while it runs.
+// The values and values squared are summed at the widths of Widths, and the
+// counts at valueWidth and valueSquaredWidth. The factories which only the
+// metrics left out of metrics would use are not created.
+template <int schedulerId, typename Widths = DefaultValueWidths>
+struct AggregatorOram {
+  AggregatorOram(
+      int myRole,
+      const LiftGameProcessedData<schedulerId>& processedData,
+      std::shared_ptr<
+          fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+          communicationAgentFactory,
+      LiftMetricSet metrics = LiftMetricSet{});
+
+  std::shared_ptr<fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+      communicationAgentFactory;
+  bool isPublisher;
+  // Declared before the factories, which create their ORAMs on it
+  common::OramPrewarmer prewarmer;
+
+  std::unique_ptr<
+      fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<Intp<false, valueWidth>>>
+      unsignedWriteOnlyOramFactory;
+  std::unique_ptr<fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<
+      Intp<true, Widths::kValueWidth>>>
+      signedWriteOnlyOramFactory;
+  std::unique_ptr<
+      fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<Intp<false, valueWidth>>>
+      testUnsignedWriteOnlyOramFactory;
+  std::unique_ptr<fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<
+      Intp<true, Widths::kValueWidth>>>
+      testSignedWriteOnlyOramFactory;
+  std::unique_ptr<fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<
+      Intp<false, Widths::kValueSquaredWidth>>>
+      valueSquaredWriteOnlyOramFactory;
+  // Only set when the values squared are narrower than valueSquaredWidth, as
+  // the values squared factory is used for them otherwise
+  std::unique_ptr<fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<
+      Intp<false, valueSquaredWidth>>>
+      packedBitsWriteOnlyOramFactory;
+  std::unique_ptr<fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<
+      Intp<false, valueSquaredWidth>>>
+      testPackedBitsWriteOnlyOramFactory;
+
+  // A factory of ORAMs of oramSize values, whose first ORAM is created ahead
+  template <bool isSigned, int8_t width>
+  std::unique_ptr<common::PrewarmedOramFactory<Intp<isSigned, width>>>
+  makePrewarmedOramFactory(size_t oramSize);
+
+  // The factory of the packed bit metrics, see Aggregator::aggregateBits
+  fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<
+      Intp<false, valueSquaredWidth>>&
+  getPackedBitsOramFactory() const {
+    if constexpr (Widths::kValueSquaredWidth == valueSquaredWidth) {
+      return *valueSquaredWriteOnlyOramFactory;
+    } else {
+      return *packedBitsWriteOnlyOramFactory;
+    }
+  }
+};
+
+template <int schedulerId, typename Widths = DefaultValueWidths>
 class Aggregator {
  public:
   Aggregator(
       int myRole,
       std::shared_ptr<IInputProcessor<schedulerId>> inputProcessor,
-      std::unique_ptr<Attributor<schedulerId>> attributor,
+      std::unique_ptr<Attributor<schedulerId, Widths>> attributor,
       int32_t numConversionsPerUser,
       std::shared_ptr<
           fbpcf::engine::communication::IPartyCommunicationAgentFactory>
-          communicationAgentFactory)
+          communicationAgentFactory,
+      LiftMetricSet metrics = LiftMetricSet{})
+      : Aggregator{
+            myRole,
+            inputProcessor,
+            std::move(attributor),
+            numConversionsPerUser,
+            std::make_unique<AggregatorOram<schedulerId, Widths>>(
+                myRole,
+                inputProcessor->getLiftGameProcessedData(),
+                communicationAgentFactory,
+                metrics),
+            metrics} {}
+
+  // Aggregates with the ORAMs of oram, which can be constructed before the
+  // attributor. The optional metrics left out of metrics are output as zero,
+  // and have to be left out of the attributor and oram as well.
+  Aggregator(
+      int myRole,
+      std::shared_ptr<IInputProcessor<schedulerId>> inputProcessor,
+      std::unique_ptr<Attributor<schedulerId, Widths>> attributor,
+      int32_t numConversionsPerUser,
+      std::unique_ptr<AggregatorOram<schedulerId, Widths>> oram,
+      LiftMetricSet metrics = LiftMetricSet{})
       : myRole_{myRole},
         inputProcessor_{inputProcessor},
         attributor_{std::move(attributor)},
-        communicationAgentFactory_{communicationAgentFactory} {
-    initOram();
-    sumEvents();
-    sumConverters();
+        oram_{std::move(oram)} {
+    sumEventsConvertersAndMatch();
     sumNumConvSquared();
-    sumMatch();
-    sumReachedConversions();
+    if (metrics.reached) {
+      sumReachedConversions();
+    }
     sumValues();
-    sumReachedValues();
-    sumValueSquared();
+    if (metrics.reached) {
+      sumReachedValues();
+    }
+    if (metrics.valueSquared) {
+      sumValueSquared();
+    }
+    revealOutputs();
   }
 
   const OutputMetricsData getMetrics() const {
@@ -77,16 +172,10 @@ class Aggregator {
   std::string toJson() const;
 
  private:
-  void initOram();
-
-  void sumEvents();
-
-  void sumConverters();
+  void sumEventsConvertersAndMatch();
 
   void sumNumConvSquared();
 
-  void sumMatch();
-
   void sumReachedConversions();
 
   void sumValues();
@@ -95,10 +184,28 @@ class Aggregator {
 
   void sumValueSquared();
 
-  // Run ORAM aggregation on input. The template parameter useVector indicates
-  // whether the input consists of a vector of inputs or a single input.
+  // Defer extracting the shares of the totals of a metric, in the order of
+  // sumGroupTotals, into testField and controlField until revealOutputs.
+  // Extracting a share makes the scheduler compute the pending gates, so
+  // extracting them only once the totals of every metric were computed
+  // computes all of them together instead of waiting for the network once per
+  // metric. controlField isn't used for test only metrics.
+  template <bool isSigned, int8_t width>
+  void deferReveal(
+      std::vector<SecInt<schedulerId, isSigned, width>> totals,
+      bool testOnly,
+      int64_t OutputMetricsData::*testField,
+      int64_t OutputMetricsData::*controlField);
+
+  // Extract the shares of the totals of deferReveal into metrics_,
+  // cohortMetrics_ and publisherBreakdowns_
+  void revealOutputs();
+
+  // Run ORAM aggregation on input and return the additive shares of the sum
+  // of each group. The template parameter useVector indicates whether the
+  // input consists of a vector of inputs or a single input.
   template <bool isSigned, int8_t width, bool useVector>
-  std::vector<SecInt<schedulerId, isSigned, width>> aggregate(
+  std::vector<Intp<isSigned, width>> aggregate(
       const std::vector<std::vector<bool>>& indexShares,
       ConditionalVector<std::vector<std::vector<bool>>, useVector>& valueShares,
       size_t oramSize,
@@ -106,59 +213,99 @@ class Aggregator {
           fbpcf::mpc_std_lib::oram::IWriteOnlyOram<Intp<isSigned, width>>> oram)
       const;
 
-  // Reveal cohort output from aggregation output as a pair consisting of the
-  // test cohort metrics and optionally the control cohort metrics.
+  // Convert additive shares into secret shares, which takes an addition in
+  // MPC for each of them
   template <bool isSigned, int8_t width>
-  std::pair<
-      std::vector<NativeIntp<isSigned, width>>,
-      std::vector<NativeIntp<isSigned, width>>>
-  revealCohortOutput(
-      std::vector<SecInt<schedulerId, isSigned, width>> aggregationOutput,
+  std::vector<SecInt<schedulerId, isSigned, width>> shareTotals(
+      const std::vector<Intp<isSigned, width>>& additiveTotals) const;
+
+  // Run ORAM aggregation on several single bit metrics, given the shares of
+  // each metric for every row, and return the totals of each metric, see
+  // sumGroupTotals. As a sum is at most the number of rows, the metrics are
+  // packed into as few fields of a wide value as can't carry into each other,
+  // so that the ORAM processes the indices once for all of the metrics of a
+  // value instead of once per metric. The values are valueSquaredWidth wide,
+  // except for the last one, which is valueWidth wide when the remaining
+  // metrics fit.
+  std::vector<std::vector<SecInt<schedulerId, false, valueWidth>>>
+  aggregateBits(
+      const std::vector<std::vector<bool>>& indexShares,
+      const std::vector<std::vector<bool>>& bitShares,
+      size_t oramSize,
+      bool testOnly,
+      fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<Intp<false, valueWidth>>&
+          narrowOramFactory,
+      fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<
+          Intp<false, valueSquaredWidth>>& wideOramFactory) const;
+
+  // Aggregate numMetrics of the metrics from start, packed into fields of
+  // fieldWidth bits of a value of packedWidth bits
+  template <int8_t packedWidth>
+  std::vector<std::vector<SecInt<schedulerId, false, valueWidth>>>
+  aggregatePackedBits(
+      const std::vector<std::vector<bool>>& indexShares,
+      const std::vector<std::vector<bool>>& bitShares,
+      size_t start,
+      size_t numMetrics,
+      size_t fieldWidth,
+      size_t oramSize,
+      bool testOnly,
+      fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<
+          Intp<false, packedWidth>>& oramFactory) const;
+
+  // The sums of each total over the first numMetrics outputs of aggregateBits
+  std::vector<SecInt<schedulerId, false, valueWidth>> addAggregationOutputs(
+      const std::vector<std::vector<SecInt<schedulerId, false, valueWidth>>>&
+          aggregationOutputs,
+      size_t numMetrics,
+      size_t numTotals) const;
+
+  // The number of totals of a metric, see sumGroupTotals
+  size_t getNumTotals(bool testOnly) const;
+
+  // The totals which are revealed for a metric, given the sums of its groups:
+  // the test and control population, then the test and control sums of each
+  // cohort, then those of each publisher breakdown. The control totals are
+  // left out for test only metrics. The groups are summed up on the additive
+  // shares of the ORAM, which is local, so that only the totals are converted
+  // into secret shares and the cost of a metric grows with the number of
+  // cohorts and breakdowns instead of the number of their combinations.
+  template <typename T>
+  std::vector<T> sumGroupTotals(const std::vector<T>& groupSums, bool testOnly)
+      const;
+
+  // Sum cohort output from aggregation output as a pair consisting of the
+  // test cohort metrics and optionally the control cohort metrics.
+  template <typename T>
+  std::pair<std::vector<T>, std::vector<T>> sumCohortOutput(
+      const std::vector<T>& aggregationOutput,
       bool testOnly) const;
 
-  // Reveal breakdown output from aggregation output as a pair consisting of the
+  // Sum breakdown output from aggregation output as a pair consisting of the
   // test breakdown metrics and optionally the control breakdown metrics.
-  template <bool isSigned, int8_t width>
-  std::pair<
-      std::vector<NativeIntp<isSigned, width>>,
-      std::vector<NativeIntp<isSigned, width>>>
-  revealBreakdownOutput(
-      std::vector<SecInt<schedulerId, isSigned, width>> aggregationOutput,
+  template <typename T>
+  std::pair<std::vector<T>, std::vector<T>> sumBreakdownOutput(
+      const std::vector<T>& aggregationOutput,
       bool testOnly) const;
 
-  // Reveal population output from aggregation output as a pair consisting
-  // of the test metrics and optionally the control metrics.
-  template <bool isSigned, int8_t width>
-  std::pair<NativeIntp<isSigned, width>, NativeIntp<isSigned, width>>
-  revealPopulationOutput(
-      std::vector<SecInt<schedulerId, isSigned, width>> aggregationOutput,
+  // Sum population output from aggregation output as a pair consisting of the
+  // test metrics and the control metrics, which is only meaningful when not
+  // testOnly.
+  template <typename T>
+  std::pair<T, T> sumPopulationOutput(
+      const std::vector<T>& aggregationOutput,
       bool testOnly) const;
 
   int32_t myRole_;
   std::shared_ptr<IInputProcessor<schedulerId>> inputProcessor_;
-  std::unique_ptr<Attributor<schedulerId>> attributor_;
+  std::unique_ptr<Attributor<schedulerId, Widths>> attributor_;
   OutputMetricsData metrics_;
 
-  std::shared_ptr<fbpcf::engine::communication::IPartyCommunicationAgentFactory>
-      communicationAgentFactory_;
-  std::unique_ptr<
-      fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<Intp<false, valueWidth>>>
-      unsignedWriteOnlyOramFactory_;
-  std::unique_ptr<
-      fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<Intp<true, valueWidth>>>
-      signedWriteOnlyOramFactory_;
-  std::unique_ptr<
-      fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<Intp<false, valueWidth>>>
-      testUnsignedWriteOnlyOramFactory_;
-  std::unique_ptr<
-      fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<Intp<true, valueWidth>>>
-      testSignedWriteOnlyOramFactory_;
-  std::unique_ptr<fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<
-      Intp<false, valueSquaredWidth>>>
-      valueSquaredWriteOnlyOramFactory_;
+  std::unique_ptr<AggregatorOram<schedulerId, Widths>> oram_;
 
   std::unordered_map<int64_t, OutputMetricsData> cohortMetrics_;
   std::unordered_map<int64_t, OutputMetricsData> publisherBreakdowns_;
+  std::vector<std::function<void()>> deferredReveals_;
 };
 } // namespace private_lift
 
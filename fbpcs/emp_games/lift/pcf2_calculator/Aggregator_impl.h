@@ -7,68 +7,80 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+
 #include "fbpcs/emp_games/lift/pcf2_calculator/Aggregator.h"
 
+#include "fbpcs/emp_games/common/OramSelection.h"
 #include "fbpcs/emp_games/common/Util.h"
 namespace private_lift {
 
-template <int schedulerId>
-void Aggregator<schedulerId>::initOram() {
-  // Initialize ORAM
-  bool isPublisher = (myRole_ == common::PUBLISHER);
-  if (inputProcessor_->getLiftGameProcessedData().numGroups > 4) {
-    // If the ORAM size is larger than 4, linear ORAM is less efficient
-    // theoretically
-    unsignedWriteOnlyOramFactory_ =
-        fbpcf::mpc_std_lib::oram::getSecureWriteOnlyOramFactory<
-            Intp<false, valueWidth>,
-            groupWidth,
-            schedulerId>(isPublisher, 0, 1, *communicationAgentFactory_);
-    signedWriteOnlyOramFactory_ =
-        fbpcf::mpc_std_lib::oram::getSecureWriteOnlyOramFactory<
-            Intp<true, valueWidth>,
-            groupWidth,
-            schedulerId>(isPublisher, 0, 1, *communicationAgentFactory_);
-    valueSquaredWriteOnlyOramFactory_ =
-        fbpcf::mpc_std_lib::oram::getSecureWriteOnlyOramFactory<
-            Intp<false, valueSquaredWidth>,
-            groupWidth,
-            schedulerId>(isPublisher, 0, 1, *communicationAgentFactory_);
+template <int schedulerId, typename Widths>
+AggregatorOram<schedulerId, Widths>::AggregatorOram(
+    int myRole,
+    const LiftGameProcessedData<schedulerId>& processedData,
+    std::shared_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+        communicationAgentFactory,
+    LiftMetricSet metrics)
+    : communicationAgentFactory{communicationAgentFactory},
+      isPublisher{myRole == common::PUBLISHER} {
+  auto numGroups = processedData.numGroups;
+  auto numTestGroups = processedData.numTestGroups;
+  // The first ORAM of each factory is created ahead. The factories are created
+  // in the order of their first use, which is the order their first ORAMs are
+  // created in, as they are created one at a time.
+  if constexpr (Widths::kValueSquaredWidth == valueSquaredWidth) {
+    valueSquaredWriteOnlyOramFactory =
+        makePrewarmedOramFactory<false, valueSquaredWidth>(numGroups);
   } else {
-    unsignedWriteOnlyOramFactory_ = fbpcf::mpc_std_lib::oram::
-        getSecureLinearOramFactory<Intp<false, valueWidth>, schedulerId>(
-            isPublisher, 0, 1, *communicationAgentFactory_);
-    signedWriteOnlyOramFactory_ = fbpcf::mpc_std_lib::oram::
-        getSecureLinearOramFactory<Intp<true, valueWidth>, schedulerId>(
-            isPublisher, 0, 1, *communicationAgentFactory_);
-    valueSquaredWriteOnlyOramFactory_ = fbpcf::mpc_std_lib::oram::
-        getSecureLinearOramFactory<Intp<false, valueSquaredWidth>, schedulerId>(
-            isPublisher, 0, 1, *communicationAgentFactory_);
+    packedBitsWriteOnlyOramFactory =
+        makePrewarmedOramFactory<false, valueSquaredWidth>(numGroups);
+  }
+  unsignedWriteOnlyOramFactory =
+      makePrewarmedOramFactory<false, valueWidth>(numGroups);
+  if (metrics.reached) {
+    testPackedBitsWriteOnlyOramFactory =
+        makePrewarmedOramFactory<false, valueSquaredWidth>(numTestGroups);
+    testUnsignedWriteOnlyOramFactory =
+        makePrewarmedOramFactory<false, valueWidth>(numTestGroups);
+  }
+  signedWriteOnlyOramFactory =
+      makePrewarmedOramFactory<true, Widths::kValueWidth>(numGroups);
+  if (metrics.reached) {
+    testSignedWriteOnlyOramFactory =
+        makePrewarmedOramFactory<true, Widths::kValueWidth>(numTestGroups);
+  }
+  if constexpr (Widths::kValueSquaredWidth != valueSquaredWidth) {
+    if (metrics.valueSquared) {
+      valueSquaredWriteOnlyOramFactory =
+          makePrewarmedOramFactory<false, Widths::kValueSquaredWidth>(
+              numGroups);
+    }
   }
+}
 
-  if (inputProcessor_->getLiftGameProcessedData().numTestGroups > 4) {
-    testUnsignedWriteOnlyOramFactory_ =
-        fbpcf::mpc_std_lib::oram::getSecureWriteOnlyOramFactory<
-            Intp<false, valueWidth>,
-            groupWidth,
-            schedulerId>(isPublisher, 0, 1, *communicationAgentFactory_);
-    testSignedWriteOnlyOramFactory_ =
-        fbpcf::mpc_std_lib::oram::getSecureWriteOnlyOramFactory<
-            Intp<true, valueWidth>,
-            groupWidth,
-            schedulerId>(isPublisher, 0, 1, *communicationAgentFactory_);
-  } else {
-    testUnsignedWriteOnlyOramFactory_ = fbpcf::mpc_std_lib::oram::
-        getSecureLinearOramFactory<Intp<false, valueWidth>, schedulerId>(
-            isPublisher, 0, 1, *communicationAgentFactory_);
-    testSignedWriteOnlyOramFactory_ = fbpcf::mpc_std_lib::oram::
-        getSecureLinearOramFactory<Intp<true, valueWidth>, schedulerId>(
-            isPublisher, 0, 1, *communicationAgentFactory_);
-  }
+template <int schedulerId, typename Widths>
+template <bool isSigned, int8_t width>
+std::unique_ptr<common::PrewarmedOramFactory<Intp<isSigned, width>>>
+AggregatorOram<schedulerId, Widths>::makePrewarmedOramFactory(
+    size_t oramSize) {
+  return std::make_unique<common::PrewarmedOramFactory<Intp<isSigned, width>>>(
+      common::getSecureOramFactory<
+          Intp<isSigned, width>,
+          groupWidth,
+          schedulerId>(
+          isPublisher, oramSize, width, *communicationAgentFactory),
+      oramSize,
+      1,
+      prewarmer);
 }
 
-template <int schedulerId>
-std::string Aggregator<schedulerId>::toJson() const {
+template <int schedulerId, typename Widths>
+std::string Aggregator<schedulerId, Widths>::toJson() const {
   GroupedLiftMetrics groupedLiftMetrics;
 
   /*
@@ -110,200 +122,90 @@ std::string Aggregator<schedulerId>::toJson() const {
   return groupedLiftMetrics.toJson();
 }
 
-template <int schedulerId>
-void Aggregator<schedulerId>::sumEvents() {
-  XLOG(INFO) << "Aggregate events";
-  // Aggregate across test/control and cohorts
-  std::vector<std::vector<std::vector<bool>>> valueSharesArray;
+template <int schedulerId, typename Widths>
+void Aggregator<schedulerId, Widths>::sumEventsConvertersAndMatch() {
+  XLOG(INFO) << "Aggregate events, converters and matchCount";
+  // Aggregate across test/control and cohorts. The events of each conversion
+  // are aggregated as separate metrics and added up afterwards.
+  std::vector<std::vector<bool>> bitShares;
   for (auto events : attributor_->getEvents()) {
-    std::vector<std::vector<bool>> valueShares(
-        valueWidth,
-        std::vector<bool>(
-            inputProcessor_->getLiftGameProcessedData().numRows, 0));
-    valueShares[0] = events.extractBit().getValue();
-    valueSharesArray.push_back(std::move(valueShares));
+    bitShares.push_back(events.extractBit().getValue());
   }
-  auto oram = unsignedWriteOnlyOramFactory_->create(
-      inputProcessor_->getLiftGameProcessedData().numGroups);
-  auto aggregationOutput = aggregate<false, valueWidth, true>(
+  bitShares.push_back(attributor_->getConverters().extractBit().getValue());
+  bitShares.push_back(attributor_->getMatch().extractBit().getValue());
+  auto aggregationOutputs = aggregateBits(
       inputProcessor_->getLiftGameProcessedData().indexShares,
-      valueSharesArray,
+      bitShares,
       inputProcessor_->getLiftGameProcessedData().numGroups,
-      std::move(oram));
+      false,
+      *oram_->unsignedWriteOnlyOramFactory,
+      oram_->getPackedBitsOramFactory());
 
-  // Extract metrics
-  auto populationOutput = revealPopulationOutput(aggregationOutput, false);
-  metrics_.testEvents = std::get<0>(populationOutput);
-  metrics_.controlEvents = std::get<1>(populationOutput);
-  auto cohortOutput = revealCohortOutput(aggregationOutput, false);
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPartnerCohorts;
-       ++i) {
-    cohortMetrics_[i].testEvents = std::get<0>(cohortOutput).at(i);
-    cohortMetrics_[i].controlEvents = std::get<1>(cohortOutput).at(i);
-  }
-  auto breakdownOutput = revealBreakdownOutput(aggregationOutput, false);
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPublisherBreakdowns;
-       ++i) {
-    publisherBreakdowns_[i].testEvents = std::get<0>(breakdownOutput).at(i);
-    publisherBreakdowns_[i].controlEvents = std::get<1>(breakdownOutput).at(i);
-  }
+  auto numConversions = bitShares.size() - 2;
+  deferReveal(
+      addAggregationOutputs(
+          aggregationOutputs, numConversions, getNumTotals(false)),
+      false,
+      &OutputMetricsData::testEvents,
+      &OutputMetricsData::controlEvents);
+  deferReveal(
+      aggregationOutputs.at(numConversions),
+      false,
+      &OutputMetricsData::testConverters,
+      &OutputMetricsData::controlConverters);
+  deferReveal(
+      aggregationOutputs.at(numConversions + 1),
+      false,
+      &OutputMetricsData::testMatchCount,
+      &OutputMetricsData::controlMatchCount);
 }
 
-template <int schedulerId>
-void Aggregator<schedulerId>::sumConverters() {
-  XLOG(INFO) << "Aggregate converters";
-  // Aggregate across test/control and cohorts
-  std::vector<std::vector<bool>> valueShares(
-      valueWidth,
-      std::vector<bool>(
-          inputProcessor_->getLiftGameProcessedData().numRows, 0));
-  valueShares[0] = attributor_->getConverters().extractBit().getValue();
-  auto oram = unsignedWriteOnlyOramFactory_->create(
-      inputProcessor_->getLiftGameProcessedData().numGroups);
-  auto aggregationOutput = aggregate<false, valueWidth, false>(
-      inputProcessor_->getLiftGameProcessedData().indexShares,
-      valueShares,
-      inputProcessor_->getLiftGameProcessedData().numGroups,
-      std::move(oram));
-
-  // Extract metrics
-  auto populationOutput = revealPopulationOutput(aggregationOutput, false);
-  metrics_.testConverters = std::get<0>(populationOutput);
-  metrics_.controlConverters = std::get<1>(populationOutput);
-  auto cohortOutput = revealCohortOutput(aggregationOutput, false);
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPartnerCohorts;
-       ++i) {
-    cohortMetrics_[i].testConverters = std::get<0>(cohortOutput).at(i);
-    cohortMetrics_[i].controlConverters = std::get<1>(cohortOutput).at(i);
-  }
-  auto breakdownOutput = revealBreakdownOutput(aggregationOutput, false);
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPublisherBreakdowns;
-       ++i) {
-    publisherBreakdowns_[i].testConverters = std::get<0>(breakdownOutput).at(i);
-    publisherBreakdowns_[i].controlConverters =
-        std::get<1>(breakdownOutput).at(i);
-  }
-}
-
-template <int schedulerId>
-void Aggregator<schedulerId>::sumNumConvSquared() {
+template <int schedulerId, typename Widths>
+void Aggregator<schedulerId, Widths>::sumNumConvSquared() {
   XLOG(INFO) << "Aggregate numConvSquared";
   // Aggregate across test/control and cohorts
   auto valueShares =
       attributor_->getNumConvSquared().extractIntShare().getBooleanShares();
-  auto oram = unsignedWriteOnlyOramFactory_->create(
+  auto oram = oram_->unsignedWriteOnlyOramFactory->create(
       inputProcessor_->getLiftGameProcessedData().numGroups);
-  auto aggregationOutput = aggregate<false, valueWidth, false>(
+  auto groupSums = aggregate<false, valueWidth, false>(
       inputProcessor_->getLiftGameProcessedData().indexShares,
       valueShares,
       inputProcessor_->getLiftGameProcessedData().numGroups,
       std::move(oram));
 
-  // Extract metrics
-  auto populationOutput = revealPopulationOutput(aggregationOutput, false);
-  metrics_.testNumConvSquared = std::get<0>(populationOutput);
-  metrics_.controlNumConvSquared = std::get<1>(populationOutput);
-  auto cohortOutput = revealCohortOutput(aggregationOutput, false);
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPartnerCohorts;
-       ++i) {
-    cohortMetrics_[i].testNumConvSquared = std::get<0>(cohortOutput).at(i);
-    cohortMetrics_[i].controlNumConvSquared = std::get<1>(cohortOutput).at(i);
-  }
-  auto breakdownOutput = revealBreakdownOutput(aggregationOutput, false);
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPublisherBreakdowns;
-       ++i) {
-    publisherBreakdowns_[i].testNumConvSquared =
-        std::get<0>(breakdownOutput).at(i);
-    publisherBreakdowns_[i].controlNumConvSquared =
-        std::get<1>(breakdownOutput).at(i);
-  }
+  deferReveal(
+      shareTotals(sumGroupTotals(groupSums, false)),
+      false,
+      &OutputMetricsData::testNumConvSquared,
+      &OutputMetricsData::controlNumConvSquared);
 }
 
-template <int schedulerId>
-void Aggregator<schedulerId>::sumMatch() {
-  XLOG(INFO) << "Aggregate matchCount";
-  // Aggregate across test/control and cohorts
-  std::vector<std::vector<bool>> valueShares(
-      valueWidth,
-      std::vector<bool>(
-          inputProcessor_->getLiftGameProcessedData().numRows, 0));
-  valueShares[0] = attributor_->getMatch().extractBit().getValue();
-  auto oram = unsignedWriteOnlyOramFactory_->create(
-      inputProcessor_->getLiftGameProcessedData().numGroups);
-  auto aggregationOutput = aggregate<false, valueWidth, false>(
-      inputProcessor_->getLiftGameProcessedData().indexShares,
-      valueShares,
-      inputProcessor_->getLiftGameProcessedData().numGroups,
-      std::move(oram));
-
-  // Extract metrics
-  auto populationOutput = revealPopulationOutput(aggregationOutput, false);
-  metrics_.testMatchCount = std::get<0>(populationOutput);
-  metrics_.controlMatchCount = std::get<1>(populationOutput);
-  auto cohortOutput = revealCohortOutput(aggregationOutput, false);
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPartnerCohorts;
-       ++i) {
-    cohortMetrics_[i].testMatchCount = std::get<0>(cohortOutput).at(i);
-    cohortMetrics_[i].controlMatchCount = std::get<1>(cohortOutput).at(i);
-  }
-  auto breakdownOutput = revealBreakdownOutput(aggregationOutput, false);
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPublisherBreakdowns;
-       ++i) {
-    publisherBreakdowns_[i].testMatchCount = std::get<0>(breakdownOutput).at(i);
-    publisherBreakdowns_[i].controlMatchCount =
-        std::get<1>(breakdownOutput).at(i);
-  }
-}
-
-template <int schedulerId>
-void Aggregator<schedulerId>::sumReachedConversions() {
+template <int schedulerId, typename Widths>
+void Aggregator<schedulerId, Widths>::sumReachedConversions() {
   XLOG(INFO) << "Aggregate reachedConversions";
-  // Aggregate across test/control and cohorts
-  std::vector<std::vector<std::vector<bool>>> valueSharesArray;
+  // Aggregate across test cohorts. The reached conversions of each conversion
+  // are aggregated as separate metrics and added up afterwards.
+  std::vector<std::vector<bool>> bitShares;
   for (auto events : attributor_->getReachedConversions()) {
-    std::vector<std::vector<bool>> valueShares(
-        valueWidth,
-        std::vector<bool>(
-            inputProcessor_->getLiftGameProcessedData().numRows, 0));
-    valueShares[0] = events.extractBit().getValue();
-    valueSharesArray.push_back(std::move(valueShares));
+    bitShares.push_back(events.extractBit().getValue());
   }
-  auto oram = testUnsignedWriteOnlyOramFactory_->create(
-      inputProcessor_->getLiftGameProcessedData().numTestGroups);
-  auto aggregationOutput = aggregate<false, valueWidth, true>(
+  auto aggregationOutputs = aggregateBits(
       inputProcessor_->getLiftGameProcessedData().testIndexShares,
-      valueSharesArray,
+      bitShares,
       inputProcessor_->getLiftGameProcessedData().numTestGroups,
-      std::move(oram));
+      true,
+      *oram_->testUnsignedWriteOnlyOramFactory,
+      *oram_->testPackedBitsWriteOnlyOramFactory);
+  auto aggregationOutput = addAggregationOutputs(
+      aggregationOutputs, aggregationOutputs.size(), getNumTotals(true));
 
-  // Extract metrics
-  auto populationOutput = revealPopulationOutput(aggregationOutput, true);
-  metrics_.reachedConversions = std::get<0>(populationOutput);
-  auto cohortOutput = revealCohortOutput(aggregationOutput, true);
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPartnerCohorts;
-       ++i) {
-    cohortMetrics_[i].reachedConversions = std::get<0>(cohortOutput).at(i);
-  }
-  auto breakdownOutput = revealBreakdownOutput(aggregationOutput, true);
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPublisherBreakdowns;
-       ++i) {
-    publisherBreakdowns_[i].reachedConversions =
-        std::get<0>(breakdownOutput).at(i);
-  }
+  deferReveal(
+      aggregationOutput, true, &OutputMetricsData::reachedConversions, nullptr);
 }
 
-template <int schedulerId>
-void Aggregator<schedulerId>::sumValues() {
+template <int schedulerId, typename Widths>
+void Aggregator<schedulerId, Widths>::sumValues() {
   XLOG(INFO) << "Aggregate values";
   // Aggregate across test/control and cohorts
   std::vector<std::vector<std::vector<bool>>> valueSharesArray;
@@ -311,36 +213,23 @@ void Aggregator<schedulerId>::sumValues() {
     auto valueShares = input.extractIntShare().getBooleanShares();
     valueSharesArray.push_back(std::move(valueShares));
   }
-  auto oram = signedWriteOnlyOramFactory_->create(
+  auto oram = oram_->signedWriteOnlyOramFactory->create(
       inputProcessor_->getLiftGameProcessedData().numGroups);
-  auto aggregationOutput = aggregate<true, valueWidth, true>(
+  auto groupSums = aggregate<true, Widths::kValueWidth, true>(
       inputProcessor_->getLiftGameProcessedData().indexShares,
       valueSharesArray,
       inputProcessor_->getLiftGameProcessedData().numGroups,
       std::move(oram));
 
-  // Extract metrics
-  auto populationOutput = revealPopulationOutput(aggregationOutput, false);
-  metrics_.testValue = std::get<0>(populationOutput);
-  metrics_.controlValue = std::get<1>(populationOutput);
-  auto cohortOutput = revealCohortOutput(aggregationOutput, false);
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPartnerCohorts;
-       ++i) {
-    cohortMetrics_[i].testValue = std::get<0>(cohortOutput).at(i);
-    cohortMetrics_[i].controlValue = std::get<1>(cohortOutput).at(i);
-  }
-  auto breakdownOutput = revealBreakdownOutput(aggregationOutput, false);
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPublisherBreakdowns;
-       ++i) {
-    publisherBreakdowns_[i].testValue = std::get<0>(breakdownOutput).at(i);
-    publisherBreakdowns_[i].controlValue = std::get<1>(breakdownOutput).at(i);
-  }
+  deferReveal(
+      shareTotals(sumGroupTotals(groupSums, false)),
+      false,
+      &OutputMetricsData::testValue,
+      &OutputMetricsData::controlValue);
 }
 
-template <int schedulerId>
-void Aggregator<schedulerId>::sumReachedValues() {
+template <int schedulerId, typename Widths>
+void Aggregator<schedulerId, Widths>::sumReachedValues() {
   XLOG(INFO) << "Aggregate reachedValues";
   // Aggregate across test/control and cohorts
   std::vector<std::vector<std::vector<bool>>> valueSharesArray;
@@ -348,71 +237,103 @@ void Aggregator<schedulerId>::sumReachedValues() {
     auto valueShares = input.extractIntShare().getBooleanShares();
     valueSharesArray.push_back(std::move(valueShares));
   }
-  auto oram = testSignedWriteOnlyOramFactory_->create(
+  auto oram = oram_->testSignedWriteOnlyOramFactory->create(
       inputProcessor_->getLiftGameProcessedData().numTestGroups);
-  auto aggregationOutput = aggregate<true, valueWidth, true>(
+  auto groupSums = aggregate<true, Widths::kValueWidth, true>(
       inputProcessor_->getLiftGameProcessedData().testIndexShares,
       valueSharesArray,
       inputProcessor_->getLiftGameProcessedData().numTestGroups,
       std::move(oram));
 
-  // Extract metrics
-  auto populationOutput = revealPopulationOutput(aggregationOutput, true);
-  metrics_.reachedValue = std::get<0>(populationOutput);
-  auto cohortOutput = revealCohortOutput(aggregationOutput, true);
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPartnerCohorts;
-       ++i) {
-    cohortMetrics_[i].reachedValue = std::get<0>(cohortOutput).at(i);
-  }
-  auto breakdownOutput = revealBreakdownOutput(aggregationOutput, true);
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPublisherBreakdowns;
-       ++i) {
-    publisherBreakdowns_[i].reachedValue = std::get<0>(breakdownOutput).at(i);
-  }
+  deferReveal(
+      shareTotals(sumGroupTotals(groupSums, true)),
+      true,
+      &OutputMetricsData::reachedValue,
+      nullptr);
 }
 
-template <int schedulerId>
-void Aggregator<schedulerId>::sumValueSquared() {
+template <int schedulerId, typename Widths>
+void Aggregator<schedulerId, Widths>::sumValueSquared() {
   XLOG(INFO) << "Aggregate valueSquared";
   // Aggregate across test/control and cohorts
   auto valueShares =
       attributor_->getValueSquared().extractIntShare().getBooleanShares();
-  auto oram = valueSquaredWriteOnlyOramFactory_->create(
+  auto oram = oram_->valueSquaredWriteOnlyOramFactory->create(
       inputProcessor_->getLiftGameProcessedData().numGroups);
-  auto aggregationOutput = aggregate<false, valueSquaredWidth, false>(
+  auto groupSums = aggregate<false, Widths::kValueSquaredWidth, false>(
       inputProcessor_->getLiftGameProcessedData().indexShares,
       valueShares,
       inputProcessor_->getLiftGameProcessedData().numGroups,
       std::move(oram));
 
-  // Extract metrics
-  auto populationOutput = revealPopulationOutput(aggregationOutput, false);
-  metrics_.testValueSquared = std::get<0>(populationOutput);
-  metrics_.controlValueSquared = std::get<1>(populationOutput);
-  auto cohortOutput = revealCohortOutput(aggregationOutput, false);
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPartnerCohorts;
-       ++i) {
-    cohortMetrics_[i].testValueSquared = std::get<0>(cohortOutput).at(i);
-    cohortMetrics_[i].controlValueSquared = std::get<1>(cohortOutput).at(i);
-  }
-  auto breakdownOutput = revealBreakdownOutput(aggregationOutput, false);
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPublisherBreakdowns;
-       ++i) {
-    publisherBreakdowns_[i].testValueSquared =
-        std::get<0>(breakdownOutput).at(i);
-    publisherBreakdowns_[i].controlValueSquared =
-        std::get<1>(breakdownOutput).at(i);
+  deferReveal(
+      shareTotals(sumGroupTotals(groupSums, false)),
+      false,
+      &OutputMetricsData::testValueSquared,
+      &OutputMetricsData::controlValueSquared);
+}
+
+template <int schedulerId, typename Widths>
+template <bool isSigned, int8_t width>
+void Aggregator<schedulerId, Widths>::deferReveal(
+    std::vector<SecInt<schedulerId, isSigned, width>> totals,
+    bool testOnly,
+    int64_t OutputMetricsData::*testField,
+    int64_t OutputMetricsData::*controlField) {
+  CHECK_EQ(totals.size(), getNumTotals(testOnly))
+      << "The totals of a metric don't match the cohorts and breakdowns";
+  deferredReveals_.push_back([this,
+                              testOnly,
+                              testField,
+                              controlField,
+                              totals = std::move(totals)]() {
+        auto reveal = [](OutputMetricsData& metrics,
+                         int64_t OutputMetricsData::*field,
+                         const SecInt<schedulerId, isSigned, width>& sum) {
+          metrics.*field =
+              static_cast<int64_t>(sum.extractIntShare().getValue());
+        };
+        // The totals are in the order of sumGroupTotals
+        auto next = totals.begin();
+        reveal(metrics_, testField, *next++);
+        if (!testOnly) {
+          reveal(metrics_, controlField, *next++);
+        }
+        auto numPartnerCohorts =
+            inputProcessor_->getLiftGameProcessedData().numPartnerCohorts;
+        auto numPublisherBreakdowns =
+            inputProcessor_->getLiftGameProcessedData().numPublisherBreakdowns;
+        for (size_t i = 0; i < numPartnerCohorts; ++i) {
+          reveal(cohortMetrics_[i], testField, *next++);
+        }
+        if (!testOnly) {
+          for (size_t i = 0; i < numPartnerCohorts; ++i) {
+            reveal(cohortMetrics_[i], controlField, *next++);
+          }
+        }
+        for (size_t i = 0; i < numPublisherBreakdowns; ++i) {
+          reveal(publisherBreakdowns_[i], testField, *next++);
+        }
+        if (!testOnly) {
+          for (size_t i = 0; i < numPublisherBreakdowns; ++i) {
+            reveal(publisherBreakdowns_[i], controlField, *next++);
+          }
+        }
+      });
+}
+
+template <int schedulerId, typename Widths>
+void Aggregator<schedulerId, Widths>::revealOutputs() {
+  XLOG(INFO) << "Extract the shares of the aggregated metrics";
+  for (auto& deferredReveal : deferredReveals_) {
+    deferredReveal();
   }
+  deferredReveals_.clear();
 }
 
-template <int schedulerId>
+template <int schedulerId, typename Widths>
 template <bool isSigned, int8_t width, bool useVector>
-std::vector<SecInt<schedulerId, isSigned, width>>
-Aggregator<schedulerId>::aggregate(
+std::vector<Intp<isSigned, width>> Aggregator<schedulerId, Widths>::aggregate(
     const std::vector<std::vector<bool>>& indexShares,
     ConditionalVector<std::vector<std::vector<bool>>, useVector>& valueShares,
     size_t oramSize,
@@ -427,9 +348,23 @@ Aggregator<schedulerId>::aggregate(
   } else {
     oram->obliviousAddBatch(indexShares, valueShares);
   }
-  std::vector<SecInt<schedulerId, isSigned, width>> output;
+  std::vector<Intp<isSigned, width>> output;
+  output.reserve(oramSize);
   for (size_t i = 0; i < oramSize; ++i) {
-    NativeIntp<isSigned, width> additiveSum(oram->secretRead(i));
+    output.push_back(oram->secretRead(i));
+  }
+  return output;
+}
+
+template <int schedulerId, typename Widths>
+template <bool isSigned, int8_t width>
+std::vector<SecInt<schedulerId, isSigned, width>>
+Aggregator<schedulerId, Widths>::shareTotals(
+    const std::vector<Intp<isSigned, width>>& additiveTotals) const {
+  std::vector<SecInt<schedulerId, isSigned, width>> output;
+  output.reserve(additiveTotals.size());
+  for (const auto& total : additiveTotals) {
+    NativeIntp<isSigned, width> additiveSum(total);
     // Convert additive shares to secret shares by inputting them into MPC
     // and adding them, then extracting the secret shares.
     auto publisherSum =
@@ -441,95 +376,239 @@ Aggregator<schedulerId>::aggregate(
   return output;
 }
 
-template <int schedulerId>
-template <bool isSigned, int8_t width>
-std::pair<
-    std::vector<NativeIntp<isSigned, width>>,
-    std::vector<NativeIntp<isSigned, width>>>
-Aggregator<schedulerId>::revealCohortOutput(
-    std::vector<SecInt<schedulerId, isSigned, width>> aggregationOutput,
+template <int schedulerId, typename Widths>
+std::vector<std::vector<SecInt<schedulerId, false, valueWidth>>>
+Aggregator<schedulerId, Widths>::aggregateBits(
+    const std::vector<std::vector<bool>>& indexShares,
+    const std::vector<std::vector<bool>>& bitShares,
+    size_t oramSize,
+    bool testOnly,
+    fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<Intp<false, valueWidth>>&
+        narrowOramFactory,
+    fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<
+        Intp<false, valueSquaredWidth>>& wideOramFactory) const {
+  auto numRows = inputProcessor_->getLiftGameProcessedData().numRows;
+  // The narrowest field which holds a sum of numRows bits. Both parties have
+  // the same number of rows, so they pack the metrics the same way.
+  size_t fieldWidth = 1;
+  while (fieldWidth < valueWidth &&
+         (uint64_t{1} << fieldWidth) <= static_cast<uint64_t>(numRows)) {
+    ++fieldWidth;
+  }
+  size_t narrowFields = valueWidth / fieldWidth;
+  size_t wideFields = valueSquaredWidth / fieldWidth;
+
+  // A wide value holds at least twice the fields of a narrow one, so it costs
+  // at most as much per metric. The metrics left over for the last value are
+  // aggregated at the narrow width when they fit, as the ORAM costs are in
+  // proportion to the width of the values.
+  std::vector<std::vector<SecInt<schedulerId, false, valueWidth>>> output;
+  size_t start = 0;
+  while (start < bitShares.size()) {
+    auto remaining = bitShares.size() - start;
+    std::vector<std::vector<SecInt<schedulerId, false, valueWidth>>> sums;
+    if (remaining <= narrowFields) {
+      sums = aggregatePackedBits<valueWidth>(
+          indexShares,
+          bitShares,
+          start,
+          remaining,
+          fieldWidth,
+          oramSize,
+          testOnly,
+          narrowOramFactory);
+    } else {
+      sums = aggregatePackedBits<valueSquaredWidth>(
+          indexShares,
+          bitShares,
+          start,
+          std::min(remaining, wideFields),
+          fieldWidth,
+          oramSize,
+          testOnly,
+          wideOramFactory);
+    }
+    start += sums.size();
+    for (auto& metricSums : sums) {
+      output.push_back(std::move(metricSums));
+    }
+  }
+  return output;
+}
+
+template <int schedulerId, typename Widths>
+template <int8_t packedWidth>
+std::vector<std::vector<SecInt<schedulerId, false, valueWidth>>>
+Aggregator<schedulerId, Widths>::aggregatePackedBits(
+    const std::vector<std::vector<bool>>& indexShares,
+    const std::vector<std::vector<bool>>& bitShares,
+    size_t start,
+    size_t numMetrics,
+    size_t fieldWidth,
+    size_t oramSize,
+    bool testOnly,
+    fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<
+        Intp<false, packedWidth>>& oramFactory) const {
+  auto numRows = inputProcessor_->getLiftGameProcessedData().numRows;
+  auto fieldMask = (uint64_t{1} << fieldWidth) - 1;
+  // The bit of a metric is the lowest bit of its field
+  std::vector<std::vector<bool>> valueShares(
+      packedWidth, std::vector<bool>(numRows, 0));
+  for (size_t i = 0; i < numMetrics; ++i) {
+    valueShares.at(i * fieldWidth) = bitShares.at(start + i);
+  }
+  auto groupSums = aggregate<false, packedWidth, false>(
+      indexShares, valueShares, oramSize, oramFactory.create(oramSize));
+  // A total adds up the sums of distinct groups, so it is a sum over distinct
+  // rows whose fields don't carry into each other either
+  auto packedTotals = shareTotals(sumGroupTotals(groupSums, testOnly));
+
+  // Secret shares are XOR shares of each bit, so the bits of a field of a
+  // share are the shares of the sum of its metric
+  std::vector<uint64_t> packedShares;
+  for (auto& packedTotal : packedTotals) {
+    packedShares.push_back(
+        static_cast<uint64_t>(packedTotal.extractIntShare().getValue()));
+  }
+  std::vector<std::vector<SecInt<schedulerId, false, valueWidth>>> output;
+  for (size_t i = 0; i < numMetrics; ++i) {
+    std::vector<SecInt<schedulerId, false, valueWidth>> sums;
+    for (auto packedShare : packedShares) {
+      typename SecInt<schedulerId, false, valueWidth>::ExtractedInt sumShare(
+          static_cast<NativeIntp<false, valueWidth>>(
+              (packedShare >> (i * fieldWidth)) & fieldMask));
+      sums.push_back(
+          SecInt<schedulerId, false, valueWidth>(std::move(sumShare)));
+    }
+    output.push_back(std::move(sums));
+  }
+  return output;
+}
+
+template <int schedulerId, typename Widths>
+std::vector<SecInt<schedulerId, false, valueWidth>>
+Aggregator<schedulerId, Widths>::addAggregationOutputs(
+    const std::vector<std::vector<SecInt<schedulerId, false, valueWidth>>>&
+        aggregationOutputs,
+    size_t numMetrics,
+    size_t numTotals) const {
+  if (numMetrics == 0) {
+    // Without any metric every sum is 0, as an ORAM nothing was added to reads
+    std::vector<SecInt<schedulerId, false, valueWidth>> output;
+    for (size_t i = 0; i < numTotals; ++i) {
+      output.push_back(SecInt<schedulerId, false, valueWidth>(
+          NativeIntp<false, valueWidth>(0), common::PUBLISHER));
+    }
+    return output;
+  }
+  auto output = aggregationOutputs.at(0);
+  for (size_t i = 1; i < numMetrics; ++i) {
+    for (size_t j = 0; j < output.size(); ++j) {
+      output.at(j) = output.at(j) + aggregationOutputs.at(i).at(j);
+    }
+  }
+  return output;
+}
+
+template <int schedulerId, typename Widths>
+size_t Aggregator<schedulerId, Widths>::getNumTotals(bool testOnly) const {
+  const auto& processedData = inputProcessor_->getLiftGameProcessedData();
+  size_t numTotals = 1 + processedData.numPartnerCohorts +
+      processedData.numPublisherBreakdowns;
+  return testOnly ? numTotals : 2 * numTotals;
+}
+
+template <int schedulerId, typename Widths>
+template <typename T>
+std::vector<T> Aggregator<schedulerId, Widths>::sumGroupTotals(
+    const std::vector<T>& groupSums,
     bool testOnly) const {
-  std::vector<NativeIntp<isSigned, width>> testCohortOutput;
-  std::vector<NativeIntp<isSigned, width>> controlCohortOutput;
-  for (size_t i = 0;
-       i < inputProcessor_->getLiftGameProcessedData().numPartnerCohorts;
-       ++i) {
+  auto populationSums = sumPopulationOutput(groupSums, testOnly);
+  auto cohortSums = sumCohortOutput(groupSums, testOnly);
+  auto breakdownSums = sumBreakdownOutput(groupSums, testOnly);
+  std::vector<T> totals;
+  totals.reserve(getNumTotals(testOnly));
+  totals.push_back(std::move(populationSums.first));
+  if (!testOnly) {
+    totals.push_back(std::move(populationSums.second));
+  }
+  // The control sums are empty for test only metrics
+  for (auto sums : {&cohortSums.first,
+                    &cohortSums.second,
+                    &breakdownSums.first,
+                    &breakdownSums.second}) {
+    std::move(sums->begin(), sums->end(), std::back_inserter(totals));
+  }
+  return totals;
+}
+
+template <int schedulerId, typename Widths>
+template <typename T>
+std::pair<std::vector<T>, std::vector<T>>
+Aggregator<schedulerId, Widths>::sumCohortOutput(
+    const std::vector<T>& aggregationOutput,
+    bool testOnly) const {
+  const auto& processedData = inputProcessor_->getLiftGameProcessedData();
+  std::vector<T> testCohortOutput;
+  std::vector<T> controlCohortOutput;
+  for (size_t i = 0; i < processedData.numPartnerCohorts; ++i) {
     auto test = aggregationOutput.at(i);
-    SecInt<schedulerId, isSigned, width> control;
-    if (!testOnly) {
-      control = aggregationOutput.at(
-          i + inputProcessor_->getLiftGameProcessedData().numGroups / 2);
+    if (processedData.numPublisherBreakdowns > 0) {
+      test = test + aggregationOutput.at(i + processedData.numPartnerCohorts);
     }
-    if (inputProcessor_->getLiftGameProcessedData().numPublisherBreakdowns >
-        0) {
-      test = test +
-          aggregationOutput.at(
-              i +
-              inputProcessor_->getLiftGameProcessedData().numPartnerCohorts);
-      if (!testOnly) {
+    testCohortOutput.push_back(std::move(test));
+    if (!testOnly) {
+      auto control = aggregationOutput.at(i + processedData.numGroups / 2);
+      if (processedData.numPublisherBreakdowns > 0) {
         control = control +
             aggregationOutput.at(
-                i + inputProcessor_->getLiftGameProcessedData().numGroups / 2 +
-                inputProcessor_->getLiftGameProcessedData().numPartnerCohorts);
+                i + processedData.numGroups / 2 +
+                processedData.numPartnerCohorts);
       }
-    }
-    // Extract cohort metrics
-    testCohortOutput.push_back(test.extractIntShare().getValue());
-    if (!testOnly) {
-      controlCohortOutput.push_back(control.extractIntShare().getValue());
+      controlCohortOutput.push_back(std::move(control));
     }
   }
-  return std::make_pair(testCohortOutput, controlCohortOutput);
+  return std::make_pair(
+      std::move(testCohortOutput), std::move(controlCohortOutput));
 }
 
-template <int schedulerId>
-template <bool isSigned, int8_t width>
-std::pair<
-    std::vector<NativeIntp<isSigned, width>>,
-    std::vector<NativeIntp<isSigned, width>>>
-Aggregator<schedulerId>::revealBreakdownOutput(
-    std::vector<SecInt<schedulerId, isSigned, width>> aggregationOutput,
+template <int schedulerId, typename Widths>
+template <typename T>
+std::pair<std::vector<T>, std::vector<T>>
+Aggregator<schedulerId, Widths>::sumBreakdownOutput(
+    const std::vector<T>& aggregationOutput,
     bool testOnly) const {
-  std::vector<NativeIntp<isSigned, width>> testBreakdownOutput;
-  std::vector<NativeIntp<isSigned, width>> controlBreakdownOutput;
-  for (size_t j = 0;
-       j < inputProcessor_->getLiftGameProcessedData().numPublisherBreakdowns;
-       ++j) {
+  const auto& processedData = inputProcessor_->getLiftGameProcessedData();
+  std::vector<T> testBreakdownOutput;
+  std::vector<T> controlBreakdownOutput;
+  for (size_t j = 0; j < processedData.numPublisherBreakdowns; ++j) {
     // The order of the metrics are test and breakdown 0, test and
     // breakdown 1, control and breakdown 0, control and breakdown 1.
-    size_t testStartIndex =
-        j * inputProcessor_->getLiftGameProcessedData().numGroups / 4;
-    size_t controlStartIndex =
-        (2 + j) * inputProcessor_->getLiftGameProcessedData().numGroups / 4;
+    size_t testStartIndex = j * processedData.numGroups / 4;
+    size_t controlStartIndex = (2 + j) * processedData.numGroups / 4;
     // Initialize test/control metrics for the case where there are no partner
     // cohorts.
     auto test = aggregationOutput.at(testStartIndex);
-    SecInt<schedulerId, isSigned, width> control;
-    if (!testOnly) {
-      control = aggregationOutput.at(controlStartIndex);
-    }
-    for (size_t i = 1;
-         i < inputProcessor_->getLiftGameProcessedData().numPartnerCohorts;
-         ++i) {
+    for (size_t i = 1; i < processedData.numPartnerCohorts; ++i) {
       test = test + aggregationOutput.at(i + testStartIndex);
-      if (!testOnly) {
-        control = control + aggregationOutput.at(i + controlStartIndex);
-      }
     }
-    // Extract breakdown metrics
-    testBreakdownOutput.push_back(test.extractIntShare().getValue());
+    testBreakdownOutput.push_back(std::move(test));
     if (!testOnly) {
-      controlBreakdownOutput.push_back(control.extractIntShare().getValue());
+      auto control = aggregationOutput.at(controlStartIndex);
+      for (size_t i = 1; i < processedData.numPartnerCohorts; ++i) {
+        control = control + aggregationOutput.at(i + controlStartIndex);
+      }
+      controlBreakdownOutput.push_back(std::move(control));
     }
   }
-  return std::make_pair(testBreakdownOutput, controlBreakdownOutput);
+  return std::make_pair(
+      std::move(testBreakdownOutput), std::move(controlBreakdownOutput));
 }
 
-template <int schedulerId>
-template <bool isSigned, int8_t width>
-std::pair<NativeIntp<isSigned, width>, NativeIntp<isSigned, width>>
-Aggregator<schedulerId>::revealPopulationOutput(
-    std::vector<SecInt<schedulerId, isSigned, width>> aggregationOutput,
+template <int schedulerId, typename Widths>
+template <typename T>
+std::pair<T, T> Aggregator<schedulerId, Widths>::sumPopulationOutput(
+    const std::vector<T>& aggregationOutput,
     bool testOnly) const {
   // Initialize test/control metrics for the case where there are no partner
   // cohorts
@@ -547,12 +626,7 @@ Aggregator<schedulerId>::revealPopulationOutput(
               i + inputProcessor_->getLiftGameProcessedData().numGroups / 2);
     }
   }
-  auto testOutput = test.extractIntShare().getValue();
-  NativeIntp<isSigned, width> controlOutput(0);
-  if (!testOnly) {
-    controlOutput = control.extractIntShare().getValue();
-  }
-  return std::make_pair(testOutput, controlOutput);
+  return std::make_pair(std::move(test), std::move(control));
 }
 
 } // namespace private_lift
@@ -10,21 +10,32 @@
 #include "folly/logging/xlog.h"
 
 #include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/LiftMetricSet.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/IInputProcessor.h"
 
 namespace private_lift {
 
-template <int schedulerId>
+// Attributes the conversions of a game, with the purchase values and their
+// squares narrowed to the widths of Widths. The optional metrics left out of
+// metrics aren't attributed.
+template <int schedulerId, typename Widths = DefaultValueWidths>
 class Attributor {
  public:
+  using SecAttributedValue = SecValueOfWidth<schedulerId, Widths::kValueWidth>;
+  using SecAttributedValueSquared =
+      SecValueOfWidth<schedulerId, Widths::kValueSquaredWidth>;
+
   Attributor(
       int myRole,
-      std::shared_ptr<IInputProcessor<schedulerId>> inputProcessor)
-      : myRole_{myRole}, inputProcessor_{inputProcessor} {
+      std::shared_ptr<IInputProcessor<schedulerId>> inputProcessor,
+      LiftMetricSet metrics = LiftMetricSet{})
+      : myRole_{myRole}, inputProcessor_{inputProcessor}, metrics_{metrics} {
     calculateEvents();
     calculateNumConvSquaredAndValueSquaredAndConverters();
     calculateMatch();
-    calculateReachedConversions();
+    if (metrics_.reached) {
+      calculateReachedConversions();
+    }
     calculateValues();
   }
 
@@ -48,25 +59,28 @@ class Attributor {
     return reachedConversions_;
   }
 
-  const std::vector<SecValue<schedulerId>> getValues() const {
+  const std::vector<SecAttributedValue> getValues() const {
     return values_;
   }
 
-  const std::vector<SecValue<schedulerId>> getReachedValues() const {
+  const std::vector<SecAttributedValue> getReachedValues() const {
     return reachedValues_;
   }
 
-  const SecValueSquared<schedulerId> getValueSquared() const {
+  const SecAttributedValueSquared getValueSquared() const {
     return valueSquared_;
   }
 
  private:
-  // Test/Control events: validPurchase (oppTs < purchaseTs + 10)
+  // Test/Control events: validPurchase (oppTs < purchaseTs + 10), compared at
+  // narrowTimeStampWidth when the timestamps are relative ones which fit it.
+  // All the conversion slots are compared in one batch.
   void calculateEvents();
 
   // Test/Control numConvSquared: number of valid events squared
   // Test/Control converters: any valid event
-  // Test/Control value squared: sum(valid event ? purchaseValue : 0)^2
+  // Test/Control value squared: sum(valid event ? purchaseValue : 0)^2, if
+  // it is in metrics_
   void calculateNumConvSquaredAndValueSquaredAndConverters();
 
   // Test/control match: valid opportunity timestamp & any valid purchase
@@ -77,20 +91,32 @@ class Attributor {
   void calculateReachedConversions();
 
   // Test/control value: valid event ? purchaseValue : 0
-  // Test reached value: isReached ? purchaseValue : 0
+  // Test reached value: isReached ? purchaseValue : 0, if it is in metrics_
   void calculateValues();
 
+  // The same value at width, which is computed locally from the shares of its
+  // bits. The value has to fit width. Returns value itself at its own width.
+  template <int8_t width, int8_t fromWidth>
+  static decltype(auto) narrow(
+      const SecValueOfWidth<schedulerId, fromWidth>& value);
+
+  // The low narrowTimeStampWidth bits of a timestamp, which are computed
+  // locally from the shares of its bits
+  static SecNarrowTimestamp<schedulerId> narrowTimestamp(
+      const SecTimestamp<schedulerId>& timestamp);
+
   int32_t myRole_;
   std::shared_ptr<IInputProcessor<schedulerId>> inputProcessor_;
+  LiftMetricSet metrics_;
 
   std::vector<SecBit<schedulerId>> events_;
   SecBit<schedulerId> converters_;
   SecNumConvSquared<schedulerId> numConvSquared_;
   SecBit<schedulerId> match_;
   std::vector<SecBit<schedulerId>> reachedConversions_;
-  std::vector<SecValue<schedulerId>> values_;
-  std::vector<SecValue<schedulerId>> reachedValues_;
-  SecValueSquared<schedulerId> valueSquared_;
+  std::vector<SecAttributedValue> values_;
+  std::vector<SecAttributedValue> reachedValues_;
+  SecAttributedValueSquared valueSquared_;
 };
 
 } // namespace private_lift
@@ -7,116 +7,180 @@
 
 #pragma once
 
+#include <iterator>
+#include <memory>
+#include <vector>
+
 #include "fbpcs/emp_games/lift/pcf2_calculator/Attributor.h"
 
 namespace private_lift {
 
-template <int schedulerId>
-void Attributor<schedulerId>::calculateEvents() {
+template <int schedulerId, typename Widths>
+template <int8_t width, int8_t fromWidth>
+decltype(auto) Attributor<schedulerId, Widths>::narrow(
+    const SecValueOfWidth<schedulerId, fromWidth>& value) {
+  if constexpr (width == fromWidth) {
+    return (value);
+  } else {
+    // Secret shares are XOR shares of each bit, so the low bits of the shares
+    // are the shares of the low bits, which are sign extended the same way on
+    // both sides
+    auto shares = value.extractIntShare().getValue();
+    for (auto& share : shares) {
+      auto lowBits = static_cast<uint64_t>(share) << (64 - width);
+      share = static_cast<int64_t>(lowBits) >> (64 - width);
+    }
+    return SecValueOfWidth<schedulerId, width>(
+        typename SecValueOfWidth<schedulerId, width>::ExtractedInt(
+            std::move(shares)));
+  }
+}
+
+template <int schedulerId, typename Widths>
+SecNarrowTimestamp<schedulerId>
+Attributor<schedulerId, Widths>::narrowTimestamp(
+    const SecTimestamp<schedulerId>& timestamp) {
+  // As for values, the low bits of the shares are the shares of the low bits
+  auto shares = timestamp.extractIntShare().getValue();
+  for (auto& share : shares) {
+    share &= (uint64_t(1) << narrowTimeStampWidth) - 1;
+  }
+  return SecNarrowTimestamp<schedulerId>(
+      typename SecNarrowTimestamp<schedulerId>::ExtractedInt(
+          std::move(shares)));
+}
+
+template <int schedulerId, typename Widths>
+void Attributor<schedulerId, Widths>::calculateEvents() {
   XLOG(INFO) << "Calculate events";
-  for (const SecTimestamp<schedulerId>& thresholdTs :
-       inputProcessor_->getLiftGameProcessedData().thresholdTimestamps) {
-    // Events occur when there is a valid purchase, i.e. the opportunity
-    // timestamp is less than the threshold timestamp
-    events_.push_back(std::move(
-        inputProcessor_->getLiftGameProcessedData()
-            .isValidOpportunityTimestamp &
-        (thresholdTs >
-         inputProcessor_->getLiftGameProcessedData().opportunityTimestamps)));
+  const auto& processedData = inputProcessor_->getLiftGameProcessedData();
+  auto numSlots = processedData.thresholdTimestamps.size();
+  if (numSlots == 0) {
+    return;
+  }
+  // Events occur when there is a valid purchase, i.e. the opportunity
+  // timestamp is less than the threshold timestamp. The conversion slots are
+  // batched one after another, so that the events of all of them take one
+  // comparison and one AND, and are split back into slots.
+  auto calculateBatchedEvents = [&](const auto& opportunityTimestamps,
+                                    const auto& thresholdTimestamps) {
+    auto thresholdBatch = thresholdTimestamps.at(0).batchingWith(std::vector(
+        std::next(thresholdTimestamps.begin()), thresholdTimestamps.end()));
+    auto opportunityBatch = opportunityTimestamps.batchingWith(
+        std::vector(numSlots - 1, opportunityTimestamps));
+    auto isValidBatch = processedData.isValidOpportunityTimestamp.batchingWith(
+        std::vector(numSlots - 1, processedData.isValidOpportunityTimestamp));
+    events_ = (isValidBatch & (thresholdBatch > opportunityBatch))
+                  .unbatching(std::make_shared<std::vector<uint32_t>>(
+                      numSlots, processedData.numRows));
+  };
+  if (processedData.timestampBits <= narrowTimeStampWidth) {
+    XLOG(INFO) << "Comparing timestamps at " << narrowTimeStampWidth
+               << " bits";
+    std::vector<SecNarrowTimestamp<schedulerId>> thresholdTimestamps;
+    thresholdTimestamps.reserve(numSlots);
+    for (const auto& thresholdTs : processedData.thresholdTimestamps) {
+      thresholdTimestamps.push_back(narrowTimestamp(thresholdTs));
+    }
+    calculateBatchedEvents(
+        narrowTimestamp(processedData.opportunityTimestamps),
+        thresholdTimestamps);
+  } else {
+    calculateBatchedEvents(
+        processedData.opportunityTimestamps,
+        processedData.thresholdTimestamps);
   }
 }
 
-template <int schedulerId>
-void Attributor<
-    schedulerId>::calculateNumConvSquaredAndValueSquaredAndConverters() {
+template <int schedulerId, typename Widths>
+void Attributor<schedulerId, Widths>::
+    calculateNumConvSquaredAndValueSquaredAndConverters() {
   XLOG(INFO) << "Calculate numConvSquared & valueSquared & converters";
-  if (events_.size() !=
-      inputProcessor_->getLiftGameProcessedData().purchaseValueSquared.size()) {
+  if (metrics_.valueSquared &&
+      events_.size() !=
+          inputProcessor_->getLiftGameProcessedData()
+              .purchaseValueSquared.size()) {
     XLOG(FATAL)
         << "Numbers of event bits and purchase values squared are inconsistent.";
   }
-  // We find the first valid event using a binary tree approach. The number of
-  // conversions is the remaining number of elements in the array. The value
-  // squared is the squared sum of the values for valid events in each row.
-  // These sums are already precomputed, so it suffices to check for the first
-  // valid event and use the sum corresponding to the position in the row.
-
-  // We first construct new arrays to store the intermediate results
-  std::vector<SecNumConvSquared<schedulerId>> numConvSquaredArray;
-  for (size_t i = 0; i < events_.size(); ++i) {
-    auto numConv = events_.size() - i;
-    auto convSquared = static_cast<uint32_t>(numConv * numConv);
-    SecNumConvSquared<schedulerId> numConvSquared(
-        std::vector(
-            inputProcessor_->getLiftGameProcessedData().numRows, convSquared),
-        common::PUBLISHER);
-    numConvSquaredArray.push_back(numConvSquared);
+  // The number of conversions is the number of elements from the first valid
+  // event to the end of the row. The value squared is the squared sum of the
+  // values for valid events in each row. These sums are already precomputed,
+  // so it suffices to find the first valid event and use the sum at its
+  // position in the row. Both are zero if there are no valid events.
+  auto numRows = inputProcessor_->getLiftGameProcessedData().numRows;
+  auto numEvents = events_.size();
+  if (numEvents == 0) {
+    converters_ = SecBit<schedulerId>{
+        std::vector<bool>(numRows, false), common::PUBLISHER};
+    numConvSquared_ = SecNumConvSquared<schedulerId>{
+        std::vector<uint32_t>(numRows, 0), common::PUBLISHER};
+    valueSquared_ = SecAttributedValueSquared{
+        std::vector<int64_t>(numRows, 0), common::PUBLISHER};
+    return;
   }
-  // The numConvSquared is zero if there are no valid events
-  SecNumConvSquared<schedulerId> zero{
-      std::vector<uint32_t>(
-          inputProcessor_->getLiftGameProcessedData().numRows, 0),
-      common::PUBLISHER};
-  numConvSquaredArray.push_back(zero);
-
-  std::vector<SecValueSquared<schedulerId>> valueSquaredArray =
-      inputProcessor_->getLiftGameProcessedData().purchaseValueSquared;
-  // The value squared is zero if there are no valid events
-  SecValueSquared<schedulerId> zeroValueSquared{
-      std::vector<int64_t>(
-          inputProcessor_->getLiftGameProcessedData().numRows, 0),
-      common::PUBLISHER};
-  valueSquaredArray.push_back(zeroValueSquared);
-
-  std::vector<SecBit<schedulerId>> eventArray = events_;
-  SecBit<schedulerId> zeroBit{
-      std::vector<bool>(
-          inputProcessor_->getLiftGameProcessedData().numRows, false),
-      common::PUBLISHER};
-  eventArray.push_back(zeroBit);
-
-  int stepSize = 1; // we process the array elements in pairs with indices
-                    // differing by stepSize
-  auto firstIndex = 0ULL; // first index at this level
-  while (firstIndex < eventArray.size() / 2) {
-    for (size_t i = firstIndex; i < eventArray.size(); i += 2 * stepSize) {
-      if (i + stepSize < eventArray.size()) {
-        // If there is a valid event at i, we set the numConvSquared to be
-        // numConvSquared[i], else we set it to be numConvSquared[i + stepSize]
-        numConvSquaredArray[i + stepSize] =
-            numConvSquaredArray.at(i + stepSize)
-                .mux(eventArray.at(i), numConvSquaredArray.at(i));
-        // The same logic applies for the valueSquared
-        valueSquaredArray[i + stepSize] =
-            valueSquaredArray.at(i + stepSize)
-                .mux(eventArray.at(i), valueSquaredArray.at(i));
-        // Update the events for the next level
-        eventArray[i + stepSize] =
-            eventArray.at(i + stepSize) | eventArray.at(i);
-      } else {
-        // Odd number of elements at this level, compute the mux with the
-        // previous pair
-        auto previousIndex = i - stepSize;
-        numConvSquaredArray[previousIndex] = numConvSquaredArray.at(i).mux(
-            eventArray.at(previousIndex),
-            numConvSquaredArray.at(previousIndex));
-        valueSquaredArray[previousIndex] = valueSquaredArray.at(i).mux(
-            eventArray.at(previousIndex), valueSquaredArray.at(previousIndex));
-        eventArray[previousIndex] =
-            eventArray.at(previousIndex) | eventArray.at(i);
+
+  // Whether there is a valid event at or before each position, as a prefix OR
+  // over a binary tree of the positions, so its depth grows with
+  // log(numEvents). At each level the positions of the upper half of a block
+  // take the OR of the last position of the lower half.
+  std::vector<SecBit<schedulerId>> anyEvent = events_;
+  for (size_t step = 1; step < numEvents; step <<= 1) {
+    for (size_t i = step; i < numEvents; ++i) {
+      if (i & step) {
+        auto lowerHalfEnd = (i & ~(2 * step - 1)) + step - 1;
+        anyEvent[i] = anyEvent.at(i) | anyEvent.at(lowerHalfEnd);
       }
     }
-    firstIndex += stepSize;
-    stepSize = stepSize << 1;
   }
-  valueSquared_ = valueSquaredArray.at(firstIndex);
-  numConvSquared_ = numConvSquaredArray.at(firstIndex);
   // A converter occurs when a row contains any valid event
-  converters_ = eventArray.at(firstIndex);
+  converters_ = anyEvent.at(numEvents - 1);
+
+  // At most one of the first valid events of a row is set, so a selection by
+  // them is the XOR of the selected values. XOR is free on the secret shares,
+  // and so is the AND of a share with a public number of conversions squared,
+  // so numConvSquared is computed directly from the shares of the first valid
+  // events. Only the secret values squared take a mux per position.
+  std::vector<uint64_t> numConvSquaredShares(numRows, 0);
+  std::vector<int64_t> valueSquaredShares(numRows, 0);
+  auto zeroValueSquared =
+      PubValueOfWidth<schedulerId, Widths::kValueSquaredWidth>(
+          std::vector<int64_t>(numRows, 0));
+  for (size_t i = 0; i < numEvents; ++i) {
+    auto firstEvent =
+        i == 0 ? events_.at(i) : events_.at(i) & !anyEvent.at(i - 1);
+    auto numConv = numEvents - i;
+    auto convSquared = static_cast<uint32_t>(numConv * numConv);
+    auto firstEventShares = firstEvent.extractBit().getValue();
+    for (size_t row = 0; row < numRows; ++row) {
+      if (firstEventShares.at(row)) {
+        numConvSquaredShares[row] ^= convSquared;
+      }
+    }
+    if (!metrics_.valueSquared) {
+      continue;
+    }
+
+    auto valueSquared = zeroValueSquared.mux(
+        firstEvent,
+        narrow<Widths::kValueSquaredWidth, valueSquaredWidth>(
+            inputProcessor_->getLiftGameProcessedData().purchaseValueSquared.at(
+                i)));
+    auto valueSquaredShare = valueSquared.extractIntShare().getValue();
+    for (size_t row = 0; row < numRows; ++row) {
+      valueSquaredShares[row] ^= valueSquaredShare.at(row);
+    }
+  }
+  numConvSquared_ = SecNumConvSquared<schedulerId>(
+      typename SecNumConvSquared<schedulerId>::ExtractedInt(
+          std::move(numConvSquaredShares)));
+  valueSquared_ = SecAttributedValueSquared(
+      typename SecAttributedValueSquared::ExtractedInt(
+          std::move(valueSquaredShares)));
 }
 
-template <int schedulerId>
-void Attributor<schedulerId>::calculateMatch() {
+template <int schedulerId, typename Widths>
+void Attributor<schedulerId, Widths>::calculateMatch() {
   XLOG(INFO) << "Calculate match";
   // a valid test/control match is when a person with an opportunity made
   // ANY nonzero conversion.
@@ -125,8 +189,8 @@ void Attributor<schedulerId>::calculateMatch() {
       inputProcessor_->getLiftGameProcessedData().isValidOpportunityTimestamp;
 }
 
-template <int schedulerId>
-void Attributor<schedulerId>::calculateReachedConversions() {
+template <int schedulerId, typename Widths>
+void Attributor<schedulerId, Widths>::calculateReachedConversions() {
   XLOG(INFO) << "Calculate reached conversions";
   for (const auto& event : events_) {
     // A reached conversion is when there is a reach (number of impressions > 0)
@@ -136,24 +200,30 @@ void Attributor<schedulerId>::calculateReachedConversions() {
   }
 }
 
-template <int schedulerId>
-void Attributor<schedulerId>::calculateValues() {
+template <int schedulerId, typename Widths>
+void Attributor<schedulerId, Widths>::calculateValues() {
   XLOG(INFO) << "Calculate values";
   if (events_.size() !=
       inputProcessor_->getLiftGameProcessedData().purchaseValues.size()) {
     XLOG(FATAL)
         << "Numbers of event bits and/or purchase values are inconsistent.";
   }
-  auto zero = PubValue<schedulerId>(std::vector<int64_t>(
-      inputProcessor_->getLiftGameProcessedData().numRows, 0));
+  auto zero = PubValueOfWidth<schedulerId, Widths::kValueWidth>(
+      std::vector<int64_t>(
+          inputProcessor_->getLiftGameProcessedData().numRows, 0));
   for (size_t i = 0; i < events_.size(); ++i) {
     // The value is the purchase value if there is a valid event, otherwise it
     // is zero
     values_.push_back(std::move(zero.mux(
         events_.at(i),
-        inputProcessor_->getLiftGameProcessedData().purchaseValues.at(i))));
+        narrow<Widths::kValueWidth, valueWidth>(
+            inputProcessor_->getLiftGameProcessedData().purchaseValues.at(
+                i)))));
   }
 
+  if (!metrics_.reached) {
+    return;
+  }
   XLOG(INFO) << "Calculate reached values";
   // A reached value is the value when there is a reach, otherwise it is zero.
   // This is only calculated for the test population.
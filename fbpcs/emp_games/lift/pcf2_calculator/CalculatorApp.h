@@ -7,16 +7,21 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstdlib>
 #include <filesystem>
+#include <optional>
 #include <string>
+#include <vector>
 #include "folly/logging/xlog.h"
 
 #include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
 #include "fbpcf/scheduler/SchedulerHelper.h"
 #include "fbpcs/emp_games/common/SchedulerStatistics.h"
+#include "fbpcs/emp_games/common/ShardQueue.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/CalculatorGame.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/CalculatorGameConfig.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/LiftMetricSet.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/InputData.h"
 
 namespace private_lift {
@@ -41,7 +46,15 @@ class CalculatorApp {
       std::shared_ptr<fbpcf::util::MetricCollector> metricCollector,
       const int startFileIndex = 0,
       const int numFiles = 1,
-      const bool useXorEncryption = true)
+      const bool useXorEncryption = true,
+      const bool useBinarySecretShares = false,
+      const int numParseThreads = 1,
+      std::shared_ptr<common::ShardQueue> shardQueue = nullptr,
+      const bool useShardCache = false,
+      const bool useFusedCompaction = false,
+      const std::chrono::seconds inputWaitTimeout = std::chrono::seconds{0},
+      const bool useRelativeTimestamps = false,
+      const LiftMetricSet metrics = LiftMetricSet{})
       : party_{party},
         communicationAgentFactory_{std::move(communicationAgentFactory)},
         numConversionsPerUser_(numConversionsPerUser),
@@ -56,7 +69,15 @@ class CalculatorApp {
         metricCollector_(metricCollector),
         startFileIndex_(startFileIndex),
         numFiles_(numFiles),
-        useXorEncryption_(useXorEncryption) {}
+        useXorEncryption_(useXorEncryption),
+        useBinarySecretShares_(useBinarySecretShares),
+        numParseThreads_(numParseThreads),
+        shardQueue_(std::move(shardQueue)),
+        useShardCache_(useShardCache),
+        useFusedCompaction_(useFusedCompaction),
+        inputWaitTimeout_(inputWaitTimeout),
+        useRelativeTimestamps_(useRelativeTimestamps),
+        metrics_(metrics) {}
 
   void run();
 
@@ -69,9 +90,21 @@ class CalculatorApp {
 
   void putOutputData(const std::string& output, const std::string& outputPath);
 
+  // The inputs and config which the output of a shard depends on, for its key
+  // in the shard cache
+  std::vector<std::string> getShardCacheInputPaths(std::size_t i) const;
+  std::string getShardCacheConfig() const;
+
   std::unique_ptr<fbpcf::scheduler::IScheduler> createScheduler();
 
  private:
+  // The input of a shard, which has no config when the game reads it from
+  // secret shares, or when the shard is in the cache and isn't computed
+  struct ShardInput {
+    bool isCached = false;
+    std::optional<CalculatorGameConfig> config;
+  };
+
   int party_;
   std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgentFactory>
       communicationAgentFactory_;
@@ -88,6 +121,21 @@ class CalculatorApp {
   int startFileIndex_;
   int numFiles_;
   bool useXorEncryption_;
+  const bool useBinarySecretShares_;
+  const int numParseThreads_;
+  std::shared_ptr<common::ShardQueue> shardQueue_;
+  const bool useShardCache_;
+  // Whether plaintext inputs go through the metadata compaction in this app,
+  // instead of being read as secret shares it wrote
+  const bool useFusedCompaction_;
+  // How long to wait for the inputs of a shard to arrive, if positive, see
+  // common/InputArrival.h
+  const std::chrono::seconds inputWaitTimeout_;
+  // Whether plaintext inputs share their timestamps relative to the earliest
+  // opportunity, see InputProcessor
+  const bool useRelativeTimestamps_;
+  // The optional metrics which are computed, see LiftMetricSet
+  const LiftMetricSet metrics_;
   common::SchedulerStatistics schedulerStatistics_;
 };
 
@@ -8,41 +8,48 @@
 #include <fbpcf/io/api/FileIOWrappers.h>
 #include <fbpcf/scheduler/LazySchedulerFactory.h>
 #include <fbpcf/scheduler/NetworkPlaintextSchedulerFactory.h>
+#include <folly/Format.h>
+#include <optional>
+#include <string>
 #include <vector>
 
+#include "fbpcs/emp_games/common/CompressedIO.h"
+#include "fbpcs/emp_games/common/FilePipeline.h"
+#include "fbpcs/emp_games/common/InputArrival.h"
+#include "fbpcs/emp_games/common/SchedulerPhase.h"
+#include "fbpcs/emp_games/common/ShardCache.h"
+#include "fbpcs/emp_games/common/ShardReport.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/CalculatorApp.h"
 
 namespace private_lift {
 
 template <int schedulerId>
 void CalculatorApp<schedulerId>::run() {
-  // Run calculator game sequentially on numFiles files, starting from
-  // startFileIndex
+  // Run calculator game sequentially on the files taken from shardQueue_ if
+  // there is one, otherwise on numFiles files starting from startFileIndex
   auto scheduler = createScheduler();
+  // The agents agreeing on the files and on the shards in the cache with the
+  // other party are created before the game takes the communication agent
+  // factory
+  auto files = shardQueue_ == nullptr
+      ? common::ShardAssignment(startFileIndex_, numFiles_)
+      : common::ShardAssignment(
+            party_, shardQueue_, *communicationAgentFactory_);
+  std::unique_ptr<common::ShardCache> shardCache;
+  if (useShardCache_) {
+    shardCache = std::make_unique<common::ShardCache>(
+        party_, getShardCacheConfig(), *communicationAgentFactory_);
+  }
   CalculatorGame<schedulerId> game{
-      party_, std::move(scheduler), std::move(communicationAgentFactory_)};
+      party_,
+      std::move(scheduler),
+      std::move(communicationAgentFactory_),
+      metrics_};
 
-  for (size_t i = startFileIndex_; i < startFileIndex_ + numFiles_; ++i) {
+  // Any exception ends the run, naming the shard it was raised on
+  auto exitOnError = [this](std::size_t i, auto&& stage) {
     try {
-      CHECK_LT(i, inputPaths_.size()) << "File index exceeds number of files.";
-      std::string output;
-      if (!readInputFromSecretShares_) {
-        CalculatorGameConfig config = getInputData(inputPaths_.at(i));
-        auto numRows = config.inputData.getNumRows();
-        XLOG(INFO) << "Have " << numRows << " values in inputData.";
-        output = game.play(config);
-      } else {
-        XLOG(INFO) << "Reading input data from secret shares.";
-        output = game.playFromSecretShares(
-            inputGlobalParamsPath_,
-            inputExpandedKeyPath_,
-            inputPaths_.at(i),
-            useDecoupledUDP_,
-            numConversionsPerUser_);
-      }
-
-      XLOG(INFO) << "done calculating";
-      putOutputData(output, outputPaths_.at(i));
+      return stage();
     } catch (const std::exception& e) {
       XLOGF(
           ERR,
@@ -51,7 +58,95 @@ void CalculatorApp<schedulerId>::run() {
           inputPaths_.at(i));
       std::exit(1);
     }
-  }
+  };
+
+  // The input of the next file is parsed and the output of the previous one
+  // written while the game runs on a file. Secret shares are read by the game
+  // itself, so only their outputs are written in the background. The shards
+  // in the cache are also looked up in the background, as that only uses the
+  // agent of the cache, and have no output to write. The reports of cached
+  // shards are those of the run which computed them.
+  common::ShardReporter reporter;
+  common::runFilesPipelined<ShardInput, std::optional<std::string>>(
+      files,
+      [this, &exitOnError, &shardCache, &reporter](std::size_t i) {
+        CHECK_LT(i, inputPaths_.size())
+            << "File index exceeds number of files.";
+        return exitOnError(i, [&]() -> ShardInput {
+          if (inputWaitTimeout_.count() > 0) {
+            common::waitForInputs(
+                getShardCacheInputPaths(i), inputWaitTimeout_);
+          }
+          fbpcs::performance_tools::ScopedPhase phase{"input_parsing"};
+          if (shardCache != nullptr &&
+              shardCache->isComputed(
+                  getShardCacheInputPaths(i),
+                  common::shardCacheStampPath(outputPaths_.at(i)))) {
+            return ShardInput{true, std::nullopt};
+          }
+          common::ShardReporter::Phase shardPhase{reporter, i, "input_parsing"};
+          reporter.setInputPaths(i, getShardCacheInputPaths(i));
+          if (readInputFromSecretShares_) {
+            return ShardInput{};
+          }
+          auto config = getInputData(inputPaths_.at(i));
+          reporter.setNumRows(i, config.inputData.getNumRows());
+          return ShardInput{false, std::move(config)};
+        });
+      },
+      [this, &game, &exitOnError, &reporter](std::size_t i, ShardInput input) {
+        return exitOnError(i, [&]() -> std::optional<std::string> {
+          if (input.isCached) {
+            return std::nullopt;
+          }
+          fbpcs::performance_tools::ScopedPhase phase{
+              "lift", common::getSchedulerCounterReader<schedulerId>()};
+          common::ShardReporter::Phase shardPhase{
+              reporter,
+              i,
+              "lift",
+              common::getSchedulerCounterReader<schedulerId>()};
+          auto& config = input.config;
+          std::string output;
+          if (config.has_value()) {
+            auto numRows = config->inputData.getNumRows();
+            XLOG(INFO) << "Have " << numRows << " values in inputData.";
+            output = useFusedCompaction_ ? game.playWithCompaction(*config)
+                                         : game.play(*config);
+          } else {
+            XLOG(INFO) << "Reading input data from secret shares.";
+            output = game.playFromSecretShares(
+                inputGlobalParamsPath_,
+                inputExpandedKeyPath_,
+                inputPaths_.at(i),
+                useDecoupledUDP_,
+                numConversionsPerUser_,
+                useBinarySecretShares_,
+                numParseThreads_);
+          }
+          XLOG(INFO) << "done calculating";
+          return output;
+        });
+      },
+      [this, &exitOnError, &shardCache, &reporter](
+          std::size_t i, std::optional<std::string> output) {
+        if (!output.has_value()) {
+          return;
+        }
+        exitOnError(i, [&]() {
+          {
+            fbpcs::performance_tools::ScopedPhase phase{"output_writing"};
+            common::ShardReporter::Phase shardPhase{
+                reporter, i, "output_writing"};
+            putOutputData(*output, outputPaths_.at(i));
+          }
+          reporter.finish(i, outputPaths_.at(i));
+          if (shardCache != nullptr) {
+            shardCache->markComputed(
+                common::shardCacheStampPath(outputPaths_.at(i)));
+          }
+        });
+      });
 
   auto gateStatistics =
       fbpcf::scheduler::SchedulerKeeper<schedulerId>::getGateStatistics();
@@ -87,8 +182,10 @@ CalculatorGameConfig CalculatorApp<schedulerId>::getInputData(
       InputData::LiftMPCType::Standard,
       computePublisherBreakdowns_,
       epoch_,
-      numConversionsPerUser_};
-  CalculatorGameConfig config = {inputData, true, numConversionsPerUser_};
+      numConversionsPerUser_,
+      numParseThreads_};
+  CalculatorGameConfig config = {
+      inputData, true, numConversionsPerUser_, useRelativeTimestamps_};
   return config;
 }
 
@@ -97,16 +194,49 @@ void CalculatorApp<schedulerId>::putOutputData(
     const std::string& output,
     const std::string& outputPath) {
   XLOG(INFO) << "putting out data...";
-  fbpcf::io::FileIOWrappers::writeFile(outputPath, output);
+  private_measurement::compressed_io::writeFile(outputPath, output);
+}
+
+template <int schedulerId>
+std::vector<std::string> CalculatorApp<schedulerId>::getShardCacheInputPaths(
+    std::size_t i) const {
+  if (!readInputFromSecretShares_) {
+    return {inputPaths_.at(i)};
+  }
+  std::vector<std::string> inputPaths{
+      inputPaths_.at(i), inputGlobalParamsPath_};
+  if (useDecoupledUDP_) {
+    inputPaths.push_back(inputExpandedKeyPath_);
+  }
+  return inputPaths;
+}
+
+template <int schedulerId>
+std::string CalculatorApp<schedulerId>::getShardCacheConfig() const {
+  return folly::sformat(
+      "pcf2_lift_calculator {} {} {} {} {} {} {} {} {} {} {}",
+      numConversionsPerUser_,
+      computePublisherBreakdowns_,
+      epoch_,
+      readInputFromSecretShares_,
+      useDecoupledUDP_,
+      useXorEncryption_,
+      useBinarySecretShares_,
+      useFusedCompaction_,
+      useRelativeTimestamps_,
+      metrics_.valueSquared,
+      metrics_.reached);
 }
 
 template <int schedulerId>
 std::unique_ptr<fbpcf::scheduler::IScheduler>
 CalculatorApp<schedulerId>::createScheduler() {
   return useXorEncryption_
-      ? fbpcf::scheduler::getLazySchedulerFactoryWithRealEngine(
-            party_, *communicationAgentFactory_, metricCollector_)
-            ->create()
+      ? common::createRealScheduler(
+            common::getSchedulerHints(kSchedulerHints),
+            party_,
+            *communicationAgentFactory_,
+            metricCollector_)
       : fbpcf::scheduler::NetworkPlaintextSchedulerFactory<false>(
             party_, *communicationAgentFactory_, metricCollector_)
             .create();
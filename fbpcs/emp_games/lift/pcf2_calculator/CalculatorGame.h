@@ -13,6 +13,8 @@
 #include "fbpcs/emp_games/lift/pcf2_calculator/Aggregator.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/Attributor.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/CalculatorGameConfig.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/LiftMetricSet.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/CompactionBasedInputProcessorFactory.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/DecoupledUDPInputProcessor.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/InputData.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/InputProcessor.h"
@@ -27,10 +29,12 @@ class CalculatorGame : public fbpcf::frontend::MpcGame<schedulerId> {
       std::unique_ptr<fbpcf::scheduler::IScheduler> scheduler,
       std::shared_ptr<
           fbpcf::engine::communication::IPartyCommunicationAgentFactory>
-          communicationAgentFactory)
+          communicationAgentFactory,
+      LiftMetricSet metrics = LiftMetricSet{})
       : fbpcf::frontend::MpcGame<schedulerId>(std::move(scheduler)),
         party_{party},
-        communicationAgentFactory_(communicationAgentFactory) {}
+        communicationAgentFactory_(communicationAgentFactory),
+        metrics_{metrics} {}
 
   std::string play(const CalculatorGameConfig& config) {
     if (config.inputData.getNumRows() == 0) {
@@ -39,18 +43,27 @@ class CalculatorGame : public fbpcf::frontend::MpcGame<schedulerId> {
       return GroupedLiftMetrics().toJson();
     }
 
-    auto inputProcessor = InputProcessor<schedulerId>(
-        party_, config.inputData, config.numConversionsPerUser);
-    auto attributor = std::make_unique<Attributor<schedulerId>>(
-        party_, std::make_unique<InputProcessor<schedulerId>>(inputProcessor));
-    auto aggregator = Aggregator<schedulerId>(
-        party_,
-        std::make_unique<InputProcessor<schedulerId>>(
-            std::move(inputProcessor)),
-        std::move(attributor),
-        config.numConversionsPerUser,
-        communicationAgentFactory_);
-    return aggregator.toJson();
+    std::shared_ptr<IInputProcessor<schedulerId>> inputProcessor =
+        std::make_shared<InputProcessor<schedulerId>>(
+            party_,
+            config.inputData,
+            config.numConversionsPerUser,
+            config.useRelativeTimestamps);
+    return calculate(inputProcessor, config.numConversionsPerUser);
+  }
+
+  // Runs the metadata compaction of the input data before the calculation, in
+  // place of the separate metadata compaction stage. The secret shares of
+  // the compacted data are handed to the calculation in memory.
+  std::string playWithCompaction(const CalculatorGameConfig& config) {
+    std::shared_ptr<IInputProcessor<schedulerId>> inputProcessor =
+        makeCompactionBasedInputProcessor<schedulerId>(
+            party_,
+            *communicationAgentFactory_,
+            config.inputData,
+            config.numConversionsPerUser);
+    return playFromInputProcessor(
+        inputProcessor, config.numConversionsPerUser);
   }
 
   std::string playFromSecretShares(
@@ -58,7 +71,9 @@ class CalculatorGame : public fbpcf::frontend::MpcGame<schedulerId> {
       const std::string& inputExpandedKeyPath,
       const std::string& inputPath,
       bool useDecoupledUDP,
-      size_t numConversionPerUser) {
+      size_t numConversionPerUser,
+      bool useBinarySecretShares = false,
+      size_t numParseThreads = 1) {
     std::shared_ptr<IInputProcessor<schedulerId>> inputProcessor;
     if (useDecoupledUDP) {
       inputProcessor =
@@ -69,9 +84,21 @@ class CalculatorGame : public fbpcf::frontend::MpcGame<schedulerId> {
               inputPath,
               numConversionPerUser);
     } else {
+      // Only the columns of the metrics computed are loaded
       inputProcessor = std::make_shared<SecretShareInputProcessor<schedulerId>>(
-          globalParamsInputPath, inputPath);
+          globalParamsInputPath,
+          inputPath,
+          useBinarySecretShares,
+          numParseThreads,
+          metrics_.getSecretShareColumns());
     }
+    return playFromInputProcessor(inputProcessor, numConversionPerUser);
+  }
+
+ private:
+  std::string playFromInputProcessor(
+      std::shared_ptr<IInputProcessor<schedulerId>> inputProcessor,
+      size_t numConversionPerUser) {
     XLOG(INFO) << "Have " << inputProcessor->getLiftGameProcessedData().numRows
                << " values in inputData.";
     if (inputProcessor->getLiftGameProcessedData().numRows == 0) {
@@ -84,20 +111,52 @@ class CalculatorGame : public fbpcf::frontend::MpcGame<schedulerId> {
           .toJson();
     }
 
-    auto attributor =
-        std::make_unique<Attributor<schedulerId>>(party_, inputProcessor);
-    auto aggregator = Aggregator<schedulerId>(
+    return calculate(inputProcessor, numConversionPerUser);
+  }
+
+  // Attributes and aggregates with the narrowest value widths which hold the
+  // sums of the values and of the values squared. Both parties know their
+  // numbers of bits from shareBitsForValuesStep, so they choose the same ones.
+  std::string calculate(
+      std::shared_ptr<IInputProcessor<schedulerId>> inputProcessor,
+      int32_t numConversionsPerUser) {
+    const auto& processedData = inputProcessor->getLiftGameProcessedData();
+    if (fitsValueWidths<NarrowValueWidths>(
+            processedData.valueBits, processedData.valueSquaredBits)) {
+      XLOG(INFO) << "Calculating with narrow value widths";
+      return calculateWithWidths<NarrowValueWidths>(
+          inputProcessor, numConversionsPerUser);
+    }
+    return calculateWithWidths<DefaultValueWidths>(
+        inputProcessor, numConversionsPerUser);
+  }
+
+  template <typename Widths>
+  std::string calculateWithWidths(
+      std::shared_ptr<IInputProcessor<schedulerId>> inputProcessor,
+      int32_t numConversionsPerUser) {
+    // The ORAMs are set up while the attribution runs
+    auto oram = std::make_unique<AggregatorOram<schedulerId, Widths>>(
+        party_,
+        inputProcessor->getLiftGameProcessedData(),
+        communicationAgentFactory_,
+        metrics_);
+    auto attributor = std::make_unique<Attributor<schedulerId, Widths>>(
+        party_, inputProcessor, metrics_);
+    auto aggregator = Aggregator<schedulerId, Widths>(
         party_,
         inputProcessor,
         std::move(attributor),
-        numConversionPerUser,
-        communicationAgentFactory_);
+        numConversionsPerUser,
+        std::move(oram),
+        metrics_);
     return aggregator.toJson();
   }
 
- private:
   const int party_;
   std::shared_ptr<fbpcf::engine::communication::IPartyCommunicationAgentFactory>
       communicationAgentFactory_;
+  // The optional metrics which are computed
+  const LiftMetricSet metrics_;
 };
 } // namespace private_lift
@@ -9,6 +9,7 @@
 
 #include <filesystem>
 
+#include "fbpcs/emp_games/common/SchedulerHints.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/InputData.h"
 
 namespace private_lift {
@@ -19,5 +20,12 @@ struct CalculatorGameConfig {
   InputData inputData;
   bool isConversionLift;
   int32_t numConversionsPerUser;
+  // Whether the timestamps are shared relative to the earliest opportunity,
+  // see InputProcessor
+  bool useRelativeTimestamps = false;
 };
+
+// The scheduler hints of lift, which only takes lazy or eager, as it feeds
+// every row of a file in at once
+const common::SchedulerHints kSchedulerHints{};
 } // namespace private_lift
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/DryRunEstimate.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/CalculatorApp.h"
+
+namespace private_lift {
+
+/*
+ * Writes lift inputs of numRows rows for both parties, with numConversions
+ * conversions per user, numCohorts cohorts and, if numBreakdowns is not 0, as
+ * many publisher breakdowns. The values are random, but the game is data
+ * oblivious, so every input of the same dimensions costs the same.
+ */
+inline void writeDryRunInputs(
+    const std::string& publisherPath,
+    const std::string& partnerPath,
+    std::size_t numRows,
+    std::size_t numConversions,
+    int64_t numCohorts,
+    int64_t numBreakdowns,
+    int64_t epoch,
+    uint32_t seed = 42) {
+  std::mt19937_64 r{seed};
+  std::uniform_int_distribution<int64_t> tsDist{epoch + 1, epoch + 86'400};
+  std::uniform_int_distribution<int64_t> countDist{0, 5};
+  std::uniform_int_distribution<int64_t> valueDist{0, 1000};
+  std::uniform_int_distribution<int64_t> bitDist{0, 1};
+  std::uniform_int_distribution<int64_t> cohortDist{
+      0, std::max<int64_t>(numCohorts, 1) - 1};
+  std::uniform_int_distribution<int64_t> breakdownDist{
+      0, std::max<int64_t>(numBreakdowns, 1) - 1};
+
+  std::ofstream publisher{publisherPath};
+  std::ofstream partner{partnerPath};
+  publisher << "id_,opportunity,test_flag,opportunity_timestamp,"
+            << "num_impressions,num_clicks,total_spend"
+            << (numBreakdowns > 0 ? ",breakdown_id\n" : "\n");
+  partner << "id_,event_timestamps,values"
+          << (numCohorts > 0 ? ",cohort_id\n" : "\n");
+  for (std::size_t i = 0; i < numRows; ++i) {
+    publisher << i << ',' << bitDist(r) << ',' << bitDist(r) << ','
+              << tsDist(r) << ',' << countDist(r) << ',' << countDist(r) << ','
+              << valueDist(r);
+    if (numBreakdowns > 0) {
+      publisher << ',' << breakdownDist(r);
+    }
+    publisher << '\n';
+
+    std::vector<int64_t> timestamps(numConversions);
+    std::generate(
+        timestamps.begin(), timestamps.end(), [&]() { return tsDist(r); });
+    std::sort(timestamps.begin(), timestamps.end());
+    std::vector<int64_t> values(numConversions);
+    std::generate(
+        values.begin(), values.end(), [&]() { return valueDist(r); });
+    partner << i << ',' << common::toDryRunArrayCell(timestamps) << ','
+            << common::toDryRunArrayCell(values);
+    if (numCohorts > 0) {
+      partner << ',' << cohortDist(r);
+    }
+    partner << '\n';
+  }
+}
+
+// Each party runs on the scheduler of the same id
+template <int party>
+common::SchedulerStatistics runDryRunApp(
+    std::unique_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory> factory,
+    const std::string& inputPath,
+    const std::string& outputPath,
+    int numConversionsPerUser,
+    bool computePublisherBreakdowns,
+    int64_t epoch,
+    bool useXorEncryption) {
+  auto metricCollector =
+      std::make_shared<fbpcf::util::MetricCollector>("lift_dry_run");
+  CalculatorApp<party> app(
+      party,
+      std::move(factory),
+      numConversionsPerUser,
+      computePublisherBreakdowns,
+      epoch,
+      std::vector<std::string>{inputPath},
+      "" /* inputGlobalParamsPath */,
+      "" /* inputExpandedKeyPath */,
+      std::vector<std::string>{outputPath},
+      false /* readInputFromSecretShares */,
+      false /* useDecoupledUDP */,
+      metricCollector,
+      0 /* startFileIndex */,
+      1 /* numFiles */,
+      useXorEncryption);
+  app.run();
+  return app.getSchedulerStatistics();
+}
+
+/*
+ * Predicts the costs of party in a lift of numRows rows with numCohorts
+ * cohorts and numBreakdowns publisher breakdowns, split over numFiles files
+ * and run by concurrency apps, from dry runs of both parties on plaintext
+ * inputs of the same dimensions.
+ */
+inline common::DryRunEstimate estimateLiftCosts(
+    int party,
+    int64_t numRows,
+    int numConversionsPerUser,
+    int64_t numCohorts,
+    int64_t numBreakdowns,
+    bool computePublisherBreakdowns,
+    int64_t epoch,
+    bool useXorEncryption,
+    int64_t numFiles,
+    int64_t concurrency,
+    int32_t bandwidthMbps) {
+  return common::estimateFromDryRuns(
+      party,
+      numRows,
+      std::min(std::max<int64_t>(numFiles, 1), concurrency),
+      bandwidthMbps,
+      [=](int64_t sampleRows, const std::string& dir) {
+        auto publisherInput = dir + "/publisher.csv";
+        auto partnerInput = dir + "/partner.csv";
+        writeDryRunInputs(
+            publisherInput,
+            partnerInput,
+            sampleRows,
+            numConversionsPerUser,
+            numCohorts,
+            numBreakdowns,
+            epoch);
+        return [=](int runParty, auto factory) {
+          return runParty == common::PUBLISHER
+              ? runDryRunApp<common::PUBLISHER>(
+                    std::move(factory),
+                    publisherInput,
+                    dir + "/publisher_output.json",
+                    numConversionsPerUser,
+                    computePublisherBreakdowns,
+                    epoch,
+                    useXorEncryption)
+              : runDryRunApp<common::PARTNER>(
+                    std::move(factory),
+                    partnerInput,
+                    dir + "/partner_output.json",
+                    numConversionsPerUser,
+                    computePublisherBreakdowns,
+                    epoch,
+                    useXorEncryption);
+        };
+      });
+}
+
+} // namespace private_lift
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/LiftGameProcessedData.h"
+
+namespace private_lift {
+
+/*
+ * The optional metrics of a lift calculation. The Attributor and the
+ * Aggregator skip the metrics left out, which are output as zero, and the
+ * secret share columns which only they read don't have to be loaded. Both
+ * parties have to compute the same metrics.
+ */
+struct LiftMetricSet {
+  // testValueSquared and controlValueSquared, from purchaseValueSquared
+  bool valueSquared = true;
+  // reachedConversions and reachedValue, from testIndexShares and testReach
+  bool reached = true;
+
+  // The columns of SECRET_SHARES_HEADER which the Attributor and the
+  // Aggregator read for these metrics, or none if they read all of them, as
+  // LiftGameProcessedData::readFromCSV and readFromBinary take them
+  std::vector<std::string> getSecretShareColumns() const {
+    std::vector<std::string> columns;
+    if (valueSquared && reached) {
+      return columns;
+    }
+    for (const auto& column : SECRET_SHARES_HEADER) {
+      if (!valueSquared && column == "purchaseValueSquared") {
+        continue;
+      }
+      if (!reached && (column == "testIndexShares" || column == "testReach")) {
+        continue;
+      }
+      columns.push_back(column);
+    }
+    return columns;
+  }
+};
+
+} // namespace private_lift
@@ -7,11 +7,17 @@
 
 #pragma once
 
+#include <chrono>
 #include <future>
 #include <memory>
+#include <optional>
 
 #include <folly/dynamic.h>
 #include "fbpcf/engine/communication/SocketPartyCommunicationAgentFactory.h"
+#include "fbpcs/emp_games/common/LaneController.h"
+#include "fbpcs/emp_games/common/MultiplexedConnection.h"
+#include "fbpcs/emp_games/common/ShardQueue.h"
+#include "fbpcs/emp_games/common/TrafficTrace.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/CalculatorApp.h"
 
 namespace private_lift {
@@ -60,7 +66,7 @@ getIOFilepaths(
 
 template <int PARTY, int index>
 inline common::SchedulerStatistics startCalculatorAppsForShardedFilesHelper(
-    int startFileIndex,
+    std::shared_ptr<common::ShardQueue> shardQueue,
     int remainingThreads,
     int numThreads,
     std::string serverIp,
@@ -75,36 +81,64 @@ inline common::SchedulerStatistics startCalculatorAppsForShardedFilesHelper(
     bool computePublisherBreakdowns,
     int epoch,
     bool useXorEncryption,
+    bool useBinarySecretShares,
+    int numParseThreads,
+    bool useShardCache,
+    bool useFusedCompaction,
+    std::chrono::seconds inputWaitTimeout,
+    bool useRelativeTimestamps,
+    LiftMetricSet metrics,
     fbpcf::engine::communication::SocketPartyCommunicationAgent::TlsInfo&
-        tlsInfo) {
+        tlsInfo,
+    std::shared_ptr<common::MultiplexedConnection> connection,
+    std::shared_ptr<common::LaneController> laneController) {
   // aggregate scheduler statistics across apps
   common::SchedulerStatistics schedulerStatistics{
       0, 0, 0, 0, folly::dynamic::object()};
 
-  // split files evenly across threads
-  auto remainingFiles = inputFilepaths.size() - startFileIndex;
-  if (remainingFiles > 0) {
-    auto numFiles = (remainingThreads > remainingFiles)
-        ? 1
-        : (remainingFiles / remainingThreads);
-
-    std::map<
-        int,
-        fbpcf::engine::communication::SocketPartyCommunicationAgentFactory::
-            PartyInfo>
-        partyInfos(
-            {{0, {serverIp, port + index * 100}},
-             {1, {serverIp, port + index * 100}}});
-
-    auto metricCollector = std::make_shared<fbpcf::util::MetricCollector>(
-        "lift_metrics_for_thread_" + std::to_string(index));
-
-    auto communicationAgentFactory = std::make_unique<
-        fbpcf::engine::communication::SocketPartyCommunicationAgentFactory>(
-        PARTY, partyInfos, tlsInfo, metricCollector);
-
-    // Each CalculatorApp runs numFiles sequentially on a single thread
-    // Publisher uses even schedulerId and partner uses odd schedulerId
+  if (remainingThreads > 0) {
+    auto metricCollector =
+        std::make_shared<fbpcf::util::MetricCollector>("lift_metrics");
+
+    // The app is a lane of the multiplexed connection when there is one, and
+    // otherwise connects on a port of its own
+    std::unique_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+        communicationAgentFactory;
+    if (connection) {
+      communicationAgentFactory =
+          std::make_unique<common::MultiplexedAgentFactory>(
+              connection, index, metricCollector);
+    } else {
+      std::map<
+          int,
+          fbpcf::engine::communication::SocketPartyCommunicationAgentFactory::
+              PartyInfo>
+          partyInfos(
+              {{0, {serverIp, port + index * 100}},
+               {1, {serverIp, port + index * 100}}});
+      communicationAgentFactory = std::make_unique<
+          fbpcf::engine::communication::SocketPartyCommunicationAgentFactory>(
+          PARTY, partyInfos, tlsInfo, metricCollector);
+    }
+    communicationAgentFactory = common::recordTraffic(
+        std::move(communicationAgentFactory),
+        common::getTrafficTracePath("lift", PARTY, index),
+        metricCollector);
+
+    // The controller of an adaptive run connects over the first app's
+    // factory, and measures the traffic of every app
+    if (laneController) {
+      if constexpr (index == 0) {
+        laneController->connect(*communicationAgentFactory);
+      }
+      communicationAgentFactory = laneController->countTraffic(
+          std::move(communicationAgentFactory), metricCollector);
+    }
+
+    // Each CalculatorApp runs the files it takes from shardQueue
+    // sequentially on a single thread, taking the next one when it finishes
+    // one. Publisher uses even schedulerId and partner uses odd schedulerId
     auto app = std::make_unique<CalculatorApp<2 * index + PARTY>>(
         PARTY,
         std::move(communicationAgentFactory),
@@ -118,22 +152,32 @@ inline common::SchedulerStatistics startCalculatorAppsForShardedFilesHelper(
         readInputFromSecretShares,
         useDecoupledUDP,
         metricCollector,
-        startFileIndex,
-        numFiles,
-        useXorEncryption);
+        0 /* startFileIndex */,
+        0 /* numFiles */,
+        useXorEncryption,
+        useBinarySecretShares,
+        numParseThreads,
+        shardQueue,
+        useShardCache,
+        useFusedCompaction,
+        inputWaitTimeout,
+        useRelativeTimestamps,
+        metrics);
 
-    auto future = std::async([&app]() {
+    auto future = std::async(std::launch::async, [&app]() {
       app->run();
       return app->getSchedulerStatistics();
     });
 
     // We construct a CalculatorApp for each thread recursively because each app
-    // has a different schedulerId, which is a template parameter
+    // has a different schedulerId, which is a template parameter. An adaptive
+    // run only starts the next one while the running ones gain from it
     if constexpr (index < kMaxConcurrency) {
-      if (remainingThreads > 1) {
+      if (remainingThreads > 1 &&
+          (!laneController || laneController->shouldStart(index + 1))) {
         auto remainingStats =
             startCalculatorAppsForShardedFilesHelper<PARTY, index + 1>(
-                startFileIndex + numFiles,
+                shardQueue,
                 remainingThreads - 1,
                 numThreads,
                 serverIp,
@@ -148,7 +192,16 @@ inline common::SchedulerStatistics startCalculatorAppsForShardedFilesHelper(
                 computePublisherBreakdowns,
                 epoch,
                 useXorEncryption,
-                tlsInfo);
+                useBinarySecretShares,
+                numParseThreads,
+                useShardCache,
+                useFusedCompaction,
+                inputWaitTimeout,
+                useRelativeTimestamps,
+                metrics,
+                tlsInfo,
+                connection,
+                laneController);
         schedulerStatistics.add(remainingStats);
       }
     }
@@ -173,13 +226,37 @@ inline common::SchedulerStatistics startCalculatorAppsForShardedFiles(
     bool computePublisherBreakdowns,
     int epoch,
     bool useXorEncryption,
+    bool useBinarySecretShares,
+    int numParseThreads,
     fbpcf::engine::communication::SocketPartyCommunicationAgent::TlsInfo&
-        tlsInfo) {
-  // use only as many threads as the number of files
+        tlsInfo,
+    const std::string& shardCostManifest = "",
+    bool useShardCache = false,
+    bool useFusedCompaction = false,
+    std::chrono::seconds inputWaitTimeout = std::chrono::seconds{0},
+    bool useRelativeTimestamps = false,
+    LiftMetricSet metrics = LiftMetricSet{},
+    bool multiplexConnections = false,
+    std::optional<common::LaneController::Options> adaptiveConcurrency =
+        std::nullopt) {
+  // use only as many threads as the number of files. An adaptive run starts
+  // up to that many, as long as each one raises the throughput
   auto numThreads = std::min((int)inputFilepaths.size(), (int)concurrency);
+  auto shardQueue =
+      common::makeShardQueue(inputFilepaths.size(), shardCostManifest);
+  std::shared_ptr<common::MultiplexedConnection> connection;
+  if (multiplexConnections && numThreads > 0) {
+    connection = common::connectMultiplexed(
+        PARTY, serverIp, port, tlsInfo, "lift_connection");
+  }
+  std::shared_ptr<common::LaneController> laneController;
+  if (adaptiveConcurrency.has_value()) {
+    laneController = std::make_shared<common::LaneController>(
+        PARTY, shardQueue, *adaptiveConcurrency);
+  }
 
   return startCalculatorAppsForShardedFilesHelper<PARTY, 0>(
-      0,
+      shardQueue,
       numThreads,
       numThreads,
       serverIp,
@@ -194,7 +271,16 @@ inline common::SchedulerStatistics startCalculatorAppsForShardedFiles(
       computePublisherBreakdowns,
       epoch,
       useXorEncryption,
-      tlsInfo);
+      useBinarySecretShares,
+      numParseThreads,
+      useShardCache,
+      useFusedCompaction,
+      inputWaitTimeout,
+      useRelativeTimestamps,
+      metrics,
+      tlsInfo,
+      connection,
+      laneController);
 }
 
 } // namespace private_lift
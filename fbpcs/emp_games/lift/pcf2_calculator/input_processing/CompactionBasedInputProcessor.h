@@ -46,14 +46,14 @@ class CompactionBasedInputProcessor : public IInputProcessor<schedulerId> {
         adapter_{std::move(adapter)},
         dataProcessor_{std::move(dataProcessor)},
         prg_{std::move(prg)},
-        inputData_{inputData},
+        inputData_{std::move(inputData)},
         numConversionsPerUser_{numConversionsPerUser} {
-    if (inputData.getNumRows() == 0) {
+    if (inputData_.getNumRows() == 0) {
       liftGameProcessedData_ = {};
       return;
     }
 
-    liftGameProcessedData_.numRows = inputData.getNumRows();
+    liftGameProcessedData_.numRows = inputData_.getNumRows();
 
     input_processing::validateNumRowsStep(myRole_, liftGameProcessedData_);
     input_processing::shareNumGroupsStep(
@@ -78,8 +78,10 @@ class CompactionBasedInputProcessor : public IInputProcessor<schedulerId> {
         compactData(intersectionMap, plaintextData);
 
     XLOG(INFO, "Begin extraction to MPC types");
-    auto publisherShares = std::get<0>(publisherPartnerJointMetadataShares);
-    auto partnerShares = std::get<1>(publisherPartnerJointMetadataShares);
+    const auto& publisherShares =
+        std::get<0>(publisherPartnerJointMetadataShares);
+    const auto& partnerShares =
+        std::get<1>(publisherPartnerJointMetadataShares);
     input_processing::extractCompactedData(
         liftGameProcessedData_,
         controlPopulation_,
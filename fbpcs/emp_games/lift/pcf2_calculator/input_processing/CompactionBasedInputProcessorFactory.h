@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
+#include "fbpcf/mpc_std_lib/unified_data_process/adapter/AdapterFactory.h"
+#include "fbpcf/mpc_std_lib/unified_data_process/data_processor/DataProcessorFactory.h"
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/CompactionBasedInputProcessor.h"
+
+namespace private_lift {
+
+/**
+ * Runs the metadata compaction of inputData on the scheduler of schedulerId,
+ * with the adapter and the data processor both the metadata compaction stage
+ * and the fused calculator use.
+ */
+template <int schedulerId>
+std::unique_ptr<CompactionBasedInputProcessor<schedulerId>>
+makeCompactionBasedInputProcessor(
+    int party,
+    fbpcf::engine::communication::IPartyCommunicationAgentFactory&
+        agentFactory,
+    InputData inputData,
+    int32_t numConversionPerUser) {
+  int partnerParty =
+      party == common::PUBLISHER ? common::PARTNER : common::PUBLISHER;
+  auto adapter = fbpcf::mpc_std_lib::unified_data_process::adapter::
+                     getAdapterFactoryWithAsWaksmanBasedShuffler<schedulerId>(
+                         party == common::PUBLISHER, party, partnerParty)
+                         ->create();
+  auto dataProcessor =
+      fbpcf::mpc_std_lib::unified_data_process::data_processor::
+          getDataProcessorFactoryWithAesCtr<schedulerId>(
+              party, partnerParty, agentFactory)
+              ->create();
+  auto prg = std::make_unique<fbpcf::engine::util::AesPrgFactory>()->create(
+      fbpcf::engine::util::getRandomM128iFromSystemNoise());
+
+  return std::make_unique<CompactionBasedInputProcessor<schedulerId>>(
+      party,
+      std::move(adapter),
+      std::move(dataProcessor),
+      std::move(prg),
+      std::move(inputData),
+      numConversionPerUser);
+}
+
+} // namespace private_lift
@@ -70,11 +70,11 @@ CompactionBasedInputProcessor<schedulerId>::preparePlaintextData(
   if (myRole_ == common::PARTNER) {
     // Construct a serializer
     LiftMetaDataSerializer partnerSerializer(
-        inputData_, numConversionsPerUser_, reverseUnionMap, unionSize);
+        inputData_, numConversionsPerUser_, std::move(reverseUnionMap));
     return partnerSerializer.serializePartnerMetadata();
   } else {
     LiftMetaDataSerializer publisherSerializer(
-        inputData_, numConversionsPerUser_, reverseUnionMap, unionSize);
+        inputData_, numConversionsPerUser_, std::move(reverseUnionMap));
     return publisherSerializer.serializePublisherMetadata();
   }
 }
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <map>
 #include "fbpcf/frontend/mpcGame.h"
 
@@ -14,13 +15,44 @@ namespace private_lift {
 
 const int kMaxConcurrency = 16;
 
-const size_t groupWidth = 32; // at most 32 cohorts and 2 publisher breakdowns
+// The width of the group ids, which combine the population, the publisher
+// breakdown (at most 2) and the partner cohort. The aggregation cost of a
+// metric grows with the number of groups in the ORAM, and with the number of
+// cohorts and breakdowns in its totals, see Aggregator::sumGroupTotals.
+const size_t groupWidth = 32;
 const size_t numConvSquaredWidth = 32;
 const size_t valueWidth = 32;
 const size_t valueSquaredWidth = 64;
 // only need log_2(64) < 8 bits to store value and valueSquared width
 const size_t numBitsForValuesWidth = 8;
 const size_t timeStampWidth = 32;
+// The width at which the opportunity and threshold timestamps are compared
+// when they are shared relative to the earliest valid opportunity timestamp
+// and fit it, which is about 194 days in seconds, see
+// input_processing::shareTimestampBaseStep
+const size_t narrowTimeStampWidth = 24;
+
+// The widths of the purchase values and of their squares in the attribution
+// and the aggregation, which cost gates and traffic in proportion to them. The
+// inputs are always shared at valueWidth and valueSquaredWidth, and are
+// narrowed locally when the sums of the values fit narrower widths, see
+// fitsValueWidths.
+template <int8_t valueBitWidth, int8_t valueSquaredBitWidth>
+struct ValueWidths {
+  static constexpr int8_t kValueWidth = valueBitWidth;
+  static constexpr int8_t kValueSquaredWidth = valueSquaredBitWidth;
+};
+using DefaultValueWidths = ValueWidths<valueWidth, valueSquaredWidth>;
+using NarrowValueWidths = ValueWidths<16, 32>;
+
+// Whether the signed sums of Widths hold the sums of the values and of the
+// values squared, given the numbers of bits of their totals as shared by
+// input_processing::shareBitsForValuesStep
+template <typename Widths>
+constexpr bool fitsValueWidths(uint8_t valueBits, uint8_t valueSquaredBits) {
+  return valueBits < Widths::kValueWidth &&
+      valueSquaredBits < Widths::kValueSquaredWidth;
+}
 
 // Threshold timestamps are valid (positive) purchase timestamp with added
 // attribution window
@@ -50,6 +82,14 @@ template <int schedulerId, bool usingBatch = true>
 using SecValue = typename fbpcf::frontend::MpcGame<
     schedulerId>::template SecSignedInt<valueWidth, usingBatch>;
 
+template <int schedulerId, int8_t width, bool usingBatch = true>
+using PubValueOfWidth = typename fbpcf::frontend::MpcGame<
+    schedulerId>::template PubSignedInt<width, usingBatch>;
+
+template <int schedulerId, int8_t width, bool usingBatch = true>
+using SecValueOfWidth = typename fbpcf::frontend::MpcGame<
+    schedulerId>::template SecSignedInt<width, usingBatch>;
+
 template <int schedulerId, bool usingBatch = true>
 using PubValueSquared = typename fbpcf::frontend::MpcGame<
     schedulerId>::template PubSignedInt<valueSquaredWidth, usingBatch>;
@@ -66,6 +106,10 @@ template <int schedulerId, bool usingBatch = true>
 using SecTimestamp = typename fbpcf::frontend::MpcGame<
     schedulerId>::template SecUnsignedInt<timeStampWidth, usingBatch>;
 
+template <int schedulerId, bool usingBatch = true>
+using SecNarrowTimestamp = typename fbpcf::frontend::MpcGame<
+    schedulerId>::template SecUnsignedInt<narrowTimeStampWidth, usingBatch>;
+
 template <int schedulerId, bool usingBatch = true>
 using PubNumConvSquared = typename fbpcf::frontend::MpcGame<
     schedulerId>::template PubUnsignedInt<numConvSquaredWidth, usingBatch>;
@@ -50,10 +50,16 @@ class DecoupledUDPInputProcessor : public IInputProcessor<schedulerId> {
 
     liftGameProcessedData_.numRows =
         std::get<0>(publisherPartnerJointMetadataShares).size();
+    // Neither party holds the values in the clear here, so the totals of the
+    // values are unknown and they are aggregated at the full widths
+    liftGameProcessedData_.valueBits = valueWidth;
+    liftGameProcessedData_.valueSquaredBits = valueSquaredWidth;
 
     XLOG(INFO, "Begin extraction to MPC types");
-    auto publisherShares = std::get<0>(publisherPartnerJointMetadataShares);
-    auto partnerShares = std::get<1>(publisherPartnerJointMetadataShares);
+    const auto& publisherShares =
+        std::get<0>(publisherPartnerJointMetadataShares);
+    const auto& partnerShares =
+        std::get<1>(publisherPartnerJointMetadataShares);
     input_processing::extractCompactedData(
         liftGameProcessedData_,
         controlPopulation_,
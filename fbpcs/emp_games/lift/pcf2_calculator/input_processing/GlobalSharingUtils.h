@@ -7,6 +7,10 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
 #include "folly/logging/xlog.h"
 
 #include "fbpcs/emp_games/common/Constants.h"
@@ -120,6 +124,80 @@ inline void shareBitsForValuesStep(
              << (int32_t)liftGameProcessedData.valueSquaredBits;
 }
 
+// The earliest valid opportunity timestamp of the publisher, which is revealed
+// to the partner with the number of bits of the latest one relative to it.
+// Both parties then share their timestamps relative to this base, so that the
+// attribution compares them at narrowTimeStampWidth when they fit it. Returns
+// 0 with timestampBits left at timeStampWidth when the relative timestamps
+// would need as many bits as the timestamps themselves.
+template <int schedulerId>
+inline uint32_t shareTimestampBaseStep(
+    int myRole,
+    const InputData& inputData,
+    LiftGameProcessedData<schedulerId>& liftGameProcessedData) {
+  XLOG(INFO) << "Set up the base of the opportunity timestamps";
+  uint64_t base = 0;
+  uint64_t timestampBits = 0;
+  if (myRole == common::PUBLISHER) {
+    const auto& opportunityTimestamps = inputData.getOpportunityTimestamps();
+    uint32_t minTimestamp = std::numeric_limits<uint32_t>::max();
+    uint32_t maxTimestamp = 0;
+    for (size_t i = 0; i < opportunityTimestamps.size(); ++i) {
+      // The same validity as isValidOpportunityTimestamp
+      if (opportunityTimestamps.at(i) > 0 &&
+          (inputData.getControlPopulation().at(i) ||
+           inputData.getTestPopulation().at(i))) {
+        minTimestamp = std::min(minTimestamp, opportunityTimestamps.at(i));
+        maxTimestamp = std::max(maxTimestamp, opportunityTimestamps.at(i));
+      }
+    }
+    if (minTimestamp <= maxTimestamp) {
+      // The partner clamps the threshold timestamps after the latest
+      // opportunity to the largest offset, so it has to be above the offsets
+      // of all the opportunity timestamps
+      uint64_t span = uint64_t(maxTimestamp) - minTimestamp + 1;
+      while (timestampBits < timeStampWidth && (span >> timestampBits) > 0) {
+        ++timestampBits;
+      }
+      base = minTimestamp;
+    }
+    if (timestampBits >= timeStampWidth) {
+      base = 0;
+      timestampBits = timeStampWidth;
+    }
+  }
+
+  base = common::shareIntFrom<
+      schedulerId,
+      timeStampWidth,
+      common::PUBLISHER,
+      common::PARTNER>(myRole, base);
+  liftGameProcessedData.timestampBits = common::shareIntFrom<
+      schedulerId,
+      numBitsForValuesWidth,
+      common::PUBLISHER,
+      common::PARTNER>(myRole, timestampBits);
+  XLOG(INFO) << "Num bits for timestamps: "
+             << (int32_t)liftGameProcessedData.timestampBits;
+  return static_cast<uint32_t>(base);
+}
+
+// The offset of an opportunity or threshold timestamp from the base of
+// shareTimestampBaseStep. Timestamps up to the base are 0 and the ones after
+// the latest valid opportunity timestamp are the largest offset timestampBits
+// hold, which keeps their comparisons with the valid opportunity timestamps.
+inline uint32_t getRelativeTimestamp(
+    uint32_t timestamp,
+    uint32_t base,
+    uint8_t timestampBits) {
+  if (timestamp <= base) {
+    return 0;
+  }
+  uint64_t maxOffset = (uint64_t(1) << timestampBits) - 1;
+  return static_cast<uint32_t>(
+      std::min(uint64_t(timestamp) - base, maxOffset));
+}
+
 template <int schedulerId>
 inline void computeIndexSharesAndSetTestGroupIds(
     LiftGameProcessedData<schedulerId>& liftGameProcessedData,
@@ -29,4 +29,13 @@ void writeToCSV(
       globalParamsPath, secretSharesPath);
 }
 
+template <int schedulerId>
+void writeToBinary(
+    const IInputProcessor<schedulerId>& inputProcessor,
+    const std::string& globalParamsPath,
+    const std::string& secretSharesPath) {
+  inputProcessor.getLiftGameProcessedData().writeToBinary(
+      globalParamsPath, secretSharesPath);
+}
+
 } // namespace private_lift
@@ -11,7 +11,9 @@
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <iterator>
 #include <string>
+#include <string_view>
 #include "folly/logging/xlog.h"
 
 #include "fbpcs/emp_games/common/Csv.h"
@@ -19,106 +21,325 @@
 
 namespace private_lift {
 
+namespace {
+
+[[noreturn]] void failToParse(std::string_view value) {
+  XLOG(FATAL) << "Failed to parse '" << value << "' to int64_t";
+  std::abort();
+}
+
+// The cells of a csv line
+class CsvRow {
+ public:
+  explicit CsvRow(const std::vector<std::string>& parts) : parts_{parts} {}
+
+  // Whether the column was read, which it isn't if it wasn't asked for
+  bool has(size_t column) const {
+    return column < parts_.size() && !parts_[column].empty();
+  }
+
+  int64_t getInt64(size_t column) const {
+    std::istringstream iss{parts_[column]};
+    int64_t parsed = 0;
+    iss >> parsed;
+    if (iss.fail()) {
+      failToParse(iss.str());
+    }
+    return parsed;
+  }
+
+  // Parses up to limit values of an array cell such as `[1,2,3]`
+  void getArray(size_t column, size_t limit, std::vector<int64_t>& values)
+      const {
+    values.clear();
+    // Strip the brackets [] before splitting into individual values
+    auto innerString = parts_[column].substr(1, parts_[column].size() - 1);
+    auto tokens = private_measurement::csv::splitByComma(innerString, false);
+    for (size_t i = 0; i < tokens.size() && i < limit; ++i) {
+      std::istringstream iss{tokens[i]};
+      int64_t parsed = 0;
+      iss >> parsed;
+      if (iss.fail()) {
+        failToParse(iss.str());
+      }
+      values.push_back(parsed);
+    }
+  }
+
+ private:
+  const std::vector<std::string>& parts_;
+};
+
+// A row of a row group, whose cells are already typed
+class RowGroupRow {
+ public:
+  RowGroupRow(
+      const private_measurement::row_group::Schema& schema,
+      const private_measurement::row_group::RowGroup& group,
+      size_t row)
+      : schema_{schema}, group_{group}, row_{row} {}
+
+  bool has(size_t /* column */) const {
+    return true;
+  }
+
+  int64_t getInt64(size_t column) const {
+    if (schema_[column].type !=
+        private_measurement::row_group::ColumnType::kInt64) {
+      XLOG(FATAL) << "Column " << schema_[column].name << " is not an integer";
+    }
+    return group_.getInt64(column, row_);
+  }
+
+  void getArray(size_t column, size_t limit, std::vector<int64_t>& values)
+      const {
+    if (schema_[column].type !=
+        private_measurement::row_group::ColumnType::kInt64Array) {
+      XLOG(FATAL) << "Column " << schema_[column].name << " is not an array";
+    }
+    auto array = group_.getArray(schema_, column, row_);
+    values.assign(
+        array, array + std::min<size_t>(schema_[column].arrayWidth, limit));
+  }
+
+ private:
+  const private_measurement::row_group::Schema& schema_;
+  const private_measurement::row_group::RowGroup& group_;
+  size_t row_;
+};
+
+// The columns of a csv which are parsed, leaving out the ones the game doesn't
+// use with these settings so that they aren't tokenized
+std::vector<std::string> getInputColumns(
+    LiftMPCType liftMpcType,
+    bool computePublisherBreakdowns) {
+  std::vector<std::string> columns = {
+      "opportunity",
+      "test_flag",
+      "opportunity_timestamp",
+      "num_impressions",
+      "num_clicks",
+      "total_spend",
+      "cohort_id",
+      "event_timestamp",
+      "event_timestamps",
+      "value",
+      "values",
+      "purchase_flag"};
+  if (computePublisherBreakdowns) {
+    columns.push_back("breakdown_id");
+  }
+  if (liftMpcType == LiftMPCType::SecretShare) {
+    columns.push_back("value_squared");
+    columns.push_back("opportunity_timestamps");
+  }
+  return columns;
+}
+
+std::vector<std::string> getHeader(
+    const private_measurement::row_group::Schema& schema) {
+  std::vector<std::string> header;
+  for (auto& column : schema) {
+    header.push_back(column.name);
+  }
+  return header;
+}
+
+} // namespace
+
 InputData::InputData(
     std::string filepath,
     LiftMPCType liftMpcType,
     bool computePublisherBreakdowns,
     int64_t epoch,
-    int32_t numConversionsPerUser)
+    int32_t numConversionsPerUser,
+    int32_t numParseThreads)
     : liftMpcType_{liftMpcType},
       computePublisherBreakdowns_{computePublisherBreakdowns},
       epoch_{epoch},
       numConversionsPerUser_{numConversionsPerUser} {
-  auto readLine = [&](const std::vector<std::string>& header,
-                      const std::vector<std::string>& parts) {
-    ++numRows_;
-    addFromCSV(header, parts);
+  auto readGroup = [&](const private_measurement::row_group::Schema& schema,
+                       const private_measurement::row_group::RowGroup& group) {
+    auto header = getHeader(schema);
+    for (size_t row = 0; row < group.numRows; ++row) {
+      ++numRows_;
+      addRow(header, RowGroupRow{schema, group, row});
+    }
+  };
+  if (private_measurement::csv::readRowGroups(filepath, readGroup)) {
+    return;
+  }
+
+  auto columns = getInputColumns(liftMpcType, computePublisherBreakdowns);
+  auto processHeader = [&columns](const std::vector<std::string>& header) {
+    for (auto& column : header) {
+      // We shouldn't fail if there are extra columns in the input. Lift games
+      // assume the ids are already matched, so the id_ column isn't needed.
+      if (column != "id_" && column != "breakdown_id" &&
+          column != "value_squared" && column != "opportunity_timestamps" &&
+          std::find(columns.begin(), columns.end(), column) == columns.end()) {
+        XLOG(WARNING) << "Warning: Unknown column in csv: " << column;
+      }
+    }
   };
 
-  if (!private_measurement::csv::readCsv(filepath, readLine)) {
+  if (numParseThreads <= 1) {
+    auto readLine = [&](const std::vector<std::string>& header,
+                        const std::vector<std::string>& parts) {
+      ++numRows_;
+      addFromCSV(header, parts);
+    };
+
+    if (!private_measurement::csv::readCsv(
+            filepath, readLine, processHeader, columns)) {
+      XLOG(FATAL) << "Failed to read input file " << filepath;
+    }
+    return;
+  }
+
+  // Each chunk of the file is parsed into its own InputData and the chunks are
+  // then appended in file order, since row order matters for aligned inputs.
+  std::vector<InputData> chunks;
+  chunks.reserve(numParseThreads);
+  for (int32_t i = 0; i < numParseThreads; ++i) {
+    chunks.push_back(emptyWithSameConfig());
+  }
+  std::vector<std::vector<std::string>> chunkParts(numParseThreads);
+  auto readLine = [&](size_t chunk,
+                      const std::vector<std::string>& header,
+                      const std::vector<std::string_view>& views) {
+    auto& parts = chunkParts.at(chunk);
+    parts.assign(views.begin(), views.end());
+    ++chunks.at(chunk).numRows_;
+    chunks.at(chunk).addFromCSV(header, parts);
+  };
+
+  if (!private_measurement::csv::readCsvViewsInChunks(
+          filepath, numParseThreads, readLine, processHeader, columns)) {
     XLOG(FATAL) << "Failed to read input file " << filepath;
   }
+  for (auto& chunk : chunks) {
+    append(std::move(chunk));
+  }
+}
+
+InputData InputData::emptyWithSameConfig() const {
+  InputData data;
+  data.liftMpcType_ = liftMpcType_;
+  data.computePublisherBreakdowns_ = computePublisherBreakdowns_;
+  data.epoch_ = epoch_;
+  data.numConversionsPerUser_ = numConversionsPerUser_;
+  return data;
+}
+
+namespace {
+
+template <typename T>
+void appendColumn(std::vector<T>& to, std::vector<T>&& from) {
+  if (to.empty()) {
+    to = std::move(from);
+  } else {
+    to.insert(
+        to.end(),
+        std::make_move_iterator(from.begin()),
+        std::make_move_iterator(from.end()));
+  }
+}
+
+} // namespace
+
+void InputData::append(InputData&& other) {
+  appendColumn(testPopulation_, std::move(other.testPopulation_));
+  appendColumn(controlPopulation_, std::move(other.controlPopulation_));
+  appendColumn(opportunityTimestamps_, std::move(other.opportunityTimestamps_));
+  appendColumn(numImpressions_, std::move(other.numImpressions_));
+  appendColumn(numClicks_, std::move(other.numClicks_));
+  appendColumn(totalSpend_, std::move(other.totalSpend_));
+  appendColumn(purchaseTimestamps_, std::move(other.purchaseTimestamps_));
+  appendColumn(purchaseValues_, std::move(other.purchaseValues_));
+  appendColumn(purchaseValuesSquared_, std::move(other.purchaseValuesSquared_));
+  appendColumn(partnerCohortIds_, std::move(other.partnerCohortIds_));
+  appendColumn(breakdownIds_, std::move(other.breakdownIds_));
+  opportunityTimestampColumns_.append(
+      std::move(other.opportunityTimestampColumns_));
+  purchaseTimestampColumns_.append(std::move(other.purchaseTimestampColumns_));
+  purchaseValueColumns_.append(std::move(other.purchaseValueColumns_));
+  purchaseValueSquaredColumns_.append(
+      std::move(other.purchaseValueSquaredColumns_));
+  appendColumn(isDummyRow_, std::move(other.isDummyRow_));
+
+  totalValue_ += other.totalValue_;
+  totalValueSquared_ += other.totalValueSquared_;
+  numPartnerCohorts_ = std::max(numPartnerCohorts_, other.numPartnerCohorts_);
+  numPublisherBreakdowns =
+      std::max(numPublisherBreakdowns, other.numPublisherBreakdowns);
+  numRows_ += other.numRows_;
 }
 
 bool InputData::setTimestamps(
-    std::string& str,
-    std::vector<std::vector<uint32_t>>& timestampArrays) {
-  timestampArrays.emplace_back();
-  // Strip the brackets [] before splitting into individual timestamp values
-  auto innerString = str.substr(1, str.size() - 1);
-  auto timestamps = private_measurement::csv::splitByComma(innerString, false);
+    const std::vector<int64_t>& values,
+    input_processing::RaggedColumns<uint32_t>& timestampColumns) {
+  // Take up to numConversionsPerUser_ elements and ignore the rest
+  auto numValues = std::min<std::size_t>(values.size(), numConversionsPerUser_);
 
   bool allZeroTimestamps = true;
-  // Take up to numConversionsPerUser_ elements and ignore the rest
-  for (std::size_t i = 0; i < timestamps.size() && i < numConversionsPerUser_;
-       ++i) {
-    std::istringstream iss{timestamps[i]};
-    int64_t parsed = 0;
-    iss >> parsed;
-    if (iss.fail()) {
-      XLOG(FATAL) << "Failed to parse '" << iss.str() << "' to int64_t";
-    }
+  std::vector<uint32_t> timestamps;
+  timestamps.reserve(numValues);
+  for (std::size_t i = 0; i < numValues; ++i) {
+    auto parsed = values[i];
     // secret-share-lift can have negative input timestamps
     if (liftMpcType_ == LiftMPCType::Standard && parsed < epoch_ &&
         parsed != 0) {
       XLOG(FATAL) << "Timestamp " << parsed << " is before epoch " << epoch_
                   << ", which is unexpected.";
     }
-    timestampArrays.back().push_back(parsed < epoch_ ? 0 : parsed - epoch_);
+    timestamps.push_back(parsed < epoch_ ? 0 : parsed - epoch_);
     allZeroTimestamps &= parsed == 0;
   }
+  timestampColumns.addRow(timestamps);
   return allZeroTimestamps;
 }
 
-void InputData::setValuesFields(std::string& str) {
-  purchaseValueArrays_.emplace_back();
-  if (liftMpcType_ == LiftMPCType::Standard) {
-    purchaseValueSquaredArrays_.emplace_back();
-  }
-  // Strip the brackets [] before splitting into individual values
-  auto innerString = str.substr(1, str.size() - 1);
-  auto values = private_measurement::csv::splitByComma(innerString, false);
+void InputData::setValuesFields(const std::vector<int64_t>& values) {
   // Take up to numConversionsPerUser_ elements and ignore the rest
-  for (std::size_t i = 0; i < values.size() && i < numConversionsPerUser_;
-       ++i) {
-    int64_t parsed = 0;
-    std::istringstream iss{values[i]};
-    iss >> parsed;
-    if (iss.fail()) {
-      XLOG(FATAL) << "Failed to parse '" << iss.str() << "' to int64_t";
-    }
-    purchaseValueArrays_.back().push_back(parsed);
-    totalValue_ += parsed;
-    // If this is secret_share lift, we can't pre-compute squared values
-    if (liftMpcType_ == LiftMPCType::Standard) {
-      purchaseValueSquaredArrays_.back().push_back(parsed * parsed);
-    }
+  auto numValues = std::min<std::size_t>(values.size(), numConversionsPerUser_);
+  purchaseValueColumns_.addRow(values.begin(), values.begin() + numValues);
+  for (std::size_t i = 0; i < numValues; ++i) {
+    totalValue_ += std::abs(values[i]);
   }
 
+  // If this is secret_share lift, we can't pre-compute squared values.
   // For non-secret-share lift, we *can* use this valueSquared optimizations to
   // avoid doing addition/multiplication in MPC, though
   if (liftMpcType_ == LiftMPCType::Standard) {
-    auto& valuesArr = purchaseValueArrays_.back();
-    auto& valuesSquaredArr = purchaseValueSquaredArrays_.back();
+    purchaseValueSquaredColumns_.addRow(std::vector<int64_t>(numValues, 0));
     uint64_t acc = 0;
+    uint64_t absAcc = 0;
     // NOTE: Don't use `auto` here since it will give us std::size_t (which is
     // unsigned) and will underflow and cause an ASAN error.
-    for (int64_t i = valuesArr.size() - 1; i >= 0; --i) {
+    for (int64_t i = numValues - 1; i >= 0; --i) {
       // 1. Add accumulation of total value seen so far iterating backwards
-      acc += valuesArr.at(i);
+      acc += values[i];
+      absAcc += std::abs(values[i]);
       // 2. Set valuesSquared at this index as acc**2
-      valuesSquaredArr.at(i) = acc * acc;
+      purchaseValueSquaredColumns_.setLastRowValue(i, acc * acc);
     }
     // Finally, update totalValueSquared with the *maximum possible* value,
-    // which is what we just stored into the first value
-    totalValueSquared_ += valuesSquaredArr.at(0);
+    // which bounds every value squared stored above even if some values are
+    // negative
+    totalValueSquared_ += absAcc * absAcc;
   }
 }
 
 void InputData::addFromCSV(
     const std::vector<std::string>& header,
     const std::vector<std::string>& parts) {
-  std::vector<std::string> featureValues;
+  addRow(header, CsvRow{parts});
+}
+
+template <typename Row>
+void InputData::addRow(const std::vector<std::string>& header, const Row& row) {
+  std::vector<int64_t> values;
 
   // These bools + int64_t allow us to create separate vectors for testPop and
   // controlPop without enforcing an ordering between oppFlag and testFlag.
@@ -129,18 +350,16 @@ void InputData::addFromCSV(
   bool isADummyRow = true;
 
   for (std::size_t i = 0; i < header.size(); ++i) {
-    auto column = header[i];
-    auto value = parts[i];
+    // A csv row only holds the columns asked for in getInputColumns
+    if (!row.has(i)) {
+      continue;
+    }
+    auto& column = header[i];
     int64_t parsed = 0;
-    std::istringstream iss{value};
     // Array columns and features may be parsed differently
     if (!(column == "opportunity_timestamps" || column == "event_timestamps" ||
           column == "values" || column == "id_")) {
-      iss >> parsed;
-
-      if (iss.fail()) {
-        XLOG(FATAL) << "Failed to parse '" << iss.str() << "' to int64_t";
-      }
+      parsed = row.getInt64(i);
     }
 
     if (column == "opportunity") {
@@ -192,16 +411,17 @@ void InputData::addFromCSV(
       // When event_timestamp column presents (in standard Converter Lift
       // input), parse it as arrays of size 1.
       if (liftMpcType_ == LiftMPCType::Standard) {
-        value = "[" + value + "]";
-        isADummyRow &= setTimestamps(value, purchaseTimestampArrays_);
+        values.assign(1, parsed);
+        isADummyRow &= setTimestamps(values, purchaseTimestampColumns_);
       } else {
         purchaseTimestamps_.push_back(parsed < epoch_ ? 0 : parsed - epoch_);
         isADummyRow &= parsed == 0;
       }
     } else if (column == "event_timestamps") {
-      isADummyRow &= setTimestamps(value, purchaseTimestampArrays_);
+      row.getArray(i, numConversionsPerUser_, values);
+      isADummyRow &= setTimestamps(values, purchaseTimestampColumns_);
     } else if (column == "value") {
-      totalValue_ += parsed;
+      totalValue_ += std::abs(parsed);
       purchaseValues_.push_back(parsed);
       // If this is secret_share lift, we can't pre-compute squared values
       if (liftMpcType_ == LiftMPCType::Standard) {
@@ -209,7 +429,8 @@ void InputData::addFromCSV(
         purchaseValuesSquared_.push_back(parsed * parsed);
       }
     } else if (column == "values") {
-      setValuesFields(value);
+      row.getArray(i, numConversionsPerUser_, values);
+      setValuesFields(values);
     } else if (column == "value_squared") {
       // This column is only valid in secret_share lift
       // otherwise, we just use simple multiplication in the above condition
@@ -221,16 +442,17 @@ void InputData::addFromCSV(
       // This column is only valid in secret_share lift
       // otherwise, we just use single opportunity_timestamp
       if (liftMpcType_ == LiftMPCType::SecretShare) {
-        isADummyRow &= setTimestamps(value, opportunityTimestampArrays_);
+        row.getArray(i, numConversionsPerUser_, values);
+        isADummyRow &= setTimestamps(values, opportunityTimestampColumns_);
       }
     } else if (column == "purchase_flag") {
       // When purchase_flag column presents (in standard Converter Lift
       // input), parse it as arrays of size 1.
       if (liftMpcType_ == LiftMPCType::Standard) {
-        value = "[" + value + "]";
-        setValuesFields(value);
+        values.assign(1, parsed);
+        setValuesFields(values);
       } else {
-        totalValue_ += parsed;
+        totalValue_ += std::abs(parsed);
         purchaseValues_.push_back(parsed);
       }
     } else if (column != "id_") { // Do nothing with the id_ column as Lift
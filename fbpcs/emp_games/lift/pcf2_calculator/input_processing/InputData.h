@@ -15,24 +15,35 @@
 #include <unordered_map>
 #include <vector>
 
+#include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/RaggedColumns.h"
+
 namespace private_lift {
 
 /*
  * This class represents input data for a Private Lift computation.
  * It processes an input csv and generates the std::vectors for each column
  * It also has the ability to generate bitmasks for cohort metrics.
+ *
+ * The array columns only store the values each row has, up to
+ * numConversionsPerUser. They are padded with zeros to the conversion slots
+ * they are shared in when they are read by slot.
  */
 class InputData {
  public:
   enum class LiftMPCType { SecretShare, Standard };
 
-  // Constructor -- input is a path to a CSV along with the new epoch to use
+  // Constructor -- input is a path to a CSV along with the new epoch to use.
+  // With numParseThreads > 1 a local CSV is parsed in that many chunks in
+  // parallel, keeping the original row order. An input in the binary row
+  // group format written by the data_processing stages is read without any
+  // text parsing.
   explicit InputData(
       std::string filepath,
       LiftMPCType liftMpcType,
       bool computePublisherBreakdowns,
       int64_t epoch = 0,
-      int32_t numConversionsPerUser = INT32_MAX);
+      int32_t numConversionsPerUser = INT32_MAX,
+      int32_t numParseThreads = 1);
 
   InputData() {}
 
@@ -65,17 +76,18 @@ class InputData {
     return totalSpend_;
   }
 
-  const std::vector<std::vector<uint32_t>>& getOpportunityTimestampArrays()
-      const {
-    return opportunityTimestampArrays_;
+  const input_processing::RaggedColumns<uint32_t>&
+  getOpportunityTimestampColumns() const {
+    return opportunityTimestampColumns_;
   }
 
   const std::vector<uint32_t>& getPurchaseTimestamps() const {
     return purchaseTimestamps_;
   }
 
-  const std::vector<std::vector<uint32_t>>& getPurchaseTimestampArrays() const {
-    return purchaseTimestampArrays_;
+  const input_processing::RaggedColumns<uint32_t>&
+  getPurchaseTimestampColumns() const {
+    return purchaseTimestampColumns_;
   }
 
   const std::vector<int64_t>& getPurchaseValues() const {
@@ -86,13 +98,14 @@ class InputData {
     return purchaseValuesSquared_;
   }
 
-  const std::vector<std::vector<int64_t>>& getPurchaseValueArrays() const {
-    return purchaseValueArrays_;
+  const input_processing::RaggedColumns<int64_t>& getPurchaseValueColumns()
+      const {
+    return purchaseValueColumns_;
   }
 
-  const std::vector<std::vector<int64_t>>& getPurchaseValueSquaredArrays()
-      const {
-    return purchaseValueSquaredArrays_;
+  const input_processing::RaggedColumns<int64_t>&
+  getPurchaseValueSquaredColumns() const {
+    return purchaseValueSquaredColumns_;
   }
 
   const std::vector<uint32_t>& getPartnerCohortIds() const {
@@ -111,6 +124,8 @@ class InputData {
     return numPartnerCohorts_;
   }
 
+  // The number of bits of the sum of the magnitudes of the values, which
+  // bounds every sum of values, and likewise for the values squared
   int64_t getNumBitsForValue() const {
     return std::ceil(std::log2(totalValue_ + 1));
   }
@@ -132,37 +147,44 @@ class InputData {
   void setFeaturesHeader(const std::vector<std::string>& header);
 
   /*
-   * Append timestamps values from str to timestampArrays, adding offset to each
-   * value
+   * Add up to numConversionsPerUser_ timestamps from values as a row of
+   * timestampColumns, shifting each one by the epoch
    *
-   * str = input data in the format of a comma-separated list surrounded by
-   * brackets
-   * timestampArrays = an array to which input data from str append
-   * offset = add offset to each value from str before append
-   * return true if all timestamps in str are all zeros, otherwise return false
+   * values = the timestamps of an array cell
+   * timestampColumns = the columns to which the timestamps are added
+   * return true if all timestamps in values are all zeros, otherwise return
+   * false
    */
   bool setTimestamps(
-      std::string& str,
-      std::vector<std::vector<uint32_t>>& timestampArrays);
+      const std::vector<int64_t>& values,
+      input_processing::RaggedColumns<uint32_t>& timestampColumns);
 
   /*
-   * Append values from str to valueArrays and add to totalValue.
-   * If not secret_share lift, then also append squared values to
-   * valuesSquaredArrays and add to totalValueSquared.
+   * Add up to numConversionsPerUser_ values as a row of purchaseValueColumns_
+   * and add them to totalValue_. If not secret_share lift, then also add the
+   * squared values as a row of purchaseValueSquaredColumns_ and add to
+   * totalValueSquared_.
    *
-   * str = input data in the format of a comma-separated list surrounded by
-   * brackets
-   * valueArrays = an array to which input data from str append
-   * valuesSquaredArrays = an array to which the squares of input data from str
-   * append
+   * values = the values of an array cell
    */
-  void setValuesFields(std::string& str);
+  void setValuesFields(const std::vector<int64_t>& values);
+
+  // Helper to add a row into the component column vectors. Row is a csv line
+  // or a row of a row group, see InputData.cpp
+  template <typename Row>
+  void addRow(const std::vector<std::string>& header, const Row& row);
 
   // Helper to add a line from a CSV into the component column vectors
   void addFromCSV(
       const std::vector<std::string>& header,
       const std::vector<std::string>& parts);
 
+  // An InputData without any rows, parsing with the same settings as this one
+  InputData emptyWithSameConfig() const;
+
+  // Appends the rows of other after the rows of this InputData
+  void append(InputData&& other);
+
   LiftMPCType liftMpcType_;
   bool computePublisherBreakdowns_;
   int64_t epoch_;
@@ -177,10 +199,10 @@ class InputData {
   std::vector<int64_t> purchaseValuesSquared_;
   std::vector<uint32_t> partnerCohortIds_;
   std::vector<uint32_t> breakdownIds_;
-  std::vector<std::vector<uint32_t>> opportunityTimestampArrays_;
-  std::vector<std::vector<uint32_t>> purchaseTimestampArrays_;
-  std::vector<std::vector<int64_t>> purchaseValueArrays_;
-  std::vector<std::vector<int64_t>> purchaseValueSquaredArrays_;
+  input_processing::RaggedColumns<uint32_t> opportunityTimestampColumns_;
+  input_processing::RaggedColumns<uint32_t> purchaseTimestampColumns_;
+  input_processing::RaggedColumns<int64_t> purchaseValueColumns_;
+  input_processing::RaggedColumns<int64_t> purchaseValueSquaredColumns_;
   std::vector<bool> isDummyRow_;
 
   int64_t totalValue_ = 0;
@@ -190,6 +212,7 @@ class InputData {
   int32_t numConversionsPerUser_;
 
   bool firstLineParsedAlready_ = false;
+  // Already counts the row being added while it's parsed
   int64_t numRows_ = 0;
 };
 
@@ -15,6 +15,7 @@
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/GlobalSharingUtils.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/IInputProcessor.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/InputData.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/PackedColumns.h"
 
 namespace private_lift {
 /**
@@ -23,10 +24,19 @@ namespace private_lift {
 template <int schedulerId>
 class InputProcessor : public IInputProcessor<schedulerId> {
  public:
-  InputProcessor(int myRole, InputData inputData, int32_t numConversionsPerUser)
+  // With useRelativeTimestamps, the opportunity and threshold timestamps are
+  // shared relative to the earliest valid opportunity timestamp, which the
+  // publisher reveals to the partner, so that the attribution compares them
+  // at a narrower width. Both parties have to set it the same way.
+  InputProcessor(
+      int myRole,
+      InputData inputData,
+      int32_t numConversionsPerUser,
+      bool useRelativeTimestamps = false)
       : myRole_{myRole},
         inputData_{inputData},
-        numConversionsPerUser_{numConversionsPerUser} {
+        numConversionsPerUser_{numConversionsPerUser},
+        useRelativeTimestamps_{useRelativeTimestamps} {
     liftGameProcessedData_.numRows = inputData.getNumRows();
 
     input_processing::validateNumRowsStep(myRole_, liftGameProcessedData_);
@@ -34,9 +44,13 @@ class InputProcessor : public IInputProcessor<schedulerId> {
         myRole_, inputData_, liftGameProcessedData_);
     input_processing::shareBitsForValuesStep(
         myRole_, inputData_, liftGameProcessedData_);
+    if (useRelativeTimestamps_) {
+      timestampBase_ = input_processing::shareTimestampBaseStep(
+          myRole_, inputData_, liftGameProcessedData_);
+    }
 
-    privatelyShareGroupIdsStep();
-    privatelySharePopulationStep();
+    privatelySharePublisherInputsStep();
+    privatelySharePartnerInputsStep();
     input_processing::computeIndexSharesAndSetTestGroupIds(
         liftGameProcessedData_,
         cohortGroupIds_,
@@ -45,9 +59,6 @@ class InputProcessor : public IInputProcessor<schedulerId> {
         testGroupIds_);
     input_processing::computeTestIndexShares(
         liftGameProcessedData_, controlPopulation_, testGroupIds_);
-    privatelyShareTimestampsStep();
-    privatelySharePurchaseValuesStep();
-    privatelyShareTestReachStep();
   }
 
   InputProcessor() {}
@@ -58,11 +69,23 @@ class InputProcessor : public IInputProcessor<schedulerId> {
   }
 
  private:
-  // Privately share cohort ids and breakdown ids.
-  void privatelyShareGroupIdsStep();
+  // Privately share the columns a party packed in one batch of bits, returning
+  // the shares of the bits
+  template <int sender>
+  std::vector<bool> privatelySharePackedColumns(
+      const input_processing::PackedColumns& packedColumns);
 
-  // Privately share popoulation
-  void privatelySharePopulationStep();
+  // Privately share the breakdown ids, population, opportunity timestamps and
+  // test reach (nonzero impressions) of the publisher in one round.
+  void privatelySharePublisherInputsStep();
+
+  // The opportunity or threshold timestamp which is shared for a timestamp,
+  // see useRelativeTimestamps
+  uint32_t getSharedTimestamp(uint32_t timestamp) const;
+
+  // Privately share the cohort ids, purchase timestamps, purchase values and
+  // purchase values squared of the partner in one round.
+  void privatelySharePartnerInputsStep();
 
   // Privately share index shares of group ids encoding the population, cohorts
   // and publisher breakdowns.
@@ -71,20 +94,14 @@ class InputProcessor : public IInputProcessor<schedulerId> {
   // Privately share index shares of group ids for the test population only.
   void privatelyShareTestIndexSharesStep();
 
-  // Privately share timestamps
-  void privatelyShareTimestampsStep();
-
-  // Privately share purchase values and purchase values squared
-  void privatelySharePurchaseValuesStep();
-
-  // Privately share test reach (nonzero impressions)
-  void privatelyShareTestReachStep();
-
   int32_t myRole_;
   InputData inputData_;
 
   int32_t numConversionsPerUser_;
 
+  bool useRelativeTimestamps_ = false;
+  uint32_t timestampBase_ = 0;
+
   SecBit<schedulerId> controlPopulation_;
   SecGroup<schedulerId> cohortGroupIds_;
   SecBit<schedulerId> breakdownBitGroupIds_;
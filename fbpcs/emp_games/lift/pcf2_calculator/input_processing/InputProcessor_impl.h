@@ -12,164 +12,178 @@
 namespace private_lift {
 
 template <int schedulerId>
-void InputProcessor<schedulerId>::privatelyShareGroupIdsStep() {
-  XLOG(INFO) << "Share cohort group ids";
-  cohortGroupIds_ = common::privatelyShareArrayWithPaddingFrom<
-      common::PARTNER,
-      uint32_t,
-      SecGroup<schedulerId>>(
-      inputData_.getPartnerCohortIds(), liftGameProcessedData_.numRows, 0);
-
-  XLOG(INFO) << "Share publisher breakdown group ids";
-  std::vector<bool> booleanBreakdownGroupIds(
-      inputData_.getBreakdownIds().begin(), inputData_.getBreakdownIds().end());
-  breakdownBitGroupIds_ = common::privatelyShareArrayWithPaddingFrom<
-      common::PUBLISHER,
-      bool,
-      SecBit<schedulerId>>(
-      booleanBreakdownGroupIds, liftGameProcessedData_.numRows, 0);
+template <int sender>
+std::vector<bool> InputProcessor<schedulerId>::privatelySharePackedColumns(
+    const input_processing::PackedColumns& packedColumns) {
+  return SecBit<schedulerId>(packedColumns.getBits(), sender)
+      .extractBit()
+      .getValue();
 }
 
 template <int schedulerId>
-void InputProcessor<schedulerId>::privatelySharePopulationStep() {
-  XLOG(INFO) << "Share control population";
-  controlPopulation_ = common::privatelyShareArrayWithPaddingFrom<
-      common::PUBLISHER,
-      bool,
-      SecBit<schedulerId>>(
-      inputData_.getControlPopulation(), liftGameProcessedData_.numRows, 0);
+uint32_t InputProcessor<schedulerId>::getSharedTimestamp(
+    uint32_t timestamp) const {
+  if (!useRelativeTimestamps_ || timestamp == 0) {
+    return timestamp;
+  }
+  return input_processing::getRelativeTimestamp(
+      timestamp, timestampBase_, liftGameProcessedData_.timestampBits);
 }
 
 template <int schedulerId>
-void InputProcessor<schedulerId>::privatelyShareTimestampsStep() {
-  // TODO: We're using 32 bits for timestamps along with an offset setting the
-  // epoch to 2019-01-01. This will break in the year 2087.
-  XLOG(INFO) << "Share opportunity timestamps";
-  liftGameProcessedData_.opportunityTimestamps =
-      common::privatelyShareArrayWithPaddingFrom<
-          common::PUBLISHER,
-          uint32_t,
-          SecTimestamp<schedulerId>>(
-          inputData_.getOpportunityTimestamps(),
-          liftGameProcessedData_.numRows,
-          0);
-
-  XLOG(INFO) << "Share if opportunity timestamps are valid";
+void InputProcessor<schedulerId>::privatelySharePublisherInputsStep() {
+  const auto numRows = liftGameProcessedData_.numRows;
+  std::vector<bool> booleanBreakdownGroupIds(
+      inputData_.getBreakdownIds().begin(), inputData_.getBreakdownIds().end());
+
   std::vector<bool> isValidOpportunityTimestamp;
+  std::vector<uint32_t> opportunityTimestamps;
   for (size_t i = 0; i < inputData_.getOpportunityTimestamps().size(); ++i) {
     // Nonzero opportunity timestamp and is opportunity (test or control)
     isValidOpportunityTimestamp.push_back(
         (inputData_.getOpportunityTimestamps().at(i) > 0) &&
         (inputData_.getControlPopulation().at(i) ||
          inputData_.getTestPopulation().at(i)));
+    opportunityTimestamps.push_back(
+        getSharedTimestamp(inputData_.getOpportunityTimestamps().at(i)));
+  }
+
+  std::vector<bool> testReach;
+  for (size_t i = 0; i < inputData_.getNumImpressions().size(); ++i) {
+    // A reach occurs when the number of impressions is nonzero, and we only
+    // compute this for the test population.
+    testReach.push_back(
+        inputData_.getTestPopulation().at(i) &&
+        (inputData_.getNumImpressions().at(i) > 0));
   }
+
+  // TODO: We're using 32 bits for timestamps along with an offset setting the
+  // epoch to 2019-01-01. This will break in the year 2087.
+  XLOG(INFO) << "Share publisher breakdown group ids, control population, "
+             << "opportunity timestamps and reach";
+  input_processing::PackedColumns packedColumns{numRows};
+  auto breakdownOffset = packedColumns.addBits(booleanBreakdownGroupIds);
+  auto controlPopulationOffset =
+      packedColumns.addBits(inputData_.getControlPopulation());
+  auto opportunityTimestampsOffset =
+      packedColumns.addInts(opportunityTimestamps, timeStampWidth);
+  auto isValidOpportunityTimestampOffset =
+      packedColumns.addBits(isValidOpportunityTimestamp);
+  auto testReachOffset = packedColumns.addBits(testReach);
+  auto shares = privatelySharePackedColumns<common::PUBLISHER>(packedColumns);
+
+  breakdownBitGroupIds_ =
+      SecBit<schedulerId>(typename SecBit<schedulerId>::ExtractedBit(
+          packedColumns.getBitShares(shares, breakdownOffset)));
+  controlPopulation_ =
+      SecBit<schedulerId>(typename SecBit<schedulerId>::ExtractedBit(
+          packedColumns.getBitShares(shares, controlPopulationOffset)));
+  liftGameProcessedData_.opportunityTimestamps = SecTimestamp<schedulerId>(
+      typename SecTimestamp<schedulerId>::ExtractedInt(
+          packedColumns.getIntShares<uint64_t>(
+              shares, opportunityTimestampsOffset, timeStampWidth)));
   liftGameProcessedData_.isValidOpportunityTimestamp =
-      common::privatelyShareArrayWithPaddingFrom<
-          common::PUBLISHER,
-          bool,
-          SecBit<schedulerId>>(
-          isValidOpportunityTimestamp, liftGameProcessedData_.numRows, 0);
-
-  XLOG(INFO) << "Share purchase timestamps";
-  liftGameProcessedData_.purchaseTimestamps =
-      common::privatelyShareTransposedArraysWithPaddingFrom<
-          common::PARTNER,
-          uint32_t,
-          SecTimestamp<schedulerId>>(
-          inputData_.getPurchaseTimestampArrays(),
-          liftGameProcessedData_.numRows,
-          numConversionsPerUser_,
-          0);
-
-  XLOG(INFO) << "Share if any purchase timestamp is valid";
-  std::vector<bool> anyValidPurchaseTimestamp;
-  for (const std::vector<uint32_t>& purchaseTimestampArray :
-       inputData_.getPurchaseTimestampArrays()) {
-    bool anyValidPurchaseTs = false;
-    for (uint32_t purchaseTs : purchaseTimestampArray) {
+      SecBit<schedulerId>(typename SecBit<schedulerId>::ExtractedBit(
+          packedColumns.getBitShares(
+              shares, isValidOpportunityTimestampOffset)));
+  liftGameProcessedData_.testReach =
+      SecBit<schedulerId>(typename SecBit<schedulerId>::ExtractedBit(
+          packedColumns.getBitShares(shares, testReachOffset)));
+}
+
+template <int schedulerId>
+void InputProcessor<schedulerId>::privatelySharePartnerInputsStep() {
+  const auto numRows = liftGameProcessedData_.numRows;
+  // The purchase timestamps and values only hold the values of each row, and
+  // are padded to the conversion slots as they are packed
+  const auto& purchaseTimestampColumns =
+      inputData_.getPurchaseTimestampColumns();
+
+  std::vector<bool> anyValidPurchaseTimestamp(
+      purchaseTimestampColumns.getNumRows());
+  // Threshold timestamps are valid (positive) purchase timestamp with added
+  // attribution window
+  input_processing::RaggedColumns<uint32_t> thresholdTimestampColumns;
+  std::vector<uint32_t> thresholdTimestamps;
+  for (size_t i = 0; i < purchaseTimestampColumns.getNumRows(); ++i) {
+    thresholdTimestamps.clear();
+    for (size_t j = 0; j < purchaseTimestampColumns.getRowSize(i); ++j) {
+      auto purchaseTimestamp = purchaseTimestampColumns.at(i, j);
       // compute whether each row contains at least one valid (positive)
       // purchase timestamp
-      anyValidPurchaseTs = anyValidPurchaseTs || (purchaseTs > 0);
+      if (purchaseTimestamp > 0) {
+        anyValidPurchaseTimestamp[i] = true;
+      }
+      thresholdTimestamps.push_back(
+          purchaseTimestamp > 0
+              ? getSharedTimestamp(
+                    purchaseTimestamp + kPurchaseTimestampThresholdWindow)
+              : 0);
     }
-    anyValidPurchaseTimestamp.push_back(anyValidPurchaseTs);
+    thresholdTimestampColumns.addRow(thresholdTimestamps);
   }
-  liftGameProcessedData_.anyValidPurchaseTimestamp =
-      common::privatelyShareArrayWithPaddingFrom<
-          common::PARTNER,
-          bool,
-          SecBit<schedulerId>>(
-          anyValidPurchaseTimestamp, liftGameProcessedData_.numRows, 0);
 
-  XLOG(INFO) << "Share threshold timestamps";
-  // Threshold timestamps are valid (positive) purchase timestamp with added
-  // attribution window
-  std::vector<std::vector<uint32_t>> thresholdTimestampArrays;
-  for (const auto& purchaseTimestampArray :
-       inputData_.getPurchaseTimestampArrays()) {
-    std::vector<uint32_t> thresholdTimestampArray;
-    for (auto purchaseTimestamp : purchaseTimestampArray) {
-      auto thresholdTimestamp = purchaseTimestamp > 0
-          ? purchaseTimestamp + kPurchaseTimestampThresholdWindow
-          : 0;
-      thresholdTimestampArray.push_back(thresholdTimestamp);
+  XLOG(INFO) << "Share partner cohort group ids, purchase timestamps, "
+             << "threshold timestamps and purchase values";
+  input_processing::PackedColumns packedColumns{numRows};
+  auto cohortOffset =
+      packedColumns.addInts(inputData_.getPartnerCohortIds(), groupWidth);
+  auto addColumns = [this, &packedColumns](
+                        const auto& columns, size_t width) {
+    std::vector<size_t> offsets;
+    offsets.reserve(numConversionsPerUser_);
+    for (int32_t i = 0; i < numConversionsPerUser_; ++i) {
+      offsets.push_back(packedColumns.addSlot(columns, i, width));
     }
-    thresholdTimestampArrays.push_back(std::move(thresholdTimestampArray));
-  }
-  // Secretly share threshold timestamps
-  liftGameProcessedData_.thresholdTimestamps =
-      common::privatelyShareTransposedArraysWithPaddingFrom<
-          common::PARTNER,
-          uint32_t,
-          SecTimestamp<schedulerId>>(
-          thresholdTimestampArrays,
-          liftGameProcessedData_.numRows,
-          numConversionsPerUser_,
-          0);
-}
+    return offsets;
+  };
+  auto purchaseTimestampOffsets =
+      addColumns(purchaseTimestampColumns, timeStampWidth);
+  auto anyValidPurchaseTimestampOffset =
+      packedColumns.addBits(anyValidPurchaseTimestamp);
+  auto thresholdTimestampOffsets =
+      addColumns(thresholdTimestampColumns, timeStampWidth);
+  auto purchaseValueOffsets =
+      addColumns(inputData_.getPurchaseValueColumns(), valueWidth);
+  auto purchaseValueSquaredOffsets = addColumns(
+      inputData_.getPurchaseValueSquaredColumns(), valueSquaredWidth);
+  auto shares = privatelySharePackedColumns<common::PARTNER>(packedColumns);
 
-template <int schedulerId>
-void InputProcessor<schedulerId>::privatelySharePurchaseValuesStep() {
-  XLOG(INFO) << "Share purchase values";
-  // Since the input values are processed row by row, while we will be doing
-  // batch computations with the values across the rows, we have to first
-  // transpose the input arrays before sharing them in MPC.
-  liftGameProcessedData_.purchaseValues =
-      common::privatelyShareTransposedArraysWithPaddingFrom<
-          common::PARTNER,
-          int64_t,
-          SecValue<schedulerId>>(
-          inputData_.getPurchaseValueArrays(),
-          liftGameProcessedData_.numRows,
-          numConversionsPerUser_,
-          0);
-
-  XLOG(INFO) << "Share purchase values squared";
-  liftGameProcessedData_.purchaseValueSquared =
-      common::privatelyShareTransposedArraysWithPaddingFrom<
-          common::PARTNER,
-          int64_t,
-          SecValueSquared<schedulerId>>(
-          inputData_.getPurchaseValueSquaredArrays(),
-          liftGameProcessedData_.numRows,
-          numConversionsPerUser_,
-          0);
-}
+  cohortGroupIds_ = SecGroup<schedulerId>(
+      typename SecGroup<schedulerId>::ExtractedInt(
+          packedColumns.getIntShares<uint64_t>(
+              shares, cohortOffset, groupWidth)));
+  liftGameProcessedData_.anyValidPurchaseTimestamp =
+      SecBit<schedulerId>(typename SecBit<schedulerId>::ExtractedBit(
+          packedColumns.getBitShares(shares, anyValidPurchaseTimestampOffset)));
 
-template <int schedulerId>
-void InputProcessor<schedulerId>::privatelyShareTestReachStep() {
-  XLOG(INFO) << "Share reach";
-  std::vector<bool> testReach;
-  for (size_t i = 0; i < inputData_.getNumImpressions().size(); ++i) {
-    // A reach occurs when the number of impressions is nonzero, and we only
-    // compute this for the test population.
-    testReach.push_back(
-        inputData_.getTestPopulation().at(i) &&
-        (inputData_.getNumImpressions().at(i) > 0));
+  liftGameProcessedData_.purchaseTimestamps.clear();
+  liftGameProcessedData_.thresholdTimestamps.clear();
+  liftGameProcessedData_.purchaseValues.clear();
+  liftGameProcessedData_.purchaseValueSquared.clear();
+  for (int32_t i = 0; i < numConversionsPerUser_; ++i) {
+    liftGameProcessedData_.purchaseTimestamps.push_back(
+        SecTimestamp<schedulerId>(
+            typename SecTimestamp<schedulerId>::ExtractedInt(
+                packedColumns.getIntShares<uint64_t>(
+                    shares, purchaseTimestampOffsets.at(i), timeStampWidth))));
+    liftGameProcessedData_.thresholdTimestamps.push_back(
+        SecTimestamp<schedulerId>(
+            typename SecTimestamp<schedulerId>::ExtractedInt(
+                packedColumns.getIntShares<uint64_t>(
+                    shares, thresholdTimestampOffsets.at(i), timeStampWidth))));
+    liftGameProcessedData_.purchaseValues.push_back(
+        SecValue<schedulerId>(typename SecValue<schedulerId>::ExtractedInt(
+            packedColumns.getIntShares<int64_t>(
+                shares, purchaseValueOffsets.at(i), valueWidth))));
+    liftGameProcessedData_.purchaseValueSquared.push_back(
+        SecValueSquared<schedulerId>(
+            typename SecValueSquared<schedulerId>::ExtractedInt(
+                packedColumns.getIntShares<int64_t>(
+                    shares,
+                    purchaseValueSquaredOffsets.at(i),
+                    valueSquaredWidth))));
   }
-  liftGameProcessedData_.testReach = common::privatelyShareArrayWithPaddingFrom<
-      common::PUBLISHER,
-      bool,
-      SecBit<schedulerId>>(testReach, liftGameProcessedData_.numRows, 0);
 }
 
 } // namespace private_lift
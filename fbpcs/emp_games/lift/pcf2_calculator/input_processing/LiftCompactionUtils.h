@@ -70,6 +70,10 @@ template <int schedulerId>
 using SecString = typename fbpcf::mpc_std_lib::unified_data_process::
     data_processor::IDataProcessor<schedulerId>::SecString;
 
+// Moves the columns of the compacted rows into liftGameProcessedData. The
+// numbers of bits of the values are left as the caller has set them, as only
+// the partner holding the values in the clear can share them, see
+// shareBitsForValuesStep.
 template <int schedulerId>
 void extractCompactedData(
     LiftGameProcessedData<schedulerId>& liftGameProcessedData,
@@ -97,37 +101,39 @@ void extractCompactedData(
 
   using MPCTypes = fbpcf::frontend::MPCTypes<schedulerId, true>;
 
+  // The columns are moved out of the deserialized rows, as every copy of a
+  // share updates the reference counts of its wires in the scheduler
   breakdownGroupIds = std::get<typename MPCTypes::SecBool>(
-      publisherDeserialized.at("breakdownId"));
+      std::move(publisherDeserialized.at("breakdownId")));
   controlPopulation = std::get<typename MPCTypes::SecBool>(
-      publisherDeserialized.at("controlPopulation"));
+      std::move(publisherDeserialized.at("controlPopulation")));
   cohortGroupIds = std::get<typename MPCTypes::SecUnsigned32Int>(
-      partnerDeserialized.at("cohortGroupId"));
+      std::move(partnerDeserialized.at("cohortGroupId")));
 
   liftGameProcessedData.isValidOpportunityTimestamp =
       std::get<typename MPCTypes::SecBool>(
-          publisherDeserialized.at("isValidOpportunityTimestamp"));
+          std::move(publisherDeserialized.at("isValidOpportunityTimestamp")));
   liftGameProcessedData.testReach = std::get<typename MPCTypes::SecBool>(
-      publisherDeserialized.at("testReach"));
+      std::move(publisherDeserialized.at("testReach")));
   liftGameProcessedData.opportunityTimestamps =
       std::get<typename MPCTypes::SecUnsigned32Int>(
-          publisherDeserialized.at("opportunityTimestamp"));
+          std::move(publisherDeserialized.at("opportunityTimestamp")));
 
   liftGameProcessedData.anyValidPurchaseTimestamp =
       std::get<typename MPCTypes::SecBool>(
-          partnerDeserialized.at("anyValidPurchaseTimestamp"));
+          std::move(partnerDeserialized.at("anyValidPurchaseTimestamp")));
   liftGameProcessedData.purchaseTimestamps =
       std::get<std::vector<typename MPCTypes::SecUnsigned32Int>>(
-          partnerDeserialized.at("purchaseTimestamp"));
+          std::move(partnerDeserialized.at("purchaseTimestamp")));
   liftGameProcessedData.thresholdTimestamps =
       std::get<std::vector<typename MPCTypes::SecUnsigned32Int>>(
-          partnerDeserialized.at("thresholdTimestamp"));
+          std::move(partnerDeserialized.at("thresholdTimestamp")));
   liftGameProcessedData.purchaseValues =
       std::get<std::vector<typename MPCTypes::Sec32Int>>(
-          partnerDeserialized.at("purchaseValue"));
+          std::move(partnerDeserialized.at("purchaseValue")));
   liftGameProcessedData.purchaseValueSquared =
       std::get<std::vector<typename MPCTypes::Sec64Int>>(
-          partnerDeserialized.at("purchaseValueSquared"));
+          std::move(partnerDeserialized.at("purchaseValueSquared")));
 }
 
 } // namespace private_lift::input_processing
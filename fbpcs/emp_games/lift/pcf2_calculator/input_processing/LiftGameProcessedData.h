@@ -8,7 +8,10 @@
 #pragma once
 
 #include <cstdint>
+#include <string_view>
 #include <vector>
+#include "fbpcf/io/api/BufferedReader.h"
+#include "fbpcf/io/api/BufferedWriter.h"
 #include "fbpcs/emp_games/common/Csv.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/Constants.h"
 
@@ -38,6 +41,11 @@ inline const std::vector<std::string> SECRET_SHARES_HEADER = {
     "purchaseValueSquared",
     "testReach"};
 
+// Magic bytes and version at the start of a binary secret shares file, see
+// LiftGameProcessedData::writeToBinary for the layout.
+inline constexpr char kBinarySecretSharesMagic[4] = {'L', 'G', 'P', 'D'};
+inline constexpr uint32_t kBinarySecretSharesVersion = 1;
+
 template <int schedulerId>
 struct LiftGameProcessedData {
   int64_t numRows = 0;
@@ -47,8 +55,15 @@ struct LiftGameProcessedData {
   uint32_t numBreakdownTestGroups = 0;
   uint32_t numCohortTestGroups = 0;
   uint32_t numTestGroups = 0;
-  uint8_t valueBits = 0;
-  uint8_t valueSquaredBits = 0;
+  // The numbers of bits of the totals of the values and of the values squared,
+  // which are the full widths unless an input processor has shared them, so
+  // that unknown totals never take the narrow value widths
+  uint8_t valueBits = valueWidth;
+  uint8_t valueSquaredBits = valueSquaredWidth;
+  // The number of bits which hold the opportunity timestamps and the threshold
+  // timestamps, which are only narrower than timeStampWidth when they are
+  // relative to the earliest valid opportunity timestamp
+  uint8_t timestampBits = timeStampWidth;
   std::vector<std::vector<bool>> indexShares;
   std::vector<std::vector<bool>> testIndexShares;
   SecGroup<schedulerId> indexBreakdownShares;
@@ -68,45 +83,121 @@ struct LiftGameProcessedData {
       const std::string& globalParamsOutputPath,
       const std::string& secretSharesOutputPath) const;
 
+  // With numParseThreads > 1, the rows of a local secret shares file are
+  // split into that many ranges, which are parsed concurrently and then
+  // appended in file order. If columns is not empty, only the columns of
+  // SECRET_SHARES_HEADER named in it are parsed and the others are left empty.
   static LiftGameProcessedData readFromCSV(
       const std::string& globalParamsInputPath,
-      const std::string& secretSharesInputPath);
+      const std::string& secretSharesInputPath,
+      size_t numParseThreads = 1,
+      const std::vector<std::string>& columns = {});
+
+  /**
+   * Writes the global params csv as writeToCSV does, but writes the secret
+   * shares as a versioned little-endian columnar binary file. Bit shares are
+   * packed 8 per byte and integer shares are written as raw 64-bit values. The
+   * file header repeats the GLOBAL_PARAMS_HEADER fields so the shares can be
+   * read back without the params file.
+   */
+  void writeToBinary(
+      const std::string& globalParamsOutputPath,
+      const std::string& secretSharesOutputPath) const;
+
+  // Reads only the columns named in columns if it is not empty, as
+  // readFromCSV does. The others are skipped over without being decoded.
+  static LiftGameProcessedData readFromBinary(
+      const std::string& secretSharesInputPath,
+      const std::vector<std::string>& columns = {});
 
  private:
+  struct ExtractedShares {
+    std::vector<uint64_t> opportunityTimestamps;
+    std::vector<bool> isValidOpportunityTimestamp;
+    std::vector<std::vector<uint64_t>> purchaseTimestamps;
+    std::vector<std::vector<uint64_t>> thresholdTimestamps;
+    std::vector<bool> anyValidPurchaseTimestamp;
+    std::vector<std::vector<int64_t>> purchaseValues;
+    std::vector<std::vector<int64_t>> purchaseValueSquared;
+    std::vector<bool> testReach;
+  };
+
+  ExtractedShares extractShares() const;
+
+  void writeGlobalParams(const std::string& globalParamsOutputPath) const;
+
+  static void writeBitColumn(
+      fbpcf::io::BufferedWriter& writer,
+      const std::vector<bool>& column);
+
   template <typename T>
-  static std::string joinColumn(
-      const std::vector<std::vector<T>>& data,
-      size_t columnIndex);
+  static void writeIntColumn(
+      fbpcf::io::BufferedWriter& writer,
+      const std::vector<T>& column);
+
+  static void readExactly(
+      fbpcf::io::BufferedReader& reader,
+      std::vector<char>& buf);
+
+  static std::vector<bool> readBitColumn(
+      fbpcf::io::BufferedReader& reader,
+      size_t numRows);
+
+  // Reads past numBytes bytes in bounded chunks. The reader can't seek, as
+  // the file may be compressed.
+  static void skipBytes(fbpcf::io::BufferedReader& reader, size_t numBytes);
 
   template <typename T>
-  static std::vector<T> extractColumn(
+  static std::vector<T> readIntColumn(
+      fbpcf::io::BufferedReader& reader,
+      size_t numRows);
+
+  // Plaintext share columns collected while reading a secret shares csv,
+  // before they are wrapped into the secret types.
+  struct ShareColumns {
+    std::vector<std::vector<bool>> indexShares;
+    std::vector<std::vector<bool>> testIndexShares;
+    ExtractedShares shares;
+  };
+
+  // Appends the rows of from, which come after the rows of to, reserving the
+  // array columns of to for expectedRows rows
+  static void appendShareColumns(
+      ShareColumns& to,
+      ShareColumns&& from,
+      size_t expectedRows);
+
+  void appendCsvRow(
+      std::string& out,
+      const ExtractedShares& shares,
+      size_t row) const;
+
+  template <typename T>
+  static void appendJoinedColumn(
+      std::string& out,
       const std::vector<std::vector<T>>& data,
       size_t columnIndex);
 
   template <typename T>
-  static std::vector<std::vector<T>> transpose(
-      const std::vector<std::vector<T>>& data);
-
-  static std::vector<std::string> splitValueArray(const std::string& str);
+  static void appendArrayCell(
+      std::string_view cell,
+      std::vector<std::vector<T>>& columns,
+      std::vector<T>& rowBuffer,
+      size_t expectedRows,
+      bool firstRow);
 
   static std::function<
       void(const std::vector<std::string>&, const std::vector<std::string>&)>
   readParamsLine(LiftGameProcessedData<schedulerId>& result);
 
-  static std::function<
-      void(const std::vector<std::string>&, const std::vector<std::string>&)>
+  static std::function<void(
+      const std::vector<std::string>&,
+      const std::vector<std::string_view>&)>
   readSharesLine(
-      LiftGameProcessedData<schedulerId>& result,
-      std::vector<std::vector<bool>>& indexShares,
-      std::vector<std::vector<bool>>& testIndexShares,
-      std::vector<uint64_t>& opportunityTimestampsShares,
-      std::vector<bool>& isValidOpportunityTimestampShares,
-      std::vector<std::vector<uint64_t>>& purchaseTimestampShares,
-      std::vector<std::vector<uint64_t>>& thresholdTimestampShares,
-      std::vector<bool>& anyValidPurchaseTimestampShares,
-      std::vector<std::vector<int64_t>>& purchaseValueShares,
-      std::vector<std::vector<int64_t>>& purchaseValueSquaredShares,
-      std::vector<bool>& testReachShares);
+      int64_t& numRows,
+      ShareColumns& columns,
+      size_t expectedRows,
+      const std::vector<std::string>& selectedColumns);
 };
 
 } // namespace private_lift
@@ -8,245 +8,704 @@
 #pragma once
 
 #include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <functional>
 #include <iterator>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include "fbpcf/io/api/FileReader.h"
+#include "fbpcf/io/api/FileWriter.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
+#include "fbpcs/emp_games/common/Util.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/LiftGameProcessedData.h"
+#include "folly/String.h"
+#include "folly/lang/Bits.h"
 #include "folly/logging/xlog.h"
 
 namespace private_lift {
 
-template <int schedulerId>
-void LiftGameProcessedData<schedulerId>::writeToCSV(
-    const std::string& globalParamsOutputPath,
-    const std::string& secretSharesOutputPath) const {
-  std::vector<std::vector<std::string>> globalParams = {
-      {std::to_string(numPartnerCohorts),
-       std::to_string(numPublisherBreakdowns),
-       std::to_string(numGroups),
-       std::to_string(numTestGroups),
-       std::to_string(valueBits),
-       std::to_string(valueSquaredBits)}};
+namespace detail {
 
-  private_measurement::csv::writeCsv(
-      globalParamsOutputPath, GLOBAL_PARAMS_HEADER, globalParams);
+// Number of rows encoded or decoded at a time when streaming a binary column,
+// so that the whole column never has to be held as bytes in memory.
+constexpr size_t kBinaryColumnChunkRows = 1 << 16;
 
-  if (numRows == 0) {
-    private_measurement::csv::writeCsv(
-        secretSharesOutputPath, SECRET_SHARES_HEADER, {});
-    return;
-  }
+// Number of rows formatted at a time by writeToCSV, which bounds the amount of
+// csv text held in memory to a single row group.
+constexpr size_t kCsvRowGroupRows = 1 << 16;
+
+template <typename T>
+void appendLittleEndian(std::vector<char>& buf, T value) {
+  auto le = folly::Endian::little(value);
+  auto bytes = reinterpret_cast<const char*>(&le);
+  buf.insert(buf.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T consumeLittleEndian(const std::vector<char>& buf, size_t& offset) {
+  T value;
+  std::memcpy(&value, buf.data() + offset, sizeof(T));
+  offset += sizeof(T);
+  return folly::Endian::little(value);
+}
 
-  std::vector<std::vector<std::string>> secretShares(numRows);
+template <typename T>
+T parseCsvScalar(std::string_view value) {
+  T parsed = 0;
+  std::from_chars(value.data(), value.data() + value.size(), parsed);
+  return parsed;
+}
 
-  std::vector<uint64_t> opportunityTimestampsShares =
+} // namespace detail
+
+template <int schedulerId>
+typename LiftGameProcessedData<schedulerId>::ExtractedShares
+LiftGameProcessedData<schedulerId>::extractShares() const {
+  ExtractedShares shares;
+  shares.opportunityTimestamps =
       opportunityTimestamps.extractIntShare().getValue();
-  std::vector<bool> isValidOpportunityTimestampShares =
+  shares.isValidOpportunityTimestamp =
       isValidOpportunityTimestamp.extractBit().getValue();
-  std::vector<std::vector<uint64_t>> purchaseTimestampShares;
   std::transform(
       purchaseTimestamps.begin(),
       purchaseTimestamps.end(),
-      std::back_inserter(purchaseTimestampShares),
+      std::back_inserter(shares.purchaseTimestamps),
       [](const SecTimestamp<schedulerId>& purchaseTimestamp) {
         return purchaseTimestamp.extractIntShare().getValue();
       });
-  std::vector<std::vector<uint64_t>> thresholdTimestampShares;
   std::transform(
       thresholdTimestamps.begin(),
       thresholdTimestamps.end(),
-      std::back_inserter(thresholdTimestampShares),
+      std::back_inserter(shares.thresholdTimestamps),
       [](const SecTimestamp<schedulerId>& thresholdTimestamp) {
         return thresholdTimestamp.extractIntShare().getValue();
       });
-  std::vector<bool> anyValidPurchaseTimestampShares =
+  shares.anyValidPurchaseTimestamp =
       anyValidPurchaseTimestamp.extractBit().getValue();
-  std::vector<std::vector<int64_t>> purchaseValueShares;
   std::transform(
       purchaseValues.begin(),
       purchaseValues.end(),
-      std::back_inserter(purchaseValueShares),
+      std::back_inserter(shares.purchaseValues),
       [](const SecValue<schedulerId>& purchaseValue) {
         return purchaseValue.extractIntShare().getValue();
       });
-  std::vector<std::vector<int64_t>> purchaseValueSquaredShares;
   std::transform(
       purchaseValueSquared.begin(),
       purchaseValueSquared.end(),
-      std::back_inserter(purchaseValueSquaredShares),
+      std::back_inserter(shares.purchaseValueSquared),
       [](const SecValueSquared<schedulerId>& purchaseValueSquared_2) {
         return purchaseValueSquared_2.extractIntShare().getValue();
       });
-  std::vector<bool> testReachShares = testReach.extractBit().getValue();
-
-  for (size_t i = 0; i < numRows; i++) {
-    secretShares[i] = std::vector<std::string>();
-    secretShares[i].reserve(SECRET_SHARES_HEADER.size());
-
-    // id_ column
-    secretShares[i].push_back(std::to_string(i));
-    secretShares[i].push_back(joinColumn(indexShares, i));
-    secretShares[i].push_back(joinColumn(testIndexShares, i));
-    secretShares[i].push_back(std::to_string(opportunityTimestampsShares[i]));
-    secretShares[i].push_back(
-        std::to_string(isValidOpportunityTimestampShares[i]));
-    secretShares[i].push_back(joinColumn(purchaseTimestampShares, i));
-    secretShares[i].push_back(joinColumn(thresholdTimestampShares, i));
-    secretShares[i].push_back(
-        std::to_string(anyValidPurchaseTimestampShares[i]));
-    secretShares[i].push_back(joinColumn(purchaseValueShares, i));
-    secretShares[i].push_back(joinColumn(purchaseValueSquaredShares, i));
-    secretShares[i].push_back(std::to_string(testReachShares[i]));
-  }
+  shares.testReach = testReach.extractBit().getValue();
+  return shares;
+}
+
+template <int schedulerId>
+void LiftGameProcessedData<schedulerId>::writeGlobalParams(
+    const std::string& globalParamsOutputPath) const {
+  std::vector<std::vector<std::string>> globalParams = {
+      {std::to_string(numPartnerCohorts),
+       std::to_string(numPublisherBreakdowns),
+       std::to_string(numGroups),
+       std::to_string(numTestGroups),
+       std::to_string(valueBits),
+       std::to_string(valueSquaredBits)}};
 
   private_measurement::csv::writeCsv(
-      secretSharesOutputPath, SECRET_SHARES_HEADER, secretShares);
+      globalParamsOutputPath, GLOBAL_PARAMS_HEADER, globalParams);
+}
+
+template <int schedulerId>
+void LiftGameProcessedData<schedulerId>::writeToCSV(
+    const std::string& globalParamsOutputPath,
+    const std::string& secretSharesOutputPath) const {
+  writeGlobalParams(globalParamsOutputPath);
+
+  auto fileWriter =
+      private_measurement::compressed_io::makeFileWriter(
+          secretSharesOutputPath);
+  auto writer =
+      std::make_unique<fbpcf::io::BufferedWriter>(std::move(fileWriter));
+
+  std::string rowGroup;
+  folly::join(',', SECRET_SHARES_HEADER, rowGroup);
+  rowGroup += '\n';
+  writer->writeString(rowGroup);
+
+  if (numRows == 0) {
+    writer->close();
+    return;
+  }
+
+  auto shares = extractShares();
+
+  // Only one row group of formatted output is held at a time, the remaining
+  // rows stay in their extracted integer form until their group is written.
+  size_t totalRows = numRows;
+  for (size_t groupStart = 0; groupStart < totalRows;
+       groupStart += detail::kCsvRowGroupRows) {
+    auto groupEnd =
+        std::min(groupStart + detail::kCsvRowGroupRows, totalRows);
+    rowGroup.clear();
+    for (size_t i = groupStart; i < groupEnd; i++) {
+      appendCsvRow(rowGroup, shares, i);
+    }
+    writer->writeString(rowGroup);
+  }
+
+  writer->close();
+}
+
+template <int schedulerId>
+void LiftGameProcessedData<schedulerId>::appendCsvRow(
+    std::string& out,
+    const ExtractedShares& shares,
+    size_t row) const {
+  // id_ column
+  out += std::to_string(row);
+  out += ',';
+  appendJoinedColumn(out, indexShares, row);
+  out += ',';
+  appendJoinedColumn(out, testIndexShares, row);
+  out += ',';
+  out += std::to_string(shares.opportunityTimestamps[row]);
+  out += ',';
+  out += std::to_string(shares.isValidOpportunityTimestamp[row]);
+  out += ',';
+  appendJoinedColumn(out, shares.purchaseTimestamps, row);
+  out += ',';
+  appendJoinedColumn(out, shares.thresholdTimestamps, row);
+  out += ',';
+  out += std::to_string(shares.anyValidPurchaseTimestamp[row]);
+  out += ',';
+  appendJoinedColumn(out, shares.purchaseValues, row);
+  out += ',';
+  appendJoinedColumn(out, shares.purchaseValueSquared, row);
+  out += ',';
+  out += std::to_string(shares.testReach[row]);
+  out += '\n';
+}
+
+template <int schedulerId>
+void LiftGameProcessedData<schedulerId>::writeToBinary(
+    const std::string& globalParamsOutputPath,
+    const std::string& secretSharesOutputPath) const {
+  writeGlobalParams(globalParamsOutputPath);
+
+  auto fileWriter =
+      private_measurement::compressed_io::makeFileWriter(
+          secretSharesOutputPath);
+  auto writer =
+      std::make_unique<fbpcf::io::BufferedWriter>(std::move(fileWriter));
+
+  std::vector<char> header(
+      std::begin(kBinarySecretSharesMagic), std::end(kBinarySecretSharesMagic));
+  auto appendUint32 = [&header](uint32_t value) {
+    detail::appendLittleEndian(header, value);
+  };
+  appendUint32(kBinarySecretSharesVersion);
+  detail::appendLittleEndian<uint64_t>(header, numRows);
+  appendUint32(numPartnerCohorts);
+  appendUint32(numPublisherBreakdowns);
+  appendUint32(numGroups);
+  appendUint32(numTestGroups);
+  detail::appendLittleEndian<uint8_t>(header, valueBits);
+  detail::appendLittleEndian<uint8_t>(header, valueSquaredBits);
+
+  if (numRows == 0) {
+    // no share columns follow
+    for (size_t i = 0; i < 6; i++) {
+      appendUint32(0);
+    }
+    writer->write(header);
+    writer->close();
+    return;
+  }
+
+  auto shares = extractShares();
+  appendUint32(indexShares.size());
+  appendUint32(testIndexShares.size());
+  appendUint32(shares.purchaseTimestamps.size());
+  appendUint32(shares.thresholdTimestamps.size());
+  appendUint32(shares.purchaseValues.size());
+  appendUint32(shares.purchaseValueSquared.size());
+  writer->write(header);
+
+  for (const auto& column : indexShares) {
+    writeBitColumn(*writer, column);
+  }
+  for (const auto& column : testIndexShares) {
+    writeBitColumn(*writer, column);
+  }
+  writeIntColumn(*writer, shares.opportunityTimestamps);
+  writeBitColumn(*writer, shares.isValidOpportunityTimestamp);
+  for (const auto& column : shares.purchaseTimestamps) {
+    writeIntColumn(*writer, column);
+  }
+  for (const auto& column : shares.thresholdTimestamps) {
+    writeIntColumn(*writer, column);
+  }
+  writeBitColumn(*writer, shares.anyValidPurchaseTimestamp);
+  for (const auto& column : shares.purchaseValues) {
+    writeIntColumn(*writer, column);
+  }
+  for (const auto& column : shares.purchaseValueSquared) {
+    writeIntColumn(*writer, column);
+  }
+  writeBitColumn(*writer, shares.testReach);
+
+  writer->close();
+}
+
+template <int schedulerId>
+void LiftGameProcessedData<schedulerId>::writeBitColumn(
+    fbpcf::io::BufferedWriter& writer,
+    const std::vector<bool>& column) {
+  std::vector<char> buf;
+  buf.reserve(detail::kBinaryColumnChunkRows / 8);
+  uint8_t byte = 0;
+  for (size_t i = 0; i < column.size(); i++) {
+    byte |= static_cast<uint8_t>(column[i]) << (i % 8);
+    if (i % 8 == 7 || i + 1 == column.size()) {
+      buf.push_back(static_cast<char>(byte));
+      byte = 0;
+    }
+    if (buf.size() == detail::kBinaryColumnChunkRows / 8) {
+      writer.write(buf);
+      buf.clear();
+    }
+  }
+  if (!buf.empty()) {
+    writer.write(buf);
+  }
+}
+
+template <int schedulerId>
+template <typename T>
+void LiftGameProcessedData<schedulerId>::writeIntColumn(
+    fbpcf::io::BufferedWriter& writer,
+    const std::vector<T>& column) {
+  std::vector<char> buf;
+  buf.reserve(detail::kBinaryColumnChunkRows * sizeof(uint64_t));
+  for (size_t i = 0; i < column.size(); i++) {
+    detail::appendLittleEndian(buf, static_cast<uint64_t>(column[i]));
+    if (buf.size() == detail::kBinaryColumnChunkRows * sizeof(uint64_t)) {
+      writer.write(buf);
+      buf.clear();
+    }
+  }
+  if (!buf.empty()) {
+    writer.write(buf);
+  }
 }
 
 template <int schedulerId>
 LiftGameProcessedData<schedulerId>
 LiftGameProcessedData<schedulerId>::readFromCSV(
     const std::string& globalParamsInputPath,
-    const std::string& secretSharesInputPath) {
+    const std::string& secretSharesInputPath,
+    size_t numParseThreads,
+    const std::vector<std::string>& columns) {
   LiftGameProcessedData<schedulerId> result;
   result.numRows = 0;
 
   private_measurement::csv::readCsv(
       globalParamsInputPath, readParamsLine(result));
 
-  std::vector<std::vector<bool>> indexShares;
-  std::vector<std::vector<bool>> testIndexShares;
-  std::vector<uint64_t> opportunityTimestampsShares;
-  std::vector<bool> isValidOpportunityTimestampShares;
-  std::vector<std::vector<uint64_t>> purchaseTimestampShares;
-  std::vector<std::vector<uint64_t>> thresholdTimestampShares;
-  std::vector<bool> anyValidPurchaseTimestampShares;
-  std::vector<std::vector<int64_t>> purchaseValueShares;
-  std::vector<std::vector<int64_t>> purchaseValueSquaredShares;
-  std::vector<bool> testReachShares;
-
-  private_measurement::csv::readCsv(
-      secretSharesInputPath,
-      readSharesLine(
-          result,
-          indexShares,
-          testIndexShares,
-          opportunityTimestampsShares,
-          isValidOpportunityTimestampShares,
-          purchaseTimestampShares,
-          thresholdTimestampShares,
-          anyValidPurchaseTimestampShares,
-          purchaseValueShares,
-          purchaseValueSquaredShares,
-          testReachShares));
+  // Rows are appended straight into column-major storage that is sized up
+  // front, instead of being collected row by row and transposed.
+  auto expectedRows =
+      private_measurement::csv::countCsvRows(secretSharesInputPath);
+  ShareColumns shareColumns;
+  shareColumns.shares.opportunityTimestamps.reserve(expectedRows);
+  shareColumns.shares.isValidOpportunityTimestamp.reserve(expectedRows);
+  shareColumns.shares.anyValidPurchaseTimestamp.reserve(expectedRows);
+  shareColumns.shares.testReach.reserve(expectedRows);
+
+  if (numParseThreads <= 1) {
+    private_measurement::csv::readCsvViews(
+        secretSharesInputPath,
+        readSharesLine(result.numRows, shareColumns, expectedRows, columns),
+        [](auto) {},
+        columns);
+  } else {
+    // Each range of rows is parsed into its own columns, which are appended
+    // in file order once every range was parsed
+    auto expectedChunkRows = expectedRows / numParseThreads + 1;
+    std::vector<ShareColumns> chunkColumns(numParseThreads);
+    std::vector<int64_t> chunkNumRows(numParseThreads, 0);
+    std::vector<std::function<void(
+        const std::vector<std::string>&,
+        const std::vector<std::string_view>&)>>
+        chunkReaders;
+    for (size_t i = 0; i < numParseThreads; i++) {
+      chunkReaders.push_back(readSharesLine(
+          chunkNumRows.at(i),
+          chunkColumns.at(i),
+          expectedChunkRows,
+          columns));
+    }
+    private_measurement::csv::readCsvViewsInChunks(
+        secretSharesInputPath,
+        numParseThreads,
+        [&chunkReaders](
+            size_t chunk,
+            const std::vector<std::string>& header,
+            const std::vector<std::string_view>& parts) {
+          chunkReaders.at(chunk)(header, parts);
+        },
+        [](auto) {},
+        columns);
+    for (size_t i = 0; i < numParseThreads; i++) {
+      result.numRows += chunkNumRows.at(i);
+      appendShareColumns(
+          shareColumns, std::move(chunkColumns.at(i)), expectedRows);
+    }
+  }
 
   if (result.numRows == 0) {
     return result;
   }
 
-  result.indexShares = transpose(indexShares);
-  result.testIndexShares = transpose(testIndexShares);
+  auto& shares = shareColumns.shares;
+  result.indexShares = std::move(shareColumns.indexShares);
+  result.testIndexShares = std::move(shareColumns.testIndexShares);
   result.opportunityTimestamps = SecTimestamp<schedulerId>(
       typename SecTimestamp<schedulerId>::ExtractedInt(
-          opportunityTimestampsShares));
+          std::move(shares.opportunityTimestamps)));
   result.isValidOpportunityTimestamp =
       SecBit<schedulerId>(typename SecBit<schedulerId>::ExtractedBit(
-          isValidOpportunityTimestampShares));
+          std::move(shares.isValidOpportunityTimestamp)));
 
-  result.purchaseTimestamps = std::vector<SecTimestamp<schedulerId>>();
-  result.purchaseTimestamps.reserve(purchaseTimestampShares[0].size());
-  for (size_t i = 0; i < purchaseTimestampShares[0].size(); i++) {
+  result.purchaseTimestamps.reserve(shares.purchaseTimestamps.size());
+  for (auto& column : shares.purchaseTimestamps) {
     result.purchaseTimestamps.push_back(SecTimestamp<schedulerId>(
-        typename SecTimestamp<schedulerId>::ExtractedInt(
-            extractColumn(purchaseTimestampShares, i))));
+        typename SecTimestamp<schedulerId>::ExtractedInt(std::move(column))));
   }
 
-  result.thresholdTimestamps = std::vector<SecTimestamp<schedulerId>>();
-  result.thresholdTimestamps.reserve(thresholdTimestampShares[0].size());
-  for (size_t i = 0; i < thresholdTimestampShares[0].size(); i++) {
+  result.thresholdTimestamps.reserve(shares.thresholdTimestamps.size());
+  for (auto& column : shares.thresholdTimestamps) {
     result.thresholdTimestamps.push_back(SecTimestamp<schedulerId>(
-        typename SecTimestamp<schedulerId>::ExtractedInt(
-            extractColumn(thresholdTimestampShares, i))));
+        typename SecTimestamp<schedulerId>::ExtractedInt(std::move(column))));
   }
 
   result.anyValidPurchaseTimestamp =
       SecBit<schedulerId>(typename SecBit<schedulerId>::ExtractedBit(
-          anyValidPurchaseTimestampShares));
+          std::move(shares.anyValidPurchaseTimestamp)));
 
-  result.purchaseValues = std::vector<SecValue<schedulerId>>();
-  result.purchaseValues.reserve(purchaseValueShares[0].size());
-  for (size_t i = 0; i < purchaseValueShares[0].size(); i++) {
+  result.purchaseValues.reserve(shares.purchaseValues.size());
+  for (auto& column : shares.purchaseValues) {
     result.purchaseValues.push_back(
         SecValue<schedulerId>(typename SecValue<schedulerId>::ExtractedInt(
-            extractColumn(purchaseValueShares, i))));
+            std::move(column))));
   }
 
-  result.purchaseValueSquared = std::vector<SecValueSquared<schedulerId>>();
-  result.purchaseValueSquared.reserve(purchaseValueSquaredShares[0].size());
-  for (size_t i = 0; i < purchaseValueSquaredShares[0].size(); i++) {
+  result.purchaseValueSquared.reserve(shares.purchaseValueSquared.size());
+  for (auto& column : shares.purchaseValueSquared) {
     result.purchaseValueSquared.push_back(SecValueSquared<schedulerId>(
         typename SecValueSquared<schedulerId>::ExtractedInt(
-            extractColumn(purchaseValueSquaredShares, i))));
+            std::move(column))));
   }
 
   result.testReach = SecBit<schedulerId>(
-      typename SecBit<schedulerId>::ExtractedBit(testReachShares));
+      typename SecBit<schedulerId>::ExtractedBit(std::move(shares.testReach)));
 
   return result;
 }
 
 template <int schedulerId>
-template <typename T>
-std::string LiftGameProcessedData<schedulerId>::joinColumn(
-    const std::vector<std::vector<T>>& data,
-    size_t columnIndex) {
-  if (data.size() == 0) {
-    return "[]";
-  } else if (data.size() == 1) {
-    return "[" + std::to_string(data[0][columnIndex]) + "]";
+LiftGameProcessedData<schedulerId>
+LiftGameProcessedData<schedulerId>::readFromBinary(
+    const std::string& secretSharesInputPath,
+    const std::vector<std::string>& columns) {
+  auto fileReader =
+      private_measurement::compressed_io::makeFileReader(
+          secretSharesInputPath);
+  auto reader =
+      std::make_unique<fbpcf::io::BufferedReader>(std::move(fileReader));
+
+  std::vector<char> header(
+      sizeof(kBinarySecretSharesMagic) + sizeof(uint32_t) * 11 +
+      sizeof(uint64_t) + sizeof(uint8_t) * 2);
+  readExactly(*reader, header);
+  if (!std::equal(
+          std::begin(kBinarySecretSharesMagic),
+          std::end(kBinarySecretSharesMagic),
+          header.begin())) {
+    throw std::runtime_error(
+        "Not a binary secret shares file: " + secretSharesInputPath);
+  }
+
+  size_t offset = sizeof(kBinarySecretSharesMagic);
+  auto consumeUint32 = [&header, &offset]() {
+    return detail::consumeLittleEndian<uint32_t>(header, offset);
+  };
+  auto version = consumeUint32();
+  if (version != kBinarySecretSharesVersion) {
+    throw std::runtime_error(
+        "Unsupported binary secret shares version " + std::to_string(version));
+  }
+
+  LiftGameProcessedData<schedulerId> result;
+  result.numRows = detail::consumeLittleEndian<uint64_t>(header, offset);
+  result.numPartnerCohorts = consumeUint32();
+  result.numPublisherBreakdowns = consumeUint32();
+  result.numGroups = consumeUint32();
+  result.numTestGroups = consumeUint32();
+  result.valueBits = detail::consumeLittleEndian<uint8_t>(header, offset);
+  result.valueSquaredBits =
+      detail::consumeLittleEndian<uint8_t>(header, offset);
+  auto numIndexShares = consumeUint32();
+  auto numTestIndexShares = consumeUint32();
+  auto numPurchaseTimestamps = consumeUint32();
+  auto numThresholdTimestamps = consumeUint32();
+  auto numPurchaseValues = consumeUint32();
+  auto numPurchaseValueSquared = consumeUint32();
+
+  if (result.numRows == 0) {
+    reader->close();
+    return result;
+  }
+  size_t numRows = result.numRows;
+  auto isRead = [&columns](const std::string& column) {
+    return columns.empty() ||
+        std::find(columns.begin(), columns.end(), column) != columns.end();
+  };
+  // The size of a column of bits and of integers, for the columns skipped
+  auto bitColumnBytes = (numRows + 7) / 8;
+  auto intColumnBytes = numRows * sizeof(uint64_t);
+
+  if (isRead("indexShares")) {
+    for (size_t i = 0; i < numIndexShares; i++) {
+      result.indexShares.push_back(readBitColumn(*reader, numRows));
+    }
   } else {
-    std::string result = "[";
-    for (size_t row = 0; row < data.size() - 1; row++) {
-      result += std::to_string(data[row][columnIndex]) + ",";
+    skipBytes(*reader, numIndexShares * bitColumnBytes);
+  }
+  if (isRead("testIndexShares")) {
+    for (size_t i = 0; i < numTestIndexShares; i++) {
+      result.testIndexShares.push_back(readBitColumn(*reader, numRows));
     }
+  } else {
+    skipBytes(*reader, numTestIndexShares * bitColumnBytes);
+  }
+  result.opportunityTimestamps = SecTimestamp<schedulerId>(
+      typename SecTimestamp<schedulerId>::ExtractedInt(
+          readIntColumn<uint64_t>(*reader, numRows)));
+  result.isValidOpportunityTimestamp =
+      SecBit<schedulerId>(typename SecBit<schedulerId>::ExtractedBit(
+          readBitColumn(*reader, numRows)));
 
-    result += std::to_string(data[data.size() - 1][columnIndex]) + "]";
-    return result;
+  result.purchaseTimestamps.reserve(numPurchaseTimestamps);
+  for (size_t i = 0; i < numPurchaseTimestamps; i++) {
+    result.purchaseTimestamps.push_back(SecTimestamp<schedulerId>(
+        typename SecTimestamp<schedulerId>::ExtractedInt(
+            readIntColumn<uint64_t>(*reader, numRows))));
+  }
+
+  result.thresholdTimestamps.reserve(numThresholdTimestamps);
+  for (size_t i = 0; i < numThresholdTimestamps; i++) {
+    result.thresholdTimestamps.push_back(SecTimestamp<schedulerId>(
+        typename SecTimestamp<schedulerId>::ExtractedInt(
+            readIntColumn<uint64_t>(*reader, numRows))));
+  }
+
+  result.anyValidPurchaseTimestamp =
+      SecBit<schedulerId>(typename SecBit<schedulerId>::ExtractedBit(
+          readBitColumn(*reader, numRows)));
+
+  result.purchaseValues.reserve(numPurchaseValues);
+  for (size_t i = 0; i < numPurchaseValues; i++) {
+    result.purchaseValues.push_back(
+        SecValue<schedulerId>(typename SecValue<schedulerId>::ExtractedInt(
+            readIntColumn<int64_t>(*reader, numRows))));
+  }
+
+  if (isRead("purchaseValueSquared")) {
+    result.purchaseValueSquared.reserve(numPurchaseValueSquared);
+    for (size_t i = 0; i < numPurchaseValueSquared; i++) {
+      result.purchaseValueSquared.push_back(SecValueSquared<schedulerId>(
+          typename SecValueSquared<schedulerId>::ExtractedInt(
+              readIntColumn<int64_t>(*reader, numRows))));
+    }
+  } else {
+    skipBytes(*reader, numPurchaseValueSquared * intColumnBytes);
+  }
+
+  // testReach is the last column, so it isn't read past when skipped
+  if (isRead("testReach")) {
+    result.testReach =
+        SecBit<schedulerId>(typename SecBit<schedulerId>::ExtractedBit(
+            readBitColumn(*reader, numRows)));
+  }
+
+  reader->close();
+  return result;
+}
+
+template <int schedulerId>
+void LiftGameProcessedData<schedulerId>::readExactly(
+    fbpcf::io::BufferedReader& reader,
+    std::vector<char>& buf) {
+  size_t totalRead = 0;
+  std::vector<char> chunk;
+  while (totalRead < buf.size()) {
+    chunk.resize(buf.size() - totalRead);
+    auto numRead = reader.read(chunk);
+    if (numRead == 0) {
+      throw std::runtime_error("Unexpected end of binary secret shares file");
+    }
+    std::copy(chunk.begin(), chunk.begin() + numRead, buf.begin() + totalRead);
+    totalRead += numRead;
+  }
+}
+
+template <int schedulerId>
+void LiftGameProcessedData<schedulerId>::skipBytes(
+    fbpcf::io::BufferedReader& reader,
+    size_t numBytes) {
+  std::vector<char> buf;
+  while (numBytes > 0) {
+    buf.resize(
+        std::min(detail::kBinaryColumnChunkRows * sizeof(uint64_t), numBytes));
+    readExactly(reader, buf);
+    numBytes -= buf.size();
   }
 }
 
+template <int schedulerId>
+std::vector<bool> LiftGameProcessedData<schedulerId>::readBitColumn(
+    fbpcf::io::BufferedReader& reader,
+    size_t numRows) {
+  std::vector<bool> column;
+  column.reserve(numRows);
+  std::vector<char> buf;
+  while (column.size() < numRows) {
+    auto chunkRows =
+        std::min(detail::kBinaryColumnChunkRows, numRows - column.size());
+    buf.resize((chunkRows + 7) / 8);
+    readExactly(reader, buf);
+    for (size_t i = 0; i < chunkRows; i++) {
+      column.push_back((static_cast<uint8_t>(buf[i / 8]) >> (i % 8)) & 1);
+    }
+  }
+  return column;
+}
+
 template <int schedulerId>
 template <typename T>
-std::vector<T> LiftGameProcessedData<schedulerId>::extractColumn(
-    const std::vector<std::vector<T>>& data,
-    size_t columnIndex) {
-  std::vector<T> result;
-  result.reserve(data.size());
-  for (size_t row = 0; row < data.size(); row++) {
-    result.push_back(data[row][columnIndex]);
+std::vector<T> LiftGameProcessedData<schedulerId>::readIntColumn(
+    fbpcf::io::BufferedReader& reader,
+    size_t numRows) {
+  std::vector<T> column;
+  column.reserve(numRows);
+  std::vector<char> buf;
+  while (column.size() < numRows) {
+    auto chunkRows =
+        std::min(detail::kBinaryColumnChunkRows, numRows - column.size());
+    buf.resize(chunkRows * sizeof(uint64_t));
+    readExactly(reader, buf);
+    size_t offset = 0;
+    for (size_t i = 0; i < chunkRows; i++) {
+      column.push_back(
+          static_cast<T>(detail::consumeLittleEndian<uint64_t>(buf, offset)));
+    }
   }
-  return result;
+  return column;
+}
+
+template <int schedulerId>
+void LiftGameProcessedData<schedulerId>::appendShareColumns(
+    ShareColumns& to,
+    ShareColumns&& from,
+    size_t expectedRows) {
+  auto append = [](auto& toColumn, auto& fromColumn) {
+    toColumn.insert(toColumn.end(), fromColumn.begin(), fromColumn.end());
+  };
+  // The array columns are only sized by the first row of a range, so the
+  // columns of a range without rows are empty
+  auto appendArrayColumns = [&append, expectedRows](
+                                auto& toColumns, auto& fromColumns) {
+    if (fromColumns.empty()) {
+      return;
+    }
+    if (toColumns.empty()) {
+      toColumns.resize(fromColumns.size());
+      for (auto& column : toColumns) {
+        column.reserve(expectedRows);
+      }
+    } else if (toColumns.size() != fromColumns.size()) {
+      throw std::runtime_error(
+          "Inconsistent array length in secret shares csv: expected " +
+          std::to_string(toColumns.size()) + ", got " +
+          std::to_string(fromColumns.size()));
+    }
+    for (size_t i = 0; i < toColumns.size(); i++) {
+      append(toColumns[i], fromColumns[i]);
+    }
+  };
+  appendArrayColumns(to.indexShares, from.indexShares);
+  appendArrayColumns(to.testIndexShares, from.testIndexShares);
+  auto& toShares = to.shares;
+  auto& fromShares = from.shares;
+  append(toShares.opportunityTimestamps, fromShares.opportunityTimestamps);
+  append(
+      toShares.isValidOpportunityTimestamp,
+      fromShares.isValidOpportunityTimestamp);
+  appendArrayColumns(
+      toShares.purchaseTimestamps, fromShares.purchaseTimestamps);
+  appendArrayColumns(
+      toShares.thresholdTimestamps, fromShares.thresholdTimestamps);
+  append(
+      toShares.anyValidPurchaseTimestamp, fromShares.anyValidPurchaseTimestamp);
+  appendArrayColumns(toShares.purchaseValues, fromShares.purchaseValues);
+  appendArrayColumns(
+      toShares.purchaseValueSquared, fromShares.purchaseValueSquared);
+  append(toShares.testReach, fromShares.testReach);
 }
 
 template <int schedulerId>
 template <typename T>
-std::vector<std::vector<T>> LiftGameProcessedData<schedulerId>::transpose(
-    const std::vector<std::vector<T>>& data) {
-  std::vector<std::vector<T>> result;
-  result.reserve(data[0].size());
-  for (size_t column = 0; column < data[0].size(); column++) {
-    result.push_back(extractColumn(data, column));
+void LiftGameProcessedData<schedulerId>::appendJoinedColumn(
+    std::string& out,
+    const std::vector<std::vector<T>>& data,
+    size_t columnIndex) {
+  out += '[';
+  for (size_t row = 0; row < data.size(); row++) {
+    if (row > 0) {
+      out += ',';
+    }
+    out += std::to_string(data[row][columnIndex]);
   }
-  return result;
+  out += ']';
 }
 
 template <int schedulerId>
-std::vector<std::string> LiftGameProcessedData<schedulerId>::splitValueArray(
-    const std::string& str) {
-  auto innerString = str.substr(1, str.size() - 1);
-  std::vector<std::string> values =
-      private_measurement::csv::splitByComma(innerString, false);
-  return values;
+template <typename T>
+void LiftGameProcessedData<schedulerId>::appendArrayCell(
+    std::string_view cell,
+    std::vector<std::vector<T>>& columns,
+    std::vector<T>& rowBuffer,
+    size_t expectedRows,
+    bool firstRow) {
+  rowBuffer.clear();
+  common::appendInnerArray(cell, rowBuffer);
+  if (firstRow) {
+    columns.resize(rowBuffer.size());
+    for (auto& column : columns) {
+      column.reserve(expectedRows);
+    }
+  } else if (rowBuffer.size() != columns.size()) {
+    throw std::runtime_error(
+        "Inconsistent array length in secret shares csv: expected " +
+        std::to_string(columns.size()) + ", got " +
+        std::to_string(rowBuffer.size()));
+  }
+  for (size_t i = 0; i < rowBuffer.size(); i++) {
+    columns[i].push_back(rowBuffer[i]);
+  }
 }
 
 template <int schedulerId>
@@ -281,77 +740,83 @@ LiftGameProcessedData<schedulerId>::readParamsLine(
 
 template <int schedulerId>
 std::function<
-    void(const std::vector<std::string>&, const std::vector<std::string>&)>
+    void(const std::vector<std::string>&, const std::vector<std::string_view>&)>
 LiftGameProcessedData<schedulerId>::readSharesLine(
-    LiftGameProcessedData<schedulerId>& result,
-    std::vector<std::vector<bool>>& indexShares,
-    std::vector<std::vector<bool>>& testIndexShares,
-    std::vector<uint64_t>& opportunityTimestampsShares,
-    std::vector<bool>& isValidOpportunityTimestampShares,
-    std::vector<std::vector<uint64_t>>& purchaseTimestampShares,
-    std::vector<std::vector<uint64_t>>& thresholdTimestampShares,
-    std::vector<bool>& anyValidPurchaseTimestampShares,
-    std::vector<std::vector<int64_t>>& purchaseValueShares,
-    std::vector<std::vector<int64_t>>& purchaseValueSquaredShares,
-    std::vector<bool>& testReachShares) {
-  return [&result,
-          &indexShares,
-          &testIndexShares,
-          &opportunityTimestampsShares,
-          &isValidOpportunityTimestampShares,
-          &purchaseTimestampShares,
-          &thresholdTimestampShares,
-          &anyValidPurchaseTimestampShares,
-          &purchaseValueShares,
-          &purchaseValueSquaredShares,
-          &testReachShares](
+    int64_t& numRows,
+    ShareColumns& columns,
+    size_t expectedRows,
+    const std::vector<std::string>& selectedColumns) {
+  return [&numRows,
+          &columns,
+          expectedRows,
+          selectedColumns,
+          isSelected = std::vector<bool>(),
+          bitBuffer = std::vector<bool>(),
+          timestampBuffer = std::vector<uint64_t>(),
+          valueBuffer = std::vector<int64_t>()](
              const std::vector<std::string>& header,
-             const std::vector<std::string>& parts) {
-    result.numRows++;
+             const std::vector<std::string_view>& parts) mutable {
+    numRows++;
+    bool firstRow = numRows == 1;
+    if (isSelected.empty()) {
+      // The csv reader leaves the columns which aren't selected unparsed
+      for (const auto& column : header) {
+        isSelected.push_back(
+            selectedColumns.empty() ||
+            std::find(
+                selectedColumns.begin(), selectedColumns.end(), column) !=
+                selectedColumns.end());
+      }
+    }
+    auto& shares = columns.shares;
     for (size_t i = 0; i < header.size(); i++) {
-      auto column = header[i];
+      if (!isSelected.at(i)) {
+        continue;
+      }
+      const auto& column = header[i];
       auto value = parts[i];
       if (column == "indexShares") {
-        indexShares.emplace_back();
-        for (const auto& indexShare : splitValueArray(value)) {
-          indexShares.back().push_back(std::stoul(indexShare));
-        }
+        appendArrayCell(
+            value, columns.indexShares, bitBuffer, expectedRows, firstRow);
       } else if (column == "testIndexShares") {
-        testIndexShares.emplace_back();
-        for (const auto& testIndexShare : splitValueArray(value)) {
-          testIndexShares.back().push_back(std::stoul(testIndexShare));
-        }
+        appendArrayCell(
+            value, columns.testIndexShares, bitBuffer, expectedRows, firstRow);
       } else if (column == "opportunityTimestamps") {
-        opportunityTimestampsShares.push_back(std::stoull(value));
+        shares.opportunityTimestamps.push_back(
+            detail::parseCsvScalar<uint64_t>(value));
       } else if (column == "isValidOpportunityTimestamp") {
-        isValidOpportunityTimestampShares.push_back(std::stoul(value));
+        shares.isValidOpportunityTimestamp.push_back(
+            detail::parseCsvScalar<uint64_t>(value) != 0);
       } else if (column == "purchaseTimestamps") {
-        purchaseTimestampShares.emplace_back();
-        for (const auto& purchaseTimestampShare : splitValueArray(value)) {
-          purchaseTimestampShares.back().push_back(
-              std::stoull(purchaseTimestampShare));
-        }
+        appendArrayCell(
+            value,
+            shares.purchaseTimestamps,
+            timestampBuffer,
+            expectedRows,
+            firstRow);
       } else if (column == "thresholdTimestamps") {
-        thresholdTimestampShares.emplace_back();
-        for (const auto& thresholdTimestampShare : splitValueArray(value)) {
-          thresholdTimestampShares.back().push_back(
-              std::stoull(thresholdTimestampShare));
-        }
+        appendArrayCell(
+            value,
+            shares.thresholdTimestamps,
+            timestampBuffer,
+            expectedRows,
+            firstRow);
       } else if (column == "anyValidPurchaseTimestamp") {
-        anyValidPurchaseTimestampShares.push_back(std::stoul(value));
+        shares.anyValidPurchaseTimestamp.push_back(
+            detail::parseCsvScalar<uint64_t>(value) != 0);
       } else if (column == "purchaseValues") {
-        purchaseValueShares.emplace_back();
-        for (const auto& purchaseValueShare : splitValueArray(value)) {
-          purchaseValueShares.back().push_back(std::stoll(purchaseValueShare));
-        }
+        appendArrayCell(
+            value, shares.purchaseValues, valueBuffer, expectedRows, firstRow);
       } else if (column == "purchaseValueSquared") {
-        purchaseValueSquaredShares.emplace_back();
-        for (const auto& purchaseValueSquaredShare : splitValueArray(value)) {
-          purchaseValueSquaredShares.back().push_back(
-              std::stoll(purchaseValueSquaredShare));
-        }
+        appendArrayCell(
+            value,
+            shares.purchaseValueSquared,
+            valueBuffer,
+            expectedRows,
+            firstRow);
       } else if (column == "testReach") {
-        testReachShares.push_back(std::stoul(value));
+        shares.testReach.push_back(
+            detail::parseCsvScalar<uint64_t>(value) != 0);
       } else if (column != "id_") {
         XLOG(WARNING) << "Warning: Unknown column in csv: " << column;
       }
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "fbpcs/emp_games/common/BitMatrix.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/RaggedColumns.h"
+
+namespace private_lift::input_processing {
+
+/**
+ * Packs the columns a party shares into one bit matrix, so that they are
+ * secret shared as one batch of bits in a single round instead of one round
+ * per column. Each column takes width rows of the matrix, one per bit, lowest
+ * bit first, and every row has numRows bits. Columns shorter than numRows are
+ * padded with zeros.
+ *
+ * The shares of the matrix are cut back into the columns with the offsets
+ * returned when adding them. Integer columns are transposed into and out of
+ * their bits with common::BitMatrix, a word at a time.
+ */
+class PackedColumns {
+ public:
+  explicit PackedColumns(size_t numRows) : numRows_{numRows} {}
+
+  // Adds the lowest width bits of values, returning the offset of the column
+  template <typename T>
+  size_t addInts(const std::vector<T>& values, size_t width) {
+    std::vector<uint64_t> padded(numRows_, 0);
+    auto numValues = std::min(values.size(), numRows_);
+    for (size_t j = 0; j < numValues; ++j) {
+      padded[j] = static_cast<uint64_t>(values[j]);
+    }
+    return addColumn(common::BitMatrix::fromInts(padded, width).transpose());
+  }
+
+  // Adds the lowest width bits of slot of columns, which is zero for the rows
+  // with fewer values, returning the offset of the column
+  template <typename T>
+  size_t addSlot(const RaggedColumns<T>& columns, size_t slot, size_t width) {
+    std::vector<uint64_t> padded(numRows_, 0);
+    auto numValues = std::min(columns.getNumRows(), numRows_);
+    for (size_t j = 0; j < numValues; ++j) {
+      padded[j] = static_cast<uint64_t>(columns.at(j, slot));
+    }
+    return addColumn(common::BitMatrix::fromInts(padded, width).transpose());
+  }
+
+  // Adds a column of bits, returning its offset
+  size_t addBits(const std::vector<bool>& values) {
+    common::BitMatrix column{1, numRows_};
+    column.setRow(0, values, 0, std::min(values.size(), numRows_));
+    return addColumn(std::move(column));
+  }
+
+  // The bits of every column, in the order they were added
+  std::vector<bool> getBits() const {
+    std::vector<bool> bits;
+    bits.reserve(numBits_);
+    for (const auto& column : columns_) {
+      for (size_t i = 0; i < column.getNumRows(); ++i) {
+        column.appendRowTo(i, bits);
+      }
+    }
+    return bits;
+  }
+
+  // The shares of the column of width bits at offset, as integers. Signed
+  // integers are sign extended from their highest bit.
+  template <typename T>
+  std::vector<T> getIntShares(
+      const std::vector<bool>& shares,
+      size_t offset,
+      size_t width) const {
+    return common::BitMatrix::fromBits(shares, offset, width, numRows_)
+        .transpose()
+        .toInts<T>();
+  }
+
+  // The shares of the column of bits at offset
+  std::vector<bool> getBitShares(const std::vector<bool>& shares, size_t offset)
+      const {
+    return std::vector<bool>(
+        shares.begin() + offset, shares.begin() + offset + numRows_);
+  }
+
+ private:
+  // Adds a column of a row of numRows bits per bit, returning its offset
+  size_t addColumn(common::BitMatrix column) {
+    auto offset = numBits_;
+    numBits_ += column.getNumRows() * numRows_;
+    columns_.push_back(std::move(column));
+    return offset;
+  }
+
+  size_t numRows_;
+  size_t numBits_ = 0;
+  std::vector<common::BitMatrix> columns_;
+};
+
+} // namespace private_lift::input_processing
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+namespace private_lift::input_processing {
+
+/**
+ * The values of an array column of the input, such as the purchase timestamps
+ * of each row. The values of all rows are stored one after another, with the
+ * offset at which each row starts, so that a row only takes as much space as
+ * it has values. Most rows have one or two, far fewer than the conversions
+ * per user they are padded to when they are shared.
+ *
+ * Conversion slot i of a row is its value i, or zero if it has fewer values.
+ */
+template <typename T>
+class RaggedColumns {
+ public:
+  // Adds a row with the values between begin and end
+  template <typename Iterator>
+  void addRow(Iterator begin, Iterator end) {
+    values_.insert(values_.end(), begin, end);
+    offsets_.push_back(values_.size());
+    numSlots_ = std::max(numSlots_, getRowSize(getNumRows() - 1));
+  }
+
+  void addRow(const std::vector<T>& values) {
+    addRow(values.begin(), values.end());
+  }
+
+  // Sets value i of the last row
+  void setLastRowValue(size_t i, T value) {
+    values_.at(offsets_.at(offsets_.size() - 2) + i) = value;
+  }
+
+  // Appends the rows of other after the rows of this
+  void append(RaggedColumns&& other) {
+    auto offset = values_.size();
+    values_.insert(
+        values_.end(),
+        std::make_move_iterator(other.values_.begin()),
+        std::make_move_iterator(other.values_.end()));
+    for (size_t row = 1; row < other.offsets_.size(); ++row) {
+      offsets_.push_back(offset + other.offsets_[row]);
+    }
+    numSlots_ = std::max(numSlots_, other.numSlots_);
+  }
+
+  size_t getNumRows() const {
+    return offsets_.size() - 1;
+  }
+
+  // The number of values of the widest row
+  size_t getNumSlots() const {
+    return numSlots_;
+  }
+
+  size_t getRowSize(size_t row) const {
+    return offsets_[row + 1] - offsets_[row];
+  }
+
+  // Slot of row, or zero if the row doesn't have that many values or there
+  // are fewer rows
+  T at(size_t row, size_t slot) const {
+    if (row >= getNumRows() || slot >= getRowSize(row)) {
+      return 0;
+    }
+    return values_[offsets_[row] + slot];
+  }
+
+  // The values of slot for numRows rows, padded with zeros
+  std::vector<T> getSlot(size_t slot, size_t numRows) const {
+    std::vector<T> column(numRows, 0);
+    auto numInputRows = std::min(numRows, getNumRows());
+    for (size_t row = 0; row < numInputRows; ++row) {
+      column[row] = at(row, slot);
+    }
+    return column;
+  }
+
+  // All slots up to the widest row for every row, padded with zeros
+  std::vector<std::vector<T>> getSlots() const {
+    std::vector<std::vector<T>> columns;
+    columns.reserve(numSlots_);
+    for (size_t slot = 0; slot < numSlots_; ++slot) {
+      columns.push_back(getSlot(slot, getNumRows()));
+    }
+    return columns;
+  }
+
+ private:
+  std::vector<T> values_;
+  std::vector<size_t> offsets_{0};
+  size_t numSlots_ = 0;
+};
+
+} // namespace private_lift::input_processing
@@ -16,10 +16,19 @@ class SecretShareInputProcessor : public IInputProcessor<schedulerId> {
  public:
   SecretShareInputProcessor(
       const std::string& globalParamsPath,
-      const std::string& secretSharePath)
-      : liftGameProcessedData_{LiftGameProcessedData<schedulerId>::readFromCSV(
-            globalParamsPath,
-            secretSharePath)} {}
+      const std::string& secretSharePath,
+      bool useBinarySecretShares = false,
+      size_t numParseThreads = 1,
+      const std::vector<std::string>& columns = {})
+      : liftGameProcessedData_{
+            useBinarySecretShares
+                ? LiftGameProcessedData<schedulerId>::readFromBinary(
+                      secretSharePath, columns)
+                : LiftGameProcessedData<schedulerId>::readFromCSV(
+                      globalParamsPath,
+                      secretSharePath,
+                      numParseThreads,
+                      columns)} {}
 
   SecretShareInputProcessor() {}
 
@@ -11,31 +11,33 @@
 
 namespace private_lift {
 
+namespace {
+
+// The value of a row of one of InputData's columns, which are padded with
+// zeros up to the union size. The rows are gathered from the columns directly
+// instead of from padded copies of them.
+template <typename T>
+T rowValue(const std::vector<T>& column, size_t row) {
+  return row < column.size() ? column[row] : T{};
+}
+
+} // namespace
+
 std::vector<std::vector<unsigned char>>
 LiftMetaDataSerializer::serializePublisherMetadata() {
   // hardcode the schedulerId as no MPC types are created during serialization
   auto publisherSerializer =
       input_processing::createPublisherSerializer<0>(numConversionsPerUser_);
 
-  std::vector<std::vector<unsigned char>> rst;
   size_t inputSize = reverseUnionMap_ == std::nullopt
       ? inputData_.getNumRows()
       : reverseUnionMap_->size();
-  size_t unionSize =
-      unionSize_ == std::nullopt ? inputSize : unionSize_.value();
-
-  rst.reserve(inputSize);
-
-  auto opportunityTimestampsPadded = common::padArray<uint32_t>(
-      inputData_.getOpportunityTimestamps(), unionSize, 0);
-  auto controlPopulationPadded = common::padArray<bool>(
-      inputData_.getControlPopulation(), unionSize, false);
-  auto testPopulationPadded =
-      common::padArray<bool>(inputData_.getTestPopulation(), unionSize, false);
-  auto numImpressionsPadded =
-      common::padArray<int64_t>(inputData_.getNumImpressions(), unionSize, 0);
-  auto breakdownIdPadded =
-      common::padArray<uint32_t>(inputData_.getBreakdownIds(), unionSize, 0);
+
+  const auto& opportunityTimestamps = inputData_.getOpportunityTimestamps();
+  const auto& controlPopulation = inputData_.getControlPopulation();
+  const auto& testPopulation = inputData_.getTestPopulation();
+  const auto& numImpressions = inputData_.getNumImpressions();
+  const auto& breakdownIds = inputData_.getBreakdownIds();
 
   std::vector<bool> breakdownIdSorted(inputSize);
   std::vector<bool> controlPopulationSorted(inputSize);
@@ -46,16 +48,17 @@ LiftMetaDataSerializer::serializePublisherMetadata() {
     int inputIndex =
         reverseUnionMap_ == std::nullopt ? i : reverseUnionMap_->at(i);
 
-    breakdownIdSorted[i] = breakdownIdPadded[inputIndex];
-    controlPopulationSorted[i] = controlPopulationPadded[inputIndex];
+    auto opportunityTimestamp = rowValue(opportunityTimestamps, inputIndex);
+    bool isControl = rowValue(controlPopulation, inputIndex);
+    bool isTest = rowValue(testPopulation, inputIndex);
+
+    breakdownIdSorted[i] = rowValue(breakdownIds, inputIndex);
+    controlPopulationSorted[i] = isControl;
     isValidOpportunityTimestamp[i] =
-        (opportunityTimestampsPadded.at(inputIndex) > 0) &&
-        (controlPopulationPadded.at(inputIndex) ||
-         testPopulationPadded.at(inputIndex));
+        (opportunityTimestamp > 0) && (isControl || isTest);
 
-    testReach[i] = testPopulationPadded.at(inputIndex) &&
-        (numImpressionsPadded.at(inputIndex) > 0);
-    opportunityTimestampsSorted[i] = opportunityTimestampsPadded[inputIndex];
+    testReach[i] = isTest && (rowValue(numImpressions, inputIndex) > 0);
+    opportunityTimestampsSorted[i] = opportunityTimestamp;
   }
 
   using InputColumnDataType =
@@ -79,31 +82,16 @@ LiftMetaDataSerializer::serializePartnerMetadata() {
   auto partnerSerializer =
       input_processing::createPartnerSerializer<0>(numConversionsPerUser_);
 
-  std::vector<std::vector<unsigned char>> rst;
   size_t inputSize = reverseUnionMap_ == std::nullopt
       ? inputData_.getNumRows()
       : reverseUnionMap_->size();
-  size_t unionSize =
-      unionSize_ == std::nullopt ? inputSize : unionSize_.value();
-  rst.reserve(inputSize);
-
-  auto cohortIdsPadded = common::padArray<uint32_t>(
-      inputData_.getPartnerCohortIds(), unionSize, 0);
-  auto purchaseTimestampsPadded = common::padNestedArrays<uint32_t>(
-      inputData_.getPurchaseTimestampArrays(),
-      unionSize,
-      numConversionsPerUser_,
-      0);
-  auto purchaseValuesPadded = common::padNestedArrays<int64_t>(
-      inputData_.getPurchaseValueArrays(),
-      unionSize,
-      numConversionsPerUser_,
-      0);
-  auto purchaseValuesSquaredPadded = common::padNestedArrays<int64_t>(
-      inputData_.getPurchaseValueSquaredArrays(),
-      unionSize,
-      numConversionsPerUser_,
-      0);
+
+  const auto& cohortIds = inputData_.getPartnerCohortIds();
+  const auto& purchaseTimestampColumns =
+      inputData_.getPurchaseTimestampColumns();
+  const auto& purchaseValueColumns = inputData_.getPurchaseValueColumns();
+  const auto& purchaseValueSquaredColumns =
+      inputData_.getPurchaseValueSquaredColumns();
 
   std::vector<bool> anyValidPurchaseTimestamps(inputSize);
   std::vector<uint32_t> cohortIdsSorted(inputSize);
@@ -120,25 +108,25 @@ LiftMetaDataSerializer::serializePartnerMetadata() {
     int inputIndex =
         reverseUnionMap_ == std::nullopt ? i : reverseUnionMap_->at(i);
 
-    cohortIdsSorted[i] = cohortIdsPadded[inputIndex];
+    cohortIdsSorted[i] = rowValue(cohortIds, inputIndex);
 
     bool anyValidPurchaseTimestamp = false;
     for (int j = 0; j < numConversionsPerUser_; j++) {
+      // The array columns are padded with zeros up to the union size and
+      // numConversionsPerUser
+      auto purchaseTimestamp = purchaseTimestampColumns.at(inputIndex, j);
       // compute whether each row contains at least one valid (positive)
       // purchase timestamp
-      anyValidPurchaseTimestamp |=
-          (purchaseTimestampsPadded[inputIndex][j] > 0);
+      anyValidPurchaseTimestamp |= (purchaseTimestamp > 0);
 
-      purchaseTimestampsSorted[i][j] = purchaseTimestampsPadded[inputIndex][j];
+      purchaseTimestampsSorted[i][j] = purchaseTimestamp;
 
-      thresholdTimestampsSorted[i][j] =
-          purchaseTimestampsPadded[inputIndex][j] > 0
-          ? purchaseTimestampsPadded[inputIndex][j] +
-              kPurchaseTimestampThresholdWindow
+      thresholdTimestampsSorted[i][j] = purchaseTimestamp > 0
+          ? purchaseTimestamp + kPurchaseTimestampThresholdWindow
           : 0;
-      purchaseValuesSorted[i][j] = purchaseValuesPadded[inputIndex][j];
+      purchaseValuesSorted[i][j] = purchaseValueColumns.at(inputIndex, j);
       purchaseValuesSquaredSorted[i][j] =
-          purchaseValuesSquaredPadded[inputIndex][j];
+          purchaseValueSquaredColumns.at(inputIndex, j);
     }
     anyValidPurchaseTimestamps[i] = anyValidPurchaseTimestamp;
   }
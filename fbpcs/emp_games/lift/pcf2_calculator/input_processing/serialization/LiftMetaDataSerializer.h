@@ -15,27 +15,29 @@
 
 namespace private_lift {
 
+/**
+ * Serializes the rows of inputData in the order of reverseUnionMap, reading
+ * them from inputData directly, which has to outlive the serializer. Rows
+ * past the end of a column of inputData are serialized as zeros.
+ */
 class LiftMetaDataSerializer : common::IMetadataSerializer {
  public:
   explicit LiftMetaDataSerializer(
-      InputData inputData,
+      const InputData& inputData,
       int32_t numConversionsPerUser,
-      std::optional<std::vector<int32_t>> reverseUnionMap = std::nullopt,
-      std::optional<size_t> unionSize = std::nullopt)
+      std::optional<std::vector<int32_t>> reverseUnionMap = std::nullopt)
       : inputData_{inputData},
         numConversionsPerUser_(numConversionsPerUser),
-        reverseUnionMap_(reverseUnionMap),
-        unionSize_(unionSize) {}
+        reverseUnionMap_(std::move(reverseUnionMap)) {}
 
   std::vector<std::vector<unsigned char>> serializePublisherMetadata() override;
 
   std::vector<std::vector<unsigned char>> serializePartnerMetadata() override;
 
  private:
-  InputData inputData_;
+  const InputData& inputData_;
   int32_t numConversionsPerUser_;
   std::optional<std::vector<int32_t>> reverseUnionMap_;
-  std::optional<size_t> unionSize_;
 };
 
 } // namespace private_lift
@@ -17,6 +17,15 @@
 
 namespace private_lift {
 
+TEST(GlobalSharingUtilsTest, testUnsharedValueBitsTakeFullWidths) {
+  // Processors which can't share the numbers of bits of the values, such as
+  // the UDP one, leave them unset, which must not pick the narrow widths
+  LiftGameProcessedData<0> liftData;
+  EXPECT_FALSE(fitsValueWidths<NarrowValueWidths>(
+      liftData.valueBits, liftData.valueSquaredBits));
+  EXPECT_TRUE(fitsValueWidths<NarrowValueWidths>(10, 15));
+}
+
 void runValidateNumRowsStep(
     LiftGameProcessedData<0>& liftData0,
     LiftGameProcessedData<1>& liftData1) {
@@ -52,6 +61,29 @@ TEST(GlobalSharingUtilsTest, testValidateNumRows) {
       "The publisher has 11 rows in their input, while the partner has 10 rows.");
 }
 
+TEST(GlobalSharingUtilsTest, testRelativeTimestampsKeepComparisons) {
+  // Valid opportunity timestamps from 100 to 110, which need 4 bits
+  uint32_t base = 100;
+  uint8_t timestampBits = 4;
+  std::vector<uint32_t> opportunityTimestamps = {100, 101, 105, 110};
+  std::vector<uint32_t> thresholdTimestamps = {
+      1, 99, 100, 101, 104, 105, 106, 110, 111, 1000, 0xFFFFFFFF};
+  for (auto opportunityTs : opportunityTimestamps) {
+    auto relativeOpportunityTs = input_processing::getRelativeTimestamp(
+        opportunityTs, base, timestampBits);
+    EXPECT_EQ(relativeOpportunityTs, opportunityTs - base);
+    for (auto thresholdTs : thresholdTimestamps) {
+      auto relativeThresholdTs = input_processing::getRelativeTimestamp(
+          thresholdTs, base, timestampBits);
+      EXPECT_LT(relativeThresholdTs, 1u << timestampBits);
+      EXPECT_EQ(
+          relativeThresholdTs > relativeOpportunityTs,
+          thresholdTs > opportunityTs)
+          << "opportunity " << opportunityTs << ", threshold " << thresholdTs;
+    }
+  }
+}
+
 void runShareGroupsAndValueBits(
     const InputData& publisherInput,
     const InputData& partnerInput,
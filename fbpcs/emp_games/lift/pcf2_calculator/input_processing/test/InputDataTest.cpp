@@ -5,13 +5,18 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <filesystem>
+#include <fstream>
+#include <sstream>
 #include <string>
 
 #include <gtest/gtest.h>
 
 #include "folly/Random.h"
 
+#include "fbpcs/emp_games/common/RowGroupFormat.h"
+#include "fbpcs/emp_games/common/Util.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/InputData.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/sample_input/SampleInput.h"
 
@@ -149,10 +154,16 @@ TEST_F(InputDataTest, TestInputDataPartner) {
   };
   std::vector<uint32_t> expectCohortIds = {0, 1, 0, 0, 2, 0, 0, 0, 0, 0,
                                            0, 0, 0, 0, 1, 2, 0, 0, 0, 0};
-  auto resPurchaseTimestampArrays = inputData.getPurchaseTimestampArrays();
-  auto resPurchaseValueArrays = inputData.getPurchaseValueArrays();
-  EXPECT_EQ(expectGetPurchaseTimestampArrays, resPurchaseTimestampArrays);
-  EXPECT_EQ(expectPurchaseValueArrays, resPurchaseValueArrays);
+  // The arrays are stored by conversion slot
+  auto resPurchaseTimestampColumns =
+      inputData.getPurchaseTimestampColumns().getSlots();
+  auto resPurchaseValueColumns =
+      inputData.getPurchaseValueColumns().getSlots();
+  EXPECT_EQ(
+      common::transpose(expectGetPurchaseTimestampArrays),
+      resPurchaseTimestampColumns);
+  EXPECT_EQ(
+      common::transpose(expectPurchaseValueArrays), resPurchaseValueColumns);
 
   ASSERT_EQ(3, inputData.getNumPartnerCohorts());
   EXPECT_EQ(expectCohortIds, inputData.getPartnerCohortIds());
@@ -174,11 +185,13 @@ TEST_F(InputDataTest, TestInputDataPartnerConverterLift) {
   std::vector<int64_t> expectPurchaseValuesSquared = {
       0, 71 * 71, 0, 0, 25 * 25, 0,       0, 0, 0, 0,
       0, 0,       0, 0, 51 * 51, 24 * 24, 0, 0, 0, 0};
-  auto resPurchaseTimestamps = inputData.getPurchaseTimestampArrays();
+  auto resPurchaseTimestamps =
+      inputData.getPurchaseTimestampColumns().getSlots();
   auto resPurchaseValues = inputData.getPurchaseValues();
   auto resPurchaseValuesSquared = inputData.getPurchaseValuesSquared();
   ASSERT_EQ(0, inputData.getNumPartnerCohorts());
-  EXPECT_EQ(expectGetPurchaseTimestamps, resPurchaseTimestamps);
+  EXPECT_EQ(
+      common::transpose(expectGetPurchaseTimestamps), resPurchaseTimestamps);
   EXPECT_EQ(expectPurchaseValues, resPurchaseValues);
   EXPECT_EQ(expectPurchaseValuesSquared, resPurchaseValuesSquared);
 }
@@ -255,4 +268,152 @@ TEST_F(InputDataTest, TestGetDummyRowsPartner) {
   auto resDummyRows1 = inputData1.getDummyRows();
   EXPECT_EQ(expectDummyRows1, resDummyRows1);
 }
+
+TEST_F(InputDataTest, TestArraysOfDifferentSizesArePaddedBySlot) {
+  auto filename = std::filesystem::temp_directory_path() /
+      ("InputDataSlots_" + std::to_string(folly::Random::rand32()));
+  {
+    std::ofstream file{filename};
+    file << "id_,event_timestamps,values,cohort_id\n"
+         << "0,[100],[3],0\n"
+         << "1,[100,200,300],[1,2,3],0\n"
+         << "2,[100,200],[4,5],0\n"
+         << "3,[100],[6],0\n";
+  }
+
+  std::vector<std::vector<uint32_t>> expectPurchaseTimestampColumns = {
+      {100, 100, 100, 100}, {0, 200, 200, 0}, {0, 300, 0, 0}};
+  std::vector<std::vector<int64_t>> expectPurchaseValueColumns = {
+      {3, 1, 4, 6}, {0, 2, 5, 0}, {0, 3, 0, 0}};
+  // The squares of the sums of the values from each slot on
+  std::vector<std::vector<int64_t>> expectPurchaseValueSquaredColumns = {
+      {9, 36, 81, 36}, {0, 25, 25, 0}, {0, 9, 0, 0}};
+  // The later chunks start with fewer slots than the earlier ones
+  for (int32_t numParseThreads : {1, 2, 4}) {
+    InputData inputData{
+        filename.native(),
+        InputData::LiftMPCType::Standard,
+        true,
+        0, /* epoch */
+        INT32_MAX, /* num_conversions_per_user */
+        numParseThreads};
+    EXPECT_EQ(4, inputData.getNumRows());
+    EXPECT_EQ(
+        expectPurchaseTimestampColumns,
+        inputData.getPurchaseTimestampColumns().getSlots());
+    EXPECT_EQ(
+        expectPurchaseValueColumns,
+        inputData.getPurchaseValueColumns().getSlots());
+    EXPECT_EQ(
+        expectPurchaseValueSquaredColumns,
+        inputData.getPurchaseValueSquaredColumns().getSlots());
+    // log2(3 + 1 + 2 + 3 + 4 + 5 + 6 + 1) and log2(9 + 36 + 81 + 36 + 1)
+    EXPECT_EQ(5, inputData.getNumBitsForValue());
+    EXPECT_EQ(8, inputData.getNumBitsForValueSquared());
+  }
+  std::filesystem::remove(filename);
+}
+
+TEST_F(InputDataTest, TestInputDataParallelParseMatchesSequential) {
+  for (const auto& filename : {aliceInputFilename_, bobInputFilename_}) {
+    InputData sequential{
+        filename,
+        InputData::LiftMPCType::Standard,
+        true,
+        1546300800, /* epoch */
+        4 /* num_conversions_per_user */};
+    InputData parallel{
+        filename,
+        InputData::LiftMPCType::Standard,
+        true,
+        1546300800, /* epoch */
+        4, /* num_conversions_per_user */
+        3 /* num_parse_threads */};
+
+    EXPECT_EQ(sequential.getNumRows(), parallel.getNumRows());
+    EXPECT_EQ(sequential.getTestPopulation(), parallel.getTestPopulation());
+    EXPECT_EQ(
+        sequential.getControlPopulation(), parallel.getControlPopulation());
+    EXPECT_EQ(
+        sequential.getOpportunityTimestamps(),
+        parallel.getOpportunityTimestamps());
+    EXPECT_EQ(
+        sequential.getPurchaseTimestampColumns().getSlots(),
+        parallel.getPurchaseTimestampColumns().getSlots());
+    EXPECT_EQ(
+        sequential.getPurchaseValueColumns().getSlots(),
+        parallel.getPurchaseValueColumns().getSlots());
+    EXPECT_EQ(
+        sequential.getPurchaseValueSquaredColumns().getSlots(),
+        parallel.getPurchaseValueSquaredColumns().getSlots());
+    EXPECT_EQ(sequential.getPartnerCohortIds(), parallel.getPartnerCohortIds());
+    EXPECT_EQ(sequential.getBreakdownIds(), parallel.getBreakdownIds());
+    EXPECT_EQ(sequential.getDummyRows(), parallel.getDummyRows());
+    EXPECT_EQ(
+        sequential.getNumPartnerCohorts(), parallel.getNumPartnerCohorts());
+    EXPECT_EQ(
+        sequential.getNumPublisherBreakdowns(),
+        parallel.getNumPublisherBreakdowns());
+    EXPECT_EQ(sequential.getNumBitsForValue(), parallel.getNumBitsForValue());
+    EXPECT_EQ(
+        sequential.getNumBitsForValueSquared(),
+        parallel.getNumBitsForValueSquared());
+  }
+}
+
+TEST_F(InputDataTest, TestInputDataRowGroupsMatchCsv) {
+  for (const auto& filename : {aliceInputFilename_, bobInputFilename_}) {
+    // The combiners write the row groups from csv rows without spaces
+    std::ifstream csvFile{filename};
+    std::stringstream csv;
+    std::string line;
+    while (std::getline(csvFile, line)) {
+      line.erase(std::remove(line.begin(), line.end(), ' '), line.end());
+      csv << line << '\n';
+    }
+    auto rowGroupFilename = std::filesystem::temp_directory_path() /
+        ("InputDataRowGroups_" + std::to_string(folly::Random::rand32()));
+    {
+      std::ofstream rowGroupFile{rowGroupFilename, std::ios::binary};
+      private_measurement::row_group::convertCsv(
+          csv, rowGroupFile, 3 /* rows_per_group */);
+    }
+
+    InputData fromCsv{
+        filename,
+        InputData::LiftMPCType::Standard,
+        true,
+        1546300800, /* epoch */
+        4 /* num_conversions_per_user */};
+    InputData fromRowGroups{
+        rowGroupFilename.native(),
+        InputData::LiftMPCType::Standard,
+        true,
+        1546300800, /* epoch */
+        4 /* num_conversions_per_user */};
+    std::filesystem::remove(rowGroupFilename);
+
+    EXPECT_EQ(fromCsv.getNumRows(), fromRowGroups.getNumRows());
+    EXPECT_EQ(fromCsv.getTestPopulation(), fromRowGroups.getTestPopulation());
+    EXPECT_EQ(
+        fromCsv.getControlPopulation(), fromRowGroups.getControlPopulation());
+    EXPECT_EQ(
+        fromCsv.getOpportunityTimestamps(),
+        fromRowGroups.getOpportunityTimestamps());
+    EXPECT_EQ(
+        fromCsv.getPurchaseTimestampColumns().getSlots(),
+        fromRowGroups.getPurchaseTimestampColumns().getSlots());
+    EXPECT_EQ(
+        fromCsv.getPurchaseValueColumns().getSlots(),
+        fromRowGroups.getPurchaseValueColumns().getSlots());
+    EXPECT_EQ(
+        fromCsv.getPurchaseValueSquaredColumns().getSlots(),
+        fromRowGroups.getPurchaseValueSquaredColumns().getSlots());
+    EXPECT_EQ(
+        fromCsv.getPartnerCohortIds(), fromRowGroups.getPartnerCohortIds());
+    EXPECT_EQ(fromCsv.getDummyRows(), fromRowGroups.getDummyRows());
+    EXPECT_EQ(
+        fromCsv.getNumPartnerCohorts(), fromRowGroups.getNumPartnerCohorts());
+  }
+}
 } // namespace private_lift
@@ -18,6 +18,7 @@
 #include "fbpcf/test/TestHelper.h"
 
 #include "fbpcs/emp_games/common/Util.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/LiftMetricSet.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/InputProcessor.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/SecretShareInputProcessor.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/test/TestUtil.h"
@@ -51,6 +52,18 @@ void serializeAndDeserializeData(
       globalParamsPath, secretSharesPath);
 }
 
+template <int schedulerId>
+void serializeAndDeserializeBinaryData(
+    std::reference_wrapper<InputProcessor<schedulerId>> inputProcessor,
+    std::reference_wrapper<LiftGameProcessedData<schedulerId>> toWrite,
+    const std::string& globalParamsPath,
+    const std::string& secretSharesPath) {
+  writeToBinary(inputProcessor.get(), globalParamsPath, secretSharesPath);
+
+  toWrite.get() =
+      LiftGameProcessedData<schedulerId>::readFromBinary(secretSharesPath);
+}
+
 static void cleanup(std::string file_to_delete) {
   remove(file_to_delete.c_str());
 }
@@ -61,6 +74,8 @@ class InputProcessorTest : public ::testing::TestWithParam<bool> {
   InputProcessor<1> partnerInputProcessor_;
   LiftGameProcessedData<0> publisherDeserialized_;
   LiftGameProcessedData<1> partnerDeserialized_;
+  LiftGameProcessedData<0> publisherBinaryDeserialized_;
+  LiftGameProcessedData<1> partnerBinaryDeserialized_;
   SecretShareInputProcessor<0> publisherSecretInputProcessor_;
   SecretShareInputProcessor<1> partnerSecretInputProcessor_;
 
@@ -158,8 +173,10 @@ class InputProcessorTest : public ::testing::TestWithParam<bool> {
     auto future4 = std::async(
         [](const std::string& globalParamsPath,
            const std::string& secretSharesPath) {
+          // Parse the shares in several chunks, which must give the same
+          // data as the single threaded deserialization above
           return SecretShareInputProcessor<0>(
-              globalParamsPath, secretSharesPath);
+              globalParamsPath, secretSharesPath, false, 3);
         },
         publisherGlobalParamsOutput,
         publisherSecretSharesOutput);
@@ -167,8 +184,10 @@ class InputProcessorTest : public ::testing::TestWithParam<bool> {
     auto future5 = std::async(
         [](const std::string& globalParamsPath,
            const std::string& secretSharesPath) {
+          // Parse the shares in several chunks, which must give the same
+          // data as the single threaded deserialization above
           return SecretShareInputProcessor<1>(
-              globalParamsPath, secretSharesPath);
+              globalParamsPath, secretSharesPath, false, 3);
         },
         partnerGlobalParamsOutput,
         partnerSecretSharesOutput);
@@ -176,6 +195,25 @@ class InputProcessorTest : public ::testing::TestWithParam<bool> {
     publisherSecretInputProcessor_ = future4.get();
     partnerSecretInputProcessor_ = future5.get();
 
+    auto future6 = std::async(
+        serializeAndDeserializeBinaryData<0>,
+        std::reference_wrapper<InputProcessor<0>>(publisherInputProcessor_),
+        std::reference_wrapper<LiftGameProcessedData<0>>(
+            publisherBinaryDeserialized_),
+        publisherGlobalParamsOutput,
+        publisherSecretSharesOutput);
+
+    auto future7 = std::async(
+        serializeAndDeserializeBinaryData<1>,
+        std::reference_wrapper<InputProcessor<1>>(partnerInputProcessor_),
+        std::reference_wrapper<LiftGameProcessedData<1>>(
+            partnerBinaryDeserialized_),
+        partnerGlobalParamsOutput,
+        partnerSecretSharesOutput);
+
+    future6.get();
+    future7.get();
+
     cleanup(publisherGlobalParamsOutput);
     cleanup(publisherSecretSharesOutput);
     cleanup(partnerGlobalParamsOutput);
@@ -374,6 +412,83 @@ TEST_P(InputProcessorTest, testReach) {
       partnerSecretInputProcessor_.getLiftGameProcessedData());
 }
 
+TEST_P(InputProcessorTest, testReadSelectedColumns) {
+  std::string tempDir = std::filesystem::temp_directory_path();
+  auto globalParamsPath = folly::sformat(
+      "{}/global_params_{}.csv", tempDir, folly::Random::secureRand64());
+  auto secretSharesPath = folly::sformat(
+      "{}/secret_shares_{}.csv", tempDir, folly::Random::secureRand64());
+  auto binarySecretSharesPath = folly::sformat(
+      "{}/secret_shares_{}.bin", tempDir, folly::Random::secureRand64());
+  writeToCSV(publisherInputProcessor_, globalParamsPath, secretSharesPath);
+  writeToBinary(
+      publisherInputProcessor_, globalParamsPath, binarySecretSharesPath);
+
+  auto columns =
+      LiftMetricSet{/* valueSquared */ false, /* reached */ false}
+          .getSecretShareColumns();
+  auto fromCsv = LiftGameProcessedData<0>::readFromCSV(
+      globalParamsPath, secretSharesPath, 1, columns);
+  auto fromCsvChunks = LiftGameProcessedData<0>::readFromCSV(
+      globalParamsPath, secretSharesPath, 3, columns);
+  auto fromBinary = LiftGameProcessedData<0>::readFromBinary(
+      binarySecretSharesPath, columns);
+  cleanup(globalParamsPath);
+  cleanup(secretSharesPath);
+  cleanup(binarySecretSharesPath);
+
+  for (const auto* data : {&fromCsv, &fromCsvChunks, &fromBinary}) {
+    util::assertNumRows(*data);
+    EXPECT_TRUE(data->testIndexShares.empty());
+    EXPECT_TRUE(data->purchaseValueSquared.empty());
+    // The columns read are the same as when every column is read, and in the
+    // binary format they come after the columns skipped
+    EXPECT_EQ(data->indexShares, publisherDeserialized_.indexShares);
+    ASSERT_EQ(
+        data->purchaseValues.size(),
+        publisherDeserialized_.purchaseValues.size());
+    for (size_t i = 0; i < data->purchaseValues.size(); ++i) {
+      EXPECT_EQ(
+          data->purchaseValues.at(i).extractIntShare().getValue(),
+          publisherDeserialized_.purchaseValues.at(i)
+              .extractIntShare()
+              .getValue());
+    }
+  }
+}
+
+TEST_P(InputProcessorTest, testBinarySecretShares) {
+  util::assertNumRows(publisherBinaryDeserialized_);
+  util::assertNumRows(partnerBinaryDeserialized_);
+  util::assertValueBits(publisherBinaryDeserialized_);
+  util::assertPartnerCohorts(publisherBinaryDeserialized_);
+  util::assertNumBreakdowns(
+      publisherBinaryDeserialized_, computePublisherBreakdowns_);
+  util::assertNumGroups(
+      publisherBinaryDeserialized_, computePublisherBreakdowns_);
+  util::assertNumTestGroups(
+      publisherBinaryDeserialized_, computePublisherBreakdowns_);
+  util::assertIndexShares(
+      publisherBinaryDeserialized_, computePublisherBreakdowns_);
+  util::assertTestIndexShares(
+      publisherBinaryDeserialized_, computePublisherBreakdowns_);
+  util::assertOpportunityTimestamps(
+      publisherBinaryDeserialized_, partnerBinaryDeserialized_);
+  util::assertIsValidOpportunityTimestamps(
+      publisherBinaryDeserialized_, partnerBinaryDeserialized_);
+  util::assertPurchaseTimestamps(
+      publisherBinaryDeserialized_, partnerBinaryDeserialized_);
+  util::assertThresholdTimestamps(
+      publisherBinaryDeserialized_, partnerBinaryDeserialized_);
+  util::assertAnyValidPurchaseTimestamp(
+      publisherBinaryDeserialized_, partnerBinaryDeserialized_);
+  util::assertPurchaseValues(
+      publisherBinaryDeserialized_, partnerBinaryDeserialized_);
+  util::assertPurchaseValuesSquared(
+      publisherBinaryDeserialized_, partnerBinaryDeserialized_);
+  util::assertReach(publisherBinaryDeserialized_, partnerBinaryDeserialized_);
+}
+
 INSTANTIATE_TEST_SUITE_P(
     InputProcessorTestSuite,
     InputProcessorTest,
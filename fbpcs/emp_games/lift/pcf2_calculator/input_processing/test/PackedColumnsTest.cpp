@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <vector>
+
+#include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/PackedColumns.h"
+
+namespace private_lift::input_processing {
+
+TEST(PackedColumnsTest, TestPacksAndUnpacksColumns) {
+  PackedColumns packed{3};
+  auto timestamps = packed.addInts(std::vector<uint32_t>{100, 0, 4000000000}, 32);
+  auto bits = packed.addBits({true, false, true});
+  auto values = packed.addInts(std::vector<int64_t>{-5, 7}, 32);
+  auto squares = packed.addInts(std::vector<int64_t>{-1, 1LL << 40, 9}, 64);
+  EXPECT_EQ(packed.getBits().size(), 3 * (32 + 1 + 32 + 64));
+
+  const auto& shares = packed.getBits();
+  EXPECT_EQ(
+      packed.getIntShares<uint64_t>(shares, timestamps, 32),
+      (std::vector<uint64_t>{100, 0, 4000000000}));
+  EXPECT_EQ(
+      packed.getBitShares(shares, bits), (std::vector<bool>{true, false, true}));
+  EXPECT_EQ(
+      packed.getIntShares<int64_t>(shares, values, 32),
+      (std::vector<int64_t>{-5, 7, 0}));
+  EXPECT_EQ(
+      packed.getIntShares<int64_t>(shares, squares, 64),
+      (std::vector<int64_t>{-1, 1LL << 40, 9}));
+}
+
+TEST(PackedColumnsTest, TestUnpacksXorSharesOfColumns) {
+  // The XOR of the shares of the two parties is the XOR of their columns
+  PackedColumns first{2};
+  PackedColumns second{2};
+  auto offset = first.addInts(std::vector<uint32_t>{0b1100, 0b1010}, 4);
+  second.addInts(std::vector<uint32_t>{0b0110, 0b0011}, 4);
+  std::vector<bool> shares(first.getBits().size());
+  for (size_t i = 0; i < shares.size(); ++i) {
+    shares[i] = first.getBits()[i] != second.getBits()[i];
+  }
+  EXPECT_EQ(
+      first.getIntShares<uint64_t>(shares, offset, 4),
+      (std::vector<uint64_t>{0b1010, 0b1001}));
+}
+
+TEST(PackedColumnsTest, TestPacksSlotsOfRaggedColumns) {
+  RaggedColumns<int64_t> columns;
+  columns.addRow({-2});
+  columns.addRow({5, 6});
+  PackedColumns packed{3};
+  auto first = packed.addSlot(columns, 0, 32);
+  auto second = packed.addSlot(columns, 1, 32);
+
+  const auto& shares = packed.getBits();
+  EXPECT_EQ(
+      packed.getIntShares<int64_t>(shares, first, 32),
+      (std::vector<int64_t>{-2, 5, 0}));
+  EXPECT_EQ(
+      packed.getIntShares<int64_t>(shares, second, 32),
+      (std::vector<int64_t>{0, 6, 0}));
+}
+
+} // namespace private_lift::input_processing
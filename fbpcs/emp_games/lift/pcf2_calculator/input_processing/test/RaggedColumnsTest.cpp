@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <vector>
+
+#include "fbpcs/emp_games/lift/pcf2_calculator/input_processing/RaggedColumns.h"
+
+namespace private_lift::input_processing {
+
+TEST(RaggedColumnsTest, TestPadsRowsToSlots) {
+  RaggedColumns<int64_t> columns;
+  columns.addRow({3});
+  columns.addRow({});
+  columns.addRow({1, 2, 0});
+  columns.addRow({4, 5});
+  columns.setLastRowValue(1, 6);
+
+  EXPECT_EQ(columns.getNumRows(), 4);
+  EXPECT_EQ(columns.getNumSlots(), 3);
+  EXPECT_EQ(columns.getRowSize(1), 0);
+  EXPECT_EQ(columns.at(3, 1), 6);
+  EXPECT_EQ(columns.at(0, 2), 0);
+  EXPECT_EQ(columns.at(4, 0), 0);
+  EXPECT_EQ(columns.getSlot(0, 5), (std::vector<int64_t>{3, 0, 1, 4, 0}));
+  EXPECT_EQ(columns.getSlot(1, 2), (std::vector<int64_t>{0, 0}));
+  EXPECT_EQ(
+      columns.getSlots(),
+      (std::vector<std::vector<int64_t>>{
+          {3, 0, 1, 4}, {0, 0, 2, 6}, {0, 0, 0, 0}}));
+}
+
+TEST(RaggedColumnsTest, TestAppend) {
+  RaggedColumns<uint32_t> first;
+  first.addRow({1, 2});
+  RaggedColumns<uint32_t> second;
+  second.addRow({3});
+  second.addRow({4, 5, 6});
+  first.append(std::move(second));
+
+  EXPECT_EQ(first.getNumRows(), 3);
+  EXPECT_EQ(
+      first.getSlots(),
+      (std::vector<std::vector<uint32_t>>{{1, 3, 4}, {2, 0, 5}, {0, 0, 6}}));
+}
+
+} // namespace private_lift::input_processing
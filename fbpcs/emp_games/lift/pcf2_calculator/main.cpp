@@ -9,16 +9,24 @@
 #include <glog/logging.h>
 #include <signal.h>
 #include <algorithm>
+#include <chrono>
 #include <filesystem>
+#include <iostream>
+#include <optional>
 #include <sstream>
 #include <string>
 
 #include "folly/String.h"
 #include "folly/init/Init.h"
+#include "folly/json.h"
 #include "folly/logging/xlog.h"
 
 #include "fbpcf/aws/AwsSdk.h"
 #include "fbpcs/emp_games/common/FeatureFlagUtil.h"
+#include "fbpcs/emp_games/common/JobManifest.h"
+#include "fbpcs/emp_games/common/MetricsRegistry.h"
+#include "fbpcs/emp_games/common/MetricsServer.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/DryRun.h"
 #include "fbpcs/emp_games/lift/pcf2_calculator/MainUtil.h"
 #include "fbpcs/performance_tools/CostEstimation.h"
 
@@ -85,6 +93,10 @@ DEFINE_int32(
     concurrency,
     1,
     "max number of game(s) that will run concurrently?");
+DEFINE_int32(
+    input_parse_threads,
+    1,
+    "Number of threads each game uses to parse a local input file");
 DEFINE_string(
     run_name,
     "",
@@ -126,6 +138,64 @@ DEFINE_string(
     private_key_path,
     "",
     "Relative file path where private key is stored. It will be prefixed with $HOME.");
+DEFINE_string(
+    shard_cost_manifest,
+    "",
+    "Path of the shard cost manifest written by the sharder, used by the "
+    "publisher to run the most expensive files first. Files run in order "
+    "if empty");
+DEFINE_string(
+    job_manifest,
+    "",
+    "Path of a manifest of independent jobs to run in this one session, "
+    "each with one input and its own output, instead of the files given by "
+    "the other input and output flags. Both parties have to list the same "
+    "jobs in the same order, and the jobs share the output visibility");
+DEFINE_int32(
+    input_wait_timeout_s,
+    0,
+    "If positive, connect and set up the schedulers before the inputs are "
+    "written, then wait up to this many seconds for the inputs of each file "
+    "before parsing them. Inputs are expected to be there if 0");
+DEFINE_bool(
+    multiplex_connections,
+    false,
+    "Run the apps of every concurrency lane as streams of one connection on "
+    "port, instead of each app connecting on a port of its own. Both parties "
+    "must set it the same");
+DEFINE_bool(
+    adaptive_concurrency,
+    false,
+    "Start the apps one at a time up to concurrency, while each one raises the "
+    "throughput of the run, instead of starting all of them. Both parties must "
+    "set it the same");
+DEFINE_int32(
+    adaptive_concurrency_interval_s,
+    30,
+    "Seconds the throughput is measured for before starting each app, when "
+    "adaptive_concurrency is set");
+DEFINE_bool(
+    dry_run_estimate,
+    false,
+    "Predict the gates, traffic and time of a run of --dry_run_num_rows rows "
+    "from dry runs of both parties on small generated inputs in this process, "
+    "print them and exit without connecting to the other party");
+DEFINE_int64(
+    dry_run_num_rows,
+    1'000'000,
+    "Rows of the run --dry_run_estimate predicts the costs of");
+DEFINE_int64(
+    dry_run_num_cohorts,
+    0,
+    "Partner cohorts of the run --dry_run_estimate predicts the costs of");
+DEFINE_int64(
+    dry_run_num_breakdowns,
+    0,
+    "Publisher breakdowns of the run --dry_run_estimate predicts the costs of");
+DEFINE_int32(
+    dry_run_bandwidth_mbps,
+    1000,
+    "Bandwidth in Mbps between the parties --dry_run_estimate assumes");
 
 int main(int argc, char** argv) {
   folly::init(&argc, &argv);
@@ -146,6 +216,37 @@ int main(int argc, char** argv) {
   CHECK_LE(concurrency, private_lift::kMaxConcurrency)
       << "Concurrency must be at most " << private_lift::kMaxConcurrency;
 
+  if (FLAGS_dry_run_estimate) {
+    int party = FLAGS_party - 1;
+    auto estimate = private_lift::estimateLiftCosts(
+        party,
+        FLAGS_dry_run_num_rows,
+        FLAGS_num_conversions_per_user,
+        FLAGS_dry_run_num_cohorts,
+        FLAGS_dry_run_num_breakdowns,
+        FLAGS_compute_publisher_breakdowns,
+        FLAGS_epoch,
+        FLAGS_use_xor_encryption,
+        FLAGS_num_files,
+        FLAGS_concurrency,
+        FLAGS_dry_run_bandwidth_mbps);
+    auto info = estimate.toDynamic();
+    info["num_conversions_per_user"] = FLAGS_num_conversions_per_user;
+    info["num_cohorts"] = FLAGS_dry_run_num_cohorts;
+    info["num_breakdowns"] = FLAGS_dry_run_num_breakdowns;
+    info["concurrency"] = FLAGS_concurrency;
+    info["num_files"] = FLAGS_num_files;
+    std::cout << folly::toPrettyJson(cost.getPredictedCostDynamic(
+                     FLAGS_run_name.empty() ? "dry_run" : FLAGS_run_name,
+                     party == common::PUBLISHER ? "Publisher" : "Partner",
+                     static_cast<int64_t>(estimate.getSeconds()),
+                     estimate.receivedNetwork,
+                     estimate.sentNetwork,
+                     info))
+              << std::endl;
+    return 0;
+  }
+
   auto filepaths = private_lift::getIOFilepaths(
       FLAGS_input_base_path,
       FLAGS_output_base_path,
@@ -157,6 +258,19 @@ int main(int argc, char** argv) {
       FLAGS_file_start_index);
   auto inputFilepaths = filepaths.first;
   auto outputFilepaths = filepaths.second;
+  if (!FLAGS_job_manifest.empty()) {
+    // Each job is a file of the session, so the jobs only share the costs of
+    // setting up the session and are computed and written separately
+    auto jobs = common::readJobManifest(FLAGS_job_manifest, 1);
+    inputFilepaths.clear();
+    outputFilepaths.clear();
+    for (const auto& job : jobs) {
+      inputFilepaths.push_back(job.inputs.at(0));
+      outputFilepaths.push_back(job.output);
+    }
+    XLOG(INFO) << "Running " << jobs.size() << " jobs from "
+               << FLAGS_job_manifest << " in one session";
+  }
 
   auto tlsInfo = fbpcf::engine::communication::getTlsInfoFromArgs(
       FLAGS_use_tls,
@@ -165,11 +279,37 @@ int main(int argc, char** argv) {
       FLAGS_private_key_path,
       "");
 
-  bool readInputFromSecretShares = private_measurement::isFeatureFlagEnabled(
-      FLAGS_pc_feature_flags, "private_lift_unified_data_process");
+  const private_measurement::FeatureFlags featureFlags{
+      FLAGS_pc_feature_flags};
+
+  bool readInputFromSecretShares =
+      featureFlags.isEnabled("private_lift_unified_data_process");
+
+  bool useDecoupledUDP =
+      featureFlags.isEnabled("pcs_private_lift_decoupled_udp");
+
+  bool useBinarySecretShares =
+      featureFlags.isEnabled("private_lift_binary_secret_shares");
+
+  bool useShardCache = featureFlags.isEnabled("private_lift_shard_cache");
 
-  bool useDecoupledUDP = private_measurement::isFeatureFlagEnabled(
-      FLAGS_pc_feature_flags, "pcs_private_lift_decoupled_udp");
+  // Runs the metadata compaction of plaintext inputs in this binary
+  bool useFusedCompaction = !readInputFromSecretShares &&
+      featureFlags.isEnabled("private_lift_fused_compaction");
+
+  // Shares the timestamps of plaintext inputs relative to the earliest valid
+  // opportunity, which the publisher reveals to the partner
+  bool useRelativeTimestamps = !readInputFromSecretShares &&
+      !useFusedCompaction &&
+      featureFlags.isEnabled("private_lift_relative_timestamps");
+
+  // Leaves out optional metrics, along with the secret share columns which
+  // only they read
+  private_lift::LiftMetricSet metrics;
+  metrics.valueSquared =
+      !featureFlags.isEnabled("private_lift_skip_value_squared");
+  metrics.reached =
+      !featureFlags.isEnabled("private_lift_skip_reached_metrics");
 
   {
     // Build a quick list of input/output files to log
@@ -186,6 +326,8 @@ int main(int argc, char** argv) {
                << "\tserver_ip_address: " << FLAGS_server_ip << "\n"
                << "\tport: " << FLAGS_port << "\n"
                << "\tconcurrency: " << FLAGS_concurrency << "\n"
+               << "\tinput parse threads: " << FLAGS_input_parse_threads
+               << "\n"
                << "\tnumber of conversions per user: "
                << FLAGS_num_conversions_per_user << "\n"
                << "\tpc_feature_flags:" << FLAGS_pc_feature_flags
@@ -193,6 +335,15 @@ int main(int argc, char** argv) {
                << "\toutput: " << outputFileLogList.str() << "\n"
                << "\tread from secret share: " << readInputFromSecretShares
                << "\tuse decoupled udp: " << useDecoupledUDP
+               << "\tread binary secret shares: " << useBinarySecretShares
+               << "\tuse shard cache: " << useShardCache
+               << "\tuse fused compaction: " << useFusedCompaction
+               << "\tuse relative timestamps: " << useRelativeTimestamps
+               << "\tcompute value squared: " << metrics.valueSquared
+               << "\tcompute reached metrics: " << metrics.reached
+               << "\tinput wait timeout: " << FLAGS_input_wait_timeout_s << "s"
+               << "\tmultiplex connections: " << FLAGS_multiplex_connections
+               << "\tadaptive concurrency: " << FLAGS_adaptive_concurrency
                << "\tinput expanded key path: " << FLAGS_input_expanded_key_path
                << "\tinput global params path: "
                << FLAGS_input_global_params_path << "\n"
@@ -202,6 +353,17 @@ int main(int argc, char** argv) {
   FLAGS_party--; // subtract 1 because we use 0 and 1 for publisher and partner
                  // instead of 1 and 2
   common::SchedulerStatistics schedulerStatistics;
+  auto metricsServer = common::MetricsServer::startFromFlags();
+  common::MetricsRegistry::getInstance()
+      .getGauge("shard.files_total")
+      .set(inputFilepaths.size());
+
+  std::optional<common::LaneController::Options> adaptiveConcurrency;
+  if (FLAGS_adaptive_concurrency) {
+    adaptiveConcurrency = common::LaneController::Options{};
+    adaptiveConcurrency->interval =
+        std::chrono::seconds(FLAGS_adaptive_concurrency_interval_s);
+  }
 
   XLOG(INFO) << "Start Private Lift...";
   if (FLAGS_party == common::PUBLISHER) {
@@ -222,7 +384,17 @@ int main(int argc, char** argv) {
             FLAGS_compute_publisher_breakdowns,
             FLAGS_epoch,
             FLAGS_use_xor_encryption,
-            tlsInfo);
+            useBinarySecretShares,
+            FLAGS_input_parse_threads,
+            tlsInfo,
+            FLAGS_shard_cost_manifest,
+            useShardCache,
+            useFusedCompaction,
+            std::chrono::seconds(FLAGS_input_wait_timeout_s),
+            useRelativeTimestamps,
+            metrics,
+            FLAGS_multiplex_connections,
+            adaptiveConcurrency);
   } else if (FLAGS_party == common::PARTNER) {
     XLOG(INFO)
         << "Starting Private Lift as Partner, will wait for Publisher...";
@@ -241,7 +413,17 @@ int main(int argc, char** argv) {
             FLAGS_compute_publisher_breakdowns,
             FLAGS_epoch,
             FLAGS_use_xor_encryption,
-            tlsInfo);
+            useBinarySecretShares,
+            FLAGS_input_parse_threads,
+            tlsInfo,
+            FLAGS_shard_cost_manifest,
+            useShardCache,
+            useFusedCompaction,
+            std::chrono::seconds(FLAGS_input_wait_timeout_s),
+            useRelativeTimestamps,
+            metrics,
+            FLAGS_multiplex_connections,
+            adaptiveConcurrency);
   } else {
     XLOGF(FATAL, "Invalid Party: {}", FLAGS_party);
   }
@@ -20,8 +20,8 @@
 namespace private_lift {
 const bool unsafe = true;
 
-template <int schedulerId>
-Aggregator<schedulerId> createAggregatorWithScheduler(
+template <int schedulerId, typename Widths>
+Aggregator<schedulerId, Widths> createAggregatorWithScheduler(
     int myRole,
     InputData inputData,
     int numConversionsPerUser,
@@ -34,9 +34,9 @@ Aggregator<schedulerId> createAggregatorWithScheduler(
       std::move(scheduler));
   auto inputProcessor =
       InputProcessor<schedulerId>(myRole, inputData, numConversionsPerUser);
-  auto attributor = std::make_unique<Attributor<schedulerId>>(
+  auto attributor = std::make_unique<Attributor<schedulerId, Widths>>(
       myRole, std::make_unique<InputProcessor<schedulerId>>(inputProcessor));
-  return Aggregator<schedulerId>(
+  return Aggregator<schedulerId, Widths>(
       myRole,
       std::make_unique<InputProcessor<schedulerId>>(std::move(inputProcessor)),
       std::move(attributor),
@@ -44,10 +44,13 @@ Aggregator<schedulerId> createAggregatorWithScheduler(
       factory);
 }
 
+// The values of the sample input fit both the default and the narrow value
+// widths, which have to give the same metrics
+template <typename Widths>
 class AggregatorTest : public ::testing::Test {
  protected:
-  std::unique_ptr<Aggregator<0>> publisherAggregator_;
-  std::unique_ptr<Aggregator<1>> partnerAggregator_;
+  std::unique_ptr<Aggregator<0, Widths>> publisherAggregator_;
+  std::unique_ptr<Aggregator<1, Widths>> partnerAggregator_;
 
   void SetUp() override {
     std::string publisherInputFilename =
@@ -82,7 +85,7 @@ class AggregatorTest : public ::testing::Test {
             1, *factories[1]);
 
     auto future0 = std::async(
-        createAggregatorWithScheduler<0>,
+        createAggregatorWithScheduler<0, Widths>,
         0,
         publisherInputData,
         numConversionsPerUser,
@@ -91,7 +94,7 @@ class AggregatorTest : public ::testing::Test {
             schedulerFactory0));
 
     auto future1 = std::async(
-        createAggregatorWithScheduler<1>,
+        createAggregatorWithScheduler<1, Widths>,
         1,
         partnerInputData,
         numConversionsPerUser,
@@ -99,144 +102,148 @@ class AggregatorTest : public ::testing::Test {
         std::reference_wrapper<fbpcf::scheduler::ISchedulerFactory<unsafe>>(
             schedulerFactory1));
 
-    publisherAggregator_ = std::make_unique<Aggregator<0>>(future0.get());
-    partnerAggregator_ = std::make_unique<Aggregator<1>>(future1.get());
+    publisherAggregator_ =
+        std::make_unique<Aggregator<0, Widths>>(future0.get());
+    partnerAggregator_ = std::make_unique<Aggregator<1, Widths>>(future1.get());
   }
 };
 
-TEST_F(AggregatorTest, testEvents) {
-  auto test = publisherAggregator_->getMetrics().testEvents;
-  auto control = publisherAggregator_->getMetrics().controlEvents;
+using ValueWidthTypes = ::testing::Types<DefaultValueWidths, NarrowValueWidths>;
+TYPED_TEST_SUITE(AggregatorTest, ValueWidthTypes);
+
+TYPED_TEST(AggregatorTest, testEvents) {
+  auto test = this->publisherAggregator_->getMetrics().testEvents;
+  auto control = this->publisherAggregator_->getMetrics().controlEvents;
   EXPECT_EQ(test, 9);
   EXPECT_EQ(control, 5);
-  auto cohort = publisherAggregator_->getCohortMetrics();
+  auto cohort = this->publisherAggregator_->getCohortMetrics();
   EXPECT_EQ(cohort[0].testEvents, 2);
   EXPECT_EQ(cohort[1].testEvents, 3);
   EXPECT_EQ(cohort[2].testEvents, 4);
   EXPECT_EQ(cohort[0].controlEvents, 2);
   EXPECT_EQ(cohort[1].controlEvents, 2);
   EXPECT_EQ(cohort[2].controlEvents, 1);
-  auto breakdown = publisherAggregator_->getBreakdownMetrics();
+  auto breakdown = this->publisherAggregator_->getBreakdownMetrics();
   EXPECT_EQ(breakdown[0].testEvents, 4);
   EXPECT_EQ(breakdown[1].testEvents, 5);
   EXPECT_EQ(breakdown[0].controlEvents, 4);
   EXPECT_EQ(breakdown[1].controlEvents, 1);
 }
 
-TEST_F(AggregatorTest, testConverters) {
-  auto test = publisherAggregator_->getMetrics().testConverters;
-  auto control = publisherAggregator_->getMetrics().controlConverters;
+TYPED_TEST(AggregatorTest, testConverters) {
+  auto test = this->publisherAggregator_->getMetrics().testConverters;
+  auto control = this->publisherAggregator_->getMetrics().controlConverters;
   EXPECT_EQ(test, 7);
   EXPECT_EQ(control, 4);
-  auto cohort = publisherAggregator_->getCohortMetrics();
+  auto cohort = this->publisherAggregator_->getCohortMetrics();
   EXPECT_EQ(cohort[0].testConverters, 2);
   EXPECT_EQ(cohort[1].testConverters, 2);
   EXPECT_EQ(cohort[2].testConverters, 3);
   EXPECT_EQ(cohort[0].controlConverters, 2);
   EXPECT_EQ(cohort[1].controlConverters, 1);
   EXPECT_EQ(cohort[2].controlConverters, 1);
-  auto breakdown = publisherAggregator_->getBreakdownMetrics();
+  auto breakdown = this->publisherAggregator_->getBreakdownMetrics();
   EXPECT_EQ(breakdown[0].testConverters, 3);
   EXPECT_EQ(breakdown[1].testConverters, 4);
   EXPECT_EQ(breakdown[0].controlConverters, 3);
   EXPECT_EQ(breakdown[1].controlConverters, 1);
 }
 
-TEST_F(AggregatorTest, testNumConvSquared) {
-  auto test = publisherAggregator_->getMetrics().testNumConvSquared;
+TYPED_TEST(AggregatorTest, testNumConvSquared) {
+  auto test = this->publisherAggregator_->getMetrics().testNumConvSquared;
   EXPECT_EQ(test, 13);
-  auto control = publisherAggregator_->getMetrics().controlNumConvSquared;
+  auto control = this->publisherAggregator_->getMetrics().controlNumConvSquared;
   EXPECT_EQ(control, 7);
-  auto cohort = publisherAggregator_->getCohortMetrics();
+  auto cohort = this->publisherAggregator_->getCohortMetrics();
   EXPECT_EQ(cohort[0].testNumConvSquared, 2);
   EXPECT_EQ(cohort[1].testNumConvSquared, 5);
   EXPECT_EQ(cohort[2].testNumConvSquared, 6);
   EXPECT_EQ(cohort[0].controlNumConvSquared, 2);
   EXPECT_EQ(cohort[1].controlNumConvSquared, 4);
   EXPECT_EQ(cohort[2].controlNumConvSquared, 1);
-  auto breakdown = publisherAggregator_->getBreakdownMetrics();
+  auto breakdown = this->publisherAggregator_->getBreakdownMetrics();
   EXPECT_EQ(breakdown[0].testNumConvSquared, 6);
   EXPECT_EQ(breakdown[1].testNumConvSquared, 7);
   EXPECT_EQ(breakdown[0].controlNumConvSquared, 6);
   EXPECT_EQ(breakdown[1].controlNumConvSquared, 1);
 }
 
-TEST_F(AggregatorTest, testMatchCount) {
-  auto test = publisherAggregator_->getMetrics().testMatchCount;
-  auto control = publisherAggregator_->getMetrics().controlMatchCount;
+TYPED_TEST(AggregatorTest, testMatchCount) {
+  auto test = this->publisherAggregator_->getMetrics().testMatchCount;
+  auto control = this->publisherAggregator_->getMetrics().controlMatchCount;
   EXPECT_EQ(test, 12);
   EXPECT_EQ(control, 7);
-  auto cohort = publisherAggregator_->getCohortMetrics();
+  auto cohort = this->publisherAggregator_->getCohortMetrics();
   EXPECT_EQ(cohort[0].testMatchCount, 6);
   EXPECT_EQ(cohort[1].testMatchCount, 3);
   EXPECT_EQ(cohort[2].testMatchCount, 3);
   EXPECT_EQ(cohort[0].controlMatchCount, 4);
   EXPECT_EQ(cohort[1].controlMatchCount, 2);
   EXPECT_EQ(cohort[2].controlMatchCount, 1);
-  auto breakdown = publisherAggregator_->getBreakdownMetrics();
+  auto breakdown = this->publisherAggregator_->getBreakdownMetrics();
   EXPECT_EQ(breakdown[0].testMatchCount, 6);
   EXPECT_EQ(breakdown[1].testMatchCount, 6);
   EXPECT_EQ(breakdown[0].controlMatchCount, 6);
   EXPECT_EQ(breakdown[1].controlMatchCount, 1);
 }
 
-TEST_F(AggregatorTest, testReachedConversions) {
+TYPED_TEST(AggregatorTest, testReachedConversions) {
   auto reachedConversions =
-      publisherAggregator_->getMetrics().reachedConversions;
+      this->publisherAggregator_->getMetrics().reachedConversions;
   EXPECT_EQ(reachedConversions, 4);
-  auto cohort = publisherAggregator_->getCohortMetrics();
+  auto cohort = this->publisherAggregator_->getCohortMetrics();
   EXPECT_EQ(cohort[0].reachedConversions, 1);
   EXPECT_EQ(cohort[1].reachedConversions, 0);
   EXPECT_EQ(cohort[2].reachedConversions, 3);
-  auto breakdown = publisherAggregator_->getBreakdownMetrics();
+  auto breakdown = this->publisherAggregator_->getBreakdownMetrics();
   EXPECT_EQ(breakdown[0].reachedConversions, 1);
   EXPECT_EQ(breakdown[1].reachedConversions, 3);
 }
 
-TEST_F(AggregatorTest, testValues) {
-  auto test = publisherAggregator_->getMetrics().testValue;
-  auto control = publisherAggregator_->getMetrics().controlValue;
+TYPED_TEST(AggregatorTest, testValues) {
+  auto test = this->publisherAggregator_->getMetrics().testValue;
+  auto control = this->publisherAggregator_->getMetrics().controlValue;
   EXPECT_EQ(test, 120);
   EXPECT_EQ(control, 20);
-  auto cohort = publisherAggregator_->getCohortMetrics();
+  auto cohort = this->publisherAggregator_->getCohortMetrics();
   EXPECT_EQ(cohort[0].testValue, 40);
   EXPECT_EQ(cohort[1].testValue, 50);
   EXPECT_EQ(cohort[2].testValue, 30);
   EXPECT_EQ(cohort[0].controlValue, 40);
   EXPECT_EQ(cohort[1].controlValue, 30);
   EXPECT_EQ(cohort[2].controlValue, -50);
-  auto breakdown = publisherAggregator_->getBreakdownMetrics();
+  auto breakdown = this->publisherAggregator_->getBreakdownMetrics();
   EXPECT_EQ(breakdown[0].testValue, 30);
   EXPECT_EQ(breakdown[1].testValue, 90);
   EXPECT_EQ(breakdown[0].controlValue, 70);
   EXPECT_EQ(breakdown[1].controlValue, -50);
 }
 
-TEST_F(AggregatorTest, testReachedValues) {
-  auto test = publisherAggregator_->getMetrics().reachedValue;
+TYPED_TEST(AggregatorTest, testReachedValues) {
+  auto test = this->publisherAggregator_->getMetrics().reachedValue;
   EXPECT_EQ(test, 100);
-  auto cohort = publisherAggregator_->getCohortMetrics();
+  auto cohort = this->publisherAggregator_->getCohortMetrics();
   EXPECT_EQ(cohort[0].reachedValue, 20);
   EXPECT_EQ(cohort[1].reachedValue, 0);
   EXPECT_EQ(cohort[2].reachedValue, 80);
-  auto breakdown = publisherAggregator_->getBreakdownMetrics();
+  auto breakdown = this->publisherAggregator_->getBreakdownMetrics();
   EXPECT_EQ(breakdown[0].reachedValue, 50);
   EXPECT_EQ(breakdown[1].reachedValue, 50);
 }
 
-TEST_F(AggregatorTest, testValueSquared) {
-  auto test = publisherAggregator_->getMetrics().testValueSquared;
-  auto control = publisherAggregator_->getMetrics().controlValueSquared;
+TYPED_TEST(AggregatorTest, testValueSquared) {
+  auto test = this->publisherAggregator_->getMetrics().testValueSquared;
+  auto control = this->publisherAggregator_->getMetrics().controlValueSquared;
   EXPECT_EQ(test, 8000);
   EXPECT_EQ(control, 4200);
-  auto cohort = publisherAggregator_->getCohortMetrics();
+  auto cohort = this->publisherAggregator_->getCohortMetrics();
   EXPECT_EQ(cohort[0].testValueSquared, 800);
   EXPECT_EQ(cohort[1].testValueSquared, 1300);
   EXPECT_EQ(cohort[2].testValueSquared, 5900);
   EXPECT_EQ(cohort[0].controlValueSquared, 800);
   EXPECT_EQ(cohort[1].controlValueSquared, 900);
   EXPECT_EQ(cohort[2].controlValueSquared, 2500);
-  auto breakdown = publisherAggregator_->getBreakdownMetrics();
+  auto breakdown = this->publisherAggregator_->getBreakdownMetrics();
   EXPECT_EQ(breakdown[0].testValueSquared, 5900);
   EXPECT_EQ(breakdown[1].testValueSquared, 2100);
   EXPECT_EQ(breakdown[0].controlValueSquared, 1700);
@@ -23,6 +23,7 @@ Attributor<schedulerId> createAttributorWithScheduler(
     int myRole,
     InputData inputData,
     int numConversionsPerUser,
+    bool useRelativeTimestamps,
     std::reference_wrapper<
         fbpcf::engine::communication::IPartyCommunicationAgentFactory> factory,
     std::reference_wrapper<fbpcf::scheduler::ISchedulerFactory<unsafe>>
@@ -31,7 +32,7 @@ Attributor<schedulerId> createAttributorWithScheduler(
   fbpcf::scheduler::SchedulerKeeper<schedulerId>::setScheduler(
       std::move(scheduler));
   auto inputProcessor = std::make_unique<InputProcessor<schedulerId>>(
-      myRole, inputData, numConversionsPerUser);
+      myRole, inputData, numConversionsPerUser, useRelativeTimestamps);
   return Attributor<schedulerId>(myRole, std::move(inputProcessor));
 }
 
@@ -41,6 +42,10 @@ class AttributorTest : public ::testing::Test {
   std::unique_ptr<Attributor<1>> partnerAttributor_;
 
   void SetUp() override {
+    createAttributors(false);
+  }
+
+  void createAttributors(bool useRelativeTimestamps) {
     std::string publisherInputFilename =
         sample_input::getPublisherInput3().native();
     std::string partnerInputFilename =
@@ -77,6 +82,7 @@ class AttributorTest : public ::testing::Test {
         0,
         publisherInputData,
         numConversionsPerUser,
+        useRelativeTimestamps,
         std::reference_wrapper<
             fbpcf::engine::communication::IPartyCommunicationAgentFactory>(
             *factories[0]),
@@ -88,6 +94,7 @@ class AttributorTest : public ::testing::Test {
         1,
         partnerInputData,
         numConversionsPerUser,
+        useRelativeTimestamps,
         std::reference_wrapper<
             fbpcf::engine::communication::IPartyCommunicationAgentFactory>(
             *factories[1]),
@@ -122,6 +129,20 @@ TEST_F(AttributorTest, testEvents) {
   EXPECT_EQ(events0, expectEvents);
 }
 
+TEST_F(AttributorTest, testEventsWithRelativeTimestamps) {
+  createAttributors(true);
+  auto future0 = std::async(revealEvents<0>, std::move(publisherAttributor_));
+  auto future1 = std::async(revealEvents<1>, std::move(partnerAttributor_));
+  auto events0 = future0.get();
+  auto events1 = future1.get();
+  std::vector<std::vector<bool>> expectEvents = {
+      {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0,
+       0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0},
+      {0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 1, 1, 0, 1,
+       1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 0, 0, 1, 1}};
+  EXPECT_EQ(events0, expectEvents);
+}
+
 TEST_F(AttributorTest, testConverters) {
   auto future0 = std::async([&] {
     return publisherAttributor_->getConverters().openToParty(0).getValue();
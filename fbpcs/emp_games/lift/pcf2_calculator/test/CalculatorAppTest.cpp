@@ -45,6 +45,7 @@ void runCalculatorApp(
     const std::string& inputExpandedKeyPath,
     const std::string& outputPath,
     bool useXorEncryption,
+    bool useFusedCompaction,
     std::unique_ptr<
         fbpcf::engine::communication::IPartyCommunicationAgentFactory>
         communicationAgentFactory) {
@@ -66,7 +67,12 @@ void runCalculatorApp(
       metricCollector,
       0,
       1,
-      useXorEncryption);
+      useXorEncryption,
+      false, /* useBinarySecretShares */
+      1, /* numParseThreads */
+      nullptr, /* shardQueue */
+      false, /* useShardCache */
+      useFusedCompaction);
   app->run();
 }
 
@@ -219,7 +225,8 @@ class CalculatorAppTestFixture
       const int numConversionsPerUser,
       const bool computePublisherBreakdowns,
       bool useTls,
-      bool useXorEncryption) {
+      bool useXorEncryption,
+      bool useFusedCompaction = false) {
     fbpcf::engine::communication::SocketPartyCommunicationAgent::TlsInfo
         tlsInfo;
     tlsInfo.certPath = useTls ? (tlsDir_ + "/cert.pem") : "";
@@ -242,6 +249,7 @@ class CalculatorAppTestFixture
         "", // inputExpandedKeyPath
         publisherOutputPath,
         useXorEncryption,
+        useFusedCompaction,
         std::move(communicationAgentFactoryAlice));
 
     auto future1 = std::async(
@@ -255,6 +263,7 @@ class CalculatorAppTestFixture
         "", // inputExpandedKeyPath
         partnerOutputPath,
         useXorEncryption,
+        useFusedCompaction,
         std::move(communicationAgentFactoryBob));
 
     future0.get();
@@ -356,6 +365,39 @@ TEST_P(CalculatorAppTestFixture, TestCorrectness) {
   EXPECT_EQ(expectedResult, result);
 }
 
+TEST_P(CalculatorAppTestFixture, TestCorrectnessWithFusedCompaction) {
+  int numConversionsPerUser = 2;
+  std::string publisherInputPath = sample_input::getPublisherInput3().native();
+  std::string partnerInputPath = sample_input::getPartnerInput2().native();
+  std::string expectedOutputPath =
+      sample_input::getCorrectnessOutput().native();
+
+  bool useTls = std::get<0>(GetParam());
+  bool useXorEncryption = std::get<1>(GetParam());
+  bool computePublisherBreakdowns = std::get<2>(GetParam());
+
+  // the plaintext inputs are compacted by the calculator itself
+  GroupedLiftMetrics result = runTest(
+      publisherInputPath,
+      partnerInputPath,
+      "",
+      publisherOutputPath_,
+      partnerOutputPath_,
+      numConversionsPerUser,
+      computePublisherBreakdowns,
+      useTls,
+      useXorEncryption,
+      true /* useFusedCompaction */);
+
+  auto expectedResult = GroupedLiftMetrics::fromJson(
+      fbpcf::io::FileIOWrappers::readFile(expectedOutputPath));
+  if (!computePublisherBreakdowns) {
+    expectedResult.publisherBreakdowns.clear();
+  }
+
+  EXPECT_EQ(expectedResult, result);
+}
+
 GroupedLiftMetrics computeCorrectResults(
     const std::string& publisherPlaintextInputPath,
     const std::string& partnerPlaintextInputPath,
@@ -0,0 +1,422 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "fbpcs/emp_games/lift/plaintext_calculator/PlaintextLiftEngine.h"
+
+#include <algorithm>
+#include <charconv>
+#include <future>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#include "fbpcs/emp_games/common/Csv.h"
+#include "fbpcs/emp_games/common/Util.h"
+
+namespace private_lift {
+
+namespace {
+int32_t findColumn(
+    const std::vector<std::string>& header,
+    const std::string& column) {
+  auto found = std::find(header.begin(), header.end(), column);
+  return found == header.end() ? -1
+                               : static_cast<int32_t>(found - header.begin());
+}
+
+// The value of the column at index, or nullopt if the input does not have it
+std::optional<uint64_t> parseColumn(
+    const std::vector<std::string_view>& parts,
+    int32_t index) {
+  if (index < 0) {
+    return std::nullopt;
+  }
+  auto cell = parts.at(index);
+  uint64_t value = 0;
+  auto [end, error] =
+      std::from_chars(cell.data(), cell.data() + cell.size(), value);
+  if (error != std::errc() || end != cell.data() + cell.size()) {
+    throw std::runtime_error(
+        "Failed to parse '" + std::string(cell) + "' to uint64_t");
+  }
+  return value;
+}
+
+uint64_t adjustForEpoch(uint64_t timestamp, uint64_t epoch) {
+  return timestamp > epoch ? timestamp - epoch : 0;
+}
+
+/*
+ * The conversions, their total value and whether any event matched, of the
+ * events of a row. Branch free, so the compiler can vectorize it.
+ */
+template <bool kHasValues>
+void sumEvents(
+    const LiftColumns& columns,
+    std::size_t begin,
+    std::size_t end,
+    uint64_t opportunityTimestamp,
+    uint64_t tsOffset,
+    uint64_t& conversions,
+    uint64_t& valueSum,
+    uint64_t& matched) {
+  for (std::size_t e = begin; e < end; ++e) {
+    auto timestamp = columns.eventTimestamps[e];
+    uint64_t converted = opportunityTimestamp < timestamp + tsOffset;
+    matched |= timestamp > 0;
+    conversions += converted;
+    if constexpr (kHasValues) {
+      valueSum += (0 - converted) & static_cast<uint64_t>(columns.values[e]);
+    }
+  }
+}
+
+LiftMetrics toLiftMetrics(const LiftCounters& counters) {
+  auto get = [&counters](LiftField field) {
+    return static_cast<int64_t>(counters[field]);
+  };
+  return LiftMetrics{
+      get(kTestConversions),
+      get(kControlConversions),
+      get(kTestConverters),
+      get(kControlConverters),
+      get(kTestValue),
+      get(kControlValue),
+      get(kTestValueSquared),
+      get(kControlValueSquared),
+      get(kTestNumConvSquared),
+      get(kControlNumConvSquared),
+      get(kTestMatchCount),
+      get(kControlMatchCount),
+      get(kReachedConversions),
+      get(kReachedValue),
+      {},
+      {}};
+}
+
+// Lines of both inputs, reused across batches
+struct LineBatch {
+  std::vector<std::string> publisherLines;
+  std::vector<std::string> partnerLines;
+  std::size_t numRows = 0;
+};
+
+LineBatch readBatch(
+    std::istream& publisherInput,
+    std::istream& partnerInput,
+    std::size_t batchRows,
+    LineBatch batch) {
+  batch.publisherLines.resize(batchRows);
+  batch.partnerLines.resize(batchRows);
+  batch.numRows = 0;
+  while (batch.numRows < batchRows &&
+         std::getline(publisherInput, batch.publisherLines[batch.numRows]) &&
+         std::getline(partnerInput, batch.partnerLines[batch.numRows])) {
+    ++batch.numRows;
+  }
+  return batch;
+}
+} // namespace
+
+void LiftColumns::clear() {
+  opportunityTimestamps.clear();
+  testFlags.clear();
+  reached.clear();
+  cohortIds.clear();
+  breakdownIds.clear();
+  eventOffsets.assign(1, 0);
+  eventTimestamps.clear();
+  values.clear();
+}
+
+LiftColumnIndexes LiftColumnIndexes::fromHeaders(
+    const std::vector<std::string>& publisherHeader,
+    const std::vector<std::string>& partnerHeader) {
+  LiftColumnIndexes indexes;
+  indexes.opportunity = findColumn(publisherHeader, "opportunity");
+  indexes.testFlag = findColumn(publisherHeader, "test_flag");
+  indexes.opportunityTimestamp =
+      findColumn(publisherHeader, "opportunity_timestamp");
+  indexes.numImpressions = findColumn(publisherHeader, "num_impressions");
+  indexes.breakdownId = findColumn(publisherHeader, "breakdown_id");
+  indexes.eventTimestamps = findColumn(partnerHeader, "event_timestamps");
+  indexes.values = findColumn(partnerHeader, "values");
+  indexes.cohortId = findColumn(partnerHeader, "cohort_id");
+  if (indexes.eventTimestamps < 0) {
+    throw std::runtime_error("The partner input has no event_timestamps");
+  }
+  return indexes;
+}
+
+PlaintextLiftEngine::PlaintextLiftEngine(
+    uint64_t numCohorts,
+    uint64_t numPublisherBreakdowns,
+    uint64_t epoch,
+    int32_t tsOffset,
+    std::size_t numThreads)
+    : numCohorts_{numCohorts},
+      numPublisherBreakdowns_{numPublisherBreakdowns},
+      epoch_{epoch},
+      tsOffset_{tsOffset},
+      numThreads_{std::max<std::size_t>(numThreads, 1)} {}
+
+void PlaintextLiftEngine::parseRow(
+    std::string& publisherLine,
+    std::string& partnerLine,
+    const LiftColumnIndexes& indexes,
+    LiftColumns& columns) const {
+  thread_local std::vector<std::string_view> publisherParts;
+  thread_local std::vector<std::string_view> partnerParts;
+
+  private_measurement::csv::splitByCommaInPlace(
+      publisherLine, true, publisherParts);
+  if (publisherParts.empty()) {
+    throw std::runtime_error("Empty publisher line");
+  }
+  auto opportunity =
+      parseColumn(publisherParts, indexes.opportunity).value_or(1);
+  auto testFlag = parseColumn(publisherParts, indexes.testFlag).value_or(0);
+  auto opportunityTimestamp = adjustForEpoch(
+      parseColumn(publisherParts, indexes.opportunityTimestamp).value_or(0),
+      epoch_);
+  auto numImpressions =
+      parseColumn(publisherParts, indexes.numImpressions).value_or(0);
+  auto breakdownId =
+      parseColumn(publisherParts, indexes.breakdownId).value_or(0);
+  if (numPublisherBreakdowns_ > 0 && breakdownId >= numPublisherBreakdowns_) {
+    throw std::runtime_error(
+        "breakdown_id " + std::to_string(breakdownId) +
+        " has to be less than the number of publisher breakdowns");
+  }
+
+  private_measurement::csv::splitByCommaInPlace(
+      partnerLine, true, partnerParts);
+  if (partnerParts.empty()) {
+    throw std::runtime_error("Empty partner line");
+  }
+  auto firstEvent = columns.eventTimestamps.size();
+  common::appendInnerArray(
+      partnerParts.at(indexes.eventTimestamps), columns.eventTimestamps);
+  for (auto e = firstEvent; e < columns.eventTimestamps.size(); ++e) {
+    columns.eventTimestamps[e] =
+        adjustForEpoch(columns.eventTimestamps[e], epoch_);
+  }
+  if (indexes.values >= 0) {
+    common::appendInnerArray(partnerParts.at(indexes.values), columns.values);
+    if (columns.values.size() != columns.eventTimestamps.size()) {
+      throw std::runtime_error(
+          "Size of event_timestamps (" +
+          std::to_string(columns.eventTimestamps.size() - firstEvent) +
+          ") and values (" +
+          std::to_string(columns.values.size() - firstEvent) +
+          ") are inconsistent");
+    }
+  }
+  auto cohortId = parseColumn(partnerParts, indexes.cohortId).value_or(0);
+  if (numCohorts_ > 0 && cohortId >= numCohorts_) {
+    throw std::runtime_error(
+        "cohort_id " + std::to_string(cohortId) +
+        " has to be less than the number of cohorts");
+  }
+
+  // Rows without an opportunity are skipped like rows without a timestamp
+  columns.opportunityTimestamps.push_back(
+      opportunity != 0 ? opportunityTimestamp : 0);
+  columns.testFlags.push_back(testFlag != 0);
+  columns.reached.push_back(numImpressions > 0);
+  columns.cohortIds.push_back(static_cast<uint32_t>(cohortId));
+  columns.breakdownIds.push_back(static_cast<uint32_t>(breakdownId));
+  columns.eventOffsets.push_back(columns.eventTimestamps.size());
+}
+
+std::vector<LiftCounters> PlaintextLiftEngine::makeGroups() const {
+  return std::vector<LiftCounters>(
+      1 + numCohorts_ + numPublisherBreakdowns_, LiftCounters{});
+}
+
+void PlaintextLiftEngine::addRows(
+    const LiftColumns& columns,
+    std::vector<LiftCounters>& groups) const {
+  const bool hasValues = !columns.values.empty();
+  const auto tsOffset = static_cast<uint64_t>(tsOffset_);
+
+  auto addRow = [](LiftCounters& group,
+                   std::size_t side,
+                   uint64_t conversions,
+                   uint64_t valueSum,
+                   uint64_t matched,
+                   uint64_t reached) {
+    // side is 0 for the test group and 1 for the control group, whose
+    // fields follow those of the test group
+    group[kTestConversions + side] += conversions;
+    group[kTestConverters + side] += conversions > 0;
+    group[kTestValue + side] += valueSum;
+    group[kTestValueSquared + side] += valueSum * valueSum;
+    group[kTestNumConvSquared + side] += conversions * conversions;
+    group[kTestMatchCount + side] += matched;
+    group[kReachedConversions] += reached * conversions;
+    group[kReachedValue] += reached * valueSum;
+  };
+
+  for (std::size_t i = 0; i < columns.size(); ++i) {
+    auto opportunityTimestamp = columns.opportunityTimestamps[i];
+    if (opportunityTimestamp == 0) {
+      continue;
+    }
+    uint64_t conversions = 0;
+    uint64_t valueSum = 0;
+    uint64_t matched = 0;
+    auto begin = columns.eventOffsets[i];
+    auto end = columns.eventOffsets[i + 1];
+    if (hasValues) {
+      sumEvents<true>(
+          columns,
+          begin,
+          end,
+          opportunityTimestamp,
+          tsOffset,
+          conversions,
+          valueSum,
+          matched);
+    } else {
+      sumEvents<false>(
+          columns,
+          begin,
+          end,
+          opportunityTimestamp,
+          tsOffset,
+          conversions,
+          valueSum,
+          matched);
+    }
+
+    std::size_t side = columns.testFlags[i] ? 0 : 1;
+    // Only the test group has reach
+    uint64_t reached = columns.testFlags[i] & columns.reached[i];
+    addRow(groups[0], side, conversions, valueSum, matched, reached);
+    if (numCohorts_ > 0) {
+      addRow(
+          groups[1 + columns.cohortIds[i]],
+          side,
+          conversions,
+          valueSum,
+          matched,
+          reached);
+    }
+    if (numPublisherBreakdowns_ > 0) {
+      addRow(
+          groups[1 + numCohorts_ + columns.breakdownIds[i]],
+          side,
+          conversions,
+          valueSum,
+          matched,
+          reached);
+    }
+  }
+}
+
+GroupedLiftMetrics PlaintextLiftEngine::toGroupedLiftMetrics(
+    const std::vector<LiftCounters>& groups) const {
+  GroupedLiftMetrics metrics{numCohorts_, numPublisherBreakdowns_};
+  metrics.metrics = toLiftMetrics(groups.at(0));
+  for (uint64_t i = 0; i < numCohorts_; ++i) {
+    metrics.cohortMetrics.at(i) = toLiftMetrics(groups.at(1 + i));
+  }
+  for (uint64_t i = 0; i < numPublisherBreakdowns_; ++i) {
+    metrics.publisherBreakdowns.at(i) =
+        toLiftMetrics(groups.at(1 + numCohorts_ + i));
+  }
+  return metrics;
+}
+
+GroupedLiftMetrics PlaintextLiftEngine::compute(
+    std::istream& publisherInput,
+    std::istream& partnerInput,
+    std::size_t batchRows) const {
+  std::string publisherHeaderLine;
+  std::string partnerHeaderLine;
+  if (!std::getline(publisherInput, publisherHeaderLine) ||
+      !std::getline(partnerInput, partnerHeaderLine)) {
+    throw std::runtime_error("The inputs must start with their headers");
+  }
+  auto indexes = LiftColumnIndexes::fromHeaders(
+      private_measurement::csv::splitByComma(publisherHeaderLine, false),
+      private_measurement::csv::splitByComma(partnerHeaderLine, false));
+
+  batchRows = std::max<std::size_t>(batchRows, 1);
+  std::vector<LiftColumns> threadColumns(numThreads_);
+  std::vector<std::vector<LiftCounters>> threadGroups(
+      numThreads_, makeGroups());
+
+  auto current = readBatch(publisherInput, partnerInput, batchRows, {});
+  LineBatch spare;
+  while (current.numRows > 0) {
+    // Read the next batch while this one is computed on
+    std::future<LineBatch> next;
+    bool hasNext = current.numRows == batchRows;
+    if (hasNext) {
+      next = std::async(
+          std::launch::async,
+          [&, batch = std::move(spare)]() mutable {
+            return readBatch(
+                publisherInput, partnerInput, batchRows, std::move(batch));
+          });
+    }
+
+    auto rowsPerThread = (current.numRows + numThreads_ - 1) / numThreads_;
+    std::vector<std::future<void>> workers;
+    for (std::size_t t = 0; t < numThreads_; ++t) {
+      auto begin = std::min(t * rowsPerThread, current.numRows);
+      auto end = std::min(begin + rowsPerThread, current.numRows);
+      if (begin == end) {
+        break;
+      }
+      workers.push_back(std::async(std::launch::async, [&, t, begin, end]() {
+        auto& columns = threadColumns[t];
+        columns.clear();
+        for (auto i = begin; i < end; ++i) {
+          parseRow(
+              current.publisherLines[i],
+              current.partnerLines[i],
+              indexes,
+              columns);
+        }
+        addRows(columns, threadGroups[t]);
+      }));
+    }
+    for (auto& worker : workers) {
+      worker.wait();
+    }
+    // Wait for the reader before rethrowing, as it reads into this frame
+    LineBatch nextBatch;
+    if (hasNext) {
+      nextBatch = next.get();
+    }
+    for (auto& worker : workers) {
+      worker.get();
+    }
+    if (!hasNext) {
+      break;
+    }
+    spare = std::move(current);
+    current = std::move(nextBatch);
+  }
+
+  // Reduce the counters of every thread per group
+  auto groups = makeGroups();
+  for (const auto& threadGroup : threadGroups) {
+    for (std::size_t g = 0; g < groups.size(); ++g) {
+      for (std::size_t field = 0; field < kNumLiftFields; ++field) {
+        groups[g][field] += threadGroup[g][field];
+      }
+    }
+  }
+  return toGroupedLiftMetrics(groups);
+}
+
+} // namespace private_lift
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "fbpcs/emp_games/lift/common/GroupedLiftMetrics.h"
+
+namespace private_lift {
+
+inline constexpr std::size_t kDefaultPlaintextBatchRows = 1 << 16;
+
+// The metrics a row adds to its groups, in the order of LiftMetrics
+enum LiftField : std::size_t {
+  kTestConversions,
+  kControlConversions,
+  kTestConverters,
+  kControlConverters,
+  kTestValue,
+  kControlValue,
+  kTestValueSquared,
+  kControlValueSquared,
+  kTestNumConvSquared,
+  kControlNumConvSquared,
+  kTestMatchCount,
+  kControlMatchCount,
+  kReachedConversions,
+  kReachedValue,
+  kNumLiftFields
+};
+
+// Unsigned, so sums wrap the same way as those of the MPC game
+using LiftCounters = std::array<uint64_t, kNumLiftFields>;
+
+/*
+ * A batch of rows in columns. The events of row i are those from
+ * eventOffsets[i] to eventOffsets[i + 1]. Timestamps are relative to the
+ * epoch, and rows without an opportunity have an opportunity timestamp of 0,
+ * which the game skips.
+ */
+struct LiftColumns {
+  std::vector<uint64_t> opportunityTimestamps;
+  std::vector<uint8_t> testFlags;
+  std::vector<uint8_t> reached;
+  std::vector<uint32_t> cohortIds;
+  std::vector<uint32_t> breakdownIds;
+  std::vector<std::size_t> eventOffsets{0};
+  std::vector<uint64_t> eventTimestamps;
+  // Empty for inputs without values
+  std::vector<int64_t> values;
+
+  std::size_t size() const {
+    return opportunityTimestamps.size();
+  }
+
+  void clear();
+};
+
+// Where the columns of the game are in the inputs, or -1 if they are not
+struct LiftColumnIndexes {
+  int32_t opportunity = -1;
+  int32_t testFlag = -1;
+  int32_t opportunityTimestamp = -1;
+  int32_t numImpressions = -1;
+  int32_t breakdownId = -1;
+  int32_t eventTimestamps = -1;
+  int32_t values = -1;
+  int32_t cohortId = -1;
+
+  static LiftColumnIndexes fromHeaders(
+      const std::vector<std::string>& publisherHeader,
+      const std::vector<std::string>& partnerHeader);
+};
+
+/*
+ * Computes lift in the clear, for deployments where both inputs are in one
+ * trusted environment. Its results are the same as those of the pcf2 lift
+ * game on the same inputs, but it reads both inputs in batches, parses and
+ * computes each batch in columns over a pool of threads while the next is
+ * read, and reduces the counters of every thread per group at the end.
+ */
+class PlaintextLiftEngine {
+ public:
+  PlaintextLiftEngine(
+      uint64_t numCohorts,
+      uint64_t numPublisherBreakdowns,
+      uint64_t epoch,
+      int32_t tsOffset,
+      std::size_t numThreads);
+
+  /*
+   * Appends the row of a publisher line and the partner line of the same row
+   * to columns. Spaces are removed from the lines in place.
+   */
+  void parseRow(
+      std::string& publisherLine,
+      std::string& partnerLine,
+      const LiftColumnIndexes& indexes,
+      LiftColumns& columns) const;
+
+  // The counters of each group: overall, the cohorts, then the breakdowns
+  std::vector<LiftCounters> makeGroups() const;
+
+  // Adds the metrics of the rows of columns to the counters of their groups
+  void addRows(const LiftColumns& columns, std::vector<LiftCounters>& groups)
+      const;
+
+  GroupedLiftMetrics toGroupedLiftMetrics(
+      const std::vector<LiftCounters>& groups) const;
+
+  /*
+   * Computes the metrics of the rows of both inputs, which start with their
+   * headers, stopping at the end of the shorter one.
+   */
+  GroupedLiftMetrics compute(
+      std::istream& publisherInput,
+      std::istream& partnerInput,
+      std::size_t batchRows = kDefaultPlaintextBatchRows) const;
+
+ private:
+  uint64_t numCohorts_;
+  uint64_t numPublisherBreakdowns_;
+  uint64_t epoch_;
+  int32_t tsOffset_;
+  std::size_t numThreads_;
+};
+
+} // namespace private_lift
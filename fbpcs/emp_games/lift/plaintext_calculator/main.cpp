@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <folly/init/Init.h>
+#include "folly/logging/xlog.h"
+
+#include "fbpcs/emp_games/lift/common/GroupedLiftMetrics.h"
+#include "fbpcs/emp_games/lift/plaintext_calculator/PlaintextLiftEngine.h"
+
+DEFINE_string(
+    input_publisher_path,
+    "sample_input/publisher_0",
+    "Path of the publisher input (should have a header)");
+DEFINE_string(
+    input_partner_path,
+    "sample_input/partner_4_convs_0",
+    "Path of the partner input, row by row with the publisher input (should "
+    "have a header)");
+DEFINE_string(
+    output_path,
+    "out.json",
+    "Path the GroupedLiftMetrics JSON is written to");
+DEFINE_int64(num_cohorts, 0, "Number of partner cohorts");
+DEFINE_int64(num_publisher_breakdowns, 0, "Number of publisher breakdowns");
+DEFINE_int64(
+    epoch,
+    1546300800,
+    "Unixtime of 2019-01-01. Timestamps are relative to it, as in pcf2_lift");
+DEFINE_int32(
+    ts_offset,
+    10,
+    "Seconds a conversion may precede its opportunity and still count");
+DEFINE_int32(
+    num_threads,
+    0,
+    "Threads parsing and computing on the rows. 0 uses every core");
+DEFINE_int64(
+    batch_rows,
+    private_lift::kDefaultPlaintextBatchRows,
+    "Rows read at a time, while the previous ones are computed on");
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  std::ifstream publisherInput{FLAGS_input_publisher_path};
+  if (!publisherInput.is_open()) {
+    XLOG(ERR) << "Failed to open '" << FLAGS_input_publisher_path << "'";
+    return 1;
+  }
+  std::ifstream partnerInput{FLAGS_input_partner_path};
+  if (!partnerInput.is_open()) {
+    XLOG(ERR) << "Failed to open '" << FLAGS_input_partner_path << "'";
+    return 1;
+  }
+
+  auto numThreads = FLAGS_num_threads > 0
+      ? static_cast<std::size_t>(FLAGS_num_threads)
+      : std::thread::hardware_concurrency();
+  private_lift::PlaintextLiftEngine engine{
+      static_cast<uint64_t>(FLAGS_num_cohorts),
+      static_cast<uint64_t>(FLAGS_num_publisher_breakdowns),
+      static_cast<uint64_t>(FLAGS_epoch),
+      FLAGS_ts_offset,
+      numThreads};
+
+  auto start = std::chrono::steady_clock::now();
+  auto metrics = engine.compute(
+      publisherInput, partnerInput, static_cast<std::size_t>(FLAGS_batch_rows));
+  auto elapsed = std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  XLOG(INFO) << "Computed lift on " << numThreads << " threads in " << elapsed
+             << " ms";
+
+  std::ofstream output{FLAGS_output_path};
+  if (!output.is_open()) {
+    XLOG(ERR) << "Failed to open '" << FLAGS_output_path << "'";
+    return 1;
+  }
+  output << metrics.toJson();
+  return 0;
+}
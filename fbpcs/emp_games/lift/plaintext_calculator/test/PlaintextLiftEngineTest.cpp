@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <tuple>
+
+#include "fbpcs/emp_games/common/Csv.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/sample_input/SampleInput.h"
+#include "fbpcs/emp_games/lift/pcf2_calculator/test/common/LiftCalculator.h"
+#include "fbpcs/emp_games/lift/plaintext_calculator/PlaintextLiftEngine.h"
+
+namespace private_lift {
+
+namespace {
+constexpr int32_t kTsOffset = 10;
+
+GroupedLiftMetrics computeReference(
+    const std::string& publisherPath,
+    const std::string& partnerPath,
+    uint64_t numCohorts,
+    uint64_t numPublisherBreakdowns) {
+  LiftCalculator liftCalculator{
+      numCohorts, numPublisherBreakdowns, kDefaultEpochOffset};
+  std::ifstream publisherInput{publisherPath};
+  std::ifstream partnerInput{partnerPath};
+  std::string publisherLine;
+  std::string partnerLine;
+  std::getline(publisherInput, publisherLine);
+  std::getline(partnerInput, partnerLine);
+  auto colNameToIndex = liftCalculator.mapColToIndex(
+      private_measurement::csv::splitByComma(publisherLine, false),
+      private_measurement::csv::splitByComma(partnerLine, false));
+  return liftCalculator.compute(
+      publisherInput, partnerInput, colNameToIndex, kTsOffset);
+}
+} // namespace
+
+class PlaintextLiftEngineTest
+    : public ::testing::TestWithParam<std::tuple<std::size_t, std::size_t>> {
+};
+
+TEST_P(PlaintextLiftEngineTest, TestMatchesReferenceCalculator) {
+  auto [numThreads, batchRows] = GetParam();
+  auto publisherPath = sample_input::getPublisherInput3().native();
+  auto partnerPath = sample_input::getPartnerInput2().native();
+  auto expected = computeReference(
+      publisherPath, partnerPath, kNumDefaultCohorts, kNumPublisherBreakdown);
+
+  PlaintextLiftEngine engine{
+      kNumDefaultCohorts,
+      kNumPublisherBreakdown,
+      kDefaultEpochOffset,
+      kTsOffset,
+      numThreads};
+  std::ifstream publisherInput{publisherPath};
+  std::ifstream partnerInput{partnerPath};
+  auto actual = engine.compute(publisherInput, partnerInput, batchRows);
+
+  EXPECT_EQ(expected, actual);
+  EXPECT_EQ(expected.toJson(), actual.toJson());
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    PlaintextLiftEngineTestSuite,
+    PlaintextLiftEngineTest,
+    ::testing::Combine(
+        ::testing::Values(1, 3, 8),
+        ::testing::Values(1, 7, kDefaultPlaintextBatchRows)));
+
+TEST(PlaintextLiftEngineTest, TestWithoutGroups) {
+  auto publisherPath = sample_input::getPublisherInput1().native();
+  auto partnerPath = sample_input::getPartnerInput4().native();
+  auto expected = computeReference(publisherPath, partnerPath, 0, 0);
+
+  PlaintextLiftEngine engine{0, 0, kDefaultEpochOffset, kTsOffset, 2};
+  std::ifstream publisherInput{publisherPath};
+  std::ifstream partnerInput{partnerPath};
+  EXPECT_EQ(expected, engine.compute(publisherInput, partnerInput));
+}
+
+TEST(PlaintextLiftEngineTest, TestRejectsCohortsOutOfRange) {
+  std::istringstream publisherInput{
+      "id_,opportunity,test_flag,opportunity_timestamp\n"
+      "0,1,1,1600000000\n"};
+  std::istringstream partnerInput{
+      "id_,event_timestamps,values,cohort_id\n"
+      "0,[1600000100],[10],4\n"};
+  PlaintextLiftEngine engine{4, 0, kDefaultEpochOffset, kTsOffset, 1};
+  EXPECT_THROW(
+      engine.compute(publisherInput, partnerInput), std::runtime_error);
+}
+
+} // namespace private_lift
@@ -11,9 +11,17 @@
 #include <fbpcf/scheduler/LazySchedulerFactory.h>
 #include <fbpcf/scheduler/NetworkPlaintextSchedulerFactory.h>
 #include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
+#include "fbpcs/emp_games/common/FilePipeline.h"
+#include "fbpcs/emp_games/common/MetricTreeFormat.h"
+#include "fbpcs/emp_games/common/SchedulerHints.h"
+#include "fbpcs/emp_games/common/SchedulerPhase.h"
 #include "fbpcs/emp_games/common/SchedulerStatistics.h"
+#include "fbpcs/emp_games/common/ShardQueue.h"
+#include "fbpcs/emp_games/common/ShardReport.h"
 #include "fbpcs/emp_games/pcf2_aggregation/AggregationGame.h"
 #include "fbpcs/emp_games/pcf2_aggregation/AggregationOptions.h"
+#include "fbpcs/emp_games/pcf2_aggregation/Constants.h"
 
 namespace pcf2_aggregation {
 
@@ -33,7 +41,9 @@ class AggregationApp {
       std::shared_ptr<fbpcf::util::MetricCollector> metricCollector,
       std::int32_t startFileIndex = 0,
       std::int32_t numFiles = 1,
-      int concurrency = 1)
+      int concurrency = 1,
+      std::shared_ptr<common::ShardQueue> shardQueue = nullptr,
+      bool combineAttributionRules = false)
       : inputEncryption_(inputEncryption),
         outputVisibility_(outputVisibility),
         communicationAgentFactory_(std::move(communicationAgentFactory)),
@@ -45,6 +55,8 @@ class AggregationApp {
         startFileIndex_(startFileIndex),
         numFiles_(numFiles),
         concurrency_(concurrency),
+        shardQueue_(std::move(shardQueue)),
+        combineAttributionRules_(combineAttributionRules),
         schedulerStatistics_{0, 0, 0, 0} {}
 
   void run() {
@@ -52,33 +64,73 @@ class AggregationApp {
         ? fbpcf::scheduler::NetworkPlaintextSchedulerFactory<false>(
               MY_ROLE, *communicationAgentFactory_, metricCollector_)
               .create()
-        : fbpcf::scheduler::getLazySchedulerFactoryWithRealEngine(
-              MY_ROLE, *communicationAgentFactory_, metricCollector_)
-              ->create();
+        : common::createRealScheduler(
+              common::getSchedulerHints(kSchedulerHints),
+              MY_ROLE,
+              *communicationAgentFactory_,
+              metricCollector_);
+
+    // The agent agreeing on the files with the other party is created before
+    // the game takes the communication agent factory
+    auto files = shardQueue_ == nullptr
+        ? common::ShardAssignment(startFileIndex_, numFiles_)
+        : common::ShardAssignment(
+              MY_ROLE, shardQueue_, *communicationAgentFactory_);
 
     AggregationGame<schedulerId> game(
         std::move(scheduler),
         std::move(communicationAgentFactory_),
         inputEncryption_,
-        concurrency_);
-
-    // Compute aggregations sequentially on numFiles files, starting from
-    // startFileIndex
-    for (size_t i = startFileIndex_; i < startFileIndex_ + numFiles_; ++i) {
-      CHECK_LT(i, inputSecretShareFilePaths_.size())
-          << "File index exceeds number of files.";
-      auto inputData = getInputData(
-          inputEncryption_,
-          inputSecretShareFilePaths_.at(i),
-          inputClearTextFilePaths_.at(i));
-      AggregationOutputMetrics output;
-      if (FLAGS_use_new_output_format) {
-        output = game.computeAggregationsReformatted(MY_ROLE, inputData);
-      } else {
-        output = game.computeAggregations(MY_ROLE, inputData);
-      }
-      putOutputData(output, outputFilePaths_.at(i));
-    }
+        concurrency_,
+        combineAttributionRules_);
+
+    // Compute aggregations sequentially on the files taken from shardQueue_ if
+    // there is one, otherwise on numFiles files starting from startFileIndex
+    // The input of the next file is parsed and the output of the previous one
+    // written while the game runs on a file
+    common::ShardReporter reporter;
+    common::runFilesPipelined<
+        AggregationInputMetrics,
+        AggregationOutputMetrics>(
+        files,
+        [this, &reporter](std::size_t i) {
+          CHECK_LT(i, inputSecretShareFilePaths_.size())
+              << "File index exceeds number of files.";
+          fbpcs::performance_tools::ScopedPhase phase{"input_parsing"};
+          common::ShardReporter::Phase shardPhase{reporter, i, "input_parsing"};
+          reporter.setInputPaths(
+              i,
+              {inputSecretShareFilePaths_.at(i),
+               inputClearTextFilePaths_.at(i)});
+          auto inputData = getInputData(
+              inputEncryption_,
+              inputSecretShareFilePaths_.at(i),
+              inputClearTextFilePaths_.at(i));
+          reporter.setNumRows(i, inputData.getIds().size());
+          return inputData;
+        },
+        [&game, &reporter](std::size_t i, AggregationInputMetrics inputData) {
+          fbpcs::performance_tools::ScopedPhase phase{
+              "aggregation", common::getSchedulerCounterReader<schedulerId>()};
+          common::ShardReporter::Phase shardPhase{
+              reporter,
+              i,
+              "aggregation",
+              common::getSchedulerCounterReader<schedulerId>()};
+          if (FLAGS_use_new_output_format) {
+            return game.computeAggregationsReformatted(MY_ROLE, inputData);
+          }
+          return game.computeAggregations(MY_ROLE, inputData);
+        },
+        [this, &reporter](std::size_t i, AggregationOutputMetrics output) {
+          {
+            fbpcs::performance_tools::ScopedPhase phase{"output_writing"};
+            common::ShardReporter::Phase shardPhase{
+                reporter, i, "output_writing"};
+            putOutputData(output, outputFilePaths_.at(i));
+          }
+          reporter.finish(i, outputFilePaths_.at(i));
+        });
 
     auto gateStatistics =
         fbpcf::scheduler::SchedulerKeeper<schedulerId>::getGateStatistics();
@@ -129,7 +181,14 @@ class AggregationApp {
   void putOutputData(
       const AggregationOutputMetrics& aggregationOutput,
       std::string outputPath) {
-    fbpcf::io::FileIOWrappers::writeFile(
+    if (FLAGS_use_binary_metrics_output) {
+      private_measurement::compressed_io::writeFile(
+          outputPath,
+          private_measurement::metric_tree::encode(
+              aggregationOutput.toDynamic()));
+      return;
+    }
+    private_measurement::compressed_io::writeFile(
         outputPath, aggregationOutput.toJson());
   }
 
@@ -148,6 +207,8 @@ class AggregationApp {
   const std::int32_t startFileIndex_;
   const std::int32_t numFiles_;
   const int concurrency_;
+  std::shared_ptr<common::ShardQueue> shardQueue_;
+  const bool combineAttributionRules_;
   common::SchedulerStatistics schedulerStatistics_;
 };
 
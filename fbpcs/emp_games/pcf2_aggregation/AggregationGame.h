@@ -33,11 +33,13 @@ class AggregationGame : public fbpcf::frontend::MpcGame<schedulerId> {
           fbpcf::engine::communication::IPartyCommunicationAgentFactory>
           communicationAgentFactory,
       common::InputEncryption inputEncryption,
-      const int concurrency = 1)
+      const int concurrency = 1,
+      bool combineAttributionRules = false)
       : fbpcf::frontend::MpcGame<schedulerId>(std::move(scheduler)),
         communicationAgentFactory_(communicationAgentFactory),
         inputEncryption_(inputEncryption),
-        concurrency_(concurrency) {}
+        concurrency_(concurrency),
+        combineAttributionRules_(combineAttributionRules) {}
 
   /**
    * Publisher shares aggregation formats with partner
@@ -102,6 +104,9 @@ class AggregationGame : public fbpcf::frontend::MpcGame<schedulerId> {
       communicationAgentFactory_;
   common::InputEncryption inputEncryption_;
   const int concurrency_;
+  // Whether all the attribution rules of a file are aggregated in one ORAM,
+  // which is revealed once after all of them
+  const bool combineAttributionRules_;
 };
 
 } // namespace pcf2_aggregation
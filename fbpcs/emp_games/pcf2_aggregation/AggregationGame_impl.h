@@ -15,6 +15,8 @@
 #include "fbpcf/mpc_std_lib/oram/ObliviousDeltaCalculatorFactory.h"
 #include "fbpcf/mpc_std_lib/oram/SinglePointArrayGeneratorFactory.h"
 #include "fbpcf/mpc_std_lib/oram/WriteOnlyOramFactory.h"
+#include "fbpcs/emp_games/common/OramSelection.h"
+#include "fbpcs/emp_games/common/SortedIds.h"
 #include "folly/logging/xlog.h"
 
 namespace pcf2_aggregation {
@@ -62,43 +64,48 @@ const std::vector<uint64_t>
 AggregationGame<schedulerId>::retrieveValidOriginalAdIds(
     const int myRole,
     std::vector<std::vector<TouchpointMetadata>>& touchpointMetadataArrays) {
-  std::unordered_set<uint64_t> adIdSet;
+  // The ad ids of every touchpoint are shared as one batch and revealed to
+  // each party with one open, instead of waiting for the network twice per
+  // touchpoint
+  std::vector<uint64_t> adIds;
+  for (const auto& touchpointMetadataArray : touchpointMetadataArrays) {
+    for (const auto& touchpointMetadata : touchpointMetadataArray) {
+      adIds.push_back(touchpointMetadata.originalAdId);
+    }
+  }
+  std::vector<uint64_t> revealedAdIds;
+  if (!adIds.empty()) {
+    SecOriginalAdIdBatch<schedulerId> secAdIds;
+    if (inputEncryption_ == common::InputEncryption::Xor) {
+      secAdIds = SecOriginalAdIdBatch<schedulerId>(
+          typename SecOriginalAdIdBatch<schedulerId>::ExtractedInt(
+              std::move(adIds)));
+    } else {
+      secAdIds = SecOriginalAdIdBatch<schedulerId>(
+          std::move(adIds), common::PUBLISHER);
+    }
+    // Both opens are issued before either value is read, so that they are
+    // computed together
+    auto publisherAdIds = secAdIds.openToParty(common::PUBLISHER);
+    auto partnerAdIds = secAdIds.openToParty(common::PARTNER);
+    revealedAdIds = (myRole == common::PUBLISHER) ? publisherAdIds.getValue()
+                                                  : partnerAdIds.getValue();
+  }
+
+  auto revealedAdId = revealedAdIds.begin();
   for (auto& touchpointMetadataArray : touchpointMetadataArrays) {
     for (auto& touchpointMetadata : touchpointMetadataArray) {
-      // Share ad id
-      SecOriginalAdId<schedulerId> secAdId;
-      if (inputEncryption_ == common::InputEncryption::Xor) {
-        typename SecOriginalAdId<schedulerId>::ExtractedInt extractedAdId(
-            touchpointMetadata.originalAdId);
-        secAdId = SecOriginalAdId<schedulerId>(std::move(extractedAdId));
-      } else {
-        secAdId = SecOriginalAdId<schedulerId>(
-            touchpointMetadata.originalAdId, common::PUBLISHER);
-      }
-
-      // Reveal ad id to publisher and partner
-      auto publisherAdId = secAdId.openToParty(common::PUBLISHER).getValue();
-      auto partnerAdId = secAdId.openToParty(common::PARTNER).getValue();
-      auto revealedAdId =
-          (myRole == common::PUBLISHER) ? publisherAdId : partnerAdId;
-
-      touchpointMetadata.originalAdId = revealedAdId;
-      if (revealedAdId > 0) {
-        adIdSet.insert(revealedAdId);
-      }
+      touchpointMetadata.originalAdId = *revealedAdId++;
     }
   }
+  std::erase(revealedAdIds, 0);
+  auto validOriginalAdIds = common::sortUniqueIds(std::move(revealedAdIds));
 
-  XLOGF(INFO, "Number of Ad Ids: {}", adIdSet.size());
+  XLOGF(INFO, "Number of Ad Ids: {}", validOriginalAdIds.size());
   // Added a check here to make sure that number of ad Ids never exceed 65,536
   // (8 unsigned bit)
-  CHECK_LE(adIdSet.size(), 65536)
+  CHECK_LE(validOriginalAdIds.size(), 65536)
       << "Number of ad Ids cannot be more than 65,536.";
-
-  std::vector<uint64_t> validOriginalAdIds;
-  validOriginalAdIds.insert(
-      validOriginalAdIds.end(), adIdSet.begin(), adIdSet.end());
-  std::sort(validOriginalAdIds.begin(), validOriginalAdIds.end());
   return validOriginalAdIds;
 }
 
@@ -106,19 +113,11 @@ template <int schedulerId>
 void AggregationGame<schedulerId>::replaceAdIdWithCompressedAdId(
     std::vector<std::vector<TouchpointMetadata>>& touchpointMetadataArrays,
     std::vector<uint64_t>& validOriginalAdIds) {
-  uint16_t compressedAdId = 1;
-  std::unordered_map<uint64_t, uint16_t> adIdToCompressedAdIdMap;
-
-  for (auto adId : validOriginalAdIds) {
-    adIdToCompressedAdIdMap.insert({adId, compressedAdId});
-    compressedAdId++;
-  }
-
   for (auto& touchpointMetadataArray : touchpointMetadataArrays) {
     for (auto& touchpointMetadata : touchpointMetadataArray) {
       if (touchpointMetadata.originalAdId > 0) {
-        touchpointMetadata.adId =
-            adIdToCompressedAdIdMap.at(touchpointMetadata.originalAdId);
+        touchpointMetadata.adId = static_cast<uint16_t>(common::compressId(
+            validOriginalAdIds, touchpointMetadata.originalAdId));
       }
     }
   }
@@ -209,27 +208,30 @@ AggregationOutputMetrics AggregationGame<schedulerId>::computeAggregations(
   const int8_t indicatorSumWidth = adIdWidth;
   bool isPublisher = (myRole == common::PUBLISHER);
 
+  const auto& attributionRules = inputData.getAttributionRules();
+  // With the rules combined, every rule is aggregated in its own slots of one
+  // ORAM, which is revealed once after all of them
+  const bool combineRules =
+      combineAttributionRules_ && !attributionRules.empty();
+  const size_t numRules = combineRules ? attributionRules.size() : 1;
+
   PrivateAggregationMetrics<schedulerId> aggregationMetrics{
       aggregationFormats,
-      AggregationContext{validOriginalAdIds},
+      AggregationContext{validOriginalAdIds, numRules},
       myRole,
       concurrency_,
-      // linear ORAM will be less efficient theoretically if ORAM size is
-      // larger than 4. Since ORAM size is adid size + 1, we use 3 as the
-      // threshold here.
-      std::move(
-          validOriginalAdIds.size() > 3
-              ? fbpcf::mpc_std_lib::oram::getSecureWriteOnlyOramFactory<
-                    fbpcf::mpc_std_lib::util::AggregationValue,
-                    indicatorSumWidth,
-                    schedulerId>(isPublisher, 0, 1, *communicationAgentFactory_)
-              : fbpcf::mpc_std_lib::oram::getSecureLinearOramFactory<
-                    fbpcf::mpc_std_lib::util::AggregationValue,
-                    schedulerId>(
-                    isPublisher, 0, 1, *communicationAgentFactory_))};
+      // The ORAM size is the number of ad ids + 1 per rule, and its values
+      // hold the sales and conversion values
+      common::getSecureOramFactory<
+          fbpcf::mpc_std_lib::util::AggregationValue,
+          indicatorSumWidth,
+          schedulerId>(
+          isPublisher,
+          getOramSize(validOriginalAdIds.size(), numRules),
+          salesValueWidth + convValueWidth,
+          *communicationAgentFactory_)};
 
   AggregationOutputMetrics out;
-  const auto& attributionRules = inputData.getAttributionRules();
   const auto& attributionSecretShares = inputData.getAttributionSecretShares();
 
   for (size_t i = 0; i < attributionRules.size(); ++i) {
@@ -250,7 +252,10 @@ AggregationOutputMetrics AggregationGame<schedulerId>::computeAggregations(
             attributionResultsPerRule);
 
     PrivateAggregation<schedulerId> privateAggregation{
-        secretSharePerRule, privateTpmArrays, privateCvmArrays};
+        secretSharePerRule,
+        privateTpmArrays,
+        privateCvmArrays,
+        combineRules ? i : 0};
 
     aggregationMetrics.computeAggregationsPerFormat(privateAggregation);
 
@@ -261,7 +266,16 @@ AggregationOutputMetrics AggregationGame<schedulerId>::computeAggregations(
         aggregationFormats.at(0).name,
         attributionRules.at(i));
 
-    out.ruleToMetrics[attributionRules.at(i)] = aggregationMetrics.reveal();
+    if (!combineRules) {
+      out.ruleToMetrics[attributionRules.at(i)] = aggregationMetrics.reveal();
+    }
+  }
+
+  if (combineRules) {
+    auto ruleMetrics = aggregationMetrics.revealRules();
+    for (size_t i = 0; i < attributionRules.size(); ++i) {
+      out.ruleToMetrics[attributionRules.at(i)] = std::move(ruleMetrics.at(i));
+    }
   }
 
   return out;
@@ -290,27 +304,30 @@ AggregationGame<schedulerId>::computeAggregationsReformatted(
   const int64_t indicatorSumWidth = adIdWidth;
   bool isPublisher = (myRole == common::PUBLISHER);
 
+  const auto& attributionRules = inputData.getAttributionRules();
+  // With the rules combined, every rule is aggregated in its own slots of one
+  // ORAM, which is revealed once after all of them
+  const bool combineRules =
+      combineAttributionRules_ && !attributionRules.empty();
+  const size_t numRules = combineRules ? attributionRules.size() : 1;
+
   PrivateAggregationMetrics<schedulerId> aggregationMetrics{
       aggregationFormats,
-      AggregationContext{validOriginalAdIds},
+      AggregationContext{validOriginalAdIds, numRules},
       myRole,
       concurrency_,
-      // linear ORAM will be less efficient theoretically if ORAM size is
-      // larger than 4. Since ORAM size is adid size + 1, we use 3 as the
-      // threshold here.
-      std::move(
-          validOriginalAdIds.size() > 3
-              ? fbpcf::mpc_std_lib::oram::getSecureWriteOnlyOramFactory<
-                    fbpcf::mpc_std_lib::util::AggregationValue,
-                    indicatorSumWidth,
-                    schedulerId>(isPublisher, 0, 1, *communicationAgentFactory_)
-              : fbpcf::mpc_std_lib::oram::getSecureLinearOramFactory<
-                    fbpcf::mpc_std_lib::util::AggregationValue,
-                    schedulerId>(
-                    isPublisher, 0, 1, *communicationAgentFactory_))};
+      // The ORAM size is the number of ad ids + 1 per rule, and its values
+      // hold the sales and conversion values
+      common::getSecureOramFactory<
+          fbpcf::mpc_std_lib::util::AggregationValue,
+          indicatorSumWidth,
+          schedulerId>(
+          isPublisher,
+          getOramSize(validOriginalAdIds.size(), numRules),
+          salesValueWidth + convValueWidth,
+          *communicationAgentFactory_)};
 
   AggregationOutputMetrics out;
-  const auto& attributionRules = inputData.getAttributionRules();
   const auto& attributionReformattedSecretShares =
       inputData.getAttributionReformattedSecretShares();
 
@@ -334,7 +351,7 @@ AggregationGame<schedulerId>::computeAggregationsReformatted(
             attributionReformattedResultsPerRule);
 
     PrivateAggregationReformatted<schedulerId> privateAggregationReformatted{
-        secretReformattedSharePerRule};
+        secretReformattedSharePerRule, combineRules ? i : 0};
 
     aggregationMetrics.computeAggregationsReformattedPerFormat(
         privateAggregationReformatted);
@@ -346,7 +363,16 @@ AggregationGame<schedulerId>::computeAggregationsReformatted(
         aggregationFormats.at(0).name,
         attributionRules.at(i));
 
-    out.ruleToMetrics[attributionRules.at(i)] = aggregationMetrics.reveal();
+    if (!combineRules) {
+      out.ruleToMetrics[attributionRules.at(i)] = aggregationMetrics.reveal();
+    }
+  }
+
+  if (combineRules) {
+    auto ruleMetrics = aggregationMetrics.revealRules();
+    for (size_t i = 0; i < attributionRules.size(); ++i) {
+      out.ruleToMetrics[attributionRules.at(i)] = std::move(ruleMetrics.at(i));
+    }
   }
   return out;
 }
@@ -23,7 +23,10 @@
 #include "folly/json.h"
 #include "folly/logging/xlog.h"
 
+#include "fbpcs/emp_games/common/AttributionShareFormat.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
 #include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/InputRow.h"
 #include "fbpcs/emp_games/common/Util.h"
 #include "fbpcs/emp_games/pcf2_aggregation/AggregationMetrics.h"
 #include "fbpcs/emp_games/pcf2_aggregation/AggregationOptions.h"
@@ -34,38 +37,68 @@
 
 namespace pcf2_aggregation {
 
+// The columns the touchpoint and conversion metadata are parsed from. The
+// other columns of the metadata input aren't tokenized.
+static const std::vector<std::string> kMetadataColumns = {
+    "ad_ids",
+    "timestamps",
+    "is_click",
+    "campaign_metadata",
+    "conversion_timestamps",
+    "conversion_values",
+    "conversion_metadata"};
+
+// Buffers for parsing a single row. They are reused across rows so that once
+// they have grown, parsing a row doesn't allocate.
+struct MetadataRowBuffers {
+  std::vector<uint64_t> adIds;
+  std::vector<uint64_t> timestamps;
+  std::vector<uint64_t> isClickShares;
+  std::vector<bool> isClicks;
+  std::vector<uint64_t> campaignMetadata;
+  std::vector<uint64_t> convValues;
+  std::vector<uint64_t> convMetadata;
+};
+
+// Row is a common::CsvInputRow or a common::RowGroupInputRow
+template <typename Row>
 static const std::vector<TouchpointMetadata> parseTouchpointMetadata(
     const int myRole,
     common::InputEncryption inputEncryption,
     const int lineNo,
     const std::vector<std::string>& header,
-    const std::vector<std::string>& parts) {
-  std::vector<uint64_t> adIds;
-  std::vector<uint64_t> timestamps;
-  std::vector<bool> isClicks;
-  std::vector<uint64_t> campaignMetadata;
+    const Row& row,
+    MetadataRowBuffers& buffers) {
+  auto& adIds = buffers.adIds;
+  auto& timestamps = buffers.timestamps;
+  auto& isClicks = buffers.isClicks;
+  auto& campaignMetadata = buffers.campaignMetadata;
+  adIds.clear();
+  timestamps.clear();
+  isClicks.clear();
+  campaignMetadata.clear();
 
-  for (size_t i = 0; i < header.size(); ++i) {
-    auto column = header[i];
-    auto value = parts[i];
+  // A csv row ends at the last of kMetadataColumns
+  for (size_t i = 0; i < std::min(header.size(), row.size()); ++i) {
+    const auto& column = header[i];
     if (column == "ad_ids") {
-      adIds = common::getInnerArray<uint64_t>(value);
+      row.appendArray(i, adIds);
     } else if (column == "timestamps") {
-      timestamps = common::getInnerArray<uint64_t>(value);
+      row.appendArray(i, timestamps);
     } else if (column == "is_click") {
       if (inputEncryption == common::InputEncryption::Xor) {
         // input is 64-bit secret shares
-        std::vector<uint64_t> isClickShares =
-            common::getInnerArray<uint64_t>(value);
-        for (auto isClickShare : isClickShares) {
+        buffers.isClickShares.clear();
+        row.appendArray(i, buffers.isClickShares);
+        for (auto isClickShare : buffers.isClickShares) {
           // suffices to read last bit
           isClicks.push_back(isClickShare & 1);
         }
       } else {
-        isClicks = common::getInnerArray<bool>(value);
+        row.appendArray(i, isClicks);
       }
     } else if (column == "campaign_metadata") {
-      campaignMetadata = common::getInnerArray<uint64_t>(value);
+      row.appendArray(i, campaignMetadata);
     }
   }
 
@@ -78,17 +111,8 @@ static const std::vector<TouchpointMetadata> parseTouchpointMetadata(
   CHECK_LE(adIds.size(), FLAGS_max_num_touchpoints)
       << "Number of touchpoints exceeds the maximum allowed value.";
 
-  std::vector<int64_t> unique_ids;
-  for (size_t i = 0; i < timestamps.size(); ++i) {
-    unique_ids.push_back(i);
-  }
-
-  const std::unordered_set<int64_t> idSet{unique_ids.begin(), unique_ids.end()};
-  CHECK_EQ(idSet.size(), timestamps.size())
-      << "Found non-unique id for line " << lineNo << ". "
-      << "This implementation currently only supports unique touchpoint ids per user.";
-
   std::vector<TouchpointMetadata> tpms;
+  tpms.reserve(FLAGS_max_num_touchpoints);
   for (size_t i = 0; i < adIds.size(); ++i) {
     tpms.push_back(TouchpointMetadata{
         /* original adId */ adIds.at(i),
@@ -118,25 +142,30 @@ static const std::vector<TouchpointMetadata> parseTouchpointMetadata(
 // extracting fields for all aggregators - currently measurement and PCM. During
 // the game then, once aggregator formats are shared between both publisher and
 // partner. We will then extract the fields required for only those aggregators.
+template <typename Row>
 static const std::vector<ConversionMetadata> parseConversionMetadata(
     const int myRole,
     common::InputEncryption inputEncryption,
     const std::vector<std::string>& header,
-    const std::vector<std::string>& parts) {
-  std::vector<uint64_t> convTimestamps;
-  std::vector<uint64_t> convValues;
-  std::vector<uint64_t> convMetadata;
+    const Row& row,
+    MetadataRowBuffers& buffers) {
+  auto& convTimestamps = buffers.timestamps;
+  auto& convValues = buffers.convValues;
+  auto& convMetadata = buffers.convMetadata;
+  convTimestamps.clear();
+  convValues.clear();
+  convMetadata.clear();
 
-  for (size_t i = 0; i < header.size(); ++i) {
-    auto column = header[i];
-    auto value = parts[i];
+  // A csv row ends at the last of kMetadataColumns
+  for (size_t i = 0; i < std::min(header.size(), row.size()); ++i) {
+    const auto& column = header[i];
 
     if (column == "conversion_timestamps") {
-      convTimestamps = common::getInnerArray<uint64_t>(value);
+      row.appendArray(i, convTimestamps);
     } else if (column == "conversion_values") {
-      convValues = common::getInnerArray<uint64_t>(value);
+      row.appendArray(i, convValues);
     } else if (column == "conversion_metadata") {
-      convMetadata = common::getInnerArray<uint64_t>(value);
+      row.appendArray(i, convMetadata);
     }
   }
 
@@ -148,6 +177,7 @@ static const std::vector<ConversionMetadata> parseConversionMetadata(
       << "Number of conversions exceeds the maximum allowed value.";
 
   std::vector<ConversionMetadata> convs;
+  convs.reserve(FLAGS_max_num_conversions);
   for (size_t i = 0; i < convTimestamps.size(); ++i) {
     convs.push_back(ConversionMetadata{
         /* ts */ convTimestamps.at(i),
@@ -180,11 +210,49 @@ AggregationInputMetrics::AggregationInputMetrics(
     common::InputEncryption inputEncryption,
     std::filesystem::path inputSecretShareFilePath,
     std::filesystem::path inputClearTextFilePath,
-    std::string aggregationFormatNamesStr) {
+    std::string aggregationFormatNamesStr)
+    : AggregationInputMetrics(
+          myRole,
+          inputEncryption,
+          inputClearTextFilePath,
+          aggregationFormatNamesStr) {
   XLOGF(
       INFO,
-      "Reading attribution result file {}",
+      "Parsing input secret share file {}",
       inputSecretShareFilePath.string());
+  auto attributionResults =
+      private_measurement::compressed_io::readFile(inputSecretShareFilePath);
+  // The attribution game writes the binary shares with
+  // --use_binary_share_output, which are read without parsing JSON
+  if (private_measurement::attribution_shares::hasMagic(attributionResults)) {
+    setAttributionShares(
+        private_measurement::attribution_shares::decode(attributionResults));
+    return;
+  }
+
+  // Reading the attribution results received from private attribution game in
+  // an unordered_map.
+  auto attributionResultJson = folly::parseJson(attributionResults);
+  for (const auto& [rule, formatters] : attributionResultJson.items()) {
+    attributionRules_.push_back(rule.asString());
+  }
+
+  if (FLAGS_use_new_output_format) {
+    attributionReformattedSecretShare_ =
+        AggregationMetrics::getAttributionsReformattedArrayfromDynamic(
+            std::move(attributionResultJson));
+  } else {
+    attributionSecretShare_ =
+        AggregationMetrics::getAttributionsArrayfromDynamic(
+            std::move(attributionResultJson));
+  }
+}
+
+AggregationInputMetrics::AggregationInputMetrics(
+    int myRole,
+    common::InputEncryption inputEncryption,
+    std::filesystem::path inputClearTextFilePath,
+    std::string aggregationFormatNamesStr) {
   XLOGF(
       INFO, "Reading metadata input file {}", inputClearTextFilePath.string());
   XLOGF(
@@ -197,22 +265,46 @@ AggregationInputMetrics::AggregationInputMetrics(
   }
 
   // Parse the input metadata file
+  auto numRows =
+      private_measurement::csv::countCsvRows(inputClearTextFilePath);
+  ids_.reserve(numRows);
+  touchpointMetadataArrays_.reserve(numRows);
+  if (!FLAGS_use_new_output_format) {
+    conversionMetadataArrays_.reserve(numRows);
+  }
+
+  MetadataRowBuffers buffers;
   auto lineNo = 0;
-  auto success = private_measurement::csv::readCsv(
-      inputClearTextFilePath,
-      [&](const std::vector<std::string>& header,
-          const std::vector<std::string>& parts) {
-        ids_.push_back(lineNo);
-
-        touchpointMetadataArrays_.push_back(parseTouchpointMetadata(
-            myRole, inputEncryption, lineNo, header, parts));
-        if (!FLAGS_use_new_output_format) {
-          conversionMetadataArrays_.push_back(
-              parseConversionMetadata(myRole, inputEncryption, header, parts));
-        }
+  auto addRow = [&](const std::vector<std::string>& header, const auto& row) {
+    ids_.push_back(lineNo);
+
+    touchpointMetadataArrays_.push_back(parseTouchpointMetadata(
+        myRole, inputEncryption, lineNo, header, row, buffers));
+    if (!FLAGS_use_new_output_format) {
+      conversionMetadataArrays_.push_back(parseConversionMetadata(
+          myRole, inputEncryption, header, row, buffers));
+    }
 
-        lineNo++;
-      });
+    lineNo++;
+  };
+  // Inputs in the row group format are typed already, so their arrays are
+  // copied rather than formatted back to text and parsed again
+  auto readGroup = [&](const private_measurement::row_group::Schema& schema,
+                       const private_measurement::row_group::RowGroup& group) {
+    auto header = common::getRowGroupHeader(schema);
+    for (size_t row = 0; row < group.numRows; ++row) {
+      addRow(header, common::RowGroupInputRow{schema, group, row});
+    }
+  };
+  auto readLine = [&](const std::vector<std::string>& header,
+                      const std::vector<std::string_view>& parts) {
+    addRow(header, common::CsvInputRow{parts});
+  };
+  auto success =
+      private_measurement::csv::readRowGroups(
+          inputClearTextFilePath, readGroup) ||
+      private_measurement::csv::readCsvViews(
+          inputClearTextFilePath, readLine, [](auto) {}, kMetadataColumns);
 
   if (!success) {
     XLOGF(
@@ -220,27 +312,24 @@ AggregationInputMetrics::AggregationInputMetrics(
         "Failed to read input metadata file {},",
         inputClearTextFilePath.string());
   }
+}
 
-  XLOGF(
-      INFO,
-      "Parsing input secret share file {}",
-      inputSecretShareFilePath.string());
-  // Reading the attribution results received from private attribution game in
-  // an unordered_map.
-  auto attributionResultJson = folly::parseJson(
-      fbpcf::io::FileIOWrappers::readFile(inputSecretShareFilePath));
-  for (const auto& [rule, formatters] : attributionResultJson.items()) {
-    attributionRules_.push_back(rule.asString());
-  }
-
-  if (FLAGS_use_new_output_format) {
-    attributionReformattedSecretShare_ =
-        AggregationMetrics::getAttributionsReformattedArrayfromDynamic(
-            std::move(attributionResultJson));
-  } else {
-    attributionSecretShare_ =
-        AggregationMetrics::getAttributionsArrayfromDynamic(
-            std::move(attributionResultJson));
+void AggregationInputMetrics::setAttributionShares(
+    const std::vector<private_measurement::attribution_shares::RuleShares>&
+        shares) {
+  for (const auto& ruleShares : shares) {
+    CHECK_EQ(ruleShares.reformatted, FLAGS_use_new_output_format)
+        << "Attribution shares of rule " << ruleShares.rule
+        << " don't match the output format.";
+    attributionRules_.push_back(ruleShares.rule);
+    if (FLAGS_use_new_output_format) {
+      attributionReformattedSecretShare_.push_back(
+          AggregationMetrics::getAttributionsReformattedArrayFromShares(
+              ruleShares));
+    } else {
+      attributionSecretShare_.push_back(
+          AggregationMetrics::getAttributionsArrayFromShares(ruleShares));
+    }
   }
 }
 
@@ -7,11 +7,13 @@
 
 #pragma once
 
+#include <algorithm>
 #include <filesystem>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "fbpcs/emp_games/common/AttributionShareFormat.h"
 #include "fbpcs/emp_games/common/Csv.h"
 
 #include "fbpcs/emp_games/pcf2_aggregation/Aggregator.h"
@@ -143,6 +145,33 @@ struct AggregationMetrics {
 
     return attributionReformattedResultsList;
   }
+
+  // The results of one rule read from the binary attribution shares, one
+  // vector of results per user in the order of the user ids
+  static std::vector<std::vector<AttributionResult>>
+  getAttributionsArrayFromShares(
+      const private_measurement::attribution_shares::RuleShares& shares) {
+    std::vector<std::vector<AttributionResult>> attributionResults(
+        shares.numUsers);
+    for (size_t i = 0; i < shares.isAttributed.size(); ++i) {
+      attributionResults[i / shares.resultsPerUser].push_back(
+          AttributionResult{shares.isAttributed[i]});
+    }
+    return attributionResults;
+  }
+
+  static std::vector<std::vector<AttributionReformattedResult>>
+  getAttributionsReformattedArrayFromShares(
+      const private_measurement::attribution_shares::RuleShares& shares) {
+    std::vector<std::vector<AttributionReformattedResult>>
+        attributionReformattedResults(shares.numUsers);
+    for (size_t i = 0; i < shares.isAttributed.size(); ++i) {
+      attributionReformattedResults[i / shares.resultsPerUser].push_back(
+          AttributionReformattedResult{
+              shares.adIds[i], shares.convValues[i], shares.isAttributed[i]});
+    }
+    return attributionReformattedResults;
+  }
 };
 
 struct AggregationOutputMetrics {
@@ -197,6 +226,14 @@ class AggregationInputMetrics {
       std::filesystem::path inputClearTextFilePaths,
       std::string aggregationFormatName);
 
+  // The metadata of inputClearTextFilePath without the attribution shares,
+  // which are set with setAttributionShares
+  explicit AggregationInputMetrics(
+      int myRole,
+      common::InputEncryption inputEncryption,
+      std::filesystem::path inputClearTextFilePath,
+      std::string aggregationFormatName);
+
   explicit AggregationInputMetrics(
       std::vector<int64_t> ids,
       std::vector<std::string> attributionRules,
@@ -246,6 +283,13 @@ class AggregationInputMetrics {
     return aggregationFormats_;
   }
 
+  // Adds the attribution shares of every rule, as the binary shares the
+  // attribution game writes, or makes in memory when both games run in one
+  // process
+  void setAttributionShares(
+      const std::vector<private_measurement::attribution_shares::RuleShares>&
+          shares);
+
  private:
   std::vector<int64_t> ids_;
   std::vector<std::string> attributionRules_;
@@ -300,6 +344,22 @@ class PrivateAggregationMetrics {
     return out;
   }
 
+  // The metrics of each of the rules aggregated together, in the order of
+  // their rule indices
+  std::vector<AggregationMetrics> revealRules() {
+    std::vector<AggregationMetrics> out;
+
+    for (const auto& [format, aggregator] : formatToAggregator) {
+      auto outputs = aggregator->revealRules();
+      out.resize(std::max(out.size(), outputs.size()));
+      for (size_t i = 0; i < outputs.size(); ++i) {
+        out.at(i).formatToAggregation[format] = std::move(outputs.at(i));
+      }
+    }
+
+    return out;
+  }
+
  private:
   std::unordered_map<std::string, std::unique_ptr<Aggregator<schedulerId>>>
       formatToAggregator;
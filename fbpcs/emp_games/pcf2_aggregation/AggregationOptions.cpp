@@ -70,6 +70,11 @@ DEFINE_string(
     ".s3.us-west-2.amazonaws.com/",
     "s3 region name");
 DEFINE_bool(use_new_output_format, false, "New Format of Attribution output");
+DEFINE_bool(
+    use_binary_metrics_output,
+    false,
+    "Write the secret shares of the metrics in the binary metric tree format "
+    "the shard combiners read without parsing JSON, instead of as JSON");
 DEFINE_string(
     run_id,
     "",
@@ -78,6 +83,30 @@ DEFINE_string(
     pc_feature_flags,
     "",
     "A String of PC Feature Flags passing from PCS, separated by comma");
+DEFINE_bool(
+    multiplex_connections,
+    false,
+    "Run the apps of every concurrency lane as streams of one connection on "
+    "port, instead of each app connecting on a port of its own. Both parties "
+    "must set it the same");
+DEFINE_bool(
+    adaptive_concurrency,
+    false,
+    "Start the apps one at a time up to concurrency, while each one raises the "
+    "throughput of the run, instead of starting all of them. Both parties must "
+    "set it the same");
+DEFINE_int32(
+    adaptive_concurrency_interval_s,
+    30,
+    "Seconds the throughput is measured for before starting each app, when "
+    "adaptive_concurrency is set");
+DEFINE_string(
+    network_compression,
+    "none",
+    "Codec compressing the traffic between the parties, for region pairs "
+    "where bandwidth costs more than CPU - options: (none|lz4|zstd). Traffic "
+    "which doesn't compress is sent as it is. Both parties must set it the "
+    "same");
 DEFINE_bool(
     use_tls,
     false,
@@ -94,3 +123,47 @@ DEFINE_string(
     private_key_path,
     "",
     "Relative file path where private key is stored. It will be prefixed with $HOME.");
+DEFINE_string(
+    shard_cost_manifest,
+    "",
+    "Path of the shard cost manifest written by the sharder, used by the "
+    "publisher to run the most expensive files first. Files run in order "
+    "if empty");
+DEFINE_string(
+    job_manifest,
+    "",
+    "Path of a manifest of independent jobs to run in this one session, "
+    "each with its secret share input, its clear text input and its own "
+    "output, instead of the files given by the base path flags. Both parties "
+    "have to list the same jobs in the same order, and the jobs share the "
+    "aggregators and the output visibility");
+DEFINE_bool(
+    dry_run_estimate,
+    false,
+    "Predict the gates, traffic and time of a run of --dry_run_num_rows rows "
+    "from dry runs of both parties on small generated inputs in this process, "
+    "print them and exit without connecting to the other party");
+DEFINE_int64(
+    dry_run_num_rows,
+    1'000'000,
+    "Rows of the run --dry_run_estimate predicts the costs of");
+DEFINE_int64(
+    dry_run_num_ad_ids,
+    100,
+    "Distinct ad ids of the run --dry_run_estimate predicts the costs of");
+DEFINE_int32(
+    dry_run_bandwidth_mbps,
+    1000,
+    "Bandwidth in Mbps between the parties --dry_run_estimate assumes");
+DEFINE_string(
+    input_cache_directory,
+    "",
+    "Local directory caching the inputs read from S3, which can be shared by "
+    "the containers of a host so that inputs read again, e.g. by a retry or "
+    "the next stage, aren't downloaded again. Inputs aren't cached if empty");
+DEFINE_bool(
+    combine_attribution_rules,
+    false,
+    "Aggregate the attribution rules of a file in one ORAM with a slot per "
+    "rule and ad id, revealed once for all of them, instead of revealing the "
+    "ORAM after each rule. Both parties have to set this the same way");
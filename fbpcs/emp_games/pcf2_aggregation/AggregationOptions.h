@@ -30,9 +30,22 @@ DECLARE_bool(log_cost);
 DECLARE_string(log_cost_s3_bucket);
 DECLARE_string(log_cost_s3_region);
 DECLARE_bool(use_new_output_format);
+DECLARE_bool(use_binary_metrics_output);
 DECLARE_string(run_id);
 DECLARE_string(pc_feature_flags);
+DECLARE_bool(multiplex_connections);
+DECLARE_bool(adaptive_concurrency);
+DECLARE_int32(adaptive_concurrency_interval_s);
+DECLARE_string(network_compression);
 DECLARE_bool(use_tls);
 DECLARE_string(ca_cert_path);
 DECLARE_string(server_cert_path);
 DECLARE_string(private_key_path);
+DECLARE_string(shard_cost_manifest);
+DECLARE_string(job_manifest);
+DECLARE_bool(dry_run_estimate);
+DECLARE_int64(dry_run_num_rows);
+DECLARE_int64(dry_run_num_ad_ids);
+DECLARE_int32(dry_run_bandwidth_mbps);
+DECLARE_string(input_cache_directory);
+DECLARE_bool(combine_attribution_rules);
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <math.h>
+#include <cmath>
 #include <memory>
 #include "folly/json.h"
 #include "folly/logging/xlog.h"
@@ -45,6 +46,8 @@ struct PrivateAggregation {
       attributionResults;
   MeasurementTpmArrays<schedulerId> privateTpm;
   MeasurementCvmArrays<schedulerId> privateCvm;
+  // The rule of the attribution results, among the rules of the aggregator
+  size_t ruleIndex = 0;
   // TODO: Add fields for additional aggregators to PrivateAggregation.
 };
 
@@ -52,6 +55,8 @@ template <int schedulerId>
 struct PrivateAggregationReformatted {
   std::vector<std::vector<PrivateAttributionReformattedResult<schedulerId>>>
       attributionReformattedResults;
+  // The rule of the attribution results, among the rules of the aggregator
+  size_t ruleIndex = 0;
   // TODO: Add fields for additional aggregators to PrivateAggregation.
 };
 
@@ -86,12 +91,32 @@ class Aggregator {
           privateAggregationReformatted) = 0;
 
   virtual AggregationOutput reveal() const = 0;
+
+  // The output of each of the rules, in the order of their rule indices
+  virtual std::vector<AggregationOutput> revealRules() const = 0;
 };
 
 struct AggregationContext {
   const std::vector<uint64_t>& validOriginalAdIds;
+  // The number of attribution rules aggregated together by the aggregator
+  size_t numRules = 1;
 };
 
+/*
+ * The rules aggregated together share one ORAM. The slot of an ad of a rule
+ * is rule << getAdIdOramWidth(numAdIds) | adId, so that the rule index is
+ * put in the bits above the ad id as a public value instead of being added
+ * to it. All but the last rule take a power of two slots, and a single rule
+ * takes the number of ad ids + 1 slots as before.
+ */
+inline size_t getAdIdOramWidth(size_t numAdIds) {
+  return std::ceil(std::log2(numAdIds + 1));
+}
+
+inline size_t getOramSize(size_t numAdIds, size_t numRules) {
+  return ((numRules - 1) << getAdIdOramWidth(numAdIds)) + numAdIds + 1;
+}
+
 template <int schedulerId>
 class AggregationFormat {
  public:
@@ -18,6 +18,7 @@
 #include "fbpcs/emp_games/common/Constants.h"
 #include "fbpcs/emp_games/pcf2_aggregation/AggregationOptions.h"
 #include "fbpcs/emp_games/pcf2_aggregation/Constants.h"
+#include "fbpcs/performance_tools/Tracepoints.h"
 
 namespace pcf2_aggregation {
 
@@ -37,6 +38,14 @@ struct MeasurementAggregation {
         measurementTouchpointMetadata;
   };
 
+  // The touchpoint-conversion pairs of one conversion slot, for a batch of
+  // users
+  struct PrivateMeasurementAggregationBatch {
+    SecBitBatch<schedulerId> hasAttributedTouchpoint;
+    SecConvValueBatch<schedulerId> convValue;
+    SecAdIdBatch<schedulerId> adId;
+  };
+
   folly::dynamic toDynamic() const {
     folly::dynamic res = folly::dynamic::object();
 
@@ -58,18 +67,28 @@ class MeasurementAggregator : public Aggregator<schedulerId> {
       const int myRole,
       const int concurrency,
       std::unique_ptr<fbpcf::mpc_std_lib::oram::IWriteOnlyOramFactory<
-          fbpcf::mpc_std_lib::util::AggregationValue>> writeOnlyOramFactory)
+          fbpcf::mpc_std_lib::util::AggregationValue>> writeOnlyOramFactory,
+      const size_t numRules = 1)
       : Aggregator<schedulerId>{} {
+    CHECK_GT(numRules, 0) << "There should be at least one rule.";
     _validOriginalAdIds = validOriginalAdIds;
-    size_t oramSize = _validOriginalAdIds.size() + 1;
+    _myRole = myRole;
+    _numRules = numRules;
+    size_t oramSize = getOramSize(_validOriginalAdIds.size(), _numRules);
     // Note that oramSize must be nonzero because
     // we will be taking its logarithm.
     CHECK_GT(oramSize, 0) << "ORAM size must be greater than zero.";
-    _oramWidth =
-        std::ceil(std::log2(oramSize)); // number of bits used to store the adId
+    // number of bits used to store the adId, and the rule above it
+    _adIdOramWidth = getAdIdOramWidth(_validOriginalAdIds.size());
+    _oramWidth = std::ceil(std::log2(oramSize));
     _writeOnlyOram = writeOnlyOramFactory->create(oramSize);
     _oramMaxBatchSize =
         writeOnlyOramFactory->getMaxBatchSize(oramSize, concurrency);
+    auto schedulerHints = common::getSchedulerHints(kSchedulerHints);
+    if (schedulerHints.maxBatchWidth > 0) {
+      _oramMaxBatchSize = std::min<std::size_t>(
+          _oramMaxBatchSize, schedulerHints.maxBatchWidth);
+    }
     XLOGF(INFO, "ORAM maxBatchSize = {}", _oramMaxBatchSize);
   }
 
@@ -92,24 +111,29 @@ class MeasurementAggregator : public Aggregator<schedulerId> {
     CHECK_EQ(privateCvmArrays.size(), privateTpmArrays.size())
         << "Size of conversion metadata and touchpoint metadata should be equal.";
 
-    std::vector<std::vector<typename MeasurementAggregation<
-        schedulerId>::PrivateMeasurementAggregationResult>>
-        touchpointConversionResults;
-    for (size_t i = 0; i < privateCvmArrays.size(); ++i) {
-      // Retrieve the touchpoint-conversion metadata pairs based on
-      // attribution results.
-      auto touchpointConversionResultsPerId =
-          retrieveTouchpointForConversionPerID(
-              privateTpmArrays.at(i),
-              privateCvmArrays.at(i),
-              privateAttributionArrays.at(i));
-      touchpointConversionResults.push_back(touchpointConversionResultsPerId);
+    // The touchpoint-conversion metadata pairs are retrieved for every user
+    // of an ORAM batch at once, and go to the ORAM without being split back
+    // into the rows of each user
+    size_t startIndex = 0;
+    while (startIndex < privateCvmArrays.size()) {
+      size_t endIndex =
+          std::min(startIndex + _oramMaxBatchSize, privateCvmArrays.size());
+      XLOGF(
+          INFO,
+          "ORAM batch startIndex = {}, endIndex = {}",
+          startIndex,
+          endIndex);
+      fbpcs::performance_tools::ScopedBatch batch{
+          "oram", startIndex, endIndex - startIndex};
+      auto oramInput = generateOramInput(
+          retrieveTouchpointForConversionBatch(
+              privateAggregation, startIndex, endIndex),
+          privateAggregation.ruleIndex);
+      _writeOnlyOram->obliviousAddBatch(oramInput.first, oramInput.second);
+      startIndex = endIndex;
     }
 
-    XLOG(INFO, "Retrieved touchpoint-conversion metadata");
-
-    // Use ORAM for aggregation
-    aggregateUsingOram(touchpointConversionResults);
+    XLOG(INFO, "Aggregated touchpoint-conversion metadata");
   }
 
   virtual void aggregateReformattedAttributions(
@@ -140,49 +164,101 @@ class MeasurementAggregator : public Aggregator<schedulerId> {
     XLOG(INFO, "Retrieved touchpoint-conversion metadata");
 
     // Use ORAM for aggregation
-    aggregateUsingOram(touchpointConversionResults);
+    aggregateUsingOram(
+        touchpointConversionResults, privateAggregationReformatted.ruleIndex);
   }
 
+  /**
+   * Retrieve the touchpoint-conversion metadata pairs of the users between
+   * startIndex and endIndex based on attribution results. Every user has the
+   * same number of touchpoints and conversions, as their inputs are padded,
+   * so each conversion slot is computed for all of the users in a batch.
+   **/
   const std::vector<typename MeasurementAggregation<
-      schedulerId>::PrivateMeasurementAggregationResult>
-  retrieveTouchpointForConversionPerID(
-      const std::vector<PrivateMeasurementTouchpointMetadata<schedulerId>>&
-          privateTpmArray,
-      const std::vector<PrivateMeasurementConversionMetadata<schedulerId>>&
-          privateCvmArray,
-      const std::vector<PrivateAttributionResult<schedulerId>>&
-          attributionResults) {
-    std::vector<typename MeasurementAggregation<
-        schedulerId>::PrivateMeasurementAggregationResult>
-        aggregationResults;
-    int numOfResults = privateTpmArray.size() - 1;
-    int atIndex = attributionResults.size() - 1;
+      schedulerId>::PrivateMeasurementAggregationBatch>
+  retrieveTouchpointForConversionBatch(
+      const PrivateAggregation<schedulerId>& privateAggregation,
+      const size_t startIndex,
+      const size_t endIndex) {
+    const auto& privateTpmArrays = privateAggregation.privateTpm;
+    const auto& privateCvmArrays = privateAggregation.privateCvm;
+    const auto& privateAttributionArrays =
+        privateAggregation.attributionResults;
+    size_t numUsers = endIndex - startIndex;
+    size_t numOfResults = privateTpmArrays.at(startIndex).size();
+    if (numOfResults == 0) {
+      return {};
+    }
 
-    for (auto convIndex = numOfResults; convIndex >= 0; convIndex--) {
-      SecBit<schedulerId> hasAttributedTouchpoint(false, common::PUBLISHER);
-      uint8_t defaultAdId = 0;
-      SecAdId<schedulerId> attributedAdId(defaultAdId, common::PUBLISHER);
+    std::vector<std::vector<uint64_t>> adIdShares(numOfResults);
+    std::vector<std::vector<uint64_t>> convValueShares(numOfResults);
+    std::vector<std::vector<bool>> isAttributedShares(
+        numOfResults * numOfResults);
+    for (size_t index = startIndex; index < endIndex; ++index) {
+      const auto& privateTpmArray = privateTpmArrays.at(index);
+      const auto& privateCvmArray = privateCvmArrays.at(index);
+      const auto& attributionResults = privateAttributionArrays.at(index);
+      CHECK_EQ(privateTpmArray.size(), numOfResults)
+          << "Every user should have the same number of touchpoints.";
+      CHECK_GE(privateCvmArray.size(), numOfResults)
+          << "Every user should have a conversion per touchpoint.";
+      CHECK_GE(attributionResults.size(), numOfResults * numOfResults)
+          << "Every user should have an attribution result per touchpoint-conversion pair.";
+      // The attribution results of the touchpoint-conversion pairs are the
+      // last of the user's, conversion by conversion
+      size_t atOffset = attributionResults.size() - numOfResults * numOfResults;
+      for (size_t i = 0; i < numOfResults; ++i) {
+        adIdShares.at(i).push_back(
+            privateTpmArray.at(i).adId.extractIntShare().getValue());
+        convValueShares.at(i).push_back(
+            privateCvmArray.at(i).convValue.extractIntShare().getValue());
+      }
+      for (size_t i = 0; i < numOfResults * numOfResults; ++i) {
+        isAttributedShares.at(i).push_back(
+            attributionResults.at(atOffset + i)
+                .isAttributed.extractBit()
+                .getValue());
+      }
+    }
 
-      for (auto tpIndex = numOfResults; tpIndex >= 0; tpIndex--) {
-        auto isAttributed = !hasAttributedTouchpoint &
-            attributionResults.at(atIndex).isAttributed;
+    std::vector<SecAdIdBatch<schedulerId>> tpAdIds;
+    tpAdIds.reserve(numOfResults);
+    for (auto& shares : adIdShares) {
+      tpAdIds.emplace_back(typename SecAdIdBatch<schedulerId>::ExtractedInt(
+          std::move(shares)));
+    }
+    const PubAdIdBatch<schedulerId> defaultAdId(
+        std::vector<uint64_t>(numUsers, 0));
 
+    // Each conversion gets the last touchpoint attributed to it
+    std::vector<typename MeasurementAggregation<
+        schedulerId>::PrivateMeasurementAggregationBatch>
+        aggregationResults;
+    aggregationResults.reserve(numOfResults);
+    for (size_t convIndex = 0; convIndex < numOfResults; ++convIndex) {
+      auto isAttributedTo = [&](size_t tpIndex) {
+        return SecBitBatch<schedulerId>(
+            typename SecBitBatch<schedulerId>::ExtractedBit(std::move(
+                isAttributedShares.at(convIndex * numOfResults + tpIndex))));
+      };
+      auto hasAttributedTouchpoint = isAttributedTo(numOfResults - 1);
+      auto attributedAdId = defaultAdId.mux(
+          hasAttributedTouchpoint, tpAdIds.at(numOfResults - 1));
+      for (size_t tpIndex = numOfResults - 1; tpIndex-- > 0;) {
+        auto isAttributed = !hasAttributedTouchpoint & isAttributedTo(tpIndex);
         hasAttributedTouchpoint = hasAttributedTouchpoint | isAttributed;
-
-        attributedAdId =
-            attributedAdId.mux(isAttributed, privateTpmArray.at(tpIndex).adId);
-
-        atIndex--;
+        attributedAdId = attributedAdId.mux(isAttributed, tpAdIds.at(tpIndex));
       }
 
-      typename MeasurementAggregation<
-          schedulerId>::PrivateMeasurementAggregationResult aggregationResult{
-          /* hasAttributedTouchpoint */ hasAttributedTouchpoint,
-          /* conv */ privateCvmArray.at(convIndex),
-          /* tp */
-          PrivateMeasurementTouchpointMetadata<schedulerId>{attributedAdId}};
-
-      aggregationResults.push_back(aggregationResult);
+      aggregationResults.push_back(
+          typename MeasurementAggregation<
+              schedulerId>::PrivateMeasurementAggregationBatch{
+              /* hasAttributedTouchpoint */ std::move(hasAttributedTouchpoint),
+              /* convValue */
+              SecConvValueBatch<schedulerId>(
+                  typename SecConvValueBatch<schedulerId>::ExtractedInt(
+                      std::move(convValueShares.at(convIndex)))),
+              /* adId */ std::move(attributedAdId)});
     }
     return aggregationResults;
   }
@@ -223,7 +299,11 @@ class MeasurementAggregator : public Aggregator<schedulerId> {
   void aggregateUsingOram(
       const std::vector<std::vector<typename MeasurementAggregation<
           schedulerId>::PrivateMeasurementAggregationResult>>&
-          touchpointConversionResults) {
+          touchpointConversionResults,
+      const size_t ruleIndex = 0) {
+    // The batches run one after another, as the ORAM computes on the
+    // scheduler of the game. The other files run in parallel on the other
+    // apps, one per thread of the concurrency.
     size_t startIndex = 0;
     while (startIndex < touchpointConversionResults.size()) {
       size_t endIndex = std::min(
@@ -233,8 +313,10 @@ class MeasurementAggregator : public Aggregator<schedulerId> {
           "ORAM batch startIndex = {}, endIndex = {}",
           startIndex,
           endIndex);
-      auto oramInput =
-          generateOramInput(touchpointConversionResults, startIndex, endIndex);
+      fbpcs::performance_tools::ScopedBatch batch{
+          "oram", startIndex, endIndex - startIndex};
+      auto oramInput = generateOramInput(
+          touchpointConversionResults, startIndex, endIndex, ruleIndex);
       _writeOnlyOram->obliviousAddBatch(oramInput.first, oramInput.second);
       startIndex = endIndex;
     }
@@ -251,86 +333,216 @@ class MeasurementAggregator : public Aggregator<schedulerId> {
               schedulerId>::PrivateMeasurementAggregationResult>>&
               touchpointConversionResults,
           const size_t startIndex,
-          const size_t endIndex) {
-    std::vector<std::vector<bool>> indexShares(_oramWidth, std::vector<bool>{});
-    std::vector<std::vector<bool>> valueShares(
-        salesValueWidth + convValueWidth, std::vector<bool>{});
-
+          const size_t endIndex,
+          const size_t ruleIndex = 0) {
     CHECK_LT(startIndex, touchpointConversionResults.size())
         << "ORAM startIndex must be less than size of array";
     CHECK_LE(endIndex, touchpointConversionResults.size())
         << "ORAM endIndex must be at most size of array";
+
+    size_t numRows = 0;
+    for (size_t index = startIndex; index < endIndex; ++index) {
+      numRows += touchpointConversionResults.at(index).size();
+    }
+    std::vector<std::vector<bool>> indexShares(
+        _oramWidth, std::vector<bool>(numRows));
+    std::vector<std::vector<bool>> valueShares(
+        salesValueWidth + convValueWidth, std::vector<bool>(numRows, false));
+    if (numRows == 0) {
+      return std::make_pair(std::move(indexShares), std::move(valueShares));
+    }
+    setRuleIndexShares(indexShares, ruleIndex);
+
+    // Retrieve the shares of every row, to compute on all of them in a batch
+    std::vector<bool> hasAttributedTouchpointShares;
+    std::vector<uint64_t> convValueShares;
+    hasAttributedTouchpointShares.reserve(numRows);
+    convValueShares.reserve(numRows);
+    size_t row = 0;
     for (size_t index = startIndex; index < endIndex; ++index) {
       for (auto& touchpointConversionResult :
            touchpointConversionResults.at(index)) {
-        const auto& touchpoint =
-            touchpointConversionResult.measurementTouchpointMetadata;
-        const auto& conversion =
-            touchpointConversionResult.measurementConversionMetadata;
         // Retrieve adId shares
-        auto indexShare = touchpoint.adId.extractIntShare().getBooleanShares();
-        for (size_t i = 0; i < _oramWidth; ++i) {
-          indexShares.at(i).push_back(indexShare.at(i));
-        }
-        // Retrieve conversion value share if attributed, or zero if not
-        // attributed
-        const PubSalesValue<schedulerId> one(uint32_t(1));
-        const PubConvValue<schedulerId> zero(uint32_t(0));
-        auto salesValue =
-            zero.mux(touchpointConversionResult.hasAttributedTouchpoint, one);
-        auto convValue = zero.mux(
-            touchpointConversionResult.hasAttributedTouchpoint,
-            conversion.convValue);
-        auto salesValueShare = salesValue.extractIntShare().getBooleanShares();
-        auto convValueShare = convValue.extractIntShare().getBooleanShares();
-        for (size_t i = 0; i < salesValueWidth; ++i) {
-          valueShares.at(i).push_back(salesValueShare.at(i));
-        }
-        for (size_t j = 0; j < convValueWidth; j++) {
-          valueShares.at(j + salesValueWidth).push_back(convValueShare.at(j));
+        uint64_t indexShare = touchpointConversionResult
+                                  .measurementTouchpointMetadata.adId
+                                  .extractIntShare()
+                                  .getValue();
+        for (size_t i = 0; i < _adIdOramWidth; ++i) {
+          indexShares.at(i)[row] = (indexShare >> i) & 1;
         }
+        hasAttributedTouchpointShares.push_back(
+            touchpointConversionResult.hasAttributedTouchpoint.extractBit()
+                .getValue());
+        convValueShares.push_back(
+            touchpointConversionResult.measurementConversionMetadata.convValue
+                .extractIntShare()
+                .getValue());
+        ++row;
       }
     }
+
+    // The sales value is one if attributed, or zero if not attributed, so its
+    // lowest bit has the shares of hasAttributedTouchpoint and the other bits
+    // are zero
+    valueShares.at(0) = hasAttributedTouchpointShares;
+
+    // Retrieve conversion value share if attributed, or zero if not
+    // attributed
+    SecBitBatch<schedulerId> hasAttributedTouchpoint(
+        typename SecBitBatch<schedulerId>::ExtractedBit(
+            std::move(hasAttributedTouchpointShares)));
+    SecConvValueBatch<schedulerId> convValue(
+        typename SecConvValueBatch<schedulerId>::ExtractedInt(
+            std::move(convValueShares)));
+    const PubConvValueBatch<schedulerId> zero(
+        std::vector<uint64_t>(numRows, 0));
+    auto convValueShare = zero.mux(hasAttributedTouchpoint, convValue)
+                              .extractIntShare()
+                              .getBooleanShares();
+    for (size_t j = 0; j < convValueWidth; j++) {
+      valueShares.at(j + salesValueWidth) = std::move(convValueShare.at(j));
+    }
     return std::make_pair(std::move(indexShares), std::move(valueShares));
   }
 
+  /**
+   * Generate input to ORAM from the batches of touchpoint-conversion pairs.
+   * The rows of each conversion slot follow those of the one before.
+   **/
+  const std::
+      pair<std::vector<std::vector<bool>>, std::vector<std::vector<bool>>>
+      generateOramInput(
+          const std::vector<typename MeasurementAggregation<
+              schedulerId>::PrivateMeasurementAggregationBatch>&
+              touchpointConversionBatches,
+          const size_t ruleIndex = 0) {
+    std::vector<std::vector<bool>> indexShares(_oramWidth);
+    std::vector<std::vector<bool>> valueShares(salesValueWidth + convValueWidth);
+    for (const auto& batch : touchpointConversionBatches) {
+      auto adIdShares = batch.adId.extractIntShare().getBooleanShares();
+      for (size_t i = 0; i < _adIdOramWidth; ++i) {
+        indexShares.at(i).insert(
+            indexShares.at(i).end(),
+            adIdShares.at(i).begin(),
+            adIdShares.at(i).end());
+      }
+
+      // The sales value is one if attributed, or zero if not attributed, and
+      // the conversion value is zero if not attributed
+      auto hasAttributedTouchpointShares =
+          batch.hasAttributedTouchpoint.extractBit().getValue();
+      auto numRows = hasAttributedTouchpointShares.size();
+      valueShares.at(0).insert(
+          valueShares.at(0).end(),
+          hasAttributedTouchpointShares.begin(),
+          hasAttributedTouchpointShares.end());
+      for (size_t j = 1; j < salesValueWidth; j++) {
+        valueShares.at(j).resize(valueShares.at(j).size() + numRows, false);
+      }
+      const PubConvValueBatch<schedulerId> zero(
+          std::vector<uint64_t>(numRows, 0));
+      auto convValueShare =
+          zero.mux(batch.hasAttributedTouchpoint, batch.convValue)
+              .extractIntShare()
+              .getBooleanShares();
+      for (size_t j = 0; j < convValueWidth; j++) {
+        auto& shares = valueShares.at(j + salesValueWidth);
+        shares.insert(
+            shares.end(), convValueShare.at(j).begin(), convValueShare.at(j).end());
+      }
+    }
+    for (size_t i = _adIdOramWidth; i < _oramWidth; ++i) {
+      indexShares.at(i).resize(valueShares.at(0).size());
+    }
+    setRuleIndexShares(indexShares, ruleIndex);
+    return std::make_pair(std::move(indexShares), std::move(valueShares));
+  }
+
+  /**
+   * Sets the shares of the bits of the index above the ad id to those of the
+   * public ruleIndex, which the publisher holds and the partner holds zeros
+   * for.
+   **/
+  void setRuleIndexShares(
+      std::vector<std::vector<bool>>& indexShares,
+      const size_t ruleIndex) const {
+    CHECK_LT(ruleIndex, _numRules) << "Rule index exceeds number of rules.";
+    for (size_t i = _adIdOramWidth; i < _oramWidth; ++i) {
+      bool bit = _myRole == common::PUBLISHER &&
+          ((ruleIndex >> (i - _adIdOramWidth)) & 1);
+      std::fill(indexShares.at(i).begin(), indexShares.at(i).end(), bit);
+    }
+  }
+
   virtual AggregationOutput reveal() const override {
-    MeasurementAggregation<schedulerId> out;
-    for (size_t i = 1; i < _validOriginalAdIds.size() + 1; ++i) {
-      const auto rAdId = _validOriginalAdIds.at(i - 1);
-      XLOGF(DBG, "Revealing measurement metrics for adId={}", rAdId);
-      fbpcf::mpc_std_lib::util::AggregationValue aggregationValue;
-      auto additiveAggregationValue = _writeOnlyOram->secretRead(i);
+    return revealRules().front();
+  }
+
+  virtual std::vector<AggregationOutput> revealRules() const override {
+    // The additive shares of every ad of every rule are read first, to be
+    // converted in one batch
+    std::vector<uint64_t> convsShares;
+    std::vector<uint64_t> salesShares;
+    for (size_t rule = 0; rule < _numRules; ++rule) {
+      for (size_t i = 1; i < _validOriginalAdIds.size() + 1; ++i) {
+        XLOGF(
+            DBG,
+            "Revealing measurement metrics for adId={} of rule {}",
+            _validOriginalAdIds.at(i - 1),
+            rule);
+        auto additiveAggregationValue =
+            _writeOnlyOram->secretRead((rule << _adIdOramWidth) | i);
+        convsShares.push_back(additiveAggregationValue.conversionCount);
+        salesShares.push_back(additiveAggregationValue.conversionValue);
+      }
+    }
 
+    std::vector<MeasurementAggregation<schedulerId>> outs(_numRules);
+    if (!convsShares.empty()) {
       // Convert additive shares to secret shares by inputting them into MPC
       // and adding them, then extracting the secret shares.
-      auto publisherConvs = SecConvValue<schedulerId>(
-          additiveAggregationValue.conversionCount, common::PUBLISHER);
-      auto partnerConvs = SecConvValue<schedulerId>(
-          additiveAggregationValue.conversionCount, common::PARTNER);
-      auto convs = publisherConvs + partnerConvs;
-      auto extractedConvs = convs.extractIntShare().getValue();
-
-      auto publisherSales = SecSalesValue<schedulerId>(
-          additiveAggregationValue.conversionValue, common::PUBLISHER);
-      auto partnerSales = SecSalesValue<schedulerId>(
-          additiveAggregationValue.conversionValue, common::PARTNER);
-      auto sales = publisherSales + partnerSales;
-      auto extractedSales = sales.extractIntShare().getValue();
-
-      out.metrics[rAdId] = ConvMetrics{
-          static_cast<uint32_t>(extractedConvs),
-          static_cast<uint32_t>(extractedSales)};
+      auto publisherConvs =
+          SecConvValueBatch<schedulerId>(convsShares, common::PUBLISHER);
+      auto partnerConvs =
+          SecConvValueBatch<schedulerId>(convsShares, common::PARTNER);
+      auto extractedConvs =
+          (publisherConvs + partnerConvs).extractIntShare().getValue();
+
+      auto publisherSales =
+          SecSalesValueBatch<schedulerId>(salesShares, common::PUBLISHER);
+      auto partnerSales =
+          SecSalesValueBatch<schedulerId>(salesShares, common::PARTNER);
+      auto extractedSales =
+          (publisherSales + partnerSales).extractIntShare().getValue();
+
+      size_t next = 0;
+      for (auto& out : outs) {
+        for (const auto rAdId : _validOriginalAdIds) {
+          out.metrics[rAdId] = ConvMetrics{
+              static_cast<uint32_t>(extractedConvs.at(next)),
+              static_cast<uint32_t>(extractedSales.at(next))};
+          ++next;
+        }
+      }
+    }
+
+    std::vector<AggregationOutput> outputs;
+    outputs.reserve(_numRules);
+    for (const auto& out : outs) {
+      outputs.push_back(out.toDynamic());
     }
-    return out.toDynamic();
+    return outputs;
   }
 
  private:
   std::vector<uint64_t> _validOriginalAdIds;
+  int _myRole;
+  size_t _numRules;
   std::unique_ptr<fbpcf::mpc_std_lib::oram::IWriteOnlyOram<
       fbpcf::mpc_std_lib::util::AggregationValue>>
       _writeOnlyOram;
   uint32_t _oramMaxBatchSize;
+  uint8_t _adIdOramWidth;
   uint8_t _oramWidth;
 };
 } // namespace
@@ -352,7 +564,8 @@ static const std::vector<AggregationFormat<schedulerId>>
               ctx.validOriginalAdIds,
               myRole,
               concurrency,
-              std::move(writeOnlyOramFactory));
+              std::move(writeOnlyOramFactory),
+              ctx.numRules);
         }}};
 
 template <int schedulerId>
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "fbpcf/frontend/mpcGame.h"
+#include "fbpcs/emp_games/common/SchedulerHints.h"
 
 namespace pcf2_aggregation {
 
@@ -17,6 +18,10 @@ enum AGGREGATION_FORMAT { AD_OBJECT_FORMAT = 1 };
 
 const int kMaxConcurrency = 16;
 
+// The scheduler hints of aggregation, which takes max_batch_width as a cap on
+// the rows of an ORAM batch
+const common::SchedulerHints kSchedulerHints{};
+
 // We are compressing the original Ad Id (64 bit integer), by mapping it to
 // an integer in the range 1 - num_of_ad_ids. Assumption here is that the
 // number of ad_ids will be less than 65,536 per run.
@@ -44,6 +49,10 @@ template <int schedulerId>
 using SecOriginalAdId = typename pcf_frontend::MpcGame<
     schedulerId>::template SecUnsignedInt<originalAdIdWidth>;
 
+template <int schedulerId>
+using SecOriginalAdIdBatch = typename pcf_frontend::MpcGame<
+    schedulerId>::template SecUnsignedInt<originalAdIdWidth, true>;
+
 template <int schedulerId>
 using PubConvValue = typename pcf_frontend::MpcGame<
     schedulerId>::template PubUnsignedInt<convValueWidth>;
@@ -51,11 +60,30 @@ template <int schedulerId>
 using SecConvValue = typename pcf_frontend::MpcGame<
     schedulerId>::template SecUnsignedInt<convValueWidth>;
 
+template <int schedulerId>
+using SecBitBatch =
+    typename pcf_frontend::MpcGame<schedulerId>::template SecBit<true>;
+template <int schedulerId>
+using PubAdIdBatch = typename pcf_frontend::MpcGame<
+    schedulerId>::template PubUnsignedInt<adIdWidth, true>;
+template <int schedulerId>
+using SecAdIdBatch = typename pcf_frontend::MpcGame<
+    schedulerId>::template SecUnsignedInt<adIdWidth, true>;
+template <int schedulerId>
+using PubConvValueBatch = typename pcf_frontend::MpcGame<
+    schedulerId>::template PubUnsignedInt<convValueWidth, true>;
+template <int schedulerId>
+using SecConvValueBatch = typename pcf_frontend::MpcGame<
+    schedulerId>::template SecUnsignedInt<convValueWidth, true>;
+
 template <int schedulerId>
 using PubSalesValue = typename pcf_frontend::MpcGame<
     schedulerId>::template PubUnsignedInt<salesValueWidth>;
 template <int schedulerId>
 using SecSalesValue = typename pcf_frontend::MpcGame<
     schedulerId>::template SecUnsignedInt<salesValueWidth>;
+template <int schedulerId>
+using SecSalesValueBatch = typename pcf_frontend::MpcGame<
+    schedulerId>::template SecUnsignedInt<salesValueWidth, true>;
 
 } // namespace pcf2_aggregation
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fbpcf/io/api/FileIOWrappers.h>
+#include <folly/String.h>
+#include <folly/dynamic.h>
+#include <folly/json.h>
+
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/DryRunEstimate.h"
+#include "fbpcs/emp_games/pcf2_aggregation/AggregationApp.h"
+#include "fbpcs/emp_games/pcf2_aggregation/AggregationOptions.h"
+
+namespace pcf2_aggregation {
+
+/*
+ * Writes shares of the attribution results of numRows rows for each of the
+ * comma separated attributionRules, in the format the attribution game
+ * writes, with an is_attributed share for every pair of touchpoint and
+ * conversion. They are random, which costs the aggregation the same as real
+ * shares do.
+ */
+inline void writeDryRunAttributionShares(
+    const std::string& path,
+    const std::string& attributionRules,
+    std::size_t numRows,
+    std::size_t numAttributions,
+    uint32_t seed) {
+  std::vector<std::string> rules;
+  folly::split(',', attributionRules, rules, true);
+  if (rules.empty()) {
+    rules.push_back(common::LAST_CLICK_1D);
+  }
+
+  std::mt19937_64 r{seed};
+  std::bernoulli_distribution attributedDist{0.5};
+  folly::dynamic resultsPerRule = folly::dynamic::object();
+  for (const auto& rule : rules) {
+    folly::dynamic resultsPerPid = folly::dynamic::object();
+    for (std::size_t i = 0; i < numRows; ++i) {
+      folly::dynamic results = folly::dynamic::array();
+      for (std::size_t j = 0; j < numAttributions; ++j) {
+        results.push_back(
+            folly::dynamic::object("is_attributed", attributedDist(r)));
+      }
+      resultsPerPid.insert(std::to_string(i), std::move(results));
+    }
+    resultsPerRule.insert(
+        rule, folly::dynamic::object("default", std::move(resultsPerPid)));
+  }
+  fbpcf::io::FileIOWrappers::writeFile(path, folly::toJson(resultsPerRule));
+}
+
+template <int PARTY, int schedulerId>
+common::SchedulerStatistics runDryRunApp(
+    std::unique_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory> factory,
+    const std::string& aggregators,
+    common::Visibility outputVisibility,
+    const std::string& secretSharePath,
+    const std::string& clearTextPath,
+    const std::string& outputPath) {
+  auto metricCollector =
+      std::make_shared<fbpcf::util::MetricCollector>("aggregation_dry_run");
+  AggregationApp<PARTY, schedulerId> app(
+      common::InputEncryption::Plaintext,
+      outputVisibility,
+      std::move(factory),
+      aggregators,
+      std::vector<std::string>{secretSharePath},
+      std::vector<std::string>{clearTextPath},
+      std::vector<std::string>{outputPath},
+      metricCollector);
+  app.run();
+  return app.getSchedulerStatistics();
+}
+
+/*
+ * Predicts the costs of party in an aggregation of the attributions of
+ * numRows rows for attributionRules, split over numFiles files and run by
+ * concurrency apps, from dry runs of both parties on inputs of the same
+ * dimensions. The inputs are padded to --max_num_touchpoints and
+ * --max_num_conversions, with ad ids up to numAdIds.
+ */
+inline common::DryRunEstimate estimateAggregationCosts(
+    int party,
+    const std::string& attributionRules,
+    const std::string& aggregators,
+    common::Visibility outputVisibility,
+    int64_t numRows,
+    int64_t numAdIds,
+    int64_t numFiles,
+    int64_t concurrency,
+    int32_t bandwidthMbps) {
+  return common::estimateFromDryRuns(
+      party,
+      numRows,
+      std::min(std::max<int64_t>(numFiles, 1), concurrency),
+      bandwidthMbps,
+      [&](int64_t sampleRows, const std::string& dir) {
+        auto publisherClearText = dir + "/publisher.csv";
+        auto partnerClearText = dir + "/partner.csv";
+        auto publisherShares = dir + "/publisher_attribution.json";
+        auto partnerShares = dir + "/partner_attribution.json";
+        std::size_t numAttributions =
+            FLAGS_max_num_touchpoints * FLAGS_max_num_conversions;
+        common::writeAttributionDryRunInputs(
+            {publisherClearText},
+            {partnerClearText},
+            sampleRows,
+            FLAGS_max_num_touchpoints,
+            FLAGS_max_num_conversions,
+            numAdIds);
+        writeDryRunAttributionShares(
+            publisherShares, attributionRules, sampleRows, numAttributions, 1);
+        writeDryRunAttributionShares(
+            partnerShares, attributionRules, sampleRows, numAttributions, 2);
+        return [&aggregators,
+                outputVisibility,
+                publisherClearText,
+                partnerClearText,
+                publisherShares,
+                partnerShares,
+                dir](int runParty, auto factory) {
+          return runParty == common::PUBLISHER
+              ? runDryRunApp<common::PUBLISHER, common::PUBLISHER>(
+                    std::move(factory),
+                    aggregators,
+                    outputVisibility,
+                    publisherShares,
+                    publisherClearText,
+                    dir + "/publisher_aggregation.json")
+              : runDryRunApp<common::PARTNER, common::PARTNER>(
+                    std::move(factory),
+                    aggregators,
+                    outputVisibility,
+                    partnerShares,
+                    partnerClearText,
+                    dir + "/partner_aggregation.json");
+        };
+      });
+}
+
+} // namespace pcf2_aggregation
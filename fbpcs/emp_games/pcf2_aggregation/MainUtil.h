@@ -9,8 +9,15 @@
 
 #include <future>
 #include <memory>
+#include <optional>
 
 #include "fbpcf/engine/communication/SocketPartyCommunicationAgentFactory.h"
+#include "fbpcs/emp_games/common/CompressingAgent.h"
+#include "fbpcs/emp_games/common/LaneController.h"
+#include "fbpcs/emp_games/common/MultiplexedConnection.h"
+#include "fbpcs/emp_games/common/SchedulerSlots.h"
+#include "fbpcs/emp_games/common/ShardQueue.h"
+#include "fbpcs/emp_games/common/TrafficTrace.h"
 #include "fbpcs/emp_games/pcf2_aggregation/AggregationApp.h"
 
 namespace pcf2_aggregation {
@@ -43,12 +50,11 @@ inline std::vector<std::string> getIOInputFilenames(
   return inputFilePaths;
 }
 
-template <int PARTY, int index>
+template <int PARTY>
 inline common::SchedulerStatistics startAggregationAppsForShardedFilesHelper(
     common::InputEncryption inputEncryption,
     common::Visibility outputVisibility,
-    int startFileIndex,
-    int remainingThreads,
+    std::shared_ptr<common::ShardQueue> shardQueue,
     int numThreads,
     std::string serverIp,
     int port,
@@ -57,79 +63,108 @@ inline common::SchedulerStatistics startAggregationAppsForShardedFilesHelper(
     std::vector<std::string>& inputClearTextFilenames,
     std::vector<std::string>& outputFilenames,
     fbpcf::engine::communication::SocketPartyCommunicationAgent::TlsInfo&
-        tlsInfo) {
-  // aggregate scheduler statistics across apps
-  common::SchedulerStatistics schedulerStatistics{
-      0, 0, 0, 0, folly::dynamic::object()};
-
-  // split files evenly across threads
-  auto remainingFiles =
-      static_cast<std::int64_t>(inputSecretShareFilenames.size()) -
-      startFileIndex;
-  if (remainingFiles > 0) {
-    auto numFiles = (remainingThreads > remainingFiles)
-        ? 1
-        : (remainingFiles / remainingThreads);
-
-    std::map<
-        int,
-        fbpcf::engine::communication::SocketPartyCommunicationAgentFactory::
-            PartyInfo>
-        partyInfos(
-            {{0, {serverIp, port + index * 100}},
-             {1, {serverIp, port + index * 100}}});
-
-    auto metricCollector = std::make_shared<fbpcf::util::MetricCollector>(
-        "aggregation_metrics_for_thread_" + std::to_string(index));
-
-    auto communicationAgentFactory = std::make_unique<
-        fbpcf::engine::communication::SocketPartyCommunicationAgentFactory>(
-        PARTY, partyInfos, tlsInfo, metricCollector);
-
-    // Each AggregationApp runs numFiles sequentially on a single thread
-    // Publisher uses even schedulerId and partner uses odd schedulerId
-    auto app = std::make_unique<
-        pcf2_aggregation::AggregationApp<PARTY, 2 * index + PARTY>>(
-        inputEncryption,
-        outputVisibility,
-        std::move(communicationAgentFactory),
-        aggregationFormats,
-        inputSecretShareFilenames,
-        inputClearTextFilenames,
-        outputFilenames,
-        metricCollector,
-        startFileIndex,
-        numFiles,
-        numThreads);
-
-    auto future = std::async([&app]() {
-      app->run();
-      return app->getSchedulerStatistics();
-    });
-
-    if constexpr (index < kMaxConcurrency) {
-      if (remainingThreads > 1) {
-        auto remainingStats =
-            startAggregationAppsForShardedFilesHelper<PARTY, index + 1>(
-                inputEncryption,
-                outputVisibility,
-                startFileIndex + numFiles,
-                remainingThreads - 1,
-                numThreads,
-                serverIp,
-                port,
-                aggregationFormats,
-                inputSecretShareFilenames,
-                inputClearTextFilenames,
-                outputFilenames,
-                tlsInfo);
-        schedulerStatistics.add(remainingStats);
-      }
-    }
-    auto stats = future.get();
-    schedulerStatistics.add(stats);
-  }
-  return schedulerStatistics;
+        tlsInfo,
+    std::shared_ptr<common::MultiplexedConnection> connection,
+    std::shared_ptr<common::LaneController> laneController,
+    private_measurement::compressed_io::Codec networkCompression,
+    uint32_t firstLane,
+    bool combineAttributionRules) {
+  // Each AggregationApp runs the files it takes from shardQueue sequentially
+  // on a single thread, taking the next one when it finishes one. Publisher
+  // uses even schedulerId and partner uses odd schedulerId
+  common::SchedulerSlots<
+      kMaxConcurrency,
+      std::unique_ptr<
+          fbpcf::engine::communication::IPartyCommunicationAgentFactory>,
+      std::shared_ptr<fbpcf::util::MetricCollector>>
+      slots([&](auto slot) {
+        constexpr int schedulerId = 2 * decltype(slot)::value + PARTY;
+        return [&](std::unique_ptr<fbpcf::engine::communication::
+                                       IPartyCommunicationAgentFactory>
+                       communicationAgentFactory,
+                   std::shared_ptr<fbpcf::util::MetricCollector>
+                       metricCollector) {
+          auto app = std::make_unique<
+              pcf2_aggregation::AggregationApp<PARTY, schedulerId>>(
+              inputEncryption,
+              outputVisibility,
+              std::move(communicationAgentFactory),
+              aggregationFormats,
+              inputSecretShareFilenames,
+              inputClearTextFilenames,
+              outputFilenames,
+              metricCollector,
+              0 /* startFileIndex */,
+              0 /* numFiles */,
+              numThreads,
+              shardQueue,
+              combineAttributionRules);
+          app->run();
+          return app->getSchedulerStatistics();
+        };
+      });
+
+  return common::runAppsInSlots(
+      numThreads,
+      [&](std::size_t slot) {
+        auto metricCollector = std::make_shared<fbpcf::util::MetricCollector>(
+            "aggregation_metrics");
+
+        // The app is a lane of the multiplexed connection when there is one,
+        // and otherwise connects on a port of its own
+        std::unique_ptr<
+            fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+            communicationAgentFactory;
+        if (connection) {
+          communicationAgentFactory =
+              std::make_unique<common::MultiplexedAgentFactory>(
+                  connection, firstLane + slot, metricCollector);
+        } else {
+          std::map<
+              int,
+              fbpcf::engine::communication::
+                  SocketPartyCommunicationAgentFactory::PartyInfo>
+              partyInfos(
+                  {{0, {serverIp, port + static_cast<int>(slot) * 100}},
+                   {1, {serverIp, port + static_cast<int>(slot) * 100}}});
+          communicationAgentFactory =
+              std::make_unique<fbpcf::engine::communication::
+                                   SocketPartyCommunicationAgentFactory>(
+                  PARTY, partyInfos, tlsInfo, metricCollector);
+        }
+        // The trace records the traffic on the wire, after compression
+        communicationAgentFactory = common::recordTraffic(
+            std::move(communicationAgentFactory),
+            common::getTrafficTracePath("aggregation", PARTY, firstLane + slot),
+            metricCollector);
+        communicationAgentFactory = common::compressTraffic(
+            std::move(communicationAgentFactory),
+            networkCompression,
+            metricCollector);
+
+        // The controller of an adaptive run connects over the first app's
+        // factory, and measures the traffic of every app
+        if (laneController) {
+          if (slot == 0) {
+            laneController->connect(*communicationAgentFactory);
+          }
+          communicationAgentFactory = laneController->countTraffic(
+              std::move(communicationAgentFactory), metricCollector);
+        }
+
+        return std::async(
+            std::launch::async,
+            [&slots,
+             slot,
+             communicationAgentFactory = std::move(communicationAgentFactory),
+             metricCollector]() mutable {
+              return slots.run(
+                  slot, std::move(communicationAgentFactory), metricCollector);
+            });
+      },
+      [&](std::size_t slot) {
+        return !laneController || laneController->shouldStart(slot);
+      });
 }
 
 template <int PARTY>
@@ -144,16 +179,39 @@ inline common::SchedulerStatistics startAggregationAppsForShardedFiles(
     int port,
     std::string aggregationFormats,
     fbpcf::engine::communication::SocketPartyCommunicationAgent::TlsInfo&
-        tlsInfo) {
-  // use only as many threads as the number of files
+        tlsInfo,
+    const std::string& shardCostManifest = "",
+    bool multiplexConnections = false,
+    std::optional<common::LaneController::Options> adaptiveConcurrency =
+        std::nullopt,
+    private_measurement::compressed_io::Codec networkCompression =
+        private_measurement::compressed_io::Codec::kNone,
+    std::shared_ptr<common::MultiplexedConnection> sharedConnection = nullptr,
+    uint32_t firstLane = 0,
+    bool combineAttributionRules = false) {
+  // use only as many threads as the number of files. An adaptive run starts
+  // up to that many, as long as each one raises the throughput
   auto numThreads =
       std::min((int)inputSecretShareFilenames.size(), (int)concurrency);
+  auto shardQueue = common::makeShardQueue(
+      inputSecretShareFilenames.size(), shardCostManifest);
+  // The apps run as lanes firstLane and up of a connection shared with other
+  // stages of a pipeline when given one
+  auto connection = sharedConnection;
+  if (connection == nullptr && multiplexConnections && numThreads > 0) {
+    connection = common::connectMultiplexed(
+        PARTY, serverIp, port, tlsInfo, "aggregation_connection");
+  }
+  std::shared_ptr<common::LaneController> laneController;
+  if (adaptiveConcurrency.has_value()) {
+    laneController = std::make_shared<common::LaneController>(
+        PARTY, shardQueue, *adaptiveConcurrency);
+  }
 
-  return startAggregationAppsForShardedFilesHelper<PARTY, 0>(
+  return startAggregationAppsForShardedFilesHelper<PARTY>(
       inputEncryption,
       outputVisibility,
-      0,
-      numThreads,
+      shardQueue,
       numThreads,
       serverIp,
       port,
@@ -161,7 +219,12 @@ inline common::SchedulerStatistics startAggregationAppsForShardedFiles(
       inputSecretShareFilenames,
       inputClearTextFilenames,
       outputFilenames,
-      tlsInfo);
+      tlsInfo,
+      connection,
+      laneController,
+      networkCompression,
+      firstLane,
+      combineAttributionRules);
 }
 
 } // namespace pcf2_aggregation
@@ -7,17 +7,26 @@
 
 #include <gflags/gflags.h>
 #include <signal.h>
+#include <chrono>
+#include <iostream>
+#include <optional>
 
 #include "folly/Format.h"
 #include "folly/init/Init.h"
+#include "folly/json.h"
 #include "folly/logging/xlog.h"
 
 #include <fbpcf/aws/AwsSdk.h>
 #include <fbpcs/performance_tools/CostEstimation.h>
 
+#include "fbpcs/emp_games/common/InputCache.h"
+#include "fbpcs/emp_games/common/JobManifest.h"
+#include "fbpcs/emp_games/common/MetricsRegistry.h"
+#include "fbpcs/emp_games/common/MetricsServer.h"
 #include "fbpcs/emp_games/pcf2_aggregation/AggregationApp.h"
 #include "fbpcs/emp_games/pcf2_aggregation/AggregationOptions.h"
 #include "fbpcs/emp_games/pcf2_aggregation/Constants.h"
+#include "fbpcs/emp_games/pcf2_aggregation/DryRun.h"
 #include "fbpcs/emp_games/pcf2_aggregation/MainUtil.h"
 
 int main(int argc, char* argv[]) {
@@ -48,8 +57,46 @@ int main(int argc, char* argv[]) {
   XLOGF(INFO, "Base output path: {}", FLAGS_output_base_path);
   XLOGF(INFO, "Run Id: {}", FLAGS_run_id);
   XLOGF(INFO, "PC Feature Flags: {}", FLAGS_pc_feature_flags);
+  XLOGF(INFO, "Input cache directory: {}", FLAGS_input_cache_directory);
+
+  private_measurement::compressed_io::setInputCacheDirectory(
+      FLAGS_input_cache_directory);
+
+  if (FLAGS_dry_run_estimate) {
+    std::string party =
+        (FLAGS_party == common::PUBLISHER) ? "Publisher" : "Partner";
+    auto estimate = pcf2_aggregation::estimateAggregationCosts(
+        FLAGS_party,
+        FLAGS_attribution_rules,
+        FLAGS_aggregators,
+        FLAGS_use_xor_encryption ? common::Visibility::Xor
+                                 : common::Visibility::Publisher,
+        FLAGS_dry_run_num_rows,
+        FLAGS_dry_run_num_ad_ids,
+        FLAGS_num_files,
+        FLAGS_concurrency,
+        FLAGS_dry_run_bandwidth_mbps);
+    auto info = estimate.toDynamic();
+    info["attribution_rules"] = FLAGS_attribution_rules;
+    info["aggregators"] = FLAGS_aggregators;
+    info["num_ad_ids"] = FLAGS_dry_run_num_ad_ids;
+    info["max_num_touchpoints"] = FLAGS_max_num_touchpoints;
+    info["max_num_conversions"] = FLAGS_max_num_conversions;
+    info["concurrency"] = FLAGS_concurrency;
+    info["num_files"] = FLAGS_num_files;
+    std::cout << folly::toPrettyJson(cost.getPredictedCostDynamic(
+                     FLAGS_run_name.empty() ? "dry_run" : FLAGS_run_name,
+                     party,
+                     static_cast<int64_t>(estimate.getSeconds()),
+                     estimate.receivedNetwork,
+                     estimate.sentNetwork,
+                     info))
+              << std::endl;
+    return 0;
+  }
 
   common::SchedulerStatistics schedulerStatistics;
+  auto metricsServer = common::MetricsServer::startFromFlags();
 
   try {
     XLOG(INFO) << "Start private aggregation...";
@@ -72,6 +119,26 @@ int main(int argc, char* argv[]) {
         FLAGS_file_start_index,
         FLAGS_use_postfix);
 
+    if (!FLAGS_job_manifest.empty()) {
+      // Each job is a file of the session, so the jobs only share the costs
+      // of setting up the session and are aggregated and written separately
+      auto jobs = common::readJobManifest(FLAGS_job_manifest, 2);
+      inputSecretShareFilePaths.clear();
+      inputClearTextFilePaths.clear();
+      outputFilePaths.clear();
+      for (const auto& job : jobs) {
+        inputSecretShareFilePaths.push_back(job.inputs.at(0));
+        inputClearTextFilePaths.push_back(job.inputs.at(1));
+        outputFilePaths.push_back(job.output);
+      }
+      XLOG(INFO) << "Running " << jobs.size() << " jobs from "
+                 << FLAGS_job_manifest << " in one session";
+    }
+
+    common::MetricsRegistry::getInstance()
+        .getGauge("shard.files_total")
+        .set(inputSecretShareFilePaths.size());
+
     int16_t concurrency = static_cast<int16_t>(FLAGS_concurrency);
     CHECK_LE(concurrency, pcf2_aggregation::kMaxConcurrency)
         << "Concurrency must be at most " << pcf2_aggregation::kMaxConcurrency;
@@ -95,6 +162,14 @@ int main(int argc, char* argv[]) {
         FLAGS_server_cert_path,
         FLAGS_private_key_path,
         "");
+    std::optional<common::LaneController::Options> adaptiveConcurrency;
+    if (FLAGS_adaptive_concurrency) {
+      adaptiveConcurrency = common::LaneController::Options{};
+      adaptiveConcurrency->interval =
+          std::chrono::seconds(FLAGS_adaptive_concurrency_interval_s);
+    }
+    auto networkCompression = private_measurement::compressed_io::parseCodec(
+        FLAGS_network_compression);
 
     if (FLAGS_party == common::PUBLISHER) {
       XLOGF(INFO, "Aggregation Format: {}", FLAGS_aggregators);
@@ -114,7 +189,14 @@ int main(int argc, char* argv[]) {
               FLAGS_server_ip,
               FLAGS_port,
               FLAGS_aggregators,
-              tlsInfo);
+              tlsInfo,
+              FLAGS_shard_cost_manifest,
+              FLAGS_multiplex_connections,
+              adaptiveConcurrency,
+              networkCompression,
+              nullptr /* sharedConnection */,
+              0 /* firstLane */,
+              FLAGS_combine_attribution_rules);
     } else if (FLAGS_party == common::PARTNER) {
       XLOG(INFO)
           << "Starting private aggregation as Partner, will wait for Publisher...";
@@ -130,7 +212,14 @@ int main(int argc, char* argv[]) {
               FLAGS_server_ip,
               FLAGS_port,
               FLAGS_aggregators,
-              tlsInfo);
+              tlsInfo,
+              FLAGS_shard_cost_manifest,
+              FLAGS_multiplex_connections,
+              adaptiveConcurrency,
+              networkCompression,
+              nullptr /* sharedConnection */,
+              0 /* firstLane */,
+              FLAGS_combine_attribution_rules);
 
     } else {
       XLOGF(FATAL, "Invalid Party: {}", FLAGS_party);
@@ -5,9 +5,12 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
+#include <filesystem>
 #include <memory>
 #include <set>
+#include <type_traits>
 
 #include <fbpcs/emp_games/pcf2_aggregation/AttributionReformattedResult.h>
 #include "folly/test/JsonTestUtil.h"
@@ -18,7 +21,10 @@
 #include "fbpcf/scheduler/WireKeeper.h"
 #include "fbpcf/test/TestHelper.h"
 #include "fbpcs/emp_games/common/TestUtil.h"
+#include "folly/Random.h"
 
+#include "fbpcs/emp_games/common/AttributionShareFormat.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
 #include "fbpcs/emp_games/common/Constants.h"
 #include "fbpcs/emp_games/common/test/TestUtils.h"
 #include "fbpcs/emp_games/pcf2_aggregation/AggregationGame.h"
@@ -447,6 +453,125 @@ TEST(AggregationGameTest, TestRetrieveValidAdIdsLazyScheduler) {
       fbpcf::SchedulerType::Lazy, fbpcf::EngineType::EngineWithDummyTuple);
 }
 
+TEST(AggregationGameTest, TestBinaryAttributionSharesMatchJson) {
+  gflags::FlagSaver flagSaver;
+  std::string baseDir =
+      private_measurement::test_util::getBaseDirFromPath(__FILE__);
+  auto clearTextFileName = baseDir +
+      "../../pcf2_attribution/test/test_correctness/" + common::LAST_CLICK_1D +
+      ".publisher.csv";
+  auto binaryFileName = (std::filesystem::temp_directory_path() /
+                         ("AggregationGameTest_" +
+                          std::to_string(folly::Random::rand32())))
+                            .native();
+
+  for (bool reformatted : {false, true}) {
+    FLAGS_use_new_output_format = reformatted;
+    auto jsonFileName = baseDir + "test_correctness/" + common::LAST_CLICK_1D +
+        (reformatted ? "_reformatted" : "") + ".publisher.json";
+    AggregationInputMetrics fromJson{
+        common::PUBLISHER,
+        common::InputEncryption::Plaintext,
+        jsonFileName,
+        clearTextFileName,
+        common::MEASUREMENT};
+
+    std::vector<private_measurement::attribution_shares::RuleShares> shares;
+    for (size_t i = 0; i < fromJson.getAttributionRules().size(); ++i) {
+      private_measurement::attribution_shares::RuleShares ruleShares{
+          fromJson.getAttributionRules().at(i), reformatted};
+      auto addUser = [&](const auto& results) {
+        ruleShares.numUsers++;
+        ruleShares.resultsPerUser = results.size();
+        for (const auto& result : results) {
+          ruleShares.isAttributed.push_back(result.isAttributed);
+          if constexpr (std::is_same_v<
+                            std::decay_t<decltype(result)>,
+                            AttributionReformattedResult>) {
+            ruleShares.adIds.push_back(result.adId);
+            ruleShares.convValues.push_back(result.convValue);
+          }
+        }
+      };
+      if (reformatted) {
+        for (const auto& results :
+             fromJson.getAttributionReformattedSecretShares().at(i)) {
+          addUser(results);
+        }
+      } else {
+        for (const auto& results :
+             fromJson.getAttributionSecretShares().at(i)) {
+          addUser(results);
+        }
+      }
+      shares.push_back(std::move(ruleShares));
+    }
+    private_measurement::compressed_io::writeFile(
+        binaryFileName,
+        private_measurement::attribution_shares::encode(shares));
+
+    AggregationInputMetrics fromBinary{
+        common::PUBLISHER,
+        common::InputEncryption::Plaintext,
+        binaryFileName,
+        clearTextFileName,
+        common::MEASUREMENT};
+    EXPECT_EQ(fromJson.getAttributionRules(), fromBinary.getAttributionRules());
+
+    // The shares set in memory, as when attribution runs in the same process,
+    // are the same as those read from the file
+    AggregationInputMetrics fromShares{
+        common::PUBLISHER,
+        common::InputEncryption::Plaintext,
+        clearTextFileName,
+        common::MEASUREMENT};
+    fromShares.setAttributionShares(shares);
+    EXPECT_EQ(fromBinary.getIds(), fromShares.getIds());
+    EXPECT_EQ(
+        fromBinary.getAttributionRules(), fromShares.getAttributionRules());
+    EXPECT_EQ(
+        fromBinary.getAttributionSecretShares().size(),
+        fromShares.getAttributionSecretShares().size());
+    EXPECT_EQ(
+        fromBinary.getAttributionReformattedSecretShares().size(),
+        fromShares.getAttributionReformattedSecretShares().size());
+    for (size_t i = 0; i < fromJson.getAttributionRules().size(); ++i) {
+      if (reformatted) {
+        const auto& expected =
+            fromJson.getAttributionReformattedSecretShares().at(i);
+        const auto& actual =
+            fromBinary.getAttributionReformattedSecretShares().at(i);
+        ASSERT_EQ(expected.size(), actual.size());
+        for (size_t user = 0; user < expected.size(); ++user) {
+          ASSERT_EQ(expected.at(user).size(), actual.at(user).size());
+          for (size_t j = 0; j < expected.at(user).size(); ++j) {
+            EXPECT_EQ(expected.at(user).at(j).adId, actual.at(user).at(j).adId);
+            EXPECT_EQ(
+                expected.at(user).at(j).convValue,
+                actual.at(user).at(j).convValue);
+            EXPECT_EQ(
+                expected.at(user).at(j).isAttributed,
+                actual.at(user).at(j).isAttributed);
+          }
+        }
+      } else {
+        const auto& expected = fromJson.getAttributionSecretShares().at(i);
+        const auto& actual = fromBinary.getAttributionSecretShares().at(i);
+        ASSERT_EQ(expected.size(), actual.size());
+        for (size_t user = 0; user < expected.size(); ++user) {
+          ASSERT_EQ(expected.at(user).size(), actual.at(user).size());
+          for (size_t j = 0; j < expected.at(user).size(); ++j) {
+            EXPECT_EQ(
+                expected.at(user).at(j).isAttributed,
+                actual.at(user).at(j).isAttributed);
+          }
+        }
+      }
+    }
+  }
+  std::filesystem::remove(binaryFileName);
+}
+
 template <int schedulerId>
 AggregationOutputMetrics computeAggregationsWithScheduler(
     int myId,
@@ -461,6 +586,24 @@ AggregationOutputMetrics computeAggregationsWithScheduler(
   return game->computeAggregations(myId, inputData);
 }
 
+template <int schedulerId>
+AggregationOutputMetrics computeCombinedAggregationsWithScheduler(
+    int myId,
+    AggregationInputMetrics inputData,
+    common::InputEncryption inputEncryption,
+    std::shared_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory> factory,
+    fbpcf::SchedulerCreator schedulerCreator) {
+  auto scheduler = schedulerCreator(myId, *factory);
+  auto game = std::make_unique<AggregationGame<schedulerId>>(
+      std::move(scheduler),
+      std::move(factory),
+      inputEncryption,
+      1 /* concurrency */,
+      true /* combineAttributionRules */);
+  return game->computeAggregations(myId, inputData);
+}
+
 template <int schedulerId>
 AggregationOutputMetrics computeAggregationsReformattedWithScheduler(
     int myId,
@@ -635,6 +778,93 @@ void testCorrectnessReformattedWithScheduler(
   }
 }
 
+// The same rule's attribution results as two rules
+AggregationInputMetrics withRuleTwice(
+    const AggregationInputMetrics& inputData,
+    const std::string& copiedRule) {
+  auto rules = inputData.getAttributionRules();
+  rules.push_back(copiedRule);
+  auto secretShares = inputData.getAttributionSecretShares();
+  secretShares.push_back(secretShares.at(0));
+  return AggregationInputMetrics{
+      inputData.getIds(),
+      rules,
+      inputData.getAggregationFormats(),
+      secretShares,
+      inputData.getAttributionReformattedSecretShares(),
+      inputData.getTouchpointMetadata(),
+      inputData.getConversionMetadata()};
+}
+
+// With the rules combined in one ORAM, each rule is aggregated on its own,
+// which two copies of a rule that both give its output check
+void testCombinedRulesWithScheduler(
+    common::InputEncryption inputEncryption,
+    fbpcf::SchedulerCreator schedulerCreator) {
+  FLAGS_use_new_output_format = false;
+  std::string baseDir_ =
+      private_measurement::test_util::getBaseDirFromPath(__FILE__);
+  const std::string attributionRule = common::LAST_CLICK_1D;
+  const std::string copiedRule = attributionRule + "_copy";
+  const std::string aggregationFormat = common::MEASUREMENT;
+
+  std::string filePrefix =
+      baseDir_ + "test_correctness/" + attributionRule + ".";
+  std::string clearTextFilePrefix = baseDir_ +
+      "../../pcf2_attribution/test/test_correctness/" + attributionRule + ".";
+  if (inputEncryption == common::InputEncryption::PartnerXor) {
+    clearTextFilePrefix = clearTextFilePrefix + "partner_xor.";
+  } else if (inputEncryption == common::InputEncryption::Xor) {
+    clearTextFilePrefix = clearTextFilePrefix + "xor.";
+  }
+
+  auto publisherInputData = withRuleTwice(
+      AggregationInputMetrics{
+          common::PUBLISHER,
+          inputEncryption,
+          filePrefix + "publisher.json",
+          clearTextFilePrefix + "publisher.csv",
+          aggregationFormat},
+      copiedRule);
+  auto partnerInputData = withRuleTwice(
+      AggregationInputMetrics{
+          common::PARTNER,
+          inputEncryption,
+          filePrefix + "partner.json",
+          clearTextFilePrefix + "partner.csv",
+          ""},
+      copiedRule);
+
+  auto factories = fbpcf::engine::communication::getInMemoryAgentFactory(2);
+  auto future0 = std::async(
+      computeCombinedAggregationsWithScheduler<0>,
+      0,
+      publisherInputData,
+      inputEncryption,
+      std::move(factories[0]),
+      schedulerCreator);
+  auto future1 = std::async(
+      computeCombinedAggregationsWithScheduler<1>,
+      1,
+      partnerInputData,
+      inputEncryption,
+      std::move(factories[1]),
+      schedulerCreator);
+  auto res0 = future0.get();
+  auto res1 = future1.get();
+
+  verifyOutput(
+      revealXORedResult(res0, res1, aggregationFormat, attributionRule),
+      filePrefix + aggregationFormat + ".json");
+  auto copiedOutput =
+      revealXORedResult(res0, res1, aggregationFormat, copiedRule);
+  auto output =
+      revealXORedResult(res0, res1, aggregationFormat, attributionRule);
+  EXPECT_EQ(
+      copiedOutput.ruleToMetrics.at(copiedRule).toDynamic(),
+      output.ruleToMetrics.at(attributionRule).toDynamic());
+}
+
 class AggregationGameTestFixture
     : public ::testing::TestWithParam<
           std::tuple<common::SchedulerType, common::InputEncryption>> {};
@@ -653,6 +883,13 @@ TEST_P(AggregationGameTestFixture, TestCorrectnessReformatted) {
       inputEncryption, fbpcf::getSchedulerCreator<unsafe>(schedulerType));
 }
 
+TEST_P(AggregationGameTestFixture, TestCorrectnessCombinedRules) {
+  auto [schedulerType, inputEncryption] = GetParam();
+
+  testCombinedRulesWithScheduler(
+      inputEncryption, fbpcf::getSchedulerCreator<unsafe>(schedulerType));
+}
+
 INSTANTIATE_TEST_SUITE_P(
     AggregationGameTest,
     AggregationGameTestFixture,
@@ -9,11 +9,22 @@
 
 #include <fbpcf/io/api/FileIOWrappers.h>
 #include <fbpcf/scheduler/NetworkPlaintextSchedulerFactory.h>
+#include <folly/Format.h>
+#include <optional>
 #include <string>
 #include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
 #include "fbpcf/scheduler/LazySchedulerFactory.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
+#include "fbpcs/emp_games/common/FilePipeline.h"
+#include "fbpcs/emp_games/common/InputArrival.h"
+#include "fbpcs/emp_games/common/SchedulerHints.h"
+#include "fbpcs/emp_games/common/SchedulerPhase.h"
 #include "fbpcs/emp_games/common/SchedulerStatistics.h"
+#include "fbpcs/emp_games/common/ShardCache.h"
+#include "fbpcs/emp_games/common/ShardQueue.h"
+#include "fbpcs/emp_games/common/ShardReport.h"
 #include "fbpcs/emp_games/pcf2_attribution/AttributionGame.h"
+#include "fbpcs/emp_games/pcf2_attribution/Constants.h"
 
 namespace pcf2_attribution {
 
@@ -31,7 +42,8 @@ class AttributionApp {
       bool useXorEncryption,
       common::InputEncryption inputEncryption,
       std::uint32_t startFileIndex = 0U,
-      int numFiles = 1)
+      int numFiles = 1,
+      std::shared_ptr<common::ShardQueue> shardQueue = nullptr)
       : communicationAgentFactory_(std::move(communicationAgentFactory)),
         attributionRules_{attributionRules},
         inputFilenames_(inputFilenames),
@@ -41,30 +53,98 @@ class AttributionApp {
         inputEncryption_(inputEncryption),
         startFileIndex_(startFileIndex),
         numFiles_(numFiles),
+        shardQueue_(std::move(shardQueue)),
         schedulerStatistics_{0, 0, 0, 0} {}
 
   void run() {
     auto scheduler = useXorEncryption_
-        ? fbpcf::scheduler::getLazySchedulerFactoryWithRealEngine(
-              MY_ROLE, *communicationAgentFactory_, metricCollector_)
-              ->create()
+        ? common::createRealScheduler(
+              common::getSchedulerHints(kSchedulerHints),
+              MY_ROLE,
+              *communicationAgentFactory_,
+              metricCollector_)
         : fbpcf::scheduler::NetworkPlaintextSchedulerFactory<false>(
               MY_ROLE, *communicationAgentFactory_, metricCollector_)
               .create();
 
     AttributionGame<schedulerId> game(std::move(scheduler));
 
-    // Compute attributions sequentially on numFiles files, starting from
-    // startFileIndex
-    for (size_t i = startFileIndex_; i < startFileIndex_ + numFiles_; ++i) {
-      CHECK_LT(i, inputFilenames_.size())
-          << "File index exceeds number of files.";
-      auto inputData = getInputData(inputFilenames_.at(i));
-      auto output =
-          game.computeAttributions(MY_ROLE, inputData, inputEncryption_);
-      putOutputData(output, outputFilenames_.at(i));
+    // Compute attributions sequentially on the files taken from shardQueue_ if
+    // there is one, otherwise on numFiles files starting from startFileIndex
+    auto files = shardQueue_ == nullptr
+        ? common::ShardAssignment(startFileIndex_, numFiles_)
+        : common::ShardAssignment(
+              MY_ROLE, shardQueue_, *communicationAgentFactory_);
+    // With the shard cache, the files both parties computed in an earlier run
+    // are skipped, so that a run restarted after a failure only computes the
+    // files it didn't finish
+    std::unique_ptr<common::ShardCache> shardCache;
+    if (FLAGS_use_shard_cache) {
+      shardCache = std::make_unique<common::ShardCache>(
+          MY_ROLE, getShardCacheConfig(), *communicationAgentFactory_);
     }
 
+    // The input of the next file is parsed and the output of the previous one
+    // written while the game runs on a file. Cached files have no input.
+    common::ShardReporter reporter;
+    common::runFilesPipelined<
+        std::optional<AttributionInputMetrics>,
+        std::optional<AttributionOutputMetrics>>(
+        files,
+        [this, &shardCache, &reporter](
+            std::size_t i) -> std::optional<AttributionInputMetrics> {
+          CHECK_LT(i, inputFilenames_.size())
+              << "File index exceeds number of files.";
+          if (FLAGS_input_wait_timeout_s > 0) {
+            common::waitForInputs(
+                {inputFilenames_.at(i)},
+                std::chrono::seconds(FLAGS_input_wait_timeout_s));
+          }
+          if (shardCache != nullptr &&
+              shardCache->isComputed(
+                  {inputFilenames_.at(i)},
+                  common::shardCacheStampPath(outputFilenames_.at(i)))) {
+            return std::nullopt;
+          }
+          fbpcs::performance_tools::ScopedPhase phase{"input_parsing"};
+          common::ShardReporter::Phase shardPhase{reporter, i, "input_parsing"};
+          reporter.setInputPaths(i, {inputFilenames_.at(i)});
+          auto inputData = getInputData(inputFilenames_.at(i));
+          reporter.setNumRows(i, inputData.getIds().size());
+          return inputData;
+        },
+        [this, &game, &reporter](
+            std::size_t i, std::optional<AttributionInputMetrics> inputData)
+            -> std::optional<AttributionOutputMetrics> {
+          if (!inputData.has_value()) {
+            return std::nullopt;
+          }
+          common::ShardReporter::Phase shardPhase{
+              reporter,
+              i,
+              "attribution",
+              common::getSchedulerCounterReader<schedulerId>()};
+          return game.computeAttributions(
+              MY_ROLE, *inputData, inputEncryption_);
+        },
+        [this, &shardCache, &reporter](
+            std::size_t i, std::optional<AttributionOutputMetrics> output) {
+          if (!output.has_value()) {
+            return;
+          }
+          {
+            fbpcs::performance_tools::ScopedPhase phase{"output_writing"};
+            common::ShardReporter::Phase shardPhase{
+                reporter, i, "output_writing"};
+            putOutputData(*output, outputFilenames_.at(i));
+          }
+          reporter.finish(i, outputFilenames_.at(i));
+          if (shardCache != nullptr) {
+            shardCache->markComputed(
+                common::shardCacheStampPath(outputFilenames_.at(i)));
+          }
+        });
+
     auto gateStatistics =
         fbpcf::scheduler::SchedulerKeeper<schedulerId>::getGateStatistics();
     XLOGF(
@@ -94,6 +174,18 @@ class AttributionApp {
   }
 
  protected:
+  // The settings which the output of a file depends on besides its input, for
+  // its key in the shard cache
+  std::string getShardCacheConfig() const {
+    return folly::sformat(
+        "pcf2_attribution {} {} {} {} {}",
+        attributionRules_,
+        useXorEncryption_,
+        static_cast<int>(inputEncryption_),
+        FLAGS_use_binary_share_output,
+        FLAGS_use_new_output_format);
+  }
+
   AttributionInputMetrics getInputData(std::string inputPath) {
     XLOG(INFO) << "MY_ROLE: " << MY_ROLE << ", schedulerId: " << schedulerId
                << ", attributionRules_: " << attributionRules_
@@ -105,8 +197,17 @@ class AttributionApp {
   void putOutputData(
       const AttributionOutputMetrics& attributions,
       const std::string& outputPath) {
-    std::string content = attributions.toJson();
-    fbpcf::io::FileIOWrappers::writeFile(outputPath, content);
+    if (FLAGS_use_binary_share_output) {
+      private_measurement::compressed_io::writeFile(
+          outputPath,
+          private_measurement::attribution_shares::encode(
+              attributions.toShares()));
+      return;
+    }
+    fbpcf::io::BufferedWriter writer{
+        private_measurement::compressed_io::makeFileWriter(outputPath)};
+    attributions.writeJson(writer);
+    writer.close();
   }
 
  private:
@@ -120,6 +221,7 @@ class AttributionApp {
   common::InputEncryption inputEncryption_;
   const std::uint32_t startFileIndex_;
   const int numFiles_;
+  std::shared_ptr<common::ShardQueue> shardQueue_;
   common::SchedulerStatistics schedulerStatistics_;
 };
 
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <utility>
 #include "fbpcf/frontend/mpcGame.h"
 #include "fbpcs/emp_games/common/Debug.h"
 #include "fbpcs/emp_games/common/Util.h"
@@ -50,6 +51,36 @@ class AttributionGame : public fbpcf::frontend::MpcGame<schedulerId> {
       const AttributionInputMetrics& inputData,
       common::InputEncryption inputEncryption);
 
+  /**
+   * Shares the touchpoints and conversions of the users, and the thresholds
+   * of the touchpoints for each rule.
+   */
+  MpcInputs<schedulerId> shareMpcInputs(
+      const std::vector<Touchpoint>& touchpoints,
+      const std::vector<Conversion>& conversions,
+      std::vector<std::shared_ptr<const AttributionRule<schedulerId>>>
+          attributionRules,
+      std::vector<int64_t> ids,
+      common::InputEncryption inputEncryption);
+
+  /**
+   * Computes the attributions of the users in ranges of usersPerBatch users,
+   * each shared, attributed and revealed before the next one is shared, so
+   * that only the secrets of one range are alive at once. Under a memory
+   * budget the ranges shrink while either party nears its budget.
+   */
+  AttributionOutputMetrics computeAttributionsInUserBatches(
+      const int myRole,
+      const AttributionInputMetrics& inputData,
+      common::InputEncryption inputEncryption,
+      size_t usersPerBatch);
+
+  /**
+   * The smaller of the batch sizes the two parties ask for, as the parties
+   * have to attribute the same users in each batch.
+   */
+  size_t agreeOnBatchSize(const int myRole, size_t batchSize);
+
   AttributionOutputMetrics computeAttributions_impl(
       std::vector<std::vector<std::vector<SecTimestamp<schedulerId>>>>&
           thresholdArraysForEachRule,
@@ -92,6 +123,15 @@ class AttributionGame : public fbpcf::frontend::MpcGame<schedulerId> {
       size_t batchSize,
       common::InputEncryption inputEncryption);
 
+  /**
+   * Replaces the ad ids of the touchpoints with compressed ad ids, and writes
+   * the mapping from the compressed ad ids to the original ones
+   */
+  void compressAdIds(
+      const int myRole,
+      std::vector<Touchpoint>& touchpoints,
+      common::InputEncryption inputEncryption);
+
   /**
    * Retrieve the original Ad Ids from touchpoint data
    */
@@ -112,14 +152,28 @@ class AttributionGame : public fbpcf::frontend::MpcGame<schedulerId> {
       std::string outputPath);
 
   /**
-   * Helper method for computing attributions.
+   * Whether each touchpoint happened before each conversion, indexed by
+   * conversion and then touchpoint. Every attribution rule needs these
+   * comparisons, so they are computed once when attributing with several
+   * rules and given to the helpers below.
+   */
+  std::vector<std::vector<SecBit<schedulerId>>>
+  computeTouchpointsBeforeConversions(
+      const std::vector<PrivateTouchpoint<schedulerId>>& touchpoints,
+      const std::vector<PrivateConversion<schedulerId>>& conversions);
+
+  /**
+   * Helper method for computing attributions. The touchpoint and conversion
+   * timestamps are compared for the rule unless the comparisons are given.
    */
   const std::vector<SecBit<schedulerId>> computeAttributionsHelper(
       const std::vector<PrivateTouchpoint<schedulerId>>& touchpoints,
       const std::vector<PrivateConversion<schedulerId>>& conversions,
       const AttributionRule<schedulerId>& attributionRule,
       const std::vector<std::vector<SecTimestamp<schedulerId>>>& thresholds,
-      size_t batchSize);
+      size_t batchSize,
+      const std::vector<std::vector<SecBit<schedulerId>>>&
+          isTouchpointBeforeConversion = {});
 
   const std::vector<AttributionReformattedOutputFmt<schedulerId>>
   computeAttributionsHelperV2(
@@ -127,6 +181,82 @@ class AttributionGame : public fbpcf::frontend::MpcGame<schedulerId> {
       const std::vector<PrivateConversion<schedulerId>>& conversions,
       const AttributionRule<schedulerId>& attributionRule,
       const std::vector<std::vector<SecTimestamp<schedulerId>>>& thresholds,
+      size_t batchSize,
+      const std::vector<std::vector<SecBit<schedulerId>>>&
+          isTouchpointBeforeConversion = {});
+
+  // The helpers above for the concrete type of the rule, to which they
+  // dispatch with visitAttributionRule
+  template <typename Rule>
+  const std::vector<SecBit<schedulerId>> computeAttributionsForRule(
+      const std::vector<PrivateTouchpoint<schedulerId>>& touchpoints,
+      const std::vector<PrivateConversion<schedulerId>>& conversions,
+      const Rule& attributionRule,
+      const std::vector<std::vector<SecTimestamp<schedulerId>>>& thresholds,
+      size_t batchSize,
+      const std::vector<std::vector<SecBit<schedulerId>>>&
+          isTouchpointBeforeConversion);
+
+  template <typename Rule>
+  const std::vector<AttributionReformattedOutputFmt<schedulerId>>
+  computeAttributionsForRuleV2(
+      const std::vector<PrivateTouchpoint<schedulerId>>& touchpoints,
+      const std::vector<PrivateConversion<schedulerId>>& conversions,
+      const Rule& attributionRule,
+      const std::vector<std::vector<SecTimestamp<schedulerId>>>& thresholds,
+      size_t batchSize,
+      const std::vector<std::vector<SecBit<schedulerId>>>&
+          isTouchpointBeforeConversion);
+
+  /**
+   * Whether each touchpoint is attributable to each conversion, computed by
+   * the rule in one batch of every pair. Indexed by touchpoint, each bit is
+   * batched over the conversions, then over the users of the batch.
+   */
+  template <typename Rule>
+  std::vector<SecBit<schedulerId>> computeAttributableInWideBatch(
+      const std::vector<PrivateTouchpoint<schedulerId>>& touchpoints,
+      const std::vector<PrivateConversion<schedulerId>>& conversions,
+      const Rule& attributionRule,
+      const std::vector<std::vector<SecTimestamp<schedulerId>>>& thresholds,
+      size_t batchSize,
+      const std::vector<std::vector<SecBit<schedulerId>>>&
+          isTouchpointBeforeConversion);
+
+  /**
+   * The attributions of a rule which attributes the latest touchpoint in its
+   * windows, computed from the touchpoints and conversions of each user
+   * obliviously sorted by time: a prefix scan finds the latest touchpoint of
+   * each window before every conversion, and the results are sorted back to
+   * the conversions. Takes O(n log^2 n) gates for the n events of a user,
+   * instead of evaluating the rule on all of their pairs.
+   */
+  template <typename Rule>
+  std::vector<AttributionReformattedOutputFmt<schedulerId>>
+  computeAttributionsBySort(
+      const std::vector<PrivateTouchpoint<schedulerId>>& touchpoints,
+      const std::vector<PrivateConversion<schedulerId>>& conversions,
+      const Rule& attributionRule,
+      const std::vector<std::vector<SecTimestamp<schedulerId>>>& thresholds,
+      size_t batchSize);
+
+  /**
+   * Given whether each touchpoint of a conversion is attributable, in
+   * timestamp order, mark only the latest attributable touchpoint as
+   * attributed. Computed with a suffix scan of depth log(#touchpoints).
+   */
+  std::vector<SecBit<schedulerId>> attributeLatestByScan(
+      const std::vector<SecBit<schedulerId>>& isAttributable);
+
+  /**
+   * Whether any touchpoint of a conversion is attributable, and the ad id of
+   * the latest attributable touchpoint or 0 if there is none. The touchpoints
+   * are reduced pairwise in a tree of depth log(#touchpoints).
+   */
+  std::pair<SecBit<schedulerId>, SecAdId<schedulerId>>
+  attributeLatestAdIdByScan(
+      const std::vector<PrivateTouchpoint<schedulerId>>& touchpoints,
+      const std::vector<SecBit<schedulerId>>& isAttributable,
       size_t batchSize);
 };
 
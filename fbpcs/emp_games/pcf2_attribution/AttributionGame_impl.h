@@ -10,9 +10,21 @@
 #include <fbpcf/io/api/FileIOWrappers.h>
 #include <algorithm>
 #include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "fbpcs/emp_games/common/CompressedIO.h"
+#include "fbpcs/emp_games/common/MemoryGovernor.h"
+#include "fbpcs/emp_games/common/SchedulerPhase.h"
+#include "fbpcs/emp_games/common/SortedIds.h"
+#include "fbpcs/emp_games/common/SortingNetwork.h"
 #include "fbpcs/emp_games/pcf2_attribution/AttributionGame.h"
 #include "fbpcs/emp_games/pcf2_attribution/AttributionOptions.h"
 #include "fbpcs/emp_games/pcf2_attribution/Constants.h"
+#include "fbpcs/performance_tools/Tracepoints.h"
 
 namespace pcf2_attribution {
 
@@ -72,9 +84,10 @@ AttributionGame<schedulerId>::privatelyShareThresholds(
                 createPrivateIsClick<schedulerId>,
                 inputEncryption,
                 std::placeholders::_1));
+    auto constants = attributionRule.makeThresholdConstants(batchSize);
     for (size_t i = 0; i < touchpoints.size(); ++i) {
       auto thresholds = attributionRule.computeThresholdsPrivate(
-          privateTouchpoints.at(i), privateIsClick.at(i), batchSize);
+          privateTouchpoints.at(i), privateIsClick.at(i), constants);
       output.push_back(std::move(thresholds));
     }
   }
@@ -126,33 +139,50 @@ AttributionGame<schedulerId>::retrieveValidOriginalAdIds(
     const int /*myRole*/,
     std::vector<Touchpoint>& touchpoints,
     common::InputEncryption inputEncryption) {
-  std::unordered_set<uint64_t> adIdSet;
-  for (auto& touchpoint : touchpoints) {
-    SecOriginalAdId<schedulerId> secAdId;
-    if (inputEncryption == common::InputEncryption::Xor) {
-      typename SecOriginalAdId<schedulerId>::ExtractedInt extractedAdIds(
-          touchpoint.originalAdId);
-      secAdId = SecOriginalAdId<schedulerId>(std::move(extractedAdIds));
-      // Reveal ad id to publisher
-      auto publisherAdId = secAdId.openToParty(common::PUBLISHER).getValue();
-      touchpoint.originalAdId = publisherAdId;
+  // Reveal the ad ids of every touchpoint to the publisher in one batch,
+  // instead of waiting for the network once per touchpoint
+  std::size_t numAdIds = 0;
+  for (const auto& touchpoint : touchpoints) {
+    numAdIds += touchpoint.originalAdId.size();
+  }
+  if (inputEncryption == common::InputEncryption::Xor && numAdIds > 0) {
+    std::vector<uint64_t> adIdShares;
+    adIdShares.reserve(numAdIds);
+    for (const auto& touchpoint : touchpoints) {
+      adIdShares.insert(
+          adIdShares.end(),
+          touchpoint.originalAdId.begin(),
+          touchpoint.originalAdId.end());
     }
-    for (auto& adId : touchpoint.originalAdId) {
+    SecOriginalAdId<schedulerId> secAdIds(
+        typename SecOriginalAdId<schedulerId>::ExtractedInt(
+            std::move(adIdShares)));
+    auto publisherAdIds = secAdIds.openToParty(common::PUBLISHER).getValue();
+    auto publisherAdId = publisherAdIds.begin();
+    for (auto& touchpoint : touchpoints) {
+      auto size = touchpoint.originalAdId.size();
+      touchpoint.originalAdId.assign(publisherAdId, publisherAdId + size);
+      publisherAdId += size;
+    }
+  }
+
+  std::vector<uint64_t> adIds;
+  adIds.reserve(numAdIds);
+  for (const auto& touchpoint : touchpoints) {
+    for (auto adId : touchpoint.originalAdId) {
       if (adId > 0) {
-        adIdSet.insert(adId);
+        adIds.push_back(adId);
       }
     }
   }
-  XLOGF(INFO, "Number of Ad Ids: {}", adIdSet.size());
-  // Added a check here to make sure that number of ad Ids never exceed 65,536
-  // (8 unsigned bit)
-  CHECK_LE(adIdSet.size(), 65536)
-      << "Number of ad Ids cannot be more than 65,536.";
-
-  std::vector<uint64_t> validOriginalAdIds;
-  validOriginalAdIds.insert(
-      validOriginalAdIds.end(), adIdSet.begin(), adIdSet.end());
-  std::sort(validOriginalAdIds.begin(), validOriginalAdIds.end());
+  auto validOriginalAdIds = common::sortUniqueIds(std::move(adIds));
+  XLOGF(INFO, "Number of Ad Ids: {}", validOriginalAdIds.size());
+  // Compressed ad ids have to fit in the ad id width of this game, which is
+  // checked before any of them are shared
+  CHECK_LE(validOriginalAdIds.size(), maxNumAdIdsFor<schedulerId>)
+      << "Number of ad Ids cannot be more than "
+      << maxNumAdIdsFor<schedulerId> << " with "
+      << adIdWidthFor<schedulerId> << " bit ad ids.";
   return validOriginalAdIds;
 }
 
@@ -160,25 +190,17 @@ template <int schedulerId>
 void AttributionGame<schedulerId>::replaceAdIdWithCompressedAdId(
     std::vector<Touchpoint>& touchpoints,
     std::vector<uint64_t>& validOriginalAdIds) {
-  uint16_t compressedAdId = 1;
-  std::unordered_map<uint64_t, uint16_t> adIdToCompressedAdIdMap;
-
-  for (auto adId : validOriginalAdIds) {
-    adIdToCompressedAdIdMap.insert({adId, compressedAdId});
-    compressedAdId++;
-  }
-
+  // Ad ids missing from validOriginalAdIds, including the default 0, are
+  // compressed to 0
   for (auto& touchpoint : touchpoints) {
-    std::vector<uint64_t> adIds;
-    uint16_t defaultAdId = 0;
-    for (auto& originalAdId : touchpoint.originalAdId) {
-      if (originalAdId > 0) {
-        adIds.push_back(adIdToCompressedAdIdMap.at(originalAdId));
-      } else {
-        adIds.push_back(defaultAdId);
-      }
-    }
-    touchpoint.adId = adIds;
+    touchpoint.adId.resize(touchpoint.originalAdId.size());
+    std::transform(
+        touchpoint.originalAdId.begin(),
+        touchpoint.originalAdId.end(),
+        touchpoint.adId.begin(),
+        [&validOriginalAdIds](uint64_t originalAdId) {
+          return common::compressId(validOriginalAdIds, originalAdId);
+        });
   }
 }
 
@@ -187,7 +209,276 @@ void AttributionGame<schedulerId>::putAdIdMappingJson(
     const CompressedAdIdToOriginalAdId& maps,
     std::string outputPath) {
   std::string content = maps.toJson();
-  fbpcf::io::FileIOWrappers::writeFile(outputPath, content);
+  private_measurement::compressed_io::writeFile(outputPath, content);
+}
+
+template <int schedulerId>
+std::vector<std::vector<SecBit<schedulerId>>>
+AttributionGame<schedulerId>::computeTouchpointsBeforeConversions(
+    const std::vector<PrivateTouchpoint<schedulerId>>& touchpoints,
+    const std::vector<PrivateConversion<schedulerId>>& conversions) {
+  std::vector<std::vector<SecBit<schedulerId>>> isTouchpointBeforeConversion;
+  isTouchpointBeforeConversion.reserve(conversions.size());
+  for (const auto& conv : conversions) {
+    std::vector<SecBit<schedulerId>> isBefore;
+    isBefore.reserve(touchpoints.size());
+    for (const auto& tp : touchpoints) {
+      isBefore.push_back(tp.ts < conv.ts);
+    }
+    isTouchpointBeforeConversion.push_back(std::move(isBefore));
+  }
+  return isTouchpointBeforeConversion;
+}
+
+template <int schedulerId>
+template <typename Rule>
+std::vector<SecBit<schedulerId>>
+AttributionGame<schedulerId>::computeAttributableInWideBatch(
+    const std::vector<PrivateTouchpoint<schedulerId>>& touchpoints,
+    const std::vector<PrivateConversion<schedulerId>>& conversions,
+    const Rule& attributionRule,
+    const std::vector<std::vector<SecTimestamp<schedulerId>>>& thresholds,
+    size_t batchSize,
+    const std::vector<std::vector<SecBit<schedulerId>>>&
+        isTouchpointBeforeConversion) {
+  CHECK_EQ(touchpoints.size(), thresholds.size())
+      << "touchpoints and thresholds are not the same length.";
+
+  // The values of every pair in one batch, touchpoint by touchpoint and then
+  // conversion by conversion, so that the bits of a touchpoint can be split
+  // off in one range
+  auto batchOfPairs = [&](auto valueOf) {
+    std::vector<std::decay_t<decltype(valueOf(0, 0))>> values;
+    values.reserve(touchpoints.size() * conversions.size());
+    for (size_t t = 0; t < touchpoints.size(); ++t) {
+      for (size_t c = 0; c < conversions.size(); ++c) {
+        values.push_back(valueOf(t, c));
+      }
+    }
+    return values.at(0).batchingWith(
+        std::vector(std::next(values.begin()), values.end()));
+  };
+
+  // Only the values compared by the rule are batched
+  PrivateTouchpoint<schedulerId> tp;
+  PrivateConversion<schedulerId> conv;
+  tp.ts = batchOfPairs([&](size_t t, size_t) { return touchpoints.at(t).ts; });
+  conv.ts =
+      batchOfPairs([&](size_t, size_t c) { return conversions.at(c).ts; });
+  if constexpr (Rule::kComparesTargetIds) {
+    tp.targetId = batchOfPairs(
+        [&](size_t t, size_t) { return touchpoints.at(t).targetId; });
+    tp.actionType = batchOfPairs(
+        [&](size_t t, size_t) { return touchpoints.at(t).actionType; });
+    conv.targetId = batchOfPairs(
+        [&](size_t, size_t c) { return conversions.at(c).targetId; });
+    conv.actionType = batchOfPairs(
+        [&](size_t, size_t c) { return conversions.at(c).actionType; });
+  }
+  std::vector<SecTimestamp<schedulerId>> pairThresholds;
+  for (size_t k = 0; k < thresholds.at(0).size(); ++k) {
+    pairThresholds.push_back(batchOfPairs(
+        [&](size_t t, size_t) { return thresholds.at(t).at(k); }));
+  }
+  auto isBefore = isTouchpointBeforeConversion.empty()
+      ? tp.ts < conv.ts
+      : batchOfPairs([&](size_t t, size_t c) {
+          return isTouchpointBeforeConversion.at(c).at(t);
+        });
+
+  return attributionRule.isAttributable(tp, conv, pairThresholds, isBefore)
+      .unbatching(std::make_shared<std::vector<uint32_t>>(
+          touchpoints.size(), conversions.size() * batchSize));
+}
+
+template <int schedulerId>
+template <typename Rule>
+std::vector<AttributionReformattedOutputFmt<schedulerId>>
+AttributionGame<schedulerId>::computeAttributionsBySort(
+    const std::vector<PrivateTouchpoint<schedulerId>>& touchpoints,
+    const std::vector<PrivateConversion<schedulerId>>& conversions,
+    const Rule& attributionRule,
+    const std::vector<std::vector<SecTimestamp<schedulerId>>>& thresholds,
+    size_t batchSize) {
+  CHECK_EQ(touchpoints.size(), thresholds.size())
+      << "touchpoints and thresholds are not the same length.";
+  auto offsets = attributionRule.getThresholdOffsets();
+  CHECK(std::is_sorted(offsets.begin(), offsets.end()))
+      << "The windows of rule " << attributionRule.name
+      << " must be in the order they take precedence.";
+  auto numEvents = touchpoints.size() + conversions.size();
+  CHECK_LT(numEvents, size_t{1} << eventIndexWidth)
+      << "Too many touchpoints and conversions per user to sort.";
+  auto numWindows = thresholds.empty() ? 0 : thresholds.at(0).size();
+
+  // The shares of an int shifted are shares of it shifted, as they are XOR
+  // shares of its bits, so keys are made from timestamps and timestamps taken
+  // back from keys locally
+  auto keyOf = [](const SecTimestamp<schedulerId>& ts) {
+    auto shares = ts.extractIntShare().getValue();
+    for (auto& share : shares) {
+      share <<= eventIndexWidth;
+    }
+    return SecSortKey<schedulerId>(
+        typename SecSortKey<schedulerId>::ExtractedInt(std::move(shares)));
+  };
+  auto timestampOf = [](const SecSortKey<schedulerId>& key) {
+    auto shares = key.extractIntShare().getValue();
+    for (auto& share : shares) {
+      share >>= eventIndexWidth;
+    }
+    return SecTimestamp<schedulerId>(
+        typename SecTimestamp<schedulerId>::ExtractedInt(std::move(shares)));
+  };
+  auto publicBits = [batchSize](bool value) {
+    return SecBit<schedulerId>{
+        std::vector<bool>(batchSize, value), common::PUBLISHER};
+  };
+  auto publicIndex = [batchSize](size_t index) {
+    return SecEventIndex<schedulerId>{
+        std::vector<uint64_t>(batchSize, index), common::PUBLISHER};
+  };
+  SecTimestamp<schedulerId> noWindow{
+      std::vector<uint32_t>(batchSize, 0), common::PUBLISHER};
+  SecAdId<schedulerId> noAdId{
+      std::vector<uint64_t>(batchSize, 0), common::PUBLISHER};
+  PubTimestamp<schedulerId> zero{std::vector<uint32_t>(batchSize, 0)};
+
+  // The events of the users, the conversions and then the touchpoints in the
+  // order of their input, each keyed by its timestamp and then its index. So
+  // a conversion comes before the touchpoints of the same second, which
+  // aren't before it, and touchpoints of the same second stay in the order
+  // the rules prefer them in. Only conversions after time 0, which aren't
+  // padding, are attributed, and only touchpoints have windows
+  struct Event {
+    SecSortKey<schedulerId> key;
+    std::vector<SecTimestamp<schedulerId>> windowEnds;
+    SecAdId<schedulerId> adId;
+    SecBit<schedulerId> isConversion;
+    SecEventIndex<schedulerId> index;
+  };
+  auto indexKey = [batchSize](size_t index) {
+    return PubSortKey<schedulerId>{std::vector<uint64_t>(batchSize, index)};
+  };
+  std::vector<Event> events;
+  events.reserve(numEvents);
+  for (size_t c = 0; c < conversions.size(); ++c) {
+    events.push_back(Event{
+        keyOf(conversions.at(c).ts) + indexKey(c),
+        std::vector<SecTimestamp<schedulerId>>(numWindows, noWindow),
+        noAdId,
+        zero < conversions.at(c).ts,
+        publicIndex(c)});
+  }
+  for (size_t t = 0; t < touchpoints.size(); ++t) {
+    auto index = conversions.size() + t;
+    events.push_back(Event{
+        keyOf(touchpoints.at(t).ts) + indexKey(index),
+        thresholds.at(t),
+        touchpoints.at(t).adId,
+        publicBits(false),
+        publicIndex(index)});
+  }
+
+  auto swapIf =
+      [](const SecBit<schedulerId>& swap, auto& first, auto& second) {
+        auto swapped = first.mux(swap, second);
+        second = second.mux(swap, first);
+        first = std::move(swapped);
+      };
+  auto swapBitsIf = [](const SecBit<schedulerId>& swap,
+                       SecBit<schedulerId>& first,
+                       SecBit<schedulerId>& second) {
+    auto difference = swap & (first ^ second);
+    first = first ^ difference;
+    second = second ^ difference;
+  };
+  auto network = common::makeSortingNetwork(numEvents);
+
+  // Sort the events of each user by their keys
+  for (const auto& layer : network) {
+    for (const auto& [first, second] : layer) {
+      auto& a = events.at(first);
+      auto& b = events.at(second);
+      auto swap = b.key < a.key;
+      swapIf(swap, a.key, b.key);
+      for (size_t k = 0; k < numWindows; ++k) {
+        swapIf(swap, a.windowEnds.at(k), b.windowEnds.at(k));
+      }
+      swapIf(swap, a.adId, b.adId);
+      swapBitsIf(swap, a.isConversion, b.isConversion);
+      swapIf(swap, a.index, b.index);
+    }
+  }
+
+  // The touchpoint of each window which ends the latest among the events up
+  // to each one, the later of them when they end together, which is the
+  // touchpoint of that window the rule prefers before a conversion. Each half
+  // is scanned on its own, then the last result of the left half is carried
+  // into the right half, keeping the depth logarithmic in the number of
+  // events
+  std::vector<SecBit<schedulerId>> attributed(numEvents, publicBits(false));
+  std::vector<SecAdId<schedulerId>> attributedAdIds(numEvents, noAdId);
+  for (size_t k = 0; k < numWindows; ++k) {
+    std::vector<SecTimestamp<schedulerId>> latestEnd;
+    std::vector<SecAdId<schedulerId>> latestAdId;
+    latestEnd.reserve(numEvents);
+    latestAdId.reserve(numEvents);
+    for (const auto& event : events) {
+      latestEnd.push_back(event.windowEnds.at(k));
+      latestAdId.push_back(event.adId);
+    }
+    std::function<void(size_t, size_t)> scan = [&](size_t begin, size_t end) {
+      if (end - begin <= 1) {
+        return;
+      }
+      auto middle = begin + (end - begin) / 2;
+      scan(begin, middle);
+      scan(middle, end);
+      const auto& carriedEnd = latestEnd.at(middle - 1);
+      const auto& carriedAdId = latestAdId.at(middle - 1);
+      for (size_t i = middle; i < end; ++i) {
+        auto isCarried = latestEnd.at(i) < carriedEnd;
+        latestEnd.at(i) = latestEnd.at(i).mux(isCarried, carriedEnd);
+        latestAdId.at(i) = latestAdId.at(i).mux(isCarried, carriedAdId);
+      }
+    };
+    scan(0, numEvents);
+
+    // A later window takes precedence when the conversion is in it
+    for (size_t i = 0; i < numEvents; ++i) {
+      auto isInWindow = timestampOf(events.at(i).key) <= latestEnd.at(i);
+      attributed.at(i) = attributed.at(i) | isInWindow;
+      attributedAdIds.at(i) =
+          attributedAdIds.at(i).mux(isInWindow, latestAdId.at(i));
+    }
+  }
+  for (size_t i = 0; i < numEvents; ++i) {
+    attributed.at(i) = attributed.at(i) & events.at(i).isConversion;
+    attributedAdIds.at(i) =
+        noAdId.mux(attributed.at(i), attributedAdIds.at(i));
+  }
+
+  // Sort the results back to the events they are of, by their index in the
+  // input, with the same network
+  for (const auto& layer : network) {
+    for (const auto& [first, second] : layer) {
+      auto swap = events.at(second).index < events.at(first).index;
+      swapIf(swap, events.at(first).index, events.at(second).index);
+      swapBitsIf(swap, attributed.at(first), attributed.at(second));
+      swapIf(swap, attributedAdIds.at(first), attributedAdIds.at(second));
+    }
+  }
+
+  std::vector<AttributionReformattedOutputFmt<schedulerId>> attributionsOutput;
+  attributionsOutput.reserve(conversions.size());
+  for (size_t c = 0; c < conversions.size(); ++c) {
+    attributionsOutput.push_back(AttributionReformattedOutputFmt<schedulerId>{
+        .ad_id = attributedAdIds.at(c),
+        .conv_value = conversions.at(c).convValue,
+        .is_attributed = attributed.at(c)});
+  }
+  return attributionsOutput;
 }
 
 template <int schedulerId>
@@ -197,11 +488,62 @@ AttributionGame<schedulerId>::computeAttributionsHelper(
     const std::vector<PrivateConversion<schedulerId>>& conversions,
     const AttributionRule<schedulerId>& attributionRule,
     const std::vector<std::vector<SecTimestamp<schedulerId>>>& thresholds,
-    size_t batchSize) {
+    size_t batchSize,
+    const std::vector<std::vector<SecBit<schedulerId>>>&
+        isTouchpointBeforeConversion) {
+  return visitAttributionRule(attributionRule, [&](const auto& rule) {
+    return this->computeAttributionsForRule(
+        touchpoints,
+        conversions,
+        rule,
+        thresholds,
+        batchSize,
+        isTouchpointBeforeConversion);
+  });
+}
+
+template <int schedulerId>
+template <typename Rule>
+const std::vector<SecBit<schedulerId>>
+AttributionGame<schedulerId>::computeAttributionsForRule(
+    const std::vector<PrivateTouchpoint<schedulerId>>& touchpoints,
+    const std::vector<PrivateConversion<schedulerId>>& conversions,
+    const Rule& attributionRule,
+    const std::vector<std::vector<SecTimestamp<schedulerId>>>& thresholds,
+    size_t batchSize,
+    const std::vector<std::vector<SecBit<schedulerId>>>&
+        isTouchpointBeforeConversion) {
   if (batchSize == 0) {
     throw std::invalid_argument(
         "Must provide positive batch size for batch execution!");
   }
+  if (FLAGS_attribution_wide_batch && !touchpoints.empty() &&
+      !conversions.empty()) {
+    // The latest attributable touchpoint of every conversion is chosen in one
+    // scan, then the bits are split by conversion in the order of the chain
+    auto isAttributed = attributeLatestByScan(computeAttributableInWideBatch(
+        touchpoints,
+        conversions,
+        attributionRule,
+        thresholds,
+        batchSize,
+        isTouchpointBeforeConversion));
+    auto byConversion = std::make_shared<std::vector<uint32_t>>(
+        conversions.size(), batchSize);
+    std::vector<std::vector<SecBit<schedulerId>>> isAttributedByTouchpoint;
+    isAttributedByTouchpoint.reserve(isAttributed.size());
+    for (const auto& bits : isAttributed) {
+      isAttributedByTouchpoint.push_back(bits.unbatching(byConversion));
+    }
+    std::vector<SecBit<schedulerId>> attributions;
+    attributions.reserve(conversions.size() * touchpoints.size());
+    for (size_t c = 0; c < conversions.size(); ++c) {
+      for (auto& bits : isAttributedByTouchpoint) {
+        attributions.push_back(std::move(bits.at(c)));
+      }
+    }
+    return attributions;
+  }
   std::vector<SecBit<schedulerId>> attributions;
   // We will be attributing on a sorted vector of touchpoints and conversions
   // (based on timestamps).
@@ -214,7 +556,22 @@ AttributionGame<schedulerId>::computeAttributionsHelper(
   // conversions and touchpoints.
   for (auto conversion = conversions.rbegin(); conversion != conversions.rend();
        ++conversion) {
-    auto conv = *conversion;
+    const auto& conv = *conversion;
+    auto convIndex = static_cast<size_t>(conversions.rend() - conversion) - 1;
+    // Whether a touchpoint is attributable to this conversion, reusing the
+    // comparison of their timestamps when it's shared with other rules
+    auto attributable = [&](size_t i) {
+      const auto& tp = touchpoints.at(i);
+      if (isTouchpointBeforeConversion.empty()) {
+        return attributionRule.isAttributable(
+            tp, conv, thresholds.at(i), tp.ts < conv.ts);
+      }
+      return attributionRule.isAttributable(
+          tp,
+          conv,
+          thresholds.at(i),
+          isTouchpointBeforeConversion.at(convIndex).at(i));
+    };
 
     OMNISCIENT_ONLY_XLOGF(
         DBG,
@@ -230,17 +587,27 @@ AttributionGame<schedulerId>::computeAttributionsHelper(
     CHECK_EQ(touchpoints.size(), thresholds.size())
         << "touchpoints and thresholds are not the same length.";
 
+    if (FLAGS_attribution_scan) {
+      std::vector<SecBit<schedulerId>> isAttributable;
+      isAttributable.reserve(touchpoints.size());
+      for (size_t i = 0; i < touchpoints.size(); ++i) {
+        isAttributable.push_back(attributable(i));
+      }
+      auto isAttributed = attributeLatestByScan(isAttributable);
+      attributions.insert(
+          attributions.end(), isAttributed.rbegin(), isAttributed.rend());
+      continue;
+    }
+
     for (size_t i = touchpoints.size(); i >= 1; --i) {
-      auto tp = touchpoints.at(i - 1);
-      auto threshold = thresholds.at(i - 1);
+      const auto& tp = touchpoints.at(i - 1);
 
       OMNISCIENT_ONLY_XLOGF(
           DBG,
           "Checking touchpoints: {}",
           common::vecToString(tp.ts.openToParty(common::PUBLISHER).getValue()));
 
-      auto isTouchpointAttributable =
-          attributionRule.isAttributable(tp, conv, threshold);
+      auto isTouchpointAttributable = attributable(i - 1);
 
       auto isAttributed = isTouchpointAttributable & !hasAttributedTouchpoint;
 
@@ -267,11 +634,78 @@ AttributionGame<schedulerId>::computeAttributionsHelperV2(
     const std::vector<PrivateConversion<schedulerId>>& conversions,
     const AttributionRule<schedulerId>& attributionRule,
     const std::vector<std::vector<SecTimestamp<schedulerId>>>& thresholds,
-    size_t batchSize) {
+    size_t batchSize,
+    const std::vector<std::vector<SecBit<schedulerId>>>&
+        isTouchpointBeforeConversion) {
+  return visitAttributionRule(attributionRule, [&](const auto& rule) {
+    return this->computeAttributionsForRuleV2(
+        touchpoints,
+        conversions,
+        rule,
+        thresholds,
+        batchSize,
+        isTouchpointBeforeConversion);
+  });
+}
+
+template <int schedulerId>
+template <typename Rule>
+const std::vector<AttributionReformattedOutputFmt<schedulerId>>
+AttributionGame<schedulerId>::computeAttributionsForRuleV2(
+    const std::vector<PrivateTouchpoint<schedulerId>>& touchpoints,
+    const std::vector<PrivateConversion<schedulerId>>& conversions,
+    const Rule& attributionRule,
+    const std::vector<std::vector<SecTimestamp<schedulerId>>>& thresholds,
+    size_t batchSize,
+    const std::vector<std::vector<SecBit<schedulerId>>>&
+        isTouchpointBeforeConversion) {
   if (batchSize == 0) {
     throw std::invalid_argument(
         "Must provide positive batch size for batch execution!");
   }
+  if constexpr (Rule::kAttributesLatestInWindows) {
+    if (FLAGS_attribution_sort && !touchpoints.empty() &&
+        !conversions.empty()) {
+      return computeAttributionsBySort(
+          touchpoints, conversions, attributionRule, thresholds, batchSize);
+    }
+  }
+  if (FLAGS_attribution_wide_batch && !touchpoints.empty() &&
+      !conversions.empty()) {
+    auto isAttributable = computeAttributableInWideBatch(
+        touchpoints,
+        conversions,
+        attributionRule,
+        thresholds,
+        batchSize,
+        isTouchpointBeforeConversion);
+    // The ad ids of the touchpoints, batched over the conversions like
+    // whether they are attributable
+    std::vector<PrivateTouchpoint<schedulerId>> wideTouchpoints(
+        touchpoints.size());
+    for (size_t t = 0; t < touchpoints.size(); ++t) {
+      const auto& adId = touchpoints.at(t).adId;
+      wideTouchpoints.at(t).adId = adId.batchingWith(
+          std::vector<SecAdId<schedulerId>>(conversions.size() - 1, adId));
+    }
+    auto [isAttributed, attributedAdId] = attributeLatestAdIdByScan(
+        wideTouchpoints, isAttributable, conversions.size() * batchSize);
+
+    auto byConversion = std::make_shared<std::vector<uint32_t>>(
+        conversions.size(), batchSize);
+    auto isAttributedByConversion = isAttributed.unbatching(byConversion);
+    auto adIdByConversion = attributedAdId.unbatching(byConversion);
+    std::vector<AttributionReformattedOutputFmt<schedulerId>>
+        attributionsOutput;
+    attributionsOutput.reserve(conversions.size());
+    for (size_t c = 0; c < conversions.size(); ++c) {
+      attributionsOutput.push_back(AttributionReformattedOutputFmt<schedulerId>{
+          .ad_id = adIdByConversion.at(c),
+          .conv_value = conversions.at(c).convValue,
+          .is_attributed = isAttributedByConversion.at(c)});
+    }
+    return attributionsOutput;
+  }
   std::vector<AttributionReformattedOutputFmt<schedulerId>> attributionsOutput;
   // We will be attributing on a sorted vector of touchpoints and conversions
   // (based on timestamps).
@@ -284,7 +718,22 @@ AttributionGame<schedulerId>::computeAttributionsHelperV2(
   // conversions and touchpoints.
   for (auto conversion = conversions.rbegin(); conversion != conversions.rend();
        ++conversion) {
-    auto conv = *conversion;
+    const auto& conv = *conversion;
+    auto convIndex = static_cast<size_t>(conversions.rend() - conversion) - 1;
+    // Whether a touchpoint is attributable to this conversion, reusing the
+    // comparison of their timestamps when it's shared with other rules
+    auto attributable = [&](size_t i) {
+      const auto& tp = touchpoints.at(i);
+      if (isTouchpointBeforeConversion.empty()) {
+        return attributionRule.isAttributable(
+            tp, conv, thresholds.at(i), tp.ts < conv.ts);
+      }
+      return attributionRule.isAttributable(
+          tp,
+          conv,
+          thresholds.at(i),
+          isTouchpointBeforeConversion.at(convIndex).at(i));
+    };
 
     OMNISCIENT_ONLY_XLOGF(
         DBG,
@@ -306,17 +755,30 @@ AttributionGame<schedulerId>::computeAttributionsHelperV2(
     attributedAdId = SecAdId<schedulerId>{
         std::vector<uint64_t>(batchSize, defaultAdId), common::PUBLISHER};
 
+    if (FLAGS_attribution_scan) {
+      std::vector<SecBit<schedulerId>> isAttributable;
+      isAttributable.reserve(touchpoints.size());
+      for (size_t i = 0; i < touchpoints.size(); ++i) {
+        isAttributable.push_back(attributable(i));
+      }
+      std::tie(hasAttributedTouchpoint, attributedAdId) =
+          attributeLatestAdIdByScan(touchpoints, isAttributable, batchSize);
+      attributionsOutput.push_back(AttributionReformattedOutputFmt<schedulerId>{
+          .ad_id = attributedAdId,
+          .conv_value = conv.convValue,
+          .is_attributed = hasAttributedTouchpoint});
+      continue;
+    }
+
     for (size_t i = touchpoints.size(); i >= 1; --i) {
-      auto tp = touchpoints.at(i - 1);
-      auto threshold = thresholds.at(i - 1);
+      const auto& tp = touchpoints.at(i - 1);
 
       OMNISCIENT_ONLY_XLOGF(
           DBG,
           "Checking touchpoints: {}",
           common::vecToString(tp.ts.openToParty(common::PUBLISHER).getValue()));
 
-      auto isTouchpointAttributable =
-          attributionRule.isAttributable(tp, conv, threshold);
+      auto isTouchpointAttributable = attributable(i - 1);
 
       auto isAttributed = isTouchpointAttributable & !hasAttributedTouchpoint;
 
@@ -340,63 +802,327 @@ AttributionGame<schedulerId>::computeAttributionsHelperV2(
   return attributionsOutput;
 }
 
+template <int schedulerId>
+std::vector<SecBit<schedulerId>>
+AttributionGame<schedulerId>::attributeLatestByScan(
+    const std::vector<SecBit<schedulerId>>& isAttributable) {
+  // laterAttributable[i] is whether any touchpoint from i on is attributable.
+  // Each half is scanned on its own, then whether any touchpoint of the right
+  // half is attributable is added to the whole left half, which keeps the
+  // depth logarithmic in the number of touchpoints.
+  std::vector<SecBit<schedulerId>> laterAttributable = isAttributable;
+  std::function<void(size_t, size_t)> scan = [&](size_t begin, size_t end) {
+    if (end - begin <= 1) {
+      return;
+    }
+    auto middle = begin + (end - begin) / 2;
+    scan(begin, middle);
+    scan(middle, end);
+    for (size_t i = begin; i < middle; ++i) {
+      laterAttributable[i] = laterAttributable[i] | laterAttributable[middle];
+    }
+  };
+  scan(0, laterAttributable.size());
+
+  std::vector<SecBit<schedulerId>> isAttributed;
+  isAttributed.reserve(isAttributable.size());
+  for (size_t i = 0; i < isAttributable.size(); ++i) {
+    isAttributed.push_back(
+        i + 1 < isAttributable.size()
+            ? isAttributable[i] & !laterAttributable[i + 1]
+            : isAttributable[i]);
+  }
+  return isAttributed;
+}
+
+template <int schedulerId>
+std::pair<SecBit<schedulerId>, SecAdId<schedulerId>>
+AttributionGame<schedulerId>::attributeLatestAdIdByScan(
+    const std::vector<PrivateTouchpoint<schedulerId>>& touchpoints,
+    const std::vector<SecBit<schedulerId>>& isAttributable,
+    size_t batchSize) {
+  // The result of a range of touchpoints is whether any of them is
+  // attributable and the ad id of the latest attributable one. The result of
+  // the later half of a range takes precedence when it is attributed, and the
+  // ranges start with an unattributed ad id of 0 so that it is the result when
+  // no touchpoint is attributable.
+  using Result = std::pair<SecBit<schedulerId>, SecAdId<schedulerId>>;
+  auto combine = [](const Result& earlier, const Result& later) {
+    return Result{
+        earlier.first | later.first,
+        earlier.second.mux(later.first, later.second)};
+  };
+  std::function<Result(size_t, size_t)> reduce = [&](size_t begin,
+                                                     size_t end) {
+    if (end - begin == 1) {
+      return Result{isAttributable.at(begin), touchpoints.at(begin).adId};
+    }
+    auto middle = begin + (end - begin) / 2;
+    return combine(reduce(begin, middle), reduce(middle, end));
+  };
+
+  Result none{
+      SecBit<schedulerId>{
+          std::vector<bool>(batchSize, false), common::PUBLISHER},
+      SecAdId<schedulerId>{
+          std::vector<uint64_t>(batchSize, 0), common::PUBLISHER}};
+  if (touchpoints.empty()) {
+    return none;
+  }
+  return combine(none, reduce(0, touchpoints.size()));
+}
+
+namespace detail {
+
+// The values of the users in [begin, end) of a touchpoint or conversion, whose
+// vectors are each empty or hold a value per user
+template <typename T>
+std::vector<T>
+sliceUsers(const std::vector<T>& values, size_t begin, size_t end) {
+  if (values.empty()) {
+    return {};
+  }
+  return std::vector<T>(values.begin() + begin, values.begin() + end);
+}
+
+inline std::vector<Touchpoint> sliceUsers(
+    const std::vector<Touchpoint>& touchpoints,
+    size_t begin,
+    size_t end) {
+  std::vector<Touchpoint> out;
+  out.reserve(touchpoints.size());
+  for (const auto& tp : touchpoints) {
+    out.push_back(Touchpoint{
+        .id = sliceUsers(tp.id, begin, end),
+        .isClick = sliceUsers(tp.isClick, begin, end),
+        .ts = sliceUsers(tp.ts, begin, end),
+        .targetId = sliceUsers(tp.targetId, begin, end),
+        .actionType = sliceUsers(tp.actionType, begin, end),
+        .originalAdId = sliceUsers(tp.originalAdId, begin, end),
+        .adId = sliceUsers(tp.adId, begin, end)});
+  }
+  return out;
+}
+
+inline std::vector<Conversion> sliceUsers(
+    const std::vector<Conversion>& conversions,
+    size_t begin,
+    size_t end) {
+  std::vector<Conversion> out;
+  out.reserve(conversions.size());
+  for (const auto& conv : conversions) {
+    out.push_back(Conversion{
+        .ts = sliceUsers(conv.ts, begin, end),
+        .targetId = sliceUsers(conv.targetId, begin, end),
+        .actionType = sliceUsers(conv.actionType, begin, end),
+        .convValue = sliceUsers(conv.convValue, begin, end)});
+  }
+  return out;
+}
+
+// Adds the results of more users, keyed by user id, to those of others
+inline void mergeAttributionResult(
+    AttributionResult& into,
+    const AttributionResult& from) {
+  if (from.isNull()) {
+    return;
+  }
+  if (into.isNull()) {
+    into = from;
+  } else {
+    into.update(from);
+  }
+}
+
+} // namespace detail
+
 template <int schedulerId>
 AttributionOutputMetrics AttributionGame<schedulerId>::computeAttributions(
     const int myRole,
     const AttributionInputMetrics& inputData,
     common::InputEncryption inputEncryption) {
+  auto numIds = inputData.getIds().size();
+  auto usersPerBatch = numIds;
+  if (FLAGS_attribution_users_per_batch > 0) {
+    usersPerBatch = std::min(
+        usersPerBatch, static_cast<size_t>(FLAGS_attribution_users_per_batch));
+  }
+  auto schedulerHints = common::getSchedulerHints(kSchedulerHints);
+  if (schedulerHints.flushRows > 0) {
+    usersPerBatch = std::min(usersPerBatch, schedulerHints.flushRows);
+  }
+  if (numIds > 0 &&
+      (usersPerBatch < numIds || FLAGS_attribution_memory_budget_mb > 0)) {
+    return computeAttributionsInUserBatches(
+        myRole, inputData, inputEncryption, usersPerBatch);
+  }
+
+  fbpcs::performance_tools::ScopedPhase inputSharingPhase{
+      "input_sharing", common::getSchedulerCounterReader<schedulerId>()};
   auto
       [thresholdArraysForEachRule,
        tpArrays,
        convArrays,
        attributionRules,
        ids] = prepareMpcInputs(myRole, inputData, inputEncryption);
+  inputSharingPhase.end();
 
+  fbpcs::performance_tools::ScopedPhase attributionPhase{
+      "attribution", common::getSchedulerCounterReader<schedulerId>()};
   return computeAttributions_impl(
       thresholdArraysForEachRule, tpArrays, convArrays, attributionRules, ids);
 }
 
+template <int schedulerId>
+AttributionOutputMetrics
+AttributionGame<schedulerId>::computeAttributionsInUserBatches(
+    const int myRole,
+    const AttributionInputMetrics& inputData,
+    common::InputEncryption inputEncryption,
+    size_t usersPerBatch) {
+  const auto& ids = inputData.getIds();
+  XLOGF(
+      INFO,
+      "Running attribution on {} ids, {} at a time",
+      ids.size(),
+      usersPerBatch);
+
+  // The ad ids are compressed over every user, so that they are the same in
+  // every batch
+  auto touchpoints = inputData.getTouchpointArrays();
+  if (FLAGS_use_new_output_format) {
+    compressAdIds(myRole, touchpoints, inputEncryption);
+  }
+  auto attributionRules =
+      shareAttributionRules(myRole, inputData.getAttributionRules());
+
+  common::MemoryGovernor::Options governorOptions;
+  governorOptions.budgetBytes =
+      static_cast<uint64_t>(std::max(FLAGS_attribution_memory_budget_mb, 0))
+      << 20;
+  common::MemoryGovernor governor{governorOptions};
+
+  AttributionOutputMetrics out;
+  auto batchSize = usersPerBatch;
+  for (size_t begin = 0, end = 0; begin < ids.size(); begin = end) {
+    if (governor.isEnabled()) {
+      batchSize = agreeOnBatchSize(
+          myRole, governor.nextBatchSize(batchSize, usersPerBatch));
+    }
+    end = std::min(begin + batchSize, ids.size());
+    XLOGF(INFO, "Attributing ids {} to {}", begin, end);
+    fbpcs::performance_tools::ScopedBatch batch{
+        "attribution_users", begin, end - begin};
+
+    fbpcs::performance_tools::ScopedPhase inputSharingPhase{
+        "input_sharing", common::getSchedulerCounterReader<schedulerId>()};
+    auto
+        [thresholdArraysForEachRule,
+         tpArrays,
+         convArrays,
+         batchRules,
+         batchIds] =
+            shareMpcInputs(
+                detail::sliceUsers(touchpoints, begin, end),
+                detail::sliceUsers(inputData.getConversionArrays(), begin, end),
+                attributionRules,
+                std::vector<int64_t>(ids.begin() + begin, ids.begin() + end),
+                inputEncryption);
+    inputSharingPhase.end();
+
+    fbpcs::performance_tools::ScopedPhase attributionPhase{
+        "attribution", common::getSchedulerCounterReader<schedulerId>()};
+    auto batchOut = computeAttributions_impl(
+        thresholdArraysForEachRule, tpArrays, convArrays, batchRules, batchIds);
+    for (const auto& [rule, metrics] : batchOut.ruleToMetrics) {
+      auto& merged = out.ruleToMetrics[rule];
+      for (const auto& [format, result] : metrics.formatToAttribution) {
+        detail::mergeAttributionResult(
+            merged.formatToAttribution[format], result);
+      }
+      detail::mergeAttributionResult(
+          merged.attributionResult, metrics.attributionResult);
+    }
+  }
+  return out;
+}
+
+template <int schedulerId>
+size_t AttributionGame<schedulerId>::agreeOnBatchSize(
+    const int myRole,
+    size_t batchSize) {
+  auto publisherBatchSize = common::
+      shareIntFrom<schedulerId, 64, common::PUBLISHER, common::PARTNER>(
+          myRole, batchSize);
+  auto partnerBatchSize = common::
+      shareIntFrom<schedulerId, 64, common::PARTNER, common::PUBLISHER>(
+          myRole, batchSize);
+  return std::max<size_t>(std::min(publisherBatchSize, partnerBatchSize), 1);
+}
+
+template <int schedulerId>
+void AttributionGame<schedulerId>::compressAdIds(
+    const int myRole,
+    std::vector<Touchpoint>& touchpoints,
+    common::InputEncryption inputEncryption) {
+  XLOG(INFO, "Retrieving original Ad Ids...");
+  auto validOriginalAdIds =
+      retrieveValidOriginalAdIds(myRole, touchpoints, inputEncryption);
+  XLOG(INFO, "Replacing original ad Ids with compressed ad Ids");
+
+  CompressedAdIdToOriginalAdId map;
+  uint16_t compressedAdId = 1;
+  for (auto originalAdId : validOriginalAdIds) {
+    map.compressedAdIdToAdIdMap[std::to_string(compressedAdId)] = originalAdId;
+    compressedAdId++;
+  }
+  std::string outputJsonFilename =
+      FLAGS_output_base_path + "compressionMapping.json";
+  putAdIdMappingJson(map, outputJsonFilename);
+
+  // replace adId with compressed adId:
+  replaceAdIdWithCompressedAdId(touchpoints, validOriginalAdIds);
+}
+
 template <int schedulerId>
 MpcInputs<schedulerId> AttributionGame<schedulerId>::prepareMpcInputs(
     const int myRole,
     const AttributionInputMetrics& inputData,
     common::InputEncryption inputEncryption) {
   XLOG(INFO, "Running attribution");
-  auto ids = inputData.getIds();
 
   // Compress the original ad id when new format is used:
   auto touchpoints = inputData.getTouchpointArrays();
   if (FLAGS_use_new_output_format) {
-    XLOG(INFO, "Retrieving original Ad Ids...");
-    auto validOriginalAdIds =
-        retrieveValidOriginalAdIds(myRole, touchpoints, inputEncryption);
-    XLOG(INFO, "Replacing original ad Ids with compressed ad Ids");
-
-    CompressedAdIdToOriginalAdId map;
-    uint16_t compressedAdId = 1;
-    for (auto originalAdId : validOriginalAdIds) {
-      map.compressedAdIdToAdIdMap[std::to_string(compressedAdId)] =
-          originalAdId;
-      compressedAdId++;
-    }
-    std::string outputJsonFilename =
-        FLAGS_output_base_path + "compressionMapping.json";
-    putAdIdMappingJson(map, outputJsonFilename);
-
-    // replace adId with compressed adId:
-    replaceAdIdWithCompressedAdId(touchpoints, validOriginalAdIds);
+    compressAdIds(myRole, touchpoints, inputEncryption);
   }
-  // Send over all of the data needed for this computation
-  XLOG(INFO, "Privately sharing touchpoints...");
-  auto tpArrays = privatelyShareTouchpoints(touchpoints, inputEncryption);
-  XLOG(INFO, "Privately sharing conversions...");
-  auto convArrays = privatelyShareConversions(
-      inputData.getConversionArrays(), inputEncryption);
 
   // Publisher shares attribution rules with partner
   auto attributionRules =
       shareAttributionRules(myRole, inputData.getAttributionRules());
 
+  return shareMpcInputs(
+      touchpoints,
+      inputData.getConversionArrays(),
+      std::move(attributionRules),
+      inputData.getIds(),
+      inputEncryption);
+}
+
+template <int schedulerId>
+MpcInputs<schedulerId> AttributionGame<schedulerId>::shareMpcInputs(
+    const std::vector<Touchpoint>& touchpoints,
+    const std::vector<Conversion>& conversions,
+    std::vector<std::shared_ptr<const AttributionRule<schedulerId>>>
+        attributionRules,
+    std::vector<int64_t> ids,
+    common::InputEncryption inputEncryption) {
+  // Send over all of the data needed for this computation
+  XLOG(INFO, "Privately sharing touchpoints...");
+  auto tpArrays = privatelyShareTouchpoints(touchpoints, inputEncryption);
+  XLOG(INFO, "Privately sharing conversions...");
+  auto convArrays = privatelyShareConversions(conversions, inputEncryption);
+
   std::vector<std::vector<std::vector<SecTimestamp<schedulerId>>>>
       thresholdArraysForEachRule;
   thresholdArraysForEachRule.reserve(attributionRules.size());
@@ -409,7 +1135,11 @@ MpcInputs<schedulerId> AttributionGame<schedulerId>::prepareMpcInputs(
         << "threshold arrays and touchpoint arrays are not the same length.";
   }
   return {
-      thresholdArraysForEachRule, tpArrays, convArrays, attributionRules, ids};
+      std::move(thresholdArraysForEachRule),
+      std::move(tpArrays),
+      std::move(convArrays),
+      std::move(attributionRules),
+      std::move(ids)};
 }
 
 template <int schedulerId>
@@ -428,6 +1158,21 @@ AttributionOutputMetrics AttributionGame<schedulerId>::computeAttributions_impl(
   // Currently we only have one attribution output format
   std::string attributionFormat = "default";
 
+  // The rules share the comparisons of the touchpoint and conversion
+  // timestamps, so they are computed once when there are several rules,
+  // unless every rule attributes by sorting without them
+  bool attributesBySort = FLAGS_attribution_sort &&
+      FLAGS_use_new_output_format &&
+      std::all_of(
+          attributionRules.begin(),
+          attributionRules.end(),
+          [](const auto& rule) { return attributesLatestInWindows(*rule); });
+  std::vector<std::vector<SecBit<schedulerId>>> isTouchpointBeforeConversion;
+  if (attributionRules.size() > 1 && !attributesBySort) {
+    isTouchpointBeforeConversion =
+        computeTouchpointsBeforeConversions(tpArrays, convArrays);
+  }
+
   // Compute for all of the given attribution rules
   AttributionMetrics attributionMetrics;
   AttributionOutputMetrics out;
@@ -443,7 +1188,12 @@ AttributionOutputMetrics AttributionGame<schedulerId>::computeAttributions_impl(
           attributionsReformatted;
 
       attributionsReformatted = computeAttributionsHelperV2(
-          tpArrays, convArrays, *attributionRule, thresholdArrays, numIds);
+          tpArrays,
+          convArrays,
+          *attributionRule,
+          thresholdArrays,
+          numIds,
+          isTouchpointBeforeConversion);
 
       AttributionReformattedOutput<schedulerId> attributionReformattedOutput{
           ids, attributionsReformatted};
@@ -458,7 +1208,12 @@ AttributionOutputMetrics AttributionGame<schedulerId>::computeAttributions_impl(
       std::vector<SecBit<schedulerId>> attributions;
 
       attributions = computeAttributionsHelper(
-          tpArrays, convArrays, *attributionRule, thresholdArrays, numIds);
+          tpArrays,
+          convArrays,
+          *attributionRule,
+          thresholdArrays,
+          numIds,
+          isTouchpointBeforeConversion);
 
       AttributionOutput<schedulerId> attributionOutput{ids, attributions};
 
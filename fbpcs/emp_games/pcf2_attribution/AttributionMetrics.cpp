@@ -6,12 +6,15 @@
  */
 
 #include <re2/re2.h>
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <map>
+#include <numeric>
 #include <unordered_set>
 
 #include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/InputRow.h"
 #include "fbpcs/emp_games/common/Util.h"
 #include "fbpcs/emp_games/pcf2_attribution/AttributionMetrics.h"
 #include "fbpcs/emp_games/pcf2_attribution/AttributionOptions.h"
@@ -19,45 +22,84 @@
 
 namespace pcf2_attribution {
 
-const std::vector<ParsedTouchpoint> AttributionInputMetrics::parseTouchpoints(
-    const int /* myRole*/,
-    const int /* lineNo */,
-    const std::vector<std::string>& header,
-    const std::vector<std::string>& parts,
-    common::InputEncryption inputEncryption) {
+namespace {
+
+// The columns touchpoints and conversions are parsed from. The other columns
+// of an input, such as the ids or metadata carried along for aggregation,
+// aren't tokenized.
+const std::vector<std::string> kInputColumns = {
+    "timestamps",
+    "is_click",
+    "target_id",
+    "action_type",
+    "ad_ids",
+    "conversion_timestamps",
+    "conversion_target_id",
+    "conversion_action_type",
+    "conversion_values"};
+
+// Buffers for parsing a single row. They are reused across rows so that once
+// they have grown, parsing a row doesn't allocate.
+struct RowBuffers {
   std::vector<uint64_t> timestamps;
+  std::vector<uint64_t> isClickShares;
   std::vector<bool> isClicks;
   std::vector<uint64_t> targetId;
   std::vector<uint64_t> actionType;
   std::vector<uint64_t> adIds;
+  std::vector<uint64_t> convValue;
+  std::vector<ParsedTouchpoint> tps;
+  std::vector<ParsedConversion> convs;
+};
+
+/**
+ * Parse touchpoints into buffers.tps and add padding if necessary. Row is a
+ * common::CsvInputRow or a common::RowGroupInputRow.
+ */
+template <typename Row>
+void parseTouchpoints(
+    const std::vector<std::string>& header,
+    const Row& row,
+    common::InputEncryption inputEncryption,
+    RowBuffers& buffers) {
+  auto& timestamps = buffers.timestamps;
+  auto& isClicks = buffers.isClicks;
+  auto& targetId = buffers.targetId;
+  auto& actionType = buffers.actionType;
+  auto& adIds = buffers.adIds;
+  timestamps.clear();
+  isClicks.clear();
+  targetId.clear();
+  actionType.clear();
+  adIds.clear();
   bool targetIdPresent = false;
   bool actionTypePresent = false;
 
-  for (auto i = 0U; i < header.size(); ++i) {
+  // A csv row ends at the last of kInputColumns
+  for (auto i = 0U; i < std::min(header.size(), row.size()); ++i) {
     const auto& column = header[i];
-    const auto& value = parts[i];
     if (column == "timestamps") {
-      timestamps = common::getInnerArray<uint64_t>(value);
+      row.appendArray(i, timestamps);
     } else if (column == "is_click") {
       if (inputEncryption == common::InputEncryption::Xor) {
         // input is 64-bit secret shares
-        std::vector<uint64_t> isClickShares =
-            common::getInnerArray<uint64_t>(value);
-        for (auto isClickShare : isClickShares) {
+        buffers.isClickShares.clear();
+        row.appendArray(i, buffers.isClickShares);
+        for (auto isClickShare : buffers.isClickShares) {
           // suffices to read last bit
           isClicks.push_back(isClickShare & 1);
         }
       } else {
-        isClicks = common::getInnerArray<bool>(value);
+        row.appendArray(i, isClicks);
       }
     } else if (column == "target_id") {
       targetIdPresent = true;
-      targetId = common::getInnerArray<uint64_t>(value);
+      row.appendArray(i, targetId);
     } else if (column == "action_type") {
       actionTypePresent = true;
-      actionType = common::getInnerArray<uint64_t>(value);
+      row.appendArray(i, actionType);
     } else if (column == "ad_ids") {
-      adIds = common::getInnerArray<uint64_t>(value);
+      row.appendArray(i, adIds);
     }
   }
 
@@ -79,9 +121,8 @@ const std::vector<ParsedTouchpoint> AttributionInputMetrics::parseTouchpoints(
     }
   }
 
-  std::vector<ParsedTouchpoint> tps;
-  tps.reserve(static_cast<std::size_t>(FLAGS_max_num_touchpoints));
-
+  auto& tps = buffers.tps;
+  tps.clear();
   for (size_t i = 0U; i < timestamps.size(); ++i) {
     tps.push_back(ParsedTouchpoint{
         /* id */ static_cast<std::int64_t>(i),
@@ -104,38 +145,43 @@ const std::vector<ParsedTouchpoint> AttributionInputMetrics::parseTouchpoints(
 
   // Add padding at the end of the input data for publisher; partner data
   // consists only of padded data
-  if (tps.size() < static_cast<std::size_t>(FLAGS_max_num_touchpoints)) {
-    tps.resize(static_cast<std::size_t>(FLAGS_max_num_touchpoints));
-  }
-  return tps;
+  tps.resize(static_cast<std::size_t>(FLAGS_max_num_touchpoints));
 }
 
-const std::vector<ParsedConversion> AttributionInputMetrics::parseConversions(
-    const int /*myRole*/,
+/**
+ * Parse conversions into buffers.convs and add padding if necessary.
+ */
+template <typename Row>
+void parseConversions(
     const std::vector<std::string>& header,
-    const std::vector<std::string>& parts,
-    common::InputEncryption inputEncryption) {
-  std::vector<uint64_t> convTimestamps;
-  std::vector<uint64_t> targetId;
-  std::vector<uint64_t> actionType;
-  std::vector<uint64_t> convValue;
+    const Row& row,
+    common::InputEncryption inputEncryption,
+    RowBuffers& buffers) {
+  auto& convTimestamps = buffers.timestamps;
+  auto& targetId = buffers.targetId;
+  auto& actionType = buffers.actionType;
+  auto& convValue = buffers.convValue;
+  convTimestamps.clear();
+  targetId.clear();
+  actionType.clear();
+  convValue.clear();
   bool targetIdPresent = false;
   bool actionTypePresent = false;
 
-  for (auto i = 0; i < header.size(); ++i) {
+  // A csv row ends at the last of kInputColumns
+  for (auto i = 0U; i < std::min(header.size(), row.size()); ++i) {
     const auto& column = header[i];
-    const auto& value = parts[i];
 
     if (column == "conversion_timestamps") {
-      convTimestamps = common::getInnerArray<uint64_t>(value);
+      row.appendArray(i, convTimestamps);
     } else if (column == "conversion_target_id") {
       targetIdPresent = true;
-      targetId = common::getInnerArray<uint64_t>(value);
+      row.appendArray(i, targetId);
     } else if (column == "conversion_action_type") {
       actionTypePresent = true;
-      actionType = common::getInnerArray<uint64_t>(value);
+      row.appendArray(i, actionType);
     } else if (column == "conversion_values") {
-      convValue = common::getInnerArray<uint64_t>(value);
+      row.appendArray(i, convValue);
     }
   }
 
@@ -155,7 +201,8 @@ const std::vector<ParsedConversion> AttributionInputMetrics::parseConversions(
     }
   }
 
-  std::vector<ParsedConversion> convs;
+  auto& convs = buffers.convs;
+  convs.clear();
   for (auto i = 0U; i < convTimestamps.size(); ++i) {
     convs.push_back(ParsedConversion{
         /* ts */ convTimestamps.at(i),
@@ -172,92 +219,74 @@ const std::vector<ParsedConversion> AttributionInputMetrics::parseConversions(
 
   // Add padding at the end of the input data for partner; publisher data
   // consists only of padded data
-  if (convs.size() < static_cast<std::size_t>(FLAGS_max_num_conversions)) {
-    convs.resize(static_cast<std::size_t>(FLAGS_max_num_conversions));
-  }
-  return convs;
+  convs.resize(static_cast<std::size_t>(FLAGS_max_num_conversions));
 }
 
-const std::vector<Touchpoint>
-AttributionInputMetrics::convertParsedTouchpointsToTouchpoints(
-    const std::vector<std::vector<ParsedTouchpoint>>& parsedTouchpoints) {
-  std::vector<Touchpoint> touchpoints;
-
-  std::vector<std::vector<int64_t>> ids(
-      FLAGS_max_num_touchpoints, std::vector<int64_t>{});
-  std::vector<std::vector<bool>> isClicks(
-      FLAGS_max_num_touchpoints, std::vector<bool>{});
-  std::vector<std::vector<uint64_t>> timestamps(
-      FLAGS_max_num_touchpoints, std::vector<uint64_t>{});
-  std::vector<std::vector<uint64_t>> targetIds(
-      FLAGS_max_num_touchpoints, std::vector<uint64_t>{});
-  std::vector<std::vector<uint64_t>> actionTypes(
-      FLAGS_max_num_touchpoints, std::vector<uint64_t>{});
-  std::vector<std::vector<uint64_t>> originalAdIds(
-      FLAGS_max_num_touchpoints, std::vector<uint64_t>{});
-  std::vector<std::vector<uint64_t>> adIds(
-      FLAGS_max_num_touchpoints, std::vector<uint64_t>{});
-
-  // The touchpoints are parsed row by row, whereas the batches are across
-  // rows.
-  for (size_t i = 0; i < parsedTouchpoints.size(); ++i) {
-    for (size_t j = 0; j < FLAGS_max_num_touchpoints; ++j) {
-      auto parsedTouchpoint = parsedTouchpoints.at(i).at(j);
-      ids.at(j).push_back(parsedTouchpoint.id);
-      isClicks.at(j).push_back(parsedTouchpoint.isClick);
-      timestamps.at(j).push_back(parsedTouchpoint.ts);
-      targetIds.at(j).push_back(parsedTouchpoint.targetId);
-      actionTypes.at(j).push_back(parsedTouchpoint.actionType);
-      originalAdIds.at(j).push_back(parsedTouchpoint.originalAdId);
-      adIds.at(j).push_back(parsedTouchpoint.adId);
-    }
+// The touchpoints are parsed row by row, whereas the batches are across rows,
+// so each parsed touchpoint is appended to the column of its slot.
+void appendTouchpoints(
+    const std::vector<ParsedTouchpoint>& tps,
+    std::vector<Touchpoint>& tpArrays) {
+  for (size_t j = 0; j < tps.size(); ++j) {
+    const auto& parsedTouchpoint = tps[j];
+    auto& touchpoint = tpArrays[j];
+    touchpoint.id.push_back(parsedTouchpoint.id);
+    touchpoint.isClick.push_back(parsedTouchpoint.isClick);
+    touchpoint.ts.push_back(parsedTouchpoint.ts);
+    touchpoint.targetId.push_back(parsedTouchpoint.targetId);
+    touchpoint.actionType.push_back(parsedTouchpoint.actionType);
+    touchpoint.originalAdId.push_back(parsedTouchpoint.originalAdId);
+    touchpoint.adId.push_back(parsedTouchpoint.adId);
   }
-  for (size_t i = 0; i < FLAGS_max_num_touchpoints; ++i) {
-    touchpoints.push_back(Touchpoint{
-        ids.at(i),
-        isClicks.at(i),
-        timestamps.at(i),
-        targetIds.at(i),
-        actionTypes.at(i),
-        originalAdIds.at(i),
-        adIds.at(i)});
+}
+
+void appendConversions(
+    const std::vector<ParsedConversion>& convs,
+    std::vector<Conversion>& convArrays) {
+  for (size_t j = 0; j < convs.size(); ++j) {
+    const auto& parsedConversion = convs[j];
+    auto& conversion = convArrays[j];
+    conversion.ts.push_back(parsedConversion.ts);
+    conversion.targetId.push_back(parsedConversion.targetId);
+    conversion.actionType.push_back(parsedConversion.actionType);
+    conversion.convValue.push_back(parsedConversion.convValue);
   }
+}
 
-  return touchpoints;
+template <typename T>
+void appendColumn(std::vector<T>& to, const std::vector<T>& from) {
+  to.insert(to.end(), from.begin(), from.end());
 }
 
-const std::vector<Conversion>
-AttributionInputMetrics::convertParsedConversionsToConversions(
-    const std::vector<std::vector<ParsedConversion>>& parsedConversions) {
-  std::vector<Conversion> conversions;
-
-  std::vector<std::vector<uint64_t>> timestamps(
-      FLAGS_max_num_conversions, std::vector<uint64_t>{});
-  std::vector<std::vector<uint64_t>> targetIds(
-      FLAGS_max_num_touchpoints, std::vector<uint64_t>{});
-  std::vector<std::vector<uint64_t>> actionTypes(
-      FLAGS_max_num_touchpoints, std::vector<uint64_t>{});
-  std::vector<std::vector<uint64_t>> values(
-      FLAGS_max_num_touchpoints, std::vector<uint64_t>{});
-
-  // The conversions are parsed row by row, whereas the batches are across
-  // rows.
-  for (const auto& oneBatchedParsedConversions : parsedConversions) {
-    for (size_t j = 0; j < oneBatchedParsedConversions.size(); ++j) {
-      timestamps.at(j).push_back(oneBatchedParsedConversions.at(j).ts);
-      targetIds.at(j).push_back(oneBatchedParsedConversions.at(j).targetId);
-      actionTypes.at(j).push_back(oneBatchedParsedConversions.at(j).actionType);
-      values.at(j).push_back(oneBatchedParsedConversions.at(j).convValue);
-    }
-  }
-  for (size_t i = 0; i < timestamps.size(); ++i) {
-    conversions.push_back(Conversion{
-        timestamps.at(i), targetIds.at(i), actionTypes.at(i), values.at(i)});
+// Appends the rows parsed into a later chunk after the rows already in
+// tpArrays, slot by slot.
+void appendTouchpointChunk(
+    const std::vector<Touchpoint>& chunk,
+    std::vector<Touchpoint>& tpArrays) {
+  for (size_t j = 0; j < chunk.size(); ++j) {
+    appendColumn(tpArrays[j].id, chunk[j].id);
+    appendColumn(tpArrays[j].isClick, chunk[j].isClick);
+    appendColumn(tpArrays[j].ts, chunk[j].ts);
+    appendColumn(tpArrays[j].targetId, chunk[j].targetId);
+    appendColumn(tpArrays[j].actionType, chunk[j].actionType);
+    appendColumn(tpArrays[j].originalAdId, chunk[j].originalAdId);
+    appendColumn(tpArrays[j].adId, chunk[j].adId);
   }
+}
 
-  return conversions;
+void appendConversionChunk(
+    const std::vector<Conversion>& chunk,
+    std::vector<Conversion>& convArrays) {
+  for (size_t j = 0; j < chunk.size(); ++j) {
+    appendColumn(convArrays[j].ts, chunk[j].ts);
+    appendColumn(convArrays[j].targetId, chunk[j].targetId);
+    appendColumn(convArrays[j].actionType, chunk[j].actionType);
+    appendColumn(convArrays[j].convValue, chunk[j].convValue);
+  }
 }
 
+} // namespace
+
 AttributionInputMetrics::AttributionInputMetrics(
     int myRole,
     std::string attributionRulesStr,
@@ -271,36 +300,90 @@ AttributionInputMetrics::AttributionInputMetrics(
         private_measurement::csv::splitByComma(attributionRulesStr, false);
   }
 
-  // Parse the input CSV
-  std::vector<std::vector<ParsedTouchpoint>> parsedTouchpoints;
-  std::vector<std::vector<ParsedConversion>> parsedConversions;
-  auto lineNo = 0;
-  bool success = private_measurement::csv::readCsv(
-      filepath,
-      [&](const std::vector<std::string>& header,
-          const std::vector<std::string>& parts) {
-        if (lineNo == 0) {
-          XLOGF(DBG, "{}", common::vecToString(header));
-        }
-        XLOGF(DBG, "{}: {}", lineNo, common::vecToString(parts));
-        ids_.push_back(lineNo);
-
-        parsedTouchpoints.push_back(
-            parseTouchpoints(myRole, lineNo, header, parts, inputEncryption));
-        parsedConversions.push_back(
-            parseConversions(myRole, header, parts, inputEncryption));
+  // Size all of the columns up front so that appending rows never reallocates
+  auto numRows = private_measurement::csv::countCsvRows(filepath);
+  ids_.reserve(numRows);
+  tpArrays_.resize(FLAGS_max_num_touchpoints);
+  for (auto& touchpoint : tpArrays_) {
+    touchpoint.id.reserve(numRows);
+    touchpoint.isClick.reserve(numRows);
+    touchpoint.ts.reserve(numRows);
+    touchpoint.targetId.reserve(numRows);
+    touchpoint.actionType.reserve(numRows);
+    touchpoint.originalAdId.reserve(numRows);
+    touchpoint.adId.reserve(numRows);
+  }
+  convArrays_.resize(FLAGS_max_num_conversions);
+  for (auto& conversion : convArrays_) {
+    conversion.ts.reserve(numRows);
+    conversion.targetId.reserve(numRows);
+    conversion.actionType.reserve(numRows);
+    conversion.convValue.reserve(numRows);
+  }
 
-        lineNo++;
-      });
+  // Parse the input CSV, in parallel chunks if requested. The rows of the
+  // first chunk go straight into the columns above, the rows of every later
+  // chunk are collected separately and appended in chunk order afterwards so
+  // that the order of the file is kept.
+  size_t numChunks = std::max(FLAGS_input_parse_threads, 1);
+  std::vector<RowBuffers> buffers(numChunks);
+  std::vector<size_t> chunkRows(numChunks);
+  std::vector<std::vector<Touchpoint>> chunkTpArrays(
+      numChunks - 1, std::vector<Touchpoint>(FLAGS_max_num_touchpoints));
+  std::vector<std::vector<Conversion>> chunkConvArrays(
+      numChunks - 1, std::vector<Conversion>(FLAGS_max_num_conversions));
+
+  // Inputs in the row group format are typed already, so their arrays are
+  // copied rather than formatted back to text and parsed again
+  auto readGroup = [&](const private_measurement::row_group::Schema& schema,
+                       const private_measurement::row_group::RowGroup& group) {
+    auto header = common::getRowGroupHeader(schema);
+    auto& rowBuffers = buffers[0];
+    for (size_t row = 0; row < group.numRows; ++row) {
+      common::RowGroupInputRow inputRow{schema, group, row};
+      parseTouchpoints(header, inputRow, inputEncryption, rowBuffers);
+      appendTouchpoints(rowBuffers.tps, tpArrays_);
+      parseConversions(header, inputRow, inputEncryption, rowBuffers);
+      appendConversions(rowBuffers.convs, convArrays_);
+    }
+    chunkRows[0] += group.numRows;
+  };
+  auto readLine = [&](size_t chunk,
+                      const std::vector<std::string>& header,
+                      const std::vector<std::string_view>& parts) {
+    auto lineNo = chunkRows[chunk]++;
+    if (chunk == 0 && lineNo == 0) {
+      XLOGF(DBG, "{}", common::vecToString(header));
+    }
+    XLOGF(DBG, "{}/{}: {}", chunk, lineNo, common::vecToString(parts));
+
+    auto& rowBuffers = buffers[chunk];
+    auto& tpArrays = chunk == 0 ? tpArrays_ : chunkTpArrays[chunk - 1];
+    auto& convArrays = chunk == 0 ? convArrays_ : chunkConvArrays[chunk - 1];
+    common::CsvInputRow inputRow{parts};
+    parseTouchpoints(header, inputRow, inputEncryption, rowBuffers);
+    appendTouchpoints(rowBuffers.tps, tpArrays);
+    parseConversions(header, inputRow, inputEncryption, rowBuffers);
+    appendConversions(rowBuffers.convs, convArrays);
+  };
+  bool success =
+      private_measurement::csv::readRowGroups(filepath, readGroup) ||
+      private_measurement::csv::readCsvViewsInChunks(
+          filepath, numChunks, readLine, [](auto) {}, kInputColumns);
 
   if (!success) {
     XLOGF(FATAL, "Failed to read input file {},", filepath.string());
   }
 
-  // Convert from parsed touchpoints and conversions to touchpoints and
-  // conversions
-  tpArrays_ = convertParsedTouchpointsToTouchpoints(parsedTouchpoints);
-  convArrays_ = convertParsedConversionsToConversions(parsedConversions);
+  for (size_t chunk = 1; chunk < numChunks; ++chunk) {
+    appendTouchpointChunk(chunkTpArrays[chunk - 1], tpArrays_);
+    appendConversionChunk(chunkConvArrays[chunk - 1], convArrays_);
+  }
+  auto totalRows =
+      std::accumulate(chunkRows.begin(), chunkRows.end(), size_t{0});
+  for (size_t lineNo = 0; lineNo < totalRows; ++lineNo) {
+    ids_.push_back(lineNo);
+  }
 }
 
 } // namespace pcf2_attribution
@@ -9,8 +9,15 @@
 
 #include <folly/dynamic.h>
 #include <folly/json.h>
+#include <algorithm>
 #include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "fbpcf/io/api/BufferedWriter.h"
+#include "fbpcs/emp_games/common/AttributionShareFormat.h"
 #include "fbpcs/emp_games/common/Csv.h"
 
 #include "fbpcs/emp_games/pcf2_attribution/AttributionOptions.h"
@@ -55,38 +62,69 @@ class AttributionInputMetrics {
   std::vector<std::string> attributionRules_;
   std::vector<Touchpoint> tpArrays_;
   std::vector<Conversion> convArrays_;
+};
 
-  /**
-   * Parse touchpoints and add padding if necessary.
-   */
-  const std::vector<ParsedTouchpoint> parseTouchpoints(
-      const int myRole,
-      const int lineNo,
-      const std::vector<std::string>& header,
-      const std::vector<std::string>& parts,
-      common::InputEncryption inputEncryption);
-
-  /**
-   * Parse conversions and add padding if necessary.
-   */
-  const std::vector<ParsedConversion> parseConversions(
-      const int myRole,
-      const std::vector<std::string>& header,
-      const std::vector<std::string>& parts,
-      common::InputEncryption inputEncryption);
+namespace detail {
+
+// Writes a JSON object one member at a time, so that only one member is
+// serialized in memory at once
+inline void writeJsonObject(
+    fbpcf::io::BufferedWriter& writer,
+    const folly::dynamic& obj) {
+  std::string json;
+  if (!obj.isObject()) {
+    json = folly::toJson(obj);
+    writer.writeString(json);
+    return;
+  }
+  bool first = true;
+  for (const auto& [key, value] : obj.items()) {
+    json =
+        (first ? "{" : ",") + folly::toJson(key) + ":" + folly::toJson(value);
+    writer.writeString(json);
+    first = false;
+  }
+  json = first ? "{}" : "}";
+  writer.writeString(json);
+}
+
+// The binary shares of the results of a rule, given as an object from user id
+// to the results of the user
+inline private_measurement::attribution_shares::RuleShares toRuleShares(
+    const std::string& rule,
+    bool reformatted,
+    const folly::dynamic& resultsPerUser) {
+  std::vector<std::pair<int64_t, const folly::dynamic*>> users;
+  for (const auto& [uid, results] : resultsPerUser.items()) {
+    users.emplace_back(uid.asInt(), &results);
+  }
+  std::sort(users.begin(), users.end(), [](const auto& a, const auto& b) {
+    return a.first < b.first;
+  });
+
+  private_measurement::attribution_shares::RuleShares shares{
+      rule,
+      reformatted,
+      users.size(),
+      users.empty() ? 0U : static_cast<uint32_t>(users.front().second->size())};
+  for (const auto& [uid, results] : users) {
+    if (results->size() != shares.resultsPerUser) {
+      throw std::invalid_argument(
+          "Users of rule " + rule + " have different numbers of results");
+    }
+    for (const auto& result : *results) {
+      shares.isAttributed.push_back(result["is_attributed"].asBool());
+      if (reformatted) {
+        shares.adIds.push_back(static_cast<uint16_t>(result["ad_id"].asInt()));
+        shares.convValues.push_back(
+            static_cast<uint32_t>(result["conv_value"].asInt()));
+      }
+    }
+  }
+  return shares;
+}
 
-  /**
-   * Convert parsed touchpoints into touchpoints.
-   */
-  const std::vector<Touchpoint> convertParsedTouchpointsToTouchpoints(
-      const std::vector<std::vector<ParsedTouchpoint>>& parsedTouchpoints);
-
-  /**
-   * Convert parsed conversions into conversions.
-   */
-  const std::vector<Conversion> convertParsedConversionsToConversions(
-      const std::vector<std::vector<ParsedConversion>>& parsedConversions);
-};
+} // namespace detail
 
 /*
  * This class stores the attribution results for each attribution format.
@@ -134,6 +172,25 @@ struct AttributionMetrics {
     return folly::toJson(obj);
   }
 
+  // Writes the same JSON as toJson without building it as a whole
+  void writeJson(fbpcf::io::BufferedWriter& writer) const {
+    if (FLAGS_use_new_output_format) {
+      detail::writeJsonObject(writer, attributionResult);
+      return;
+    }
+    std::string json;
+    bool first = true;
+    for (const auto& [attributionName, attributionMetrics] :
+         formatToAttribution) {
+      json = (first ? "{" : ",") + folly::toJson(attributionName) + ":";
+      writer.writeString(json);
+      detail::writeJsonObject(writer, attributionMetrics);
+      first = false;
+    }
+    json = first ? "{}" : "}";
+    writer.writeString(json);
+  }
+
   static AttributionMetrics fromJson(const std::string& str) {
     auto obj = folly::parseJson(str);
     return fromDynamic(obj);
@@ -178,6 +235,41 @@ struct AttributionOutputMetrics {
     return folly::toPrettyJson(obj);
   }
 
+  // Writes the output as JSON one user at a time, instead of building the
+  // tree and string of toJson for all of the users, which for large inputs
+  // take many times the memory of the results themselves. The JSON isn't
+  // pretty printed, but parses to the same output
+  void writeJson(fbpcf::io::BufferedWriter& writer) const {
+    std::string json;
+    bool first = true;
+    for (const auto& [ruleName, metrics] : ruleToMetrics) {
+      json = (first ? "{" : ",") + folly::toJson(ruleName) + ":";
+      writer.writeString(json);
+      metrics.writeJson(writer);
+      first = false;
+    }
+    json = first ? "{}" : "}";
+    writer.writeString(json);
+  }
+
+  // The results in the binary format pcf2_aggregation reads, with the results
+  // of every format of a rule under the name of the rule
+  std::vector<private_measurement::attribution_shares::RuleShares> toShares()
+      const {
+    std::vector<private_measurement::attribution_shares::RuleShares> shares;
+    for (const auto& [ruleName, metrics] : ruleToMetrics) {
+      if (FLAGS_use_new_output_format) {
+        shares.push_back(
+            detail::toRuleShares(ruleName, true, metrics.attributionResult));
+        continue;
+      }
+      for (const auto& [format, result] : metrics.formatToAttribution) {
+        shares.push_back(detail::toRuleShares(ruleName, false, result));
+      }
+    }
+    return shares;
+  }
+
   static AttributionOutputMetrics fromJson(const std::string& str) {
     auto obj = folly::parseJson(str);
     return fromDynamic(obj);
@@ -26,6 +26,12 @@ DEFINE_int32(
     0,
     "First file that will be read with base path");
 DEFINE_int32(num_files, 0, "Number of files that should be read");
+DEFINE_string(
+    job_list,
+    "",
+    "Local or s3 path of a list of jobs to run instead of the base paths, one "
+    "<input base path>,<output base path> per line with num_files files each. "
+    "The jobs share the schedulers and connections of a single run");
 DEFINE_string(
     attribution_rules,
     common::LAST_CLICK_1D,
@@ -52,6 +58,42 @@ DEFINE_bool(
     "A postfix number added to input/output files to accommodate sharding");
 DEFINE_int32(max_num_touchpoints, 4, "Maximum touchpoints per user");
 DEFINE_int32(max_num_conversions, 4, "Maximum conversions per user");
+DEFINE_bool(
+    attribution_scan,
+    false,
+    "Choose the attributed touchpoint of each conversion with a scan whose "
+    "depth is logarithmic in max_num_touchpoints, instead of a linear chain");
+DEFINE_bool(
+    attribution_wide_batch,
+    false,
+    "Evaluate the attribution rule on every touchpoint and conversion pair of "
+    "the users in one batch, then choose the attributed touchpoints of every "
+    "conversion with one scan, instead of a batch per pair");
+DEFINE_bool(
+    attribution_sort,
+    false,
+    "With use_new_output_format, attribute with the rules that allow it by "
+    "obliviously sorting the touchpoints and conversions of each user by time "
+    "and scanning them, at a cost of O(n log^2 n) in the events per user, "
+    "instead of evaluating the rule on every touchpoint and conversion pair. "
+    "For users with many touchpoints and conversions");
+DEFINE_int32(
+    attribution_users_per_batch,
+    0,
+    "If positive, the users of a file are shared and attributed this many at "
+    "a time, so that the secrets of only one batch of users are held at once. "
+    "Both parties must use the same value");
+DEFINE_int32(
+    attribution_memory_budget_mb,
+    0,
+    "If positive, the users of a file are attributed in batches which shrink "
+    "while the memory the process holds nears this many MB, and grow back "
+    "once it has dropped, up to attribution_users_per_batch users. Both "
+    "parties must set it, though not to the same value");
+DEFINE_int32(
+    input_parse_threads,
+    1,
+    "Number of threads used to parse a local input file");
 DEFINE_int32(
     input_encryption,
     0,
@@ -66,6 +108,16 @@ DEFINE_string(
     ".s3.us-west-2.amazonaws.com/",
     "s3 region name");
 DEFINE_bool(use_new_output_format, false, "New Format of Attribution output");
+DEFINE_bool(
+    use_binary_share_output,
+    false,
+    "Write the secret shares of the results in the binary format "
+    "pcf2_aggregation reads without parsing JSON, instead of as JSON");
+DEFINE_int32(
+    ad_id_width,
+    16,
+    "Bit width of the compressed ad ids of the new output format, 16 or 10 for "
+    "campaigns with at most 1023 ad ids. Both parties must use the same width");
 DEFINE_string(
     run_id,
     "",
@@ -74,6 +126,36 @@ DEFINE_string(
     pc_feature_flags,
     "",
     "A String of PC Feature Flags passing from PCS, separated by comma");
+DEFINE_bool(
+    multiplex_connections,
+    false,
+    "Run the apps of every concurrency lane as streams of one connection on "
+    "port, instead of each app connecting on a port of its own. Both parties "
+    "must set it the same");
+DEFINE_bool(
+    adaptive_concurrency,
+    false,
+    "Start the apps one at a time up to concurrency, while each one raises the "
+    "throughput of the run, instead of starting all of them. Both parties must "
+    "set it the same");
+DEFINE_int32(
+    adaptive_concurrency_interval_s,
+    30,
+    "Seconds the throughput is measured for before starting each app, when "
+    "adaptive_concurrency is set");
+DEFINE_string(
+    network_compression,
+    "none",
+    "Codec compressing the traffic between the parties, for region pairs "
+    "where bandwidth costs more than CPU - options: (none|lz4|zstd). Traffic "
+    "which doesn't compress is sent as it is. Both parties must set it the "
+    "same");
+DEFINE_bool(
+    pin_lanes,
+    false,
+    "Pin each app, and the threads it starts, to an equal share of the CPUs "
+    "ordered by NUMA node, so that the apps of hosts with several nodes keep "
+    "to the caches and memory of one node");
 DEFINE_bool(
     use_tls,
     false,
@@ -90,3 +172,41 @@ DEFINE_string(
     private_key_path,
     "",
     "Relative file path where private key is stored. It will be prefixed with $HOME.");
+DEFINE_string(
+    shard_cost_manifest,
+    "",
+    "Path of the shard cost manifest written by the sharder, used by the "
+    "publisher to run the most expensive files first. Files run in order "
+    "if empty");
+DEFINE_bool(
+    use_shard_cache,
+    false,
+    "Skip the files both parties computed in an earlier run with the same "
+    "inputs and settings, so that a run restarted after a failure resumes "
+    "with the files it didn't finish");
+DEFINE_int32(
+    input_wait_timeout_s,
+    0,
+    "If positive, connect and set up the schedulers before the inputs are "
+    "written, then wait up to this many seconds for the input of each file "
+    "before parsing it. Inputs are expected to be there if 0");
+DEFINE_bool(
+    dry_run_estimate,
+    false,
+    "Predict the gates, traffic and time of a run of --dry_run_num_rows rows "
+    "from dry runs of both parties on small generated inputs in this process, "
+    "print them and exit without connecting to the other party");
+DEFINE_int64(
+    dry_run_num_rows,
+    1'000'000,
+    "Rows of the run --dry_run_estimate predicts the costs of");
+DEFINE_int32(
+    dry_run_bandwidth_mbps,
+    1000,
+    "Bandwidth in Mbps between the parties --dry_run_estimate assumes");
+DEFINE_string(
+    input_cache_directory,
+    "",
+    "Local directory caching the inputs read from S3, which can be shared by "
+    "the containers of a host so that inputs read again, e.g. by a retry or "
+    "the next stage, aren't downloaded again. Inputs aren't cached if empty");
@@ -16,6 +16,7 @@ DECLARE_string(input_base_path);
 DECLARE_string(output_base_path);
 DECLARE_int32(file_start_index);
 DECLARE_int32(num_files);
+DECLARE_string(job_list);
 DECLARE_string(attribution_rules);
 DECLARE_string(aggregators);
 DECLARE_int32(concurrency);
@@ -24,14 +25,34 @@ DECLARE_string(run_name);
 DECLARE_bool(use_postfix);
 DECLARE_int32(max_num_touchpoints);
 DECLARE_int32(max_num_conversions);
+DECLARE_bool(attribution_scan);
+DECLARE_bool(attribution_wide_batch);
+DECLARE_bool(attribution_sort);
+DECLARE_int32(attribution_users_per_batch);
+DECLARE_int32(attribution_memory_budget_mb);
+DECLARE_int32(input_parse_threads);
 DECLARE_int32(input_encryption);
 DECLARE_bool(log_cost);
 DECLARE_string(log_cost_s3_bucket);
 DECLARE_string(log_cost_s3_region);
 DECLARE_bool(use_new_output_format);
+DECLARE_bool(use_binary_share_output);
+DECLARE_int32(ad_id_width);
 DECLARE_string(run_id);
 DECLARE_string(pc_feature_flags);
+DECLARE_bool(multiplex_connections);
+DECLARE_bool(adaptive_concurrency);
+DECLARE_int32(adaptive_concurrency_interval_s);
+DECLARE_string(network_compression);
+DECLARE_bool(pin_lanes);
 DECLARE_bool(use_tls);
 DECLARE_string(ca_cert_path);
 DECLARE_string(server_cert_path);
 DECLARE_string(private_key_path);
+DECLARE_string(shard_cost_manifest);
+DECLARE_bool(use_shard_cache);
+DECLARE_int32(input_wait_timeout_s);
+DECLARE_bool(dry_run_estimate);
+DECLARE_int64(dry_run_num_rows);
+DECLARE_int32(dry_run_bandwidth_mbps);
+DECLARE_string(input_cache_directory);
@@ -9,6 +9,7 @@
 
 #include <cstdint>
 #include <stdexcept>
+#include <vector>
 
 #include <fmt/format.h>
 
@@ -21,6 +22,16 @@ const uint32_t kSecondsInOneDay = 86400; // 60 * 60 * 24
 const uint32_t kSecondsInTwentyEightDays = 2419200; // 60 * 60 * 24 * 28
 const uint32_t kSecondsInSevenDays = 604800; // 60 * 60 * 24 * 7
 
+// Public batches used to compute the thresholds of private touchpoints: zeros,
+// and each threshold offset of a rule in the order of getThresholdOffsets.
+// They don't depend on the touchpoints, so they are created once for a rule and
+// batch size and shared by every touchpoint slot
+template <int schedulerId>
+struct ThresholdConstants {
+  PubTimestamp<schedulerId> zero;
+  std::vector<PubTimestamp<schedulerId>> offsets;
+};
+
 template <int schedulerId>
 struct AttributionRule {
   AttributionRule(std::uint64_t _id, std::string _name)
@@ -36,24 +47,64 @@ struct AttributionRule {
   // pass in a list of names, and the output json will be keyed by names
   const std::string name;
 
+  // Whether isAttributable compares the target ids and action types of the
+  // touchpoints and conversions. Rules that don't declare it false, so that
+  // the attribution in a wide batch doesn't batch those values for them
+  static constexpr bool kComparesTargetIds = true;
+
+  // Whether a touchpoint is attributable exactly when it is before the
+  // conversion and the conversion is by the end of one of its windows, the
+  // thresholds, which are later the later the touchpoint. The attributed
+  // touchpoint is then the latest one of the last window the conversion is
+  // in, as the windows are in the order they take precedence, so it can be
+  // found by a scan of the events of a user sorted by time. Rules that
+  // don't declare it false
+  static constexpr bool kAttributesLatestInWindows = false;
+
   // Should return true if the given touchpoint is eligible to be attributed
   // to the given conversion
+  SecBit<schedulerId> isAttributable(
+      const PrivateTouchpoint<schedulerId>& tp,
+      const PrivateConversion<schedulerId>& conv,
+      const std::vector<SecTimestamp<schedulerId>>& thresholds) const {
+    return isAttributable(tp, conv, thresholds, tp.ts < conv.ts);
+  }
+
+  // Same as above, given whether the touchpoint happened before the
+  // conversion. That comparison is the same for every rule, so it can be
+  // computed once for a touchpoint and conversion when attributing with
+  // several rules
   virtual SecBit<schedulerId> isAttributable(
       const PrivateTouchpoint<schedulerId>&,
       const PrivateConversion<schedulerId>&,
-      const std::vector<SecTimestamp<schedulerId>>&) const = 0;
+      const std::vector<SecTimestamp<schedulerId>>&,
+      const SecBit<schedulerId>& isTouchpointBeforeConversion) const = 0;
 
   // Compute touchpoint thresholds from plaintext touchpoints based on
   // attribution rule
   virtual std::vector<SecTimestamp<schedulerId>> computeThresholdsPlaintext(
       const Touchpoint&) const = 0;
 
+  // Seconds added to the timestamp of a touchpoint to compute its thresholds
+  virtual std::vector<uint32_t> getThresholdOffsets() const = 0;
+
+  ThresholdConstants<schedulerId> makeThresholdConstants(
+      size_t batchSize) const {
+    ThresholdConstants<schedulerId> constants{
+        PubTimestamp<schedulerId>(std::vector<uint32_t>(batchSize, 0)), {}};
+    for (auto offset : getThresholdOffsets()) {
+      constants.offsets.push_back(
+          PubTimestamp<schedulerId>(std::vector<uint32_t>(batchSize, offset)));
+    }
+    return constants;
+  }
+
   // Compute touchpoint thresholds from private touchpoints based on attribution
-  // rule
+  // rule, given the constants from makeThresholdConstants for the batch size
   virtual std::vector<SecTimestamp<schedulerId>> computeThresholdsPrivate(
       const PrivateTouchpoint<schedulerId>&,
       const PrivateIsClick<schedulerId>&,
-      size_t batchSize) const = 0;
+      const ThresholdConstants<schedulerId>& constants) const = 0;
 
   // Constructors for attribution rules, which can be found in
   // AttributionRule.cpp
@@ -8,6 +8,7 @@
 #include <chrono>
 #include <cstdint>
 #include <memory>
+#include <type_traits>
 #include "fbpcs/emp_games/common/Constants.h"
 #include "fbpcs/emp_games/pcf2_attribution/AttributionRule.h"
 #include "fbpcs/emp_games/pcf2_attribution/Constants.h"
@@ -15,7 +16,7 @@
 namespace pcf2_attribution {
 
 template <int schedulerId>
-class LastClickRule : public AttributionRule<schedulerId> {
+class LastClickRule final : public AttributionRule<schedulerId> {
  public:
   LastClickRule(
       std::int64_t id,
@@ -24,11 +25,17 @@ class LastClickRule : public AttributionRule<schedulerId> {
       : AttributionRule<schedulerId>(id, name),
         threshold_(thresholdInSeconds) {}
 
+  static constexpr bool kComparesTargetIds = false;
+  static constexpr bool kAttributesLatestInWindows = true;
+
+  using AttributionRule<schedulerId>::isAttributable;
+
   SecBit<schedulerId> isAttributable(
-      const PrivateTouchpoint<schedulerId>& tp,
+      const PrivateTouchpoint<schedulerId>& /* tp */,
       const PrivateConversion<schedulerId>& conv,
-      const std::vector<SecTimestamp<schedulerId>>& thresholds) const override {
-    return (tp.ts < conv.ts) & (conv.ts <= thresholds.at(0));
+      const std::vector<SecTimestamp<schedulerId>>& thresholds,
+      const SecBit<schedulerId>& isTouchpointBeforeConversion) const override {
+    return isTouchpointBeforeConversion & (conv.ts <= thresholds.at(0));
   }
 
   std::vector<SecTimestamp<schedulerId>> computeThresholdsPlaintext(
@@ -44,19 +51,17 @@ class LastClickRule : public AttributionRule<schedulerId> {
         SecTimestamp<schedulerId>(thresholdNDaysClick, common::PUBLISHER)};
   }
 
+  std::vector<uint32_t> getThresholdOffsets() const override {
+    return {static_cast<uint32_t>(threshold_.count())};
+  }
+
   std::vector<SecTimestamp<schedulerId>> computeThresholdsPrivate(
       const PrivateTouchpoint<schedulerId>& privateTp,
       const PrivateIsClick<schedulerId>& privateIsClick,
-      size_t batchSize) const override {
-    PubTimestamp<schedulerId> zero;
-    PubTimestamp<schedulerId> secondsInThreshold;
-
-    zero = PubTimestamp<schedulerId>(std::vector<uint32_t>(batchSize, 0));
-    secondsInThreshold = PubTimestamp<schedulerId>(
-        std::vector<uint32_t>(batchSize, threshold_.count()));
-
+      const ThresholdConstants<schedulerId>& constants) const override {
+    const auto& zero = constants.zero;
     auto isValidClick = privateIsClick.isClick & (zero < privateTp.ts);
-    auto thresholdNDays = privateTp.ts + secondsInThreshold;
+    auto thresholdNDays = privateTp.ts + constants.offsets.at(0);
     auto thresholdNDaysClick = zero.mux(isValidClick, thresholdNDays);
     return std::vector<SecTimestamp<schedulerId>>{thresholdNDaysClick};
   }
@@ -66,7 +71,7 @@ class LastClickRule : public AttributionRule<schedulerId> {
 };
 
 template <int schedulerId>
-class LastTouch_ClickNDays_ImpressionMDays
+class LastTouch_ClickNDays_ImpressionMDays final
     : public AttributionRule<schedulerId> {
  public:
   LastTouch_ClickNDays_ImpressionMDays(
@@ -78,12 +83,19 @@ class LastTouch_ClickNDays_ImpressionMDays
         clickThreshold_(clickThreshold),
         impressionThreshold_(impressionThreshold) {}
 
+  static constexpr bool kComparesTargetIds = false;
+  // Clicks are in the last window, which is at least as long as the first
+  static constexpr bool kAttributesLatestInWindows = true;
+
+  using AttributionRule<schedulerId>::isAttributable;
+
   /* if click within 28d, if touch within 1d */
   SecBit<schedulerId> isAttributable(
-      const PrivateTouchpoint<schedulerId>& tp,
+      const PrivateTouchpoint<schedulerId>& /* tp */,
       const PrivateConversion<schedulerId>& conv,
-      const std::vector<SecTimestamp<schedulerId>>& thresholds) const override {
-    auto validConv = tp.ts < conv.ts;
+      const std::vector<SecTimestamp<schedulerId>>& thresholds,
+      const SecBit<schedulerId>& isTouchpointBeforeConversion) const override {
+    const auto& validConv = isTouchpointBeforeConversion;
     auto touchWithinMDays = conv.ts <= thresholds.at(0);
     auto clickWithinNDays = conv.ts <= thresholds.at(1);
 
@@ -111,26 +123,23 @@ class LastTouch_ClickNDays_ImpressionMDays
         SecTimestamp<schedulerId>(thresholdNDaysClick, common::PUBLISHER)};
   }
 
+  std::vector<uint32_t> getThresholdOffsets() const override {
+    return {
+        static_cast<uint32_t>(impressionThreshold_.count()),
+        static_cast<uint32_t>(clickThreshold_.count())};
+  }
+
   std::vector<SecTimestamp<schedulerId>> computeThresholdsPrivate(
       const PrivateTouchpoint<schedulerId>& privateTp,
       const PrivateIsClick<schedulerId>& privateIsClick,
-      size_t batchSize) const override {
-    PubTimestamp<schedulerId> zero;
-    PubTimestamp<schedulerId> secondsInMDays;
-    PubTimestamp<schedulerId> secondsInNDays;
-
-    zero = PubTimestamp<schedulerId>(std::vector<uint32_t>(batchSize, 0));
-    secondsInMDays = PubTimestamp<schedulerId>(
-        std::vector<uint32_t>(batchSize, impressionThreshold_.count()));
-    secondsInNDays = PubTimestamp<schedulerId>(
-        std::vector<uint32_t>(batchSize, clickThreshold_.count()));
-
+      const ThresholdConstants<schedulerId>& constants) const override {
+    const auto& zero = constants.zero;
     auto isValid = zero < privateTp.ts;
     auto isValidClick = privateIsClick.isClick & isValid;
-    auto thresholdMDays = privateTp.ts + secondsInMDays;
+    auto thresholdMDays = privateTp.ts + constants.offsets.at(0);
     auto thresholdMDaysTouch = zero.mux(isValid, thresholdMDays);
 
-    auto thresholdNDays = privateTp.ts + secondsInNDays;
+    auto thresholdNDays = privateTp.ts + constants.offsets.at(1);
     auto thresholdNDaysClick = zero.mux(isValidClick, thresholdNDays);
     return std::vector<SecTimestamp<schedulerId>>{
         thresholdMDaysTouch, thresholdNDaysClick};
@@ -146,19 +155,24 @@ class LastTouch_ClickNDays_ImpressionMDays
   more than 1 day after the touchpoint
 */
 template <int schedulerId>
-class LastClick_2_7Days : public AttributionRule<schedulerId> {
+class LastClick_2_7Days final : public AttributionRule<schedulerId> {
  public:
   LastClick_2_7Days()
       : AttributionRule<schedulerId>(
             /* id */ 5,
             /* name */ common::LAST_CLICK_2_7D) {}
 
+  static constexpr bool kComparesTargetIds = false;
+
+  using AttributionRule<schedulerId>::isAttributable;
+
   /* if click is within 7d but after 1d */
   SecBit<schedulerId> isAttributable(
-      const PrivateTouchpoint<schedulerId>& tp,
+      const PrivateTouchpoint<schedulerId>& /* tp */,
       const PrivateConversion<schedulerId>& conv,
-      const std::vector<SecTimestamp<schedulerId>>& thresholds) const override {
-    auto validConv = tp.ts < conv.ts;
+      const std::vector<SecTimestamp<schedulerId>>& thresholds,
+      const SecBit<schedulerId>& isTouchpointBeforeConversion) const override {
+    const auto& validConv = isTouchpointBeforeConversion;
     auto clickAfterOneDay = thresholds.at(0) < conv.ts;
     auto clickWithinSevenDays = conv.ts <= thresholds.at(1);
 
@@ -185,26 +199,21 @@ class LastClick_2_7Days : public AttributionRule<schedulerId> {
         SecTimestamp<schedulerId>(upperBoundSevenDaysClick, common::PUBLISHER)};
   }
 
+  std::vector<uint32_t> getThresholdOffsets() const override {
+    return {kSecondsInOneDay, kSecondsInSevenDays};
+  }
+
   std::vector<SecTimestamp<schedulerId>> computeThresholdsPrivate(
       const PrivateTouchpoint<schedulerId>& privateTp,
       const PrivateIsClick<schedulerId>& privateIsClick,
-      size_t batchSize) const override {
-    PubTimestamp<schedulerId> zero;
-    PubTimestamp<schedulerId> secondsInOneDay;
-    PubTimestamp<schedulerId> secondsInSevenDays;
-
-    zero = PubTimestamp<schedulerId>(std::vector<uint32_t>(batchSize, 0));
-    secondsInOneDay = PubTimestamp<schedulerId>(
-        std::vector<uint32_t>(batchSize, kSecondsInOneDay));
-    secondsInSevenDays = PubTimestamp<schedulerId>(
-        std::vector<uint32_t>(batchSize, kSecondsInSevenDays));
-
+      const ThresholdConstants<schedulerId>& constants) const override {
+    const auto& zero = constants.zero;
     auto isValidClick = privateIsClick.isClick & (zero < privateTp.ts);
 
-    auto lowerBoundOneDay = privateTp.ts + secondsInOneDay;
+    auto lowerBoundOneDay = privateTp.ts + constants.offsets.at(0);
     auto lowerBoundOneDayClick = zero.mux(isValidClick, lowerBoundOneDay);
 
-    auto upperBoundSevenDay = privateTp.ts + secondsInSevenDays;
+    auto upperBoundSevenDay = privateTp.ts + constants.offsets.at(1);
     auto upperBoundSevenDayClick = zero.mux(isValidClick, upperBoundSevenDay);
 
     return std::vector<SecTimestamp<schedulerId>>{
@@ -218,18 +227,23 @@ class LastClick_2_7Days : public AttributionRule<schedulerId> {
   impression in 1d, favoring the most recent.
 */
 template <int schedulerId>
-class LastTouch_2_7Days : public AttributionRule<schedulerId> {
+class LastTouch_2_7Days final : public AttributionRule<schedulerId> {
  public:
   LastTouch_2_7Days()
       : AttributionRule<schedulerId>(
             /* id */ 6,
             /* name */ common::LAST_TOUCH_2_7D) {}
 
+  static constexpr bool kComparesTargetIds = false;
+
+  using AttributionRule<schedulerId>::isAttributable;
+
   SecBit<schedulerId> isAttributable(
-      const PrivateTouchpoint<schedulerId>& tp,
+      const PrivateTouchpoint<schedulerId>& /* tp */,
       const PrivateConversion<schedulerId>& conv,
-      const std::vector<SecTimestamp<schedulerId>>& thresholds) const override {
-    auto validConv = tp.ts < conv.ts;
+      const std::vector<SecTimestamp<schedulerId>>& thresholds,
+      const SecBit<schedulerId>& isTouchpointBeforeConversion) const override {
+    const auto& validConv = isTouchpointBeforeConversion;
     auto clickAfterOneDay = thresholds.at(0) < conv.ts;
     auto clickWithinSevenDays = conv.ts <= thresholds.at(1);
 
@@ -265,28 +279,23 @@ class LastTouch_2_7Days : public AttributionRule<schedulerId> {
         SecTimestamp<schedulerId>(upperBoundOneDayTouch, common::PUBLISHER)};
   }
 
+  std::vector<uint32_t> getThresholdOffsets() const override {
+    return {kSecondsInOneDay, kSecondsInSevenDays};
+  }
+
   std::vector<SecTimestamp<schedulerId>> computeThresholdsPrivate(
       const PrivateTouchpoint<schedulerId>& privateTp,
       const PrivateIsClick<schedulerId>& privateIsClick,
-      size_t batchSize) const override {
-    PubTimestamp<schedulerId> zero;
-    PubTimestamp<schedulerId> secondsInOneDay;
-    PubTimestamp<schedulerId> secondsInSevenDays;
-
-    zero = PubTimestamp<schedulerId>(std::vector<uint32_t>(batchSize, 0));
-    secondsInOneDay = PubTimestamp<schedulerId>(
-        std::vector<uint32_t>(batchSize, kSecondsInOneDay));
-    secondsInSevenDays = PubTimestamp<schedulerId>(
-        std::vector<uint32_t>(batchSize, kSecondsInSevenDays));
-
+      const ThresholdConstants<schedulerId>& constants) const override {
+    const auto& zero = constants.zero;
     auto isValid = zero < privateTp.ts;
     auto isValidClick = privateIsClick.isClick & isValid;
 
-    auto lowerBoundAndUpperBoundOneDay = privateTp.ts + secondsInOneDay;
+    auto lowerBoundAndUpperBoundOneDay = privateTp.ts + constants.offsets.at(0);
     auto lowerBoundOneDayClick =
         zero.mux(isValidClick, lowerBoundAndUpperBoundOneDay);
 
-    auto upperBoundSevenDay = privateTp.ts + secondsInSevenDays;
+    auto upperBoundSevenDay = privateTp.ts + constants.offsets.at(1);
     auto upperBoundSevenDayClick = zero.mux(isValidClick, upperBoundSevenDay);
 
     auto upperBoundOneDayTouch =
@@ -298,19 +307,22 @@ class LastTouch_2_7Days : public AttributionRule<schedulerId> {
 };
 
 template <int schedulerId>
-class LastClick_1Day_TargetId : public AttributionRule<schedulerId> {
+class LastClick_1Day_TargetId final : public AttributionRule<schedulerId> {
  public:
   LastClick_1Day_TargetId()
       : AttributionRule<schedulerId>(
             /* id */ 7,
             /* name */ common::LAST_CLICK_1D_TARGETID) {}
 
+  using AttributionRule<schedulerId>::isAttributable;
+
   SecBit<schedulerId> isAttributable(
       const PrivateTouchpoint<schedulerId>& tp,
       const PrivateConversion<schedulerId>& conv,
-      const std::vector<SecTimestamp<schedulerId>>& thresholds) const override {
+      const std::vector<SecTimestamp<schedulerId>>& thresholds,
+      const SecBit<schedulerId>& isTouchpointBeforeConversion) const override {
     return (tp.targetId == conv.targetId) & (tp.actionType == conv.actionType) &
-        (tp.ts < conv.ts) & (conv.ts <= thresholds.at(0));
+        isTouchpointBeforeConversion & (conv.ts <= thresholds.at(0));
   }
 
   std::vector<SecTimestamp<schedulerId>> computeThresholdsPlaintext(
@@ -327,19 +339,17 @@ class LastClick_1Day_TargetId : public AttributionRule<schedulerId> {
         SecTimestamp<schedulerId>(thresholdOneDayClick, common::PUBLISHER)};
   }
 
+  std::vector<uint32_t> getThresholdOffsets() const override {
+    return {kSecondsInOneDay};
+  }
+
   std::vector<SecTimestamp<schedulerId>> computeThresholdsPrivate(
       const PrivateTouchpoint<schedulerId>& privateTp,
       const PrivateIsClick<schedulerId>& privateIsClick,
-      size_t batchSize) const override {
-    PubTimestamp<schedulerId> zero;
-    PubTimestamp<schedulerId> secondsInOneDay;
-
-    zero = PubTimestamp<schedulerId>(std::vector<uint32_t>(batchSize, 0));
-    secondsInOneDay = PubTimestamp<schedulerId>(
-        std::vector<uint32_t>(batchSize, kSecondsInOneDay));
-
+      const ThresholdConstants<schedulerId>& constants) const override {
+    const auto& zero = constants.zero;
     auto isValidClick = privateIsClick.isClick & (zero < privateTp.ts);
-    auto thresholdOneDay = privateTp.ts + secondsInOneDay;
+    auto thresholdOneDay = privateTp.ts + constants.offsets.at(0);
     auto thresholdOneDayClick = zero.mux(isValidClick, thresholdOneDay);
     return std::vector<SecTimestamp<schedulerId>>{thresholdOneDayClick};
   }
@@ -380,6 +390,47 @@ inline const auto SUPPORTED_ATTRIBUTION_RULES =
         std::make_shared<LastTouch_2_7Days<schedulerId>>(),
         std::make_shared<LastClick_1Day_TargetId<schedulerId>>()};
 
+/*
+  Calls f with the rule as its concrete type. The rules are final, so the
+  attributions computed by f are compiled for each rule with its
+  isAttributable inlined, instead of calling it virtually for every
+  touchpoint and conversion. Other rules are given to f as they are.
+*/
+template <int schedulerId, typename F>
+decltype(auto) visitAttributionRule(
+    const AttributionRule<schedulerId>& rule,
+    F&& f) {
+  if (auto lastClick = dynamic_cast<const LastClickRule<schedulerId>*>(&rule)) {
+    return f(*lastClick);
+  }
+  if (auto lastTouch = dynamic_cast<
+          const LastTouch_ClickNDays_ImpressionMDays<schedulerId>*>(&rule)) {
+    return f(*lastTouch);
+  }
+  if (auto lastClick27 =
+          dynamic_cast<const LastClick_2_7Days<schedulerId>*>(&rule)) {
+    return f(*lastClick27);
+  }
+  if (auto lastTouch27 =
+          dynamic_cast<const LastTouch_2_7Days<schedulerId>*>(&rule)) {
+    return f(*lastTouch27);
+  }
+  if (auto targetId =
+          dynamic_cast<const LastClick_1Day_TargetId<schedulerId>*>(&rule)) {
+    return f(*targetId);
+  }
+  return f(rule);
+}
+
+// Whether the attributions of the rule can be computed by sorting the events of
+// each user, as the rule attributes the latest touchpoint in its windows
+template <int schedulerId>
+bool attributesLatestInWindows(const AttributionRule<schedulerId>& rule) {
+  return visitAttributionRule(rule, [](const auto& concreteRule) {
+    return std::decay_t<decltype(concreteRule)>::kAttributesLatestInWindows;
+  });
+}
+
 template <int schedulerId>
 std::shared_ptr<const AttributionRule<schedulerId>>
 AttributionRule<schedulerId>::fromNameOrThrow(const std::string& name) {
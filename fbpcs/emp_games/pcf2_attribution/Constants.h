@@ -7,7 +7,11 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include "fbpcf/frontend/mpcGame.h"
+#include "fbpcs/emp_games/common/SchedulerHints.h"
 
 namespace pcf2_attribution {
 
@@ -18,6 +22,33 @@ const size_t actionTypeWidth = 16;
 const size_t originalAdIdWidth = 64;
 const size_t adIdWidth = 16;
 const size_t convValueWidth = 32;
+// The events of a user are sorted by their timestamp and then by their index,
+// held in the low bits of the key
+const size_t eventIndexWidth = 16;
+const size_t sortKeyWidth = timeStampWidth + eventIndexWidth;
+
+// The scheduler hints of attribution, which takes flush_rows as the users
+// attributed at a time
+const common::SchedulerHints kSchedulerHints{};
+
+// Games whose scheduler ids start from this offset are a variant with narrow
+// compressed ad ids, which most campaigns fit in. Muxing and revealing ad ids
+// costs gates per bit, so the ad id width is chosen with the scheduler id at
+// compile time, and the apps of a run pick one of the variants at runtime.
+const int kNarrowAdIdSchedulerIdOffset = 64;
+const size_t narrowAdIdWidth = 10;
+static_assert(
+    2 * kMaxConcurrency + 1 < kNarrowAdIdSchedulerIdOffset,
+    "The scheduler ids of the variants must not overlap");
+
+template <int schedulerId>
+inline constexpr size_t adIdWidthFor =
+    schedulerId >= kNarrowAdIdSchedulerIdOffset ? narrowAdIdWidth : adIdWidth;
+
+// Compressed ad ids start from 1, as 0 means no ad id
+template <int schedulerId>
+inline constexpr std::uint64_t maxNumAdIdsFor =
+    (std::uint64_t{1} << adIdWidthFor<schedulerId>) - 1;
 
 template <int schedulerId>
 using PubBit =
@@ -56,10 +87,10 @@ using SecOriginalAdId = typename fbpcf::frontend::MpcGame<
 
 template <int schedulerId>
 using PubAdId = typename fbpcf::frontend::MpcGame<
-    schedulerId>::template PubUnsignedInt<adIdWidth, true>;
+    schedulerId>::template PubUnsignedInt<adIdWidthFor<schedulerId>, true>;
 template <int schedulerId>
 using SecAdId = typename fbpcf::frontend::MpcGame<
-    schedulerId>::template SecUnsignedInt<adIdWidth, true>;
+    schedulerId>::template SecUnsignedInt<adIdWidthFor<schedulerId>, true>;
 
 template <int schedulerId>
 using PubConvValue = typename fbpcf::frontend::MpcGame<
@@ -68,4 +99,15 @@ template <int schedulerId>
 using SecConvValue = typename fbpcf::frontend::MpcGame<
     schedulerId>::template SecUnsignedInt<convValueWidth, true>;
 
+template <int schedulerId>
+using PubSortKey = typename fbpcf::frontend::MpcGame<
+    schedulerId>::template PubUnsignedInt<sortKeyWidth, true>;
+template <int schedulerId>
+using SecSortKey = typename fbpcf::frontend::MpcGame<
+    schedulerId>::template SecUnsignedInt<sortKeyWidth, true>;
+
+template <int schedulerId>
+using SecEventIndex = typename fbpcf::frontend::MpcGame<
+    schedulerId>::template SecUnsignedInt<eventIndexWidth, true>;
+
 } // namespace pcf2_attribution
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/DryRunEstimate.h"
+#include "fbpcs/emp_games/pcf2_attribution/AttributionApp.h"
+#include "fbpcs/emp_games/pcf2_attribution/AttributionOptions.h"
+#include "fbpcs/emp_games/pcf2_attribution/Constants.h"
+
+namespace pcf2_attribution {
+
+template <int PARTY, int schedulerId>
+common::SchedulerStatistics runDryRunApp(
+    std::unique_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory> factory,
+    const std::string& attributionRules,
+    bool useXorEncryption,
+    const std::string& inputPath,
+    const std::string& outputPath) {
+  auto metricCollector =
+      std::make_shared<fbpcf::util::MetricCollector>("attribution_dry_run");
+  AttributionApp<PARTY, schedulerId> app(
+      std::move(factory),
+      PARTY == common::PUBLISHER ? attributionRules : "",
+      std::vector<std::string>{inputPath},
+      std::vector<std::string>{outputPath},
+      metricCollector,
+      useXorEncryption,
+      common::InputEncryption::Plaintext);
+  app.run();
+  return app.getSchedulerStatistics();
+}
+
+/*
+ * Predicts the costs of party in an attribution of numRows rows split over
+ * numFiles files, run by concurrency apps, from dry runs of both parties on
+ * inputs of the same dimensions. The inputs are padded to
+ * --max_num_touchpoints and --max_num_conversions. schedulerIdOffset picks
+ * the variant of the game, as in startAttributionAppsForShardedFiles.
+ */
+template <int schedulerIdOffset = 0>
+common::DryRunEstimate estimateAttributionCosts(
+    int party,
+    const std::string& attributionRules,
+    bool useXorEncryption,
+    int64_t numRows,
+    int64_t numFiles,
+    int64_t concurrency,
+    int32_t bandwidthMbps) {
+  return common::estimateFromDryRuns(
+      party,
+      numRows,
+      std::min(std::max<int64_t>(numFiles, 1), concurrency),
+      bandwidthMbps,
+      [&attributionRules, useXorEncryption](
+          int64_t sampleRows, const std::string& dir) {
+        auto publisherInput = dir + "/publisher_input.csv";
+        auto partnerInput = dir + "/partner_input.csv";
+        common::writeAttributionDryRunInputs(
+            {publisherInput},
+            {partnerInput},
+            sampleRows,
+            FLAGS_max_num_touchpoints,
+            FLAGS_max_num_conversions);
+        return [&attributionRules,
+                useXorEncryption,
+                publisherInput,
+                partnerInput,
+                dir](int runParty, auto factory) {
+          return runParty == common::PUBLISHER
+              ? runDryRunApp<
+                    common::PUBLISHER,
+                    schedulerIdOffset + common::PUBLISHER>(
+                    std::move(factory),
+                    attributionRules,
+                    useXorEncryption,
+                    publisherInput,
+                    dir + "/publisher_output.json")
+              : runDryRunApp<
+                    common::PARTNER,
+                    schedulerIdOffset + common::PARTNER>(
+                    std::move(factory),
+                    attributionRules,
+                    useXorEncryption,
+                    partnerInput,
+                    dir + "/partner_output.json");
+        };
+      });
+}
+
+} // namespace pcf2_attribution
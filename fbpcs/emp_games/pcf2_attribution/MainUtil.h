@@ -10,10 +10,23 @@
 #include <cstdint>
 #include <future>
 #include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 
 #include <fbpcf/engine/communication/SocketPartyCommunicationAgent.h>
+#include <fbpcf/io/api/FileIOWrappers.h>
+#include <folly/String.h>
 #include <folly/dynamic.h>
 #include "fbpcf/engine/communication/SocketPartyCommunicationAgentFactory.h"
+#include "fbpcs/emp_games/common/CompressingAgent.h"
+#include "fbpcs/emp_games/common/LaneController.h"
+#include "fbpcs/emp_games/common/MultiplexedConnection.h"
+#include "fbpcs/emp_games/common/SchedulerSlots.h"
+#include "fbpcs/emp_games/common/ShardQueue.h"
+#include "fbpcs/emp_games/common/ThreadPlacement.h"
+#include "fbpcs/emp_games/common/TrafficTrace.h"
 #include "fbpcs/emp_games/pcf2_attribution/AttributionApp.h"
 
 namespace pcf2_attribution {
@@ -53,86 +66,174 @@ getIOFilenames(
   return std::make_pair(inputFilenames, outputFilenames);
 }
 
-template <std::uint32_t PARTY, std::uint32_t index>
+/*
+ * Get the files of every job in a job list, one after another, so that a
+ * single run computes attributions for all of them. Each line of the job list
+ * is "<input base path>,<output base path>", and the files of each job are
+ * named as by getIOFilenames. Running jobs in one process reuses the
+ * schedulers, engines and connections of its apps across them, so the base OT
+ * setup and TLS handshakes are paid once per run instead of once per job. Both
+ * parties must list their jobs in the same order.
+ */
+inline std::pair<std::vector<std::string>, std::vector<std::string>>
+getIOFilenamesForJobs(
+    const std::string& jobListPath,
+    int32_t numFiles,
+    int32_t fileStartIndex,
+    bool use_postfix) {
+  std::vector<std::string> inputFilenames;
+  std::vector<std::string> outputFilenames;
+
+  std::istringstream jobList{fbpcf::io::FileIOWrappers::readFile(jobListPath)};
+  std::string line;
+  while (std::getline(jobList, line)) {
+    auto job = folly::trimWhitespace(line);
+    if (job.empty()) {
+      continue;
+    }
+    std::vector<std::string> paths;
+    folly::split(',', job, paths);
+    if (paths.size() != 2) {
+      throw std::invalid_argument(folly::sformat(
+          "Expected <input base path>,<output base path> in the job list {}, "
+          "got '{}'",
+          jobListPath,
+          job));
+    }
+    auto [jobInputs, jobOutputs] = getIOFilenames(
+        numFiles,
+        folly::trimWhitespace(paths.at(0)).str(),
+        folly::trimWhitespace(paths.at(1)).str(),
+        fileStartIndex,
+        use_postfix);
+    inputFilenames.insert(
+        inputFilenames.end(), jobInputs.begin(), jobInputs.end());
+    outputFilenames.insert(
+        outputFilenames.end(), jobOutputs.begin(), jobOutputs.end());
+  }
+  return std::make_pair(inputFilenames, outputFilenames);
+}
+
+template <std::uint32_t PARTY, int schedulerIdOffset = 0>
 inline common::SchedulerStatistics startAttributionAppsForShardedFilesHelper(
     bool useXorEncryption,
     common::InputEncryption inputEncryption,
-    std::uint32_t startFileIndex,
-    std::uint32_t remainingThreads,
+    std::shared_ptr<common::ShardQueue> shardQueue,
+    std::uint32_t numThreads,
     std::string serverIp,
     int port,
     std::string attributionRules,
     std::vector<std::string>& inputFilenames,
     std::vector<std::string>& outputFilenames,
     fbpcf::engine::communication::SocketPartyCommunicationAgent::TlsInfo&
-        tlsInfo) {
-  // aggregate scheduler statistics across apps
-  common::SchedulerStatistics schedulerStatistics{
-      0, 0, 0, 0, folly::dynamic::object()};
-
-  // split files evenly across threads
-  auto remainingFiles =
-      static_cast<std::int64_t>(inputFilenames.size()) - startFileIndex;
-  if (remainingFiles > 0) {
-    auto numFiles = (remainingThreads > remainingFiles)
-        ? 1U
-        : (remainingFiles / remainingThreads);
-
-    std::map<
-        int,
-        fbpcf::engine::communication::SocketPartyCommunicationAgentFactory::
-            PartyInfo>
-        partyInfos(
-            {{0, {serverIp, port + static_cast<int>(index) * 100}},
-             {1, {serverIp, port + static_cast<int>(index) * 100}}});
-
-    auto metricCollector = std::make_shared<fbpcf::util::MetricCollector>(
-        "attribution_metrics_for_thread_" + std::to_string(index));
-
-    auto communicationAgentFactory = std::make_unique<
-        fbpcf::engine::communication::SocketPartyCommunicationAgentFactory>(
-        PARTY, partyInfos, tlsInfo, metricCollector);
-
-    // Each AttributionApp runs numFiles sequentially on a single thread
-    // Publisher uses even schedulerId and partner uses odd schedulerId
-    auto app = std::make_unique<
-        pcf2_attribution::AttributionApp<PARTY, 2 * index + PARTY>>(
-        std::move(communicationAgentFactory),
-        attributionRules,
-        inputFilenames,
-        outputFilenames,
-        metricCollector,
-        useXorEncryption,
-        inputEncryption,
-        startFileIndex,
-        numFiles);
-
-    auto future = std::async([&app]() {
-      app->run();
-      return app->getSchedulerStatistics();
-    });
-
-    if constexpr (index < kMaxConcurrency) {
-      if (remainingThreads > 1) {
-        auto remainingStats =
-            startAttributionAppsForShardedFilesHelper<PARTY, index + 1>(
-                useXorEncryption,
-                inputEncryption,
-                startFileIndex + numFiles,
-                remainingThreads - 1,
-                serverIp,
-                port,
-                attributionRules,
-                inputFilenames,
-                outputFilenames,
-                tlsInfo);
-        schedulerStatistics.add(remainingStats);
-      }
-    }
-    auto stats = future.get();
-    schedulerStatistics.add(stats);
-  }
-  return schedulerStatistics;
+        tlsInfo,
+    std::shared_ptr<common::MultiplexedConnection> connection,
+    std::shared_ptr<common::LaneController> laneController,
+    private_measurement::compressed_io::Codec networkCompression,
+    uint32_t firstLane,
+    bool pinLanes) {
+  // Each AttributionApp runs the files it takes from shardQueue sequentially
+  // on a single thread, taking the next one when it finishes one. Publisher
+  // uses even schedulerId and partner uses odd schedulerId, both from the
+  // offset of the game variant
+  common::SchedulerSlots<
+      kMaxConcurrency,
+      std::unique_ptr<
+          fbpcf::engine::communication::IPartyCommunicationAgentFactory>,
+      std::shared_ptr<fbpcf::util::MetricCollector>>
+      slots([&](auto slot) {
+        constexpr int schedulerId =
+            schedulerIdOffset + 2 * decltype(slot)::value + PARTY;
+        return [&](std::unique_ptr<fbpcf::engine::communication::
+                                       IPartyCommunicationAgentFactory>
+                       communicationAgentFactory,
+                   std::shared_ptr<fbpcf::util::MetricCollector>
+                       metricCollector) {
+          auto app = std::make_unique<
+              pcf2_attribution::AttributionApp<PARTY, schedulerId>>(
+              std::move(communicationAgentFactory),
+              attributionRules,
+              inputFilenames,
+              outputFilenames,
+              metricCollector,
+              useXorEncryption,
+              inputEncryption,
+              0U /* startFileIndex */,
+              0 /* numFiles */,
+              shardQueue);
+          app->run();
+          return app->getSchedulerStatistics();
+        };
+      });
+
+  return common::runAppsInSlots(
+      numThreads,
+      [&](std::size_t slot) {
+        auto metricCollector = std::make_shared<fbpcf::util::MetricCollector>(
+            "attribution_metrics");
+
+        // The app is a lane of the multiplexed connection when there is one,
+        // and otherwise connects on a port of its own
+        std::unique_ptr<
+            fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+            communicationAgentFactory;
+        if (connection) {
+          communicationAgentFactory =
+              std::make_unique<common::MultiplexedAgentFactory>(
+                  connection, firstLane + slot, metricCollector);
+        } else {
+          std::map<
+              int,
+              fbpcf::engine::communication::
+                  SocketPartyCommunicationAgentFactory::PartyInfo>
+              partyInfos(
+                  {{0, {serverIp, port + static_cast<int>(slot) * 100}},
+                   {1, {serverIp, port + static_cast<int>(slot) * 100}}});
+          communicationAgentFactory =
+              std::make_unique<fbpcf::engine::communication::
+                                   SocketPartyCommunicationAgentFactory>(
+                  PARTY, partyInfos, tlsInfo, metricCollector);
+        }
+        // The trace records the traffic on the wire, after compression
+        communicationAgentFactory = common::recordTraffic(
+            std::move(communicationAgentFactory),
+            common::getTrafficTracePath("attribution", PARTY, firstLane + slot),
+            metricCollector);
+        communicationAgentFactory = common::compressTraffic(
+            std::move(communicationAgentFactory),
+            networkCompression,
+            metricCollector);
+
+        // The controller of an adaptive run connects over the first app's
+        // factory, and measures the traffic of every app
+        if (laneController) {
+          if (slot == 0) {
+            laneController->connect(*communicationAgentFactory);
+          }
+          communicationAgentFactory = laneController->countTraffic(
+              std::move(communicationAgentFactory), metricCollector);
+        }
+
+        // A pinned app runs on its share of the CPUs, split between all the
+        // apps the run may start
+        return std::async(
+            std::launch::async,
+            [&slots,
+             slot,
+             numThreads,
+             pinLanes,
+             communicationAgentFactory = std::move(communicationAgentFactory),
+             metricCollector]() mutable {
+              if (pinLanes) {
+                common::pinThreadToLane(slot, numThreads);
+              }
+              return slots.run(
+                  slot, std::move(communicationAgentFactory), metricCollector);
+            });
+      },
+      [&](std::size_t slot) {
+        return !laneController || laneController->shouldStart(slot);
+      });
 }
 
 template <int PARTY>
@@ -146,22 +247,79 @@ inline common::SchedulerStatistics startAttributionAppsForShardedFiles(
     int port,
     const std::string& attributionRules,
     fbpcf::engine::communication::SocketPartyCommunicationAgent::TlsInfo&
-        tlsInfo) {
-  // use only as many threads as the number of files
+        tlsInfo,
+    const std::string& shardCostManifest = "",
+    std::size_t adIdBits = adIdWidth,
+    bool multiplexConnections = false,
+    std::optional<common::LaneController::Options> adaptiveConcurrency =
+        std::nullopt,
+    private_measurement::compressed_io::Codec networkCompression =
+        private_measurement::compressed_io::Codec::kNone,
+    std::shared_ptr<common::MultiplexedConnection> sharedConnection = nullptr,
+    uint32_t firstLane = 0,
+    bool pinLanes = false) {
+  // use only as many threads as the number of files. An adaptive run starts
+  // up to that many, as long as each one raises the throughput
   auto numThreads =
       std::min(static_cast<std::int16_t>(inputFilenames.size()), concurrency);
+  auto shardQueue =
+      common::makeShardQueue(inputFilenames.size(), shardCostManifest);
+  // The apps run as lanes firstLane and up of a connection shared with other
+  // stages of a pipeline when given one
+  auto connection = sharedConnection;
+  if (connection == nullptr && multiplexConnections && numThreads > 0) {
+    connection = common::connectMultiplexed(
+        PARTY, serverIp, port, tlsInfo, "attribution_connection");
+  }
+  std::shared_ptr<common::LaneController> laneController;
+  if (adaptiveConcurrency.has_value()) {
+    laneController = std::make_shared<common::LaneController>(
+        PARTY, shardQueue, *adaptiveConcurrency);
+  }
 
-  return startAttributionAppsForShardedFilesHelper<PARTY, 0U>(
+  if (adIdBits == narrowAdIdWidth) {
+    return startAttributionAppsForShardedFilesHelper<
+        PARTY,
+        kNarrowAdIdSchedulerIdOffset>(
+        useXorEncryption,
+        inputEncryption,
+        shardQueue,
+        numThreads,
+        serverIp,
+        port,
+        attributionRules,
+        inputFilenames,
+        outputFilenames,
+        tlsInfo,
+        connection,
+        laneController,
+        networkCompression,
+        firstLane,
+        pinLanes);
+  }
+  if (adIdBits != adIdWidth) {
+    throw std::invalid_argument(folly::sformat(
+        "Ad id width must be {} or {}, got {}",
+        adIdWidth,
+        narrowAdIdWidth,
+        adIdBits));
+  }
+  return startAttributionAppsForShardedFilesHelper<PARTY>(
       useXorEncryption,
       inputEncryption,
-      0U,
+      shardQueue,
       numThreads,
       serverIp,
       port,
       attributionRules,
       inputFilenames,
       outputFilenames,
-      tlsInfo);
+      tlsInfo,
+      connection,
+      laneController,
+      networkCompression,
+      firstLane,
+      pinLanes);
 }
 
 } // namespace pcf2_attribution
@@ -7,18 +7,26 @@
 
 #include <gflags/gflags.h>
 #include <signal.h>
+#include <chrono>
+#include <iostream>
+#include <optional>
 #include <string>
 
 #include "folly/Format.h"
+#include "folly/json.h"
 #include "folly/init/Init.h"
 #include "folly/logging/xlog.h"
 
 #include <fbpcf/aws/AwsSdk.h>
 #include <fbpcs/performance_tools/CostEstimation.h>
 
+#include "fbpcs/emp_games/common/InputCache.h"
+#include "fbpcs/emp_games/common/MetricsRegistry.h"
+#include "fbpcs/emp_games/common/MetricsServer.h"
 #include "fbpcs/emp_games/pcf2_attribution/AttributionApp.h"
 #include "fbpcs/emp_games/pcf2_attribution/AttributionOptions.h"
 #include "fbpcs/emp_games/pcf2_attribution/Constants.h"
+#include "fbpcs/emp_games/pcf2_attribution/DryRun.h"
 #include "fbpcs/emp_games/pcf2_attribution/MainUtil.h"
 
 int main(int argc, char* argv[]) {
@@ -45,20 +53,73 @@ int main(int argc, char* argv[]) {
   XLOGF(INFO, "Port: {}", FLAGS_port);
   XLOGF(INFO, "Base input path: {}", FLAGS_input_base_path);
   XLOGF(INFO, "Base output path: {}", FLAGS_output_base_path);
+  XLOGF(INFO, "Job list: {}", FLAGS_job_list);
   XLOGF(INFO, "Run Id: {}", FLAGS_run_id);
   XLOGF(INFO, "PC Feature Flags: {}", FLAGS_pc_feature_flags);
+  XLOGF(INFO, "Input cache directory: {}", FLAGS_input_cache_directory);
+
+  private_measurement::compressed_io::setInputCacheDirectory(
+      FLAGS_input_cache_directory);
+
+  if (FLAGS_dry_run_estimate) {
+    auto party = (FLAGS_party == common::PUBLISHER) ? "Publisher" : "Partner";
+    auto estimate = FLAGS_ad_id_width ==
+            static_cast<int32_t>(pcf2_attribution::narrowAdIdWidth)
+        ? pcf2_attribution::estimateAttributionCosts<
+              pcf2_attribution::kNarrowAdIdSchedulerIdOffset>(
+              FLAGS_party,
+              FLAGS_attribution_rules,
+              FLAGS_use_xor_encryption,
+              FLAGS_dry_run_num_rows,
+              FLAGS_num_files,
+              FLAGS_concurrency,
+              FLAGS_dry_run_bandwidth_mbps)
+        : pcf2_attribution::estimateAttributionCosts(
+              FLAGS_party,
+              FLAGS_attribution_rules,
+              FLAGS_use_xor_encryption,
+              FLAGS_dry_run_num_rows,
+              FLAGS_num_files,
+              FLAGS_concurrency,
+              FLAGS_dry_run_bandwidth_mbps);
+    auto info = estimate.toDynamic();
+    info["attribution_rules"] = FLAGS_attribution_rules;
+    info["max_num_touchpoints"] = FLAGS_max_num_touchpoints;
+    info["max_num_conversions"] = FLAGS_max_num_conversions;
+    info["concurrency"] = FLAGS_concurrency;
+    info["num_files"] = FLAGS_num_files;
+    std::cout << folly::toPrettyJson(cost.getPredictedCostDynamic(
+                     FLAGS_run_name.empty() ? "dry_run" : FLAGS_run_name,
+                     party,
+                     static_cast<int64_t>(estimate.getSeconds()),
+                     estimate.receivedNetwork,
+                     estimate.sentNetwork,
+                     info))
+              << std::endl;
+    return 0;
+  }
 
   common::SchedulerStatistics schedulerStatistics;
+  auto metricsServer = common::MetricsServer::startFromFlags();
 
   // use batched attribution by default
   bool useXorEncryption = FLAGS_use_xor_encryption;
   try {
-    auto [inputFilenames, outputFilenames] = pcf2_attribution::getIOFilenames(
-        FLAGS_num_files,
-        FLAGS_input_base_path,
-        FLAGS_output_base_path,
-        FLAGS_file_start_index,
-        FLAGS_use_postfix);
+    auto [inputFilenames, outputFilenames] = FLAGS_job_list.empty()
+        ? pcf2_attribution::getIOFilenames(
+              FLAGS_num_files,
+              FLAGS_input_base_path,
+              FLAGS_output_base_path,
+              FLAGS_file_start_index,
+              FLAGS_use_postfix)
+        : pcf2_attribution::getIOFilenamesForJobs(
+              FLAGS_job_list,
+              FLAGS_num_files,
+              FLAGS_file_start_index,
+              FLAGS_use_postfix);
+    common::MetricsRegistry::getInstance()
+        .getGauge("shard.files_total")
+        .set(inputFilenames.size());
     int16_t concurrency = static_cast<int16_t>(FLAGS_concurrency);
     CHECK_LE(concurrency, pcf2_attribution::kMaxConcurrency)
         << "Concurrency must be at most " << pcf2_attribution::kMaxConcurrency;
@@ -69,6 +130,14 @@ int main(int argc, char* argv[]) {
         FLAGS_server_cert_path,
         FLAGS_private_key_path,
         "");
+    std::optional<common::LaneController::Options> adaptiveConcurrency;
+    if (FLAGS_adaptive_concurrency) {
+      adaptiveConcurrency = common::LaneController::Options{};
+      adaptiveConcurrency->interval =
+          std::chrono::seconds(FLAGS_adaptive_concurrency_interval_s);
+    }
+    auto networkCompression = private_measurement::compressed_io::parseCodec(
+        FLAGS_network_compression);
     common::InputEncryption inputEncryption =
         common::InputEncryption::Plaintext;
     if (FLAGS_input_encryption == 1) {
@@ -92,7 +161,15 @@ int main(int argc, char* argv[]) {
               FLAGS_server_ip,
               FLAGS_port,
               FLAGS_attribution_rules,
-              tlsInfo);
+              tlsInfo,
+              FLAGS_shard_cost_manifest,
+              FLAGS_ad_id_width,
+              FLAGS_multiplex_connections,
+              adaptiveConcurrency,
+              networkCompression,
+              nullptr /* sharedConnection */,
+              0 /* firstLane */,
+              FLAGS_pin_lanes);
 
     } else if (FLAGS_party == common::PARTNER) {
       XLOG(INFO)
@@ -109,7 +186,15 @@ int main(int argc, char* argv[]) {
               FLAGS_server_ip,
               FLAGS_port,
               FLAGS_attribution_rules,
-              tlsInfo);
+              tlsInfo,
+              FLAGS_shard_cost_manifest,
+              FLAGS_ad_id_width,
+              FLAGS_multiplex_connections,
+              adaptiveConcurrency,
+              networkCompression,
+              nullptr /* sharedConnection */,
+              0 /* firstLane */,
+              FLAGS_pin_lanes);
 
     } else {
       XLOGF(FATAL, "Invalid Party: {}", FLAGS_party);
@@ -0,0 +1,479 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "fbpcs/emp_games/pcf2_attribution/plaintext/PlaintextAttributionEngine.h"
+
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/Csv.h"
+#include "fbpcs/emp_games/common/Util.h"
+#include "fbpcs/emp_games/pcf2_attribution/AttributionRule.h"
+#include "fbpcs/emp_games/pcf2_attribution/Constants.h"
+
+namespace pcf2_attribution {
+
+namespace {
+// The rules are only read for their parameters and never run, so any
+// scheduler id instantiates them
+constexpr int kRuleSchedulerId = 0;
+
+template <size_t width>
+uint64_t truncate(uint64_t value) {
+  if constexpr (width >= 64) {
+    return value;
+  } else {
+    return value & ((uint64_t{1} << width) - 1);
+  }
+}
+
+template <typename RuleT>
+bool isRule(const AttributionRule<kRuleSchedulerId>& rule) {
+  return dynamic_cast<const RuleT*>(&rule) != nullptr;
+}
+
+int32_t findColumn(
+    const std::vector<std::string>& header,
+    const std::string& column) {
+  auto found = std::find(header.begin(), header.end(), column);
+  return found == header.end() ? -1
+                               : static_cast<int32_t>(found - header.begin());
+}
+
+// Appends the array of the column at index, if the input has it
+template <typename T>
+void appendColumn(
+    const std::vector<std::string_view>& parts,
+    int32_t index,
+    std::vector<T>& out) {
+  if (index >= 0) {
+    common::appendInnerArray(parts.at(index), out);
+  }
+}
+
+void checkSameLength(
+    std::size_t expected,
+    std::size_t actual,
+    const std::string& first,
+    const std::string& second) {
+  if (expected != actual) {
+    throw std::runtime_error(
+        first + " arrays and " + second + " arrays are not the same length.");
+  }
+}
+
+// Buffers for parsing a single row, reused across the rows of a thread
+struct RowBuffers {
+  std::vector<std::string_view> publisherParts;
+  std::vector<std::string_view> partnerParts;
+  std::vector<uint64_t> timestamps;
+  std::vector<bool> isClicks;
+  std::vector<uint64_t> targetId;
+  std::vector<uint64_t> actionType;
+  std::vector<uint64_t> adIds;
+  std::vector<uint64_t> convValues;
+  std::vector<ParsedTouchpoint> tps;
+  std::vector<ParsedConversion> convs;
+};
+
+// Lines of both inputs, reused across batches
+struct LineBatch {
+  std::vector<std::string> publisherLines;
+  std::vector<std::string> partnerLines;
+  std::size_t numRows = 0;
+};
+
+LineBatch readBatch(
+    std::istream& publisherInput,
+    std::istream& partnerInput,
+    std::size_t batchRows,
+    LineBatch batch) {
+  batch.publisherLines.resize(batchRows);
+  batch.partnerLines.resize(batchRows);
+  batch.numRows = 0;
+  while (batch.numRows < batchRows &&
+         std::getline(publisherInput, batch.publisherLines[batch.numRows]) &&
+         std::getline(partnerInput, batch.partnerLines[batch.numRows])) {
+    ++batch.numRows;
+  }
+  return batch;
+}
+} // namespace
+
+PlaintextAttributionRule::PlaintextAttributionRule(
+    std::string name,
+    Kind kind,
+    std::vector<uint32_t> thresholdOffsets)
+    : name_{std::move(name)},
+      kind_{kind},
+      thresholdOffsets_{std::move(thresholdOffsets)} {
+  auto numOffsets = kind_ == Kind::LastClick_2_7Days ||
+          kind_ == Kind::LastTouch_2_7Days || kind_ == Kind::LastTouch
+      ? 2
+      : 1;
+  if (thresholdOffsets_.size() != static_cast<std::size_t>(numOffsets)) {
+    throw std::invalid_argument(
+        "Attribution rule " + name_ + " needs " + std::to_string(numOffsets) +
+        " threshold offsets");
+  }
+}
+
+PlaintextAttributionRule PlaintextAttributionRule::fromNameOrThrow(
+    const std::string& name) {
+  auto rule = AttributionRule<kRuleSchedulerId>::fromNameOrThrow(name);
+  Kind kind;
+  if (isRule<LastClickRule<kRuleSchedulerId>>(*rule)) {
+    kind = Kind::LastClick;
+  } else if (isRule<LastTouch_ClickNDays_ImpressionMDays<kRuleSchedulerId>>(
+                 *rule)) {
+    kind = Kind::LastTouch;
+  } else if (isRule<LastClick_2_7Days<kRuleSchedulerId>>(*rule)) {
+    kind = Kind::LastClick_2_7Days;
+  } else if (isRule<LastTouch_2_7Days<kRuleSchedulerId>>(*rule)) {
+    kind = Kind::LastTouch_2_7Days;
+  } else if (isRule<LastClick_1Day_TargetId<kRuleSchedulerId>>(*rule)) {
+    kind = Kind::LastClick_TargetId;
+  } else {
+    throw std::runtime_error(
+        "Attribution rule " + name + " has no plaintext kernel");
+  }
+  return PlaintextAttributionRule{
+      rule->name, kind, rule->getThresholdOffsets()};
+}
+
+bool PlaintextAttributionRule::isAttributable(
+    const ParsedTouchpoint& tp,
+    const ParsedConversion& conv) const {
+  // Timestamps and thresholds are as wide as in the MPC game, so that they
+  // overflow the same way
+  auto tpTs = static_cast<uint32_t>(tp.ts);
+  auto convTs = static_cast<uint32_t>(conv.ts);
+  bool isValid = tpTs > 0;
+  bool isValidClick = tp.isClick && isValid;
+  bool isTouchpointBeforeConversion = tpTs < convTs;
+  auto threshold = [tpTs, this](bool isEligible, std::size_t offset) {
+    return isEligible ? static_cast<uint32_t>(tpTs + thresholdOffsets_[offset])
+                      : uint32_t{0};
+  };
+
+  switch (kind_) {
+    case Kind::LastClick:
+      return isTouchpointBeforeConversion &&
+          convTs <= threshold(isValidClick, 0);
+    case Kind::LastTouch:
+      // The offsets are those of impressions, then of clicks
+      return isTouchpointBeforeConversion &&
+          (convTs <= threshold(isValid, 0) ||
+           convTs <= threshold(isValidClick, 1));
+    case Kind::LastClick_2_7Days:
+      return isTouchpointBeforeConversion &&
+          threshold(isValidClick, 0) < convTs &&
+          convTs <= threshold(isValidClick, 1);
+    case Kind::LastTouch_2_7Days:
+      return isTouchpointBeforeConversion &&
+          ((threshold(isValidClick, 0) < convTs &&
+            convTs <= threshold(isValidClick, 1)) ||
+           convTs <= threshold(isValid && !isValidClick, 0));
+    case Kind::LastClick_TargetId:
+      return truncate<targetIdWidth>(tp.targetId) ==
+          truncate<targetIdWidth>(conv.targetId) &&
+          truncate<actionTypeWidth>(tp.actionType) ==
+          truncate<actionTypeWidth>(conv.actionType) &&
+          isTouchpointBeforeConversion && convTs <= threshold(isValidClick, 0);
+  }
+  return false;
+}
+
+AttributionColumnIndexes AttributionColumnIndexes::fromHeaders(
+    const std::vector<std::string>& publisherHeader,
+    const std::vector<std::string>& partnerHeader) {
+  AttributionColumnIndexes indexes;
+  indexes.adIds = findColumn(publisherHeader, "ad_ids");
+  indexes.timestamps = findColumn(publisherHeader, "timestamps");
+  indexes.isClick = findColumn(publisherHeader, "is_click");
+  indexes.targetId = findColumn(publisherHeader, "target_id");
+  indexes.actionType = findColumn(publisherHeader, "action_type");
+  indexes.conversionTimestamps =
+      findColumn(partnerHeader, "conversion_timestamps");
+  indexes.conversionValues = findColumn(partnerHeader, "conversion_values");
+  indexes.conversionTargetId =
+      findColumn(partnerHeader, "conversion_target_id");
+  indexes.conversionActionType =
+      findColumn(partnerHeader, "conversion_action_type");
+  if (indexes.adIds < 0 || indexes.timestamps < 0 || indexes.isClick < 0) {
+    throw std::runtime_error(
+        "The publisher input needs ad_ids, timestamps and is_click");
+  }
+  if (indexes.conversionTimestamps < 0 || indexes.conversionValues < 0) {
+    throw std::runtime_error(
+        "The partner input needs conversion_timestamps and conversion_values");
+  }
+  return indexes;
+}
+
+PlaintextAttributionEngine::PlaintextAttributionEngine(
+    const std::vector<std::string>& attributionRuleNames,
+    std::size_t numThreads)
+    : numThreads_{std::max<std::size_t>(numThreads, 1)} {
+  for (const auto& name : attributionRuleNames) {
+    rules_.push_back(PlaintextAttributionRule::fromNameOrThrow(name));
+  }
+}
+
+void PlaintextAttributionEngine::addRow(
+    std::string& publisherLine,
+    std::string& partnerLine,
+    const AttributionColumnIndexes& indexes,
+    std::vector<AdIdMetrics>& ruleMetrics) const {
+  thread_local RowBuffers buffers;
+
+  auto& publisherParts = buffers.publisherParts;
+  private_measurement::csv::splitByCommaInPlace(
+      publisherLine, true, publisherParts);
+  if (publisherParts.empty()) {
+    throw std::runtime_error("Empty publisher line");
+  }
+  buffers.timestamps.clear();
+  buffers.isClicks.clear();
+  buffers.targetId.clear();
+  buffers.actionType.clear();
+  buffers.adIds.clear();
+  appendColumn(publisherParts, indexes.timestamps, buffers.timestamps);
+  appendColumn(publisherParts, indexes.isClick, buffers.isClicks);
+  appendColumn(publisherParts, indexes.targetId, buffers.targetId);
+  appendColumn(publisherParts, indexes.actionType, buffers.actionType);
+  appendColumn(publisherParts, indexes.adIds, buffers.adIds);
+  auto numTouchpoints = buffers.timestamps.size();
+  checkSameLength(
+      numTouchpoints, buffers.isClicks.size(), "timestamps", "is_click");
+  checkSameLength(
+      numTouchpoints, buffers.adIds.size(), "timestamps", "original ad ID");
+  if (numTouchpoints > 0 && indexes.targetId >= 0) {
+    checkSameLength(
+        numTouchpoints, buffers.targetId.size(), "timestamps", "target_id");
+  }
+  if (numTouchpoints > 0 && indexes.actionType >= 0) {
+    checkSameLength(
+        numTouchpoints, buffers.actionType.size(), "timestamps", "action_type");
+  }
+
+  // Touchpoints are built and sorted as in AttributionInputMetrics, so that
+  // the latest attributable one is the same as in the MPC game
+  auto& tps = buffers.tps;
+  tps.clear();
+  for (std::size_t i = 0; i < numTouchpoints; ++i) {
+    tps.push_back(ParsedTouchpoint{
+        /* id */ static_cast<std::int64_t>(i),
+        /* isClick */ buffers.isClicks[i],
+        /* ts */ buffers.timestamps[i],
+        /* targetId */ !buffers.targetId.empty() ? buffers.targetId[i] : 0ULL,
+        /* actionType */
+        !buffers.actionType.empty() ? buffers.actionType[i] : 0ULL,
+        /* original adId */ buffers.adIds[i],
+        /* compressed adId */ 0});
+  }
+  std::sort(tps.begin(), tps.end());
+
+  auto& partnerParts = buffers.partnerParts;
+  private_measurement::csv::splitByCommaInPlace(
+      partnerLine, true, partnerParts);
+  if (partnerParts.empty()) {
+    throw std::runtime_error("Empty partner line");
+  }
+  buffers.timestamps.clear();
+  buffers.targetId.clear();
+  buffers.actionType.clear();
+  buffers.convValues.clear();
+  appendColumn(partnerParts, indexes.conversionTimestamps, buffers.timestamps);
+  appendColumn(partnerParts, indexes.conversionValues, buffers.convValues);
+  appendColumn(partnerParts, indexes.conversionTargetId, buffers.targetId);
+  appendColumn(partnerParts, indexes.conversionActionType, buffers.actionType);
+  auto numConversions = buffers.timestamps.size();
+  checkSameLength(
+      numConversions,
+      buffers.convValues.size(),
+      "Conversion timestamps",
+      "conversion value");
+  if (numConversions > 0 && indexes.conversionTargetId >= 0) {
+    checkSameLength(
+        numConversions,
+        buffers.targetId.size(),
+        "Conversion timestamps",
+        "target_id");
+  }
+  if (numConversions > 0 && indexes.conversionActionType >= 0) {
+    checkSameLength(
+        numConversions,
+        buffers.actionType.size(),
+        "Conversion timestamps",
+        "action_type");
+  }
+  auto& convs = buffers.convs;
+  convs.clear();
+  for (std::size_t i = 0; i < numConversions; ++i) {
+    convs.push_back(ParsedConversion{
+        /* ts */ buffers.timestamps[i],
+        /* targetId */ !buffers.targetId.empty() ? buffers.targetId[i] : 0ULL,
+        /* actionType */
+        !buffers.actionType.empty() ? buffers.actionType[i] : 0ULL,
+        /* convValue */ buffers.convValues[i]});
+  }
+
+  for (std::size_t r = 0; r < rules_.size(); ++r) {
+    auto& metrics = ruleMetrics[r];
+    // Every ad id of the touchpoints is in the output of the aggregation,
+    // attributed or not
+    for (const auto& tp : tps) {
+      if (tp.originalAdId > 0) {
+        metrics[tp.originalAdId];
+      }
+    }
+    // A conversion is attributed to the latest attributable touchpoint, and
+    // dropped if that touchpoint has no ad id
+    for (const auto& conv : convs) {
+      for (auto tp = tps.rbegin(); tp != tps.rend(); ++tp) {
+        if (!rules_[r].isAttributable(*tp, conv)) {
+          continue;
+        }
+        if (tp->originalAdId > 0) {
+          auto& adIdMetrics = metrics[tp->originalAdId];
+          adIdMetrics.convs += 1;
+          adIdMetrics.sales += static_cast<uint32_t>(
+              truncate<convValueWidth>(conv.convValue));
+        }
+        break;
+      }
+    }
+  }
+}
+
+pcf2_aggregation::AggregationOutputMetrics
+PlaintextAttributionEngine::toAggregationOutputMetrics(
+    const std::vector<AdIdMetrics>& ruleMetrics) const {
+  pcf2_aggregation::AggregationOutputMetrics out;
+  for (std::size_t r = 0; r < rules_.size(); ++r) {
+    folly::dynamic measurement = folly::dynamic::object();
+    for (const auto& [adId, metrics] : ruleMetrics.at(r)) {
+      measurement.insert(std::to_string(adId), metrics.toDynamic());
+    }
+    pcf2_aggregation::AggregationMetrics aggregationMetrics;
+    aggregationMetrics.formatToAggregation[common::MEASUREMENT] =
+        std::move(measurement);
+    out.ruleToMetrics[rules_[r].getName()] = std::move(aggregationMetrics);
+  }
+  return out;
+}
+
+pcf2_aggregation::AggregationOutputMetrics PlaintextAttributionEngine::compute(
+    std::istream& publisherInput,
+    std::istream& partnerInput,
+    std::size_t batchRows) const {
+  std::string publisherHeaderLine;
+  std::string partnerHeaderLine;
+  if (!std::getline(publisherInput, publisherHeaderLine) ||
+      !std::getline(partnerInput, partnerHeaderLine)) {
+    throw std::runtime_error("The inputs must start with their headers");
+  }
+  auto indexes = AttributionColumnIndexes::fromHeaders(
+      private_measurement::csv::splitByComma(publisherHeaderLine, false),
+      private_measurement::csv::splitByComma(partnerHeaderLine, false));
+
+  batchRows = std::max<std::size_t>(batchRows, 1);
+  std::vector<std::vector<AdIdMetrics>> threadMetrics(
+      numThreads_, std::vector<AdIdMetrics>(rules_.size()));
+
+  auto current = readBatch(publisherInput, partnerInput, batchRows, {});
+  LineBatch spare;
+  while (current.numRows > 0) {
+    // Read the next batch while this one is attributed
+    std::future<LineBatch> next;
+    bool hasNext = current.numRows == batchRows;
+    if (hasNext) {
+      next = std::async(
+          std::launch::async,
+          [&, batch = std::move(spare)]() mutable {
+            return readBatch(
+                publisherInput, partnerInput, batchRows, std::move(batch));
+          });
+    }
+
+    auto rowsPerThread = (current.numRows + numThreads_ - 1) / numThreads_;
+    std::vector<std::future<void>> workers;
+    for (std::size_t t = 0; t < numThreads_; ++t) {
+      auto begin = std::min(t * rowsPerThread, current.numRows);
+      auto end = std::min(begin + rowsPerThread, current.numRows);
+      if (begin == end) {
+        break;
+      }
+      workers.push_back(std::async(std::launch::async, [&, t, begin, end]() {
+        for (auto i = begin; i < end; ++i) {
+          addRow(
+              current.publisherLines[i],
+              current.partnerLines[i],
+              indexes,
+              threadMetrics[t]);
+        }
+      }));
+    }
+    for (auto& worker : workers) {
+      worker.wait();
+    }
+    // Wait for the reader before rethrowing, as it reads into this frame
+    LineBatch nextBatch;
+    if (hasNext) {
+      nextBatch = next.get();
+    }
+    for (auto& worker : workers) {
+      worker.get();
+    }
+    if (!hasNext) {
+      break;
+    }
+    spare = std::move(current);
+    current = std::move(nextBatch);
+  }
+
+  // Sum the metrics of every thread per rule and ad id. Sums wrap at 32 bits,
+  // as they do in the ORAM of the aggregation
+  std::vector<AdIdMetrics> ruleMetrics(rules_.size());
+  for (const auto& metrics : threadMetrics) {
+    for (std::size_t r = 0; r < rules_.size(); ++r) {
+      for (const auto& [adId, adIdMetrics] : metrics[r]) {
+        auto& sum = ruleMetrics[r][adId];
+        sum.convs += adIdMetrics.convs;
+        sum.sales += adIdMetrics.sales;
+      }
+    }
+  }
+  return toAggregationOutputMetrics(ruleMetrics);
+}
+
+pcf2_aggregation::AggregationOutputMetrics
+PlaintextAttributionEngine::makePartnerShares(
+    const pcf2_aggregation::AggregationOutputMetrics& metrics) {
+  pcf2_aggregation::AggregationOutputMetrics shares;
+  for (const auto& [rule, aggregationMetrics] : metrics.ruleToMetrics) {
+    pcf2_aggregation::AggregationMetrics ruleShares;
+    for (const auto& [format, aggregation] :
+         aggregationMetrics.formatToAggregation) {
+      folly::dynamic formatShares = folly::dynamic::object();
+      for (const auto& item : aggregation.items()) {
+        formatShares.insert(
+            item.first, pcf2_aggregation::ConvMetrics{0, 0}.toDynamic());
+      }
+      ruleShares.formatToAggregation[format] = std::move(formatShares);
+    }
+    shares.ruleToMetrics[rule] = std::move(ruleShares);
+  }
+  return shares;
+}
+
+} // namespace pcf2_attribution
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fbpcs/emp_games/pcf2_aggregation/AggregationMetrics.h"
+#include "fbpcs/emp_games/pcf2_attribution/Conversion.h"
+#include "fbpcs/emp_games/pcf2_attribution/Touchpoint.h"
+
+namespace pcf2_attribution {
+
+inline constexpr std::size_t kDefaultPlaintextBatchRows = 1 << 14;
+
+/*
+ * The plaintext kernel of an attribution rule of AttributionRule.h. It is
+ * built from the rule of the same name, whose threshold offsets it uses, and
+ * attributes the same touchpoints as the rule does in the MPC game, with the
+ * same 32 bit timestamp arithmetic.
+ */
+class PlaintextAttributionRule {
+ public:
+  enum class Kind {
+    LastClick,
+    LastTouch,
+    LastClick_2_7Days,
+    LastTouch_2_7Days,
+    LastClick_TargetId
+  };
+
+  PlaintextAttributionRule(
+      std::string name,
+      Kind kind,
+      std::vector<uint32_t> thresholdOffsets);
+
+  static PlaintextAttributionRule fromNameOrThrow(const std::string& name);
+
+  const std::string& getName() const {
+    return name_;
+  }
+
+  // Whether the touchpoint may be attributed the conversion
+  bool isAttributable(const ParsedTouchpoint& tp, const ParsedConversion& conv)
+      const;
+
+ private:
+  std::string name_;
+  Kind kind_;
+  std::vector<uint32_t> thresholdOffsets_;
+};
+
+// Where the columns of the game are in the inputs, or -1 if they are not
+struct AttributionColumnIndexes {
+  int32_t adIds = -1;
+  int32_t timestamps = -1;
+  int32_t isClick = -1;
+  int32_t targetId = -1;
+  int32_t actionType = -1;
+  int32_t conversionTimestamps = -1;
+  int32_t conversionValues = -1;
+  int32_t conversionTargetId = -1;
+  int32_t conversionActionType = -1;
+
+  static AttributionColumnIndexes fromHeaders(
+      const std::vector<std::string>& publisherHeader,
+      const std::vector<std::string>& partnerHeader);
+};
+
+// Conversions and sales attributed to each original ad id, for each rule
+using AdIdMetrics = std::unordered_map<uint64_t, pcf2_aggregation::ConvMetrics>;
+
+/*
+ * Computes attribution and its measurement aggregation in the clear, for
+ * deployments where both inputs are in one trusted environment. Its results
+ * are those that pcf2_attribution followed by pcf2_aggregation reveal on the
+ * same plaintext inputs, but the users of each batch of rows are attributed
+ * on a pool of threads while the next batch is read, and the metrics of every
+ * thread are summed per ad id at the end.
+ */
+class PlaintextAttributionEngine {
+ public:
+  PlaintextAttributionEngine(
+      const std::vector<std::string>& attributionRuleNames,
+      std::size_t numThreads);
+
+  /*
+   * Attributes the conversions of a user to their touchpoints under every
+   * rule, and adds them to the metrics of the rules. Spaces are removed from
+   * the lines in place.
+   */
+  void addRow(
+      std::string& publisherLine,
+      std::string& partnerLine,
+      const AttributionColumnIndexes& indexes,
+      std::vector<AdIdMetrics>& ruleMetrics) const;
+
+  pcf2_aggregation::AggregationOutputMetrics toAggregationOutputMetrics(
+      const std::vector<AdIdMetrics>& ruleMetrics) const;
+
+  /*
+   * Computes the metrics of the rows of both inputs, which start with their
+   * headers, stopping at the end of the shorter one. They are keyed by rule,
+   * then by the measurement format, then by original ad id, as in the output
+   * of pcf2_aggregation.
+   */
+  pcf2_aggregation::AggregationOutputMetrics compute(
+      std::istream& publisherInput,
+      std::istream& partnerInput,
+      std::size_t batchRows = kDefaultPlaintextBatchRows) const;
+
+  /*
+   * The partner's XOR shares of metrics whose publisher shares are the
+   * metrics themselves, so that the two can be combined by
+   * pcf2_shard_combiner like those of the MPC games.
+   */
+  static pcf2_aggregation::AggregationOutputMetrics makePartnerShares(
+      const pcf2_aggregation::AggregationOutputMetrics& metrics);
+
+ private:
+  std::vector<PlaintextAttributionRule> rules_;
+  std::size_t numThreads_;
+};
+
+} // namespace pcf2_attribution
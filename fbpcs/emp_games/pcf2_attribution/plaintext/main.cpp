@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <folly/init/Init.h>
+#include "folly/logging/xlog.h"
+
+#include "fbpcs/emp_games/common/Csv.h"
+#include "fbpcs/emp_games/pcf2_attribution/plaintext/PlaintextAttributionEngine.h"
+
+DEFINE_string(
+    input_publisher_path,
+    "",
+    "Path of the publisher input of pcf2_attribution (should have a header)");
+DEFINE_string(
+    input_partner_path,
+    "",
+    "Path of the partner input, row by row with the publisher input (should "
+    "have a header)");
+DEFINE_string(
+    attribution_rules,
+    "",
+    "Comma separated list of attribution rules to compute");
+DEFINE_string(
+    output_publisher_path,
+    "out.json",
+    "Path the aggregated metrics are written to, in the format of "
+    "pcf2_aggregation");
+DEFINE_string(
+    output_partner_path,
+    "",
+    "If set, path the partner's XOR shares of the metrics are written to, so "
+    "that pcf2_shard_combiner can combine the two outputs");
+DEFINE_int32(
+    num_threads,
+    0,
+    "Threads attributing the users of the rows. 0 uses every core");
+DEFINE_int64(
+    batch_rows,
+    pcf2_attribution::kDefaultPlaintextBatchRows,
+    "Rows read at a time, while the previous ones are attributed");
+
+namespace {
+bool writeOutput(
+    const std::string& path,
+    const pcf2_aggregation::AggregationOutputMetrics& metrics) {
+  std::ofstream output{path};
+  if (!output.is_open()) {
+    XLOG(ERR) << "Failed to open '" << path << "'";
+    return false;
+  }
+  output << metrics.toJson();
+  return true;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  std::ifstream publisherInput{FLAGS_input_publisher_path};
+  if (!publisherInput.is_open()) {
+    XLOG(ERR) << "Failed to open '" << FLAGS_input_publisher_path << "'";
+    return 1;
+  }
+  std::ifstream partnerInput{FLAGS_input_partner_path};
+  if (!partnerInput.is_open()) {
+    XLOG(ERR) << "Failed to open '" << FLAGS_input_partner_path << "'";
+    return 1;
+  }
+
+  auto numThreads = FLAGS_num_threads > 0
+      ? static_cast<std::size_t>(FLAGS_num_threads)
+      : std::thread::hardware_concurrency();
+  pcf2_attribution::PlaintextAttributionEngine engine{
+      private_measurement::csv::splitByComma(FLAGS_attribution_rules, false),
+      numThreads};
+
+  auto start = std::chrono::steady_clock::now();
+  auto metrics = engine.compute(
+      publisherInput, partnerInput, static_cast<std::size_t>(FLAGS_batch_rows));
+  auto elapsed = std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  XLOG(INFO) << "Computed attribution and aggregation on " << numThreads
+             << " threads in " << elapsed << " ms";
+
+  if (!writeOutput(FLAGS_output_publisher_path, metrics)) {
+    return 1;
+  }
+  if (!FLAGS_output_partner_path.empty() &&
+      !writeOutput(
+          FLAGS_output_partner_path,
+          pcf2_attribution::PlaintextAttributionEngine::makePartnerShares(
+              metrics))) {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <tuple>
+
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/TestUtil.h"
+#include "fbpcs/emp_games/pcf2_aggregation/test/AggregationTestUtils.h"
+#include "fbpcs/emp_games/pcf2_attribution/plaintext/PlaintextAttributionEngine.h"
+
+namespace pcf2_attribution {
+
+namespace {
+// The inputs of the correctness tests of pcf2_attribution, and the metrics
+// pcf2_aggregation computes on them
+struct CorrectnessFiles {
+  std::string publisherPath;
+  std::string partnerPath;
+  std::string expectedPath;
+};
+
+CorrectnessFiles getCorrectnessFiles(const std::string& attributionRule) {
+  auto baseDir = private_measurement::test_util::getBaseDirFromPath(__FILE__);
+  auto inputPrefix =
+      baseDir + "../../test/test_correctness/" + attributionRule + ".";
+  return CorrectnessFiles{
+      inputPrefix + "publisher.csv",
+      inputPrefix + "partner.csv",
+      baseDir + "../../../pcf2_aggregation/test/test_correctness/" +
+          attributionRule + "." + common::MEASUREMENT + ".json"};
+}
+
+pcf2_aggregation::AggregationOutputMetrics compute(
+    const std::vector<std::string>& attributionRules,
+    const CorrectnessFiles& files,
+    std::size_t numThreads,
+    std::size_t batchRows) {
+  PlaintextAttributionEngine engine{attributionRules, numThreads};
+  std::ifstream publisherInput{files.publisherPath};
+  std::ifstream partnerInput{files.partnerPath};
+  return engine.compute(publisherInput, partnerInput, batchRows);
+}
+} // namespace
+
+class PlaintextAttributionEngineTest
+    : public ::testing::TestWithParam<
+          std::tuple<std::string, std::size_t, std::size_t>> {};
+
+TEST_P(PlaintextAttributionEngineTest, TestMatchesAggregationGame) {
+  auto [attributionRule, numThreads, batchRows] = GetParam();
+  auto files = getCorrectnessFiles(attributionRule);
+  auto output = compute({attributionRule}, files, numThreads, batchRows);
+  pcf2_aggregation::verifyOutput(output, files.expectedPath);
+
+  // The output and the partner's shares combine to the same metrics
+  auto revealed = pcf2_aggregation::revealXORedResult(
+      output,
+      PlaintextAttributionEngine::makePartnerShares(output),
+      common::MEASUREMENT,
+      attributionRule);
+  pcf2_aggregation::verifyOutput(revealed, files.expectedPath);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    PlaintextAttributionEngineTestSuite,
+    PlaintextAttributionEngineTest,
+    ::testing::Combine(
+        ::testing::Values(
+            common::LAST_CLICK_1D,
+            common::LAST_TOUCH_1D,
+            common::LAST_CLICK_2_7D,
+            common::LAST_TOUCH_2_7D),
+        ::testing::Values(1, 4),
+        ::testing::Values(1, 5, kDefaultPlaintextBatchRows)));
+
+TEST(PlaintextAttributionEngineTest, TestRulesAreComputedTogether) {
+  auto files = getCorrectnessFiles(common::LAST_TOUCH_2_7D);
+  auto together = compute(
+      {common::LAST_CLICK_1D, common::LAST_TOUCH_2_7D}, files, 2, 3);
+  for (const auto& rule : {common::LAST_CLICK_1D, common::LAST_TOUCH_2_7D}) {
+    auto alone = compute({rule}, files, 1, kDefaultPlaintextBatchRows);
+    EXPECT_EQ(
+        alone.ruleToMetrics.at(rule).toDynamic(),
+        together.ruleToMetrics.at(rule).toDynamic());
+  }
+}
+
+TEST(PlaintextAttributionEngineTest, TestTargetIdAndActionType) {
+  std::istringstream publisherInput{
+      "id_,ad_ids,timestamps,is_click,target_id,action_type\n"
+      "1,[7],[100],[1],[555],[4]\n"
+      "2,[7],[100],[1],[555],[4]\n"
+      "3,[7, 8],[100, 150],[1, 1],[555, 556],[4, 4]\n"};
+  std::istringstream partnerInput{
+      "id_,conversion_timestamps,conversion_values,conversion_target_id,"
+      "conversion_action_type\n"
+      "1,[200],[10],[554],[4]\n"
+      "2,[200],[20],[555],[4]\n"
+      "3,[200],[40],[555],[4]\n"};
+  PlaintextAttributionEngine engine{{common::LAST_CLICK_1D_TARGETID}, 2};
+  auto output = engine.compute(publisherInput, partnerInput);
+
+  // The later click of the last user has another target id, so the
+  // conversion goes to the earlier one
+  auto expected = folly::dynamic::object(
+      "7", pcf2_aggregation::ConvMetrics{2, 60}.toDynamic())(
+      "8", pcf2_aggregation::ConvMetrics{0, 0}.toDynamic());
+  EXPECT_EQ(
+      expected,
+      output.ruleToMetrics.at(common::LAST_CLICK_1D_TARGETID)
+          .formatToAggregation.at(common::MEASUREMENT));
+}
+
+TEST(PlaintextAttributionEngineTest, TestRejectsUnknownRule) {
+  EXPECT_THROW(
+      (PlaintextAttributionEngine{{"last_click_3d"}, 1}), std::runtime_error);
+}
+
+TEST(PlaintextAttributionEngineTest, TestRejectsMismatchedArrays) {
+  std::istringstream publisherInput{
+      "id_,ad_ids,timestamps,is_click\n"
+      "1,[1, 2],[100],[1]\n"};
+  std::istringstream partnerInput{
+      "id_,conversion_timestamps,conversion_values\n"
+      "1,[200],[10]\n"};
+  PlaintextAttributionEngine engine{{common::LAST_CLICK_1D}, 1};
+  EXPECT_THROW(
+      engine.compute(publisherInput, partnerInput), std::runtime_error);
+}
+
+} // namespace pcf2_attribution
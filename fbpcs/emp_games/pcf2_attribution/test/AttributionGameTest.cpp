@@ -5,9 +5,11 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 #include <filesystem>
 #include <future>
+#include <tuple>
 
 #include "folly/dynamic.h"
 #include "folly/json.h"
@@ -189,6 +191,186 @@ TEST(AttributionGameTest, TestAttributionLogicPlaintextBatch) {
   }
 }
 
+TEST(AttributionGameTest, TestAttributionScanMatchesChain) {
+  size_t batchSize = 3;
+
+  std::vector<Touchpoint> touchpoints{
+      Touchpoint{
+          .id = {0, 0, 0},
+          .isClick = {true, false, true},
+          .ts = {100, 100, 100},
+          .adId = {1, 1, 1}},
+      Touchpoint{
+          .id = {1, 1, 1},
+          .isClick = {false, true, true},
+          .ts = {200, 150, 300},
+          .adId = {2, 2, 2}},
+      Touchpoint{
+          .id = {2, 2, 2},
+          .isClick = {true, true, false},
+          .ts = {300, 400, 500},
+          .adId = {3, 3, 3}},
+      Touchpoint{
+          .id = {3, 3, 3},
+          .isClick = {false, true, true},
+          .ts = {400, 600, 700},
+          .adId = {4, 4, 4}},
+      Touchpoint{
+          .id = {4, 4, 4},
+          .isClick = {true, false, true},
+          .ts = {500, 800, 900},
+          .adId = {5, 5, 5}}};
+
+  std::vector<Conversion> conversions{
+      Conversion{.ts = {50, 50, 50}, .convValue = {1, 1, 1}},
+      Conversion{.ts = {350, 450, 650}, .convValue = {2, 2, 2}},
+      Conversion{.ts = {600, 900, 1000}, .convValue = {3, 3, 3}},
+      Conversion{.ts = {0, 0, 0}, .convValue = {0, 0, 0}}};
+
+  AttributionGame<common::PUBLISHER> game(
+      std::make_unique<fbpcf::scheduler::PlaintextScheduler>(
+          fbpcf::scheduler::WireKeeper::createWithVectorArena<unsafe>()));
+
+  auto privateTouchpoints = game.privatelyShareTouchpoints(
+      touchpoints, common::InputEncryption::Plaintext);
+  auto privateConversions = game.privatelyShareConversions(
+      conversions, common::InputEncryption::Plaintext);
+
+  for (auto ruleName : {common::LAST_CLICK_1D, common::LAST_TOUCH_1D}) {
+    auto rule = AttributionRule<common::PUBLISHER>::fromNameOrThrow(ruleName);
+    auto thresholds = game.privatelyShareThresholds(
+        touchpoints,
+        privateTouchpoints,
+        *rule,
+        batchSize,
+        common::InputEncryption::Plaintext);
+
+    gflags::FlagSaver flagSaver;
+    std::vector<std::vector<std::vector<uint64_t>>> results;
+    // The chain, the scan, the scan over a wide batch of every pair, and the
+    // scan of the sorted events
+    for (auto [scan, wideBatch, sort] :
+         std::vector<std::tuple<bool, bool, bool>>{
+             {false, false, false},
+             {true, false, false},
+             {false, true, false},
+             {false, false, true}}) {
+      FLAGS_attribution_scan = scan;
+      FLAGS_attribution_wide_batch = wideBatch;
+      FLAGS_attribution_sort = sort;
+      std::vector<std::vector<uint64_t>> opened;
+      auto attributions = game.computeAttributionsHelper(
+          privateTouchpoints,
+          privateConversions,
+          *rule,
+          thresholds,
+          batchSize);
+      for (auto& attribution : attributions) {
+        auto bits = attribution.openToParty(common::PUBLISHER).getValue();
+        opened.emplace_back(bits.begin(), bits.end());
+      }
+      auto reformatted = game.computeAttributionsHelperV2(
+          privateTouchpoints,
+          privateConversions,
+          *rule,
+          thresholds,
+          batchSize);
+      for (auto& attribution : reformatted) {
+        auto bits =
+            attribution.is_attributed.openToParty(common::PUBLISHER).getValue();
+        opened.emplace_back(bits.begin(), bits.end());
+        auto adIds =
+            attribution.ad_id.openToParty(common::PUBLISHER).getValue();
+        opened.emplace_back(adIds.begin(), adIds.end());
+      }
+      results.push_back(opened);
+    }
+    EXPECT_EQ(results.at(0), results.at(1)) << ruleName;
+    EXPECT_EQ(results.at(0), results.at(2)) << ruleName;
+    EXPECT_EQ(results.at(0), results.at(3)) << ruleName;
+  }
+}
+
+TEST(AttributionGameTest, TestAdIdWidthOfGameVariants) {
+  EXPECT_EQ(adIdWidth, adIdWidthFor<common::PARTNER>);
+  EXPECT_EQ(65535, maxNumAdIdsFor<2 * kMaxConcurrency + common::PARTNER>);
+  EXPECT_EQ(
+      narrowAdIdWidth,
+      adIdWidthFor<kNarrowAdIdSchedulerIdOffset + common::PUBLISHER>);
+  EXPECT_EQ(1023, maxNumAdIdsFor<kNarrowAdIdSchedulerIdOffset>);
+}
+
+TEST(AttributionGameTest, TestSharedTimestampComparisons) {
+  size_t batchSize = 2;
+
+  std::vector<Touchpoint> touchpoints{
+      Touchpoint{
+          .id = {0, 0},
+          .isClick = {true, false},
+          .ts = {100, 100},
+          .adId = {1, 1}},
+      Touchpoint{
+          .id = {1, 1},
+          .isClick = {false, true},
+          .ts = {200, 300},
+          .adId = {2, 2}},
+      Touchpoint{
+          .id = {2, 2},
+          .isClick = {true, true},
+          .ts = {400, 500},
+          .adId = {3, 3}}};
+
+  std::vector<Conversion> conversions{
+      Conversion{.ts = {150, 50}, .convValue = {1, 1}},
+      Conversion{.ts = {450, 600}, .convValue = {2, 2}}};
+
+  AttributionGame<common::PUBLISHER> game(
+      std::make_unique<fbpcf::scheduler::PlaintextScheduler>(
+          fbpcf::scheduler::WireKeeper::createWithVectorArena<unsafe>()));
+
+  auto privateTouchpoints = game.privatelyShareTouchpoints(
+      touchpoints, common::InputEncryption::Plaintext);
+  auto privateConversions = game.privatelyShareConversions(
+      conversions, common::InputEncryption::Plaintext);
+  auto isTouchpointBeforeConversion = game.computeTouchpointsBeforeConversions(
+      privateTouchpoints, privateConversions);
+  EXPECT_EQ(conversions.size(), isTouchpointBeforeConversion.size());
+  EXPECT_EQ(
+      std::vector<bool>({true, false}),
+      isTouchpointBeforeConversion.at(0).at(0).openToParty(common::PUBLISHER)
+          .getValue());
+
+  for (auto ruleName :
+       {common::LAST_CLICK_1D,
+        common::LAST_TOUCH_1D,
+        common::LAST_TOUCH_2_7D}) {
+    auto rule = AttributionRule<common::PUBLISHER>::fromNameOrThrow(ruleName);
+    auto thresholds = game.privatelyShareThresholds(
+        touchpoints,
+        privateTouchpoints,
+        *rule,
+        batchSize,
+        common::InputEncryption::Plaintext);
+
+    auto separate = game.computeAttributionsHelper(
+        privateTouchpoints, privateConversions, *rule, thresholds, batchSize);
+    auto shared = game.computeAttributionsHelper(
+        privateTouchpoints,
+        privateConversions,
+        *rule,
+        thresholds,
+        batchSize,
+        isTouchpointBeforeConversion);
+    ASSERT_EQ(separate.size(), shared.size());
+    for (size_t i = 0; i < separate.size(); ++i) {
+      EXPECT_EQ(
+          separate.at(i).openToParty(common::PUBLISHER).getValue(),
+          shared.at(i).openToParty(common::PUBLISHER).getValue())
+          << ruleName;
+    }
+  }
+}
+
 TEST(AttributionGameTest, TestAttributionReformattedOutputLogicPlaintextBatch) {
   int batchSize = 2;
 
@@ -540,6 +722,32 @@ INSTANTIATE_TEST_SUITE_P(
           "_" + newOutputFormat;
     });
 
+TEST(AttributionGameTest, TestCorrectnessInUserBatches) {
+  gflags::FlagSaver flagSaver;
+  // Smaller than the number of users of the inputs, and not a divisor of it
+  FLAGS_attribution_users_per_batch = 3;
+  auto schedulerCreator =
+      fbpcf::getSchedulerCreator<unsafe>(common::SchedulerType::Lazy);
+  for (auto useNewOutputFormat : {false, true}) {
+    for (auto attributionRule :
+         {common::LAST_CLICK_1D, common::LAST_CLICK_1D_TARGETID}) {
+      testCorrectnessWithScheduler<true, common::InputEncryption::Plaintext>(
+          attributionRule, schedulerCreator, useNewOutputFormat);
+    }
+  }
+}
+
+TEST(AttributionGameTest, TestCorrectnessUnderMemoryBudget) {
+  gflags::FlagSaver flagSaver;
+  // Below the memory the test already holds, so that every batch after the
+  // first is shrunk, down to the smallest batch the governor allows
+  FLAGS_attribution_memory_budget_mb = 1;
+  auto schedulerCreator =
+      fbpcf::getSchedulerCreator<unsafe>(common::SchedulerType::Lazy);
+  testCorrectnessWithScheduler<true, common::InputEncryption::Plaintext>(
+      common::LAST_CLICK_1D, schedulerCreator, true);
+}
+
 class AttributionGameInputTestFixture
     : public ::testing::TestWithParam<std::tuple<
           common::SchedulerType,
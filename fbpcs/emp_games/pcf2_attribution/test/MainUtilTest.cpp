@@ -7,7 +7,11 @@
 
 #include <gtest/gtest.h>
 
+#include <filesystem>
+#include <stdexcept>
 #include <string>
+#include <vector>
+#include "folly/Random.h"
 #include "folly/logging/xlog.h"
 
 #include "fbpcs/emp_games/pcf2_attribution/MainUtil.h"
@@ -77,4 +81,28 @@ TEST(MainUtilTest, AttributionMainUtilMultipleFilesTest) {
       outputFilePaths[2]);
 }
 
+TEST(MainUtilTest, AttributionMainUtilJobListTest) {
+  auto jobListPath = (std::filesystem::temp_directory_path() /
+                      ("MainUtilTestJobList_" +
+                       std::to_string(folly::Random::rand32())))
+                         .native();
+  fbpcf::io::FileIOWrappers::writeFile(
+      jobListPath, "in_a,out_a\n\n  in_b , out_b\n");
+
+  auto [inputFilePaths, outputFilePaths] =
+      pcf2_attribution::getIOFilenamesForJobs(jobListPath, 2, 1, true);
+  EXPECT_EQ(
+      std::vector<std::string>({"in_a_1", "in_a_2", "in_b_1", "in_b_2"}),
+      inputFilePaths);
+  EXPECT_EQ(
+      std::vector<std::string>({"out_a_1", "out_a_2", "out_b_1", "out_b_2"}),
+      outputFilePaths);
+
+  fbpcf::io::FileIOWrappers::writeFile(jobListPath, "in_a\n");
+  EXPECT_THROW(
+      pcf2_attribution::getIOFilenamesForJobs(jobListPath, 1, 0, false),
+      std::invalid_argument);
+  std::filesystem::remove(jobListPath);
+}
+
 } // namespace pcf2_attribution
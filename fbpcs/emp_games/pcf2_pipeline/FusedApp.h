@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <folly/logging/xlog.h>
+
+#include "fbpcf/engine/communication/IPartyCommunicationAgentFactory.h"
+#include "fbpcf/scheduler/NetworkPlaintextSchedulerFactory.h"
+#include "fbpcf/util/MetricCollector.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
+#include "fbpcs/emp_games/common/FilePipeline.h"
+#include "fbpcs/emp_games/common/MetricTreeFormat.h"
+#include "fbpcs/emp_games/common/SchedulerHints.h"
+#include "fbpcs/emp_games/common/SchedulerPhase.h"
+#include "fbpcs/emp_games/common/SchedulerStatistics.h"
+#include "fbpcs/emp_games/common/ShardQueue.h"
+#include "fbpcs/emp_games/common/ShardReport.h"
+#include "fbpcs/emp_games/pcf2_aggregation/AggregationGame.h"
+#include "fbpcs/emp_games/pcf2_aggregation/Constants.h"
+#include "fbpcs/emp_games/pcf2_attribution/AttributionGame.h"
+#include "fbpcs/emp_games/pcf2_attribution/Constants.h"
+#include "fbpcs/emp_games/pcf2_pipeline/PipelineOptions.h"
+
+namespace pcf2_pipeline {
+
+// The aggregation games of fused apps take the scheduler ids from this offset
+// up, as they run next to the attribution games of the same lanes
+const int kFusedAggregationSchedulerIdOffset = 128;
+static_assert(
+    kFusedAggregationSchedulerIdOffset >
+        pcf2_attribution::kNarrowAdIdSchedulerIdOffset +
+            2 * pcf2_attribution::kMaxConcurrency + 1,
+    "The scheduler ids of the fused games must not overlap");
+
+/*
+ * Runs attribution and then aggregation on each of the files it takes, in one
+ * app on one lane, so that the secret shares attribution makes of a file go
+ * to aggregation in memory, instead of being written out, stored remotely and
+ * read and parsed back by a second app on a connection of its own.
+ *
+ * The two games keep a scheduler each, as every fbpcf game installs the
+ * scheduler it is made with, but both are made once for all the files of the
+ * app, on agents of the same lane. The shares of attribution are the XOR
+ * shares the aggregation game takes as its input, so they go from one game to
+ * the other without any traffic.
+ */
+template <int MY_ROLE, int attributionSchedulerId, int aggregationSchedulerId>
+class FusedApp {
+ public:
+  FusedApp(
+      std::unique_ptr<
+          fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+          communicationAgentFactory,
+      const std::string& attributionRules,
+      const std::string& aggregationFormats,
+      const std::vector<std::string>& inputFilenames,
+      const std::vector<std::string>& outputFilenames,
+      std::shared_ptr<fbpcf::util::MetricCollector> metricCollector,
+      bool useXorEncryption,
+      common::InputEncryption inputEncryption,
+      std::shared_ptr<common::ShardQueue> shardQueue,
+      int concurrency = 1)
+      : communicationAgentFactory_(std::move(communicationAgentFactory)),
+        attributionRules_{attributionRules},
+        aggregationFormats_{aggregationFormats},
+        inputFilenames_(inputFilenames),
+        outputFilenames_(outputFilenames),
+        metricCollector_(metricCollector),
+        useXorEncryption_(useXorEncryption),
+        inputEncryption_(inputEncryption),
+        shardQueue_(std::move(shardQueue)),
+        concurrency_(concurrency),
+        schedulerStatistics_{0, 0, 0, 0} {}
+
+  void run() {
+    // Both parties create the schedulers, and so their agents, in the same
+    // order
+    auto attributionScheduler = createScheduler(
+        common::getSchedulerHints(pcf2_attribution::kSchedulerHints));
+    auto aggregationScheduler = createScheduler(
+        common::getSchedulerHints(pcf2_aggregation::kSchedulerHints));
+    auto files = common::ShardAssignment(
+        MY_ROLE, shardQueue_, *communicationAgentFactory_);
+
+    pcf2_attribution::AttributionGame<attributionSchedulerId> attributionGame(
+        std::move(attributionScheduler));
+    pcf2_aggregation::AggregationGame<aggregationSchedulerId> aggregationGame(
+        std::move(aggregationScheduler),
+        std::move(communicationAgentFactory_),
+        inputEncryption_,
+        concurrency_);
+
+    // The inputs of both games are parsed from the input of the next file and
+    // the output of the previous one written while the games run on a file
+    common::ShardReporter reporter;
+    common::runFilesPipelined<
+        FusedInput,
+        pcf2_aggregation::AggregationOutputMetrics>(
+        files,
+        [this, &reporter](std::size_t i) {
+          CHECK_LT(i, inputFilenames_.size())
+              << "File index exceeds number of files.";
+          fbpcs::performance_tools::ScopedPhase phase{"input_parsing"};
+          common::ShardReporter::Phase shardPhase{reporter, i, "input_parsing"};
+          reporter.setInputPaths(i, {inputFilenames_.at(i)});
+          FusedInput input{
+              pcf2_attribution::AttributionInputMetrics{
+                  MY_ROLE,
+                  attributionRules_,
+                  inputFilenames_.at(i),
+                  inputEncryption_},
+              pcf2_aggregation::AggregationInputMetrics{
+                  MY_ROLE,
+                  inputEncryption_,
+                  inputFilenames_.at(i),
+                  aggregationFormats_}};
+          reporter.setNumRows(i, input.attribution.getIds().size());
+          return input;
+        },
+        [this, &attributionGame, &aggregationGame, &reporter](
+            std::size_t i, FusedInput input) {
+          {
+            fbpcs::performance_tools::ScopedPhase phase{
+                "attribution",
+                common::getSchedulerCounterReader<attributionSchedulerId>()};
+            common::ShardReporter::Phase shardPhase{
+                reporter,
+                i,
+                "attribution",
+                common::getSchedulerCounterReader<attributionSchedulerId>()};
+            input.aggregation.setAttributionShares(
+                attributionGame
+                    .computeAttributions(
+                        MY_ROLE, input.attribution, inputEncryption_)
+                    .toShares());
+          }
+
+          fbpcs::performance_tools::ScopedPhase phase{
+              "aggregation",
+              common::getSchedulerCounterReader<aggregationSchedulerId>()};
+          common::ShardReporter::Phase shardPhase{
+              reporter,
+              i,
+              "aggregation",
+              common::getSchedulerCounterReader<aggregationSchedulerId>()};
+          if (FLAGS_use_new_output_format) {
+            return aggregationGame.computeAggregationsReformatted(
+                MY_ROLE, input.aggregation);
+          }
+          return aggregationGame.computeAggregations(
+              MY_ROLE, input.aggregation);
+        },
+        [this, &reporter](
+            std::size_t i, pcf2_aggregation::AggregationOutputMetrics output) {
+          {
+            fbpcs::performance_tools::ScopedPhase phase{"output_writing"};
+            common::ShardReporter::Phase shardPhase{
+                reporter, i, "output_writing"};
+            putOutputData(output, outputFilenames_.at(i));
+          }
+          reporter.finish(i, outputFilenames_.at(i));
+        });
+
+    addSchedulerStatistics<attributionSchedulerId>();
+    addSchedulerStatistics<aggregationSchedulerId>();
+    XLOGF(
+        INFO,
+        "Non-free gate count = {}, Free gate count = {}",
+        schedulerStatistics_.nonFreeGates,
+        schedulerStatistics_.freeGates);
+    XLOGF(
+        INFO,
+        "Sent network traffic = {}, Received network traffic = {}",
+        schedulerStatistics_.sentNetwork,
+        schedulerStatistics_.receivedNetwork);
+    schedulerStatistics_.details = metricCollector_->collectMetrics();
+  }
+
+  common::SchedulerStatistics getSchedulerStatistics() {
+    return schedulerStatistics_;
+  }
+
+ private:
+  struct FusedInput {
+    pcf2_attribution::AttributionInputMetrics attribution;
+    pcf2_aggregation::AggregationInputMetrics aggregation;
+  };
+
+  std::unique_ptr<fbpcf::scheduler::IScheduler> createScheduler(
+      const common::SchedulerHints& hints) {
+    return useXorEncryption_
+        ? common::createRealScheduler(
+              hints, MY_ROLE, *communicationAgentFactory_, metricCollector_)
+        : fbpcf::scheduler::NetworkPlaintextSchedulerFactory<false>(
+              MY_ROLE, *communicationAgentFactory_, metricCollector_)
+              .create();
+  }
+
+  template <int schedulerId>
+  void addSchedulerStatistics() {
+    auto gateStatistics =
+        fbpcf::scheduler::SchedulerKeeper<schedulerId>::getGateStatistics();
+    auto trafficStatistics =
+        fbpcf::scheduler::SchedulerKeeper<schedulerId>::getTrafficStatistics();
+    schedulerStatistics_.nonFreeGates += gateStatistics.first;
+    schedulerStatistics_.freeGates += gateStatistics.second;
+    schedulerStatistics_.sentNetwork += trafficStatistics.first;
+    schedulerStatistics_.receivedNetwork += trafficStatistics.second;
+    fbpcf::scheduler::SchedulerKeeper<schedulerId>::deleteEngine();
+  }
+
+  void putOutputData(
+      const pcf2_aggregation::AggregationOutputMetrics& aggregationOutput,
+      const std::string& outputPath) {
+    if (FLAGS_use_binary_metrics_output) {
+      private_measurement::compressed_io::writeFile(
+          outputPath,
+          private_measurement::metric_tree::encode(
+              aggregationOutput.toDynamic()));
+      return;
+    }
+    private_measurement::compressed_io::writeFile(
+        outputPath, aggregationOutput.toJson());
+  }
+
+  std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+      communicationAgentFactory_;
+  std::string attributionRules_;
+  std::string aggregationFormats_;
+  std::vector<std::string> inputFilenames_;
+  std::vector<std::string> outputFilenames_;
+  std::shared_ptr<fbpcf::util::MetricCollector> metricCollector_;
+  bool useXorEncryption_;
+  common::InputEncryption inputEncryption_;
+  std::shared_ptr<common::ShardQueue> shardQueue_;
+  int concurrency_;
+  common::SchedulerStatistics schedulerStatistics_;
+};
+
+} // namespace pcf2_pipeline
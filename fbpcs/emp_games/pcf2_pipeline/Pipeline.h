@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <folly/Format.h>
+#include <folly/String.h>
+#include <folly/dynamic.h>
+#include <folly/logging/xlog.h>
+
+#include "fbpcf/engine/communication/SocketPartyCommunicationAgent.h"
+#include "fbpcs/emp_games/common/CompressedIO.h"
+#include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/MultiplexedConnection.h"
+#include "fbpcs/emp_games/common/SchedulerSlots.h"
+#include "fbpcs/emp_games/common/SchedulerStatistics.h"
+#include "fbpcs/emp_games/common/TrafficTrace.h"
+#include "fbpcs/emp_games/pcf2_aggregation/MainUtil.h"
+#include "fbpcs/emp_games/pcf2_attribution/MainUtil.h"
+#include "fbpcs/emp_games/pcf2_pipeline/FusedApp.h"
+
+/*
+Runs the stages of a private measurement run one after another in a single
+process, instead of a binary and container per stage. The process starts, the
+parties connect and TLS is set up once for every stage. The apps of all the
+stages run as lanes of one multiplexed connection, and the files one stage
+writes for the next can be kept on local disk instead of remote storage.
+*/
+namespace pcf2_pipeline {
+
+enum class Stage { kAttribution, kAggregation };
+
+inline std::string getStageName(Stage stage) {
+  switch (stage) {
+    case Stage::kAttribution:
+      return "attribution";
+    case Stage::kAggregation:
+      return "aggregation";
+  }
+  throw std::invalid_argument(
+      "Unknown stage " + std::to_string(static_cast<int>(stage)));
+}
+
+// The stages of a comma separated list, which have to be listed in the order
+// they depend on each other, each at most once
+inline std::vector<Stage> parseStages(const std::string& names) {
+  const std::vector<Stage> allStages{Stage::kAttribution, Stage::kAggregation};
+  std::vector<std::string> parts;
+  folly::split(',', names, parts, true /* ignoreEmpty */);
+
+  std::vector<Stage> stages;
+  for (const auto& part : parts) {
+    auto name = folly::trimWhitespace(part).str();
+    auto stage = std::find_if(
+        allStages.begin(), allStages.end(), [&name](Stage stage) {
+          return getStageName(stage) == name;
+        });
+    if (stage == allStages.end()) {
+      throw std::invalid_argument(folly::sformat(
+          "Unknown stage '{}'. Expected 'attribution' or 'aggregation'",
+          name));
+    }
+    if (!stages.empty() && *stage <= stages.back()) {
+      throw std::invalid_argument(folly::sformat(
+          "Stage '{}' is listed after a stage which depends on it or twice",
+          name));
+    }
+    stages.push_back(*stage);
+  }
+  if (stages.empty()) {
+    throw std::invalid_argument("No stage to run");
+  }
+  return stages;
+}
+
+// The first lane of the shared connection used by the apps of the stage at
+// stageIndex, so that no stage reuses the streams of an earlier one
+inline uint32_t getFirstLane(std::size_t stageIndex) {
+  constexpr uint32_t kLanesPerStage = 1 +
+      std::max(
+          pcf2_attribution::kMaxConcurrency, pcf2_aggregation::kMaxConcurrency);
+  return static_cast<uint32_t>(stageIndex) * kLanesPerStage;
+}
+
+struct PipelineConfig {
+  std::vector<Stage> stages;
+  // The inputs of attribution, which are also the clear text inputs of
+  // aggregation
+  std::vector<std::string> inputFilenames;
+  // The outputs of attribution read by aggregation
+  std::vector<std::string> intermediateFilenames;
+  // The outputs of the last stage
+  std::vector<std::string> outputFilenames;
+  int16_t concurrency;
+  std::string serverIp;
+  int port;
+  std::string attributionRules;
+  std::string aggregators;
+  bool useXorEncryption;
+  common::InputEncryption inputEncryption;
+  std::size_t adIdBits;
+  private_measurement::compressed_io::Codec networkCompression;
+  // Whether attribution and aggregation run fused in the same apps, with the
+  // shares passed between them in memory instead of intermediate files
+  bool fuseStages = false;
+};
+
+template <int PARTY, int attributionSchedulerIdOffset>
+common::SchedulerStatistics startFusedAppsHelper(
+    PipelineConfig& config,
+    std::shared_ptr<common::ShardQueue> shardQueue,
+    std::size_t numThreads,
+    std::shared_ptr<common::MultiplexedConnection> connection,
+    uint32_t firstLane) {
+  // Each app has a scheduler id for each game. Publisher uses even ids and
+  // partner odd ones, for attribution from the offset of its variant and for
+  // aggregation from the offset of the fused apps
+  common::SchedulerSlots<
+      pcf2_attribution::kMaxConcurrency,
+      std::unique_ptr<
+          fbpcf::engine::communication::IPartyCommunicationAgentFactory>,
+      std::shared_ptr<fbpcf::util::MetricCollector>>
+      slots([&](auto slot) {
+        constexpr int attributionSchedulerId =
+            attributionSchedulerIdOffset + 2 * decltype(slot)::value + PARTY;
+        constexpr int aggregationSchedulerId =
+            kFusedAggregationSchedulerIdOffset + 2 * decltype(slot)::value +
+            PARTY;
+        return [&](std::unique_ptr<fbpcf::engine::communication::
+                                       IPartyCommunicationAgentFactory>
+                       communicationAgentFactory,
+                   std::shared_ptr<fbpcf::util::MetricCollector>
+                       metricCollector) {
+          auto app = std::make_unique<FusedApp<
+              PARTY,
+              attributionSchedulerId,
+              aggregationSchedulerId>>(
+              std::move(communicationAgentFactory),
+              config.attributionRules,
+              config.aggregators,
+              config.inputFilenames,
+              config.outputFilenames,
+              metricCollector,
+              config.useXorEncryption,
+              config.inputEncryption,
+              shardQueue,
+              numThreads);
+          app->run();
+          return app->getSchedulerStatistics();
+        };
+      });
+
+  return common::runAppsInSlots(numThreads, [&](std::size_t slot) {
+    auto metricCollector =
+        std::make_shared<fbpcf::util::MetricCollector>("pipeline_metrics");
+    std::unique_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory>
+        communicationAgentFactory =
+            std::make_unique<common::MultiplexedAgentFactory>(
+                connection, firstLane + slot, metricCollector);
+    communicationAgentFactory = common::recordTraffic(
+        std::move(communicationAgentFactory),
+        common::getTrafficTracePath("pipeline", PARTY, firstLane + slot),
+        metricCollector);
+    communicationAgentFactory = common::compressTraffic(
+        std::move(communicationAgentFactory),
+        config.networkCompression,
+        metricCollector);
+    return std::async(
+        std::launch::async,
+        [&slots,
+         slot,
+         communicationAgentFactory = std::move(communicationAgentFactory),
+         metricCollector]() mutable {
+          return slots.run(
+              slot, std::move(communicationAgentFactory), metricCollector);
+        });
+  });
+}
+
+/*
+ * Runs attribution and aggregation fused, each app of the run on a lane of
+ * connection from firstLane up, computing both games on each file it takes.
+ * Nothing is written between the stages.
+ */
+template <int PARTY>
+common::SchedulerStatistics startFusedApps(
+    PipelineConfig& config,
+    std::shared_ptr<common::MultiplexedConnection> connection,
+    uint32_t firstLane) {
+  auto numThreads = std::min<std::size_t>(
+      config.inputFilenames.size(),
+      static_cast<std::size_t>(config.concurrency));
+  auto shardQueue = common::makeShardQueue(config.inputFilenames.size(), "");
+
+  if (config.adIdBits == pcf2_attribution::narrowAdIdWidth) {
+    return startFusedAppsHelper<
+        PARTY,
+        pcf2_attribution::kNarrowAdIdSchedulerIdOffset>(
+        config, shardQueue, numThreads, connection, firstLane);
+  }
+  if (config.adIdBits != pcf2_attribution::adIdWidth) {
+    throw std::invalid_argument(folly::sformat(
+        "Ad id width must be {} or {}, got {}",
+        pcf2_attribution::adIdWidth,
+        pcf2_attribution::narrowAdIdWidth,
+        config.adIdBits));
+  }
+  return startFusedAppsHelper<PARTY, 0>(
+      config, shardQueue, numThreads, connection, firstLane);
+}
+
+/*
+ * Runs the stages of config in order over one connection to the other party,
+ * which has to run the same stages. Returns the scheduler statistics of every
+ * stage added together.
+ */
+template <int PARTY>
+common::SchedulerStatistics runPipeline(
+    PipelineConfig& config,
+    fbpcf::engine::communication::SocketPartyCommunicationAgent::TlsInfo&
+        tlsInfo) {
+  auto connection = common::connectMultiplexed(
+      PARTY, config.serverIp, config.port, tlsInfo, "pipeline_connection");
+
+  if (config.fuseStages) {
+    XLOG(INFO) << "Starting the fused attribution and aggregation stages";
+    return startFusedApps<PARTY>(config, connection, getFirstLane(0));
+  }
+
+  common::SchedulerStatistics schedulerStatistics{
+      0, 0, 0, 0, folly::dynamic::object()};
+  for (std::size_t i = 0; i < config.stages.size(); ++i) {
+    auto stage = config.stages.at(i);
+    // The last stage writes the outputs of the run, the others write for the
+    // stages after them
+    bool isLast = i + 1 == config.stages.size();
+    XLOG(INFO) << "Starting the " << getStageName(stage) << " stage";
+
+    common::SchedulerStatistics stageStatistics;
+    switch (stage) {
+      case Stage::kAttribution:
+        stageStatistics =
+            pcf2_attribution::startAttributionAppsForShardedFiles<PARTY>(
+                config.useXorEncryption,
+                config.inputEncryption,
+                config.inputFilenames,
+                isLast ? config.outputFilenames : config.intermediateFilenames,
+                config.concurrency,
+                config.serverIp,
+                config.port,
+                config.attributionRules,
+                tlsInfo,
+                "" /* shardCostManifest */,
+                config.adIdBits,
+                true /* multiplexConnections */,
+                std::nullopt /* adaptiveConcurrency */,
+                config.networkCompression,
+                connection,
+                getFirstLane(i));
+        break;
+      case Stage::kAggregation:
+        stageStatistics =
+            pcf2_aggregation::startAggregationAppsForShardedFiles<PARTY>(
+                config.inputEncryption,
+                config.useXorEncryption ? common::Visibility::Xor
+                                        : common::Visibility::Publisher,
+                config.intermediateFilenames,
+                config.inputFilenames,
+                config.outputFilenames,
+                config.concurrency,
+                config.serverIp,
+                config.port,
+                config.aggregators,
+                tlsInfo,
+                "" /* shardCostManifest */,
+                true /* multiplexConnections */,
+                std::nullopt /* adaptiveConcurrency */,
+                config.networkCompression,
+                connection,
+                getFirstLane(i));
+        break;
+    }
+    XLOGF(
+        INFO,
+        "Finished the {} stage. Sent network traffic = {}, Received network "
+        "traffic = {}",
+        getStageName(stage),
+        stageStatistics.sentNetwork,
+        stageStatistics.receivedNetwork);
+    schedulerStatistics.add(stageStatistics);
+  }
+  return schedulerStatistics;
+}
+
+} // namespace pcf2_pipeline
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "fbpcs/emp_games/pcf2_pipeline/PipelineOptions.h"
+
+#include <gflags/gflags.h>
+
+DEFINE_string(
+    stages,
+    "attribution,aggregation",
+    "Comma separated list of the stages to run in this process, in order - "
+    "options: (attribution|aggregation)");
+DEFINE_string(
+    intermediate_base_path,
+    "",
+    "Base path of the files attribution writes and aggregation reads the "
+    "secret shares from. A local path keeps them off remote storage");
+DEFINE_bool(
+    use_binary_metrics_output,
+    false,
+    "Write the secret shares of the metrics in the binary metric tree format "
+    "the shard combiners read without parsing JSON, instead of as JSON");
+DEFINE_bool(
+    fuse_stages,
+    false,
+    "Run attribution and aggregation in the same apps, passing the secret "
+    "shares of attribution to aggregation in memory instead of through "
+    "intermediate files. Needs both stages");
@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <gflags/gflags_declare.h>
+
+// The flags of the stages are those of pcf2_attribution, which the pipeline
+// links, with the flags below added for the pipeline and for aggregation
+#include "fbpcs/emp_games/pcf2_attribution/AttributionOptions.h"
+
+DECLARE_string(stages);
+DECLARE_string(intermediate_base_path);
+DECLARE_bool(use_binary_metrics_output);
+DECLARE_bool(fuse_stages);
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <signal.h>
+#include <algorithm>
+#include <string>
+
+#include "folly/Format.h"
+#include "folly/init/Init.h"
+#include "folly/logging/xlog.h"
+
+#include <fbpcf/aws/AwsSdk.h>
+#include <fbpcs/performance_tools/CostEstimation.h>
+
+#include "fbpcs/emp_games/common/InputCache.h"
+#include "fbpcs/emp_games/pcf2_pipeline/Pipeline.h"
+#include "fbpcs/emp_games/pcf2_pipeline/PipelineOptions.h"
+
+int main(int argc, char* argv[]) {
+  folly::init(&argc, &argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  fbpcs::performance_tools::CostEstimation cost =
+      fbpcs::performance_tools::CostEstimation(
+          "pipeline",
+          FLAGS_log_cost_s3_bucket,
+          FLAGS_log_cost_s3_region,
+          "pcf2");
+  cost.start();
+
+  fbpcf::AwsSdk::aquire();
+
+  signal(SIGPIPE, SIG_IGN);
+
+  FLAGS_party--; // subtract 1 because we use 0 and 1 for publisher and partner
+                 // instead of 1 and 2
+
+  XLOGF(INFO, "Party: {}", FLAGS_party);
+  XLOGF(INFO, "Server IP: {}", FLAGS_server_ip);
+  XLOGF(INFO, "Port: {}", FLAGS_port);
+  XLOGF(INFO, "Stages: {}", FLAGS_stages);
+  XLOGF(INFO, "Fuse stages: {}", FLAGS_fuse_stages);
+  XLOGF(INFO, "Base input path: {}", FLAGS_input_base_path);
+  XLOGF(INFO, "Base intermediate path: {}", FLAGS_intermediate_base_path);
+  XLOGF(INFO, "Base output path: {}", FLAGS_output_base_path);
+  XLOGF(INFO, "Run Id: {}", FLAGS_run_id);
+  XLOGF(INFO, "Input cache directory: {}", FLAGS_input_cache_directory);
+
+  private_measurement::compressed_io::setInputCacheDirectory(
+      FLAGS_input_cache_directory);
+
+  common::SchedulerStatistics schedulerStatistics;
+  try {
+    pcf2_pipeline::PipelineConfig config;
+    config.stages = pcf2_pipeline::parseStages(FLAGS_stages);
+    config.fuseStages = FLAGS_fuse_stages;
+    if (config.fuseStages && config.stages.size() != 2) {
+      throw std::invalid_argument(
+          "fuse_stages needs both the attribution and aggregation stages");
+    }
+    if (config.stages.size() > 1 && !config.fuseStages &&
+        FLAGS_intermediate_base_path.empty()) {
+      throw std::invalid_argument(
+          "intermediate_base_path is needed to run more than one stage");
+    }
+
+    auto [inputFilenames, outputFilenames] = pcf2_attribution::getIOFilenames(
+        FLAGS_num_files,
+        FLAGS_input_base_path,
+        FLAGS_output_base_path,
+        FLAGS_file_start_index,
+        FLAGS_use_postfix);
+    config.inputFilenames = std::move(inputFilenames);
+    config.outputFilenames = std::move(outputFilenames);
+    config.intermediateFilenames = pcf2_aggregation::getIOInputFilenames(
+        FLAGS_num_files,
+        FLAGS_intermediate_base_path,
+        FLAGS_file_start_index,
+        FLAGS_use_postfix);
+
+    config.concurrency = static_cast<int16_t>(FLAGS_concurrency);
+    CHECK_LE(
+        config.concurrency,
+        std::min(
+            pcf2_attribution::kMaxConcurrency,
+            pcf2_aggregation::kMaxConcurrency))
+        << "Concurrency is too high";
+    config.serverIp = FLAGS_server_ip;
+    config.port = FLAGS_port;
+    config.attributionRules = FLAGS_attribution_rules;
+    config.aggregators = FLAGS_aggregators;
+    config.useXorEncryption = FLAGS_use_xor_encryption;
+    config.inputEncryption = common::InputEncryption::Plaintext;
+    if (FLAGS_input_encryption == 1) {
+      config.inputEncryption = common::InputEncryption::PartnerXor;
+    } else if (FLAGS_input_encryption == 2) {
+      config.inputEncryption = common::InputEncryption::Xor;
+    }
+    config.adIdBits = FLAGS_ad_id_width;
+    config.networkCompression = private_measurement::compressed_io::parseCodec(
+        FLAGS_network_compression);
+
+    auto tlsInfo = fbpcf::engine::communication::getTlsInfoFromArgs(
+        FLAGS_use_tls,
+        FLAGS_ca_cert_path,
+        FLAGS_server_cert_path,
+        FLAGS_private_key_path,
+        "");
+
+    if (FLAGS_party == common::PUBLISHER) {
+      XLOG(INFO) << "Starting the pipeline as Publisher, will wait for "
+                    "Partner...";
+      schedulerStatistics =
+          pcf2_pipeline::runPipeline<common::PUBLISHER>(config, tlsInfo);
+    } else if (FLAGS_party == common::PARTNER) {
+      XLOG(INFO) << "Starting the pipeline as Partner, will wait for "
+                    "Publisher...";
+      schedulerStatistics =
+          pcf2_pipeline::runPipeline<common::PARTNER>(config, tlsInfo);
+    } else {
+      XLOGF(FATAL, "Invalid Party: {}", FLAGS_party);
+    }
+  } catch (const std::exception& e) {
+    XLOG(ERR) << "Error: Exception caught in the pipeline run.\n \t error msg: "
+              << e.what() << "\n \t input directory: " << FLAGS_input_base_path;
+    std::exit(1);
+  }
+
+  cost.end();
+  XLOG(INFO, cost.getEstimatedCostString());
+
+  XLOGF(
+      INFO,
+      "Non-free gate count = {}, Free gate count = {}",
+      schedulerStatistics.nonFreeGates,
+      schedulerStatistics.freeGates);
+
+  XLOGF(
+      INFO,
+      "Sent network traffic = {}, Received network traffic = {}",
+      schedulerStatistics.sentNetwork,
+      schedulerStatistics.receivedNetwork);
+
+  return 0;
+}
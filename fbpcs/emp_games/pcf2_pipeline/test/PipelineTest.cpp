@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fbpcf/io/api/FileIOWrappers.h>
+#include "folly/Random.h"
+#include "folly/json.h"
+
+#include "fbpcf/engine/communication/test/SocketInTestHelper.h"
+#include "fbpcs/emp_games/common/TestUtil.h"
+#include "fbpcs/emp_games/pcf2_pipeline/Pipeline.h"
+
+namespace pcf2_pipeline {
+
+TEST(PipelineTest, TestParseStages) {
+  EXPECT_EQ(
+      (std::vector<Stage>{Stage::kAttribution, Stage::kAggregation}),
+      parseStages("attribution, aggregation"));
+  EXPECT_EQ(
+      std::vector<Stage>{Stage::kAggregation}, parseStages("aggregation"));
+}
+
+TEST(PipelineTest, TestRejectsInvalidStages) {
+  EXPECT_THROW(parseStages(""), std::invalid_argument);
+  EXPECT_THROW(parseStages("attribution,lift"), std::invalid_argument);
+  EXPECT_THROW(parseStages("aggregation,attribution"), std::invalid_argument);
+  EXPECT_THROW(parseStages("attribution,attribution"), std::invalid_argument);
+}
+
+TEST(PipelineTest, TestStagesUseSeparateLanes) {
+  EXPECT_EQ(0, getFirstLane(0));
+  EXPECT_GT(getFirstLane(1), pcf2_attribution::kMaxConcurrency);
+  EXPECT_GT(getFirstLane(1), pcf2_aggregation::kMaxConcurrency);
+}
+
+// Runs the pipeline of the party, which writes its output to outputPath
+template <int PARTY>
+static void runParty(
+    bool fuseStages,
+    int port,
+    const std::string& inputPath,
+    const std::string& intermediatePath,
+    const std::string& outputPath) {
+  PipelineConfig config;
+  config.stages = {Stage::kAttribution, Stage::kAggregation};
+  config.fuseStages = fuseStages;
+  config.inputFilenames = {inputPath};
+  config.intermediateFilenames = {intermediatePath};
+  config.outputFilenames = {outputPath};
+  config.concurrency = 1;
+  config.serverIp = "127.0.0.1";
+  config.port = port;
+  config.attributionRules =
+      PARTY == common::PUBLISHER ? common::LAST_CLICK_1D : "";
+  config.aggregators = PARTY == common::PUBLISHER ? common::MEASUREMENT : "";
+  config.useXorEncryption = false;
+  config.inputEncryption = common::InputEncryption::Plaintext;
+  config.adIdBits = pcf2_attribution::adIdWidth;
+  config.networkCompression = private_measurement::compressed_io::Codec::kNone;
+  fbpcf::engine::communication::SocketPartyCommunicationAgent::TlsInfo tlsInfo;
+  tlsInfo.useTls = false;
+  runPipeline<PARTY>(config, tlsInfo);
+}
+
+// Runs the pipeline of both parties on the last click 1d inputs, and returns
+// the outputs of the publisher and of the partner
+static std::pair<folly::dynamic, folly::dynamic> runBothParties(
+    bool fuseStages) {
+  auto inputPrefix =
+      private_measurement::test_util::getBaseDirFromPath(__FILE__) +
+      "../../pcf2_attribution/test/test_correctness/" + common::LAST_CLICK_1D;
+  auto tmpPrefix = (std::filesystem::temp_directory_path() /
+                    ("PipelineTest_" +
+                     std::to_string(folly::Random::secureRand64())))
+                       .string();
+  auto port =
+      fbpcf::engine::communication::SocketInTestHelper::findNextOpenPort(5000);
+
+  auto futurePublisher = std::async(
+      std::launch::async,
+      runParty<common::PUBLISHER>,
+      fuseStages,
+      port,
+      inputPrefix + ".publisher.csv",
+      tmpPrefix + "_publisher_intermediate",
+      tmpPrefix + "_publisher_output");
+  auto futurePartner = std::async(
+      std::launch::async,
+      runParty<common::PARTNER>,
+      fuseStages,
+      port,
+      inputPrefix + ".partner.csv",
+      tmpPrefix + "_partner_intermediate",
+      tmpPrefix + "_partner_output");
+  futurePublisher.get();
+  futurePartner.get();
+
+  std::pair<folly::dynamic, folly::dynamic> outputs{
+      folly::parseJson(fbpcf::io::FileIOWrappers::readFile(
+          tmpPrefix + "_publisher_output")),
+      folly::parseJson(fbpcf::io::FileIOWrappers::readFile(
+          tmpPrefix + "_partner_output"))};
+  for (auto suffix :
+       {"_publisher_intermediate",
+        "_publisher_output",
+        "_partner_intermediate",
+        "_partner_output"}) {
+    std::filesystem::remove(tmpPrefix + suffix);
+  }
+  return outputs;
+}
+
+// Fusing the stages only changes how the shares get from attribution to
+// aggregation, not what either party outputs
+TEST(PipelineTest, TestFusedOutputEqualsStagedOutput) {
+  auto [stagedPublisher, stagedPartner] = runBothParties(false);
+  auto [fusedPublisher, fusedPartner] = runBothParties(true);
+  EXPECT_EQ(stagedPublisher, fusedPublisher);
+  EXPECT_EQ(stagedPartner, fusedPartner);
+}
+
+} // namespace pcf2_pipeline
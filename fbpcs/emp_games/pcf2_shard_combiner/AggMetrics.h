@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <map>
 #include <memory>
@@ -138,9 +139,35 @@ class AggMetrics {
   // SecMetricVariant.
   void updateSecValueFromPublicInt();
 
-  // Traverses through all children and calls updateSecValueFromRawInt.
+  // Traverses through all children and calls updateSecValueFromRawInt. With
+  // batched XOR shares, the secret values of all the leaves are constructed
+  // in one batch instead.
   void updateAllSecVals();
 
+  // Same as updateAllSecVals on each of metrics in turn, except that with
+  // batched XOR shares the raw ints of the leaves of all of them are laid out
+  // in one buffer and constructed in a single batch.
+  static void updateAllSecVals(
+      const std::vector<std::shared_ptr<
+          AggMetrics<schedulerId, usingBatch, inputEncryption>>>& metrics);
+
+  // Appends the value nodes of the tree to leaves, in the order of the keys of
+  // the dicts and of the elements of the lists.
+  void appendLeaves(
+      std::vector<AggMetrics<schedulerId, usingBatch, inputEncryption>*>&
+          leaves);
+
+  // Whether rhs has the same dict keys and list sizes all the way down, so
+  // that appendLeaves lists the same metrics of both in the same order.
+  bool hasSameSchema(
+      const AggMetrics<schedulerId, usingBatch, inputEncryption>& rhs) const;
+
+  // A hash of the types, dict keys and list sizes down to depth levels below
+  // this one, of which only the types are hashed, which is the same for
+  // metrics of the same schema within a process. Metrics with different
+  // fingerprints differ in those levels.
+  uint64_t getSchemaFingerprint(std::size_t depth) const;
+
   // Value is moved to val_.
   void setList(MetricsList& v);
 
@@ -179,7 +206,8 @@ class AggMetrics {
   newLike(const std::shared_ptr<
           AggMetrics<schedulerId, usingBatch, inputEncryption>>& rhs);
 
-  // Parses the Json into AggMetrics object.
+  // Parses the Json into AggMetrics object. Files in the binary metric tree
+  // format are decoded instead.
   static std::shared_ptr<AggMetrics<schedulerId, usingBatch, inputEncryption>>
   fromJson(std::string filePath);
 
@@ -190,6 +218,18 @@ class AggMetrics {
   // Note: use this method reveal final output metric.
   folly::dynamic toRevealedDynamic(int party) const;
 
+  // Same as toRevealedDynamic for each of parties, but opens every value of
+  // the metrics to all of them in one batch, which the scheduler runs in a
+  // single round, instead of one open per value and party.
+  std::vector<folly::dynamic> toRevealedDynamics(
+      const std::vector<int>& parties);
+
+  // Emits dynamic object with this party's XOR share of each value instead of
+  // the value, all extracted in one batch with batched values. The output is
+  // still secret and is read back by fromJson like any other shard, so that
+  // partial sums can be combined further.
+  folly::dynamic toSecretShareDynamic();
+
   // writes object with indentation to the ostream obj.
   void print(std::ostream& os, int32_t tabstop) const;
 
@@ -209,14 +249,30 @@ class AggMetrics {
   }
 
  private:
+  // Adds rhs to lhs by walking both trees together by reference, so that no
+  // node or container is copied on the way down.
+  static void accumulateNode(
+      AggMetrics<schedulerId, usingBatch, inputEncryption>& lhs,
+      const AggMetrics<schedulerId, usingBatch, inputEncryption>& rhs);
+
   // This is the actual accumulate operation that gets called on the leaf node.
   // Reason for writing this function separately is that, newer backends
   // can be easily configured. (like Arithemetic-SS for instance).
   static void accumulateFinal(
-      std::shared_ptr<AggMetrics<schedulerId, usingBatch, inputEncryption>>&
-          lhs,
-      const std::shared_ptr<
-          AggMetrics<schedulerId, usingBatch, inputEncryption>>& rhs);
+      AggMetrics<schedulerId, usingBatch, inputEncryption>& lhs,
+      const AggMetrics<schedulerId, usingBatch, inputEncryption>& rhs);
+
+  // Sets the secret values of the leaves from their raw ints, in one batch
+  // with batched XOR shares.
+  static void updateLeafSecVals(
+      const std::vector<AggMetrics<schedulerId, usingBatch, inputEncryption>*>&
+          leaves);
+
+  // Emits the dynamic object of the metrics with the values of the leaves
+  // taken from leafValues, starting at next, in the order of appendLeaves.
+  folly::dynamic toDynamicWithLeaves(
+      const std::vector<folly::dynamic>& leafValues,
+      size_t& next) const;
 
   // helper for print
   void printSpaces(std::ostream& os, int32_t n) const;
@@ -176,4 +176,61 @@ TEST_F(AggMetricsTest, AccumulatePlainTextTest) {
   EXPECT_EQ(result->toDynamic(), expectedResultDynObj);
 }
 
+TEST_F(AggMetricsTest, AccumulateMergesDictKeys) {
+  auto makeDict = [](const std::vector<std::pair<std::string, int64_t>>& kvs) {
+    auto dict = std::make_shared<AggMetrics<>>(AggMetricType::kDict);
+    for (const auto& [key, value] : kvs) {
+      dict->insert(std::make_pair(key, std::make_shared<AggMetrics<>>(value)));
+    }
+    return dict;
+  };
+
+  auto result = makeDict({{"b", 1}, {"d", 2}});
+  auto rhs = makeDict({{"a", 10}, {"b", 20}, {"c", 30}, {"e", 40}});
+  AggMetrics<>::accumulate(result, rhs);
+
+  EXPECT_EQ(
+      result->toDynamic(),
+      folly::dynamic::object("a", 10)("b", 21)("c", 30)("d", 2)("e", 40));
+}
+
+TEST_F(AggMetricsTest, TestLeavesAndSchema) {
+  auto inputPath1 =
+      baseDir_ + "test_new_parser/accumulate_test_input_plaintext_1.json";
+  auto input1 = AggMetrics<>::fromJson(inputPath1);
+  auto input2 = AggMetrics<>::fromJson(inputPath1);
+  EXPECT_TRUE(input1->hasSameSchema(*input2));
+
+  std::vector<AggMetrics<>*> leaves;
+  input1->appendLeaves(leaves);
+  ASSERT_EQ(leaves.size(), 2);
+  EXPECT_EQ(leaves.at(0)->getValue(), 2);
+  EXPECT_EQ(leaves.at(1)->getValue(), 3);
+
+  auto dict = std::make_shared<AggMetrics<>>(AggMetricType::kDict);
+  dict->insert(std::make_pair("a", std::make_shared<AggMetrics<>>(1)));
+  auto otherDict = std::make_shared<AggMetrics<>>(AggMetricType::kDict);
+  otherDict->insert(std::make_pair("b", std::make_shared<AggMetrics<>>(1)));
+  EXPECT_FALSE(dict->hasSameSchema(*otherDict));
+  EXPECT_FALSE(dict->hasSameSchema(*input1));
+
+  EXPECT_EQ(
+      input1->getSchemaFingerprint(5), input2->getSchemaFingerprint(5));
+  EXPECT_NE(
+      dict->getSchemaFingerprint(1), otherDict->getSchemaFingerprint(1));
+  EXPECT_NE(dict->getSchemaFingerprint(1), input1->getSchemaFingerprint(1));
+
+  // Only the types are hashed at the last level
+  EXPECT_EQ(
+      dict->getSchemaFingerprint(0), otherDict->getSchemaFingerprint(0));
+  auto nested = std::make_shared<AggMetrics<>>(AggMetricType::kDict);
+  nested->insert(std::make_pair("a", dict));
+  auto otherNested = std::make_shared<AggMetrics<>>(AggMetricType::kDict);
+  otherNested->insert(std::make_pair("a", otherDict));
+  EXPECT_EQ(
+      nested->getSchemaFingerprint(1), otherNested->getSchemaFingerprint(1));
+  EXPECT_NE(
+      nested->getSchemaFingerprint(2), otherNested->getSchemaFingerprint(2));
+}
+
 } // namespace shard_combiner
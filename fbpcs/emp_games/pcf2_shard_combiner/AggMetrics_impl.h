@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <iterator>
 #include <memory>
 #include <ostream>
 #include <queue>
@@ -15,12 +17,15 @@
 #include <folly/FBString.h>
 #include <folly/Format.h>
 #include <folly/dynamic.h>
+#include <folly/hash/Hash.h>
 #include <folly/json.h>
 #include <folly/logging/xlog.h>
 
 #include <fbpcf/exception/exceptions.h>
 #include <fbpcf/io/api/FileIOWrappers.h>
+#include <fbpcs/emp_games/common/CompressedIO.h>
 #include <fbpcs/emp_games/common/Constants.h>
+#include <fbpcs/emp_games/common/MetricTreeFormat.h>
 #include <fbpcs/emp_games/pcf2_shard_combiner/AggMetrics.h>
 
 namespace shard_combiner {
@@ -35,14 +40,13 @@ template <
     bool usingBatch,
     common::InputEncryption inputEncryption>
 void AggMetrics<schedulerId, usingBatch, inputEncryption>::accumulateFinal(
-    std::shared_ptr<AggMetrics<schedulerId, usingBatch, inputEncryption>>& lhs,
-    const std::shared_ptr<AggMetrics<schedulerId, usingBatch, inputEncryption>>&
-        rhs) {
+    AggMetrics<schedulerId, usingBatch, inputEncryption>& lhs,
+    const AggMetrics<schedulerId, usingBatch, inputEncryption>& rhs) {
   if constexpr (inputEncryption == common::InputEncryption::Plaintext) {
-    lhs->setValue(lhs->getValue() + rhs->getValue());
+    lhs.setValue(lhs.getValue() + rhs.getValue());
   } else if constexpr (inputEncryption == common::InputEncryption::Xor) {
-    auto res = lhs->getSecValueXor() + rhs->getSecValueXor();
-    lhs->setSecValueXor(res);
+    auto res = lhs.getSecValueXor() + rhs.getSecValueXor();
+    lhs.setSecValueXor(res);
   } else {
     throw common::exceptions::NotImplementedError(
         "This method will patched with tests in the future.");
@@ -77,54 +81,60 @@ void AggMetrics<schedulerId, usingBatch, inputEncryption>::accumulate(
     std::shared_ptr<AggMetrics<schedulerId, usingBatch, inputEncryption>>& lhs,
     const std::shared_ptr<AggMetrics<schedulerId, usingBatch, inputEncryption>>&
         rhs) {
-  if (lhs->getType() != rhs->getType()) {
+  accumulateNode(*lhs, *rhs);
+}
+
+template <
+    int schedulerId,
+    bool usingBatch,
+    common::InputEncryption inputEncryption>
+void AggMetrics<schedulerId, usingBatch, inputEncryption>::accumulateNode(
+    AggMetrics<schedulerId, usingBatch, inputEncryption>& lhs,
+    const AggMetrics<schedulerId, usingBatch, inputEncryption>& rhs) {
+  if (lhs.getType() != rhs.getType()) {
     throw common::exceptions::InvalidAccessError(
         "Rhs and lhs has to be of the same type");
   }
 
-  using AggMetric_sp =
-      std::shared_ptr<AggMetrics<schedulerId, usingBatch, inputEncryption>>;
-  std::queue<std::pair<AggMetric_sp, AggMetric_sp>> q_;
-
-  q_.push(std::make_pair(lhs, rhs));
-
-  while (!q_.empty()) {
-    auto [lhsMetric, rhsMetric] = q_.front();
-    q_.pop();
-    switch (rhsMetric->getType()) {
-      case AggMetricType::kDict: {
-        auto lhsMetricMap = lhsMetric->getAsDict();
-        for (const auto& [key, innerMetricsRhs] : rhsMetric->getAsDict()) {
-          if (lhsMetricMap.find(key) != lhsMetricMap.end()) {
-            auto innerMetricLhs = lhsMetricMap.at(key);
-            q_.push(std::make_pair(innerMetricLhs, innerMetricsRhs));
-          } else {
-            // rhs has a key that lhs does not. We can simply assign it to lhs
-            // as rhs usually used only once, so no need to copy. Also, no need
-            // to traverse because we don't have add to rhs down that path.
-            lhsMetric->insert(std::make_pair(key, innerMetricsRhs));
-          }
+  switch (rhs.getType()) {
+    case AggMetricType::kDict: {
+      // Both dicts are sorted by key, so they are merged in one pass instead
+      // of looking up every key of rhs in lhs.
+      auto& lhsMetricMap = std::get<MetricsDict>(lhs.val_);
+      auto lhsIt = lhsMetricMap.begin();
+      for (const auto& [key, innerMetricRhs] : rhs.getAsDict()) {
+        while (lhsIt != lhsMetricMap.end() && lhsIt->first < key) {
+          ++lhsIt;
+        }
+        if (lhsIt != lhsMetricMap.end() && lhsIt->first == key) {
+          accumulateNode(*lhsIt->second, *innerMetricRhs);
+        } else {
+          // rhs has a key that lhs does not. We can simply assign it to lhs
+          // as rhs usually used only once, so no need to copy. Also, no need
+          // to traverse because we don't have add to rhs down that path.
+          lhsIt = std::next(
+              lhsMetricMap.emplace_hint(lhsIt, key, innerMetricRhs));
         }
-        break;
       }
-      case AggMetricType::kList: {
-        auto aggMetricList = lhsMetric->getAsList();
-        auto metricList = rhsMetric->getAsList();
+      break;
+    }
+    case AggMetricType::kList: {
+      const auto& aggMetricList = lhs.getAsList();
+      const auto& metricList = rhs.getAsList();
 
-        if (aggMetricList.size() != metricList.size()) {
-          XLOG(ERR) << "Rhs and Lhs list do not match in size";
-          throw common::exceptions::SchemaTraceError(
-              "Rhs and Lhs list do not match in size");
-        }
-        for (size_t i = 0; i != aggMetricList.size(); ++i) {
-          q_.push(std::make_pair(aggMetricList.at(i), metricList.at(i)));
-        }
-        break;
+      if (aggMetricList.size() != metricList.size()) {
+        XLOG(ERR) << "Rhs and Lhs list do not match in size";
+        throw common::exceptions::SchemaTraceError(
+            "Rhs and Lhs list do not match in size");
       }
-      case AggMetricType::kValue: {
-        accumulateFinal(lhsMetric, rhsMetric);
-        break;
+      for (size_t i = 0; i != aggMetricList.size(); ++i) {
+        accumulateNode(*aggMetricList.at(i), *metricList.at(i));
       }
+      break;
+    }
+    case AggMetricType::kValue: {
+      accumulateFinal(lhs, rhs);
+      break;
     }
   }
 }
@@ -392,7 +402,10 @@ template <
 std::shared_ptr<AggMetrics<schedulerId, usingBatch, inputEncryption>>
 AggMetrics<schedulerId, usingBatch, inputEncryption>::fromJson(
     std::string filePath) {
-  auto dynObj = folly::parseJson(fbpcf::io::FileIOWrappers::readFile(filePath));
+  auto content = private_measurement::compressed_io::readFile(filePath);
+  auto dynObj = private_measurement::metric_tree::hasMagic(content)
+      ? private_measurement::metric_tree::decode(content)
+      : folly::parseJson(content);
 
   using AggMetric_sp =
       std::shared_ptr<AggMetrics<schedulerId, usingBatch, inputEncryption>>;
@@ -611,36 +624,303 @@ AggMetrics<schedulerId, usingBatch, inputEncryption>::toRevealedDynamic(
   }
 }
 
+template <
+    int schedulerId,
+    bool usingBatch,
+    common::InputEncryption inputEncryption>
+std::vector<folly::dynamic>
+AggMetrics<schedulerId, usingBatch, inputEncryption>::toRevealedDynamics(
+    const std::vector<int>& parties) {
+  if constexpr (inputEncryption == common::InputEncryption::Xor) {
+    std::vector<AggMetrics<schedulerId, usingBatch, inputEncryption>*> leaves;
+    appendLeaves(leaves);
+    std::vector<std::vector<folly::dynamic>> leafValues(parties.size());
+    if (!leaves.empty()) {
+      std::vector<SecInt<schedulerId, usingBatch>> values;
+      values.reserve(leaves.size());
+      for (const auto leaf : leaves) {
+        values.push_back(leaf->getSecValueXor());
+      }
+
+      // Every open is issued before any of them is read, so that they are
+      // evaluated together
+      if constexpr (usingBatch) {
+        auto batch = values.at(0).batchingWith(
+            std::vector<SecInt<schedulerId, usingBatch>>(
+                values.begin() + 1, values.end()));
+        std::vector<decltype(batch.openToParty(0))> opened;
+        for (auto party : parties) {
+          opened.push_back(batch.openToParty(party));
+        }
+        for (size_t i = 0; i < parties.size(); ++i) {
+          for (auto value : opened.at(i).getValue()) {
+            leafValues.at(i).push_back(value);
+          }
+        }
+      } else {
+        std::vector<std::vector<decltype(values.at(0).openToParty(0))>> opened(
+            parties.size());
+        for (size_t i = 0; i < parties.size(); ++i) {
+          for (const auto& value : values) {
+            opened.at(i).push_back(value.openToParty(parties.at(i)));
+          }
+        }
+        for (size_t i = 0; i < parties.size(); ++i) {
+          for (const auto& value : opened.at(i)) {
+            leafValues.at(i).push_back(value.getValue());
+          }
+        }
+      }
+    }
+
+    std::vector<folly::dynamic> out;
+    out.reserve(parties.size());
+    for (const auto& values : leafValues) {
+      size_t next = 0;
+      out.push_back(toDynamicWithLeaves(values, next));
+    }
+    return out;
+  } else {
+    XLOG(ERR, "To reveal metrics it has to be encrypted as a Xor-SS");
+    throw common::exceptions::InvalidAccessError(
+        "To reveal metrics it has to be encrypted as a Xor-SS");
+  }
+}
+
+template <
+    int schedulerId,
+    bool usingBatch,
+    common::InputEncryption inputEncryption>
+folly::dynamic
+AggMetrics<schedulerId, usingBatch, inputEncryption>::toSecretShareDynamic() {
+  if constexpr (inputEncryption == common::InputEncryption::Xor) {
+    std::vector<AggMetrics<schedulerId, usingBatch, inputEncryption>*> leaves;
+    appendLeaves(leaves);
+    std::vector<folly::dynamic> shares;
+    shares.reserve(leaves.size());
+    if (!leaves.empty()) {
+      if constexpr (usingBatch) {
+        std::vector<SecInt<schedulerId, usingBatch>> values;
+        values.reserve(leaves.size() - 1);
+        for (size_t i = 1; i < leaves.size(); ++i) {
+          values.push_back(leaves.at(i)->getSecValueXor());
+        }
+        auto batch = leaves.at(0)->getSecValueXor().batchingWith(values);
+        for (auto share : batch.extractIntShare().getValue()) {
+          shares.push_back(share);
+        }
+      } else {
+        for (const auto leaf : leaves) {
+          shares.push_back(
+              leaf->getSecValueXor().extractIntShare().getValue());
+        }
+      }
+    }
+    size_t next = 0;
+    return toDynamicWithLeaves(shares, next);
+  } else {
+    XLOG(ERR, "To extract shares metrics have to be encrypted as a Xor-SS");
+    throw common::exceptions::InvalidAccessError(
+        "To extract shares metrics have to be encrypted as a Xor-SS");
+  }
+}
+
+template <
+    int schedulerId,
+    bool usingBatch,
+    common::InputEncryption inputEncryption>
+folly::dynamic
+AggMetrics<schedulerId, usingBatch, inputEncryption>::toDynamicWithLeaves(
+    const std::vector<folly::dynamic>& leafValues,
+    size_t& next) const {
+  switch (getType()) {
+    case AggMetricType::kDict: {
+      folly::dynamic container = folly::dynamic::object();
+      for (const auto& [key, value] : getAsDict()) {
+        container.insert(key, value->toDynamicWithLeaves(leafValues, next));
+      }
+      return container;
+    }
+    case AggMetricType::kList: {
+      folly::dynamic container = folly::dynamic::array();
+      for (const auto& value : getAsList()) {
+        container.push_back(value->toDynamicWithLeaves(leafValues, next));
+      }
+      return container;
+    }
+    case AggMetricType::kValue: {
+      return leafValues.at(next++);
+    }
+    default:
+      XLOG(ERR) << "Metric values should be maps, lists, or integers here";
+      throw common::exceptions::NotImplementedError(
+          "Metric values should be maps, lists, or integers here.");
+  }
+}
+
 template <
     int schedulerId,
     bool usingBatch,
     common::InputEncryption inputEncryption>
 void AggMetrics<schedulerId, usingBatch, inputEncryption>::updateAllSecVals() {
+  std::vector<AggMetrics<schedulerId, usingBatch, inputEncryption>*> leaves;
+  appendLeaves(leaves);
+  updateLeafSecVals(leaves);
+}
+
+template <
+    int schedulerId,
+    bool usingBatch,
+    common::InputEncryption inputEncryption>
+void AggMetrics<schedulerId, usingBatch, inputEncryption>::updateAllSecVals(
+    const std::vector<std::shared_ptr<
+        AggMetrics<schedulerId, usingBatch, inputEncryption>>>& metrics) {
+  std::vector<AggMetrics<schedulerId, usingBatch, inputEncryption>*> leaves;
+  for (const auto& metric : metrics) {
+    metric->appendLeaves(leaves);
+  }
+  updateLeafSecVals(leaves);
+}
+
+template <
+    int schedulerId,
+    bool usingBatch,
+    common::InputEncryption inputEncryption>
+void AggMetrics<schedulerId, usingBatch, inputEncryption>::updateLeafSecVals(
+    const std::vector<AggMetrics<schedulerId, usingBatch, inputEncryption>*>&
+        leaves) {
+  if constexpr (
+      usingBatch && inputEncryption == common::InputEncryption::Xor) {
+    if (leaves.empty()) {
+      return;
+    }
+    // A single secret batch of every raw int, which is then split into the
+    // values of the leaves without any gates
+    std::vector<int64_t> rawInts;
+    rawInts.reserve(leaves.size());
+    for (const auto leaf : leaves) {
+      rawInts.push_back(leaf->getValue());
+    }
+    typename SecInt<schedulerId, usingBatch>::ExtractedInt extractedInt(
+        rawInts);
+    SecInt<schedulerId, usingBatch> batch(std::move(extractedInt));
+    auto values = batch.unbatching(
+        std::make_shared<std::vector<uint32_t>>(leaves.size(), 1));
+    for (size_t i = 0; i < leaves.size(); ++i) {
+      leaves.at(i)->setSecValueXor(values.at(i));
+    }
+  } else {
+    for (const auto leaf : leaves) {
+      leaf->updateSecValueFromRawInt();
+    }
+  }
+}
+
+template <
+    int schedulerId,
+    bool usingBatch,
+    common::InputEncryption inputEncryption>
+void AggMetrics<schedulerId, usingBatch, inputEncryption>::appendLeaves(
+    std::vector<AggMetrics<schedulerId, usingBatch, inputEncryption>*>&
+        leaves) {
   switch (getType()) {
     case AggMetricType::kDict: {
-      for (auto [k, v] : getAsDict()) {
-        v->updateAllSecVals();
+      for (const auto& [k, v] : getAsDict()) {
+        v->appendLeaves(leaves);
       }
       break;
     }
     case AggMetricType::kList: {
-      for (auto v : getAsList()) {
-        v->updateAllSecVals();
+      for (const auto& v : getAsList()) {
+        v->appendLeaves(leaves);
       }
       break;
     }
     case AggMetricType::kValue: {
-      updateSecValueFromRawInt();
+      leaves.push_back(this);
       break;
     }
-    default: {
-      std::string errStr =
-          folly::sformat("Note match type received: {}", (int)getType());
-      XLOG(ERR) << errStr;
-      throw common::exceptions::SchemaTraceError(errStr);
+  }
+}
+
+template <
+    int schedulerId,
+    bool usingBatch,
+    common::InputEncryption inputEncryption>
+bool AggMetrics<schedulerId, usingBatch, inputEncryption>::hasSameSchema(
+    const AggMetrics<schedulerId, usingBatch, inputEncryption>& rhs) const {
+  if (getType() != rhs.getType()) {
+    return false;
+  }
+  switch (getType()) {
+    case AggMetricType::kDict: {
+      const auto& lhsDict = getAsDict();
+      const auto& rhsDict = rhs.getAsDict();
+      return lhsDict.size() == rhsDict.size() &&
+          std::equal(
+                 lhsDict.begin(),
+                 lhsDict.end(),
+                 rhsDict.begin(),
+                 [](const auto& lhsEntry, const auto& rhsEntry) {
+                   return lhsEntry.first == rhsEntry.first &&
+                       lhsEntry.second->hasSameSchema(*rhsEntry.second);
+                 });
+    }
+    case AggMetricType::kList: {
+      const auto& lhsList = getAsList();
+      const auto& rhsList = rhs.getAsList();
+      return lhsList.size() == rhsList.size() &&
+          std::equal(
+                 lhsList.begin(),
+                 lhsList.end(),
+                 rhsList.begin(),
+                 [](const auto& lhsMetric, const auto& rhsMetric) {
+                   return lhsMetric->hasSameSchema(*rhsMetric);
+                 });
+    }
+    case AggMetricType::kValue: {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <
+    int schedulerId,
+    bool usingBatch,
+    common::InputEncryption inputEncryption>
+uint64_t
+AggMetrics<schedulerId, usingBatch, inputEncryption>::getSchemaFingerprint(
+    std::size_t depth) const {
+  uint64_t fingerprint =
+      folly::hash::twang_mix64(static_cast<uint64_t>(getType()) + 1);
+  if (depth == 0) {
+    return fingerprint;
+  }
+  switch (getType()) {
+    case AggMetricType::kDict: {
+      for (const auto& [k, v] : getAsDict()) {
+        fingerprint =
+            folly::hash::hash_128_to_64(fingerprint, folly::hash::fnv64(k));
+        fingerprint = folly::hash::hash_128_to_64(
+            fingerprint, v->getSchemaFingerprint(depth - 1));
+      }
+      break;
+    }
+    case AggMetricType::kList: {
+      fingerprint =
+          folly::hash::hash_128_to_64(fingerprint, getAsList().size());
+      for (const auto& v : getAsList()) {
+        fingerprint = folly::hash::hash_128_to_64(
+            fingerprint, v->getSchemaFingerprint(depth - 1));
+      }
+      break;
+    }
+    case AggMetricType::kValue: {
       break;
     }
   }
+  return fingerprint;
 }
 
 } // namespace shard_combiner
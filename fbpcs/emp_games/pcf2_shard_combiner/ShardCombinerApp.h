@@ -7,10 +7,16 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <future>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include <folly/Format.h>
 #include <folly/dynamic.h>
 #include <folly/json.h>
 
@@ -22,7 +28,9 @@
 #include <fbpcf/scheduler/NetworkPlaintextSchedulerFactory.h>
 
 #include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/SchedulerPhase.h"
 #include "fbpcs/emp_games/common/SchedulerStatistics.h"
+#include "fbpcs/emp_games/common/ShardReport.h"
 #include "fbpcs/emp_games/pcf2_shard_combiner/AggMetrics.h"
 #include "fbpcs/emp_games/pcf2_shard_combiner/AggMetrics_impl.h"
 #include "fbpcs/emp_games/pcf2_shard_combiner/ShardCombinerGame.h"
@@ -50,7 +58,9 @@ class ShardCombinerApp {
       std::int64_t threshold,
       bool useXorEncryption,
       common::ResultVisibility resultVisibility,
-      std::shared_ptr<fbpcf::util::MetricCollector> metricCollector)
+      std::shared_ptr<fbpcf::util::MetricCollector> metricCollector,
+      std::chrono::seconds inputWaitTimeout = std::chrono::seconds{0},
+      bool partialSum = false)
       : shardStartIndex_(shardStartIndex),
         numShards_(numShards),
         threshold_(threshold),
@@ -61,7 +71,9 @@ class ShardCombinerApp {
         communicationAgentFactory_(std::move(communicationAgentFactory)),
         useXorEncryption_(useXorEncryption),
         schedulerStatistics_{0, 0, 0, 0, 0},
-        metricCollector_(metricCollector) {
+        metricCollector_(metricCollector),
+        inputWaitTimeout_(inputWaitTimeout),
+        partialSum_(partialSum) {
     XLOG(INFO) << "Instantiated: " << schedulerId;
   }
 
@@ -77,49 +89,123 @@ class ShardCombinerApp {
     XLOG(INFO) << "Made scheduler: " << schedulerId;
 
     ShardCombinerGame<shardSchemaType, schedulerId, usingBatch, inputEncryption>
-        game(std::move(scheduler), std::move(communicationAgentFactory_));
+        game(
+            std::move(scheduler),
+            std::move(communicationAgentFactory_),
+            std::max<int>(std::thread::hardware_concurrency(), 1),
+            partialSum_);
 
     XLOG(INFO) << "Constructed game obj for: " << schedulerId;
 
-    // read shards in the game and populate secret vals
-    auto inputs = game.readShards(inputPath_, inputFilePrefix_, numShards_);
+    // The phases of the combination, as shard 0, for the report of the run
+    common::ShardReporter reporter;
 
-    XLOG(INFO) << "Read input files: " << inputPath_ << "/" << inputFilePrefix_;
+    AggMetrics_sp<schedulerId, usingBatch, inputEncryption> resSecret;
+    if (inputWaitTimeout_.count() > 0) {
+      // The shards are read while they are combined, so both are one phase
+      XLOG(INFO) << "Streaming the Game: " << schedulerId;
+      fbpcs::performance_tools::ScopedPhase combinePhase{
+          "shard_combination",
+          common::getSchedulerCounterReader<schedulerId>()};
+      common::ShardReporter::Phase combineShardPhase{
+          reporter,
+          0,
+          "shard_combination",
+          common::getSchedulerCounterReader<schedulerId>()};
+      resSecret = game.playStreaming(
+          inputPath_,
+          inputFilePrefix_,
+          shardStartIndex_,
+          numShards_,
+          inputWaitTimeout_);
+      combineShardPhase.end();
+      combinePhase.end();
+    } else {
+      // read shards in the game and populate secret vals
+      fbpcs::performance_tools::ScopedPhase inputPhase{
+          "input_parsing", common::getSchedulerCounterReader<schedulerId>()};
+      common::ShardReporter::Phase inputShardPhase{
+          reporter,
+          0,
+          "input_parsing",
+          common::getSchedulerCounterReader<schedulerId>()};
+      auto inputs = game.readShards(
+          inputPath_, inputFilePrefix_, numShards_, shardStartIndex_);
+      inputShardPhase.end();
+      inputPhase.end();
+
+      XLOG(INFO) << "Read input files: " << inputPath_ << "/"
+                 << inputFilePrefix_;
 
-    XLOG(INFO) << "Starting the Game: " << schedulerId;
-    auto resSecret = game.play(inputs);
+      XLOG(INFO) << "Starting the Game: " << schedulerId;
+      fbpcs::performance_tools::ScopedPhase combinePhase{
+          "shard_combination",
+          common::getSchedulerCounterReader<schedulerId>()};
+      common::ShardReporter::Phase combineShardPhase{
+          reporter,
+          0,
+          "shard_combination",
+          common::getSchedulerCounterReader<schedulerId>()};
+      resSecret = game.play(inputs);
+      combineShardPhase.end();
+      combinePhase.end();
+    }
     XLOG(INFO) << "Playing: " << inputPath_ << "/" << inputFilePrefix_;
 
+    fbpcs::performance_tools::ScopedPhase revealPhase{
+        "reveal", common::getSchedulerCounterReader<schedulerId>()};
+    common::ShardReporter::Phase revealShardPhase{
+        reporter,
+        0,
+        "reveal",
+        common::getSchedulerCounterReader<schedulerId>()};
     std::unordered_map<int32_t, folly::dynamic> ret;
 
-    // Insert revealed results only if the party has access for the result
-    // to be revealed. Otherwise, insert dummy result.
-    if (resultVisibility_ == common::ResultVisibility::kPublisher ||
-        resultVisibility_ == common::ResultVisibility::kPublic) {
-      ret.insert(std::make_pair(
-          common::PUBLISHER, resSecret->toRevealedDynamic(common::PUBLISHER)));
+    // A partial sum isn't revealed, each party writes its share of it for the
+    // job that combines the partial sums. Otherwise, reveal the results to
+    // the parties with access to them in a single batched open. The other
+    // parties get a dummy result.
+    if (partialSum_) {
+      ret.insert(
+          std::make_pair(schedulerId, resSecret->toSecretShareDynamic()));
     } else {
-      auto dummyResult =
-          AggMetrics<schedulerId, usingBatch, inputEncryption>::newLike(
-              resSecret);
-      ret.insert(std::make_pair(common::PUBLISHER, dummyResult->toDynamic()));
+      std::vector<int> revealedParties;
+      for (auto party : {common::PUBLISHER, common::PARTNER}) {
+        if (resultVisibility_ == common::ResultVisibility::kPublic ||
+            resultVisibility_ ==
+                (party == common::PUBLISHER
+                     ? common::ResultVisibility::kPublisher
+                     : common::ResultVisibility::kPartner)) {
+          revealedParties.push_back(party);
+        } else {
+          ret.insert(std::make_pair(
+              party,
+              AggMetrics<schedulerId, usingBatch, inputEncryption>::newLike(
+                  resSecret)
+                  ->toDynamic()));
+        }
+      }
+      auto revealed = resSecret->toRevealedDynamics(revealedParties);
+      for (size_t i = 0; i < revealedParties.size(); ++i) {
+        ret.insert(
+            std::make_pair(revealedParties.at(i), std::move(revealed.at(i))));
+      }
     }
 
-    // Insert revealed results only if the party has access for the result
-    // to be revealed. Otherwise, insert dummy result.
-    if (resultVisibility_ == common::ResultVisibility::kPartner ||
-        resultVisibility_ == common::ResultVisibility::kPublic) {
-      ret.insert(std::make_pair(
-          common::PARTNER, resSecret->toRevealedDynamic(common::PARTNER)));
-    } else {
-      auto dummyResult =
-          AggMetrics<schedulerId, usingBatch, inputEncryption>::newLike(
-              resSecret);
-      ret.insert(std::make_pair(common::PARTNER, dummyResult->toDynamic()));
-    }
+    revealShardPhase.end();
+    revealPhase.end();
 
-    // Write only owner Party's output
-    putOutputData(ret.at(schedulerId));
+    // Write only owner Party's output, while the statistics of the scheduler
+    // are collected
+    auto outputWriting = std::async(std::launch::async, [&]() {
+      fbpcs::performance_tools::ScopedPhase outputPhase{"output_writing"};
+      common::ShardReporter::Phase outputShardPhase{
+          reporter, 0, "output_writing"};
+      putOutputData(ret.at(schedulerId));
+      outputShardPhase.end();
+      outputPhase.end();
+      putRunReport(reporter);
+    });
 
     auto gateStatistics =
         fbpcf::scheduler::SchedulerKeeper<schedulerId>::getGateStatistics();
@@ -143,6 +229,7 @@ class ShardCombinerApp {
     schedulerStatistics_.receivedNetwork = trafficStatistics.second;
     fbpcf::scheduler::SchedulerKeeper<schedulerId>::deleteEngine();
     schedulerStatistics_.details = metricCollector_->collectMetrics();
+    outputWriting.get();
   }
 
   common::SchedulerStatistics getSchedulerStatistics() {
@@ -161,6 +248,31 @@ class ShardCombinerApp {
         outputPath_, folly::toJson(outputData));
   }
 
+  // Gathers the reports the games wrote next to the shards into a report of
+  // the run, with the phases of the combination, next to the output
+  void putRunReport(common::ShardReporter& reporter) {
+    auto combinerReport = reporter.getReport(0);
+    if (!combinerReport.has_value()) {
+      return;
+    }
+    combinerReport->numRows = numShards_;
+    combinerReport->outputBytes = common::getLocalFileBytes({outputPath_});
+    std::vector<std::string> shardPaths;
+    for (int32_t i = shardStartIndex_; i < shardStartIndex_ + numShards_; ++i) {
+      shardPaths.push_back(
+          folly::sformat("{}/{}_{}", inputPath_, inputFilePrefix_, i));
+    }
+    try {
+      common::writeRunReport(
+          shardPaths,
+          outputPath_,
+          folly::dynamic::object(
+              "shard_combiner", combinerReport->toDynamic()));
+    } catch (const std::exception& e) {
+      XLOGF(WARN, "Failed to write the report of the run: {}", e.what());
+    }
+  }
+
  private:
   int32_t shardStartIndex_;
   int32_t numShards_;
@@ -175,5 +287,11 @@ class ShardCombinerApp {
   bool useXorEncryption_;
   common::SchedulerStatistics schedulerStatistics_;
   std::shared_ptr<fbpcf::util::MetricCollector> metricCollector_;
+  // If positive, the shards are combined as they arrive, each waited for up
+  // to this long
+  std::chrono::seconds inputWaitTimeout_;
+  // If set, the shards are only summed, and this party's share of the sum is
+  // written instead of the revealed, thresholded result
+  bool partialSum_;
 };
 } // namespace shard_combiner
@@ -8,8 +8,13 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <cstdlib>
+#include <future>
 #include <memory>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 #include <folly/Format.h>
@@ -21,11 +26,13 @@
 #include <fbpcf/frontend/mpcGame.h>
 
 #include "fbpcs/emp_games/common/Constants.h"
+#include "fbpcs/emp_games/common/InputArrival.h"
 #include "fbpcs/emp_games/pcf2_shard_combiner/AggMetrics.h"
 #include "fbpcs/emp_games/pcf2_shard_combiner/ShardValidator.h"
 #include "fbpcs/emp_games/pcf2_shard_combiner/ShardValidator_impl.h"
 #include "fbpcs/emp_games/pcf2_shard_combiner/util/AggMetricsThresholdCheckers.h"
 #include "fbpcs/emp_games/pcf2_shard_combiner/util/AggMetricsThresholdCheckers_impl.h"
+#include "fbpcs/performance_tools/Tracepoints.h"
 
 namespace shard_combiner {
 
@@ -44,10 +51,12 @@ class ShardCombinerGame : public fbpcf::frontend::MpcGame<schedulerId> {
       std::shared_ptr<
           fbpcf::engine::communication::IPartyCommunicationAgentFactory>
           communicationAgentFactory,
-      const int concurrency = 1)
+      const int concurrency = 1,
+      bool partialSum = false)
       : fbpcf::frontend::MpcGame<schedulerId>(std::move(scheduler)),
         communicationAgentFactory_(std::move(communicationAgentFactory)),
-        concurrency_(concurrency) {
+        concurrency_(concurrency),
+        partialSum_(partialSum) {
     thresholdFn_ =
         checkThresholdAndUpdateMetric<schedulerId, usingBatch, inputEncryption>(
             shardSchemaType, kAnonymityThreshold, kHiddenMetricConstant);
@@ -61,7 +70,66 @@ class ShardCombinerGame : public fbpcf::frontend::MpcGame<schedulerId> {
 
     auto result = inputData.at(0); // reduced output is in the zeroth element.
 
-    thresholdFn_(result);
+    if (!partialSum_) {
+      thresholdFn_(result);
+    }
+
+    return result;
+  }
+
+  // Combines the shards while they are still being written upstream, instead
+  // of after all of them are. The shards are waited for, up to timeout each,
+  // and added to the running sum one at a time in index order, which both
+  // parties follow so that they add the same gates in the same order. The
+  // next shard is waited for, parsed and validated while the last one is
+  // added. The threshold is applied once all numShards shards from
+  // firstShard are in, unless the result is a partial sum.
+  AggMetrics_sp playStreaming(
+      const std::string& inputDir,
+      const std::string& filename,
+      int32_t firstShard,
+      int32_t numShards,
+      std::chrono::seconds timeout,
+      std::chrono::milliseconds pollInterval = common::kInputPollInterval) {
+    if (numShards <= 0) {
+      throw std::invalid_argument("There are no shards to combine");
+    }
+    auto readShard = [this, &inputDir, &filename, timeout, pollInterval](
+                         int32_t i) {
+      return std::async(std::launch::async, [=, &inputDir, &filename]() {
+        std::string fullPath =
+            folly::sformat("{}/{}_{}", inputDir, filename, i);
+        common::waitForInputs({fullPath}, timeout, pollInterval);
+        auto shard =
+            AggMetrics<schedulerId, usingBatch, inputEncryption>::fromJson(
+                fullPath);
+        XLOG(INFO) << "parsed: " << fullPath;
+        validator_.validate(*shard);
+        XLOG(INFO) << "validated: " << fullPath;
+        return shard;
+      });
+    };
+
+    AggMetrics_sp result;
+    auto nextShard = readShard(firstShard);
+    for (int32_t i = firstShard; i < firstShard + numShards; i++) {
+      auto shard = nextShard.get();
+      if (i + 1 < firstShard + numShards) {
+        nextShard = readShard(i + 1);
+      }
+      shard->updateAllSecVals();
+      if (result == nullptr) {
+        result = shard;
+      } else {
+        AggMetrics<schedulerId, usingBatch, inputEncryption>::accumulate(
+            result, shard);
+      }
+      XLOG(INFO) << "accumulated: " << i;
+    }
+
+    if (!partialSum_) {
+      thresholdFn_(result);
+    }
 
     return result;
   }
@@ -82,8 +150,22 @@ class ShardCombinerGame : public fbpcf::frontend::MpcGame<schedulerId> {
    *
    * Since, MPC's lazy scheduler internally parallelizes the ops that don't have
    * dependencies, we don't have need to launch a thread pool to realize this.
+   *
+   * With batched secret values, shards that all have the same schema are
+   * summed by batchedReducer instead.
    */
   void reducer(std::vector<AggMetrics_sp>& input) {
+    if constexpr (
+        usingBatch && inputEncryption == common::InputEncryption::Xor) {
+      if (input.size() > 1 &&
+          std::all_of(
+              input.begin() + 1, input.end(), [&input](const auto& shard) {
+                return input.at(0)->hasSameSchema(*shard);
+              })) {
+        batchedReducer(input);
+        return;
+      }
+    }
     for (int step = 1;
          step < (input.size() % 2 == 0 ? input.size() : input.size() + 1);
          step <<= 1) {
@@ -98,23 +180,106 @@ class ShardCombinerGame : public fbpcf::frontend::MpcGame<schedulerId> {
     }
   }
 
-  // TODO: parallelize these reads, and  attach validation. That way things
-  // are faster.
-  std::vector<AggMetrics_sp>
-  readShards(std::string inputDir, std::string filename, int32_t numShards) {
+  /*
+   * Lays the values of all the shards out in one batch, shard after shard in
+   * the leaf order of their common schema, and sums them in a tree of wide
+   * adds: each level adds the first half of the remaining shards to the
+   * second half in a single batched add, carrying an odd last shard over to
+   * the next level.
+   *  [s0 s1 s2 s3 s4] => [s0+s2 s1+s3 s4] => [s0+s2+s4 s1+s3] => [sum]
+   * The sums are written to the leaves of the first shard.
+   */
+  void batchedReducer(std::vector<AggMetrics_sp>& input) {
+    using SecInt_t = SecInt<schedulerId, usingBatch>;
+    std::vector<AggMetrics<schedulerId, usingBatch, inputEncryption>*>
+        resultLeaves;
+    input.at(0)->appendLeaves(resultLeaves);
+    const uint32_t numLeaves = resultLeaves.size();
+    if (numLeaves == 0) {
+      return;
+    }
+
+    std::vector<SecInt_t> values;
+    values.reserve(input.size() * numLeaves);
+    for (const auto& shard : input) {
+      std::vector<AggMetrics<schedulerId, usingBatch, inputEncryption>*>
+          leaves;
+      shard->appendLeaves(leaves);
+      for (const auto leaf : leaves) {
+        values.push_back(leaf->getSecValueXor());
+      }
+    }
+    auto batch = values.at(0).batchingWith(
+        std::vector<SecInt_t>(values.begin() + 1, values.end()));
+    values.clear();
+
+    for (size_t numShards = input.size(); numShards > 1;
+         numShards = (numShards + 1) / 2) {
+      const uint32_t halfSize = numShards / 2 * numLeaves;
+      auto unbatchingStrategy =
+          std::make_shared<std::vector<uint32_t>>(2, halfSize);
+      if (numShards % 2 == 1) {
+        unbatchingStrategy->push_back(numLeaves);
+      }
+      auto halves = batch.unbatching(unbatchingStrategy);
+      batch = halves.at(0) + halves.at(1);
+      if (halves.size() == 3) {
+        batch = batch.batchingWith({halves.at(2)});
+      }
+    }
+
+    auto sums =
+        batch.unbatching(std::make_shared<std::vector<uint32_t>>(numLeaves, 1));
+    for (uint32_t i = 0; i < numLeaves; i++) {
+      resultLeaves.at(i)->setSecValueXor(sums.at(i));
+    }
+  }
+
+  // Reads, parses and validates up to concurrency shards at a time on their
+  // own threads, which bounds how many shards are parsed at once. Shards with
+  // the schema of a shard validated before are only compared by fingerprint.
+  // The secret values of all the shards are then updated together on this
+  // thread in shard order, since that adds input gates to the scheduler,
+  // which both parties have to do in the same order. The shards read are
+  // firstShard to firstShard + numShards - 1.
+  std::vector<AggMetrics_sp> readShards(
+      std::string inputDir,
+      std::string filename,
+      int32_t numShards,
+      int32_t firstShard = 0) {
     shards_.clear();
-    for (int i = 0; i < numShards; i++) {
-      std::string fullPath = folly::sformat("{}/{}_{}", inputDir, filename, i);
-      auto shard =
-          AggMetrics<schedulerId, usingBatch, inputEncryption>::fromJson(
-              fullPath);
-      XLOG(INFO) << "parsed: " << fullPath;
-      validateShardSchema<shardSchemaType>(*shard);
-      XLOG(INFO) << "validated: " << fullPath;
-      shard->updateAllSecVals();
-      XLOG(INFO) << "updatedSecVals: " << fullPath;
-      shards_.push_back(shard);
+    shards_.reserve(std::max(numShards, 0));
+    const int32_t batchSize = std::max(concurrency_, 1);
+    const int32_t lastShard = firstShard + numShards;
+    for (int32_t begin = firstShard; begin < lastShard; begin += batchSize) {
+      int32_t end = std::min(begin + batchSize, lastShard);
+      fbpcs::performance_tools::ScopedBatch batch{
+          "shard_parsing",
+          static_cast<std::size_t>(begin),
+          static_cast<std::size_t>(end - begin)};
+      std::vector<std::future<AggMetrics_sp>> parsedShards;
+      parsedShards.reserve(end - begin);
+      for (int32_t i = begin; i < end; i++) {
+        parsedShards.push_back(
+            std::async(std::launch::async, [this, &inputDir, &filename, i]() {
+              std::string fullPath =
+                  folly::sformat("{}/{}_{}", inputDir, filename, i);
+              auto shard =
+                  AggMetrics<schedulerId, usingBatch, inputEncryption>::
+                      fromJson(fullPath);
+              XLOG(INFO) << "parsed: " << fullPath;
+              validator_.validate(*shard);
+              XLOG(INFO) << "validated: " << fullPath;
+              return shard;
+            }));
+      }
+      for (int32_t i = begin; i < end; i++) {
+        shards_.push_back(parsedShards.at(i - begin).get());
+      }
     }
+    AggMetrics<schedulerId, usingBatch, inputEncryption>::updateAllSecVals(
+        shards_);
+    XLOG(INFO) << "updatedSecVals of " << shards_.size() << " shards";
     return shards_;
   }
 
@@ -123,7 +288,11 @@ class ShardCombinerGame : public fbpcf::frontend::MpcGame<schedulerId> {
   std::shared_ptr<fbpcf::engine::communication::IPartyCommunicationAgentFactory>
       communicationAgentFactory_;
   int concurrency_;
+  // Whether the result is a partial sum of a range of the shards, which is
+  // combined further by another job and so isn't thresholded
+  bool partialSum_;
   std::vector<AggMetrics_sp> shards_;
+  CachedShardValidator<shardSchemaType> validator_;
 
   std::function<void(AggMetrics_sp)> thresholdFn_;
 };
@@ -5,12 +5,15 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <chrono>
+#include <filesystem>
 #include <future>
 #include <unordered_map>
 
 #include <gtest/gtest.h>
 
 #include <folly/Format.h>
+#include <folly/Random.h>
 #include <folly/dynamic.h>
 #include <folly/json.h>
 
@@ -27,6 +30,10 @@
 
 namespace shard_combiner {
 
+// Shards are read in batches of this many, so that the tests on 3 shards
+// cover a full and a partial batch
+constexpr int kReadConcurrency = 2;
+
 template <
     ShardSchemaType shardSchemaType,
     int32_t schedulerId,
@@ -40,14 +47,16 @@ std::shared_ptr<ShardCombinerGame<
 getGameInstance(
     std::shared_ptr<
         fbpcf::engine::communication::IPartyCommunicationAgentFactory> factory,
-    fbpcf::SchedulerCreator schedulerCreator) {
+    fbpcf::SchedulerCreator schedulerCreator,
+    bool partialSum = false) {
   auto scheduler = schedulerCreator(schedulerId, *factory);
 
   return std::make_shared<ShardCombinerGame<
       shardSchemaType,
       schedulerId,
       usingBatch,
-      inputEncryption>>(std::move(scheduler), std::move(factory), 1);
+      inputEncryption>>(
+      std::move(scheduler), std::move(factory), kReadConcurrency, partialSum);
 }
 
 // returns a map of revealed folly::dynamic objects indexed by schedulerId.
@@ -64,14 +73,26 @@ std::unordered_map<int32_t, folly::dynamic> runGameTest(
     int32_t numShards,
     std::shared_ptr<
         fbpcf::engine::communication::IPartyCommunicationAgentFactory> factory,
-    fbpcf::SchedulerCreator schedulerCreator) {
+    fbpcf::SchedulerCreator schedulerCreator,
+    bool streaming) {
   auto game = getGameInstance<
       shardSchemaType,
       schedulerId,
       usingBatch,
       inputEncryption>(factory, schedulerCreator);
-  auto new_metrics = game->readShards(inputDir, filename, numShards);
-  auto res = game->play(new_metrics);
+  std::shared_ptr<AggMetrics<schedulerId, usingBatch, inputEncryption>> res;
+  if (streaming) {
+    res = game->playStreaming(
+        inputDir,
+        filename,
+        0,
+        numShards,
+        std::chrono::seconds{1},
+        std::chrono::milliseconds{10});
+  } else {
+    auto new_metrics = game->readShards(inputDir, filename, numShards);
+    res = game->play(new_metrics);
+  }
 
   std::unordered_map<int32_t, folly::dynamic> ret;
   ret.insert(std::make_pair(
@@ -79,6 +100,11 @@ std::unordered_map<int32_t, folly::dynamic> runGameTest(
   ret.insert(
       std::make_pair(common::PARTNER, res->toRevealedDynamic(common::PARTNER)));
 
+  // Revealing to both parties in one batch reveals the same result
+  auto revealed =
+      res->toRevealedDynamics({common::PUBLISHER, common::PARTNER});
+  EXPECT_EQ(ret.at(schedulerId), revealed.at(schedulerId));
+
   return ret;
 }
 
@@ -91,7 +117,8 @@ void runTestWithParams(
     std::string partnerFileName,
     std::string publisherFileName,
     int32_t numShards,
-    std::string expectedOutFileName) {
+    std::string expectedOutFileName,
+    bool streaming = false) {
   constexpr common::InputEncryption inputEncryption =
       common::InputEncryption::Xor;
 
@@ -111,7 +138,8 @@ void runTestWithParams(
       partnerFileName,
       numShards,
       std::move(factories[common::PARTNER]),
-      schedulerCreator);
+      schedulerCreator,
+      streaming);
 
   auto gamePublisher = std::async(
       std::launch::async,
@@ -124,7 +152,8 @@ void runTestWithParams(
       publisherFileName,
       numShards,
       std::move(factories[common::PUBLISHER]),
-      schedulerCreator);
+      schedulerCreator,
+      streaming);
 
   auto f1 = gamePartner.get();
   auto f2 = gamePublisher.get();
@@ -136,6 +165,119 @@ void runTestWithParams(
   EXPECT_EQ(f2.at(common::PUBLISHER), expectedObj);
 }
 
+// Sums shards firstShard to firstShard + numShards - 1 and writes this
+// party's share of the sum to outputPath
+template <int32_t schedulerId, bool usingBatch>
+void runPartialSumGame(
+    std::string inputDir,
+    std::string filename,
+    int32_t firstShard,
+    int32_t numShards,
+    std::string outputPath,
+    std::shared_ptr<
+        fbpcf::engine::communication::IPartyCommunicationAgentFactory> factory,
+    fbpcf::SchedulerCreator schedulerCreator) {
+  auto game = getGameInstance<
+      ShardSchemaType::kTest,
+      schedulerId,
+      usingBatch,
+      common::InputEncryption::Xor>(factory, schedulerCreator, true);
+  auto new_metrics =
+      game->readShards(inputDir, filename, numShards, firstShard);
+  auto res = game->play(new_metrics);
+  fbpcf::io::FileIOWrappers::writeFile(
+      outputPath, folly::toJson(res->toSecretShareDynamic()));
+}
+
+// Combines the shards of combiner_logic_test in two levels: a partial sum of
+// shards 0 and 1 and one of shard 2, whose shares are then the 2 shards of
+// the final combination
+template <bool usingBatch>
+void runHierarchicalTest(
+    common::SchedulerType schedulerType,
+    std::string baseDir,
+    std::string partnerFileName,
+    std::string publisherFileName,
+    std::string expectedOutFileName) {
+  std::string tempDir = std::filesystem::temp_directory_path();
+  std::string partialPartnerFileName =
+      folly::sformat("partial_partner_{}.json", folly::Random::secureRand64());
+  std::string partialPublisherFileName = folly::sformat(
+      "partial_publisher_{}.json", folly::Random::secureRand64());
+
+  fbpcf::SchedulerCreator schedulerCreator =
+      fbpcf::getSchedulerCreator<true>(schedulerType);
+  const std::vector<std::pair<int32_t, int32_t>> ranges{{0, 2}, {2, 1}};
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    auto [firstShard, numShards] = ranges.at(i);
+    auto factories = fbpcf::engine::communication::getInMemoryAgentFactory(2);
+    auto gamePartner = std::async(
+        std::launch::async,
+        runPartialSumGame<common::PARTNER, usingBatch>,
+        baseDir,
+        partnerFileName,
+        firstShard,
+        numShards,
+        folly::sformat("{}/{}_{}", tempDir, partialPartnerFileName, i),
+        std::move(factories[common::PARTNER]),
+        schedulerCreator);
+    auto gamePublisher = std::async(
+        std::launch::async,
+        runPartialSumGame<common::PUBLISHER, usingBatch>,
+        baseDir,
+        publisherFileName,
+        firstShard,
+        numShards,
+        folly::sformat("{}/{}_{}", tempDir, partialPublisherFileName, i),
+        std::move(factories[common::PUBLISHER]),
+        schedulerCreator);
+    gamePartner.get();
+    gamePublisher.get();
+  }
+
+  auto factories = fbpcf::engine::communication::getInMemoryAgentFactory(2);
+  auto gamePartner = std::async(
+      std::launch::async,
+      runGameTest<
+          ShardSchemaType::kTest,
+          common::PARTNER,
+          usingBatch,
+          common::InputEncryption::Xor>,
+      tempDir,
+      partialPartnerFileName,
+      ranges.size(),
+      std::move(factories[common::PARTNER]),
+      schedulerCreator,
+      false /* streaming */);
+  auto gamePublisher = std::async(
+      std::launch::async,
+      runGameTest<
+          ShardSchemaType::kTest,
+          common::PUBLISHER,
+          usingBatch,
+          common::InputEncryption::Xor>,
+      tempDir,
+      partialPublisherFileName,
+      ranges.size(),
+      std::move(factories[common::PUBLISHER]),
+      schedulerCreator,
+      false /* streaming */);
+  auto f1 = gamePartner.get();
+  auto f2 = gamePublisher.get();
+
+  auto expectedObj = folly::parseJson(
+      fbpcf::io::FileIOWrappers::readFile(baseDir + expectedOutFileName));
+  EXPECT_EQ(f1.at(common::PARTNER), expectedObj);
+  EXPECT_EQ(f2.at(common::PUBLISHER), expectedObj);
+
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    std::filesystem::remove(
+        folly::sformat("{}/{}_{}", tempDir, partialPartnerFileName, i));
+    std::filesystem::remove(
+        folly::sformat("{}/{}_{}", tempDir, partialPublisherFileName, i));
+  }
+}
+
 template <
     ShardSchemaType shardSchemaType,
     int32_t schedulerId,
@@ -282,6 +424,55 @@ TEST_P(ShardCombinerGameTestFixture, TestAggLogic) {
   testFn(3, usingBatch, schedulerType);
 }
 
+// Combining the shards as they arrive sums them to the same result
+TEST_P(ShardCombinerGameTestFixture, TestAggLogicStreaming) {
+  auto [schedulerType, usingBatch] = GetParam();
+  for (int32_t numShards : {2, 3}) {
+    std::string expectedOutFileName =
+        folly::sformat("expected_out_shards_{}.json", numShards);
+    if (usingBatch) {
+      runTestWithParams<true>(
+          schedulerType,
+          baseDir_ + "combiner_logic_test/",
+          "input_partner.json",
+          "input_publisher.json",
+          numShards,
+          expectedOutFileName,
+          true /* streaming */);
+    } else {
+      runTestWithParams<false>(
+          schedulerType,
+          baseDir_ + "combiner_logic_test/",
+          "input_partner.json",
+          "input_publisher.json",
+          numShards,
+          expectedOutFileName,
+          true /* streaming */);
+    }
+  }
+}
+
+// Summing ranges of the shards into secret partial sums and combining those
+// gives the same result as combining all the shards at once
+TEST_P(ShardCombinerGameTestFixture, TestAggLogicHierarchical) {
+  auto [schedulerType, usingBatch] = GetParam();
+  if (usingBatch) {
+    runHierarchicalTest<true>(
+        schedulerType,
+        baseDir_ + "combiner_logic_test/",
+        "input_partner.json",
+        "input_publisher.json",
+        "expected_out_shards_3.json");
+  } else {
+    runHierarchicalTest<false>(
+        schedulerType,
+        baseDir_ + "combiner_logic_test/",
+        "input_partner.json",
+        "input_publisher.json",
+        "expected_out_shards_3.json");
+  }
+}
+
 // This test checks if 2 shards that have different attribution
 // measurement keys can be combined correctly.
 TEST_P(ShardCombinerGameTestFixture, TestAggAdObj) {
@@ -7,6 +7,11 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_set>
+
 #include <fbpcs/emp_games/common/Constants.h>
 #include <fbpcs/emp_games/pcf2_shard_combiner/AggMetrics.h>
 
@@ -22,4 +27,44 @@ template <
 void validateShardSchema(
     const AggMetrics<schedulerId, usingBatch, inputEncryption>& metrics);
 
+// The number of levels below the top of a shard which validateShardSchema
+// inspects the dict keys or list sizes of. Deeper levels are not validated.
+template <ShardSchemaType shardSchemaType>
+constexpr std::size_t getValidatedSchemaDepth() {
+  if constexpr (shardSchemaType == ShardSchemaType::kAdObjFormat) {
+    // The rules, the aggregations of each rule, and the type of each
+    // aggregation
+    return 2;
+  } else if constexpr (
+      shardSchemaType == ShardSchemaType::kGroupedLiftMetrics) {
+    // The keys at the top
+    return 1;
+  } else {
+    return 0;
+  }
+}
+
+// Validates the shards of a run, which all come from the same producer and so
+// should share their schema. Each shard is compared to the shards validated
+// before it by the fingerprint of the levels validateShardSchema inspects, and
+// only a shard with a new fingerprint is walked by validateShardSchema. Shards
+// may be validated from several threads at once.
+template <ShardSchemaType shardSchemaType>
+class CachedShardValidator {
+ public:
+  template <
+      int schedulerId,
+      bool usingBatch,
+      common::InputEncryption inputEncryption>
+  void validate(
+      const AggMetrics<schedulerId, usingBatch, inputEncryption>& metrics);
+
+  // The number of distinct schemas which were fully validated
+  std::size_t getNumValidatedSchemas() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::unordered_set<uint64_t> validatedFingerprints_;
+};
+
 } // namespace shard_combiner
@@ -120,4 +120,43 @@ TEST_F(ShardValidatorTest, LiftTestValidInputEmptyCohortMetrics) {
   validateShardSchema<ShardSchemaType::kGroupedLiftMetrics>(*testMetricsObj);
 }
 
+// Shards of a schema which was validated before are only compared by the
+// fingerprint of the levels the validator inspects, while invalid shards are
+// never cached
+TEST_F(ShardValidatorTest, CachedValidatorValidatesEachSchemaOnce) {
+  CachedShardValidator<ShardSchemaType::kGroupedLiftMetrics> validator;
+  auto validShard =
+      AggMetrics<schedulerId, usingBatch, inputEncryption>::fromJson(
+          baseDir_ + "valid_lift_input.json");
+  auto otherValidShard =
+      AggMetrics<schedulerId, usingBatch, inputEncryption>::fromJson(
+          baseDir_ + "valid_lift_no_cohort_metrics.json");
+  auto extendedShard =
+      AggMetrics<schedulerId, usingBatch, inputEncryption>::fromJson(
+          baseDir_ + "valid_lift_input.json");
+  extendedShard->insert(std::make_pair(
+      "extra",
+      std::make_shared<AggMetrics<schedulerId, usingBatch, inputEncryption>>(
+          AggMetricType::kDict)));
+  auto invalidShard =
+      AggMetrics<schedulerId, usingBatch, inputEncryption>::fromJson(
+          baseDir_ + "valid_measurement_shard.json");
+
+  validator.validate(*validShard);
+  validator.validate(*validShard);
+  EXPECT_EQ(validator.getNumValidatedSchemas(), 1);
+  // Differs only below the keys at the top
+  validator.validate(*otherValidShard);
+  EXPECT_EQ(validator.getNumValidatedSchemas(), 1);
+  validator.validate(*extendedShard);
+  EXPECT_EQ(validator.getNumValidatedSchemas(), 2);
+
+  for (auto i = 0; i < 2; ++i) {
+    EXPECT_THROW(
+        validator.validate(*invalidShard),
+        common::exceptions::SchemaTraceError);
+  }
+  EXPECT_EQ(validator.getNumValidatedSchemas(), 2);
+}
+
 } // namespace shard_combiner
@@ -48,6 +48,35 @@ void validateShardSchema(
   }
 }
 
+template <ShardSchemaType shardSchemaType>
+template <
+    int schedulerId,
+    bool usingBatch,
+    common::InputEncryption inputEncryption>
+void CachedShardValidator<shardSchemaType>::validate(
+    const AggMetrics<schedulerId, usingBatch, inputEncryption>& metrics) {
+  auto fingerprint = metrics.getSchemaFingerprint(
+      getValidatedSchemaDepth<shardSchemaType>());
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (validatedFingerprints_.count(fingerprint) > 0) {
+      return;
+    }
+  }
+  // A schema which hasn't been seen yet is walked in full, which throws with
+  // what is wrong with it if it is invalid
+  validateShardSchema<shardSchemaType>(metrics);
+  std::lock_guard<std::mutex> lock{mutex_};
+  validatedFingerprints_.insert(fingerprint);
+}
+
+template <ShardSchemaType shardSchemaType>
+std::size_t CachedShardValidator<shardSchemaType>::getNumValidatedSchemas()
+    const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return validatedFingerprints_.size();
+}
+
 template <
     int schedulerId,
     bool usingBatch,
@@ -7,6 +7,7 @@
 
 #include <signal.h>
 
+#include <chrono>
 #include <filesystem>
 #include <stdexcept>
 
@@ -87,6 +88,19 @@ DEFINE_string(
     run_id,
     "",
     "A run_id used to identify all the logs in a PL/PA run.");
+DEFINE_int32(
+    input_wait_timeout_s,
+    0,
+    "If positive, start before the shards are written and combine each shard "
+    "as soon as it arrives, in shard order, waiting up to this many seconds "
+    "for each. Both parties have to set this the same way");
+DEFINE_bool(
+    partial_sum,
+    false,
+    "Only sum shards first_shard_index to first_shard_index + num_shards - 1 "
+    "and write this party's secret share of the sum, without thresholding or "
+    "revealing it. The outputs of such jobs over ranges of the shards are "
+    "shards of a final job, which combines them into the result");
 DEFINE_string(
     pc_feature_flags,
     "",
@@ -115,6 +129,8 @@ int main(int argc, char* argv[]) {
   XLOGF(INFO, "Number of shards: {}", FLAGS_num_shards);
   XLOGF(INFO, "Output path: {}", FLAGS_output_path);
   XLOGF(INFO, "K-anonymity threshold: {}", FLAGS_threshold);
+  XLOGF(INFO, "Input wait timeout: {}s", FLAGS_input_wait_timeout_s);
+  XLOGF(INFO, "Partial sum: {}", FLAGS_partial_sum);
   XLOGF(INFO, "Run Id: {}", FLAGS_run_id);
   XLOGF(INFO, "PC Feature Flags: {}", FLAGS_pc_feature_flags);
 
@@ -154,7 +170,9 @@ int main(int argc, char* argv[]) {
         FLAGS_visibility,
         FLAGS_server_ip,
         FLAGS_port,
-        tlsInfo);
+        tlsInfo,
+        std::chrono::seconds(FLAGS_input_wait_timeout_s),
+        FLAGS_partial_sum);
   } else if (FLAGS_metrics_format_type == "lift") {
     schedulerStatistics = runApp<ShardSchemaType::kGroupedLiftMetrics>(
         FLAGS_party,
@@ -170,7 +188,9 @@ int main(int argc, char* argv[]) {
         FLAGS_visibility,
         FLAGS_server_ip,
         FLAGS_port,
-        tlsInfo);
+        tlsInfo,
+        std::chrono::seconds(FLAGS_input_wait_timeout_s),
+        FLAGS_partial_sum);
   } else {
     std::string errStr = folly::sformat(
         "unsupported metrics format type: {}", FLAGS_metrics_format_type);
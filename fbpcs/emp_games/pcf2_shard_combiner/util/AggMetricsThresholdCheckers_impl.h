@@ -6,7 +6,11 @@
  */
 
 #include <unistd.h>
+#include <cstdint>
+#include <iterator>
+#include <memory>
 #include <type_traits>
+#include <vector>
 
 #include <folly/Format.h>
 
@@ -89,6 +93,87 @@ ThresholdFn<schedulerId, usingBatch, inputEncryption> getGroupLiftChecker(
   };
 }
 
+/**
+ * Checks the same thresholds as getGroupLiftChecker, for batched XOR secret
+ * values, with one batched comparison for all the LiftMetrics of the grouped
+ * metrics and one batched mux for all the values they hide, instead of one of
+ * each per LiftMetrics. The conditions are laid out again next to the values
+ * they mask, and the masked values are scattered back to their nodes.
+ */
+template <
+    int schedulerId,
+    bool usingBatch,
+    common::InputEncryption inputEncryption>
+ThresholdFn<schedulerId, usingBatch, inputEncryption>
+getBatchedGroupLiftChecker(int64_t threshold, int64_t sentinelVal) {
+  return [threshold, sentinelVal](
+             AggMetrics_sp<schedulerId, usingBatch, inputEncryption>
+                 aggMetrics) {
+    using SecInt_t = SecInt<schedulerId, usingBatch>;
+    using SecBit_t = SecBit<schedulerId, usingBatch>;
+    if (aggMetrics->getType() != AggMetricType::kDict) {
+      return;
+    }
+
+    std::vector<AggMetrics_sp<schedulerId, usingBatch, inputEncryption>>
+        liftMetrics{aggMetrics->getAtKey("metrics")};
+    for (const auto& key : {"cohortMetrics", "publisherBreakdowns"}) {
+      const auto& list = aggMetrics->getAtKey(key)->getAsList();
+      liftMetrics.insert(liftMetrics.end(), list.begin(), list.end());
+    }
+
+    auto batchOf = [](const auto& secrets) {
+      return secrets.at(0).batchingWith(
+          std::vector(std::next(secrets.begin()), secrets.end()));
+    };
+
+    // (controlConverters + testConverters) >= threshold, for every
+    // LiftMetrics at once
+    std::vector<SecInt_t> testConverters;
+    std::vector<SecInt_t> controlConverters;
+    for (const auto& metrics : liftMetrics) {
+      testConverters.push_back(
+          metrics->getAtKey("testConverters")->getSecValueXor());
+      controlConverters.push_back(
+          metrics->getAtKey("controlConverters")->getSecValueXor());
+    }
+    const uint32_t numLiftMetrics = liftMetrics.size();
+    auto conditions = (batchOf(controlConverters) + batchOf(testConverters)) >=
+        SecInt_t(
+            std::vector<int64_t>(numLiftMetrics, threshold), common::PUBLISHER);
+    auto conditionOfLiftMetrics = conditions.unbatching(
+        std::make_shared<std::vector<uint32_t>>(numLiftMetrics, 1));
+
+    std::vector<AggMetrics_sp<schedulerId, usingBatch, inputEncryption>>
+        hiddenValues;
+    std::vector<SecInt_t> values;
+    std::vector<SecBit_t> conditionOfValues;
+    for (uint32_t i = 0; i < numLiftMetrics; ++i) {
+      for (const auto& [k, v] : liftMetrics.at(i)->getAsDict()) {
+        if (v->getType() == AggMetricType::kValue &&
+            k != "testPopulation" && k != "controlPopulation") {
+          hiddenValues.push_back(v);
+          values.push_back(v->getSecValueXor());
+          conditionOfValues.push_back(conditionOfLiftMetrics.at(i));
+        }
+      }
+    }
+    if (hiddenValues.empty()) {
+      return;
+    }
+
+    const uint32_t numValues = hiddenValues.size();
+    SecInt_t sentinels(
+        std::vector<int64_t>(numValues, sentinelVal), common::PUBLISHER);
+    auto maskedValues =
+        sentinels.mux(batchOf(conditionOfValues), batchOf(values))
+            .unbatching(std::make_shared<std::vector<uint32_t>>(numValues, 1));
+    for (uint32_t i = 0; i < numValues; ++i) {
+      hiddenValues.at(i)->setSecValueXor(maskedValues.at(i));
+    }
+  };
+}
+
 template <
     int schedulerId,
     bool usingBatch,
@@ -154,6 +239,13 @@ checkThresholdAndUpdateMetric(
     int64_t threshold,
     int64_t sentinelVal = -1) {
   if (shardSchemaType == ShardSchemaType::kGroupedLiftMetrics) {
+    if constexpr (
+        usingBatch && inputEncryption == common::InputEncryption::Xor) {
+      return getBatchedGroupLiftChecker<
+          schedulerId,
+          usingBatch,
+          inputEncryption>(threshold, sentinelVal);
+    }
     return getGroupLiftChecker<schedulerId, usingBatch, inputEncryption>(
         threshold, sentinelVal);
   } else {
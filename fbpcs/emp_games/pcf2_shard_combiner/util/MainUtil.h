@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <memory>
 
@@ -35,7 +36,9 @@ common::SchedulerStatistics runApp(
     std::string ip,
     std::uint16_t port,
     fbpcf::engine::communication::SocketPartyCommunicationAgent::TlsInfo&
-        tlsInfo) {
+        tlsInfo,
+    std::chrono::seconds inputWaitTimeout = std::chrono::seconds{0},
+    bool partialSum = false) {
   assert(inputEncryption == common::InputEncryption::Xor);
   assert(visibility == 0 || visibility == 1 || visibility == 2);
 
@@ -83,7 +86,9 @@ common::SchedulerStatistics runApp(
           threshold,
           useXorEncryption,
           resultVisibility,
-          metricCollector);
+          metricCollector,
+          inputWaitTimeout,
+          partialSum);
       app->run();
       return app->getSchedulerStatistics();
     } else {
@@ -101,7 +106,9 @@ common::SchedulerStatistics runApp(
           threshold,
           useXorEncryption,
           resultVisibility,
-          metricCollector);
+          metricCollector,
+          inputWaitTimeout,
+          partialSum);
       app->run();
       return app->getSchedulerStatistics();
     }
@@ -121,7 +128,9 @@ common::SchedulerStatistics runApp(
           threshold,
           useXorEncryption,
           resultVisibility,
-          metricCollector);
+          metricCollector,
+          inputWaitTimeout,
+          partialSum);
       app->run();
       return app->getSchedulerStatistics();
     } else {
@@ -139,7 +148,9 @@ common::SchedulerStatistics runApp(
           threshold,
           useXorEncryption,
           resultVisibility,
-          metricCollector);
+          metricCollector,
+          inputWaitTimeout,
+          partialSum);
       app->run();
       return app->getSchedulerStatistics();
     }
@@ -7,26 +7,79 @@
 
 #include <fbpcf/engine/communication/SocketPartyCommunicationAgentFactory.h>
 #include <fbpcf/exception/exceptions.h>
+#include <fbpcf/io/api/BufferedWriter.h>
 #include <fbpcf/io/api/FileReader.h>
+#include <fbpcf/io/api/FileWriter.h>
 #include <folly/logging/xlog.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <future>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "fbpcs/emp_games/common/Constants.h"
 #include "fbpcs/emp_games/private_id_dfca_aggregator/PrivateIdDfcaAggregatorApp.h"
+#include "fbpcs/emp_games/private_id_dfca_aggregator/util/RangeMerger.h"
 #include "fbpcs/emp_games/private_id_dfca_aggregator/util/ShardReader.h"
 #include "fbpcs/emp_games/private_id_dfca_aggregator/util/SortedIdSwapper.h"
 
 namespace private_id_dfca_aggregator {
 
-const size_t MSG_SIZE(BUFSIZ);
-const std::vector<unsigned char> MSG_TERM(MSG_SIZE);
+/*
+The partner sends its lines to the publisher in messages of whole lines, each
+framed as an 8 byte length followed by that many bytes of lines. A message of
+length 0 ends the stream.
+*/
+namespace {
+void sendMessage(
+    fbpcf::engine::communication::IPartyCommunicationAgent& agent,
+    const std::string& lines) {
+  uint64_t size = lines.size();
+  std::vector<unsigned char> header(sizeof(size));
+  std::memcpy(header.data(), &size, sizeof(size));
+  agent.send(header);
+  if (size > 0) {
+    agent.send(std::vector<unsigned char>(lines.begin(), lines.end()));
+  }
+}
+
+// Returns an empty vector at the end of the stream
+std::vector<unsigned char> receiveMessage(
+    fbpcf::engine::communication::IPartyCommunicationAgent& agent) {
+  auto header = agent.receive(sizeof(uint64_t));
+  uint64_t size;
+  std::memcpy(&size, header.data(), sizeof(size));
+  if (size == 0) {
+    return {};
+  }
+  return agent.receive(size);
+}
+
+// The lines of a message, which point into it
+std::vector<folly::StringPiece> splitLines(
+    const std::vector<unsigned char>& message) {
+  std::vector<folly::StringPiece> lines;
+  folly::split(
+      '\n',
+      folly::StringPiece(
+          reinterpret_cast<const char*>(message.data()), message.size()),
+      lines,
+      true /* ignoreEmpty */);
+  return lines;
+}
+} // namespace
 
 PrivateIdDfcaAggregatorApp::PrivateIdDfcaAggregatorApp(
     std::unique_ptr<
         fbpcf::engine::communication::IPartyCommunicationAgentFactory>
-        communicationAgentFactory)
-    : communicationAgentFactory_(std::move(communicationAgentFactory)) {}
+        communicationAgentFactory,
+    size_t messageSize,
+    size_t numPartitions)
+    : communicationAgentFactory_(std::move(communicationAgentFactory)),
+      messageSize_(std::max<size_t>(messageSize, 1)),
+      numPartitions_(std::max<size_t>(numPartitions, 1)) {}
 
 void PrivateIdDfcaAggregatorApp::run(
     const std::int8_t party,
@@ -42,10 +95,18 @@ void PrivateIdDfcaAggregatorApp::run(
 
   switch (party) {
     case common::PUBLISHER:
-      runPublisher(outputPath);
+      if (numPartitions_ > 1) {
+        runPartitionedPublisher(outputPath);
+      } else {
+        runPublisher(outputPath);
+      }
       break;
     case common::PARTNER:
-      runPartner();
+      if (numPartitions_ > 1) {
+        runPartitionedPartner();
+      } else {
+        runPartner();
+      }
       break;
     default:
       throw common::exceptions::NotImplementedError(
@@ -60,18 +121,26 @@ void PrivateIdDfcaAggregatorApp::runPublisher(const std::string& outputPath) {
   auto communicationAgent = communicationAgentFactory_->create(
       common::PARTNER, "pid_dfca_aggregator_publisher");
 
-  auto partnerData = communicationAgent->receive(MSG_SIZE);
-  while (partnerData != MSG_TERM && !shardReader_->isFinished()) {
+  // The next message is received while the lines of the current one are
+  // swapped. Once the publisher shard is finished the rest of the stream is
+  // still received, so that the partner can finish sending it.
+  auto receiveNext = [&communicationAgent]() {
+    return std::async(std::launch::async, [&communicationAgent]() {
+      return receiveMessage(*communicationAgent);
+    });
+  };
+  auto nextMessage = receiveNext();
+  auto partnerData = nextMessage.get();
+  while (!partnerData.empty()) {
     XLOG(INFO) << "Publisher: Received partner message -- size: "
                << partnerData.size();
+    nextMessage = receiveNext();
 
-    std::vector<char> buf(partnerData.begin(), partnerData.end());
-    std::vector<std::string> partnerLines;
-    folly::split('\n', buf, partnerLines);
+    if (!shardReader_->isFinished()) {
+      sortedIdSwapper->run(splitLines(partnerData));
+    }
 
-    sortedIdSwapper->run(partnerLines);
-
-    partnerData = communicationAgent->receive(MSG_SIZE);
+    partnerData = nextMessage.get();
   }
 
   XLOG(INFO) << "Publisher: Finished";
@@ -82,18 +151,140 @@ void PrivateIdDfcaAggregatorApp::runPartner() {
   auto communicationAgent = communicationAgentFactory_->create(
       common::PUBLISHER, "pid_dfca_aggregator_partner");
 
+  // The next lines are read while the current ones are sent
+  auto readNext = [this]() {
+    return std::async(std::launch::async, [this]() {
+      return shardReader_->getNextLines(messageSize_);
+    });
+  };
+  auto nextLines = readNext();
+  auto lines = nextLines.get();
+  while (!lines.empty()) {
+    nextLines = readNext();
+
+    XLOG(INFO) << "Partner: Sending message -- size: " << lines.size();
+    sendMessage(*communicationAgent, lines);
+
+    lines = nextLines.get();
+  }
+
+  XLOG(INFO) << "Partner: Finished";
+  sendMessage(*communicationAgent, "");
+}
+
+std::vector<std::string> PrivateIdDfcaAggregatorApp::readAllLines() {
+  std::vector<std::string> lines;
   while (!shardReader_->isFinished()) {
-    auto message = shardReader_->getNextChunk(MSG_SIZE);
+    auto line = shardReader_->readNextLine();
+    if (!line.empty()) {
+      lines.push_back(std::move(line));
+    }
+  }
+  return lines;
+}
 
-    const std::vector<unsigned char> data(message.begin(), message.end());
+std::vector<std::unique_ptr<
+    fbpcf::engine::communication::IPartyCommunicationAgent>>
+PrivateIdDfcaAggregatorApp::createPartitionAgents(
+    int otherParty,
+    const std::string& name) {
+  std::vector<
+      std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgent>>
+      agents;
+  for (size_t i = 0; i < numPartitions_; ++i) {
+    agents.push_back(communicationAgentFactory_->create(
+        otherParty, name + "_" + std::to_string(i)));
+  }
+  return agents;
+}
+
+void PrivateIdDfcaAggregatorApp::runPartitionedPublisher(
+    const std::string& outputPath) {
+  auto communicationAgent = communicationAgentFactory_->create(
+      common::PARTNER, "pid_dfca_aggregator_publisher");
+  auto publisherLines = readAllLines();
 
-    XLOG(INFO) << "Partner: Sending message -- size: " << data.size();
+  // The partner picks the split ids from its lines, which both parties
+  // partition their lines by
+  std::vector<std::string> splitIds;
+  auto splitIdsMessage = receiveMessage(*communicationAgent);
+  if (!splitIdsMessage.empty()) {
+    folly::split(
+        '\n',
+        folly::StringPiece(
+            reinterpret_cast<const char*>(splitIdsMessage.data()),
+            splitIdsMessage.size()),
+        splitIds);
+  }
+  auto bounds = getPartitionBounds(publisherLines, splitIds, numPartitions_);
+  XLOG(INFO) << "Publisher: Merging " << publisherLines.size()
+             << " lines in " << numPartitions_ << " ranges";
+
+  auto agents = createPartitionAgents(
+      common::PARTNER, "pid_dfca_aggregator_publisher");
+  std::vector<std::future<std::string>> outputs;
+  for (size_t i = 0; i < numPartitions_; ++i) {
+    outputs.push_back(std::async(
+        std::launch::async,
+        [&publisherLines, &bounds, &agent = *agents.at(i), i]() {
+          RangeMerger merger{publisherLines, bounds.at(i), bounds.at(i + 1)};
+          std::string output;
+          auto partnerData = receiveMessage(agent);
+          while (!partnerData.empty()) {
+            merger.merge(splitLines(partnerData), output);
+            partnerData = receiveMessage(agent);
+          }
+          return output;
+        }));
+  }
 
-    communicationAgent->send(data);
+  fbpcf::io::BufferedWriter writer{
+      std::make_unique<fbpcf::io::FileWriter>(outputPath)};
+  writer.writeString("publisher_user_id,partner_user_id\n");
+  for (auto& output : outputs) {
+    writer.writeString(output.get());
   }
+  writer.close();
+  XLOG(INFO) << "Publisher: Finished";
+}
+
+void PrivateIdDfcaAggregatorApp::runPartitionedPartner() {
+  auto communicationAgent = communicationAgentFactory_->create(
+      common::PUBLISHER, "pid_dfca_aggregator_partner");
+  auto partnerLines = readAllLines();
 
+  auto splitIds = pickSplitIds(partnerLines, numPartitions_);
+  sendMessage(*communicationAgent, folly::join('\n', splitIds));
+  auto bounds = getPartitionBounds(partnerLines, splitIds, numPartitions_);
+  XLOG(INFO) << "Partner: Sending " << partnerLines.size() << " lines in "
+             << numPartitions_ << " ranges";
+
+  auto agents = createPartitionAgents(
+      common::PUBLISHER, "pid_dfca_aggregator_partner");
+  std::vector<std::future<void>> sent;
+  for (size_t i = 0; i < numPartitions_; ++i) {
+    sent.push_back(std::async(
+        std::launch::async,
+        [this, &partnerLines, &bounds, &agent = *agents.at(i), i]() {
+          std::string lines;
+          for (auto j = bounds.at(i); j < bounds.at(i + 1); ++j) {
+            if (!lines.empty() &&
+                lines.size() + partnerLines.at(j).size() > messageSize_) {
+              sendMessage(agent, lines);
+              lines.clear();
+            }
+            lines += partnerLines.at(j);
+          }
+          if (!lines.empty()) {
+            sendMessage(agent, lines);
+          }
+          sendMessage(agent, "");
+        }));
+  }
+  for (auto& partition : sent) {
+    partition.get();
+  }
   XLOG(INFO) << "Partner: Finished";
-  communicationAgent->send(MSG_TERM);
 }
 
 } // namespace private_id_dfca_aggregator
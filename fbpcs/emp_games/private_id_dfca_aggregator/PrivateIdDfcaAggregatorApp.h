@@ -11,6 +11,7 @@
 #include <memory>
 #include <queue>
 #include <string>
+#include <vector>
 
 #include <fbpcf/engine/communication/SocketPartyCommunicationAgentFactory.h>
 #include <fbpcf/io/api/BufferedReader.h>
@@ -23,10 +24,15 @@ namespace private_id_dfca_aggregator {
 
 class PrivateIdDfcaAggregatorApp {
  public:
+  // The partner sends its lines in messages of up to messageSize bytes
+  static constexpr size_t kDefaultMessageSize = 4 << 20;
+
   explicit PrivateIdDfcaAggregatorApp(
       std::unique_ptr<
           fbpcf::engine::communication::IPartyCommunicationAgentFactory>
-          communicationAgentFactory);
+          communicationAgentFactory,
+      size_t messageSize = kDefaultMessageSize,
+      size_t numPartitions = 1);
 
   void run(
       const std::int8_t party,
@@ -37,9 +43,24 @@ class PrivateIdDfcaAggregatorApp {
   void runPublisher(const std::string& outputPath);
   void runPartner();
 
+  // With more than one partition, both parties read their whole shard and
+  // split it into numPartitions ranges of private ids, at split ids the
+  // partner picks from its lines. Every range is sent and merged over its
+  // own connection, in parallel, and the matches of the ranges are written in
+  // the order of the ranges, which is the order of the ids.
+  void runPartitionedPublisher(const std::string& outputPath);
+  void runPartitionedPartner();
+
  private:
   std::unique_ptr<fbpcf::engine::communication::IPartyCommunicationAgentFactory>
       communicationAgentFactory_;
+  std::vector<std::string> readAllLines();
+  std::vector<std::unique_ptr<
+      fbpcf::engine::communication::IPartyCommunicationAgent>>
+  createPartitionAgents(int otherParty, const std::string& name);
+
   std::shared_ptr<ShardReader> shardReader_;
+  size_t messageSize_;
+  size_t numPartitions_;
 };
 } // namespace private_id_dfca_aggregator
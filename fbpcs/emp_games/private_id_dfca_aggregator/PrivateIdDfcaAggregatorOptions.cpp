@@ -14,6 +14,14 @@ DEFINE_string(server_ip, "", "Server's IP address");
 DEFINE_int32(port, 15200, "Server's port");
 DEFINE_string(input_path, "", "Input path where input file is located");
 DEFINE_string(output_path, "", "Output path where output file is located");
+DEFINE_int32(
+    message_size_kb,
+    4096,
+    "Size in KB of the messages of whole lines the partner sends its input in");
+DEFINE_int32(
+    num_partitions,
+    1,
+    "Number of private id ranges merged in parallel, each over its own connection. Both parties read their whole shard into memory when it is more than 1");
 DEFINE_string(run_name, "", "User given name used to write cost info in S3");
 DEFINE_bool(
     log_cost,
@@ -14,6 +14,8 @@ DECLARE_string(server_ip);
 DECLARE_int32(port);
 DECLARE_string(input_path);
 DECLARE_string(output_path);
+DECLARE_int32(message_size_kb);
+DECLARE_int32(num_partitions);
 DECLARE_string(run_name);
 DECLARE_bool(log_cost);
 DECLARE_string(log_cost_s3_bucket);
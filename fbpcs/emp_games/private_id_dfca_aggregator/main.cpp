@@ -13,6 +13,7 @@
 #include <folly/logging/xlog.h>
 #include <glog/logging.h>
 #include <signal.h>
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
@@ -72,7 +73,9 @@ int main(int argc, char* argv[]) {
       FLAGS_party, partyInfos, tlsInfo, metricCollector);
 
   auto app = private_id_dfca_aggregator::PrivateIdDfcaAggregatorApp(
-      std::move(commAgentFactory));
+      std::move(commAgentFactory),
+      static_cast<size_t>(std::max(FLAGS_message_size_kb, 1)) * 1024,
+      std::max(FLAGS_num_partitions, 1));
 
   app.run(FLAGS_party, FLAGS_input_path, FLAGS_output_path);
 
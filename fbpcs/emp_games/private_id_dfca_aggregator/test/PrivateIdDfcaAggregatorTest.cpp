@@ -52,14 +52,18 @@ class PrivateIdDfcaAggregatorAppTestFixture
           communicationAgentFactory,
       const std::int32_t party,
       const std::string& inputPath,
-      const std::string& outputPath) {
+      const std::string& outputPath,
+      size_t numPartitions) {
+    // Small messages, so that the shards are sent in many of them
     auto app = std::make_unique<PrivateIdDfcaAggregatorApp>(
-        std::move(communicationAgentFactory));
+        std::move(communicationAgentFactory),
+        64 /* messageSize */,
+        numPartitions);
 
     app->run(party, inputPath, outputPath);
   }
 
-  void runGame(bool useTls, int shardNumber) {
+  void runGame(bool useTls, int shardNumber, size_t numPartitions = 1) {
     fbpcf::engine::communication::SocketPartyCommunicationAgent::TlsInfo
         tlsInfo;
     tlsInfo.certPath = useTls ? (tlsDir_ + "/cert.pem") : "";
@@ -82,7 +86,8 @@ class PrivateIdDfcaAggregatorAppTestFixture
         common::PUBLISHER,
         "./fbpcs/emp_games/private_id_dfca_aggregator/test/inputs/publisher/shard_" +
             std::to_string(shardNumber) + ".csv",
-        outputFile);
+        outputFile,
+        numPartitions);
 
     XLOG(INFO) << "Executing f2";
 
@@ -92,7 +97,8 @@ class PrivateIdDfcaAggregatorAppTestFixture
         common::PARTNER,
         "./fbpcs/emp_games/private_id_dfca_aggregator/test/inputs/partner/shard_" +
             std::to_string(shardNumber) + ".csv",
-        outputFile);
+        outputFile,
+        numPartitions);
 
     f1.wait();
     f2.wait();
@@ -118,6 +124,11 @@ TEST_P(PrivateIdDfcaAggregatorAppTestFixture, testAggregation) {
   runGame(useTls, shardNumber);
 }
 
+TEST_P(PrivateIdDfcaAggregatorAppTestFixture, testPartitionedAggregation) {
+  auto [useTls, shardNumber] = GetParam();
+  runGame(useTls, shardNumber, 3);
+}
+
 INSTANTIATE_TEST_CASE_P(
     ShardCombinerAppTest,
     PrivateIdDfcaAggregatorAppTestFixture,
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/String.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace private_id_dfca_aggregator {
+
+// The private id of a "privateId,userId\n" line
+inline folly::StringPiece getPrivateId(folly::StringPiece line) {
+  auto comma = line.find(',');
+  return comma == folly::StringPiece::npos ? line : line.subpiece(0, comma);
+}
+
+// Picks the private ids splitting lines, sorted by private id, into
+// numPartitions ranges of about the same number of lines. There are fewer
+// than numPartitions - 1 of them if there are fewer lines than that.
+inline std::vector<std::string> pickSplitIds(
+    const std::vector<std::string>& lines,
+    size_t numPartitions) {
+  std::vector<std::string> splitIds;
+  for (size_t i = 1; i < numPartitions; ++i) {
+    auto index = i * lines.size() / numPartitions;
+    if (index > 0 && index < lines.size()) {
+      splitIds.push_back(getPrivateId(lines.at(index)).str());
+    }
+  }
+  return splitIds;
+}
+
+// Returns the numPartitions + 1 bounds of the ranges of lines, sorted by
+// private id, whose ids are below the first split id, between two split ids,
+// and so on. Ranges past the last split id are empty, so that both parties
+// get the same ranges from the same split ids.
+inline std::vector<size_t> getPartitionBounds(
+    const std::vector<std::string>& lines,
+    const std::vector<std::string>& splitIds,
+    size_t numPartitions) {
+  std::vector<size_t> bounds{0};
+  for (size_t i = 1; i < numPartitions; ++i) {
+    if (i - 1 < splitIds.size()) {
+      folly::StringPiece splitId{splitIds.at(i - 1)};
+      auto bound = std::lower_bound(
+          lines.begin() + bounds.back(),
+          lines.end(),
+          splitId,
+          [](const std::string& line, folly::StringPiece id) {
+            return getPrivateId(line) < id;
+          });
+      bounds.push_back(bound - lines.begin());
+    } else {
+      bounds.push_back(lines.size());
+    }
+  }
+  bounds.push_back(lines.size());
+  return bounds;
+}
+
+/*
+ * Merge joins the partner lines of a range with the publisher lines of the
+ * same range, both sorted by private id, like SortedIdSwapper does for a
+ * whole shard. The partner lines can be merged in several calls, in order.
+ */
+class RangeMerger {
+ public:
+  RangeMerger(
+      const std::vector<std::string>& publisherLines,
+      size_t begin,
+      size_t end)
+      : publisherLines_{publisherLines}, next_{begin}, end_{end} {}
+
+  // Appends a "publisherUserId,partnerUserId\n" line to out for every match
+  void merge(
+      const std::vector<folly::StringPiece>& partnerLines,
+      std::string& out) {
+    size_t partnerIdx = 0;
+    while (partnerIdx < partnerLines.size() && next_ < end_) {
+      folly::StringPiece publisherPrivateId, publisherUserId;
+      folly::split(
+          ',', publisherLines_.at(next_), publisherPrivateId, publisherUserId);
+
+      folly::StringPiece partnerPrivateId, partnerUserId;
+      folly::split(
+          ',', partnerLines[partnerIdx], partnerPrivateId, partnerUserId);
+
+      auto compareRes = publisherPrivateId.compare(partnerPrivateId);
+      if (compareRes == 0) {
+        auto publisherUserIdTrimmed = folly::trimWhitespace(publisherUserId);
+        auto partnerUserIdTrimmed = folly::trimWhitespace(partnerUserId);
+        out.append(
+            publisherUserIdTrimmed.data(), publisherUserIdTrimmed.size());
+        out += ',';
+        out.append(partnerUserIdTrimmed.data(), partnerUserIdTrimmed.size());
+        out += '\n';
+        partnerIdx++;
+        next_++;
+      } else if (compareRes < 0) {
+        next_++;
+      } else {
+        partnerIdx++;
+      }
+    }
+  }
+
+ private:
+  const std::vector<std::string>& publisherLines_;
+  size_t next_;
+  size_t end_;
+};
+
+} // namespace private_id_dfca_aggregator
@@ -31,34 +31,50 @@ class ShardReader {
     return chunk + std::string(chunkSize - chunk.size(), '\x00');
   }
 
-  std::string peekNextLine() {
-    if (lineBuffer_ == "") {
+  // Returns whole lines of up to maxSize bytes in total, or the next line
+  // alone if it is longer than that. Returns an empty string once the shard is
+  // finished.
+  std::string getNextLines(size_t maxSize) {
+    std::string lines;
+    while (!isFinished() &&
+           (lines.empty() || lines.size() + peekNextLine().size() <= maxSize)) {
+      lines += readNextLine();
+    }
+    return lines;
+  }
+
+  // The line stays valid until the next line is read
+  const std::string& peekNextLine() {
+    if (lineBuffer_.empty()) {
       lineBuffer_ = readNextLine();
     }
     return lineBuffer_;
   }
 
   std::string readNextLine() {
-    if (lineBuffer_ != "") {
-      auto tmp = lineBuffer_;
-      lineBuffer_ = "";
-      return tmp;
-    } else {
-      if (bufferedReader_->eof()) {
-        return "";
-      } else {
-        auto line = bufferedReader_->readLine();
-        folly::StringPiece privateId, userId;
-        folly::split(',', line, privateId, userId);
+    if (!lineBuffer_.empty()) {
+      std::string line = std::move(lineBuffer_);
+      lineBuffer_.clear();
+      return line;
+    }
+    while (!bufferedReader_->eof()) {
+      auto line = bufferedReader_->readLine();
+      folly::StringPiece privateId, userId;
+      folly::split(',', line, privateId, userId);
 
-        // Discard the header and unmatched PID results
-        if (privateId.toString() == "id_" || userId.toString() == "0") {
-          return readNextLine();
-        } else {
-          return privateId.toString() + "," + userId.toString() + "\n";
-        }
+      // Discard the header and unmatched PID results
+      if (privateId == "id_" || userId == "0") {
+        continue;
       }
+      std::string result;
+      result.reserve(privateId.size() + userId.size() + 2);
+      result.append(privateId.data(), privateId.size());
+      result += ',';
+      result.append(userId.data(), userId.size());
+      result += '\n';
+      return result;
     }
+    return "";
   }
 
   bool isFinished() {
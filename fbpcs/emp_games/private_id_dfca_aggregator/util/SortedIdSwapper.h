@@ -35,12 +35,15 @@ class SortedIdSwapper {
     bufferedWriter_->writeString("publisher_user_id,partner_user_id\n");
   }
 
-  void run(std::vector<std::string> partnerLines) {
-    int partnerIdx = 0;
+  // Merge joins the partner lines with the publisher lines, which are both
+  // sorted by private id. The ids are compared in place, and every match is
+  // formatted into one reused line.
+  void run(const std::vector<folly::StringPiece>& partnerLines) {
+    size_t partnerIdx = 0;
 
     while (partnerIdx < partnerLines.size() &&
            !publisherShardReader_->isFinished()) {
-      auto publisherLine = publisherShardReader_->peekNextLine();
+      const auto& publisherLine = publisherShardReader_->peekNextLine();
       folly::StringPiece publisherPrivateId, publisherUserId;
       folly::split(',', publisherLine, publisherPrivateId, publisherUserId);
 
@@ -48,23 +51,26 @@ class SortedIdSwapper {
       folly::split(
           ',', partnerLines[partnerIdx], partnerPrivateId, partnerUserId);
 
-      auto compareRes = publisherPrivateId.compare(partnerPrivateId.toString());
+      auto compareRes = publisherPrivateId.compare(partnerPrivateId);
 
       if (compareRes == 0) { // match
-
-        std::vector<std::string> userIds{
-            folly::trimWhitespace(publisherUserId).toString(),
-            folly::trimWhitespace(partnerUserId).toString()};
-
-        auto newLine = folly::join(",", userIds) + "\n";
-        bufferedWriter_->writeString(newLine);
+        auto publisherUserIdTrimmed = folly::trimWhitespace(publisherUserId);
+        auto partnerUserIdTrimmed = folly::trimWhitespace(partnerUserId);
+        outputLine_.clear();
+        outputLine_.append(
+            publisherUserIdTrimmed.data(), publisherUserIdTrimmed.size());
+        outputLine_ += ',';
+        outputLine_.append(
+            partnerUserIdTrimmed.data(), partnerUserIdTrimmed.size());
+        outputLine_ += '\n';
+        bufferedWriter_->writeString(outputLine_);
 
         partnerIdx++;
-        publisherLine = publisherShardReader_->readNextLine();
+        publisherShardReader_->readNextLine();
 
       } else if (compareRes < 0) { // publisherPrivateId < partnerPrivateId
 
-        publisherLine = publisherShardReader_->readNextLine();
+        publisherShardReader_->readNextLine();
 
       } else if (compareRes > 0) { // publisherPrivateId > partnerPrivateId
 
@@ -80,6 +86,7 @@ class SortedIdSwapper {
  private:
   std::unique_ptr<fbpcf::io::BufferedWriter> bufferedWriter_;
   std::shared_ptr<ShardReader> publisherShardReader_;
+  std::string outputLine_;
 };
 
 } // namespace private_id_dfca_aggregator
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <iostream>
+#include <stdexcept>
+
+#include <gflags/gflags.h>
+
+#include <folly/init/Init.h>
+#include <folly/json.h>
+#include <folly/logging/xlog.h>
+
+#include "fbpcs/emp_games/common/TrafficReplay.h"
+#include "fbpcs/emp_games/common/TrafficTrace.h"
+
+DEFINE_string(
+    publisher_trace,
+    "",
+    "Traffic trace of the publisher app of a lane, from traffic_trace_dir");
+DEFINE_string(
+    partner_trace,
+    "",
+    "Traffic trace of the partner app of the same lane. Without it, the time "
+    "of the publisher is only summarized as it was recorded");
+DEFINE_double(latency_ms, 0, "One way latency of the simulated network");
+DEFINE_double(
+    bandwidth_mbps,
+    0,
+    "Bandwidth of the simulated network in each direction, in megabits per "
+    "second, or 0 for unlimited");
+
+int main(int argc, char* argv[]) {
+  folly::init(&argc, &argv);
+
+  try {
+    if (FLAGS_publisher_trace.empty()) {
+      throw std::invalid_argument("publisher_trace is required");
+    }
+    auto publisher = common::TrafficTrace::read(FLAGS_publisher_trace);
+
+    folly::dynamic out = folly::dynamic::object;
+    if (FLAGS_partner_trace.empty()) {
+      out["publisher"] = common::summarizeTrafficTrace(publisher).toDynamic();
+    } else {
+      auto partner = common::TrafficTrace::read(FLAGS_partner_trace);
+      common::ReplayNetwork network;
+      network.latencySeconds = FLAGS_latency_ms / 1e3;
+      network.bytesPerSecond = FLAGS_bandwidth_mbps * 1e6 / 8;
+      auto parties = common::replayTrafficTraces(publisher, partner, network);
+      out["publisher"] = parties[0].toDynamic();
+      out["partner"] = parties[1].toDynamic();
+    }
+    std::cout << folly::toPrettyJson(out) << std::endl;
+  } catch (const std::exception& e) {
+    XLOGF(ERR, "Failed to replay the traffic traces: {}", e.what());
+    return 1;
+  }
+  return 0;
+}
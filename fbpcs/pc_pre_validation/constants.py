@@ -136,5 +136,8 @@ BINARY_INFOS: List[BinaryInfo] = [
     # TODO: Add UDP-ralted binaries when rolling out
 ]
 ONEDOCKER_EXE_PATH = "ONEDOCKER_EXE_PATH"
+# The path of the native input_data_validator binary, which scans downloaded
+# inputs in place of the Python workers when set
+INPUT_DATA_NATIVE_VALIDATOR_PATH = "INPUT_DATA_NATIVE_VALIDATOR_PATH"
 OUT_OF_RANGE_COUNT = "out_of_range_count"
 ERROR_MESSAGES = "error_messages"
@@ -19,7 +19,9 @@ Error handling:
 """
 
 import csv
+import json
 import os
+import subprocess
 import sys
 import time
 from multiprocessing import Process, Queue
@@ -38,6 +40,7 @@ from fbpcs.pc_pre_validation.constants import (
     EVENT_TIMESTAMP_FIELD,
     ID_FIELD_PREFIX,
     INPUT_DATA_MAX_FILE_SIZE_IN_BYTES,
+    INPUT_DATA_NATIVE_VALIDATOR_PATH,
     INPUT_DATA_TMP_FILE_PATH,
     INPUT_DATA_VALIDATOR_NAME,
     INTEGER_MAX_VALUE,
@@ -88,6 +91,7 @@ class InputDataValidator(Validator):
         start_timestamp: Optional[str] = None,
         end_timestamp: Optional[str] = None,
         tee_local_file_path: Optional[str] = None,
+        native_validator_path: Optional[str] = None,
     ) -> None:
         self._input_file_path = input_file_path
         self._local_file_path: str = self._get_local_filepath()
@@ -100,6 +104,9 @@ class InputDataValidator(Validator):
         self._partner_pc_pre_validation = partner_pc_pre_validation
         self._enable_for_tee = enable_for_tee
         self._tee_local_file_path = tee_local_file_path
+        self._native_validator_path: Optional[str] = (
+            native_validator_path or os.getenv(INPUT_DATA_NATIVE_VALIDATOR_PATH)
+        )
         self._private_computation_role: PrivateComputationRole = (
             private_computation_role
         )
@@ -359,10 +366,13 @@ class InputDataValidator(Validator):
 
             header_row = self._get_and_validate_header(validation_issues)
 
-            if not self._stream_file:
-                self._create_shards()
+            if not self._stream_file and self._native_validator_path:
+                self._run_native_validator(validation_issues)
+            else:
+                if not self._stream_file:
+                    self._create_shards()
 
-            self._run_workers(validation_issues, header_row)
+                self._run_workers(validation_issues, header_row)
 
             self._validate_cohort_ids(validation_issues.cohort_id_set)
 
@@ -454,6 +464,42 @@ class InputDataValidator(Validator):
                     f"Worker {i} failed with exit code {w.exitcode}"
                 )
 
+    # Validates the rows of the local file with the native input_data_validator,
+    # which reports the same counts as the workers
+    def _run_native_validator(
+        self, validation_issues: InputDataValidationIssues
+    ) -> None:
+        native_validator_path = self._native_validator_path
+        if native_validator_path is None:
+            raise InputDataValidationException(
+                "The native input data validator path is not set."
+            )
+        command = [
+            native_validator_path,
+            f"--input_path={self._local_file_path}",
+            f"--start_timestamp={self._start_timestamp or 0}",
+            f"--end_timestamp={self._end_timestamp or 0}",
+            f"--enable_for_tee={str(self._enable_for_tee).lower()}",
+            f"--num_threads={self._parallelism}",
+        ]
+        try:
+            output = subprocess.run(
+                command, check=True, capture_output=True, text=True
+            ).stdout
+            counts = json.loads(output)
+        except (OSError, ValueError, subprocess.CalledProcessError) as e:
+            raise InputDataValidationException(
+                f"Failed to run the native input data validator.\n\t{e}"
+            )
+
+        validation_issues.empty_counter.update(counts["empty_counts"])
+        validation_issues.format_error_counter.update(counts["format_error_counts"])
+        validation_issues.range_error_counter.update(counts["range_error_counts"])
+        validation_issues.cohort_id_set |= set(counts["cohort_ids"])
+        validation_issues.rows_processed_count += counts["rows_processed_count"]
+        if counts["error"]:
+            raise InputDataValidationException(counts["error"])
+
     def _stream_field_names(self) -> Sequence[str]:
         try:
             response = self._s3_client.get_object(
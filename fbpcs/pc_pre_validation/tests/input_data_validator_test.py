@@ -4,6 +4,7 @@
 # LICENSE file in the root directory of this source tree.
 
 # pyre-strict
+import json
 import os
 import random
 import time
@@ -291,6 +292,60 @@ class TestInputDataValidator(TestCase):
 
         self.assertEqual(report, expected_report)
 
+    @patch("fbpcs.pc_pre_validation.input_data_validator.subprocess")
+    @patch("fbpcs.pc_pre_validation.input_data_validator.time")
+    def test_run_validations_with_native_validator(
+        self, time_mock: Mock, subprocess_mock: Mock
+    ) -> None:
+        time_mock.time.return_value = TEST_TIMESTAMP
+        self.write_lines_to_file([b"id_,value,event_timestamp\n"])
+        subprocess_mock.run.return_value.stdout = json.dumps(
+            {
+                "rows_processed_count": 3,
+                "empty_counts": {},
+                "format_error_counts": {"id_": 2},
+                "range_error_counts": {},
+                "cohort_ids": [],
+                "error": "",
+            }
+        )
+        expected_report = ValidationReport(
+            validation_result=ValidationResult.FAILED,
+            validator_name=INPUT_DATA_VALIDATOR_NAME,
+            message=f"File: {TEST_TEMP_FILEPATH} failed validation, with errors on 'id_'.",
+            details={
+                "rows_processed_count": 3,
+                "validation_errors": {"id_": {"bad_format_count": 2}},
+            },
+        )
+
+        validator = InputDataValidator(
+            input_file_path=TEST_INPUT_FILE_PATH,
+            cloud_provider=TEST_CLOUD_PROVIDER,
+            region=TEST_REGION,
+            stream_file=TEST_STREAM_FILE,
+            publisher_pc_pre_validation=TEST_PUBLISHER_PC_PRE_VALIDATION,
+            partner_pc_pre_validation=TEST_PARTNER_PC_PRE_VALIDATION,
+            enable_for_tee=True,
+            private_computation_role=TEST_PRIVATE_COMPUTATION_ROLE,
+            tee_local_file_path=TEST_TEMP_FILEPATH,
+            native_validator_path="/bin/input_data_validator",
+        )
+        report = validator.validate()
+
+        self.assertEqual(report, expected_report)
+        self.assertEqual(
+            subprocess_mock.run.call_args[0][0],
+            [
+                "/bin/input_data_validator",
+                f"--input_path={TEST_TEMP_FILEPATH}",
+                "--start_timestamp=0",
+                "--end_timestamp=0",
+                "--enable_for_tee=true",
+                "--num_threads=1",
+            ],
+        )
+
     @patch("fbpcs.pc_pre_validation.input_data_validator.time")
     def test_run_validations_success_for_pl_fields(self, time_mock: Mock) -> None:
         time_mock.time.return_value = TEST_TIMESTAMP
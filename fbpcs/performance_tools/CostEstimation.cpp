@@ -6,25 +6,50 @@
  */
 
 #include "fbpcs/performance_tools/CostEstimation.h"
+#include "fbpcs/performance_tools/CostUploader.h"
+#include "fbpcs/performance_tools/PhaseProfiler.h"
 #include <fbpcf/io/api/FileIOWrappers.h>
 #include <folly/DynamicConverter.h>
 #include <folly/dynamic.h>
 #include <folly/json.h>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
 #include <sys/resource.h>
 #include <unistd.h>
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
 #include <iomanip>
+#include <limits>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+DEFINE_int32(
+    cost_sampling_interval_ms,
+    0,
+    "If positive, sample the memory, network and CPU usage in the background at this interval for the cost log");
+DEFINE_int32(
+    cost_upload_deadline_ms,
+    5000,
+    "How long a run waits for its cost log to be written before it exits. "
+    "A write which hasn't succeeded by then makes no further attempts, and "
+    "is left in cost_spool_dir for the next run given it");
+DEFINE_int32(
+    cost_upload_attempts,
+    3,
+    "How many times the write of the cost log is tried");
+DEFINE_string(
+    cost_spool_dir,
+    "/tmp/fbpcs_cost_spool",
+    "Local directory where the cost log is kept until it is written. Empty "
+    "to not keep it");
+
 namespace fbpcs::performance_tools {
 
 const std::unordered_map<std::string, std::string> SUPPORTED_APPLICATIONS(
@@ -102,42 +127,34 @@ void CostEstimation::calculateCostCheckPoints() {
 
   for (size_t i = 0; i < checkPoints_; ++i) {
     auto& cur_checkpoint = checkPointMetrics_.at(checkPointName_[i]);
-    // CPU cost
-    const double cpu_cost =
-        vCPUS * (PER_CPU_HOUR_COST / 60) * (cur_checkpoint.runtime / 60);
-    // Memory cost
-    const double memory_cost =
-        MEMORY_SIZE * (PER_GB_HOUR_COST / 60) * (cur_checkpoint.runtime / 60);
-    // Network cost
-    const double network_cost =
-        (((cur_checkpoint.networkRxBytes + cur_checkpoint.networkTxBytes) /
-          1024) /
-         1024 / 1024) *
-        NETWORK_PER_GB_COST;
-    // ECR cost
-    const double binarySizeInGB = 0.2; // The PA binary file is about ~200MB
-    const double ecr_cost = binarySizeInGB * ECR_PER_GB_COST;
-    // Total estimated cost
-    cur_checkpoint.cost = cpu_cost + memory_cost + network_cost + ecr_cost;
+    cur_checkpoint.cost = estimateCost(
+        cur_checkpoint.runtime,
+        cur_checkpoint.networkRxBytes + cur_checkpoint.networkTxBytes);
   }
 }
 
-void CostEstimation::calculateCost() {
+double CostEstimation::estimateCost(
+    double runningTimeInSec,
+    double networkBytes) {
   // CPU cost
-  double cpu_cost =
-      vCPUS * (PER_CPU_HOUR_COST / 60) * ((double)runningTimeInSec_ / 60);
+  double cpu_cost = vCPUS * (PER_CPU_HOUR_COST / 60) * (runningTimeInSec / 60);
   // Memory cost
   double memory_cost =
-      MEMORY_SIZE * (PER_GB_HOUR_COST / 60) * ((double)runningTimeInSec_ / 60);
+      MEMORY_SIZE * (PER_GB_HOUR_COST / 60) * (runningTimeInSec / 60);
   // Network cost
   double network_cost =
-      (((double)(networkRXBytes_ + networkTXBytes_) / 1024) / 1024 / 1024) *
-      NETWORK_PER_GB_COST;
+      ((networkBytes / 1024) / 1024 / 1024) * NETWORK_PER_GB_COST;
   // ECR cost
   double binarySizeInGB = 0.2; // The PA binary file is about ~200MB
   double ecr_cost = binarySizeInGB * ECR_PER_GB_COST;
   // Total estimated cost
-  estimatedCost_ = cpu_cost + memory_cost + network_cost + ecr_cost;
+  return cpu_cost + memory_cost + network_cost + ecr_cost;
+}
+
+void CostEstimation::calculateCost() {
+  estimatedCost_ = estimateCost(
+      runningTimeInSec_,
+      static_cast<double>(networkRXBytes_ + networkTXBytes_));
   // peak memory usage
   peakRSS_ = getPeakRSS();
   if (checkPoints_ > 0) {
@@ -230,6 +247,9 @@ folly::dynamic CostEstimation::getEstimatedCostDynamic(
   result.insert("cloud_provider", CLOUD);
   result.insert("additional_info", folly::toJson(info));
   result.insert("maximum memory usage", peakRSS_);
+  if (!samplesSummary_.isNull()) {
+    result.insert("samples", folly::toJson(samplesSummary_));
+  }
 
   if (checkPoints_ > 0) {
     folly::dynamic checkpointsFolly = folly::dynamic::object();
@@ -240,6 +260,50 @@ folly::dynamic CostEstimation::getEstimatedCostDynamic(
     }
     result.insert("checkpoint", folly::toJson(checkpointsFolly));
   }
+  auto& phaseProfiler = PhaseProfiler::getInstance();
+  if (!phaseProfiler.empty()) {
+    result.insert("phase", folly::toJson(phaseProfiler.toDynamic()));
+  }
+  return result;
+}
+
+folly::dynamic CostEstimation::getPredictedCostDynamic(
+    std::string run_name,
+    std::string party,
+    int64_t runningTimeInSec,
+    long networkRXBytes,
+    long networkTXBytes,
+    folly::dynamic info) const {
+  folly::dynamic result = folly::dynamic::object;
+
+  const auto now_ts = std::chrono::time_point_cast<std::chrono::seconds>(
+      std::chrono::system_clock::now());
+  const auto timestamp = now_ts.time_since_epoch().count();
+
+  auto t = std::time(nullptr);
+  char ds_string[40];
+  struct tm newTime;
+  std::strftime(
+      ds_string, sizeof(ds_string), "%Y-%m-%d", localtime_r(&t, &newTime));
+  result.insert("name", run_name);
+  result.insert("party", party);
+  result.insert("ds", ds_string);
+  result.insert("timestamp", timestamp);
+  result.insert("app_name", application_);
+  result.insert("app_version", version_);
+  result.insert("wall_time", runningTimeInSec);
+  result.insert("rx_bytes_dev", networkRXBytes);
+  result.insert("tx_bytes_dev", networkTXBytes);
+  result.insert("mem_alloted", MEMORY_SIZE);
+  result.insert("cpu_alloted", vCPUS);
+  result.insert(
+      "estimated_cost",
+      estimateCost(
+          runningTimeInSec,
+          static_cast<double>(networkRXBytes + networkTXBytes)));
+  result.insert("cloud_provider", CLOUD);
+  result.insert("additional_info", folly::toJson(info));
+  result.insert("predicted", true);
   return result;
 }
 
@@ -265,6 +329,56 @@ void CostEstimation::start() {
     networkRXBytes_ = result["rx"];
     networkTXBytes_ = result["tx"];
   }
+  if (FLAGS_cost_sampling_interval_ms > 0) {
+    startSampling(std::chrono::milliseconds(FLAGS_cost_sampling_interval_ms));
+  }
+}
+
+void CostEstimation::startSampling(std::chrono::milliseconds interval) {
+  sampler_ = std::make_unique<ResourceSampler>(
+      [this]() { return takeResourceSample(); }, interval);
+}
+
+ResourceSample CostEstimation::takeResourceSample() {
+  ResourceSample sample{
+      std::chrono::duration<double>(
+          std::chrono::system_clock::now() - start_time_)
+          .count(),
+      getCurrentRSS(),
+      0,
+      0,
+      0};
+  auto network = readNetworkSnapshot();
+  sample.networkRxBytes = network.at("rx");
+  sample.networkTxBytes = network.at("tx");
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) == 0) {
+    sample.cpuTime = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+        ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+  }
+  return sample;
+}
+
+// Summarizes the samples of the phase ending at every checkpoint, of the one
+// after the last checkpoint and of the whole run
+void CostEstimation::summarizeSamples() {
+  sampler_->stop();
+  auto samples = sampler_->getSamples();
+  sampler_.reset();
+
+  // The last sample is taken after end_time_, when the sampler stops
+  constexpr auto kEndTime = std::numeric_limits<double>::infinity();
+  std::vector<std::pair<std::string, std::pair<double, double>>> phases;
+  double phaseStart = 0;
+  for (size_t i = 0; i < checkPointName_.size(); ++i) {
+    phases.push_back({checkPointName_[i], {phaseStart, checkPointTime_[i]}});
+    phaseStart = checkPointTime_[i];
+  }
+  if (!checkPointName_.empty()) {
+    phases.push_back({"after last checkpoint", {phaseStart, kEndTime}});
+  }
+  phases.push_back({"total", {0, kEndTime}});
+  samplesSummary_ = ResourceSampler::summarize(samples, phases);
 }
 
 void CostEstimation::end() {
@@ -277,6 +391,9 @@ void CostEstimation::end() {
 
   runningTimeInSec_ = (end_time_ - start_time_) / std::chrono::seconds(1);
   calculateCost();
+  if (sampler_ != nullptr) {
+    summarizeSamples();
+  }
 }
 
 void CostEstimation::addCheckPoint(std::string checkPointName) {
@@ -297,6 +414,8 @@ void CostEstimation::addCheckPoint(std::string checkPointName) {
   current_metrics.curRSS = getCurrentRSS();
   checkPointMetrics_[checkPointName] = current_metrics;
   checkPointName_.push_back(checkPointName);
+  checkPointTime_.push_back(
+      std::chrono::duration<double>(current_time - start_time_).count());
   checkPoints_++;
 }
 
@@ -327,12 +446,31 @@ std::string CostEstimation::_writeToS3(
     std::string filePath,
     folly::dynamic costDynamic) {
   std::string costData = folly::toPrettyJson(costDynamic);
-  try {
-    XLOG(INFO) << "Writing cost file to s3: " << filePath;
-    fbpcf::io::FileIOWrappers::writeFile(filePath, costData);
-  } catch (const std::exception& e) {
-    XLOG(WARN) << "Warning: Exception writing cost in S3.\n\terror msg: "
-               << e.what();
+  XLOG(INFO) << "Writing cost file to s3: " << filePath;
+  // The write runs in the background, and is only waited for until the
+  // deadline, so that retries of a failed write don't hold up the end of the
+  // run. What earlier runs left in the spool is written alongside.
+  CostUploader uploader{
+      FLAGS_cost_spool_dir,
+      FLAGS_cost_upload_attempts,
+      std::chrono::seconds(1),
+      [](const std::string& path, const std::string& data) {
+        fbpcf::io::FileIOWrappers::writeFile(path, data);
+      }};
+  uploader.resumeSpooled();
+  uploader.upload(filePath, costData);
+  auto pending = uploader.waitFor(
+      std::chrono::milliseconds(std::max(FLAGS_cost_upload_deadline_ms, 0)));
+  if (pending > 0) {
+    return folly::to<std::string>(
+        "Still writing ",
+        filePath,
+        " after ",
+        FLAGS_cost_upload_deadline_ms,
+        "ms. Continuing execution, it is retried by the next run from ",
+        FLAGS_cost_spool_dir);
+  }
+  if (uploader.getFailed() > 0) {
     return "Failed to write " + filePath + ". Continuing execution.";
   }
   return "Successfully wrote cost info at : " + filePath;
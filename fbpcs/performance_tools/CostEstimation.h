@@ -8,8 +8,12 @@
 #pragma once
 
 #include <folly/dynamic.h>
+#include <chrono>
+#include <memory>
 #include <string>
 
+#include "fbpcs/performance_tools/ResourceSampler.h"
+
 namespace fbpcs::performance_tools {
 
 // Constants used for fargate container cost computation
@@ -58,11 +62,16 @@ class CostEstimation {
   size_t peakRSS_; // maximum virtual memory space used by the process, in kB
   std::unordered_map<std::string, CheckPointMetrics> checkPointMetrics_;
   std::vector<std::string> checkPointName_;
+  std::vector<double> checkPointTime_; // seconds since start, not rounded
   int checkPoints_ = 0;
+  std::unique_ptr<ResourceSampler> sampler_;
+  folly::dynamic samplesSummary_ = nullptr;
   void calculateCostCheckPoints();
   std::unordered_map<std::string, long> readNetworkSnapshot();
   size_t getPeakRSS();
   size_t getCurrentRSS();
+  ResourceSample takeResourceSample();
+  void summarizeSamples();
 
  public:
   explicit CostEstimation(
@@ -87,10 +96,32 @@ class CostEstimation {
       folly::dynamic info);
   folly::dynamic getEstimatedCostDynamic(std::string run_name);
 
+  // The cost dynamic of a run predicted from its running time and traffic
+  // instead of measured, with the fields of getEstimatedCostDynamic and
+  // "predicted" set
+  folly::dynamic getPredictedCostDynamic(
+      std::string run_name,
+      std::string party,
+      int64_t runningTimeInSec,
+      long networkRXBytes,
+      long networkTXBytes,
+      folly::dynamic info) const;
+
+  // The cost of running for runningTimeInSec on the alloted container,
+  // sending and receiving networkBytes in total
+  static double estimateCost(double runningTimeInSec, double networkBytes);
+
+  // Also starts sampling the resources every --cost_sampling_interval_ms if
+  // it is set
   void start();
   void end();
   void addCheckPoint(std::string checkPointName);
+  // Samples the RSS, network and CPU every interval until end(). The cost
+  // JSON then summarizes the samples between every two checkpoints.
+  void startSampling(std::chrono::milliseconds interval);
 
+  // Write the cost JSON in the background, waiting for it for at most
+  // --cost_upload_deadline_ms, and return a message of how it went
   std::string writeToS3(
       std::string party,
       std::string run_name,
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "fbpcs/performance_tools/CostUploader.h"
+#include <fcntl.h>
+#include <folly/logging/xlog.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iterator>
+#include <system_error>
+#include <utility>
+
+namespace fbpcs::performance_tools {
+
+namespace {
+constexpr char kSpoolSuffix[] = ".cost_upload";
+
+// A spool file name made of the characters of path which are safe in one
+std::string getSpoolName(const std::string& path) {
+  std::string name;
+  std::transform(
+      path.begin(), path.end(), std::back_inserter(name), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '.' ||
+                c == '-'
+            ? c
+            : '_';
+      });
+  return name + kSpoolSuffix;
+}
+
+bool writeAll(int fd, const std::string& data) {
+  std::size_t written = 0;
+  while (written < data.size()) {
+    auto size = ::write(fd, data.data() + written, data.size() - written);
+    if (size < 0) {
+      return false;
+    }
+    written += size;
+  }
+  return true;
+}
+
+bool readAll(int fd, std::string& data) {
+  char buf[4096];
+  while (true) {
+    auto size = ::read(fd, buf, sizeof(buf));
+    if (size < 0) {
+      return false;
+    }
+    if (size == 0) {
+      return true;
+    }
+    data.append(buf, size);
+  }
+}
+
+// Whether fd is still the file at path, which it isn't once the uploader
+// which held it has uploaded and removed it
+bool isFileAt(int fd, const std::string& path) {
+  struct stat opened;
+  struct stat current;
+  return ::fstat(fd, &opened) == 0 && ::stat(path.c_str(), &current) == 0 &&
+      opened.st_dev == current.st_dev && opened.st_ino == current.st_ino;
+}
+} // namespace
+
+CostUploader::CostUploader(
+    std::string spoolDir,
+    int maxAttempts,
+    std::chrono::milliseconds retryDelay,
+    Write write)
+    : spoolDir_{std::move(spoolDir)},
+      maxAttempts_{std::max(maxAttempts, 1)},
+      retryDelay_{retryDelay},
+      write_{std::move(write)} {}
+
+CostUploader::~CostUploader() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stopped_ = true;
+  }
+  changed_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void CostUploader::upload(const std::string& path, const std::string& data) {
+  start(path, data, spool(path, data));
+}
+
+std::size_t CostUploader::resumeSpooled() {
+  std::error_code error;
+  std::filesystem::directory_iterator entries{spoolDir_, error};
+  if (error) {
+    return 0;
+  }
+  std::size_t started = 0;
+  for (const auto& entry : entries) {
+    auto spoolPath = entry.path().string();
+    if (entry.path().extension() != kSpoolSuffix) {
+      continue;
+    }
+    // Files locked by another uploader are being uploaded by it
+    SpoolFile spoolFile{::open(spoolPath.c_str(), O_RDONLY), spoolPath};
+    if (spoolFile.fd < 0) {
+      continue;
+    }
+    std::string content;
+    if (::flock(spoolFile.fd, LOCK_EX | LOCK_NB) != 0 ||
+        !isFileAt(spoolFile.fd, spoolPath) ||
+        !readAll(spoolFile.fd, content)) {
+      ::close(spoolFile.fd);
+      continue;
+    }
+    // The first line is the path the upload goes to, and the rest its data
+    auto newline = content.find('\n');
+    if (newline == 0 || newline == std::string::npos) {
+      ::close(spoolFile.fd);
+      continue;
+    }
+    auto path = content.substr(0, newline);
+    XLOGF(INFO, "Resuming the upload of the spooled cost of {}", path);
+    start(path, content.substr(newline + 1), std::move(spoolFile));
+    ++started;
+  }
+  return started;
+}
+
+std::size_t CostUploader::waitFor(std::chrono::milliseconds deadline) {
+  std::unique_lock<std::mutex> lock{mutex_};
+  changed_.wait_for(lock, deadline, [this]() { return pending_ == 0; });
+  stopped_ = true;
+  changed_.notify_all();
+  return pending_;
+}
+
+std::size_t CostUploader::getFailed() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return failed_;
+}
+
+// Writes the upload to the spool directory, and returns its file there, or
+// no file if it couldn't be written, in which case it is still uploaded but
+// not retried by a later run. The file is locked before it is in the spool
+// directory, so that no other uploader resumes it.
+CostUploader::SpoolFile CostUploader::spool(
+    const std::string& path,
+    const std::string& data) {
+  if (spoolDir_.empty()) {
+    return SpoolFile{};
+  }
+  std::error_code error;
+  std::filesystem::create_directories(spoolDir_, error);
+  auto spoolPath =
+      (std::filesystem::path{spoolDir_} / getSpoolName(path)).string();
+  auto tmpPath = spoolPath + "." + std::to_string(::getpid()) + ".tmp";
+  SpoolFile spoolFile{
+      ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644), spoolPath};
+  if (spoolFile.fd < 0) {
+    XLOGF(WARN, "Could not spool the cost upload to {}", tmpPath);
+    return SpoolFile{};
+  }
+  if (::flock(spoolFile.fd, LOCK_EX) != 0 ||
+      !writeAll(spoolFile.fd, path + '\n' + data)) {
+    XLOGF(WARN, "Could not spool the cost upload to {}", tmpPath);
+    ::close(spoolFile.fd);
+    std::filesystem::remove(tmpPath, error);
+    return SpoolFile{};
+  }
+  std::filesystem::rename(tmpPath, spoolPath, error);
+  if (error) {
+    XLOGF(WARN, "Could not spool the cost upload to {}", spoolPath);
+    ::close(spoolFile.fd);
+    std::filesystem::remove(tmpPath, error);
+    return SpoolFile{};
+  }
+  return spoolFile;
+}
+
+void CostUploader::start(
+    std::string path,
+    std::string data,
+    SpoolFile spoolFile) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  ++pending_;
+  threads_.emplace_back([this,
+                         path = std::move(path),
+                         data = std::move(data),
+                         spoolFile = std::move(spoolFile)]() {
+    auto uploaded = run(path, data);
+    if (spoolFile.fd >= 0) {
+      // Removed before it is unlocked, so that no other uploader resumes it
+      if (uploaded) {
+        std::error_code error;
+        std::filesystem::remove(spoolFile.path, error);
+      }
+      ::close(spoolFile.fd);
+    }
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    --pending_;
+    if (!uploaded) {
+      ++failed_;
+    }
+    changed_.notify_all();
+  });
+}
+
+// Makes the attempts of an upload until one succeeds or the uploader is
+// stopped, and returns whether it was uploaded
+bool CostUploader::run(const std::string& path, const std::string& data) {
+  for (int attempt = 1; attempt <= maxAttempts_; ++attempt) {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      if (stopped_) {
+        return false;
+      }
+    }
+    try {
+      write_(path, data);
+      return true;
+    } catch (const std::exception& e) {
+      XLOGF(
+          WARN,
+          "Attempt {} of {} to write the cost to {} failed: {}",
+          attempt,
+          maxAttempts_,
+          path,
+          e.what());
+    }
+    if (attempt < maxAttempts_) {
+      std::unique_lock<std::mutex> lock{mutex_};
+      changed_.wait_for(
+          lock, retryDelay_ * attempt, [this]() { return stopped_; });
+    }
+  }
+  return false;
+}
+
+} // namespace fbpcs::performance_tools
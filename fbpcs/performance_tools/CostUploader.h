@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fbpcs::performance_tools {
+
+/*
+ * Uploads the cost JSON of a run on background threads, so that retries of a
+ * failed upload don't hold up the end of the run for longer than the caller
+ * waits for them.
+ *
+ * Every upload is first written to a spool directory, with the path it goes
+ * to, and removed from it once uploaded. Uploads which haven't finished by the
+ * deadline of waitFor make no further attempts, and are left in the spool for
+ * the next uploader given the same spool directory. An attempt already running
+ * then can't be cancelled, so the uploader waits for it when it is destroyed,
+ * rather than leaving a thread writing while the process exits.
+ *
+ * An uploader holds a lock on each spool file it uploads, so that uploaders of
+ * concurrent processes sharing a spool directory never resume each other's
+ * uploads.
+ */
+class CostUploader {
+ public:
+  using Write =
+      std::function<void(const std::string& path, const std::string& data)>;
+
+  CostUploader(
+      std::string spoolDir,
+      int maxAttempts,
+      std::chrono::milliseconds retryDelay,
+      Write write);
+
+  ~CostUploader();
+
+  CostUploader(const CostUploader&) = delete;
+  CostUploader& operator=(const CostUploader&) = delete;
+
+  // Uploads data to path, retrying up to maxAttempts times, a retryDelay
+  // longer after each attempt
+  void upload(const std::string& path, const std::string& data);
+
+  // Also uploads what earlier uploaders left in the spool directory and no
+  // other one is uploading. Returns how many uploads it started.
+  std::size_t resumeSpooled();
+
+  // Waits until every upload has finished or the deadline has passed, and
+  // returns how many are still running. Those are then stopped after the
+  // attempt they are making.
+  std::size_t waitFor(std::chrono::milliseconds deadline);
+
+  // How many uploads failed every attempt or were stopped, and are left in the
+  // spool
+  std::size_t getFailed() const;
+
+ private:
+  // A file of the spool directory, locked by this uploader while open
+  struct SpoolFile {
+    int fd = -1;
+    std::string path;
+  };
+
+  SpoolFile spool(const std::string& path, const std::string& data);
+  void start(std::string path, std::string data, SpoolFile spoolFile);
+  bool run(const std::string& path, const std::string& data);
+
+  std::string spoolDir_;
+  int maxAttempts_;
+  std::chrono::milliseconds retryDelay_;
+  Write write_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  std::size_t pending_ = 0;
+  std::size_t failed_ = 0;
+  bool stopped_ = false;
+  std::vector<std::thread> threads_;
+};
+
+} // namespace fbpcs::performance_tools
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "fbpcs/performance_tools/PhaseProfiler.h"
+#include <folly/logging/xlog.h>
+#include <folly/tracing/StaticTracepoint.h>
+#include <malloc.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <utility>
+
+namespace fbpcs::performance_tools {
+
+namespace {
+double toSeconds(const struct timeval& time) {
+  return time.tv_sec + time.tv_usec / 1e6;
+}
+
+// Number of threads of the process, from /proc/self/status
+int64_t getThreadCount() {
+  std::ifstream status{"/proc/self/status"};
+  for (std::string line; getline(status, line);) {
+    if (line.rfind("Threads:", 0) == 0) {
+      return std::stoll(line.substr(8));
+    }
+  }
+  return 0;
+}
+
+// Bytes in use on the heap of the process
+int64_t getHeapBytes() {
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  return mallinfo2().uordblks;
+#else
+  return 0;
+#endif
+}
+
+thread_local const ScopedPhase* currentPhase = nullptr;
+} // namespace
+
+void PhaseMetrics::add(const PhaseMetrics& other) {
+  count += other.count;
+  wallTime += other.wallTime;
+  userCpuTime += other.userCpuTime;
+  sysCpuTime += other.sysCpuTime;
+  maxThreads = std::max(maxThreads, other.maxThreads);
+  allocatedBytes += other.allocatedBytes;
+  mpc.nonFreeGates += other.mpc.nonFreeGates;
+  mpc.freeGates += other.mpc.freeGates;
+  mpc.sentNetwork += other.mpc.sentNetwork;
+  mpc.receivedNetwork += other.mpc.receivedNetwork;
+}
+
+folly::dynamic PhaseMetrics::toDynamic() const {
+  return folly::dynamic::object("count", count)("wall_time", wallTime)(
+      "user_cpu_time", userCpuTime)("sys_cpu_time", sysCpuTime)(
+      "max_threads", maxThreads)("allocated_bytes", allocatedBytes)(
+      "non_free_gates", mpc.nonFreeGates)("free_gates", mpc.freeGates)(
+      "sent_network", mpc.sentNetwork)(
+      "received_network", mpc.receivedNetwork);
+}
+
+PhaseProfiler& PhaseProfiler::getInstance() {
+  static PhaseProfiler profiler;
+  return profiler;
+}
+
+void PhaseProfiler::addPhase(
+    const std::string& name,
+    const PhaseMetrics& metrics) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto [it, inserted] = phaseMetrics_.try_emplace(name);
+  if (inserted) {
+    phaseNames_.push_back(name);
+  }
+  it->second.add(metrics);
+}
+
+bool PhaseProfiler::empty() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return phaseNames_.empty();
+}
+
+folly::dynamic PhaseProfiler::toDynamic() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  folly::dynamic phases = folly::dynamic::object();
+  for (const auto& name : phaseNames_) {
+    phases.insert(name, phaseMetrics_.at(name).toDynamic());
+  }
+  return phases;
+}
+
+ScopedPhase::ScopedPhase(
+    std::string name,
+    std::function<PhaseCounters()> readCounters)
+    : name_{std::move(name)},
+      readCounters_{std::move(readCounters)},
+      start_{takeSnapshot()},
+      outer_{currentPhase} {
+  currentPhase = this;
+  FOLLY_SDT(fbpcs, phase_begin, name_.c_str());
+}
+
+ScopedPhase::~ScopedPhase() {
+  end();
+}
+
+void ScopedPhase::end() {
+  if (ended_) {
+    return;
+  }
+  ended_ = true;
+  if (currentPhase == this) {
+    currentPhase = outer_;
+  }
+  try {
+    auto end = takeSnapshot();
+    PhaseMetrics metrics;
+    metrics.count = 1;
+    metrics.wallTime =
+        std::chrono::duration<double>(end.time - start_.time).count();
+    [[maybe_unused]] int64_t wallNs =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            end.time - start_.time)
+            .count();
+    FOLLY_SDT(fbpcs, phase_end, name_.c_str(), wallNs);
+    metrics.userCpuTime = end.userCpuTime - start_.userCpuTime;
+    metrics.sysCpuTime = end.sysCpuTime - start_.sysCpuTime;
+    metrics.maxThreads = getThreadCount();
+    metrics.allocatedBytes =
+        std::max<int64_t>(end.heapBytes - start_.heapBytes, 0);
+    metrics.mpc.nonFreeGates = end.mpc.nonFreeGates - start_.mpc.nonFreeGates;
+    metrics.mpc.freeGates = end.mpc.freeGates - start_.mpc.freeGates;
+    metrics.mpc.sentNetwork = end.mpc.sentNetwork - start_.mpc.sentNetwork;
+    metrics.mpc.receivedNetwork =
+        end.mpc.receivedNetwork - start_.mpc.receivedNetwork;
+    PhaseProfiler::getInstance().addPhase(name_, metrics);
+  } catch (const std::exception& e) {
+    XLOGF(WARN, "Failed to record phase {}: {}", name_, e.what());
+  }
+}
+
+const std::string& ScopedPhase::getCurrentName() {
+  static const std::string kNoPhase;
+  return currentPhase ? currentPhase->name_ : kNoPhase;
+}
+
+ScopedPhase::Snapshot ScopedPhase::takeSnapshot() const {
+  Snapshot snapshot{std::chrono::steady_clock::now(), 0, 0, getHeapBytes(), {}};
+  struct rusage ru;
+  if (getrusage(RUSAGE_THREAD, &ru) == 0) {
+    snapshot.userCpuTime = toSeconds(ru.ru_utime);
+    snapshot.sysCpuTime = toSeconds(ru.ru_stime);
+  }
+  if (readCounters_) {
+    snapshot.mpc = readCounters_();
+  }
+  return snapshot;
+}
+
+} // namespace fbpcs::performance_tools
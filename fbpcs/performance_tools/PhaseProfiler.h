@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/dynamic.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fbpcs::performance_tools {
+
+// Gate and traffic counters of an MPC scheduler
+struct PhaseCounters {
+  uint64_t nonFreeGates = 0;
+  uint64_t freeGates = 0;
+  uint64_t sentNetwork = 0;
+  uint64_t receivedNetwork = 0;
+};
+
+/*
+ * The resources used by all the runs of a phase, such as input parsing or
+ * output writing. CPU time is the time of the thread which ran the phase, and
+ * allocated bytes are the growth of the heap of the whole process, so phases
+ * running on other threads at the same time are counted too.
+ */
+struct PhaseMetrics {
+  int64_t count = 0;
+  double wallTime = 0; // seconds
+  double userCpuTime = 0; // seconds
+  double sysCpuTime = 0; // seconds
+  int64_t maxThreads = 0;
+  int64_t allocatedBytes = 0;
+  PhaseCounters mpc;
+
+  void add(const PhaseMetrics& other);
+  folly::dynamic toDynamic() const;
+};
+
+/*
+ * Collects the metrics of the phases of a run, from every thread, in the
+ * order the phases first finished. CostEstimation adds them to the cost
+ * JSON.
+ */
+class PhaseProfiler {
+ public:
+  static PhaseProfiler& getInstance();
+
+  void addPhase(const std::string& name, const PhaseMetrics& metrics);
+  bool empty() const;
+  folly::dynamic toDynamic() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<std::string> phaseNames_;
+  std::unordered_map<std::string, PhaseMetrics> phaseMetrics_;
+};
+
+/*
+ * Records a phase from its construction to its destruction, or to end() if
+ * that comes first, in the PhaseProfiler. readCounters, if set, reads the
+ * counters of the scheduler the phase runs on, and the phase records how much
+ * they grew. The phase also fires the phase tracepoints of Tracepoints.h.
+ */
+class ScopedPhase {
+ public:
+  explicit ScopedPhase(
+      std::string name,
+      std::function<PhaseCounters()> readCounters = nullptr);
+  ~ScopedPhase();
+
+  void end();
+
+  // The name of the innermost phase running on the calling thread, or an
+  // empty string outside of every phase
+  static const std::string& getCurrentName();
+
+  ScopedPhase(const ScopedPhase&) = delete;
+  ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+ private:
+  struct Snapshot {
+    std::chrono::steady_clock::time_point time;
+    double userCpuTime;
+    double sysCpuTime;
+    int64_t heapBytes;
+    PhaseCounters mpc;
+  };
+  Snapshot takeSnapshot() const;
+
+  std::string name_;
+  std::function<PhaseCounters()> readCounters_;
+  Snapshot start_;
+  bool ended_ = false;
+  // The phase which was running on the thread when this one started
+  const ScopedPhase* outer_;
+};
+
+} // namespace fbpcs::performance_tools
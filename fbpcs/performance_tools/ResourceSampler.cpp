@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "fbpcs/performance_tools/ResourceSampler.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace fbpcs::performance_tools {
+
+namespace {
+// Nearest rank percentile of values, which are sorted
+double percentile(const std::vector<double>& values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  auto rank = static_cast<std::size_t>(std::ceil(p * values.size()));
+  return values.at(std::clamp<std::size_t>(rank, 1, values.size()) - 1);
+}
+
+folly::dynamic summarizeValues(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return folly::dynamic::object("p50", percentile(values, 0.5))(
+      "p95", percentile(values, 0.95))(
+      "max", values.empty() ? 0 : values.back());
+}
+} // namespace
+
+ResourceSampler::ResourceSampler(
+    std::function<ResourceSample()> takeSample,
+    std::chrono::milliseconds interval,
+    std::size_t capacity)
+    : takeSample_{std::move(takeSample)},
+      interval_{interval},
+      capacity_{std::max<std::size_t>(capacity, 2)} {
+  samples_.reserve(capacity_);
+  thread_ = std::thread([this]() { run(); });
+}
+
+ResourceSampler::~ResourceSampler() {
+  stop();
+}
+
+void ResourceSampler::stop() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (stopRequested_) {
+      return;
+    }
+    stopRequested_ = true;
+  }
+  stopped_.notify_all();
+  thread_.join();
+  addSample(takeSample_());
+}
+
+std::vector<ResourceSample> ResourceSampler::getSamples() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  std::vector<ResourceSample> samples;
+  samples.reserve(samples_.size());
+  samples.insert(samples.end(), samples_.begin() + next_, samples_.end());
+  samples.insert(samples.end(), samples_.begin(), samples_.begin() + next_);
+  return samples;
+}
+
+void ResourceSampler::addSample(ResourceSample sample) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (samples_.size() < capacity_) {
+    samples_.push_back(sample);
+  } else {
+    samples_.at(next_) = sample;
+    next_ = (next_ + 1) % capacity_;
+  }
+}
+
+void ResourceSampler::run() {
+  while (true) {
+    addSample(takeSample_());
+    std::unique_lock<std::mutex> lock{mutex_};
+    if (stopped_.wait_for(
+            lock, interval_, [this]() { return stopRequested_; })) {
+      return;
+    }
+  }
+}
+
+folly::dynamic ResourceSampler::summarize(
+    const std::vector<ResourceSample>& samples,
+    const std::vector<std::pair<std::string, std::pair<double, double>>>&
+        phases) {
+  folly::dynamic summary = folly::dynamic::object();
+  for (const auto& [name, bounds] : phases) {
+    std::vector<double> rss, rxRate, txRate, cpuUtilization;
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+      const auto& sample = samples.at(i);
+      if (sample.time < bounds.first || sample.time >= bounds.second) {
+        continue;
+      }
+      rss.push_back(sample.curRSS);
+      if (i == 0) {
+        continue;
+      }
+      const auto& previous = samples.at(i - 1);
+      auto elapsed = sample.time - previous.time;
+      if (elapsed <= 0) {
+        continue;
+      }
+      rxRate.push_back(
+          (sample.networkRxBytes - previous.networkRxBytes) / elapsed);
+      txRate.push_back(
+          (sample.networkTxBytes - previous.networkTxBytes) / elapsed);
+      cpuUtilization.push_back((sample.cpuTime - previous.cpuTime) / elapsed);
+    }
+    summary.insert(
+        name,
+        folly::dynamic::object("samples", rss.size())(
+            "mem", summarizeValues(std::move(rss)))(
+            "rx_bytes_per_sec", summarizeValues(std::move(rxRate)))(
+            "tx_bytes_per_sec", summarizeValues(std::move(txRate)))(
+            "cpu_utilization", summarizeValues(std::move(cpuUtilization))));
+  }
+  return summary;
+}
+
+} // namespace fbpcs::performance_tools
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/dynamic.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace fbpcs::performance_tools {
+
+// Default number of samples kept, about an hour and a half at one per second
+constexpr std::size_t kDefaultSampleCapacity = 1 << 13;
+
+struct ResourceSample {
+  // Wall clock (std::chrono::system_clock) seconds since the run started, as
+  // set by takeSample. CostEstimation counts from CostEstimation::start().
+  double time;
+  size_t curRSS; // kB
+  long networkRxBytes;
+  long networkTxBytes;
+  double cpuTime; // user and system seconds of the process
+};
+
+/*
+ * Takes a ResourceSample on a background thread every interval, into a ring
+ * buffer of the last capacity ones, so that spikes and stalls between the
+ * checkpoints of CostEstimation are seen.
+ */
+class ResourceSampler {
+ public:
+  ResourceSampler(
+      std::function<ResourceSample()> takeSample,
+      std::chrono::milliseconds interval,
+      std::size_t capacity = kDefaultSampleCapacity);
+  ~ResourceSampler();
+
+  ResourceSampler(const ResourceSampler&) = delete;
+  ResourceSampler& operator=(const ResourceSampler&) = delete;
+
+  // Takes a last sample and stops the thread. Does nothing if it is stopped.
+  void stop();
+
+  // The samples kept, oldest first
+  std::vector<ResourceSample> getSamples() const;
+
+  /*
+   * Summarizes the p50, p95 and max of the RSS, the network rates and the CPU
+   * utilization over every phase, given as a name and its [begin, end) time
+   * on the same clock as ResourceSample::time. Rates are taken between a sample
+   * and the one before it, and count towards the phase of the later sample.
+   */
+  static folly::dynamic summarize(
+      const std::vector<ResourceSample>& samples,
+      const std::vector<std::pair<std::string, std::pair<double, double>>>&
+          phases);
+
+ private:
+  void addSample(ResourceSample sample);
+  void run();
+
+  std::function<ResourceSample()> takeSample_;
+  std::chrono::milliseconds interval_;
+  std::size_t capacity_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable stopped_;
+  bool stopRequested_ = false;
+  std::vector<ResourceSample> samples_;
+  std::size_t next_ = 0; // where the next sample goes once samples_ is full
+  std::thread thread_;
+};
+
+} // namespace fbpcs::performance_tools
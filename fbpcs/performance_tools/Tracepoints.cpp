@@ -0,0 +1,11 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "fbpcs/performance_tools/Tracepoints.h"
+
+FOLLY_SDT_DEFINE_SEMAPHORE(fbpcs, batch_begin)
+FOLLY_SDT_DEFINE_SEMAPHORE(fbpcs, batch_end)
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <folly/tracing/StaticTracepoint.h>
+
+/*
+Static tracepoints (USDT) of the games, in the fbpcs provider, which perf or
+bpftrace can attach to in a running game. A tracepoint nothing is attached to
+is a nop, and the batch tracepoints don't read the clock unless one is.
+
+  phase_begin(name)                     a ScopedPhase starts
+  phase_end(name, wall_ns)              and ends
+  batch_begin(name, first, size)        a batch of rows of a phase starts
+  batch_end(name, first, size, wall_ns) and ends
+
+where name is a C string, and first is the index of the first row of the
+batch. For example, the latency histogram of the ORAM batches of a running
+aggregation:
+
+  bpftrace -e 'usdt:./pcf2_aggregation_calculator:fbpcs:batch_end
+      /str(arg0) == "oram"/ { @ns = hist(arg3); }' -p <pid>
+*/
+FOLLY_SDT_DECLARE_SEMAPHORE(fbpcs, batch_begin);
+FOLLY_SDT_DECLARE_SEMAPHORE(fbpcs, batch_end);
+
+namespace fbpcs::performance_tools {
+
+// Fires the batch tracepoints at its construction and destruction. name must
+// outlive it.
+class ScopedBatch {
+ public:
+  ScopedBatch(const char* name, std::size_t first, std::size_t size)
+      : name_{name},
+        first_{first},
+        size_{size},
+        isTraced_{FOLLY_SDT_IS_ENABLED(fbpcs, batch_end)} {
+    FOLLY_SDT_WITH_SEMAPHORE(fbpcs, batch_begin, name_, first_, size_);
+    if (isTraced_) {
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~ScopedBatch() {
+    if (isTraced_) {
+      [[maybe_unused]] int64_t wallNs =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start_)
+              .count();
+      FOLLY_SDT_WITH_SEMAPHORE(fbpcs, batch_end, name_, first_, size_, wallNs);
+    }
+  }
+
+  ScopedBatch(const ScopedBatch&) = delete;
+  ScopedBatch& operator=(const ScopedBatch&) = delete;
+
+ private:
+  const char* name_;
+  std::size_t first_;
+  std::size_t size_;
+  bool isTraced_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace fbpcs::performance_tools
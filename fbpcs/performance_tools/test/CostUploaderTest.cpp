@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "folly/Random.h"
+
+#include "fbpcs/performance_tools/CostUploader.h"
+
+namespace fbpcs::performance_tools {
+
+class CostUploaderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    spoolDir_ = std::filesystem::temp_directory_path() /
+        ("CostUploaderTest_" + std::to_string(folly::Random::secureRand64()));
+  }
+
+  void TearDown() override {
+    std::filesystem::remove_all(spoolDir_);
+  }
+
+  // The contents of the files in the spool directory
+  std::vector<std::string> getSpooled() const {
+    std::vector<std::string> spooled;
+    if (!std::filesystem::exists(spoolDir_)) {
+      return spooled;
+    }
+    for (const auto& entry : std::filesystem::directory_iterator{spoolDir_}) {
+      std::ifstream in{entry.path()};
+      std::stringstream content;
+      content << in.rdbuf();
+      spooled.push_back(content.str());
+    }
+    return spooled;
+  }
+
+  std::string spoolDir_;
+};
+
+// Fails the first failures writes, and records the ones after
+class FakeWrite {
+ public:
+  explicit FakeWrite(int failures) : failures_{failures} {}
+
+  CostUploader::Write get() {
+    return [this](const std::string& path, const std::string& data) {
+      std::lock_guard<std::mutex> lock{mutex_};
+      ++attempts_;
+      if (attempts_ <= failures_) {
+        throw std::runtime_error("write failed");
+      }
+      written_[path] = data;
+    };
+  }
+
+  int getAttempts() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return attempts_;
+  }
+
+  std::map<std::string, std::string> getWritten() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return written_;
+  }
+
+ private:
+  std::mutex mutex_;
+  int failures_;
+  int attempts_ = 0;
+  std::map<std::string, std::string> written_;
+};
+
+TEST_F(CostUploaderTest, TestRetriesUntilWritten) {
+  FakeWrite write{2};
+  {
+    CostUploader uploader{
+        spoolDir_, 3, std::chrono::milliseconds(1), write.get()};
+    uploader.upload("s3://bucket/cost.json", "{}");
+    EXPECT_EQ(0, uploader.waitFor(std::chrono::seconds(10)));
+    EXPECT_EQ(0, uploader.getFailed());
+  }
+  EXPECT_EQ(3, write.getAttempts());
+  EXPECT_EQ("{}", write.getWritten().at("s3://bucket/cost.json"));
+  EXPECT_TRUE(getSpooled().empty());
+}
+
+TEST_F(CostUploaderTest, TestFailedUploadIsResumedByTheNextUploader) {
+  FakeWrite failingWrite{3};
+  {
+    CostUploader uploader{
+        spoolDir_, 3, std::chrono::milliseconds(1), failingWrite.get()};
+    uploader.upload("s3://bucket/cost.json", "{\"a\": 1}");
+    EXPECT_EQ(0, uploader.waitFor(std::chrono::seconds(10)));
+    EXPECT_EQ(1, uploader.getFailed());
+  }
+  EXPECT_EQ(3, failingWrite.getAttempts());
+  EXPECT_EQ(
+      std::vector<std::string>{"s3://bucket/cost.json\n{\"a\": 1}"},
+      getSpooled());
+
+  FakeWrite write{0};
+  {
+    CostUploader uploader{
+        spoolDir_, 3, std::chrono::milliseconds(1), write.get()};
+    EXPECT_EQ(1, uploader.resumeSpooled());
+    EXPECT_EQ(0, uploader.waitFor(std::chrono::seconds(10)));
+  }
+  EXPECT_EQ("{\"a\": 1}", write.getWritten().at("s3://bucket/cost.json"));
+  EXPECT_TRUE(getSpooled().empty());
+}
+
+TEST_F(CostUploaderTest, TestDeadlineStopsTheAttemptsAndKeepsTheSpool) {
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  std::atomic<int> attempts{0};
+  auto blockingWrite = [&attempts, released](
+                           const std::string&, const std::string&) {
+    ++attempts;
+    released.wait();
+    throw std::runtime_error("write failed");
+  };
+
+  {
+    CostUploader uploader{
+        spoolDir_, 3, std::chrono::milliseconds(1), blockingWrite};
+    uploader.upload("s3://bucket/cost.json", "{}");
+    EXPECT_EQ(1, uploader.waitFor(std::chrono::milliseconds(50)));
+
+    // Another uploader doesn't resume an upload which is still running
+    FakeWrite write{0};
+    CostUploader otherUploader{
+        spoolDir_, 3, std::chrono::milliseconds(1), write.get()};
+    EXPECT_EQ(0, otherUploader.resumeSpooled());
+
+    // The uploader waits for the attempt it was making when destroyed
+    release.set_value();
+  }
+  EXPECT_EQ(1, attempts.load());
+  EXPECT_EQ(
+      std::vector<std::string>{"s3://bucket/cost.json\n{}"}, getSpooled());
+}
+
+TEST_F(CostUploaderTest, TestUploadsWithoutSpool) {
+  FakeWrite write{0};
+  {
+    CostUploader uploader{"", 3, std::chrono::milliseconds(1), write.get()};
+    EXPECT_EQ(0, uploader.resumeSpooled());
+    uploader.upload("s3://bucket/cost.json", "{}");
+    EXPECT_EQ(0, uploader.waitFor(std::chrono::seconds(10)));
+  }
+  EXPECT_EQ("{}", write.getWritten().at("s3://bucket/cost.json"));
+}
+
+} // namespace fbpcs::performance_tools
@@ -17,6 +17,7 @@ class PCSFeature(Enum):
     PC_COORDINATED_RETRY = "private_computation_coordinated_retry"
     PRIVATE_LIFT_UNIFIED_DATA_PROCESS = "private_lift_unified_data_process"
     PCS_PRIVATE_LIFT_DECOUPLED_UDP = "pcs_private_lift_decoupled_udp"
+    PRIVATE_LIFT_BINARY_SECRET_SHARES = "private_lift_binary_secret_shares"
     PRIVATE_ATTRIBUTION_MR_PID = "private_attribution_with_mr_pid"
     SHARD_COMBINER_PCF2_RELEASE = "shard_combiner_pcf2_release"
     NUM_MPC_CONTAINER_MUTATION = "num_mpc_container_mutation"